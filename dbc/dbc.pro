@@ -30,47 +30,90 @@ CONFIG += c++14
 INCLUDEPATH += include
 HEADERS = include/metatypes.h \
           include/log.h \
+          include/log_writer.h \
+          include/metrics_registry.h \
+          include/request_tracer.h \
+          include/worker_pools.h \
+          include/thread_placement.h \
+          include/query_statistics.h \
+          include/traffic_recorder.h \
           include/dbc.h \
           include/cache_base.h \
           include/cache.h \
+          include/concurrent_cache.h \
+          include/cache_warmer.h \
           include/database_manager.h \
+          include/id_registry.h \
+          include/catalog.h \
           include/sql_helpers.h \
           include/region.h \
           include/regions.h \
           include/server.h \
           include/servers.h \
           include/server_administrator.h \
+          include/server_load_index.h \
+          include/server_health_statistics.h \
           include/customer_secret.h \
           include/customer_secrets.h \
           include/host_scheme.h \
           include/host_schemes.h \
           include/scheme_host.h \
           include/scheme_host_path.h \
+          include/string_pool.h \
           include/monitor.h \
           include/monitors.h \
           include/monitor_updater.h \
           include/customer_capabilities.h \
           include/customers_capabilities.h \
+          include/customer_rate_limiter.h \
           include/customer_mapping.h \
+          include/shard_map.h \
           include/event.h \
           include/events.h \
           include/event_processor.h \
           include/short_latency_entry.h \
           include/latency_entry.h \
+          include/latency_entry_chunk_list.h \
+          include/latency_deduplicator.h \
+          include/latency_spool.h \
+          include/latency_rollup.h \
+          include/latency_sketch.h \
+          include/latency_block.h \
+          include/latency_populations.h \
+          include/latency_purger.h \
+          include/job_scheduler.h \
+          include/periodic_scheduler.h \
+          include/warm_start.h \
+          include/statement_pipeline.h \
+          include/typed_result_set.h \
+          include/memory_governor.h \
+          include/cache_invalidation_bus.h \
+          include/latency_archive.h \
           include/aggregated_latency_entry.h \
           include/latency_interface.h \
+          include/latency_ring_buffer.h \
+          include/latency_rolling_statistics.h \
+          include/latency_result_cache.h \
           include/latency_aggregator.h \
           include/latency_interface_manager.h \
+          include/query_executor.h \
+          include/query_plan_checker.h \
+          include/plot_worker_pool.h \
+          include/plot_cache.h \
+          include/dashboard_cache.h \
           include/plotter_base.h \
           include/latency_plotter.h \
           include/plot_mailbox.h \
           include/rest_helpers.h \
+          include/json_stream_writer.h \
+          include/response_compressor.h \
           include/active_resources.h \
           include/resource.h \
           include/resources.h \
           include/resource_plotter.h \
           include/region_manager.h \
           include/server_manager.h \
+          include/job_manager.h \
           include/host_scheme_manager.h \
           include/monitor_manager.h \
           include/customer_capabilities_manager.h \
@@ -79,6 +122,7 @@ HEADERS = include/metatypes.h \
           include/latency_manager.h \
           include/multiple_manager.h \
           include/resource_manager.h \
+          include/metrics_manager.h \
           include/customer_authenticator.h \
           include/customer_rest_api_v1.h \
           include/outbound_rest_api.h \
@@ -91,38 +135,80 @@ HEADERS = include/metatypes.h \
 SOURCES = source/main.cpp \
           source/metatypes.cpp \
           source/log.cpp \
+          source/log_writer.cpp \
+          source/metrics_registry.cpp \
+          source/request_tracer.cpp \
+          source/worker_pools.cpp \
+          source/thread_placement.cpp \
+          source/query_statistics.cpp \
+          source/traffic_recorder.cpp \
           source/dbc.cpp \
           source/cache_base.cpp \
+          source/cache_warmer.cpp \
           source/database_manager.cpp \
+          source/id_registry.cpp \
+          source/catalog.cpp \
           source/sql_helpers.cpp \
           source/regions.cpp \
           source/server.cpp \
           source/servers.cpp \
           source/server_administrator.cpp \
+          source/server_load_index.cpp \
+          source/server_health_statistics.cpp \
           source/customer_secret.cpp \
           source/customer_secrets.cpp \
           source/host_schemes.cpp \
+          source/string_pool.cpp \
           source/monitor.cpp \
           source/monitors.cpp \
           source/monitor_updater.cpp \
           source/customers_capabilities.cpp \
+          source/customer_rate_limiter.cpp \
           source/customer_mapping.cpp \
+          source/shard_map.cpp \
           source/event.cpp \
           source/events.cpp \
           source/event_processor.cpp \
+          source/latency_entry_chunk_list.cpp \
+          source/latency_deduplicator.cpp \
+          source/latency_spool.cpp \
+          source/latency_rollup.cpp \
+          source/latency_sketch.cpp \
+          source/latency_block.cpp \
+          source/latency_populations.cpp \
+          source/latency_purger.cpp \
+          source/job_scheduler.cpp \
+          source/periodic_scheduler.cpp \
+          source/warm_start.cpp \
+          source/statement_pipeline.cpp \
+          source/typed_result_set.cpp \
+          source/memory_governor.cpp \
+          source/cache_invalidation_bus.cpp \
+          source/latency_archive.cpp \
           source/latency_interface.cpp \
+          source/latency_ring_buffer.cpp \
+          source/latency_rolling_statistics.cpp \
+          source/latency_result_cache.cpp \
           source/latency_aggregator.cpp \
           source/latency_aggregator_private.cpp \
           source/latency_interface_manager.cpp \
+          source/query_executor.cpp \
+          source/query_plan_checker.cpp \
+          source/plot_worker_pool.cpp \
+          source/plot_cache.cpp \
+          source/dashboard_cache.cpp \
           source/plotter_base.cpp \
           source/latency_plotter.cpp \
           source/plot_mailbox.cpp \
           source/rest_helpers.cpp \
+          source/json_stream_writer.cpp \
+          source/response_compressor.cpp \
           source/active_resources.cpp \
           source/resources.cpp \
           source/resource_plotter.cpp \
           source/region_manager.cpp \
           source/server_manager.cpp \
+          source/job_manager.cpp \
           source/host_scheme_manager.cpp \
           source/monitor_manager.cpp \
           source/customer_capabilities_manager.cpp \
@@ -131,6 +217,7 @@ SOURCES = source/main.cpp \
           source/latency_manager.cpp \
           source/multiple_manager.cpp \
           source/resource_manager.cpp \
+          source/metrics_manager.cpp \
           source/customer_authenticator.cpp \
           source/customer_rest_api_v1.cpp \
           source/outbound_rest_api.cpp \
@@ -151,11 +238,13 @@ INCLUDEPATH += $${INEREST_API_IN_V1_INCLUDE}
 INCLUDEPATH += $${INEREST_API_OUT_V1_INCLUDE}
 INCLUDEPATH += $${INECRYPTO_INCLUDE}
 INCLUDEPATH += $${INEXTEA_INCLUDE}
+INCLUDEPATH += $${LIBPQ_INCLUDE}
 
 LIBS += -L$${INEREST_API_IN_V1_LIBDIR} -linerest_api_in_v1
 LIBS += -L$${INEREST_API_OUT_V1_LIBDIR} -linerest_api_out_v1
 LIBS += -L$${INECRYPTO_LIBDIR} -linecrypto
 LIBS += -L$${INEXTEA_LIBDIR} -linextea
+LIBS += -L$${LIBPQ_LIBDIR} -lpq
 
 ########################################################################################################################
 # Locate build intermediate and output products
@@ -24,6 +24,7 @@
 #define CACHE_H
 
 #include <cstdint>
+#include <cstring>
 
 #include "cache_base.h"
 #include "customer_secret.h"
@@ -32,7 +33,14 @@ class QTimer;
 class DatabaseManager;
 
 /**
- * Template class you can use to create a cache with random eviction.
+ * Template class you can use to create a cache.  The eviction policy is selectable, see
+ * \ref CacheBase::EvictionPolicy.  The cache also tracks hit, miss, eviction, and probe length statistics.
+ *
+ * The cache is an open addressed hash table using a layout similar to a Swiss table.  The table size is a power of
+ * two.  Each table entry has a one byte control value, held in a separate array, that either marks the entry as empty
+ * or deleted or holds 7 bits of the entry's hash.  Lookups examine groups of 16 control bytes at a time, using SSE2
+ * when available, and only compare IDs for entries whose control byte matches.  Values and eviction policy state are
+ * held in their own arrays so probing touches as few cache lines as possible.
  *
  * The parameter T is the datatype being cached.  The type T must be default constructable and assignable.  The
  * parameter ID should be a C++ pod type with a predictable byte representation.
@@ -45,30 +53,116 @@ template<typename T, typename ID> class Cache:public CacheBase {
          * Constructor
          *
          * \param[in] maximumCacheDepth The maximum allowed cache depth.
+         *
+         * \param[in] evictionPolicy    The eviction policy to use when the cache is full.
          */
-        Cache(Index maximumCacheDepth) {
-            cacheTable = nullptr;
-            resizeCache(maximumCacheDepth);
+        Cache(Index maximumCacheDepth, EvictionPolicy evictionPolicy = EvictionPolicy::RANDOM) {
+            controlBytes          = nullptr;
+            values                = nullptr;
+            usages                = nullptr;
+            currentEvictionPolicy = evictionPolicy;
+            currentAccessClock    = 0;
+            clockHand             = 0;
+
+            currentNumberCachedEntries = 0;
+            currentMaximumCacheDepth   = maximumCacheDepth;
+
+            allocateTable(calculateCacheTableSize(maximumCacheDepth));
+
+            if (currentEvictionPolicy == EvictionPolicy::TINY_LFU) {
+                frequencySketch.resize(maximumCacheDepth);
+            }
         }
 
         virtual ~Cache() {
-            delete[] cacheTable;
+            releaseTable();
         }
 
         /**
-         * Method that resizes the cache.  This method will evict all cache entries.
+         * Method that resizes the cache.  Existing entries are retained and rehashed into the new table.  If the
+         * cache is shrinking, entries are evicted, using the current eviction policy, until the remaining entries
+         * fit.  The method does nothing if the cache size is unchanged.
          *
          * \param[in] newCacheSize The new cache size.
          */
         void resizeCache(unsigned long newCacheSize) {
-            if (cacheTable != nullptr) {
-                delete[] cacheTable;
+            if (newCacheSize != currentMaximumCacheDepth) {
+                while (currentNumberCachedEntries > newCacheSize) {
+                    eraseEntry(selectVictim());
+                    ++currentStatistics.evictions;
+                }
+
+                currentMaximumCacheDepth = newCacheSize;
+
+                Index newTableSize = calculateCacheTableSize(newCacheSize);
+                if (newTableSize != currentCacheTableSize) {
+                    rehashTable(newTableSize);
+                }
+
+                if (currentEvictionPolicy == EvictionPolicy::TINY_LFU) {
+                    frequencySketch.resize(newCacheSize);
+                }
             }
+        }
+
+        /**
+         * Method that discards every cached entry.  The cache depth and statistics are retained.
+         */
+        void clearCache() {
+            Index tableSize = currentCacheTableSize;
+
+            releaseTable();
+            allocateTable(tableSize);
 
             currentNumberCachedEntries = 0;
-            currentMaximumCacheDepth   = newCacheSize;
-            currentCacheTableSize      = calculateCacheTableSize(newCacheSize);
-            cacheTable                 = new Entry[currentCacheTableSize]();
+            clockHand                  = 0;
+        }
+
+        /**
+         * Method you can use to determine the current eviction policy.
+         *
+         * \return Returns the current eviction policy.
+         */
+        inline EvictionPolicy evictionPolicy() const {
+            return currentEvictionPolicy;
+        }
+
+        /**
+         * Method you can use to change the eviction policy.  Cached entries are retained.
+         *
+         * \param[in] newEvictionPolicy The new eviction policy.
+         */
+        void setEvictionPolicy(EvictionPolicy newEvictionPolicy) {
+            if (newEvictionPolicy != currentEvictionPolicy) {
+                if (newEvictionPolicy == EvictionPolicy::TINY_LFU) {
+                    frequencySketch.resize(currentMaximumCacheDepth);
+                } else if (currentEvictionPolicy == EvictionPolicy::TINY_LFU) {
+                    frequencySketch.resize(0);
+                }
+
+                currentEvictionPolicy = newEvictionPolicy;
+            }
+        }
+
+        /**
+         * Method you can use to obtain the cache statistics accumulated since the cache was created or the
+         * statistics were last reset, along with the current cache occupancy.
+         *
+         * \return Returns the cache statistics.
+         */
+        inline Statistics statistics() const {
+            Statistics result = currentStatistics;
+            result.numberEntries = currentNumberCachedEntries;
+            result.tableSize     = currentCacheTableSize;
+
+            return result;
+        }
+
+        /**
+         * Method you can use to reset the cache statistics.
+         */
+        void resetStatistics() {
+            currentStatistics = Statistics();
         }
 
         /**
@@ -80,8 +174,8 @@ template<typename T, typename ID> class Cache:public CacheBase {
          *         is not in the cache.
          */
         const T* getCacheEntry(ID entryId) const {
-            Index index = locateEntry(entryId);
-            return index != invalidIndex ? cacheTable[index].pointer() : nullptr;
+            Index index = lookupEntry(entryId);
+            return index != invalidIndex ? values + index : nullptr;
         }
 
         /**
@@ -94,8 +188,8 @@ template<typename T, typename ID> class Cache:public CacheBase {
          *         is not in the cache.
          */
         T* getCacheEntry(ID entryId) {
-            Index index = locateEntry(entryId);
-            return index != invalidIndex ? cacheTable[index].pointer() : nullptr;
+            Index index = lookupEntry(entryId);
+            return index != invalidIndex ? values + index : nullptr;
         }
 
         /**
@@ -106,54 +200,11 @@ template<typename T, typename ID> class Cache:public CacheBase {
          * \return Returns true on success.  Returns false on error.
          */
         bool evictCacheEntry(ID entryId) {
-            bool success = false;
-
-            Index hashedIndex     = initialHashIndex(entryId);
-            Index maximumDistance = cacheTable[hashedIndex].maximumDistance();
-
-            if (maximumDistance > 0) {
-                Entry* entry         = cacheTable + hashedIndex;
-                bool   entryOccupied = entry->isOccupied();
-                ID     thisEntryId   = entryOccupied ? idFromValue(entry->reference()) : 0;
+            Index index   = locateEntry(entryId, hashId(entryId));
+            bool  success = (index != invalidIndex);
 
-                if (maximumDistance == 1 && entryOccupied && thisEntryId == entryId) {
-                    *entry = Entry();
-
-                    --currentNumberCachedEntries;
-                    success = true;
-                } else {
-                    Index newMaximumDistance = 0;
-                    Index currentDistance    = 0;
-                    Index index              = hashedIndex;
-
-                    while (maximumDistance > currentDistance && (!entryOccupied || thisEntryId != entryId)) {
-                        ++currentDistance;
-
-                        if (entryOccupied && initialHashIndex(thisEntryId) == hashedIndex) {
-                            newMaximumDistance = currentDistance;
-                        }
-
-                        index = nextIndex(index);
-
-                        entry = cacheTable + index;
-                        entryOccupied = entry->isOccupied();
-                        if (entryOccupied) {
-                            thisEntryId = idFromValue(entry->reference());
-                        }
-                    }
-
-                    if (thisEntryId == entryId) {
-                        entry->clearValue();
-                        entry->markUnoccupied();
-
-                        if (currentDistance == maximumDistance) {
-                            cacheTable[hashedIndex].setMaximumDistance(newMaximumDistance);
-                        }
-
-                        --currentNumberCachedEntries;
-                        success = true;
-                    }
-                }
+            if (success) {
+                eraseEntry(index);
             }
 
             return success;
@@ -161,49 +212,40 @@ template<typename T, typename ID> class Cache:public CacheBase {
 
         /**
          * Method you can use to add a new cache entry to the cache.  If needed, another entry will be evicted to
-         * make room for this entry.
+         * make room for this entry.  Under the \ref CacheBase::EvictionPolicy::TINY_LFU policy, the new entry may be
+         * rejected instead.
          *
          * \param[in] value The value to be added.
          */
         void addToCache(const T& value) {
-            ID entryId = idFromValue(value);
-
-            Index hashedIndex = initialHashIndex(entryId);
-            Index index       = locateEntry(entryId, hashedIndex);
+            ID            entryId   = idFromValue(value);
+            std::uint64_t hashValue = hashId(entryId);
+            Index         index     = locateEntry(entryId, hashValue);
 
             if (index != invalidIndex) {
-                cacheTable[index].setValue(value);
-            } else {
+                values[index] = value;
+                touchEntry(index);
+            } else if (currentMaximumCacheDepth > 0) {
+                bool admit = true;
                 if (currentNumberCachedEntries >= currentMaximumCacheDepth) {
-                    performRandomEviction();
-                }
+                    Index victimIndex = selectVictim();
 
-                // Note that the algorithm below will hang if the cache ever becomes completely full.  We rely on the
-                // fact that we perform evictions above to avoid having to add extra code to detect the cache full
-                // table condition.
-                //
-                // Note that keeping the cache relatively unpopulated causes us to statistically find most entries on
-                // the first try.  If needed, this can be modeled reasonably accurately via a binomial distribution.
-
-                Entry* hashedEntry     = cacheTable + hashedIndex;
-                Entry* entry           = hashedEntry;
-                Index  maximumDistance = hashedEntry->maximumDistance();
-                Index  currentDistance = 1;
-
-                index = hashedIndex;
-                while (entry->isOccupied()) {
-                    ++currentDistance;
-                    index = nextIndex(index);
-                    entry = cacheTable + index;
-                }
+                    if (currentEvictionPolicy == EvictionPolicy::TINY_LFU) {
+                        std::uint64_t victimHashValue = hashId(idFromValue(values[victimIndex]));
+                        admit = frequencySketch.estimate(hashValue) > frequencySketch.estimate(victimHashValue);
+                    }
 
-                entry->setValue(value);
-                entry->markOccupied();
-                if (currentDistance > maximumDistance) {
-                    hashedEntry->setMaximumDistance(currentDistance);
+                    if (admit) {
+                        eraseEntry(victimIndex);
+                        ++currentStatistics.evictions;
+                    } else {
+                        ++currentStatistics.rejections;
+                    }
                 }
 
-                ++currentNumberCachedEntries;
+                if (admit) {
+                    insertEntry(value, hashValue);
+                }
             }
         }
 
@@ -219,375 +261,340 @@ template<typename T, typename ID> class Cache:public CacheBase {
 
     private:
         /**
-         * Class that holds a single cache entry.
+         * The number of entries sampled by the approximate LRU policies.
          */
-        class Entry {
-            public:
-                Entry() {
-                    currentValue           = T();
-                    currentMaximumDistance = 0;
-                    currentIsOccupied      = false;
-                }
-
-                /**
-                 * Constructor
-                 *
-                 * \param[in] value The value to be cached.
-                 */
-                inline Entry(
-                        const T& value
-                    ):currentValue(
-                        value
-                    ),currentMaximumDistance(
-                        0
-                    ),currentIsOccupied(
-                        false
-                    ) {}
-
-                /**
-                 * Constructor
-                 *
-                 * \param[in] value           The value to be cached.
-                 *
-                 * \param[in] maximumDistance The maximum distance to specify for this entry.
-                 */
-                inline Entry(
-                        const T& value,
-                        Index    maximumDistance
-                    ):currentValue(
-                        value
-                    ),currentMaximumDistance(
-                        maximumDistance
-                    ),currentIsOccupied(
-                        true
-                    ) {}
-
-                /**
-                 * Constructor
-                 *
-                 * \param[in] value           The value to be cached.
-                 *
-                 * \param[in] maximumDistance The maximum distance to specify for this entry.
-                 *
-                 * \param[in] isOccupied      Flag indicating if this entry should be marked as occupied.
-                 */
-                inline Entry(
-                        const T& value,
-                        Index    maximumDistance,
-                        bool     isOccupied
-                    ):currentValue(
-                        value
-                    ),currentMaximumDistance(
-                        maximumDistance
-                    ),currentIsOccupied(
-                        isOccupied
-                    ) {}
-
-                /**
-                 * Copy constructor
-                 *
-                 * \param[in] other The instance to assign to this instance.
-                 */
-                inline Entry(
-                        const Entry& other
-                    ):currentValue(
-                        other.currentValue
-                    ),currentMaximumDistance(
-                        other.currentMaximumDistance
-                    ),currentIsOccupied(
-                        other.currentIsOccupied
-                    ) {}
-
-                /**
-                 * Move constructor
-                 *
-                 * \param[in] other The instance to assign to this instance.
-                 */
-                inline Entry(
-                        Entry&& other
-                    ):currentValue(
-                        other.currentValue
-                    ),currentMaximumDistance(
-                        other.currentMaximumDistance
-                    ),currentIsOccupied(
-                        other.currentIsOccupied
-                    ) {}
-
-                ~Entry() {}
-
-                /**
-                 * Method you can use to determine if this location is occupied.
-                 *
-                 * \return Returns true if the location is occupied.  Returns false if the location is not occupied.
-                 */
-                inline bool isOccupied() const {
-                    return currentIsOccupied;
-                }
+        static constexpr unsigned lruSampleSize = 5;
 
-                /**
-                 * Method you can use to determine if this location is unoccupied.
-                 *
-                 * \return Returns true if the location is unoccupied.  Returns false if the location is occupied.
-                 */
-                inline bool isUnoccupied() const {
-                    return !currentIsOccupied;
-                }
+        /**
+         * Method that calculates the first probe group for a hash.
+         *
+         * \param[in] hashValue The hash of the entry ID.
+         *
+         * \return Returns the index of the first probe group.
+         */
+        inline Index initialGroup(std::uint64_t hashValue) const {
+            return static_cast<Index>(hashValue >> 7) & groupMask;
+        }
 
-                /**
-                 * Method you can use to mark this location as occupied.
-                 *
-                 * \param[in] nowOccupied If true, the location will be marked as occupied.  If false, the location
-                 *                        will be marked as unoccupied.
-                 */
-                inline void markOccupied(bool nowOccupied = true) {
-                    currentIsOccupied = nowOccupied;
-                }
+        /**
+         * Method that calculates the control byte tag for a hash.
+         *
+         * \param[in] hashValue The hash of the entry ID.
+         *
+         * \return Returns the 7-bit tag.
+         */
+        static inline std::uint8_t controlTag(std::uint64_t hashValue) {
+            return static_cast<std::uint8_t>(hashValue) & controlTagMask;
+        }
 
-                /**
-                 * Method you can use to mark this location as unoccupied.
-                 *
-                 * \param[in] nowUnoccupied If true, the location will be marked as unoccupied.  If false, the location
-                 *                          will be marked as occupied.
-                 */
-                inline void markUnoccupied(bool nowUnoccupied = true) {
-                    currentIsOccupied = !nowUnoccupied;
-                }
+        /**
+         * Method that finds the entry in the cache.  Groups are visited using triangular probing which is guaranteed
+         * to visit every group because the number of groups is a power of two.
+         *
+         * \param[in]  entryId      The ID of the entry to be located.
+         *
+         * \param[in]  hashValue    The hash of the entry ID.
+         *
+         * \param[out] groupsProbed An optional pointer to a value to be populated with the number of probe groups
+         *                          examined.
+         *
+         * \return Returns the index into the cache where the entry resides.  A value of \ref invalidIndex is returned
+         *         if the entry can not be found.
+         */
+        Index locateEntry(ID entryId, std::uint64_t hashValue, Index* groupsProbed = nullptr) const {
+            std::uint8_t tag    = controlTag(hashValue);
+            Index        group  = initialGroup(hashValue);
+            Index        probe  = 0;
+            Index        result = invalidIndex;
+            bool         done;
 
-                /**
-                 * Method that clears the value for this entry.
-                 */
-                inline void clearValue() {
-                    currentValue = T();
-                }
+            do {
+                const std::uint8_t* groupControl = controlBytes + group * groupWidth;
 
-                /**
-                 * Method you can use to obtain the value at this location.
-                 *
-                 * \return Returns a constant reference to the value.
-                 */
-                inline const T& reference() const {
-                    return currentValue;
-                }
+                GroupMask matches = matchControl(groupControl, tag);
+                while (matches != 0 && result == invalidIndex) {
+                    Index index = group * groupWidth + lowestBitIndex(matches);
+                    if (idFromValue(values[index]) == entryId) {
+                        result = index;
+                    }
 
-                /**
-                 * Method you can use to obtain the value at this location.
-                 *
-                 * \return Returns a constant reference to the value.
-                 */
-                inline T& reference() {
-                    return currentValue;
+                    matches &= matches - 1;
                 }
 
-                /**
-                 * Method you can use to obtain the value at this location.
-                 *
-                 * \return Returns a constant reference to the value.
-                 */
-                inline const T* pointer() const {
-                    return &currentValue;
-                }
+                ++probe;
+                done  = (   result != invalidIndex
+                         || matchControl(groupControl, controlEmpty) != 0
+                         || probe > groupMask
+                        );
+                group = (group + probe) & groupMask;
+            } while (!done);
 
-                /**
-                 * Method you can use to obtain the value at this location.
-                 *
-                 * \return Returns a constant reference to the value.
-                 */
-                inline T* pointer() {
-                    return &currentValue;
-                }
+            if (groupsProbed != nullptr) {
+                *groupsProbed = probe;
+            }
 
-                /**
-                 * Method you can use to set the value at this location.
-                 *
-                 * \param[in] newValue The new value for the location.
-                 */
-                inline void setValue(const T& newValue) {
-                    currentValue = newValue;
-                }
+            return result;
+        }
 
-                /**
-                 * Method you can use to obtain the current maximum distance for this hash location.
-                 *
-                 * \return Returns the maximum distance.
-                 */
-                inline Index maximumDistance() const {
-                    return currentMaximumDistance;
-                }
+        /**
+         * Method that finds the entry in the cache on behalf of a caller, updating the statistics and the state used
+         * by the eviction policy.
+         *
+         * \param[in] entryId The ID of the desired entry.
+         *
+         * \return Returns the index into the cache where the entry resides.  A value of \ref invalidIndex is returned
+         *         if the entry can not be found.
+         */
+        Index lookupEntry(ID entryId) const {
+            std::uint64_t hashValue = hashId(entryId);
+            Index         groupsProbed;
+            Index         index     = locateEntry(entryId, hashValue, &groupsProbed);
 
-                /**
-                 * Method you can use to update the maximum distance for this hash location.
-                 *
-                 * \param[in] newMaximumDistance The new maximum distance value.
-                 */
-                inline void setMaximumDistance(Index newMaximumDistance) {
-                    currentMaximumDistance = newMaximumDistance;
-                }
+            ++currentStatistics.probeLengths[
+                groupsProbed < numberProbeLengthBins ? groupsProbed - 1 : numberProbeLengthBins - 1
+            ];
 
-                /**
-                 * Assignment operator
-                 *
-                 * \param[in] other The instance to assign to this instance.
-                 *
-                 * \return Returns a reference to this instance.
-                 */
-                inline Entry& operator=(const Entry& other) {
-                    currentValue           = other.currentValue;
-                    currentMaximumDistance = other.currentMaximumCacheDepth;
-                    currentIsOccupied      = other.currentIsOccupied;
-
-                    return *this;
-                }
+            if (index != invalidIndex) {
+                ++currentStatistics.hits;
+                touchEntry(index);
+            } else {
+                ++currentStatistics.misses;
+            }
 
-                /**
-                 * Assignment operator
-                 *
-                 * \param[in] other The instance to assign to this instance.
-                 *
-                 * \return Returns a reference to this instance.
-                 */
-                inline Entry& operator=(Entry&& other) {
-                    currentValue           = other.currentValue;
-                    currentMaximumDistance = other.currentMaximumDistance;
-                    currentIsOccupied      = other.currentIsOccupied;
-
-                    return *this;
-                }
+            if (currentEvictionPolicy == EvictionPolicy::TINY_LFU) {
+                frequencySketch.increment(hashValue);
+            }
 
-            private:
-                /**
-                 * The current value.
-                 */
-                T currentValue;
+            return index;
+        }
 
-                /**
-                 * The current maximum distance to the last cache entry associated with this location.  A value is one
-                 * based.  A value of 0 indicates no cache entries tied to this hash value.
-                 */
-                Index currentMaximumDistance;
+        /**
+         * Method that finds the first empty or deleted table entry along the probe sequence for a hash.  The table
+         * must contain at least one empty or deleted entry.
+         *
+         * \param[in] hashValue The hash of the entry ID.
+         *
+         * \return Returns the index of the table entry.
+         */
+        Index locateFreeEntry(std::uint64_t hashValue) const {
+            Index     group = initialGroup(hashValue);
+            Index     probe = 0;
+            GroupMask free  = matchEmptyOrDeleted(controlBytes + group * groupWidth);
+
+            while (free == 0) {
+                ++probe;
+                group = (group + probe) & groupMask;
+                free  = matchEmptyOrDeleted(controlBytes + group * groupWidth);
+            }
 
-                /**
-                 * Flag holding true if this location is occupied.
-                 */
-                bool currentIsOccupied;
-        };
+            return group * groupWidth + lowestBitIndex(free);
+        }
 
         /**
-         * Method that finds the entry in the cache.
-         *
-         * \param[in] entryId          The ID of the entry to be evicted.
+         * Method that inserts a new entry into the cache.  The caller must guarantee that the cache is not at its
+         * maximum depth and that the entry is not already in the cache.  If deleted entries have consumed the
+         * remaining table capacity, the table is rebuilt in place first.
          *
-         * \param[in] initialHashIndex The initial hash index to be used.
+         * \param[in] value     The value to be inserted.
          *
-         * \return Returns the index into the cache where the entry resides.  A value of \ref invalidIndex is returned
-         *         if the entry can not be found.
+         * \param[in] hashValue The hash of the value's ID.
          */
-        Index locateEntry(ID entryId, Index initialHashIndex) const {
-            Index index             = initialHashIndex;
-            Index remainingDistance = cacheTable[index].maximumDistance();
+        void insertEntry(const T& value, std::uint64_t hashValue) {
+            Index index = locateFreeEntry(hashValue);
+            if (controlBytes[index] == controlEmpty && remainingGrowth == 0) {
+                rehashTable(currentCacheTableSize);
+                index = locateFreeEntry(hashValue);
+            }
 
-            while (remainingDistance > 0                                      &&
-                   (cacheTable[index].isUnoccupied()                     ||
-                   idFromValue(cacheTable[index].reference()) != entryId    )    ) {
-                --remainingDistance;
-                index = nextIndex(index);
+            if (controlBytes[index] == controlEmpty) {
+                --remainingGrowth;
             }
 
-            return remainingDistance == 0 ? invalidIndex : index;
+            controlBytes[index] = controlTag(hashValue);
+            values[index]       = value;
+            touchEntry(index);
+
+            ++currentNumberCachedEntries;
+            ++currentStatistics.insertions;
         }
 
         /**
-         * Method that finds the entry in the cache.  This version will calculate an initial hash index.
+         * Method that removes an entry from the table.  If the entry's probe group still contains an empty entry
+         * then no probe sequence can continue past the group and the entry can be marked empty.  Otherwise the
+         * entry is marked as deleted so that probe sequences passing through the group are not cut short.
          *
-         * \param[in] entryId          The ID of the entry to be evicted.
-         *
-         * \param[in] initialHashIndex The initial hash index to be used.
-         *
-         * \return Returns the index into the cache where the entry resides.  A value of \ref invalidIndex is returned
-         *         if the entry can not be found.
+         * \param[in] index The index of the entry to be removed.
          */
-        Index locateEntry(ID entryId) const {
-            return locateEntry(entryId, initialHashIndex(entryId));
+        void eraseEntry(Index index) {
+            const std::uint8_t* groupControl = controlBytes + (index & ~static_cast<Index>(groupWidth - 1));
+            if (matchControl(groupControl, controlEmpty) != 0) {
+                controlBytes[index] = controlEmpty;
+                ++remainingGrowth;
+            } else {
+                controlBytes[index] = controlDeleted;
+            }
+
+            values[index] = T();
+            usages[index] = 0;
+
+            --currentNumberCachedEntries;
         }
 
         /**
-         * Method that calculates the next index position.
-         *
-         * \param[in] currentIndex The current index value.
+         * Method that allocates an empty table.
          *
-         * \return Returns the next index value.
+         * \param[in] tableSize The table size, in entries.  The value must be a power of two and a multiple of the
+         *                      group width.
          */
-        inline Index nextIndex(Index currentIndex) const {
-            ++currentIndex;
-            return currentIndex >= currentCacheTableSize ? 0 : currentIndex;
+        void allocateTable(Index tableSize) {
+            currentCacheTableSize = tableSize;
+            groupMask             = tableSize / groupWidth - 1;
+            remainingGrowth       = maximumTableLoad(tableSize);
+            controlBytes          = new std::uint8_t[tableSize];
+            values                = new T[tableSize]();
+            usages                = new std::uint32_t[tableSize]();
+
+            std::memset(controlBytes, controlEmpty, tableSize);
         }
 
         /**
-         * Method that calculates the previous index position.
-         *
-         * \param[in] currentIndex The current index value.
-         *
-         * \return Returns the previous index value.
+         * Method that releases the table.
          */
-        inline Index previousIndex(Index currentIndex) const {
-            return (currentIndex == 0 ? currentCacheTableSize : currentIndex) - 1;
+        void releaseTable() {
+            delete[] controlBytes;
+            delete[] values;
+            delete[] usages;
+
+            controlBytes = nullptr;
+            values       = nullptr;
+            usages       = nullptr;
         }
 
         /**
-         * Method that calculates an initial hash index from an entry ID.
-         *
-         * \param[in] entryId          The ID of the entry to be evicted.
+         * Method that rebuilds the table, reinserting every cached entry.  Deleted entries are discarded.
          *
-         * \return Returns an initial hash index.
+         * \param[in] newTableSize The new table size, in entries.
          */
-        inline Index initialHashIndex(ID entryId) const {
-            std::uint64_t hashValue;
-            if (sizeof(ID) == 1) {
-                hashValue = fnv1a8(static_cast<std::uint8_t>(entryId));
-            } else if (sizeof(ID) == 2) {
-                hashValue = fnv1a16(static_cast<std::uint16_t>(entryId));
-            } else if (sizeof(ID) == 4) {
-                hashValue = fnv1a32(static_cast<std::uint32_t>(entryId));
-            } else if (sizeof(ID) == 8) {
-                hashValue = fnv1a64(static_cast<std::uint64_t>(entryId));
-            } else {
-                hashValue = fnv1aOffsetBasis;
-                const std::uint8_t* d = reinterpret_cast<const std::uint8_t*>(&entryId);
-                for (unsigned i=0 ; i<sizeof(ID) ; ++i) {
-                    hashValue = fnv1a8(d[i], hashValue);
+        void rehashTable(Index newTableSize) {
+            Index          oldTableSize    = currentCacheTableSize;
+            std::uint8_t*  oldControlBytes = controlBytes;
+            T*             oldValues       = values;
+            std::uint32_t* oldUsages       = usages;
+
+            allocateTable(newTableSize);
+
+            for (Index oldIndex=0 ; oldIndex<oldTableSize ; ++oldIndex) {
+                if (isOccupied(oldControlBytes[oldIndex])) {
+                    std::uint64_t hashValue = hashId(idFromValue(oldValues[oldIndex]));
+                    Index         index     = locateFreeEntry(hashValue);
+
+                    controlBytes[index] = controlTag(hashValue);
+                    values[index]       = oldValues[oldIndex];
+                    usages[index]       = oldUsages[oldIndex];
+
+                    --remainingGrowth;
                 }
             }
 
-            return static_cast<Index>(hashValue % currentCacheTableSize);
+            clockHand = 0;
+
+            delete[] oldControlBytes;
+            delete[] oldValues;
+            delete[] oldUsages;
         }
 
         /**
-         * Method that calculates the distnace between two entries.
+         * Method that records an access to an entry for the eviction policy.
          *
-         * \param[in] startingIndex The starting index.
-         *
-         * \param[in] endingIndex   The ending index.
+         * \param[in] index The index of the entry that was accessed.
+         */
+        inline void touchEntry(Index index) const {
+            if (currentEvictionPolicy == EvictionPolicy::CLOCK) {
+                usages[index] = 1;
+            } else if (currentEvictionPolicy != EvictionPolicy::RANDOM) {
+                usages[index] = ++currentAccessClock;
+            }
+        }
+
+        /**
+         * Method that selects the entry to be evicted based on the current eviction policy.  The cache must contain
+         * at least one entry.
          *
-         * \return Returns the distance.
+         * \return Returns the index of the selected entry.
          */
-        inline Index distance(Index startingIndex, Index endingIndex) {
-            return   startingIndex <= endingIndex
-                   ? endingIndex - startingIndex + 1
-                   : endingIndex + currentCacheTableSize - startingIndex + 1;
+        Index selectVictim() {
+            Index result;
+
+            switch (currentEvictionPolicy) {
+                case EvictionPolicy::RANDOM:          { result = randomOccupiedIndex();  break; }
+                case EvictionPolicy::CLOCK:           { result = clockVictim();          break; }
+                case EvictionPolicy::APPROXIMATE_LRU: { result = sampledLruVictim();     break; }
+                case EvictionPolicy::TINY_LFU:        { result = sampledLruVictim();     break; }
+                default:                              { result = randomOccupiedIndex();  break; }
+            }
+
+            return result;
         }
 
         /**
-         * Method that performs a random eviction from the cache.
+         * Method that selects a random occupied entry.  The cache must contain at least one entry.
+         *
+         * \return Returns the index of the selected entry.
          */
-        void performRandomEviction() {
-            Index  index;
-            Entry* entry;
+        Index randomOccupiedIndex() {
+            Index index;
             do {
                 index = randomIndex(currentCacheTableSize);
-                entry = cacheTable + index;
-            } while (entry->isUnoccupied());
+            } while (!isOccupied(controlBytes[index]));
+
+            return index;
+        }
+
+        /**
+         * Method that selects a victim using the CLOCK algorithm.  The clock hand sweeps the table clearing the
+         * usage of referenced entries until it finds an entry that has not been referenced.  The method will
+         * terminate within two sweeps of the table.
+         *
+         * \return Returns the index of the selected entry.
+         */
+        Index clockVictim() {
+            Index result = invalidIndex;
+            do {
+                if (isOccupied(controlBytes[clockHand])) {
+                    if (usages[clockHand] == 0) {
+                        result = clockHand;
+                    } else {
+                        usages[clockHand] = 0;
+                    }
+                }
 
-            ID entryId = idFromValue(entry->reference());
-            evictCacheEntry(entryId);
+                clockHand = (clockHand + 1) & (currentCacheTableSize - 1);
+            } while (result == invalidIndex);
+
+            return result;
+        }
+
+        /**
+         * Method that selects a victim by sampling a small number of random entries and picking the least recently
+         * used sampled entry.  Ages are calculated relative to the access clock so the algorithm tolerates the
+         * access clock wrapping.
+         *
+         * \return Returns the index of the selected entry.
+         */
+        Index sampledLruVictim() {
+            Index         result    = randomOccupiedIndex();
+            std::uint32_t oldestAge = currentAccessClock - usages[result];
+
+            for (unsigned i=1 ; i<lruSampleSize ; ++i) {
+                Index         index = randomOccupiedIndex();
+                std::uint32_t age   = currentAccessClock - usages[index];
+                if (age > oldestAge) {
+                    result    = index;
+                    oldestAge = age;
+                }
+            }
+
+            return result;
         }
 
         /**
@@ -596,19 +603,66 @@ template<typename T, typename ID> class Cache:public CacheBase {
         Index currentMaximumCacheDepth;
 
         /**
-         * The size of the cache table.
+         * The size of the cache table.  The value is always a power of two.
          */
         Index currentCacheTableSize;
 
+        /**
+         * Mask used to select a probe group.
+         */
+        Index groupMask;
+
+        /**
+         * The number of empty entries that can still be consumed before the table must be rebuilt.
+         */
+        Index remainingGrowth;
+
         /**
          * A count of the current number of cached entries.
          */
         Index currentNumberCachedEntries;
 
         /**
-         * The cache implemented as a circular hash table.
+         * The control byte for each table entry.
+         */
+        std::uint8_t* controlBytes;
+
+        /**
+         * The value held in each table entry.
+         */
+        T* values;
+
+        /**
+         * The usage value for each table entry.  Under the CLOCK policy, a non-zero value indicates the entry was
+         * referenced since the clock hand last passed.  Under the LRU based policies, the value is the access clock
+         * at the last access.
+         */
+        std::uint32_t* usages;
+
+        /**
+         * The current eviction policy.
+         */
+        EvictionPolicy currentEvictionPolicy;
+
+        /**
+         * The current position of the CLOCK hand.
+         */
+        Index clockHand;
+
+        /**
+         * Logical clock incremented on every access under the LRU based policies.
+         */
+        mutable std::uint32_t currentAccessClock;
+
+        /**
+         * The frequency sketch used by the TinyLFU policy.
+         */
+        mutable FrequencySketch frequencySketch;
+
+        /**
+         * The current cache statistics.
          */
-        Entry* cacheTable;
+        mutable Statistics currentStatistics;
 };
 
 #endif
@@ -23,8 +23,14 @@
 #ifndef CACHE_BASE_H
 #define CACHE_BASE_H
 
+#include <QString>
+
 #include <cstdint>
 
+#if (defined(__SSE2__))
+    #include <emmintrin.h>
+#endif
+
 /**
  * Class used to manage a cache of customer secrets.  All protected functions are designed to be fully thread safe.
  */
@@ -40,11 +46,219 @@ class CacheBase {
          */
         static constexpr unsigned long invalidIndex = static_cast<unsigned long>(-1);
 
+        /**
+         * Enumeration of supported eviction policies.
+         */
+        enum class EvictionPolicy {
+            /**
+             * Indicates a uniformly random cache entry is evicted.
+             */
+            RANDOM,
+
+            /**
+             * Indicates the CLOCK, or second chance, algorithm is used.  Entries that have been accessed since the
+             * clock hand last passed them are skipped once.
+             */
+            CLOCK,
+
+            /**
+             * Indicates approximate LRU.  A small number of random entries are sampled and the least recently used
+             * sampled entry is evicted.
+             */
+            APPROXIMATE_LRU,
+
+            /**
+             * Indicates TinyLFU admission.  Victims are selected using approximate LRU but a new entry is only
+             * admitted if it has been requested more often than the victim it would replace.  Request frequencies
+             * are estimated using a count-min sketch.
+             */
+            TINY_LFU
+        };
+
+        /**
+         * The number of bins in the probe length histogram.  The last bin counts all lookups with a probe length
+         * equal to or greater than the bin index plus one.
+         */
+        static constexpr unsigned numberProbeLengthBins = 8;
+
+        /**
+         * Class used to report cache statistics.
+         */
+        class Statistics {
+            public:
+                Statistics();
+
+                /**
+                 * Method you can use to add statistics from another cache to this instance.
+                 *
+                 * \param[in] other The statistics to be added.
+                 *
+                 * \return Returns a reference to this instance.
+                 */
+                Statistics& operator+=(const Statistics& other);
+
+                /**
+                 * The number of lookups that found the requested entry.
+                 */
+                unsigned long long hits;
+
+                /**
+                 * The number of lookups that did not find the requested entry.
+                 */
+                unsigned long long misses;
+
+                /**
+                 * The number of new entries added to the cache.
+                 */
+                unsigned long long insertions;
+
+                /**
+                 * The number of entries evicted to make room for new entries.
+                 */
+                unsigned long long evictions;
+
+                /**
+                 * The number of new entries rejected by the admission policy.
+                 */
+                unsigned long long rejections;
+
+                /**
+                 * Histogram of lookup probe lengths.  Bin N holds the number of lookups that examined N + 1 groups of
+                 * table entries.
+                 */
+                unsigned long long probeLengths[numberProbeLengthBins];
+
+                /**
+                 * The number of entries held in the cache when the statistics were obtained.
+                 */
+                unsigned long long numberEntries;
+
+                /**
+                 * The number of table entries allocated when the statistics were obtained.  The fill factor is the
+                 * number of entries divided by this value.
+                 */
+                unsigned long long tableSize;
+        };
+
         CacheBase();
 
         ~CacheBase();
 
+        /**
+         * Method you can use to convert an eviction policy to a string.
+         *
+         * \param[in] evictionPolicy The eviction policy to be converted.
+         *
+         * \return Returns the eviction policy as a string.
+         */
+        static QString toString(EvictionPolicy evictionPolicy);
+
+        /**
+         * Method you can use to convert a string to an eviction policy.
+         *
+         * \param[in]  str     The string to be converted.
+         *
+         * \param[out] success An optional pointer to a boolean value holding true on success or false on error.
+         *
+         * \return Returns the eviction policy.
+         */
+        static EvictionPolicy toEvictionPolicy(const QString& str, bool* success = nullptr);
+
     protected:
+        /**
+         * Class that implements a count-min sketch of 4-bit counters used to estimate how often entries are
+         * requested.  Counters are halved periodically so the sketch tracks recent popularity.
+         */
+        class FrequencySketch {
+            public:
+                FrequencySketch();
+
+                ~FrequencySketch();
+
+                /**
+                 * Method that resizes the sketch for a given cache depth.  All counters are reset.
+                 *
+                 * \param[in] maximumCacheDepth The maximum cache depth.  A value of 0 releases the sketch.
+                 */
+                void resize(Index maximumCacheDepth);
+
+                /**
+                 * Method that records a request for an entry.
+                 *
+                 * \param[in] hash The hash of the entry ID.
+                 */
+                void increment(std::uint64_t hash);
+
+                /**
+                 * Method that estimates the request frequency of an entry.
+                 *
+                 * \param[in] hash The hash of the entry ID.
+                 *
+                 * \return Returns the estimated number of recent requests, saturating at 15.
+                 */
+                unsigned estimate(std::uint64_t hash) const;
+
+            private:
+                /**
+                 * The number of counters examined per entry.
+                 */
+                static constexpr unsigned sketchDepth = 4;
+
+                /**
+                 * The maximum value of a counter.
+                 */
+                static constexpr unsigned maximumCount = 15;
+
+                /**
+                 * The number of recorded requests, per cache entry, between counter halvings.
+                 */
+                static constexpr unsigned samplesPerEntry = 10;
+
+                /**
+                 * Per-depth seeds used to select counters.
+                 */
+                static const std::uint64_t depthSeeds[sketchDepth];
+
+                /**
+                 * Method that calculates the hash used to select a counter at a given depth.
+                 *
+                 * \param[in] hash  The hash of the entry ID.
+                 *
+                 * \param[in] depth The sketch depth.
+                 *
+                 * \return Returns the counter hash.
+                 */
+                static inline std::uint64_t counterHash(std::uint64_t hash, unsigned depth) {
+                    std::uint64_t h = (hash + depthSeeds[depth]) * 0x9E3779B97F4A7C15ULL;
+                    return h ^ (h >> 29);
+                }
+
+                /**
+                 * Method that halves every counter.
+                 */
+                void halveCounters();
+
+                /**
+                 * The table of counters, 16 per word.
+                 */
+                std::uint64_t* table;
+
+                /**
+                 * Mask used to select a word in the table.
+                 */
+                Index tableMask;
+
+                /**
+                 * The number of recorded requests since the counters were last halved.
+                 */
+                unsigned long long numberAdditions;
+
+                /**
+                 * The number of recorded requests between counter halvings.
+                 */
+                unsigned long long sampleSize;
+        };
+
         /**
          * Basis for the Fowler-Noll-Vo hash algorithm,
          */
@@ -61,45 +275,156 @@ class CacheBase {
          */
         static std::uint64_t fnv1a8(std::uint8_t value, std::uint64_t hash = fnv1aOffsetBasis);
 
+
         /**
-         * Method that implements the Fowler-Noll-Vo hash for a 16-bit value.
+         * Template method that calculates a hash of an ID.  IDs up to 64-bits in size use a multiplicative
+         * (Fibonacci) hash with the upper half of the product folded into the lower half so that every bit of the
+         * result is usable.  Larger IDs are first reduced using the Fowler-Noll-Vo hash.  The ID should be a C++ pod
+         * type with a predictable byte representation.
          *
-         * \param[in] value The value to calculate the hash for.
+         * \param[in] entryId The ID to calculate the hash for.
          *
-         * \param[in] hash  The running hash or basis.
+         * \return Returns a hash of the ID.
+         */
+        template<typename ID> static inline std::uint64_t hashId(ID entryId) {
+            std::uint64_t value;
+            if (sizeof(ID) <= sizeof(std::uint64_t)) {
+                value = static_cast<std::uint64_t>(entryId);
+            } else {
+                value = fnv1aOffsetBasis;
+                const std::uint8_t* d = reinterpret_cast<const std::uint8_t*>(&entryId);
+                for (unsigned i=0 ; i<sizeof(ID) ; ++i) {
+                    value = fnv1a8(d[i], value);
+                }
+            }
+
+            std::uint64_t hashValue = value * multiplicativeHashConstant;
+            return hashValue ^ (hashValue >> 32);
+        }
+
+        /**
+         * The number of control bytes in a probe group.
+         */
+        static constexpr unsigned groupWidth = 16;
+
+        /**
+         * Control byte value used to mark an empty table entry.
+         */
+        static constexpr std::uint8_t controlEmpty = 0x80;
+
+        /**
+         * Control byte value used to mark a deleted table entry.
+         */
+        static constexpr std::uint8_t controlDeleted = 0xFE;
+
+        /**
+         * Mask applied to a hash to obtain the 7-bit tag stored in the control byte of an occupied table entry.
+         */
+        static constexpr std::uint8_t controlTagMask = 0x7F;
+
+        /**
+         * Type used to hold a bit mask of table entries within a probe group.
+         */
+        typedef unsigned GroupMask;
+
+        /**
+         * Method that determines if a control byte marks an occupied table entry.
          *
-         * \return Returns a hash of the value.
+         * \param[in] control The control byte to be tested.
+         *
+         * \return Returns true if the entry is occupied.  Returns false if the entry is empty or deleted.
          */
-        static std::uint64_t fnv1a16(std::uint16_t value, std::uint64_t hash = fnv1aOffsetBasis);
+        static inline bool isOccupied(std::uint8_t control) {
+            return (control & 0x80) == 0;
+        }
 
         /**
-         * Method that implements the Fowler-Noll-Vo hash for a 32-bit value.
+         * Method that locates every control byte in a probe group matching a given value.  SSE2 is used when
+         * available.
          *
-         * \param[in] value The value to calculate the hash for.
+         * \param[in] group Pointer to the first control byte of the group.
          *
-         * \param[in] hash  The running hash or basis.
+         * \param[in] value The value to be matched.
          *
-         * \return Returns a hash of the value.
+         * \return Returns a bit mask with one bit set for each matching control byte.
          */
-        static std::uint64_t fnv1a32(std::uint32_t value, std::uint64_t hash = fnv1aOffsetBasis);
+        static inline GroupMask matchControl(const std::uint8_t* group, std::uint8_t value) {
+            #if (defined(__SSE2__))
+                __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+                __m128i pattern = _mm_set1_epi8(static_cast<char>(value));
+                return static_cast<GroupMask>(_mm_movemask_epi8(_mm_cmpeq_epi8(control, pattern)));
+            #else
+                GroupMask result = 0;
+                for (unsigned i=0 ; i<groupWidth ; ++i) {
+                    if (group[i] == value) {
+                        result |= 1U << i;
+                    }
+                }
+
+                return result;
+            #endif
+        }
 
         /**
-         * Method that implements the Fowler-Noll-Vo hash for a 64-bit value.
+         * Method that locates every empty or deleted control byte in a probe group.  SSE2 is used when available.
          *
-         * \param[in] value The value to calculate the hash for.
+         * \param[in] group Pointer to the first control byte of the group.
          *
-         * \param[in] hash  The running hash or basis.
+         * \return Returns a bit mask with one bit set for each empty or deleted control byte.
+         */
+        static inline GroupMask matchEmptyOrDeleted(const std::uint8_t* group) {
+            #if (defined(__SSE2__))
+                __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+                return static_cast<GroupMask>(_mm_movemask_epi8(control));
+            #else
+                GroupMask result = 0;
+                for (unsigned i=0 ; i<groupWidth ; ++i) {
+                    if (!isOccupied(group[i])) {
+                        result |= 1U << i;
+                    }
+                }
+
+                return result;
+            #endif
+        }
+
+        /**
+         * Method that determines the index of the lowest set bit in a group mask.
          *
-         * \return Returns a hash of the value.
+         * \param[in] mask The mask to be tested.  The mask must be non-zero.
+         *
+         * \return Returns the index of the lowest set bit.
          */
-        static std::uint64_t fnv1a64(std::uint64_t value, std::uint64_t hash = fnv1aOffsetBasis);
+        static inline unsigned lowestBitIndex(GroupMask mask) {
+            #if (defined(__GNUC__))
+                return static_cast<unsigned>(__builtin_ctz(mask));
+            #else
+                unsigned result = 0;
+                while ((mask & 1) == 0) {
+                    mask >>= 1;
+                    ++result;
+                }
+
+                return result;
+            #endif
+        }
 
         /**
-         * Method that calculates an optimal cache table size based on a requested size.  The function locates the next
-         * prime equal to or larger than the specified value.  This function will also include a reservation margin
-         * in order to keep the cache search length low.
+         * Method that calculates the number of entries that can be stored in a table of a given size while keeping
+         * probe sequences short.
          *
-         * Note that ths function is time consuming so it should not be used on a regular basis.
+         * \param[in] tableSize The table size, in entries.
+         *
+         * \return Returns the maximum number of occupied or deleted entries.
+         */
+        static inline Index maximumTableLoad(Index tableSize) {
+            return tableSize - tableSize / 8;
+        }
+
+        /**
+         * Method that calculates an optimal cache table size based on a requested size.  The function returns the
+         * smallest power of two, no smaller than a single probe group, that can hold the requested number of entries
+         * at a load factor of no more than 7/8.
          *
          * \param[in] requestedSize The value to use as a basis.
          *
@@ -122,40 +447,9 @@ class CacheBase {
         static constexpr std::uint64_t fnv1Prime = 1099611628211ULL;
 
         /**
-         * The cache reservation margin to guarantee a statistically high hit rate.
-         */
-        static constexpr float cacheReservationMargin = 1.25F;
-
-        /**
-         * Method that determines if one number divides another.
-         *
-         * \param[in[ dividend The dividend.
-         *
-         * \param[in] divisor  The divisor.
-         *
-         * \return Returns true if the divisor divides into the dividend.
-         */
-        static inline bool divides(Index dividend, Index divisor) {
-            return (dividend % divisor) == 0;
-        }
-
-        /**
-         * Method that determines if a value is prime.
-         *
-         * \param[in] value The value to be tested.
-         *
-         * \return Returns true if the value is prime.  Returns false if the value is not prime.
-         */
-        static bool isPrime(Index value);
-
-        /**
-         * Method that finds the next prime equal to or greater than a specified value.
-         *
-         * \param[in] value The value to find the next higher prime from.
-         *
-         * \return Returns the next higher prime value.
+         * Multiplier used by the multiplicative hash, 2^64 divided by the golden ratio.
          */
-        static Index calculateNextPrime(Index value);
+        static constexpr std::uint64_t multiplicativeHashConstant = 0x9E3779B97F4A7C15ULL;
 
         /**
          * Seed used to generate random values.
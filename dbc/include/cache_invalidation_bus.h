@@ -0,0 +1,251 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref CacheInvalidationBus class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef CACHE_INVALIDATION_BUS_H
+#define CACHE_INVALIDATION_BUS_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include <functional>
+
+class DatabaseManager;
+struct pg_conn;
+
+/**
+ * Singleton thread that keeps the caches of several DBC instances coherent using PostgreSQL LISTEN/NOTIFY.
+ *
+ * Writers call \ref CacheInvalidationBus::publish after a change has been committed.  The change is queued and sent
+ * as a compact "table:id:instance:version" notification on a dedicated connection.  The same connection listens on
+ * the channel and dispatches notifications from other instances to the handler registered for the table so the
+ * affected entry can be evicted or reloaded.  Notifications from this instance and out of order versions are ignored.
+ *
+ * Notifications sent while a listener is disconnected are lost so every handler is called with
+ * \ref CacheInvalidationBus::allEntries after the listening connection is re-established.
+ */
+class CacheInvalidationBus:public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type of function called when an entry is changed by another instance.  The function is called from the
+         * bus thread.
+         */
+        typedef std::function<void(quint64 entryId)> Handler;
+
+        /**
+         * Value used to indicate that every entry of a table may have changed.
+         */
+        static constexpr quint64 allEntries = static_cast<quint64>(-1);
+
+        /**
+         * The thread ID used by the bus and by handlers to obtain database connections.
+         */
+        static const unsigned busThreadId = static_cast<unsigned>(-9);
+
+        /**
+         * The default notification channel.
+         */
+        static const char defaultChannel[];
+
+        /**
+         * The maximum time between checks for queued notifications, in milliseconds.
+         */
+        static constexpr int pollIntervalMilliseconds = 100;
+
+        /**
+         * The delay before a lost listening connection is re-established, in milliseconds.
+         */
+        static constexpr unsigned long reconnectDelayMilliseconds = 5000;
+
+        /**
+         * The maximum number of queued notifications.  When exceeded, the queue is replaced by one notification per
+         * table covering every entry.
+         */
+        static constexpr int maximumPendingNotifications = 10000;
+
+        /**
+         * Method you can use to obtain the global instance.
+         *
+         * \return Returns a pointer to the global instance.
+         */
+        static CacheInvalidationBus* instance();
+
+        /**
+         * Method you can use to start the bus.  A running bus is restarted if the channel changes.
+         *
+         * \param[in] databaseManager The database manager used to obtain the listening connection.
+         *
+         * \param[in] channel         The notification channel.
+         */
+        void startBus(DatabaseManager* databaseManager, const QString& channel = QString(defaultChannel));
+
+        /**
+         * Method you can use to stop the bus.  Call this method before the database manager is destroyed.
+         */
+        void stopBus();
+
+        /**
+         * Method you can use to register the handler for a table.  Any existing handler for the table is replaced.
+         *
+         * \param[in] table   The table name used in notifications.
+         *
+         * \param[in] handler The function called when another instance changes an entry in the table.
+         */
+        void registerHandler(const QString& table, const Handler& handler);
+
+        /**
+         * Method you can use to remove the handler for a table.  Remove handlers before the objects they reference
+         * are destroyed.
+         *
+         * \param[in] table The table name used in notifications.
+         */
+        void unregisterHandler(const QString& table);
+
+        /**
+         * Method you can use to tell other instances that an entry has changed.  Call this method after the change
+         * has been committed.  This method does nothing if the bus is not running.  This method is thread safe.
+         *
+         * \param[in] table   The table name used in notifications.
+         *
+         * \param[in] entryId The ID of the changed entry or \ref CacheInvalidationBus::allEntries.
+         */
+        void publish(const QString& table, quint64 entryId = allEntries);
+
+        /**
+         * Method you can use to determine if the bus is currently listening for notifications.
+         *
+         * \return Returns true if the bus is listening.  Returns false if the bus is stopped or disconnected.
+         */
+        inline bool isListening() const {
+            return listening.loadAcquire() != 0;
+        }
+
+    protected:
+        /**
+         * Method that listens for and sends notifications.
+         */
+        void run() override;
+
+    private:
+        CacheInvalidationBus();
+
+        ~CacheInvalidationBus() override;
+
+        /**
+         * Method that starts listening on the notification channel.
+         *
+         * \param[in] connection The libpq connection.
+         *
+         * \param[in] channel    The notification channel.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        static bool listen(pg_conn* connection, const QString& channel);
+
+        /**
+         * Method that waits briefly for notifications and dispatches any that are received.
+         *
+         * \param[in] connection The libpq connection.
+         *
+         * \return Returns true on success.  Returns false if the connection failed.
+         */
+        bool receive(pg_conn* connection);
+
+        /**
+         * Method that sends the queued notifications.
+         *
+         * \param[in] connection The libpq connection.
+         *
+         * \param[in] channel    The notification channel.
+         *
+         * \return Returns true on success.  Returns false if the connection failed.
+         */
+        bool sendPending(pg_conn* connection, const QString& channel);
+
+        /**
+         * Method that parses a received notification and calls the associated handler.
+         *
+         * \param[in] payload The notification payload.
+         */
+        void dispatch(const QString& payload);
+
+        /**
+         * Method that calls every handler with \ref CacheInvalidationBus::allEntries.
+         */
+        void dispatchAll();
+
+        /**
+         * Mutex protecting the handlers, the queued notifications and the bus settings.
+         */
+        mutable QMutex busMutex;
+
+        /**
+         * The database manager used to obtain the listening connection.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The notification channel.
+         */
+        QString currentChannel;
+
+        /**
+         * The handlers by table name.
+         */
+        QHash<QString, Handler> handlers;
+
+        /**
+         * The queued notification payloads.
+         */
+        QStringList pendingPayloads;
+
+        /**
+         * Flag indicating the bus is running and accepting notifications.
+         */
+        QAtomicInt running;
+
+        /**
+         * Flag indicating the bus is listening.
+         */
+        QAtomicInt listening;
+
+        /**
+         * Random value identifying this instance in notifications.
+         */
+        QString instanceId;
+
+        /**
+         * The version assigned to the last notification sent by this instance.
+         */
+        quint64 lastVersion;
+
+        /**
+         * The last version received from each of the other instances.  Only used by the bus thread.
+         */
+        QHash<QString, quint64> lastVersionByInstance;
+};
+
+#endif
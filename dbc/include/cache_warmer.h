@@ -0,0 +1,176 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref CacheWarmer class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef CACHE_WARMER_H
+#define CACHE_WARMER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QMutex>
+
+class CustomerSecrets;
+class CustomersCapabilities;
+
+/**
+ * Class that pre-populates the customer secrets and customer capabilities caches in the background after startup so
+ * the first requests from each active customer do not all miss the cache.  Each table is loaded with a single
+ * streaming query, bounded by the configured cache depth.  The REST API remains available while the warm-up runs.
+ */
+class CacheWarmer:public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * Enumeration of warm-up states.
+         */
+        enum class Status {
+            /**
+             * Indicates the warm-up has not been started or is disabled.
+             */
+            IDLE,
+
+            /**
+             * Indicates the warm-up is in progress.
+             */
+            RUNNING,
+
+            /**
+             * Indicates the warm-up has finished.
+             */
+            COMPLETED
+        };
+
+        /**
+         * Trivial class used to report the progress of the warm-up.
+         */
+        class WarmUpStatus {
+            public:
+                /**
+                 * The warm-up's current state.
+                 */
+                Status status;
+
+                /**
+                 * The number of customer secrets added to the cache.
+                 */
+                unsigned long numberCustomerSecrets;
+
+                /**
+                 * The number of customer capabilities added to the cache.
+                 */
+                unsigned long numberCustomerCapabilities;
+
+                /**
+                 * The time spent warming the caches, in milliseconds.  The value is updated once the warm-up
+                 * completes.
+                 */
+                unsigned long long elapsedMilliseconds;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] customerSecrets       The customer secrets cache to be warmed.
+         *
+         * \param[in] customersCapabilities The customer capabilities cache to be warmed.
+         *
+         * \param[in] parent                Pointer to the parent object.
+         */
+        CacheWarmer(
+            CustomerSecrets*       customerSecrets,
+            CustomersCapabilities* customersCapabilities,
+            QObject*               parent = nullptr
+        );
+
+        ~CacheWarmer() override;
+
+        /**
+         * Method you can use to convert a warm-up status to a string.
+         *
+         * \param[in] status The status to be converted.
+         *
+         * \return Returns the status as a string.
+         */
+        static QString toString(Status status);
+
+        /**
+         * Method you can use to start the warm-up.  The warm-up is performed at most once, later calls are ignored.
+         * Call this method once the database connection settings and cache depths are known.
+         *
+         * \param[in] numberCustomerSecrets      The maximum number of customer secrets to load.
+         *
+         * \param[in] numberCustomerCapabilities The maximum number of customer capabilities to load.
+         */
+        void startWarmUp(unsigned long numberCustomerSecrets, unsigned long numberCustomerCapabilities);
+
+        /**
+         * Method you can use to obtain the progress of the warm-up.
+         *
+         * \return Returns the current warm-up status.
+         */
+        WarmUpStatus warmUpStatus() const;
+
+    protected:
+        /**
+         * Method that loads the caches in the background.
+         */
+        void run() override;
+
+    private:
+        /**
+         * The thread ID used for database access during the warm-up.
+         */
+        static const unsigned warmUpThreadId = static_cast<unsigned>(-5);
+
+        /**
+         * The customer secrets cache.
+         */
+        CustomerSecrets* currentCustomerSecrets;
+
+        /**
+         * The customer capabilities cache.
+         */
+        CustomersCapabilities* currentCustomersCapabilities;
+
+        /**
+         * Mutex used to protect the warm-up state.
+         */
+        mutable QMutex statusMutex;
+
+        /**
+         * The maximum number of customer secrets to load.
+         */
+        unsigned long maximumNumberCustomerSecrets;
+
+        /**
+         * The maximum number of customer capabilities to load.
+         */
+        unsigned long maximumNumberCustomerCapabilities;
+
+        /**
+         * The current warm-up status.
+         */
+        WarmUpStatus currentStatus;
+};
+
+#endif
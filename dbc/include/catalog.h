@@ -0,0 +1,783 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref Catalog class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <QObject>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QString>
+
+#include <memory>
+
+#include "host_scheme.h"
+#include "monitor.h"
+#include "scheme_host_path.h"
+
+class QDataStream;
+class DatabaseManager;
+
+/**
+ * Class that holds an in-memory copy of the monitor and host/scheme tables.  The catalog is updated incrementally by
+ * the create, modify and delete paths of \ref Monitors, \ref HostSchemes and \ref CustomersCapabilities and is
+ * periodically reloaded from the database as a safety net.
+ *
+ * Readers obtain an immutable, versioned \ref Catalog::Snapshot indexed by ID, by customer, by host/scheme and by
+ * host/scheme and path.  Lookups against a snapshot never lock or touch the database.
+ */
+class Catalog:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef Monitor::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a host/scheme ID.
+         */
+        typedef HostScheme::HostSchemeId HostSchemeId;
+
+        /**
+         * Type used to represent a customer ID.
+         */
+        typedef HostScheme::CustomerId CustomerId;
+
+        /**
+         * Type used to represent a list of monitors.
+         */
+        typedef QList<Monitor> MonitorList;
+
+        /**
+         * Type used to represent a collection of monitors by monitor ID.
+         */
+        typedef QHash<MonitorId, Monitor> MonitorsById;
+
+        /**
+         * Type used to represent a collection of monitors by host/scheme and path.
+         */
+        typedef QMultiHash<SchemeHostPath, Monitor> MonitorsBySchemeHostPath;
+
+        /**
+         * Type used to represent a collection of host/schemes by host/scheme ID.
+         */
+        typedef QHash<HostSchemeId, HostScheme> HostSchemesById;
+
+        /**
+         * The default interval between forced reloads, in seconds.
+         */
+        static const unsigned defaultReconcileIntervalSeconds;
+
+        /**
+         * The table name used for catalog cache invalidation notifications.  Notifications carry the customer ID.
+         */
+        static const char invalidationTable[];
+
+        /**
+         * Class holding an immutable view of the catalog.
+         */
+        class Snapshot {
+            friend class Catalog;
+
+            public:
+                Snapshot():currentVersion(0) {}
+
+                /**
+                 * Method you can use to obtain the snapshot version.  The version increases with every change.
+                 *
+                 * \return Returns the snapshot version.  A value of 0 indicates the catalog has never been loaded.
+                 */
+                inline unsigned long long version() const {
+                    return currentVersion;
+                }
+
+                /**
+                 * Method you can use to determine if the catalog has been loaded.
+                 *
+                 * \return Returns true if the snapshot reflects the database.  Returns false if the catalog could
+                 *         not be loaded.
+                 */
+                inline bool isLoaded() const {
+                    return currentVersion != 0;
+                }
+
+                /**
+                 * Method you can use to obtain a monitor by monitor ID.
+                 *
+                 * \param[in] monitorId The ID of the desired monitor.
+                 *
+                 * \return Returns the monitor.  An invalid monitor is returned if the monitor does not exist.
+                 */
+                inline Monitor monitor(MonitorId monitorId) const {
+                    return currentMonitorsById.value(monitorId);
+                }
+
+                /**
+                 * Method you can use to obtain a host/scheme by host/scheme ID.
+                 *
+                 * \param[in] hostSchemeId The ID of the desired host/scheme.
+                 *
+                 * \return Returns the host/scheme.  An invalid host/scheme is returned if the host/scheme does not
+                 *         exist.
+                 */
+                inline HostScheme hostScheme(HostSchemeId hostSchemeId) const {
+                    return currentHostSchemesById.value(hostSchemeId);
+                }
+
+                /**
+                 * Method you can use to obtain every monitor.
+                 *
+                 * \return Returns every monitor, by monitor ID.
+                 */
+                inline const MonitorsById& monitorsById() const {
+                    return currentMonitorsById;
+                }
+
+                /**
+                 * Method you can use to obtain every host/scheme.
+                 *
+                 * \return Returns every host/scheme, by host/scheme ID.
+                 */
+                inline const HostSchemesById& hostSchemesById() const {
+                    return currentHostSchemesById;
+                }
+
+                /**
+                 * Method you can use to obtain the monitors tied to a customer.
+                 *
+                 * \param[in] customerId The ID of the customer of interest.
+                 *
+                 * \return Returns the customer's monitors, by monitor ID.
+                 */
+                MonitorsById monitorsByCustomerId(CustomerId customerId) const;
+
+                /**
+                 * Method you can use to obtain the monitors tied to a customer, sorted by user ordering.
+                 *
+                 * \param[in] customerId The ID of the customer of interest.
+                 *
+                 * \return Returns the customer's monitors.
+                 */
+                MonitorList monitorsByUserOrder(CustomerId customerId) const;
+
+                /**
+                 * Method you can use to obtain the monitors tied to a customer by host/scheme and path.
+                 *
+                 * \param[in] customerId The ID of the customer of interest.
+                 *
+                 * \return Returns the customer's monitors, by host/scheme and path.
+                 */
+                MonitorsBySchemeHostPath monitorsBySchemeHostPath(CustomerId customerId) const;
+
+                /**
+                 * Method you can use to obtain the monitors at a given host/scheme and path.
+                 *
+                 * \param[in] schemeHostPath The host/scheme and path of interest.
+                 *
+                 * \return Returns the monitors at the host/scheme and path.
+                 */
+                MonitorList monitorsAt(const SchemeHostPath& schemeHostPath) const;
+
+                /**
+                 * Method you can use to obtain the monitors tied to a host/scheme, sorted by user ordering.
+                 *
+                 * \param[in] hostSchemeId The ID of the host/scheme of interest.
+                 *
+                 * \return Returns the monitors under the host/scheme.
+                 */
+                MonitorList monitorsUnderHostScheme(HostSchemeId hostSchemeId) const;
+
+                /**
+                 * Method you can use to obtain the host/schemes tied to a customer.
+                 *
+                 * \param[in] customerId The ID of the customer of interest.
+                 *
+                 * \return Returns the customer's host/schemes, by host/scheme ID.
+                 */
+                HostSchemesById hostSchemesByCustomerId(CustomerId customerId) const;
+
+            private:
+                /**
+                 * Method that adds or replaces a monitor.
+                 *
+                 * \param[in] monitor The monitor to be added.
+                 */
+                void insertMonitor(const Monitor& monitor);
+
+                /**
+                 * Method that removes a monitor.
+                 *
+                 * \param[in] monitorId The ID of the monitor to be removed.
+                 */
+                void removeMonitor(MonitorId monitorId);
+
+                /**
+                 * Method that adds or replaces a host/scheme.
+                 *
+                 * \param[in] hostScheme The host/scheme to be added.
+                 */
+                void insertHostScheme(const HostScheme& hostScheme);
+
+                /**
+                 * Method that removes a host/scheme and every monitor under it.
+                 *
+                 * \param[in] hostSchemeId The ID of the host/scheme to be removed.
+                 */
+                void removeHostScheme(HostSchemeId hostSchemeId);
+
+                /**
+                 * Method that removes every monitor tied to a customer.
+                 *
+                 * \param[in] customerId The ID of the customer.
+                 */
+                void removeCustomerMonitors(CustomerId customerId);
+
+                /**
+                 * Method that removes every host/scheme, and the monitors under them, tied to a customer.
+                 *
+                 * \param[in] customerId The ID of the customer.
+                 */
+                void removeCustomerHostSchemes(CustomerId customerId);
+
+                /**
+                 * Method that sorts a list of monitors by user ordering.
+                 *
+                 * \param[in,out] monitors The monitors to be sorted.
+                 */
+                static void sortByUserOrder(MonitorList& monitors);
+
+                /**
+                 * The snapshot version.
+                 */
+                unsigned long long currentVersion;
+
+                /**
+                 * Every monitor, by monitor ID.
+                 */
+                MonitorsById currentMonitorsById;
+
+                /**
+                 * Every host/scheme, by host/scheme ID.
+                 */
+                HostSchemesById currentHostSchemesById;
+
+                /**
+                 * Monitor IDs by customer ID.
+                 */
+                QHash<CustomerId, QSet<MonitorId>> monitorIdsByCustomerId;
+
+                /**
+                 * Monitor IDs by host/scheme ID.
+                 */
+                QHash<HostSchemeId, QSet<MonitorId>> monitorIdsByHostSchemeId;
+
+                /**
+                 * Monitor IDs by host/scheme and path.
+                 */
+                QMultiHash<SchemeHostPath, MonitorId> monitorIdsBySchemeHostPath;
+
+                /**
+                 * Host/scheme IDs by customer ID.
+                 */
+                QHash<CustomerId, QSet<HostSchemeId>> hostSchemeIdsByCustomerId;
+        };
+
+        /**
+         * Type used to reference a snapshot.
+         */
+        typedef std::shared_ptr<const Snapshot> SnapshotPointer;
+
+        /**
+         * Constructor
+         *
+         * \param[in] databaseManager The database manager used to load the catalog.
+         *
+         * \param[in] parent          Pointer to the parent object.
+         */
+        Catalog(DatabaseManager* databaseManager, QObject* parent = nullptr);
+
+        ~Catalog() override;
+
+        /**
+         * Method you can use to obtain the current snapshot.  The catalog is loaded from the database on first use,
+         * after \ref Catalog::invalidate is called and when the reconcile interval expires.  Other threads continue to
+         * use the previous snapshot while a reload is in progress.  This method is thread safe.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the current snapshot.
+         */
+        SnapshotPointer snapshot(unsigned threadId = 0);
+
+        /**
+         * Method you can use to record a created or modified monitor.
+         *
+         * \param[in] monitor The new monitor data.
+         */
+        void updateMonitor(const Monitor& monitor);
+
+        /**
+         * Method you can use to record a deleted monitor.
+         *
+         * \param[in] monitorId The ID of the deleted monitor.
+         */
+        void removeMonitor(MonitorId monitorId);
+
+        /**
+         * Method you can use to record that every monitor tied to a customer was deleted.
+         *
+         * \param[in] customerId The ID of the customer.
+         */
+        void removeCustomerMonitors(CustomerId customerId);
+
+        /**
+         * Method you can use to record a created or modified host/scheme.
+         *
+         * \param[in] hostScheme The new host/scheme data.
+         */
+        void updateHostScheme(const HostScheme& hostScheme);
+
+        /**
+         * Method you can use to record a deleted host/scheme.  Monitors under the host/scheme are also removed.
+         *
+         * \param[in] hostSchemeId The ID of the deleted host/scheme.
+         */
+        void removeHostScheme(HostSchemeId hostSchemeId);
+
+        /**
+         * Method you can use to record that every host/scheme tied to a customer was deleted.  Monitors under the
+         * host/schemes are also removed.
+         *
+         * \param[in] customerId The ID of the customer.
+         */
+        void removeCustomerHostSchemes(CustomerId customerId);
+
+        /**
+         * Method you can use to indicate that an unknown set of entries may have changed.  The catalog will be
+         * reloaded on the next call to \ref Catalog::snapshot.
+         */
+        void invalidate();
+
+        /**
+         * Method you can use to set the interval between forced reloads.
+         *
+         * \param[in] reconcileIntervalSeconds The new reconcile interval, in seconds.
+         */
+        void setReconcileInterval(unsigned reconcileIntervalSeconds);
+
+        /**
+         * Method you can use to save the current snapshot to a file so a later instance can start serving requests
+         * without waiting for the catalog to load.  The file is replaced atomically.  This method is thread safe.
+         *
+         * \param[in] filename The file to be written.
+         *
+         * \return Returns true on success.  Returns false if the catalog has not been loaded or on error.
+         */
+        bool saveSnapshot(const QString& filename);
+
+        /**
+         * Method you can use to seed the catalog from a file written by \ref Catalog::saveSnapshot.  The file is
+         * memory mapped and is only used if the catalog has not been loaded and the row counts and maximum IDs
+         * recorded in the file still match the database.  A restored catalog is served immediately but readers will
+         * not reload it themselves; call \ref Catalog::reconcileNow, typically from a background thread, to bring it
+         * up to date.  This method is thread safe.
+         *
+         * \param[in] filename The file to be read.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true if the catalog was restored.  Returns false if the file is missing, invalid or stale.
+         */
+        bool restoreSnapshot(const QString& filename, unsigned threadId = 0);
+
+        /**
+         * Method you can use to reload the catalog from the database immediately.  This method is thread safe.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool reconcileNow(unsigned threadId = 0);
+
+        /**
+         * Method you can use to reload the monitors and host/schemes tied to a single customer from the database.  Used
+         * when another instance reports that the customer's entries changed.  This method is thread safe.
+         *
+         * \param[in] customerId The ID of the customer to be reloaded.
+         *
+         * \param[in] threadId   An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error, in which case the catalog is invalidated.
+         */
+        bool reloadCustomer(CustomerId customerId, unsigned threadId = 0);
+
+        /**
+         * Method you can use to obtain the data version for a customer.  The version changes whenever the customer's
+         * monitors, host/schemes, capabilities or status change and can be used to build entity tags for REST
+         * responses.  Versions are seeded from the startup time so tags issued by a previous instance are never
+         * reused.  This method is thread safe.
+         *
+         * \param[in] customerId The ID of the customer of interest.
+         *
+         * \return Returns the customer's current data version.
+         */
+        unsigned long long customerVersion(CustomerId customerId) const;
+
+        /**
+         * Method you can use to indicate that data tied to a customer has changed.  This method is thread safe.
+         *
+         * \param[in] customerId The ID of the customer whose data changed.
+         */
+        void customerChanged(CustomerId customerId);
+
+        /**
+         * Method you can use to wait for the data version for a customer to change.  This method is thread safe.
+         *
+         * \param[in] customerId          The ID of the customer of interest.
+         *
+         * \param[in] knownVersion        The data version the caller already holds.
+         *
+         * \param[in] timeoutMilliseconds The maximum time to wait, in milliseconds.
+         *
+         * \return Returns the customer's current data version.  The value matches the known version if the wait
+         *         timed out.
+         */
+        unsigned long long waitForCustomerChange(
+            CustomerId         customerId,
+            unsigned long long knownVersion,
+            unsigned long      timeoutMilliseconds
+        ) const;
+
+        /**
+         * Method you can use to indicate that data tied to any customer may have changed.  This method is thread
+         * safe.
+         */
+        void allCustomersChanged();
+
+    private:
+        /**
+         * Trivial class used to queue incremental changes.
+         */
+        class Change {
+            public:
+                /**
+                 * Enumeration of change types.
+                 */
+                enum class Type {
+                    UPDATE_MONITOR,
+                    REMOVE_MONITOR,
+                    REMOVE_CUSTOMER_MONITORS,
+                    UPDATE_HOST_SCHEME,
+                    REMOVE_HOST_SCHEME,
+                    REMOVE_CUSTOMER_HOST_SCHEMES
+                };
+
+                Change():type(Type::REMOVE_MONITOR),id(0) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] changeType The change type.
+                 *
+                 * \param[in] changeId   The monitor, host/scheme or customer ID.
+                 */
+                Change(Type changeType, unsigned long changeId):type(changeType),id(changeId) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] monitor The created or modified monitor.
+                 */
+                Change(const Monitor& monitor):type(Type::UPDATE_MONITOR),id(monitor.monitorId()),monitor(monitor) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] hostScheme The created or modified host/scheme.
+                 */
+                Change(
+                        const HostScheme& hostScheme
+                    ):type(
+                        Type::UPDATE_HOST_SCHEME
+                    ),id(
+                        hostScheme.hostSchemeId()
+                    ),hostScheme(
+                        hostScheme
+                    ) {}
+
+                /**
+                 * The type of change.
+                 */
+                Type type;
+
+                /**
+                 * The monitor, host/scheme or customer ID.
+                 */
+                unsigned long id;
+
+                /**
+                 * The monitor data for \ref Type::UPDATE_MONITOR changes.
+                 */
+                Monitor monitor;
+
+                /**
+                 * The host/scheme data for \ref Type::UPDATE_HOST_SCHEME changes.
+                 */
+                HostScheme hostScheme;
+        };
+
+        /**
+         * Trivial class used to detect a snapshot file that no longer matches the database.
+         */
+        class Fingerprint {
+            public:
+                Fingerprint():numberHostSchemes(0),maximumHostSchemeId(0),numberMonitors(0),maximumMonitorId(0) {}
+
+                /**
+                 * Method you can use to compare two fingerprints.
+                 *
+                 * \param[in] other The instance to compare against.
+                 *
+                 * \return Returns true if the fingerprints match.
+                 */
+                inline bool operator==(const Fingerprint& other) const {
+                    return (
+                           numberHostSchemes == other.numberHostSchemes
+                        && maximumHostSchemeId == other.maximumHostSchemeId
+                        && numberMonitors == other.numberMonitors
+                        && maximumMonitorId == other.maximumMonitorId
+                    );
+                }
+
+                /**
+                 * The number of host/schemes.
+                 */
+                quint64 numberHostSchemes;
+
+                /**
+                 * The largest host/scheme ID.
+                 */
+                quint64 maximumHostSchemeId;
+
+                /**
+                 * The number of monitors.
+                 */
+                quint64 numberMonitors;
+
+                /**
+                 * The largest monitor ID.
+                 */
+                quint64 maximumMonitorId;
+        };
+
+        /**
+         * Value placed at the start of a snapshot file.
+         */
+        static const char snapshotFileMagic[8];
+
+        /**
+         * Value placed at the end of a snapshot file.
+         */
+        static const quint32 snapshotFileEndMarker;
+
+        /**
+         * The snapshot file format version.  Files written using a different version are ignored.
+         */
+        static const quint32 snapshotFileVersion;
+
+        /**
+         * Method that calculates the fingerprint of a snapshot.
+         *
+         * \param[in] snapshot The snapshot of interest.
+         *
+         * \return Returns the snapshot's fingerprint.
+         */
+        static Fingerprint fingerprint(const Snapshot& snapshot);
+
+        /**
+         * Method that calculates the fingerprint of the database tables.
+         *
+         * \param[out] result   The database fingerprint.
+         *
+         * \param[in]  threadId The thread ID used to obtain a database instance.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool databaseFingerprint(Fingerprint& result, unsigned threadId);
+
+        /**
+         * Method that writes the contents of a snapshot to a stream.
+         *
+         * \param[in] stream   The stream to write to.
+         *
+         * \param[in] snapshot The snapshot to be written.
+         */
+        static void writeSnapshotEntries(QDataStream& stream, const Snapshot& snapshot);
+
+        /**
+         * Method that reads the contents of a snapshot from a stream.
+         *
+         * \param[in]  stream          The stream to read from.
+         *
+         * \param[in]  fileFingerprint The fingerprint recorded in the file header.
+         *
+         * \param[out] snapshot        The snapshot to be populated.
+         *
+         * \return Returns true on success.  Returns false if the stream holds invalid data.
+         */
+        static bool readSnapshotEntries(QDataStream& stream, const Fingerprint& fileFingerprint, Snapshot& snapshot);
+
+        /**
+         * Method that determines if the catalog should be reloaded.
+         *
+         * \return Returns true if the catalog has never been loaded, has been invalidated, or has not been
+         *         reloaded within the reconcile interval.
+         */
+        bool needsReconcile() const;
+
+        /**
+         * Method that reloads the catalog from the database.  The reconcile mutex must be locked by the caller.
+         * Changes queued while the tables are being read are applied on top of the reloaded data.
+         *
+         * \param[in] threadId The thread ID used to obtain a database instance.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool reconcile(unsigned threadId);
+
+        /**
+         * Method that queues a change.
+         *
+         * \param[in] change The change to be queued.
+         */
+        void queueChange(const Change& change);
+
+        /**
+         * Method that applies a list of changes to a snapshot.
+         *
+         * \param[in,out] snapshot The snapshot to be updated.
+         *
+         * \param[in]     changes  The changes to be applied, in order.
+         */
+        static void applyChanges(Snapshot& snapshot, const QList<Change>& changes);
+
+        /**
+         * Method that folds pending changes into a new snapshot.  The writer mutex must be locked by the caller.
+         */
+        void applyPendingChanges();
+
+        /**
+         * The underlying database manager instance.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * Mutex used to serialize changes.
+         */
+        mutable QMutex writerMutex;
+
+        /**
+         * Mutex used to serialize reloads.
+         */
+        QMutex reconcileMutex;
+
+        /**
+         * The current snapshot.  Accessed using the std::atomic_load and std::atomic_store functions.
+         */
+        SnapshotPointer currentSnapshot;
+
+        /**
+         * Changes not yet folded into the current snapshot.
+         */
+        QList<Change> pendingChanges;
+
+        /**
+         * Changes queued since the current reload started.
+         */
+        QList<Change> changesDuringReconcile;
+
+        /**
+         * Flag indicating that a reload is reading the database.
+         */
+        bool reconcileInProgress;
+
+        /**
+         * Flag indicating that the current snapshot was restored from a file and is waiting for
+         * \ref Catalog::reconcileNow.
+         */
+        QAtomicInt restoredPendingReconcile;
+
+        /**
+         * The number of pending changes.  Used to avoid locking when no changes are pending.
+         */
+        QAtomicInt numberPendingChanges;
+
+        /**
+         * Flag indicating that the catalog has been invalidated.
+         */
+        QAtomicInt invalidated;
+
+        /**
+         * Timer measuring the time since the last successful reload.
+         */
+        QElapsedTimer timeSinceReconcile;
+
+        /**
+         * The current reconcile interval, in milliseconds.
+         */
+        qint64 currentReconcileIntervalMilliseconds;
+
+        /**
+         * Mutex used to protect the customer data versions.
+         */
+        mutable QMutex customerVersionMutex;
+
+        /**
+         * Wait condition signalled whenever a customer data version changes.
+         */
+        mutable QWaitCondition customerVersionChanged;
+
+        /**
+         * The data version for each customer that has changed since startup.
+         */
+        QHash<CustomerId, unsigned long long> customerVersions;
+
+        /**
+         * The most recently issued data version.
+         */
+        unsigned long long lastCustomerVersion;
+
+        /**
+         * The data version applied to every customer.  Customers with an older entry report this value.
+         */
+        unsigned long long allCustomersVersion;
+};
+
+#endif
@@ -0,0 +1,517 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref ConcurrentCache template class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef CONCURRENT_CACHE_H
+#define CONCURRENT_CACHE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include <cstdint>
+
+#include "cache_base.h"
+#include "cache.h"
+
+/**
+ * Template class you can use to create a thread safe cache.  The cache is split into a number of
+ * independently locked shards, each of which is a \ref Cache instance.  Entries are assigned to shards by hash of the
+ * entry ID so threads accessing different entries will rarely contend for the same lock.
+ *
+ * Because entries can be evicted by other threads at any time, this class never exposes pointers into the cache.
+ * Values are copied out under the shard lock and can be modified in place using \ref modifyCacheEntry.
+ *
+ * The cache can optionally remember, for a limited time, IDs that are known not to exist.  This negative cache is
+ * bounded and disabled by default, see \ref setNegativeCaching.  Adding an entry clears any negative entry for the
+ * same ID.
+ *
+ * The parameter T is the datatype being cached.  The type T must be default constructable and assignable.  The
+ * parameter ID should be a C++ pod type with a predictable byte representation.
+ *
+ * You should create a derived class and overload the pure-virtual method \ref idFromValue.
+ */
+template<typename T, typename ID> class ConcurrentCache:public CacheBase {
+    public:
+        /**
+         * The default number of shards.
+         */
+        static constexpr unsigned defaultNumberShards = 16;
+
+        /**
+         * The default negative cache depth.
+         */
+        static constexpr unsigned long defaultNegativeCacheDepth = 10000;
+
+        /**
+         * The default time a negative cache entry remains valid, in seconds.
+         */
+        static constexpr unsigned long defaultNegativeTimeToLiveSeconds = 60;
+
+        /**
+         * Constructor
+         *
+         * \param[in] maximumCacheDepth The maximum allowed cache depth, across all shards.
+         *
+         * \param[in] evictionPolicy    The eviction policy to use when a shard is full.
+         *
+         * \param[in] numberShards      The number of independently locked shards.
+         */
+        ConcurrentCache(
+                Index          maximumCacheDepth,
+                EvictionPolicy evictionPolicy = EvictionPolicy::RANDOM,
+                unsigned       numberShards = defaultNumberShards
+            ) {
+            currentNumberShards   = numberShards > 0 ? numberShards : 1;
+            currentEvictionPolicy = evictionPolicy;
+            shards                = new Shard*[currentNumberShards];
+
+            Index shardCacheDepth = calculateShardCacheDepth(maximumCacheDepth);
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                shards[i] = new Shard(this, shardCacheDepth, evictionPolicy);
+            }
+
+            negativeClock.start();
+        }
+
+        virtual ~ConcurrentCache() {
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                delete shards[i];
+            }
+
+            delete[] shards;
+        }
+
+        /**
+         * Method that resizes the cache.  Existing entries are retained, see \ref Cache::resizeCache.  Shards are
+         * resized one at a time so the resize proceeds incrementally.  Other threads can continue to use every shard
+         * not currently being rehashed.  The method does nothing if the cache size is unchanged.
+         *
+         * \param[in] newCacheSize The new cache size, across all shards.
+         */
+        void resizeCache(unsigned long newCacheSize) {
+            Index shardCacheDepth = calculateShardCacheDepth(newCacheSize);
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                Shard*       shard = shards[i];
+                QMutexLocker locker(&shard->mutex);
+                shard->resizeCache(shardCacheDepth);
+            }
+        }
+
+        /**
+         * Method that discards every cached entry.  Negative entries are retained.
+         */
+        void clearCache() {
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                Shard*       shard = shards[i];
+                QMutexLocker locker(&shard->mutex);
+                shard->clearCache();
+            }
+        }
+
+        /**
+         * Method you can use to configure negative caching.
+         *
+         * \param[in] maximumNegativeCacheDepth The maximum number of IDs, across all shards, to remember as not
+         *                                      existing.  A value of 0 disables negative caching and discards all
+         *                                      negative entries.
+         *
+         * \param[in] timeToLiveSeconds         The time, in seconds, that a negative entry remains valid.
+         */
+        void setNegativeCaching(Index maximumNegativeCacheDepth, unsigned long timeToLiveSeconds) {
+            Index shardNegativeCacheDepth = (
+                  maximumNegativeCacheDepth > 0
+                ? calculateShardCacheDepth(maximumNegativeCacheDepth)
+                : 0
+            );
+
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                Shard*       shard = shards[i];
+                QMutexLocker locker(&shard->mutex);
+                shard->negativeCache.resizeCache(shardNegativeCacheDepth);
+                shard->negativeTimeToLiveMilliseconds = 1000LL * timeToLiveSeconds;
+            }
+        }
+
+        /**
+         * Method you can use to record that an ID is known not to exist.  The call is ignored if negative caching is
+         * disabled.
+         *
+         * \param[in] entryId The ID that does not exist.
+         */
+        void addNegativeEntry(ID entryId) {
+            Shard*       shard = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            NegativeEntry negativeEntry;
+            negativeEntry.entryId        = entryId;
+            negativeEntry.expirationTime = negativeClock.elapsed() + shard->negativeTimeToLiveMilliseconds;
+
+            shard->negativeCache.addToCache(negativeEntry);
+        }
+
+        /**
+         * Method you can use to determine if an ID is known not to exist.  Expired negative entries are discarded.
+         *
+         * \param[in] entryId The ID of interest.
+         *
+         * \return Returns true if the ID holds an unexpired negative entry.  Returns false otherwise.
+         */
+        bool isKnownAbsent(ID entryId) {
+            Shard*       shard = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            bool                 result        = false;
+            const NegativeEntry* negativeEntry = shard->negativeCache.getCacheEntry(entryId);
+            if (negativeEntry != nullptr) {
+                if (negativeEntry->expirationTime > negativeClock.elapsed()) {
+                    result = true;
+                } else {
+                    shard->negativeCache.evictCacheEntry(entryId);
+                }
+            }
+
+            return result;
+        }
+
+        /**
+         * Method you can use to discard any negative entry for an ID.
+         *
+         * \param[in] entryId The ID of interest.
+         */
+        void clearNegativeEntry(ID entryId) {
+            Shard*       shard = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            shard->negativeCache.evictCacheEntry(entryId);
+        }
+
+        /**
+         * Method you can use to determine the current eviction policy.
+         *
+         * \return Returns the current eviction policy.
+         */
+        inline EvictionPolicy evictionPolicy() const {
+            return currentEvictionPolicy;
+        }
+
+        /**
+         * Method you can use to change the eviction policy.  Cached entries are retained.
+         *
+         * \param[in] newEvictionPolicy The new eviction policy.
+         */
+        void setEvictionPolicy(EvictionPolicy newEvictionPolicy) {
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                Shard*       shard = shards[i];
+                QMutexLocker locker(&shard->mutex);
+                shard->setEvictionPolicy(newEvictionPolicy);
+            }
+
+            currentEvictionPolicy = newEvictionPolicy;
+        }
+
+        /**
+         * Method you can use to obtain the cache statistics, summed across all shards.
+         *
+         * \return Returns the cache statistics.
+         */
+        Statistics statistics() const {
+            Statistics result;
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                const Shard* shard = shards[i];
+                QMutexLocker locker(&shard->mutex);
+                result += shard->statistics();
+            }
+
+            return result;
+        }
+
+        /**
+         * Method you can use to reset the cache statistics.
+         */
+        void resetStatistics() {
+            for (unsigned i=0 ; i<currentNumberShards ; ++i) {
+                Shard*       shard = shards[i];
+                QMutexLocker locker(&shard->mutex);
+                shard->resetStatistics();
+            }
+        }
+
+        /**
+         * Method you can use to get a copy of a cache entry from the cache by ID.
+         *
+         * \param[in]  entryId The ID of the desired entry.
+         *
+         * \param[out] value   The value to be populated with a copy of the cached entry.  The value is left unchanged
+         *                     if the entry is not in the cache.
+         *
+         * \return Returns true if the entry was found in the cache.  Returns false if the entry is not in the cache.
+         */
+        bool getCacheEntry(ID entryId, T& value) const {
+            const Shard* shard = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            const T* entry = shard->getCacheEntry(entryId);
+            if (entry != nullptr) {
+                value = *entry;
+            }
+
+            return entry != nullptr;
+        }
+
+        /**
+         * Method you can use to modify a cache entry in place.  The supplied function is called with a reference to
+         * the cached value while the shard lock is held so the function should be short and must not access this
+         * cache.
+         *
+         * \param[in] entryId  The ID of the entry to be modified.
+         *
+         * \param[in] function The function or functor to be called with a reference to the cached value.
+         *
+         * \return Returns true if the entry was found and modified.  Returns false if the entry is not in the cache.
+         */
+        template<typename F> bool modifyCacheEntry(ID entryId, F function) {
+            Shard*       shard = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            T* entry = shard->getCacheEntry(entryId);
+            if (entry != nullptr) {
+                function(*entry);
+            }
+
+            return entry != nullptr;
+        }
+
+        /**
+         * Method you can use to evict a cache entry from the cache.
+         *
+         * \param[in] entryId The ID of the entry to be evicted.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool evictCacheEntry(ID entryId) {
+            Shard*       shard = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            return shard->evictCacheEntry(entryId);
+        }
+
+        /**
+         * Method you can use to add a new cache entry to the cache.  If needed, another entry in the same shard will
+         * be evicted to make room for this entry.
+         *
+         * \param[in] value The value to be added.
+         */
+        void addToCache(const T& value) {
+            ID           entryId = idFromValue(value);
+            Shard*       shard   = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            shard->negativeCache.evictCacheEntry(entryId);
+            shard->addToCache(value);
+        }
+
+        /**
+         * Method you can use to add a new cache entry to the cache only if no entry with the same ID is already
+         * cached.  The check and insertion are performed atomically.
+         *
+         * \param[in] value The value to be added.
+         *
+         * \return Returns true if the value was added.  Returns false if an entry with the same ID was already cached.
+         */
+        bool addToCacheIfAbsent(const T& value) {
+            ID           entryId = idFromValue(value);
+            Shard*       shard   = shardForId(entryId);
+            QMutexLocker locker(&shard->mutex);
+
+            bool absent = (shard->getCacheEntry(entryId) == nullptr);
+            if (absent) {
+                shard->negativeCache.evictCacheEntry(entryId);
+                shard->addToCache(value);
+            }
+
+            return absent;
+        }
+
+    protected:
+        /**
+         * Method that obtains the ID used to access a specific value.
+         *
+         * \param[in] value The value to calculate the ID for.
+         *
+         * \return Returns the ID to associate with this value.
+         */
+        virtual ID idFromValue(const T& value) const = 0;
+
+    private:
+        /**
+         * Class that holds a negative cache entry.
+         */
+        class NegativeEntry {
+            public:
+                NegativeEntry() {
+                    entryId        = ID();
+                    expirationTime = 0;
+                }
+
+                /**
+                 * The ID known not to exist.
+                 */
+                ID entryId;
+
+                /**
+                 * The time when this entry expires, in milliseconds relative to the cache's negative clock.
+                 */
+                qint64 expirationTime;
+        };
+
+        /**
+         * Class that holds the negative entries for a single shard.
+         */
+        class NegativeCache:public Cache<NegativeEntry, ID> {
+            public:
+                NegativeCache():Cache<NegativeEntry, ID>(0, CacheBase::EvictionPolicy::CLOCK) {}
+
+                ~NegativeCache() override {}
+
+            protected:
+                /**
+                 * Method that obtains the ID used to access a specific value.
+                 *
+                 * \param[in] value The value to calculate the ID for.
+                 *
+                 * \return Returns the ID to associate with this value.
+                 */
+                ID idFromValue(const NegativeEntry& value) const final {
+                    return value.entryId;
+                }
+        };
+
+        /**
+         * Class that holds a single independently locked shard of the cache.
+         */
+        class Shard:public Cache<T, ID> {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] owner             The cache that owns this shard.
+                 *
+                 * \param[in] maximumCacheDepth The maximum allowed cache depth for this shard.
+                 *
+                 * \param[in] evictionPolicy    The eviction policy for this shard.
+                 */
+                Shard(
+                        const ConcurrentCache*    owner,
+                        CacheBase::Index          maximumCacheDepth,
+                        CacheBase::EvictionPolicy evictionPolicy
+                    ):Cache<T, ID>(
+                        maximumCacheDepth,
+                        evictionPolicy
+                    ),negativeTimeToLiveMilliseconds(
+                        0
+                    ),owner(
+                        owner
+                    ) {}
+
+                ~Shard() override {}
+
+                /**
+                 * Mutex used to protect this shard.
+                 */
+                mutable QMutex mutex;
+
+                /**
+                 * The negative entries for this shard.
+                 */
+                NegativeCache negativeCache;
+
+                /**
+                 * The time a negative entry remains valid, in milliseconds.
+                 */
+                qint64 negativeTimeToLiveMilliseconds;
+
+            protected:
+                /**
+                 * Method that obtains the ID used to access a specific value.  This method defers to the owning
+                 * cache.
+                 *
+                 * \param[in] value The value to calculate the ID for.
+                 *
+                 * \return Returns the ID to associate with this value.
+                 */
+                ID idFromValue(const T& value) const final {
+                    return owner->idFromValue(value);
+                }
+
+            private:
+                /**
+                 * The cache that owns this shard.
+                 */
+                const ConcurrentCache* owner;
+        };
+
+        /**
+         * Method that determines the per-shard cache depth from a total cache depth.
+         *
+         * \param[in] maximumCacheDepth The maximum allowed cache depth, across all shards.
+         *
+         * \return Returns the maximum cache depth for each shard.
+         */
+        inline Index calculateShardCacheDepth(Index maximumCacheDepth) const {
+            Index shardCacheDepth = (maximumCacheDepth + currentNumberShards - 1) / currentNumberShards;
+            return shardCacheDepth > 0 ? shardCacheDepth : 1;
+        }
+
+        /**
+         * Method that locates the shard holding a given entry.  We use the upper bits of the hash so the shard
+         * selection is largely independent of the index used within the shard.
+         *
+         * \param[in] entryId The ID of the entry.
+         *
+         * \return Returns a pointer to the shard.
+         */
+        inline Shard* shardForId(ID entryId) const {
+            return shards[static_cast<unsigned>((hashId(entryId) >> 32) % currentNumberShards)];
+        }
+
+        /**
+         * The number of shards.
+         */
+        unsigned currentNumberShards;
+
+        /**
+         * The current eviction policy.
+         */
+        EvictionPolicy currentEvictionPolicy;
+
+        /**
+         * Array of pointers to each shard.
+         */
+        Shard** shards;
+
+        /**
+         * Monotonic clock used to expire negative entries.
+         */
+        QElapsedTimer negativeClock;
+};
+
+#endif
@@ -27,16 +27,22 @@
 #include <QString>
 #include <QByteArray>
 #include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QList>
 
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 
 #include "rest_helpers.h"
+#include "cache_base.h"
+#include "job_scheduler.h"
 
 class CustomersCapabilities;
 class CustomerSecrets;
 class ServerAdministrator;
+class CacheWarmer;
 
 /**
  * Class that support a set of REST endpoints used to manage customer capabilities.
@@ -65,6 +71,11 @@ class CustomerCapabilitiesManager:public QObject {
          */
         static const QString customerCapabilitiesPurgePath;
 
+        /**
+         * Path used to synchronize the capabilities of a collection of customers in bulk.
+         */
+        static const QString customerCapabilitiesSyncPath;
+
         /**
          * Path used to obtain a list of all customer's capabilities.
          */
@@ -85,6 +96,11 @@ class CustomerCapabilitiesManager:public QObject {
          */
         static const QString customerCapabilitiesPausePath;
 
+        /**
+         * Path used to obtain customer secrets and customer capabilities cache statistics.
+         */
+        static const QString customerCacheStatisticsPath;
+
         /**
          * Constructor
          *
@@ -97,6 +113,11 @@ class CustomerCapabilitiesManager:public QObject {
          * \param[in] serverAdministrator              The server administrator used to issue commands to the polling
          *                                             servers.
          *
+         * \param[in] cacheWarmer                      The cache warmer used to pre-populate the customer caches.
+         *
+         * \param[in] jobScheduler                     The scheduler used to run customer purges and
+         *                                             synchronizations in the background.
+         *
          * \param[in[ secret                           The incoming data secret.
          *
          * \param[in] parent                           Pointer to the parent object.
@@ -106,6 +127,8 @@ class CustomerCapabilitiesManager:public QObject {
             CustomersCapabilities* customerCapabilitiesDatabaseApi,
             CustomerSecrets*       customerSecretsDatabaseApi,
             ServerAdministrator*   ServerAdministrator,
+            CacheWarmer*           cacheWarmer,
+            JobScheduler*          jobScheduler,
             const QByteArray&      secret,
             QObject*               parent = nullptr
         );
@@ -297,15 +320,112 @@ class CustomerCapabilitiesManager:public QObject {
                  *                                            database.
                  *
                  * \param[in] serverAdministrator             The server administrator.
+                 *
+                 * \param[in] jobScheduler                    The scheduler used to run purges in the background.
                  */
                 CustomerCapabilitiesPurge(
                     const QByteArray&      secret,
                     CustomersCapabilities* customerCapabilitiesDatabaseApi,
-                    ServerAdministrator*   serverAdministrator
+                    ServerAdministrator*   serverAdministrator,
+                    JobScheduler*          jobScheduler
                 );
 
                 ~CustomerCapabilitiesPurge() override;
 
+                /**
+                 * The job type used for customer purges.
+                 */
+                static const QString purgeJobType;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * Method that performs a purge from a job worker.
+                 *
+                 * \param[in] parameters The job parameters.
+                 *
+                 * \param[in] progress   The job's progress reporter.
+                 *
+                 * \param[in] threadId   The database thread ID reserved for the calling worker.
+                 *
+                 * \return Returns true on success.  Returns false on error.
+                 */
+                bool purgeCustomers(const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId);
+
+                /**
+                 * The current customer capabilities database API.
+                 */
+                CustomersCapabilities* currentCustomersCapabilities;
+
+                /**
+                 * The server administrator used to command the polling servers.
+                 */
+                ServerAdministrator* currentServerAdministrator;
+
+                /**
+                 * The scheduler used to run purges in the background.
+                 */
+                JobScheduler* currentJobScheduler;
+        };
+
+        /**
+         * The customer/sync handler.
+         */
+        class CustomerCapabilitiesSync:public RestApiInV1::InesonicRestHandler {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret                          The secret to use for this handler.
+                 *
+                 * \param[in] customerCapabilitiesDatabaseApi Class used to manage customer capabilities in the
+                 *                                            database.
+                 *
+                 * \param[in] serverAdministrator             The server administrator.
+                 *
+                 * \param[in] customerSecretsDatabaseApi      Class used to manage customer secrets.
+                 *
+                 * \param[in] jobScheduler                    The scheduler used to run synchronizations in the
+                 *                                            background.
+                 */
+                CustomerCapabilitiesSync(
+                    const QByteArray&      secret,
+                    CustomersCapabilities* customerCapabilitiesDatabaseApi,
+                    ServerAdministrator*   serverAdministrator,
+                    CustomerSecrets*       customerSecretsDatabaseApi,
+                    JobScheduler*          jobScheduler
+                );
+
+                ~CustomerCapabilitiesSync() override;
+
+                /**
+                 * The job type used for customer synchronizations.
+                 */
+                static const QString syncJobType;
+
+                /**
+                 * The maximum number of customers sent to the polling servers in a single update.
+                 */
+                static const unsigned customerBatchSize;
+
             protected:
                 /**
                  * Method you can overload to receive a request and send a return response.  This method will only be
@@ -326,6 +446,61 @@ class CustomerCapabilitiesManager:public QObject {
                 ) override;
 
             private:
+                /**
+                 * Method that converts a single entry of a synchronization request to customer capabilities.  Fields
+                 * that are omitted take the same defaults used by the customer/create endpoint.
+                 *
+                 * \param[in] value The entry to be converted.
+                 *
+                 * \return Returns the customer capabilities.  An invalid instance is returned if the entry is not
+                 *         valid.
+                 */
+                static CustomerCapabilities toCapabilities(const QJsonValue& value);
+
+                /**
+                 * Method that performs a synchronization from a job worker.
+                 *
+                 * \param[in] parameters The job parameters.
+                 *
+                 * \param[in] progress   The job's progress reporter.
+                 *
+                 * \param[in] threadId   The database thread ID reserved for the calling worker.
+                 *
+                 * \return Returns true on success.  Returns false on error.
+                 */
+                bool synchronizeCustomers(
+                    const QJsonObject&      parameters,
+                    JobScheduler::Progress& progress,
+                    unsigned                threadId
+                );
+
+                /**
+                 * Method that sends a list of customers to the polling servers in batches.
+                 *
+                 * \param[in]     customerIds The customers to be sent.
+                 *
+                 * \param[in]     activate    If true, the customers are activated.  If false, the customers are
+                 *                            deactivated.
+                 *
+                 * \param[in]     total       The total number of customers to be sent by this job.
+                 *
+                 * \param[in,out] completed   The number of customers sent so far by this job.
+                 *
+                 * \param[in]     progress    The job's progress reporter.
+                 *
+                 * \param[in]     threadId    The database thread ID reserved for the calling worker.
+                 *
+                 * \return Returns true on success.  Returns false if any batch could not be sent.
+                 */
+                bool updatePollingServers(
+                    const QList<CustomerCapabilities::CustomerId>& customerIds,
+                    bool                                           activate,
+                    unsigned long                                  total,
+                    unsigned long&                                 completed,
+                    JobScheduler::Progress&                        progress,
+                    unsigned                                       threadId
+                );
+
                 /**
                  * The current customer capabilities database API.
                  */
@@ -335,6 +510,16 @@ class CustomerCapabilitiesManager:public QObject {
                  * The server administrator used to command the polling servers.
                  */
                 ServerAdministrator* currentServerAdministrator;
+
+                /**
+                 * The customer secrets database API.
+                 */
+                CustomerSecrets* currentCustomerSecrets;
+
+                /**
+                 * The scheduler used to run synchronizations in the background.
+                 */
+                JobScheduler* currentJobScheduler;
         };
 
         /**
@@ -512,6 +697,82 @@ class CustomerCapabilitiesManager:public QObject {
                 ServerAdministrator* currentServerAdministrator;
         };
 
+        /**
+         * The customer/cache/statistics handler.
+         */
+        class CustomerCacheStatistics:public RestApiInV1::InesonicRestHandler, private RestHelpers {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret                          The secret to use for this handler.
+                 *
+                 * \param[in] customerCapabilitiesDatabaseApi Class used to manage customer capabilities in the
+                 *                                            database.
+                 *
+                 * \param[in] customerSecretsDatabaseApi      Class used to manage customer secrets.
+                 *
+                 * \param[in] cacheWarmer                     The cache warmer used to pre-populate the caches.
+                 */
+                CustomerCacheStatistics(
+                    const QByteArray&      secret,
+                    CustomersCapabilities* customerCapabilitiesDatabaseApi,
+                    CustomerSecrets*       customerSecretsDatabaseApi,
+                    CacheWarmer*           cacheWarmer
+                );
+
+                ~CustomerCacheStatistics() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * Method that converts cache statistics to a JSON object.
+                 *
+                 * \param[in] statistics     The statistics to be converted.
+                 *
+                 * \param[in] evictionPolicy The eviction policy used by the cache.
+                 *
+                 * \return Returns the statistics as a JSON object.
+                 */
+                static QJsonObject statisticsToJson(
+                    const CacheBase::Statistics& statistics,
+                    CacheBase::EvictionPolicy    evictionPolicy
+                );
+
+                /**
+                 * The current customer capabilities database API.
+                 */
+                CustomersCapabilities* currentCustomersCapabilities;
+
+                /**
+                 * The current customer secrets database API.
+                 */
+                CustomerSecrets* currentCustomerSecrets;
+
+                /**
+                 * The cache warmer.
+                 */
+                CacheWarmer* currentCacheWarmer;
+        };
+
         /**
          * The customer/get handler.
          */
@@ -532,6 +793,11 @@ class CustomerCapabilitiesManager:public QObject {
          */
         CustomerCapabilitiesPurge customerCapabilitiesPurge;
 
+        /**
+         * The customer/sync handler.
+         */
+        CustomerCapabilitiesSync customerCapabilitiesSync;
+
         /**
          * The customer/list handler.
          */
@@ -551,6 +817,11 @@ class CustomerCapabilitiesManager:public QObject {
          * The customer/pause handler.
          */
         CustomerCapabilitiesPause customerCapabilitiesPause;
+
+        /**
+         * The customer/cache/statistics handler.
+         */
+        CustomerCacheStatistics customerCacheStatistics;
 };
 
 #endif
@@ -25,7 +25,10 @@
 
 #include <QObject>
 #include <QString>
+#include <QHash>
 #include <QSet>
+#include <QList>
+#include <QMutex>
 
 #include <cstdint>
 
@@ -35,6 +38,7 @@
 
 class QTimer;
 class DatabaseManager;
+class ShardMap;
 
 /**
  * Class used to track which servers a customer has been assigned to.  This class expects a table named
@@ -51,6 +55,9 @@ class DatabaseManager;
  *         CONSTRAINT customer_mapping_constraint_2 FOREIGN KEY (server_id)
  *             REFERENCES servers (server_id) ON DELETE CASCADE ON UPDATE NO ACTION
  *     ) ENGINE=InnoDB DEFAULT CHARSET=latin1
+ *
+ * The table is loaded once into an in-memory index, keyed both by customer and by server, which is kept consistent
+ * with the database as mappings are updated.  Reads are served from the index.
  */
 class CustomerMapping:public QObject {
     Q_OBJECT
@@ -71,6 +78,16 @@ class CustomerMapping:public QObject {
          */
         static constexpr ServerId invalidServerId = 0;
 
+        /**
+         * The maximum number of rows written by a single statement during bulk updates.
+         */
+        static const unsigned maximumRowsPerStatement;
+
+        /**
+         * The table name used for cache invalidation notifications.
+         */
+        static const char invalidationTable[];
+
         /**
          * Type used to represent a list of servers.
          */
@@ -232,6 +249,18 @@ class CustomerMapping:public QObject {
          */
         bool updateMapping(CustomerId customerId, const Mapping& mapping, unsigned threadId = 0);
 
+        /**
+         * Method you can use to assign mappings to a collection of customers in a single transaction.
+         *
+         * \param[in] mappings The mappings to assign, by customer ID.  An empty mapping removes the customer from
+         *                     every server.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error, in which case no mapping is changed.
+         */
+        bool updateMappings(const MappingsByCustomerId& mappings, unsigned threadId = 0);
+
         /**
          * Method you can use to obtain a customer mapping.
          *
@@ -255,11 +284,117 @@ class CustomerMapping:public QObject {
          */
         MappingsByCustomerId mappings(ServerId serverId = invalidServerId, unsigned threadId = 0);
 
+        /**
+         * Method you can use to obtain the customers assigned to a server.
+         *
+         * \param[in] serverId The server ID of the server we want customers for.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns a list of the customers assigned to the server.
+         */
+        QList<CustomerId> customerIds(ServerId serverId, unsigned threadId = 0);
+
+        /**
+         * Method you can use to remove a server from the in-memory index.  Call this method after the server has been
+         * deleted from the database so that the cascaded mapping entries are also dropped from memory.
+         *
+         * \param[in] serverId The server ID of the deleted server.
+         */
+        void removeServer(ServerId serverId);
+
+        /**
+         * Method you can use to force the in-memory index to be reloaded from the database on next access.
+         */
+        void invalidate();
+
+        /**
+         * Method you can use to restrict this mapping to the customers owned by the local shard.  Mappings for
+         * customers owned by other shards are ignored when the in-memory index is loaded so each shard balances only
+         * its own customers across the polling servers.
+         *
+         * \param[in] newShardMap The shard map.  A null pointer disables the restriction.
+         */
+        void setShardMap(ShardMap* newShardMap);
+
+        /**
+         * Method you can use to obtain the shard map used to restrict this mapping.
+         *
+         * \return Returns the shard map.  A null pointer is returned if no shard map is set.
+         */
+        ShardMap* shardMap() const;
+
+        /**
+         * Method you can use to determine if the local shard owns a customer.
+         *
+         * \param[in] customerId The customer ID of interest.
+         *
+         * \param[in] threadId   An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true if the local shard owns the customer or sharding is disabled.  Returns false if
+         *         another shard owns the customer.
+         */
+        bool ownsCustomer(CustomerId customerId, unsigned threadId = 0);
+
     private:
+        /**
+         * Method that loads the in-memory index from the database, if needed.  The caller must hold the index mutex.
+         *
+         * \param[in] threadId The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true if the index is loaded.  Returns false on error.
+         */
+        bool loadIndex(unsigned threadId);
+
+        /**
+         * Method that reads every mapping from the database.
+         *
+         * \param[out] success  Pointer to a boolean value holding true on success or false on error.
+         *
+         * \param[in]  threadId The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the mappings by customer ID.
+         */
+        MappingsByCustomerId readMappings(bool* success, unsigned threadId);
+
+        /**
+         * Method that replaces a customer's mapping in the in-memory index.  The caller must hold the index mutex.
+         *
+         * \param[in] customerId The customer ID of the customer to be updated.
+         *
+         * \param[in] mapping    The new mapping for the customer.  An empty mapping removes the customer.
+         */
+        void indexMapping(CustomerId customerId, const Mapping& mapping);
+
         /**
          * The underlying database manager instance.
          */
         DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The shard map used to restrict this mapping to locally owned customers.
+         */
+        ShardMap* currentShardMap;
+
+        /**
+         * Mutex used to guard the in-memory index.
+         */
+        QMutex indexMutex;
+
+        /**
+         * Flag indicating that the in-memory index has been loaded from the database.
+         */
+        bool indexLoaded;
+
+        /**
+         * The in-memory index of mappings by customer ID.
+         */
+        MappingsByCustomerId mappingsByCustomerId;
+
+        /**
+         * The in-memory index of assigned customers by server ID.
+         */
+        QHash<ServerId, QSet<CustomerId>> customerIdsByServerId;
 };
 
 #endif
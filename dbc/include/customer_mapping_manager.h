@@ -27,6 +27,9 @@
 #include <QString>
 #include <QByteArray>
 #include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdint>
 
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
@@ -99,6 +102,27 @@ class CustomerMappingManager:public QObject {
         void setSecret(const QByteArray& newSecret);
 
     private:
+        /**
+         * Method that checks that this shard owns a customer.  When another shard owns the customer, the response is
+         * populated with the owning shard's ID and base URL so the caller can resend the request to that shard.
+         *
+         * \param[in]  customerMapping The customer mapping database API.
+         *
+         * \param[in]  customerId      The customer ID named in the request.
+         *
+         * \param[in]  threadId        The ID used to uniquely identify this thread while in flight.
+         *
+         * \param[out] responseObject  The response object to populate if the customer belongs to another shard.
+         *
+         * \return Returns true if this shard owns the customer.  Returns false if the request belongs elsewhere.
+         */
+        static bool checkShard(
+            CustomerMapping* customerMapping,
+            std::uint32_t    customerId,
+            unsigned         threadId,
+            QJsonObject&     responseObject
+        );
+
         /**
          * The mapping/get handler.
          */
@@ -191,11 +215,17 @@ class CustomerMappingManager:public QObject {
                 /**
                  * Constructor
                  *
-                 * \param[in] secret                 The secret to use for this handler.
+                 * \param[in] secret                     The secret to use for this handler.
+                 *
+                 * \param[in] customerMappingDatabaseApi Class used to manage customer mapping entries in the database.
                  *
-                 * \param[in] serverAdministratorApi The server administration API.
+                 * \param[in] serverAdministratorApi     The server administration API.
                  */
-                CustomerMappingCustomerActivate(const QByteArray& secret, ServerAdministrator* serverAdministratorApi);
+                CustomerMappingCustomerActivate(
+                    const QByteArray&    secret,
+                    CustomerMapping*     customerMappingDatabaseApi,
+                    ServerAdministrator* serverAdministratorApi
+                );
 
                 ~CustomerMappingCustomerActivate() override;
 
@@ -219,6 +249,11 @@ class CustomerMappingManager:public QObject {
                 ) override;
 
             private:
+                /**
+                 * The current customer mapping database API.
+                 */
+                CustomerMapping* currentCustomerMapping;
+
                 /**
                  * The current server administrator.
                  */
@@ -233,11 +268,17 @@ class CustomerMappingManager:public QObject {
                 /**
                  * Constructor
                  *
-                 * \param[in] secret                 The secret to use for this handler.
+                 * \param[in] secret                     The secret to use for this handler.
                  *
-                 * \param[in] serverAdministratorApi The server administration API.
+                 * \param[in] customerMappingDatabaseApi Class used to manage customer mapping entries in the database.
+                 *
+                 * \param[in] serverAdministratorApi     The server administration API.
                  */
-                CustomerMappingCustomerDeactivate(const QByteArray& secret, ServerAdministrator* serverAdministratorApi);
+                CustomerMappingCustomerDeactivate(
+                    const QByteArray&    secret,
+                    CustomerMapping*     customerMappingDatabaseApi,
+                    ServerAdministrator* serverAdministratorApi
+                );
 
                 ~CustomerMappingCustomerDeactivate() override;
 
@@ -261,6 +302,11 @@ class CustomerMappingManager:public QObject {
                 ) override;
 
             private:
+                /**
+                 * The current customer mapping database API.
+                 */
+                CustomerMapping* currentCustomerMapping;
+
                 /**
                  * The current server administrator.
                  */
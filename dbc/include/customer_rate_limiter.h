@@ -0,0 +1,214 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref CustomerRateLimiter class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef CUSTOMER_RATE_LIMITER_H
+#define CUSTOMER_RATE_LIMITER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include <cstdint>
+
+#include "customer_capabilities.h"
+#include "metrics_registry.h"
+
+class CustomersCapabilities;
+
+/**
+ * Class that limits the rate at which each customer may call expensive customer API endpoints.  Each customer holds a
+ * token bucket refilled at a rate set by the customer's plan, taken as a base rate plus a rate per monitor the
+ * customer's capabilities allow.  Endpoints spend a cost weight from the bucket and requests that find too few tokens
+ * are refused along with the time until enough tokens will be available.
+ *
+ * Buckets are created on a customer's first request and discarded once idle long enough to have refilled.  Budgets
+ * are refreshed from the customer capabilities periodically so plan changes take effect without a restart.
+ */
+class CustomerRateLimiter {
+    public:
+        /**
+         * Type used to represent a customer ID.
+         */
+        typedef CustomerCapabilities::CustomerId CustomerId;
+
+        /**
+         * The default base token rate, in tokens per second.
+         */
+        static const double defaultBaseRate;
+
+        /**
+         * The default additional token rate per allowed monitor, in tokens per second.
+         */
+        static const double defaultRatePerMonitor;
+
+        /**
+         * The default bucket depth, in seconds of refill.
+         */
+        static const double defaultBurstSeconds;
+
+        /**
+         * The interval between budget refreshes from the customer capabilities, in milliseconds.
+         */
+        static const qint64 budgetRefreshMilliseconds;
+
+        /**
+         * Constructor
+         *
+         * \param[in] customersCapabilities The customer capabilities database API used to obtain each plan.
+         */
+        CustomerRateLimiter(CustomersCapabilities* customersCapabilities);
+
+        ~CustomerRateLimiter();
+
+        /**
+         * Method you can use to set the budgets granted to customers.  A base rate and rate per monitor of zero
+         * disables rate limiting.
+         *
+         * \param[in] baseRate       The token rate granted to every customer, in tokens per second.
+         *
+         * \param[in] ratePerMonitor The additional token rate granted per monitor the customer's plan allows, in
+         *                           tokens per second.
+         *
+         * \param[in] burstSeconds   The bucket depth, expressed in seconds of refill.
+         */
+        void setBudget(double baseRate, double ratePerMonitor, double burstSeconds);
+
+        /**
+         * Method you can use to spend tokens from a customer's bucket.
+         *
+         * \param[in]  customerId        The customer making the request.
+         *
+         * \param[in]  cost              The cost weight of the request, in tokens.
+         *
+         * \param[in]  threadId          The ID used to identify the thread and database connection.
+         *
+         * \param[out] retryAfterSeconds The number of seconds until the request would be admitted.  The value is
+         *                               only set if the request is refused.
+         *
+         * \return Returns true if the request is admitted.  Returns false if the request is refused.
+         */
+        bool admit(CustomerId customerId, double cost, unsigned threadId, unsigned* retryAfterSeconds);
+
+    private:
+        /**
+         * Trivial class that holds a customer's token bucket.
+         */
+        class Bucket {
+            public:
+                /**
+                 * The number of tokens available.
+                 */
+                double tokens;
+
+                /**
+                 * The refill rate, in tokens per second.
+                 */
+                double rate;
+
+                /**
+                 * The bucket depth, in tokens.
+                 */
+                double depth;
+
+                /**
+                 * The time the bucket was last refilled, in milliseconds.
+                 */
+                qint64 lastRefill;
+
+                /**
+                 * The time the budget was last refreshed from the customer capabilities, in milliseconds.
+                 */
+                qint64 lastBudgetRefresh;
+        };
+
+        /**
+         * The interval between sweeps of idle buckets, in milliseconds.
+         */
+        static const qint64 sweepIntervalMilliseconds;
+
+        /**
+         * Method that updates a bucket's budget from the customer capabilities.  The caller must not hold the bucket
+         * mutex.
+         *
+         * \param[in] customerId The customer of interest.
+         *
+         * \param[in] threadId   The ID used to identify the thread and database connection.
+         *
+         * \return Returns the refill rate, in tokens per second.
+         */
+        double customerRate(CustomerId customerId, unsigned threadId);
+
+        /**
+         * Method that discards buckets that have been idle long enough to have refilled.  The caller must hold the
+         * bucket mutex.
+         *
+         * \param[in] now The current time, in milliseconds.
+         */
+        void sweep(qint64 now);
+
+        /**
+         * The customer capabilities database API.
+         */
+        CustomersCapabilities* currentCustomersCapabilities;
+
+        /**
+         * Mutex used to guard the buckets and budget.
+         */
+        QMutex bucketMutex;
+
+        /**
+         * Clock used to refill buckets.
+         */
+        QElapsedTimer clock;
+
+        /**
+         * The base token rate, in tokens per second.
+         */
+        double currentBaseRate;
+
+        /**
+         * The token rate per allowed monitor, in tokens per second.
+         */
+        double currentRatePerMonitor;
+
+        /**
+         * The bucket depth, in seconds of refill.
+         */
+        double currentBurstSeconds;
+
+        /**
+         * The time idle buckets were last swept, in milliseconds.
+         */
+        qint64 lastSweep;
+
+        /**
+         * The buckets, by customer ID.
+         */
+        QHash<CustomerId, Bucket> buckets;
+
+        /**
+         * Counter tracking refused requests.
+         */
+        MetricsRegistry::Counter* rejectedMetric;
+};
+
+#endif
@@ -27,6 +27,7 @@
 #include <QString>
 #include <QByteArray>
 #include <QJsonDocument>
+#include <QAtomicInt>
 
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
@@ -41,7 +42,6 @@ class CustomersCapabilities;
 class HostSchemes;
 class Monitors;
 class Regions;
-class Servers;
 class Events;
 class EventProcessor;
 class LatencyInterfaceManager;
@@ -49,6 +49,10 @@ class Resoures;
 class LatencyPlotter;
 class ResourcePlotter;
 class ServerAdministrator;
+class ResponseCompressor;
+class Catalog;
+class DashboardCache;
+class CustomerRateLimiter;
 
 /**
  * Class that supports the customer REST API.
@@ -122,6 +126,11 @@ class CustomerRestApiV1:public QObject {
          */
         static const QString statusListPath;
 
+        /**
+         * Path used to wait for monitor status changes.
+         */
+        static const QString statusWaitPath;
+
         /**
          * Path used to get information needed by the WordPress plug-in.
          */
@@ -132,11 +141,26 @@ class CustomerRestApiV1:public QObject {
          */
         static const QString latencyListPath;
 
+        /**
+         * Path used to get latency statistics for several monitors.
+         */
+        static const QString latencyStatisticsPath;
+
+        /**
+         * Path used to get rolling latency statistics for several monitors.
+         */
+        static const QString latencyRollingPath;
+
         /**
          * Path used to get latency plots.
          */
         static const QString latencyPlotPath;
 
+        /**
+         * Path used to get latency data in the compact binary export format.
+         */
+        static const QString latencyExportPath;
+
         /**
          * Path used to request operations be paused or resumed.
          */
@@ -181,8 +205,6 @@ class CustomerRestApiV1:public QObject {
          *
          * \param[in] regionDatabaseApi                Class used to manage region data.
          *
-         * \param[in] serverDatabaseApi                Class used to manager server data.
-         *
          * \param[in] eventsDatabaseApi                Class used to access events data.
          *
          * \param[in] eventProcessor                   Class used to report events.
@@ -197,6 +219,14 @@ class CustomerRestApiV1:public QObject {
          *
          * \param[in] serverAdministrator              The server administration instance.
          *
+         * \param[in] responseCompressor               Class used to compress large responses.
+         *
+         * \param[in] catalog                          The catalog used to track customer data versions.
+         *
+         * \param[in] dashboardCache                   Class used to build and cache customer dashboards.
+         *
+         * \param[in] customerRateLimiter              The per-customer rate limiter applied to expensive requests.
+         *
          * \param[in] parent                           Pointer to the parent object.
          */
         CustomerRestApiV1(
@@ -208,7 +238,6 @@ class CustomerRestApiV1:public QObject {
             Monitors*                monitorDatabaseApi,
             MonitorUpdater*          monitorUpdater,
             Regions*                 regionDatabaseApi,
-            Servers*                 serverDatabaseApi,
             Events*                  eventDatabaseApi,
             EventProcessor*          eventProcessor,
             LatencyInterfaceManager* latencyInterfaceManager,
@@ -216,12 +245,51 @@ class CustomerRestApiV1:public QObject {
             Resources*               resourceDatabaseApi,
             ResourcePlotter*         resourcePlotter,
             ServerAdministrator*     ServerAdministrator,
+            ResponseCompressor*      responseCompressor,
+            Catalog*                 catalog,
+            DashboardCache*          dashboardCache,
+            CustomerRateLimiter*     customerRateLimiter,
             QObject*                 parent = nullptr
         );
 
         ~CustomerRestApiV1() override;
 
     private:
+        /**
+         * The rate limiter cost of a v1/multiple/list request.
+         */
+        static const double multipleListCost;
+
+        /**
+         * The rate limiter cost of a v1/latency/list request.
+         */
+        static const double latencyListCost;
+
+        /**
+         * The rate limiter cost of a v1/latency/statistics request.
+         */
+        static const double latencyStatisticsCost;
+
+        /**
+         * The rate limiter cost of a v1/latency/rolling request.
+         */
+        static const double latencyRollingCost;
+
+        /**
+         * The rate limiter cost of a v1/latency/plot request.
+         */
+        static const double latencyPlotCost;
+
+        /**
+         * The rate limiter cost of a v1/latency/export request.
+         */
+        static const double latencyExportCost;
+
+        /**
+         * The rate limiter cost of a v1/resource/plot request.
+         */
+        static const double resourcePlotCost;
+
         /**
          * The v1/capabilities/get handler.
          */
@@ -234,10 +302,13 @@ class CustomerRestApiV1:public QObject {
                  *
                  * \param[in] customerCapabilitiesDatabaseApi Class used to manage customer capabilities in the
                  *                                            database.
+                 *
+                 * \param[in] catalog                         The catalog used to track customer data versions.
                  */
                 CapabilitiesGet(
                     CustomerAuthenticator* customerAuthenticator,
-                    CustomersCapabilities* customerCapabilitiesDatabaseApi
+                    CustomersCapabilities* customerCapabilitiesDatabaseApi,
+                    Catalog*               catalog
                 );
 
                 ~CapabilitiesGet() override;
@@ -269,6 +340,11 @@ class CustomerRestApiV1:public QObject {
                  * The current customer capabilities database API.
                  */
                 CustomersCapabilities* customersCapabilities;
+
+                /**
+                 * The catalog used to track customer data versions.
+                 */
+                Catalog* currentCatalog;
         };
 
         /**
@@ -330,10 +406,13 @@ class CustomerRestApiV1:public QObject {
                  * \param[in] customerAuthenticator Class used to authenticate a customer.
                  *
                  * \param[in] hostSchemeDatabaseApi Class used to manage hosts and schemes.
+                 *
+                 * \param[in] catalog               The catalog used to track customer data versions.
                  */
                 HostsList(
                     CustomerAuthenticator* customerAuthenticator,
-                    HostSchemes*           hostSchemeDatabaseApi
+                    HostSchemes*           hostSchemeDatabaseApi,
+                    Catalog*               catalog
                 );
 
                 ~HostsList() override;
@@ -365,6 +444,11 @@ class CustomerRestApiV1:public QObject {
                  * The current host/scheme database API.
                  */
                 HostSchemes* currentHostSchemes;
+
+                /**
+                 * The catalog used to track customer data versions.
+                 */
+                Catalog* currentCatalog;
         };
 
         /**
@@ -425,11 +509,14 @@ class CustomerRestApiV1:public QObject {
                  * \param[in] monitorDatabaseApi    Class used to manage the customer's monitors.
                  *
                  * \param[in] hostSchemeDatabaseApi Class used to manage hosts and schemes.
+                 *
+                 * \param[in] catalog               The catalog used to track customer data versions.
                  */
                 MonitorsList(
                     CustomerAuthenticator* customerAuthenticator,
                     Monitors*              monitorDatabaseApi,
-                    HostSchemes*           hostSchemeDatabaseApi
+                    HostSchemes*           hostSchemeDatabaseApi,
+                    Catalog*               catalog
                 );
 
                 ~MonitorsList() override;
@@ -466,6 +553,11 @@ class CustomerRestApiV1:public QObject {
                  * The current host/scheme database API.
                  */
                 HostSchemes* currentHostSchemes;
+
+                /**
+                 * The catalog used to track customer data versions.
+                 */
+                Catalog* currentCatalog;
         };
 
         /**
@@ -673,7 +765,7 @@ class CustomerRestApiV1:public QObject {
         /**
          * The v1/events/list handler.
          */
-        class EventsList:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
+        class EventsList:public RestApiInV1::InesonicCustomerBinaryRestHandler, private RestHelpers {
             public:
                 /**
                  * Constructor
@@ -681,10 +773,13 @@ class CustomerRestApiV1:public QObject {
                  * \param[in] customerAuthenticator Class used to authenticate a customer.
                  *
                  * \param[in] eventDatabaseApi      Class used to manage events.
+                 *
+                 * \param[in] responseCompressor    Class used to compress large responses.
                  */
                 EventsList(
                     CustomerAuthenticator* customerAuthenticator,
-                    Events*                eventDatabaseApi
+                    Events*                eventDatabaseApi,
+                    ResponseCompressor*    responseCompressor
                 );
 
                 ~EventsList() override;
@@ -702,9 +797,9 @@ class CustomerRestApiV1:public QObject {
                  *
                  * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
                  *
-                 * \return The response to return, also encoded as a JSON document.
+                 * \return The response to return, serialized as a JSON document and compressed if requested.
                  */
-                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                RestApiInV1::BinaryResponse processAuthenticatedRequest(
                     const QString&       path,
                     unsigned long        customerId,
                     const QJsonDocument& request,
@@ -716,6 +811,11 @@ class CustomerRestApiV1:public QObject {
                  * The current event database API.
                  */
                 Events* currentEvents;
+
+                /**
+                 * The compressor applied to large responses.
+                 */
+                ResponseCompressor* currentResponseCompressor;
         };
 
         /**
@@ -841,10 +941,13 @@ class CustomerRestApiV1:public QObject {
                  * \param[in] customerAuthenticator Class used to authenticate a customer.
                  *
                  * \param[in] eventDatabaseApi      Class used to manage events and status.
+                 *
+                 * \param[in] catalog               The catalog used to track customer data versions.
                  */
                 StatusList(
                     CustomerAuthenticator* customerAuthenticator,
-                    Events*                eventDatabaseApi
+                    Events*                eventDatabaseApi,
+                    Catalog*               catalog
                 );
 
                 ~StatusList() override;
@@ -876,29 +979,113 @@ class CustomerRestApiV1:public QObject {
                  * The current event database API.
                  */
                 Events* currentEvents;
+
+                /**
+                 * The catalog used to track customer data versions.
+                 */
+                Catalog* currentCatalog;
+        };
+
+        /**
+         * The v1/status/wait handler.  The handler holds the request until the customer's monitor status or events
+         * change, or until the requested timeout expires.  This lets clients replace periodic polling of v1/status/list
+         * and v1/events/list with a single outstanding request.
+         */
+        class StatusWait:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
+            public:
+                /**
+                 * The default time to hold a request, in seconds.
+                 */
+                static constexpr unsigned defaultTimeoutSeconds = 20;
+
+                /**
+                 * The longest time a request can be held, in seconds.
+                 */
+                static constexpr unsigned maximumTimeoutSeconds = 60;
+
+                /**
+                 * The maximum number of requests held at one time.  Requests beyond this limit are answered
+                 * immediately so held requests can never starve the server of worker threads.
+                 */
+                static constexpr int maximumNumberWaiters = 32;
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerAuthenticator Class used to authenticate a customer.
+                 *
+                 * \param[in] eventDatabaseApi      Class used to manage events and status.
+                 *
+                 * \param[in] catalog               The catalog used to track customer data versions.
+                 */
+                StatusWait(
+                    CustomerAuthenticator* customerAuthenticator,
+                    Events*                eventDatabaseApi,
+                    Catalog*               catalog
+                );
+
+                ~StatusWait() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path       The request path.
+                 *
+                 * \param[in] customerId The customer Id of the customer making the request.
+                 *
+                 * \param[in] request    The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    unsigned long        customerId,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The current event database API.
+                 */
+                Events* currentEvents;
+
+                /**
+                 * The catalog used to track customer data versions.
+                 */
+                Catalog* currentCatalog;
+
+                /**
+                 * The number of requests currently being held.
+                 */
+                QAtomicInt currentNumberWaiters;
         };
 
         /**
          * The v1/multiple/list handler.
          */
-        class MultipleList:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
+        class MultipleList:public RestApiInV1::InesonicCustomerBinaryRestHandler, private RestHelpers {
             public:
                 /**
                  * Constructor
                  *
                  * \param[in] customerAuthenticator Class used to authenticate a customer.
                  *
-                 * \param[in] hostSchemeDatabaseApi Class used to manage hosts and schemes.
+                 * \param[in] dashboardCache        Class used to build and cache customer dashboards.
                  *
-                 * \param[in] monitorDatabaseApi    Class used to manage the customer's monitors.
+                 * \param[in] responseCompressor    Class used to compress large responses.
                  *
-                 * \param[in] eventDatabaseApi      Class used to manage events and status.
+                 * \param[in] rateLimiter           The per-customer rate limiter.
                  */
                 MultipleList(
                     CustomerAuthenticator* customerAuthenticator,
-                    HostSchemes*           hostSchemeDatabaseApi,
-                    Monitors*              monitorDatabaseApi,
-                    Events*                eventDatabaseApi
+                    DashboardCache*        dashboardCache,
+                    ResponseCompressor*    responseCompressor,
+                    CustomerRateLimiter*   rateLimiter
                 );
 
                 ~MultipleList() override;
@@ -916,9 +1103,9 @@ class CustomerRestApiV1:public QObject {
                  *
                  * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
                  *
-                 * \return The response to return, also encoded as a JSON document.
+                 * \return The response to return, serialized as a JSON document and compressed if requested.
                  */
-                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                RestApiInV1::BinaryResponse processAuthenticatedRequest(
                     const QString&       path,
                     unsigned long        customerId,
                     const QJsonDocument& request,
@@ -927,25 +1114,25 @@ class CustomerRestApiV1:public QObject {
 
             private:
                 /**
-                 * The current host/scheme database API.
+                 * The customer dashboard cache.
                  */
-                HostSchemes* currentHostSchemes;
+                DashboardCache* currentDashboardCache;
 
                 /**
-                 * The current monitors database API.
+                 * The compressor applied to large responses.
                  */
-                Monitors* currentMonitors;
+                ResponseCompressor* currentResponseCompressor;
 
                 /**
-                 * The current event database API.
+                 * The per-customer rate limiter.
                  */
-                Events* currentEvents;
+                CustomerRateLimiter* currentRateLimiter;
         };
 
         /**
          * The v1/latency/list handler.
          */
-        class LatencyList:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
+        class LatencyList:public RestApiInV1::InesonicCustomerBinaryRestHandler, private RestHelpers {
             public:
                 /**
                  * Constructor
@@ -954,12 +1141,18 @@ class CustomerRestApiV1:public QObject {
                  *
                  * \param[in] latencyInterfaceManager The latency interface manager, used to get latency data.
                  *
-                 * \param[in] serverDatabaseApi       Class used to manager server data.
+                 * \param[in] serverAdministrator     Class holding the in-memory server table.
+                 *
+                 * \param[in] responseCompressor      Class used to compress large responses.
+                 *
+                 * \param[in] rateLimiter             The per-customer rate limiter.
                  */
                 LatencyList(
                     CustomerAuthenticator*   customerAuthenticator,
                     LatencyInterfaceManager* latencyInterfaceManager,
-                    Servers*                 serverDatabaseApi
+                    ServerAdministrator*     serverAdministrator,
+                    ResponseCompressor*      responseCompressor,
+                    CustomerRateLimiter*     rateLimiter
                 );
 
                 ~LatencyList() override;
@@ -977,7 +1170,129 @@ class CustomerRestApiV1:public QObject {
                  *
                  * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
                  *
-                 * \return The response to return, also encoded as a JSON document.
+                 * \return The response to return, serialized as a JSON document and compressed if requested.
+                 */
+                RestApiInV1::BinaryResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    unsigned long        customerId,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The current latency database API.
+                 */
+                LatencyInterfaceManager* currentLatencyInterfaceManager;
+
+                /**
+                 * The server administrator, used for its in-memory server snapshot.
+                 */
+                ServerAdministrator* currentServerAdministrator;
+
+                /**
+                 * The compressor applied to large responses.
+                 */
+                ResponseCompressor* currentResponseCompressor;
+
+                /**
+                 * The per-customer rate limiter.
+                 */
+                CustomerRateLimiter* currentRateLimiter;
+        };
+
+        /**
+         * The v1/latency/statistics handler.
+         */
+        class LatencyStatistics:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerAuthenticator   Class used to authenticate a customer.
+                 *
+                 * \param[in] latencyInterfaceManager The latency interface manager, used to get latency data.
+                 *
+                 * \param[in] rateLimiter             The per-customer rate limiter.
+                 */
+                LatencyStatistics(
+                    CustomerAuthenticator*   customerAuthenticator,
+                    LatencyInterfaceManager* latencyInterfaceManager,
+                    CustomerRateLimiter*     rateLimiter
+                );
+
+                ~LatencyStatistics() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path       The request path.
+                 *
+                 * \param[in] customerId The customer Id of the customer making the request.
+                 *
+                 * \param[in] request    The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    unsigned long        customerId,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The current latency database API.
+                 */
+                LatencyInterfaceManager* currentLatencyInterfaceManager;
+
+                /**
+                 * The per-customer rate limiter.
+                 */
+                CustomerRateLimiter* currentRateLimiter;
+        };
+
+        /**
+         * The v1/latency/rolling handler.
+         */
+        class LatencyRolling:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerAuthenticator   Class used to authenticate a customer.
+                 *
+                 * \param[in] latencyInterfaceManager The latency interface manager, used to get latency data.
+                 *
+                 * \param[in] rateLimiter             The per-customer rate limiter.
+                 */
+                LatencyRolling(
+                    CustomerAuthenticator*   customerAuthenticator,
+                    LatencyInterfaceManager* latencyInterfaceManager,
+                    CustomerRateLimiter*     rateLimiter
+                );
+
+                ~LatencyRolling() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path       The request path.
+                 *
+                 * \param[in] customerId The customer Id of the customer making the request.
+                 *
+                 * \param[in] request    The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, encoded as a JSON document.
                  */
                 RestApiInV1::JsonResponse processAuthenticatedRequest(
                     const QString&       path,
@@ -993,9 +1308,9 @@ class CustomerRestApiV1:public QObject {
                 LatencyInterfaceManager* currentLatencyInterfaceManager;
 
                 /**
-                 * The current servers database API.
+                 * The per-customer rate limiter.
                  */
-                Servers* currentServers;
+                CustomerRateLimiter* currentRateLimiter;
         };
 
         /**
@@ -1009,8 +1324,14 @@ class CustomerRestApiV1:public QObject {
                  * \param[in] customerAuthenticator Class used to authenticate a customer.
                  *
                  * \param[in] latencyPlotter        The plotter used to generate latency plots.
+                 *
+                 * \param[in] rateLimiter           The per-customer rate limiter.
                  */
-                LatencyPlot(CustomerAuthenticator* customerAuthenticator, LatencyPlotter* latencyPlotter);
+                LatencyPlot(
+                    CustomerAuthenticator* customerAuthenticator,
+                    LatencyPlotter*        latencyPlotter,
+                    CustomerRateLimiter*   rateLimiter
+                );
 
                 ~LatencyPlot() override;
 
@@ -1041,6 +1362,84 @@ class CustomerRestApiV1:public QObject {
                  * The current latency plotter.
                  */
                 LatencyPlotter* currentLatencyPlotter;
+
+                /**
+                 * The per-customer rate limiter.
+                 */
+                CustomerRateLimiter* currentRateLimiter;
+        };
+
+        /**
+         * The v1/latency/export handler.
+         */
+        class LatencyExport:public RestApiInV1::InesonicCustomerBinaryRestHandler, private RestHelpers {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerAuthenticator   Class used to authenticate a customer.
+                 *
+                 * \param[in] latencyInterfaceManager The latency interface manager, used to get latency data.
+                 *
+                 * \param[in] serverAdministrator     Class holding the in-memory server table.
+                 *
+                 * \param[in] responseCompressor      Class used to compress large responses.
+                 *
+                 * \param[in] rateLimiter             The per-customer rate limiter.
+                 */
+                LatencyExport(
+                    CustomerAuthenticator*   customerAuthenticator,
+                    LatencyInterfaceManager* latencyInterfaceManager,
+                    ServerAdministrator*     serverAdministrator,
+                    ResponseCompressor*      responseCompressor,
+                    CustomerRateLimiter*     rateLimiter
+                );
+
+                ~LatencyExport() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path       The request path.
+                 *
+                 * \param[in] customerId The customer Id of the customer making the request.
+                 *
+                 * \param[in] request    The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId   The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, encoded in the format described by
+                 *         \ref RestHelpers::convertToBinary.  Errors are reported as a JSON document.
+                 */
+                RestApiInV1::BinaryResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    unsigned long        customerId,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The current latency database API.
+                 */
+                LatencyInterfaceManager* currentLatencyInterfaceManager;
+
+                /**
+                 * The server administrator, used for its in-memory server snapshot.
+                 */
+                ServerAdministrator* currentServerAdministrator;
+
+                /**
+                 * The compressor applied to large responses.
+                 */
+                ResponseCompressor* currentResponseCompressor;
+
+                /**
+                 * The per-customer rate limiter.
+                 */
+                CustomerRateLimiter* currentRateLimiter;
         };
 
         /**
@@ -1137,7 +1536,8 @@ class CustomerRestApiV1:public QObject {
         };
 
         /**
-         * The v1/resource/create handler.
+         * The v1/resource/create handler.  The request holds either a single entry or an "entries" array of entries.
+         * Entries are queued and written to the database in bulk.
          */
         class ResourceCreate:public RestApiInV1::InesonicCustomerRestHandler, private RestHelpers {
             public:
@@ -1175,6 +1575,29 @@ class CustomerRestApiV1:public QObject {
                 ) override;
 
             private:
+                /**
+                 * Value indicating the maximum number of entries that can be supplied in a single request.
+                 */
+                static constexpr unsigned maximumEntriesPerRequest = 10000;
+
+                /**
+                 * Method that converts a JSON object holding a value, and optional value type and timestamp, to a
+                 * resource entry.
+                 *
+                 * \param[in]  customerId The customer Id of the customer making the request.
+                 *
+                 * \param[in]  object     The JSON object to be converted.
+                 *
+                 * \param[out] resource   The resulting resource entry.
+                 *
+                 * \return Returns an empty string on success.  Returns the failure status on error.
+                 */
+                static QString convertToResource(
+                    unsigned long      customerId,
+                    const QJsonObject& object,
+                    Resource&          resource
+                );
+
                 /**
                  * The current resource database API.
                  */
@@ -1237,8 +1660,14 @@ class CustomerRestApiV1:public QObject {
                  * \param[in] customerAuthenticator Class used to authenticate a customer.
                  *
                  * \param[in] resourcePlotter       The plotter used to generate resource plots.
+                 *
+                 * \param[in] rateLimiter           The per-customer rate limiter.
                  */
-                ResourcePlot(CustomerAuthenticator* customerAuthenticator, ResourcePlotter* resourcePlotter);
+                ResourcePlot(
+                    CustomerAuthenticator* customerAuthenticator,
+                    ResourcePlotter*       resourcePlotter,
+                    CustomerRateLimiter*   rateLimiter
+                );
 
                 ~ResourcePlot() override;
 
@@ -1269,6 +1698,11 @@ class CustomerRestApiV1:public QObject {
                  * The current latency plotter.
                  */
                 ResourcePlotter* currentResourcePlotter;
+
+                /**
+                 * The per-customer rate limiter.
+                 */
+                CustomerRateLimiter* currentRateLimiter;
         };
 
         /**
@@ -1336,6 +1770,11 @@ class CustomerRestApiV1:public QObject {
          */
         StatusList statusList;
 
+        /**
+         * The v1/status/wait handler.
+         */
+        StatusWait statusWait;
+
         /**
          * The v1/multiple/list handler.
          */
@@ -1346,11 +1785,26 @@ class CustomerRestApiV1:public QObject {
          */
         LatencyList latencyList;
 
+        /**
+         * The v1/latency/statistics handler.
+         */
+        LatencyStatistics latencyStatistics;
+
+        /**
+         * The v1/latency/rolling handler.
+         */
+        LatencyRolling latencyRolling;
+
         /**
          * The v1/latency/plot handler.
          */
         LatencyPlot latencyPlot;
 
+        /**
+         * The v1/latency/export handler.
+         */
+        LatencyExport latencyExport;
+
         /**
          * The v1/customer/pause handler.
          */
@@ -28,14 +28,13 @@
 #include <QHash>
 #include <QSqlQuery>
 #include <QLinkedList>
-#include <QMutex>
 
 #include <cstdint>
 #include <inextea.h>
 
 #include "sql_helpers.h"
 #include "customer_secret.h"
-#include "cache.h"
+#include "concurrent_cache.h"
 
 class QTimer;
 class DatabaseManager;
@@ -56,10 +55,11 @@ class DatabaseManager;
  *
  * The encrypted secret contains the 16 byte IV followed by the encrypted secret itself.
  *
- * Note that, for performance reasons, this class maintains an cache of customer secrets with random eviction.
+ * Note that, for performance reasons, this class maintains a sharded, thread safe cache of customer secrets with
+ * random eviction.
  */
 class CustomerSecrets:public QObject,
-                      public Cache<CustomerSecret, CustomerSecret::CustomerId>,
+                      public ConcurrentCache<CustomerSecret, CustomerSecret::CustomerId>,
                       private SqlHelpers {
     Q_OBJECT
 
@@ -74,6 +74,11 @@ class CustomerSecrets:public QObject,
          */
         static constexpr unsigned defaultCacheDepth = 10000;
 
+        /**
+         * The table name used for cache invalidation notifications.
+         */
+        static const char invalidationTable[];
+
         /**
          * Constructor
          *
@@ -105,18 +110,28 @@ class CustomerSecrets:public QObject,
         void setEncryptionKeys(const QByteArray& newKeys);
 
         /**
-         * Method you can use to change the XTEA customer identifier key on the fly.
+         * Method you can use to change the XTEA customer identifier key on the fly.  Cached customer identifier
+         * mappings are discarded if the key changes.
          *
          * \param[in] newKeys  The new customer identifier key.
          */
         void setCustomerIdentifierKey(const QByteArray& newKeys);
 
+        /**
+         * Method that resizes the customer secrets cache and the customer identifier cache.  Existing entries are
+         * retained.
+         *
+         * \param[in] newCacheSize The new cache size.
+         */
+        void resizeCache(unsigned long newCacheSize);
+
         /**
          * Method you can use to get a customer secret for a customer.
          *
          * \param[in] customerId    The ID of the customer to get the secret for.
          *
-         * \param[in] noCacheUpdate If true, then reading this value will not change the cache state.
+         * \param[in] noCacheUpdate If true, then reading this value will not change the cache state and the
+         *                          database is always checked on a cache miss, ignoring negative cache entries.
          *
          * \param[in] threadId      An optional thread ID used to maintain independent per-thread database instances.
          *
@@ -144,6 +159,20 @@ class CustomerSecrets:public QObject,
          */
         CustomerSecret updateCustomerSecret(CustomerId customerId, unsigned threadId = 0);
 
+        /**
+         * Method you can use to pre-populate the cache with a single streaming query.  Customers currently mapped to
+         * a polling server are loaded first.  Entries already in the cache are left untouched.  The load stops early
+         * if the calling thread is asked to interrupt.
+         *
+         * \param[in] maximumNumberEntries The maximum number of customers to load.
+         *
+         * \param[in] threadId             An optional thread ID used to maintain independent per-thread database
+         *                                 instances.
+         *
+         * \return Returns the number of entries added to the cache.
+         */
+        unsigned long warmCache(unsigned long maximumNumberEntries, unsigned threadId = 0);
+
         /**
          * Method that generates a customer identifier from a customer ID.
          *
@@ -154,7 +183,8 @@ class CustomerSecrets:public QObject,
         std::uint64_t toCustomerIdentifier(CustomerId customerId) const;
 
         /**
-         * Method that generates a customer ID from a customer identifier.
+         * Method that generates a customer ID from a customer identifier.  Results are cached so customers
+         * authenticating repeatedly do not pay for the XTEA decryption on every request.
          *
          * \param[in] customerIdentifier The customer identifier to convert.
          *
@@ -173,6 +203,83 @@ class CustomerSecrets:public QObject,
         CustomerId idFromValue(const CustomerSecret& value) const final;
 
     private:
+        /**
+         * Trivial class that maps a customer identifier to a customer ID.
+         */
+        class IdentifierMapping {
+            public:
+                IdentifierMapping() {
+                    customerIdentifier = 0;
+                    customerId         = CustomerSecret::invalidCustomerId;
+                }
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerIdentifier The customer identifier.
+                 *
+                 * \param[in] customerId         The customer ID tied to the customer identifier.
+                 */
+                IdentifierMapping(std::uint64_t customerIdentifier, CustomerId customerId) {
+                    this->customerIdentifier = customerIdentifier;
+                    this->customerId         = customerId;
+                }
+
+                /**
+                 * The customer identifier.
+                 */
+                std::uint64_t customerIdentifier;
+
+                /**
+                 * The customer ID.
+                 */
+                CustomerId customerId;
+        };
+
+        /**
+         * Class that caches decoded customer identifiers.  The mapping depends only on the customer identifier key so
+         * entries never go stale while the key is unchanged.
+         */
+        class IdentifierCache:public ConcurrentCache<IdentifierMapping, std::uint64_t> {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] maximumCacheDepth The maximum allowed cache depth.
+                 */
+                IdentifierCache(
+                        unsigned long maximumCacheDepth
+                    ):ConcurrentCache<IdentifierMapping, std::uint64_t>(
+                        maximumCacheDepth,
+                        EvictionPolicy::CLOCK
+                    ) {}
+
+                ~IdentifierCache() override {}
+
+            protected:
+                /**
+                 * Method that obtains the ID used to access a specific value.
+                 *
+                 * \param[in] value The value to calculate the ID for.
+                 *
+                 * \return Returns the ID to associate with this value.
+                 */
+                std::uint64_t idFromValue(const IdentifierMapping& value) const final {
+                    return value.customerIdentifier;
+                }
+        };
+
+        /**
+         * Method that decrypts a customer secret read from the database.
+         *
+         * \param[in] customerId      The ID of the customer owning the secret.
+         *
+         * \param[in] encryptedSecret The encrypted secret, including the leading IV.
+         *
+         * \return Returns the decrypted customer secret.
+         */
+        CustomerSecret decryptSecret(CustomerId customerId, const QByteArray& encryptedSecret) const;
+
         /**
          * The underlying database manager instance.
          */
@@ -189,9 +296,9 @@ class CustomerSecrets:public QObject,
         std::uint8_t customerIdentifierKey[16];
 
         /**
-         * Mutex used to protect the cache.
+         * Cache of customer identifier to customer ID mappings.
          */
-        QMutex cacheMutex;
+        mutable IdentifierCache identifierCache;
 };
 
 #endif
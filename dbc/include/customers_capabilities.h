@@ -28,16 +28,16 @@
 #include <QSqlQuery>
 #include <QHash>
 #include <QSet>
-#include <QMutex>
 
 #include <cstdint>
 
 #include "sql_helpers.h"
 #include "customer_capabilities.h"
-#include "cache.h"
+#include "concurrent_cache.h"
 
 class QTimer;
 class DatabaseManager;
+class Catalog;
 
 /**
  * Class used to manage the allowed capabilities by each customer.  This cless expects a table named
@@ -52,9 +52,11 @@ class DatabaseManager;
  *         PRIMARY KEY (customer_id)
  *     ) ENGINE=InnoDB DEFAULT CHARSET=latin1
  *
- * Note that, for performance reasons, this class maintains an cache of customer capabilities with random eviction.
+ * Note that, for performance reasons, this class maintains a sharded, thread safe cache of customer
+ * capabilities with random eviction.
  */
-class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, CustomerCapabilities::CustomerId> {
+class CustomersCapabilities:public QObject,
+                             public ConcurrentCache<CustomerCapabilities, CustomerCapabilities::CustomerId> {
     Q_OBJECT
 
     public:
@@ -78,17 +80,30 @@ class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, C
          */
         static constexpr unsigned defaultCacheDepth = 10000;
 
+        /**
+         * The table name used for cache invalidation notifications.
+         */
+        static const char invalidationTable[];
+
+        /**
+         * The maximum number of rows read or written by a single statement during bulk synchronization.
+         */
+        static const unsigned maximumRowsPerStatement;
+
         /**
          * Constructor
          *
          * \param[in] databaseManager   The database manager used to fetch information about a region.
          *
+         * \param[in] catalog           The in-memory catalog to be updated when customers are deleted.
+         *
          * \param[in] maximumCacheDepth The maximum allowed cache depth.
          *
          * \param[in] parent            Pointer to the parent object.
          */
         CustomersCapabilities(
             DatabaseManager*  databaseManager,
+            Catalog*          catalog,
             unsigned          maximumCacheDepth = defaultCacheDepth,
             QObject*          parent = nullptr
         );
@@ -100,7 +115,8 @@ class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, C
          *
          * \param[in] customerId    The ID of the customer to get the capabilities for.
          *
-         * \param[in] noCacheUpdate If true, then reading this value will not change the cache state.
+         * \param[in] noCacheUpdate If true, then reading this value will not change the cache state and the
+         *                          database is always checked on a cache miss, ignoring negative cache entries.
          *
          * \param[in] threadId      An optional thread ID used to maintain independent per-thread database instances.
          *
@@ -112,6 +128,18 @@ class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, C
             unsigned   threadId = 0
         );
 
+        /**
+         * Method you can use to get the capabilities for a collection of customers.  Cached entries are used where
+         * available.  The remaining entries are read with a single query and added to the cache.
+         *
+         * \param[in] customerIds The IDs of the customers to get the capabilities for.
+         *
+         * \param[in] threadId    An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the customer capabilities by customer ID.  Customers with no capabilities are omitted.
+         */
+        CapabilitiesByCustomerId getCustomerCapabilities(const CustomerIdSet& customerIds, unsigned threadId = 0);
+
         /**
          * Method you can use to delete a customer capabilities.
          *
@@ -149,6 +177,28 @@ class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, C
             unsigned                    threadId = 0
         );
 
+        /**
+         * Method you can use to bring the stored capabilities for a collection of customers in line with a supplied
+         * set of capabilities.  The stored entries are read in bulk and only new or changed entries are written,
+         * within a single transaction.  The paused state of existing customers is preserved and customers that are
+         * not supplied are left untouched.
+         *
+         * \param[in]  customerCapabilities The desired capabilities by customer ID.
+         *
+         * \param[out] changedCapabilities  An optional pointer to a hash populated with the entries that were
+         *                                  added or changed, as written.
+         *
+         * \param[in]  threadId             An optional thread ID used to maintain independent per-thread database
+         *                                  instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool synchronizeCustomerCapabilities(
+            const CapabilitiesByCustomerId& customerCapabilities,
+            CapabilitiesByCustomerId*       changedCapabilities = nullptr,
+            unsigned                        threadId = 0
+        );
+
         /**
          * Method you can use to get all the capabilities for every customer.
          *
@@ -158,6 +208,20 @@ class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, C
          */
         CapabilitiesByCustomerId getAllCustomerCapabilities(unsigned threadId = 0);
 
+        /**
+         * Method you can use to pre-populate the cache with a single streaming query.  Customers currently mapped to
+         * a polling server are loaded first.  Entries already in the cache are left untouched.  The load stops early
+         * if the calling thread is asked to interrupt.
+         *
+         * \param[in] maximumNumberEntries The maximum number of customers to load.
+         *
+         * \param[in] threadId             An optional thread ID used to maintain independent per-thread database
+         *                                 instances.
+         *
+         * \return Returns the number of entries added to the cache.
+         */
+        unsigned long warmCache(unsigned long maximumNumberEntries, unsigned threadId = 0);
+
     protected:
         /**
          * Method that obtains the ID used to access a specific value.
@@ -175,9 +239,9 @@ class CustomersCapabilities:public QObject, public Cache<CustomerCapabilities, C
         DatabaseManager* currentDatabaseManager;
 
         /**
-         * Mutex used to protect the cache.
+         * The in-memory catalog of monitors and host/schemes.
          */
-        QMutex cacheMutex;
+        Catalog* currentCatalog;
 };
 
 #endif
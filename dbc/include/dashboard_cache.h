@@ -0,0 +1,266 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref DashboardCache class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef DASHBOARD_CACHE_H
+#define DASHBOARD_CACHE_H
+
+#include <QByteArray>
+#include <QAtomicInteger>
+
+#include "concurrent_cache.h"
+#include "customer_capabilities.h"
+#include "rest_helpers.h"
+
+class HostSchemes;
+class Monitors;
+class Events;
+class Catalog;
+class LatencyRollingStatistics;
+
+/**
+ * Class that holds a serialized dashboard for each recently viewed customer.  A dashboard holds the customer's
+ * host/schemes, monitors, events and monitor status.  Each dashboard is tagged with the customer data version reported
+ * by the \ref Catalog so a dashboard is rebuilt only after the customer's monitors, host/schemes, events or status
+ * change.  This class is thread safe.
+ */
+class DashboardCache:private RestHelpers {
+    public:
+        /**
+         * Type used to represent a customer ID.
+         */
+        typedef CustomerCapabilities::CustomerId CustomerId;
+
+        /**
+         * The default maximum number of cached dashboards.
+         */
+        static constexpr unsigned long defaultCacheDepth = 1024;
+
+        /**
+         * The default event window, in days.  A value of zero includes every event.
+         */
+        static constexpr unsigned defaultEventWindowDays = 0;
+
+        /**
+         * Constructor
+         *
+         * \param[in] hostSchemeDatabaseApi Class used to manage hosts and schemes.
+         *
+         * \param[in] monitorDatabaseApi    Class used to manage the customer's monitors.
+         *
+         * \param[in] eventDatabaseApi      Class used to manage events and status.
+         *
+         * \param[in] catalog               The catalog used to track customer data versions.
+         *
+         * \param[in] rollingStatistics     The rolling latency statistics added to each dashboard.  A null pointer
+         *                                  excludes rolling latency statistics.
+         *
+         * \param[in] maximumCacheDepth     The maximum number of cached dashboards.
+         */
+        DashboardCache(
+            HostSchemes*              hostSchemeDatabaseApi,
+            Monitors*                 monitorDatabaseApi,
+            Events*                   eventDatabaseApi,
+            Catalog*                  catalog,
+            LatencyRollingStatistics* rollingStatistics = nullptr,
+            unsigned long             maximumCacheDepth = defaultCacheDepth
+        );
+
+        ~DashboardCache();
+
+        /**
+         * Method you can use to change the maximum number of cached dashboards.
+         *
+         * \param[in] newCacheSize The new maximum number of cached dashboards.  A value of zero disables the cache.
+         */
+        void resizeCache(unsigned long newCacheSize);
+
+        /**
+         * Method you can use to obtain the dashboard cache statistics.
+         *
+         * \return Returns the cache statistics, summed across all shards.
+         */
+        CacheBase::Statistics statistics() const;
+
+        /**
+         * Method you can use to limit the events included in a dashboard to a recent time window.  The window is
+         * applied when a dashboard is built so a cached dashboard may hold events that have since left the window
+         * until the customer's data next changes.
+         *
+         * \param[in] eventWindowDays The new event window, in days.  A value of zero includes every event.
+         */
+        void setEventWindow(unsigned eventWindowDays);
+
+        /**
+         * Method you can use to obtain the current event window.
+         *
+         * \return Returns the current event window, in days.
+         */
+        unsigned eventWindow() const;
+
+        /**
+         * Method you can use to obtain a customer's dashboard.  The cached dashboard is returned if it is current,
+         * otherwise the dashboard is rebuilt from the database and cached.  Rolling latency statistics, when enabled,
+         * change continuously so they're read from memory and added to every response rather than cached.
+         *
+         * \param[in] customerId The ID of the customer of interest.
+         *
+         * \param[in] threadId   An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the dashboard as a compact, UTF-8 encoded JSON document.
+         */
+        QByteArray dashboard(CustomerId customerId, unsigned threadId = 0);
+
+    private:
+        /**
+         * Trivial class holding a single serialized dashboard.
+         */
+        class Dashboard {
+            public:
+                Dashboard() {
+                    customerId  = 0;
+                    dataVersion = 0;
+                }
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerId  The ID of the customer this dashboard belongs to.
+                 *
+                 * \param[in] dataVersion The customer data version the dashboard was built from.
+                 *
+                 * \param[in] jsonData    The serialized dashboard.
+                 */
+                Dashboard(CustomerId customerId, unsigned long long dataVersion, const QByteArray& jsonData) {
+                    this->customerId  = customerId;
+                    this->dataVersion = dataVersion;
+                    this->jsonData    = jsonData;
+                }
+
+                /**
+                 * The ID of the customer this dashboard belongs to.
+                 */
+                CustomerId customerId;
+
+                /**
+                 * The customer data version the dashboard was built from.
+                 */
+                unsigned long long dataVersion;
+
+                /**
+                 * The serialized dashboard.
+                 */
+                QByteArray jsonData;
+        };
+
+        /**
+         * Method that builds a dashboard from the database.
+         *
+         * \param[in] customerId The ID of the customer of interest.
+         *
+         * \param[in] threadId   The thread ID used to obtain a database instance.
+         *
+         * \return Returns the dashboard as a compact, UTF-8 encoded JSON document.
+         */
+        QByteArray buildDashboard(CustomerId customerId, unsigned threadId) const;
+
+        /**
+         * Method that adds the customer's rolling latency statistics to a serialized dashboard.
+         *
+         * \param[in] dashboard  The serialized dashboard.
+         *
+         * \param[in] customerId The ID of the customer of interest.
+         *
+         * \param[in] threadId   The thread ID used to obtain the catalog snapshot.
+         *
+         * \return Returns the dashboard with a "latency_rolling" member holding the statistics of each monitor.
+         */
+        QByteArray addRollingStatistics(const QByteArray& dashboard, CustomerId customerId, unsigned threadId) const;
+
+        /**
+         * Class that holds the serialized dashboards.
+         */
+        class EntryCache:public ConcurrentCache<Dashboard, CustomerId> {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] maximumCacheDepth The maximum allowed cache depth.
+                 */
+                EntryCache(
+                        unsigned long maximumCacheDepth
+                    ):ConcurrentCache<Dashboard, CustomerId>(
+                        maximumCacheDepth,
+                        EvictionPolicy::CLOCK
+                    ) {}
+
+                ~EntryCache() override {}
+
+            protected:
+                /**
+                 * Method that obtains the ID used to access a specific value.
+                 *
+                 * \param[in] value The value to calculate the ID for.
+                 *
+                 * \return Returns the ID to associate with this value.
+                 */
+                CustomerId idFromValue(const Dashboard& value) const final {
+                    return value.customerId;
+                }
+        };
+
+        /**
+         * The current host/scheme database API.
+         */
+        HostSchemes* currentHostSchemes;
+
+        /**
+         * The current monitors database API.
+         */
+        Monitors* currentMonitors;
+
+        /**
+         * The current event database API.
+         */
+        Events* currentEvents;
+
+        /**
+         * The catalog used to track customer data versions.
+         */
+        Catalog* currentCatalog;
+
+        /**
+         * The rolling latency statistics added to each dashboard.
+         */
+        LatencyRollingStatistics* currentRollingStatistics;
+
+        /**
+         * The current event window, in days.
+         */
+        QAtomicInteger<unsigned> currentEventWindowDays;
+
+        /**
+         * The cached dashboards.
+         */
+        mutable EntryCache entryCache;
+};
+
+#endif
@@ -26,14 +26,38 @@
 #include <QObject>
 #include <QAtomicInteger>
 #include <QString>
+#include <QStringList>
 #include <QByteArray>
+#include <QHash>
+#include <QList>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
 #include <QSqlDatabase>
+#include <QSqlQuery>
+
+#include "metrics_registry.h"
+
+class QTimer;
+class QThread;
 
 /**
- * A database manager API you can use to create database connection instances.
+ * A database manager API you can use to create database connection instances.  Connections are pooled.  A connection
+ * is tied to both the supplied instance name and to the calling thread so repeated requests from the same thread
+ * with the same instance name will reuse an already open connection.  Connections that have been idle for some time
+ * are health-checked before reuse and connections idle beyond the configured idle timeout are reaped.
+ *
+ * Each pooled connection also keeps a cache of prepared statements, keyed by statement text, so frequently used
+ * statements are parsed and planned by the server once per connection rather than once per call.
+ *
+ * Read only work that can tolerate slightly stale data can be routed to optional read replicas using
+ * \ref DatabaseManager::getReadDatabase.  Replicas are used in rotation.  A replica whose replication lag exceeds the
+ * configured limit, or that can not be reached, is skipped until its next lag check.  The primary is used when no
+ * replica is usable.
  */
 class DatabaseManager:public QObject {
+    Q_OBJECT
+
     public:
         /**
          * The default database driver.
@@ -45,13 +69,222 @@ class DatabaseManager:public QObject {
          */
         static const unsigned short defaultDatabasePort;
 
+        /**
+         * The default minimum number of connections to retain in the pool.
+         */
+        static const unsigned defaultMinimumPoolSize;
+
+        /**
+         * The default maximum number of simultaneously open pooled connections.
+         */
+        static const unsigned defaultMaximumPoolSize;
+
+        /**
+         * The default time, in seconds, an idle connection is retained before being reaped.
+         */
+        static const unsigned defaultIdleTimeoutSeconds;
+
+        /**
+         * The default idle time, in seconds, after which a connection is health-checked before being reused.
+         */
+        static const unsigned defaultHealthCheckIntervalSeconds;
+
+        /**
+         * The default maximum time, in milliseconds, we will wait for a free pool slot.
+         */
+        static const unsigned defaultMaximumAcquireWaitMilliseconds;
+
+        /**
+         * The maximum number of prepared statements cached per connection.  The cache is flushed when this limit is
+         * reached.
+         */
+        static const unsigned maximumPreparedStatementsPerConnection;
+
+        /**
+         * The default maximum replication lag, in seconds, tolerated before a read replica is skipped.
+         */
+        static const unsigned defaultMaximumReplicaLagSeconds;
+
+        /**
+         * Class that holds a snapshot of the pool statistics.
+         */
+        class Statistics {
+            public:
+                constexpr Statistics():
+                    currentNumberOpenConnections(0),
+                    currentNumberIdleConnections(0),
+                    currentNumberAcquisitions(0),
+                    currentNumberWaits(0),
+                    currentNumberTimeouts(0),
+                    currentNumberHealthCheckFailures(0),
+                    currentNumberReapedConnections(0),
+                    currentTotalAcquireWaitMicroseconds(0),
+                    currentMaximumAcquireWaitMicroseconds(0) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] numberOpenConnections          The number of open pooled connections.
+                 *
+                 * \param[in] numberIdleConnections          The number of open pooled connections not in use.
+                 *
+                 * \param[in] numberAcquisitions             The number of connections handed out by the pool.
+                 *
+                 * \param[in] numberWaits                    The number of acquisitions that had to wait for a slot.
+                 *
+                 * \param[in] numberTimeouts                 The number of acquisitions that timed out.
+                 *
+                 * \param[in] numberHealthCheckFailures      The number of pooled connections that failed a health
+                 *                                           check and were reopened.
+                 *
+                 * \param[in] numberReapedConnections        The number of idle connections closed by the pool.
+                 *
+                 * \param[in] totalAcquireWaitMicroseconds   The total time spent waiting for pool slots.
+                 *
+                 * \param[in] maximumAcquireWaitMicroseconds The longest time spent waiting for a pool slot.
+                 */
+                constexpr Statistics(
+                        unsigned           numberOpenConnections,
+                        unsigned           numberIdleConnections,
+                        unsigned long long numberAcquisitions,
+                        unsigned long long numberWaits,
+                        unsigned long long numberTimeouts,
+                        unsigned long long numberHealthCheckFailures,
+                        unsigned long long numberReapedConnections,
+                        unsigned long long totalAcquireWaitMicroseconds,
+                        unsigned long long maximumAcquireWaitMicroseconds
+                    ):currentNumberOpenConnections(
+                        numberOpenConnections
+                    ),currentNumberIdleConnections(
+                        numberIdleConnections
+                    ),currentNumberAcquisitions(
+                        numberAcquisitions
+                    ),currentNumberWaits(
+                        numberWaits
+                    ),currentNumberTimeouts(
+                        numberTimeouts
+                    ),currentNumberHealthCheckFailures(
+                        numberHealthCheckFailures
+                    ),currentNumberReapedConnections(
+                        numberReapedConnections
+                    ),currentTotalAcquireWaitMicroseconds(
+                        totalAcquireWaitMicroseconds
+                    ),currentMaximumAcquireWaitMicroseconds(
+                        maximumAcquireWaitMicroseconds
+                    ) {}
+
+                /**
+                 * Method you can use to obtain the number of open pooled connections.
+                 *
+                 * \return Returns the number of open pooled connections.
+                 */
+                inline unsigned numberOpenConnections() const {
+                    return currentNumberOpenConnections;
+                }
+
+                /**
+                 * Method you can use to obtain the number of open, idle, pooled connections.
+                 *
+                 * \return Returns the number of idle pooled connections.
+                 */
+                inline unsigned numberIdleConnections() const {
+                    return currentNumberIdleConnections;
+                }
+
+                /**
+                 * Method you can use to obtain the number of connections handed out by the pool.
+                 *
+                 * \return Returns the number of acquisitions.
+                 */
+                inline unsigned long long numberAcquisitions() const {
+                    return currentNumberAcquisitions;
+                }
+
+                /**
+                 * Method you can use to obtain the number of acquisitions that had to wait for a free slot.
+                 *
+                 * \return Returns the number of waits.
+                 */
+                inline unsigned long long numberWaits() const {
+                    return currentNumberWaits;
+                }
+
+                /**
+                 * Method you can use to obtain the number of acquisitions that timed out waiting for a free slot.
+                 *
+                 * \return Returns the number of timeouts.
+                 */
+                inline unsigned long long numberTimeouts() const {
+                    return currentNumberTimeouts;
+                }
+
+                /**
+                 * Method you can use to obtain the number of failed health checks.
+                 *
+                 * \return Returns the number of failed health checks.
+                 */
+                inline unsigned long long numberHealthCheckFailures() const {
+                    return currentNumberHealthCheckFailures;
+                }
+
+                /**
+                 * Method you can use to obtain the number of connections reaped or evicted by the pool.
+                 *
+                 * \return Returns the number of reaped connections.
+                 */
+                inline unsigned long long numberReapedConnections() const {
+                    return currentNumberReapedConnections;
+                }
+
+                /**
+                 * Method you can use to obtain the total time spent waiting for pool slots.
+                 *
+                 * \return Returns the total acquire wait time, in microseconds.
+                 */
+                inline unsigned long long totalAcquireWaitMicroseconds() const {
+                    return currentTotalAcquireWaitMicroseconds;
+                }
+
+                /**
+                 * Method you can use to obtain the longest time spent waiting for a pool slot.
+                 *
+                 * \return Returns the maximum acquire wait time, in microseconds.
+                 */
+                inline unsigned long long maximumAcquireWaitMicroseconds() const {
+                    return currentMaximumAcquireWaitMicroseconds;
+                }
+
+                /**
+                 * Method you can use to obtain the average acquire wait time across all acquisitions.
+                 *
+                 * \return Returns the average acquire wait time, in microseconds.
+                 */
+                inline double averageAcquireWaitMicroseconds() const {
+                    return   currentNumberAcquisitions > 0
+                           ? static_cast<double>(currentTotalAcquireWaitMicroseconds) / currentNumberAcquisitions
+                           : 0.0;
+                }
+
+            private:
+                unsigned           currentNumberOpenConnections;
+                unsigned           currentNumberIdleConnections;
+                unsigned long long currentNumberAcquisitions;
+                unsigned long long currentNumberWaits;
+                unsigned long long currentNumberTimeouts;
+                unsigned long long currentNumberHealthCheckFailures;
+                unsigned long long currentNumberReapedConnections;
+                unsigned long long currentTotalAcquireWaitMicroseconds;
+                unsigned long long currentMaximumAcquireWaitMicroseconds;
+        };
+
         DatabaseManager();
 
         ~DatabaseManager() override;
 
         /**
-         * Method you can use to obtain a new database instance.  The database instance will be opened and prepared for
-         * use.
+         * Method you can use to obtain a database instance.  The database instance will be opened and prepared for
+         * use.  An already open pooled connection will be returned if one exists for this instance name and thread.
+         * Every call must be paired with a call to \ref DatabaseManager::closeAndRelease.
          *
          * \param[in] instanceName The name to assign to this instance.
          *
@@ -61,23 +294,66 @@ class DatabaseManager:public QObject {
 
         /**
          * Method you can use to obtain a new database instance.  The database instance will be opened and prepared for
-         * use.  This version will create a new database with a unique instance name.
+         * use.  This version will create a new database with a unique instance name.  The connection is not pooled and
+         * will be closed when released.
          *
          * \return Returns the opened database instance will be closed if an error occurs.
          */
         QSqlDatabase getDatabase();
 
         /**
-         * Method that closes a database, if open, and releases the connection.
+         * Method you can use to obtain a database instance for read only work.  The connection is made to a read
+         * replica, if one is configured and current, and to the primary otherwise.  Data read may lag the primary by
+         * up to the configured maximum replica lag so this method should not be used for reads that must observe
+         * this process's own recent writes.  Every call must be paired with a call to
+         * \ref DatabaseManager::closeAndRelease.
+         *
+         * \param[in] instanceName The name to assign to this instance.
+         *
+         * \return Returns the opened database instance will be closed if an error occurs.
+         */
+        QSqlDatabase getReadDatabase(const QString& instanceName);
+
+        /**
+         * Method that releases a connection back to the pool.  Unpooled connections are closed.
          *
-         * \param[in] database The database to be closed and released.
+         * \param[in] database The database to be closed and released.  The instance will be reset on exit.
          */
         void closeAndRelease(QSqlDatabase& database);
 
+        /**
+         * Method you can use to obtain a prepared query for a statement.  For pooled connections, the prepared query
+         * is cached with the connection and reused on later calls with the same statement text so the statement is
+         * only parsed and planned once per connection.  Unpooled connections receive a newly prepared query.
+         *
+         * Statements should use placeholders, rather than embedded values, so that the statement text stays the same
+         * from call to call.  The returned query shares its state with the cached instance; callers must bind every
+         * placeholder before each execution and must not use the same statement twice at once on one connection.
+         *
+         * \param[in]  database  The database connection returned by 
+ef DatabaseManager::getDatabase.
+         *
+         * \param[in]  statement The statement to be prepared.
+         *
+         * \param[out] success   An optional pointer to a boolean that is set to true on success or false if the
+         *                       statement could not be prepared.
+         *
+         * 
+eturn Returns the prepared, forward only, query.
+         */
+        QSqlQuery preparedQuery(const QSqlDatabase& database, const QString& statement, bool* success = nullptr);
+
+        /**
+         * Method you can use to obtain a snapshot of the pool statistics.
+         *
+         * \return Returns the current pool statistics.
+         */
+        Statistics statistics() const;
+
     public slots:
         /**
          * Slot you can use to set the database connection parameters.  Values will be used for all new database
-         * connections.
+         * connections.  Idle pooled connections using older settings will be reopened on their next use.
          *
          * \param[in] databaseUsername The database username.
          *
@@ -100,16 +376,275 @@ class DatabaseManager:public QObject {
             const QString& databaseDriver = defaultDatabaseDriver
         );
 
+        /**
+         * Slot you can use to set the connection pool parameters.
+         *
+         * \param[in] minimumPoolSize                The minimum number of idle connections the reaper will retain.
+         *
+         * \param[in] maximumPoolSize                The maximum number of simultaneously open pooled connections.
+         *
+         * \param[in] idleTimeoutSeconds             The time an idle connection is retained before being reaped.
+         *
+         * \param[in] healthCheckIntervalSeconds     The idle time after which a connection is checked before reuse.
+         *
+         * \param[in] maximumAcquireWaitMilliseconds The maximum time to wait for a free pool slot.
+         */
+        void setPoolParameters(
+            unsigned minimumPoolSize,
+            unsigned maximumPoolSize,
+            unsigned idleTimeoutSeconds = defaultIdleTimeoutSeconds,
+            unsigned healthCheckIntervalSeconds = defaultHealthCheckIntervalSeconds,
+            unsigned maximumAcquireWaitMilliseconds = defaultMaximumAcquireWaitMilliseconds
+        );
+
+        /**
+         * Slot you can use to set the read replicas.  Replicas share the primary's credentials, database name and
+         * driver.
+         *
+         * \param[in] replicaServers    The replica servers, each as a host name optionally followed by a colon and a
+         *                              port number.  An empty list routes all reads to the primary.
+         *
+         * \param[in] maximumLagSeconds The maximum replication lag, in seconds, before a replica is skipped.
+         */
+        void setReadReplicas(
+            const QStringList& replicaServers,
+            unsigned           maximumLagSeconds = defaultMaximumReplicaLagSeconds
+        );
+
+    private slots:
+        /**
+         * Slot that is triggered periodically to close idle connections.
+         */
+        void reapIdleConnections();
+
     private:
+        /**
+         * Interval, in milliseconds, between idle connection reaping passes.
+         */
+        static const unsigned reapIntervalMilliseconds;
+
+        /**
+         * Interval, in milliseconds, between replication lag checks of each read replica.
+         */
+        static const unsigned replicaLagCheckIntervalMilliseconds;
+
+        /**
+         * Value used to indicate the primary database rather than a read replica.
+         */
+        static const int primaryDatabase;
+
         /**
          * Counter used to create new, unique database instances.
          */
         static QAtomicInteger<unsigned long long> instanceCounter;
 
+        /**
+         * Trivial class used to track a single pooled connection.
+         */
+        class Connection {
+            public:
+                Connection():useCount(0),lastReleaseTime(0),settingsGeneration(0),owningThread(nullptr) {}
+
+                /**
+                 * The underlying database instance.
+                 */
+                QSqlDatabase database;
+
+                /**
+                 * The number of outstanding acquisitions of this connection.
+                 */
+                unsigned useCount;
+
+                /**
+                 * The pool clock time, in milliseconds, when this connection was last released.
+                 */
+                long long lastReleaseTime;
+
+                /**
+                 * The settings generation this connection was opened under.
+                 */
+                unsigned long settingsGeneration;
+
+                /**
+                 * The thread that owns this connection.
+                 */
+                QThread* owningThread;
+
+                /**
+                 * The prepared statements cached with this connection, by statement text.
+                 */
+                QHash<QString, QSqlQuery> preparedStatements;
+        };
+
+        /**
+         * Trivial class used to track a single read replica.
+         */
+        class Replica {
+            public:
+                Replica():port(0),lagging(false),lastLagCheckTime(0) {}
+
+                /**
+                 * The replica server name.
+                 */
+                QString server;
+
+                /**
+                 * The replica port number.
+                 */
+                unsigned short port;
+
+                /**
+                 * Flag indicating if the replica was lagging or unreachable at the last check.
+                 */
+                bool lagging;
+
+                /**
+                 * The pool clock time, in milliseconds, of the last lag check.
+                 */
+                long long lastLagCheckTime;
+        };
+
+        /**
+         * Method that obtains a pooled connection.
+         *
+         * \param[in] name         The per-thread connection name.
+         *
+         * \param[in] replicaIndex The index of the read replica to connect to or \ref primaryDatabase.
+         *
+         * \return Returns the opened database instance will be closed if an error occurs.
+         */
+        QSqlDatabase acquireDatabase(const QString& name, int replicaIndex);
+
+        /**
+         * Method that builds the per-thread connection name for an instance name.
+         *
+         * \param[in] instanceName The caller supplied instance name.
+         *
+         * \return Returns the connection name used for the calling thread.
+         */
+        static QString connectionName(const QString& instanceName);
+
+        /**
+         * Method that opens a database connection using the current settings.
+         *
+         * \param[in] connectionName The connection name to use.
+         *
+         * \param[in] replicaIndex   The index of the read replica to connect to or \ref primaryDatabase.
+         *
+         * \return Returns the database instance.  The instance is closed on error.
+         */
+        QSqlDatabase openDatabase(const QString& connectionName, int replicaIndex = primaryDatabase);
+
+        /**
+         * Method that checks that an open connection is still usable.
+         *
+         * \param[in] database The database to be checked.
+         *
+         * \return Returns true if the connection is usable.  Returns false if the connection is broken.
+         */
+        static bool isHealthy(QSqlDatabase& database);
+
+        /**
+         * Method that checks that a read replica is within the allowed replication lag.
+         *
+         * \param[in] database          The replica connection to be checked.
+         *
+         * \param[in] maximumLagSeconds The maximum allowed lag, in seconds.
+         *
+         * \return Returns true if the replica is current.  Returns false if the replica is lagging or the check failed.
+         */
+        static bool isReplicaCurrent(QSqlDatabase& database, unsigned maximumLagSeconds);
+
+        /**
+         * Method that closes and removes a pooled connection.  The pool mutex must be locked by the caller.
+         *
+         * \param[in] connectionName The connection name of the connection to be removed.
+         */
+        void removeConnection(const QString& connectionName);
+
+        /**
+         * Method that closes the least recently used idle connection to make room in the pool.  The pool mutex must
+         * be locked by the caller.
+         *
+         * \return Returns true if a connection was evicted.  Returns false if no idle connection exists.
+         */
+        bool evictIdleConnection();
+
         /**
          * Mutex used to make certain settings updates occur atomically.
          */
-        QMutex databaseMutex;
+        mutable QMutex databaseMutex;
+
+        /**
+         * Mutex used to guard the connection pool.  This mutex is never held while connecting to the database.
+         */
+        mutable QMutex poolMutex;
+
+        /**
+         * Wait condition used to signal that a pool slot may have become available.
+         */
+        QWaitCondition poolSlotAvailable;
+
+        /**
+         * Monotonic clock used for idle and wait time measurements.
+         */
+        QElapsedTimer poolClock;
+
+        /**
+         * Timer used to trigger idle connection reaping.
+         */
+        QTimer* reapTimer;
+
+        /**
+         * The pooled connections, by connection name.
+         */
+        QHash<QString, Connection> connections;
+
+        /**
+         * The number of pooled connections that are open or being opened.
+         */
+        unsigned currentNumberOpenConnections;
+
+        /**
+         * The current settings generation.  Incremented each time the connection settings change.
+         */
+        unsigned long currentSettingsGeneration;
+
+        /**
+         * The current minimum pool size.
+         */
+        unsigned currentMinimumPoolSize;
+
+        /**
+         * The current maximum pool size.
+         */
+        unsigned currentMaximumPoolSize;
+
+        /**
+         * The current idle timeout, in milliseconds.
+         */
+        long long currentIdleTimeoutMilliseconds;
+
+        /**
+         * The current health check interval, in milliseconds.
+         */
+        long long currentHealthCheckIntervalMilliseconds;
+
+        /**
+         * The current maximum acquire wait time, in milliseconds.
+         */
+        unsigned long currentMaximumAcquireWaitMilliseconds;
+
+        /**
+         * The accumulated pool statistics.
+         */
+        unsigned long long currentNumberAcquisitions;
+        unsigned long long currentNumberWaits;
+        unsigned long long currentNumberTimeouts;
+        unsigned long long currentNumberHealthCheckFailures;
+        unsigned long long currentNumberReapedConnections;
+        unsigned long long currentTotalAcquireWaitMicroseconds;
+        unsigned long long currentMaximumAcquireWaitMicroseconds;
 
         /**
          * The current database username.
@@ -140,6 +675,26 @@ class DatabaseManager:public QObject {
          * The current database driver.
          */
         QString currentDatabaseDriver;
+
+        /**
+         * The read replicas.  Guarded by the database mutex.
+         */
+        QList<Replica> replicas;
+
+        /**
+         * The current maximum replication lag, in seconds.
+         */
+        unsigned currentMaximumReplicaLagSeconds;
+
+        /**
+         * Counter used to rotate reads across the replicas.
+         */
+        QAtomicInteger<unsigned> nextReplica;
+
+        /**
+         * Histogram tracking the time needed to acquire a connection.
+         */
+        MetricsRegistry::Histogram* acquireMetric;
 };
 
 #endif
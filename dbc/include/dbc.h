@@ -25,10 +25,18 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QJsonObject>
 #include <QByteArray>
 #include <QList>
+#include <QPair>
 #include <QFileSystemWatcher>
 
+#include <functional>
+
+#include "cache_base.h"
+#include "metrics_registry.h"
+
 namespace RestApiInV1 {
     class Server;
     class TimeDeltaHandler;
@@ -37,18 +45,28 @@ namespace RestApiInV1 {
 class QNetworkAccessManager;
 
 class DatabaseManager;
+class IdRegistry;
+class Catalog;
 class LatencyInterfaceManager;
+class PlotWorkerPool;
 class LatencyPlotter;
 class ResourcePlotter;
+class ResponseCompressor;
+class DashboardCache;
+class CustomerRateLimiter;
 class Regions;
 class Servers;
 class ServerAdministrator;
 class CustomerSecrets;
 class CustomersCapabilities;
+class CacheWarmer;
+class WarmStart;
+class QueryPlanChecker;
 class HostSchemes;
 class Monitors;
 class Events;
 class CustomerMapping;
+class ShardMap;
 class Resources;
 
 class RegionManager;
@@ -61,6 +79,9 @@ class CustomerMappingManager;
 class LatencyManager;
 class MultipleManager;
 class ResourceManager;
+class JobScheduler;
+class JobManager;
+class MetricsManager;
 class CustomerAuthenticator;
 class CustomerRestApiV1;
 class OutboundRestApi;
@@ -83,9 +104,14 @@ class DbC:public QObject {
          *                                  Note that this file will be monitored for updates so it can be changed
          *                                  while the application is running.
          *
+         * \param[in] relayMode             If true, the controller runs as a regional latency ingest relay.  Relays
+         *                                  accept latency posts from nearby polling servers and write them to the
+         *                                  shared database.  The customer and administrative REST APIs are not
+         *                                  served and aggregation is left to the central controller.
+         *
          * \param[in] parent                Pointer to the parent object.
          */
-        DbC(const QString& configurationFilename, QObject* parent = nullptr);
+        DbC(const QString& configurationFilename, bool relayMode = false, QObject* parent = nullptr);
 
         ~DbC() override;
 
@@ -103,6 +129,64 @@ class DbC:public QObject {
          */
         static constexpr unsigned keyLength = 56;
 
+        /**
+         * Configuration settings that are only applied at startup.  Changes to these settings are reported on reload
+         * but take effect after a restart.
+         */
+        static const QStringList restartRequiredSettings;
+
+        /**
+         * Method that determines if any of a list of configuration settings differ from the applied configuration.
+         * Every setting is reported as changed until a configuration has been applied.
+         *
+         * \param[in] configuration The newly read configuration.
+         *
+         * \param[in] settings      The names of the settings of interest.
+         *
+         * \return Returns true if any of the settings changed.
+         */
+        bool settingsChanged(const QJsonObject& configuration, const QStringList& settings) const;
+
+        /**
+         * Method that adds a series sampled from another class when the metrics are rendered.  The series is removed
+         * when this class is destroyed.
+         *
+         * \param[in] type    The metric type.
+         *
+         * \param[in] name    The metric family name.
+         *
+         * \param[in] help    The metric family description.
+         *
+         * \param[in] labels  The series labels.
+         *
+         * \param[in] sampler The function used to sample the value.
+         */
+        void addSampledMetric(
+            MetricsRegistry::Type           type,
+            const QString&                  name,
+            const QString&                  help,
+            const QString&                  labels,
+            const MetricsRegistry::Sampler& sampler
+        );
+
+        /**
+         * Method that exports the statistics of a cache as metrics.
+         *
+         * \param[in] cacheName  The name used to identify the cache.
+         *
+         * \param[in] statistics Function used to obtain the cache statistics.
+         */
+        void addCacheMetrics(const QString& cacheName, const std::function<CacheBase::Statistics()>& statistics);
+
+        /**
+         * Method that reads a memory usage value for this process from /proc/self/status.
+         *
+         * \param[in] field The name of the field to read, for example "VmRSS".
+         *
+         * \return Returns the value in bytes.  A value of 0 is returned if the value could not be read.
+         */
+        static double processMemoryBytes(const QByteArray& field);
+
         /**
          * The filesystem watcher used to monitor the configuration file.
          */
@@ -113,6 +197,21 @@ class DbC:public QObject {
          */
         QString currentConfigurationFilename;
 
+        /**
+         * The most recently applied configuration.  Used to determine which subsystems a reload needs to touch.
+         */
+        QJsonObject appliedConfiguration;
+
+        /**
+         * Flag indicating that a configuration has been applied.
+         */
+        bool configurationApplied;
+
+        /**
+         * Flag indicating if this controller is running as a regional latency ingest relay.
+         */
+        bool currentRelayMode;
+
         /**
          * Flag indicating if verbose reporting should be used.
          */
@@ -133,6 +232,16 @@ class DbC:public QObject {
          */
         DatabaseManager* databaseManager;
 
+        /**
+         * Registry of valid monitor and server IDs.
+         */
+        IdRegistry* currentIdRegistry;
+
+        /**
+         * The in-memory catalog of monitors and host/schemes.
+         */
+        Catalog* currentCatalog;
+
         /**
          * Interface to obtain and update regions data.
          */
@@ -163,6 +272,21 @@ class DbC:public QObject {
          */
         CustomersCapabilities* currentCustomersCapabilities;
 
+        /**
+         * Background thread used to pre-populate the customer caches at startup.
+         */
+        CacheWarmer* currentCacheWarmer;
+
+        /**
+         * Background thread used to restore, reconcile and save the catalog snapshot.
+         */
+        WarmStart* currentWarmStart;
+
+        /**
+         * Background thread used to verify the query plans of the hot queries at startup.
+         */
+        QueryPlanChecker* currentQueryPlanChecker;
+
         /**
          * Interface used to obtain and record events.
          */
@@ -178,6 +302,11 @@ class DbC:public QObject {
          */
         CustomerMapping* currentCustomerMapping;
 
+        /**
+         * The map of customers to database controller shards.
+         */
+        ShardMap* currentShardMap;
+
         /**
          * The internal REST API used to obtain and modify regions.
          */
@@ -228,6 +357,26 @@ class DbC:public QObject {
          */
         ResourceManager* currentResourceManager;
 
+        /**
+         * The scheduler used to run long admin operations in the background.
+         */
+        JobScheduler* currentJobScheduler;
+
+        /**
+         * The internal REST API used to track and cancel background jobs.
+         */
+        JobManager* currentJobManager;
+
+        /**
+         * The internal REST API used to report metrics.
+         */
+        MetricsManager* currentMetricsManager;
+
+        /**
+         * The names and labels of the sampled metrics we added.
+         */
+        QList<QPair<QString, QString>> sampledMetrics;
+
         /**
          * Class used to authenticate customers use of our REST API -- WordPress Only.
          */
@@ -263,6 +412,11 @@ class DbC:public QObject {
          */
         LatencyInterfaceManager* latencyInterfaceManager;
 
+        /**
+         * The pool of workers used to render plots.
+         */
+        PlotWorkerPool* currentPlotWorkerPool;
+
         /**
          * The latency plotting engine.
          */
@@ -273,6 +427,21 @@ class DbC:public QObject {
          */
         ResourcePlotter* currentResourcePlotter;
 
+        /**
+         * The compressor applied to large REST responses.
+         */
+        ResponseCompressor* currentResponseCompressor;
+
+        /**
+         * The cache of serialized customer dashboards.
+         */
+        DashboardCache* currentDashboardCache;
+
+        /**
+         * The per-customer rate limiter applied to expensive customer API requests.
+         */
+        CustomerRateLimiter* currentCustomerRateLimiter;
+
         /**
          * The database username.
          */
@@ -169,7 +169,19 @@ class Event {
             /**
              * Indicates a storage limit has been reached.
              */
-            STORAGE_LIMIT_REACHED = 20
+            STORAGE_LIMIT_REACHED = 20,
+
+            /**
+             * Indicates recent latency has risen well above the monitor's daily average.  This event is not used by
+             * the polling server.
+             */
+            LATENCY_DEGRADED = 21,
+
+            /**
+             * Indicates recent latency has returned to the monitor's daily average.  This event is not used by the
+             * polling server.
+             */
+            LATENCY_RESTORED = 22
         };
 
         /**
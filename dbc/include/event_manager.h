@@ -27,16 +27,17 @@
 #include <QString>
 #include <QByteArray>
 #include <QJsonDocument>
+#include <QJsonObject>
 
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 
 #include "rest_helpers.h"
+#include "event_processor.h"
 
 class Events;
 class Monitors;
-class EventProcessor;
 
 /**
  * Class that support a set of REST endpoints used to manage regions.
@@ -50,6 +51,11 @@ class EventManager:public QObject {
          */
         static const QString eventReportPath;
 
+        /**
+         * Path used to report a group of events.
+         */
+        static const QString eventReportBatchPath;
+
         /**
          * Path used to obtain status about a monitor or all monitors associated with a customer.
          */
@@ -95,6 +101,31 @@ class EventManager:public QObject {
         void setSecret(const QByteArray& newSecret);
 
     private:
+        /**
+         * Method used by the event report handlers to parse a single reported event.
+         *
+         * \param[in]  object        The JSON object describing the event.
+         *
+         * \param[in]  monitors      Class used to manage monitors entries in the database.
+         *
+         * \param[out] reportedEvent The parsed event.
+         *
+         * \param[out] ignored       Set to true if the event is for a monitor that no longer exists and should be
+         *                           silently ignored.
+         *
+         * \param[in]  threadId      The ID used to uniquely identify this thread while in flight.
+         *
+         * \return Returns "OK" if the event is valid, a failure status if the event is invalid, or an empty string if
+         *         the object is malformed.
+         */
+        static QString parseReportedEvent(
+            const QJsonObject&             object,
+            Monitors*                      monitors,
+            EventProcessor::ReportedEvent& reportedEvent,
+            bool&                          ignored,
+            unsigned                       threadId
+        );
+
         /**
          * The event/report handler.
          */
@@ -146,6 +177,59 @@ class EventManager:public QObject {
                 Monitors* currentMonitors;
         };
 
+        /**
+         * The event/report/batch handler.
+         */
+        class EventReportBatch:public RestApiInV1::InesonicRestHandler, private RestHelpers {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret             The secret to use for this handler.
+                 *
+                 * \param[in] eventProcessor     Class used to propagate events.
+                 *
+                 * \param[in] monitorDatabaseApi Class used to manage monitors entries in the database.
+                 */
+                EventReportBatch(
+                    const QByteArray& secret,
+                    EventProcessor*   eventProcessor,
+                    Monitors*         monitorDatabaseApi
+                );
+
+                ~EventReportBatch() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The current event processor API.
+                 */
+                EventProcessor* currentEventProcessor;
+
+                /**
+                 * The current monitor database API.
+                 */
+                Monitors* currentMonitors;
+        };
+
         /**
          * The event/status handler.
          */
@@ -242,6 +326,11 @@ class EventManager:public QObject {
          */
         EventReport eventReport;
 
+        /**
+         * The event/report/batch handler.
+         */
+        EventReportBatch eventReportBatch;
+
         /**
          * The event/status handler.
          */
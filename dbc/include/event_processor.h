@@ -25,23 +25,31 @@
 
 #include <QObject>
 #include <QString>
+#include <QByteArray>
 #include <QList>
-#include <QTimer>
 #include <QHash>
+#include <QSet>
+#include <QMultiMap>
 #include <QMutex>
 
 #include <cstdint>
 
 #include "event.h"
+#include "host_scheme.h"
+#include "periodic_scheduler.h"
 
 class Events;
 class Monitors;
 class HostSchemes;
 class OutboundRestApi;
+class LatencyRollingStatistics;
 
 /**
  * Class that handles reported events.  This class records the event and then triggers outbound reporting of the event.
  * The class also periodically scans SSL expiration date/time values to identify certificates that are about to expire.
+ * Host/schemes are indexed by the time their certificates enter the expiration margin so each check only examines
+ * host/schemes that crossed the margin or were modified since the previous check.  The class can also periodically
+ * compare each monitor's rolling latency statistics to report latency degradation without reading the database.
  */
 class EventProcessor:public QObject {
     Q_OBJECT
@@ -82,6 +90,95 @@ class EventProcessor:public QObject {
          */
         static const unsigned long sslCertificateExpirationMarginSeconds = 3 * 24 * 3600;
 
+        /**
+         * Trivial class that holds a single event reported by a polling server.
+         */
+        class ReportedEvent {
+            public:
+                ReportedEvent() {
+                    customerId    = Event::invalidCustomerId;
+                    monitorId     = 0;
+                    unixTimestamp = 0;
+                    eventType     = EventType::INVALID;
+                    monitorStatus = MonitorStatus::UNKNOWN;
+                }
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] customerId    The ID of the customer tied to the monitor.
+                 *
+                 * \param[in] monitorId     The ID of the monitor that triggered the event.
+                 *
+                 * \param[in] unixTimestamp The Unix timestamp for the event.
+                 *
+                 * \param[in] eventType     The type of event that occurred.
+                 *
+                 * \param[in] monitorStatus The monitor status code reported from the polling server.
+                 *
+                 * \param[in] message       A message associated with this event.
+                 *
+                 * \param[in] hash          The cryptographic hash of the page or found keywords, if relevant.
+                 */
+                ReportedEvent(
+                        CustomerId         customerId,
+                        MonitorId          monitorId,
+                        unsigned long long unixTimestamp,
+                        EventType          eventType,
+                        MonitorStatus      monitorStatus,
+                        const QString&     message,
+                        const QByteArray&  hash
+                    ) {
+                    this->customerId    = customerId;
+                    this->monitorId     = monitorId;
+                    this->unixTimestamp = unixTimestamp;
+                    this->eventType     = eventType;
+                    this->monitorStatus = monitorStatus;
+                    this->message       = message;
+                    this->hash          = hash;
+                }
+
+                /**
+                 * The ID of the customer tied to the monitor.
+                 */
+                CustomerId customerId;
+
+                /**
+                 * The ID of the monitor that triggered the event.
+                 */
+                MonitorId monitorId;
+
+                /**
+                 * The Unix timestamp for the event.
+                 */
+                unsigned long long unixTimestamp;
+
+                /**
+                 * The type of event that occurred.
+                 */
+                EventType eventType;
+
+                /**
+                 * The monitor status code reported from the polling server.
+                 */
+                MonitorStatus monitorStatus;
+
+                /**
+                 * A message associated with this event.
+                 */
+                QString message;
+
+                /**
+                 * The cryptographic hash of the page or found keywords, if relevant.
+                 */
+                QByteArray hash;
+        };
+
+        /**
+         * Type used to represent a list of reported events.
+         */
+        typedef QList<ReportedEvent> ReportedEventList;
+
         /**
          * Constructor
          *
@@ -137,23 +234,160 @@ class EventProcessor:public QObject {
             unsigned           threadId = 0
         );
 
+        /**
+         * Method you can use to report a group of events.  Events are classified in order.  Events that need to be
+         * recorded are written together, in a single transaction, and then reported.
+         *
+         * \param[in] reportedEvents The events to be reported, in the order they occurred.
+         *
+         * \param[in] threadId       An optional thread ID used to maintain independent per-thread database
+         *                           instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool reportEvents(const ReportedEventList& reportedEvents, unsigned threadId = 0);
+
+        /**
+         * Method you can use to enable or disable latency degradation events.  A monitor is reported as degraded when
+         * its five minute mean latency exceeds its 24 hour mean latency by the degradation ratio and restored once it
+         * falls back below the midpoint between the two.
+         *
+         * \param[in] rollingStatistics The rolling latency statistics to check.  A null pointer disables the check.
+         *
+         * \param[in] degradationRatio  The ratio of five minute to 24 hour mean latency that indicates degradation.
+         *                              A value of 0 disables the check.
+         */
+        void setLatencyDegradation(LatencyRollingStatistics* rollingStatistics, double degradationRatio);
+
     private slots:
         /**
          * Slot that is triggered when the SSL expiration check timer fires.
          */
         void checkSslExpiration();
 
+        /**
+         * Slot that is triggered when a host/scheme is modified.  The host/scheme is re-evaluated on the next SSL
+         * expiration check.  This slot is called directly from the thread performing the modification.
+         *
+         * \param[in] hostSchemeId The ID of the modified host/scheme.
+         */
+        void hostSchemeModified(HostScheme::HostSchemeId hostSchemeId);
+
+        /**
+         * Slot that is triggered when the latency degradation check timer fires.
+         */
+        void checkLatencyDegradation();
+
     private:
         /**
-         * SSL expiration check interval.
+         * SSL expiration check interval, in seconds.
+         */
+        static const unsigned long sslCheckIntervalSeconds = 2;
+
+        /**
+         * Latency degradation check interval, in seconds.
          */
-        static const unsigned sslCheckIntervalMilliseconds = 2000;
+        static const unsigned long latencyCheckIntervalSeconds = 60;
+
+        /**
+         * The minimum decayed number of samples in the five minute window before a monitor is checked.
+         */
+        static const double latencyMinimumRecentWeight;
+
+        /**
+         * The minimum decayed number of samples in the 24 hour window before a monitor is checked.
+         */
+        static const double latencyMinimumBaselineWeight;
 
         /**
          * Database ID for the timer function used to check SSL expiration.
          */
         static const unsigned timerDatabaseThreadId = static_cast<unsigned>(-2);
 
+        /**
+         * Interval between full scans of every host/scheme used to reconcile the SSL expiration index, in seconds.
+         */
+        static const unsigned long sslReconcileIntervalSeconds = 3600;
+
+        /**
+         * Type used to order host/schemes by the time their certificates enter the expiration margin.
+         */
+        typedef QMultiMap<unsigned long long, HostScheme::HostSchemeId> HostSchemeIdsByTriggerTime;
+
+        /**
+         * The number of lock stripes used to serialize event reporting.
+         */
+        static const unsigned numberReportEventStripes = 64;
+
+        /**
+         * Method that records a group of events and then reports those that need to be reported.
+         *
+         * \param[in] events   The events to be recorded.
+         *
+         * \param[in] reports  Flags indicating which of the events should also be reported.
+         *
+         * \param[in] threadId The thread ID used to maintain independent per-thread database instances.
+         */
+        void recordAndReport(const QList<Event>& events, const QList<bool>& reports, unsigned threadId);
+
+        /**
+         * Method that sends an event report to the website.
+         *
+         * \param[in] event    The event to be reported.
+         *
+         * \param[in] threadId The thread ID used to maintain independent per-thread database instances.
+         */
+        void sendReport(const Event& event, unsigned threadId);
+
+        /**
+         * Method that checks a single host/scheme, reports any SSL expiration transition and indexes the time the
+         * host/scheme's certificate will next enter the expiration margin.
+         *
+         * \param[in] hostScheme      The host/scheme to be checked.
+         *
+         * \param[in] currentDateTime The current Unix timestamp, in seconds.
+         */
+        void checkHostSchemeSslExpiration(const HostScheme& hostScheme, unsigned long long currentDateTime);
+
+        /**
+         * Method that removes a host/scheme from the SSL expiration index.
+         *
+         * \param[in] hostSchemeId The ID of the host/scheme to be removed.
+         */
+        void unindexSslExpiration(HostScheme::HostSchemeId hostSchemeId);
+
+        /**
+         * Method that reports an SSL certificate event against the first monitor under a host/scheme.
+         *
+         * \param[in] hostScheme      The host/scheme tied to the certificate.
+         *
+         * \param[in] eventType       The event to be reported.
+         *
+         * \param[in] currentDateTime The current Unix timestamp, in seconds.
+         */
+        void reportSslEvent(const HostScheme& hostScheme, EventType eventType, unsigned long long currentDateTime);
+
+        /**
+         * Method that reports a latency event against a monitor.
+         *
+         * \param[in] monitorId       The ID of the monitor to report against.
+         *
+         * \param[in] eventType       The event to be reported.
+         *
+         * \param[in] recentMean      The five minute mean latency, in microseconds.
+         *
+         * \param[in] baselineMean    The 24 hour mean latency, in microseconds.
+         *
+         * \param[in] currentDateTime The current Unix timestamp, in seconds.
+         */
+        void reportLatencyEvent(
+            MonitorId          monitorId,
+            EventType          eventType,
+            double             recentMean,
+            double             baselineMean,
+            unsigned long long currentDateTime
+        );
+
         /**
          * The underlying monitors database API.
          */
@@ -175,19 +409,72 @@ class EventProcessor:public QObject {
         OutboundRestApi* currentWebsiteRestApi;
 
         /**
-         * Timer used to schedule periodic checks of SSL certificates.
+         * The scheduled task used to perform periodic checks of SSL certificates.
          */
-        QTimer certificateCheckTimer;
+        PeriodicScheduler::TaskId certificateCheckTaskId;
 
         /**
-         * Mutex used to make certain event reporting/recording is always serialized.
+         * Mutexes used to make certain event reporting/recording is serialized per monitor and per host/scheme.  A
+         * monitor or host/scheme is covered by the stripe selected by its ID modulo \ref numberReportEventStripes.
          */
-        QMutex reportEventMutex;
+        QMutex reportEventMutexes[numberReportEventStripes];
 
         /**
          * Hash of currently expiring/expired certificates.
          */
         QHash<HostScheme::HostSchemeId, bool> currentExpiringHostSchemes;
+
+        /**
+         * Host/schemes not yet expiring, ordered by the time their certificates enter the expiration margin.
+         */
+        HostSchemeIdsByTriggerTime hostSchemeIdsByTriggerTime;
+
+        /**
+         * The indexed trigger time of each host/scheme in \ref hostSchemeIdsByTriggerTime.
+         */
+        QHash<HostScheme::HostSchemeId, unsigned long long> triggerTimesByHostSchemeId;
+
+        /**
+         * Mutex used to protect \ref modifiedHostSchemeIds.
+         */
+        QMutex modifiedHostSchemesMutex;
+
+        /**
+         * Host/schemes modified since the last SSL expiration check.
+         */
+        QSet<HostScheme::HostSchemeId> modifiedHostSchemeIds;
+
+        /**
+         * The Unix timestamp of the last full scan of every host/scheme.  A value of 0 forces a full scan.
+         */
+        unsigned long long lastSslReconcileTime;
+
+        /**
+         * The scheduled task used to perform periodic checks of rolling latency statistics.
+         */
+        PeriodicScheduler::TaskId latencyCheckTaskId;
+
+        /**
+         * Mutex used to protect the latency degradation settings.
+         */
+        QMutex latencyDegradationMutex;
+
+        /**
+         * The rolling latency statistics to check.
+         */
+        LatencyRollingStatistics* currentRollingStatistics;
+
+        /**
+         * The ratio of five minute to 24 hour mean latency that indicates degradation.  A value of 0 disables the
+         * check.
+         */
+        double currentLatencyDegradationRatio;
+
+        /**
+         * Hash of monitors checked against their rolling latency statistics, holding true for monitors currently
+         * reported as degraded.
+         */
+        QHash<MonitorId, bool> currentDegradedMonitors;
 };
 
 #endif
@@ -29,14 +29,21 @@
 #include <QHash>
 #include <QList>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QJsonObject>
 
 #include <cstdint>
 
 #include "event.h"
+#include "host_scheme.h"
 #include "sql_helpers.h"
+#include "periodic_scheduler.h"
+#include "job_scheduler.h"
 
 class QSqlQuery;
+class QSqlDatabase;
 class DatabaseManager;
+class Catalog;
 
 /**
  * Class used to read and write information about events.  THis class expects two tables named "monitor_status" and
@@ -78,7 +85,9 @@ class DatabaseManager;
  *                         'TRANSACTION',
  *                         'INQUIRY',
  *                         'SUPPORT_REQUEST',
- *                         'STORAGE_LIMIT_REACHED'
+ *                         'STORAGE_LIMIT_REACHED',
+ *                         'LATENCY_DEGRADED',
+ *                         'LATENCY_RESTORED'
  *                     ) NOT NULL,
  *         message     VARCHAR(128),
  *         KEY event_constraint_1 (customer_id),
@@ -93,6 +102,15 @@ class DatabaseManager;
  *             ON UPDATE NO ACTION,
  *         PRIMARY KEY (event_id)
  *     )
+ *
+ * The last event of each event class and the status of each monitor are held in a memory resident state table so
+ * that event dispositions can be determined without reading the database.  Entries are loaded lazily, on first use,
+ * and are updated as events are recorded.
+ *
+ * The event table may be range partitioned on timestamp.  Retention and purges run as background jobs.  Retention
+ * creates partitions ahead of the current time and drops expired partitions whole.  Entries left in partitions that
+ * straddle the threshold, and every entry removed by a purge, are deleted in bounded batches so neither holds locks
+ * long enough to stall event recording.
  */
 class Events:public QObject, private SqlHelpers {
     Q_OBJECT
@@ -138,6 +156,11 @@ class Events:public QObject, private SqlHelpers {
          */
         typedef QHash<Monitor::MonitorId, MonitorStatus> MonitorStatusByMonitorId;
 
+        /**
+         * Type used to represent a host/scheme ID.
+         */
+        typedef HostScheme::HostSchemeId HostSchemeId;
+
         /**
          * Enumeration indicating if we should ignore an event, record and event or record and report an event.
          */
@@ -173,14 +196,85 @@ class Events:public QObject, private SqlHelpers {
          */
         static constexpr CustomerId invalidCustomerId = Event::invalidCustomerId;
 
+        /**
+         * Value used to indicate that the number of returned events should not be limited.
+         */
+        static constexpr unsigned long unlimitedPageSize = 0;
+
+        /**
+         * Trivial class used to mark a position in an event listing.  Listings are ordered by timestamp and then by
+         * event ID so the pair uniquely identifies the last event of a page.
+         */
+        class Cursor {
+            public:
+                Cursor():currentZoranTimestamp(0),currentEventId(invalidEventId) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] zoranTimestamp The Zoran timestamp of the last event returned.
+                 *
+                 * \param[in] eventId        The event ID of the last event returned.
+                 */
+                Cursor(
+                        ZoranTimeStamp zoranTimestamp,
+                        EventId        eventId
+                    ):currentZoranTimestamp(
+                        zoranTimestamp
+                    ),currentEventId(
+                        eventId
+                    ) {}
+
+                /**
+                 * Method you can use to determine if this cursor marks a position.
+                 *
+                 * \return Returns true if the cursor is valid.  Returns false if the listing should start at the
+                 *         beginning.
+                 */
+                inline bool isValid() const {
+                    return currentEventId != invalidEventId;
+                }
+
+                /**
+                 * Method you can use to obtain the Zoran timestamp of the last event returned.
+                 *
+                 * \return Returns the Zoran timestamp.
+                 */
+                inline ZoranTimeStamp zoranTimestamp() const {
+                    return currentZoranTimestamp;
+                }
+
+                /**
+                 * Method you can use to obtain the event ID of the last event returned.
+                 *
+                 * \return Returns the event ID.
+                 */
+                inline EventId eventId() const {
+                    return currentEventId;
+                }
+
+            private:
+                /**
+                 * The Zoran timestamp of the last event returned.
+                 */
+                ZoranTimeStamp currentZoranTimestamp;
+
+                /**
+                 * The event ID of the last event returned.
+                 */
+                EventId currentEventId;
+        };
+
         /**
          * Constructor
          *
          * \param[in] databaseManager The database manager used to fetch information about a region.
          *
+         * \param[in] catalog         The in-memory catalog used to locate the host/scheme tied to a monitor.
+         *
          * \param[in] parent          Pointer to the parent object.
          */
-        Events(DatabaseManager* databaseManager, QObject* parent = nullptr);
+        Events(DatabaseManager* databaseManager, Catalog* catalog, QObject* parent = nullptr);
 
         ~Events() override;
 
@@ -214,6 +308,19 @@ class Events:public QObject, private SqlHelpers {
             unsigned           threadId = 0
         );
 
+        /**
+         * Method you can use to add a group of events in a single transaction.  The events are written using
+         * multi-row inserts and each monitor's status is written once, reflecting the last event for that monitor.
+         *
+         * \param[in] events   The events to be recorded, in order.  The event ID of each entry is ignored.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the recorded events, in order, with their assigned event IDs.  An empty list is returned on
+         *         error, in which case none of the events are recorded.
+         */
+        EventList recordEvents(const EventList& events, unsigned threadId = 0);
+
         /**
          * Method you can use to obtain the current status of a monitor
          *
@@ -265,6 +372,38 @@ class Events:public QObject, private SqlHelpers {
             unsigned           threadId = 0
         );
 
+        /**
+         * Method you can use to obtain a single page of events by customer ID.
+         * Pages may be read from a read replica and so may lag recent writes by up to the configured maximum
+         * replica lag.
+         *
+         * \param[in] customerId     The customer ID.  An invalid customer ID will return events for all customers.
+         *
+         * \param[in] startTimestamp The starting Unix timestamp for the list.  Values will be limited to the range
+         *                           supported by the Zoran epoch.
+         *
+         * \param[in] endingTimstamp The ending Unix timestamp for the list.  Values will be limited to the range
+         *                           supported by the Zoran epoch.
+         *
+         * \param[in] after          The cursor marking the last event of the previous page.  An invalid cursor
+         *                           starts the listing at the beginning.
+         *
+         * \param[in] pageSize       The maximum number of events to return.  A value of \ref unlimitedPageSize
+         *                           returns every remaining event.
+         *
+         * \param[in] threadId       An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns a list of events.
+         */
+        EventList getEventsByCustomer(
+            CustomerId         customerId,
+            unsigned long long startTimestamp,
+            unsigned long long endingTimestamp,
+            const Cursor&      after,
+            unsigned long      pageSize,
+            unsigned           threadId = 0
+        );
+
         /**
          * Method you can use to obtain a list of events by monitor ID.
          *
@@ -287,6 +426,38 @@ class Events:public QObject, private SqlHelpers {
             unsigned           threadId = 0
         );
 
+        /**
+         * Method you can use to obtain a single page of events by monitor ID.
+         * Pages may be read from a read replica and so may lag recent writes by up to the configured maximum
+         * replica lag.
+         *
+         * \param[in] monitorId      The monitor ID.
+         *
+         * \param[in] startTimestamp The starting Unix timestamp for the list.  Values will be limited to the range
+         *                           supported by the Zoran epoch.
+         *
+         * \param[in] endingTimstamp The ending Unix timestamp for the list.  Values will be limited to the range
+         *                           supported by the Zoran epoch.
+         *
+         * \param[in] after          The cursor marking the last event of the previous page.  An invalid cursor
+         *                           starts the listing at the beginning.
+         *
+         * \param[in] pageSize       The maximum number of events to return.  A value of \ref unlimitedPageSize
+         *                           returns every remaining event.
+         *
+         * \param[in] threadId       An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns a list of events.
+         */
+        EventList getEventsByMonitor(
+            MonitorId          monitorId,
+            unsigned long long startTimestamp,
+            unsigned long long endingTimestamp,
+            const Cursor&      after,
+            unsigned long      pageSize,
+            unsigned           threadId = 0
+        );
+
         /**
          * Method you can use to determine how to handle an event based on the customer history.
          *
@@ -311,17 +482,194 @@ class Events:public QObject, private SqlHelpers {
         );
 
         /**
-         * Method you can use to purge events before a specified timestamp.
+         * Method you can use to set the job scheduler used to run retention and purges.  The event job types are
+         * registered with the scheduler so this method must be called before jobs are resumed.
+         *
+         * \param[in] jobScheduler The job scheduler.
+         */
+        void setJobScheduler(JobScheduler* jobScheduler);
+
+        /**
+         * Method you can use to set the event retention.
+         *
+         * \param[in] maximumAge      The maximum age of an event, in seconds.  A value of 0 keeps events forever.
+         *
+         * \param[in] partitionPeriod The span, in seconds, of each event table partition.  A value of 0 disables
+         *                            partition creation.
+         */
+        void setRetention(unsigned long maximumAge, unsigned long partitionPeriod);
+
+        /**
+         * Method you can use to set the number of events deleted per batch by retention and purges.
+         *
+         * \param[in] batchSize The number of events deleted per statement.
+         */
+        void setPurgeBatchSize(unsigned long batchSize);
+
+        /**
+         * Method you can use to purge events at or before a specified timestamp.  The purge is run as a background
+         * job and the method returns once the job is recorded.
          *
          * \param[in] customerId The customer ID.  An invalid customer ID will purge events for all customers.
          *
          * \param[in] timestamp  The Unix timestamp to purge for.
          *
          * \param[in] threadId   An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the ID of the purge job.  The value \ref JobScheduler::invalidJobId is returned on error.
+         */
+        JobScheduler::JobId purgeEvents(CustomerId customerId, unsigned long long timestamp, unsigned threadId = 0);
+
+        /**
+         * The job type used to purge events.
+         */
+        static const QString purgeJobType;
+
+        /**
+         * The job type used to enforce event retention.
+         */
+        static const QString retentionJobType;
+
+        /**
+         * The default number of events deleted per batch.
          */
-        void purgeEvents(CustomerId customerId, unsigned long long timestamp, unsigned threadId = 0);
+        static const unsigned long defaultPurgeBatchSize;
 
     private:
+        /**
+         * The maximum number of events per multi-row INSERT statement.
+         */
+        static const unsigned long maximumEventsPerStatement;
+
+        /**
+         * The name of the scheduled retention task.
+         */
+        static const QString retentionTaskName;
+
+        /**
+         * The period of the retention task, in seconds.
+         */
+        static const unsigned long retentionPeriod = 3600;
+
+        /**
+         * Value indicating the number of partition periods to create ahead of the current time.
+         */
+        static const unsigned long partitionsAhead = 4;
+
+        /**
+         * Enumeration of event classes tracked in the state table.
+         */
+        enum class EventClass {
+            /**
+             * Indicates events that are not tracked.
+             */
+            NONE,
+
+            /**
+             * Indicates working and no response events.
+             */
+            AVAILABILITY,
+
+            /**
+             * Indicates content changed events.
+             */
+            CONTENT,
+
+            /**
+             * Indicates keyword events.
+             */
+            KEYWORDS,
+
+            /**
+             * Indicates SSL certificate expiring and renewed events.
+             */
+            SSL_CERTIFICATE,
+
+            /**
+             * Indicates latency degraded and restored events.
+             */
+            LATENCY
+        };
+
+        /**
+         * Trivial class that holds the last recorded event of a given event class.
+         */
+        class LastEvent {
+            public:
+                LastEvent() {
+                    exists         = false;
+                    eventType      = EventType::INVALID;
+                    zoranTimestamp = 0;
+                }
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] eventType      The type of the last event.
+                 *
+                 * \param[in] zoranTimestamp The Zoran timestamp of the last event.
+                 *
+                 * \param[in] hash           The hash tied to the last event.
+                 */
+                LastEvent(EventType eventType, ZoranTimeStamp zoranTimestamp, const QByteArray& hash) {
+                    this->exists         = true;
+                    this->eventType      = eventType;
+                    this->zoranTimestamp = zoranTimestamp;
+                    this->hash           = hash;
+
+                    recentHashes.append(hash);
+                }
+
+                /**
+                 * Method that carries recent hashes forward from an earlier event of the same class.  Hashes are
+                 * appended after this event's hash, oldest last, until \ref maximumRecentHashes entries are held.
+                 *
+                 * \param[in] earlier The earlier event whose hashes should be retained.
+                 */
+                void retainHashes(const LastEvent& earlier) {
+                    for (  QList<QByteArray>::const_iterator it  = earlier.recentHashes.constBegin(),
+                                                             end = earlier.recentHashes.constEnd()
+                         ; it != end && recentHashes.size() < maximumRecentHashes
+                         ; ++it
+                        ) {
+                        if (!recentHashes.contains(*it)) {
+                            recentHashes.append(*it);
+                        }
+                    }
+                }
+
+                /**
+                 * The maximum number of recent hashes held per entry.  Content that rotates through no more than
+                 * this many variants is reported once per variant rather than on every rotation.
+                 */
+                static constexpr int maximumRecentHashes = 4;
+
+                /**
+                 * Flag indicating if a matching event has ever been recorded.
+                 */
+                bool exists;
+
+                /**
+                 * The type of the last event.
+                 */
+                EventType eventType;
+
+                /**
+                 * The Zoran timestamp of the last event.
+                 */
+                ZoranTimeStamp zoranTimestamp;
+
+                /**
+                 * The hash tied to the last event.
+                 */
+                QByteArray hash;
+
+                /**
+                 * The hashes of the most recent events, newest first.  The list always starts with \ref hash.
+                 */
+                QList<QByteArray> recentHashes;
+        };
+
         /**
          * Base class for all duplicate event checking.
          */
@@ -345,8 +693,10 @@ class Events:public QObject, private SqlHelpers {
                  *
                  * \param[in] hash          The cryptographic hash of the page or found keywords, if relevant.
                  *
-                 * \return Returns a string containing the required SQL query.  An empty string is returned if no
-                 *         check of the database is needed and the event should always be reported.
+                 * \return Returns a string containing the required SQL query.  The monitor ID is referenced through
+                 *         the :monitor_id placeholder so the query text is the same for every monitor and can be
+                 *         prepared once per connection.  An empty string is returned if no check of the database is
+                 *         needed and the event should always be reported.
                  */
                 virtual QString queryString(
                     EventType         eventType,
@@ -356,34 +706,49 @@ class Events:public QObject, private SqlHelpers {
                 ) const;
 
                 /**
-                 * Method that checks the result from a SQL query to determine if an event should be recorded.
+                 * Method that checks the last recorded event to determine if an event should be recorded.
                  *
-                 * The default implementation checks to see if the first returned record from the query has the same
-                 * event type as specified in the call.
+                 * The default implementation checks to see if the last event has the same event type as specified in
+                 * the call.
                  *
-                 * \param[in,out] query         The SQL query to be checked.
+                 * \param[in] lastEvent     The last recorded event matching this checker's query.
                  *
-                 * \param[in]     eventType     The type of event that is triggering this query.
+                 * \param[in] eventType     The type of event that is triggering this check.
                  *
-                 * \param[in]     monitorStatus The monitor status reported by the polling server.
+                 * \param[in] monitorStatus The monitor status reported by the polling server.
                  *
-                 * \param[in]     monitorId     The ID of the monitor that triggered the event.
+                 * \param[in] monitorId     The ID of the monitor that triggered the event.
                  *
-                 * \param[in]     hash          The cryptographic hash of the page or found keywords, if relevant.
+                 * \param[in] hash          The cryptographic hash of the page or found keywords, if relevant.
                  *
                  * \return Returns the required processing for the event.  The default implementation returns
-                 *         EventDisposition::IGNORE if the last event for the monitor based on the query is the same
-                 *         type indicated by the event type parameter.  Returns EventDisposition::RECORD_AND_REPORT
-                 *         otherwise.
+                 *         EventDisposition::IGNORE if the last event for the monitor is the same type indicated by the
+                 *         event type parameter.  Returns EventDisposition::RECORD_AND_REPORT otherwise.
                  */
-                virtual EventDisposition checkQuery(
-                    QSqlQuery&        query,
+                virtual EventDisposition checkLastEvent(
+                    const LastEvent&  lastEvent,
                     EventType         eventType,
                     MonitorStatus     monitorStatus,
                     MonitorId         monitorId,
                     const QByteArray& hash
                 ) const;
 
+                /**
+                 * Method that indicates the class of events this checker tracks.  Checkers reporting the same class
+                 * share a single entry in the state table.
+                 *
+                 * \return Returns the event class.  The default implementation returns \ref EventClass::NONE.
+                 */
+                virtual EventClass eventClass() const;
+
+                /**
+                 * Method that indicates if this checker tracks events per host/scheme rather than per monitor.
+                 *
+                 * \return Returns true if events are tracked per host/scheme.  The default implementation returns
+                 *         false.
+                 */
+                virtual bool perHostScheme() const;
+
             protected:
                 /**
                  * Method that generates a query test condition for recording.
@@ -392,7 +757,8 @@ class Events:public QObject, private SqlHelpers {
                  *
                  * \param[in] hash      The cryptographic hash of the page or found keywords, if relevant.
                  *
-                 * \returns a SQL clause indicating the condition used to limit the query.
+                 * \returns a SQL clause indicating the condition used to limit the query.  The clause must refer to
+                 *          the monitor ID through the :monitor_id placeholder.
                  */
                 virtual QString queryCondition(
                     MonitorId         monitorId,
@@ -403,7 +769,7 @@ class Events:public QObject, private SqlHelpers {
                  * Method that generates a list of columns to be returned in the query.
                  *
                  * \return Returns a list of columns to be returned in the query.  The default implementation returns
-                 *         event_type AS event_type.
+                 *         the event type, hash and timestamp.
                  */
                 virtual QString queryColumns() const;
 
@@ -429,6 +795,13 @@ class Events:public QObject, private SqlHelpers {
 
                 ~PerHostSchemeChecker() override;
 
+                /**
+                 * Method that indicates if this checker tracks events per host/scheme rather than per monitor.
+                 *
+                 * \return Returns true.
+                 */
+                bool perHostScheme() const override;
+
             protected:
                 /**
                  * Method that generates a query test condition.
@@ -490,38 +863,50 @@ class Events:public QObject, private SqlHelpers {
                 ~HashedEventChecker() override;
 
                 /**
-                 * Method that checks the result from a SQL query to determine if an event should be reported.
+                 * Method that checks the last recorded event to determine if an event should be reported.
                  *
-                 * \param[in,out] query         The SQL query to be checked.
+                 * \param[in] lastEvent     The last recorded event matching this checker's query.
                  *
-                 * \param[in]     eventType     The type of event that is triggering this query.
+                 * \param[in] eventType     The type of event that is triggering this check.
                  *
-                 * \param[in]     monitorStatus The monitor status reported by the polling server.
+                 * \param[in] monitorStatus The monitor status reported by the polling server.
                  *
-                 * \param[in]     monitorId     The ID of the monitor that triggered the event.
+                 * \param[in] monitorId     The ID of the monitor that triggered the event.
                  *
-                 * \param[in]     hash          The cryptographic hash of the page or found keywords, if relevant.
+                 * \param[in] hash          The cryptographic hash of the page or found keywords, if relevant.
                  *
-                 * \return Returns EventDisposition::IGNORE if the event is a repeat event.  Returns
-                 *         EventDisposition::RECORD_AND_REPORT if the event is a new event.
+                 * \return Returns EventDisposition::IGNORE if the hash matches any of the recent hashes held for
+                 *         the monitor.  Returns EventDisposition::RECORD_AND_REPORT if the content is new.
                  */
-                EventDisposition checkQuery(
-                    QSqlQuery&        query,
+                EventDisposition checkLastEvent(
+                    const LastEvent&  lastEvent,
                     EventType         eventType,
                     MonitorStatus     monitorStatus,
                     MonitorId         monitorId,
                     const QByteArray& hash
                 ) const override;
 
-            protected:
                 /**
-                 * Method that generates a list of columns to be returned in the query.
+                 * Method that builds up a SQL query used to load the recent hashes for a monitor.
                  *
-                 * \return Returns a list of columns to be returned in the query.  The default implementation returns
-                 *         event_type AS event_type.
+                 * \param[in] eventType     The type of event that is triggering this query.
+                 *
+                 * \param[in] monitorStatus The monitor status reported by the polling server.
+                 *
+                 * \param[in] monitorId     The ID of the monitor that triggered the event.
+                 *
+                 * \param[in] hash          The cryptographic hash of the page or found keywords, if relevant.
+                 *
+                 * \return Returns a query returning up to \ref LastEvent::maximumRecentHashes events, newest first.
                  */
-                QString queryColumns() const override;
+                QString queryString(
+                    EventType         eventType,
+                    MonitorStatus     monitorStatus,
+                    MonitorId         monitorId,
+                    const QByteArray& hash
+                ) const override;
 
+            protected:
                 /**
                  * Method that provides the default disposition if an empty query is returned.
                  *
@@ -544,6 +929,13 @@ class Events:public QObject, private SqlHelpers {
 
                 ~SslChecker() override;
 
+                /**
+                 * Method that indicates the class of events this checker tracks.
+                 *
+                 * \return Returns \ref EventClass::SSL_CERTIFICATE.
+                 */
+                EventClass eventClass() const override;
+
             protected:
                 /**
                  * Method you can overload to return the list of event types to look for.
@@ -563,6 +955,13 @@ class Events:public QObject, private SqlHelpers {
 
                 ~WorkingChecker() override;
 
+                /**
+                 * Method that indicates the class of events this checker tracks.
+                 *
+                 * \return Returns \ref EventClass::AVAILABILITY.
+                 */
+                EventClass eventClass() const override;
+
             protected:
                 /**
                  * Method you can overload to return the list of event types to look for.
@@ -595,6 +994,13 @@ class Events:public QObject, private SqlHelpers {
 
                 ~NoResponseChecker() override;
 
+                /**
+                 * Method that indicates the class of events this checker tracks.
+                 *
+                 * \return Returns \ref EventClass::AVAILABILITY.
+                 */
+                EventClass eventClass() const override;
+
             protected:
                 /**
                  * Method you can overload to return the list of event types to look for.
@@ -626,6 +1032,13 @@ class Events:public QObject, private SqlHelpers {
 
                 ~ContentChangedChecker() override;
 
+                /**
+                 * Method that indicates the class of events this checker tracks.
+                 *
+                 * \return Returns \ref EventClass::CONTENT.
+                 */
+                EventClass eventClass() const override;
+
             protected:
                 /**
                  * Method you can overload to return the list of event types to look for.
@@ -645,6 +1058,13 @@ class Events:public QObject, private SqlHelpers {
 
                 ~KeywordsChecker() override;
 
+                /**
+                 * Method that indicates the class of events this checker tracks.
+                 *
+                 * \return Returns \ref EventClass::KEYWORDS.
+                 */
+                EventClass eventClass() const override;
+
             protected:
                 /**
                  * Method you can overload to return the list of event types to look for.
@@ -675,6 +1095,65 @@ class Events:public QObject, private SqlHelpers {
                 ~SslCertificateRenewedChecker() override;
         };
 
+        /**
+         * Class used to test latency issues.
+         */
+        class LatencyChecker:public PerMonitorChecker {
+            public:
+                LatencyChecker();
+
+                ~LatencyChecker() override;
+
+                /**
+                 * Method that indicates the class of events this checker tracks.
+                 *
+                 * \return Returns \ref EventClass::LATENCY.
+                 */
+                EventClass eventClass() const override;
+
+            protected:
+                /**
+                 * Method you can overload to return the list of event types to look for.
+                 *
+                 * \return Returns a list of event types as a string.  This implementation returns:
+                 *         'LATENCY_DEGRADED', 'LATENCY_RESTORED'
+                 */
+                QString eventTypes() const override;
+        };
+
+        /**
+         * Class used to test latency degraded events.
+         */
+        class LatencyDegradedChecker:public LatencyChecker {
+            public:
+                LatencyDegradedChecker();
+
+                ~LatencyDegradedChecker() override;
+
+            protected:
+                /**
+                 * Method that provides the default disposition if an empty query is returned.
+                 *
+                 * \param[in] eventType     The type of event that is triggering this query.
+                 *
+                 * \param[in] monitorStatus The monitor status reported by the polling server.
+                 *
+                 * \return Returns the default disposition for an empty query.  This version always returns
+                 *         \ref EventDisposition::RECORD_AND_REPORT.
+                 */
+                EventDisposition defaultDisposition(EventType eventType, MonitorStatus monitorStatus) const override;
+        };
+
+        /**
+         * Class used to test latency restored events.
+         */
+        class LatencyRestoredChecker:public LatencyChecker {
+            public:
+                LatencyRestoredChecker();
+
+                ~LatencyRestoredChecker() override;
+        };
+
         /**
          * Class used to test customer events.
          */
@@ -733,6 +1212,103 @@ class Events:public QObject, private SqlHelpers {
          */
         static EventList parseLongQuery(QSqlQuery& sqlQuery);
 
+        /**
+         * Method that builds the key condition selecting a customer's events.
+         *
+         * \param[in] customerId The customer ID.  An invalid customer ID selects every event.
+         *
+         * \return Returns the SQL condition.
+         */
+        static QString customerCondition(CustomerId customerId);
+
+        /**
+         * Method that builds the key condition selecting a monitor's events.
+         *
+         * \param[in] monitorId The monitor ID.
+         *
+         * \return Returns the SQL condition.
+         */
+        static QString monitorCondition(MonitorId monitorId);
+
+        /**
+         * Method used internally to read a page of events.
+         *
+         * \param[in] keyCondition   The SQL condition selecting the customer or monitor.  An empty string selects
+         *                           every event.
+         *
+         * \param[in] startTimestamp The starting Unix timestamp for the list.
+         *
+         * \param[in] endingTimstamp The ending Unix timestamp for the list.
+         *
+         * \param[in] after          The cursor marking the last event of the previous page.
+         *
+         * \param[in] pageSize       The maximum number of events to return.
+         *
+         * \param[in] readReplica    If true, the events may be read from a read replica.
+         *
+         * \param[in] threadId       The thread ID used to obtain a database instance.
+         *
+         * \return Returns a list of events.
+         */
+        EventList queryEvents(
+            const QString&     keyCondition,
+            unsigned long long startTimestamp,
+            unsigned long long endingTimestamp,
+            const Cursor&      after,
+            unsigned long      pageSize,
+            bool               readReplica,
+            unsigned           threadId
+        );
+
+        /**
+         * Method that submits a retention job.  The method is called by the periodic scheduler.
+         */
+        void startRetention();
+
+        /**
+         * Method that performs a retention job.
+         *
+         * \param[in] parameters The job parameters.  Retention jobs have no parameters.
+         *
+         * \param[in] progress   The progress reporter for the job.
+         *
+         * \param[in] threadId   The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool runRetention(const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId);
+
+        /**
+         * Method that performs a purge job.
+         *
+         * \param[in] parameters The job parameters holding the customer ID and Unix timestamp to purge for.
+         *
+         * \param[in] progress   The progress reporter for the job.
+         *
+         * \param[in] threadId   The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool runPurge(const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId);
+
+        /**
+         * Method that deletes events in bounded batches until no matching events remain or the job is canceled.
+         *
+         * \param[in]     database  The database instance to be used.
+         *
+         * \param[in]     condition The SQL condition selecting the events to be deleted.
+         *
+         * \param[in,out] progress  The progress reporter for the job.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool deleteEvents(QSqlDatabase& database, const QString& condition, JobScheduler::Progress& progress);
+
+        /**
+         * Method that updates the period of the retention task.
+         */
+        void updateSchedule();
+
         /**
          * Method that converts a Unix timestamp to a Zoran timestamp with capping.
          *
@@ -742,6 +1318,57 @@ class Events:public QObject, private SqlHelpers {
          */
         ZoranTimeStamp toZoranTimestamp(unsigned long long unixTimestamp);
 
+        /**
+         * Method that determines the status a monitor is left in after an event.
+         *
+         * \param[in] eventType The type of event.
+         *
+         * \return Returns the resulting monitor status.
+         */
+        static MonitorStatus statusAfterEvent(EventType eventType);
+
+        /**
+         * Method that determines the state table key for an event.
+         *
+         * \param[in] checker   The checker tied to the event.
+         *
+         * \param[in] monitorId The ID of the monitor that triggered the event.
+         *
+         * \param[in] threadId  The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the state table key.  A value of 0 is returned if the monitor's host/scheme is unknown.
+         */
+        std::uint64_t stateKey(const Checker* checker, MonitorId monitorId, unsigned threadId);
+
+        /**
+         * Method that reads the last event matching a checker from the database.  Hashes from any additional rows
+         * returned by the query are kept as the event's recent hashes.
+         *
+         * \param[out] lastEvent   The last event.  The event is left untouched if no matching event exists.
+         *
+         * \param[in]  queryString The query used to find the last event.
+         *
+         * \param[in]  monitorId   The monitor ID to bind to the query's :monitor_id placeholder.
+         *
+         * \param[in]  threadId    The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool readLastEvent(LastEvent& lastEvent, const QString& queryString, MonitorId monitorId, unsigned threadId);
+
+        /**
+         * Method that reads the status of a monitor from the database.
+         *
+         * \param[out] monitorStatus The status of the monitor.
+         *
+         * \param[in]  monitorId     The ID of the monitor of interest.
+         *
+         * \param[in]  threadId      The thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool readMonitorStatus(MonitorStatus& monitorStatus, MonitorId monitorId, unsigned threadId);
+
         /**
          * Hash table of event checkers.
          */
@@ -751,6 +1378,61 @@ class Events:public QObject, private SqlHelpers {
          * The underlying database manager instance.
          */
         DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The in-memory catalog used to locate the host/scheme tied to a monitor.
+         */
+        Catalog* currentCatalog;
+
+        /**
+         * Mutex used to guard the state table.
+         */
+        QMutex stateMutex;
+
+        /**
+         * The last recorded event by event class and monitor or host/scheme.
+         */
+        QHash<std::uint64_t, LastEvent> lastEvents;
+
+        /**
+         * The current status of each monitor, by monitor ID.
+         */
+        QHash<MonitorId, MonitorStatus> monitorStatuses;
+
+        /**
+         * The job scheduler used to run retention and purges.
+         */
+        JobScheduler* currentJobScheduler;
+
+        /**
+         * The scheduled task used to trigger retention.
+         */
+        PeriodicScheduler::TaskId retentionTaskId;
+
+        /**
+         * Flag indicating that a retention job has been submitted and has not yet finished.
+         */
+        QAtomicInt retentionPending;
+
+        /**
+         * Mutex used to guard the retention settings.
+         */
+        QMutex retentionMutex;
+
+        /**
+         * The maximum age of an event, in seconds.  A value of 0 keeps events forever.
+         */
+        unsigned long currentMaximumEventAge;
+
+        /**
+         * The span of each event table partition, in seconds.
+         */
+        unsigned long currentPartitionPeriod;
+
+        /**
+         * The number of events deleted per batch.
+         */
+        unsigned long currentPurgeBatchSize;
 };
 
 #endif
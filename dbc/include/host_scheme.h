@@ -29,12 +29,14 @@
 #include <cstdint>
 
 class HostSchemes;
+class Catalog;
 
 /**
  * Trivial class used to hold information about a customer's server and scheme.
  */
 class HostScheme {
     friend class HostSchemes;
+    friend class Catalog;
 
     public:
         /**
@@ -26,6 +26,9 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QList>
+#include <QUrl>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 
 #include <cstdint>
@@ -35,6 +38,8 @@
 
 class QTimer;
 class DatabaseManager;
+class IdRegistry;
+class Catalog;
 
 /**
  * Class used to read and write information about server hostnames and schemes used to access them.  This cless expects
@@ -52,6 +57,9 @@ class DatabaseManager;
  *             ON DELETE CASCADE
  *             ON UPDATE NO ACTION
  *     ) ENGINE=InnoDB AUTO_INCREMENT=102 DEFAULT CHARSET=latin1
+ *
+ * Reads are served from the in-memory \ref Catalog, which this class keeps up to date as host/schemes are created,
+ * modified and deleted.
  */
 class HostSchemes:public QObject, private SqlHelpers {
     Q_OBJECT
@@ -72,14 +80,28 @@ class HostSchemes:public QObject, private SqlHelpers {
          */
         typedef QHash<HostSchemeId, HostScheme> HostSchemeHash;
 
+        /**
+         * Type used to represent a list of host/schemes.
+         */
+        typedef QList<HostScheme> HostSchemeList;
+
         /**
          * Constructor
          *
          * \param[in] databaseManager The database manager used to fetch information about host/scheme instances.
          *
+         * \param[in] idRegistry      The registry of valid monitor and server IDs to be kept up to date.
+         *
+         * \param[in] catalog         The in-memory catalog used to serve reads and to be kept up to date.
+         *
          * \param[in] parent          Pointer to the parent object.
          */
-        HostSchemes(DatabaseManager* databaseManager, QObject* parent = nullptr);
+        HostSchemes(
+            DatabaseManager* databaseManager,
+            IdRegistry*      idRegistry,
+            Catalog*         catalog,
+            QObject*         parent = nullptr
+        );
 
         ~HostSchemes() override;
 
@@ -141,6 +163,54 @@ class HostSchemes:public QObject, private SqlHelpers {
          */
         bool deleteCustomerHostSchemes(CustomerId customerId, unsigned threadId = 0);
 
+        /**
+         * Method you can use to insert a set of new host/schemes using multi-row INSERT statements.  The method does
+         * not touch the catalog so it can be used inside a transaction owned by the caller.  Call
+         * \ref HostSchemes::commitHostSchemes once the transaction has been committed.
+         *
+         * \param[in]  database            The database connection to use.
+         *
+         * \param[in]  customerId          The customer ID to tie to the new host/schemes.
+         *
+         * \param[in]  urls                The host/scheme URLs to be inserted.
+         *
+         * \param[out] insertedHostSchemes The inserted host/schemes, in the order supplied.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool insertHostSchemes(
+            QSqlDatabase&      database,
+            CustomerId         customerId,
+            const QList<QUrl>& urls,
+            HostSchemeList&    insertedHostSchemes
+        ) const;
+
+        /**
+         * Method you can use to remove a set of host/schemes, and the monitors under them, by host/scheme ID.  The
+         * method does not touch the catalog or ID registry so it can be used inside a transaction owned by the
+         * caller.
+         *
+         * \param[in] database      The database connection to use.
+         *
+         * \param[in] hostSchemeIds The IDs of the host/schemes to be removed.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool removeHostSchemes(QSqlDatabase& database, const QList<HostSchemeId>& hostSchemeIds) const;
+
+        /**
+         * Method you can use to publish changes made by \ref HostSchemes::insertHostSchemes and
+         * \ref HostSchemes::removeHostSchemes to the catalog and ID registry.
+         *
+         * \param[in] insertedHostSchemes  The host/schemes that were inserted.
+         *
+         * \param[in] removedHostSchemeIds The IDs of the host/schemes that were removed.
+         */
+        void commitHostSchemes(
+            const HostSchemeList&      insertedHostSchemes,
+            const QList<HostSchemeId>& removedHostSchemeIds
+        );
+
         /**
          * Method you can use to obtain host schemes for a given customer or all customers.
          *
@@ -153,7 +223,6 @@ class HostSchemes:public QObject, private SqlHelpers {
          */
         HostSchemeHash getHostSchemes(CustomerId customerId = HostScheme::invalidCustomerId, unsigned threadId = 0);
 
-    private:
         /**
          * Method that converts a query to a host/scheme instance.
          *
@@ -164,10 +233,35 @@ class HostSchemes:public QObject, private SqlHelpers {
          */
         static HostScheme convertQueryToHostScheme(const QSqlQuery& sqlQuery, bool* success = nullptr);
 
+    signals:
+        /**
+         * Signal that is emitted when a host/scheme has been successfully modified.  The signal is emitted from the
+         * thread performing the modification.
+         *
+         * \param[out] hostSchemeId The ID of the modified host/scheme.
+         */
+        void hostSchemeModified(HostSchemeId hostSchemeId);
+
+    private:
+        /**
+         * The maximum number of host/schemes per multi-row INSERT or DELETE statement.
+         */
+        static const unsigned long maximumHostSchemesPerStatement;
+
         /**
          * The underlying database manager instance.
          */
         DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The registry of valid monitor and server IDs.
+         */
+        IdRegistry* currentIdRegistry;
+
+        /**
+         * The in-memory catalog of monitors and host/schemes.
+         */
+        Catalog* currentCatalog;
 };
 
 #endif
@@ -0,0 +1,335 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref IdRegistry class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef ID_REGISTRY_H
+#define ID_REGISTRY_H
+
+#include <QObject>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+#include <memory>
+
+#include "monitor.h"
+#include "server.h"
+
+class QSqlDatabase;
+
+/**
+ * Class that tracks the set of monitor and server IDs that currently exist in the database.  The registry is updated
+ * incrementally as monitors and servers are created and deleted and is periodically reconciled against the database
+ * as a safety net.
+ *
+ * Readers obtain an immutable, versioned \ref IdRegistry::Snapshot.  Obtaining the snapshot does not lock unless
+ * incremental changes are pending and lookups against the snapshot never lock.
+ */
+class IdRegistry:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef Monitor::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef Server::ServerId ServerId;
+
+        /**
+         * The default interval between forced reconciliations, in seconds.
+         */
+        static const unsigned defaultReconcileIntervalSeconds;
+
+        /**
+         * Class holding an immutable view of the registered IDs.
+         */
+        class Snapshot {
+            public:
+                Snapshot():currentVersion(0) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] version    The snapshot version.
+                 *
+                 * \param[in] monitorIds The registered monitor IDs.
+                 *
+                 * \param[in] serverIds  The registered server IDs.
+                 */
+                Snapshot(
+                        unsigned long long     version,
+                        const QSet<MonitorId>& monitorIds,
+                        const QSet<ServerId>&  serverIds
+                    ):currentVersion(
+                        version
+                    ),currentMonitorIds(
+                        monitorIds
+                    ),currentServerIds(
+                        serverIds
+                    ) {}
+
+                /**
+                 * Method you can use to obtain the snapshot version.  The version increases with every change.
+                 *
+                 * \return Returns the snapshot version.  A value of 0 indicates the registry has never been loaded.
+                 */
+                inline unsigned long long version() const {
+                    return currentVersion;
+                }
+
+                /**
+                 * Method you can use to determine if a monitor ID is registered.
+                 *
+                 * \param[in] monitorId The monitor ID to check.
+                 *
+                 * \return Returns true if the monitor ID is registered.
+                 */
+                inline bool containsMonitor(MonitorId monitorId) const {
+                    return currentMonitorIds.contains(monitorId);
+                }
+
+                /**
+                 * Method you can use to determine if a server ID is registered.
+                 *
+                 * \param[in] serverId The server ID to check.
+                 *
+                 * \return Returns true if the server ID is registered.
+                 */
+                inline bool containsServer(ServerId serverId) const {
+                    return currentServerIds.contains(serverId);
+                }
+
+                /**
+                 * Method you can use to obtain the registered monitor IDs.
+                 *
+                 * \return Returns the registered monitor IDs.
+                 */
+                inline const QSet<MonitorId>& monitorIds() const {
+                    return currentMonitorIds;
+                }
+
+                /**
+                 * Method you can use to obtain the registered server IDs.
+                 *
+                 * \return Returns the registered server IDs.
+                 */
+                inline const QSet<ServerId>& serverIds() const {
+                    return currentServerIds;
+                }
+
+            private:
+                /**
+                 * The snapshot version.
+                 */
+                unsigned long long currentVersion;
+
+                /**
+                 * The registered monitor IDs.
+                 */
+                QSet<MonitorId> currentMonitorIds;
+
+                /**
+                 * The registered server IDs.
+                 */
+                QSet<ServerId> currentServerIds;
+        };
+
+        /**
+         * Type used to reference a snapshot.
+         */
+        typedef std::shared_ptr<const Snapshot> SnapshotPointer;
+
+        /**
+         * Constructor
+         *
+         * \param[in] parent Pointer to the parent object.
+         */
+        IdRegistry(QObject* parent = nullptr);
+
+        ~IdRegistry() override;
+
+        /**
+         * Method you can use to obtain the current snapshot.  This method is thread safe.
+         *
+         * \return Returns the current snapshot.
+         */
+        SnapshotPointer snapshot();
+
+        /**
+         * Method you can use to register a newly created monitor.
+         *
+         * \param[in] monitorId The ID of the new monitor.
+         */
+        void addMonitor(MonitorId monitorId);
+
+        /**
+         * Method you can use to unregister a deleted monitor.
+         *
+         * \param[in] monitorId The ID of the deleted monitor.
+         */
+        void removeMonitor(MonitorId monitorId);
+
+        /**
+         * Method you can use to register a newly created server.
+         *
+         * \param[in] serverId The ID of the new server.
+         */
+        void addServer(ServerId serverId);
+
+        /**
+         * Method you can use to unregister a deleted server.
+         *
+         * \param[in] serverId The ID of the deleted server.
+         */
+        void removeServer(ServerId serverId);
+
+        /**
+         * Method you can use to indicate that an unknown set of IDs may have been removed.  The registry will be
+         * reconciled against the database on the next call to \ref IdRegistry::reconcileIfNeeded.
+         */
+        void invalidate();
+
+        /**
+         * Method you can use to set the interval between forced reconciliations.
+         *
+         * \param[in] reconcileIntervalSeconds The new reconcile interval, in seconds.
+         */
+        void setReconcileInterval(unsigned reconcileIntervalSeconds);
+
+        /**
+         * Method you can use to determine if the registry should be reconciled against the database.
+         *
+         * \return Returns true if the registry has never been loaded, has been invalidated, or has not been
+         *         reconciled within the reconcile interval.
+         */
+        bool needsReconcile() const;
+
+        /**
+         * Method that reconciles the registry against the database if needed.
+         *
+         * \param[in] database The open database instance to be used.
+         *
+         * \return Returns true on success or if no reconcile was needed.  Returns false on error.
+         */
+        bool reconcileIfNeeded(QSqlDatabase& database);
+
+        /**
+         * Method that reloads the registry from the database.
+         *
+         * \param[in] database The open database instance to be used.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool reconcile(QSqlDatabase& database);
+
+    private:
+        /**
+         * Trivial class used to queue incremental changes.
+         */
+        class Change {
+            public:
+                /**
+                 * Enumeration of change types.
+                 */
+                enum class Type {
+                    ADD_MONITOR,
+                    REMOVE_MONITOR,
+                    ADD_SERVER,
+                    REMOVE_SERVER
+                };
+
+                Change():type(Type::ADD_MONITOR),id(0) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] changeType The change type.
+                 *
+                 * \param[in] changeId   The monitor or server ID.
+                 */
+                Change(Type changeType, unsigned long changeId):type(changeType),id(changeId) {}
+
+                /**
+                 * The type of change.
+                 */
+                Type type;
+
+                /**
+                 * The monitor or server ID.
+                 */
+                unsigned long id;
+        };
+
+        /**
+         * Method that queues a change.
+         *
+         * \param[in] change The change to be queued.
+         */
+        void queueChange(const Change& change);
+
+        /**
+         * Method that folds pending changes into a new snapshot.  The writer mutex must be locked by the caller.
+         */
+        void applyPendingChanges();
+
+        /**
+         * Mutex used to serialize changes and reconciliation.
+         */
+        mutable QMutex writerMutex;
+
+        /**
+         * The current snapshot.  Accessed using the std::atomic_load and std::atomic_store functions.
+         */
+        SnapshotPointer currentSnapshot;
+
+        /**
+         * Changes not yet folded into the current snapshot.
+         */
+        QList<Change> pendingChanges;
+
+        /**
+         * The number of pending changes.  Used to avoid locking when no changes are pending.
+         */
+        QAtomicInt numberPendingChanges;
+
+        /**
+         * Flag indicating that the registry has been invalidated.
+         */
+        QAtomicInt invalidated;
+
+        /**
+         * Timer measuring the time since the last successful reconcile.
+         */
+        QElapsedTimer timeSinceReconcile;
+
+        /**
+         * The current reconcile interval, in milliseconds.
+         */
+        qint64 currentReconcileIntervalMilliseconds;
+};
+
+#endif
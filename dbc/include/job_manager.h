@@ -0,0 +1,178 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref JobManager class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef JOB_MANAGER_H
+#define JOB_MANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QJsonDocument>
+
+#include <rest_api_in_v1_server.h>
+#include <rest_api_in_v1_json_response.h>
+#include <rest_api_in_v1_inesonic_rest_handler.h>
+
+class JobScheduler;
+
+/**
+ * Class that provides REST endpoints used to track and cancel background admin jobs.
+ */
+class JobManager:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Path used to obtain the state of a job.
+         */
+        static const QString jobStatusPath;
+
+        /**
+         * Path used to cancel a job.
+         */
+        static const QString jobCancelPath;
+
+        /**
+         * Constructor
+         *
+         * \param[in] restApiServer The REST API server instance.
+         *
+         * \param[in] jobScheduler  The scheduler running background jobs.
+         *
+         * \param[in] secret        The incoming data secret.
+         *
+         * \param[in] parent        Pointer to the parent object.
+         */
+        JobManager(
+            RestApiInV1::Server* restApiServer,
+            JobScheduler*        jobScheduler,
+            const QByteArray&    secret,
+            QObject*             parent = nullptr
+        );
+
+        ~JobManager() override;
+
+        /**
+         * Method you can use to set the Inesonic authentication secret.
+         *
+         * \param[in] newSecret The new secret to be used.  The secret must be the length prescribed by the
+         *                      constant \ref inesonicSecretLength.
+         */
+        void setSecret(const QByteArray& newSecret);
+
+    private:
+        /**
+         * The job/status handler.
+         */
+        class JobStatus:public RestApiInV1::InesonicRestHandler {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret       The secret to use for this handler.
+                 *
+                 * \param[in] jobScheduler The scheduler running background jobs.
+                 */
+                JobStatus(const QByteArray& secret, JobScheduler* jobScheduler);
+
+                ~JobStatus() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The scheduler running background jobs.
+                 */
+                JobScheduler* currentJobScheduler;
+        };
+
+        /**
+         * The job/cancel handler.
+         */
+        class JobCancel:public RestApiInV1::InesonicRestHandler {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret       The secret to use for this handler.
+                 *
+                 * \param[in] jobScheduler The scheduler running background jobs.
+                 */
+                JobCancel(const QByteArray& secret, JobScheduler* jobScheduler);
+
+                ~JobCancel() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The scheduler running background jobs.
+                 */
+                JobScheduler* currentJobScheduler;
+        };
+
+        /**
+         * The job/status handler.
+         */
+        JobStatus jobStatus;
+
+        /**
+         * The job/cancel handler.
+         */
+        JobCancel jobCancel;
+};
+
+#endif
@@ -0,0 +1,525 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref JobScheduler class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QJsonObject>
+
+#include <functional>
+
+class DatabaseManager;
+
+/**
+ * Class that runs long admin operations as background jobs so they never hold a REST worker.  Owners of an operation
+ * register a job type along with a function that performs the work.  Submitted jobs are recorded in a job table and
+ * picked up by a small pool of worker threads, subject to a per-type concurrency limit.  Jobs report progress through
+ * the job record and may be canceled while pending or, for job functions that check for it, while running.
+ *
+ * Jobs that were pending or running when the controller stopped are run again once \ref JobScheduler::resumeJobs is
+ * called so job functions must be safe to repeat.
+ *
+ * This class expects a table defined as:
+ *
+ *     CREATE TYPE admin_job_status AS ENUM('PENDING','RUNNING','COMPLETED','FAILED','CANCELED');
+ *
+ *     CREATE TABLE admin_job (
+ *         job_id     BIGSERIAL NOT NULL PRIMARY KEY,
+ *         job_type   VARCHAR(32) NOT NULL,
+ *         parameters TEXT NOT NULL,
+ *         completed  BIGINT NOT NULL DEFAULT 0,
+ *         total      BIGINT NOT NULL DEFAULT 0,
+ *         message    TEXT NOT NULL DEFAULT '',
+ *         status     admin_job_status NOT NULL DEFAULT 'PENDING'
+ *     );
+ */
+class JobScheduler:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to represent a job ID.
+         */
+        typedef unsigned long long JobId;
+
+        /**
+         * Value used to indicate an invalid job ID.
+         */
+        static constexpr JobId invalidJobId = 0;
+
+        /**
+         * The default number of job workers.
+         */
+        static const unsigned defaultNumberWorkers;
+
+        /**
+         * The largest number of job workers supported.
+         */
+        static const unsigned maximumNumberWorkers = 16;
+
+        /**
+         * The database thread ID used by the first worker.  Subsequent workers count down from this value.
+         */
+        static constexpr unsigned firstDatabaseThreadId = static_cast<unsigned>(-100);
+
+        /**
+         * Enumeration of job states.
+         */
+        enum class Status {
+            /**
+             * Indicates the job is waiting for a worker.
+             */
+            PENDING,
+
+            /**
+             * Indicates the job is in progress or was interrupted and will be run again.
+             */
+            RUNNING,
+
+            /**
+             * Indicates the job finished successfully.
+             */
+            COMPLETED,
+
+            /**
+             * Indicates the job could not be completed.
+             */
+            FAILED,
+
+            /**
+             * Indicates the job was canceled.
+             */
+            CANCELED
+        };
+
+        /**
+         * Class passed to job functions to report progress and check for cancellation.
+         */
+        class Progress {
+            friend class JobScheduler;
+
+            public:
+                /**
+                 * Method you can use to determine the ID of the job being run.
+                 *
+                 * \return Returns the job ID.
+                 */
+                JobId jobId() const;
+
+                /**
+                 * Method you can use to report progress.  The progress is written to the job record.
+                 *
+                 * \param[in] completed The number of work items completed.
+                 *
+                 * \param[in] total     The total number of work items.
+                 */
+                void setProgress(unsigned long long completed, unsigned long long total);
+
+                /**
+                 * Method you can use to record a message reported with the job status, typically a failure reason.
+                 *
+                 * \param[in] message The message to be recorded.
+                 */
+                void setMessage(const QString& message);
+
+                /**
+                 * Method you can use to determine if cancellation of this job has been requested.  Job functions
+                 * should return promptly, with any completed work left consistent, once this returns true.
+                 *
+                 * \return Returns true if the job should stop.
+                 */
+                bool cancelRequested() const;
+
+            private:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] scheduler        The scheduler running the job.
+                 *
+                 * \param[in] jobId            The ID of the job being run.
+                 *
+                 * \param[in] databaseThreadId The database thread ID used by the calling worker.
+                 */
+                Progress(JobScheduler* scheduler, JobId jobId, unsigned databaseThreadId);
+
+                /**
+                 * The scheduler running the job.
+                 */
+                JobScheduler* currentScheduler;
+
+                /**
+                 * The ID of the job being run.
+                 */
+                JobId currentJobId;
+
+                /**
+                 * The database thread ID used by the calling worker.
+                 */
+                unsigned currentDatabaseThreadId;
+
+                /**
+                 * The message to be recorded with the job's final status.
+                 */
+                QString currentMessage;
+        };
+
+        /**
+         * Type of the function used to perform a job.  The function receives the job parameters, the progress
+         * reporter, and the database thread ID reserved for the calling worker.  The function should return true on
+         * success or false on error.
+         */
+        typedef std::function<bool(const QJsonObject&, Progress&, unsigned)> JobFunction;
+
+        /**
+         * Trivial class used to report the state of a job.
+         */
+        class JobStatus {
+            public:
+                /**
+                 * The job type.
+                 */
+                QString jobType;
+
+                /**
+                 * The job's current state.
+                 */
+                Status status;
+
+                /**
+                 * The number of work items completed.
+                 */
+                unsigned long long completed;
+
+                /**
+                 * The total number of work items, if known.
+                 */
+                unsigned long long total;
+
+                /**
+                 * The message recorded by the job, if any.
+                 */
+                QString message;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] databaseManager The database manager used to access the job table.
+         *
+         * \param[in] parent          Pointer to the parent object.
+         */
+        JobScheduler(DatabaseManager* databaseManager, QObject* parent = nullptr);
+
+        ~JobScheduler() override;
+
+        /**
+         * Method you can use to convert a job status to a string.
+         *
+         * \param[in] status The status to be converted.
+         *
+         * \return Returns the status as a string.
+         */
+        static QString toString(Status status);
+
+        /**
+         * Method you can use to convert a string to a job status.
+         *
+         * \param[in]  str     The string to be converted.
+         *
+         * \param[out] success An optional pointer to a boolean value holding true on success or false on error.
+         *
+         * \return Returns the status.
+         */
+        static Status toStatus(const QString& str, bool* success = nullptr);
+
+        /**
+         * Method you can use to register a job type.  Register job types before calling \ref resumeJobs.
+         *
+         * \param[in] jobType           The name used to identify the job type.
+         *
+         * \param[in] maximumConcurrent The maximum number of jobs of this type that may run at once.
+         *
+         * \param[in] jobFunction       The function used to perform jobs of this type.
+         */
+        void registerJobType(const QString& jobType, unsigned maximumConcurrent, JobFunction jobFunction);
+
+        /**
+         * Method you can use to change the concurrency limit for a registered job type.
+         *
+         * \param[in] jobType           The job type to be updated.
+         *
+         * \param[in] maximumConcurrent The maximum number of jobs of this type that may run at once.  Must be at
+         *                              least 1.
+         *
+         * \return Returns true on success.  Returns false if the job type is not registered.
+         */
+        bool setMaximumConcurrent(const QString& jobType, unsigned maximumConcurrent);
+
+        /**
+         * Method you can use to set the number of job workers.  Removed workers finish the job they are running
+         * before they exit.
+         *
+         * \param[in] numberWorkers The number of job workers.
+         */
+        void setNumberWorkers(unsigned numberWorkers);
+
+        /**
+         * Method you can use to submit a job.  The method returns once the job is recorded.
+         *
+         * \param[in] jobType    The type of job to run.  The type must be registered.
+         *
+         * \param[in] parameters The parameters passed to the job function.
+         *
+         * \param[in] threadId   An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the ID of the new job.  The value \ref invalidJobId is returned on error.
+         */
+        JobId submit(const QString& jobType, const QJsonObject& parameters, unsigned threadId = 0);
+
+        /**
+         * Method you can use to obtain the state of a job.
+         *
+         * \param[in]  jobId     The ID of the job of interest.
+         *
+         * \param[out] jobStatus The job's state.
+         *
+         * \param[in]  threadId  An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false if the job does not exist or on error.
+         */
+        bool getJobStatus(JobId jobId, JobStatus& jobStatus, unsigned threadId = 0);
+
+        /**
+         * Method you can use to cancel a job.  Pending jobs are canceled immediately.  Running jobs are asked to stop
+         * and are marked canceled once their job function returns.
+         *
+         * \param[in] jobId    The ID of the job to be canceled.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true if the job was canceled or asked to stop.  Returns false if the job is unknown or has
+         *         already finished.
+         */
+        bool cancel(JobId jobId, unsigned threadId = 0);
+
+        /**
+         * Method you can use to queue jobs left pending or running by a previous run.  Call this method once the
+         * database connection settings are known and the job types are registered.
+         */
+        void resumeJobs();
+
+    private:
+        /**
+         * Trivial class that holds a queued job.
+         */
+        class QueuedJob {
+            public:
+                /**
+                 * The job ID.
+                 */
+                JobId jobId;
+
+                /**
+                 * The job type.
+                 */
+                QString jobType;
+
+                /**
+                 * The job parameters.
+                 */
+                QJsonObject parameters;
+        };
+
+        /**
+         * Trivial class that holds the settings and state of a job type.
+         */
+        class JobType {
+            public:
+                /**
+                 * The function used to perform jobs of this type.
+                 */
+                JobFunction jobFunction;
+
+                /**
+                 * The maximum number of jobs of this type that may run at once.
+                 */
+                unsigned maximumConcurrent;
+
+                /**
+                 * The number of jobs of this type currently running.
+                 */
+                unsigned numberRunning;
+        };
+
+        /**
+         * Class used to run jobs from a dedicated thread.
+         */
+        class Worker:public QThread {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] scheduler        The scheduler that owns this worker.
+                 *
+                 * \param[in] databaseThreadId The database thread ID reserved for this worker.
+                 */
+                Worker(JobScheduler* scheduler, unsigned databaseThreadId);
+
+                ~Worker() override;
+
+                /**
+                 * Method you can use to ask the worker to exit once it finishes its current job.
+                 */
+                void requestStop();
+
+                /**
+                 * Method you can use to determine if the worker has been asked to exit.  The scheduler's job mutex
+                 * must be held when calling this method.
+                 *
+                 * \return Returns true if the worker should exit.
+                 */
+                bool stopRequested() const;
+
+            protected:
+                /**
+                 * Method that runs this thread.
+                 */
+                void run() override;
+
+            private:
+                /**
+                 * The scheduler that owns this worker.
+                 */
+                JobScheduler* currentScheduler;
+
+                /**
+                 * The database thread ID reserved for this worker.
+                 */
+                unsigned currentDatabaseThreadId;
+
+                /**
+                 * Flag indicating that the worker should exit.  Protected by the scheduler's job mutex.
+                 */
+                bool currentStopRequested;
+        };
+
+        /**
+         * Method used by workers to obtain the next job whose type is below its concurrency limit.  The method blocks
+         * until a job is available or the worker is asked to stop.
+         *
+         * \param[in]  worker The worker requesting a job.
+         *
+         * \param[out] job    The job to be run.
+         *
+         * \return Returns true if a job was obtained.  Returns false if the worker should exit.
+         */
+        bool nextJob(Worker* worker, QueuedJob& job);
+
+        /**
+         * Method used by workers to run a job and record its outcome.
+         *
+         * \param[in] job              The job to be run.
+         *
+         * \param[in] databaseThreadId The database thread ID reserved for the calling worker.
+         */
+        void runJob(const QueuedJob& job, unsigned databaseThreadId);
+
+        /**
+         * Method that records the progress of a job.
+         *
+         * \param[in] jobId     The ID of the job.
+         *
+         * \param[in] completed The number of work items completed.
+         *
+         * \param[in] total     The total number of work items.
+         *
+         * \param[in] threadId  The database thread ID to be used.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool recordProgress(JobId jobId, unsigned long long completed, unsigned long long total, unsigned threadId);
+
+        /**
+         * Method that updates the state of a job.
+         *
+         * \param[in] jobId    The ID of the job.
+         *
+         * \param[in] status   The new job state.
+         *
+         * \param[in] message  The message to be recorded with the job.
+         *
+         * \param[in] threadId The database thread ID to be used.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool setJobStatus(JobId jobId, Status status, const QString& message, unsigned threadId);
+
+        /**
+         * The database manager used to access the job table.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * Mutex used to protect the queue, job types, cancellation requests and worker stop flags.
+         */
+        QMutex jobMutex;
+
+        /**
+         * Wait condition used to wake idle workers.
+         */
+        QWaitCondition jobCondition;
+
+        /**
+         * The queued jobs, oldest first.
+         */
+        QList<QueuedJob> pendingJobs;
+
+        /**
+         * The IDs of the jobs currently running.
+         */
+        QSet<JobId> runningJobs;
+
+        /**
+         * The IDs of running jobs that have been asked to stop.
+         */
+        QSet<JobId> cancelRequests;
+
+        /**
+         * The registered job types, by name.
+         */
+        QHash<QString, JobType> jobTypes;
+
+        /**
+         * The current workers.
+         */
+        QList<Worker*> workers;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref JsonStreamWriter class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef JSON_STREAM_WRITER_H
+#define JSON_STREAM_WRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QJsonArray>
+
+/**
+ * Class that serializes a compact JSON document incrementally.  Large listings can be written one element at a time
+ * so the complete document never needs to exist as a tree of \ref QJsonObject and \ref QJsonArray instances.  Peak
+ * memory is then close to the size of the serialized response rather than several times that size.
+ *
+ * The caller is responsible for balancing calls to the begin and end methods.
+ */
+class JsonStreamWriter {
+    public:
+        /**
+         * Constructor
+         *
+         * \param[in] reserve An optional number of bytes to reserve up front.
+         */
+        explicit JsonStreamWriter(int reserve = 0);
+
+        ~JsonStreamWriter();
+
+        /**
+         * Method that starts a new object, either at the top level or as an array element.
+         */
+        void beginObject();
+
+        /**
+         * Method that starts a new object under a key of the enclosing object.
+         *
+         * \param[in] key The key for the new object.
+         */
+        void beginObject(const QString& key);
+
+        /**
+         * Method that ends the current object.
+         */
+        void endObject();
+
+        /**
+         * Method that starts a new array, either at the top level or as an array element.
+         */
+        void beginArray();
+
+        /**
+         * Method that starts a new array under a key of the enclosing object.
+         *
+         * \param[in] key The key for the new array.
+         */
+        void beginArray(const QString& key);
+
+        /**
+         * Method that ends the current array.
+         */
+        void endArray();
+
+        /**
+         * Method that adds a value under a key of the enclosing object.
+         *
+         * \param[in] key   The key for the value.
+         *
+         * \param[in] value The value to be written.
+         */
+        void insert(const QString& key, const QJsonValue& value);
+
+        /**
+         * Method that adds a value to the enclosing array.
+         *
+         * \param[in] value The value to be written.
+         */
+        void append(const QJsonValue& value);
+
+        /**
+         * Method that returns the serialized document.
+         *
+         * \return Returns the serialized document.
+         */
+        inline const QByteArray& data() const {
+            return currentData;
+        }
+
+    private:
+        /**
+         * Method that writes a separator, if needed, before a new member or element.
+         */
+        void separate();
+
+        /**
+         * Method that writes an escaped key and the trailing colon.
+         *
+         * \param[in] key The key to be written.
+         */
+        void writeKey(const QString& key);
+
+        /**
+         * Method that writes a single value.
+         *
+         * \param[in] value The value to be written.
+         */
+        void writeValue(const QJsonValue& value);
+
+        /**
+         * The serialized document.
+         */
+        QByteArray currentData;
+
+        /**
+         * Stack holding, for each open object or array, whether a member or element has already been written.
+         */
+        QVector<bool> currentNotEmpty;
+};
+
+#endif
@@ -25,10 +25,12 @@
 
 #include <QObject>
 #include <QString>
+#include <QHash>
 
 #include <customers_capabilities.h>
 
-class QTimer;
+#include "periodic_scheduler.h"
+
 class QSqlQuery;
 class DatabaseManager;
 
@@ -68,6 +70,7 @@ class DatabaseManager;
  *         minimum_latency         INTEGER  UNSIGNED NOT NULL,
  *         maximum_latency         INTEGER  UNSIGNED NOT NULL,
  *         number_samples          INTEGER  UNSIGNED NOT NULL,
+ *         latency_sketch          BLOB,
  *         KEY latency_aggregated_constraint_1 (monitor_id),
  *         CONSTRAINT latency_aggregated_constraint_1 FOREIGN KEY (monitor_id)
  *             REFERENCES monitor (monitor_id)
@@ -86,6 +89,17 @@ class LatencyAggregator:public QObject {
     Q_OBJECT
 
     public:
+        /**
+         * The default number of worker threads used to aggregate data.
+         */
+        static const unsigned defaultNumberWorkers;
+
+        /**
+         * Type used to hold the partition period, in seconds, of each time-range partitioned table, keyed by table
+         * name.
+         */
+        typedef QHash<QString, unsigned long> PartitionPeriods;
+
         /**
          * Constructor
          *
@@ -147,7 +161,11 @@ class LatencyAggregator:public QObject {
          * \param[in] expungePeriod          The maximum age for any entry before being expunged.
          *
          * \param[in] inputAlreadyAggregated If true, then the input table will contain additional entries for mean and
-         *                                   variance.
+         *                                   variance.  Aggregated input tables keep their own retention so their
+         *                                   entries are not pruned once aggregated.
+         *
+         * \param[in] inputBlocks            If true, then the input table holds raw entries as compressed blocks.
+         *                                   Only whole blocks are aggregated and pruned.
          */
         void setParameters(
             const QString& inputTableName,
@@ -155,7 +173,8 @@ class LatencyAggregator:public QObject {
             unsigned long  inputTableMaximumAge,
             unsigned long  resamplePeriod,
             unsigned long  expungePeriod,
-            bool           inputAggregated
+            bool           inputAggregated,
+            bool           inputBlocks = false
         );
 
         /**
@@ -169,17 +188,75 @@ class LatencyAggregator:public QObject {
          */
         bool deleteByCustomerId(const CustomersCapabilities::CustomerIdSet& customerIds, unsigned threadId);
 
+        /**
+         * Slot you can trigger to set the number of worker threads used to aggregate data.  Input entries are divided
+         * into contiguous ranges of monitor IDs holding roughly equal numbers of rows with each range aggregated by
+         * its own worker and database connection.
+         *
+         * \param[in] numberWorkers The number of worker threads.  A value of one aggregates on a single thread.
+         */
+        void setNumberWorkers(unsigned numberWorkers);
+
+        /**
+         * Slot you can trigger to indicate that statistics for periods starting at or after a given time are rolled
+         * up as entries arrive.  Input entries in those periods are pruned without being aggregated.
+         *
+         * \param[in] coverageStart The Unix timestamp of the first rolled up period.  A value of zero indicates that
+         *                          every period should be aggregated.
+         */
+        void setRollupCoverageStart(unsigned long long coverageStart);
+
+        /**
+         * Slot you can trigger to set the partition periods of time-range partitioned tables.  Partitions are created
+         * ahead of the entries written to them and partitions holding only expired entries are dropped whole.  Row
+         * deletes are limited to the partition straddling the expunge threshold and the default partition.
+         *
+         * \param[in] partitionPeriods The partition period of each partitioned table.  Tables that are not listed
+         *                             are not extended with new partitions.
+         */
+        void setPartitionPeriods(const PartitionPeriods& partitionPeriods);
+
+        /**
+         * Slot you can trigger to enable or disable periodic aggregation.  Disabled aggregators keep their parameters
+         * but never start so that controllers sharing a database can leave aggregation to a single instance.
+         *
+         * \param[in] nowEnabled If true, aggregation runs at period intervals.  If false, aggregation is suspended.
+         */
+        void setEnabled(bool nowEnabled);
+
+    signals:
+        /**
+         * Signal that is emitted each time an aggregation run completes.
+         */
+        void aggregationFinished();
+
     private:
         /**
          * Method that is triggered to start the aggregation function.
          */
         void startAggregation();
 
+        /**
+         * Method that registers the aggregation task under the current output table name and sets its period so that
+         * it runs at period boundaries.
+         */
+        void updateSchedule();
+
     private:
         /**
-         * Timer used to trigger the underlying aggregator at period intervals.
+         * The name the aggregation task is registered under.
+         */
+        QString currentTaskName;
+
+        /**
+         * The scheduled task used to trigger the underlying aggregator at period intervals.
+         */
+        PeriodicScheduler::TaskId aggregationTaskId;
+
+        /**
+         * Flag indicating if periodic aggregation is enabled.
          */
-        QTimer* aggregationTimer;
+        bool currentEnabled;
 
         /**
          * The underlying implementation.
@@ -0,0 +1,539 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyArchive class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_ARCHIVE_H
+#define LATENCY_ARCHIVE_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+#include "aggregated_latency_entry.h"
+
+class QFile;
+class QSqlDatabase;
+class DatabaseManager;
+class LatencyPopulations;
+class LatencySketch;
+
+/**
+ * Class that moves old latency aggregated entries out of the database into columnar segment files.  Each segment file
+ * holds one week of entries for one shard of the monitors, sorted by monitor, server and start time, with each column
+ * stored contiguously so readers scan only the columns they need.  Segment files are memory mapped and read in place.
+ *
+ * Entries are deleted from the database and recorded in the manifest in a single transaction that only commits once
+ * the segment file is safely written so an entry is never in both places or lost.  Segments are deleted once they age
+ * past the expunge period.
+ *
+ * This class expects a table defined as:
+ *
+ *     CREATE TABLE latency_archive_segments (
+ *         file_name       TEXT NOT NULL PRIMARY KEY,
+ *         start_timestamp INTEGER NOT NULL,
+ *         end_timestamp   INTEGER NOT NULL,
+ *         shard           SMALLINT NOT NULL,
+ *         number_rows     INTEGER NOT NULL
+ *     );
+ */
+class LatencyArchive:public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a Zoran timestamp.
+         */
+        typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+        /**
+         * Type used to represent a list of aggregated latency entries.
+         */
+        typedef QList<AggregatedLatencyEntry> AggregatedLatencyEntryList;
+
+        /**
+         * The period covered by each segment, in seconds.
+         */
+        static const unsigned long segmentPeriod;
+
+        /**
+         * The default age, in seconds, at which entries are archived.
+         */
+        static const unsigned long defaultArchiveAge;
+
+        /**
+         * The default number of shards entries are split across.
+         */
+        static const unsigned defaultNumberShards;
+
+        /**
+         * Trivial class used to select the archived entries to be read.
+         */
+        class Filter {
+            public:
+                /**
+                 * Flag indicating that entries for every monitor should be read.
+                 */
+                bool allMonitors;
+
+                /**
+                 * The monitors to read entries for.  Ignored if \ref allMonitors is true.
+                 */
+                QSet<MonitorId> monitorIds;
+
+                /**
+                 * Flag indicating that entries from every server should be read.
+                 */
+                bool allServers;
+
+                /**
+                 * The servers to read entries from.  Ignored if \ref allServers is true.
+                 */
+                QSet<ServerId> serverIds;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] databaseManager The database manager used to access the latency tables.
+         *
+         * \param[in] parent          Pointer to the parent object.
+         */
+        LatencyArchive(DatabaseManager* databaseManager, QObject* parent = nullptr);
+
+        ~LatencyArchive() override;
+
+        /**
+         * Method you can use to configure archiving.
+         *
+         * \param[in] directory    The directory holding the segment files.  An empty string disables archiving.
+         *
+         * \param[in] archiveAge   The age, in seconds, at which entries are archived.
+         *
+         * \param[in] numberShards The number of shards entries are split across.  Changing this value only affects
+         *                         newly written segments.
+         */
+        void setParameters(const QString& directory, unsigned long archiveAge, unsigned numberShards);
+
+        /**
+         * Method you can use to set the age at which archived entries are deleted.
+         *
+         * \param[in] expungeAge The maximum age of any entry, in seconds.  A value of zero keeps segments forever.
+         */
+        void setExpungeAge(unsigned long expungeAge);
+
+        /**
+         * Method you can use to determine if any archived entries may fall within a time range.
+         *
+         * \param[in] startTimestamp The starting Unix timestamp (inclusive).
+         *
+         * \param[in] endTimestamp   The ending Unix timestamp (inclusive).
+         *
+         * \return Returns true if a segment overlaps the range.
+         */
+        bool covers(unsigned long long startTimestamp, unsigned long long endTimestamp);
+
+        /**
+         * Method you can use to read archived entries.  Entries are selected by their sample timestamp in the same
+         * way as entries in the database.
+         *
+         * \param[in]     filter            The monitors and servers to read entries for.
+         *
+         * \param[in]     startTimestamp    The starting Unix timestamp (inclusive).
+         *
+         * \param[in]     endTimestamp      The ending Unix timestamp (inclusive).
+         *
+         * \param[in,out] aggregatedEntries An optional list that the entries are appended to, ordered by start time,
+         *                                  monitor and server.
+         *
+         * \param[in,out] populations       An optional collection that the statistics of the entries are appended to.
+         *
+         * \param[in,out] latencySketch     An optional sketch that the quantile sketches of the entries are merged
+         *                                  into.
+         *
+         * \return Returns true on success.  Returns false if a segment holds a corrupt sketch.
+         */
+        bool readEntries(
+            const Filter&               filter,
+            unsigned long long          startTimestamp,
+            unsigned long long          endTimestamp,
+            AggregatedLatencyEntryList* aggregatedEntries,
+            LatencyPopulations*         populations,
+            LatencySketch*              latencySketch
+        );
+
+    public slots:
+        /**
+         * Slot you can use to archive entries that have aged past the archive age and delete expired segments.  The
+         * call is ignored if archiving is disabled or already in progress.
+         */
+        void startArchive();
+
+    protected:
+        /**
+         * Method that archives entries in the background.
+         */
+        void run() override;
+
+    private:
+        /**
+         * Value used to identify segment files.
+         */
+        static const char segmentMagic[8];
+
+        /**
+         * The segment file format version.
+         */
+        static const std::uint32_t formatVersion;
+
+        /**
+         * The number of columns in a segment file, excluding the sketch data.
+         */
+        static constexpr unsigned numberColumns = 12;
+
+        /**
+         * The width, in bytes, of each column value.
+         */
+        static const unsigned columnWidths[numberColumns];
+
+        /**
+         * The header at the start of every segment file.  Columns follow the header, each starting on an 8 byte
+         * boundary, in the order monitor ID, server ID, timestamp, latency, start timestamp, end timestamp, mean,
+         * variance, minimum, maximum, number samples and sketch offsets.  The sketch offsets column holds one more
+         * value than the number of rows and indexes the sketch data that follows it.
+         */
+        struct SegmentHeader {
+            /**
+             * The segment magic value.
+             */
+            char magic[8];
+
+            /**
+             * The segment file format version.
+             */
+            std::uint32_t version;
+
+            /**
+             * The number of rows in the segment.
+             */
+            std::uint32_t numberRows;
+
+            /**
+             * The Zoran timestamp of the start of the week covered by the segment.
+             */
+            std::uint32_t startTimestamp;
+
+            /**
+             * The Zoran timestamp of the end of the week covered by the segment.
+             */
+            std::uint32_t endTimestamp;
+
+            /**
+             * The smallest sample timestamp in the segment.
+             */
+            std::uint32_t minimumTimestamp;
+
+            /**
+             * The largest sample timestamp in the segment.
+             */
+            std::uint32_t maximumTimestamp;
+
+            /**
+             * The number of bytes of sketch data.
+             */
+            std::uint64_t sketchBytes;
+
+            /**
+             * Reserved for future use.
+             */
+            std::uint8_t reserved[8];
+        } __attribute__((packed));
+
+        /**
+         * Class holding a single mapped segment file.
+         */
+        class Segment {
+            public:
+                /**
+                 * The segment file name, relative to the archive directory.
+                 */
+                QString fileName;
+
+                /**
+                 * The segment file.
+                 */
+                QFile* file;
+
+                /**
+                 * The mapped segment file.
+                 */
+                uchar* mapping;
+
+                /**
+                 * The segment header.
+                 */
+                const SegmentHeader* header;
+
+                /**
+                 * The monitor ID column.
+                 */
+                const std::uint32_t* monitorIds;
+
+                /**
+                 * The server ID column.
+                 */
+                const std::uint16_t* serverIds;
+
+                /**
+                 * The sample timestamp column.
+                 */
+                const std::uint32_t* timestamps;
+
+                /**
+                 * The sample latency column.
+                 */
+                const std::uint32_t* latencies;
+
+                /**
+                 * The start timestamp column.
+                 */
+                const std::uint32_t* startTimestamps;
+
+                /**
+                 * The end timestamp column.
+                 */
+                const std::uint32_t* endTimestamps;
+
+                /**
+                 * The mean latency column.
+                 */
+                const double* meanLatencies;
+
+                /**
+                 * The latency variance column.
+                 */
+                const double* varianceLatencies;
+
+                /**
+                 * The minimum latency column.
+                 */
+                const std::uint32_t* minimumLatencies;
+
+                /**
+                 * The maximum latency column.
+                 */
+                const std::uint32_t* maximumLatencies;
+
+                /**
+                 * The number of samples column.
+                 */
+                const std::uint32_t* numberSamples;
+
+                /**
+                 * The sketch offsets column.
+                 */
+                const std::uint64_t* sketchOffsets;
+
+                /**
+                 * The sketch data.
+                 */
+                const char* sketches;
+        };
+
+        /**
+         * Type used to hold a shared reference to a segment.  The segment is closed once the last reference is
+         * released so readers can safely scan a segment while it is being expired.
+         */
+        typedef QSharedPointer<Segment> SegmentPointer;
+
+        /**
+         * Type used to hold a list of segments.
+         */
+        typedef QList<SegmentPointer> SegmentList;
+
+        /**
+         * Method that calculates the offset of each column in a segment file.
+         *
+         * \param[in]  numberRows    The number of rows in the segment.
+         *
+         * \param[out] columnOffsets Array populated with the offset of each column.
+         *
+         * \return Returns the offset of the sketch data.
+         */
+        static std::uint64_t columnOffsets(unsigned long numberRows, std::uint64_t* columnOffsets);
+
+        /**
+         * Method that opens and validates a segment file.
+         *
+         * \param[in] directory The archive directory.
+         *
+         * \param[in] fileName  The segment file name.
+         *
+         * \return Returns the segment.  A null pointer is returned on error.
+         */
+        static SegmentPointer openSegment(const QString& directory, const QString& fileName);
+
+        /**
+         * Method that unmaps and closes a segment.
+         *
+         * \param[in] segment The segment to be closed.
+         */
+        static void closeSegment(Segment* segment);
+
+        /**
+         * Method that loads the segments listed in the manifest and removes segment files that are not listed.
+         *
+         * \param[in,out] database  The database instance to be used.
+         *
+         * \param[in]     directory The archive directory.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool loadSegments(QSqlDatabase& database, const QString& directory);
+
+        /**
+         * Method that archives every full week of entries older than a threshold.
+         *
+         * \param[in,out] database     The database instance to be used.
+         *
+         * \param[in]     directory    The archive directory.
+         *
+         * \param[in]     threshold    The Zoran timestamp of the first week to be kept in the database.
+         *
+         * \param[in]     numberShards The number of shards.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool archiveWeeks(
+            QSqlDatabase&  database,
+            const QString& directory,
+            ZoranTimeStamp threshold,
+            unsigned       numberShards
+        );
+
+        /**
+         * Method that archives one week of entries for one shard.
+         *
+         * \param[in,out] database     The database instance to be used.
+         *
+         * \param[in]     directory    The archive directory.
+         *
+         * \param[in]     weekStart    The Zoran timestamp of the start of the week.
+         *
+         * \param[in]     shard        The shard to be archived.
+         *
+         * \param[in]     numberShards The number of shards.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool archiveSegment(
+            QSqlDatabase&  database,
+            const QString& directory,
+            ZoranTimeStamp weekStart,
+            unsigned       shard,
+            unsigned       numberShards
+        );
+
+        /**
+         * Method that deletes segments that end at or before a threshold.
+         *
+         * \param[in,out] database  The database instance to be used.
+         *
+         * \param[in]     directory The archive directory.
+         *
+         * \param[in]     threshold The Zoran expunge threshold.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool expireSegments(QSqlDatabase& database, const QString& directory, ZoranTimeStamp threshold);
+
+        /**
+         * Method that clamps a Unix timestamp to the Zoran timestamp range.
+         *
+         * \param[in] unixTimestamp The Unix timestamp to be converted.
+         *
+         * \return Returns the Zoran timestamp.
+         */
+        static ZoranTimeStamp toZoranTimestamp(unsigned long long unixTimestamp);
+
+        /**
+         * The database manager used to access the latency tables.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * Mutex used to protect the archive parameters.
+         */
+        QMutex parametersMutex;
+
+        /**
+         * The archive directory.  An empty string indicates archiving is disabled.
+         */
+        QString currentDirectory;
+
+        /**
+         * The age, in seconds, at which entries are archived.
+         */
+        unsigned long currentArchiveAge;
+
+        /**
+         * The maximum age of any entry, in seconds.
+         */
+        unsigned long currentExpungeAge;
+
+        /**
+         * The number of shards.
+         */
+        unsigned currentNumberShards;
+
+        /**
+         * The directory the current segments were loaded from.  Only accessed from the archive thread.
+         */
+        QString currentLoadedDirectory;
+
+        /**
+         * Mutex used to protect the segment list.
+         */
+        QMutex segmentsMutex;
+
+        /**
+         * The currently loaded segments.
+         */
+        SegmentList currentSegments;
+};
+
+#endif
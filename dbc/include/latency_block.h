@@ -0,0 +1,166 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyBlock class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_BLOCK_H
+#define LATENCY_BLOCK_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+
+/**
+ * Class that encodes and decodes compressed blocks of latency samples for a single monitor and server.  Each block
+ * covers one \ref blockPeriod and is stored as a single row of the latency_blocks table.
+ *
+ * The serialized form is a sequence of segments.  Each segment holds a varint sample count followed by the first
+ * timestamp and latency as varints.  Each following timestamp is stored as the zig-zag varint of the change in the
+ * interval between samples and each following latency as the varint of the exclusive-or with the previous latency.
+ * Samples taken at a steady rate encode their timestamps in a single byte and similar latencies share their upper
+ * bits so most samples need two to four bytes rather than a full row.
+ *
+ * Segments are self delimiting so the concatenation of two serialized blocks is the serialized form of their union.
+ * This lets each flush append its samples to an existing row with the "||" operator.  The decoder sorts samples by
+ * timestamp and keeps the first sample seen for any duplicated timestamp, matching the behavior of the per-sample
+ * table's primary key.
+ */
+class LatencyBlock {
+    public:
+        /**
+         * Type used to represent a timestamp.
+         */
+        typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+        /**
+         * Type used to represent a latency value.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * Trivial class used to hold a single sample.
+         */
+        class Sample {
+            public:
+                /**
+                 * The sample timestamp, relative to the start of the Zoran epoch.
+                 */
+                ZoranTimeStamp timestamp;
+
+                /**
+                 * The sample latency, in microseconds.
+                 */
+                LatencyMicroseconds latency;
+        };
+
+        /**
+         * Type used to represent a list of samples.
+         */
+        typedef QVector<Sample> SampleList;
+
+        /**
+         * The period covered by each block, in seconds.
+         */
+        static const unsigned long blockPeriod;
+
+        /**
+         * Method you can use to determine the block holding a timestamp.
+         *
+         * \param[in] zoranTimestamp The timestamp, relative to the start of the Zoran epoch.
+         *
+         * \return Returns the timestamp of the first second of the block holding the supplied timestamp.
+         */
+        static inline ZoranTimeStamp blockTimestamp(ZoranTimeStamp zoranTimestamp) {
+            return zoranTimestamp - (zoranTimestamp % blockPeriod);
+        }
+
+        /**
+         * Method you can use to determine the period to align thresholds to so they fall on both a period boundary
+         * and a block boundary.
+         *
+         * \param[in] period The period, in seconds.
+         *
+         * \return Returns the least common multiple of the period and the block period.  The block period is
+         *         returned if the period is zero.
+         */
+        static unsigned long blockAlignedPeriod(unsigned long period);
+
+        /**
+         * Method you can use to encode a list of samples as a single segment.
+         *
+         * \param[in] samples The samples to be encoded.  The samples need not be sorted.
+         *
+         * \return Returns the serialized segment.  An empty array is returned if there are no samples.
+         */
+        static QByteArray encode(SampleList samples);
+
+        /**
+         * Method you can use to decode a serialized block.
+         *
+         * \param[in]  block   The serialized block.
+         *
+         * \param[out] samples The decoded samples, sorted by timestamp.  Any existing contents are replaced.
+         *
+         * \return Returns true on success.  Returns false if the block is empty or malformed.
+         */
+        static bool decode(const QByteArray& block, SampleList& samples);
+
+        /**
+         * Method that appends a varint to a buffer.
+         *
+         * \param[in]     value  The value to be appended.
+         *
+         * \param[in,out] buffer The buffer to append to.
+         */
+        static void appendVarint(std::uint64_t value, QByteArray& buffer);
+
+        /**
+         * Method that reads a varint from a buffer.
+         *
+         * \param[in,out] current A pointer to the next byte to be read.  The pointer is advanced past the value.
+         *
+         * \param[in]     end     A pointer just past the last byte in the buffer.
+         *
+         * \param[out]    value   The value that was read.
+         *
+         * \return Returns true on success.  Returns false if the buffer ended within the value or the value is too
+         *         long.
+         */
+        static inline bool readVarint(const std::uint8_t*& current, const std::uint8_t* end, std::uint64_t& value) {
+            bool          success = false;
+            std::uint64_t result  = 0;
+            unsigned      shift   = 0;
+
+            while (!success && current != end && shift < 64) {
+                std::uint8_t byte = *current++;
+                result  |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                success  = (byte & 0x80) == 0;
+                shift   += 7;
+            }
+
+            value = result;
+            return success;
+        }
+};
+
+#endif
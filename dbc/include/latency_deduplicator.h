@@ -0,0 +1,142 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyDeduplicator class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_DEDUPLICATOR_H
+#define LATENCY_DEDUPLICATOR_H
+
+#include <QSet>
+#include <QPair>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+
+class LatencyEntryChunkList;
+
+/**
+ * Class that drops latency entries resent by polling servers before they reach the database.  Recently seen monitor,
+ * server and timestamp tuples are held in two generations of hash sets.  Once the newer generation holds half the
+ * capacity the older generation is discarded so memory is bounded while every tuple is remembered for at least half
+ * the capacity worth of later entries.  Lookups are exact so an entry is never dropped unless it is a duplicate.
+ *
+ * This class is not thread safe and is intended to be used by a single flush thread.
+ */
+class LatencyDeduplicator {
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a Zoran timestamp.
+         */
+        typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+        /**
+         * The default maximum number of remembered tuples.
+         */
+        static const unsigned long defaultCapacity;
+
+        /**
+         * Constructor
+         *
+         * \param[in] capacity The maximum number of remembered tuples.  A value of zero disables de-duplication.
+         */
+        LatencyDeduplicator(unsigned long capacity = defaultCapacity);
+
+        ~LatencyDeduplicator();
+
+        /**
+         * Method you can use to change the maximum number of remembered tuples.  Remembered tuples are discarded.
+         *
+         * \param[in] newCapacity The new capacity.  A value of zero disables de-duplication.
+         */
+        void setCapacity(unsigned long newCapacity);
+
+        /**
+         * Method you can use to obtain the maximum number of remembered tuples.
+         *
+         * \return Returns the current capacity.
+         */
+        inline unsigned long capacity() const {
+            return currentCapacity;
+        }
+
+        /**
+         * Method you can use to record a tuple.
+         *
+         * \param[in] monitorId      The monitor ID.
+         *
+         * \param[in] serverId       The server ID.
+         *
+         * \param[in] zoranTimestamp The Zoran timestamp.
+         *
+         * \return Returns true if the tuple is new.  Returns false if the tuple was recently seen.
+         */
+        bool insert(MonitorId monitorId, ServerId serverId, ZoranTimeStamp zoranTimestamp);
+
+        /**
+         * Method you can use to remove duplicate entries from a list.  Entries are compacted in place and keep their
+         * order.
+         *
+         * \param[in,out] entries    The list to be filtered.
+         *
+         * \param[in]     firstIndex The index of the first entry to be checked.  Earlier entries are left untouched.
+         *
+         * \return Returns the number of entries removed.
+         */
+        unsigned long filter(LatencyEntryChunkList& entries, unsigned long firstIndex);
+
+        /**
+         * Method you can use to forget every remembered tuple.
+         */
+        void clear();
+
+    private:
+        /**
+         * Type used to identify a tuple.  The first value holds the monitor ID and server ID.
+         */
+        typedef QPair<std::uint64_t, ZoranTimeStamp> Key;
+
+        /**
+         * The maximum number of remembered tuples.
+         */
+        unsigned long currentCapacity;
+
+        /**
+         * The generation receiving new tuples.
+         */
+        QSet<Key> currentGeneration;
+
+        /**
+         * The previous generation.
+         */
+        QSet<Key> previousGeneration;
+};
+
+#endif
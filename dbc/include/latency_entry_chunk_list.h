@@ -0,0 +1,423 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyEntryChunkList class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_ENTRY_CHUNK_LIST_H
+#define LATENCY_ENTRY_CHUNK_LIST_H
+
+#include <QList>
+#include <QMutex>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+
+/**
+ * Class that holds a sequence of latency entries in fixed size, structure-of-arrays chunks.  Chunks are obtained from
+ * and returned to a \ref LatencyEntryChunkList::Pool so that steady state ingest does not touch the heap.  All chunks
+ * except the last are always full which allows entries to be accessed by index.
+ */
+class LatencyEntryChunkList {
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a Zoran timestamp.
+         */
+        typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+        /**
+         * Type used to represent a latency, in microseconds.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * The number of entries held by each chunk.
+         */
+        static constexpr unsigned chunkCapacity = 16384;
+
+        /**
+         * Class holding a single chunk of entries.
+         */
+        class Chunk {
+            public:
+                Chunk():currentSize(0) {}
+
+                /**
+                 * Method you can use to determine the number of entries in this chunk.
+                 *
+                 * \return Returns the number of entries in this chunk.
+                 */
+                inline unsigned size() const {
+                    return currentSize;
+                }
+
+                /**
+                 * Method you can use to determine if this chunk is full.
+                 *
+                 * \return Returns true if the chunk is full.
+                 */
+                inline bool isFull() const {
+                    return currentSize >= chunkCapacity;
+                }
+
+                /**
+                 * Method you can use to empty this chunk.
+                 */
+                inline void clear() {
+                    currentSize = 0;
+                }
+
+                /**
+                 * Method you can use to discard entries from the end of this chunk.
+                 *
+                 * \param[in] newSize The new number of entries.  The value must not exceed the current size.
+                 */
+                inline void truncate(unsigned newSize) {
+                    currentSize = newSize;
+                }
+
+                /**
+                 * Method you can use to append an entry to this chunk.  The chunk must not be full.
+                 *
+                 * \param[in] monitorId           The monitor ID.
+                 *
+                 * \param[in] serverId            The server ID.
+                 *
+                 * \param[in] zoranTimestamp      The Zoran timestamp.
+                 *
+                 * \param[in] latencyMicroseconds The latency, in microseconds.
+                 */
+                inline void append(
+                        MonitorId           monitorId,
+                        ServerId            serverId,
+                        ZoranTimeStamp      zoranTimestamp,
+                        LatencyMicroseconds latencyMicroseconds
+                    ) {
+                    monitorIds[currentSize]            = monitorId;
+                    serverIds[currentSize]             = serverId;
+                    zoranTimestamps[currentSize]       = zoranTimestamp;
+                    latenciesMicroseconds[currentSize] = latencyMicroseconds;
+                    ++currentSize;
+                }
+
+                /**
+                 * Method you can use to obtain an entry from this chunk.
+                 *
+                 * \param[in] index The zero based index of the entry.
+                 *
+                 * \return Returns the requested entry.
+                 */
+                inline LatencyEntry at(unsigned index) const {
+                    return LatencyEntry(
+                        monitorIds[index],
+                        serverIds[index],
+                        zoranTimestamps[index],
+                        latenciesMicroseconds[index]
+                    );
+                }
+
+                /**
+                 * The monitor IDs.
+                 */
+                MonitorId monitorIds[chunkCapacity];
+
+                /**
+                 * The server IDs.
+                 */
+                ServerId serverIds[chunkCapacity];
+
+                /**
+                 * The Zoran timestamps.
+                 */
+                ZoranTimeStamp zoranTimestamps[chunkCapacity];
+
+                /**
+                 * The latencies, in microseconds.
+                 */
+                LatencyMicroseconds latenciesMicroseconds[chunkCapacity];
+
+            private:
+                /**
+                 * The number of entries in this chunk.
+                 */
+                unsigned currentSize;
+        };
+
+        /**
+         * Class that recycles chunks.  This class is thread safe.
+         */
+        class Pool {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] maximumFreeChunks The maximum number of free chunks to retain.  Chunks released beyond
+                 *                              this limit are returned to the heap.
+                 */
+                Pool(unsigned long maximumFreeChunks);
+
+                ~Pool();
+
+                /**
+                 * Method you can use to obtain an empty chunk.
+                 *
+                 * \return Returns a pointer to an empty chunk.
+                 */
+                Chunk* acquire();
+
+                /**
+                 * Method you can use to return a chunk to the pool.
+                 *
+                 * \param[in] chunk The chunk to be returned.
+                 */
+                void release(Chunk* chunk);
+
+                /**
+                 * Method you can use to determine the number of free chunks currently held by the pool.
+                 *
+                 * \return Returns the number of free chunks.
+                 */
+                unsigned long numberFreeChunks() const;
+
+            private:
+                /**
+                 * Mutex used to guard the free list.
+                 */
+                mutable QMutex freeListMutex;
+
+                /**
+                 * The free chunks.
+                 */
+                QList<Chunk*> freeChunks;
+
+                /**
+                 * The maximum number of free chunks to retain.
+                 */
+                unsigned long currentMaximumFreeChunks;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] pool The pool used to obtain and release chunks.
+         */
+        LatencyEntryChunkList(Pool* pool);
+
+        LatencyEntryChunkList(const LatencyEntryChunkList& other) = delete;
+
+        ~LatencyEntryChunkList();
+
+        LatencyEntryChunkList& operator=(const LatencyEntryChunkList& other) = delete;
+
+        /**
+         * Method you can use to append an entry.
+         *
+         * \param[in] monitorId           The monitor ID.
+         *
+         * \param[in] serverId            The server ID.
+         *
+         * \param[in] zoranTimestamp      The Zoran timestamp.
+         *
+         * \param[in] latencyMicroseconds The latency, in microseconds.
+         */
+        inline void append(
+                MonitorId           monitorId,
+                ServerId            serverId,
+                ZoranTimeStamp      zoranTimestamp,
+                LatencyMicroseconds latencyMicroseconds
+            ) {
+            if (chunks.isEmpty() || chunks.last()->isFull()) {
+                chunks.append(currentPool->acquire());
+            }
+
+            chunks.last()->append(monitorId, serverId, zoranTimestamp, latencyMicroseconds);
+            ++currentSize;
+        }
+
+        /**
+         * Method you can use to append an entry.
+         *
+         * \param[in] latencyEntry The entry to be appended.
+         */
+        inline void append(const LatencyEntry& latencyEntry) {
+            append(
+                latencyEntry.monitorId(),
+                latencyEntry.serverId(),
+                latencyEntry.zoranTimestamp(),
+                latencyEntry.latencyMicroseconds()
+            );
+        }
+
+        /**
+         * Method you can use to obtain the number of entries.
+         *
+         * \return Returns the number of entries.
+         */
+        inline unsigned long size() const {
+            return currentSize;
+        }
+
+        /**
+         * Method you can use to determine if this list is empty.
+         *
+         * \return Returns true if the list is empty.
+         */
+        inline bool isEmpty() const {
+            return currentSize == 0;
+        }
+
+        /**
+         * Method you can use to obtain an entry by index.
+         *
+         * \param[in] index The zero based index of the entry.
+         *
+         * \return Returns the requested entry.
+         */
+        inline LatencyEntry at(unsigned long index) const {
+            return chunks.at(static_cast<int>(index / chunkCapacity))->at(static_cast<unsigned>(index % chunkCapacity));
+        }
+
+        /**
+         * Method you can use to overwrite an entry by index.
+         *
+         * \param[in] index        The zero based index of the entry.
+         *
+         * \param[in] latencyEntry The new entry value.
+         */
+        inline void replace(unsigned long index, const LatencyEntry& latencyEntry) {
+            Chunk*   chunk      = chunks.at(static_cast<int>(index / chunkCapacity));
+            unsigned chunkIndex = static_cast<unsigned>(index % chunkCapacity);
+
+            chunk->monitorIds[chunkIndex]            = latencyEntry.monitorId();
+            chunk->serverIds[chunkIndex]             = latencyEntry.serverId();
+            chunk->zoranTimestamps[chunkIndex]       = latencyEntry.zoranTimestamp();
+            chunk->latenciesMicroseconds[chunkIndex] = latencyEntry.latencyMicroseconds();
+        }
+
+        /**
+         * Method you can use to discard entries from the end of this list.  Emptied chunks are returned to the pool.
+         *
+         * \param[in] newSize The new number of entries.  Values larger than the current size are ignored.
+         */
+        void truncate(unsigned long newSize);
+
+        /**
+         * Method you can use to exchange the contents of this list with another list.  Both lists should share the
+         * same pool.
+         *
+         * \param[in,out] other The list to swap with.
+         */
+        void swap(LatencyEntryChunkList& other);
+
+        /**
+         * Method you can use to empty this list, returning all chunks to the pool.
+         */
+        void clear();
+
+        /**
+         * Method you can use to sort the entries by monitor ID, server ID, and timestamp, matching the primary key
+         * order of the latency tables.  The sort is an LSD radix sort and is stable so entries with identical keys
+         * keep their relative order.
+         */
+        void sortByKey();
+
+    private:
+        /**
+         * Flattened copy of an entry used while sorting.
+         */
+        struct SortRecord {
+            MonitorId           monitorId;
+            ZoranTimeStamp      zoranTimestamp;
+            LatencyMicroseconds latencyMicroseconds;
+            ServerId            serverId;
+        };
+
+        /**
+         * Method that performs a single counting sort pass on one byte of the sort key.
+         *
+         * \param[in]  source      The records to be sorted.
+         *
+         * \param[out] destination The location to receive the sorted records.
+         *
+         * \param[in]  count       The number of records.
+         *
+         * \param[in]  digit       The key byte to sort on.  Bytes 0 through 3 are the timestamp, 4 and 5 are the
+         *                         server ID, and 6 through 9 are the monitor ID, least significant byte first.
+         *
+         * eturn Returns true if records were moved into the destination.  Returns false if every record has the
+         *         same value for this byte and the pass was skipped.
+         */
+        static bool radixPass(
+            const SortRecord* source,
+            SortRecord*       destination,
+            unsigned long     count,
+            unsigned          digit
+        );
+
+        /**
+         * Method that extracts a single byte of the sort key from a record.
+         *
+         * \param[in] record The record.
+         *
+         * \param[in] digit  The key byte to extract.
+         *
+         * eturn Returns the requested byte.
+         */
+        static inline unsigned keyByte(const SortRecord& record, unsigned digit) {
+            unsigned result;
+
+            if (digit < 4) {
+                result = (record.zoranTimestamp >> (8 * digit)) & 0xFF;
+            } else if (digit < 6) {
+                result = (record.serverId >> (8 * (digit - 4))) & 0xFF;
+            } else {
+                result = (record.monitorId >> (8 * (digit - 6))) & 0xFF;
+            }
+
+            return result;
+        }
+
+        /**
+         * The pool used to obtain and release chunks.
+         */
+        Pool* currentPool;
+
+        /**
+         * The chunks holding our entries.
+         */
+        QList<Chunk*> chunks;
+
+        /**
+         * The number of entries.
+         */
+        unsigned long currentSize;
+};
+
+#endif
@@ -26,9 +26,15 @@
 #include <QObject>
 #include <QThread>
 #include <QString>
+#include <QByteArray>
 #include <QHash>
+#include <QSet>
 #include <QList>
+#include <QAtomicPointer>
+#include <QAtomicInteger>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
 
 #include <cstdint>
 
@@ -37,9 +43,21 @@
 #include "server.h"
 #include "short_latency_entry.h"
 #include "latency_entry.h"
+#include "latency_entry_chunk_list.h"
+#include "latency_deduplicator.h"
+#include "id_registry.h"
+#include "metrics_registry.h"
+#include "memory_governor.h"
 
 class QTimer;
+class QSqlDatabase;
+struct pg_conn;
 class DatabaseManager;
+class LatencySpool;
+class LatencyRollup;
+class LatencyRingBuffer;
+class LatencyRollingStatistics;
+class ServerHealthStatistics;
 
 /**
  * Class used to cache customer data and flush data to the database in bulk.  You can also query data entries by
@@ -93,19 +111,227 @@ class LatencyInterface:public QThread {
          */
         typedef QList<LatencyEntry> LatencyEntryList;
 
+        /**
+         * Type used to represent a set of monitor IDs.
+         */
+        typedef QSet<MonitorId> MonitorIdSet;
+
+        /**
+         * Structure that defines a latency entry as received from a polling server.  Note that this structure is also
+         * defined in the polling_server project with a with a structure that must match this one.
+         */
+        struct RawEntry {
+            /**
+             * The monitor ID.
+             */
+            std::uint32_t monitorId;
+
+            /**
+             * The Zoran timestamp.
+             */
+            std::uint32_t timestamp;
+
+            /**
+             * The latency in microseconds
+             */
+            std::uint32_t latencyMicroseconds;
+        } __attribute__((packed));
+
         /**
          * Constructor
          *
-         * \param[in] databaseManager The database manager tracking customer data.
+         * \param[in] databaseManager   The database manager tracking customer data.
+         *
+         * \param[in] idRegistry        The registry of valid monitor and server IDs.
+         *
+         * \param[in] ringBuffer        The in-memory buffer of recent entries fed as entries are received.
+         *
+         * \param[in] rollingStatistics The in-memory rolling statistics fed as entries are received.
          *
-         * \param[in] connectionId    An integer value used to mange the database connection unique.
+         * \param[in] serverHealth      The in-memory polling server health statistics fed as entries are received.
          *
-         * \param[in] parent          Pointer to the parent object.
+         * \param[in] connectionId      An integer value used to mange the database connection unique.
+         *
+         * \param[in] parent            Pointer to the parent object.
          */
-        LatencyInterface(DatabaseManager* databaseManager, unsigned connectionId, QObject* parent = nullptr);
+        LatencyInterface(
+            DatabaseManager*          databaseManager,
+            IdRegistry*               idRegistry,
+            LatencyRingBuffer*        ringBuffer,
+            LatencyRollingStatistics* rollingStatistics,
+            ServerHealthStatistics*   serverHealth,
+            unsigned                  connectionId,
+            QObject*                  parent = nullptr
+        );
 
         ~LatencyInterface() override;
 
+        /**
+         * The default number of entries written to the database per transaction.
+         */
+        static const unsigned long defaultFlushBatchSize;
+
+        /**
+         * Method you can use to set the number of entries written to the database per transaction.
+         *
+         * \param[in] newFlushBatchSize The new flush batch size.  A value of zero selects the default.
+         */
+        void setFlushBatchSize(unsigned long newFlushBatchSize);
+
+        /**
+         * Method you can use to set the number of recent monitor, server and timestamp tuples remembered so resent
+         * entries can be dropped before they are written.  Remembered tuples are discarded when the value changes.
+         *
+         * \param[in] newCapacity The new capacity.  A value of zero disables de-duplication.
+         */
+        void setDeduplicationCapacity(unsigned long newCapacity);
+
+        /**
+         * The default number of queued entries that will trigger a flush.
+         */
+        static const unsigned long defaultFlushMaximumEntries;
+
+        /**
+         * The default number of queued bytes that will trigger a flush.
+         */
+        static const unsigned long long defaultFlushMaximumBytes;
+
+        /**
+         * The default maximum age of the oldest queued entry before a flush is triggered, in seconds.
+         */
+        static const unsigned long defaultFlushMaximumAge;
+
+        /**
+         * Method you can use to set the thresholds that trigger a flush.  A flush is triggered as soon as any one of
+         * the thresholds is reached.
+         *
+         * \param[in] maximumEntries The number of queued entries that will trigger a flush.  A value of zero selects
+         *                           the default.
+         *
+         * \param[in] maximumBytes   The number of queued bytes that will trigger a flush.  A value of zero selects the
+         *                           default.
+         *
+         * \param[in] maximumAge     The maximum age of the oldest queued entry, in seconds.  A value of zero selects
+         *                           the default.
+         */
+        void setFlushThresholds(
+            unsigned long      maximumEntries,
+            unsigned long long maximumBytes,
+            unsigned long      maximumAge
+        );
+
+        /**
+         * Method you can use to back this interface with a crash-safe spool.  Entries left in the spool by a previous
+         * run are replayed.  This method must be called before any entries are added.
+         *
+         * \param[in] directory The directory holding the spool for this interface.
+         *
+         * \return Returns true on success.  Returns false on error, in which case entries are held in memory.
+         */
+        bool enableSpool(const QString& directory);
+
+        /**
+         * Method you can use to determine if this interface has entries waiting to be flushed.
+         *
+         * \return Returns true if entries are waiting to be flushed.
+         */
+        bool hasPendingEntries() const;
+
+        /**
+         * Trivial class used to report the ingest pressure on this interface.
+         */
+        class IngestPressure {
+            public:
+                /**
+                 * The number of entries waiting to be flushed.
+                 */
+                unsigned long queueDepth;
+
+                /**
+                 * Flag indicating that producers should hold and batch data locally.
+                 */
+                bool throttled;
+
+                /**
+                 * The suggested delay before the next post, in seconds.  The value is zero if producers are not
+                 * throttled.
+                 */
+                unsigned long retryAfterSeconds;
+        };
+
+        /**
+         * The default queue depth at which producers are throttled.
+         */
+        static const unsigned long defaultIngestHighWatermark;
+
+        /**
+         * The default queue depth at which producers are no longer throttled.
+         */
+        static const unsigned long defaultIngestLowWatermark;
+
+        /**
+         * Method you can use to set the queue depths used to throttle producers.  Producers are throttled once the
+         * queue depth reaches the high watermark and remain throttled until the queue depth falls to the low
+         * watermark.
+         *
+         * \param[in] highWatermark The queue depth at which producers are throttled.  A value of zero selects the
+         *                          default.
+         *
+         * \param[in] lowWatermark  The queue depth at which producers are no longer throttled.
+         */
+        void setIngestWatermarks(unsigned long highWatermark, unsigned long lowWatermark);
+
+        /**
+         * Method you can use to determine the current ingest pressure on this interface.
+         *
+         * \return Returns the current ingest pressure.
+         */
+        IngestPressure ingestPressure();
+
+        /**
+         * Method you can use to set the number of writer threads used to flush entries to the database.  Entries are
+         * sharded across writers by a hash of the monitor ID and each writer uses its own database connection.  The
+         * new value takes effect on the next flush.
+         *
+         * \param[in] numberWriters The number of writer threads.  A value of zero or one flushes entries from the
+         *                          interface's own thread.
+         */
+        void setNumberWriters(unsigned numberWriters);
+
+        /**
+         * Method you can use to determine the number of entries each writer is currently flushing.
+         *
+         * \return Returns a list holding the queue depth of each writer.  The list is empty if this interface flushes
+         *         entries from its own thread.
+         */
+        QList<unsigned long> shardQueueDepths();
+
+        /**
+         * Method you can use to maintain per monitor, server, and period statistics as entries are flushed.  Periods
+         * that end at least the maximum age in the past are written directly to the latency_aggregated table, merged
+         * with any existing row for the same period.  Changes take effect on the next flush.
+         *
+         * \param[in] resamplePeriod The resample period, in seconds.  A value of zero disables rollups.
+         *
+         * \param[in] maximumAge     The age at which periods are closed and written, in seconds.
+         *
+         * \param[in] coverageStart  The Unix timestamp of the first period to be rolled up.  Earlier entries are left
+         *                           to the \ref LatencyAggregator.
+         */
+        void setRollupParameters(
+            unsigned long      resamplePeriod,
+            unsigned long      maximumAge,
+            unsigned long long coverageStart
+        );
+
+        /**
+         * Method you can use to write raw entries as compressed hourly blocks to the latency_blocks table rather than
+         * as individual rows to the latency_seconds table.  The new value takes effect on the next flush.
+         *
+         * \param[in] enabled If true, entries are written as compressed blocks.
+         */
+        void setBlockStorage(bool enabled);
+
     public slots:
         /**
          * Slot you can trigger to add a new entry for a cutomer.
@@ -140,10 +366,39 @@ class LatencyInterface:public QThread {
         void addEntries(const LatencyEntryList& latencyEntries);
 
         /**
-         * Method that starts this thread if it's not actively running.
+         * Slot you can trigger to add a block of raw latency entries received from a polling server.  The payload is
+         * retained, without copying, and the entries are converted by the flush thread.  Only the recent entry
+         * buffer is locked, per monitor stripe, as the entries are copied into it.
+         *
+         * \param[in] serverId      The ID of the region server where these measurements were taken.
+         *
+         * \param[in] payload       The buffer holding the raw entries.
+         *
+         * \param[in] offset        The byte offset to the first \ref RawEntry in the payload.
+         *
+         * \param[in] numberEntries The number of raw entries.
+         */
+        void addEntries(
+            ServerId          serverId,
+            const QByteArray& payload,
+            unsigned long     offset,
+            unsigned long     numberEntries
+        );
+
+        /**
+         * Method that starts this thread if it's not actively running.  Once started, the thread sleeps until a flush
+         * threshold is reached or shutdown is requested.
          */
         void receivedEntries();
 
+    signals:
+        /**
+         * Signal that is emitted from the flush thread after entries have been written to the database.
+         *
+         * \param[out] monitorIds The IDs of the monitors that received new entries.
+         */
+        void entriesWritten(const LatencyInterface::MonitorIdSet& monitorIds);
+
     protected:
         /**
          * Method that runs this thread.
@@ -151,30 +406,428 @@ class LatencyInterface:public QThread {
         void run() override;
 
     private:
+        /**
+         * Class used to flush one shard of a region's entries from a dedicated thread.
+         */
+        class ShardWriter:public QThread {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] owner        The interface that owns this writer.
+                 *
+                 * \param[in] databaseName The name of the database connection used by this writer.
+                 */
+                ShardWriter(LatencyInterface* owner, const QString& databaseName);
+
+                ~ShardWriter() override;
+
+                /**
+                 * Method you can use to access the entries to be written.  The entries must only be modified while
+                 * the writer is idle.
+                 *
+                 * \return Returns a reference to the entries to be written.
+                 */
+                LatencyEntryChunkList& entries();
+
+                /**
+                 * Method that wakes the writer to flush its entries.
+                 */
+                void startWrite();
+
+                /**
+                 * Method that blocks until the writer has flushed its entries.
+                 *
+                 * \return Returns true if the entries were written.  Returns false if the entries were abandoned at
+                 *         shutdown.
+                 */
+                bool waitForWrite();
+
+                /**
+                 * Method you can use to determine the number of entries this writer is flushing.
+                 *
+                 * \return Returns the current queue depth.
+                 */
+                unsigned long queueDepth() const;
+
+            protected:
+                /**
+                 * Method that runs this thread.
+                 */
+                void run() override;
+
+            private:
+                /**
+                 * The interface that owns this writer.
+                 */
+                LatencyInterface* currentOwner;
+
+                /**
+                 * The name of the database connection used by this writer.
+                 */
+                QString currentDatabaseName;
+
+                /**
+                 * The entries to be written.
+                 */
+                LatencyEntryChunkList currentEntries;
+
+                /**
+                 * The number of entries this writer is flushing.
+                 */
+                QAtomicInteger<quint64> currentQueueDepth;
+
+                /**
+                 * Mutex used with the writer condition.
+                 */
+                QMutex writerMutex;
+
+                /**
+                 * Wait condition used to signal the writer and the flush thread.
+                 */
+                QWaitCondition writerCondition;
+
+                /**
+                 * Flag indicating that a write has been requested and is not yet complete.
+                 */
+                bool writeRequested;
+
+                /**
+                 * Flag indicating that the last write succeeded.
+                 */
+                bool writeSucceeded;
+
+                /**
+                 * Flag indicating that the writer thread should exit.
+                 */
+                bool stopRequested;
+        };
+
+        /**
+         * Trivial class used to identify the compressed block for a single monitor, server, and block period.
+         */
+        class BlockKey {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] monitorId      The monitor ID.
+                 *
+                 * \param[in] serverId       The server ID.
+                 *
+                 * \param[in] blockTimestamp The Zoran timestamp of the first second of the block.
+                 */
+                BlockKey(MonitorId monitorId, ServerId serverId, ZoranTimeStamp blockTimestamp);
+
+                /**
+                 * Comparison operator.  Keys are ordered by monitor ID, server ID and block timestamp.
+                 *
+                 * \param[in] other The instance to compare against.
+                 *
+                 * \return Returns true if this key precedes the other key.
+                 */
+                bool operator<(const BlockKey& other) const;
+
+                /**
+                 * The monitor ID.
+                 */
+                MonitorId monitorId;
+
+                /**
+                 * The server ID.
+                 */
+                ServerId serverId;
+
+                /**
+                 * The Zoran timestamp of the first second of the block.
+                 */
+                ZoranTimeStamp blockTimestamp;
+        };
+
+        /**
+         * Trivial class used to hold a block of incoming entries pending conversion by the flush thread.  Blocks are
+         * linked into a lock-free, multiple producer, single consumer stack.
+         */
+        class IncomingBlock {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] rawPayload       The buffer holding the raw entries.
+                 *
+                 * \param[in] rawOffset        The byte offset to the first raw entry.
+                 *
+                 * \param[in] rawNumberEntries The number of raw entries.
+                 *
+                 * \param[in] rawServerId      The server ID to apply to every raw entry.
+                 */
+                IncomingBlock(
+                        const QByteArray& rawPayload,
+                        unsigned long     rawOffset,
+                        unsigned long     rawNumberEntries,
+                        ServerId          rawServerId
+                    ):next(
+                        nullptr
+                    ),payload(
+                        rawPayload
+                    ),offset(
+                        rawOffset
+                    ),numberEntries(
+                        rawNumberEntries
+                    ),numberBytes(
+                        rawNumberEntries * sizeof(RawEntry)
+                    ),serverId(
+                        rawServerId
+                    ) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] latencyEntries Already decoded latency entries.
+                 */
+                IncomingBlock(
+                        const LatencyEntryList& latencyEntries
+                    ):next(
+                        nullptr
+                    ),offset(
+                        0
+                    ),numberEntries(
+                        static_cast<unsigned long>(latencyEntries.size())
+                    ),numberBytes(
+                        static_cast<unsigned long>(latencyEntries.size()) * sizeof(LatencyEntry)
+                    ),serverId(
+                        0
+                    ),entries(
+                        latencyEntries
+                    ) {}
+
+                /**
+                 * The next block in the stack.
+                 */
+                IncomingBlock* next;
+
+                /**
+                 * The buffer holding the raw entries.  Empty if this block holds decoded entries.
+                 */
+                QByteArray payload;
+
+                /**
+                 * The byte offset to the first raw entry.
+                 */
+                unsigned long offset;
+
+                /**
+                 * The number of entries in this block.
+                 */
+                unsigned long numberEntries;
+
+                /**
+                 * The approximate memory footprint of the entries in this block, in bytes.
+                 */
+                unsigned long numberBytes;
+
+                /**
+                 * The server ID to apply to every raw entry.
+                 */
+                ServerId serverId;
+
+                /**
+                 * Already decoded entries.
+                 */
+                LatencyEntryList entries;
+        };
+
+        /**
+         * Method that pushes a block onto the incoming stack.  This method is lock-free and can be called from any
+         * thread.
+         *
+         * \param[in] block The block to be pushed.  This class takes ownership of the block.
+         */
+        void pushIncomingBlock(IncomingBlock* block);
+
+        /**
+         * Method that records newly queued entries and wakes the flush thread if needed.  This method is lock-free in
+         * the common case.
+         *
+         * \param[in] newEntries The number of newly queued entries.
+         *
+         * \param[in] newBytes   The approximate memory footprint of the newly queued entries, in bytes.
+         */
+        void queuedEntries(unsigned long newEntries, unsigned long newBytes);
+
+        /**
+         * Method that takes every incoming block and appends the entries, in arrival order, to the in process entry
+         * list.  If a spool is in use, spooled entries are then read up to the flush entry threshold.  This method
+         * must only be called from the flush thread.
+         */
+        void drainIncomingBlocks();
+
+        /**
+         * Method that wakes the flush thread.
+         */
+        void wakeFlushThread();
+
+        /**
+         * Method that determines if a flush is due.  The flush mutex must be locked when this method is called.
+         *
+         * \param[out] waitMilliseconds The time to wait before checking again, in milliseconds, if a flush is not yet
+         *                              due.
+         *
+         * \return Returns true if a flush is due.  Returns false if a flush is not yet due.
+         */
+        bool flushDue(unsigned long& waitMilliseconds) const;
+
+        /**
+         * Method that determines the number of entries waiting to be flushed.
+         *
+         * \return Returns the number of queued entries.
+         */
+        unsigned long numberQueuedEntries();
+
         /**
          * Method that is called to flush entries.
          */
         void performFlush();
 
         /**
-         * Time to sleep while the incoming data queue is empty, in seconds.
+         * Method that writes entries to the database, retrying until the entries are written or shutdown is requested.
+         * The entries are cleared on return.
+         *
+         * \param[in] entries      The entries to be written.
+         *
+         * \param[in] databaseName The name of the database connection to use.
+         *
+         * \return Returns true if the entries were written.  Returns false if the entries were abandoned at shutdown.
+         */
+        bool writeEntries(LatencyEntryChunkList& entries, const QString& databaseName);
+
+        /**
+         * Method that applies the current rollup parameters and adds the in process entries to the rollup.  This
+         * method must only be called from the flush thread.
+         */
+        void accumulateRollups();
+
+        /**
+         * Method that writes closed rollup periods to the database.  Periods that could not be written are retained
+         * and retried on the next flush.  This method must only be called from the flush thread.
+         *
+         * \param[in] databaseName The name of the database connection to use.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool writeRollups(const QString& databaseName);
+
+        /**
+         * Method that selects the writer for a monitor.
+         *
+         * \param[in] monitorId     The monitor ID.
+         *
+         * \param[in] numberWriters The number of writers.
+         *
+         * \return Returns the zero based writer index.
+         */
+        static inline unsigned shardIndex(MonitorId monitorId, unsigned numberWriters) {
+            // Fibonacci hashing spreads sequentially allocated monitor IDs evenly across the writers.
+            std::uint32_t hash = static_cast<std::uint32_t>(monitorId) * 0x9E3779B1U;
+            return static_cast<unsigned>((static_cast<std::uint64_t>(hash) * numberWriters) >> 32);
+        }
+
+        /**
+         * Method that bulk loads a batch of in-process entries using the PostgreSQL binary COPY protocol.  Entries are
+         * copied into a temporary staging table and then merged into the latency table in a single statement.  The
+         * caller is expected to have opened a transaction.
+         *
+         * \param[in] database   The database to write to.
+         *
+         * \param[in] connection The underlying PostgreSQL connection handle.
+         *
+         * \param[in] validIds   The registry snapshot used to discard entries for unknown monitors and servers.
+         *
+         * \param[in] entries    The entries to be written.
+         *
+         * \param[in] baseIndex  The index of the first entry to be written.
+         *
+         * \param[in] count      The number of entries to be written.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool copyEntries(
+            QSqlDatabase&                database,
+            pg_conn*                     connection,
+            const IdRegistry::Snapshot&  validIds,
+            const LatencyEntryChunkList& entries,
+            unsigned long                baseIndex,
+            unsigned long                count
+        );
+
+        /**
+         * Method that writes a batch of in-process entries using multi-row INSERT statements.  This method is used
+         * with database drivers that do not support COPY.
+         *
+         * \param[in] database  The database to write to.
+         *
+         * \param[in] validIds  The registry snapshot used to discard entries for unknown monitors and servers.
+         *
+         * \param[in] entries   The entries to be written.
+         *
+         * \param[in] baseIndex The index of the first entry to be written.
+         *
+         * \param[in] count     The number of entries to be written.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool insertEntries(
+            QSqlDatabase&                database,
+            const IdRegistry::Snapshot&  validIds,
+            const LatencyEntryChunkList& entries,
+            unsigned long                baseIndex,
+            unsigned long                count
+        );
+
+        /**
+         * Method that writes a batch of in-process entries as compressed blocks.  Entries are grouped by monitor,
+         * server, and block period and each group is appended to its block with a multi-row upsert.  The caller is
+         * expected to have opened a transaction.
+         *
+         * \param[in] database  The database to write to.
+         *
+         * \param[in] validIds  The registry snapshot used to discard entries for unknown monitors and servers.
+         *
+         * \param[in] entries   The entries to be written.
+         *
+         * \param[in] baseIndex The index of the first entry to be written.
+         *
+         * \param[in] count     The number of entries to be written.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool insertBlocks(
+            QSqlDatabase&                database,
+            const IdRegistry::Snapshot&  validIds,
+            const LatencyEntryChunkList& entries,
+            unsigned long                baseIndex,
+            unsigned long                count
+        );
+
+        /**
+         * Value used to indicate that no entries are queued.
          */
-        static const unsigned queueCheckInterval;
+        static const qint64 noQueuedEntries;
 
         /**
-         * Number of queue check cycles before forcing a flush.
+         * The maximum number of rows per multi-row INSERT statement.
          */
-        static const unsigned numberCyclesBeforeForcedCommit;
+        static const unsigned long maximumRowsPerStatement;
 
         /**
-         * The ideal maximum number of entries we allow before we trigger a flush.
+         * The size of the buffer used to stream COPY data, in bytes.
          */
-        static const unsigned long maximumNumberCachedEntries;
+        static const int copyBufferSize;
 
         /**
-         * The maximum number of rows per database transaction.
+         * The minimum suggested delay reported to throttled producers, in seconds.
          */
-        static const unsigned long maximumRowsPerTransaction;
+        static const unsigned minimumRetryAfterSeconds;
 
         /**
          * The interval to wait before retrying a database operation.
@@ -182,32 +835,239 @@ class LatencyInterface:public QThread {
         static const unsigned retryIntervalMilliseconds;
 
         /**
-         * Mutex used to gate changes to the incoming entries.
+         * The top of the lock-free stack of incoming blocks.
+         */
+        QAtomicPointer<IncomingBlock> incomingBlocks;
+
+        /**
+         * The total number of entries held in the incoming blocks.
+         */
+        QAtomicInteger<quint64> numberIncomingEntries;
+
+        /**
+         * The approximate memory footprint of the entries held in the incoming blocks, in bytes.
+         */
+        QAtomicInteger<quint64> numberIncomingBytes;
+
+        /**
+         * The number of entries held by the flush in progress.  Used only to report memory usage.
+         */
+        QAtomicInteger<quint64> numberFlushingEntries;
+
+        /**
+         * Time, relative to the flush clock, when the oldest queued entry arrived, in milliseconds.
+         */
+        QAtomicInteger<qint64> oldestEntryMilliseconds;
+
+        /**
+         * Time, relative to the flush clock, when the oldest entry of the flush in progress arrived, in milliseconds.
+         * Only accessed by the flush thread.
+         */
+        qint64 flushOldestEntryMilliseconds;
+
+        /**
+         * Flag indicating that a producer has already woken the flush thread for a size threshold.
+         */
+        QAtomicInt sizeThresholdSignalled;
+
+        /**
+         * Clock used to track the age of queued entries.
+         */
+        QElapsedTimer flushClock;
+
+        /**
+         * Mutex used with the flush condition.
+         */
+        QMutex flushMutex;
+
+        /**
+         * Wait condition used to wake the flush thread.
+         */
+        QWaitCondition flushCondition;
+
+        /**
+         * Pool of recycled chunks used by the in process entry list.
          */
-        QMutex incomingEntriesMutex;
+        LatencyEntryChunkList::Pool chunkPool;
 
         /**
-         * Table of incoming cached entries by slug and customer.
+         * Table of in process cached entries by slug and customer.  Only accessed by the flush thread.
          */
-        LatencyEntryList* currentIncomingEntries;
+        LatencyEntryChunkList currentInProcessEntries;
 
         /**
-         * Table of in process cached entries by slug and customer.
+         * The crash-safe spool backing this interface.  A null pointer indicates that entries are held in memory.
          */
-        LatencyEntryList* currentInProcessEntries;
+        LatencySpool* currentSpool;
+
+        /**
+         * The running statistics for recent periods.  A null pointer indicates that rollups are disabled.  Only
+         * accessed by the flush thread.
+         */
+        LatencyRollup* currentRollup;
+
+        /**
+         * Mutex protecting the rollup parameters.
+         */
+        QMutex rollupParametersMutex;
+
+        /**
+         * The requested rollup resample period, in seconds.  A value of zero disables rollups.
+         */
+        unsigned long currentRollupResamplePeriod;
+
+        /**
+         * The age at which rollup periods are closed, in seconds.
+         */
+        unsigned long currentRollupMaximumAge;
+
+        /**
+         * The Unix timestamp of the first period to be rolled up.
+         */
+        unsigned long long currentRollupCoverageStart;
 
         /**
          * The current database manager.
          */
         DatabaseManager* currentDatabaseManager;
 
+        /**
+         * The registry of valid monitor and server IDs.
+         */
+        IdRegistry* currentIdRegistry;
+
+        /**
+         * The in-memory buffer of recent entries.
+         */
+        LatencyRingBuffer* currentRingBuffer;
+
+        /**
+         * The in-memory rolling statistics.
+         */
+        LatencyRollingStatistics* currentRollingStatistics;
+
+        /**
+         * The in-memory polling server health statistics.
+         */
+        ServerHealthStatistics* currentServerHealth;
+
         /**
          * The unique connection identifier for this connection.
          */
         unsigned currentConnectionId;
 
         /**
-         * Flag that is set to indicate that we should shutdown the background thread.
+         * The number of entries written to the database per transaction.
+         */
+        QAtomicInteger<quint64> currentFlushBatchSize;
+
+        /**
+         * The requested number of remembered tuples.  Applied by the flush thread.
+         */
+        QAtomicInteger<quint64> currentDeduplicationCapacity;
+
+        /**
+         * The recently seen tuples.  Only accessed from the flush thread.
+         */
+        LatencyDeduplicator currentDeduplicator;
+
+        /**
+         * The number of queued entries that will trigger a flush.
+         */
+        QAtomicInteger<quint64> currentFlushMaximumEntries;
+
+        /**
+         * The number of queued bytes that will trigger a flush.
+         */
+        QAtomicInteger<quint64> currentFlushMaximumBytes;
+
+        /**
+         * The maximum age of the oldest queued entry, in milliseconds.
+         */
+        QAtomicInteger<quint64> currentFlushMaximumAgeMilliseconds;
+
+        /**
+         * The queue depth at which producers are throttled.
+         */
+        QAtomicInteger<quint64> currentIngestHighWatermark;
+
+        /**
+         * The queue depth at which producers are no longer throttled.
+         */
+        QAtomicInteger<quint64> currentIngestLowWatermark;
+
+        /**
+         * The measured rate of the most recent successful flush, in entries per second.
+         */
+        QAtomicInteger<quint64> currentFlushRate;
+
+        /**
+         * The labels identifying this interface's metrics.
+         */
+        QString metricLabels;
+
+        /**
+         * Histogram tracking the duration of successful flushes.
+         */
+        MetricsRegistry::Histogram* flushDurationMetric;
+
+        /**
+         * Counter tracking the number of entries flushed to the database.
+         */
+        MetricsRegistry::Counter* flushedEntriesMetric;
+
+        /**
+         * Counter tracking the number of entries received from polling servers.
+         */
+        MetricsRegistry::Counter* receivedEntriesMetric;
+
+        /**
+         * Counter tracking the number of duplicate entries dropped before being written.
+         */
+        MetricsRegistry::Counter* duplicateEntriesMetric;
+
+        /**
+         * Histogram tracking the time from receipt of the oldest entry in a flush until the flush is committed.
+         */
+        MetricsRegistry::Histogram* ingestLagMetric;
+
+        /**
+         * Flag indicating that producers are currently throttled.
+         */
+        QAtomicInt ingestThrottled;
+
+        /**
+         * The memory pressure stage last reported by the \ref MemoryGovernor.
+         */
+        QAtomicInt memoryStage;
+
+        /**
+         * The ID used to register this interface with the \ref MemoryGovernor.
+         */
+        MemoryGovernor::ConsumerId memoryConsumerId;
+
+        /**
+         * The number of writer threads to be used on the next flush.
+         */
+        QAtomicInteger<quint32> currentNumberWriters;
+
+        /**
+         * Flag holding a non-zero value if entries are written as compressed blocks.
+         */
+        QAtomicInt currentBlockStorage;
+
+        /**
+         * Mutex protecting the list of shard writers.
+         */
+        QMutex shardWritersMutex;
+
+        /**
+         * The shard writers.  Only modified by the flush thread.
+         */
+        QList<ShardWriter*> shardWriters;
+
+        /**
+         * Flag that is set to indicate that we should shutdown the background thread.  Protected by the flush mutex.
          */
         bool shutdownRequested;
 };
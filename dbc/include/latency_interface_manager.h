@@ -28,6 +28,8 @@
 #include <QHash>
 #include <QList>
 #include <QMutex>
+#include <QAtomicPointer>
+#include <QAtomicInteger>
 #include <QPair>
 #include <QSqlDatabase>
 
@@ -41,11 +43,22 @@
 #include "short_latency_entry.h"
 #include "latency_entry.h"
 #include "latency_interface.h"
+#include "latency_purger.h"
+#include "latency_archive.h"
 #include "aggregated_latency_entry.h"
+#include "latency_sketch.h"
+#include "latency_ring_buffer.h"
+#include "latency_rolling_statistics.h"
+#include "server_health_statistics.h"
+#include "latency_result_cache.h"
+#include "query_executor.h"
+#include "memory_governor.h"
 
 class QTimer;
 class DatabaseManager;
 class LatencyAggregator;
+class LatencyPopulations;
+class Catalog;
 
 /**
  * Class used to manage a collection of latency interface classes.  This class exists to allow for greater
@@ -75,14 +88,66 @@ class LatencyInterfaceManager:public QObject {
          */
         typedef QPair<LatencyEntryList, AggregatedLatencyEntryList> LatencyEntryLists;
 
+        /**
+         * Type used to represent a set of monitor IDs.
+         */
+        typedef LatencyInterface::MonitorIdSet MonitorIdSet;
+
+        /**
+         * Type used to return latency statistics for several monitors.
+         */
+        typedef QHash<LatencyEntry::MonitorId, AggregatedLatencyEntry> LatencyStatisticsByMonitorId;
+
+        /**
+         * Type used to return rolling latency statistics for several monitors.
+         */
+        typedef LatencyRollingStatistics::SummariesByMonitorId RollingStatisticsByMonitorId;
+
+        /**
+         * Trivial class used to describe a coarser aggregation tier fed from the next finer tier.
+         */
+        class AggregationTier {
+            public:
+                /**
+                 * The name of the table holding this tier.
+                 */
+                QString tableName;
+
+                /**
+                 * The resample period for this tier, in seconds.  The value should be a multiple of the next finer
+                 * tier's resample period.
+                 */
+                unsigned long resamplePeriod;
+
+                /**
+                 * The age at which entries in this tier are expunged, in seconds.
+                 */
+                unsigned long expungeAge;
+        };
+
+        /**
+         * Type used to represent a chain of aggregation tiers, finest first.
+         */
+        typedef QList<AggregationTier> AggregationTierList;
+
         /**
          * Constructor
          *
          * \param[in] databaseManager The database manager class we use to create database instances.
          *
+         * \param[in] idRegistry      The registry of valid monitor and server IDs.
+         *
+         * \param[in] catalog         The in-memory catalog used to resolve the monitors read from the recent entry
+         *                            buffer.
+         *
          * \param[in] parent          Pointer to the parent object.
          */
-        LatencyInterfaceManager(DatabaseManager* databaseManager, QObject* parent = nullptr);
+        LatencyInterfaceManager(
+            DatabaseManager* databaseManager,
+            IdRegistry*      idRegistry,
+            Catalog*         catalog,
+            QObject*         parent = nullptr
+        );
 
         ~LatencyInterfaceManager() override;
 
@@ -116,7 +181,13 @@ class LatencyInterfaceManager:public QObject {
          *
          * \param[in] threadId       The optional thread ID of the thread we're operating under.
          *
-         * \return Returns a pair of latency entries holding regular and aggregated data.
+         * \param[in] resolution     The coarsest acceptable spacing between aggregated entries, in seconds.  Older
+         *                           data is read from the coarsest aggregation tier that satisfies this resolution.
+         *                           A value of zero always reads the finest tier.
+         *
+         * \return Returns a pair of latency entries holding regular and aggregated data.  Identical concurrent
+         *         requests share a single read and results are briefly cached until new data for the customer is
+         *         written.
          */
         LatencyEntryLists getLatencyEntries(
             CustomerCapabilities::CustomerId customerId,
@@ -126,7 +197,57 @@ class LatencyInterfaceManager:public QObject {
             Server::ServerId                 serverId,
             unsigned long long               startTimestamp = 0,
             unsigned long long               endTimestamp = std::numeric_limits<unsigned long long>::max(),
-            unsigned                         threadId = 0
+            unsigned                         threadId = 0,
+            unsigned long                    resolution = 0
+        );
+
+        /**
+         * Method you can use to obtain latency data downsampled into fixed intervals.  Each interval holds the
+         * combined mean, variance, minimum and maximum of the raw and aggregated entries for one monitor and one
+         * server.  The coarsest aggregation tier satisfying the interval is read.
+         *
+         * \param[in]  customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
+         *                            all customers.
+         *
+         * \param[in]  hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
+         *                            invalid host/scheme ID indicates the monitor ID should be used.
+         *
+         * \param[in]  monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
+         *                            monitor ID indicates all monitors.
+         *
+         * \param[in]  regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in]  serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                            indicates all servers.
+         *
+         * \param[in]  startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]  endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]  resolution     The minimum interval width, in seconds.
+         *
+         * \param[in]  maximumPoints  The maximum number of intervals per monitor and server.  A value of 0 places no
+         *                            limit on the number of intervals.
+         *
+         * \param[in]  threadId       The optional thread ID of the thread we're operating under.
+         *
+         * \param[out] interval       An optional pointer populated with the interval width used, in seconds.
+         *
+         * \return Returns the downsampled entries ordered by monitor ID, server ID and time.  Each entry's start and
+         *         end timestamps bound its interval.
+         */
+        AggregatedLatencyEntryList getLatencyBuckets(
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            unsigned long                    resolution,
+            unsigned long                    maximumPoints,
+            unsigned                         threadId = 0,
+            unsigned long*                   interval = nullptr
         );
 
         /**
@@ -152,7 +273,11 @@ class LatencyInterfaceManager:public QObject {
          *
          * \param[in] threadId       The optional thread ID of the thread we're operating under.
          *
-         * \return Returns an aggregated latency entry holding the captured statistics.
+         * \param[out] latencySketch An optional pointer to a sketch populated with the quantile sketch of the
+         *                           requested window.
+         *
+         * \return Returns an aggregated latency entry holding the captured statistics.  Whole periods of the coarsest
+         *         aggregation tier are used where possible with finer tiers covering the edges of the window.
          */
         AggregatedLatencyEntry getLatencyStatistics(
             CustomerCapabilities::CustomerId customerId,
@@ -162,9 +287,86 @@ class LatencyInterfaceManager:public QObject {
             Server::ServerId                 serverId,
             unsigned long long               startTimestamp = 0,
             unsigned long long               endTimestamp = std::numeric_limits<unsigned long long>::max(),
-            unsigned                         threadId = 0
+            unsigned                         threadId = 0,
+            LatencySketch*                   latencySketch = nullptr
+        );
+
+        /**
+         * Method you can use to obtain latency statistics for many monitors of a customer at once.  Each aggregation
+         * tier and the raw entries are read with a single query grouped by monitor so the cost is close to that of
+         * \ref LatencyInterfaceManager::getLatencyStatistics for one monitor.
+         *
+         * \param[in] customerId     The ID of the customer requesting this data.  Must be a valid customer ID.
+         *
+         * \param[in] monitorIds     The monitors of interest.  An empty set indicates every monitor of the customer.
+         *
+         * \param[in] regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in] serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                           indicates all servers.
+         *
+         * \param[in] startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in] endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in] threadId       The optional thread ID of the thread we're operating under.
+         *
+         * \param[out] success       An optional pointer to a flag holding true on exit if successful.
+         *
+         * \return Returns the statistics of each monitor with data in the window.
+         */
+        LatencyStatisticsByMonitorId getBulkLatencyStatistics(
+            CustomerCapabilities::CustomerId customerId,
+            const MonitorIdSet&              monitorIds,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp = 0,
+            unsigned long long               endTimestamp = std::numeric_limits<unsigned long long>::max(),
+            unsigned                         threadId = 0,
+            bool*                            success = nullptr
+        );
+
+        /**
+         * Method you can use to obtain the rolling latency statistics of many monitors of a customer.  Statistics are
+         * read from memory and include entries not yet flushed to the database.
+         *
+         * \param[in]  customerId The ID of the customer requesting this data.  Must be a valid customer ID.
+         *
+         * \param[in]  monitorIds The monitors of interest.  An empty set indicates every monitor of the customer.
+         *                        Monitors not owned by the customer are ignored.
+         *
+         * \param[in]  serverId   The server ID of the server we want latency data from.  An invalid server ID
+         *                        combines every server.
+         *
+         * \param[in]  window     The window of interest.
+         *
+         * \param[in]  threadId   The optional thread ID of the thread we're operating under.
+         *
+         * \param[out] success    An optional pointer to a flag holding true on exit if successful.
+         *
+         * \return Returns the statistics of each monitor with recent samples.
+         */
+        RollingStatisticsByMonitorId getRollingStatistics(
+            CustomerCapabilities::CustomerId customerId,
+            const MonitorIdSet&              monitorIds,
+            Server::ServerId                 serverId,
+            LatencyRollingStatistics::Window window,
+            unsigned                         threadId = 0,
+            bool*                            success = nullptr
         );
 
+        /**
+         * Method you can use to obtain the version of the latency data tied to a monitor.  The version changes each
+         * time new entries for the monitor are written and each time an aggregation run completes.  This method is
+         * thread safe.
+         *
+         * \param[in] monitorId The monitor ID of the monitor of interest.  An invalid monitor ID returns a version that
+         *                      changes when data for any monitor changes.
+         *
+         * \return Returns the current data version.
+         */
+        unsigned long long dataVersion(LatencyEntry::MonitorId monitorId = Monitor::invalidMonitorId) const;
+
     public slots:
         /**
          * Slot you can trigger to add a new entry for a cutomer.
@@ -216,6 +418,41 @@ class LatencyInterfaceManager:public QObject {
          */
         bool deleteByCustomerId(const CustomersCapabilities::CustomerIdSet& customerIds, unsigned threadId);
 
+        /**
+         * Method you can use to queue a background purge of latency entries for a set of users.  Entries are deleted
+         * from the raw table and every aggregation tier in throttled batches.
+         *
+         * \param[in] customerIds The customer IDs of the users to have entries deleted for.
+         *
+         * \param[in] threadId    The ID of the thread used to record the purge job.
+         *
+         * \return Returns the ID of the purge job.  The value \ref LatencyPurger::invalidJobId is returned on error.
+         */
+        LatencyPurger::JobId startPurge(const CustomersCapabilities::CustomerIdSet& customerIds, unsigned threadId);
+
+        /**
+         * Method you can use to obtain the progress of a purge job.
+         *
+         * \param[in]  jobId     The ID of the purge job.
+         *
+         * \param[out] jobStatus The job's progress.
+         *
+         * \param[in]  threadId  The ID of the thread used to read the job status.
+         *
+         * \return Returns true on success.  Returns false if the job does not exist or on error.
+         */
+        bool getPurgeStatus(LatencyPurger::JobId jobId, LatencyPurger::JobStatus& jobStatus, unsigned threadId);
+
+        /**
+         * Method you can use to set the batch size and rate limit used by purge jobs.  Unfinished purge jobs are
+         * resumed once the limits are set.
+         *
+         * \param[in] batchSize     The number of rows deleted per transaction.
+         *
+         * \param[in] rowsPerSecond The maximum number of rows deleted per second.
+         */
+        void setPurgeThrottle(unsigned long batchSize, unsigned long rowsPerSecond);
+
         /**
          * Method you can use to set the input and output table and table type.
          *
@@ -235,136 +472,1245 @@ class LatencyInterfaceManager:public QObject {
             bool           inputAggregated
         );
 
-    private:
         /**
-         * Method that gets raw latency entries.
-         *
-         * \param[out]    success        Flag holding true on exit if successful.
-         *
-         * \param[in,out] database       The database instance to be used.
+         * Method you can use to set the number of worker threads used to aggregate latency entries.
          *
-         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
-         *                               all customers.
+         * \param[in] numberWorkers The number of aggregation worker threads.
+         */
+        void setNumberAggregationWorkers(unsigned numberWorkers);
+
+        /**
+         * Method you can use to set the number of worker threads used to read raw latency entries concurrently with
+         * aggregated latency entries.
          *
-         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
-         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         * \param[in] numberWorkers The number of query worker threads.  A value of 0 reads raw entries from the
+         *                          calling thread.
+         */
+        void setNumberQueryWorkers(unsigned numberWorkers);
+
+        /**
+         * Method you can use to set how long recent raw entries are held in memory.  Reads of raw entries inside this
+         * window are served from memory and include entries not yet flushed to the database.
          *
-         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
-         *                               monitor ID indicates all monitors.
+         * \param[in] retentionSeconds The retention window, in seconds.  A value of 0 reads every raw entry from the
+         *                             database.
+         */
+        void setRecentRetention(unsigned long retentionSeconds);
+
+        /**
+         * Method you can use to enable or disable the rolling statistics kept as entries are received.
          *
-         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         * \param[in] nowEnabled If true, rolling statistics are tracked.  If false, rolling statistics are discarded.
+         */
+        void setRollingStatisticsEnabled(bool nowEnabled);
+
+        /**
+         * Method you can use to obtain the rolling statistics kept as entries are received.
          *
-         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
-         *                               indicates all servers.
+         * \return Returns a pointer to the rolling statistics.  The rolling statistics are owned by this class.
+         */
+        LatencyRollingStatistics* rollingStatistics();
+
+        /**
+         * Method you can use to obtain the polling server health statistics kept as entries are received.
          *
-         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         * \return Returns a pointer to the server health statistics.  The statistics are owned by this class.
+         */
+        ServerHealthStatistics* serverHealth();
+
+        /**
+         * Method you can use to configure the cache of latency entry query results.
          *
-         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         * \param[in] maximumCacheDepth      The maximum number of cached results.
          *
-         * \return Returns a list of captured \ref LatencyEntry instances.
+         * \param[in] timeToLiveMilliseconds The time a result remains valid, in milliseconds.  A value of 0 disables
+         *                                   caching although identical concurrent requests still share one read.
          */
-        LatencyEntryList getRawEntries(
-            bool&                            success,
-            QSqlDatabase&                    database,
-            CustomerCapabilities::CustomerId customerId,
-            HostScheme::HostSchemeId         hostSchemeId,
-            LatencyEntry::MonitorId          monitorId,
-            Region::RegionId                 regionId,
-            Server::ServerId                 serverId,
-            unsigned long long               startTimestamp,
-            unsigned long long               endTimestamp
-        );
+        void setResultCache(unsigned long maximumCacheDepth, unsigned long timeToLiveMilliseconds);
 
         /**
-         * Method that gets aggregated latency entries.
-         *
-         * \param[out]    success        Flag holding true on exit if successful.
+         * Method you can use to obtain the statistics for the cache of latency entry query results.
          *
-         * \param[in,out] database       The database instance to be used.
+         * \return Returns the cache statistics.
+         */
+        CacheBase::Statistics resultCacheStatistics() const;
+
+        /**
+         * Method you can use to set the number of raw entries written to the database per transaction.
          *
-         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
-         *                               all customers.
+         * \param[in] flushBatchSize The new flush batch size.
+         */
+        void setFlushBatchSize(unsigned long flushBatchSize);
+
+        /**
+         * Method you can use to set the number of recent monitor, server and timestamp tuples each latency interface
+         * remembers so resent entries are dropped before they are written.
          *
-         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
-         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         * \param[in] capacity The number of remembered tuples.  A value of zero disables de-duplication.
+         */
+        void setDeduplicationCapacity(unsigned long capacity);
+
+        /**
+         * Method you can use to set the thresholds that trigger a flush of queued latency entries.
          *
-         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
-         *                               monitor ID indicates all monitors.
+         * \param[in] maximumEntries The number of queued entries that will trigger a flush.
          *
-         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         * \param[in] maximumBytes   The number of queued bytes that will trigger a flush.
          *
-         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
-         *                               indicates all servers.
+         * \param[in] maximumAge     The maximum age of the oldest queued entry, in seconds.
+         */
+        void setFlushThresholds(unsigned long maximumEntries, unsigned long long maximumBytes, unsigned long maximumAge);
+
+        /**
+         * Method you can use to place latency entries in a crash-safe spool, one sub-directory per region.  Regions
+         * with entries left in the spool by a previous run are started immediately so the entries are replayed.  The
+         * spool directory can only be set before the first latency entry is received.
          *
-         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         * \param[in] spoolDirectory The spool directory.  An empty string holds latency entries in memory.
+         */
+        void setSpoolDirectory(const QString& spoolDirectory);
+
+        /**
+         * Method you can use to set the queue depths used to throttle polling servers.
          *
-         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         * \param[in] highWatermark The queue depth at which polling servers are throttled.
          *
-         * \return Returns a list of captured \ref LatencyEntry instances.
+         * \param[in] lowWatermark  The queue depth at which polling servers are no longer throttled.
          */
-        AggregatedLatencyEntryList getAggregatedEntries(
-            bool&                            success,
-            QSqlDatabase&                    database,
-            CustomerCapabilities::CustomerId customerId,
-            HostScheme::HostSchemeId         hostSchemeId,
-            LatencyEntry::MonitorId          monitorId,
-            Region::RegionId                 regionId,
-            Server::ServerId                 serverId,
-            unsigned long long               startTimestamp,
-            unsigned long long               endTimestamp
-        );
+        void setIngestWatermarks(unsigned long highWatermark, unsigned long lowWatermark);
 
         /**
-         * Method that gets raw latency entry statistics.
-         *
-         * \param[out]    success        Flag holding true on exit if successful.
+         * Type used to represent a number of writer threads by region.
+         */
+        typedef QHash<RegionId, unsigned> NumberWritersByRegion;
+
+        /**
+         * Method you can use to set the number of writer threads used to flush each region's latency entries.
          *
-         * \param[in,out] database       The database instance to be used.
+         * \param[in] defaultNumberWriters  The number of writer threads for regions not listed explicitly.
          *
-         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
-         *                               all customers.
+         * \param[in] numberWritersByRegion The number of writer threads for specific regions.
+         */
+        void setNumberWriters(unsigned defaultNumberWriters, const NumberWritersByRegion& numberWritersByRegion);
+
+        /**
+         * Method you can use to compute aggregated statistics as latency entries arrive rather than by re-reading
+         * raw entries from the database.  Rollups cover periods starting after rollups are enabled.  The aggregator
+         * continues to aggregate earlier periods and prunes raw entries for covered periods.
          *
-         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
-         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         * \param[in] enabled If true, ingest-time rollups are enabled.
+         */
+        void setIngestRollups(bool enabled);
+
+        /**
+         * Method you can use to store raw entries as compressed hourly blocks in the latency_blocks table rather than
+         * as individual rows in the latency_seconds table.  Raw entry queries and the aggregator read from the
+         * selected table.  Entries already in the other table are not migrated so the mode should be selected before
+         * entries are collected or once the other table has been drained by the aggregator.
          *
-         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
-         *                               monitor ID indicates all monitors.
+         * \param[in] enabled If true, block storage is enabled.
+         */
+        void setBlockStorage(bool enabled);
+
+        /**
+         * Method you can use to configure a chain of coarser aggregation tiers.  The first tier is fed from the
+         * latency_aggregated table and each later tier is fed from the tier before it.  Each tier is aggregated once
+         * the tier feeding it has completed a full period.
          *
-         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         * \param[in] aggregationTiers The aggregation tiers, finest first.  An empty list disables tiering.
+         */
+        void setAggregationTiers(const AggregationTierList& aggregationTiers);
+
+        /**
+         * Type used to hold the partition period, in seconds, of each time-range partitioned latency table, keyed by
+         * table name.
+         */
+        typedef QHash<QString, unsigned long> PartitionPeriods;
+
+        /**
+         * Method you can use to set the partition periods of time-range partitioned latency tables.  Partitions are
+         * created ahead of time and expired partitions are dropped whole rather than deleted row by row.
          *
-         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
-         *                               indicates all servers.
+         * \param[in] partitionPeriods The partition period of each partitioned table.
+         */
+        void setPartitionPeriods(const PartitionPeriods& partitionPeriods);
+
+        /**
+         * Method you can use to configure archiving of old latency aggregated entries to columnar segment files.
+         * Archived entries are read transparently by queries against the latency aggregated table.
          *
-         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         * \param[in] directory    The directory holding the segment files.  An empty string disables archiving.
          *
-         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         * \param[in] archiveAge   The age, in seconds, at which entries are archived.  The value should be larger
+         *                         than the age at which the coarsest aggregation tier reads entries.
          *
-         * \return Returns a list of captured \ref LatencyEntry instances.
+         * \param[in] numberShards The number of shards monitors are split across.
          */
-        AggregatedLatencyEntry getRawEntryStatistics(
-            bool&                            success,
-            QSqlDatabase&                    database,
-            CustomerCapabilities::CustomerId customerId,
-            HostScheme::HostSchemeId         hostSchemeId,
-            LatencyEntry::MonitorId          monitorId,
-            Region::RegionId                 regionId,
-            Server::ServerId                 serverId,
-            unsigned long long               startTimestamp,
-            unsigned long long               endTimestamp
-        );
+        void setArchive(const QString& directory, unsigned long archiveAge, unsigned numberShards);
 
         /**
-         * Method that builds a select query based on a set of constraints.
-         *
-         * \param[in] tableName      The name of the table to build the query for.
-         *
-         * \param[in] customerId     The ID of the customer requesting this data.  An invalid customer ID indicates all
-         *                           customers.
+         * Method you can use to enable or disable background aggregation.  Regional ingest relays share the central
+         * database and disable aggregation so that aggregated tables and the archive are maintained by a single
+         * controller.
          *
-         * \param[in] hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An invalid
-         *                           host/scheme ID indicates the monitor ID should be used.
+         * \param[in] nowEnabled If true, aggregation runs at period intervals.  If false, entries are only written.
+         */
+        void setAggregationEnabled(bool nowEnabled);
+
+    private slots:
+        /**
+         * Slot that is triggered from a flush thread when latency entries have been written.
          *
-         * \param[in] monitorId      The monitor ID of the monitor we wish latency information for.  An invalid monitor
+         * \param[in] monitorIds The IDs of the monitors that received new entries.
+         */
+        void entriesWritten(const LatencyInterface::MonitorIdSet& monitorIds);
+
+        /**
+         * Slot that is triggered when an aggregation run completes.
+         */
+        void aggregationFinished();
+
+    private:
+        /**
+         * Class used to combine the entries falling in one downsampling interval.
+         */
+        class Bucket {
+            public:
+                /**
+                 * Trivial class used to identify an interval for a single monitor and server.
+                 */
+                class Key {
+                    public:
+                        /**
+                         * Constructor
+                         *
+                         * \param[in] monitorId The monitor ID.
+                         *
+                         * \param[in] serverId  The server ID.
+                         *
+                         * \param[in] index     The zero based index of the interval.
+                         */
+                        Key(
+                            LatencyEntry::MonitorId monitorId,
+                            LatencyEntry::ServerId  serverId,
+                            unsigned long long      index
+                        );
+
+                        /**
+                         * Comparison operator.  Keys are ordered by monitor ID, server ID and interval.
+                         *
+                         * \param[in] other The instance to compare against.
+                         *
+                         * \return Returns true if this key precedes the other key.
+                         */
+                        bool operator<(const Key& other) const;
+
+                        /**
+                         * The monitor ID.
+                         */
+                        LatencyEntry::MonitorId monitorId;
+
+                        /**
+                         * The server ID.
+                         */
+                        LatencyEntry::ServerId serverId;
+
+                        /**
+                         * The zero based index of the interval.
+                         */
+                        unsigned long long index;
+                };
+
+                Bucket();
+
+                /**
+                 * Method that adds a sub-population to this interval.  Empty sub-populations are ignored.
+                 *
+                 * \param[in] meanLatency     The mean latency of the sub-population, in microseconds.
+                 *
+                 * \param[in] varianceLatency The population variance of the sub-population.
+                 *
+                 * \param[in] minimumLatency  The minimum latency of the sub-population, in microseconds.
+                 *
+                 * \param[in] maximumLatency  The maximum latency of the sub-population, in microseconds.
+                 *
+                 * \param[in] numberSamples   The number of samples in the sub-population.
+                 */
+                void add(
+                    double                            meanLatency,
+                    double                            varianceLatency,
+                    LatencyEntry::LatencyMicroseconds minimumLatency,
+                    LatencyEntry::LatencyMicroseconds maximumLatency,
+                    unsigned long long                numberSamples
+                );
+
+                /**
+                 * The number of samples in this interval.
+                 */
+                unsigned long long numberSamples;
+
+                /**
+                 * The mean latency, in microseconds.
+                 */
+                double meanLatency;
+
+                /**
+                 * The sum of squared deviations from the mean, in microseconds squared.
+                 */
+                double sumSquaredDeviations;
+
+                /**
+                 * The minimum latency, in microseconds.
+                 */
+                LatencyEntry::LatencyMicroseconds minimumLatency;
+
+                /**
+                 * The maximum latency, in microseconds.
+                 */
+                LatencyEntry::LatencyMicroseconds maximumLatency;
+        };
+
+        /**
+         * Type used to accumulate statistics for several monitors.
+         */
+        typedef QHash<LatencyEntry::MonitorId, Bucket> BucketsByMonitorId;
+
+        /**
+         * Class used to read raw latency entries, or their statistics, on a query worker while the calling thread
+         * reads the aggregated entries.
+         */
+        class RawQueryJob:public QueryExecutor::Job {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] manager        The manager that owns this job.
+                 *
+                 * \param[in] customerId     The ID of the customer requesting this data.
+                 *
+                 * \param[in] hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.
+                 *
+                 * \param[in] monitorId      The monitor ID of the monitor we wish latency information for.
+                 *
+                 * \param[in] regionId       The region ID of the desired region.
+                 *
+                 * \param[in] serverId       The server ID of the server we want latency data from.
+                 *
+                 * \param[in] startTimestamp The starting timestamp (inclusive) that we want information for.
+                 *
+                 * \param[in] endTimestamp   The ending timestamp (inclusive) that we want information for.
+                 *
+                 * \param[in] statistics     If true, the job reads raw entry statistics.  If false, the job reads
+                 *                           the raw entries.
+                 *
+                 * \param[in] includeSketch  If true, the job also builds a quantile sketch of the raw entries.  Only
+                 *                           used when reading statistics.
+                 */
+                RawQueryJob(
+                    LatencyInterfaceManager*         manager,
+                    CustomerCapabilities::CustomerId customerId,
+                    HostScheme::HostSchemeId         hostSchemeId,
+                    LatencyEntry::MonitorId          monitorId,
+                    Region::RegionId                 regionId,
+                    Server::ServerId                 serverId,
+                    unsigned long long               startTimestamp,
+                    unsigned long long               endTimestamp,
+                    bool                             statistics,
+                    bool                             includeSketch
+                );
+
+                ~RawQueryJob() override;
+
+                /**
+                 * Method that is called from a query worker to read the raw entries.
+                 */
+                void run() override;
+
+                /**
+                 * Method you can use to determine if the query succeeded.
+                 *
+                 * \return Returns true on success.  Returns false on error.
+                 */
+                bool succeeded() const;
+
+                /**
+                 * Method you can use to obtain the raw entries.
+                 *
+                 * \return Returns the raw entries read by this job.
+                 */
+                const LatencyEntryList& entries() const;
+
+                /**
+                 * Method you can use to obtain the raw entry statistics.
+                 *
+                 * \return Returns the raw entry statistics read by this job.
+                 */
+                const AggregatedLatencyEntry& statistics() const;
+
+                /**
+                 * Method you can use to obtain the quantile sketch of the raw entries.
+                 *
+                 * \return Returns the quantile sketch built by this job.
+                 */
+                const LatencySketch& sketch() const;
+
+            private:
+                /**
+                 * The manager that owns this job.
+                 */
+                LatencyInterfaceManager* currentManager;
+
+                /**
+                 * The requested customer ID.
+                 */
+                CustomerCapabilities::CustomerId currentCustomerId;
+
+                /**
+                 * The requested host/scheme ID.
+                 */
+                HostScheme::HostSchemeId currentHostSchemeId;
+
+                /**
+                 * The requested monitor ID.
+                 */
+                LatencyEntry::MonitorId currentMonitorId;
+
+                /**
+                 * The requested region ID.
+                 */
+                Region::RegionId currentRegionId;
+
+                /**
+                 * The requested server ID.
+                 */
+                Server::ServerId currentServerId;
+
+                /**
+                 * The requested starting timestamp.
+                 */
+                unsigned long long currentStartTimestamp;
+
+                /**
+                 * The requested ending timestamp.
+                 */
+                unsigned long long currentEndTimestamp;
+
+                /**
+                 * Flag indicating that statistics rather than entries are read.
+                 */
+                bool currentStatistics;
+
+                /**
+                 * Flag indicating that a quantile sketch should be built.
+                 */
+                bool currentIncludeSketch;
+
+                /**
+                 * Flag indicating that the query succeeded.
+                 */
+                bool currentSuccess;
+
+                /**
+                 * The raw entries.
+                 */
+                LatencyEntryList currentEntries;
+
+                /**
+                 * The raw entry statistics.
+                 */
+                AggregatedLatencyEntry currentStatisticsEntry;
+
+                /**
+                 * The quantile sketch of the raw entries.
+                 */
+                LatencySketch currentSketch;
+        };
+
+        /**
+         * Method that determines if every raw entry at or before a timestamp has been folded into the aggregated
+         * tables and purged from the raw table.  As with the aggregation tiers, the aggregator is given two resample
+         * periods beyond the aggregation age to complete its pass.
+         *
+         * \param[in] endTimestamp The ending timestamp (inclusive) of the requested window.
+         *
+         * \return Returns true if the raw table can be skipped for the window.
+         */
+        bool rawEntriesAggregated(unsigned long long endTimestamp);
+
+        /**
+         * Method that determines the oldest timestamp guaranteed to still be held in the raw table.  Older raw
+         * entries may already have been folded into the aggregated tables.
+         *
+         * \return Returns the oldest Unix timestamp guaranteed to be unaggregated.
+         */
+        unsigned long long oldestUnaggregatedTimestamp();
+
+        /**
+         * Method that reads latency entries from memory and the database.
+         *
+         * \param[out] success        Flag holding true on exit if successful.
+         *
+         * \param[in]  customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]  hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]  monitorId      The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]  regionId       The region ID of the desired region.
+         *
+         * \param[in]  serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]  startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]  endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]  threadId       The thread ID of the thread we're operating under.
+         *
+         * \param[in]  resolution     The coarsest acceptable spacing between aggregated entries, in seconds.
+         *
+         * \return Returns a pair of latency entries holding regular and aggregated data.
+         */
+        LatencyEntryLists readLatencyEntries(
+            bool&                            success,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            unsigned                         threadId,
+            unsigned long                    resolution
+        );
+
+        /**
+         * Method that obtains the data version used to tag a cached query result.
+         *
+         * \param[in] customerId The ID of the customer being queried.  An invalid customer ID indicates all
+         *                       customers.
+         *
+         * \param[in] monitorId  The ID of the monitor being queried.  An invalid monitor ID indicates all monitors.
+         *
+         * \return Returns the data version.  The version changes whenever data covered by the query is written.
+         */
+        unsigned long long resultDataVersion(
+            CustomerCapabilities::CustomerId customerId,
+            LatencyEntry::MonitorId          monitorId
+        ) const;
+
+        /**
+         * Method that reads recent raw entries from the in-memory buffer.
+         *
+         * \param[in]  customerId     The customer ID of the customer to get entries for.
+         *
+         * \param[in]  hostSchemeId   The host/scheme ID of the host/scheme to get entries for.
+         *
+         * \param[in]  monitorId      The monitor ID of the monitor to get entries for.
+         *
+         * \param[in]  regionId       The region ID of the region to get entries for.
+         *
+         * \param[in]  serverId       The server ID of the server to get entries for.
+         *
+         * \param[in]  startTimestamp The starting timestamp (inclusive).
+         *
+         * \param[in]  endTimestamp   The ending timestamp (inclusive).
+         *
+         * \param[in]  threadId       The thread ID used to obtain the catalog snapshot.
+         *
+         * \param[out] rawEntries     The list populated with the recent raw entries.
+         *
+         * \return Returns the Unix timestamp where the buffer's coverage starts.  Raw entries before this timestamp
+         *         must be read from the database.  The maximum unsigned long long value is returned if the buffer
+         *         can not serve the request.
+         */
+        unsigned long long getRecentEntries(
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            unsigned                         threadId,
+            LatencyEntryList&                rawEntries
+        );
+
+        /**
+         * Method that pushes the current rollup parameters to the latency interfaces and aggregator.  The access mutex
+         * must be locked when this method is called.
+         */
+        void applyRollupParameters();
+
+        /**
+         * Method that pushes the current input table and parameters to the aggregator reading raw entries.  The access
+         * mutex must be locked when this method is called.
+         */
+        void applyAggregatorParameters();
+
+        /**
+         * Method that configures the aggregators feeding each aggregation tier.  The access mutex must be locked when
+         * this method is called.
+         */
+        void applyAggregationTiers();
+
+        /**
+         * Method that selects the aggregation tier used to read older data.
+         *
+         * \param[in]  startTimestamp The starting timestamp of the requested window.
+         *
+         * \param[in]  resolution     The coarsest acceptable spacing between entries, in seconds.
+         *
+         * \param[out] tableName      The name of the selected tier's table.
+         *
+         * \param[out] tierEnd        The Unix timestamp where the selected tier's complete periods end.  Newer data
+         *                            should be read from the latency_aggregated table.
+         *
+         * \return Returns true if a coarser tier was selected.  Returns false if only the latency_aggregated table
+         *         should be used.
+         */
+        bool selectAggregationTier(
+            unsigned long long  startTimestamp,
+            unsigned long       resolution,
+            QString&            tableName,
+            unsigned long long& tierEnd
+        );
+
+        /**
+         * Method that selects the coarsest aggregation tier holding at least one whole period of a window.
+         *
+         * \param[in]  startTimestamp The starting Unix timestamp (inclusive) of the window.
+         *
+         * \param[in]  endTimestamp   The ending Unix timestamp (inclusive) of the window.
+         *
+         * \param[in]  numberTiers    The number of finest tiers to consider.
+         *
+         * \param[out] tierIndex      The index of the selected tier.
+         *
+         * \param[out] tableName      The name of the selected tier's table.
+         *
+         * \param[out] alignedStart   The Unix timestamp where the selected tier's whole periods start.
+         *
+         * \param[out] alignedEnd     The Unix timestamp where the selected tier's whole periods end (exclusive).
+         *
+         * 
+eturn Returns true if a tier was selected.  Returns false if only the latency_aggregated table should be
+         *         used.
+         */
+        bool selectSpanningTier(
+            unsigned long long  startTimestamp,
+            unsigned long long  endTimestamp,
+            unsigned            numberTiers,
+            unsigned&           tierIndex,
+            QString&            tableName,
+            unsigned long long& alignedStart,
+            unsigned long long& alignedEnd
+        );
+
+        /**
+         * Method that gets aggregated latency data, reading older data from the selected aggregation tier.
+         *
+         * \param[out]    success           Flag holding true on exit if successful.
+         *
+         * \param[in,out] database          The database instance to be used.
+         *
+         * \param[in]     customerId        The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId      The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId         The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId          The region ID of the desired region.
+         *
+         * \param[in]     serverId          The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp    The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp      The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     resolution        The coarsest acceptable spacing between entries, in seconds.
+         *
+         * \param[in,out] aggregatedEntries An optional list that the aggregated entries are appended to.
+         *
+         * \param[in,out] populations       An optional collection that the statistics of the aggregated entries are
+         *                                  appended to.
+         *
+         * \param[in,out] latencySketch     An optional sketch that the quantile sketches of the aggregated entries are
+         *                                  merged into.
+         */
+        void getTieredAggregatedData(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            unsigned long                    resolution,
+            AggregatedLatencyEntryList*      aggregatedEntries,
+            LatencyPopulations*              populations,
+            LatencySketch*                   latencySketch
+        );
+
+        /**
+         * Method that gets aggregated statistics for a window.  Whole periods of the coarsest tier are read from that
+         * tier, typically the daily summary, and the partial periods at either edge are read from successively finer
+         * tiers.  The number of rows read is therefore nearly independent of the window length.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     numberTiers    The number of finest tiers that may be used.
+         *
+         * \param[in,out] populations    The collection that the statistics of the aggregated entries are appended to.
+         *
+         * \param[in,out] latencySketch  An optional sketch that the quantile sketches of the aggregated entries are
+         *                               merged into.
+         */
+        void getSpanningAggregatedData(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            unsigned                         numberTiers,
+            LatencyPopulations&              populations,
+            LatencySketch*                   latencySketch
+        );
+
+        /**
+         * Method that gets aggregated statistics for a window, by monitor.  Tiers are selected as by
+         * \ref LatencyInterfaceManager::getSpanningAggregatedData.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     monitorIds     The monitors of interest.  An empty set indicates every monitor of the
+         *                               customer.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     numberTiers    The number of finest tiers that may be used.
+         *
+         * \param[in,out] buckets        The per-monitor statistics to be updated.
+         */
+        void getSpanningGroupedStatistics(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            const MonitorIdSet&              monitorIds,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            unsigned                         numberTiers,
+            BucketsByMonitorId&              buckets
+        );
+
+        /**
+         * Method that gets aggregated statistics for a window of a single tier, by monitor.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     monitorIds     The monitors of interest.  An empty set indicates every monitor of the
+         *                               customer.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     tableName      The name of the aggregated table to read.
+         *
+         * \param[in,out] buckets        The per-monitor statistics to be updated.
+         */
+        void getGroupedSegmentStatistics(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            const MonitorIdSet&              monitorIds,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            const QString&                   tableName,
+            BucketsByMonitorId&              buckets
+        );
+
+        /**
+         * Method that builds the filter used to read archived entries for a query.
+         *
+         * \param[out]    success      Flag holding true on exit if successful.
+         *
+         * \param[in,out] database     The database instance to be used.
+         *
+         * \param[in]     customerId   The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId    The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId     The region ID of the desired region.
+         *
+         * \param[in]     serverId     The server ID of the server we want latency data from.
+         *
+         * \return Returns the archive filter.
+         */
+        static LatencyArchive::Filter buildArchiveFilter(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId
+        );
+
+        /**
+         * Method that gets aggregated latency data from a single table.
+         *
+         * \param[out]    success           Flag holding true on exit if successful.
+         *
+         * \param[in,out] database          The database instance to be used.
+         *
+         * \param[in]     customerId        The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId      The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId         The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId          The region ID of the desired region.
+         *
+         * \param[in]     serverId          The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp    The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp      The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     tableName         The name of the aggregated table to read.
+         *
+         * \param[in,out] aggregatedEntries An optional list that the aggregated entries are appended to.
+         *
+         * \param[in,out] populations       An optional collection that the statistics of the aggregated entries are
+         *                                  appended to.
+         *
+         * \param[in,out] latencySketch     An optional sketch that the quantile sketches of the aggregated entries are
+         *                                  merged into.
+         */
+        void getAggregatedSegment(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            const QString&                   tableName,
+            AggregatedLatencyEntryList*      aggregatedEntries,
+            LatencyPopulations*              populations,
+            LatencySketch*                   latencySketch
+        );
+
+        /**
+         * Method that appends the statistics of aggregated entries to a population collection.  Only the statistics
+         * columns are read so no intermediate entries are created.
+         *
+         * \param[out]    success           Flag holding true on exit if successful.
+         *
+         * \param[in,out] database          The database instance to be used.
+         *
+         * \param[in]     customerId        The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId      The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId         The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId          The region ID of the desired region.
+         *
+         * \param[in]     serverId          The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp    The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp      The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     tableName         The name of the aggregated table to read.
+         *
+         * \param[in,out] populations       The collection to append to.
+         */
+        void getAggregatedPopulations(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            const QString&                   tableName,
+            LatencyPopulations&              populations
+        );
+
+        /**
+         * Method that gets raw latency entries.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
+         *                               all customers.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
+         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
+         *                               monitor ID indicates all monitors.
+         *
+         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                               indicates all servers.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \return Returns a list of captured \ref LatencyEntry instances.
+         */
+        LatencyEntryList getRawEntries(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp
+        );
+
+        /**
+         * Method that reads raw latency entries from the block storage table.  Blocks overlapping the time range are
+         * decoded and samples outside of the range are discarded.
+         *
+         * \param[out]    success        A reference to a boolean value holding true on success.
+         *
+         * \param[in,out] database       The database to query.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
+         *                               all customers.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
+         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
+         *                               monitor ID indicates all monitors.
+         *
+         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                               indicates all servers.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \return Returns a list of captured \ref LatencyEntry instances sorted by timestamp, monitor, and server.
+         */
+        LatencyEntryList getBlockEntries(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp
+        );
+
+        /**
+         * Method that calculates statistics for raw latency entries held in the block storage table.  The blocks are
+         * decoded once and the sketch, if requested, is built from the same samples.
+         *
+         * \param[out]    success        A reference to a boolean value holding true on success.
+         *
+         * \param[in,out] database       The database to query.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in,out] latencySketch  The sketch to add entries to.  A null pointer can be used if no sketch is
+         *                               needed.
+         *
+         * \return Returns the statistics for the entries.
+         */
+        AggregatedLatencyEntry getBlockEntryStatistics(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            LatencySketch*                   latencySketch
+        );
+
+        /**
+         * Method that gets aggregated latency entries.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
+         *                               all customers.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
+         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
+         *                               monitor ID indicates all monitors.
+         *
+         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                               indicates all servers.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     tableName      The name of the aggregated table to read.
+         *
+         * \return Returns a list of captured \ref LatencyEntry instances.
+         */
+        AggregatedLatencyEntryList getAggregatedEntries(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            const QString&                   tableName
+        );
+
+        /**
+         * Method that gets raw latency entry statistics.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.  An invalid customer ID indicates
+         *                               all customers.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An
+         *                               invalid host/scheme ID indicates the monitor ID should be used.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.  An invalid
+         *                               monitor ID indicates all monitors.
+         *
+         * \param[in]     regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                               indicates all servers.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \return Returns a list of captured \ref LatencyEntry instances.
+         */
+        AggregatedLatencyEntry getRawEntryStatistics(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp
+        );
+
+        /**
+         * Method that gets raw latency entry statistics, by monitor.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     monitorIds     The monitors of interest.  An empty set indicates every monitor of the
+         *                               customer.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in,out] buckets        The per-monitor statistics to be updated.
+         */
+        void getGroupedRawEntryStatistics(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            const MonitorIdSet&              monitorIds,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            BucketsByMonitorId&              buckets
+        );
+
+        /**
+         * Method that merges the stored quantile sketches of aggregated entries into a sketch.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     tableName      The name of the aggregated table to read.
+         *
+         * \param[in,out] latencySketch  The sketch to merge into.
+         */
+        void getAggregatedSketch(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            const QString&                   tableName,
+            LatencySketch&                   latencySketch
+        );
+
+        /**
+         * Method that adds raw latency entries to a quantile sketch.  Entries are bucketed by the database so only
+         * one row per occupied bucket is returned.
+         *
+         * \param[out]    success        Flag holding true on exit if successful.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     customerId     The ID of the customer requesting this data.
+         *
+         * \param[in]     hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.
+         *
+         * \param[in]     monitorId      The monitor ID of the monitor we wish latency information for.
+         *
+         * \param[in]     regionId       The region ID of the desired region.
+         *
+         * \param[in]     serverId       The server ID of the server we want latency data from.
+         *
+         * \param[in]     startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in]     endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in,out] latencySketch  The sketch to add entries to.
+         */
+        void getRawEntrySketch(
+            bool&                            success,
+            QSqlDatabase&                    database,
+            CustomerCapabilities::CustomerId customerId,
+            HostScheme::HostSchemeId         hostSchemeId,
+            LatencyEntry::MonitorId          monitorId,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            LatencySketch&                   latencySketch
+        );
+
+        /**
+         * Method that builds a select query based on a set of constraints.
+         *
+         * \param[in] tableName      The name of the table to build the query for.
+         *
+         * \param[in] customerId     The ID of the customer requesting this data.  An invalid customer ID indicates all
+         *                           customers.
+         *
+         * \param[in] hostSchemeId   The host/scheme ID of the host scheme we wish latency information for.  An invalid
+         *                           host/scheme ID indicates the monitor ID should be used.
+         *
+         * \param[in] monitorId      The monitor ID of the monitor we wish latency information for.  An invalid monitor
          *                           ID indicates all monitors.
          *
          * \param[in] regionId       The region ID of the desired region.  An invalid region ID means all regions.
@@ -390,6 +1736,37 @@ class LatencyInterfaceManager:public QObject {
             const QString&                   selectClause = QString("*")
         );
 
+        /**
+         * Method that builds a select query returning one row per monitor.
+         *
+         * \param[in] tableName      The name of the table to build the query for.
+         *
+         * \param[in] customerId     The ID of the customer requesting this data.
+         *
+         * \param[in] monitorIds     The monitors of interest.  An empty set indicates every monitor of the customer.
+         *
+         * \param[in] regionId       The region ID of the desired region.  An invalid region ID means all regions.
+         *
+         * \param[in] serverId       The server ID of the server we want latency data from.  An invalid server ID
+         *                           indicates all servers.
+         *
+         * \param[in] startTimestamp The starting timestamp (inclusive) that we want information for.
+         *
+         * \param[in] endTimestamp   The ending timestamp (inclusive) that we want information for.
+         *
+         * \param[in] selectClause   The select clause, excluding the monitor ID.
+         */
+        QString buildGroupedQueryString(
+            const QString&                   tableName,
+            CustomerCapabilities::CustomerId customerId,
+            const MonitorIdSet&              monitorIds,
+            Region::RegionId                 regionId,
+            Server::ServerId                 serverId,
+            unsigned long long               startTimestamp,
+            unsigned long long               endTimestamp,
+            const QString&                   selectClause
+        );
+
         /**
          * Method that converts a Unix timestamp to a Zoran timestamp with capping.
          *
@@ -404,20 +1781,228 @@ class LatencyInterfaceManager:public QObject {
          */
         DatabaseManager* currentDatabaseManager;
 
+        /**
+         * The registry of valid monitor and server IDs.
+         */
+        IdRegistry* currentIdRegistry;
+
+        /**
+         * The in-memory catalog of monitors.
+         */
+        Catalog* currentCatalog;
+
+        /**
+         * The in-memory buffer of recent raw entries, shared by every data interface.
+         */
+        LatencyRingBuffer currentRingBuffer;
+
+        /**
+         * The in-memory rolling statistics, shared by every data interface.
+         */
+        LatencyRollingStatistics currentRollingStatistics;
+
+        /**
+         * The in-memory polling server health statistics, shared by every data interface.
+         */
+        ServerHealthStatistics currentServerHealth;
+
         /**
          * The latency data aggregator.
          */
         LatencyAggregator* currentLatencyAggregator;
 
         /**
-         * Mutex used to control access to the data interface by region table.
+         * The background latency purger.
+         */
+        LatencyPurger* currentLatencyPurger;
+
+        /**
+         * The archive of old latency aggregated entries.
+         */
+        LatencyArchive* currentLatencyArchive;
+
+        /**
+         * The pool of workers used to read raw entries concurrently with aggregated entries.
+         */
+        QueryExecutor* currentQueryExecutor;
+
+        /**
+         * The number of entries in the lock-free data interface lookup table.
+         */
+        static constexpr unsigned numberRegionSlots = static_cast<unsigned>(std::numeric_limits<RegionId>::max()) + 1;
+
+        /**
+         * Mutex used to control creation of data interfaces and access to the data interface by region table.
          */
         QMutex accessMutex;
 
+        /**
+         * Lock-free, read-mostly, lookup table of data interfaces indexed directly by region ID.  Entries are written
+         * once, under the access mutex, and never change afterwards.
+         */
+        QAtomicPointer<LatencyInterface> dataInterfacesBySlot[numberRegionSlots];
+
         /**
          * Table of data interfaces by region.
          */
         QHash<RegionId, LatencyInterface*> dataInterfacesByRegion;
+
+        /**
+         * The current flush batch size applied to each latency interface.
+         */
+        unsigned long currentFlushBatchSize;
+
+        /**
+         * The current de-duplication capacity applied to each latency interface.
+         */
+        unsigned long currentDeduplicationCapacity;
+
+        /**
+         * The current number of queued entries that will trigger a flush.
+         */
+        unsigned long currentFlushMaximumEntries;
+
+        /**
+         * The current number of queued bytes that will trigger a flush.
+         */
+        unsigned long long currentFlushMaximumBytes;
+
+        /**
+         * The current maximum age of queued entries, in seconds.
+         */
+        unsigned long currentFlushMaximumAge;
+
+        /**
+         * The current spool directory.  An empty string indicates that latency entries are held in memory.
+         */
+        QString currentSpoolDirectory;
+
+        /**
+         * The current queue depth at which polling servers are throttled.
+         */
+        unsigned long currentIngestHighWatermark;
+
+        /**
+         * The current queue depth at which polling servers are no longer throttled.
+         */
+        unsigned long currentIngestLowWatermark;
+
+        /**
+         * The current number of writer threads for regions not listed explicitly.
+         */
+        unsigned currentDefaultNumberWriters;
+
+        /**
+         * The current number of writer threads for specific regions.
+         */
+        NumberWritersByRegion currentNumberWritersByRegion;
+
+        /**
+         * The current age at which raw entries are aggregated, in seconds.
+         */
+        unsigned long currentAggregationAge;
+
+        /**
+         * The current aggregation resample period, in seconds.
+         */
+        unsigned long currentResamplePeriod;
+
+        /**
+         * Flag indicating that ingest-time rollups are enabled.
+         */
+        bool currentIngestRollupsEnabled;
+
+        /**
+         * Flag indicating that background aggregation is enabled.
+         */
+        bool currentAggregationEnabled;
+
+        /**
+         * The current maximum age of any entry, in seconds.
+         */
+        unsigned long currentExpungePeriod;
+
+        /**
+         * Flag indicating that the raw entry table holds aggregated entries.
+         */
+        bool currentInputAggregated;
+
+        /**
+         * Flag holding a non-zero value if raw entries are stored as compressed blocks.
+         */
+        QAtomicInt currentBlockStorage;
+
+        /**
+         * The Unix timestamp of the first period covered by ingest-time rollups.  A value of zero indicates rollups
+         * have not been started.
+         */
+        unsigned long long currentRollupCoverageStart;
+
+        /**
+         * The current aggregation tiers, finest first.
+         */
+        AggregationTierList currentAggregationTiers;
+
+        /**
+         * The age at which each aggregation tier is aggregated, in seconds.
+         */
+        QList<unsigned long> tierAggregationAges;
+
+        /**
+         * The aggregators feeding each aggregation tier.
+         */
+        QList<LatencyAggregator*> tierAggregators;
+
+        /**
+         * The current number of aggregation worker threads.
+         */
+        unsigned currentNumberAggregationWorkers;
+
+        /**
+         * The current partition period of each time-range partitioned latency table.
+         */
+        PartitionPeriods currentPartitionPeriods;
+
+        /**
+         * Mutex used to protect the data versions.
+         */
+        mutable QMutex dataVersionMutex;
+
+        /**
+         * The latest data version across all monitors.
+         */
+        unsigned long long currentDataVersion;
+
+        /**
+         * The data version assigned by the last completed aggregation run.
+         */
+        unsigned long long currentAggregationDataVersion;
+
+        /**
+         * The data version assigned by the last write of entries for a monitor missing from the catalog.  Every
+         * customer's data is treated as changed by such a write.
+         */
+        unsigned long long currentUnattributedDataVersion;
+
+        /**
+         * The data version assigned by the last write for each monitor.
+         */
+        QHash<LatencyEntry::MonitorId, unsigned long long> monitorDataVersions;
+
+        /**
+         * The data version assigned by the last write for each customer.
+         */
+        QHash<CustomerCapabilities::CustomerId, unsigned long long> customerDataVersions;
+
+        /**
+         * The cache of latency entry query results.
+         */
+        LatencyResultCache currentResultCache;
+
+        /**
+         * The ID used to register the result cache with the \ref MemoryGovernor.
+         */
+        MemoryGovernor::ConsumerId resultCacheConsumerId;
 };
 
 #endif
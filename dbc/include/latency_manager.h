@@ -27,17 +27,24 @@
 #include <QString>
 #include <QByteArray>
 #include <QJsonDocument>
+#include <QHash>
+#include <QMutex>
+
+#include <cstdint>
 
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 #include <rest_api_in_v1_inesonic_binary_rest_handler.h>
 
+#include "server.h"
+#include "latency_interface.h"
 #include "rest_helpers.h"
 
-class Servers;
+class ServerAdministrator;
 class LatencyInterfaceManager;
 class LatencyPlotter;
+class ResponseCompressor;
 
 /**
  * Class that support a set of REST endpoints used to manage customer latency data.
@@ -61,6 +68,11 @@ class LatencyManager:public QObject {
          */
         static const QString latencyPurgePath;
 
+        /**
+         * Path used to obtain the progress of a latency purge.
+         */
+        static const QString latencyPurgeStatusPath;
+
         /**
          * Path used to obtain latency information in plot format.
          */
@@ -74,26 +86,29 @@ class LatencyManager:public QObject {
         /**
          * Constructor
          *
-         * \param[in] restApiServer      The REST API server instance.
+         * \param[in] restApiServer       The REST API server instance.
          *
-         * \param[in] latencyDatabaseApi Class used to manage regions entries in the database.
+         * \param[in] latencyDatabaseApi  Class used to manage regions entries in the database.
          *
-         * \param[in] serverDatabaseApi  Class used to manage our servers.
+         * \param[in] serverAdministrator Class holding the in-memory server table.
          *
-         * \param[in] monitorDatabaseApi Class used to manage our monitors.
+         * \param[in] monitorDatabaseApi  Class used to manage our monitors.
          *
-         * \param[in] latencyPlotter     Class used to generate latency plots.
+         * \param[in] latencyPlotter      Class used to generate latency plots.
          *
-         * \param[in[ secret             The incoming data secret.
+         * \param[in] responseCompressor  Class used to compress large responses.
          *
-         * \param[in] parent             Pointer to the parent object.
+         * \param[in[ secret              The incoming data secret.
+         *
+         * \param[in] parent              Pointer to the parent object.
          */
         LatencyManager(
             RestApiInV1::Server*     restApiServer,
             LatencyInterfaceManager* latencyDatabaseApi,
-            Servers*                 serverDatabaseApi,
+            ServerAdministrator*     serverAdministrator,
             Monitors*                monitorDatabaseApi,
             LatencyPlotter*          latencyPlotter,
+            ResponseCompressor*      responseCompressor,
             const QByteArray&        secret,
             QObject*                 parent = nullptr
         );
@@ -117,16 +132,16 @@ class LatencyManager:public QObject {
                 /**
                  * Constructor
                  *
-                 * \param[in] secret             The secret to use for this handler.
+                 * \param[in] secret              The secret to use for this handler.
                  *
-                 * \param[in] latencyDatabaseApi Class used to manage regions entries in the database.
+                 * \param[in] latencyDatabaseApi  Class used to manage regions entries in the database.
                  *
-                 * \param[in] serverDatabaseApi  Class used to manage our servers.
+                 * \param[in] serverAdministrator Class holding the in-memory server table.
                  */
                 LatencyRecord(
                     const QByteArray&        secret,
                     LatencyInterfaceManager* latencyDatabaseApi,
-                    Servers*                 serverDatabaseApi
+                    ServerAdministrator*     serverAdministrator
                 );
 
                 ~LatencyRecord() override;
@@ -163,7 +178,9 @@ class LatencyManager:public QObject {
                  */
                 struct Header {
                     /**
-                     * A header version code value.  Currently ignored and set to 0.
+                     * A header version code value.  Version 0 headers carry no batch sequence number.  Version 1
+                     * headers carry a batch sequence number.  Version 2 headers are followed by a compact payload
+                     * rather than fixed size entries.
                      */
                     std::uint16_t version;
 
@@ -194,64 +211,155 @@ class LatencyManager:public QObject {
                     std::uint8_t serverStatusCode;
 
                     /**
-                     * Reserved for future use.  Fill with zeros.
+                     * The batch sequence number.  The value increases by at least one for every new batch sent by the
+                     * server and is repeated when a batch is retried.  A value of 0 indicates the batch is not
+                     * sequenced.  Ignored for version 0 headers.
                      */
-                    std::uint8_t spare[64 - (2 + maximumIdentifierLength + 4 + 2 + 2 + 1)];
-                } __attribute__((packed));
+                    std::uint64_t batchSequence;
 
-                /**
-                 * Structure that defines our latency entry.  Note that this structure is also defined in the
-                 * polling_server project with a with a structure that must match this one.
-                 */
-                struct Entry {
                     /**
-                     * The monitor ID.
+                     * The framing used for a compact payload.  Ignored for headers before version 2.
                      */
-                    std::uint32_t monitorId;
+                    std::uint8_t payloadFraming;
 
                     /**
-                     * The Zoran timestamp.
-                     */
-                    std::uint32_t timestamp;
-
-                    /**
-                     * The latency in microseconds
+                     * Reserved for future use.  Fill with zeros.
                      */
-                    std::uint32_t latencyMicroseconds;
+                    std::uint8_t spare[64 - (2 + maximumIdentifierLength + 4 + 2 + 2 + 1 + 8 + 1)];
                 } __attribute__((packed));
 
+                /**
+                 * The header version that introduced compact payloads.
+                 */
+                static constexpr std::uint16_t compactHeaderVersion = 2;
+
+                /**
+                 * Payload framing value indicating the compact payload is not compressed.
+                 */
+                static constexpr std::uint8_t uncompressedFraming = 0;
+
+                /**
+                 * Payload framing value indicating the compact payload is zlib compressed.
+                 */
+                static constexpr std::uint8_t zlibFraming = 1;
+
+                /**
+                 * The largest accepted uncompressed compact payload, in bytes.
+                 */
+                static constexpr std::uint32_t maximumCompactPayloadSize = 64 * 1024 * 1024;
+
+                /**
+                 * Method that expands a compact payload into fixed size entries.
+                 *
+                 * \param[in]  header   The request header.
+                 *
+                 * \param[in]  request  The request, including the header.
+                 *
+                 * \param[out] entries  The decoded entries, in the layout of \ref Entry.
+                 *
+                 * \return Returns true on success.  Returns false if the payload is malformed.
+                 */
+                static bool decodeCompactEntries(const Header& header, const QByteArray& request, QByteArray& entries);
+
+                /**
+                 * The header version that introduced batch sequence numbers.
+                 */
+                static constexpr std::uint16_t sequencedHeaderVersion = 1;
+
+                /**
+                 * The number of sequence numbers below the highest accepted sequence number that are tracked
+                 * individually so batches delivered out of order are still accepted.
+                 */
+                static constexpr unsigned sequenceWindowSize = 64;
+
+                /**
+                 * Trivial class used to track the batch sequence numbers accepted from a single server.
+                 */
+                class SequenceWindow {
+                    public:
+                        SequenceWindow():highestSequence(0),acceptedMask(0) {}
+
+                        /**
+                         * The highest accepted sequence number.
+                         */
+                        std::uint64_t highestSequence;
+
+                        /**
+                         * Bit mask of accepted sequence numbers below the highest.  Bit N is set if sequence number
+                         * highestSequence - 1 - N has been accepted.
+                         */
+                        std::uint64_t acceptedMask;
+                };
+
+                /**
+                 * Method that records a batch sequence number.  A sequence number too far below the window is taken
+                 * to mean the server restarted its count, so the window is reset.
+                 *
+                 * \param[in]  serverId              The ID of the server that sent the batch.
+                 *
+                 * \param[in]  batchSequence         The batch sequence number.
+                 *
+                 * \param[out] acknowledgedSequence  The highest accepted sequence number for the server.
+                 *
+                 * \return Returns true if the batch is new.  Returns false if the batch was already accepted.
+                 */
+                bool acceptSequence(
+                    Server::ServerId serverId,
+                    std::uint64_t    batchSequence,
+                    std::uint64_t&   acknowledgedSequence
+                );
+
+                /**
+                 * Structure that defines our latency entry.  The structure is shared with \ref LatencyInterface so
+                 * that received entries can be queued without conversion.
+                 */
+                typedef LatencyInterface::RawEntry Entry;
+
                 /**
                  * The current region database API.
                  */
                 LatencyInterfaceManager* currentLatencyInterfaceManager;
 
                 /**
-                 * The current servers database API.
+                 * The server administrator holding the in-memory server table.
+                 */
+                ServerAdministrator* currentServerAdministrator;
+
+                /**
+                 * Mutex used to protect the sequence windows.
+                 */
+                QMutex sequenceMutex;
+
+                /**
+                 * The accepted batch sequence numbers, by server.
                  */
-                Servers* currentServers;
+                QHash<Server::ServerId, SequenceWindow> sequenceWindows;
         };
 
         /**
          * The latency/get handler.
          */
-        class LatencyGet:public RestApiInV1::InesonicRestHandler, private RestHelpers {
+        class LatencyGet:public RestApiInV1::InesonicBinaryRestHandler, private RestHelpers {
             public:
                 /**
                  * Constructor
                  *
-                 * \param[in] secret             The secret to use for this handler.
+                 * \param[in] secret              The secret to use for this handler.
                  *
-                 * \param[in] latencyDatabaseApi Class used to manage regions entries in the database.
+                 * \param[in] latencyDatabaseApi  Class used to manage regions entries in the database.
                  *
-                 * \param[in] serverDatabaseApi  Class used to manage our servers.
+                 * \param[in] serverAdministrator Class holding the in-memory server table.
                  *
-                 * \param[in] monitorDatabaseApi Class used to manage our monitors.
+                 * \param[in] monitorDatabaseApi  Class used to manage our monitors.
+                 *
+                 * \param[in] responseCompressor  Class used to compress large responses.
                  */
                 LatencyGet(
                     const QByteArray&        secret,
                     LatencyInterfaceManager* latencyDatabaseApi,
-                    Servers*                 serverDatabaseApi,
-                    Monitors*                monitorDatabaseApi
+                    ServerAdministrator*     serverAdministrator,
+                    Monitors*                monitorDatabaseApi,
+                    ResponseCompressor*      responseCompressor
                 );
 
                 ~LatencyGet() override;
@@ -267,12 +375,13 @@ class LatencyManager:public QObject {
                  *
                  * \param[in] threadId The ID used to uniquely identify this thread while in flight.
                  *
-                 * \return The response to return, also encoded as a JSON document.
+                 * \return The response to return, encoded as a JSON document or, if the "binary" format was
+                 *         requested, in the format described by \ref RestHelpers::convertToBinary.
                  */
-                RestApiInV1::JsonResponse processAuthenticatedRequest(
-                    const QString&       path,
-                    const QJsonDocument& request,
-                    unsigned             threadId
+                RestApiInV1::Response* processAuthenticatedRequest(
+                    const QString&    path,
+                    const QByteArray& request,
+                    unsigned          threadId
                 ) override;
 
             private:
@@ -282,14 +391,19 @@ class LatencyManager:public QObject {
                 LatencyInterfaceManager* currentLatencyInterfaceManager;
 
                 /**
-                 * The current servers database API.
+                 * The server administrator, used for its in-memory server snapshot.
                  */
-                Servers* currentServers;
+                ServerAdministrator* currentServerAdministrator;
 
                 /**
                  * The current monitors database API.
                  */
                 Monitors* currentMonitors;
+
+                /**
+                 * The compressor applied to large responses.
+                 */
+                ResponseCompressor* currentResponseCompressor;
         };
 
         /**
@@ -334,6 +448,48 @@ class LatencyManager:public QObject {
                 LatencyInterfaceManager* currentLatencyInterfaceManager;
         };
 
+        /**
+         * The latency/purge/status handler.
+         */
+        class LatencyPurgeStatus:public RestApiInV1::InesonicRestHandler, private RestHelpers {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret             The secret to use for this handler.
+                 *
+                 * \param[in] latencyDatabaseApi Class used to manage regions entries in the database.
+                 */
+                LatencyPurgeStatus(const QByteArray& secret, LatencyInterfaceManager* latencyDatabaseApi);
+
+                ~LatencyPurgeStatus() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The current region database API.
+                 */
+                LatencyInterfaceManager* currentLatencyInterfaceManager;
+        };
+
         /**
          * The latency/plot handler.
          */
@@ -433,6 +589,11 @@ class LatencyManager:public QObject {
          */
         LatencyPurge latencyPurge;
 
+        /**
+         * The latency/purge/status handler.
+         */
+        LatencyPurgeStatus latencyPurgeStatus;
+
         /**
          * The latency/plot handler.
          */
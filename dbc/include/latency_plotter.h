@@ -41,7 +41,9 @@
 #include "server.h"
 #include "host_scheme.h"
 #include "plot_mailbox.h"
+#include "plot_cache.h"
 #include "plotter_base.h"
+#include "memory_governor.h"
 
 namespace QtCharts {
     class QChart;
@@ -90,9 +92,15 @@ class LatencyPlotter:public PlotterBase {
          *
          * \param[in] latencyInterfaceManager The latency interface manager used to get plot data.
          *
+         * \param[in] plotWorkerPool          The pool of workers used to render plots.
+         *
          * \param[in] parent                  Pointer to the parent object.
          */
-        LatencyPlotter(LatencyInterfaceManager* latencyInterfaceManager, QObject* parent = nullptr);
+        LatencyPlotter(
+            LatencyInterfaceManager* latencyInterfaceManager,
+            PlotWorkerPool*          plotWorkerPool,
+            QObject*                 parent = nullptr
+        );
 
         ~LatencyPlotter() override;
 
@@ -261,40 +269,441 @@ class LatencyPlotter:public PlotterBase {
          */
         PlotMailbox& mailbox(unsigned threadId);
 
-    signals:
         /**
-         * Signal that is emitted to request a plot showing latency over time.
+         * Method you can use to obtain the cache of encoded plots.
          *
-         * \param[out] threadId        The zero based ID of the thread requesting this plot.
+         * \return Returns a reference to the plot cache.
+         */
+        PlotCache& plotCache();
+
+        /**
+         * Method you can use to obtain the version of the data a plot would be rendered from.  Cached plots are only
+         * valid while this version is unchanged.
+         *
+         * \param[in] monitorId The monitor ID of the monitor the plot is limited to.  An invalid monitor ID indicates
+         *                      a plot covering multiple monitors.
          *
-         * \param[out] customerId      The customer ID of the customer tied to the plot.  An invalid customer ID
+         * \return Returns the current data version.
+         */
+        unsigned long long dataVersion(MonitorId monitorId) const;
+
+    private:
+        /**
+         * Job used to render a plot showing latency over time from a plot worker thread.
+         */
+        class HistoryPlotJob:public PlotWorkerPool::Job {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] plotter          The plotter used to render the image.
+                 *
+                 * \param[in] mailbox          The mailbox to receive the image.
+                 *
+                 * \param[in] threadId         The zero based ID of the thread requesting this plot.
+                 *
+                 * \param[in] customerId       The customer ID of the customer tied to the plot.
+                 *
+                 * \param[in] regionId         The region ID of the region to limit the plot to.
+                 *
+                 * \param[in] serverId         The server ID of the server to limit the plot to.
+                 *
+                 * \param[in] hostSchemeId     The host/scheme ID of the host scheme to limit the plot to.
+                 *
+                 * \param[in] monitorId        The monitor ID of the monitor to limit the plot to.
+                 *
+                 * \param[in] startTimestamp   The Unix timestamp to start the plot at.
+                 *
+                 * \param[in] endTimestamp     The Unix timestamp to end the plot at.
+                 *
+                 * \param[in] titleText        The chart title text.
+                 *
+                 * \param[in] xAxisTitle       The title to apply to the X axis.
+                 *
+                 * \param[in] yAxisTitle       The title to apply to the Y axis.
+                 *
+                 * \param[in] dateFormatString The date format string.
+                 *
+                 * \param[in] titleFont        The font to use for the title.
+                 *
+                 * \param[in] axisTitleFont    The font to use for the axis titles.
+                 *
+                 * \param[in] axisLabelFont    The font to use for the axis labels.
+                 *
+                 * \param[in] maximumLatency   The maximum latency to show.
+                 *
+                 * \param[in] minimumLatency   The minimum latency to show.
+                 *
+                 * \param[in] logScale         If true, then latency will be shown using a log scale.
+                 *
+                 * \param[in] width            The plot width, in pixels.
+                 *
+                 * \param[in] height           The plot height, in pixels.
+                 */
+                HistoryPlotJob(
+                    LatencyPlotter*    plotter,
+                    PlotMailbox*       mailbox,
+                    ThreadId           threadId,
+                    CustomerId         customerId,
+                    RegionId           regionId,
+                    ServerId           serverId,
+                    HostSchemeId       hostSchemeId,
+                    MonitorId          monitorId,
+                    unsigned long long startTimestamp,
+                    unsigned long long endTimestamp,
+                    const QString&     titleText,
+                    const QString&     xAxisTitle,
+                    const QString&     yAxisTitle,
+                    const QString&     dateFormatString,
+                    const QString&     titleFont,
+                    const QString&     axisTitleFont,
+                    const QString&     axisLabelFont,
+                    double             maximumLatency,
+                    double             minimumLatency,
+                    bool               logScale,
+                    unsigned           width,
+                    unsigned           height
+                );
+
+                ~HistoryPlotJob() override;
+
+                /**
+                 * Method that is called from a worker thread to render the plot.
+                 *
+                 * \param[in] databaseThreadId The database thread ID reserved for the calling worker.
+                 */
+                void run(unsigned databaseThreadId) override;
+
+            private:
+                /**
+                 * The plotter used to render the image.
+                 */
+                LatencyPlotter* currentPlotter;
+
+                /**
+                 * The ID of the thread requesting this plot.
+                 */
+                ThreadId currentThreadId;
+
+                /**
+                 * The customer ID of the customer tied to the plot.
+                 */
+                CustomerId currentCustomerId;
+
+                /**
+                 * The region ID of the region to limit the plot to.
+                 */
+                RegionId currentRegionId;
+
+                /**
+                 * The server ID of the server to limit the plot to.
+                 */
+                ServerId currentServerId;
+
+                /**
+                 * The host/scheme ID of the host scheme to limit the plot to.
+                 */
+                HostSchemeId currentHostSchemeId;
+
+                /**
+                 * The monitor ID of the monitor to limit the plot to.
+                 */
+                MonitorId currentMonitorId;
+
+                /**
+                 * The Unix timestamp to start the plot at.
+                 */
+                unsigned long long currentStartTimestamp;
+
+                /**
+                 * The Unix timestamp to end the plot at.
+                 */
+                unsigned long long currentEndTimestamp;
+
+                /**
+                 * The chart title text.
+                 */
+                QString currentTitleText;
+
+                /**
+                 * The title to apply to the X axis.
+                 */
+                QString currentXAxisTitle;
+
+                /**
+                 * The title to apply to the Y axis.
+                 */
+                QString currentYAxisTitle;
+
+                /**
+                 * The date format string.
+                 */
+                QString currentDateFormatString;
+
+                /**
+                 * The font to use for the title.
+                 */
+                QString currentTitleFont;
+
+                /**
+                 * The font to use for the axis titles.
+                 */
+                QString currentAxisTitleFont;
+
+                /**
+                 * The font to use for the axis labels.
+                 */
+                QString currentAxisLabelFont;
+
+                /**
+                 * The maximum latency to show.
+                 */
+                double currentMaximumLatency;
+
+                /**
+                 * The minimum latency to show.
+                 */
+                double currentMinimumLatency;
+
+                /**
+                 * If true, then latency will be shown using a log scale.
+                 */
+                bool currentLogScale;
+
+                /**
+                 * The plot width, in pixels.
+                 */
+                unsigned currentWidth;
+
+                /**
+                 * The plot height, in pixels.
+                 */
+                unsigned currentHeight;
+        };
+
+        /**
+         * Job used to render a histogram of latency from a plot worker thread.
+         */
+        class HistogramPlotJob:public PlotWorkerPool::Job {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] plotter        The plotter used to render the image.
+                 *
+                 * \param[in] mailbox        The mailbox to receive the image.
+                 *
+                 * \param[in] threadId       The zero based ID of the thread requesting this plot.
+                 *
+                 * \param[in] customerId     The customer ID of the customer tied to the plot.
+                 *
+                 * \param[in] regionId       The region ID of the region to limit the plot to.
+                 *
+                 * \param[in] serverId       The server ID of the server to limit the plot to.
+                 *
+                 * \param[in] hostSchemeId   The host/scheme ID of the host scheme to limit the plot to.
+                 *
+                 * \param[in] monitorId      The monitor ID of the monitor to limit the plot to.
+                 *
+                 * \param[in] startTimestamp The Unix timestamp to start the plot at.
+                 *
+                 * \param[in] endTimestamp   The Unix timestamp to end the plot at.
+                 *
+                 * \param[in] titleText      The chart title text.
+                 *
+                 * \param[in] xAxisTitle     The title to apply to the X axis.
+                 *
+                 * \param[in] yAxisTitle     The title to apply to the Y axis.
+                 *
+                 * \param[in] titleFont      The font to use for the title.
+                 *
+                 * \param[in] axisTitleFont  The font to use for the axis titles.
+                 *
+                 * \param[in] axisLabelFont  The font to use for the axis labels.
+                 *
+                 * \param[in] maximumLatency The maximum latency to show.
+                 *
+                 * \param[in] minimumLatency The minimum latency to show.
+                 *
+                 * \param[in] width          The plot width, in pixels.
+                 *
+                 * \param[in] height         The plot height, in pixels.
+                 */
+                HistogramPlotJob(
+                    LatencyPlotter*    plotter,
+                    PlotMailbox*       mailbox,
+                    ThreadId           threadId,
+                    CustomerId         customerId,
+                    RegionId           regionId,
+                    ServerId           serverId,
+                    HostSchemeId       hostSchemeId,
+                    MonitorId          monitorId,
+                    unsigned long long startTimestamp,
+                    unsigned long long endTimestamp,
+                    const QString&     titleText,
+                    const QString&     xAxisTitle,
+                    const QString&     yAxisTitle,
+                    const QString&     titleFont,
+                    const QString&     axisTitleFont,
+                    const QString&     axisLabelFont,
+                    double             maximumLatency,
+                    double             minimumLatency,
+                    unsigned           width,
+                    unsigned           height
+                );
+
+                ~HistogramPlotJob() override;
+
+                /**
+                 * Method that is called from a worker thread to render the plot.
+                 *
+                 * \param[in] databaseThreadId The database thread ID reserved for the calling worker.
+                 */
+                void run(unsigned databaseThreadId) override;
+
+            private:
+                /**
+                 * The plotter used to render the image.
+                 */
+                LatencyPlotter* currentPlotter;
+
+                /**
+                 * The ID of the thread requesting this plot.
+                 */
+                ThreadId currentThreadId;
+
+                /**
+                 * The customer ID of the customer tied to the plot.
+                 */
+                CustomerId currentCustomerId;
+
+                /**
+                 * The region ID of the region to limit the plot to.
+                 */
+                RegionId currentRegionId;
+
+                /**
+                 * The server ID of the server to limit the plot to.
+                 */
+                ServerId currentServerId;
+
+                /**
+                 * The host/scheme ID of the host scheme to limit the plot to.
+                 */
+                HostSchemeId currentHostSchemeId;
+
+                /**
+                 * The monitor ID of the monitor to limit the plot to.
+                 */
+                MonitorId currentMonitorId;
+
+                /**
+                 * The Unix timestamp to start the plot at.
+                 */
+                unsigned long long currentStartTimestamp;
+
+                /**
+                 * The Unix timestamp to end the plot at.
+                 */
+                unsigned long long currentEndTimestamp;
+
+                /**
+                 * The chart title text.
+                 */
+                QString currentTitleText;
+
+                /**
+                 * The title to apply to the X axis.
+                 */
+                QString currentXAxisTitle;
+
+                /**
+                 * The title to apply to the Y axis.
+                 */
+                QString currentYAxisTitle;
+
+                /**
+                 * The font to use for the title.
+                 */
+                QString currentTitleFont;
+
+                /**
+                 * The font to use for the axis titles.
+                 */
+                QString currentAxisTitleFont;
+
+                /**
+                 * The font to use for the axis labels.
+                 */
+                QString currentAxisLabelFont;
+
+                /**
+                 * The maximum latency to show.
+                 */
+                double currentMaximumLatency;
+
+                /**
+                 * The minimum latency to show.
+                 */
+                double currentMinimumLatency;
+
+                /**
+                 * The plot width, in pixels.
+                 */
+                unsigned currentWidth;
+
+                /**
+                 * The plot height, in pixels.
+                 */
+                unsigned currentHeight;
+        };
+
+        /**
+         * Method that reduces raw latency entries to at most four entries per pixel column.  The first, last, minimum
+         * and maximum entries of each column are kept so the rendered plot is unchanged while the number of series
+         * points is bounded by the image width rather than the number of entries.
+         *
+         * \param[in] latencyEntries The entries to be reduced.  Entries must be sorted by timestamp.
+         *
+         * \param[in] numberColumns  The number of pixel columns the entries will be drawn across.
+         *
+         * \return Returns the reduced list of entries, in timestamp order.
+         */
+        static QList<LatencyEntry> downsampleEntries(const QList<LatencyEntry>& latencyEntries, unsigned numberColumns);
+
+        /**
+         * Method that generates a plot showing latency over time.  This method is called from a plot worker thread.
+         *
+         * \param[in] threadId         The zero based ID of the thread requesting this plot.
+         *
+         * \param[in] customerId       The customer ID of the customer tied to the plot.  An invalid customer ID
          *                             indicates all customers.
          *
-         * \param[out] regionId        The region ID of the region to limit the plot to.  An invalid region ID indicates
+         * \param[in] regionId         The region ID of the region to limit the plot to.  An invalid region ID indicates
          *                             all regions.
          *
-         * \param[out] serverId        The server ID of the server to limit the plot to.  An invalid server ID indicates
+         * \param[in] serverId         The server ID of the server to limit the plot to.  An invalid server ID indicates
          *                             all servers.
          *
-         * \param[out] hostSchemeId    The host/scheme ID of the host scheme to limit the plot to.  An invalid
+         * \param[in] hostSchemeId     The host/scheme ID of the host scheme to limit the plot to.  An invalid
          *                             host/scheme ID indicates all host schemes.
          *
-         * \param[out] monitorId       The monitor ID of the monitor to limit the plot to.  An invalid monitor ID
+         * \param[in] monitorId        The monitor ID of the monitor to limit the plot to.  An invalid monitor ID
          *                             indicates all monitors.
          *
-         * \param[out] startTimestamp  The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
+         * \param[in] startTimestamp   The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
          *                             start timestamp.
          *
-         * \param[out] endTimestamp    The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
+         * \param[in] endTimestamp     The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
          *                             start timestamp.
          *
-         * \param[out] titleText       The chart title text.
+         * \param[in] titleText        The chart title text.
          *
-         * \param[out] xAxisTitle      The title to apply to the X axis.
+         * \param[in] xAxisTitle       The title to apply to the X axis.
          *
-         * \param[out] yAxisTitle      The title to apply to the Y axis.
+         * \param[in] yAxisTitle       The title to apply to the Y axis.
          *
-         * \param[out] dateFormat      The date format string.
+         * \param[in] dateFormat       The date format string.
          *
          * \param[in] titleFont        The font to use for the title.  An invalid font will cause the default font to be
          *                             used.
@@ -305,21 +714,21 @@ class LatencyPlotter:public PlotterBase {
          * \param[in] axisLabelFont    The font to use for the axis labels.  An invalid font will cause the default font
          *                             to be used.
          *
-         * \param[out] maximumLatency  The maximum latency to show.  A negative value indicates that the value should be
+         * \param[in] maximumLatency   The maximum latency to show.  A negative value indicates that the value should be
          *                             determined by the provided data.
          *
-         * \param[out] minimumLatency  The minimum latency to show.  A negative value indicates that the value should be
+         * \param[in] minimumLatency   The minimum latency to show.  A negative value indicates that the value should be
          *                             determined by the provided data.
          *
-         * \param[out] latencyLogScale If true, then latency will be shown using a log scale.
+         * \param[in] latencyLogScale  If true, then latency will be shown using a log scale.
          *
-         * \param[out] width           The plot width, in pixels.
+         * \param[in] width            The plot width, in pixels.
          *
-         * \param[out] height          The plot height, in pixels.
+         * \param[in] height           The plot height, in pixels.
          *
-         * \return Returns a reference to the mailbox to receive the image.
+         * \param[in] databaseThreadId The database thread ID reserved for the calling plot worker.
          */
-        void issueRequestHistoryPlot(
+        void generateHistoryPlot(
             unsigned           threadId,
             unsigned long      customerId,
             unsigned           regionId,
@@ -335,44 +744,45 @@ class LatencyPlotter:public PlotterBase {
             const QString&     titleFont,
             const QString&     axisTitleFont,
             const QString&     axisLabelFont,
-            double             maximumLatency = -1,
-            double             minimumLatency = -1,
-            bool               logScale = false,
-            unsigned           width = defaultWidth,
-            unsigned           height = defaultHeight
+            double             maximumLatency,
+            double             minimumLatency,
+            bool               logScale,
+            unsigned           width,
+            unsigned           height,
+            unsigned           databaseThreadId
         );
 
         /**
-         * Signal that is emitted to request a histogram of latency.
+         * Method that generates a histogram of latency.  This method is called from a plot worker thread.
          *
-         * \param[out] threadId        The zero based ID of the thread requesting this plot.
+         * \param[in] threadId         The zero based ID of the thread requesting this plot.
          *
-         * \param[out] customerId      The customer ID of the customer tied to the plot.  An invalid customer ID
+         * \param[in] customerId       The customer ID of the customer tied to the plot.  An invalid customer ID
          *                             indicates all customers.
          *
-         * \param[out] regionId        The region ID of the region to limit the plot to.  An invalid region ID indicates
+         * \param[in] regionId         The region ID of the region to limit the plot to.  An invalid region ID indicates
          *                             all regions.
          *
-         * \param[out] serverId        The server ID of the server to limit the plot to.  An invalid server ID indicates
+         * \param[in] serverId         The server ID of the server to limit the plot to.  An invalid server ID indicates
          *                             all servers.
          *
-         * \param[out] hostSchemeId    The host/scheme ID of the host scheme to limit the plot to.  An invalid
+         * \param[in] hostSchemeId     The host/scheme ID of the host scheme to limit the plot to.  An invalid
          *                             host/scheme ID indicates all host schemes.
          *
-         * \param[out] monitorId       The monitor ID of the monitor to limit the plot to.  An invalid monitor ID
+         * \param[in] monitorId        The monitor ID of the monitor to limit the plot to.  An invalid monitor ID
          *                             indicates all monitors.
          *
-         * \param[out] startTimestamp  The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
+         * \param[in] startTimestamp   The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
          *                             start timestamp.
          *
-         * \param[out] endTimestamp    The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
+         * \param[in] endTimestamp     The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
          *                             start timestamp.
          *
-         * \param[out] titleText       The chart title text.
+         * \param[in] titleText        The chart title text.
          *
-         * \param[out] xAxisTitle      The title to apply to the X axis.
+         * \param[in] xAxisTitle       The title to apply to the X axis.
          *
-         * \param[out] yAxisTitle      The title to apply to the Y axis.
+         * \param[in] yAxisTitle       The title to apply to the Y axis.
          *
          * \param[in] titleFont        The font to use for the title.  An invalid font will cause the default font to be
          *                             used.
@@ -383,172 +793,17 @@ class LatencyPlotter:public PlotterBase {
          * \param[in] axisLabelFont    The font to use for the axis labels.  An invalid font will cause the default font
          *                             to be used.
          *
-         * \param[out] maximumLatency  The maximum latency to show.  A negative value indicates that the value should be
+         * \param[in] maximumLatency   The maximum latency to show.  A negative value indicates that the value should be
          *                             determined by the provided data.
          *
-         * \param[out] minimumLatency  The minimum latency to show.  A negative value indicates that the value should be
+         * \param[in] minimumLatency   The minimum latency to show.  A negative value indicates that the value should be
          *                             determined by the provided data.
          *
-         * \param[out] width           The plot width, in pixels.
-         *
-         * \param[out] height          The plot height, in pixels.
-         *
-         * \return Returns a reference to the mailbox to receive the image.
-         */
-        void issueRequestHistogramPlot(
-            unsigned           threadId,
-            unsigned long      customerId,
-            unsigned           regionId,
-            unsigned           serverId,
-            unsigned long      hostSchemeId,
-            unsigned long      monitorId,
-            unsigned long long startTimestamp,
-            unsigned long long endTimestamp,
-            const QString&     titleText,
-            const QString&     xAxisTitle,
-            const QString&     yAxisTitle,
-            const QString&     titleFont,
-            const QString&     axisTitleFont,
-            const QString&     axisLabelFont,
-            double             maximumLatency = -1,
-            double             minimumLatency = -1,
-            unsigned           width = defaultWidth,
-            unsigned           height = defaultHeight
-        );
-
-    private slots:
-        /**
-         * Slot that is triggered to generate a plot showing latency over time.
-         *
-         * \param[in] threadId        The zero based ID of the thread requesting this plot.
-         *
-         * \param[in] customerId      The customer ID of the customer tied to the plot.  An invalid customer ID
-         *                            indicates all customers.
-         *
-         * \param[in] regionId        The region ID of the region to limit the plot to.  An invalid region ID indicates
-         *                            all regions.
-         *
-         * \param[in] serverId        The server ID of the server to limit the plot to.  An invalid server ID indicates
-         *                            all servers.
-         *
-         * \param[in] hostSchemeId    The host/scheme ID of the host scheme to limit the plot to.  An invalid
-         *                            host/scheme ID indicates all host schemes.
-         *
-         * \param[in] monitorId       The monitor ID of the monitor to limit the plot to.  An invalid monitor ID
-         *                            indicates all monitors.
-         *
-         * \param[in] startTimestamp  The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
-         *                            start timestamp.
-         *
-         * \param[in] endTimestamp    The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
-         *                            start timestamp.
-         *
-         * \param[in] titleText       The chart title text.
-         *
-         * \param[in] xAxisTitle      The title to apply to the X axis.
-         *
-         * \param[in] yAxisTitle      The title to apply to the Y axis.
-         *
-         * \param[in] dateFormat      The date format string.
-         *
-         * \param[in] titleFont       The font to use for the title.  An invalid font will cause the default font to be
-         *                            used.
-         *
-         * \param[in] axisTitleFont   The font to use for the axis titles.  An invalid font will cause the default font
-         *                            to be used.
-         *
-         * \param[in] axisLabelFont   The font to use for the axis labels.  An invalid font will cause the default font
-         *                            to be used.
-         *
-         * \param[in] maximumLatency  The maximum latency to show.  A negative value indicates that the value should be
-         *                            determined by the provided data.
+         * \param[in] width            The plot width, in pixels.
          *
-         * \param[in] minimumLatency  The minimum latency to show.  A negative value indicates that the value should be
-         *                            determined by the provided data.
+         * \param[in] height           The plot height, in pixels.
          *
-         * \param[in] latencyLogScale If true, then latency will be shown using a log scale.
-         *
-         * \param[in] width           The plot width, in pixels.
-         *
-         * \param[in] height          The plot height, in pixels.
-         *
-         * \return Returns a reference to the mailbox to receive the image.
-         */
-        void generateHistoryPlot(
-            unsigned           threadId,
-            unsigned long      customerId,
-            unsigned           regionId,
-            unsigned           serverId,
-            unsigned long      hostSchemeId,
-            unsigned long      monitorId,
-            unsigned long long startTimestamp,
-            unsigned long long endTimestamp,
-            const QString&     titleText,
-            const QString&     xAxisTitle,
-            const QString&     yAxisTitle,
-            const QString&     dateFormatString,
-            const QString&     titleFont,
-            const QString&     axisTitleFont,
-            const QString&     axisLabelFont,
-            double             maximumLatency = -1,
-            double             minimumLatency = -1,
-            bool               logScale = false,
-            unsigned           width = defaultWidth,
-            unsigned           height = defaultHeight
-        );
-
-        /**
-         * Slot that is triggered to generates a histogram of latency.
-         *
-         * \param[in] threadId        The zero based ID of the thread requesting this plot.
-         *
-         * \param[in] customerId      The customer ID of the customer tied to the plot.  An invalid customer ID
-         *                            indicates all customers.
-         *
-         * \param[in] regionId        The region ID of the region to limit the plot to.  An invalid region ID indicates
-         *                            all regions.
-         *
-         * \param[in] serverId        The server ID of the server to limit the plot to.  An invalid server ID indicates
-         *                            all servers.
-         *
-         * \param[in] hostSchemeId    The host/scheme ID of the host scheme to limit the plot to.  An invalid
-         *                            host/scheme ID indicates all host schemes.
-         *
-         * \param[in] monitorId       The monitor ID of the monitor to limit the plot to.  An invalid monitor ID
-         *                            indicates all monitors.
-         *
-         * \param[in] startTimestamp  The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
-         *                            start timestamp.
-         *
-         * \param[in] endTimestamp    The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
-         *                            start timestamp.
-         *
-         * \param[in] titleText       The chart title text.
-         *
-         * \param[in] xAxisTitle      The title to apply to the X axis.
-         *
-         * \param[in] yAxisTitle      The title to apply to the Y axis.
-         *
-         * \param[in] titleFont       The font to use for the title.  An invalid font will cause the default font to be
-         *                            used.
-         *
-         * \param[in] axisTitleFont   The font to use for the axis titles.  An invalid font will cause the default font
-         *                            to be used.
-         *
-         * \param[in] axisLabelFont   The font to use for the axis labels.  An invalid font will cause the default font
-         *                            to be used.
-         *
-         * \param[in] maximumLatency  The maximum latency to show.  A negative value indicates that the value should be
-         *                            determined by the provided data.
-         *
-         * \param[in] minimumLatency  The minimum latency to show.  A negative value indicates that the value should be
-         *                            determined by the provided data.
-         *
-         * \param[in] width           The plot width, in pixels.
-         *
-         * \param[in] height          The plot height, in pixels.
-         *
-         * \return Returns a reference to the mailbox to receive the image.
+         * \param[in] databaseThreadId The database thread ID reserved for the calling plot worker.
          */
         void generateHistogramPlot(
             unsigned           threadId,
@@ -565,13 +820,13 @@ class LatencyPlotter:public PlotterBase {
             const QString&     titleFont,
             const QString&     axisTitleFont,
             const QString&     axisLabelFont,
-            double             maximumLatency = -1,
-            double             minimumLatency = -1,
-            unsigned           width = defaultWidth,
-            unsigned           height = defaultHeight
+            double             maximumLatency,
+            double             minimumLatency,
+            unsigned           width,
+            unsigned           height,
+            unsigned           databaseThreadId
         );
 
-    private:
         /**
          * The latency interface manager used to fetch latency data.
          */
@@ -587,6 +842,16 @@ class LatencyPlotter:public PlotterBase {
          */
         QVector<PlotMailbox*> mailboxes;
 
+        /**
+         * The cache of encoded plots.
+         */
+        PlotCache currentPlotCache;
+
+        /**
+         * The ID used to register the plot cache with the \ref MemoryGovernor.
+         */
+        MemoryGovernor::ConsumerId plotCacheConsumerId;
+
         /**
          * The graphics/scene instance used by this class.
          */
@@ -0,0 +1,190 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyPopulations class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_POPULATIONS_H
+#define LATENCY_POPULATIONS_H
+
+#include <QVector>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+#include "aggregated_latency_entry.h"
+
+/**
+ * Class that holds a collection of latency sub-populations in structure-of-arrays form.  Each statistic is held in its
+ * own contiguous array so the combining kernels stream through memory and can be vectorized by the compiler.
+ *
+ * The kernels accumulate into several independent lanes that are summed at the end.  This breaks the loop carried
+ * dependency on each running sum, allowing the compiler to use SIMD registers without relaxing floating point
+ * semantics, and keeps results deterministic for a given input order.
+ */
+class LatencyPopulations {
+    public:
+        /**
+         * Type used to represent a latency value.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * Trivial class used to report the statistics of a combined population.
+         */
+        class Summary {
+            public:
+                /**
+                 * The number of samples in the combined population.
+                 */
+                unsigned long long numberSamples;
+
+                /**
+                 * The mean latency of the combined population, in microseconds.
+                 */
+                double meanLatency;
+
+                /**
+                 * The population variance of the combined population, in microseconds squared.
+                 */
+                double varianceLatency;
+
+                /**
+                 * The minimum latency of the combined population, in microseconds.
+                 */
+                LatencyMicroseconds minimumLatency;
+
+                /**
+                 * The maximum latency of the combined population, in microseconds.
+                 */
+                LatencyMicroseconds maximumLatency;
+        };
+
+        LatencyPopulations();
+
+        ~LatencyPopulations();
+
+        /**
+         * Method you can use to determine the number of sub-populations.
+         *
+         * \return Returns the number of sub-populations.
+         */
+        unsigned long size() const;
+
+        /**
+         * Method you can use to determine if there are no sub-populations.
+         *
+         * \return Returns true if there are no sub-populations.
+         */
+        bool isEmpty() const;
+
+        /**
+         * Method you can use to reserve space for sub-populations.
+         *
+         * \param[in] numberPopulations The number of sub-populations to reserve space for.
+         */
+        void reserve(unsigned long numberPopulations);
+
+        /**
+         * Method you can use to remove every sub-population.
+         */
+        void clear();
+
+        /**
+         * Method you can use to add a sub-population.  Empty sub-populations are ignored.
+         *
+         * \param[in] meanLatency     The mean latency of the sub-population, in microseconds.
+         *
+         * \param[in] varianceLatency The population variance of the sub-population.
+         *
+         * \param[in] minimumLatency  The minimum latency of the sub-population, in microseconds.
+         *
+         * \param[in] maximumLatency  The maximum latency of the sub-population, in microseconds.
+         *
+         * \param[in] numberSamples   The number of samples in the sub-population.
+         */
+        void append(
+            double              meanLatency,
+            double              varianceLatency,
+            LatencyMicroseconds minimumLatency,
+            LatencyMicroseconds maximumLatency,
+            unsigned long       numberSamples
+        );
+
+        /**
+         * Method you can use to add an aggregated entry as a sub-population.
+         *
+         * \param[in] entry The aggregated entry to be added.
+         */
+        void append(const AggregatedLatencyEntry& entry);
+
+        /**
+         * Method you can use to combine every sub-population.
+         *
+         * \return Returns the statistics of the combined population.  The number of samples will be zero if there
+         *         are no sub-populations.
+         */
+        Summary combine() const;
+
+        /**
+         * Method you can use to combine a contiguous range of sub-populations.
+         *
+         * \param[in] firstIndex The zero based index of the first sub-population in the range.
+         *
+         * \param[in] lastIndex  The zero based index just past the last sub-population in the range.
+         *
+         * \return Returns the statistics of the combined population.  The number of samples will be zero if the
+         *         range is empty.
+         */
+        Summary combine(unsigned long firstIndex, unsigned long lastIndex) const;
+
+    private:
+        /**
+         * The number of independent accumulation lanes used by the kernels.
+         */
+        static constexpr unsigned numberLanes = 4;
+
+        /**
+         * The mean latency of each sub-population.
+         */
+        QVector<double> currentMeans;
+
+        /**
+         * The variance of each sub-population.
+         */
+        QVector<double> currentVariances;
+
+        /**
+         * The number of samples in each sub-population.  Counts are held as doubles so the kernels operate on a
+         * single data type.
+         */
+        QVector<double> currentCounts;
+
+        /**
+         * The minimum latency of each sub-population.
+         */
+        QVector<LatencyMicroseconds> currentMinimums;
+
+        /**
+         * The maximum latency of each sub-population.
+         */
+        QVector<LatencyMicroseconds> currentMaximums;
+};
+
+#endif
@@ -0,0 +1,330 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyPurger class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_PURGER_H
+#define LATENCY_PURGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "customers_capabilities.h"
+
+class QSqlDatabase;
+class DatabaseManager;
+
+/**
+ * Class that purges latency entries for customers as a background job.  Each purge is recorded in a job table so
+ * progress can be reported and an interrupted purge is resumed after a restart.  Entries are deleted in bounded
+ * batches, each committed with the job's progress, and batches are paced to a configurable number of rows per second
+ * so a purge never holds locks long enough to stall ingest.
+ *
+ * This class expects a table defined as:
+ *
+ *     CREATE TYPE latency_purge_job_status AS ENUM('PENDING','RUNNING','COMPLETED','FAILED');
+ *
+ *     CREATE TABLE latency_purge_job (
+ *         job_id       BIGSERIAL NOT NULL PRIMARY KEY,
+ *         customer_ids TEXT NOT NULL,
+ *         table_names  TEXT NOT NULL,
+ *         table_index  SMALLINT NOT NULL DEFAULT 0,
+ *         rows_deleted BIGINT NOT NULL DEFAULT 0,
+ *         status       latency_purge_job_status NOT NULL DEFAULT 'PENDING'
+ *     );
+ */
+class LatencyPurger:public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to represent a purge job ID.
+         */
+        typedef unsigned long long JobId;
+
+        /**
+         * Value used to indicate an invalid job ID.
+         */
+        static constexpr JobId invalidJobId = 0;
+
+        /**
+         * The default number of rows deleted per batch.
+         */
+        static const unsigned long defaultBatchSize;
+
+        /**
+         * The default maximum number of rows deleted per second.
+         */
+        static const unsigned long defaultRowsPerSecond;
+
+        /**
+         * Enumeration of purge job states.
+         */
+        enum class Status {
+            /**
+             * Indicates the job has not been started.
+             */
+            PENDING,
+
+            /**
+             * Indicates the job is in progress or was interrupted and will be resumed.
+             */
+            RUNNING,
+
+            /**
+             * Indicates every entry for the job's customers has been deleted.
+             */
+            COMPLETED,
+
+            /**
+             * Indicates the job could not be completed.
+             */
+            FAILED
+        };
+
+        /**
+         * Trivial class used to report the progress of a purge job.
+         */
+        class JobStatus {
+            public:
+                /**
+                 * The job's current state.
+                 */
+                Status status;
+
+                /**
+                 * The number of rows deleted so far.
+                 */
+                unsigned long long rowsDeleted;
+
+                /**
+                 * The number of tables fully purged.
+                 */
+                unsigned numberTablesCompleted;
+
+                /**
+                 * The number of tables to be purged.
+                 */
+                unsigned numberTables;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] databaseManager The database manager used to access the latency tables.
+         *
+         * \param[in] parent          Pointer to the parent object.
+         */
+        LatencyPurger(DatabaseManager* databaseManager, QObject* parent = nullptr);
+
+        ~LatencyPurger() override;
+
+        /**
+         * Method you can use to convert a job status to a string.
+         *
+         * \param[in] status The status to be converted.
+         *
+         * \return Returns the status as a string.
+         */
+        static QString toString(Status status);
+
+        /**
+         * Method you can use to convert a string to a job status.
+         *
+         * \param[in]  str     The string to be converted.
+         *
+         * \param[out] success An optional pointer to a boolean value holding true on success or false on error.
+         *
+         * \return Returns the status.
+         */
+        static Status toStatus(const QString& str, bool* success = nullptr);
+
+        /**
+         * Method you can use to queue a purge of latency entries.  The method returns once the job is recorded.
+         *
+         * \param[in] customerIds The customer IDs of the users to have entries deleted for.
+         *
+         * \param[in] tableNames  The names of the tables to be purged.
+         *
+         * \param[in] threadId    An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the ID of the new job.  The value \ref invalidJobId is returned on error.
+         */
+        JobId startPurge(
+            const CustomersCapabilities::CustomerIdSet& customerIds,
+            const QStringList&                          tableNames,
+            unsigned                                    threadId = 0
+        );
+
+        /**
+         * Method you can use to obtain the progress of a purge job.
+         *
+         * \param[in]  jobId     The ID of the job of interest.
+         *
+         * \param[out] jobStatus The job's progress.
+         *
+         * \param[in]  threadId  An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false if the job does not exist or on error.
+         */
+        bool getJobStatus(JobId jobId, JobStatus& jobStatus, unsigned threadId = 0);
+
+        /**
+         * Method you can use to set the purge batch size and rate limit.
+         *
+         * \param[in] batchSize     The number of rows deleted per transaction.
+         *
+         * \param[in] rowsPerSecond The maximum number of rows deleted per second.
+         */
+        void setThrottle(unsigned long batchSize, unsigned long rowsPerSecond);
+
+        /**
+         * Method you can use to start working through unfinished purge jobs, including jobs left by a previous run.
+         * Call this method once the database connection settings are known.
+         */
+        void resumeJobs();
+
+    protected:
+        /**
+         * Method that processes purge jobs in the background.
+         */
+        void run() override;
+
+    private:
+        /**
+         * The number of milliseconds to wait before retrying after a database error.
+         */
+        static const unsigned long retryIntervalMilliseconds;
+
+        /**
+         * Method that works through a single purge job.
+         *
+         * \param[in,out] database    The database instance to be used.
+         *
+         * \param[in]     jobId       The ID of the job.
+         *
+         * \param[in]     customerIds The customer IDs, as a comma separated list.
+         *
+         * \param[in]     tableNames  The tables to be purged.
+         *
+         * \param[in]     tableIndex  The index of the first table not yet fully purged.
+         *
+         * \return Returns true if the job was completed or interrupted by shutdown.  Returns false on error.
+         */
+        bool purgeJob(
+            QSqlDatabase&      database,
+            JobId              jobId,
+            const QString&     customerIds,
+            const QStringList& tableNames,
+            unsigned           tableIndex
+        );
+
+        /**
+         * Method that deletes one batch of entries and records the job's progress in the same transaction.
+         *
+         * \param[in,out] database    The database instance to be used.
+         *
+         * \param[in]     jobId       The ID of the job.
+         *
+         * \param[in]     customerIds The customer IDs, as a comma separated list.
+         *
+         * \param[in]     tableName   The table to be purged.
+         *
+         * \param[in]     tableIndex  The index of the table being purged.
+         *
+         * \param[in]     batchSize   The maximum number of rows to be deleted.
+         *
+         * \param[out]    rowsDeleted The number of rows deleted.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool purgeBatch(
+            QSqlDatabase&  database,
+            JobId          jobId,
+            const QString& customerIds,
+            const QString& tableName,
+            unsigned       tableIndex,
+            unsigned long  batchSize,
+            unsigned long& rowsDeleted
+        );
+
+        /**
+         * Method that updates the state of a job.
+         *
+         * \param[in,out] database The database instance to be used.
+         *
+         * \param[in]     jobId    The ID of the job.
+         *
+         * \param[in]     status   The new job state.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool setJobStatus(QSqlDatabase& database, JobId jobId, Status status);
+
+        /**
+         * Method that waits for a period of time or until shutdown is requested.
+         *
+         * \param[in] milliseconds The maximum time to wait, in milliseconds.
+         *
+         * \return Returns true if shutdown was requested.
+         */
+        bool waitOrShutdown(unsigned long milliseconds);
+
+        /**
+         * The database manager used to access the latency tables.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * Mutex used to protect the job state shared with the purge thread.
+         */
+        QMutex jobMutex;
+
+        /**
+         * Wait condition used to wake the purge thread.
+         */
+        QWaitCondition jobCondition;
+
+        /**
+         * Flag indicating that a new job has been queued since the purge thread last checked.
+         */
+        bool jobsQueued;
+
+        /**
+         * Flag indicating that the purge thread should exit.
+         */
+        bool shutdownRequested;
+
+        /**
+         * The number of rows deleted per transaction.
+         */
+        unsigned long currentBatchSize;
+
+        /**
+         * The maximum number of rows deleted per second.
+         */
+        unsigned long currentRowsPerSecond;
+};
+
+#endif
@@ -0,0 +1,338 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyResultCache class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_RESULT_CACHE_H
+#define LATENCY_RESULT_CACHE_H
+
+#include <QByteArray>
+#include <QPair>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+#include <cstdint>
+
+#include "concurrent_cache.h"
+#include "latency_interface.h"
+#include "aggregated_latency_entry.h"
+
+/**
+ * Class that caches latency query results for a short time.  Results are keyed by their normalized query parameters
+ * and tagged with the version of the data they were read from so a cached result is only returned while its data is
+ * current.
+ *
+ * Identical queries issued concurrently share a single execution.  The first caller runs the query while later
+ * callers wait for and share its result.  This class is thread safe.
+ */
+class LatencyResultCache {
+    public:
+        /**
+         * Type used to track a list of raw latency entries.
+         */
+        typedef LatencyInterface::LatencyEntryList LatencyEntryList;
+
+        /**
+         * List of aggregated latency entries.
+         */
+        typedef QList<AggregatedLatencyEntry> AggregatedLatencyEntryList;
+
+        /**
+         * Type used to hold a combination of recent and aggregated latency entries.
+         */
+        typedef QPair<LatencyEntryList, AggregatedLatencyEntryList> LatencyEntryLists;
+
+        /**
+         * The default maximum number of cached results.
+         */
+        static constexpr unsigned long defaultCacheDepth = 64;
+
+        /**
+         * The default time a result remains valid, in milliseconds.
+         */
+        static constexpr unsigned long defaultTimeToLiveMilliseconds = 5000;
+
+        /**
+         * The divisor applied to the configured cache depth while under memory pressure.
+         */
+        static constexpr unsigned long pressureShrinkFactor = 4;
+
+        /**
+         * Constructor
+         *
+         * \param[in] maximumCacheDepth The maximum number of cached results.
+         */
+        LatencyResultCache(unsigned long maximumCacheDepth = defaultCacheDepth);
+
+        ~LatencyResultCache();
+
+        /**
+         * Method you can use to change the maximum number of cached results.
+         *
+         * \param[in] newCacheSize The new maximum number of cached results.
+         */
+        void resizeCache(unsigned long newCacheSize);
+
+        /**
+         * Method you can use to obtain the result cache statistics.
+         *
+         * \return Returns the cache statistics, summed across all shards.
+         */
+        CacheBase::Statistics statistics() const;
+
+        /**
+         * Method you can use to estimate the memory held by the cached results.
+         *
+         * \return Returns the approximate memory usage, in bytes.
+         */
+        unsigned long long memoryUsage() const;
+
+        /**
+         * Method you can use to shrink the cache while the process is under memory pressure.  The cache is reduced to
+         * \ref LatencyResultCache::pressureShrinkFactor of its configured size and restored once pressure is released.
+         *
+         * \param[in] underPressure If true, the cache is shrunk.  If false, the configured size is restored.
+         */
+        void setMemoryPressure(bool underPressure);
+
+        /**
+         * Method you can use to set the time a result remains valid.
+         *
+         * \param[in] timeToLiveMilliseconds The time to live, in milliseconds.  A value of 0 disables caching although
+         *                                   concurrent identical queries still share a single execution.
+         */
+        void setTimeToLive(unsigned long timeToLiveMilliseconds);
+
+        /**
+         * Method you can use to look up a result.  If an identical query is already running, this method waits for it
+         * to finish.  If no result is available, the caller becomes responsible for running the query and must call
+         * \ref LatencyResultCache::finishQuery when done.
+         *
+         * \param[in]  key         The normalized query parameters.
+         *
+         * \param[in]  dataVersion The current version of the data covered by the query.  The version should be read
+         *                         before the query is run so that data arriving while the query runs invalidates the
+         *                         result.
+         *
+         * \param[out] result      The cached result.  The value is only updated if a current result is found.
+         *
+         * \return Returns true if a current result was found.  Returns false if the caller must run the query.
+         */
+        bool startQuery(const QByteArray& key, unsigned long long dataVersion, LatencyEntryLists& result);
+
+        /**
+         * Method you must call after running a query started with \ref LatencyResultCache::startQuery.
+         *
+         * \param[in] key         The normalized query parameters.
+         *
+         * \param[in] dataVersion The data version passed to \ref LatencyResultCache::startQuery.
+         *
+         * \param[in] result      The query result.  A null pointer indicates the query failed.  Waiting callers then
+         *                        run the query themselves.
+         */
+        void finishQuery(const QByteArray& key, unsigned long long dataVersion, const LatencyEntryLists* result);
+
+    private:
+        /**
+         * Trivial class holding a single result.
+         */
+        class Result {
+            public:
+                Result() {
+                    dataVersion    = 0;
+                    expirationTime = 0;
+                }
+
+                /**
+                 * The normalized query parameters.
+                 */
+                QByteArray key;
+
+                /**
+                 * The version of the data the result was read from.
+                 */
+                unsigned long long dataVersion;
+
+                /**
+                 * The time, in milliseconds since the cache was created, when this result expires.
+                 */
+                qint64 expirationTime;
+
+                /**
+                 * The result.
+                 */
+                LatencyEntryLists entries;
+        };
+
+        /**
+         * Trivial class used to track a running query and hand its result to waiting callers.  A finished query is
+         * deleted by the last waiting caller.
+         */
+        class Flight {
+            public:
+                Flight() {
+                    numberWaiters = 0;
+                    finished      = false;
+                    succeeded     = false;
+                }
+
+                /**
+                 * The number of callers waiting for this query.
+                 */
+                unsigned numberWaiters;
+
+                /**
+                 * Flag indicating the query has finished.
+                 */
+                bool finished;
+
+                /**
+                 * Flag indicating the query succeeded.
+                 */
+                bool succeeded;
+
+                /**
+                 * The query result.
+                 */
+                Result result;
+        };
+
+        /**
+         * Method that calculates the cache ID used for a key.
+         *
+         * \param[in] key The normalized query parameters.
+         *
+         * \return Returns the cache ID for the key.
+         */
+        static std::uint64_t keyHash(const QByteArray& key);
+
+        /**
+         * Method that looks up a current result.
+         *
+         * \param[in]  key         The normalized query parameters.
+         *
+         * \param[in]  dataVersion The current version of the data covered by the query.
+         *
+         * \param[out] result      The cached result.  The value is only updated if a current result is found.
+         *
+         * \return Returns true if a current result was found.
+         */
+        bool getResult(const QByteArray& key, unsigned long long dataVersion, LatencyEntryLists& result) const;
+
+        /**
+         * Class that holds the results.
+         */
+        class EntryCache:public ConcurrentCache<Result, std::uint64_t> {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] maximumCacheDepth The maximum allowed cache depth.
+                 */
+                EntryCache(
+                        unsigned long maximumCacheDepth
+                    ):ConcurrentCache<Result, std::uint64_t>(
+                        maximumCacheDepth,
+                        EvictionPolicy::CLOCK
+                    ) {}
+
+                ~EntryCache() override {}
+
+            protected:
+                /**
+                 * Method that obtains the ID used to access a specific value.
+                 *
+                 * \param[in] value The value to calculate the ID for.
+                 *
+                 * \return Returns the ID to associate with this value.
+                 */
+                std::uint64_t idFromValue(const Result& value) const final {
+                    return keyHash(value.key);
+                }
+        };
+
+        /**
+         * The cached results.
+         */
+        mutable EntryCache entryCache;
+
+        /**
+         * Method that applies the configured size, reduced if under memory pressure.  The depth mutex must be held.
+         */
+        void applyCacheDepth();
+
+        /**
+         * Method that folds the size of a newly cached result into the running average.
+         *
+         * \param[in] entryBytes The approximate size of the result, in bytes.
+         */
+        void updateAverageEntryBytes(unsigned long long entryBytes);
+
+        /**
+         * Mutex protecting the configured cache depth and the memory pressure flag.
+         */
+        QMutex depthMutex;
+
+        /**
+         * The configured cache depth.
+         */
+        unsigned long currentCacheDepth;
+
+        /**
+         * Flag indicating the cache is shrunk due to memory pressure.
+         */
+        bool underMemoryPressure;
+
+        /**
+         * Running average of the size of a cached result, in bytes.
+         */
+        QAtomicInteger<quint64> averageEntryBytes;
+
+        /**
+         * Clock used to expire results.
+         */
+        QElapsedTimer clock;
+
+        /**
+         * The time a result remains valid, in milliseconds.
+         */
+        QAtomicInteger<quint64> currentTimeToLive;
+
+        /**
+         * Mutex used to protect the running queries.
+         */
+        QMutex inFlightMutex;
+
+        /**
+         * Wait condition signalled when a running query finishes.
+         */
+        QWaitCondition inFlightCondition;
+
+        /**
+         * The running queries, keyed by normalized query parameters.
+         */
+        QHash<QByteArray, Flight*> flights;
+};
+
+#endif
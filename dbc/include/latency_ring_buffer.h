@@ -0,0 +1,343 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyRingBuffer class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_RING_BUFFER_H
+#define LATENCY_RING_BUFFER_H
+
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QVector>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+
+/**
+ * Class that holds recent latency entries in memory, one compact ring per monitor and server.  Entries are added as
+ * they're received so recent-window reads can be served without touching the database and include entries that are
+ * still queued for a flush.
+ *
+ * The buffer covers every entry timestamped at or after its coverage start, which is the later of the time the buffer
+ * was enabled and the retention window.  A series that overflows its ring moves the coverage start forward for any
+ * read that includes that series.  This class is thread safe.
+ */
+class LatencyRingBuffer {
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a Zoran timestamp.
+         */
+        typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+        /**
+         * Type used to represent a latency value.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * Type used to represent a set of monitor IDs.
+         */
+        typedef QSet<MonitorId> MonitorIdSet;
+
+        /**
+         * Type used to represent a list of latency entries.
+         */
+        typedef QList<LatencyEntry> LatencyEntryList;
+
+        /**
+         * The default retention window, in seconds.
+         */
+        static const unsigned long defaultRetention;
+
+        /**
+         * The maximum number of entries held for a single monitor and server.
+         */
+        static const unsigned maximumEntriesPerSeries;
+
+        LatencyRingBuffer();
+
+        ~LatencyRingBuffer();
+
+        /**
+         * Method you can use to set the retention window.  Changing the window discards every held entry and restarts
+         * coverage from the current time.
+         *
+         * \param[in] retentionSeconds The retention window, in seconds.  A value of 0 disables the buffer.
+         */
+        void setRetention(unsigned long retentionSeconds);
+
+        /**
+         * Method you can use to obtain the retention window.
+         *
+         * \return Returns the retention window, in seconds.  A value of 0 indicates the buffer is disabled.
+         */
+        unsigned long retention() const;
+
+        /**
+         * Method you can use to add an entry.
+         *
+         * \param[in] monitorId           The ID of the monitor tied to this entry.
+         *
+         * \param[in] serverId            The ID of the server where this measurement was taken.
+         *
+         * \param[in] zoranTimestamp      The timestamp relative to the start of the Zoran epoch.
+         *
+         * \param[in] latencyMicroseconds The latency measurement, in microseconds.
+         */
+        void addEntry(
+            MonitorId           monitorId,
+            ServerId            serverId,
+            ZoranTimeStamp      zoranTimestamp,
+            LatencyMicroseconds latencyMicroseconds
+        );
+
+        /**
+         * Method you can use to add a collection of entries.
+         *
+         * \param[in] latencyEntries The entries to be added.
+         */
+        void addEntries(const LatencyEntryList& latencyEntries);
+
+        /**
+         * Method you can use to discard every entry tied to a collection of monitors.
+         *
+         * \param[in] monitorIds The IDs of the monitors to discard.
+         */
+        void removeMonitors(const MonitorIdSet& monitorIds);
+
+        /**
+         * Method you can use to discard entries that have aged out of the retention window.  Entries are also
+         * discarded as new entries arrive for a series so this method only needs to be called periodically to release
+         * idle series.
+         */
+        void expire();
+
+        /**
+         * Method you can use to read entries.
+         *
+         * \param[in]  monitorIds     The monitors to read.  A null pointer reads every monitor.
+         *
+         * \param[in]  serverId       The server to read.  An invalid server ID reads every server.
+         *
+         * \param[in]  startTimestamp The starting Unix timestamp (inclusive).
+         *
+         * \param[in]  endTimestamp   The ending Unix timestamp (inclusive).
+         *
+         * \param[out] latencyEntries The list populated with every held entry in the window at or after the returned
+         *                            coverage start, ordered by timestamp, monitor ID and server ID.
+         *
+         * \return Returns the Unix timestamp where coverage of the requested series starts.  Older entries must be
+         *         read from the database.  The maximum unsigned long long value is returned if the buffer is
+         *         disabled.
+         */
+        unsigned long long getEntries(
+            const MonitorIdSet* monitorIds,
+            ServerId            serverId,
+            unsigned long long  startTimestamp,
+            unsigned long long  endTimestamp,
+            LatencyEntryList&   latencyEntries
+        ) const;
+
+    private:
+        /**
+         * The number of independently locked stripes.  Monitors are assigned to stripes by monitor ID.
+         */
+        static constexpr unsigned numberStripes = 64;
+
+        /**
+         * Trivial class holding a single compact entry.
+         */
+        class Sample {
+            public:
+                /**
+                 * The Zoran timestamp.
+                 */
+                ZoranTimeStamp zoranTimestamp;
+
+                /**
+                 * The latency, in microseconds.
+                 */
+                LatencyMicroseconds latencyMicroseconds;
+        };
+
+        /**
+         * Class holding the ring of entries for a single monitor and server.
+         */
+        class Series {
+            public:
+                Series();
+
+                ~Series();
+
+                /**
+                 * Method that adds a sample, overwriting the oldest sample if the ring is full.
+                 *
+                 * \param[in] sample The sample to add.
+                 */
+                void append(const Sample& sample);
+
+                /**
+                 * Method that discards samples older than a cutoff.
+                 *
+                 * \param[in] cutoff The Zoran timestamp of the oldest sample to keep.
+                 */
+                void expire(ZoranTimeStamp cutoff);
+
+                /**
+                 * Method you can use to determine if the series holds no samples.
+                 *
+                 * \return Returns true if the series is empty.
+                 */
+                bool isEmpty() const;
+
+                /**
+                 * Method you can use to obtain a sample.
+                 *
+                 * \param[in] index The zero based index of the sample, oldest first.
+                 *
+                 * \return Returns the requested sample.
+                 */
+                const Sample& at(unsigned index) const;
+
+                /**
+                 * Method you can use to obtain the number of samples.
+                 *
+                 * \return Returns the number of samples.
+                 */
+                unsigned size() const;
+
+                /**
+                 * Method you can use to obtain the newest Zoran timestamp overwritten because the ring was full.
+                 *
+                 * \return Returns the newest overwritten timestamp.  A value of 0 indicates no sample was overwritten.
+                 */
+                ZoranTimeStamp overwrittenThrough() const;
+
+            private:
+                /**
+                 * The ring storage.  The capacity is always a power of two.
+                 */
+                QVector<Sample> samples;
+
+                /**
+                 * The index of the oldest sample.
+                 */
+                unsigned currentFirst;
+
+                /**
+                 * The number of samples.
+                 */
+                unsigned currentSize;
+
+                /**
+                 * The newest Zoran timestamp overwritten because the ring was full.
+                 */
+                ZoranTimeStamp currentOverwrittenThrough;
+        };
+
+        /**
+         * Type used to hold the series for one monitor, keyed by server ID.
+         */
+        typedef QHash<ServerId, Series> SeriesByServer;
+
+        /**
+         * Class holding the series for the monitors assigned to one stripe.
+         */
+        class Stripe {
+            public:
+                /**
+                 * Mutex used to protect this stripe.
+                 */
+                mutable QMutex mutex;
+
+                /**
+                 * The series, keyed by monitor ID.
+                 */
+                QHash<MonitorId, SeriesByServer> seriesByMonitor;
+        };
+
+        /**
+         * Method that reads entries from one monitor's series.  The stripe mutex must be locked.
+         *
+         * \param[in]     seriesByServer The monitor's series.
+         *
+         * \param[in]     monitorId      The monitor ID.
+         *
+         * \param[in]     serverId       The server to read.  An invalid server ID reads every server.
+         *
+         * \param[in]     startTimestamp The starting Zoran timestamp (inclusive).
+         *
+         * \param[in]     endTimestamp   The ending Zoran timestamp (inclusive).
+         *
+         * \param[in,out] coverageStart  The coverage start, as a Zoran timestamp, moved forward past any overwritten
+         *                               samples.
+         *
+         * \param[in,out] latencyEntries The list to append entries to.
+         */
+        static void readSeries(
+            const SeriesByServer& seriesByServer,
+            MonitorId             monitorId,
+            ServerId              serverId,
+            ZoranTimeStamp        startTimestamp,
+            ZoranTimeStamp        endTimestamp,
+            ZoranTimeStamp&       coverageStart,
+            LatencyEntryList&     latencyEntries
+        );
+
+        /**
+         * Method that calculates the Zoran timestamp of the oldest entry to keep.
+         *
+         * \param[in] retentionSeconds The retention window, in seconds.
+         *
+         * \return Returns the cutoff Zoran timestamp.
+         */
+        static ZoranTimeStamp cutoffTimestamp(unsigned long retentionSeconds);
+
+        /**
+         * The stripes.
+         */
+        Stripe stripes[numberStripes];
+
+        /**
+         * The retention window, in seconds.
+         */
+        QAtomicInteger<quint64> currentRetention;
+
+        /**
+         * The Unix timestamp where coverage started.
+         */
+        QAtomicInteger<quint64> currentCoverageStart;
+};
+
+#endif
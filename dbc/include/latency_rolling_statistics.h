@@ -0,0 +1,483 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref LatencyRollingStatistics class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_ROLLING_STATISTICS_H
+#define LATENCY_ROLLING_STATISTICS_H
+
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QString>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+
+/**
+ * Class that tracks rolling latency statistics for every monitor and server as entries are received.  Each series
+ * holds one exponentially decayed accumulator per window so the current mean, variance and approximate percentiles of
+ * recent latency can be read without touching the database.
+ *
+ * Each window's length is used as the decay time constant so a sample's weight falls by a factor of e every window.
+ * Percentiles are interpolated from a decayed histogram with logarithmically spaced buckets.  Samples that arrive out
+ * of order are treated as arriving with the newest sample in their series.  This class is thread safe.
+ */
+class LatencyRollingStatistics {
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a Zoran timestamp.
+         */
+        typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+        /**
+         * Type used to represent a latency value.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * Type used to represent a set of monitor IDs.
+         */
+        typedef QSet<MonitorId> MonitorIdSet;
+
+        /**
+         * Type used to represent a list of latency entries.
+         */
+        typedef QList<LatencyEntry> LatencyEntryList;
+
+        /**
+         * Enumeration of supported windows.
+         */
+        enum class Window : std::uint8_t {
+            /**
+             * Indicates a five minute window.
+             */
+            FIVE_MINUTES = 0,
+
+            /**
+             * Indicates a one hour window.
+             */
+            ONE_HOUR = 1,
+
+            /**
+             * Indicates a 24 hour window.
+             */
+            ONE_DAY = 2
+        };
+
+        /**
+         * The number of supported windows.
+         */
+        static constexpr unsigned numberWindows = 3;
+
+        /**
+         * The length of each window, in seconds, indexed by window.
+         */
+        static const unsigned long windowSeconds[numberWindows];
+
+        /**
+         * The time a series can go without new entries before it's discarded, in seconds.
+         */
+        static const unsigned long maximumIdleSeconds;
+
+        /**
+         * Trivial class holding the statistics for one window.
+         */
+        class Summary {
+            public:
+                Summary() {
+                    weight            = 0;
+                    meanLatency       = 0;
+                    varianceLatency   = 0;
+                    p50Latency        = 0;
+                    p90Latency        = 0;
+                    p99Latency        = 0;
+                    lastUnixTimestamp = 0;
+                }
+
+                /**
+                 * Method you can use to determine if this summary holds any samples.
+                 *
+                 * \return Returns true if the summary holds samples.  Returns false if the summary is empty.
+                 */
+                inline bool isValid() const {
+                    return weight > 0;
+                }
+
+                /**
+                 * The decayed number of samples in the window.
+                 */
+                double weight;
+
+                /**
+                 * The decayed mean latency, in microseconds.
+                 */
+                double meanLatency;
+
+                /**
+                 * The decayed latency variance, in microseconds squared.
+                 */
+                double varianceLatency;
+
+                /**
+                 * The approximate median latency, in microseconds.
+                 */
+                double p50Latency;
+
+                /**
+                 * The approximate 90th percentile latency, in microseconds.
+                 */
+                double p90Latency;
+
+                /**
+                 * The approximate 99th percentile latency, in microseconds.
+                 */
+                double p99Latency;
+
+                /**
+                 * The Unix timestamp of the newest sample.
+                 */
+                unsigned long long lastUnixTimestamp;
+        };
+
+        /**
+         * Type used to represent summaries keyed by monitor ID.
+         */
+        typedef QHash<MonitorId, Summary> SummariesByMonitorId;
+
+        LatencyRollingStatistics();
+
+        ~LatencyRollingStatistics();
+
+        /**
+         * Method you can use to enable or disable tracking.  Disabling tracking discards every series.
+         *
+         * \param[in] nowEnabled If true, entries are tracked.  If false, entries are ignored.
+         */
+        void setEnabled(bool nowEnabled);
+
+        /**
+         * Method you can use to determine if tracking is enabled.
+         *
+         * \return Returns true if tracking is enabled.
+         */
+        bool isEnabled() const;
+
+        /**
+         * Method you can use to add an entry.
+         *
+         * \param[in] monitorId           The ID of the monitor tied to this entry.
+         *
+         * \param[in] serverId            The ID of the server where this measurement was taken.
+         *
+         * \param[in] zoranTimestamp      The timestamp relative to the start of the Zoran epoch.
+         *
+         * \param[in] latencyMicroseconds The latency measurement, in microseconds.
+         */
+        void addEntry(
+            MonitorId           monitorId,
+            ServerId            serverId,
+            ZoranTimeStamp      zoranTimestamp,
+            LatencyMicroseconds latencyMicroseconds
+        );
+
+        /**
+         * Method you can use to add a collection of entries.
+         *
+         * \param[in] latencyEntries The entries to be added.
+         */
+        void addEntries(const LatencyEntryList& latencyEntries);
+
+        /**
+         * Method you can use to discard every series tied to a collection of monitors.
+         *
+         * \param[in] monitorIds The IDs of the monitors to discard.
+         */
+        void removeMonitors(const MonitorIdSet& monitorIds);
+
+        /**
+         * Method you can use to discard series that have received no entries for \ref maximumIdleSeconds.
+         */
+        void expire();
+
+        /**
+         * Method you can use to obtain the statistics for a single monitor.
+         *
+         * \param[in] monitorId The monitor of interest.
+         *
+         * \param[in] serverId  The server of interest.  An invalid server ID combines every server.
+         *
+         * \param[in] window    The window of interest.
+         *
+         * \return Returns the statistics decayed to the current time.  An invalid summary is returned if the monitor
+         *         has no samples.
+         */
+        Summary summary(MonitorId monitorId, ServerId serverId, Window window) const;
+
+        /**
+         * Method you can use to obtain the statistics for a collection of monitors.
+         *
+         * \param[in] monitorIds The monitors of interest.  A null pointer reads every monitor.
+         *
+         * \param[in] serverId   The server of interest.  An invalid server ID combines every server.
+         *
+         * \param[in] window     The window of interest.
+         *
+         * \return Returns the statistics decayed to the current time, keyed by monitor ID.  Monitors without samples
+         *         are excluded.
+         */
+        SummariesByMonitorId summaries(const MonitorIdSet* monitorIds, ServerId serverId, Window window) const;
+
+        /**
+         * Method you can use to convert a window to a string.
+         *
+         * \param[in] window The window to convert.
+         *
+         * \return Returns the window as a short string such as "5m".
+         */
+        static QString toString(Window window);
+
+    private:
+        /**
+         * The number of independently locked stripes.  Monitors are assigned to stripes by monitor ID.
+         */
+        static constexpr unsigned numberStripes = 64;
+
+        /**
+         * The number of histogram buckets.  Bucket 0 holds latencies below \ref firstBucketLimit and each later
+         * bucket is wider than the one before it by a factor of the square root of 2.
+         */
+        static constexpr unsigned numberBuckets = 32;
+
+        /**
+         * The upper limit of the first histogram bucket, in microseconds.
+         */
+        static const double firstBucketLimit;
+
+        /**
+         * Class holding one decayed accumulator.
+         */
+        class Accumulator {
+            public:
+                Accumulator();
+
+                ~Accumulator();
+
+                /**
+                 * Method that scales every sample in the accumulator.
+                 *
+                 * \param[in] factor The factor to scale by.
+                 */
+                void decay(double factor);
+
+                /**
+                 * Method that adds a sample with a weight of 1.
+                 *
+                 * \param[in] latency The sample latency, in microseconds.
+                 *
+                 * \param[in] bucket  The histogram bucket holding the sample.
+                 */
+                void add(double latency, unsigned bucket);
+
+                /**
+                 * Method that merges another accumulator into this one.
+                 *
+                 * \param[in] other The accumulator to merge.
+                 */
+                void merge(const Accumulator& other);
+
+                /**
+                 * Method that builds a summary from this accumulator.
+                 *
+                 * \param[in] lastZoranTimestamp The Zoran timestamp of the newest sample.
+                 *
+                 * \return Returns the summary.
+                 */
+                Summary toSummary(ZoranTimeStamp lastZoranTimestamp) const;
+
+            private:
+                /**
+                 * Method that calculates an approximate quantile from the histogram.
+                 *
+                 * \param[in] fraction The quantile, between 0 and 1.
+                 *
+                 * \return Returns the approximate latency at the quantile, in microseconds.
+                 */
+                double quantile(double fraction) const;
+
+                /**
+                 * The decayed number of samples.
+                 */
+                double currentWeight;
+
+                /**
+                 * The decayed mean.
+                 */
+                double currentMean;
+
+                /**
+                 * The decayed sum of squared differences from the mean.
+                 */
+                double currentSumSquares;
+
+                /**
+                 * The decayed histogram.
+                 */
+                float currentBuckets[numberBuckets];
+        };
+
+        /**
+         * Class holding the accumulators for a single monitor and server.
+         */
+        class Series {
+            public:
+                Series();
+
+                ~Series();
+
+                /**
+                 * Method that adds a sample.
+                 *
+                 * \param[in] zoranTimestamp      The sample timestamp.
+                 *
+                 * \param[in] latencyMicroseconds The sample latency.
+                 */
+                void add(ZoranTimeStamp zoranTimestamp, LatencyMicroseconds latencyMicroseconds);
+
+                /**
+                 * Method that merges one window of this series, decayed to a given time, into an accumulator.
+                 *
+                 * \param[in]     window         The window to merge.
+                 *
+                 * \param[in]     zoranTimestamp The Zoran timestamp to decay to.
+                 *
+                 * \param[in,out] accumulator    The accumulator to merge into.
+                 */
+                void mergeInto(Window window, ZoranTimeStamp zoranTimestamp, Accumulator& accumulator) const;
+
+                /**
+                 * Method you can use to obtain the timestamp of the newest sample.
+                 *
+                 * \return Returns the Zoran timestamp of the newest sample.
+                 */
+                ZoranTimeStamp lastTimestamp() const;
+
+            private:
+                /**
+                 * The accumulators, indexed by window.
+                 */
+                Accumulator accumulators[numberWindows];
+
+                /**
+                 * The Zoran timestamp of the newest sample.
+                 */
+                ZoranTimeStamp currentLastTimestamp;
+        };
+
+        /**
+         * Type used to hold the series for one monitor, keyed by server ID.
+         */
+        typedef QHash<ServerId, Series> SeriesByServer;
+
+        /**
+         * Class holding the series for the monitors assigned to one stripe.
+         */
+        class Stripe {
+            public:
+                /**
+                 * Mutex used to protect this stripe.
+                 */
+                mutable QMutex mutex;
+
+                /**
+                 * The series, keyed by monitor ID.
+                 */
+                QHash<MonitorId, SeriesByServer> seriesByMonitor;
+        };
+
+        /**
+         * Method that combines one monitor's series into a summary.  The stripe mutex must be locked.
+         *
+         * \param[in] seriesByServer The monitor's series.
+         *
+         * \param[in] serverId       The server to read.  An invalid server ID combines every server.
+         *
+         * \param[in] window         The window to read.
+         *
+         * \param[in] zoranTimestamp The Zoran timestamp to decay to.
+         *
+         * \return Returns the combined summary.
+         */
+        static Summary summarizeSeries(
+            const SeriesByServer& seriesByServer,
+            ServerId              serverId,
+            Window                window,
+            ZoranTimeStamp        zoranTimestamp
+        );
+
+        /**
+         * Method that calculates the histogram bucket holding a latency.
+         *
+         * \param[in] latency The latency, in microseconds.
+         *
+         * \return Returns the zero based bucket index.
+         */
+        static unsigned bucketIndex(double latency);
+
+        /**
+         * Method that calculates the lower limit of a histogram bucket.
+         *
+         * \param[in] bucket The zero based bucket index.
+         *
+         * \return Returns the lower limit, in microseconds.
+         */
+        static double bucketLowerLimit(unsigned bucket);
+
+        /**
+         * Method that calculates the current Zoran timestamp.
+         *
+         * \return Returns the current Zoran timestamp.
+         */
+        static ZoranTimeStamp currentZoranTimestamp();
+
+        /**
+         * The stripes.
+         */
+        Stripe stripes[numberStripes];
+
+        /**
+         * Flag indicating if tracking is enabled.
+         */
+        QAtomicInteger<int> currentEnabled;
+};
+
+#endif
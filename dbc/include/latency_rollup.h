@@ -0,0 +1,243 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencyRollup class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_ROLLUP_H
+#define LATENCY_ROLLUP_H
+
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QRandomGenerator>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+#include "aggregated_latency_entry.h"
+#include "latency_sketch.h"
+
+/**
+ * Class that maintains running statistics for each monitor, server, and resample period as latency entries arrive.
+ * Each accumulator tracks the Welford running mean and variance, the minimum, maximum, and sample count, plus a single
+ * entry reservoir sample, so a closed period can be written as an \ref AggregatedLatencyEntry without re-reading the
+ * raw entries from the database.
+ *
+ * Entries timestamped before the coverage start are ignored.  Periods before the coverage start are left to the
+ * \ref LatencyAggregator so no period is ever counted twice.
+ *
+ * This class is not thread safe.  It is expected to be used only from the flushing thread.
+ */
+class LatencyRollup {
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a list of aggregated latency entries.
+         */
+        typedef QList<AggregatedLatencyEntry> AggregatedLatencyEntryList;
+
+        /**
+         * Constructor
+         *
+         * \param[in] resamplePeriod The resample period, in seconds.
+         *
+         * \param[in] coverageStart  The Unix timestamp of the first period covered by this rollup.  The value should
+         *                           be aligned to the resample period.
+         */
+        LatencyRollup(unsigned long resamplePeriod, unsigned long long coverageStart);
+
+        ~LatencyRollup();
+
+        /**
+         * Method you can use to determine the resample period.
+         *
+         * \return Returns the resample period, in seconds.
+         */
+        unsigned long resamplePeriod() const;
+
+        /**
+         * Method you can use to determine the start of the periods covered by this rollup.
+         *
+         * \return Returns the Unix timestamp of the first covered period.
+         */
+        unsigned long long coverageStart() const;
+
+        /**
+         * Method you can use to determine the number of open accumulators.
+         *
+         * \return Returns the number of accumulators across all periods.
+         */
+        unsigned long numberAccumulators() const;
+
+        /**
+         * Method you can use to add a latency entry to the rollup.
+         *
+         * \param[in] monitorId           The monitor ID of the entry.
+         *
+         * \param[in] serverId            The server ID of the entry.
+         *
+         * \param[in] zoranTimestamp      The timestamp of the entry, relative to the Zoran epoch.
+         *
+         * \param[in] latencyMicroseconds The latency of the entry, in microseconds.
+         */
+        void addEntry(
+            MonitorId                         monitorId,
+            ServerId                          serverId,
+            LatencyEntry::ZoranTimeStamp      zoranTimestamp,
+            LatencyEntry::LatencyMicroseconds latencyMicroseconds
+        );
+
+        /**
+         * Method you can use to obtain the aggregated entries for every period that ends at or before a threshold.
+         * The periods are retained until \ref removeClosedPeriods is called so a failed write can be retried.
+         *
+         * \param[in]  closeThreshold  The Unix timestamp used to close periods.
+         *
+         * \param[out] latencySketches An optional list populated with the quantile sketch for each returned entry.
+         *
+         * \return Returns the aggregated entries for the closed periods.
+         */
+        AggregatedLatencyEntryList closedPeriods(
+            unsigned long long    closeThreshold,
+            QList<LatencySketch>* latencySketches = nullptr
+        ) const;
+
+        /**
+         * Method you can use to discard every period that ends at or before a threshold.
+         *
+         * \param[in] closeThreshold The Unix timestamp used to close periods.
+         */
+        void removeClosedPeriods(unsigned long long closeThreshold);
+
+    private:
+        /**
+         * Class that holds the running statistics for a single monitor, server, and period.
+         */
+        class Accumulator {
+            public:
+                Accumulator();
+
+                ~Accumulator() = default;
+
+                /**
+                 * Method that adds a sample to the accumulator.
+                 *
+                 * \param[in] zoranTimestamp      The timestamp of the sample.
+                 *
+                 * \param[in] latencyMicroseconds The sample latency, in microseconds.
+                 *
+                 * \param[in] randomGenerator     The random generator used to maintain the reservoir sample.
+                 */
+                void add(
+                    LatencyEntry::ZoranTimeStamp      zoranTimestamp,
+                    LatencyEntry::LatencyMicroseconds latencyMicroseconds,
+                    QRandomGenerator&                 randomGenerator
+                );
+
+                /**
+                 * The number of samples.
+                 */
+                unsigned long numberSamples;
+
+                /**
+                 * The running mean latency.
+                 */
+                double meanLatency;
+
+                /**
+                 * The running sum of squared differences from the mean.
+                 */
+                double sumSquaredDifferences;
+
+                /**
+                 * The minimum latency.
+                 */
+                LatencyEntry::LatencyMicroseconds minimumLatency;
+
+                /**
+                 * The maximum latency.
+                 */
+                LatencyEntry::LatencyMicroseconds maximumLatency;
+
+                /**
+                 * The timestamp of the reservoir sample.
+                 */
+                LatencyEntry::ZoranTimeStamp sampleZoranTimestamp;
+
+                /**
+                 * The latency of the reservoir sample.
+                 */
+                LatencyEntry::LatencyMicroseconds sampleLatency;
+
+                /**
+                 * The quantile sketch of the samples.
+                 */
+                LatencySketch sketch;
+        };
+
+        /**
+         * Type used to hold accumulators keyed by monitor and server ID.
+         */
+        typedef QHash<std::uint64_t, Accumulator> AccumulatorsByKey;
+
+        /**
+         * Method that calculates the accumulator key for a monitor and server.
+         *
+         * \param[in] monitorId The monitor ID.
+         *
+         * \param[in] serverId  The server ID.
+         *
+         * \return Returns the accumulator key.
+         */
+        static inline std::uint64_t key(MonitorId monitorId, ServerId serverId) {
+            return (static_cast<std::uint64_t>(monitorId) << 16) | static_cast<std::uint64_t>(serverId);
+        }
+
+        /**
+         * The resample period, in seconds.
+         */
+        unsigned long currentResamplePeriod;
+
+        /**
+         * The first covered period.
+         */
+        unsigned long long currentCoverageStart;
+
+        /**
+         * The accumulators, keyed by the Unix timestamp of the start of each period.
+         */
+        QMap<unsigned long long, AccumulatorsByKey> accumulatorsByPeriod;
+
+        /**
+         * The random generator used to maintain reservoir samples.
+         */
+        QRandomGenerator randomGenerator;
+};
+
+#endif
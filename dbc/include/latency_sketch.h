@@ -0,0 +1,207 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencySketch class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_SKETCH_H
+#define LATENCY_SKETCH_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+
+/**
+ * Class that maintains a mergeable quantile sketch of latency values.  Values are counted in logarithmically spaced
+ * buckets so any reported quantile is within \ref relativeAccuracy of a true sample value regardless of the number
+ * of samples or their distribution.
+ *
+ * The serialized form is a sequence of fixed size records, each holding a little endian 16-bit bucket index followed
+ * by a little endian 32-bit count.  A bucket may appear in more than one record and the counts are summed when the
+ * sketch is decoded.  The concatenation of two serialized sketches is therefore the serialized form of their merged
+ * sketch, which lets the database merge sketches with the "||" operator or the string_agg aggregate.
+ */
+class LatencySketch {
+    public:
+        /**
+         * Type used to represent a latency value.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * The relative accuracy of reported quantiles.
+         */
+        static const double relativeAccuracy;
+
+        /**
+         * The ratio between the upper and lower bounds of each bucket.
+         */
+        static const double gamma;
+
+        /**
+         * The size of each serialized record, in bytes.
+         */
+        static const unsigned recordSize;
+
+        LatencySketch();
+
+        /**
+         * Copy constructor
+         *
+         * \param[in] other The instance to be copied.
+         */
+        LatencySketch(const LatencySketch& other);
+
+        ~LatencySketch();
+
+        /**
+         * Method you can use to determine if this sketch holds no samples.
+         *
+         * \return Returns true if the sketch is empty.  Returns false if the sketch holds samples.
+         */
+        bool isEmpty() const;
+
+        /**
+         * Method you can use to determine the number of samples represented by this sketch.
+         *
+         * \return Returns the number of samples.
+         */
+        unsigned long long numberSamples() const;
+
+        /**
+         * Method you can use to add a latency value to the sketch.
+         *
+         * \param[in] latencyMicroseconds The latency value, in microseconds.
+         *
+         * \param[in] count               The number of samples with this value.
+         */
+        void addValue(LatencyMicroseconds latencyMicroseconds, unsigned long long count = 1);
+
+        /**
+         * Method you can use to add samples directly to a bucket.  This allows bucket counts computed by the database
+         * to be folded into the sketch.
+         *
+         * \param[in] bucketIndex The bucket index, as reported by \ref bucketIndex.
+         *
+         * \param[in] count       The number of samples to add to the bucket.
+         */
+        void addBucket(int bucketIndex, unsigned long long count);
+
+        /**
+         * Method you can use to merge another sketch into this sketch.
+         *
+         * \param[in] other The sketch to be merged.
+         */
+        void merge(const LatencySketch& other);
+
+        /**
+         * Method you can use to remove every sample from this sketch.
+         */
+        void clear();
+
+        /**
+         * Method you can use to estimate a quantile.
+         *
+         * \param[in] quantile The desired quantile, between 0 and 1 inclusive.
+         *
+         * \return Returns the estimated latency at the requested quantile, in microseconds.  A value of 0 is
+         *         returned if the sketch is empty.
+         */
+        LatencyMicroseconds quantile(double quantile) const;
+
+        /**
+         * Method you can use to redistribute the sketch into equal width bins.  The samples in each sketch bucket are
+         * spread across the bins overlapping the bucket in proportion to the overlap.  Samples outside the requested
+         * range are ignored.
+         *
+         * \param[in] minimumMicroseconds The lower edge of the first bin, in microseconds.
+         *
+         * \param[in] maximumMicroseconds The upper edge of the last bin, in microseconds.
+         *
+         * \param[in] numberBins          The number of bins.
+         *
+         * \return Returns the estimated number of samples in each bin.
+         */
+        QVector<double> histogram(double minimumMicroseconds, double maximumMicroseconds, unsigned numberBins) const;
+
+        /**
+         * Method you can use to serialize this sketch.
+         *
+         * \return Returns the serialized sketch.
+         */
+        QByteArray toByteArray() const;
+
+        /**
+         * Method you can use to decode a serialized sketch.
+         *
+         * \param[in]  data    The serialized sketch.  The value may be the concatenation of several serialized
+         *                     sketches.
+         *
+         * \param[out] success An optional pointer to a boolean value populated with true on success or false if the
+         *                     data is malformed.
+         *
+         * \return Returns the decoded sketch.  An empty sketch is returned on error.
+         */
+        static LatencySketch fromByteArray(const QByteArray& data, bool* success = nullptr);
+
+        /**
+         * Method that calculates the bucket index for a latency value.  The database computes the same value as
+         * CEIL(LN(GREATEST(latency, 1)) / LN(gamma)).
+         *
+         * \param[in] latencyMicroseconds The latency value, in microseconds.
+         *
+         * \return Returns the bucket index.
+         */
+        static int bucketIndex(LatencyMicroseconds latencyMicroseconds);
+
+        /**
+         * Assignment operator
+         *
+         * \param[in] other The instance to assign to this instance.
+         *
+         * \return Returns a reference to this instance.
+         */
+        LatencySketch& operator=(const LatencySketch& other);
+
+    private:
+        /**
+         * Method that calculates the representative value of a bucket.
+         *
+         * \param[in] bucketIndex The bucket index.
+         *
+         * \return Returns the representative latency for the bucket.
+         */
+        static LatencyMicroseconds bucketValue(int bucketIndex);
+
+        /**
+         * The sample counts, keyed by bucket index.
+         */
+        QMap<int, unsigned long long> currentCounts;
+
+        /**
+         * The total number of samples.
+         */
+        unsigned long long currentNumberSamples;
+};
+
+#endif
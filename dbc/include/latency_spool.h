@@ -0,0 +1,370 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LatencySpool class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LATENCY_SPOOL_H
+#define LATENCY_SPOOL_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QtGlobal>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+#include "latency_entry_chunk_list.h"
+
+class QFile;
+
+/**
+ * Class that provides a crash-safe, append-only, memory-mapped spool of pending latency entries for a single region.
+ * Producers append entries from any thread.  A single consumer reads entries in arrival order and checkpoints its
+ * position once the entries have been committed to the database.
+ *
+ * The spool is stored as a directory of fixed size segment files plus a small checkpoint file.  Each record carries a
+ * marker that is written last so a restart can locate the end of the spool by scanning the final segment.  Segment
+ * files are written through a shared memory mapping so appended entries survive a crash of this process.  Entries
+ * after the last checkpoint are replayed on restart which means a crash between a database commit and the following
+ * checkpoint can flush a batch twice.  Duplicates are discarded by the database insert.
+ */
+class LatencySpool {
+    public:
+        /**
+         * Type used to represent a monitor ID.
+         */
+        typedef LatencyEntry::MonitorId MonitorId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef LatencyEntry::ServerId ServerId;
+
+        /**
+         * Type used to represent a list of latency entries.
+         */
+        typedef QList<LatencyEntry> LatencyEntryList;
+
+        /**
+         * The default number of records held by each segment file.
+         */
+        static const unsigned long defaultSegmentCapacity;
+
+        /**
+         * Constructor
+         *
+         * \param[in] directory       The directory used to hold the spool files.  The directory is created if needed.
+         *
+         * \param[in] segmentCapacity The number of records held by each segment file.
+         */
+        LatencySpool(const QString& directory, unsigned long segmentCapacity = defaultSegmentCapacity);
+
+        ~LatencySpool();
+
+        /**
+         * Method you can use to open the spool, replaying any entries that were never checkpointed.  This method must
+         * be called before any other method.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool open();
+
+        /**
+         * Method you can use to determine the directory holding this spool.
+         *
+         * \return Returns the spool directory.
+         */
+        const QString& directory() const;
+
+        /**
+         * Method you can use to determine the number of entries that have not yet been read by the consumer.
+         *
+         * \return Returns the number of unread entries.
+         */
+        unsigned long numberUnreadEntries();
+
+        /**
+         * Method you can use to append a block of raw latency entries received from a polling server.
+         *
+         * \param[in] serverId      The ID of the region server where these measurements were taken.
+         *
+         * \param[in] payload       The buffer holding the raw entries.
+         *
+         * \param[in] offset        The byte offset to the first \ref LatencyInterface::RawEntry in the payload.
+         *
+         * \param[in] numberEntries The number of raw entries.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool append(ServerId serverId, const QByteArray& payload, unsigned long offset, unsigned long numberEntries);
+
+        /**
+         * Method you can use to append a list of latency entries.
+         *
+         * \param[in] latencyEntries The entries to be appended.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool append(const LatencyEntryList& latencyEntries);
+
+        /**
+         * Method you can use to read unread entries, in arrival order.  The read position is advanced but is not made
+         * persistent until \ref LatencySpool::checkpoint is called.  This method must only be called by the consumer.
+         *
+         * \param[in] destination    The list to receive the entries.
+         *
+         * \param[in] maximumEntries The maximum number of entries to be read.
+         *
+         * \return Returns the number of entries read.
+         */
+        unsigned long read(LatencyEntryChunkList& destination, unsigned long maximumEntries);
+
+        /**
+         * Method you can use to make the current read position persistent.  Segment files that have been fully read
+         * are removed.  This method must only be called by the consumer.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool checkpoint();
+
+    private:
+        /**
+         * Structure used to represent a single record in a segment file.
+         */
+        struct Record {
+            /**
+             * The monitor ID.
+             */
+            std::uint32_t monitorId;
+
+            /**
+             * The Zoran timestamp.
+             */
+            std::uint32_t timestamp;
+
+            /**
+             * The latency in microseconds
+             */
+            std::uint32_t latencyMicroseconds;
+
+            /**
+             * The server ID.
+             */
+            std::uint16_t serverId;
+
+            /**
+             * Marker written last to indicate that the record is complete.
+             */
+            std::uint16_t marker;
+        } __attribute__((packed));
+
+        /**
+         * Structure used to represent the header at the start of each segment file.
+         */
+        struct SegmentHeader {
+            /**
+             * Value used to identify a segment file.
+             */
+            char magic[8];
+
+            /**
+             * The file format version.
+             */
+            std::uint32_t version;
+
+            /**
+             * The number of records held by the segment.
+             */
+            std::uint32_t capacity;
+
+            /**
+             * Padding to keep records aligned.
+             */
+            std::uint8_t reserved[16];
+        } __attribute__((packed));
+
+        /**
+         * Structure used to represent the checkpoint file.
+         */
+        struct Checkpoint {
+            /**
+             * Value used to identify a checkpoint file.
+             */
+            char magic[8];
+
+            /**
+             * The sequence number of the segment holding the next unread record.
+             */
+            std::uint64_t sequence;
+
+            /**
+             * The index of the next unread record within the segment.
+             */
+            std::uint64_t index;
+        } __attribute__((packed));
+
+        /**
+         * Class holding a single mapped segment file.
+         */
+        class Segment {
+            public:
+                /**
+                 * The segment sequence number.
+                 */
+                std::uint64_t sequence;
+
+                /**
+                 * The underlying file.
+                 */
+                QFile* file;
+
+                /**
+                 * The start of the mapped file.
+                 */
+                uchar* mapping;
+
+                /**
+                 * The mapped records.
+                 */
+                Record* records;
+
+                /**
+                 * The number of records held by the segment.
+                 */
+                unsigned long capacity;
+
+                /**
+                 * The number of records written to the segment.
+                 */
+                unsigned long numberWritten;
+        };
+
+        /**
+         * Method that generates the filename for a segment.
+         *
+         * \param[in] sequence The segment sequence number.
+         *
+         * \return Returns the absolute path to the segment file.
+         */
+        QString segmentFilename(std::uint64_t sequence) const;
+
+        /**
+         * Method that opens and maps a segment file, creating it if needed.
+         *
+         * \param[in] sequence The segment sequence number.
+         *
+         * \param[in] create   If true, a new, empty, segment file will be created.
+         *
+         * \return Returns the newly opened segment.  A null pointer is returned on error.
+         */
+        Segment* openSegment(std::uint64_t sequence, bool create);
+
+        /**
+         * Method that locates an open segment by sequence number.  The spool mutex must be locked when this method is
+         * called.
+         *
+         * \param[in] sequence The segment sequence number.
+         *
+         * \return Returns the segment.  A null pointer is returned if the segment is not open.
+         */
+        Segment* findSegment(std::uint64_t sequence) const;
+
+        /**
+         * Method that unmaps and closes a segment.
+         *
+         * \param[in] segment The segment to be closed.
+         *
+         * \param[in] remove  If true, the segment file will also be removed.
+         */
+        static void closeSegment(Segment* segment, bool remove);
+
+        /**
+         * Method that obtains room for one more record.  The spool mutex must be locked when this method is called.
+         *
+         * \return Returns a pointer to the record to be written.  A null pointer is returned on error.
+         */
+        Record* reserveRecord();
+
+        /**
+         * Method that publishes a record by writing its marker.
+         *
+         * \param[in] record The record to be published.
+         */
+        static void publishRecord(Record* record);
+
+        /**
+         * Value written in each record's marker field.
+         */
+        static const std::uint16_t recordMarker;
+
+        /**
+         * The current spool file format version.
+         */
+        static const std::uint32_t formatVersion;
+
+        /**
+         * The segment file magic value.
+         */
+        static const char segmentMagic[8];
+
+        /**
+         * The checkpoint file magic value.
+         */
+        static const char checkpointMagic[8];
+
+        /**
+         * The spool directory.
+         */
+        QString currentDirectory;
+
+        /**
+         * The number of records held by each new segment.
+         */
+        unsigned long currentSegmentCapacity;
+
+        /**
+         * Mutex protecting the segment list and write position.
+         */
+        QMutex spoolMutex;
+
+        /**
+         * The open segments, oldest first.
+         */
+        QList<Segment*> segments;
+
+        /**
+         * The sequence number of the segment holding the next record to be read.
+         */
+        std::uint64_t currentReadSequence;
+
+        /**
+         * Index of the next record to be read within the read segment.
+         */
+        unsigned long currentReadIndex;
+
+        /**
+         * The total number of records written but not yet read.
+         */
+        unsigned long currentNumberUnread;
+};
+
+#endif
@@ -26,7 +26,29 @@
 #include <QString>
 
 /**
- * Function you can use to write a log entry.
+ * Enumeration of log message severities.
+ */
+enum class LogSeverity {
+    /**
+     * Indicates an informational message.
+     */
+    INFO,
+
+    /**
+     * Indicates a warning.
+     */
+    WARNING,
+
+    /**
+     * Indicates an error.
+     */
+    ERROR
+};
+
+/**
+ * Function you can use to write a log entry.  Entries are queued and written by a background thread so this function
+ * never blocks on terminal or journal I/O.  Entries are dropped, and counted, if the queue is full or if the
+ * severity's rate limit has been reached.
  *
  * \param[in] message The log message.
  *
@@ -34,4 +56,30 @@
  */
 void logWrite(const QString& message, bool error = false);
 
+/**
+ * Function you can use to write a log entry with an explicit severity.
+ *
+ * \param[in] message  The log message.
+ *
+ * \param[in] severity The message severity.
+ */
+void logWrite(const QString& message, LogSeverity severity);
+
+/**
+ * Function you can use to set the maximum number of messages logged per second for a severity.
+ *
+ * \param[in] severity          The severity to be limited.
+ *
+ * \param[in] messagesPerSecond The maximum number of messages per second.  A value of 0 disables the limit.
+ */
+void logSetRateLimit(LogSeverity severity, unsigned messagesPerSecond);
+
+/**
+ * Function you can use to obtain the number of log messages dropped since startup, either because the queue was full
+ * or because a rate limit was reached.
+ *
+ * \return Returns the number of dropped messages.
+ */
+unsigned long long logMessagesDropped();
+
 #endif
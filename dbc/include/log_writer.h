@@ -0,0 +1,292 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref LogWriter class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <QString>
+#include <QMutex>
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <cstddef>
+
+#include "log.h"
+
+/**
+ * Class that queues log entries in a bounded, lock-free, ring buffer and writes them from a background thread in
+ * batches, flushing once per batch rather than once per entry.  Any number of threads may write entries concurrently.
+ * Entries are dropped and counted, never blocked, when the ring is full or when a severity's rate limit is reached.
+ * The writer periodically reports the number of dropped entries.
+ *
+ * The writer uses a standard library thread rather than a QThread so that it remains usable before the application
+ * object is created and after it is destroyed.  The queue is drained at process exit.  Entries written after that
+ * point are written synchronously.
+ */
+class LogWriter {
+    public:
+        /**
+         * The number of entries the ring buffer can hold.  The value must be a power of two.
+         */
+        static constexpr unsigned queueCapacity = 8192;
+
+        /**
+         * The default maximum number of entries per second for each severity.
+         */
+        static constexpr unsigned defaultRateLimit = 1000;
+
+        /**
+         * Method you can use to obtain the process wide log writer.  The writer is created on first use.
+         *
+         * \return Returns a pointer to the log writer.
+         */
+        static LogWriter* instance();
+
+        /**
+         * Method you can use to queue a log entry.
+         *
+         * \param[in] message  The message to be written.
+         *
+         * \param[in] severity The message severity.
+         */
+        void write(const QString& message, LogSeverity severity);
+
+        /**
+         * Method you can use to set the maximum number of entries per second for a severity.
+         *
+         * \param[in] severity          The severity to be limited.
+         *
+         * \param[in] messagesPerSecond The limit.  A value of 0 disables the limit.
+         */
+        void setRateLimit(LogSeverity severity, unsigned messagesPerSecond);
+
+        /**
+         * Method you can use to obtain the number of entries dropped since startup.
+         *
+         * \return Returns the number of dropped entries.
+         */
+        unsigned long long numberDropped() const;
+
+    private:
+        /**
+         * The number of severities.
+         */
+        static constexpr unsigned numberSeverities = 3;
+
+        /**
+         * Interval, in milliseconds, the writer sleeps when the queue is empty.
+         */
+        static constexpr unsigned idleIntervalMilliseconds = 10;
+
+        /**
+         * Interval, in milliseconds, between reports of dropped entries.
+         */
+        static constexpr unsigned dropReportIntervalMilliseconds = 10000;
+
+        /**
+         * Class holding a single queued entry.  The sequence number tracks which lap of the ring the slot belongs to
+         * and whether it is waiting to be filled or to be written.
+         */
+        class Slot {
+            public:
+                Slot();
+
+                /**
+                 * The slot sequence number.
+                 */
+                std::atomic<std::size_t> sequence;
+
+                /**
+                 * The time the entry was logged, in milliseconds since the Unix epoch.
+                 */
+                long long timestamp;
+
+                /**
+                 * The entry severity.
+                 */
+                LogSeverity severity;
+
+                /**
+                 * The entry message.
+                 */
+                QString message;
+        };
+
+        /**
+         * Class that tracks the entries logged in the current second for one severity.
+         */
+        class RateLimiter {
+            public:
+                RateLimiter();
+
+                /**
+                 * The second, since the Unix epoch, being counted.
+                 */
+                std::atomic<long long> currentSecond;
+
+                /**
+                 * The number of entries accepted in the current second.
+                 */
+                std::atomic<unsigned> currentCount;
+
+                /**
+                 * The maximum number of entries per second.  A value of 0 disables the limit.
+                 */
+                std::atomic<unsigned> limit;
+        };
+
+        LogWriter();
+
+        ~LogWriter();
+
+        /**
+         * Method registered to run at process exit.  Stops the writer thread and drains the queue.
+         */
+        static void shutdown();
+
+        /**
+         * Method that checks and updates the rate limit for a severity.
+         *
+         * \param[in] severity  The entry severity.
+         *
+         * \param[in] timestamp The entry time, in milliseconds since the Unix epoch.
+         *
+         * \return Returns true if the entry may be logged.  Returns false if the rate limit has been reached.
+         */
+        bool allow(LogSeverity severity, long long timestamp);
+
+        /**
+         * Method that adds an entry to the queue.
+         *
+         * \param[in] message   The message to be written.
+         *
+         * \param[in] severity  The message severity.
+         *
+         * \param[in] timestamp The entry time, in milliseconds since the Unix epoch.
+         *
+         * \return Returns true on success.  Returns false if the queue is full.
+         */
+        bool enqueue(const QString& message, LogSeverity severity, long long timestamp);
+
+        /**
+         * Method that moves every queued entry into the output batches.  Only the writer may call this method.
+         *
+         * \param[in,out] outputBatch The batch of entries for the standard output.
+         *
+         * \param[in,out] errorBatch  The batch of entries for the standard error.
+         *
+         * \return Returns the number of entries moved.
+         */
+        unsigned long drain(std::string& outputBatch, std::string& errorBatch);
+
+        /**
+         * Method that writes batches to the standard output and standard error and flushes both.
+         *
+         * \param[in,out] outputBatch The batch of entries for the standard output.  The batch is cleared.
+         *
+         * \param[in,out] errorBatch  The batch of entries for the standard error.  The batch is cleared.
+         */
+        static void flush(std::string& outputBatch, std::string& errorBatch);
+
+        /**
+         * Method that formats a single entry.
+         *
+         * \param[in] message   The message.
+         *
+         * \param[in] severity  The message severity.
+         *
+         * \param[in] timestamp The entry time, in milliseconds since the Unix epoch.
+         *
+         * \return Returns the formatted line, including the terminating newline.
+         */
+        static std::string format(const QString& message, LogSeverity severity, long long timestamp);
+
+        /**
+         * Method that reports entries dropped since the last report.  Only the writer may call this method.
+         *
+         * \param[in,out] errorBatch The batch of entries for the standard error.
+         */
+        void reportDropped(std::string& errorBatch);
+
+        /**
+         * The writer thread body.
+         */
+        void run();
+
+        /**
+         * The ring buffer.
+         */
+        Slot slots[queueCapacity];
+
+        /**
+         * The position of the next slot to be filled.
+         */
+        std::atomic<std::size_t> enqueuePosition;
+
+        /**
+         * The position of the next slot to be written.  Only used by the writer.
+         */
+        std::size_t dequeuePosition;
+
+        /**
+         * Per severity rate limiters.
+         */
+        RateLimiter rateLimiters[numberSeverities];
+
+        /**
+         * The number of entries dropped because the queue was full.
+         */
+        std::atomic<unsigned long long> numberDroppedQueueFull;
+
+        /**
+         * The number of entries dropped because of a rate limit.
+         */
+        std::atomic<unsigned long long> numberDroppedRateLimited;
+
+        /**
+         * The number of dropped entries included in the last report.  Only used by the writer.
+         */
+        unsigned long long numberDroppedReported;
+
+        /**
+         * Flag indicating the writer thread should stop.
+         */
+        std::atomic<bool> stopRequested;
+
+        /**
+         * Flag indicating that entries are written synchronously because the writer thread has stopped.
+         */
+        std::atomic<bool> synchronous;
+
+        /**
+         * Mutex used to serialize synchronous writes.
+         */
+        QMutex synchronousMutex;
+
+        /**
+         * The writer thread.
+         */
+        std::thread writerThread;
+};
+
+#endif
@@ -0,0 +1,262 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref MemoryGovernor class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef MEMORY_GOVERNOR_H
+#define MEMORY_GOVERNOR_H
+
+#include <QString>
+#include <QMap>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+#include <functional>
+
+#include "periodic_scheduler.h"
+
+/**
+ * Singleton class that enforces a single memory budget across the queues and caches of this process.  Subsystems
+ * register as consumers, reporting their approximate usage and reacting to the current pressure stage.
+ *
+ * Usage is periodically compared against a soft and a hard limit.  The larger of the accounted usage and the resident
+ * set size of the process is used so memory that no consumer tracks still counts against the budget.  While usage
+ * remains above the soft limit the stage escalates one step per evaluation, first shrinking result caches then forcing
+ * early flushes.  Reaching the hard limit applies ingest backpressure immediately.  Stages are relaxed one step per
+ * evaluation once usage falls below \ref MemoryGovernor::releaseFraction of the soft limit.
+ */
+class MemoryGovernor {
+    public:
+        /**
+         * Enumeration of memory pressure stages.  Each stage includes the responses of the stages before it.
+         */
+        enum class Stage : int {
+            /**
+             * Indicates usage is within budget.
+             */
+            NORMAL = 0,
+
+            /**
+             * Indicates result caches should shrink.
+             */
+            SHRINK_CACHES = 1,
+
+            /**
+             * Indicates queues should be flushed early.
+             */
+            FORCE_FLUSH = 2,
+
+            /**
+             * Indicates producers should be throttled.
+             */
+            BACKPRESSURE = 3
+        };
+
+        /**
+         * Type used to identify a registered consumer.
+         */
+        typedef unsigned long ConsumerId;
+
+        /**
+         * Value used to indicate an invalid consumer ID.
+         */
+        static constexpr ConsumerId invalidConsumerId = 0;
+
+        /**
+         * Type of function used to report a consumer's approximate memory usage, in bytes.  The function may be
+         * called from any thread.
+         */
+        typedef std::function<unsigned long long()> UsageFunction;
+
+        /**
+         * Type of function called when the pressure stage changes.  The function is called with the governor's lock
+         * held and must not call back into the governor.
+         */
+        typedef std::function<void(Stage stage)> ResponseFunction;
+
+        /**
+         * The default interval between evaluations, in seconds.
+         */
+        static constexpr unsigned long defaultEvaluationIntervalSeconds = 5;
+
+        /**
+         * The fraction of the soft limit usage must fall below before the stage is relaxed.
+         */
+        static constexpr double releaseFraction = 0.9;
+
+        /**
+         * Method you can use to obtain the global instance.
+         *
+         * \return Returns a pointer to the global instance.
+         */
+        static MemoryGovernor* instance();
+
+        /**
+         * Method you can use to set the memory limits.
+         *
+         * \param[in] softLimit The usage, in bytes, above which memory is shed.  A value of zero disables the
+         *                      governor.
+         *
+         * \param[in] hardLimit The usage, in bytes, at which ingest backpressure is applied.  A value of zero
+         *                      disables backpressure.
+         */
+        void setLimits(unsigned long long softLimit, unsigned long long hardLimit);
+
+        /**
+         * Method you can use to register a consumer.  The response function is called immediately with the current
+         * stage.
+         *
+         * \param[in] name             The consumer name, used in log messages and metrics.
+         *
+         * \param[in] usageFunction    The function reporting the consumer's usage.
+         *
+         * \param[in] responseFunction The function called when the pressure stage changes.
+         *
+         * \return Returns the ID of the new consumer.
+         */
+        ConsumerId registerConsumer(
+            const QString&          name,
+            const UsageFunction&    usageFunction,
+            const ResponseFunction& responseFunction
+        );
+
+        /**
+         * Method you can use to unregister a consumer.  Unregister consumers before they are destroyed.
+         *
+         * \param[in] consumerId The ID of the consumer.
+         */
+        void unregisterConsumer(ConsumerId consumerId);
+
+        /**
+         * Method you can use to obtain the current pressure stage.
+         *
+         * \return Returns the current stage.
+         */
+        inline Stage stage() const {
+            return static_cast<Stage>(currentStage.loadAcquire());
+        }
+
+        /**
+         * Method you can use to obtain the usage measured by the last evaluation.
+         *
+         * \return Returns the measured usage, in bytes.
+         */
+        inline unsigned long long usage() const {
+            return currentUsage.loadAcquire();
+        }
+
+        /**
+         * Method you can use to convert a stage to a string.
+         *
+         * \param[in] stage The stage to be converted.
+         *
+         * \return Returns the stage as a string.
+         */
+        static QString toString(Stage stage);
+
+    private:
+        /**
+         * Trivial class holding a registered consumer.
+         */
+        class Consumer {
+            public:
+                /**
+                 * The consumer name.
+                 */
+                QString name;
+
+                /**
+                 * The function reporting the consumer's usage.
+                 */
+                UsageFunction usageFunction;
+
+                /**
+                 * The function called when the pressure stage changes.
+                 */
+                ResponseFunction responseFunction;
+        };
+
+        MemoryGovernor();
+
+        ~MemoryGovernor();
+
+        /**
+         * Method that compares usage against the limits and updates the stage.  Called from the periodic scheduler.
+         */
+        void evaluate();
+
+        /**
+         * Method that reads the resident set size of this process.
+         *
+         * \return Returns the resident set size, in bytes.  A value of zero is returned if the size is not available.
+         */
+        static unsigned long long residentSetSize();
+
+        /**
+         * Method that determines the metric labels used for a consumer.
+         *
+         * \param[in] name The consumer name.
+         *
+         * \return Returns the metric labels.
+         */
+        static QString metricLabels(const QString& name);
+
+        /**
+         * Mutex protecting the consumers and limits.
+         */
+        QMutex consumersMutex;
+
+        /**
+         * The registered consumers by ID.
+         */
+        QMap<ConsumerId, Consumer> consumers;
+
+        /**
+         * The ID to assign to the next consumer.
+         */
+        ConsumerId nextConsumerId;
+
+        /**
+         * The soft limit, in bytes.
+         */
+        unsigned long long currentSoftLimit;
+
+        /**
+         * The hard limit, in bytes.
+         */
+        unsigned long long currentHardLimit;
+
+        /**
+         * The current stage.
+         */
+        QAtomicInt currentStage;
+
+        /**
+         * The usage measured by the last evaluation, in bytes.
+         */
+        QAtomicInteger<quint64> currentUsage;
+
+        /**
+         * The ID of the evaluation task.
+         */
+        PeriodicScheduler::TaskId evaluationTaskId;
+};
+
+#endif
@@ -28,6 +28,8 @@
 #include <QHostAddress>
 #include <QJsonDocument>
 
+#include "outbound_rest_api_factory.h"
+
 /**
  * Function you can call during application start-up to register metatypes required by the application.
  */
@@ -39,5 +41,6 @@ void registerMetaTypes();
 
 Q_DECLARE_METATYPE(QHostAddress)
 Q_DECLARE_METATYPE(QJsonDocument)
+Q_DECLARE_METATYPE(OutboundRestApiFactory::LatenciesByServerIdentifier)
 
 #endif
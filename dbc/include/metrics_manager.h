@@ -0,0 +1,202 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref MetricsManager class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef METRICS_MANAGER_H
+#define METRICS_MANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QJsonDocument>
+
+#include <rest_api_in_v1_server.h>
+#include <rest_api_in_v1_json_response.h>
+#include <rest_api_in_v1_inesonic_rest_handler.h>
+#include <rest_api_in_v1_inesonic_binary_rest_handler.h>
+
+class MetricsRegistry;
+class QueryStatistics;
+class ResponseCompressor;
+
+/**
+ * Class that supports REST endpoints used to obtain the contents of the \ref MetricsRegistry and the
+ * \ref QueryStatistics.
+ */
+class MetricsManager:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Path used to obtain the metrics in the Prometheus text exposition format.
+         */
+        static const QString metricsGetPath;
+
+        /**
+         * Path used to obtain the per-statement query statistics.
+         */
+        static const QString metricsQueriesPath;
+
+        /**
+         * Constructor
+         *
+         * \param[in] restApiServer      The REST API server instance.
+         *
+         * \param[in] metricsRegistry    The registry holding the metrics to be reported.
+         *
+         * \param[in] queryStatistics    The per-statement query statistics to be reported.
+         *
+         * \param[in] responseCompressor Class used to compress large responses.
+         *
+         * \param[in[ secret             The incoming data secret.
+         *
+         * \param[in] parent             Pointer to the parent object.
+         */
+        MetricsManager(
+            RestApiInV1::Server* restApiServer,
+            MetricsRegistry*     metricsRegistry,
+            QueryStatistics*     queryStatistics,
+            ResponseCompressor*  responseCompressor,
+            const QByteArray&    secret,
+            QObject*             parent = nullptr
+        );
+
+        ~MetricsManager() override;
+
+        /**
+         * Method you can use to set the Inesonic authentication secret.
+         *
+         * \param[in] newSecret The new secret to be used.  The secret must be the length prescribed by the
+         *                      constant \ref inesonicSecretLength.
+         */
+        void setSecret(const QByteArray& newSecret);
+
+    private:
+        /**
+         * The metrics/get handler.
+         */
+        class MetricsGet:public RestApiInV1::InesonicBinaryRestHandler {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret             The secret to use for this handler.
+                 *
+                 * \param[in] metricsRegistry    The registry holding the metrics to be reported.
+                 *
+                 * \param[in] responseCompressor Class used to compress large responses.
+                 */
+                MetricsGet(
+                    const QByteArray&   secret,
+                    MetricsRegistry*    metricsRegistry,
+                    ResponseCompressor* responseCompressor
+                );
+
+                ~MetricsGet() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path      The request path.
+                 *
+                 * \param[in] request   The request data encoded as a JSON document.  The document may optionally
+                 *                      hold an "accept_encoding" value.
+                 *
+                 * \param[in] threadId  The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, in the Prometheus text exposition format and compressed if
+                 *         requested.
+                 */
+                RestApiInV1::Response* processAuthenticatedRequest(
+                    const QString&    path,
+                    const QByteArray& request,
+                    unsigned          threadId
+                ) override;
+
+            private:
+                /**
+                 * The registry holding the metrics to be reported.
+                 */
+                MetricsRegistry* currentMetricsRegistry;
+
+                /**
+                 * The compressor applied to large responses.
+                 */
+                ResponseCompressor* currentResponseCompressor;
+        };
+
+        /**
+         * The metrics/queries handler.
+         */
+        class MetricsQueries:public RestApiInV1::InesonicRestHandler {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] secret          The secret to use for this handler.
+                 *
+                 * \param[in] queryStatistics The per-statement query statistics to be reported.
+                 */
+                MetricsQueries(const QByteArray& secret, QueryStatistics* queryStatistics);
+
+                ~MetricsQueries() override;
+
+            protected:
+                /**
+                 * Method you can overload to receive a request and send a return response.  This method will only be
+                 * triggered if the message meets the authentication requirements.
+                 *
+                 * \param[in] path     The request path.
+                 *
+                 * \param[in] request  The request data encoded as a JSON document.  The document may optionally
+                 *                     hold a "limit" value and a "reset" value.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify this thread while in flight.
+                 *
+                 * \return The response to return, also encoded as a JSON document.
+                 */
+                RestApiInV1::JsonResponse processAuthenticatedRequest(
+                    const QString&       path,
+                    const QJsonDocument& request,
+                    unsigned             threadId
+                ) override;
+
+            private:
+                /**
+                 * The per-statement query statistics to be reported.
+                 */
+                QueryStatistics* currentQueryStatistics;
+        };
+
+        /**
+         * The metrics/get handler.
+         */
+        MetricsGet metricsGet;
+
+        /**
+         * The metrics/queries handler.
+         */
+        MetricsQueries metricsQueries;
+};
+
+#endif
@@ -0,0 +1,492 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref MetricsRegistry class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef METRICS_REGISTRY_H
+#define METRICS_REGISTRY_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <functional>
+
+/**
+ * Class that holds the process wide set of counters, gauges and histograms.  Metrics are grouped into families by
+ * name.  Each family holds one series per label set.  Updating a metric is lock-free.  The registry lock is only
+ * taken when a series is created or removed and when the registry is rendered.
+ *
+ * Values already tracked elsewhere, such as cache statistics, can be exported through samplers that are called when
+ * the registry is rendered.  The registry renders in the Prometheus text exposition format.
+ */
+class MetricsRegistry {
+    public:
+        /**
+         * Enumeration of metric types.
+         */
+        enum class Type {
+            /**
+             * Indicates a monotonically increasing count.
+             */
+            COUNTER,
+
+            /**
+             * Indicates a value that can go up or down.
+             */
+            GAUGE,
+
+            /**
+             * Indicates a distribution of observations in fixed buckets.
+             */
+            HISTOGRAM
+        };
+
+        /**
+         * Type used to sample a value when the registry is rendered.
+         */
+        typedef std::function<double()> Sampler;
+
+        /**
+         * The default histogram bucket upper bounds, in seconds.
+         */
+        static const QList<double> defaultLatencyBuckets;
+
+        /**
+         * Base class for a single series.
+         */
+        class Metric {
+            public:
+                virtual ~Metric();
+
+                /**
+                 * Method that appends this series to a rendering.
+                 *
+                 * \param[in]     name   The family name.
+                 *
+                 * \param[in]     labels The series labels, without braces.  An empty string indicates no labels.
+                 *
+                 * \param[in,out] output The rendering to append to.
+                 */
+                virtual void render(const QString& name, const QString& labels, QByteArray& output) const = 0;
+        };
+
+        /**
+         * Class that holds a monotonically increasing count.
+         */
+        class Counter:public Metric {
+            public:
+                Counter();
+
+                ~Counter() override;
+
+                /**
+                 * Method you can use to increment the counter.
+                 *
+                 * \param[in] amount The amount to add.
+                 */
+                inline void increment(unsigned long long amount = 1) {
+                    currentValue.fetchAndAddRelaxed(amount);
+                }
+
+                /**
+                 * Method you can use to obtain the current count.
+                 *
+                 * \return Returns the current count.
+                 */
+                inline unsigned long long value() const {
+                    return currentValue.loadAcquire();
+                }
+
+                /**
+                 * Method that appends this series to a rendering.
+                 *
+                 * \param[in]     name   The family name.
+                 *
+                 * \param[in]     labels The series labels, without braces.
+                 *
+                 * \param[in,out] output The rendering to append to.
+                 */
+                void render(const QString& name, const QString& labels, QByteArray& output) const override;
+
+            private:
+                /**
+                 * The current count.
+                 */
+                QAtomicInteger<quint64> currentValue;
+        };
+
+        /**
+         * Class that holds a value that can go up or down.
+         */
+        class Gauge:public Metric {
+            public:
+                Gauge();
+
+                ~Gauge() override;
+
+                /**
+                 * Method you can use to set the gauge.
+                 *
+                 * \param[in] newValue The new value.
+                 */
+                inline void set(double newValue) {
+                    currentValue.store(newValue, std::memory_order_relaxed);
+                }
+
+                /**
+                 * Method you can use to adjust the gauge.
+                 *
+                 * \param[in] amount The amount to add.  Use a negative value to decrease the gauge.
+                 */
+                void add(double amount);
+
+                /**
+                 * Method you can use to obtain the current value.
+                 *
+                 * \return Returns the current value.
+                 */
+                inline double value() const {
+                    return currentValue.load(std::memory_order_relaxed);
+                }
+
+                /**
+                 * Method that appends this series to a rendering.
+                 *
+                 * \param[in]     name   The family name.
+                 *
+                 * \param[in]     labels The series labels, without braces.
+                 *
+                 * \param[in,out] output The rendering to append to.
+                 */
+                void render(const QString& name, const QString& labels, QByteArray& output) const override;
+
+            private:
+                /**
+                 * The current value.
+                 */
+                std::atomic<double> currentValue;
+        };
+
+        /**
+         * Class that counts observations in fixed buckets.
+         */
+        class Histogram:public Metric {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] bounds The bucket upper bounds, in increasing order.  An implicit final bucket holds
+                 *                   every observation.
+                 */
+                Histogram(const QList<double>& bounds);
+
+                ~Histogram() override;
+
+                /**
+                 * Method you can use to record an observation.
+                 *
+                 * \param[in] value The observed value.
+                 */
+                void observe(double value);
+
+                /**
+                 * Method that appends this series to a rendering.
+                 *
+                 * \param[in]     name   The family name.
+                 *
+                 * \param[in]     labels The series labels, without braces.
+                 *
+                 * \param[in,out] output The rendering to append to.
+                 */
+                void render(const QString& name, const QString& labels, QByteArray& output) const override;
+
+            private:
+                /**
+                 * The bucket upper bounds.
+                 */
+                QList<double> currentBounds;
+
+                /**
+                 * The per-bucket, non-cumulative, observation counts.
+                 */
+                QAtomicInteger<quint64>* currentCounts;
+
+                /**
+                 * The total number of observations.
+                 */
+                QAtomicInteger<quint64> currentCount;
+
+                /**
+                 * The sum of all observations.
+                 */
+                std::atomic<double> currentSum;
+        };
+
+        /**
+         * Class that measures the lifetime of a scope and records it, in seconds, to a histogram.
+         */
+        class ScopedTimer {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] histogram The histogram to receive the measurement.  A null pointer disables the timer.
+                 */
+                ScopedTimer(Histogram* histogram);
+
+                ~ScopedTimer();
+
+            private:
+                /**
+                 * The histogram to receive the measurement.
+                 */
+                Histogram* currentHistogram;
+
+                /**
+                 * Timer used to measure the scope.
+                 */
+                QElapsedTimer timer;
+        };
+
+        /**
+         * Method you can use to obtain the process wide registry.  The registry is created on first use.
+         *
+         * \return Returns a pointer to the registry.
+         */
+        static MetricsRegistry* instance();
+
+        /**
+         * Method you can use to build a single label.  The value is escaped as required.
+         *
+         * \param[in] name  The label name.
+         *
+         * \param[in] value The label value.
+         *
+         * \return Returns a label of the form name="value".
+         */
+        static QString label(const QString& name, const QString& value);
+
+        /**
+         * Method you can use to obtain the histogram tracking the latency of a database access method.
+         *
+         * \param[in] method The name of the method, typically in Class::method form.
+         *
+         * \return Returns the histogram for the method.
+         */
+        static Histogram* queryHistogram(const QString& method);
+
+        /**
+         * Method you can use to obtain, creating if needed, a counter.
+         *
+         * \param[in] name   The family name.
+         *
+         * \param[in] help   The family description.
+         *
+         * \param[in] labels The series labels, without braces.
+         *
+         * \return Returns the counter.  A null pointer is returned if the family holds a different type of metric.
+         */
+        Counter* counter(const QString& name, const QString& help, const QString& labels = QString());
+
+        /**
+         * Method you can use to obtain, creating if needed, a gauge.
+         *
+         * \param[in] name   The family name.
+         *
+         * \param[in] help   The family description.
+         *
+         * \param[in] labels The series labels, without braces.
+         *
+         * \return Returns the gauge.  A null pointer is returned if the family holds a different type of metric.
+         */
+        Gauge* gauge(const QString& name, const QString& help, const QString& labels = QString());
+
+        /**
+         * Method you can use to obtain, creating if needed, a histogram.
+         *
+         * \param[in] name   The family name.
+         *
+         * \param[in] help   The family description.
+         *
+         * \param[in] labels The series labels, without braces.
+         *
+         * \param[in] bounds The bucket upper bounds.  The value is ignored if the histogram already exists.
+         *
+         * \return Returns the histogram.  A null pointer is returned if the family holds a different type of metric.
+         */
+        Histogram* histogram(
+            const QString&       name,
+            const QString&       help,
+            const QString&       labels = QString(),
+            const QList<double>& bounds = defaultLatencyBuckets
+        );
+
+        /**
+         * Method you can use to add a series whose value is sampled when the registry is rendered.  An existing series
+         * with the same labels is replaced.
+         *
+         * \param[in] type    The metric type.  Histograms can not be sampled.
+         *
+         * \param[in] name    The family name.
+         *
+         * \param[in] help    The family description.
+         *
+         * \param[in] labels  The series labels, without braces.
+         *
+         * \param[in] sampler The function used to sample the value.  The function may be called from any thread.
+         *
+         * \return Returns true on success.  Returns false if the type is not supported or conflicts with the family.
+         */
+        bool addSampler(
+            Type           type,
+            const QString& name,
+            const QString& help,
+            const QString& labels,
+            const Sampler& sampler
+        );
+
+        /**
+         * Method you can use to remove a series.  Pointers to the removed series become invalid.  You should only
+         * remove series you added through \ref addSampler or whose pointers are held by the caller alone.
+         *
+         * \param[in] name   The family name.
+         *
+         * \param[in] labels The series labels, without braces.
+         */
+        void removeSeries(const QString& name, const QString& labels = QString());
+
+        /**
+         * Method you can use to render every series in the Prometheus text exposition format.
+         *
+         * \return Returns the rendered metrics.
+         */
+        QByteArray render() const;
+
+    private:
+        /**
+         * Class that reports a value sampled when the registry is rendered.
+         */
+        class SampledMetric:public Metric {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] sampler The function used to sample the value.
+                 */
+                SampledMetric(const Sampler& sampler);
+
+                ~SampledMetric() override;
+
+                /**
+                 * Method that appends this series to a rendering.
+                 *
+                 * \param[in]     name   The family name.
+                 *
+                 * \param[in]     labels The series labels, without braces.
+                 *
+                 * \param[in,out] output The rendering to append to.
+                 */
+                void render(const QString& name, const QString& labels, QByteArray& output) const override;
+
+            private:
+                /**
+                 * The function used to sample the value.
+                 */
+                Sampler currentSampler;
+        };
+
+        /**
+         * Trivial class that holds a family of series sharing a name.
+         */
+        class Family {
+            public:
+                /**
+                 * The family type.
+                 */
+                Type type;
+
+                /**
+                 * The family description.
+                 */
+                QString help;
+
+                /**
+                 * The series, keyed by label set.
+                 */
+                QMap<QString, Metric*> series;
+        };
+
+        MetricsRegistry();
+
+        ~MetricsRegistry();
+
+        /**
+         * Method that locates, creating if needed, a family.  The registry mutex must be held.
+         *
+         * \param[in] type The family type.
+         *
+         * \param[in] name The family name.
+         *
+         * \param[in] help The family description.
+         *
+         * \return Returns the family.  A null pointer is returned if the family exists with a different type.
+         */
+        Family* family(Type type, const QString& name, const QString& help);
+
+        /**
+         * Method that converts a value to its rendered form.
+         *
+         * \param[in] value The value to be converted.
+         *
+         * \return Returns the rendered value.
+         */
+        static QByteArray formatValue(double value);
+
+        /**
+         * Method that appends a single sample line to a rendering.
+         *
+         * \param[in]     name   The sample name.
+         *
+         * \param[in]     labels The sample labels, without braces.
+         *
+         * \param[in]     value  The rendered sample value.
+         *
+         * \param[in,out] output The rendering to append to.
+         */
+        static void renderLine(const QString& name, const QString& labels, const QByteArray& value, QByteArray& output);
+
+        /**
+         * Mutex protecting the families.
+         */
+        mutable QMutex registryMutex;
+
+        /**
+         * The families, keyed by name.
+         */
+        QMap<QString, Family> families;
+};
+
+#endif
@@ -31,15 +31,23 @@
 
 #include "customer_capabilities.h"
 #include "host_scheme.h"
+#include "string_pool.h"
 
 class Monitors;
+class Catalog;
+class MonitorUpdater;
 class PostSetting;
 
 /**
- * Class used to hold information about a single customer monitor.
+ * Class used to hold information about a single customer monitor.  Monitors are held by the in-memory catalog for
+ * every customer so the representation is kept compact: the path and user agent are interned in the
+ * \ref StringPool, keywords are kept as a single contiguous blob in the format produced by
+ * \ref Monitor::toByteArray, and large POST bodies are kept compressed and only expanded when requested.
  */
 class Monitor {
     friend class Monitors;
+    friend class Catalog;
+    friend class MonitorUpdater;
 
     public:
         /**
@@ -192,6 +200,11 @@ class Monitor {
          */
         static constexpr CustomerId invalidCustomerId = HostScheme::invalidCustomerId;
 
+        /**
+         * The POST content size, in bytes, at or above which POST content is held compressed.
+         */
+        static constexpr int postContentCompressionThreshold = 256;
+
     private:
         /**
          * Constructor.
@@ -339,7 +352,7 @@ class Monitor {
          * \param[in] newPath The new path to apply to this monitor.
          */
         inline void setPath(const QString& newPath) {
-            currentPath = newPath;
+            currentPath = StringPool::intern(newPath);
         }
 
         /**
@@ -379,11 +392,22 @@ class Monitor {
         }
 
         /**
-         * Method you can use to obtain the content check keyword list.
+         * Method you can use to obtain the content check keyword list.  The list is decoded from the keyword blob on
+         * each call.
          *
          * \return Returns the content check keyword list.
          */
-        inline const KeywordList& keywords() const {
+        inline KeywordList keywords() const {
+            return toKeywordList(currentKeywords);
+        }
+
+        /**
+         * Method you can use to obtain the content check keywords in the format produced by
+         * \ref Monitor::toByteArray.
+         *
+         * \return Returns the keyword blob.
+         */
+        inline const QByteArray& keywordBlob() const {
             return currentKeywords;
         }
 
@@ -393,7 +417,7 @@ class Monitor {
          * \param[in] newKeywordList The new list of content check keywords.
          */
         inline void setKeywords(const KeywordList& newKeywordList) {
-            currentKeywords = newKeywordList;
+            currentKeywords = toByteArray(newKeywordList);
         }
 
         /**
@@ -429,26 +453,29 @@ class Monitor {
          * \param[in] newUserAgent The new user agent string.
          */
         inline void setUserAgent(const QString& newUserAgent) {
-            currentUserAgent = newUserAgent;
+            currentUserAgent = StringPool::intern(newUserAgent);
         }
 
         /**
-         * Method you can use to obtain the post content.
+         * Method you can use to obtain the post content.  Large POST content is expanded on each call.
          *
          * \return Returns the post content.
          */
-        inline const QByteArray& postContent() const {
-            return currentPostContent;
-        }
+        QByteArray postContent() const;
+
+        /**
+         * Method you can use to obtain the post content in the compressed form used by the database.
+         *
+         * \return Returns the post content compressed using qCompress.
+         */
+        QByteArray compressedPostContent() const;
 
         /**
          * Method you can use to change the post content.
          *
          * \param[in] newPostContent The new post content.
          */
-        inline void setPostContent(const QByteArray& newPostContent) {
-            currentPostContent = newPostContent;
-        }
+        void setPostContent(const QByteArray& newPostContent);
 
         /**
          * Method you can use to convert a method value to a string.
@@ -550,6 +577,15 @@ class Monitor {
          */
         static KeywordList toKeywordList(const QByteArray& blob, bool* ok = nullptr);
 
+        /**
+         * Method you can use to check that a binary blob holds a well formed keyword list without decoding it.
+         *
+         * \param[in] blob The blob to be checked.
+         *
+         * \return Returns true if the blob is well formed.  Returns false if the blob is malformed.
+         */
+        static bool isValidKeywordBlob(const QByteArray& blob);
+
         /**
          * Assignment operator
          *
@@ -567,6 +603,14 @@ class Monitor {
         Monitor& operator=(Monitor&& other);
 
     private:
+        /**
+         * Method used to adopt POST content in the compressed form used by the database.  Large content is kept
+         * compressed, small content is expanded.
+         *
+         * \param[in] newCompressedPostContent The POST content, compressed using qCompress.
+         */
+        void setCompressedPostContent(const QByteArray& newCompressedPostContent);
+
         /**
          * The monitor database ID.
          */
@@ -603,9 +647,9 @@ class Monitor {
         ContentCheckMode currentContentCheckMode;
 
         /**
-         * The list of content check keywords.
+         * The content check keywords, in the format produced by \ref Monitor::toByteArray.
          */
-        KeywordList currentKeywords;
+        QByteArray currentKeywords;
 
         /**
          * The current content type for this POST.
@@ -618,9 +662,15 @@ class Monitor {
         QString currentUserAgent;
 
         /**
-         * The current post content.
+         * The current post content.  The content is compressed if \ref Monitor::currentPostContentCompressed is
+         * set.
          */
         QByteArray currentPostContent;
+
+        /**
+         * Flag indicating that \ref Monitor::currentPostContent holds compressed content.
+         */
+        bool currentPostContentCompressed;
 };
 
 #endif
@@ -513,13 +513,20 @@ class MonitorUpdater:public QObject {
         /**
          * Constructor
          *
+         * \param[in] databaseManager     The database manager used to apply updates in a single transaction.
+         *
          * \param[in] hostSchemes         The host/schemes database API.
          *
          * \param[in] monitors            The monitors database API.
          *
          * \param[in] serverAdministrator The server administration engine.
          */
-        MonitorUpdater(HostSchemes* hostSchemes, Monitors* monitors, ServerAdministrator* serverAdministrator);
+        MonitorUpdater(
+            DatabaseManager*     databaseManager,
+            HostSchemes*         hostSchemes,
+            Monitors*            monitors,
+            ServerAdministrator* serverAdministrator
+        );
 
         ~MonitorUpdater() override;
 
@@ -573,7 +580,8 @@ class MonitorUpdater:public QObject {
 
         /**
          * Method you can use to process a list of monitor entries in order to update the database for a given
-         * customer.
+         * customer.  The differences against the current settings are computed in memory and then applied in a
+         * single transaction using multi-row statements.
          *
          * \param[in]     customerCapabilities The customer capabilities instance used to discern both the customer ID
          *                                     and the features the customer can use.
@@ -640,6 +648,38 @@ class MonitorUpdater:public QObject {
          */
         typedef QMap<UserOrdering, Entry*> SortedEntries;
 
+        /**
+         * Trivial class used to track a monitor that must be created during an update.
+         */
+        class PendingMonitor {
+            public:
+                /**
+                 * The index of the new host/scheme this monitor is tied to.  A negative value indicates that the
+                 * monitor is tied to the existing host/scheme given by \ref PendingMonitor::hostSchemeId.
+                 */
+                int newHostSchemeIndex;
+
+                /**
+                 * The ID of the existing host/scheme this monitor is tied to.
+                 */
+                HostSchemeId hostSchemeId;
+
+                /**
+                 * The slug to assign to this monitor.
+                 */
+                QString slug;
+
+                /**
+                 * The monitor entry used to create this monitor.
+                 */
+                const Entry* entry;
+        };
+
+        /**
+         * Type used to represent a list of pending monitors.
+         */
+        typedef QList<PendingMonitor> PendingMonitors;
+
         /**
          * Type used to track pending customer updates.
          */
@@ -691,29 +731,6 @@ class MonitorUpdater:public QObject {
          */
         static QString urlToSlug(const QUrl& url);
 
-        /**
-         * Method that creates a new monitor instance on the heap from provided data.
-         *
-         * \param[in] customerId   The customer ID to tie to this monitor.
-         *
-         * \param[in] hostSchemeId The host/scheme ID to tie to this monitor.
-         *
-         * \param[in] slug         The slug to assign to this monitor.
-         *
-         * \param[in] entry        The monitor entry.
-         *
-         * \param[in] threadId     The thread ID used to select a database instance.
-         *
-         * \return Returns a pointer to the newly created monitor.
-         */
-        Monitor* createMonitor(
-            CustomerId     customerId,
-            HostSchemeId   hostSchemeId,
-            const QString& slug,
-            const Entry&   entry,
-            unsigned       threadId
-        );
-
         /**
          * Method that update a monitor from a monitor entry.
          *
@@ -726,48 +743,40 @@ class MonitorUpdater:public QObject {
         static bool updateMonitor(Monitor* monitor, const Entry& monitorEntry);
 
         /**
-         * Method that identifies and deletes old monitors from the database.
+         * Method that applies the changes computed by \ref MonitorUpdater::update in a single transaction.  The
+         * catalog is only updated once the transaction has been committed.
          *
-         * \param[in,out] errors           A list of errors to be updated should new errors be found.
+         * \param[in,out] errors            A list of errors to be updated should new errors be found.
          *
-         * \param[in]     existingMonitors A hash holding the existing monitors.
+         * \param[in]     customerId        The customer ID of the customer being updated.
          *
-         * \param[in]     threadId         A thread ID used to select a database instance.
-         */
-        void deleteUnusedMonitors(
-            Errors&                                   errors,
-            const Monitors::MonitorsBySchemeHostPath& existingMonitors,
-            unsigned                                  threadId
-        );
-
-        /**
-         * Method that identifies and deletes old host/schemes from the database.
+         * \param[in]     newHostSchemeUrls The URLs of the host/schemes to be created.
+         *
+         * \param[in]     pendingMonitors   The monitors to be created.
          *
-         * \param[in,out] errors              A list of errors to be updated should new errors be found.
+         * \param[in]     modifiedMonitors  The existing monitors with changed settings.
          *
-         * \param[in]     existingHostSchemes A hash holding the existing host/schemes.
+         * \param[in]     unusedMonitors    The existing monitors to be deleted.
          *
-         * \param[in]     usedHostSchemes     A set holding the host/schemes that are still being used.
+         * \param[in]     unusedHostSchemes The existing host/schemes to be deleted.
          *
-         * \param[in]     threadId            A thread ID used to select a database instance.
+         * \param[in]     threadId          A thread ID used to select a database instance.
          */
-        void deleteUnusedHostSchemes(
-            Errors&                            errors,
-            const HostSchemes::HostSchemeHash& existingHostSchemes,
-            const QSet<const HostScheme*>&     usedHostSchemes,
-            unsigned                           threadId
+        void applyChanges(
+            Errors&                                   errors,
+            CustomerId                                customerId,
+            const QList<QUrl>&                        newHostSchemeUrls,
+            const PendingMonitors&                    pendingMonitors,
+            const Monitors::MonitorList&              modifiedMonitors,
+            const Monitors::MonitorsBySchemeHostPath& unusedMonitors,
+            const HostSchemes::HostSchemeList&        unusedHostSchemes,
+            unsigned                                  threadId
         );
 
         /**
-         * Template function that deletes entries from an iterable container.
-         *
-         * \param[in] container The container to purge all entries from.
+         * The database manager used to apply updates.
          */
-        template<typename T> void deleteContents(T& container) {
-            for (typename T::iterator it=container.begin(),end=container.end() ; it!=end ; ++it) {
-                delete *it;
-            }
-        }
+        DatabaseManager* currentDatabaseManager;
 
         /**
          * The current host/schemes database API.
@@ -27,6 +27,8 @@
 #include <QString>
 #include <QHash>
 #include <QMultiHash>
+#include <QList>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 
 #include <cstdint>
@@ -37,6 +39,8 @@
 #include "sql_helpers.h"
 
 class DatabaseManager;
+class IdRegistry;
+class Catalog;
 
 /**
  * Class used to read and write information about user monitors.  This cless expects a number of different tables
@@ -72,6 +76,9 @@ class DatabaseManager;
  *             ON DELETE CASCADE
  *             ON UPDATE NO ACTION
  *     ) ENGINE=InnoDB DEFAULT CHARSET=latin1
+ *
+ * Reads are served from the in-memory \ref Catalog, which this class keeps up to date as monitors are created,
+ * modified and deleted.
  */
 class Monitors:public QObject, private SqlHelpers {
     Q_OBJECT
@@ -152,9 +159,18 @@ class Monitors:public QObject, private SqlHelpers {
          *
          * \param[in] databaseManager The database manager used to fetch information about a monitor.
          *
+         * \param[in] idRegistry      The registry of valid monitor and server IDs to be kept up to date.
+         *
+         * \param[in] catalog         The in-memory catalog used to serve reads and to be kept up to date.
+         *
          * \param[in] parent          Pointer to the parent object.
          */
-        Monitors(DatabaseManager* databaseManager, QObject* parent = nullptr);
+        Monitors(
+            DatabaseManager* databaseManager,
+            IdRegistry*      idRegistry,
+            Catalog*         catalog,
+            QObject*         parent = nullptr
+        );
 
         ~Monitors() override;
 
@@ -309,7 +325,65 @@ class Monitors:public QObject, private SqlHelpers {
          */
         bool deleteMonitors(CustomerId customerId, unsigned threadId = 0);
 
-    private:
+        /**
+         * Method you can use to insert a set of new monitors using multi-row INSERT statements.  The method does not
+         * touch the catalog or ID registry so it can be used inside a transaction owned by the caller.  Call
+         * \ref Monitors::commitMonitors once the transaction has been committed.
+         *
+         * \param[in]  database         The database connection to use.
+         *
+         * \param[in]  monitors         The monitors to be inserted.  Monitor IDs are ignored.
+         *
+         * \param[out] insertedMonitors The inserted monitors, with monitor IDs, in the order supplied.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool insertMonitors(
+            QSqlDatabase&      database,
+            const MonitorList& monitors,
+            MonitorList&       insertedMonitors
+        ) const;
+
+        /**
+         * Method you can use to update a set of monitors using batched UPDATE statements.  The method does not touch
+         * the catalog so it can be used inside a transaction owned by the caller.
+         *
+         * \param[in] database The database connection to use.
+         *
+         * \param[in] monitors The monitors to be updated.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool updateMonitors(QSqlDatabase& database, const MonitorList& monitors) const;
+
+        /**
+         * Method you can use to remove a set of monitors by monitor ID.  The method does not touch the catalog or ID
+         * registry so it can be used inside a transaction owned by the caller.
+         *
+         * \param[in] database   The database connection to use.
+         *
+         * \param[in] monitorIds The IDs of the monitors to be removed.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool removeMonitors(QSqlDatabase& database, const QList<MonitorId>& monitorIds) const;
+
+        /**
+         * Method you can use to publish changes made by \ref Monitors::insertMonitors,
+         * \ref Monitors::updateMonitors, and \ref Monitors::removeMonitors to the catalog and ID registry.
+         *
+         * \param[in] insertedMonitors  The monitors that were inserted.
+         *
+         * \param[in] updatedMonitors   The monitors that were updated.
+         *
+         * \param[in] removedMonitorIds The IDs of the monitors that were removed.
+         */
+        void commitMonitors(
+            const MonitorList&      insertedMonitors,
+            const MonitorList&      updatedMonitors,
+            const QList<MonitorId>& removedMonitorIds
+        );
+
         /**
          * Method that converts a query to a monitor instance.
          *
@@ -320,10 +394,26 @@ class Monitors:public QObject, private SqlHelpers {
          */
         static Monitor convertQueryToMonitor(const QSqlQuery& sqlQuery, bool* success = nullptr);
 
+    private:
+        /**
+         * The maximum number of monitors per multi-row INSERT or UPDATE statement.
+         */
+        static const unsigned long maximumMonitorsPerStatement;
+
         /**
          * The underlying database manager instance.
          */
         DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The registry of valid monitor and server IDs.
+         */
+        IdRegistry* currentIdRegistry;
+
+        /**
+         * The in-memory catalog of monitors and host/schemes.
+         */
+        Catalog* currentCatalog;
 };
 
 #endif
@@ -33,15 +33,15 @@
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
+#include <rest_api_in_v1_inesonic_binary_rest_handler.h>
 
 #include "monitor.h"
 #include "monitors.h"
 #include "rest_helpers.h"
 
-class HostSchemes;
-class Monitors;
-class Events;
+class DashboardCache;
 class LatencyPlotter;
+class ResponseCompressor;
 
 /**
  * Class that support a set of REST endpoints used to obtain multiple data elements.
@@ -58,26 +58,23 @@ class MultipleManager:public QObject {
         /**
          * Constructor
          *
-         * \param[in] restApiServer         The REST API server instance.
+         * \param[in] restApiServer      The REST API server instance.
          *
-         * \param[in] hostSchemeDatabaseApi Class used to manage hosts and schemes.
+         * \param[in] dashboardCache     Class used to build and cache customer dashboards.
          *
-         * \param[in] monitorDatabaseApi    Class used to manage the customer's monitors.
+         * \param[in] latencyPlotter     Plotter used to generate latency plots.
          *
-         * \param[in] eventDatabaseApi      Class used to manage events and status.
+         * \param[in] responseCompressor Class used to compress large responses.
          *
-         * \param[in] latencyPlotter        Plotter used to generate latency plots.
+         * \param[in[ secret             The incoming data secret.
          *
-         * \param[in[ secret                The incoming data secret.
-         *
-         * \param[in] parent                Pointer to the parent object.
+         * \param[in] parent             Pointer to the parent object.
          */
         MultipleManager(
             RestApiInV1::Server*   restApiServer,
-            HostSchemes*           hostSchemeDatabaseApi,
-            Monitors*              monitorDatabaseApi,
-            Events*                eventDatabaseApi,
+            DashboardCache*        dashboardCache,
             LatencyPlotter*        latencyPlotter,
+            ResponseCompressor*    responseCompressor,
             const QByteArray&      secret,
             QObject*               parent = nullptr
         );
@@ -96,24 +93,21 @@ class MultipleManager:public QObject {
         /**
          * The multiple/list handler.
          */
-        class MultipleList:public RestApiInV1::InesonicRestHandler, private RestHelpers {
+        class MultipleList:public RestApiInV1::InesonicBinaryRestHandler, private RestHelpers {
             public:
                 /**
                  * Constructor
                  *
-                 * \param[in] secret                The secret to use for this handler.
-                 *
-                 * \param[in] hostSchemeDatabaseApi Class used to manage hosts and schemes.
+                 * \param[in] secret             The secret to use for this handler.
                  *
-                 * \param[in] monitorDatabaseApi    Class used to manage the customer's monitors.
+                 * \param[in] dashboardCache     Class used to build and cache customer dashboards.
                  *
-                 * \param[in] eventDatabaseApi      Class used to manage events and status.
+                 * \param[in] responseCompressor Class used to compress large responses.
                  */
                 MultipleList(
-                    const QByteArray& secret,
-                    HostSchemes*      hostSchemeDatabaseApi,
-                    Monitors*         monitorDatabaseApi,
-                    Events*           eventDatabaseApi
+                    const QByteArray&   secret,
+                    DashboardCache*     dashboardCache,
+                    ResponseCompressor* responseCompressor
                 );
 
                 ~MultipleList() override;
@@ -129,29 +123,24 @@ class MultipleManager:public QObject {
                  *
                  * \param[in] threadId  The ID used to uniquely identify this thread while in flight.
                  *
-                 * \return The response to return, also encoded as a JSON document.
+                 * \return The response to return, serialized as a JSON document and compressed if requested.
                  */
-                RestApiInV1::JsonResponse processAuthenticatedRequest(
-                    const QString&       path,
-                    const QJsonDocument& request,
-                    unsigned             threadId
+                RestApiInV1::Response* processAuthenticatedRequest(
+                    const QString&    path,
+                    const QByteArray& request,
+                    unsigned          threadId
                 ) override;
 
             private:
                 /**
-                 * The current host/scheme database API.
-                 */
-                HostSchemes* currentHostSchemes;
-
-                /**
-                 * The current monitors database API.
+                 * The customer dashboard cache.
                  */
-                Monitors* currentMonitors;
+                DashboardCache* currentDashboardCache;
 
                 /**
-                 * The current event database API.
+                 * The compressor applied to large responses.
                  */
-                Events* currentEvents;
+                ResponseCompressor* currentResponseCompressor;
         };
 
         /**
@@ -26,6 +26,8 @@
 #include <QObject>
 #include <QUrl>
 #include <QQueue>
+#include <QList>
+#include <QHash>
 #include <QTimer>
 #include <QString>
 #include <QByteArray>
@@ -35,12 +37,20 @@
 #include <rest_api_out_v1_server.h>
 #include <rest_api_out_v1_inesonic_rest_handler.h>
 
+#include "metrics_registry.h"
+
 /**
  * Class that provides a generic outbound REST API to a single server.  You can use this class to issue messages to
  * remote endpoints on a server in a controlled fashion.  This function merges an outbound server instance with
  * ephemeral REST API instances.
  *
  * To use, instantiate an instance and then call the \ref startReporting method (or trigger it).
+ *
+ * Up to \ref maximumConcurrentRequests requests can be in flight at once.  When this value is 1, the default, messages
+ * are delivered strictly in order and a failing message holds back the messages queued behind it.  With higher values,
+ * a failing message is retried with exponential backoff while the remaining messages continue to be sent.  Messages
+ * to a selected endpoint can also be coalesced, while they wait in the queue, into a single POST carrying an array of
+ * messages.  See \ref setBatching.
  */
 class OutboundRestApi:public RestApiOutV1::Server {
     Q_OBJECT
@@ -52,10 +62,20 @@ class OutboundRestApi:public RestApiOutV1::Server {
         static constexpr unsigned maximumIdleTimeSeconds = 3600;
 
         /**
-         * Retry interval in seconds.
+         * Retry interval in seconds.  The interval is doubled on each subsequent failure of the same request.
          */
         static constexpr unsigned retryInterval = 60;
 
+        /**
+         * The largest retry interval, in seconds, we will back off to.
+         */
+        static constexpr unsigned maximumRetryInterval = 3600;
+
+        /**
+         * The default number of requests that can be in flight at once.
+         */
+        static constexpr unsigned defaultMaximumConcurrentRequests = 1;
+
         /**
          * Constructor
          *
@@ -80,6 +100,46 @@ class OutboundRestApi:public RestApiOutV1::Server {
 
         ~OutboundRestApi() override;
 
+        /**
+         * Method you can use to set the number of requests that can be in flight at once.  Connections are pooled and
+         * kept alive by the underlying network access manager so concurrent requests share connections to the server.
+         *
+         * \param[in] newMaximumConcurrentRequests The new maximum number of concurrent requests.  A value of 1 causes
+         *                                         messages to be delivered strictly in order.  A value of 0 is
+         *                                         treated as 1.
+         */
+        void setMaximumConcurrentRequests(unsigned newMaximumConcurrentRequests);
+
+        /**
+         * Method you can use to determine the number of requests that can be in flight at once.
+         *
+         * \return Returns the maximum number of concurrent requests.
+         */
+        unsigned maximumConcurrentRequests() const;
+
+        /**
+         * Method you can use to coalesce queued messages sent to an endpoint.  Consecutive queued messages to the
+         * endpoint that do not require a callback are sent as a single POST to the batch endpoint.  The batch message
+         * is a JSON array holding each of the original messages.
+         *
+         * \param[in] endpoint         The endpoint whose messages should be coalesced.
+         *
+         * \param[in] batchEndpoint    The endpoint that accepts an array of messages.
+         *
+         * \param[in] maximumBatchSize The maximum number of messages to include in a single POST.  A value of 0 or 1
+         *                             disables batching.
+         */
+        void setBatching(const QString& endpoint, const QString& batchEndpoint, unsigned maximumBatchSize);
+
+        /**
+         * Method you can use to enable or disable garbage collection of this instance after an extended period of
+         * non-use.
+         *
+         * \param[in] enabled If true, this instance will request garbage collection once idle.  If false, this
+         *                    instance will be kept indefinitely.
+         */
+        void setGarbageCollection(bool enabled);
+
         /**
          * Method you can use to send a message to a remote host.
          *
@@ -112,7 +172,8 @@ class OutboundRestApi:public RestApiOutV1::Server {
 
         /**
          * Method you can use to send a message to a remote host.  This version will trigger a callback to an old
-         * style Qt slot.
+         * style Qt slot.  The slot must accept a void pointer holding the context and can optionally accept a
+         * QJsonDocument holding the response, for example SLOT(sendCallback(void*,QJsonDocument)).
          *
          * \param[in] endpoint The endpoint to send the message to.
          *
@@ -224,13 +285,6 @@ class OutboundRestApi:public RestApiOutV1::Server {
             const QString&       slot
         );
 
-        /**
-         * Signal used internally to trigger a callback after a message has been sent successfully.
-         *
-         * \param[in] context The context to be sent.
-         */
-        void sendCallback(void* context);
-
     private slots:
         /**
          * Slot that send messages to remote hosts.  This slot is triggered by the \ref sendMessage signal.
@@ -261,6 +315,11 @@ class OutboundRestApi:public RestApiOutV1::Server {
          */
         void startNextAction();
 
+        /**
+         * Slot that starts any transfers that can be started.  This slot is also triggered when a retry is due.
+         */
+        void startTransfers();
+
         /**
          * Slot that is triggered on successful transmission of a request.
          *
@@ -485,6 +544,128 @@ class OutboundRestApi:public RestApiOutV1::Server {
                 QString currentSlot;
         };
 
+        /**
+         * Type used to represent a list of requests.
+         */
+        typedef QList<Request> RequestList;
+
+        /**
+         * Class that tracks a single POST to the server.  A transfer carries either a single request or a batch of
+         * coalesced requests.
+         */
+        class Transfer {
+            public:
+                Transfer():
+                    currentNumberFailures(0),
+                    currentRetryTime(0) {}
+
+                /**
+                 * Constructor.
+                 *
+                 * \param[in] requests The requests carried by this transfer.
+                 *
+                 * \param[in] endpoint The endpoint to post this transfer to.
+                 *
+                 * \param[in] message  The message to be posted.
+                 */
+                Transfer(
+                        const RequestList&   requests,
+                        const QString&       endpoint,
+                        const QJsonDocument& message
+                    ):currentRequests(
+                        requests
+                    ),currentEndpoint(
+                        endpoint
+                    ),currentMessage(
+                        message
+                    ),currentNumberFailures(
+                        0
+                    ),currentRetryTime(
+                        0
+                    ) {}
+
+                /**
+                 * Method you can use to obtain the requests carried by this transfer.
+                 *
+                 * \return Returns the requests carried by this transfer.
+                 */
+                const RequestList& requests() const {
+                    return currentRequests;
+                }
+
+                /**
+                 * Method you can use to determine the endpoint for this transfer.
+                 *
+                 * \return Returns the endpoint for this transfer.
+                 */
+                const QString& endpoint() const {
+                    return currentEndpoint;
+                }
+
+                /**
+                 * Method you can use to determine the message to be posted.
+                 *
+                 * \return Returns the message to be posted.
+                 */
+                const QJsonDocument& message() const {
+                    return currentMessage;
+                }
+
+                /**
+                 * Method you can use to determine how many times this transfer has failed.
+                 *
+                 * \return Returns the number of failed attempts.
+                 */
+                unsigned numberFailures() const {
+                    return currentNumberFailures;
+                }
+
+                /**
+                 * Method that records a failed attempt and schedules the next one.
+                 *
+                 * \param[in] retryTime The time, in milliseconds since the epoch, when the next attempt is due.
+                 */
+                void failed(long long retryTime) {
+                    ++currentNumberFailures;
+                    currentRetryTime = retryTime;
+                }
+
+                /**
+                 * Method you can use to determine when the next attempt is due.
+                 *
+                 * \return Returns the time, in milliseconds since the epoch, when the next attempt is due.
+                 */
+                long long retryTime() const {
+                    return currentRetryTime;
+                }
+
+            private:
+                /**
+                 * The requests carried by this transfer.
+                 */
+                RequestList currentRequests;
+
+                /**
+                 * The endpoint we're posting to.
+                 */
+                QString currentEndpoint;
+
+                /**
+                 * The message to be posted.
+                 */
+                QJsonDocument currentMessage;
+
+                /**
+                 * The number of failed attempts.
+                 */
+                unsigned currentNumberFailures;
+
+                /**
+                 * The time when the next attempt is due, in milliseconds since the epoch.
+                 */
+                long long currentRetryTime;
+        };
+
         /**
          * Enumeration of timer actions.
          */
@@ -494,16 +675,6 @@ class OutboundRestApi:public RestApiOutV1::Server {
              */
             NONE,
 
-            /**
-             * Indicates we should retry our request.
-             */
-            RETRY,
-
-            /**
-             * Indicates we should cleanup our request.
-             */
-            CLEANUP,
-
             /**
              * Indicates we should be garbage collected.
              */
@@ -511,14 +682,34 @@ class OutboundRestApi:public RestApiOutV1::Server {
         };
 
         /**
-         * Method that starts the next request.
+         * Method that pops the next transfer from the pending requests queue, coalescing requests if batching is
+         * enabled.
+         *
+         * \return Returns the next transfer to be sent.
+         */
+        Transfer nextTransfer();
+
+        /**
+         * Method that starts a transfer.
+         *
+         * \param[in] transfer The transfer to be sent.
+         */
+        void startSend(const Transfer& transfer);
+
+        /**
+         * Method that calculates the delay before retrying a transfer.
+         *
+         * \param[in] numberFailures The number of times the transfer has failed.
+         *
+         * \return Returns the retry delay, in seconds.
          */
-        void startSend(const Request& request);
+        static unsigned retryDelay(unsigned numberFailures);
 
         /**
-         * Method that pops the head from the pending requests queue and begins the next action.
+         * Method that updates the reported queue length.  Instances sharing a server adjust a single gauge by the
+         * change in their own queue length so the gauge remains correct while an instance is being replaced.
          */
-        void startNext();
+        void updateQueueLengthMetric();
 
         /**
          * Queue of pending requests.
@@ -526,9 +717,34 @@ class OutboundRestApi:public RestApiOutV1::Server {
         QQueue<Request> pendingRequests;
 
         /**
-         * Pointer to the in-flight request.
+         * The in-flight transfers, by handler.
+         */
+        QHash<RestApiOutV1::InesonicRestHandler*, Transfer> activeTransfers;
+
+        /**
+         * Transfers waiting to be retried.
+         */
+        QList<Transfer> delayedTransfers;
+
+        /**
+         * The maximum number of in-flight transfers.
          */
-        RestApiOutV1::InesonicRestHandler* activeRequest;
+        unsigned currentMaximumConcurrentRequests;
+
+        /**
+         * The endpoint whose messages we coalesce.
+         */
+        QString currentBatchedEndpoint;
+
+        /**
+         * The endpoint that receives coalesced messages.
+         */
+        QString currentBatchEndpoint;
+
+        /**
+         * The maximum number of messages to coalesce into a single transfer.
+         */
+        unsigned currentMaximumBatchSize;
 
         /**
          * Flag that indicates if we should perform garbage collection.
@@ -541,9 +757,24 @@ class OutboundRestApi:public RestApiOutV1::Server {
         TimerAction timerAction;
 
         /**
-         * Timer used to manage retries and garbage collection.
+         * Timer used to manage garbage collection.
          */
         QTimer eventTimer;
+
+        /**
+         * Timer used to trigger retries.
+         */
+        QTimer retryTimer;
+
+        /**
+         * Gauge tracking the number of messages waiting to be delivered to this server.
+         */
+        MetricsRegistry::Gauge* queueLengthMetric;
+
+        /**
+         * The queue length most recently added to the gauge.
+         */
+        unsigned reportedQueueLength;
 };
 
 #endif
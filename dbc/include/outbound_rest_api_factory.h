@@ -27,6 +27,7 @@
 #include <QHash>
 #include <QMutex>
 #include <QString>
+#include <QElapsedTimer>
 #include <QByteArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -58,6 +59,16 @@ class OutboundRestApiFactory:public QObject {
             HTTPS
         };
 
+        /**
+         * Type used to hold the messages for a fan-out, by server identifier.
+         */
+        typedef QHash<QString, QJsonDocument> MessagesByServerIdentifier;
+
+        /**
+         * Type used to report the time, in milliseconds, taken by each server to accept a fan-out message.
+         */
+        typedef QHash<QString, unsigned long long> LatenciesByServerIdentifier;
+
         /**
          * The default user agent string.
          */
@@ -288,7 +299,57 @@ class OutboundRestApiFactory:public QObject {
             const char*    slot
         );
 
+        /**
+         * Method you can use to send a message to a number of remote hosts at once.  Each server receives its message
+         * independently so the fan-out completes in roughly the time taken by the slowest server.  Servers targeted
+         * by a fan-out are kept warm and are not garbage collected until released with
+         * \ref releaseOutboundRestApi.  The \ref fanOutCompleted signal is emitted once every server has accepted
+         * its message.
+         *
+         * \param[in] messages The messages to be sent, by server identifier.
+         *
+         * \param[in] endpoint The endpoint to send the messages to.
+         *
+         * \param[in] logText  Text to be dumped to stdout on successful completion.
+         */
+        void postMessages(
+            const MessagesByServerIdentifier& messages,
+            const QString&                    endpoint,
+            const QString&                    logText
+        );
+
+        /**
+         * Method you can use to indicate that a server no longer needs to be kept warm.  The server's REST API will be
+         * garbage collected once idle.
+         *
+         * \param[in] serverIdentifier The identifier used to address this server.
+         */
+        void releaseOutboundRestApi(const QString& serverIdentifier);
+
     signals:
+        /**
+         * Signal that is emitted when every server targeted by a fan-out has accepted its message.
+         *
+         * \param[out] endpoint  The endpoint the messages were sent to.
+         *
+         * \param[out] latencies The time taken by each server to accept its message, in milliseconds.
+         */
+        void fanOutCompleted(const QString& endpoint, const LatenciesByServerIdentifier& latencies);
+
+        /**
+         * Signal used internally to queue up a fan-out.
+         *
+         * \param[out] fanOut The fan-out to be started.  The receiver takes ownership of the fan-out.
+         */
+        void fanOutRequested(void* fanOut);
+
+        /**
+         * Signal used internally to queue up the release of a server's REST API.
+         *
+         * \param[out] serverIdentifier The identifier used to address this server.
+         */
+        void releaseRequested(const QString& serverIdentifier);
+
         /**
          * Signal that queues up a request to send a message to a remote host.  This version will trigger a callback to
          * an old style Qt slot.
@@ -352,7 +413,190 @@ class OutboundRestApiFactory:public QObject {
          */
         void expungeOutboundRestApi(OutboundRestApi* outboundRestApi);
 
+        /**
+         * Slot that performs the work of starting a fan-out.
+         *
+         * \param[in] fanOut The fan-out to be started.
+         */
+        void performFanOut(void* fanOut);
+
+        /**
+         * Slot that performs the work of releasing a server's REST API.
+         *
+         * \param[in] serverIdentifier The identifier used to address this server.
+         */
+        void performRelease(const QString& serverIdentifier);
+
+        /**
+         * Slot that is triggered when a server accepts a fan-out message.
+         *
+         * \param[in] context The \ref FanOutTarget tied to the message.
+         */
+        void sendCallback(void* context);
+
     private:
+        /**
+         * Class that tracks a message sent to a number of servers.
+         */
+        class FanOut {
+            public:
+                /**
+                 * Constructor.
+                 *
+                 * \param[in] messages The messages to be sent, by server identifier.
+                 *
+                 * \param[in] endpoint The endpoint to send the messages to.
+                 *
+                 * \param[in] logText  Text to be dumped to stdout on successful completion.
+                 */
+                FanOut(
+                        const MessagesByServerIdentifier& messages,
+                        const QString&                    endpoint,
+                        const QString&                    logText
+                    ):currentMessages(
+                        messages
+                    ),currentEndpoint(
+                        endpoint
+                    ),currentLogText(
+                        logText
+                    ),currentNumberOutstanding(
+                        static_cast<unsigned>(messages.size())
+                    ) {}
+
+                /**
+                 * Method you can use to obtain the messages to be sent.
+                 *
+                 * \return Returns the messages to be sent, by server identifier.
+                 */
+                const MessagesByServerIdentifier& messages() const {
+                    return currentMessages;
+                }
+
+                /**
+                 * Method you can use to obtain the endpoint to send the messages to.
+                 *
+                 * \return Returns the endpoint.
+                 */
+                const QString& endpoint() const {
+                    return currentEndpoint;
+                }
+
+                /**
+                 * Method you can use to obtain the log text to show on successful completion.
+                 *
+                 * \return Returns the log text.
+                 */
+                const QString& logText() const {
+                    return currentLogText;
+                }
+
+                /**
+                 * Method you can use to start timing this fan-out.
+                 */
+                void start() {
+                    currentTimer.start();
+                }
+
+                /**
+                 * Method you can use to record that a server has accepted its message.
+                 *
+                 * \param[in] serverIdentifier The identifier of the server.
+                 *
+                 * \return Returns true if every server has now accepted its message.
+                 */
+                bool completed(const QString& serverIdentifier) {
+                    currentLatencies.insert(serverIdentifier, static_cast<unsigned long long>(currentTimer.elapsed()));
+                    --currentNumberOutstanding;
+                    return currentNumberOutstanding == 0;
+                }
+
+                /**
+                 * Method you can use to obtain the time taken by each server to accept its message.
+                 *
+                 * \return Returns the latencies, in milliseconds, by server identifier.
+                 */
+                const LatenciesByServerIdentifier& latencies() const {
+                    return currentLatencies;
+                }
+
+            private:
+                /**
+                 * The messages to be sent.
+                 */
+                MessagesByServerIdentifier currentMessages;
+
+                /**
+                 * The endpoint to send the messages to.
+                 */
+                QString currentEndpoint;
+
+                /**
+                 * The log text to show on successful completion.
+                 */
+                QString currentLogText;
+
+                /**
+                 * The number of servers that have not yet accepted their message.
+                 */
+                unsigned currentNumberOutstanding;
+
+                /**
+                 * Timer used to measure per-server latency.
+                 */
+                QElapsedTimer currentTimer;
+
+                /**
+                 * The measured latencies by server identifier.
+                 */
+                LatenciesByServerIdentifier currentLatencies;
+        };
+
+        /**
+         * Class used as the callback context for a single server in a fan-out.
+         */
+        class FanOutTarget {
+            public:
+                /**
+                 * Constructor.
+                 *
+                 * \param[in] fanOut           The fan-out this target belongs to.
+                 *
+                 * \param[in] serverIdentifier The identifier of the targeted server.
+                 */
+                FanOutTarget(FanOut* fanOut, const QString& serverIdentifier):
+                    currentFanOut(fanOut),
+                    currentServerIdentifier(serverIdentifier) {}
+
+                /**
+                 * Method you can use to obtain the fan-out this target belongs to.
+                 *
+                 * \return Returns the fan-out.
+                 */
+                FanOut* fanOut() const {
+                    return currentFanOut;
+                }
+
+                /**
+                 * Method you can use to obtain the identifier of the targeted server.
+                 *
+                 * \return Returns the server identifier.
+                 */
+                const QString& serverIdentifier() const {
+                    return currentServerIdentifier;
+                }
+
+            private:
+                /**
+                 * The fan-out this target belongs to.
+                 */
+                FanOut* currentFanOut;
+
+                /**
+                 * The identifier of the targeted server.
+                 */
+                QString currentServerIdentifier;
+        };
+
         /**
          * Method you can use to obtain a server instance for a given host address.
          *
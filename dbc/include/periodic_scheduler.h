@@ -0,0 +1,512 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref PeriodicScheduler class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef PERIODIC_SCHEDULER_H
+#define PERIODIC_SCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include <functional>
+
+#include "metrics_registry.h"
+
+class QTimer;
+
+/**
+ * Class that runs periodic background work from a single hierarchical timer wheel.  Owners register a named task and
+ * set its period.  Each task may add a random jitter to its period and may belong to a mutual exclusion group.  A due
+ * task whose group already has a running member, or which is itself still running, is deferred by
+ * \ref PeriodicScheduler::groupRetrySeconds rather than started.
+ *
+ * Task periods, jitter and groups set by the owner are defaults that can be overridden by name through
+ * \ref PeriodicScheduler::setConfiguration so that every cadence is configured in one place.
+ *
+ * Task functions are called from the thread that first called \ref PeriodicScheduler::instance.  Tasks that start
+ * their work on another thread supply a busy function so the scheduler can tell when the work has finished.
+ */
+class PeriodicScheduler:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to identify a registered task.
+         */
+        typedef unsigned long long TaskId;
+
+        /**
+         * Value used to indicate an invalid task ID.
+         */
+        static constexpr TaskId invalidTaskId = 0;
+
+        /**
+         * Type of function called to run a task.
+         */
+        typedef std::function<void()> TaskFunction;
+
+        /**
+         * Type of function used to determine if a task's work is still running.  The function is called with the
+         * scheduler's lock held and must not call back into the scheduler.
+         */
+        typedef std::function<bool()> BusyFunction;
+
+        /**
+         * Value used to indicate that a configured setting should use the owner's default.
+         */
+        static constexpr long useDefault = -1;
+
+        /**
+         * The delay, in seconds, applied to a task deferred because its group or the task itself is busy.
+         */
+        static const unsigned long groupRetrySeconds;
+
+        /**
+         * The mutual exclusion group used by heavy database maintenance such as aggregation and expunge runs.
+         */
+        static const QString databaseMaintenanceGroup;
+
+        /**
+         * Class that holds the configured overrides for a single task.
+         */
+        class TaskConfiguration {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] periodSeconds The period, in seconds.  A value of \ref PeriodicScheduler::useDefault
+                 *                          keeps the owner's period.  A value of zero disables the task.
+                 *
+                 * \param[in] jitterSeconds The maximum random delay, in seconds, added to each period.  A value of
+                 *                          \ref PeriodicScheduler::useDefault keeps the owner's jitter.
+                 *
+                 * \param[in] group         The mutual exclusion group.  A null string keeps the owner's group.  An
+                 *                          empty string places the task in no group.
+                 */
+                TaskConfiguration(
+                    long           periodSeconds = useDefault,
+                    long           jitterSeconds = useDefault,
+                    const QString& group = QString()
+                );
+
+                /**
+                 * Copy constructor
+                 *
+                 * \param[in] other The instance to be copied.
+                 */
+                TaskConfiguration(const TaskConfiguration& other);
+
+                ~TaskConfiguration();
+
+                /**
+                 * Method you can use to obtain the configured period.
+                 *
+                 * \return Returns the configured period, in seconds, or \ref PeriodicScheduler::useDefault.
+                 */
+                inline long periodSeconds() const {
+                    return currentPeriodSeconds;
+                }
+
+                /**
+                 * Method you can use to obtain the configured jitter.
+                 *
+                 * \return Returns the configured jitter, in seconds, or \ref PeriodicScheduler::useDefault.
+                 */
+                inline long jitterSeconds() const {
+                    return currentJitterSeconds;
+                }
+
+                /**
+                 * Method you can use to obtain the configured group.
+                 *
+                 * \return Returns the configured group.  A null string indicates the owner's group.
+                 */
+                inline const QString& group() const {
+                    return currentGroup;
+                }
+
+                /**
+                 * Assignment operator.
+                 *
+                 * \param[in] other The instance to be copied.
+                 *
+                 * \return Returns a reference to this instance.
+                 */
+                TaskConfiguration& operator=(const TaskConfiguration& other);
+
+            private:
+                /**
+                 * The configured period.
+                 */
+                long currentPeriodSeconds;
+
+                /**
+                 * The configured jitter.
+                 */
+                long currentJitterSeconds;
+
+                /**
+                 * The configured group.
+                 */
+                QString currentGroup;
+        };
+
+        /**
+         * Type used to hold task configurations keyed by task name.
+         */
+        typedef QHash<QString, TaskConfiguration> TaskConfigurations;
+
+        /**
+         * Method you can use to obtain the process wide scheduler.  The scheduler is created on first use and ticks
+         * on the thread that first calls this method, normally the main thread.
+         *
+         * \return Returns a pointer to the scheduler.
+         */
+        static PeriodicScheduler* instance();
+
+        /**
+         * Method you can use to register a task.  The task does not run until a period is set.
+         *
+         * \param[in] name          The task name.  Names are used to configure tasks and label metrics.  Tasks
+         *                          sharing a name share their configuration and metrics.
+         *
+         * \param[in] defaultGroup  The owner's mutual exclusion group.  An empty string places the task in no group.
+         *
+         * \param[in] defaultJitter The owner's maximum random delay, in seconds, added to each period.
+         *
+         * \param[in] function      The function called to run the task.
+         *
+         * \param[in] busyFunction  An optional function indicating if work started by the task is still running.
+         *                          Tasks without a busy function are finished when the task function returns.
+         *
+         * \return Returns the ID of the new task.
+         */
+        TaskId registerTask(
+            const QString&      name,
+            const QString&      defaultGroup,
+            unsigned long       defaultJitter,
+            const TaskFunction& function,
+            const BusyFunction& busyFunction = BusyFunction()
+        );
+
+        /**
+         * Method you can use to unregister a task.  Unregister tasks before their owner is destroyed.
+         *
+         * \param[in] taskId The ID of the task.
+         */
+        void unregisterTask(TaskId taskId);
+
+        /**
+         * Method you can use to set the owner's period for a task.  Setting the period the task already has leaves
+         * its next run unchanged.
+         *
+         * \param[in] taskId        The ID of the task.
+         *
+         * \param[in] periodSeconds The period, in seconds.  A value of zero stops the task regardless of its
+         *                          configuration.
+         *
+         * \param[in] aligned       If true, runs are aligned to multiples of the period in wall clock time.
+         */
+        void setPeriod(TaskId taskId, unsigned long periodSeconds, bool aligned = false);
+
+        /**
+         * Method you can use to determine the effective period of a task.
+         *
+         * \param[in] taskId The ID of the task.
+         *
+         * \return Returns the effective period, in seconds.  A value of zero is returned if the task is stopped or
+         *         not registered.
+         */
+        unsigned long period(TaskId taskId) const;
+
+        /**
+         * Method you can use to replace the configured overrides.  Tasks registered later pick up their overrides
+         * when registered.
+         *
+         * \param[in] configurations The task configurations keyed by task name.
+         */
+        void setConfiguration(const TaskConfigurations& configurations);
+
+    private:
+        /**
+         * The number of levels in the timer wheel.
+         */
+        static constexpr unsigned wheelLevels = 4;
+
+        /**
+         * The number of bits used to select a slot on each level.
+         */
+        static constexpr unsigned slotBits = 6;
+
+        /**
+         * The number of slots on each level.
+         */
+        static constexpr unsigned slotsPerLevel = 1U << slotBits;
+
+        /**
+         * The tick interval, in milliseconds.  Each tick is one second.
+         */
+        static constexpr unsigned tickMilliseconds = 1000;
+
+        /**
+         * Type used to hold an entry in the wheel.  Entries hold the task ID and deadline tick.  Entries whose
+         * deadline no longer matches their task's deadline are stale and ignored.
+         */
+        typedef QPair<TaskId, unsigned long long> WheelEntry;
+
+        /**
+         * Type used to hold the entries in a single slot.
+         */
+        typedef QList<WheelEntry> Slot;
+
+        /**
+         * Class that tracks a single registered task.
+         */
+        class Task {
+            public:
+                /**
+                 * The task name.
+                 */
+                QString name;
+
+                /**
+                 * The owner's mutual exclusion group.
+                 */
+                QString defaultGroup;
+
+                /**
+                 * The owner's jitter, in seconds.
+                 */
+                unsigned long defaultJitter;
+
+                /**
+                 * The owner's period, in seconds.
+                 */
+                unsigned long ownerPeriod;
+
+                /**
+                 * The period the task is currently scheduled with, in seconds.
+                 */
+                unsigned long scheduledPeriod;
+
+                /**
+                 * Flag indicating if runs are aligned to the period.
+                 */
+                bool aligned;
+
+                /**
+                 * The function used to run the task.
+                 */
+                TaskFunction function;
+
+                /**
+                 * The function used to determine if the task is still running.
+                 */
+                BusyFunction busyFunction;
+
+                /**
+                 * The tick the task next runs on.  A value of zero indicates that the task is not scheduled.
+                 */
+                unsigned long long deadline;
+
+                /**
+                 * Flag indicating if the task is running.
+                 */
+                bool running;
+
+                /**
+                 * Timer measuring the current run.
+                 */
+                QElapsedTimer runClock;
+
+                /**
+                 * Counter tracking runs started.
+                 */
+                MetricsRegistry::Counter* runsMetric;
+
+                /**
+                 * Counter tracking runs deferred.
+                 */
+                MetricsRegistry::Counter* deferredMetric;
+
+                /**
+                 * Histogram tracking run durations.
+                 */
+                MetricsRegistry::Histogram* durationMetric;
+        };
+
+        PeriodicScheduler();
+
+        ~PeriodicScheduler() override;
+
+        /**
+         * Method that is triggered at each tick to advance the wheel and run due tasks.
+         */
+        void tick();
+
+        /**
+         * Method that advances the wheel by a single tick.  The caller must hold the scheduler lock.
+         *
+         * \param[in,out] dueTasks The list to append the IDs of due tasks to.
+         */
+        void advance(QList<TaskId>& dueTasks);
+
+        /**
+         * Method that runs, or defers, a due task.
+         *
+         * \param[in] taskId The ID of the task.
+         */
+        void runTask(TaskId taskId);
+
+        /**
+         * Method that finishes tasks whose work is no longer running.  The caller must hold the scheduler lock.
+         */
+        void pollRunning();
+
+        /**
+         * Method that records the end of a run.  The caller must hold the scheduler lock.
+         *
+         * \param[in] task The task that finished.
+         */
+        void finishTask(Task& task);
+
+        /**
+         * Method that applies a task's effective period, rescheduling the task if the period changed.  The caller
+         * must hold the scheduler lock.
+         *
+         * \param[in] taskId The ID of the task.
+         *
+         * \param[in] task   The task to update.
+         */
+        void updateTask(TaskId taskId, Task& task);
+
+        /**
+         * Method that schedules a task's next periodic run.  The caller must hold the scheduler lock.
+         *
+         * \param[in] taskId The ID of the task.
+         *
+         * \param[in] task   The task to schedule.
+         */
+        void scheduleNext(TaskId taskId, Task& task);
+
+        /**
+         * Method that schedules a task for a given tick.  The caller must hold the scheduler lock.
+         *
+         * \param[in] taskId   The ID of the task.
+         *
+         * \param[in] task     The task to schedule.
+         *
+         * \param[in] deadline The tick to run the task on.
+         */
+        void scheduleAt(TaskId taskId, Task& task, unsigned long long deadline);
+
+        /**
+         * Method that places an entry in the wheel.  The caller must hold the scheduler lock.
+         *
+         * \param[in] entry The entry to be placed.
+         */
+        void insertEntry(const WheelEntry& entry);
+
+        /**
+         * Method that determines a task's effective period.  The caller must hold the scheduler lock.
+         *
+         * \param[in] task The task.
+         *
+         * \return Returns the effective period, in seconds.
+         */
+        unsigned long effectivePeriod(const Task& task) const;
+
+        /**
+         * Method that determines a task's effective jitter.  The caller must hold the scheduler lock.
+         *
+         * \param[in] task The task.
+         *
+         * \return Returns the effective jitter, in seconds.
+         */
+        unsigned long effectiveJitter(const Task& task) const;
+
+        /**
+         * Method that determines a task's effective group.  The caller must hold the scheduler lock.
+         *
+         * \param[in] task The task.
+         *
+         * \return Returns the effective group.  An empty string indicates no group.
+         */
+        QString effectiveGroup(const Task& task) const;
+
+        /**
+         * Method that determines if another member of a group is running.  The caller must hold the scheduler lock.
+         *
+         * \param[in] group  The group to check.
+         *
+         * \param[in] taskId The ID of the task to exclude.
+         *
+         * \return Returns true if another member of the group is running.
+         */
+        bool groupBusy(const QString& group, TaskId taskId) const;
+
+        /**
+         * Lock protecting the scheduler.
+         */
+        mutable QMutex schedulerMutex;
+
+        /**
+         * The registered tasks, keyed by task ID.
+         */
+        QHash<TaskId, Task*> currentTasks;
+
+        /**
+         * The ID to assign to the next registered task.
+         */
+        TaskId nextTaskId;
+
+        /**
+         * The configured overrides, keyed by task name.
+         */
+        TaskConfigurations currentConfigurations;
+
+        /**
+         * The wheel slots, by level.
+         */
+        Slot wheel[wheelLevels][slotsPerLevel];
+
+        /**
+         * The current tick.
+         */
+        unsigned long long currentTick;
+
+        /**
+         * Timer measuring the time since the scheduler was created.
+         */
+        QElapsedTimer clock;
+
+        /**
+         * Timer used to drive the wheel.
+         */
+        QTimer* tickTimer;
+};
+
+#endif
@@ -0,0 +1,254 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref PlotCache class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef PLOT_CACHE_H
+#define PLOT_CACHE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QAtomicInteger>
+
+#include <cstdint>
+
+#include "concurrent_cache.h"
+
+/**
+ * Class that caches encoded plot images.  Plots are keyed by their normalized plot parameters and tagged with the
+ * version of the data they were rendered from.  A cached plot is only returned while its data version is current so
+ * new data is never hidden by a stale image.  This class is thread safe.
+ */
+class PlotCache {
+    public:
+        /**
+         * The default maximum number of cached plots.
+         */
+        static constexpr unsigned long defaultCacheDepth = 256;
+
+        /**
+         * The divisor applied to the configured cache depth while under memory pressure.
+         */
+        static constexpr unsigned long pressureShrinkFactor = 4;
+
+        /**
+         * Trivial class holding a single encoded plot.
+         */
+        class Plot {
+            public:
+                Plot() {
+                    dataVersion = 0;
+                }
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] key         The normalized plot parameters.
+                 *
+                 * \param[in] dataVersion The version of the data the plot was rendered from.
+                 *
+                 * \param[in] imageData   The encoded image.
+                 */
+                Plot(const QByteArray& key, unsigned long long dataVersion, const QByteArray& imageData) {
+                    this->key         = key;
+                    this->dataVersion = dataVersion;
+                    this->imageData   = imageData;
+                    this->etag        = PlotCache::etag(key, dataVersion);
+                }
+
+                /**
+                 * The normalized plot parameters.
+                 */
+                QByteArray key;
+
+                /**
+                 * The version of the data the plot was rendered from.
+                 */
+                unsigned long long dataVersion;
+
+                /**
+                 * The encoded image.
+                 */
+                QByteArray imageData;
+
+                /**
+                 * The entity tag clients can use to revalidate the plot.
+                 */
+                QByteArray etag;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] maximumCacheDepth The maximum number of cached plots.
+         */
+        PlotCache(unsigned long maximumCacheDepth = defaultCacheDepth);
+
+        ~PlotCache();
+
+        /**
+         * Method you can use to change the maximum number of cached plots.
+         *
+         * \param[in] newCacheSize The new maximum number of cached plots.  A value of zero disables the cache.
+         */
+        void resizeCache(unsigned long newCacheSize);
+
+        /**
+         * Method you can use to obtain the plot cache statistics.
+         *
+         * \return Returns the cache statistics, summed across all shards.
+         */
+        CacheBase::Statistics statistics() const;
+
+        /**
+         * Method you can use to estimate the memory held by the cached plots.
+         *
+         * \return Returns the approximate memory usage, in bytes.
+         */
+        unsigned long long memoryUsage() const;
+
+        /**
+         * Method you can use to shrink the cache while the process is under memory pressure.  The cache is reduced to
+         * \ref PlotCache::pressureShrinkFactor of its configured size and restored once pressure is released.
+         *
+         * \param[in] underPressure If true, the cache is shrunk.  If false, the configured size is restored.
+         */
+        void setMemoryPressure(bool underPressure);
+
+        /**
+         * Method you can use to look up a cached plot.
+         *
+         * \param[in]  key         The normalized plot parameters.
+         *
+         * \param[in]  dataVersion The current version of the data covered by the plot.
+         *
+         * \param[out] plot        The cached plot.  The value is only updated if a current plot is found.
+         *
+         * \return Returns true if a current plot was found.  Returns false if the plot must be rendered.
+         */
+        bool getPlot(const QByteArray& key, unsigned long long dataVersion, Plot& plot) const;
+
+        /**
+         * Method you can use to add a newly rendered plot to the cache.
+         *
+         * \param[in] key         The normalized plot parameters.
+         *
+         * \param[in] dataVersion The version of the data the plot was rendered from.  The version should be read
+         *                        before the plot is rendered so that data arriving while rendering invalidates the
+         *                        plot.
+         *
+         * \param[in] imageData   The encoded image.
+         *
+         * \return Returns the cached plot.
+         */
+        Plot addPlot(const QByteArray& key, unsigned long long dataVersion, const QByteArray& imageData);
+
+        /**
+         * Method that calculates the entity tag for a plot.
+         *
+         * \param[in] key         The normalized plot parameters.
+         *
+         * \param[in] dataVersion The version of the data the plot was rendered from.
+         *
+         * \return Returns the entity tag, as a hexadecimal string.
+         */
+        static QByteArray etag(const QByteArray& key, unsigned long long dataVersion);
+
+    private:
+        /**
+         * Method that calculates the cache ID used for a key.
+         *
+         * \param[in] key The normalized plot parameters.
+         *
+         * \return Returns the cache ID for the key.
+         */
+        static std::uint64_t keyHash(const QByteArray& key);
+
+        /**
+         * Class that holds the encoded plots.
+         */
+        class EntryCache:public ConcurrentCache<Plot, std::uint64_t> {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] maximumCacheDepth The maximum allowed cache depth.
+                 */
+                EntryCache(
+                        unsigned long maximumCacheDepth
+                    ):ConcurrentCache<Plot, std::uint64_t>(
+                        maximumCacheDepth,
+                        EvictionPolicy::CLOCK
+                    ) {}
+
+                ~EntryCache() override {}
+
+            protected:
+                /**
+                 * Method that obtains the ID used to access a specific value.
+                 *
+                 * \param[in] value The value to calculate the ID for.
+                 *
+                 * \return Returns the ID to associate with this value.
+                 */
+                std::uint64_t idFromValue(const Plot& value) const final {
+                    return keyHash(value.key);
+                }
+        };
+
+        /**
+         * The cached plots.
+         */
+        mutable EntryCache entryCache;
+
+        /**
+         * Method that applies the configured size, reduced if under memory pressure.  The depth mutex must be held.
+         */
+        void applyCacheDepth();
+
+        /**
+         * Method that folds the size of a newly cached plot into the running average.
+         *
+         * \param[in] entryBytes The approximate size of the plot, in bytes.
+         */
+        void updateAverageEntryBytes(unsigned long long entryBytes);
+
+        /**
+         * Mutex protecting the configured cache depth and the memory pressure flag.
+         */
+        QMutex depthMutex;
+
+        /**
+         * The configured cache depth.
+         */
+        unsigned long currentCacheDepth;
+
+        /**
+         * Flag indicating the cache is shrunk due to memory pressure.
+         */
+        bool underMemoryPressure;
+
+        /**
+         * Running average of the size of a cached plot, in bytes.
+         */
+        QAtomicInteger<quint64> averageEntryBytes;
+};
+
+#endif
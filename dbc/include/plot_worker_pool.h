@@ -0,0 +1,252 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref PlotWorkerPool class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef PLOT_WORKER_POOL_H
+#define PLOT_WORKER_POOL_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+
+#include "metrics_registry.h"
+
+class PlotMailbox;
+
+/**
+ * Class that maintains a pool of threads used to render plots.  Plot requests are queued and picked up by the first
+ * idle worker so a few slow plots do not delay every other plot.  Each worker renders into its own offscreen scene and
+ * uses its own database connection.
+ */
+class PlotWorkerPool:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * The default number of rendering workers.
+         */
+        static const unsigned defaultNumberWorkers;
+
+        /**
+         * The default maximum number of plots that may wait for a worker.
+         */
+        static const unsigned defaultMaximumQueued;
+
+        /**
+         * The database thread ID used by the first worker.  Subsequent workers count down from this value.
+         */
+        static constexpr unsigned firstDatabaseThreadId = static_cast<unsigned>(-10);
+
+        /**
+         * Base class for queued plot requests.
+         */
+        class Job {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] mailbox The mailbox to receive the rendered image.
+                 */
+                Job(PlotMailbox* mailbox);
+
+                virtual ~Job();
+
+                /**
+                 * Method you can use to obtain the mailbox tied to this job.
+                 *
+                 * \return Returns the mailbox that receives the rendered image.
+                 */
+                PlotMailbox* mailbox() const;
+
+                /**
+                 * Method that is called from a worker thread to render the plot.  The rendered image, or a failed
+                 * status, must be sent to the job's mailbox.
+                 *
+                 * \param[in] databaseThreadId The database thread ID reserved for the calling worker.
+                 */
+                virtual void run(unsigned databaseThreadId) = 0;
+
+            private:
+                /**
+                 * The mailbox tied to this job.
+                 */
+                PlotMailbox* currentMailbox;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] parent Pointer to the parent object.
+         */
+        PlotWorkerPool(QObject* parent = nullptr);
+
+        ~PlotWorkerPool() override;
+
+        /**
+         * Method you can use to set the number of rendering workers.  Removed workers finish the plot they are
+         * rendering before they exit.
+         *
+         * \param[in] numberWorkers The number of rendering workers.  Must be at least 1.
+         */
+        void setNumberWorkers(unsigned numberWorkers);
+
+        /**
+         * Method you can use to determine the number of rendering workers.
+         *
+         * \return Returns the number of rendering workers.
+         */
+        unsigned numberWorkers() const;
+
+        /**
+         * Method you can use to set the maximum number of plots that may wait for a worker.  Callers are expected
+         * to check \ref PlotWorkerPool::acceptingJobs and refuse plot requests rather than queue them behind a
+         * backlog they would wait on for a long time.
+         *
+         * \param[in] maximumQueued The maximum number of queued plots.  A value of 0 disables the limit.
+         */
+        void setMaximumQueued(unsigned maximumQueued);
+
+        /**
+         * Method you can use to determine the maximum number of plots that may wait for a worker.
+         *
+         * \return Returns the maximum number of queued plots.  A value of 0 indicates no limit.
+         */
+        unsigned maximumQueued() const;
+
+        /**
+         * Method you can use to determine if the backlog is short enough to accept new plots.  This method is
+         * thread safe.
+         *
+         * \return Returns true if new plots should be queued.  Returns false if the backlog is full.
+         */
+        bool acceptingJobs() const;
+
+        /**
+         * Method you can use to queue a plot request.  This method is thread safe.
+         *
+         * \param[in] job The job to be queued.  The pool takes ownership of the job.
+         */
+        void enqueue(Job* job);
+
+    private:
+        /**
+         * Class used to render queued plots from a dedicated thread.
+         */
+        class Worker:public QThread {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] pool             The pool that owns this worker.
+                 *
+                 * \param[in] databaseThreadId The database thread ID reserved for this worker.
+                 */
+                Worker(PlotWorkerPool* pool, unsigned databaseThreadId);
+
+                ~Worker() override;
+
+                /**
+                 * Method you can use to ask the worker to exit once it finishes its current job.
+                 */
+                void requestStop();
+
+                /**
+                 * Method you can use to determine if the worker has been asked to exit.  The pool's queue mutex must
+                 * be held when calling this method.
+                 *
+                 * \return Returns true if the worker should exit.
+                 */
+                bool stopRequested() const;
+
+            protected:
+                /**
+                 * Method that runs this thread.
+                 */
+                void run() override;
+
+            private:
+                /**
+                 * The pool that owns this worker.
+                 */
+                PlotWorkerPool* currentPool;
+
+                /**
+                 * The database thread ID reserved for this worker.
+                 */
+                unsigned currentDatabaseThreadId;
+
+                /**
+                 * Flag indicating that the worker should exit.  Protected by the pool's queue mutex.
+                 */
+                bool currentStopRequested;
+        };
+
+        /**
+         * Method used by workers to obtain the next job.  The method blocks until a job is available or the worker is
+         * asked to stop.
+         *
+         * \param[in] worker The worker requesting a job.
+         *
+         * \return Returns the next job.  A null pointer is returned if the worker should exit.
+         */
+        Job* nextJob(Worker* worker);
+
+        /**
+         * Method that reports the current backlog to the \ref MetricsRegistry.  The queue mutex must be held when
+         * calling this method.
+         */
+        void updateQueueDepth();
+
+        /**
+         * Mutex used to protect the job queue and the worker stop flags.
+         */
+        mutable QMutex queueMutex;
+
+        /**
+         * Wait condition used to wake idle workers.
+         */
+        QWaitCondition queueCondition;
+
+        /**
+         * The queued jobs.
+         */
+        QQueue<Job*> pendingJobs;
+
+        /**
+         * The maximum number of queued jobs.  Protected by the queue mutex.
+         */
+        unsigned currentMaximumQueued;
+
+        /**
+         * Gauge tracking the number of queued jobs.
+         */
+        MetricsRegistry::Gauge* queueDepthMetric;
+
+        /**
+         * The current workers.
+         */
+        QList<Worker*> workers;
+};
+
+#endif
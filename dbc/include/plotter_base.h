@@ -25,12 +25,23 @@
 
 #include <QObject>
 #include <QMutex>
+#include <QAtomicInt>
 #include <QVector>
+#include <QString>
+#include <QStringList>
 #include <QFont>
+#include <QPointF>
+#include <QRectF>
+#include <QImage>
+#include <QPainter>
+
+class QPen;
+class QBrush;
 
 #include <cstdint>
 
 #include "customer_capabilities.h"
+#include "plot_worker_pool.h"
 
 namespace QtCharts {
     class QChart;
@@ -73,17 +84,388 @@ class PlotterBase:public QObject {
         /**
          * Constructor
          *
-         * \param[in] parent Pointer to the parent object.
+         * \param[in] plotWorkerPool The pool of workers used to render plots.
+         *
+         * \param[in] parent         Pointer to the parent object.
          */
-        PlotterBase(QObject* parent = nullptr);
+        PlotterBase(PlotWorkerPool* plotWorkerPool, QObject* parent = nullptr);
 
         ~PlotterBase() override;
 
+        /**
+         * The largest image, in pixels, that will be rendered using the lightweight \ref PlotterBase::Canvas
+         * renderer rather than QtCharts.  The fixed cost of building a QtCharts scene dominates for small,
+         * sparkline sized, images.
+         */
+        static constexpr unsigned defaultFastRendererMaximumPixels = 320 * 240;
+
+        /**
+         * Method you can use to set the largest image, in pixels, that will be rendered using the lightweight
+         * renderer.
+         *
+         * \param[in] newMaximumPixels The new pixel threshold.  A value of 0 will force all plots to be rendered
+         *                             using QtCharts.
+         */
+        void setFastRendererMaximumPixels(unsigned newMaximumPixels);
+
+        /**
+         * Method you can use to obtain the largest image, in pixels, that will be rendered using the lightweight
+         * renderer.
+         *
+         * \return Returns the current pixel threshold.
+         */
+        unsigned fastRendererMaximumPixels() const;
+
+        /**
+         * Method you can use to determine if the rendering backlog is short enough to accept new plots.  Callers
+         * should refuse plot requests when this method returns false rather than block behind the backlog.
+         *
+         * \return Returns true if new plots should be requested.  Returns false if the backlog is full.
+         */
+        bool acceptingPlots() const;
+
     protected:
         /**
-         * The plotter database thread ID.
+         * Lightweight renderer that draws plots directly into a QImage using QPainter.  The class supports the
+         * subset of QtCharts used by the plotters:  a title, a bottom date/time, day-of-week or value axis, a left
+         * linear or logarithmic value axis, lines, shaded bands and histogram bars.
+         *
+         * To use, configure the title and axes, call \ref PlotterBase::Canvas::drawFrame, draw the plot content
+         * and then obtain the image using \ref PlotterBase::Canvas::image.
          */
-        static constexpr unsigned databaseThreadId = static_cast<unsigned>(-10);
+        class Canvas {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] width  The image width, in pixels.
+                 *
+                 * \param[in] height The image height, in pixels.
+                 */
+                Canvas(unsigned width, unsigned height);
+
+                ~Canvas();
+
+                /**
+                 * Method you can use to set the plot title.
+                 *
+                 * \param[in] text            The title text.
+                 *
+                 * \param[in] fontDescription The title font description.  An invalid description selects the
+                 *                            default font.
+                 */
+                void setTitle(const QString& text, const QString& fontDescription);
+
+                /**
+                 * Method you can use to set the axis titles.
+                 *
+                 * \param[in] xAxisTitle      The horizontal axis title.
+                 *
+                 * \param[in] yAxisTitle      The vertical axis title.
+                 *
+                 * \param[in] fontDescription The axis title font description.  An invalid description selects the
+                 *                            default font.
+                 */
+                void setAxisTitles(
+                    const QString& xAxisTitle,
+                    const QString& yAxisTitle,
+                    const QString& fontDescription
+                );
+
+                /**
+                 * Method you can use to set the font used for axis labels.
+                 *
+                 * \param[in] fontDescription The axis label font description.  An invalid description selects the
+                 *                            default font.
+                 */
+                void setAxisLabelFont(const QString& fontDescription);
+
+                /**
+                 * Method you can use to configure the horizontal axis as a date/time axis.
+                 *
+                 * \param[in] minimumMilliseconds The left edge, in milliseconds since the Unix epoch.
+                 *
+                 * \param[in] maximumMilliseconds The right edge, in milliseconds since the Unix epoch.
+                 *
+                 * \param[in] dateFormatString    The format string used for the labels.
+                 */
+                void setHorizontalDateTimeAxis(
+                    double         minimumMilliseconds,
+                    double         maximumMilliseconds,
+                    const QString& dateFormatString
+                );
+
+                /**
+                 * Method you can use to configure the horizontal axis as a day-of-week axis.  The axis spans 1.0
+                 * to 8.0 with labels for Monday through Sunday.
+                 */
+                void setHorizontalDayOfWeekAxis();
+
+                /**
+                 * Method you can use to configure the horizontal axis as a value axis.
+                 *
+                 * \param[in] minimum       The left edge value.
+                 *
+                 * \param[in] maximum       The right edge value.
+                 *
+                 * \param[in] numberSteps   The number of major steps along the axis.
+                 *
+                 * \param[in] numberDigits  The number of digits to show after the decimal point.
+                 */
+                void setHorizontalValueAxis(
+                    double   minimum,
+                    double   maximum,
+                    unsigned numberSteps,
+                    unsigned numberDigits
+                );
+
+                /**
+                 * Method you can use to configure the vertical axis.
+                 *
+                 * \param[in] minimum     The bottom edge value.
+                 *
+                 * \param[in] maximum     The top edge value.
+                 *
+                 * \param[in] numberSteps The number of major steps along the axis.  Ignored for logarithmic axis.
+                 *
+                 * \param[in] logScale    If true, the axis will be logarithmic.
+                 */
+                void setVerticalAxis(double minimum, double maximum, unsigned numberSteps, bool logScale = false);
+
+                /**
+                 * Method that lays out and draws the title, axis titles, grid lines and axis labels.  This method
+                 * must be called after the axis are configured and before any plot content is drawn.
+                 */
+                void drawFrame();
+
+                /**
+                 * Method that draws a poly-line.
+                 *
+                 * \param[in] points The points to be drawn, in axis coordinates.
+                 *
+                 * \param[in] pen    The pen used to draw the line.
+                 */
+                void drawLine(const QVector<QPointF>& points, const QPen& pen);
+
+                /**
+                 * Method that draws a shaded band between two lines.
+                 *
+                 * \param[in] lower The points along the lower edge of the band, in axis coordinates.
+                 *
+                 * \param[in] upper The points along the upper edge of the band, in axis coordinates.
+                 *
+                 * \param[in] brush The brush used to fill the band.  Gradients are stretched over the band.
+                 *
+                 * \param[in] pen   The pen used to outline the band.
+                 */
+                void drawBand(
+                    const QVector<QPointF>& lower,
+                    const QVector<QPointF>& upper,
+                    const QBrush&           brush,
+                    const QPen&             pen
+                );
+
+                /**
+                 * Method that draws equal width bars spanning the horizontal axis.
+                 *
+                 * \param[in] values The bar heights, in vertical axis coordinates, from left to right.
+                 *
+                 * \param[in] brush  The brush used to fill the bars.
+                 *
+                 * \param[in] pen    The pen used to outline the bars.
+                 */
+                void drawBars(const QVector<double>& values, const QBrush& brush, const QPen& pen);
+
+                /**
+                 * Method that finishes drawing and returns the rendered image.
+                 *
+                 * \return Returns the rendered image.
+                 */
+                const QImage& image();
+
+            private:
+                /**
+                 * Enumeration of supported horizontal axis types.
+                 */
+                enum class HorizontalAxisType {
+                    /**
+                     * Indicates a date/time axis.
+                     */
+                    DATE_TIME,
+
+                    /**
+                     * Indicates a day-of-week axis.
+                     */
+                    DAY_OF_WEEK,
+
+                    /**
+                     * Indicates a value axis.
+                     */
+                    VALUE
+                };
+
+                /**
+                 * Margin, in pixels, placed around the plot elements.
+                 */
+                static constexpr int margin = 8;
+
+                /**
+                 * The number of date/time axis steps.  Matches the tick count used with QtCharts.
+                 */
+                static constexpr unsigned dateTimeSteps = 4;
+
+                /**
+                 * Method that converts a font description to a font, falling back to a default font.
+                 *
+                 * \param[in] fontDescription The font description.
+                 *
+                 * \param[in] defaultFont     The font to use if the description is invalid.
+                 *
+                 * \return Returns the requested font.
+                 */
+                static QFont fontFor(const QString& fontDescription, const QFont& defaultFont);
+
+                /**
+                 * Method that maps a point in axis coordinates to image coordinates.
+                 *
+                 * \param[in] point The point in axis coordinates.
+                 *
+                 * \return Returns the point in image coordinates.
+                 */
+                QPointF map(const QPointF& point) const;
+
+                /**
+                 * Method that maps a horizontal axis value to an image coordinate.
+                 *
+                 * \param[in] x The horizontal axis value.
+                 *
+                 * \return Returns the image X coordinate.
+                 */
+                double mapX(double x) const;
+
+                /**
+                 * Method that maps a vertical axis value to an image coordinate.
+                 *
+                 * \param[in] y The vertical axis value.
+                 *
+                 * \return Returns the image Y coordinate.
+                 */
+                double mapY(double y) const;
+
+                /**
+                 * Method that generates the horizontal axis tick values and labels.
+                 *
+                 * \param[out] tickValues The tick values, in horizontal axis coordinates.
+                 *
+                 * \param[out] labels     The label for each tick.  Labels are positioned between ticks for
+                 *                        day-of-week axis.
+                 */
+                void horizontalTicks(QVector<double>& tickValues, QStringList& labels) const;
+
+                /**
+                 * Method that generates the vertical axis tick values and labels.
+                 *
+                 * \param[out] tickValues The tick values, in vertical axis coordinates.
+                 *
+                 * \param[out] labels     The label for each tick.
+                 */
+                void verticalTicks(QVector<double>& tickValues, QStringList& labels) const;
+
+                /**
+                 * The image being rendered.
+                 */
+                QImage currentImage;
+
+                /**
+                 * The painter used to render the image.
+                 */
+                QPainter currentPainter;
+
+                /**
+                 * The plot title.
+                 */
+                QString currentTitle;
+
+                /**
+                 * The plot title font.
+                 */
+                QFont currentTitleFont;
+
+                /**
+                 * The horizontal axis title.
+                 */
+                QString currentXAxisTitle;
+
+                /**
+                 * The vertical axis title.
+                 */
+                QString currentYAxisTitle;
+
+                /**
+                 * The axis title font.
+                 */
+                QFont currentAxisTitleFont;
+
+                /**
+                 * The axis label font.
+                 */
+                QFont currentAxisLabelFont;
+
+                /**
+                 * The horizontal axis type.
+                 */
+                HorizontalAxisType currentHorizontalAxisType;
+
+                /**
+                 * The date format string used for date/time axis.
+                 */
+                QString currentDateFormatString;
+
+                /**
+                 * The left edge of the horizontal axis.
+                 */
+                double currentMinimumX;
+
+                /**
+                 * The right edge of the horizontal axis.
+                 */
+                double currentMaximumX;
+
+                /**
+                 * The number of major steps along the horizontal axis.
+                 */
+                unsigned currentNumberXSteps;
+
+                /**
+                 * The number of digits shown after the decimal point on a value horizontal axis.
+                 */
+                unsigned currentNumberXDigits;
+
+                /**
+                 * The bottom edge of the vertical axis.
+                 */
+                double currentMinimumY;
+
+                /**
+                 * The top edge of the vertical axis.
+                 */
+                double currentMaximumY;
+
+                /**
+                 * The number of major steps along the vertical axis.
+                 */
+                unsigned currentNumberYSteps;
+
+                /**
+                 * Flag indicating if the vertical axis is logarithmic.
+                 */
+                bool currentLogScale;
+
+                /**
+                 * The region of the image holding the plot content.
+                 */
+                QRectF currentPlotArea;
+        };
 
         /**
          * Value used to perform nice scaling.  The value relates roughly to the denominator of the fraction of a plot
@@ -135,6 +517,58 @@ class PlotterBase:public QObject {
          * \return Returns a font matching the description.
          */
         static QFont toFont(const QString& description, bool* ok = nullptr);
+
+        /**
+         * Method you can use to queue a plot to be rendered by the worker pool.
+         *
+         * \param[in] job The job to be queued.  The pool takes ownership of the job.
+         */
+        void enqueue(PlotWorkerPool::Job* job);
+
+        /**
+         * Method that determines if a plot should be rendered using the lightweight \ref PlotterBase::Canvas
+         * renderer.
+         *
+         * \param[in] width  The image width, in pixels.
+         *
+         * \param[in] height The image height, in pixels.
+         *
+         * \return Returns true if the lightweight renderer should be used.  Returns false if QtCharts should be
+         *         used.
+         */
+        bool useFastRenderer(unsigned width, unsigned height) const;
+
+        /**
+         * Method that records how long a plot took to produce in the \ref MetricsRegistry.
+         *
+         * \param[in] plotType     The name used to identify the type of plot.
+         *
+         * \param[in] fastRenderer Flag indicating if the lightweight renderer was used.
+         *
+         * \param[in] numberPoints The number of data points, or bars, plotted.
+         *
+         * \param[in] dataTime     The time spent obtaining and preparing the plotted data, in nanoseconds.
+         *
+         * \param[in] drawTime     The time spent drawing the plot, in nanoseconds.
+         */
+        static void recordPlotTiming(
+            const QString& plotType,
+            bool           fastRenderer,
+            unsigned long  numberPoints,
+            qint64         dataTime,
+            qint64         drawTime
+        );
+
+    private:
+        /**
+         * The pool of workers used to render plots.
+         */
+        PlotWorkerPool* currentPlotWorkerPool;
+
+        /**
+         * The largest image, in pixels, rendered using the lightweight renderer.
+         */
+        QAtomicInt currentFastRendererMaximumPixels;
 };
 
 #endif
@@ -0,0 +1,208 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref QueryExecutor class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef QUERY_EXECUTOR_H
+#define QUERY_EXECUTOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+
+/**
+ * Class that maintains a pool of long lived threads used to issue independent database queries concurrently with the
+ * calling thread.  Database connections are pooled per thread so each worker keeps its own open connection between
+ * queries.
+ *
+ * Jobs are owned by the caller, which typically queues one phase of a request, performs another phase itself and then
+ * waits for the queued phase to complete.
+ */
+class QueryExecutor:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * The default number of query workers.
+         */
+        static const unsigned defaultNumberWorkers;
+
+        /**
+         * Base class for queued queries.
+         */
+        class Job {
+            friend class QueryExecutor;
+
+            public:
+                Job();
+
+                virtual ~Job();
+
+                /**
+                 * Method that is called from a worker thread to perform the query.
+                 */
+                virtual void run() = 0;
+
+                /**
+                 * Method you can use to block until the job has been run.
+                 */
+                void waitForCompletion();
+
+            private:
+                /**
+                 * Method that marks this job as completed and releases any waiting thread.
+                 */
+                void markCompleted();
+
+                /**
+                 * Mutex used to protect the completion flag.
+                 */
+                QMutex completionMutex;
+
+                /**
+                 * Wait condition used to wake the waiting thread.
+                 */
+                QWaitCondition completionCondition;
+
+                /**
+                 * Flag indicating that the job has been run.
+                 */
+                bool currentCompleted;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] parent Pointer to the parent object.
+         */
+        QueryExecutor(QObject* parent = nullptr);
+
+        ~QueryExecutor() override;
+
+        /**
+         * Method you can use to set the number of query workers.  Removed workers finish the query they are running
+         * before they exit.
+         *
+         * \param[in] numberWorkers The number of query workers.
+         */
+        void setNumberWorkers(unsigned numberWorkers);
+
+        /**
+         * Method you can use to determine the number of query workers.
+         *
+         * \return Returns the number of query workers.
+         */
+        unsigned numberWorkers() const;
+
+        /**
+         * Method you can use to queue a query.  This method is thread safe.
+         *
+         * \param[in] job The job to be queued.  The caller retains ownership of the job and must call
+         *                \ref QueryExecutor::Job::waitForCompletion before destroying it.
+         */
+        void enqueue(Job* job);
+
+    private:
+        /**
+         * Class used to run queued queries from a dedicated thread.
+         */
+        class Worker:public QThread {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] executor The executor that owns this worker.
+                 */
+                Worker(QueryExecutor* executor);
+
+                ~Worker() override;
+
+                /**
+                 * Method you can use to ask the worker to exit once it finishes its current job.
+                 */
+                void requestStop();
+
+                /**
+                 * Method you can use to determine if the worker has been asked to exit.  The executor's queue mutex
+                 * must be held when calling this method.
+                 *
+                 * \return Returns true if the worker should exit.
+                 */
+                bool stopRequested() const;
+
+            protected:
+                /**
+                 * Method that runs this thread.
+                 */
+                void run() override;
+
+            private:
+                /**
+                 * The executor that owns this worker.
+                 */
+                QueryExecutor* currentExecutor;
+
+                /**
+                 * Flag indicating that the worker should exit.  Protected by the executor's queue mutex.
+                 */
+                bool currentStopRequested;
+        };
+
+        /**
+         * Method used by workers to obtain the next job.  The method blocks until a job is available or the worker is
+         * asked to stop.
+         *
+         * \param[in] worker The worker requesting a job.
+         *
+         * \return Returns the next job.  A null pointer is returned if the worker should exit.
+         */
+        Job* nextJob(Worker* worker);
+
+        /**
+         * Mutex used to protect the job queue and the worker stop flags.
+         */
+        mutable QMutex queueMutex;
+
+        /**
+         * Wait condition used to wake idle workers.
+         */
+        QWaitCondition queueCondition;
+
+        /**
+         * The queued jobs.
+         */
+        QQueue<Job*> pendingJobs;
+
+        /**
+         * The number of workers accepting jobs.  Jobs are run by the caller when no workers are accepting jobs.
+         * Protected by the queue mutex.
+         */
+        unsigned currentNumberActiveWorkers;
+
+        /**
+         * The current workers.
+         */
+        QList<Worker*> workers;
+};
+
+#endif
@@ -0,0 +1,149 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref QueryPlanChecker class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef QUERY_PLAN_CHECKER_H
+#define QUERY_PLAN_CHECKER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QList>
+#include <QStringList>
+#include <QMutex>
+#include <QJsonObject>
+#include <QSqlDatabase>
+
+class DatabaseManager;
+
+/**
+ * Class that runs EXPLAIN against a representative instance of each hot query shape in the background after startup
+ * and warns when the planner falls back to a sequential scan over a large table.  The queries mirror the shapes built
+ * by \ref Events::Checker::queryString, \ref Events, \ref Monitors and \ref LatencyInterfaceManager::buildQueryString
+ * and should be kept in step with them.  Sequential scans over small tables are expected and are not reported.
+ */
+class QueryPlanChecker:public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * The default minimum estimated number of rows a table must hold before a sequential scan is reported.
+         */
+        static constexpr unsigned long defaultMinimumTableRows = 10000;
+
+        /**
+         * Constructor
+         *
+         * \param[in] databaseManager The database manager used to run the queries.
+         *
+         * \param[in] parent          Pointer to the parent object.
+         */
+        QueryPlanChecker(DatabaseManager* databaseManager, QObject* parent = nullptr);
+
+        ~QueryPlanChecker() override;
+
+        /**
+         * Method you can use to start the check.  The check is performed at most once, later calls are ignored.
+         * Call this method once the database connection settings are known.
+         *
+         * \param[in] minimumTableRows The minimum estimated number of rows a table must hold before a sequential scan
+         *                             over it is reported.
+         */
+        void startCheck(unsigned long minimumTableRows = defaultMinimumTableRows);
+
+    protected:
+        /**
+         * Method that checks the query plans in the background.
+         */
+        void run() override;
+
+    private:
+        /**
+         * The thread ID used for database access during the check.
+         */
+        static const unsigned checkThreadId = static_cast<unsigned>(-6);
+
+        /**
+         * Trivial class used to describe a single hot query.
+         */
+        class HotQuery {
+            public:
+                /**
+                 * A short description of the query, used in log messages.
+                 */
+                QString description;
+
+                /**
+                 * The query to be explained.
+                 */
+                QString query;
+        };
+
+        /**
+         * Method that builds the list of hot queries to be checked.
+         *
+         * \return Returns the list of hot queries.
+         */
+        static QList<HotQuery> hotQueries();
+
+        /**
+         * Method that walks a plan node and all of its children, collecting the relations read by sequential scans.
+         *
+         * \param[in]     planNode  The plan node to walk.
+         *
+         * \param[in,out] relations The list of relation names to be appended to.
+         */
+        static void collectSequentialScans(const QJsonObject& planNode, QStringList& relations);
+
+        /**
+         * Method that obtains the planner's estimate of the number of rows in a table.
+         *
+         * \param[in] database     The database to query.
+         *
+         * \param[in] relationName The name of the relation.
+         *
+         * \return Returns the estimated number of rows.  A negative value is returned if the estimate is not
+         *         available.
+         */
+        static double estimatedRows(const QSqlDatabase& database, const QString& relationName);
+
+        /**
+         * The database manager.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * Mutex used to protect the check state.
+         */
+        QMutex stateMutex;
+
+        /**
+         * Flag indicating if the check has been started.
+         */
+        bool checkStarted;
+
+        /**
+         * The minimum estimated number of rows a table must hold before a sequential scan is reported.
+         */
+        unsigned long currentMinimumTableRows;
+};
+
+#endif
@@ -0,0 +1,275 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref QueryStatistics class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef QUERY_STATISTICS_H
+#define QUERY_STATISTICS_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QVariant>
+#include <QMutex>
+#include <QAtomicInteger>
+#include <QSqlQuery>
+
+/**
+ * Class that aggregates execution statistics for each distinct SQL statement.  Statements are normalized by
+ * replacing literals with placeholders and collapsing value lists so that statements differing only in their
+ * parameters share one entry.  Statements taking longer than the slow query threshold are logged along with their
+ * parameters.
+ *
+ * Statements are recorded by \ref SqlHelpers::execute.
+ */
+class QueryStatistics {
+    public:
+        /**
+         * The default threshold, in milliseconds, above which statements are logged.
+         */
+        static const unsigned defaultSlowThresholdMilliseconds;
+
+        /**
+         * The maximum number of distinct statements tracked.  Statements beyond this limit are aggregated under a
+         * single entry.
+         */
+        static constexpr unsigned maximumNumberStatements = 1024;
+
+        /**
+         * Trivial class that summarizes the executions of one normalized statement.
+         */
+        class Summary {
+            public:
+                /**
+                 * The normalized statement.
+                 */
+                QString statement;
+
+                /**
+                 * The number of times the statement was executed.
+                 */
+                unsigned long long count;
+
+                /**
+                 * The number of executions that failed.
+                 */
+                unsigned long long errors;
+
+                /**
+                 * The total time spent executing the statement, in seconds.
+                 */
+                double totalSeconds;
+
+                /**
+                 * The estimated median execution time, in seconds.
+                 */
+                double p50Seconds;
+
+                /**
+                 * The estimated 99th percentile execution time, in seconds.
+                 */
+                double p99Seconds;
+
+                /**
+                 * The longest execution time, in seconds.
+                 */
+                double maximumSeconds;
+
+                /**
+                 * The total number of rows returned or affected.
+                 */
+                unsigned long long rows;
+        };
+
+        /**
+         * Type used to represent a list of summaries.
+         */
+        typedef QList<Summary> SummaryList;
+
+        /**
+         * Method you can use to obtain the process wide statistics.  The instance is created on first use.
+         *
+         * \return Returns a pointer to the statistics instance.
+         */
+        static QueryStatistics* instance();
+
+        /**
+         * Method you can use to set the execution time above which statements are logged.
+         *
+         * \param[in] newSlowThresholdMilliseconds The new threshold, in milliseconds.
+         */
+        void setSlowThreshold(unsigned newSlowThresholdMilliseconds);
+
+        /**
+         * Method that records one execution of a statement.
+         *
+         * \param[in] query       The query that executed the statement.
+         *
+         * \param[in] statement   The statement that was executed.
+         *
+         * \param[in] success     Flag indicating if the statement executed successfully.
+         *
+         * \param[in] elapsedTime The execution time, in nanoseconds.
+         */
+        void record(const QSqlQuery& query, const QString& statement, bool success, qint64 elapsedTime);
+
+        /**
+         * Method that records one execution of a statement that was not executed through a QSqlQuery.
+         *
+         * \param[in] statement   The statement that was executed.
+         *
+         * \param[in] success     Flag indicating if the statement executed successfully.
+         *
+         * \param[in] elapsedTime The execution time, in nanoseconds.
+         *
+         * \param[in] rows        The number of rows returned or affected.
+         */
+        void record(const QString& statement, bool success, qint64 elapsedTime, int rows);
+
+        /**
+         * Method you can use to obtain a summary of every tracked statement.
+         *
+         * \return Returns the summaries, sorted by decreasing total execution time.
+         */
+        SummaryList summaries() const;
+
+        /**
+         * Method you can use to discard all collected statistics.
+         */
+        void reset();
+
+        /**
+         * Method you can use to normalize a statement.  String and numeric literals are replaced by "?", runs of
+         * whitespace are collapsed, and repeated placeholders and value rows are collapsed into a single entry.
+         *
+         * \param[in] statement The statement to be normalized.
+         *
+         * \return Returns the normalized statement.
+         */
+        static QString normalize(const QString& statement);
+
+    private:
+        /**
+         * The number of execution time buckets.  Bucket N holds executions taking less than 2^N microseconds.
+         */
+        static constexpr unsigned numberBuckets = 32;
+
+        /**
+         * Trivial class that accumulates the executions of one normalized statement.
+         */
+        class Entry {
+            public:
+                /**
+                 * The number of times the statement was executed.
+                 */
+                unsigned long long count;
+
+                /**
+                 * The number of executions that failed.
+                 */
+                unsigned long long errors;
+
+                /**
+                 * The total execution time, in nanoseconds.
+                 */
+                qint64 totalTime;
+
+                /**
+                 * The longest execution time, in nanoseconds.
+                 */
+                qint64 maximumTime;
+
+                /**
+                 * The total number of rows returned or affected.
+                 */
+                unsigned long long rows;
+
+                /**
+                 * The number of executions falling into each bucket.
+                 */
+                unsigned long long buckets[numberBuckets];
+        };
+
+        QueryStatistics();
+
+        ~QueryStatistics();
+
+        /**
+         * Method that estimates a percentile from an entry's buckets.
+         *
+         * \param[in] entry    The entry to be examined.
+         *
+         * \param[in] fraction The percentile, expressed as a fraction between 0 and 1.
+         *
+         * \return Returns the estimated execution time, in seconds.
+         */
+        static double percentile(const Entry& entry, double fraction);
+
+        /**
+         * Method that adds one execution of a statement to the statistics.
+         *
+         * \param[in] statement   The statement that was executed.
+         *
+         * \param[in] success     Flag indicating if the statement executed successfully.
+         *
+         * \param[in] elapsedTime The execution time, in nanoseconds.
+         *
+         * \param[in] rows        The number of rows returned or affected.
+         *
+         * \return Returns true if the execution exceeded the slow statement threshold.
+         */
+        bool recordExecution(const QString& statement, bool success, qint64 elapsedTime, int rows);
+
+        /**
+         * Method that logs a slow statement.
+         *
+         * \param[in] boundValues The values bound to the statement.
+         *
+         * \param[in] statement   The statement that was executed.
+         *
+         * \param[in] elapsedTime The execution time, in nanoseconds.
+         *
+         * \param[in] rows        The number of rows returned or affected.
+         */
+        static void logSlowStatement(
+            const QMap<QString, QVariant>& boundValues,
+            const QString&                 statement,
+            qint64                         elapsedTime,
+            int                            rows
+        );
+
+        /**
+         * The slow query threshold, in nanoseconds.
+         */
+        QAtomicInteger<qint64> currentSlowThreshold;
+
+        /**
+         * Mutex protecting the statement entries.
+         */
+        mutable QMutex entryMutex;
+
+        /**
+         * The statement entries, by normalized statement.
+         */
+        QHash<QString, Entry> entries;
+};
+
+#endif
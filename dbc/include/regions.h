@@ -26,6 +26,7 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QAtomicInteger>
 
 #include <cstdint>
 
@@ -121,11 +122,25 @@ class Regions:public QObject, private SqlHelpers {
          */
         RegionHash getAllRegions(unsigned threadId = 0);
 
+        /**
+         * Method you can use to obtain the current version of the region table.  The version changes whenever a
+         * region is created, modified or deleted through this class and is seeded from the startup time.  This method
+         * is thread safe.
+         *
+         * \return Returns the current region table version.
+         */
+        unsigned long long version() const;
+
     private:
         /**
          * The underlying database manager instance.
          */
         DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The current region table version.
+         */
+        QAtomicInteger<quint64> currentVersion;
 };
 
 #endif
@@ -0,0 +1,348 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RequestTracer class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef REQUEST_TRACER_H
+#define REQUEST_TRACER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QMutex>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+
+/**
+ * Class that traces where time is spent while servicing REST requests.  A \ref RequestTracer::Trace is placed around
+ * each request handler and \ref RequestTracer::Span instances are placed around the phases of interest.  A span is
+ * tied to the trace running on the calling thread with the same thread ID.  Time is charged to the innermost open
+ * span so the phase breakdown of a request always adds up to the request's duration.
+ *
+ * The duration of every traced request is recorded, per endpoint, in the \ref MetricsRegistry.  A configurable
+ * fraction of requests is sampled.  Sampled requests also record a per-phase breakdown and, if they take longer than
+ * the slow request threshold, are written to the slow request log.
+ *
+ * Requests are authenticated before the handler is called.  Authentication spans opened before the trace starts are
+ * therefore held by the thread and adopted by the next trace started on that thread with the same thread ID.
+ */
+class RequestTracer {
+    public:
+        /**
+         * Enumeration of traced phases.
+         */
+        enum class Phase {
+            /**
+             * Indicates time spent authenticating the customer.
+             */
+            AUTHENTICATION,
+
+            /**
+             * Indicates time spent in caches, excluding any database access needed to fill them.
+             */
+            CACHE,
+
+            /**
+             * Indicates time spent accessing the database.
+             */
+            DATABASE,
+
+            /**
+             * Indicates time spent building and serializing responses.
+             */
+            JSON,
+
+            /**
+             * Indicates time spent rendering, or waiting for, plots.
+             */
+            PLOT,
+
+            /**
+             * Indicates time spent in the handler outside of any other phase.
+             */
+            HANDLER
+        };
+
+        /**
+         * The number of traced phases.
+         */
+        static constexpr unsigned numberPhases = 6;
+
+        /**
+         * The default fraction of requests to sample.
+         */
+        static const double defaultSampleRate;
+
+        /**
+         * The default threshold, in milliseconds, above which sampled requests are logged.
+         */
+        static const unsigned defaultSlowThresholdMilliseconds;
+
+        /**
+         * Class that traces a single request.  Create an instance on the stack at the start of the request handler.
+         */
+        class Trace {
+            friend class RequestTracer;
+
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] endpoint The name used to identify the endpoint.
+                 *
+                 * \param[in] threadId The ID used to uniquely identify the request while in flight.
+                 */
+                Trace(const QString& endpoint, unsigned threadId);
+
+                ~Trace();
+
+            private:
+                /**
+                 * Method that charges the time since the last phase change to the current phase and starts a new
+                 * phase.
+                 *
+                 * \param[in] newPhase The new phase.
+                 *
+                 * \return Returns the phase that was current.
+                 */
+                Phase switchPhase(Phase newPhase);
+
+                /**
+                 * The endpoint name.
+                 */
+                QString currentEndpoint;
+
+                /**
+                 * The request thread ID.
+                 */
+                unsigned currentThreadId;
+
+                /**
+                 * Flag indicating if this trace is the one spans on this thread are charged to.
+                 */
+                bool active;
+
+                /**
+                 * Flag indicating if this trace is sampled.
+                 */
+                bool sampled;
+
+                /**
+                 * The time the request started, in nanoseconds.
+                 */
+                qint64 startTime;
+
+                /**
+                 * The time of the last phase change, in nanoseconds.
+                 */
+                qint64 lastPhaseTime;
+
+                /**
+                 * The current phase.
+                 */
+                Phase currentPhase;
+
+                /**
+                 * The time charged to each phase, in nanoseconds.
+                 */
+                qint64 phaseTimes[numberPhases];
+        };
+
+        /**
+         * Class that charges the duration of a scope to a phase of the request running on this thread.  The class
+         * does nothing if no sampled request with the same thread ID is running on this thread.
+         */
+        class Span {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] phase    The phase to charge.
+                 *
+                 * \param[in] threadId The request thread ID.
+                 */
+                Span(Phase phase, unsigned threadId);
+
+                ~Span();
+
+            private:
+                /**
+                 * The trace being charged.  A null pointer indicates no trace is being charged.
+                 */
+                Trace* currentTrace;
+
+                /**
+                 * The phase to restore when the span ends.
+                 */
+                Phase previousPhase;
+
+                /**
+                 * The request thread ID.
+                 */
+                unsigned currentThreadId;
+
+                /**
+                 * The time the span started, in nanoseconds, for spans held until a trace starts.  A negative value
+                 * indicates the span is not held.
+                 */
+                qint64 heldStartTime;
+        };
+
+        /**
+         * Method you can use to obtain the process wide tracer.  The tracer is created on first use.
+         *
+         * \return Returns a pointer to the tracer.
+         */
+        static RequestTracer* instance();
+
+        /**
+         * Method you can use to set the fraction of requests to sample.
+         *
+         * \param[in] newSampleRate The new sample rate, between 0 and 1 inclusive.
+         */
+        void setSampleRate(double newSampleRate);
+
+        /**
+         * Method you can use to set the duration above which sampled requests are logged.
+         *
+         * \param[in] newSlowThresholdMilliseconds The new threshold, in milliseconds.
+         */
+        void setSlowThreshold(unsigned newSlowThresholdMilliseconds);
+
+        /**
+         * Method you can use to set the file slow requests are appended to.
+         *
+         * \param[in] filename The file to append to.  An empty string causes slow requests to be written to the
+         *                     application log.
+         *
+         * \return Returns true on success.  Returns false if the file could not be opened.
+         */
+        bool setSlowRequestLog(const QString& filename);
+
+    private:
+        /**
+         * The maximum number of spans a thread holds until a trace starts.
+         */
+        static constexpr unsigned maximumHeldSpans = 4;
+
+        /**
+         * Trivial class that holds a span closed before its trace started.
+         */
+        class HeldSpan {
+            public:
+                /**
+                 * The request thread ID.
+                 */
+                unsigned threadId;
+
+                /**
+                 * The phase the span charged.
+                 */
+                Phase phase;
+
+                /**
+                 * The time the span started, in nanoseconds.
+                 */
+                qint64 startTime;
+
+                /**
+                 * The duration of the span, in nanoseconds.
+                 */
+                qint64 duration;
+        };
+
+        RequestTracer();
+
+        ~RequestTracer();
+
+        /**
+         * Method that obtains the current time.
+         *
+         * \return Returns the current time, in nanoseconds since the tracer was created.
+         */
+        qint64 now() const;
+
+        /**
+         * Method that decides if a request should be sampled.
+         *
+         * \return Returns true if the request should be sampled.
+         */
+        bool sample() const;
+
+        /**
+         * Method that records a completed trace.
+         *
+         * \param[in] trace   The completed trace.
+         *
+         * \param[in] endTime The time the trace ended, in nanoseconds.
+         */
+        void finish(const Trace& trace, qint64 endTime);
+
+        /**
+         * Method that converts a phase to a string.
+         *
+         * \param[in] phase The phase to be converted.
+         *
+         * \return Returns the phase as a string.
+         */
+        static QString toString(Phase phase);
+
+        /**
+         * The trace running on this thread.
+         */
+        static thread_local Trace* threadTrace;
+
+        /**
+         * Spans closed on this thread before their trace started.
+         */
+        static thread_local HeldSpan heldSpans[maximumHeldSpans];
+
+        /**
+         * The number of held spans on this thread.
+         */
+        static thread_local unsigned numberHeldSpans;
+
+        /**
+         * Clock used to time spans.
+         */
+        QElapsedTimer clock;
+
+        /**
+         * The sample rate, scaled so that 0xFFFFFFFF samples every request.
+         */
+        QAtomicInteger<quint32> currentSampleThreshold;
+
+        /**
+         * The slow request threshold, in nanoseconds.
+         */
+        QAtomicInteger<qint64> currentSlowThreshold;
+
+        /**
+         * Mutex protecting the slow request log.
+         */
+        QMutex slowRequestLogMutex;
+
+        /**
+         * The slow request log file.  The file is closed when slow requests go to the application log.
+         */
+        QFile slowRequestLog;
+};
+
+#endif
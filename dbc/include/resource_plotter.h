@@ -77,11 +77,13 @@ class ResourcePlotter:public PlotterBase {
         /**
          * Constructor
          *
-         * \param[in] resources The resource database API.
+         * \param[in] resources      The resource database API.
          *
-         * \param[in] parent    Pointer to the parent object.
+         * \param[in] plotWorkerPool The pool of workers used to render plots.
+         *
+         * \param[in] parent         Pointer to the parent object.
          */
-        ResourcePlotter(Resources* resources, QObject* parent = nullptr);
+        ResourcePlotter(Resources* resources, PlotWorkerPool* plotWorkerPool, QObject* parent = nullptr);
 
         ~ResourcePlotter() override;
 
@@ -153,106 +155,200 @@ class ResourcePlotter:public PlotterBase {
          */
         PlotMailbox& mailbox(unsigned threadId);
 
-    signals:
+    private:
         /**
-         * Signal that is emitted to request a plot showing resource over time.
-         *
-         * \param[out] threadId       The zero based ID of the thread requesting this plot.
-         *
-         * \param[out] customerId     The customer ID of the customer tied to the plot.
-         *
-         * \param[out] valueType      The value type for the data to be plotted.
-         *
-         * \param[out] startTimestamp The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
-         *                            start timestamp.
-         *
-         * \param[out] endTimestamp   The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
-         *                            start timestamp.
-         *
-         * \param[in] scaleFactor     A vertical scale factor to apply to presented values.
-         *
-         * \param[out] titleText      The chart title text.
-         *
-         * \param[out] xAxisTitle     The title to apply to the X axis.
-         *
-         * \param[out] yAxisTitle     The title to apply to the Y axis.
-         *
-         * \param[out] dateFormat     The date format string.
-         *
-         * \param[in] titleFont       The font to use for the title.  An invalid font will cause the default font to be
-         *                            used.
-         *
-         * \param[in] axisTitleFont   The font to use for the axis titles.  An invalid font will cause the default font
-         *                            to be used.
-         *
-         * \param[in] axisLabelFont   The font to use for the axis labels.  An invalid font will cause the default font
-         *                            to be used.
-         *
-         * \param[out] width          The plot width, in pixels.
-         *
-         * \param[out] height         The plot height, in pixels.
-         *
-         * \return Returns a reference to the mailbox to receive the image.
+         * Job used to render a plot showing resource over time from a plot worker thread.
          */
-        void issueRequestPlot(
-            unsigned           threadId,
-            unsigned long      customerId,
-            unsigned           valueType,
-            unsigned long long startTimestamp,
-            unsigned long long endTimestamp,
-            float              scaleFactor,
-            const QString&     titleText,
-            const QString&     xAxisTitle,
-            const QString&     yAxisTitle,
-            const QString&     dateFormatString,
-            const QString&     titleFont,
-            const QString&     axisTitleFont,
-            const QString&     axisLabelFont,
-            unsigned           width = defaultWidth,
-            unsigned           height = defaultHeight
-        );
+        class PlotJob:public PlotWorkerPool::Job {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] plotter          The plotter used to render the image.
+                 *
+                 * \param[in] mailbox          The mailbox to receive the image.
+                 *
+                 * \param[in] threadId         The zero based ID of the thread requesting this plot.
+                 *
+                 * \param[in] customerId       The customer ID of the customer tied to the plot.
+                 *
+                 * \param[in] valueType        The value type for the data to be plotted.
+                 *
+                 * \param[in] startTimestamp   The Unix timestamp to start the plot at.
+                 *
+                 * \param[in] endTimestamp     The Unix timestamp to end the plot at.
+                 *
+                 * \param[in] scaleFactor      A vertical scale factor to apply to presented values.
+                 *
+                 * \param[in] titleText        The chart title text.
+                 *
+                 * \param[in] xAxisTitle       The title to apply to the X axis.
+                 *
+                 * \param[in] yAxisTitle       The title to apply to the Y axis.
+                 *
+                 * \param[in] dateFormatString The date format string.
+                 *
+                 * \param[in] titleFont        The font to use for the title.
+                 *
+                 * \param[in] axisTitleFont    The font to use for the axis titles.
+                 *
+                 * \param[in] axisLabelFont    The font to use for the axis labels.
+                 *
+                 * \param[in] width            The plot width, in pixels.
+                 *
+                 * \param[in] height           The plot height, in pixels.
+                 */
+                PlotJob(
+                    ResourcePlotter*   plotter,
+                    PlotMailbox*       mailbox,
+                    ThreadId           threadId,
+                    CustomerId         customerId,
+                    ValueType          valueType,
+                    unsigned long long startTimestamp,
+                    unsigned long long endTimestamp,
+                    float              scaleFactor,
+                    const QString&     titleText,
+                    const QString&     xAxisTitle,
+                    const QString&     yAxisTitle,
+                    const QString&     dateFormatString,
+                    const QString&     titleFont,
+                    const QString&     axisTitleFont,
+                    const QString&     axisLabelFont,
+                    unsigned           width,
+                    unsigned           height
+                );
+
+                ~PlotJob() override;
+
+                /**
+                 * Method that is called from a worker thread to render the plot.
+                 *
+                 * \param[in] databaseThreadId The database thread ID reserved for the calling worker.
+                 */
+                void run(unsigned databaseThreadId) override;
+
+            private:
+                /**
+                 * The plotter used to render the image.
+                 */
+                ResourcePlotter* currentPlotter;
+
+                /**
+                 * The ID of the thread requesting this plot.
+                 */
+                ThreadId currentThreadId;
+
+                /**
+                 * The customer ID of the customer tied to the plot.
+                 */
+                CustomerId currentCustomerId;
+
+                /**
+                 * The value type for the data to be plotted.
+                 */
+                ValueType currentValueType;
+
+                /**
+                 * The Unix timestamp to start the plot at.
+                 */
+                unsigned long long currentStartTimestamp;
+
+                /**
+                 * The Unix timestamp to end the plot at.
+                 */
+                unsigned long long currentEndTimestamp;
+
+                /**
+                 * A vertical scale factor to apply to presented values.
+                 */
+                float currentScaleFactor;
+
+                /**
+                 * The chart title text.
+                 */
+                QString currentTitleText;
+
+                /**
+                 * The title to apply to the X axis.
+                 */
+                QString currentXAxisTitle;
+
+                /**
+                 * The title to apply to the Y axis.
+                 */
+                QString currentYAxisTitle;
+
+                /**
+                 * The date format string.
+                 */
+                QString currentDateFormatString;
+
+                /**
+                 * The font to use for the title.
+                 */
+                QString currentTitleFont;
+
+                /**
+                 * The font to use for the axis titles.
+                 */
+                QString currentAxisTitleFont;
+
+                /**
+                 * The font to use for the axis labels.
+                 */
+                QString currentAxisLabelFont;
+
+                /**
+                 * The plot width, in pixels.
+                 */
+                unsigned currentWidth;
+
+                /**
+                 * The plot height, in pixels.
+                 */
+                unsigned currentHeight;
+        };
 
-    private slots:
         /**
-         * Slot that is triggered to generate a plot showing resource over time.
+         * Method that generates a plot showing resource over time.  This method is called from a plot worker thread.
          *
-         * \param[in] threadId       The zero based ID of the thread requesting this plot.
+         * \param[in] threadId         The zero based ID of the thread requesting this plot.
          *
-         * \param[in] customerId     The customer ID of the customer tied to the plot.  An invalid customer ID
-         *                           indicates all customers.
+         * \param[in] customerId       The customer ID of the customer tied to the plot.  An invalid customer ID
+         *                             indicates all customers.
          *
-         * \param[in] valueType      The value type for the data to be plotted.
+         * \param[in] valueType        The value type for the data to be plotted.
          *
-         * \param[in] startTimestamp The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
-         *                           start timestamp.
+         * \param[in] startTimestamp   The Unix timestamp to limit the plot to.  A start timestamp of 0 indicates no
+         *                             start timestamp.
          *
-         * \param[in] endTimestamp   The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
-         *                           start timestamp.
+         * \param[in] endTimestamp     The Unix timestamp to limit the plot to.  An end timestamp of 0 indicates no
+         *                             start timestamp.
          *
-         * \param[in] scaleFactor    A vertical scale factor to apply to presented values.
+         * \param[in] scaleFactor      A vertical scale factor to apply to presented values.
          *
-         * \param[in] titleText      The chart title text.
+         * \param[in] titleText        The chart title text.
          *
-         * \param[in] xAxisTitle     The title to apply to the X axis.
+         * \param[in] xAxisTitle       The title to apply to the X axis.
          *
-         * \param[in] yAxisTitle     The title to apply to the Y axis.
+         * \param[in] yAxisTitle       The title to apply to the Y axis.
          *
-         * \param[in] dateFormat     The date format string.
+         * \param[in] dateFormat       The date format string.
          *
-         * \param[in] titleFont      The font to use for the title.  An invalid font will cause the default font to be
-         *                           used.
+         * \param[in] titleFont        The font to use for the title.  An invalid font will cause the default font to be
+         *                             used.
          *
-         * \param[in] axisTitleFont  The font to use for the axis titles.  An invalid font will cause the default font
-         *                           to be used.
+         * \param[in] axisTitleFont    The font to use for the axis titles.  An invalid font will cause the default font
+         *                             to be used.
          *
-         * \param[in] axisLabelFont  The font to use for the axis labels.  An invalid font will cause the default font
-         *                           to be used.
+         * \param[in] axisLabelFont    The font to use for the axis labels.  An invalid font will cause the default font
+         *                             to be used.
          *
-         * \param[in] width          The plot width, in pixels.
+         * \param[in] width            The plot width, in pixels.
          *
-         * \param[in] height         The plot height, in pixels.
+         * \param[in] height           The plot height, in pixels.
          *
-         * \return Returns a reference to the mailbox to receive the image.
+         * \param[in] databaseThreadId The database thread ID reserved for the calling plot worker.
          */
         void generatePlot(
             unsigned           threadId,
@@ -268,11 +364,11 @@ class ResourcePlotter:public PlotterBase {
             const QString&     titleFont,
             const QString&     axisTitleFont,
             const QString&     axisLabelFont,
-            unsigned           width = defaultWidth,
-            unsigned           height = defaultHeight
+            unsigned           width,
+            unsigned           height,
+            unsigned           databaseThreadId
         );
 
-    private:
         /**
          * The resource interface manager used to fetch resource data.
          */
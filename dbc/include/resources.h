@@ -28,17 +28,24 @@
 #include <QString>
 #include <QByteArray>
 #include <QList>
+#include <QHash>
+#include <QPair>
+#include <QAtomicInt>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
 
 #include <cstdint>
 
 #include "resource.h"
 #include "active_resources.h"
-#include "cache.h"
+#include "concurrent_cache.h"
 #include "sql_helpers.h"
+#include "metrics_registry.h"
+#include "periodic_scheduler.h"
 
 class QSqlQuery;
-class QTimer;
+class QSqlDatabase;
 class DatabaseManager;
 
 /**
@@ -55,8 +62,61 @@ class DatabaseManager;
  *             FOREIGN KEY (customer_id) REFERENCES customer_capabilities(customer_id)
  *             ON DELETE_CASCADE
  *     ) ENGINE=InnoDB DEFAULT CHARSET=latin1
+ *
+ * Resource entries can either be written immediately using \ref Resources::recordResource or queued using
+ * \ref Resources::queueResources.  Queued entries are written in bulk by a background flush thread.
+ *
+ * The value types held for each customer, along with the first and last timestamps for each, are tracked in the
+ * table below so lookups never scan the resources table.  The table is updated as entries are written and trimmed as
+ * entries are expunged.  The first timestamp is a lower bound once older entries are expunged.
+ *
+ *     CREATE TABLE resource_summary (
+ *         customer_id     BIGINT   NOT NULL,
+ *         value_type      SMALLINT NOT NULL,
+ *         first_timestamp BIGINT   NOT NULL,
+ *         last_timestamp  BIGINT   NOT NULL,
+ *         PRIMARY KEY(customer_id, value_type),
+ *         CONSTRAINT resource_summary_customer_id_fk_constraint
+ *             FOREIGN KEY (customer_id) REFERENCES customer_capabilities(customer_id)
+ *             ON DELETE CASCADE
+ *     )
+ *
+ * Existing data can be summarized with:
+ *
+ *     INSERT INTO resource_summary
+ *         SELECT customer_id, value_type, MIN(timestamp1::BIGINT * 3600 + timestamp2),
+ *                MAX(timestamp1::BIGINT * 3600 + timestamp2)
+ *         FROM resources GROUP BY customer_id, value_type
+ *
+ * Resource data can also be aggregated into a chain of coarser tiers, finest first.  Each tier is fed from the next
+ * finer tier, or from the resources table for the first tier, and is held in a table of the form:
+ *
+ *     CREATE TABLE resources_hourly (
+ *         customer_id     BIGINT           NOT NULL,
+ *         value_type      SMALLINT         NOT NULL,
+ *         start_timestamp BIGINT           NOT NULL,
+ *         mean_value      DOUBLE PRECISION NOT NULL,
+ *         minimum_value   REAL             NOT NULL,
+ *         maximum_value   REAL             NOT NULL,
+ *         number_samples  INTEGER          NOT NULL,
+ *         PRIMARY KEY(customer_id, value_type, start_timestamp),
+ *         CONSTRAINT resources_hourly_customer_id_fk_constraint
+ *             FOREIGN KEY (customer_id) REFERENCES customer_capabilities(customer_id)
+ *             ON DELETE CASCADE
+ *     ) PARTITION BY RANGE (start_timestamp)
+ *
+ * The progress of each tier is tracked in the table:
+ *
+ *     CREATE TABLE resources_aggregation_watermark (
+ *         output_table   TEXT   NOT NULL PRIMARY KEY,
+ *         time_threshold BIGINT NOT NULL
+ *     )
+ *
+ * The resources table may be range partitioned on timestamp1 and tier tables may be range partitioned on
+ * start_timestamp.  Partitions are created ahead of the entries written to them and expired partitions are dropped
+ * whole.  Partitioned tables should include a default partition to receive late entries.
  */
-class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources, Resource::CustomerId> {
+class Resources:public QThread, private SqlHelpers, public ConcurrentCache<ActiveResources, Resource::CustomerId> {
     Q_OBJECT
 
     public:
@@ -80,6 +140,39 @@ class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources
          */
         typedef QList<Resource> ResourceList;
 
+        /**
+         * Trivial class used to describe a coarser aggregation tier fed from the next finer tier.
+         */
+        class AggregationTier {
+            public:
+                /**
+                 * The name of the table holding this tier.
+                 */
+                QString tableName;
+
+                /**
+                 * The resample period for this tier, in seconds.  The value should be a multiple of the next finer
+                 * tier's resample period.
+                 */
+                unsigned long resamplePeriod;
+
+                /**
+                 * The age at which entries in this tier are expunged, in seconds.
+                 */
+                unsigned long expungeAge;
+        };
+
+        /**
+         * Type used to represent a chain of aggregation tiers, finest first.
+         */
+        typedef QList<AggregationTier> AggregationTierList;
+
+        /**
+         * Type used to hold the partition period, in seconds, of each time-range partitioned table, keyed by table
+         * name.
+         */
+        typedef QHash<QString, unsigned long> PartitionPeriods;
+
         /**
          * Constructor
          *
@@ -129,17 +222,67 @@ class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources
         );
 
         /**
-         * Method you can use to obtain resources for a given customer and type.
+         * Value indicating the default number of queued entries that will trigger a flush.
+         */
+        static constexpr unsigned long defaultFlushMaximumEntries = 10000;
+
+        /**
+         * Value indicating the default maximum age of the oldest queued entry, in seconds.
+         */
+        static constexpr unsigned long defaultFlushMaximumAge = 5;
+
+        /**
+         * Value indicating the maximum number of queued entries.  Entries beyond this depth are rejected.
+         */
+        static constexpr unsigned long maximumQueueDepth = 1000000;
+
+        /**
+         * Method you can use to queue resource data to be written by the flush thread.  Entries are written in the
+         * order they are queued.  Duplicate entries for the same customer, value type and timestamp are discarded
+         * when written.
+         *
+         * \param[in] resources The resource entries to be queued.
+         *
+         * \return Returns true if the entries were queued.  Returns false if the queue is full.  No entries are queued
+         *         on error.
+         */
+        bool queueResources(const ResourceList& resources);
+
+        /**
+         * Method you can use to set the thresholds that trigger a flush of queued entries.
+         *
+         * \param[in] maximumEntries The number of queued entries that will trigger a flush.  A value of zero selects
+         *                           the default.
+         *
+         * \param[in] maximumAge     The maximum age of the oldest queued entry, in seconds.  A value of zero selects
+         *                           the default.
+         */
+        void setFlushThresholds(unsigned long maximumEntries, unsigned long maximumAge);
+
+        /**
+         * Method you can use to determine the number of entries waiting to be written.
+         *
+         * \return Returns the number of queued entries.
+         */
+        unsigned long numberQueuedEntries();
+
+        /**
+         * Method you can use to obtain resources for a given customer and type.  Requests spanning a long time range
+         * are served from the finest aggregation tier that holds the range in roughly \ref targetNumberPoints entries
+         * or fewer.  Aggregated entries report the mean value for each period, timestamped at the start of the period.
          *
          * \param[in] customerId     The ID of the customer.
          *
          * \param[in] valueType      The type for the value to be stored.
          *
          * \param[in] startTimestamp The optional starting timestamp for the request.  A value of 0 indicates no
-         *                           starting timestamp.
+         *                           starting timestamp.  Requests with no starting timestamp are always served from
+         *                           the resources table.
          *
          * \param[in] endTimestamp   The optional ending timestamp for the request.  A value of 0 indicates no ending
          *                           timestamp.
+         *
+         * \param[in] threadId       An optional thread ID used to maintain independent per-thread database instances.
          */
         ResourceList getResources(
             CustomerId         customerId,
@@ -167,6 +310,28 @@ class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources
          */
         void setMaximumAge(unsigned long newMaximumAge);
 
+        /**
+         * Method you can use to set the chain of aggregation tiers.  Tiers are aggregated in the background at the
+         * shortest tier resample period.
+         *
+         * \param[in] aggregationTiers The aggregation tiers, finest first.  An empty list disables aggregation.
+         */
+        void setAggregationTiers(const AggregationTierList& aggregationTiers);
+
+        /**
+         * Method you can use to set the partition periods of time-range partitioned tables.  The period for the
+         * resources table must be a multiple of one hour.
+         *
+         * \param[in] partitionPeriods The partition period of each partitioned table.  Tables that are not listed
+         *                             are not extended with new partitions.
+         */
+        void setPartitionPeriods(const PartitionPeriods& partitionPeriods);
+
+        /**
+         * Value indicating the number of entries a request should return when it is served from an aggregation tier.
+         */
+        static constexpr unsigned long targetNumberPoints = 2000;
+
     protected:
         /**
          * Method that obtains the ID used to access a specific value.
@@ -188,16 +353,103 @@ class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources
          */
         void startExpunge();
 
+        /**
+         * Slot that starts the aggregation and partition maintenance operation.
+         */
+        void startAggregation();
+
     private:
+        /**
+         * Class used to write queued resource entries from a dedicated thread.
+         */
+        class Flusher:public QThread {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] owner The resources instance that owns this flusher.
+                 */
+                Flusher(Resources* owner);
+
+                ~Flusher() override;
+
+            protected:
+                /**
+                 * Method that runs this thread.
+                 */
+                void run() override;
+
+            private:
+                /**
+                 * The resources instance that owns this flusher.
+                 */
+                Resources* currentOwner;
+        };
+
         /**
          * Value indicating the maximum resources cache size.
          */
         static const unsigned maximumCacheDepth = 10000;
 
         /**
-         * Value indicating the expunge timer check interval in milliseconds.
+         * Value indicating the default expunge interval, in seconds.
+         */
+        static const unsigned long expungePeriod = 60 * 60 * 24;
+
+        /**
+         * Value indicating the default random delay, in seconds, added to each expunge interval.
+         */
+        static const unsigned long expungeJitter = 600;
+
+        /**
+         * Value indicating the longest interval between aggregation and partition maintenance runs, in seconds.
+         */
+        static const unsigned long maximumAggregationPeriod = 3600;
+
+        /**
+         * Value indicating the number of partition periods to create ahead of the current time.
+         */
+        static const unsigned long partitionsAhead = 4;
+
+        /**
+         * The name of the table holding the aggregation watermarks.
          */
-        static const unsigned expungeTimerPeriod = 1000 * 60 * 60 * 24;
+        static const QString watermarkTableName;
+
+        /**
+         * The name of the raw resources table.
+         */
+        static const QString resourcesTableName;
+
+        /**
+         * The name of the table summarizing the value types held for each customer.
+         */
+        static const QString summaryTableName;
+
+        /**
+         * The name of the scheduled expunge task.
+         */
+        static const QString expungeTaskName;
+
+        /**
+         * The name of the scheduled aggregation and partition maintenance task.
+         */
+        static const QString aggregationTaskName;
+
+        /**
+         * Type used to identify one customer's value type in the summary table.
+         */
+        typedef QPair<CustomerId, ValueType> SummaryKey;
+
+        /**
+         * Type used to hold the first and last Unix timestamps of a summary table entry.
+         */
+        typedef QPair<unsigned long long, unsigned long long> SummaryRange;
+
+        /**
+         * Type used to hold a collection of summary ranges.
+         */
+        typedef QHash<SummaryKey, SummaryRange> SummaryRanges;
 
         /**
          * The thread ID to use when expunging old entries.
@@ -205,14 +457,129 @@ class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources
         static const unsigned expungeThreadId = static_cast<unsigned>(-4);
 
         /**
-         * The underlying database manager instance.
+         * The thread ID to use when writing queued entries.
          */
-        DatabaseManager* currentDatabaseManager;
+        static const unsigned flushThreadId = static_cast<unsigned>(-7);
+
+        /**
+         * The maximum number of rows written by a single INSERT statement.
+         */
+        static const unsigned maximumRowsPerStatement = 1000;
 
         /**
-         * Mutex used to protect the cache.
+         * Method you can use to determine if a flush is due.  The queue mutex must be locked.
+         *
+         * \param[out] waitMilliseconds The time to wait before the next flush is due, in milliseconds.  The value is
+         *                              only set if no flush is due.
+         *
+         * \return Returns true if a flush is due.  Returns false if no flush is due.
+         */
+        bool flushDue(unsigned long& waitMilliseconds) const;
+
+        /**
+         * Method that writes a collection of resource entries to the database using multi-row inserts.
+         *
+         * \param[in] resources The resource entries to be written.
+         *
+         * \return Returns true on success.  Returns false on error.
          */
-        QMutex cacheMutex;
+        bool writeResources(const ResourceList& resources);
+
+        /**
+         * Method that updates the summary table and the active resources cache for newly written entries.
+         *
+         * \param[in] query     The query used to update the summary table.
+         *
+         * \param[in] resources The newly written entries.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool updateSummary(QSqlQuery& query, const ResourceList& resources);
+
+        /**
+         * Method that trims the summary table after entries older than a threshold are removed.  Customers losing a
+         * value type are evicted from the active resources cache.
+         *
+         * \param[in] query      The query used to update the summary table.
+         *
+         * \param[in] customerId The customer whose entries were removed.  An invalid customer ID indicates all
+         *                       customers.
+         *
+         * \param[in] timestamp  The Unix timestamp of the oldest remaining entry.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool trimSummary(QSqlQuery& query, CustomerId customerId, unsigned long long timestamp);
+
+        /**
+         * Method that selects the table used to serve a request.
+         *
+         * \param[in] startTimestamp The starting timestamp for the request.
+         *
+         * \param[in] endTimestamp   The ending timestamp for the request.  A value of 0 indicates no ending timestamp.
+         *
+         * \return Returns the name of the table to be used.
+         */
+        QString tableForRange(unsigned long long startTimestamp, unsigned long long endTimestamp);
+
+        /**
+         * Method that starts or stops the expunge and aggregation tasks to match the current settings.
+         */
+        void updateSchedule();
+
+        /**
+         * Method that creates partitions ahead of the current time.
+         *
+         * \param[in,out] database         The database instance to be used.
+         *
+         * \param[in]     aggregationTiers The current aggregation tiers.
+         *
+         * \param[in]     partitionPeriods The current partition periods.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool createPartitions(
+            QSqlDatabase&              database,
+            const AggregationTierList& aggregationTiers,
+            const PartitionPeriods&    partitionPeriods
+        );
+
+        /**
+         * Method that aggregates every completed period not yet held by an aggregation tier.
+         *
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     tier           The aggregation tier to be updated.
+         *
+         * \param[in]     inputTableName The name of the table feeding this tier.
+         *
+         * \param[in,out] inputThreshold On entry, the Unix timestamp up to which the input table is complete.  On
+         *                               exit, the Unix timestamp up to which this tier is complete.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool aggregateTier(
+            QSqlDatabase&          database,
+            const AggregationTier& tier,
+            const QString&         inputTableName,
+            unsigned long long&    inputThreshold
+        );
+
+        /**
+         * Method that expunges expired entries from the resources table and each aggregation tier.
+         *
+         * \param[in,out] database         The database instance to be used.
+         *
+         * \param[in]     aggregationTiers The current aggregation tiers.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool expungeEntries(QSqlDatabase& database, const AggregationTierList& aggregationTiers);
+
+        /**
+         * The underlying database manager instance.
+         */
+        DatabaseManager* currentDatabaseManager;
 
         /**
          * The maximum age for resource entries.
@@ -220,9 +587,89 @@ class Resources:public QThread, private SqlHelpers, public Cache<ActiveResources
         unsigned long currentMaximumResourceDataAge;
 
         /**
-         * Timer used to trigger the expunge thread at periodic intervals.
+         * The scheduled task used to trigger the expunge operation.
+         */
+        PeriodicScheduler::TaskId expungeTaskId;
+
+        /**
+         * The scheduled task used to trigger aggregation and partition maintenance.
+         */
+        PeriodicScheduler::TaskId aggregationTaskId;
+
+        /**
+         * Flag indicating that the next background run should expunge old entries.
+         */
+        QAtomicInt expungePending;
+
+        /**
+         * Mutex used to protect the aggregation tiers and partition periods.
+         */
+        QMutex tiersMutex;
+
+        /**
+         * The current aggregation tiers, finest first.
+         */
+        AggregationTierList currentAggregationTiers;
+
+        /**
+         * The current partition periods.
+         */
+        PartitionPeriods currentPartitionPeriods;
+
+        /**
+         * Mutex used to protect the queue of pending entries.
+         */
+        QMutex queueMutex;
+
+        /**
+         * Wait condition used to wake the flush thread.
+         */
+        QWaitCondition queueCondition;
+
+        /**
+         * The entries waiting to be written.
+         */
+        ResourceList queuedResources;
+
+        /**
+         * Timer used to measure the age of queued entries.
+         */
+        QElapsedTimer queueClock;
+
+        /**
+         * The queue clock time when the oldest queued entry was received, in milliseconds.
+         */
+        qint64 oldestQueuedMilliseconds;
+
+        /**
+         * The number of queued entries that will trigger a flush.
+         */
+        unsigned long currentFlushMaximumEntries;
+
+        /**
+         * The maximum age of the oldest queued entry, in milliseconds.
+         */
+        unsigned long currentFlushMaximumAgeMilliseconds;
+
+        /**
+         * Flag indicating that the flush thread should exit.
+         */
+        bool flushStopRequested;
+
+        /**
+         * Counter tracking the number of queued entries written to the database.
+         */
+        MetricsRegistry::Counter* flushedEntriesMetric;
+
+        /**
+         * Counter tracking the number of entries rejected because the queue was full.
+         */
+        MetricsRegistry::Counter* rejectedEntriesMetric;
+
+        /**
+         * The flush thread.
          */
-        QTimer* expungeTimer;
+        Flusher* flusher;
 };
 
 #endif
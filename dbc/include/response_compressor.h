@@ -0,0 +1,160 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref ResponseCompressor class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef RESPONSE_COMPRESSOR_H
+#define RESPONSE_COMPRESSOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QAtomicInteger>
+
+#include <cstdint>
+
+/**
+ * Class that compresses large REST responses for clients that ask for it.  The inbound REST server does not expose
+ * request headers to handlers so clients list the encodings they accept, using HTTP "Accept-Encoding" syntax, in an
+ * "accept_encoding" request field.  Compressed responses are returned with a content type of "application/gzip" or
+ * "application/zlib" so the client knows to inflate the body.
+ *
+ * Compression runs on the calling handler's worker thread.  This class is thread safe.
+ */
+class ResponseCompressor {
+    public:
+        /**
+         * Enumeration of supported encodings.
+         */
+        enum class Encoding {
+            /**
+             * Indicates no compression.
+             */
+            IDENTITY,
+
+            /**
+             * Indicates the zlib format of RFC 1950, the HTTP "deflate" encoding.
+             */
+            DEFLATE,
+
+            /**
+             * Indicates the gzip format of RFC 1952.
+             */
+            GZIP
+        };
+
+        /**
+         * The default smallest response, in bytes, that will be compressed.
+         */
+        static constexpr unsigned long defaultMinimumSize = 8192;
+
+        /**
+         * The default zlib compression level.
+         */
+        static constexpr int defaultCompressionLevel = 6;
+
+        /**
+         * Constructor
+         */
+        ResponseCompressor();
+
+        ~ResponseCompressor();
+
+        /**
+         * Method you can use to set the smallest response that will be compressed.
+         *
+         * \param[in] newMinimumSize The new minimum size, in bytes.  A value of 0 disables compression.
+         */
+        void setMinimumSize(unsigned long newMinimumSize);
+
+        /**
+         * Method you can use to obtain the smallest response that will be compressed.
+         *
+         * \return Returns the minimum size, in bytes.  A value of 0 indicates compression is disabled.
+         */
+        unsigned long minimumSize() const;
+
+        /**
+         * Method you can use to set the zlib compression level.
+         *
+         * \param[in] newCompressionLevel The new compression level, 1 through 9.
+         */
+        void setCompressionLevel(int newCompressionLevel);
+
+        /**
+         * Method you can use to obtain the zlib compression level.
+         *
+         * \return Returns the compression level.
+         */
+        int compressionLevel() const;
+
+        /**
+         * Method that selects the preferred supported encoding from an "Accept-Encoding" style list.  gzip is
+         * preferred over deflate when both are accepted with the same quality.
+         *
+         * \param[in] acceptEncoding The list of accepted encodings.
+         *
+         * \return Returns the selected encoding.
+         */
+        static Encoding selectEncoding(const QString& acceptEncoding);
+
+        /**
+         * Method that compresses a response if it is large enough and the client accepts a supported encoding.
+         *
+         * \param[in]     encoding    The encoding to apply.
+         *
+         * \param[in,out] contentType The content type of the response.  The value is updated if the response is
+         *                            compressed.
+         *
+         * \param[in]     data        The response data.
+         *
+         * \return Returns the data to send, compressed or not.
+         */
+        QByteArray compress(Encoding encoding, QByteArray& contentType, const QByteArray& data) const;
+
+    private:
+        /**
+         * Method that calculates the CRC-32 of a block of data, as required by the gzip trailer.
+         *
+         * \param[in] data The data to calculate the CRC for.
+         *
+         * \return Returns the calculated CRC.
+         */
+        static std::uint32_t crc32(const QByteArray& data);
+
+        /**
+         * Method that builds the table used by \ref ResponseCompressor::crc32.
+         *
+         * \return Returns the 256 entry CRC-32 table.
+         */
+        static QVector<std::uint32_t> buildCrc32Table();
+
+        /**
+         * The current minimum size.
+         */
+        QAtomicInteger<unsigned long> currentMinimumSize;
+
+        /**
+         * The current compression level.
+         */
+        QAtomicInteger<int> currentCompressionLevel;
+};
+
+#endif
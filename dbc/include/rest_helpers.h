@@ -30,6 +30,9 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
 
 #include "host_scheme.h"
 #include "host_schemes.h"
@@ -42,16 +45,24 @@
 #include "events.h"
 #include "latency_entry.h"
 #include "aggregated_latency_entry.h"
+#include "latency_rolling_statistics.h"
 #include "latency_interface_manager.h"
 #include "monitor_updater.h"
 #include "resource.h"
 #include "resources.h"
+#include "json_stream_writer.h"
+#include "metrics_registry.h"
 
 /**
  * Class that provides a handful of helper method to parse REST requests and generate responses.
  */
 class RestHelpers {
     public:
+        /**
+         * The content type reported for responses in the binary latency export format.
+         */
+        static const QByteArray binaryLatencyContentType;
+
         /**
          * Method used to convert a host/scheme to a JSON object.
          *
@@ -234,6 +245,70 @@ class RestHelpers {
          */
         static QJsonArray convertToJson(const Events::EventList& event, bool includeCustomerId, bool includeHash);
 
+        /**
+         * Method that converts monitor status values to JSON.
+         *
+         * \param[in] monitorStatus The monitor status values, by monitor ID.
+         *
+         * \return Returns a QJsonObject instance mapping each monitor ID to its status.
+         */
+        static QJsonObject convertToJson(const Events::MonitorStatusByMonitorId& monitorStatus);
+
+        /**
+         * Method that encodes an event listing cursor for a REST response.
+         *
+         * \param[in] cursor The cursor to be encoded.
+         *
+         * \return Returns the encoded cursor.
+         */
+        static QString convertToString(const Events::Cursor& cursor);
+
+        /**
+         * Method that decodes an event listing cursor supplied in a REST request.
+         *
+         * \param[in]  cursorString The encoded cursor.
+         *
+         * \param[out] ok           A pointer to a boolean value that can optionally be populated with true on
+         *                          success or false if the cursor is malformed.
+         *
+         * \return Returns the decoded cursor.  An invalid cursor is returned if the string is malformed.
+         */
+        static Events::Cursor convertToCursor(const QString& cursorString, bool* ok = nullptr);
+
+        /**
+         * Method that obtains the cursor following a page of events.
+         *
+         * \param[in] events   The events returned for the page.
+         *
+         * \param[in] pageSize The requested page size.
+         *
+         * \return Returns the cursor for the next page.  An invalid cursor is returned if the page was the last.
+         */
+        static Events::Cursor nextCursor(const Events::EventList& events, unsigned long pageSize);
+
+        /**
+         * Method that writes a list of events, as a JSON array, into a streamed response.
+         *
+         * \param[in,out] writer            The writer receiving the array.
+         *
+         * \param[in]     key               The key to place the array under.
+         *
+         * \param[in]     events            The event list to be converted.
+         *
+         * \param[in]     includeCustomerId If true, the customer ID will be included in the response.  If false, the
+         *                                  customer ID will be excluded from the response.
+         *
+         * \param[in]     includeHash       If true, the event hash will be included.  If false, the event hash will
+         *                                  be excluded.
+         */
+        static void writeJson(
+            JsonStreamWriter&        writer,
+            const QString&           key,
+            const Events::EventList& events,
+            bool                     includeCustomerId,
+            bool                     includeHash
+        );
+
         /**
          * Method that converts a latency entry to a JSON response.
          *
@@ -350,6 +425,156 @@ class RestHelpers {
             bool                                                       includeCustomerId
         );
 
+        /**
+         * Method that converts rolling latency statistics to a JSON response.  Latency values are reported in seconds.
+         *
+         * \param[in] summary The rolling statistics to be converted.
+         *
+         * \return Returns a QJsonObject instance holding the response.
+         */
+        static QJsonObject convertToJson(const LatencyRollingStatistics::Summary& summary);
+
+        /**
+         * Method that writes a list of latency entries, as a JSON array, into a streamed response.  Entries are
+         * converted one at a time so the full array never exists in memory.
+         *
+         * \param[in,out] writer            The writer receiving the array.
+         *
+         * \param[in]     key               The key to place the array under.
+         *
+         * \param[in]     entries           The entries to be converted.
+         *
+         * \param[in]     serversById       A hash of server instances by server ID.
+         *
+         * \param[in]     monitorsById      A hash of monitor instances by monitor ID.
+         *
+         * \param[in]     includeServerId   If true, the server ID will be included in the response.
+         *
+         * \param[in]     includeRegionId   If true, the region ID will be included in the response.
+         *
+         * \param[in]     includeCustomerId If true, the customer ID will be included in the response.
+         */
+        static void writeJson(
+            JsonStreamWriter&                                writer,
+            const QString&                                   key,
+            const LatencyInterfaceManager::LatencyEntryList& entries,
+            const Servers::ServersById&                      serversById,
+            const Monitors::MonitorsById&                    monitorsById,
+            bool                                             includeServerId,
+            bool                                             includeRegionId,
+            bool                                             includeCustomerId
+        );
+
+        /**
+         * Method that writes a list of aggregated latency entries, as a JSON array, into a streamed response.
+         * Entries are converted one at a time so the full array never exists in memory.
+         *
+         * \param[in,out] writer            The writer receiving the array.
+         *
+         * \param[in]     key               The key to place the array under.
+         *
+         * \param[in]     entries           The entries to be converted.
+         *
+         * \param[in]     serversById       A hash of server instances by server ID.
+         *
+         * \param[in]     monitorsById      A hash of monitor instances by monitor ID.
+         *
+         * \param[in]     includeServerId   If true, the server ID will be included in the response.
+         *
+         * \param[in]     includeRegionId   If true, the region ID will be included in the response.
+         *
+         * \param[in]     includeCustomerId If true, the customer ID will be included in the response.
+         */
+        static void writeJson(
+            JsonStreamWriter&                                          writer,
+            const QString&                                             key,
+            const LatencyInterfaceManager::AggregatedLatencyEntryList& entries,
+            const Servers::ServersById&                                serversById,
+            const Monitors::MonitorsById&                              monitorsById,
+            bool                                                       includeServerId,
+            bool                                                       includeRegionId,
+            bool                                                       includeCustomerId
+        );
+
+        /**
+         * Method that estimates the size of the JSON produced by \ref RestHelpers::writeJson for a latency listing
+         * so the streamed response can be reserved once rather than grown repeatedly.
+         *
+         * \param[in] rawEntries        The raw entries to be written.
+         *
+         * \param[in] aggregatedEntries The aggregated entries to be written.
+         *
+         * \return Returns the number of bytes to reserve.
+         */
+        static int estimatedJsonSize(
+            const LatencyInterfaceManager::LatencyEntryList&           rawEntries,
+            const LatencyInterfaceManager::AggregatedLatencyEntryList& aggregatedEntries
+        );
+
+        /**
+         * Method that converts raw and aggregated latency entries to the compact binary export format.  The format is
+         * intended for bulk consumers that would otherwise spend most of their time parsing JSON.  All multi-byte
+         * values are little endian.  "varint" values are unsigned LEB128 and "zigzag" values are signed values
+         * zigzag encoded into a varint.  The layout is:
+         *
+         *     magic                 4 bytes, "SSLB"
+         *     version               uint8, currently 1
+         *     flags                 uint8, bit 0 = server IDs, bit 1 = region IDs, bit 2 = customer IDs
+         *     zoran epoch           uint64, Unix timestamp of Zoran time 0
+         *     region dictionary     varint count followed by count varint region IDs (present if bit 1 is set)
+         *     customer dictionary   varint count followed by count varint customer IDs (present if bit 2 is set)
+         *     raw section           varint entry count followed by the base columns
+         *     aggregated section    varint entry count followed by the base columns and the aggregated columns
+         *
+         * Each section is columnar, every column holding one value per entry, in this order:
+         *
+         *     monitor ID            varint
+         *     server ID             varint (present if bit 0 is set)
+         *     region index          varint index into the region dictionary (present if bit 1 is set)
+         *     customer index        varint index into the customer dictionary (present if bit 2 is set)
+         *     timestamp             zigzag, Zoran time minus the previous entry's Zoran time (the first entry is
+         *                           relative to 0)
+         *     latency               varint, microseconds
+         *
+         * The aggregated section then adds:
+         *
+         *     start timestamp       zigzag, Zoran start time minus the entry's timestamp
+         *     end timestamp         varint, Zoran end time minus the entry's start time
+         *     average               float64, microseconds
+         *     variance              float64, microseconds squared
+         *     minimum               varint, microseconds
+         *     maximum               varint, microseconds
+         *     number samples        varint
+         *
+         * Unknown servers and monitors are reported with the invalid region and customer IDs, as with
+         * \ref RestHelpers::convertToJson.
+         *
+         * \param[in] rawEntries        The raw entries to be converted.
+         *
+         * \param[in] aggregatedEntries The aggregated entries to be converted.
+         *
+         * \param[in] serversById       A hash of server instances by server ID.
+         *
+         * \param[in] monitorsById      A hash of monitor instances by monitor ID.
+         *
+         * \param[in] includeServerId   If true, the server ID column will be included.
+         *
+         * \param[in] includeRegionId   If true, the region dictionary and region index column will be included.
+         *
+         * \param[in] includeCustomerId If true, the customer dictionary and customer index column will be included.
+         *
+         * \return Returns the encoded data.
+         */
+        static QByteArray convertToBinary(
+            const LatencyInterfaceManager::LatencyEntryList&           rawEntries,
+            const LatencyInterfaceManager::AggregatedLatencyEntryList& aggregatedEntries,
+            const Servers::ServersById&                                serversById,
+            const Monitors::MonitorsById&                              monitorsById,
+            bool                                                       includeServerId,
+            bool                                                       includeRegionId,
+            bool                                                       includeCustomerId
+        );
+
         /**
          * Method that converts a single resource entry to JSON.
          *
@@ -377,6 +602,281 @@ class RestHelpers {
             bool                           fullEntry,
             bool                           includeCustomerId
         );
+
+        /**
+         * Method that builds an entity tag for a catalog response.  The tag changes whenever the underlying data
+         * version changes.
+         *
+         * \param[in] path        The request path.
+         *
+         * \param[in] customerId  The customer ID of the customer making the request.
+         *
+         * \param[in] dataVersion The data version the response is built from.
+         *
+         * \param[in] variant     Request parameters that change the response content.
+         *
+         * \return Returns the hex encoded entity tag.
+         */
+        static QString entityTag(
+            const QString&     path,
+            unsigned long      customerId,
+            unsigned long long dataVersion,
+            const QString&     variant = QString()
+        );
+
+        /**
+         * Method that obtains the entity tag supplied in the "if_none_match" field of a request.
+         *
+         * \param[in] request The request to be checked.
+         *
+         * \return Returns the supplied entity tag.  An empty string is returned if no tag was supplied.
+         */
+        static QString ifNoneMatch(const QJsonDocument& request);
+
+    private:
+        /**
+         * The JSON key holding the monitor ID of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString monitorIdKey;
+
+        /**
+         * The JSON key holding the timestamp of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString timestampKey;
+
+        /**
+         * The JSON key holding the latency of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString latencyKey;
+
+        /**
+         * The JSON key holding the server ID of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString serverIdKey;
+
+        /**
+         * The JSON key holding the region ID of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString regionIdKey;
+
+        /**
+         * The JSON key holding the customer ID of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString customerIdKey;
+
+        /**
+         * The JSON key holding the average latency of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString averageKey;
+
+        /**
+         * The JSON key holding the latency variance of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString varianceKey;
+
+        /**
+         * The JSON key holding the minimum latency of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString minimumKey;
+
+        /**
+         * The JSON key holding the maximum latency of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString maximumKey;
+
+        /**
+         * The JSON key holding the sample count of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString numberSamplesKey;
+
+        /**
+         * The JSON key holding the start timestamp of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString startTimestampKey;
+
+        /**
+         * The JSON key holding the end timestamp of a latency entry.  Keys used once per entry are built once.
+         */
+        static const QString endTimestampKey;
+
+        /**
+         * Type used to map region IDs to indexes in the binary export region dictionary.
+         */
+        typedef QHash<Region::RegionId, unsigned long> RegionIndexes;
+
+        /**
+         * Type used to map customer IDs to indexes in the binary export customer dictionary.
+         */
+        typedef QHash<CustomerCapabilities::CustomerId, unsigned long> CustomerIndexes;
+
+        /**
+         * Method that appends the columns shared by raw and aggregated entries to a binary export.
+         *
+         * \param[in,out] result            The array to append the columns to.
+         *
+         * \param[in]     entries           The entries to be converted.
+         *
+         * \param[in]     serversById       A hash of server instances by server ID.
+         *
+         * \param[in]     monitorsById      A hash of monitor instances by monitor ID.
+         *
+         * \param[in]     includeServerId   If true, the server ID column will be included.
+         *
+         * \param[in]     includeRegionId   If true, the region index column will be included.
+         *
+         * \param[in]     includeCustomerId If true, the customer index column will be included.
+         *
+         * \param[in]     regionIndexes     The region dictionary indexes by region ID.
+         *
+         * \param[in]     customerIndexes   The customer dictionary indexes by customer ID.
+         */
+        static void appendLatencyColumns(
+            QByteArray&                       result,
+            const QList<const LatencyEntry*>& entries,
+            const Servers::ServersById&       serversById,
+            const Monitors::MonitorsById&     monitorsById,
+            bool                              includeServerId,
+            bool                              includeRegionId,
+            bool                              includeCustomerId,
+            const RegionIndexes&              regionIndexes,
+            const CustomerIndexes&            customerIndexes
+        );
+
+        /**
+         * Method that appends an unsigned LEB128 value to a binary export.
+         *
+         * \param[in,out] result The array to append the value to.
+         *
+         * \param[in]     value  The value to be appended.
+         */
+        static void appendVarint(QByteArray& result, unsigned long long value);
+
+        /**
+         * Method that appends a signed value, zigzag encoded as an unsigned LEB128 value, to a binary export.
+         *
+         * \param[in,out] result The array to append the value to.
+         *
+         * \param[in]     value  The value to be appended.
+         */
+        static void appendZigZag(QByteArray& result, long long value);
+
+        /**
+         * Method that appends a little endian IEEE-754 double precision value to a binary export.
+         *
+         * \param[in,out] result The array to append the value to.
+         *
+         * \param[in]     value  The value to be appended.
+         */
+        static void appendDouble(QByteArray& result, double value);
+
+        /**
+         * Method that returns the region ID for a server, or the invalid region ID if the server is unknown.
+         *
+         * \param[in] serverId    The server ID to look up.
+         *
+         * \param[in] serversById A hash of server instances by server ID.
+         *
+         * \return Returns the region ID of the server.
+         */
+        static Region::RegionId regionIdForServer(Server::ServerId serverId, const Servers::ServersById& serversById);
+
+        /**
+         * Method that returns the customer ID for a monitor, or the invalid customer ID if the monitor is unknown.
+         *
+         * \param[in] monitorId    The monitor ID to look up.
+         *
+         * \param[in] monitorsById A hash of monitor instances by monitor ID.
+         *
+         * \return Returns the customer ID owning the monitor.
+         */
+        static CustomerCapabilities::CustomerId customerIdForMonitor(
+            Monitor::MonitorId            monitorId,
+            const Monitors::MonitorsById& monitorsById
+        );
+
+        /**
+         * Trivial class that holds the metrics tracking one kind of list serialization.
+         */
+        class SerializationMetrics {
+            public:
+                /**
+                 * Histogram tracking the time spent serializing each list.
+                 */
+                MetricsRegistry::Histogram* seconds;
+
+                /**
+                 * Counter tracking the number of serialized entries.
+                 */
+                MetricsRegistry::Counter* entries;
+
+                /**
+                 * Counter tracking the number of bytes written by streamed serialization.  The value is a null pointer
+                 * for serialization to JSON values.
+                 */
+                MetricsRegistry::Counter* bytes;
+        };
+
+        /**
+         * Class that records the time spent serializing a list, and the number of entries serialized, when it goes
+         * out of scope.
+         */
+        class SerializationTimer {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] metrics       The metrics to be updated.
+                 *
+                 * \param[in] numberEntries The number of entries being serialized.
+                 *
+                 * \param[in] writer        The streamed writer receiving the entries.  A null pointer indicates the
+                 *                          entries are being converted to a JSON value.
+                 */
+                SerializationTimer(
+                    const SerializationMetrics& metrics,
+                    unsigned long               numberEntries,
+                    const JsonStreamWriter*     writer = nullptr
+                );
+
+                ~SerializationTimer();
+
+            private:
+                /**
+                 * The metrics to be updated.
+                 */
+                const SerializationMetrics& currentMetrics;
+
+                /**
+                 * The number of entries being serialized.
+                 */
+                unsigned long currentNumberEntries;
+
+                /**
+                 * The streamed writer receiving the entries.
+                 */
+                const JsonStreamWriter* currentWriter;
+
+                /**
+                 * The size of the streamed response when serialization started.
+                 */
+                int startingSize;
+
+                /**
+                 * Timer used to measure the serialization time.
+                 */
+                QElapsedTimer timer;
+        };
+
+        /**
+         * Method that obtains the metrics tracking one kind of list serialization.
+         *
+         * \param[in] kind   The kind of entries being serialized.
+         *
+         * \param[in] writer The name of the writer used, either "object" or "stream".
+         *
+         * \return Returns the metrics.
+         */
+        static SerializationMetrics serializationMetrics(const QString& kind, const QString& writer);
 };
 
 #endif
@@ -29,7 +29,11 @@
 #include <QHash>
 #include <QSet>
 #include <QMap>
+#include <QList>
 #include <QJsonObject>
+#include <QJsonDocument>
+
+#include <memory>
 
 #include "server.h"
 #include "servers.h"
@@ -40,16 +44,23 @@
 #include "host_schemes.h"
 #include "customer_capabilities.h"
 #include "customer_mapping.h"
+#include "server_load_index.h"
+#include "server_health_statistics.h"
 
 class Servers;
 class Regions;
 class Monitors;
 class HostSchemes;
 class CustomersCapabilities;
+class QTimer;
 class OutboundRestApiFactory;
 
 /**
  * Class that administrates our polling servers.
+ *
+ * Readers obtain an immutable, versioned \ref ServerAdministrator::Snapshot of the servers and regions.  Each change
+ * publishes a new snapshot atomically so readers never block on, or observe a partial, update.  Changes serialize
+ * among themselves on a writer mutex that readers never take.
  */
 class ServerAdministrator:public QObject {
     Q_OBJECT
@@ -60,6 +71,11 @@ class ServerAdministrator:public QObject {
          */
         static constexpr Server::ServerId invalidServerId = 0;
 
+        /**
+         * The default interval between writes of reported server status and loading to the database, in seconds.
+         */
+        static const unsigned defaultReportFlushIntervalSeconds;
+
         /**
          * Type used to represent a region ID.
          */
@@ -100,6 +116,134 @@ class ServerAdministrator:public QObject {
          */
         typedef QList<CustomerId> CustomerList;
 
+        /**
+         * Type used to represent projected CPU loading by server ID.
+         */
+        typedef QHash<ServerId, float> LoadingByServerId;
+
+        /**
+         * Type used to track servers by region.  We use a map to impose consistent ordering of regions.
+         */
+        typedef QMap<RegionId, ServersById> ServersByServerIdByRegionId;
+
+        /**
+         * Type used to map a host address to a server.
+         */
+        typedef QHash<QString, ServerId> ServerIdsByIdentifier;
+
+        /**
+         * Class holding an immutable view of the servers and regions.
+         */
+        class Snapshot {
+            friend class ServerAdministrator;
+
+            public:
+                Snapshot():currentVersion(0) {}
+
+                /**
+                 * Method you can use to obtain the snapshot version.  The version increases with every change.
+                 *
+                 * \return Returns the snapshot version.  A value of 0 indicates the servers have never been loaded.
+                 */
+                inline unsigned long long version() const {
+                    return currentVersion;
+                }
+
+                /**
+                 * Method you can use to determine if the servers have been loaded.
+                 *
+                 * \return Returns true if the snapshot reflects the database.
+                 */
+                inline bool isLoaded() const {
+                    return currentVersion != 0;
+                }
+
+                /**
+                 * Method you can use to obtain a server by server ID.
+                 *
+                 * \param[in] serverId The server ID of the desired server.
+                 *
+                 * \return Returns the server.  An invalid server is returned if the server does not exist.
+                 */
+                inline Server server(ServerId serverId) const {
+                    return currentServersById.value(serverId);
+                }
+
+                /**
+                 * Method you can use to obtain a server by identifier.
+                 *
+                 * \param[in] identifier The server identifier.
+                 *
+                 * \return Returns the server.  An invalid server is returned if the server does not exist.
+                 */
+                inline Server server(const QString& identifier) const {
+                    return currentServersById.value(
+                        currentServerIdsByIdentifier.value(identifier, Server::invalidServerId)
+                    );
+                }
+
+                /**
+                 * Method you can use to obtain every server.
+                 *
+                 * \return Returns every server, by server ID.
+                 */
+                inline const ServersById& serversById() const {
+                    return currentServersById;
+                }
+
+                /**
+                 * Method you can use to obtain the active servers, by region.
+                 *
+                 * \return Returns the active servers by server ID, by region ID.
+                 */
+                inline const ServersByServerIdByRegionId& activeServersByRegionId() const {
+                    return currentActiveServersByRegionId;
+                }
+
+                /**
+                 * Method you can use to obtain the index last sent to servers in a region.
+                 *
+                 * \param[in] regionId The region ID of the region of interest.
+                 *
+                 * \return Returns the region index.  The maximum unsigned value is returned if the region has not
+                 *         been indexed.
+                 */
+                inline unsigned regionIndex(RegionId regionId) const {
+                    return currentRegionIndexByRegionIds.value(regionId, static_cast<unsigned>(-1));
+                }
+
+            private:
+                /**
+                 * The snapshot version.
+                 */
+                unsigned long long currentVersion;
+
+                /**
+                 * Every server, by server ID.
+                 */
+                ServersById currentServersById;
+
+                /**
+                 * Server IDs, by identifier.
+                 */
+                ServerIdsByIdentifier currentServerIdsByIdentifier;
+
+                /**
+                 * Active servers, by region.
+                 */
+                ServersByServerIdByRegionId currentActiveServersByRegionId;
+
+                /**
+                 * Region indexes, by region ID.
+                 */
+                QHash<RegionId, unsigned> currentRegionIndexByRegionIds;
+        };
+
+        /**
+         * Type used to reference a snapshot.
+         */
+        typedef std::shared_ptr<const Snapshot> SnapshotPointer;
+
         /**
          * Constructor
          *
@@ -132,6 +276,16 @@ class ServerAdministrator:public QObject {
 
         ~ServerAdministrator() override;
 
+        /**
+         * Method you can use to obtain the current snapshot.  The servers are loaded from the database on first use.
+         * Once loaded, this method never blocks.  This method is thread safe.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the current snapshot.
+         */
+        SnapshotPointer snapshot(unsigned threadId = 0);
+
         /**
          * Method you can use to get a server by server ID.
          *
@@ -178,9 +332,80 @@ class ServerAdministrator:public QObject {
          *
          * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
          *
-         * \return Returns a hash of servers by server ID.
+         * \return Returns a hash of servers by server ID.  The hash is an implicitly shared copy of the current
+         *         snapshot so it remains consistent while the servers change.
          */
-        const ServersById& getServersById(unsigned threadId = 0);
+        ServersById getServersById(unsigned threadId = 0);
+
+        /**
+         * Method you can use to record the status and loading reported by a polling server.  The report only updates
+         * the in-memory server table.  Changed servers are written to the database in bulk at the report flush
+         * interval.
+         *
+         * \param[in] identifier        The identifier of the reporting server.
+         *
+         * \param[in] status            The reported server status.
+         *
+         * \param[in] monitorsPerSecond The reported monitor service rate.
+         *
+         * \param[in] cpuLoading        The reported CPU loading.
+         *
+         * \param[in] memoryLoading     The reported memory loading.
+         *
+         * \param[in] threadId          An optional thread ID used to maintain independent per-thread database
+         *                              instances.  The database is only used to load the server table.
+         *
+         * \return Returns the updated \ref Server instance.  An invalid server instance is returned if the
+         *         identifier is not known.
+         */
+        Server recordServerReport(
+            const QString& identifier,
+            Status         status,
+            float          monitorsPerSecond,
+            float          cpuLoading,
+            float          memoryLoading,
+            unsigned       threadId = 0
+        );
+
+        /**
+         * Method you can use to set the interval between writes of reported server status and loading.
+         *
+         * \param[in] intervalSeconds The flush interval, in seconds.
+         */
+        void setReportFlushInterval(unsigned intervalSeconds);
+
+        /**
+         * Method you can use to enable delta customer updates.  When enabled, each customer message sent to a polling
+         * server carries a version number.  As long as the customer's settings are unchanged, later updates only
+         * carry the monitors that were added, modified or removed since the last sent version.  The polling server is
+         * expected to answer a delta it can not apply to its current version with a status other than "OK", which
+         * triggers a full resynchronization of that customer on that server.
+         *
+         * \param[in] enabled If true, delta updates are enabled.  If false, full customer messages are always sent.
+         */
+        void setDeltaUpdates(bool enabled);
+
+        /**
+         * Method you can use to set the polling server health statistics used to steer placements away from degraded
+         * servers.  Servers are re-evaluated at every report flush interval.  Degraded servers are still offered when
+         * no healthy server has capacity.
+         *
+         * \param[in] serverHealth     The server health statistics.  A null pointer disables health tracking.
+         *
+         * \param[in] degradationRatio The ratio a server's mean latency or timeout ratio must exceed the median of its
+         *                             regional peers by to be considered degraded.  A value of zero disables the
+         *                             check.
+         */
+        void setServerHealth(ServerHealthStatistics* serverHealth, double degradationRatio);
+
+        /**
+         * Method you can use to obtain the health of every polling server, compared against its regional peers.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the health by server ID.  An empty hash is returned if no health statistics are set.
+         */
+        ServerHealthStatistics::HealthByServerId getServerHealth(unsigned threadId = 0);
 
     public slots:
         /**
@@ -282,6 +507,29 @@ class ServerAdministrator:public QObject {
          */
         bool deactivateCustomer(CustomerId customerId, unsigned threadId);
 
+        /**
+         * Slot you can use to update polling servers to support a collection of customers.  Capabilities are loaded
+         * in bulk and each polling server receives a single message covering every customer it serves.
+         *
+         * \param[in] customerIds The IDs of the customers to update.
+         *
+         * \param[in] threadId    An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false if any customer could not be updated.
+         */
+        bool activateCustomers(const CustomerList& customerIds, unsigned threadId);
+
+        /**
+         * Slot you can use to remove a collection of customers from the polling servers.
+         *
+         * \param[in] customerIds The IDs of the customers to remove.
+         *
+         * \param[in] threadId    An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false if any customer could not be removed.
+         */
+        bool deactivateCustomers(const CustomerList& customerIds, unsigned threadId);
+
         /**
          * Slot you can use to pause or resume a customer.
          *
@@ -299,18 +547,29 @@ class ServerAdministrator:public QObject {
          * Slot you can use to move all work from one server to another server and then optionally mark the server as
          * inactive.
          *
-         * \param[in] fromServerId The server to move work from.  The server will be marked inactive at the start of
-         *                         this process.
+         * The complete new assignment is planned in memory first, using a simple load model that charges each
+         * server for the monitor checks per second it is given.  The new mappings are then written in a single
+         * transaction and each destination server receives a single batched activation message.
          *
-         * \param[in] customers    A list of customers to be reassigned.  An empty list indicates all customers tied
-         *                         to the server should be reassigned.  An empty list will also cause the server to
-         *                         go inactive.
+         * \param[in] fromServerId     The server to move work from.  The server will be marked inactive at the start
+         *                             of this process.
          *
-         * \param[in] toServerId   The server to move work to.  An invalid server ID will cause the work to be
-         *                         redistributed across all other servers in the same region.  Note that this server
-         *                         should be inactive or defunct.
+         * \param[in] customers        A list of customers to be reassigned.  An empty list indicates all customers
+         *                             tied to the server should be reassigned.  An empty list will also cause the
+         *                             server to go inactive.
          *
-         * \param[in] threadId     An optional thread ID used to maintain independent per-thread database instances.
+         * \param[in] toServerId       The server to move work to.  An invalid server ID will cause the work to be
+         *                             redistributed across all other servers in the same region.  Note that this
+         *                             server should be inactive or defunct.
+         *
+         * \param[in] dryRun           If true, the new assignment is planned but neither the database nor the
+         *                             polling servers are updated and the server's status is left unchanged.
+         *
+         * \param[in] projectedLoading Optional pointer to a hash that is populated with the projected CPU loading of
+         *                             every server once the new assignment is in place.
+         *
+         * \param[in] threadId         An optional thread ID used to maintain independent per-thread database
+         *                             instances.
          *
          * \return Returns true on success.  Returns false on error.
          */
@@ -318,19 +577,281 @@ class ServerAdministrator:public QObject {
             ServerId            fromServerId,
             const CustomerList& customers = CustomerList(),
             ServerId            toServerId = invalidServerId,
+            bool                dryRun = false,
+            LoadingByServerId*  projectedLoading = nullptr,
             unsigned            threadId = 0
         );
 
+        /**
+         * Slot you can use to write reported server status and loading held in memory to the database.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         */
+        void flushServerReports(unsigned threadId = 0);
+
+    private slots:
+        /**
+         * Slot that is triggered at the report flush interval.
+         */
+        void reportFlushTimeout();
+
+        /**
+         * Slot that is triggered when a polling server responds to a delta customer update.
+         *
+         * \param[in] context  The \ref CustomerUpdate tied to the message.
+         *
+         * \param[in] response The response from the polling server.
+         */
+        void customerUpdateResponse(void* context, const QJsonDocument& response);
+
     private:
         /**
-         * Type used to track servers by region.  We use a map to impose consistent ordering of regions.
+         * Class that tracks the customer state last sent to a polling server.
          */
-        typedef QMap<RegionId, ServersById> ServersByServerIdByRegionId;
+        class CustomerSyncState {
+            public:
+                CustomerSyncState():currentVersion(0) {}
+
+                /**
+                 * Constructor.
+                 *
+                 * \param[in] version         The version number last sent.
+                 *
+                 * \param[in] settings        The customer settings last sent, without any host/schemes.
+                 *
+                 * \param[in] hostSchemesById The host/schemes last sent.
+                 *
+                 * \param[in] monitorsById    The monitors last sent.
+                 */
+                CustomerSyncState(
+                        unsigned long                      version,
+                        const QJsonObject&                 settings,
+                        const HostSchemes::HostSchemeHash& hostSchemesById,
+                        const Monitors::MonitorsById&      monitorsById
+                    ):currentVersion(
+                        version
+                    ),currentSettings(
+                        settings
+                    ),currentHostSchemesById(
+                        hostSchemesById
+                    ),currentMonitorsById(
+                        monitorsById
+                    ) {}
+
+                /**
+                 * Method you can use to obtain the version number last sent.
+                 *
+                 * \return Returns the version number last sent.
+                 */
+                unsigned long version() const {
+                    return currentVersion;
+                }
+
+                /**
+                 * Method you can use to obtain the customer settings last sent.
+                 *
+                 * \return Returns the customer settings last sent, without any host/schemes.
+                 */
+                const QJsonObject& settings() const {
+                    return currentSettings;
+                }
+
+                /**
+                 * Method you can use to obtain the host/schemes last sent.
+                 *
+                 * \return Returns the host/schemes last sent, by host/scheme ID.
+                 */
+                const HostSchemes::HostSchemeHash& hostSchemesById() const {
+                    return currentHostSchemesById;
+                }
+
+                /**
+                 * Method you can use to obtain the monitors last sent.
+                 *
+                 * \return Returns the monitors last sent, by monitor ID.
+                 */
+                const Monitors::MonitorsById& monitorsById() const {
+                    return currentMonitorsById;
+                }
+
+            private:
+                /**
+                 * The version number last sent.
+                 */
+                unsigned long currentVersion;
+
+                /**
+                 * The customer settings last sent.
+                 */
+                QJsonObject currentSettings;
+
+                /**
+                 * The host/schemes last sent.
+                 */
+                HostSchemes::HostSchemeHash currentHostSchemesById;
+
+                /**
+                 * The monitors last sent.
+                 */
+                Monitors::MonitorsById currentMonitorsById;
+        };
 
         /**
-         * Type used to map a host address to a server.
+         * Class used as the callback context for a delta customer update.
          */
-        typedef QHash<QString, ServerId> ServerIdsByIdentifier;
+        class CustomerUpdate {
+            public:
+                /**
+                 * Constructor.
+                 *
+                 * \param[in] serverId   The ID of the server the update was sent to.
+                 *
+                 * \param[in] customerId The ID of the customer being updated.
+                 *
+                 * \param[in] version    The version number carried by the update.
+                 */
+                CustomerUpdate(
+                        ServerId      serverId,
+                        CustomerId    customerId,
+                        unsigned long version
+                    ):currentServerId(
+                        serverId
+                    ),currentCustomerId(
+                        customerId
+                    ),currentVersion(
+                        version
+                    ) {}
+
+                /**
+                 * Method you can use to obtain the ID of the server the update was sent to.
+                 *
+                 * \return Returns the server ID.
+                 */
+                ServerId serverId() const {
+                    return currentServerId;
+                }
+
+                /**
+                 * Method you can use to obtain the ID of the customer being updated.
+                 *
+                 * \return Returns the customer ID.
+                 */
+                CustomerId customerId() const {
+                    return currentCustomerId;
+                }
+
+                /**
+                 * Method you can use to obtain the version number carried by the update.
+                 *
+                 * \return Returns the version number.
+                 */
+                unsigned long version() const {
+                    return currentVersion;
+                }
+
+            private:
+                /**
+                 * The server the update was sent to.
+                 */
+                ServerId currentServerId;
+
+                /**
+                 * The customer being updated.
+                 */
+                CustomerId currentCustomerId;
+
+                /**
+                 * The version number carried by the update.
+                 */
+                unsigned long currentVersion;
+        };
+
+        /**
+         * Class that collects customer messages so that each polling server receives a single message covering
+         * every customer it serves.
+         */
+        class CustomerMessageBatch {
+            public:
+                CustomerMessageBatch():currentNumberCustomers(0) {}
+
+                /**
+                 * Method you can use to add a customer's settings for a server.
+                 *
+                 * \param[in] serverIdentifier The identifier of the server.
+                 *
+                 * \param[in] customerId       The ID of the customer.
+                 *
+                 * \param[in] message          The customer settings for this server.
+                 */
+                void addCustomerMessage(
+                        const QString&     serverIdentifier,
+                        CustomerId         customerId,
+                        const QJsonObject& message
+                    ) {
+                    currentRequestsByServerIdentifier[serverIdentifier].insert(QString::number(customerId), message);
+                    ++currentNumberCustomers;
+                }
+
+                /**
+                 * Method you can use to add a pause message for a server.  Pause messages are sent after the customer
+                 * settings.
+                 *
+                 * \param[in] serverIdentifier The identifier of the server.
+                 *
+                 * \param[in] message          The pause message.
+                 */
+                void addPauseMessage(const QString& serverIdentifier, const QJsonObject& message) {
+                    currentPauseMessagesByServerIdentifier[serverIdentifier].append(message);
+                }
+
+                /**
+                 * Method you can use to obtain the combined customer settings for each server.
+                 *
+                 * \return Returns the customer settings requests by server identifier.
+                 */
+                const QHash<QString, QJsonObject>& requestsByServerIdentifier() const {
+                    return currentRequestsByServerIdentifier;
+                }
+
+                /**
+                 * Method you can use to obtain the pause messages for each server.
+                 *
+                 * \return Returns the pause messages by server identifier.
+                 */
+                const QHash<QString, QList<QJsonObject>>& pauseMessagesByServerIdentifier() const {
+                    return currentPauseMessagesByServerIdentifier;
+                }
+
+                /**
+                 * Method you can use to determine the number of customer messages in this batch.
+                 *
+                 * \return Returns the number of customer messages.
+                 */
+                unsigned long numberCustomers() const {
+                    return currentNumberCustomers;
+                }
+
+            private:
+                /**
+                 * The combined customer settings by server identifier.
+                 */
+                QHash<QString, QJsonObject> currentRequestsByServerIdentifier;
+
+                /**
+                 * The pause messages by server identifier.
+                 */
+                QHash<QString, QList<QJsonObject>> currentPauseMessagesByServerIdentifier;
+
+                /**
+                 * The number of customer messages.
+                 */
+                unsigned long currentNumberCustomers;
+        };
+
+        /**
+         * Type used to track the state last sent for each customer on a server.
+         */
+        typedef QHash<CustomerId, CustomerSyncState> CustomerSyncStates;
 
         /**
          * The endpoint used to make a polling server inactive.
@@ -347,6 +868,11 @@ class ServerAdministrator:public QObject {
          */
         static const QString pollingServerCustomerPauseEndpoint;
 
+        /**
+         * The endpoint used to send delta customer updates to a polling server.
+         */
+        static const QString pollingServerCustomerUpdateEndpoint;
+
         /**
          * Method you can use to assign a collection of servers to this customer.  Unless told otherwise, the method
          * will attempt to reuse existing servers as much as possible.
@@ -362,6 +888,9 @@ class ServerAdministrator:public QObject {
          *
          * \param[in] exclusionList  A list of servers to be excluded.
          *
+         * \param[in] loadIndex      Optional load index used to pick servers.  The live load index is used if this
+         *                           value is null.
+         *
          * \param[in] threadId       An optional thread ID used to maintain independent per-thread database instances.
          *
          * \return Returns a tuple containing the updated mapping and the server ID of any servers removed from the
@@ -372,22 +901,39 @@ class ServerAdministrator:public QObject {
             bool                       ignoreExisting,
             bool                       multiRegion,
             const ServerExclusionList& exclusionList = ServerExclusionList(),
+            const ServerLoadIndex*     loadIndex = nullptr,
             unsigned                   threadId = 0
         );
 
         /**
-         * Method that identifies the least loaded server in a collection of servers.
+         * Method that determines the number of monitor checks per second a customer asks for.
          *
-         * This method assumes the cache has been loaded and that we currently have a lock on our internal data
-         * structures.
+         * \param[in] capabilities The customer's capabilities.
          *
-         * \param[in] servers       Servers to be queried.  Only active servers will be considered.
+         * \param[in] threadId     An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns the customer's monitor checks per second.
+         */
+        float customerMonitorsPerSecond(const CustomerCapabilities& capabilities, unsigned threadId = 0) const;
+
+        /**
+         * Method that projects a change in a customer's servers onto a load index so later placements in the same
+         * run account for it.
+         *
+         * \param[in] loadIndex                 The load index to be updated.
          *
-         * \param[in] exclusionList A list of servers to be excluded.
+         * \param[in] oldServers                The servers the customer was assigned to.
          *
-         * \return Returns the least loaded server in the set.
+         * \param[in] newServers                The servers the customer is now assigned to.
+         *
+         * \param[in] customerMonitorsPerSecond The customer's monitor checks per second.
          */
-        static Server leastLoadedServer(const ServersById& servers, const ServerExclusionList& exclusionList);
+        static void projectPlacement(
+            ServerLoadIndex&                  loadIndex,
+            const CustomerMapping::ServerSet& oldServers,
+            const CustomerMapping::ServerSet& newServers,
+            float                             customerMonitorsPerSecond
+        );
 
         /**
          * Method that is used to update our local hashes from the database.
@@ -396,6 +942,18 @@ class ServerAdministrator:public QObject {
          */
         void updateLocalCache(unsigned threadId = 0);
 
+        /**
+         * Method that publishes a new snapshot of the servers and regions.  The writer mutex must be locked by the
+         * caller.
+         */
+        void publishSnapshot();
+
+        /**
+         * Method that re-evaluates which servers are degraded and updates the load index to match.  The writer mutex
+         * must not be locked by the caller.
+         */
+        void updateServerHealth();
+
         /**
          * Method that updates the region data for all active servers.
          */
@@ -470,6 +1028,78 @@ class ServerAdministrator:public QObject {
          */
         void sendGoActive(const Server& server, unsigned regionIndex, unsigned numberRegions);
 
+        /**
+         * Method that builds the message used to command a server to go active.
+         *
+         * \param[in] regionIndex   The zero based region index.
+         *
+         * \param[in] numberRegions The number of regions.
+         *
+         * \return Returns a QJsonObject holding the region settings to report to the remote server.
+         */
+        static QJsonObject buildRegionChangeMessage(unsigned regionIndex, unsigned numberRegions);
+
+        /**
+         * Method that builds the polling server message describing a single monitor.
+         *
+         * \param[in] monitor The monitor to be described.
+         *
+         * \return Returns a QJsonObject holding the monitor settings.
+         */
+        static QJsonObject buildMonitorMessage(const Monitor& monitor);
+
+        /**
+         * Method that builds a delta customer update message holding the monitors added, modified and removed since a
+         * previously sent state.  A monitor is considered modified if any of its settings or its host/scheme URL
+         * changed.
+         *
+         * \param[in] syncState       The state last sent to the polling server.
+         *
+         * \param[in] hostSchemesById A hash table of the customer's current host schemes by host/scheme ID.
+         *
+         * \param[in] monitorsById    A hash table of the customer's current monitors by monitor ID.
+         *
+         * \return Returns a QJsonObject holding "add", "modify" and "remove" entries.  Entries with no changes are
+         *         omitted so an empty object is returned if nothing changed.
+         */
+        static QJsonObject buildCustomerDelta(
+            const CustomerSyncState&           syncState,
+            const HostSchemes::HostSchemeHash& hostSchemesById,
+            const Monitors::MonitorsById&      monitorsById
+        );
+
+        /**
+         * Method that sends a customer's settings to a single polling server, using a delta update when possible.
+         *
+         * \param[in] server          The server to receive the settings.
+         *
+         * \param[in] customerId      The ID of the customer.
+         *
+         * \param[in] settings        The customer settings for this server, without any host/schemes.
+         *
+         * \param[in] hostSchemesById A hash table of the customer's host schemes by host/scheme ID.
+         *
+         * \param[in] monitorsById    A hash table of the customer's monitors by monitor ID.
+         *
+         * \param[in] batch           An optional batch to add full customer messages to.  If null, messages are sent
+         *                            immediately.  Delta updates are always sent immediately.
+         */
+        void sendCustomerSettings(
+            const Server&                      server,
+            CustomerId                         customerId,
+            const QJsonObject&                 settings,
+            const HostSchemes::HostSchemeHash& hostSchemesById,
+            const Monitors::MonitorsById&      monitorsById,
+            CustomerMessageBatch*              batch = nullptr
+        );
+
+        /**
+         * Method that sends the messages collected in a customer message batch.
+         *
+         * \param[in] batch The batch to be sent.
+         */
+        void sendCustomerMessageBatch(const CustomerMessageBatch& batch);
+
         /**
          * Method that builds a customer polling server update message.
          *
@@ -524,13 +1154,17 @@ class ServerAdministrator:public QObject {
          * \param[in] capabilities   The customer capabilities to apply.
          *
          * \param[in] threadId       The thread ID used to maintain independent per-thread database instances.
+         *
+         * \param[in] batch          An optional batch to add customer settings and pause messages to.  If null,
+         *                           messages are sent immediately.
          */
         void applyCustomerActivation(
             const CustomerMapping::Mapping&   mapping,
             const CustomerMapping::ServerSet& removedServers,
             const CustomerMapping::ServerSet& limitToServers,
             const CustomerCapabilities&       capabilities,
-            unsigned                          threadId
+            unsigned                          threadId,
+            CustomerMessageBatch*             batch = nullptr
         );
 
         /**
@@ -569,10 +1203,15 @@ class ServerAdministrator:public QObject {
         OutboundRestApiFactory* currentOutboundRestApiFactory;
 
         /**
-         * Mutex used to manage access to the services provided by this class.
+         * Mutex used to serialize changes.  Readers use the current snapshot and never take this mutex.
          */
         QMutex accessMutex;
 
+        /**
+         * The current snapshot.  Accessed using the std::atomic_load and std::atomic_store functions.
+         */
+        SnapshotPointer currentSnapshot;
+
         /**
          * Flag indicating if we've loaded server information from our database.
          */
@@ -603,10 +1242,50 @@ class ServerAdministrator:public QObject {
          */
         ServersByServerIdByRegionId defunctServersByServerIdByRegionId;
 
+        /**
+         * Index of servers ordered by projected loading.
+         */
+        ServerLoadIndex serverLoadIndex;
+
         /**
          * Hash of region IDs by region index.
          */
         QHash<RegionId, unsigned> regionIndexByRegionIds;
+
+        /**
+         * The IDs of servers with reported status or loading not yet written to the database.
+         */
+        QSet<ServerId> reportedServerIds;
+
+        /**
+         * Timer used to write reported server status and loading.
+         */
+        QTimer* reportFlushTimer;
+
+        /**
+         * Flag indicating if delta customer updates are enabled.
+         */
+        bool currentDeltaUpdates;
+
+        /**
+         * The customer state last sent to each server, by server ID.
+         */
+        QHash<ServerId, CustomerSyncStates> customerSyncStatesByServerId;
+
+        /**
+         * The polling server health statistics.
+         */
+        ServerHealthStatistics* currentServerHealth;
+
+        /**
+         * The ratio to a server's regional peers beyond which the server is considered degraded.
+         */
+        double currentHealthDegradationRatio;
+
+        /**
+         * The IDs of servers currently marked degraded in the load index.
+         */
+        QSet<ServerId> degradedServerIds;
 };
 
 #endif
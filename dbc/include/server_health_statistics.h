@@ -0,0 +1,363 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref ServerHealthStatistics class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef SERVER_HEALTH_STATISTICS_H
+#define SERVER_HEALTH_STATISTICS_H
+
+#include <QMutex>
+#include <QHash>
+#include <QList>
+
+#include "region.h"
+#include "server.h"
+#include "servers.h"
+#include "latency_entry.h"
+
+/**
+ * Class that tracks rolling health statistics for every polling server as latency entries are received.  Each
+ * server holds a single exponentially decayed accumulator covering every monitor the server checks, so the observed
+ * sample rate, latency mean and variance, and the ratio of failed readings can be read without touching the database.
+ *
+ * Samples are decayed by arrival time using \ref windowSeconds as the time constant.  Readings above
+ * \ref LatencyEntry::maximumAllowedLatencyMicroseconds are counted as timeouts and excluded from the latency
+ * statistics.  Servers are judged against the other servers in their region, so the health of a server can be
+ * compared to what its peers observe over the same period.  This class is thread safe.
+ */
+class ServerHealthStatistics {
+    public:
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef Server::ServerId ServerId;
+
+        /**
+         * Type used to represent a region ID.
+         */
+        typedef Region::RegionId RegionId;
+
+        /**
+         * Type used to represent a latency value.
+         */
+        typedef LatencyEntry::LatencyMicroseconds LatencyMicroseconds;
+
+        /**
+         * Type used to represent a list of latency entries.
+         */
+        typedef QList<LatencyEntry> LatencyEntryList;
+
+        /**
+         * Type used to represent a table of servers by server ID.
+         */
+        typedef Servers::ServersById ServersById;
+
+        /**
+         * The decay time constant, in seconds.
+         */
+        static const unsigned long windowSeconds;
+
+        /**
+         * The time a server can go without new entries before its statistics are discarded, in seconds.
+         */
+        static const unsigned long maximumIdleSeconds;
+
+        /**
+         * The decayed number of samples a server must hold before it's compared against its peers or used as a peer.
+         */
+        static const double minimumWeight;
+
+        /**
+         * The timeout ratio a server may exceed its scaled peer baseline by before it's considered degraded.  The
+         * margin keeps servers in regions with almost no timeouts from being flagged over a handful of failures.
+         */
+        static const double timeoutRatioMargin;
+
+        /**
+         * Trivial class used to accumulate the entries from a single server before they're added under the lock.
+         */
+        class Batch {
+            friend class ServerHealthStatistics;
+
+            public:
+                Batch();
+
+                ~Batch();
+
+                /**
+                 * Method you can use to add a reading to the batch.
+                 *
+                 * \param[in] latencyMicroseconds The reported latency, in microseconds.  Values above
+                 *                                \ref LatencyEntry::maximumAllowedLatencyMicroseconds are counted as
+                 *                                timeouts.
+                 */
+                void add(LatencyMicroseconds latencyMicroseconds);
+
+                /**
+                 * Method you can use to determine if the batch holds no readings.
+                 *
+                 * \return Returns true if the batch is empty.  Returns false if the batch holds readings.
+                 */
+                inline bool isEmpty() const {
+                    return currentNumberSamples == 0;
+                }
+
+            private:
+                /**
+                 * The number of readings in the batch.
+                 */
+                unsigned long currentNumberSamples;
+
+                /**
+                 * The number of readings that were timeouts.
+                 */
+                unsigned long currentNumberTimeouts;
+
+                /**
+                 * The mean latency of the valid readings.
+                 */
+                double currentMean;
+
+                /**
+                 * The sum of squared differences from the mean of the valid readings.
+                 */
+                double currentSumSquares;
+        };
+
+        /**
+         * Trivial class holding the health of a single server.
+         */
+        class Health {
+            public:
+                Health() {
+                    weight            = 0;
+                    sampleRate        = 0;
+                    meanLatency       = 0;
+                    varianceLatency   = 0;
+                    timeoutRatio      = 0;
+                    lastUnixTimestamp = 0;
+                    numberPeers       = 0;
+                    peerMeanLatency   = 0;
+                    peerTimeoutRatio  = 0;
+                    degraded          = false;
+                }
+
+                /**
+                 * Method you can use to determine if this instance holds any samples.
+                 *
+                 * \return Returns true if the server has samples.  Returns false if the instance is empty.
+                 */
+                inline bool isValid() const {
+                    return weight > 0;
+                }
+
+                /**
+                 * The decayed number of readings, including timeouts.
+                 */
+                double weight;
+
+                /**
+                 * The observed number of readings received per second.
+                 */
+                double sampleRate;
+
+                /**
+                 * The decayed mean latency of valid readings, in microseconds.
+                 */
+                double meanLatency;
+
+                /**
+                 * The decayed latency variance of valid readings, in microseconds squared.
+                 */
+                double varianceLatency;
+
+                /**
+                 * The decayed fraction of readings that were timeouts.
+                 */
+                double timeoutRatio;
+
+                /**
+                 * The Unix timestamp when readings were last received.
+                 */
+                unsigned long long lastUnixTimestamp;
+
+                /**
+                 * The number of servers in the same region with enough samples to be compared against.
+                 */
+                unsigned numberPeers;
+
+                /**
+                 * The median mean latency across the server's peers, in microseconds.
+                 */
+                double peerMeanLatency;
+
+                /**
+                 * The median timeout ratio across the server's peers.
+                 */
+                double peerTimeoutRatio;
+
+                /**
+                 * Flag indicating if the server is degraded relative to its peers.
+                 */
+                bool degraded;
+        };
+
+        /**
+         * Type used to represent server health by server ID.
+         */
+        typedef QHash<ServerId, Health> HealthByServerId;
+
+        ServerHealthStatistics();
+
+        ~ServerHealthStatistics();
+
+        /**
+         * Method you can use to add a batch of readings received from a server.
+         *
+         * \param[in] serverId The ID of the server that took the readings.
+         *
+         * \param[in] batch    The readings to be added.
+         */
+        void addBatch(ServerId serverId, const Batch& batch);
+
+        /**
+         * Method you can use to add a collection of entries.  Entries may come from any number of servers.
+         *
+         * \param[in] latencyEntries The entries to be added.
+         */
+        void addEntries(const LatencyEntryList& latencyEntries);
+
+        /**
+         * Method you can use to discard servers that have received no entries for \ref maximumIdleSeconds.
+         */
+        void expire();
+
+        /**
+         * Method you can use to obtain the health of every known server, compared against its regional peers.
+         *
+         * \param[in] serversById      The servers to report, used to determine each server's region.  Servers
+         *                             without statistics are excluded.
+         *
+         * \param[in] degradationRatio The ratio a server's mean latency or timeout ratio must exceed the median of
+         *                             its peers by to be marked degraded.  A value of zero disables the check.
+         *
+         * \return Returns the health decayed to the current time, keyed by server ID.
+         */
+        HealthByServerId health(const ServersById& serversById, double degradationRatio) const;
+
+    private:
+        /**
+         * Class holding the decayed accumulators for a single server.
+         */
+        class Series {
+            public:
+                Series();
+
+                ~Series();
+
+                /**
+                 * Method that adds a batch of readings.
+                 *
+                 * \param[in] batch       The readings to be added.
+                 *
+                 * \param[in] unixSeconds The arrival time, in seconds since the Unix epoch.
+                 */
+                void add(const Batch& batch, double unixSeconds);
+
+                /**
+                 * Method that builds the health of this series without the peer comparison.
+                 *
+                 * \param[in] unixSeconds The time to decay to, in seconds since the Unix epoch.
+                 *
+                 * \return Returns the decayed health.
+                 */
+                Health toHealth(double unixSeconds) const;
+
+                /**
+                 * Method you can use to obtain the time readings were last received.
+                 *
+                 * \return Returns the arrival time of the newest readings, in seconds since the Unix epoch.
+                 */
+                double lastSeconds() const;
+
+            private:
+                /**
+                 * The decayed number of readings.
+                 */
+                double currentWeight;
+
+                /**
+                 * The decayed number of timeouts.
+                 */
+                double currentTimeoutWeight;
+
+                /**
+                 * The decayed number of valid readings.
+                 */
+                double currentLatencyWeight;
+
+                /**
+                 * The decayed mean latency of valid readings.
+                 */
+                double currentMean;
+
+                /**
+                 * The decayed sum of squared differences from the mean of valid readings.
+                 */
+                double currentSumSquares;
+
+                /**
+                 * The arrival time of the first readings, in seconds since the Unix epoch.
+                 */
+                double currentFirstSeconds;
+
+                /**
+                 * The arrival time of the newest readings, in seconds since the Unix epoch.
+                 */
+                double currentLastSeconds;
+        };
+
+        /**
+         * Method that calculates the median of a list of values.
+         *
+         * \param[in] values The values.  The list is reordered.
+         *
+         * \return Returns the median.  A value of zero is returned for an empty list.
+         */
+        static double median(QList<double>& values);
+
+        /**
+         * Method that calculates the current time.
+         *
+         * \return Returns the current time, in seconds since the Unix epoch.
+         */
+        static double currentUnixSeconds();
+
+        /**
+         * Mutex used to protect the series.
+         */
+        mutable QMutex accessMutex;
+
+        /**
+         * The series, keyed by server ID.
+         */
+        QHash<ServerId, Series> seriesByServerId;
+};
+
+#endif
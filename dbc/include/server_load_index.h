@@ -0,0 +1,320 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref ServerLoadIndex class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef SERVER_LOAD_INDEX_H
+#define SERVER_LOAD_INDEX_H
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QPair>
+
+#include "region.h"
+#include "server.h"
+
+/**
+ * Class that keeps servers ordered by a load score so the least loaded active server, either fleet wide or within
+ * a region, can be found in O(log n) time.
+ *
+ * A server's score is the larger of its projected CPU and memory loading.  Projections start from the last reported
+ * loading and grow as monitor checks are assigned to the server, scaled by the server's reported loading per monitor
+ * check per second.  Servers that do not report a polling rate are scaled by the fleet average.  Projected
+ * assignments are discarded when the server next reports, since the report then includes them.
+ *
+ * Every server is tracked but only active servers are ordered and offered by the least loaded queries.  Servers
+ * marked degraded have \ref degradedScorePenalty added to their score so they're only offered once every healthy
+ * server is fully loaded.
+ */
+class ServerLoadIndex {
+    public:
+        /**
+         * Type used to represent a region ID.
+         */
+        typedef Region::RegionId RegionId;
+
+        /**
+         * Type used to represent a server ID.
+         */
+        typedef Server::ServerId ServerId;
+
+        /**
+         * Type used to represent a server exclusion list.
+         */
+        typedef QSet<ServerId> ServerExclusionList;
+
+        /**
+         * The CPU loading assumed per monitor check per second when no server reports its polling rate.
+         */
+        static const float defaultLoadingPerMonitorPerSecond;
+
+        /**
+         * The value added to the load score of a degraded server.
+         */
+        static const float degradedScorePenalty;
+
+        ServerLoadIndex();
+
+        /**
+         * Copy constructor
+         *
+         * \param[in] other The instance to be copied.
+         */
+        ServerLoadIndex(const ServerLoadIndex& other);
+
+        ~ServerLoadIndex();
+
+        /**
+         * Method you can use to remove every server from the index.
+         */
+        void clear();
+
+        /**
+         * Method you can use to add or update a server.  Any projected assignments to the server are discarded.
+         *
+         * \param[in] server   The server to be added.
+         *
+         * \param[in] degraded If true, the server is marked degraded.
+         */
+        void insert(const Server& server, bool degraded = false);
+
+        /**
+         * Method you can use to remove a server.
+         *
+         * \param[in] serverId The ID of the server to be removed.
+         */
+        void remove(ServerId serverId);
+
+        /**
+         * Method you can use to mark a server as degraded or healthy.
+         *
+         * \param[in] serverId    The ID of the server of interest.
+         *
+         * \param[in] nowDegraded If true, the server is degraded.  If false, the server is healthy.
+         */
+        void setDegraded(ServerId serverId, bool nowDegraded);
+
+        /**
+         * Method you can use to determine if a server is marked degraded.
+         *
+         * \param[in] serverId The ID of the server of interest.
+         *
+         * \return Returns true if the server is degraded.  Returns false if the server is healthy or unknown.
+         */
+        bool isDegraded(ServerId serverId) const;
+
+        /**
+         * Method you can use to project the loading of monitor checks being added to or removed from a server.
+         *
+         * \param[in] serverId          The ID of the server receiving the work.
+         *
+         * \param[in] monitorsPerSecond The monitor checks per second being added.  Use a negative value to remove
+         *                              work.
+         */
+        void addMonitorsPerSecond(ServerId serverId, float monitorsPerSecond);
+
+        /**
+         * Method you can use to obtain the projected CPU loading of a server.
+         *
+         * \param[in] serverId The ID of the server of interest.
+         *
+         * \return Returns the projected CPU loading.  A value of 0 is returned for unknown servers.
+         */
+        float projectedCpuLoading(ServerId serverId) const;
+
+        /**
+         * Method you can use to obtain the load score for a server.
+         *
+         * \param[in] serverId The ID of the server of interest.
+         *
+         * \return Returns the load score.  The maximum float value is returned for unknown servers.
+         */
+        float score(ServerId serverId) const;
+
+        /**
+         * Method you can use to find the least loaded active server across every region.
+         *
+         * \param[in] exclusionList A list of servers to be excluded.
+         *
+         * \return Returns the ID of the least loaded server.  An invalid server ID is returned if there are no
+         *         eligible servers.
+         */
+        ServerId leastLoaded(const ServerExclusionList& exclusionList = ServerExclusionList()) const;
+
+        /**
+         * Method you can use to find the least loaded active server in a region.
+         *
+         * \param[in] regionId      The ID of the region to be searched.
+         *
+         * \param[in] exclusionList A list of servers to be excluded.
+         *
+         * \return Returns the ID of the least loaded server.  An invalid server ID is returned if there are no
+         *         eligible servers.
+         */
+        ServerId leastLoaded(RegionId regionId, const ServerExclusionList& exclusionList = ServerExclusionList()) const;
+
+        /**
+         * Assignment operator
+         *
+         * \param[in] other The instance to be copied.
+         *
+         * \return Returns a reference to this instance.
+         */
+        ServerLoadIndex& operator=(const ServerLoadIndex& other);
+
+    private:
+        /**
+         * Type used to order servers by load score.  Server IDs break ties.
+         */
+        typedef QPair<float, ServerId> Key;
+
+        /**
+         * Type used to hold servers in load order.
+         */
+        typedef QMap<Key, ServerId> OrderedServers;
+
+        /**
+         * Trivial class used to track the loading of a single server.
+         */
+        class Entry {
+            public:
+                Entry();
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] server The server to be tracked.
+                 */
+                Entry(const Server& server);
+
+                /**
+                 * The region the server lives in.
+                 */
+                RegionId regionId;
+
+                /**
+                 * Flag indicating if the server is active.
+                 */
+                bool active;
+
+                /**
+                 * Flag indicating if the server is degraded.
+                 */
+                bool degraded;
+
+                /**
+                 * The last reported CPU loading.
+                 */
+                float cpuLoading;
+
+                /**
+                 * The last reported memory loading.
+                 */
+                float memoryLoading;
+
+                /**
+                 * The last reported monitor checks per second.
+                 */
+                float monitorsPerSecond;
+
+                /**
+                 * The monitor checks per second assigned since the last report.
+                 */
+                float projectedMonitorsPerSecond;
+
+                /**
+                 * The key the server is currently ordered under.
+                 */
+                Key key;
+        };
+
+        /**
+         * Method that calculates the projected CPU loading for an entry.
+         *
+         * \param[in] entry The entry of interest.
+         *
+         * \return Returns the projected CPU loading.
+         */
+        float projectedCpuLoading(const Entry& entry) const;
+
+        /**
+         * Method that calculates the load score for an entry.
+         *
+         * \param[in] entry The entry of interest.
+         *
+         * \return Returns the load score.
+         */
+        float score(const Entry& entry) const;
+
+        /**
+         * Method that adds an entry to the ordered indexes.
+         *
+         * \param[in] serverId The ID of the server tied to the entry.
+         *
+         * \param[in] entry    The entry to be ordered.  The entry's key is updated.
+         */
+        void order(ServerId serverId, Entry& entry);
+
+        /**
+         * Method that removes an entry from the ordered indexes.
+         *
+         * \param[in] entry The entry to be removed.
+         */
+        void unorder(const Entry& entry);
+
+        /**
+         * Method that finds the first server in an ordered index that is not excluded.
+         *
+         * \param[in] servers       The ordered servers to search.
+         *
+         * \param[in] exclusionList A list of servers to be excluded.
+         *
+         * \return Returns the ID of the first eligible server.
+         */
+        static ServerId firstEligible(const OrderedServers& servers, const ServerExclusionList& exclusionList);
+
+        /**
+         * Every tracked server by server ID.
+         */
+        QHash<ServerId, Entry> entriesByServerId;
+
+        /**
+         * Active servers in load order.
+         */
+        OrderedServers orderedServers;
+
+        /**
+         * Active servers in load order, by region.
+         */
+        QHash<RegionId, OrderedServers> orderedServersByRegionId;
+
+        /**
+         * The total reported CPU loading across active servers.
+         */
+        float totalCpuLoading;
+
+        /**
+         * The total reported monitor checks per second across active servers.
+         */
+        float totalMonitorsPerSecond;
+};
+
+#endif
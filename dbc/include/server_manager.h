@@ -32,6 +32,8 @@
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 
+#include "job_scheduler.h"
+
 class ServerAdministrator;
 class Regions;
 
@@ -101,6 +103,8 @@ class ServerManager:public QObject {
          *
          * \param[in] regionDatabaseApi   Class used to manage servers entries in the database.
          *
+         * \param[in] jobScheduler        The scheduler used to run reassignments in the background.
+         *
          * \param[in[ secret              The incoming data secret.
          *
          * \param[in] parent              Pointer to the parent object.
@@ -109,6 +113,7 @@ class ServerManager:public QObject {
             RestApiInV1::Server* restApiServer,
             ServerAdministrator* serverAdministrator,
             Regions*             regionDatabaseApi,
+            JobScheduler*        jobScheduler,
             const QByteArray&    secret,
             QObject*             parent = nullptr
         );
@@ -492,11 +497,22 @@ class ServerManager:public QObject {
                  * \param[in] secret              The secret to use for this handler.
                  *
                  * \param[in] serverAdministrator Class used to manage servers entrie.
+                 *
+                 * \param[in] jobScheduler        The scheduler used to run reassignments in the background.
                  */
-                ServerReassign(const QByteArray& secret, ServerAdministrator* serverAdministrator);
+                ServerReassign(
+                    const QByteArray&    secret,
+                    ServerAdministrator* serverAdministrator,
+                    JobScheduler*        jobScheduler
+                );
 
                 ~ServerReassign() override;
 
+                /**
+                 * The job type used for server reassignments.
+                 */
+                static const QString reassignJobType;
+
             protected:
                 /**
                  * Method you can overload to receive a request and send a return response.  This method will only be
@@ -517,10 +533,28 @@ class ServerManager:public QObject {
                 ) override;
 
             private:
+                /**
+                 * Method that performs a reassignment from a job worker.
+                 *
+                 * \param[in] parameters The job parameters.
+                 *
+                 * \param[in] progress   The job's progress reporter.
+                 *
+                 * \param[in] threadId   The database thread ID reserved for the calling worker.
+                 *
+                 * \return Returns true on success.  Returns false on error.
+                 */
+                bool reassign(const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId);
+
                 /**
                  * The current servers database API.
                  */
                 ServerAdministrator* currentServerAdministrator;
+
+                /**
+                 * The scheduler used to run reassignments in the background.
+                 */
+                JobScheduler* currentJobScheduler;
         };
 
         /**
@@ -36,6 +36,7 @@
 
 class QTimer;
 class DatabaseManager;
+class IdRegistry;
 
 /**
  * Class used to read and write information about a server.  This cless expects a table named "server" with the
@@ -87,9 +88,11 @@ class Servers:public QObject, private SqlHelpers {
          *
          * \param[in] databaseManager The database manager used to fetch information about a region.
          *
+         * \param[in] idRegistry      The registry of valid monitor and server IDs to be kept up to date.
+         *
          * \param[in] parent          Pointer to the parent object.
          */
-        Servers(DatabaseManager* databaseManager, QObject* parent = nullptr);
+        Servers(DatabaseManager* databaseManager, IdRegistry* idRegistry, QObject* parent = nullptr);
 
         ~Servers() override;
 
@@ -146,6 +149,18 @@ class Servers:public QObject, private SqlHelpers {
          */
         bool modifyServer(const Server& server, unsigned threadId = 0);
 
+        /**
+         * Method you can use to write the reported status and loading of a collection of servers to the database in
+         * a single statement.  Region and identifier are not changed.
+         *
+         * \param[in] servers  The servers to be updated.
+         *
+         * \param[in] threadId An optional thread ID used to maintain independent per-thread database instances.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool updateServerReports(const ServerList& servers, unsigned threadId = 0);
+
         /**
          * Method you can use to delete a server from the database.
          *
@@ -198,6 +213,11 @@ class Servers:public QObject, private SqlHelpers {
          * The underlying database manager instance.
          */
         DatabaseManager* currentDatabaseManager;
+
+        /**
+         * The registry of valid monitor and server IDs.
+         */
+        IdRegistry* currentIdRegistry;
 };
 
 #endif
@@ -0,0 +1,333 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref ShardMap class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef SHARD_MAP_H
+#define SHARD_MAP_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+
+#include <cstdint>
+
+#include "customer_capabilities.h"
+
+class DatabaseManager;
+
+/**
+ * Class that assigns customers to database controller shards.  Shards are listed in the database and placed on a
+ * consistent hash ring with a configurable number of virtual nodes each so adding or removing a shard moves only the
+ * customers that hash to the affected arcs of the ring.  Every shard reads the same table so all shards agree on the
+ * owner of any customer without coordinating.
+ *
+ * The ring is loaded on first use and reloaded after \ref ShardMap::invalidate is called.  A controller with no local
+ * shard ID configured is unsharded and owns every customer.
+ */
+class ShardMap:public QObject {
+    Q_OBJECT
+
+    public:
+        /**
+         * Type used to represent a customer ID.
+         */
+        typedef CustomerCapabilities::CustomerId CustomerId;
+
+        /**
+         * Type used to represent a shard ID.
+         */
+        typedef std::uint16_t ShardId;
+
+        /**
+         * Value used to indicate an invalid shard ID.  A local shard ID of this value disables sharding.
+         */
+        static constexpr ShardId invalidShardId = 0;
+
+        /**
+         * The default number of virtual nodes placed on the ring for each shard.
+         */
+        static const unsigned defaultVirtualNodes;
+
+        /**
+         * Trivial class that describes a single shard.
+         */
+        class Shard {
+            public:
+                /**
+                 * Constructor.  Creates an invalid shard.
+                 */
+                inline Shard():currentShardId(invalidShardId),currentVirtualNodes(0) {}
+
+                /**
+                 * Constructor
+                 *
+                 * \param[in] shardId      The ID of this shard.
+                 *
+                 * \param[in] baseUrl      The base URL polling servers and peer controllers should use to reach
+                 *                         this shard.
+                 *
+                 * \param[in] virtualNodes The number of virtual nodes this shard places on the ring.
+                 */
+                inline Shard(
+                        ShardId        shardId,
+                        const QString& baseUrl,
+                        unsigned       virtualNodes
+                    ):currentShardId(
+                        shardId
+                    ),currentBaseUrl(
+                        baseUrl
+                    ),currentVirtualNodes(
+                        virtualNodes
+                    ) {}
+
+                /**
+                 * Copy constructor
+                 *
+                 * \param[in] other The instance to be copied.
+                 */
+                inline Shard(
+                        const Shard& other
+                    ):currentShardId(
+                        other.currentShardId
+                    ),currentBaseUrl(
+                        other.currentBaseUrl
+                    ),currentVirtualNodes(
+                        other.currentVirtualNodes
+                    ) {}
+
+                ~Shard() = default;
+
+                /**
+                 * Method you can use to determine if this shard is valid.
+                 *
+                 * \return Returns true if the shard is valid.  Returns false if the shard is invalid.
+                 */
+                inline bool isValid() const {
+                    return currentShardId != invalidShardId;
+                }
+
+                /**
+                 * Method you can use to determine if this shard is invalid.
+                 *
+                 * \return Returns true if the shard is invalid.  Returns false if the shard is valid.
+                 */
+                inline bool isInvalid() const {
+                    return !isValid();
+                }
+
+                /**
+                 * Method you can use to obtain the shard ID.
+                 *
+                 * \return Returns the shard ID.
+                 */
+                inline ShardId shardId() const {
+                    return currentShardId;
+                }
+
+                /**
+                 * Method you can use to obtain the shard's base URL.
+                 *
+                 * \return Returns the shard's base URL.
+                 */
+                inline const QString& baseUrl() const {
+                    return currentBaseUrl;
+                }
+
+                /**
+                 * Method you can use to obtain the number of virtual nodes this shard places on the ring.
+                 *
+                 * \return Returns the number of virtual nodes.
+                 */
+                inline unsigned virtualNodes() const {
+                    return currentVirtualNodes;
+                }
+
+                /**
+                 * Assignment operator
+                 *
+                 * \param[in] other The instance to assign to this instance.
+                 *
+                 * \return Returns a reference to this instance.
+                 */
+                inline Shard& operator=(const Shard& other) {
+                    currentShardId      = other.currentShardId;
+                    currentBaseUrl      = other.currentBaseUrl;
+                    currentVirtualNodes = other.currentVirtualNodes;
+
+                    return *this;
+                }
+
+            private:
+                /**
+                 * The shard ID.
+                 */
+                ShardId currentShardId;
+
+                /**
+                 * The shard base URL.
+                 */
+                QString currentBaseUrl;
+
+                /**
+                 * The number of virtual nodes.
+                 */
+                unsigned currentVirtualNodes;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] databaseManager The database manager used to read the shard table.
+         *
+         * \param[in] parent          Pointer to the parent object.
+         */
+        ShardMap(DatabaseManager* databaseManager, QObject* parent = nullptr);
+
+        ~ShardMap() override;
+
+        /**
+         * Method you can use to set the ID of the shard this controller serves.
+         *
+         * \param[in] newLocalShardId The local shard ID.  A value of \ref ShardMap::invalidShardId disables
+         *                            sharding.
+         */
+        void setLocalShardId(ShardId newLocalShardId);
+
+        /**
+         * Method you can use to obtain the ID of the shard this controller serves.
+         *
+         * \return Returns the local shard ID.
+         */
+        ShardId localShardId() const;
+
+        /**
+         * Method you can use to determine if this controller is one of several shards.
+         *
+         * \return Returns true if sharding is enabled.  Returns false if this controller owns every customer.
+         */
+        bool isSharded() const;
+
+        /**
+         * Method you can use to obtain the shard that owns a customer.
+         *
+         * \param[in] customerId The customer ID of interest.
+         *
+         * \param[in] threadId   The ID used to identify the thread and database connection.
+         *
+         * \return Returns the owning shard.  An invalid shard is returned if sharding is disabled or the shard table
+         *         could not be read.
+         */
+        Shard shardForCustomer(CustomerId customerId, unsigned threadId = 0);
+
+        /**
+         * Method you can use to obtain a shard by shard ID.
+         *
+         * \param[in] shardId  The shard ID of interest.
+         *
+         * \param[in] threadId The ID used to identify the thread and database connection.
+         *
+         * \return Returns the requested shard.  An invalid shard is returned if the shard does not exist.
+         */
+        Shard shard(ShardId shardId, unsigned threadId = 0);
+
+        /**
+         * Method you can use to determine if this controller owns a customer.  An unsharded controller owns every
+         * customer.  If the shard table can not be read, the controller assumes ownership so that customers are
+         * never orphaned by a transient database failure.
+         *
+         * \param[in] customerId The customer ID of interest.
+         *
+         * \param[in] threadId   The ID used to identify the thread and database connection.
+         *
+         * \return Returns true if this controller owns the customer.  Returns false if another shard owns the
+         *         customer.
+         */
+        bool ownsCustomer(CustomerId customerId, unsigned threadId = 0);
+
+        /**
+         * Method you can use to force the shard table to be reloaded on next access.
+         */
+        void invalidate();
+
+    private:
+        /**
+         * Method that loads the shard table and builds the ring.  The ring mutex must be held by the caller.
+         *
+         * \param[in] threadId The ID used to identify the thread and database connection.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool loadRing(unsigned threadId);
+
+        /**
+         * Method that locates the shard owning a customer on the current ring.  The ring mutex must be held by the
+         * caller.
+         *
+         * \param[in] customerId The customer ID of interest.
+         *
+         * \return Returns the owning shard ID.  Returns \ref ShardMap::invalidShardId if the ring is empty.
+         */
+        ShardId ringLookup(CustomerId customerId) const;
+
+        /**
+         * Method that scrambles a 64-bit value.  The SplitMix64 finalizer is used so ring positions are spread
+         * evenly regardless of how shard and customer IDs are allocated.
+         *
+         * \param[in] value The value to be scrambled.
+         *
+         * \return Returns the scrambled value.
+         */
+        static std::uint64_t mix(std::uint64_t value);
+
+        /**
+         * The database manager used to read the shard table.
+         */
+        DatabaseManager* currentDatabaseManager;
+
+        /**
+         * Mutex used to guard the ring and the local shard ID.
+         */
+        mutable QMutex ringMutex;
+
+        /**
+         * The local shard ID.
+         */
+        ShardId currentLocalShardId;
+
+        /**
+         * Flag indicating that the ring has been loaded.
+         */
+        bool ringLoaded;
+
+        /**
+         * The known shards, by shard ID.
+         */
+        QHash<ShardId, Shard> shardsById;
+
+        /**
+         * The consistent hash ring, mapping ring positions to shard IDs.
+         */
+        QMap<std::uint64_t, ShardId> ring;
+};
+
+#endif
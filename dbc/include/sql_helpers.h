@@ -24,12 +24,45 @@
 #define SQL_HELPERS_H
 
 #include <QString>
+#include <QList>
+#include <QSqlQuery>
+
+class QSqlDatabase;
+struct pg_conn;
 
 /**
- * Class that provides a collection of useful helpers for SQL statements.
+ * Class that provides a collection of useful helpers for SQL statements.  Statements should be executed through
+ * \ref SqlHelpers::execute so that they are included in the query statistics.
  */
 class SqlHelpers {
     public:
+        /**
+         * Trivial class used to describe one range partition of a table.  Bounds are in the units of the table's
+         * partition key.
+         */
+        class Partition {
+            public:
+                /**
+                 * The name of the partition.
+                 */
+                QString partitionName;
+
+                /**
+                 * The inclusive lower bound of the partition.
+                 */
+                long long lowerBound;
+
+                /**
+                 * The exclusive upper bound of the partition.
+                 */
+                long long upperBound;
+        };
+
+        /**
+         * Type used to represent a list of partitions.
+         */
+        typedef QList<Partition> PartitionList;
+
         SqlHelpers();
 
         ~SqlHelpers();
@@ -51,6 +84,105 @@ class SqlHelpers {
          * \return Returns the binary data converted to text.
          */
         static QString binaryToText(const QByteArray& binaryData);
+
+        /**
+         * Method you can use to execute a prepared query.  The execution is timed and recorded by the
+         * \ref QueryStatistics instance.
+         *
+         * \param[in] query The prepared query to be executed.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        static bool execute(QSqlQuery& query);
+
+        /**
+         * Method you can use to execute a statement.  The execution is timed and recorded by the
+         * \ref QueryStatistics instance.
+         *
+         * \param[in] query     The query used to execute the statement.
+         *
+         * \param[in] statement The statement to be executed.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        static bool execute(QSqlQuery& query, const QString& statement);
+
+        /**
+         * Method that obtains the PostgreSQL connection handle for a database, if available.
+         *
+         * \param[in] database The database to be checked.
+         *
+         * \return Returns a pointer to the PostgreSQL connection.  A null pointer is returned if the database is not
+         *         backed by libpq.
+         */
+        static pg_conn* postgreSqlConnection(const QSqlDatabase& database);
+
+        /**
+         * Method that obtains the range partitions of a table.  The default partition is not reported.
+         *
+         * \param[in,out] database    The database instance to be used.
+         *
+         * \param[in]     tableName   The name of the table.
+         *
+         * \param[out]    partitioned Holds true if the table is partitioned.
+         *
+         * \param[out]    partitions  The table's range partitions.  The list is empty if the table is not
+         *                            partitioned.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        static bool getPartitions(
+            QSqlDatabase&  database,
+            const QString& tableName,
+            bool&          partitioned,
+            PartitionList& partitions
+        );
+
+        /**
+         * Method that creates any missing partitions covering a span of partition key values.  Partitions are aligned
+         * to the partition period.  Spans already covered by an existing partition, in whole or in part, are skipped.
+         * Tables that are not partitioned are left untouched.
+         *
+         * \param[in,out] database        The database instance to be used.
+         *
+         * \param[in]     tableName       The name of the partitioned table.
+         *
+         * \param[in]     partitionPeriod The span of key values covered by each partition.
+         *
+         * \param[in]     startKey        The first key value to be covered.
+         *
+         * \param[in]     endKey          The key value at the end of the span to be covered.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        static bool createPartitions(
+            QSqlDatabase&  database,
+            const QString& tableName,
+            long long      partitionPeriod,
+            long long      startKey,
+            long long      endKey
+        );
+
+        /**
+         * Method that detaches and drops every range partition of a table whose upper bound is at or below a
+         * threshold.
+         *
+         * \param[in,out] database     The database instance to be used.
+         *
+         * \param[in]     tableName    The name of the table.
+         *
+         * \param[in]     keyThreshold The partition key value below which entries are expired.
+         *
+         * \param[out]    partitioned  Holds true if the table is partitioned.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        static bool dropPartitions(
+            QSqlDatabase&  database,
+            const QString& tableName,
+            long long      keyThreshold,
+            bool&          partitioned
+        );
 };
 
 #endif
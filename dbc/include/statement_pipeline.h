@@ -0,0 +1,236 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref StatementPipeline class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef STATEMENT_PIPELINE_H
+#define STATEMENT_PIPELINE_H
+
+#include <QString>
+#include <QList>
+#include <QVariant>
+#include <QAtomicInt>
+#include <QSqlDatabase>
+
+struct pg_conn;
+
+/**
+ * Class that executes a list of write statements with as few round trips to the database as possible.  When the
+ * database is backed by libpq 14 or newer, the statements are sent back to back using libpq pipeline mode over a
+ * non-blocking socket and the results are collected as they arrive.  Otherwise the statements are executed one at
+ * a time through Qt SQL.
+ *
+ * Statements use "?" placeholders for their parameters, as with positional binding in Qt SQL.  Consecutive statements
+ * with the same text are prepared once.  Every statement is recorded by the \ref QueryStatistics instance.
+ *
+ * A failed statement causes the remaining statements to be skipped.  Use the pipeline within a transaction if the
+ * statements must be applied atomically.
+ */
+class StatementPipeline {
+    public:
+        /**
+         * The maximum time to wait for the database to accept statements or return results, in milliseconds.
+         */
+        static constexpr int maximumWaitMilliseconds = 10 * 60 * 1000;
+
+        /**
+         * Constructor
+         *
+         * \param[in] database The database used to execute the statements.
+         */
+        StatementPipeline(const QSqlDatabase& database);
+
+        ~StatementPipeline();
+
+        /**
+         * Method you can use to globally enable or disable pipeline mode.  Statements are executed one at a time
+         * while pipeline mode is disabled.  This method is thread safe.
+         *
+         * \param[in] nowEnabled If true, pipeline mode will be used when available.
+         */
+        static void setEnabled(bool nowEnabled);
+
+        /**
+         * Method you can use to determine if this build supports pipeline mode.
+         *
+         * \return Returns true if pipeline mode is supported.
+         */
+        static bool isSupported();
+
+        /**
+         * Method you can use to queue a statement.
+         *
+         * \param[in] statement  The statement to be queued.
+         *
+         * \param[in] parameters Values for the statement's "?" placeholders, in order.  Byte arrays are sent as
+         *                       binary data.
+         */
+        void append(const QString& statement, const QVariantList& parameters = QVariantList());
+
+        /**
+         * Method you can use to determine the number of queued statements.
+         *
+         * \return Returns the number of queued statements.
+         */
+        inline unsigned long size() const {
+            return static_cast<unsigned long>(currentStatements.size());
+        }
+
+        /**
+         * Method you can use to execute and then discard the queued statements.
+         *
+         * \return Returns true if every statement succeeded.  Returns false on error.
+         */
+        bool execute();
+
+        /**
+         * Method you can use to obtain a description of the last error.
+         *
+         * \return Returns the last error message.  An empty string is returned if no error has occurred.
+         */
+        inline const QString& lastError() const {
+            return currentLastError;
+        }
+
+    private:
+        /**
+         * Trivial class used to hold a queued statement.
+         */
+        class Statement {
+            public:
+                /**
+                 * The statement text.
+                 */
+                QString text;
+
+                /**
+                 * The statement parameters.
+                 */
+                QVariantList parameters;
+        };
+
+        /**
+         * Trivial class used to track the result of a pipelined statement.
+         */
+        class Completion {
+            public:
+                /**
+                 * The time since the previous result was received, in nanoseconds.
+                 */
+                qint64 elapsedTime;
+
+                /**
+                 * The number of rows returned or affected.
+                 */
+                int rows;
+
+                /**
+                 * Flag indicating if the statement succeeded.
+                 */
+                bool success;
+        };
+
+        /**
+         * Method that executes the queued statements using libpq pipeline mode.
+         *
+         * \param[in] connection The connection to be used.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool executePipelined(pg_conn* connection);
+
+        /**
+         * Method that sends the queued statements using libpq pipeline mode.  The statement index tied to each
+         * expected result is recorded in \ref StatementPipeline::resultStatements.
+         *
+         * \param[in] connection The connection to be used.
+         *
+         * \return Returns true on success.  Returns false if a statement could not be sent.  Statements sent before
+         *         the failure must still be collected.
+         */
+        bool sendStatements(pg_conn* connection);
+
+        /**
+         * Method that collects the results of a pipeline, up to and including the final synchronization point.
+         *
+         * \param[in] connection The connection to be used.
+         *
+         * \return Returns true if every statement succeeded.  Returns false on error.
+         */
+        bool collectResults(pg_conn* connection);
+
+        /**
+         * Method that waits until the connection can be read or written.
+         *
+         * \param[in] connection The connection to be used.
+         *
+         * \param[in] write      If true, also wait for the connection to become writable.
+         *
+         * \return Returns true on success.  Returns false if the wait timed out or failed.
+         */
+        static bool waitForSocket(pg_conn* connection, bool write);
+
+        /**
+         * Method that executes the queued statements one at a time using Qt SQL.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool executeSequentially();
+
+        /**
+         * Method that converts "?" placeholders to the numbered placeholders used by libpq.
+         *
+         * \param[in] statement The statement to be converted.
+         *
+         * \return Returns the converted statement.
+         */
+        static QByteArray toNumberedPlaceholders(const QString& statement);
+
+        /**
+         * Flag indicating if pipeline mode is enabled.
+         */
+        static QAtomicInt enabled;
+
+        /**
+         * The database used to execute the statements.
+         */
+        QSqlDatabase currentDatabase;
+
+        /**
+         * The queued statements.
+         */
+        QList<Statement> currentStatements;
+
+        /**
+         * The statement tied to each expected pipeline result.  Results from preparing a statement hold -1.
+         */
+        QList<int> resultStatements;
+
+        /**
+         * The results received for each pipelined statement, in order.
+         */
+        QList<Completion> completions;
+
+        /**
+         * The last reported error.
+         */
+        QString currentLastError;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref StringPool class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+
+/**
+ * Class that interns strings so that equal strings held by many objects share a single buffer.  Monitor paths and
+ * user agent strings repeat heavily across customers so interning them keeps the in-memory catalog small and avoids
+ * an allocation per string per catalog load.
+ *
+ * Strings are never removed from the pool while they're in use.  Call \ref StringPool::purge periodically to release
+ * strings that are no longer referenced outside of the pool.
+ */
+class StringPool {
+    public:
+        /**
+         * Method you can use to obtain the pooled instance of a string.
+         *
+         * \param[in] str The string to be interned.
+         *
+         * \return Returns a string equal to the supplied string that shares storage with every other interned copy.
+         */
+        static QString intern(const QString& str);
+
+        /**
+         * Method you can use to release strings that are referenced only by the pool.
+         *
+         * \return Returns the number of strings released.
+         */
+        static unsigned long purge();
+
+        /**
+         * Method you can use to determine the number of strings currently held by the pool.
+         *
+         * \return Returns the number of pooled strings.
+         */
+        static unsigned long size();
+
+    private:
+        /**
+         * Mutex used to protect the pool.
+         */
+        static QMutex poolMutex;
+
+        /**
+         * The pooled strings.
+         */
+        static QSet<QString> pool;
+};
+
+#endif
@@ -0,0 +1,283 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref ThreadPlacement class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+/**
+ * Singleton class that places the threads of the background subsystems.  Each subsystem may be pinned to a set of
+ * CPUs and run at a chosen nice value so that background work stays on its own NUMA node and away from the REST
+ * workers.  Nice values are used rather than Qt thread priorities because Linux ignores the latter for threads under
+ * the default scheduling policy.  Subsystem threads hold a \ref ThreadPlacement::Scope for the lifetime of their run loop.  The placement is
+ * applied when a thread enters its scope and is reapplied to running threads whenever it changes.
+ *
+ * The CPU time used by the threads of each subsystem is reported through the metrics registry.
+ */
+class ThreadPlacement {
+    public:
+        /**
+         * Enumeration of placed subsystems.
+         */
+        enum class Subsystem {
+            /**
+             * Indicates the per-region latency interface threads and their shard writers.
+             */
+            LATENCY_INTERFACE,
+
+            /**
+             * Indicates the latency aggregation thread and its workers.
+             */
+            AGGREGATION,
+
+            /**
+             * Indicates the latency query workers.
+             */
+            QUERY,
+
+            /**
+             * Indicates the resource expunge, aggregation and flush threads.
+             */
+            RESOURCES,
+
+            /**
+             * Indicates the plot rendering workers.
+             */
+            PLOT,
+
+            /**
+             * Indicates the background job workers and the latency purger.
+             */
+            JOB
+        };
+
+        /**
+         * The number of placed subsystems.
+         */
+        static constexpr unsigned numberSubsystems = 6;
+
+        /**
+         * Trivial class that holds the placement of a subsystem.
+         */
+        class Placement {
+            public:
+                Placement() {
+                    adjustNice = false;
+                    nice       = 0;
+                }
+
+                /**
+                 * The CPUs the subsystem's threads may run on.  An empty list leaves the affinity unchanged.
+                 */
+                QList<unsigned> cpus;
+
+                /**
+                 * Flag indicating if the nice value of the subsystem's threads should be set.
+                 */
+                bool adjustNice;
+
+                /**
+                 * The nice value of the subsystem's threads, from -20 to 19.  Negative values require the
+                 * CAP_SYS_NICE capability.
+                 */
+                int nice;
+        };
+
+        /**
+         * Class that places the calling thread for the duration of a scope.  Create an instance at the top of a
+         * thread's run method.
+         */
+        class Scope {
+            public:
+                /**
+                 * Constructor
+                 *
+                 * \param[in] subsystem The subsystem the calling thread belongs to.
+                 */
+                Scope(Subsystem subsystem);
+
+                ~Scope();
+
+            private:
+                /**
+                 * The subsystem the thread belongs to.
+                 */
+                Subsystem currentSubsystem;
+        };
+
+        /**
+         * Method you can use to obtain the process wide thread placement.  The instance is created on first use.
+         *
+         * \return Returns a pointer to the thread placement.
+         */
+        static ThreadPlacement* instance();
+
+        /**
+         * Method you can use to set the placement of a subsystem.  Running threads of the subsystem are updated.
+         *
+         * \param[in] subsystem The subsystem to be updated.
+         *
+         * \param[in] placement The new placement.
+         */
+        void setPlacement(Subsystem subsystem, const Placement& placement);
+
+        /**
+         * Method you can use to convert a subsystem to a string.
+         *
+         * \param[in] subsystem The subsystem to convert.
+         *
+         * \return Returns the subsystem name.
+         */
+        static QString toString(Subsystem subsystem);
+
+        /**
+         * Method you can use to convert a string to a subsystem.
+         *
+         * \param[in]  str     The string to be converted.
+         *
+         * \param[out] success An optional pointer to a boolean value holding true on success or false on error.
+         *
+         * \return Returns the subsystem.
+         */
+        static Subsystem toSubsystem(const QString& str, bool* success = nullptr);
+
+        /**
+         * Method you can use to parse a CPU list such as "0-7,16-23".  The format matches the Linux cpuset list
+         * format.
+         *
+         * \param[in]  str     The string to be parsed.
+         *
+         * \param[out] success An optional pointer to a boolean value holding true on success or false on error.
+         *
+         * \return Returns the listed CPUs in ascending order.
+         */
+        static QList<unsigned> toCpuList(const QString& str, bool* success = nullptr);
+
+    private:
+        /**
+         * Trivial class that tracks a running thread.
+         */
+        class PlacedThread {
+            public:
+                /**
+                 * The POSIX thread handle.
+                 */
+                pthread_t handle;
+
+                /**
+                 * The kernel thread ID.
+                 */
+                pid_t threadId;
+
+                /**
+                 * Flag indicating if the thread's CPU clock could be obtained.
+                 */
+                bool hasCpuClock;
+
+                /**
+                 * The clock measuring the thread's CPU time.
+                 */
+                clockid_t cpuClock;
+        };
+
+        ThreadPlacement();
+
+        ~ThreadPlacement();
+
+        /**
+         * Method that registers and places the calling thread.
+         *
+         * \param[in] subsystem The subsystem the calling thread belongs to.
+         */
+        void enter(Subsystem subsystem);
+
+        /**
+         * Method that unregisters the calling thread, accumulating the CPU time it used.
+         *
+         * \param[in] subsystem The subsystem the calling thread belongs to.
+         */
+        void leave(Subsystem subsystem);
+
+        /**
+         * Method that applies a placement to a thread.  The caller must hold the placement mutex.
+         *
+         * \param[in] placedThread The thread to be placed.
+         *
+         * \param[in] placement    The placement to apply.
+         */
+        static void apply(const PlacedThread& placedThread, const Placement& placement);
+
+        /**
+         * Method that measures the CPU time used by a thread.
+         *
+         * \param[in] placedThread The thread to be measured.
+         *
+         * \return Returns the CPU time, in seconds.
+         */
+        static double cpuSeconds(const PlacedThread& placedThread);
+
+        /**
+         * Method that measures the CPU time used by the threads of a subsystem, including threads that have exited.
+         *
+         * \param[in] subsystem The subsystem of interest.
+         *
+         * \return Returns the CPU time, in seconds.
+         */
+        double subsystemCpuSeconds(Subsystem subsystem);
+
+        /**
+         * Method that counts the running threads of a subsystem.
+         *
+         * \param[in] subsystem The subsystem of interest.
+         *
+         * \return Returns the number of running threads.
+         */
+        unsigned numberThreads(Subsystem subsystem);
+
+        /**
+         * Mutex used to guard the placements and thread lists.
+         */
+        QMutex placementMutex;
+
+        /**
+         * The current placement, by subsystem.
+         */
+        Placement placements[numberSubsystems];
+
+        /**
+         * The running threads, by subsystem.
+         */
+        QList<PlacedThread> threads[numberSubsystems];
+
+        /**
+         * The CPU time used by threads that have exited, in seconds, by subsystem.
+         */
+        double retiredCpuSeconds[numberSubsystems];
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref TrafficRecorder class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef TRAFFIC_RECORDER_H
+#define TRAFFIC_RECORDER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+
+/**
+ * Class that optionally captures inbound requests to a file so that production load can be reproduced against a test
+ * instance.  Capture is disabled by default and costs a single atomic load per request while disabled.
+ *
+ * The capture file starts with the 8 byte magic value "DBCCAP01" followed by the capture start time, in milliseconds
+ * since the Unix epoch, as a 64-bit value.  Each request then follows as a record holding:
+ *
+ *     - The time since the capture started, in nanoseconds, as a 64-bit value.
+ *     - The authenticated customer ID, or 0 for requests authenticated with the Inesonic shared secret, as a 64-bit
+ *       value.
+ *     - The length of the path, in bytes, as a 16-bit value.
+ *     - The length of the payload, in bytes, as a 32-bit value.
+ *     - The UTF-8 encoded path.
+ *     - The decoded request payload.  JSON payloads are stored in compact form.
+ *
+ * All values are stored little endian.
+ */
+class TrafficRecorder {
+    public:
+        /**
+         * The default maximum capture file size, in bytes.
+         */
+        static const unsigned long long defaultMaximumCaptureSize;
+
+        /**
+         * Method you can use to obtain the process wide recorder.  The recorder is created on first use.
+         *
+         * \return Returns a pointer to the recorder.
+         */
+        static TrafficRecorder* instance();
+
+        /**
+         * Method you can use to start or stop capturing requests.  Starting a capture with a new file replaces the
+         * file contents.  The method does nothing if the filename is unchanged.
+         *
+         * \param[in] filename           The file to capture requests to.  An empty string stops the capture.
+         *
+         * \param[in] maximumCaptureSize The file size, in bytes, after which the capture is stopped.
+         *
+         * \return Returns true on success.  Returns false if the file could not be opened.
+         */
+        bool setCaptureFile(const QString& filename, unsigned long long maximumCaptureSize);
+
+        /**
+         * Method that records a request with a JSON payload.
+         *
+         * \param[in] path       The request path.
+         *
+         * \param[in] customerId The authenticated customer ID, or 0 for requests authenticated with the Inesonic
+         *                       shared secret.
+         *
+         * \param[in] request    The request payload.
+         */
+        static inline void record(const QString& path, unsigned long customerId, const QJsonDocument& request) {
+            TrafficRecorder* recorder = instance();
+            if (recorder->capturing.loadAcquire() != 0) {
+                recorder->write(path, customerId, request.toJson(QJsonDocument::JsonFormat::Compact));
+            }
+        }
+
+        /**
+         * Method that records a request with a binary payload.
+         *
+         * \param[in] path       The request path.
+         *
+         * \param[in] customerId The authenticated customer ID, or 0 for requests authenticated with the Inesonic
+         *                       shared secret.
+         *
+         * \param[in] request    The request payload.
+         */
+        static inline void record(const QString& path, unsigned long customerId, const QByteArray& request) {
+            TrafficRecorder* recorder = instance();
+            if (recorder->capturing.loadAcquire() != 0) {
+                recorder->write(path, customerId, request);
+            }
+        }
+
+    private:
+        TrafficRecorder();
+
+        ~TrafficRecorder();
+
+        /**
+         * Method that appends a record to the capture file.
+         *
+         * \param[in] path       The request path.
+         *
+         * \param[in] customerId The authenticated customer ID.
+         *
+         * \param[in] payload    The request payload.
+         */
+        void write(const QString& path, unsigned long customerId, const QByteArray& payload);
+
+        /**
+         * Flag indicating if requests are being captured.
+         */
+        QAtomicInt capturing;
+
+        /**
+         * Mutex protecting the capture file.
+         */
+        QMutex captureMutex;
+
+        /**
+         * The most recently requested capture filename.
+         */
+        QString currentFilename;
+
+        /**
+         * The capture file.
+         */
+        QFile captureFile;
+
+        /**
+         * Timer started when the capture started.
+         */
+        QElapsedTimer captureTimer;
+
+        /**
+         * The file size after which the capture is stopped.
+         */
+        unsigned long long currentMaximumCaptureSize;
+};
+
+#endif
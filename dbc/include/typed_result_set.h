@@ -0,0 +1,317 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref TypedResultSet class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef TYPED_RESULT_SET_H
+#define TYPED_RESULT_SET_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QSqlDatabase>
+
+#include <cstdint>
+#include <vector>
+
+struct pg_conn;
+struct pg_result;
+
+/**
+ * Class that executes a bulk SELECT and decodes the result directly into per-column, typed arrays.  Callers describe
+ * the columns they need with a static schema; values are never wrapped in QVariant instances.
+ *
+ * On PostgreSQL connections the statement is issued through libpq requesting binary results and values are decoded
+ * from network byte order.  If a requested column has a type with no binary decoder, the statement is reissued in
+ * text format and values are parsed in place.  Other drivers fall back to QSqlQuery.
+ */
+class TypedResultSet {
+    public:
+        /**
+         * Enumeration of supported column value types.
+         */
+        enum class ColumnType {
+            /**
+             * Indicates an integer column decoded into std::uint32_t values.
+             */
+            UINT32,
+
+            /**
+             * Indicates an integer column decoded into std::uint64_t values.
+             */
+            UINT64,
+
+            /**
+             * Indicates a floating point or integer column decoded into double values.
+             */
+            DOUBLE,
+
+            /**
+             * Indicates a BYTEA column decoded into QByteArray values.  NULL values decode as empty arrays.
+             */
+            BYTES
+        };
+
+        /**
+         * Structure describing one requested column.
+         */
+        struct Column {
+            /**
+             * The column name, as reported by the database.
+             */
+            const char* name;
+
+            /**
+             * The type the column should be decoded into.
+             */
+            ColumnType type;
+        };
+
+        /**
+         * Constructor
+         *
+         * \param[in] database The database connection to execute against.
+         */
+        TypedResultSet(const QSqlDatabase& database);
+
+        ~TypedResultSet();
+
+        /**
+         * Method you can use to execute a statement and decode the requested columns.
+         *
+         * \param[in] statement     The statement to be executed.
+         *
+         * \param[in] columns       The requested columns.  Column values are accessed by their index in this array.
+         *
+         * \param[in] numberColumns The number of requested columns.
+         *
+         * \return Returns true on success.  Returns false if the statement failed, a column is missing, or a value
+         *         could not be decoded.  The reason is available from \ref TypedResultSet::lastError.
+         */
+        bool execute(const QString& statement, const Column* columns, unsigned numberColumns);
+
+        /**
+         * Method you can use to determine the number of rows decoded.
+         *
+         * \return Returns the number of rows.
+         */
+        inline unsigned long size() const {
+            return currentSize;
+        }
+
+        /**
+         * Method you can use to obtain the values of a \ref TypedResultSet::ColumnType::UINT32 column.
+         *
+         * \param[in] column The index of the requested column.
+         *
+         * \return Returns a pointer to \ref TypedResultSet::size values.
+         */
+        inline const std::uint32_t* uint32Values(unsigned column) const {
+            return columnBuffers.at(column).uint32Values.data();
+        }
+
+        /**
+         * Method you can use to obtain the values of a \ref TypedResultSet::ColumnType::UINT64 column.
+         *
+         * \param[in] column The index of the requested column.
+         *
+         * \return Returns a pointer to \ref TypedResultSet::size values.
+         */
+        inline const std::uint64_t* uint64Values(unsigned column) const {
+            return columnBuffers.at(column).uint64Values.data();
+        }
+
+        /**
+         * Method you can use to obtain the values of a \ref TypedResultSet::ColumnType::DOUBLE column.
+         *
+         * \param[in] column The index of the requested column.
+         *
+         * \return Returns a pointer to \ref TypedResultSet::size values.
+         */
+        inline const double* doubleValues(unsigned column) const {
+            return columnBuffers.at(column).doubleValues.data();
+        }
+
+        /**
+         * Method you can use to obtain the values of a \ref TypedResultSet::ColumnType::BYTES column.
+         *
+         * \param[in] column The index of the requested column.
+         *
+         * \return Returns a pointer to \ref TypedResultSet::size values.
+         */
+        inline const QByteArray* byteArrayValues(unsigned column) const {
+            return columnBuffers.at(column).byteArrayValues.constData();
+        }
+
+        /**
+         * Method you can use to obtain a description of the last error.
+         *
+         * \return Returns the last error.  An empty string is returned if the last call succeeded.
+         */
+        inline const QString& lastError() const {
+            return currentLastError;
+        }
+
+    private:
+        /**
+         * The PostgreSQL type OID for BYTEA values.
+         */
+        static constexpr unsigned byteaOid = 17;
+
+        /**
+         * The PostgreSQL type OID for BIGINT values.
+         */
+        static constexpr unsigned int8Oid = 20;
+
+        /**
+         * The PostgreSQL type OID for SMALLINT values.
+         */
+        static constexpr unsigned int2Oid = 21;
+
+        /**
+         * The PostgreSQL type OID for INTEGER values.
+         */
+        static constexpr unsigned int4Oid = 23;
+
+        /**
+         * The PostgreSQL type OID for REAL values.
+         */
+        static constexpr unsigned float4Oid = 700;
+
+        /**
+         * The PostgreSQL type OID for DOUBLE PRECISION values.
+         */
+        static constexpr unsigned float8Oid = 701;
+
+        /**
+         * Structure holding the decoded values for one column.  Only the vector matching the column type is used.
+         */
+        struct ColumnBuffer {
+            ColumnType                 type;
+            std::vector<std::uint32_t> uint32Values;
+            std::vector<std::uint64_t> uint64Values;
+            std::vector<double>        doubleValues;
+            QVector<QByteArray>        byteArrayValues;
+        };
+
+        /**
+         * Method that executes the statement through libpq.
+         *
+         * \param[in] connection The underlying PostgreSQL connection.
+         *
+         * \param[in] statement  The statement to be executed.
+         *
+         * \param[in] columns    The requested columns.
+         *
+         * \return Returns true on success.
+         */
+        bool executePostgreSql(pg_conn* connection, const QByteArray& statement, const Column* columns);
+
+        /**
+         * Method that decodes a libpq result.
+         *
+         * \param[in] result  The result to decode.
+         *
+         * \param[in] columns The requested columns.
+         *
+         * \return Returns true on success.
+         */
+        bool decodeResult(const pg_result* result, const Column* columns);
+
+        /**
+         * Method that executes the statement through QSqlQuery for drivers other than PostgreSQL.
+         *
+         * \param[in] statement The statement to be executed.
+         *
+         * \param[in] columns   The requested columns.
+         *
+         * \return Returns true on success.
+         */
+        bool executeGeneric(const QString& statement, const Column* columns);
+
+        /**
+         * Method that determines if a column of a given PostgreSQL type can be decoded from binary format.
+         *
+         * \param[in] typeOid The PostgreSQL type OID.
+         *
+         * \param[in] type    The requested column type.
+         *
+         * \return Returns true if the binary format can be decoded.
+         */
+        static bool binaryDecodable(unsigned typeOid, ColumnType type);
+
+        /**
+         * Method that decodes a single binary integer or floating point value.
+         *
+         * \param[in]  typeOid The PostgreSQL type OID.
+         *
+         * \param[in]  data    The value in network byte order.
+         *
+         * \param[in]  length  The value length in bytes.
+         *
+         * \param[out] value   The decoded value.
+         *
+         * \return Returns true on success.
+         */
+        static bool decodeBinaryNumber(unsigned typeOid, const char* data, int length, double& value);
+
+        /**
+         * Method that decodes a single binary integer value.
+         *
+         * \param[in]  typeOid The PostgreSQL type OID.
+         *
+         * \param[in]  data    The value in network byte order.
+         *
+         * \param[in]  length  The value length in bytes.
+         *
+         * \param[out] value   The decoded value.
+         *
+         * \return Returns true on success.  Negative values are rejected.
+         */
+        static bool decodeBinaryInteger(unsigned typeOid, const char* data, int length, std::uint64_t& value);
+
+        /**
+         * Method that resizes the column buffers to hold a given number of rows.
+         *
+         * \param[in] numberRows The number of rows.
+         */
+        void resizeBuffers(unsigned long numberRows);
+
+        /**
+         * The database connection.
+         */
+        QSqlDatabase currentDatabase;
+
+        /**
+         * The decoded columns.
+         */
+        QVector<ColumnBuffer> columnBuffers;
+
+        /**
+         * The number of decoded rows.
+         */
+        unsigned long currentSize;
+
+        /**
+         * The last reported error.
+         */
+        QString currentLastError;
+};
+
+#endif
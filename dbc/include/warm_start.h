@@ -0,0 +1,120 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This header defines the \ref WarmStart class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QMutex>
+
+#include "periodic_scheduler.h"
+
+class Catalog;
+
+/**
+ * Class that lets a restarted controller serve requests within seconds rather than waiting for the catalog to load.
+ * The catalog snapshot is saved to disk periodically and at shutdown.  On startup the saved snapshot is restored,
+ * provided it still matches the database, and the catalog is then reconciled against the database in the
+ * background.
+ */
+class WarmStart:public QThread {
+    Q_OBJECT
+
+    public:
+        /**
+         * The default interval between saves, in seconds.
+         */
+        static const unsigned long defaultSaveIntervalSeconds;
+
+        /**
+         * Constructor
+         *
+         * \param[in] catalog The catalog to be saved and restored.
+         *
+         * \param[in] parent  Pointer to the parent object.
+         */
+        WarmStart(Catalog* catalog, QObject* parent = nullptr);
+
+        /**
+         * Destructor.  The catalog is saved a final time if a snapshot file is configured.
+         */
+        ~WarmStart() override;
+
+        /**
+         * Method you can use to configure the warm start.  The first call that supplies a filename restores the
+         * catalog from the file, if possible, and starts the background reconcile.  Later calls only change where
+         * and how often the catalog is saved.  Call this method once the database connection settings are known.
+         *
+         * \param[in] filename            The snapshot file.  An empty string disables the warm start.
+         *
+         * \param[in] saveIntervalSeconds The interval between saves, in seconds.  A value of 0 saves the catalog only
+         *                                at shutdown.
+         */
+        void configure(const QString& filename, unsigned long saveIntervalSeconds);
+
+        /**
+         * Method you can use to save the catalog to the configured file.
+         *
+         * \return Returns true on success.  Returns false if no file is configured or on error.
+         */
+        bool save();
+
+    protected:
+        /**
+         * Method that reconciles a restored catalog in the background.
+         */
+        void run() override;
+
+    private:
+        /**
+         * The thread ID used for database access.
+         */
+        static const unsigned warmStartThreadId = static_cast<unsigned>(-8);
+
+        /**
+         * The catalog.
+         */
+        Catalog* currentCatalog;
+
+        /**
+         * Mutex used to protect the configured filename.
+         */
+        mutable QMutex filenameMutex;
+
+        /**
+         * The configured snapshot file.
+         */
+        QString currentFilename;
+
+        /**
+         * Flag indicating that a restore has been attempted.
+         */
+        bool restoreAttempted;
+
+        /**
+         * The scheduler task used to save the catalog.
+         */
+        PeriodicScheduler::TaskId saveTaskId;
+};
+
+#endif
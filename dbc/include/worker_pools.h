@@ -0,0 +1,252 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref WorkerPools class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project db_controller */
+
+#ifndef WORKER_POOLS_H
+#define WORKER_POOLS_H
+
+#include <QString>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "metrics_registry.h"
+
+/**
+ * Class that divides the inbound server's request workers between classes of traffic.  Request handlers place a
+ * \ref WorkerPools::Admission around their expensive work.  Each pool limits how many of its requests may run at
+ * once and how many may wait for a worker.  Requests that would exceed the queue limit or that wait longer than the
+ * queue timeout are refused.
+ *
+ * Ingest is always admitted.  A configurable number of the inbound server's workers is reserved for ingest and the
+ * remaining pools share what is left, so a burst of customer reads or plots can never occupy every worker while
+ * polling servers are posting latency.
+ */
+class WorkerPools {
+    public:
+        /**
+         * Enumeration of worker pools.
+         */
+        enum class Pool {
+            /**
+             * Indicates latency posted by polling servers.
+             */
+            INGEST,
+
+            /**
+             * Indicates customer API reads.
+             */
+            CUSTOMER,
+
+            /**
+             * Indicates plot rendering requests.
+             */
+            PLOT,
+
+            /**
+             * Indicates administrative requests.
+             */
+            ADMIN
+        };
+
+        /**
+         * The number of worker pools.
+         */
+        static constexpr unsigned numberPools = 4;
+
+        /**
+         * The default time a request may wait for a worker, in milliseconds.
+         */
+        static const unsigned defaultQueueTimeoutMilliseconds;
+
+        /**
+         * The default maximum number of requests that may wait for a worker in each pool.
+         */
+        static const unsigned defaultMaximumQueued;
+
+        /**
+         * Class that holds a worker from a pool for the duration of a scope.  Check \ref Admission::admitted before
+         * doing the work the admission guards.
+         */
+        class Admission {
+            public:
+                /**
+                 * Constructor.  The constructor blocks until a worker is available, the queue timeout elapses or the
+                 * pool's queue is found to be full.
+                 *
+                 * \param[in] pool The pool to draw a worker from.
+                 */
+                Admission(Pool pool);
+
+                ~Admission();
+
+                /**
+                 * Method you can use to determine if the request was admitted.
+                 *
+                 * \return Returns true if a worker is held.  Returns false if the request was refused.
+                 */
+                inline bool admitted() const {
+                    return currentAdmitted;
+                }
+
+            private:
+                /**
+                 * The pool the worker was drawn from.
+                 */
+                Pool currentPool;
+
+                /**
+                 * Flag indicating if a worker is held.
+                 */
+                bool currentAdmitted;
+        };
+
+        /**
+         * Method you can use to obtain the process wide worker pools.  The pools are created on first use.
+         *
+         * \return Returns a pointer to the worker pools.
+         */
+        static WorkerPools* instance();
+
+        /**
+         * Method you can use to set the total number of request workers and the number reserved for ingest.
+         *
+         * \param[in] totalWorkers   The number of workers available to the inbound server.  A value of zero places
+         *                           no shared limit on the pools.
+         *
+         * \param[in] ingestReserved The number of workers only ingest may use.
+         */
+        void setWorkers(unsigned totalWorkers, unsigned ingestReserved);
+
+        /**
+         * Method you can use to set the limits of a pool.  Limits on the ingest pool are ignored.
+         *
+         * \param[in] pool           The pool to update.
+         *
+         * \param[in] maximumWorkers The maximum number of the pool's requests that may run at once.  A value of
+         *                           zero limits the pool only by the shared workers.
+         *
+         * \param[in] maximumQueued  The maximum number of the pool's requests that may wait for a worker.
+         */
+        void setPoolLimits(Pool pool, unsigned maximumWorkers, unsigned maximumQueued);
+
+        /**
+         * Method you can use to set the time a request may wait for a worker.
+         *
+         * \param[in] newQueueTimeoutMilliseconds The queue timeout, in milliseconds.
+         */
+        void setQueueTimeout(unsigned newQueueTimeoutMilliseconds);
+
+        /**
+         * Method you can use to convert a pool to a string.
+         *
+         * \param[in] pool The pool to convert.
+         *
+         * \return Returns the pool name.
+         */
+        static QString toString(Pool pool);
+
+    private:
+        WorkerPools();
+
+        ~WorkerPools();
+
+        /**
+         * Method that draws a worker from a pool.
+         *
+         * \param[in] pool The pool to draw from.
+         *
+         * \return Returns true if a worker was drawn.  Returns false if the request was refused.
+         */
+        bool acquire(Pool pool);
+
+        /**
+         * Method that returns a worker to a pool.
+         *
+         * \param[in] pool The pool to return the worker to.
+         */
+        void release(Pool pool);
+
+        /**
+         * Method that determines if a pool may start another request.  The caller must hold the pool mutex.
+         *
+         * \param[in] poolIndex The index of the pool.
+         *
+         * \return Returns true if a worker is available to the pool.
+         */
+        bool workerAvailable(unsigned poolIndex) const;
+
+        /**
+         * Mutex used to guard the pool state.
+         */
+        QMutex poolMutex;
+
+        /**
+         * Condition signalled whenever a worker is returned.
+         */
+        QWaitCondition workerReleased;
+
+        /**
+         * The maximum number of workers shared by the non-ingest pools.  A value of zero indicates no limit.
+         */
+        unsigned currentSharedWorkers;
+
+        /**
+         * The number of workers held by the non-ingest pools.
+         */
+        unsigned numberSharedActive;
+
+        /**
+         * The queue timeout, in milliseconds.
+         */
+        unsigned currentQueueTimeoutMilliseconds;
+
+        /**
+         * The maximum number of running requests, by pool.
+         */
+        unsigned maximumWorkers[numberPools];
+
+        /**
+         * The maximum number of waiting requests, by pool.
+         */
+        unsigned maximumQueued[numberPools];
+
+        /**
+         * The number of running requests, by pool.
+         */
+        unsigned numberActive[numberPools];
+
+        /**
+         * The number of waiting requests, by pool.
+         */
+        unsigned numberQueued[numberPools];
+
+        /**
+         * Gauges tracking the number of running requests, by pool.
+         */
+        MetricsRegistry::Gauge* activeMetrics[numberPools];
+
+        /**
+         * Counters tracking refused requests, by pool.
+         */
+        MetricsRegistry::Counter* rejectedMetrics[numberPools];
+};
+
+#endif
@@ -18,132 +18,217 @@
 * This header implements the \ref CacheBase class.
 ***********************************************************************************************************************/
 
+#include <QString>
 #include <QRandomGenerator>
 
 #include <cstdint>
-#include <cmath>
 
 #include "cache_base.h"
 
-CacheBase::CacheBase() {
-    for (unsigned i=0 ; i<(sizeof(seed)/sizeof(std::uint64_t)) ; ++i) {
-        seed[i] = QRandomGenerator::global()->generate64();
+/***********************************************************************************************************************
+* CacheBase::Statistics
+*/
+
+CacheBase::Statistics::Statistics() {
+    hits       = 0;
+    misses     = 0;
+    insertions = 0;
+    evictions  = 0;
+    rejections = 0;
+
+    numberEntries = 0;
+    tableSize     = 0;
+
+    for (unsigned i=0 ; i<numberProbeLengthBins ; ++i) {
+        probeLengths[i] = 0;
     }
 }
 
 
-CacheBase::~CacheBase() {}
+CacheBase::Statistics& CacheBase::Statistics::operator+=(const CacheBase::Statistics& other) {
+    hits       += other.hits;
+    misses     += other.misses;
+    insertions += other.insertions;
+    evictions  += other.evictions;
+    rejections += other.rejections;
 
+    numberEntries += other.numberEntries;
+    tableSize     += other.tableSize;
 
-std::uint64_t CacheBase::fnv1a8(std::uint8_t value, std::uint64_t hash) {
-    return (hash ^ value) * fnv1Prime;
+    for (unsigned i=0 ; i<numberProbeLengthBins ; ++i) {
+        probeLengths[i] += other.probeLengths[i];
+    }
+
+    return *this;
+}
+
+/***********************************************************************************************************************
+* CacheBase::FrequencySketch
+*/
+
+const std::uint64_t CacheBase::FrequencySketch::depthSeeds[CacheBase::FrequencySketch::sketchDepth] = {
+    0xC3A5C85C97CB3127ULL,
+    0xB492B66FBE98F273ULL,
+    0x9AE16A3B2F90404FULL,
+    0xCBF29CE484222325ULL
+};
+
+CacheBase::FrequencySketch::FrequencySketch() {
+    table           = nullptr;
+    tableMask       = 0;
+    numberAdditions = 0;
+    sampleSize      = 0;
+}
+
+
+CacheBase::FrequencySketch::~FrequencySketch() {
+    delete[] table;
 }
 
 
-std::uint64_t CacheBase::fnv1a16(std::uint16_t value, std::uint64_t hash) {
-    unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+void CacheBase::FrequencySketch::resize(CacheBase::Index maximumCacheDepth) {
+    delete[] table;
+
+    table           = nullptr;
+    tableMask       = 0;
+    numberAdditions = 0;
+    sampleSize      = 0;
 
-    hash = (hash ^ bytes[0]) * fnv1Prime;
-    hash = (hash ^ bytes[1]) * fnv1Prime;
+    if (maximumCacheDepth > 0) {
+        // Each word holds 16 counters and each entry touches 4 counters so one word per 4 entries keeps the
+        // collision rate low.  The table size is a power of two so we can select a word with a mask.
+
+        Index requiredWords = (maximumCacheDepth + 3) / 4;
+        Index tableSize     = 1;
+        while (tableSize < requiredWords) {
+            tableSize <<= 1;
+        }
 
-    return hash;
+        table      = new std::uint64_t[tableSize]();
+        tableMask  = tableSize - 1;
+        sampleSize = static_cast<unsigned long long>(maximumCacheDepth) * samplesPerEntry;
+    }
 }
 
 
-std::uint64_t CacheBase::fnv1a32(std::uint32_t value, std::uint64_t hash) {
-    unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+void CacheBase::FrequencySketch::increment(std::uint64_t hash) {
+    if (table != nullptr) {
+        bool incremented = false;
+        for (unsigned depth=0 ; depth<sketchDepth ; ++depth) {
+            std::uint64_t  h     = counterHash(hash, depth);
+            std::uint64_t* word  = table + (h & tableMask);
+            unsigned       shift = static_cast<unsigned>((h >> 40) & 0x0F) * 4;
 
-    hash = (hash ^ bytes[0]) * fnv1Prime;
-    hash = (hash ^ bytes[1]) * fnv1Prime;
-    hash = (hash ^ bytes[2]) * fnv1Prime;
-    hash = (hash ^ bytes[3]) * fnv1Prime;
+            if (((*word >> shift) & 0x0F) < maximumCount) {
+                *word       += std::uint64_t(1) << shift;
+                incremented  = true;
+            }
+        }
 
-    return hash;
+        if (incremented) {
+            ++numberAdditions;
+            if (numberAdditions >= sampleSize) {
+                halveCounters();
+            }
+        }
+    }
 }
 
 
-std::uint64_t CacheBase::fnv1a64(std::uint64_t value, std::uint64_t hash) {
-    unsigned char* bytes = reinterpret_cast<unsigned char*>(&value);
+unsigned CacheBase::FrequencySketch::estimate(std::uint64_t hash) const {
+    unsigned result = 0;
 
-    hash = (hash ^ bytes[0]) * fnv1Prime;
-    hash = (hash ^ bytes[1]) * fnv1Prime;
-    hash = (hash ^ bytes[2]) * fnv1Prime;
-    hash = (hash ^ bytes[3]) * fnv1Prime;
-    hash = (hash ^ bytes[4]) * fnv1Prime;
-    hash = (hash ^ bytes[5]) * fnv1Prime;
-    hash = (hash ^ bytes[6]) * fnv1Prime;
-    hash = (hash ^ bytes[7]) * fnv1Prime;
+    if (table != nullptr) {
+        result = maximumCount;
+        for (unsigned depth=0 ; depth<sketchDepth ; ++depth) {
+            std::uint64_t h     = counterHash(hash, depth);
+            unsigned      shift = static_cast<unsigned>((h >> 40) & 0x0F) * 4;
+            unsigned      count = static_cast<unsigned>((table[h & tableMask] >> shift) & 0x0F);
 
-    return hash;
+            if (count < result) {
+                result = count;
+            }
+        }
+    }
+
+    return result;
 }
 
 
-CacheBase::Index CacheBase::calculateCacheTableSize(Index requestedSize) {
-    return calculateNextPrime(requestedSize * cacheReservationMargin);
+void CacheBase::FrequencySketch::halveCounters() {
+    for (Index i=0 ; i<=tableMask ; ++i) {
+        table[i] = (table[i] >> 1) & 0x7777777777777777ULL;
+    }
+
+    numberAdditions /= 2;
 }
 
+/***********************************************************************************************************************
+* CacheBase
+*/
 
-bool CacheBase::isPrime(CacheBase::Index value) {
-    bool prime;
+CacheBase::CacheBase() {
+    for (unsigned i=0 ; i<(sizeof(seed)/sizeof(std::uint64_t)) ; ++i) {
+        seed[i] = QRandomGenerator::global()->generate64();
+    }
+}
 
-    if (value == 2 || value == 3) {
-        prime = true;
-    } else if (value < 5) {
-        prime = false;
-    } else {
-        unsigned long endingIndex = static_cast<unsigned long>(std::sqrt(value)) + 1;
-        unsigned long i           = 6;
 
-        prime = true;
-        while (prime && i <= endingIndex) {
-            prime = !divides(value, i - 1) && !divides(value, i + 1);
-            i += 6;
-        }
+CacheBase::~CacheBase() {}
+
+
+QString CacheBase::toString(CacheBase::EvictionPolicy evictionPolicy) {
+    QString result;
+    switch (evictionPolicy) {
+        case EvictionPolicy::RANDOM:          { result = QString("RANDOM");           break; }
+        case EvictionPolicy::CLOCK:           { result = QString("CLOCK");            break; }
+        case EvictionPolicy::APPROXIMATE_LRU: { result = QString("APPROXIMATE_LRU");  break; }
+        case EvictionPolicy::TINY_LFU:        { result = QString("TINY_LFU");         break; }
+        default:                              { Q_ASSERT(false);                      break; }
     }
 
-    return prime;
+    return result;
 }
 
 
-CacheBase::Index CacheBase::calculateNextPrime(Index value) {
-    Index nextPrime;
-    if (value < 5) {
-        if (value < 2) {
-            nextPrime = 2;
-        } else if (value < 3) {
-            nextPrime = 3;
-        } else {
-            nextPrime = 5;
-        }
+CacheBase::EvictionPolicy CacheBase::toEvictionPolicy(const QString& str, bool* success) {
+    bool           ok = true;
+    EvictionPolicy result;
+
+    QString s = str.trimmed().toLower().replace("-", "_");
+    if (s == "random") {
+        result = EvictionPolicy::RANDOM;
+    } else if (s == "clock") {
+        result = EvictionPolicy::CLOCK;
+    } else if (s == "approximate_lru" || s == "lru") {
+        result = EvictionPolicy::APPROXIMATE_LRU;
+    } else if (s == "tiny_lfu" || s == "tinylfu") {
+        result = EvictionPolicy::TINY_LFU;
     } else {
-        nextPrime = 0;
-
-        Index i  = 6UL * ((value + 2UL) / 6UL);
-        Index v1 = i - 1;
-        if (v1 > value && isPrime(v1)) {
-            nextPrime = v1;
-        } else {
-            Index v2 = i + 1;
-            if (v2 > value && isPrime(v2)) {
-                nextPrime = v2;
-            } else {
-                do {
-                    i += 6;
-                    v1 = i - 1;
-                    if (isPrime(v1)) {
-                        nextPrime = v1;
-                    } else {
-                        v2 = i + 1;
-                        if (isPrime(v2)) {
-                            nextPrime = v2;
-                        }
-                    }
-                } while (nextPrime == 0);
-            }
-        }
+        ok     = false;
+        result = EvictionPolicy::RANDOM;
+    }
+
+    if (success != nullptr) {
+        *success = ok;
+    }
+
+    return result;
+}
+
+
+std::uint64_t CacheBase::fnv1a8(std::uint8_t value, std::uint64_t hash) {
+    return (hash ^ value) * fnv1Prime;
+}
+
+
+CacheBase::Index CacheBase::calculateCacheTableSize(Index requestedSize) {
+    Index tableSize = groupWidth;
+    while (maximumTableLoad(tableSize) <= requestedSize) {
+        tableSize <<= 1;
     }
 
-    return nextPrime;
+    return tableSize;
 }
 
 
@@ -0,0 +1,335 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref CacheInvalidationBus class.
+***********************************************************************************************************************/
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QSqlDatabase>
+#include <QSqlError>
+
+#include <poll.h>
+#include <libpq-fe.h>
+
+#include "log.h"
+#include "metrics_registry.h"
+#include "database_manager.h"
+#include "sql_helpers.h"
+#include "cache_invalidation_bus.h"
+
+const char CacheInvalidationBus::defaultChannel[] = "dbc_invalidation";
+
+CacheInvalidationBus* CacheInvalidationBus::instance() {
+    static CacheInvalidationBus* cacheInvalidationBus = new CacheInvalidationBus;
+    return cacheInvalidationBus;
+}
+
+
+CacheInvalidationBus::CacheInvalidationBus() {
+    currentDatabaseManager = nullptr;
+    currentChannel         = QString(defaultChannel);
+    instanceId             = QString::number(QRandomGenerator::global()->generate64(), 16);
+    lastVersion            = 0;
+
+    running.storeRelease(0);
+    listening.storeRelease(0);
+
+    MetricsRegistry::instance()->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_cache_invalidation_listening"),
+        QString("Indicates if cache invalidation notifications are being received."),
+        QString(),
+        [this]() {
+            return static_cast<double>(listening.loadAcquire());
+        }
+    );
+}
+
+
+CacheInvalidationBus::~CacheInvalidationBus() {
+    stopBus();
+}
+
+
+void CacheInvalidationBus::startBus(DatabaseManager* databaseManager, const QString& channel) {
+    busMutex.lock();
+    bool restart = isRunning() && (databaseManager != currentDatabaseManager || channel != currentChannel);
+    busMutex.unlock();
+
+    if (restart) {
+        stopBus();
+    }
+
+    QMutexLocker locker(&busMutex);
+
+    currentDatabaseManager = databaseManager;
+    currentChannel         = channel;
+
+    running.storeRelease(1);
+
+    if (!isRunning()) {
+        start(QThread::LowPriority);
+    }
+}
+
+
+void CacheInvalidationBus::stopBus() {
+    running.storeRelease(0);
+
+    requestInterruption();
+    wait();
+
+    QMutexLocker locker(&busMutex);
+    pendingPayloads.clear();
+}
+
+
+void CacheInvalidationBus::registerHandler(const QString& table, const CacheInvalidationBus::Handler& handler) {
+    QMutexLocker locker(&busMutex);
+    handlers.insert(table, handler);
+}
+
+
+void CacheInvalidationBus::unregisterHandler(const QString& table) {
+    QMutexLocker locker(&busMutex);
+    handlers.remove(table);
+}
+
+
+void CacheInvalidationBus::publish(const QString& table, quint64 entryId) {
+    if (running.loadAcquire() != 0) {
+        QMutexLocker locker(&busMutex);
+
+        if (pendingPayloads.size() >= maximumPendingNotifications) {
+            // Other instances can no longer be told exactly what changed so tell them everything did.
+            QStringList tables = handlers.keys();
+            if (!tables.contains(table)) {
+                tables.append(table);
+            }
+
+            pendingPayloads.clear();
+            for (QStringList::const_iterator it=tables.constBegin(),end=tables.constEnd() ; it!=end ; ++it) {
+                ++lastVersion;
+                pendingPayloads.append(QString("%1:*:%2:%3").arg(*it, instanceId).arg(lastVersion));
+            }
+
+            logWrite(QString("Cache invalidation queue overflowed, invalidating all entries."), true);
+        } else {
+            ++lastVersion;
+            pendingPayloads.append(
+                QString("%1:%2:%3:%4")
+                .arg(table, entryId == allEntries ? QString("*") : QString::number(entryId), instanceId)
+                .arg(lastVersion)
+            );
+        }
+    }
+}
+
+
+void CacheInvalidationBus::run() {
+    busMutex.lock();
+    DatabaseManager* databaseManager = currentDatabaseManager;
+    QString          channel         = currentChannel;
+    busMutex.unlock();
+
+    bool listenedBefore = false;
+    while (!isInterruptionRequested()) {
+        QSqlDatabase database   = databaseManager->getDatabase();
+        pg_conn*     connection = database.isOpen() ? SqlHelpers::postgreSqlConnection(database) : nullptr;
+
+        if (connection != nullptr && listen(connection, channel)) {
+            listening.storeRelease(1);
+
+            // Anything changed while we were not listening is unknown.
+            if (listenedBefore) {
+                dispatchAll();
+            }
+
+            listenedBefore = true;
+
+            bool connected = true;
+            while (connected && !isInterruptionRequested()) {
+                connected = sendPending(connection, channel) && receive(connection);
+            }
+
+            listening.storeRelease(0);
+
+            if (!connected) {
+                logWrite(
+                    QString("Lost connection - CacheInvalidationBus::run: %1")
+                    .arg(QString::fromUtf8(PQerrorMessage(connection))),
+                    true
+                );
+            }
+        } else if (database.isOpen()) {
+            logWrite(QString("Failed LISTEN - CacheInvalidationBus::run: %1").arg(channel), true);
+        } else {
+            logWrite(
+                QString("Failed to open database - CacheInvalidationBus::run: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+
+        databaseManager->closeAndRelease(database);
+
+        unsigned long waited = 0;
+        while (waited < reconnectDelayMilliseconds && !isInterruptionRequested()) {
+            msleep(pollIntervalMilliseconds);
+            waited += pollIntervalMilliseconds;
+        }
+    }
+}
+
+
+bool CacheInvalidationBus::listen(pg_conn* connection, const QString& channel) {
+    bool       success     = false;
+    QByteArray channelUtf8 = channel.toUtf8();
+    char*      identifier  = PQescapeIdentifier(connection, channelUtf8.constData(), channelUtf8.size());
+
+    if (identifier != nullptr) {
+        PGresult* result = PQexec(connection, (QByteArray("LISTEN ") + identifier).constData());
+        success = (PQresultStatus(result) == PGRES_COMMAND_OK);
+
+        PQclear(result);
+        PQfreemem(identifier);
+    }
+
+    return success;
+}
+
+
+bool CacheInvalidationBus::receive(pg_conn* connection) {
+    bool success = true;
+
+    pollfd descriptor;
+    descriptor.fd      = PQsocket(connection);
+    descriptor.events  = POLLIN;
+    descriptor.revents = 0;
+
+    if (descriptor.fd < 0) {
+        success = false;
+    } else if (poll(&descriptor, 1, pollIntervalMilliseconds) > 0) {
+        success = (PQconsumeInput(connection) != 0);
+    }
+
+    // Executing statements can also queue notifications so we always drain the queue.
+    PGnotify* notification = PQnotifies(connection);
+    while (notification != nullptr) {
+        dispatch(QString::fromUtf8(notification->extra));
+        PQfreemem(notification);
+
+        notification = PQnotifies(connection);
+    }
+
+    return success && PQstatus(connection) == CONNECTION_OK;
+}
+
+
+bool CacheInvalidationBus::sendPending(pg_conn* connection, const QString& channel) {
+    busMutex.lock();
+    QStringList payloads;
+    payloads.swap(pendingPayloads);
+    busMutex.unlock();
+
+    bool       success     = true;
+    QByteArray channelUtf8 = channel.toUtf8();
+
+    QStringList::const_iterator it  = payloads.constBegin();
+    QStringList::const_iterator end = payloads.constEnd();
+    while (success && it != end) {
+        QByteArray  payloadUtf8 = it->toUtf8();
+        const char* values[2]   = { channelUtf8.constData(), payloadUtf8.constData() };
+
+        PGresult* result = PQexecParams(
+            connection,
+            "SELECT pg_notify($1, $2)",
+            2,
+            nullptr,
+            values,
+            nullptr,
+            nullptr,
+            0
+        );
+
+        success = (PQresultStatus(result) == PGRES_TUPLES_OK);
+        PQclear(result);
+
+        if (success) {
+            ++it;
+        }
+    }
+
+    if (!success) {
+        // Unsent notifications are retried once the connection is re-established.
+        QStringList unsent;
+        for (QStringList::const_iterator unsentIterator=it ; unsentIterator!=end ; ++unsentIterator) {
+            unsent.append(*unsentIterator);
+        }
+
+        QMutexLocker locker(&busMutex);
+        pendingPayloads = unsent + pendingPayloads;
+    }
+
+    return success;
+}
+
+
+void CacheInvalidationBus::dispatch(const QString& payload) {
+    QStringList fields = payload.split(QChar(':'));
+    if (fields.size() == 4 && fields.at(2) != instanceId) {
+        bool    versionOk;
+        quint64 version = fields.at(3).toULongLong(&versionOk);
+
+        bool    entryIdOk = true;
+        quint64 entryId   = fields.at(1) == QString("*") ? allEntries : fields.at(1).toULongLong(&entryIdOk);
+
+        if (versionOk && entryIdOk) {
+            QHash<QString, quint64>::iterator versionIterator = lastVersionByInstance.find(fields.at(2));
+            if (versionIterator == lastVersionByInstance.end() || version > versionIterator.value()) {
+                lastVersionByInstance.insert(fields.at(2), version);
+
+                busMutex.lock();
+                Handler handler = handlers.value(fields.at(0));
+                busMutex.unlock();
+
+                if (handler) {
+                    handler(entryId);
+                }
+            }
+        } else {
+            logWrite(QString("Invalid cache invalidation notification: %1").arg(payload), true);
+        }
+    }
+}
+
+
+void CacheInvalidationBus::dispatchAll() {
+    busMutex.lock();
+    QList<Handler> allHandlers = handlers.values();
+    busMutex.unlock();
+
+    for (QList<Handler>::const_iterator it=allHandlers.constBegin(),end=allHandlers.constEnd() ; it!=end ; ++it) {
+        (*it)(allEntries);
+    }
+}
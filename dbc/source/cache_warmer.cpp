@@ -0,0 +1,124 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref CacheWarmer class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include "log.h"
+#include "customer_secrets.h"
+#include "customers_capabilities.h"
+#include "cache_warmer.h"
+
+CacheWarmer::CacheWarmer(
+        CustomerSecrets*       customerSecrets,
+        CustomersCapabilities* customersCapabilities,
+        QObject*               parent
+    ):QThread(
+        parent
+    ),currentCustomerSecrets(
+        customerSecrets
+    ),currentCustomersCapabilities(
+        customersCapabilities
+    ) {
+    maximumNumberCustomerSecrets      = 0;
+    maximumNumberCustomerCapabilities = 0;
+
+    currentStatus.status                     = Status::IDLE;
+    currentStatus.numberCustomerSecrets      = 0;
+    currentStatus.numberCustomerCapabilities = 0;
+    currentStatus.elapsedMilliseconds        = 0;
+}
+
+
+CacheWarmer::~CacheWarmer() {
+    requestInterruption();
+    wait();
+}
+
+
+QString CacheWarmer::toString(CacheWarmer::Status status) {
+    QString result;
+    switch (status) {
+        case Status::IDLE:      { result = QString("IDLE");       break; }
+        case Status::RUNNING:   { result = QString("RUNNING");    break; }
+        case Status::COMPLETED: { result = QString("COMPLETED");  break; }
+        default:                { Q_ASSERT(false);                break; }
+    }
+
+    return result;
+}
+
+
+void CacheWarmer::startWarmUp(unsigned long numberCustomerSecrets, unsigned long numberCustomerCapabilities) {
+    QMutexLocker locker(&statusMutex);
+
+    if (currentStatus.status == Status::IDLE) {
+        maximumNumberCustomerSecrets      = numberCustomerSecrets;
+        maximumNumberCustomerCapabilities = numberCustomerCapabilities;
+        currentStatus.status              = Status::RUNNING;
+
+        start(QThread::LowPriority);
+    }
+}
+
+
+CacheWarmer::WarmUpStatus CacheWarmer::warmUpStatus() const {
+    QMutexLocker locker(&statusMutex);
+    return currentStatus;
+}
+
+
+void CacheWarmer::run() {
+    QElapsedTimer timer;
+    timer.start();
+
+    statusMutex.lock();
+    unsigned long numberCustomerSecrets      = maximumNumberCustomerSecrets;
+    unsigned long numberCustomerCapabilities = maximumNumberCustomerCapabilities;
+    statusMutex.unlock();
+
+    // Capabilities are loaded first as every authenticated customer request needs them.
+    unsigned long capabilitiesLoaded = currentCustomersCapabilities->warmCache(
+        numberCustomerCapabilities,
+        warmUpThreadId
+    );
+    unsigned long secretsLoaded = currentCustomerSecrets->warmCache(numberCustomerSecrets, warmUpThreadId);
+
+    unsigned long long elapsedMilliseconds = static_cast<unsigned long long>(timer.elapsed());
+
+    statusMutex.lock();
+    currentStatus.status                     = Status::COMPLETED;
+    currentStatus.numberCustomerSecrets      = secretsLoaded;
+    currentStatus.numberCustomerCapabilities = capabilitiesLoaded;
+    currentStatus.elapsedMilliseconds        = elapsedMilliseconds;
+    statusMutex.unlock();
+
+    logWrite(
+        QString("Cache warm-up completed: %1 customer secrets, %2 customer capabilities, %3 mSec.")
+        .arg(secretsLoaded)
+        .arg(capabilitiesLoaded)
+        .arg(elapsedMilliseconds),
+        false
+    );
+}
@@ -0,0 +1,1028 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This header implements the \ref Catalog class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QHash>
+#include <QMultiHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+
+#include "log.h"
+#include "database_manager.h"
+#include "host_scheme.h"
+#include "host_schemes.h"
+#include "monitor.h"
+#include "monitors.h"
+#include "string_pool.h"
+#include "scheme_host_path.h"
+#include "sql_helpers.h"
+#include "cache_invalidation_bus.h"
+#include "catalog.h"
+
+/***********************************************************************************************************************
+* Catalog::Snapshot
+*/
+
+Catalog::MonitorsById Catalog::Snapshot::monitorsByCustomerId(CustomerId customerId) const {
+    MonitorsById result;
+
+    const QSet<MonitorId> monitorIds = monitorIdsByCustomerId.value(customerId);
+    for (QSet<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        result.insert(*it, currentMonitorsById.value(*it));
+    }
+
+    return result;
+}
+
+
+Catalog::MonitorList Catalog::Snapshot::monitorsByUserOrder(CustomerId customerId) const {
+    MonitorList result;
+
+    const QSet<MonitorId> monitorIds = monitorIdsByCustomerId.value(customerId);
+    for (QSet<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        result.append(currentMonitorsById.value(*it));
+    }
+
+    sortByUserOrder(result);
+    return result;
+}
+
+
+Catalog::MonitorsBySchemeHostPath Catalog::Snapshot::monitorsBySchemeHostPath(CustomerId customerId) const {
+    MonitorsBySchemeHostPath result;
+
+    const QSet<MonitorId> monitorIds = monitorIdsByCustomerId.value(customerId);
+    for (QSet<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        const Monitor& monitor = currentMonitorsById.constFind(*it).value();
+        result.insert(SchemeHostPath(monitor.hostSchemeId(), monitor.path()), monitor);
+    }
+
+    return result;
+}
+
+
+Catalog::MonitorList Catalog::Snapshot::monitorsAt(const SchemeHostPath& schemeHostPath) const {
+    MonitorList result;
+
+    QMultiHash<SchemeHostPath, MonitorId>::const_iterator it  = monitorIdsBySchemeHostPath.constFind(schemeHostPath);
+    QMultiHash<SchemeHostPath, MonitorId>::const_iterator end = monitorIdsBySchemeHostPath.constEnd();
+    while (it != end && it.key() == schemeHostPath) {
+        result.append(currentMonitorsById.value(it.value()));
+        ++it;
+    }
+
+    return result;
+}
+
+
+Catalog::MonitorList Catalog::Snapshot::monitorsUnderHostScheme(HostSchemeId hostSchemeId) const {
+    MonitorList result;
+
+    const QSet<MonitorId> monitorIds = monitorIdsByHostSchemeId.value(hostSchemeId);
+    for (QSet<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        result.append(currentMonitorsById.value(*it));
+    }
+
+    sortByUserOrder(result);
+    return result;
+}
+
+
+Catalog::HostSchemesById Catalog::Snapshot::hostSchemesByCustomerId(CustomerId customerId) const {
+    HostSchemesById result;
+
+    const QSet<HostSchemeId> hostSchemeIds = hostSchemeIdsByCustomerId.value(customerId);
+    for (  QSet<HostSchemeId>::const_iterator it  = hostSchemeIds.constBegin(),
+                                              end = hostSchemeIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        result.insert(*it, currentHostSchemesById.value(*it));
+    }
+
+    return result;
+}
+
+
+void Catalog::Snapshot::insertMonitor(const Monitor& monitor) {
+    MonitorId monitorId = monitor.monitorId();
+
+    removeMonitor(monitorId);
+
+    currentMonitorsById.insert(monitorId, monitor);
+    monitorIdsByCustomerId[monitor.customerId()].insert(monitorId);
+    monitorIdsByHostSchemeId[monitor.hostSchemeId()].insert(monitorId);
+    monitorIdsBySchemeHostPath.insert(SchemeHostPath(monitor.hostSchemeId(), monitor.path()), monitorId);
+}
+
+
+void Catalog::Snapshot::removeMonitor(MonitorId monitorId) {
+    MonitorsById::iterator it = currentMonitorsById.find(monitorId);
+    if (it != currentMonitorsById.end()) {
+        const Monitor& monitor = it.value();
+
+        QHash<CustomerId, QSet<MonitorId>>::iterator customerIt = monitorIdsByCustomerId.find(monitor.customerId());
+        if (customerIt != monitorIdsByCustomerId.end()) {
+            customerIt.value().remove(monitorId);
+            if (customerIt.value().isEmpty()) {
+                monitorIdsByCustomerId.erase(customerIt);
+            }
+        }
+
+        QHash<HostSchemeId, QSet<MonitorId>>::iterator hostSchemeIt = monitorIdsByHostSchemeId.find(
+            monitor.hostSchemeId()
+        );
+        if (hostSchemeIt != monitorIdsByHostSchemeId.end()) {
+            hostSchemeIt.value().remove(monitorId);
+            if (hostSchemeIt.value().isEmpty()) {
+                monitorIdsByHostSchemeId.erase(hostSchemeIt);
+            }
+        }
+
+        monitorIdsBySchemeHostPath.remove(SchemeHostPath(monitor.hostSchemeId(), monitor.path()), monitorId);
+        currentMonitorsById.erase(it);
+    }
+}
+
+
+void Catalog::Snapshot::insertHostScheme(const HostScheme& hostScheme) {
+    HostSchemeId hostSchemeId = hostScheme.hostSchemeId();
+
+    HostSchemesById::const_iterator it = currentHostSchemesById.constFind(hostSchemeId);
+    if (it != currentHostSchemesById.constEnd() && it.value().customerId() != hostScheme.customerId()) {
+        CustomerId oldCustomerId = it.value().customerId();
+        QSet<HostSchemeId>& oldCustomerHostSchemeIds = hostSchemeIdsByCustomerId[oldCustomerId];
+
+        oldCustomerHostSchemeIds.remove(hostSchemeId);
+        if (oldCustomerHostSchemeIds.isEmpty()) {
+            hostSchemeIdsByCustomerId.remove(oldCustomerId);
+        }
+    }
+
+    currentHostSchemesById.insert(hostSchemeId, hostScheme);
+    hostSchemeIdsByCustomerId[hostScheme.customerId()].insert(hostSchemeId);
+}
+
+
+void Catalog::Snapshot::removeHostScheme(HostSchemeId hostSchemeId) {
+    // Mirrors the ON DELETE CASCADE constraint on the monitor table.
+    const QSet<MonitorId> monitorIds = monitorIdsByHostSchemeId.value(hostSchemeId);
+    for (QSet<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        removeMonitor(*it);
+    }
+
+    HostSchemesById::iterator it = currentHostSchemesById.find(hostSchemeId);
+    if (it != currentHostSchemesById.end()) {
+        CustomerId                                      customerId = it.value().customerId();
+        QHash<CustomerId, QSet<HostSchemeId>>::iterator customerIt = hostSchemeIdsByCustomerId.find(customerId);
+        if (customerIt != hostSchemeIdsByCustomerId.end()) {
+            customerIt.value().remove(hostSchemeId);
+            if (customerIt.value().isEmpty()) {
+                hostSchemeIdsByCustomerId.erase(customerIt);
+            }
+        }
+
+        currentHostSchemesById.erase(it);
+    }
+}
+
+
+void Catalog::Snapshot::removeCustomerMonitors(CustomerId customerId) {
+    const QSet<MonitorId> monitorIds = monitorIdsByCustomerId.value(customerId);
+    for (QSet<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        removeMonitor(*it);
+    }
+}
+
+
+void Catalog::Snapshot::removeCustomerHostSchemes(CustomerId customerId) {
+    const QSet<HostSchemeId> hostSchemeIds = hostSchemeIdsByCustomerId.value(customerId);
+    for (  QSet<HostSchemeId>::const_iterator it  = hostSchemeIds.constBegin(),
+                                              end = hostSchemeIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        removeHostScheme(*it);
+    }
+}
+
+
+void Catalog::Snapshot::sortByUserOrder(MonitorList& monitors) {
+    std::sort(
+        monitors.begin(),
+        monitors.end(),
+        [](const Monitor& a, const Monitor& b) {
+            return (
+                   a.userOrdering() < b.userOrdering()
+                || (a.userOrdering() == b.userOrdering() && a.monitorId() < b.monitorId())
+            );
+        }
+    );
+}
+
+/***********************************************************************************************************************
+* Catalog
+*/
+
+const unsigned Catalog::defaultReconcileIntervalSeconds = 15 * 60;
+const char     Catalog::snapshotFileMagic[8]            = { 'D', 'B', 'C', 'C', 'A', 'T', 'L', 'G' };
+const quint32  Catalog::snapshotFileEndMarker           = 0x5AA5C33C;
+const quint32  Catalog::snapshotFileVersion             = 1;
+const char     Catalog::invalidationTable[]             = "catalog";
+
+Catalog::Catalog(
+        DatabaseManager* databaseManager,
+        QObject*         parent
+    ):QObject(
+        parent
+    ),currentDatabaseManager(
+        databaseManager
+    ) {
+    currentSnapshot                      = std::make_shared<const Snapshot>();
+    reconcileInProgress                  = false;
+    restoredPendingReconcile             = 0;
+    numberPendingChanges                 = 0;
+    invalidated                          = 0;
+    currentReconcileIntervalMilliseconds = 1000LL * defaultReconcileIntervalSeconds;
+    lastCustomerVersion                  = static_cast<unsigned long long>(QDateTime::currentMSecsSinceEpoch());
+    allCustomersVersion                  = lastCustomerVersion;
+
+    timeSinceReconcile.invalidate();
+}
+
+
+Catalog::~Catalog() {}
+
+
+Catalog::SnapshotPointer Catalog::snapshot(unsigned threadId) {
+    if (needsReconcile()) {
+        if (!std::atomic_load(&currentSnapshot)->isLoaded()) {
+            // Nothing useful to hand out yet so wait for whichever thread is loading the catalog.
+            QMutexLocker reconcileMutexLocker(&reconcileMutex);
+            if (needsReconcile() && restoredPendingReconcile.loadAcquire() == 0) {
+                reconcile(threadId);
+            }
+        } else if (restoredPendingReconcile.loadAcquire() == 0 && reconcileMutex.tryLock()) {
+            // A restored snapshot is brought up to date by Catalog::reconcileNow so requests are not held up.
+            if (needsReconcile()) {
+                reconcile(threadId);
+            }
+
+            reconcileMutex.unlock();
+        }
+    }
+
+    if (numberPendingChanges.loadAcquire() != 0) {
+        QMutexLocker writerMutexLocker(&writerMutex);
+        applyPendingChanges();
+    }
+
+    return std::atomic_load(&currentSnapshot);
+}
+
+
+void Catalog::updateMonitor(const Monitor& monitor) {
+    queueChange(Change(monitor));
+    customerChanged(monitor.customerId());
+    CacheInvalidationBus::instance()->publish(invalidationTable, monitor.customerId());
+}
+
+
+void Catalog::removeMonitor(MonitorId monitorId) {
+    SnapshotPointer              snapshot = std::atomic_load(&currentSnapshot);
+    MonitorsById::const_iterator it       = snapshot->monitorsById().constFind(monitorId);
+
+    queueChange(Change(Change::Type::REMOVE_MONITOR, monitorId));
+
+    if (it != snapshot->monitorsById().constEnd()) {
+        customerChanged(it.value().customerId());
+        CacheInvalidationBus::instance()->publish(invalidationTable, it.value().customerId());
+    } else {
+        allCustomersChanged();
+        CacheInvalidationBus::instance()->publish(invalidationTable);
+    }
+}
+
+
+void Catalog::removeCustomerMonitors(CustomerId customerId) {
+    queueChange(Change(Change::Type::REMOVE_CUSTOMER_MONITORS, customerId));
+    customerChanged(customerId);
+    CacheInvalidationBus::instance()->publish(invalidationTable, customerId);
+}
+
+
+void Catalog::updateHostScheme(const HostScheme& hostScheme) {
+    queueChange(Change(hostScheme));
+    customerChanged(hostScheme.customerId());
+    CacheInvalidationBus::instance()->publish(invalidationTable, hostScheme.customerId());
+}
+
+
+void Catalog::removeHostScheme(HostSchemeId hostSchemeId) {
+    SnapshotPointer                 snapshot = std::atomic_load(&currentSnapshot);
+    HostSchemesById::const_iterator it       = snapshot->hostSchemesById().constFind(hostSchemeId);
+
+    queueChange(Change(Change::Type::REMOVE_HOST_SCHEME, hostSchemeId));
+
+    if (it != snapshot->hostSchemesById().constEnd()) {
+        customerChanged(it.value().customerId());
+        CacheInvalidationBus::instance()->publish(invalidationTable, it.value().customerId());
+    } else {
+        allCustomersChanged();
+        CacheInvalidationBus::instance()->publish(invalidationTable);
+    }
+}
+
+
+void Catalog::removeCustomerHostSchemes(CustomerId customerId) {
+    queueChange(Change(Change::Type::REMOVE_CUSTOMER_HOST_SCHEMES, customerId));
+    customerChanged(customerId);
+    CacheInvalidationBus::instance()->publish(invalidationTable, customerId);
+}
+
+
+void Catalog::invalidate() {
+    invalidated.storeRelease(1);
+    allCustomersChanged();
+}
+
+
+void Catalog::setReconcileInterval(unsigned reconcileIntervalSeconds) {
+    QMutexLocker writerMutexLocker(&writerMutex);
+    currentReconcileIntervalMilliseconds = 1000LL * reconcileIntervalSeconds;
+}
+
+
+bool Catalog::saveSnapshot(const QString& filename) {
+    writerMutex.lock();
+    applyPendingChanges();
+    SnapshotPointer snapshot = std::atomic_load(&currentSnapshot);
+    writerMutex.unlock();
+
+    bool success = snapshot->isLoaded();
+    if (success) {
+        Fingerprint snapshotFingerprint = fingerprint(*snapshot);
+
+        QSaveFile file(filename);
+        success = file.open(QFile::WriteOnly);
+        if (success) {
+            QDataStream stream(&file);
+            stream.setVersion(QDataStream::Qt_5_0);
+
+            stream.writeRawData(snapshotFileMagic, sizeof(snapshotFileMagic));
+            stream << snapshotFileVersion
+                   << static_cast<qint64>(QDateTime::currentMSecsSinceEpoch())
+                   << snapshotFingerprint.numberHostSchemes
+                   << snapshotFingerprint.maximumHostSchemeId
+                   << snapshotFingerprint.numberMonitors
+                   << snapshotFingerprint.maximumMonitorId;
+
+            writeSnapshotEntries(stream, *snapshot);
+            stream << snapshotFileEndMarker;
+
+            success = (stream.status() == QDataStream::Ok && file.commit());
+        }
+
+        if (!success) {
+            logWrite(QString("Could not write catalog snapshot %1: %2").arg(filename, file.errorString()), true);
+        }
+    }
+
+    return success;
+}
+
+
+bool Catalog::restoreSnapshot(const QString& filename, unsigned threadId) {
+    QMutexLocker reconcileMutexLocker(&reconcileMutex);
+
+    QFile file(filename);
+    bool  success = !std::atomic_load(&currentSnapshot)->isLoaded() && file.open(QFile::ReadOnly);
+
+    qint64 fileSize = success ? file.size() : 0;
+    uchar* mapping  = nullptr;
+    if (success) {
+        mapping = file.map(0, fileSize);
+        success = (mapping != nullptr);
+
+        if (!success) {
+            logWrite(QString("Could not map catalog snapshot %1: %2").arg(filename, file.errorString()), true);
+        }
+    }
+
+    Snapshot snapshot;
+    qint64   savedAt = 0;
+    if (success) {
+        // Strings are copied by the stream so the mapping only needs to outlive the stream.
+        QByteArray data = QByteArray::fromRawData(
+            reinterpret_cast<const char*>(mapping),
+            static_cast<int>(std::min(fileSize, static_cast<qint64>(INT_MAX)))
+        );
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        char        magic[sizeof(snapshotFileMagic)];
+        quint32     version = 0;
+        Fingerprint fileFingerprint;
+
+        success = (
+               stream.readRawData(magic, sizeof(magic)) == static_cast<int>(sizeof(magic))
+            && std::memcmp(magic, snapshotFileMagic, sizeof(snapshotFileMagic)) == 0
+        );
+
+        if (success) {
+            stream >> version
+                   >> savedAt
+                   >> fileFingerprint.numberHostSchemes
+                   >> fileFingerprint.maximumHostSchemeId
+                   >> fileFingerprint.numberMonitors
+                   >> fileFingerprint.maximumMonitorId;
+
+            success = (stream.status() == QDataStream::Ok && version == snapshotFileVersion);
+        }
+
+        if (success) {
+            // Checking the database first lets us skip decoding a file that no longer matches.
+            Fingerprint currentFingerprint;
+            success = databaseFingerprint(currentFingerprint, threadId);
+            if (success && !(currentFingerprint == fileFingerprint)) {
+                logWrite(QString("Ignoring stale catalog snapshot %1").arg(filename), false);
+                success = false;
+            }
+        } else {
+            logWrite(QString("Ignoring invalid catalog snapshot %1").arg(filename), true);
+        }
+
+        if (success) {
+            quint32 endMarker = 0;
+
+            success = readSnapshotEntries(stream, fileFingerprint, snapshot);
+            if (success) {
+                stream >> endMarker;
+                success = (
+                       stream.status() == QDataStream::Ok
+                    && endMarker == snapshotFileEndMarker
+                    && fingerprint(snapshot) == fileFingerprint
+                );
+            }
+
+            if (!success) {
+                logWrite(QString("Ignoring corrupt catalog snapshot %1").arg(filename), true);
+            }
+        }
+
+        file.unmap(mapping);
+    }
+
+    if (success) {
+        QMutexLocker writerMutexLocker(&writerMutex);
+
+        // Every change is idempotent so anything recorded before the restore is simply applied on top.
+        applyChanges(snapshot, pendingChanges);
+        snapshot.currentVersion = std::atomic_load(&currentSnapshot)->version() + 1;
+
+        std::atomic_store(&currentSnapshot, SnapshotPointer(std::make_shared<const Snapshot>(snapshot)));
+
+        pendingChanges.clear();
+        numberPendingChanges.storeRelease(0);
+        restoredPendingReconcile.storeRelease(1);
+
+        logWrite(
+            QString("Restored catalog snapshot %1: %2 host/schemes, %3 monitors, saved %4 seconds ago.")
+            .arg(filename)
+            .arg(snapshot.hostSchemesById().size())
+            .arg(snapshot.monitorsById().size())
+            .arg((QDateTime::currentMSecsSinceEpoch() - savedAt) / 1000),
+            false
+        );
+    }
+
+    return success;
+}
+
+
+bool Catalog::reconcileNow(unsigned threadId) {
+    QMutexLocker reconcileMutexLocker(&reconcileMutex);
+
+    bool success = reconcile(threadId);
+    restoredPendingReconcile.storeRelease(0);
+
+    return success;
+}
+
+
+bool Catalog::reloadCustomer(CustomerId customerId, unsigned threadId) {
+    QList<Change> changes;
+    changes.append(Change(Change::Type::REMOVE_CUSTOMER_HOST_SCHEMES, customerId));
+    changes.append(Change(Change::Type::REMOVE_CUSTOMER_MONITORS, customerId));
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        success = SqlHelpers::execute(
+            query,
+            QString("SELECT * FROM host_scheme WHERE customer_id = %1").arg(customerId)
+        );
+        if (success) {
+            while (success && query.next()) {
+                HostScheme hostScheme = HostSchemes::convertQueryToHostScheme(query, &success);
+                if (success) {
+                    changes.append(Change(hostScheme));
+                }
+            }
+
+            if (success) {
+                success = SqlHelpers::execute(
+                    query,
+                    QString("SELECT * FROM monitor WHERE customer_id = %1").arg(customerId)
+                );
+                if (success) {
+                    while (success && query.next()) {
+                        Monitor monitor = Monitors::convertQueryToMonitor(query, &success);
+                        if (success) {
+                            changes.append(Change(monitor));
+                        }
+                    }
+
+                    if (!success) {
+                        logWrite(QString("Invalid monitor - Catalog::reloadCustomer"), true);
+                    }
+                } else {
+                    logWrite(
+                        QString("Failed SELECT - Catalog::reloadCustomer: %1").arg(query.lastError().text()),
+                        true
+                    );
+                }
+            } else {
+                logWrite(QString("Invalid host/scheme - Catalog::reloadCustomer"), true);
+            }
+        } else {
+            logWrite(QString("Failed SELECT - Catalog::reloadCustomer: %1").arg(query.lastError().text()), true);
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Catalog::reloadCustomer: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    if (success) {
+        // Queued together so no reader sees the customer with only some of its entries.
+        QMutexLocker writerMutexLocker(&writerMutex);
+
+        pendingChanges.append(changes);
+        numberPendingChanges.storeRelease(pendingChanges.size());
+
+        if (reconcileInProgress) {
+            changesDuringReconcile.append(changes);
+        }
+
+        writerMutexLocker.unlock();
+        customerChanged(customerId);
+    } else {
+        invalidate();
+    }
+
+    return success;
+}
+
+
+unsigned long long Catalog::customerVersion(CustomerId customerId) const {
+    QMutexLocker customerVersionMutexLocker(&customerVersionMutex);
+    return std::max(customerVersions.value(customerId, 0), allCustomersVersion);
+}
+
+
+void Catalog::customerChanged(CustomerId customerId) {
+    QMutexLocker customerVersionMutexLocker(&customerVersionMutex);
+    ++lastCustomerVersion;
+    customerVersions.insert(customerId, lastCustomerVersion);
+    customerVersionChanged.wakeAll();
+}
+
+
+unsigned long long Catalog::waitForCustomerChange(
+        CustomerId         customerId,
+        unsigned long long knownVersion,
+        unsigned long      timeoutMilliseconds
+    ) const {
+    QMutexLocker customerVersionMutexLocker(&customerVersionMutex);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    unsigned long long result  = std::max(customerVersions.value(customerId, 0), allCustomersVersion);
+    qint64             elapsed = 0;
+    while (result == knownVersion && elapsed < static_cast<qint64>(timeoutMilliseconds)) {
+        customerVersionChanged.wait(
+            &customerVersionMutex,
+            static_cast<unsigned long>(static_cast<qint64>(timeoutMilliseconds) - elapsed)
+        );
+
+        result  = std::max(customerVersions.value(customerId, 0), allCustomersVersion);
+        elapsed = timer.elapsed();
+    }
+
+    return result;
+}
+
+
+void Catalog::allCustomersChanged() {
+    QMutexLocker customerVersionMutexLocker(&customerVersionMutex);
+    ++lastCustomerVersion;
+    allCustomersVersion = lastCustomerVersion;
+    customerVersions.clear();
+    customerVersionChanged.wakeAll();
+}
+
+
+Catalog::Fingerprint Catalog::fingerprint(const Catalog::Snapshot& snapshot) {
+    Fingerprint result;
+
+    const HostSchemesById& hostSchemesById = snapshot.hostSchemesById();
+    for (  HostSchemesById::const_iterator it  = hostSchemesById.constBegin(),
+                                           end = hostSchemesById.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        result.maximumHostSchemeId = std::max(result.maximumHostSchemeId, static_cast<quint64>(it.key()));
+    }
+
+    const MonitorsById& monitorsById = snapshot.monitorsById();
+    for (MonitorsById::const_iterator it=monitorsById.constBegin(),end=monitorsById.constEnd() ; it!=end ; ++it) {
+        result.maximumMonitorId = std::max(result.maximumMonitorId, static_cast<quint64>(it.key()));
+    }
+
+    result.numberHostSchemes = static_cast<quint64>(hostSchemesById.size());
+    result.numberMonitors    = static_cast<quint64>(monitorsById.size());
+
+    return result;
+}
+
+
+bool Catalog::databaseFingerprint(Catalog::Fingerprint& result, unsigned threadId) {
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        success = SqlHelpers::execute(
+            query,
+            "SELECT "
+                "(SELECT COUNT(*) FROM host_scheme), "
+                "(SELECT COALESCE(MAX(host_scheme_id), 0) FROM host_scheme), "
+                "(SELECT COUNT(*) FROM monitor), "
+                "(SELECT COALESCE(MAX(monitor_id), 0) FROM monitor)"
+        );
+
+        if (success && query.next()) {
+            result.numberHostSchemes = query.value(0).toULongLong(&success);
+            if (success) {
+                result.maximumHostSchemeId = query.value(1).toULongLong(&success);
+            }
+
+            if (success) {
+                result.numberMonitors = query.value(2).toULongLong(&success);
+            }
+
+            if (success) {
+                result.maximumMonitorId = query.value(3).toULongLong(&success);
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - Catalog::databaseFingerprint: %1").arg(query.lastError().text()),
+                true
+            );
+            success = false;
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Catalog::databaseFingerprint: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+void Catalog::writeSnapshotEntries(QDataStream& stream, const Catalog::Snapshot& snapshot) {
+    const HostSchemesById& hostSchemesById = snapshot.hostSchemesById();
+    for (  HostSchemesById::const_iterator it  = hostSchemesById.constBegin(),
+                                           end = hostSchemesById.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        const HostScheme& hostScheme = it.value();
+        stream << static_cast<quint32>(hostScheme.hostSchemeId())
+               << static_cast<quint32>(hostScheme.customerId())
+               << hostScheme.url()
+               << static_cast<quint64>(hostScheme.sslExpirationTimestamp());
+    }
+
+    const MonitorsById& monitorsById = snapshot.monitorsById();
+    for (MonitorsById::const_iterator it=monitorsById.constBegin(),end=monitorsById.constEnd() ; it!=end ; ++it) {
+        const Monitor& monitor = it.value();
+        stream << static_cast<quint32>(monitor.monitorId())
+               << static_cast<quint32>(monitor.customerId())
+               << static_cast<quint32>(monitor.hostSchemeId())
+               << static_cast<quint16>(monitor.userOrdering())
+               << monitor.path()
+               << static_cast<quint8>(monitor.method())
+               << static_cast<quint8>(monitor.contentCheckMode())
+               << monitor.keywordBlob()
+               << static_cast<quint8>(monitor.contentType())
+               << monitor.userAgent()
+               << monitor.compressedPostContent();
+    }
+}
+
+
+bool Catalog::readSnapshotEntries(
+        QDataStream&                stream,
+        const Catalog::Fingerprint& fileFingerprint,
+        Catalog::Snapshot&          snapshot
+    ) {
+    bool    success = true;
+    quint64 index   = 0;
+    while (success && index < fileFingerprint.numberHostSchemes) {
+        quint32 hostSchemeId;
+        quint32 customerId;
+        QUrl    url;
+        quint64 sslExpirationTimestamp;
+
+        stream >> hostSchemeId >> customerId >> url >> sslExpirationTimestamp;
+
+        success = (stream.status() == QDataStream::Ok && hostSchemeId != HostScheme::invalidHostSchemeId);
+        if (success) {
+            snapshot.insertHostScheme(HostScheme(hostSchemeId, customerId, url, sslExpirationTimestamp));
+        }
+
+        ++index;
+    }
+
+    index = 0;
+    while (success && index < fileFingerprint.numberMonitors) {
+        quint32    monitorId;
+        quint32    customerId;
+        quint32    hostSchemeId;
+        quint16    userOrdering;
+        QString    path;
+        quint8     method;
+        quint8     contentCheckMode;
+        QByteArray keywordBlob;
+        quint8     contentType;
+        QString    userAgent;
+        QByteArray compressedPostContent;
+
+        stream >> monitorId
+               >> customerId
+               >> hostSchemeId
+               >> userOrdering
+               >> path
+               >> method
+               >> contentCheckMode
+               >> keywordBlob
+               >> contentType
+               >> userAgent
+               >> compressedPostContent;
+
+        success = (
+               stream.status() == QDataStream::Ok
+            && monitorId != Monitor::invalidMonitorId
+            && method <= static_cast<quint8>(Monitor::Method::PATCH)
+            && contentCheckMode <= static_cast<quint8>(Monitor::ContentCheckMode::SMART_CONTENT_MATCH)
+            && contentType <= static_cast<quint8>(Monitor::ContentType::TEXT)
+            && Monitor::isValidKeywordBlob(keywordBlob)
+        );
+
+        if (success) {
+            // As with Monitors::convertQueryToMonitor, the keyword blob and compressed POST content are adopted
+            // as stored.
+            Monitor monitor(
+                monitorId,
+                customerId,
+                hostSchemeId,
+                userOrdering,
+                path,
+                static_cast<Monitor::Method>(method),
+                static_cast<Monitor::ContentCheckMode>(contentCheckMode),
+                Monitor::KeywordList(),
+                static_cast<Monitor::ContentType>(contentType),
+                userAgent,
+                QByteArray()
+            );
+
+            monitor.currentKeywords = keywordBlob;
+            monitor.setCompressedPostContent(compressedPostContent);
+
+            snapshot.insertMonitor(monitor);
+        }
+
+        ++index;
+    }
+
+    return success;
+}
+
+
+bool Catalog::needsReconcile() const {
+    QMutexLocker writerMutexLocker(&writerMutex);
+    return (
+           invalidated.loadAcquire() != 0
+        || !timeSinceReconcile.isValid()
+        || timeSinceReconcile.hasExpired(currentReconcileIntervalMilliseconds)
+    );
+}
+
+
+bool Catalog::reconcile(unsigned threadId) {
+    writerMutex.lock();
+    reconcileInProgress = true;
+    changesDuringReconcile.clear();
+    invalidated.storeRelease(0);
+    writerMutex.unlock();
+
+    // Strings held only by the pool belong to monitors from snapshots that have since been released.
+    StringPool::purge();
+
+    Snapshot snapshot;
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        success = SqlHelpers::execute(query, "SELECT * FROM host_scheme");
+        if (success) {
+            while (success && query.next()) {
+                HostScheme hostScheme = HostSchemes::convertQueryToHostScheme(query, &success);
+                if (success) {
+                    snapshot.insertHostScheme(hostScheme);
+                }
+            }
+
+            if (success) {
+                success = SqlHelpers::execute(query, "SELECT * FROM monitor");
+                if (success) {
+                    while (success && query.next()) {
+                        Monitor monitor = Monitors::convertQueryToMonitor(query, &success);
+                        if (success) {
+                            snapshot.insertMonitor(monitor);
+                        }
+                    }
+
+                    if (!success) {
+                        logWrite(QString("Invalid monitor - Catalog::reconcile"), true);
+                    }
+                } else {
+                    logWrite(QString("Failed SELECT - Catalog::reconcile: %1").arg(query.lastError().text()), true);
+                }
+            } else {
+                logWrite(QString("Invalid host/scheme - Catalog::reconcile"), true);
+            }
+        } else {
+            logWrite(QString("Failed SELECT - Catalog::reconcile: %1").arg(query.lastError().text()), true);
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Catalog::reconcile: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    QMutexLocker writerMutexLocker(&writerMutex);
+    reconcileInProgress = false;
+
+    if (success) {
+        // Changes queued while we were reading may or may not be reflected in the results.  Every change is
+        // idempotent so we simply apply them again, in order.
+        applyChanges(snapshot, changesDuringReconcile);
+        snapshot.currentVersion = std::atomic_load(&currentSnapshot)->version() + 1;
+
+        std::atomic_store(&currentSnapshot, SnapshotPointer(std::make_shared<const Snapshot>(snapshot)));
+
+        pendingChanges.clear();
+        numberPendingChanges.storeRelease(0);
+        timeSinceReconcile.start();
+    } else {
+        invalidated.storeRelease(1);
+    }
+
+    changesDuringReconcile.clear();
+
+    return success;
+}
+
+
+void Catalog::queueChange(const Change& change) {
+    QMutexLocker writerMutexLocker(&writerMutex);
+
+    pendingChanges.append(change);
+    numberPendingChanges.storeRelease(pendingChanges.size());
+
+    if (reconcileInProgress) {
+        changesDuringReconcile.append(change);
+    }
+}
+
+
+void Catalog::applyChanges(Catalog::Snapshot& snapshot, const QList<Catalog::Change>& changes) {
+    for (QList<Change>::const_iterator it=changes.constBegin(),end=changes.constEnd() ; it!=end ; ++it) {
+        switch (it->type) {
+            case Change::Type::UPDATE_MONITOR: {
+                snapshot.insertMonitor(it->monitor);
+                break;
+            }
+
+            case Change::Type::REMOVE_MONITOR: {
+                snapshot.removeMonitor(static_cast<MonitorId>(it->id));
+                break;
+            }
+
+            case Change::Type::REMOVE_CUSTOMER_MONITORS: {
+                snapshot.removeCustomerMonitors(static_cast<CustomerId>(it->id));
+                break;
+            }
+
+            case Change::Type::UPDATE_HOST_SCHEME: {
+                snapshot.insertHostScheme(it->hostScheme);
+                break;
+            }
+
+            case Change::Type::REMOVE_HOST_SCHEME: {
+                snapshot.removeHostScheme(static_cast<HostSchemeId>(it->id));
+                break;
+            }
+
+            case Change::Type::REMOVE_CUSTOMER_HOST_SCHEMES: {
+                snapshot.removeCustomerHostSchemes(static_cast<CustomerId>(it->id));
+                break;
+            }
+        }
+    }
+}
+
+
+void Catalog::applyPendingChanges() {
+    if (!pendingChanges.isEmpty()) {
+        SnapshotPointer oldSnapshot = std::atomic_load(&currentSnapshot);
+
+        // Changes applied before the catalog is first loaded would be lost by the load so we keep the snapshot
+        // empty until then.  The load reads the committed changes directly from the database.
+        if (oldSnapshot->isLoaded()) {
+            Snapshot snapshot(*oldSnapshot);
+            applyChanges(snapshot, pendingChanges);
+            snapshot.currentVersion = oldSnapshot->version() + 1;
+
+            std::atomic_store(&currentSnapshot, SnapshotPointer(std::make_shared<const Snapshot>(snapshot)));
+        }
+
+        pendingChanges.clear();
+        numberPendingChanges.storeRelease(0);
+    }
+}
@@ -28,6 +28,7 @@
 #include "customer_secrets.h"
 #include "customer_capabilities.h"
 #include "customers_capabilities.h"
+#include "request_tracer.h"
 #include "customer_authenticator.h"
 
 CustomerAuthenticator::CustomerAuthenticator(
@@ -50,7 +51,8 @@ CustomerAuthenticator::~CustomerAuthenticator() {}
 
 
 unsigned long CustomerAuthenticator::customerId(const QString& customerIdentifier, unsigned threadId) {
-    unsigned long customerId = 0;
+    RequestTracer::Span authenticationSpan(RequestTracer::Phase::AUTHENTICATION, threadId);
+    unsigned long       customerId = 0;
 
     bool          ok;
     std::uint64_t identifierValue = customerIdentifier.toULongLong(&ok, 16);
@@ -79,6 +81,8 @@ unsigned long CustomerAuthenticator::customerId(const QString& customerIdentifie
 
 
 QByteArray CustomerAuthenticator::customerSecret(unsigned long customerId, unsigned threadId) {
+    RequestTracer::Span authenticationSpan(RequestTracer::Phase::AUTHENTICATION, threadId);
+
     CustomerSecret secret = customerSecrets->getCustomerSecret(
         static_cast<CustomerCapabilities::CustomerId>(customerId),
         false,
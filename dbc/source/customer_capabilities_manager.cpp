@@ -23,13 +23,17 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QJsonArray>
 
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 
+#include "cache_base.h"
+#include "cache_warmer.h"
 #include "customer_secrets.h"
 #include "server_administrator.h"
 #include "customers_capabilities.h"
+#include "job_scheduler.h"
 #include "customer_capabilities_manager.h"
 
 /***********************************************************************************************************************
@@ -375,17 +379,30 @@ RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCapabilitiesDelet
 * CustomerCapabilitiesManager::CustomerCapabilitiesPurge
 */
 
+const QString CustomerCapabilitiesManager::CustomerCapabilitiesPurge::purgeJobType("customer_purge");
+
 CustomerCapabilitiesManager::CustomerCapabilitiesPurge::CustomerCapabilitiesPurge(
         const QByteArray&      secret,
         CustomersCapabilities* customerCapabilitiesDatabaseApi,
-        ServerAdministrator*   serverAdministrator
+        ServerAdministrator*   serverAdministrator,
+        JobScheduler*          jobScheduler
     ):RestApiInV1::InesonicRestHandler(
         secret
     ),currentCustomersCapabilities(
         customerCapabilitiesDatabaseApi
     ),currentServerAdministrator(
         serverAdministrator
-    ) {}
+    ),currentJobScheduler(
+        jobScheduler
+    ) {
+    currentJobScheduler->registerJobType(
+        purgeJobType,
+        1,
+        [this](const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId) {
+            return purgeCustomers(parameters, progress, threadId);
+        }
+    );
+}
 
 
 CustomerCapabilitiesManager::CustomerCapabilitiesPurge::~CustomerCapabilitiesPurge() {}
@@ -410,19 +427,8 @@ RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCapabilitiesPurge
         while (success && index < numberCustomerIds) {
             double customerIdDouble = array.at(index).toDouble(-1.0);
             if (customerIdDouble >= 1.0 && customerIdDouble <= 0xFFFFFFFF) {
-                CustomerCapabilities::CustomerId customerId = static_cast<CustomerCapabilities::CustomerId>(
-                    customerIdDouble
-                );
-                success = currentServerAdministrator->deactivateCustomer(customerId, threadId);
-                if (success) {
-                    customerIds.insert(customerId);
-                    ++index;
-                } else {
-                    responseObject.insert(
-                        "status",
-                        QString("failed, could not deactivate customer %1)invalid customer ID").arg(customerId)
-                    );
-                }
+                customerIds.insert(static_cast<CustomerCapabilities::CustomerId>(customerIdDouble));
+                ++index;
             } else {
                 success = false;
                 responseObject.insert("status", "failed, invalid customer ID");
@@ -431,9 +437,15 @@ RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCapabilitiesPurge
 
         if (success) {
             if (static_cast<unsigned long>(customerIds.size()) == numberCustomerIds) {
-                success = currentCustomersCapabilities->purgeCustomerCapabilities(customerIds, threadId);
-                if (success) {
+                // Deactivating customers commands the polling servers one customer at a time so the purge is run as
+                // a background job rather than holding this worker.
+                QJsonObject parameters;
+                parameters.insert("customer_ids", array);
+
+                JobScheduler::JobId jobId = currentJobScheduler->submit(purgeJobType, parameters, threadId);
+                if (jobId != JobScheduler::invalidJobId) {
                     responseObject.insert("status", "OK");
+                    responseObject.insert("job_id", static_cast<double>(jobId));
                 } else {
                     responseObject.insert("status", "failed");
                 }
@@ -448,6 +460,301 @@ RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCapabilitiesPurge
     return response;
 }
 
+
+bool CustomerCapabilitiesManager::CustomerCapabilitiesPurge::purgeCustomers(
+        const QJsonObject&      parameters,
+        JobScheduler::Progress& progress,
+        unsigned                threadId
+    ) {
+    QJsonArray    array             = parameters.value("customer_ids").toArray();
+    unsigned long numberCustomerIds = static_cast<unsigned long>(array.size());
+    unsigned long index             = 0;
+    bool          success           = true;
+
+    CustomersCapabilities::CustomerIdSet customerIds;
+    while (success && index < numberCustomerIds && !progress.cancelRequested()) {
+        CustomerCapabilities::CustomerId customerId = static_cast<CustomerCapabilities::CustomerId>(
+            array.at(index).toDouble(0)
+        );
+
+        success = currentServerAdministrator->deactivateCustomer(customerId, threadId);
+        if (success) {
+            customerIds.insert(customerId);
+
+            ++index;
+            progress.setProgress(index, numberCustomerIds + 1);
+        } else {
+            progress.setMessage(QString("could not deactivate customer %1").arg(customerId));
+        }
+    }
+
+    // A canceled purge leaves the customers deactivated so no customer is left partly purged.
+    if (success && index == numberCustomerIds) {
+        success = currentCustomersCapabilities->purgeCustomerCapabilities(customerIds, threadId);
+        if (success) {
+            progress.setProgress(numberCustomerIds + 1, numberCustomerIds + 1);
+        } else {
+            progress.setMessage(QString("could not purge customer capabilities"));
+        }
+    }
+
+    return success;
+}
+
+/***********************************************************************************************************************
+* CustomerCapabilitiesManager::CustomerCapabilitiesSync
+*/
+
+const QString  CustomerCapabilitiesManager::CustomerCapabilitiesSync::syncJobType("customer_sync");
+const unsigned CustomerCapabilitiesManager::CustomerCapabilitiesSync::customerBatchSize = 500;
+
+CustomerCapabilitiesManager::CustomerCapabilitiesSync::CustomerCapabilitiesSync(
+        const QByteArray&      secret,
+        CustomersCapabilities* customerCapabilitiesDatabaseApi,
+        ServerAdministrator*   serverAdministrator,
+        CustomerSecrets*       customerSecretsDatabaseApi,
+        JobScheduler*          jobScheduler
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentCustomersCapabilities(
+        customerCapabilitiesDatabaseApi
+    ),currentServerAdministrator(
+        serverAdministrator
+    ),currentCustomerSecrets(
+        customerSecretsDatabaseApi
+    ),currentJobScheduler(
+        jobScheduler
+    ) {
+    currentJobScheduler->registerJobType(
+        syncJobType,
+        1,
+        [this](const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId) {
+            return synchronizeCustomers(parameters, progress, threadId);
+        }
+    );
+}
+
+
+CustomerCapabilitiesManager::CustomerCapabilitiesSync::~CustomerCapabilitiesSync() {}
+
+
+RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCapabilitiesSync::processAuthenticatedRequest(
+        const QString&       /* path */,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (request.isArray()) {
+        QJsonObject   responseObject;
+
+        QJsonArray    array           = request.array();
+        unsigned long numberCustomers = static_cast<unsigned long>(array.size());
+        unsigned long index           = 0;
+        bool          success         = true;
+
+        CustomersCapabilities::CustomerIdSet customerIds;
+        while (success && index < numberCustomers) {
+            CustomerCapabilities capabilities = toCapabilities(array.at(index));
+            if (capabilities.isValid()) {
+                customerIds.insert(capabilities.customerId());
+                ++index;
+            } else {
+                success = false;
+                responseObject.insert("status", QString("failed, invalid entry %1").arg(index));
+            }
+        }
+
+        if (success) {
+            if (static_cast<unsigned long>(customerIds.size()) == numberCustomers) {
+                // Polling servers are updated in batches once the database is in sync, so the work is run as a
+                // background job rather than holding this worker.
+                QJsonObject parameters;
+                parameters.insert("customers", array);
+
+                JobScheduler::JobId jobId = currentJobScheduler->submit(syncJobType, parameters, threadId);
+                if (jobId != JobScheduler::invalidJobId) {
+                    responseObject.insert("status", "OK");
+                    responseObject.insert("job_id", static_cast<double>(jobId));
+                } else {
+                    responseObject.insert("status", "failed");
+                }
+            } else {
+                responseObject.insert("status", "failed, duplicate customer ID");
+            }
+        }
+
+        response = RestApiInV1::JsonResponse(responseObject);
+    }
+
+    return response;
+}
+
+
+CustomerCapabilities CustomerCapabilitiesManager::CustomerCapabilitiesSync::toCapabilities(const QJsonValue& value) {
+    CustomerCapabilities result;
+
+    if (value.isObject()) {
+        QJsonObject object = value.toObject();
+
+        double customerIdDouble      = object.value("customer_id").toDouble(-1.0);
+        int    maximumNumberMonitors = object.contains("maximum_number_monitors")
+                                       ? object.value("maximum_number_monitors").toInt(-1)
+                                       : 10;
+        int    pollingInterval       = object.contains("polling_interval")
+                                       ? object.value("polling_interval").toInt(-1)
+                                       : 120;
+        int    expirationDays        = object.contains("expiration_days")
+                                       ? object.value("expiration_days").toInt(-1)
+                                       : 180;
+
+        if (customerIdDouble >= 1.0          &&
+            customerIdDouble <= 0xFFFFFFFF   &&
+            maximumNumberMonitors > 0        &&
+            maximumNumberMonitors <= 0xFFFF  &&
+            pollingInterval > 0              &&
+            pollingInterval <= 0xFFFF        &&
+            expirationDays >= 0                 ) {
+            result = CustomerCapabilities(
+                static_cast<CustomerCapabilities::CustomerId>(customerIdDouble),
+                static_cast<unsigned short>(maximumNumberMonitors),
+                static_cast<unsigned short>(pollingInterval),
+                static_cast<unsigned>(expirationDays),
+                object.value("customer_active").toBool(false),
+                object.value("multi_region_checking").toBool(false),
+                object.value("supports_wordpress").toBool(false),
+                object.value("supports_rest_api").toBool(false),
+                object.value("supports_content_checking").toBool(false),
+                object.value("supports_keyword_checking").toBool(false),
+                object.value("supports_post_method").toBool(false),
+                object.value("supports_latency_tracking").toBool(false),
+                object.value("supports_ssl_expiration_checking").toBool(false),
+                object.value("supports_ping_based_polling").toBool(false),
+                object.value("supports_blacklist_checking").toBool(false),
+                object.value("supports_domain_expiration_checking").toBool(false),
+                object.value("supports_maintenance_mode").toBool(false),
+                object.value("supports_rollups").toBool(false),
+                false // paused
+            );
+        }
+    }
+
+    return result;
+}
+
+
+bool CustomerCapabilitiesManager::CustomerCapabilitiesSync::synchronizeCustomers(
+        const QJsonObject&      parameters,
+        JobScheduler::Progress& progress,
+        unsigned                threadId
+    ) {
+    QJsonArray array = parameters.value("customers").toArray();
+
+    CustomersCapabilities::CapabilitiesByCustomerId capabilitiesByCustomerId;
+    capabilitiesByCustomerId.reserve(array.size());
+    for (QJsonArray::const_iterator it=array.constBegin(),end=array.constEnd() ; it!=end ; ++it) {
+        CustomerCapabilities capabilities = toCapabilities(*it);
+        if (capabilities.isValid()) {
+            capabilitiesByCustomerId.insert(capabilities.customerId(), capabilities);
+        }
+    }
+
+    CustomersCapabilities::CapabilitiesByCustomerId changedCapabilities;
+    bool success = currentCustomersCapabilities->synchronizeCustomerCapabilities(
+        capabilitiesByCustomerId,
+        &changedCapabilities,
+        threadId
+    );
+
+    if (success) {
+        ServerAdministrator::CustomerList activateCustomerIds;
+        ServerAdministrator::CustomerList deactivateCustomerIds;
+
+        for (  CustomersCapabilities::CapabilitiesByCustomerId::const_iterator
+                   it  = changedCapabilities.constBegin(),
+                   end = changedCapabilities.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            const CustomerCapabilities& capabilities = it.value();
+
+            if (capabilities.supportsRestApi() || capabilities.supportsWordPress()) {
+                CustomerSecret secret = currentCustomerSecrets->getCustomerSecret(it.key(), true, threadId);
+                if (secret.isInvalid()) {
+                    currentCustomerSecrets->updateCustomerSecret(it.key(), threadId);
+                }
+            }
+
+            if (capabilities.customerActive()) {
+                activateCustomerIds.append(it.key());
+            } else {
+                deactivateCustomerIds.append(it.key());
+            }
+        }
+
+        // The database is already in sync at this point so cancellation is not honored here.  Stopping early would
+        // leave polling servers behind that a later synchronization would no longer see as changed.
+        unsigned long total     = static_cast<unsigned long>(changedCapabilities.size());
+        unsigned long completed = 0;
+
+        bool activated   = updatePollingServers(activateCustomerIds, true, total, completed, progress, threadId);
+        bool deactivated = updatePollingServers(deactivateCustomerIds, false, total, completed, progress, threadId);
+
+        success = activated && deactivated;
+        if (success) {
+            progress.setMessage(
+                QString("%1 of %2 customers changed")
+                .arg(changedCapabilities.size())
+                .arg(capabilitiesByCustomerId.size())
+            );
+        }
+    } else {
+        progress.setMessage(QString("could not synchronize customer capabilities"));
+    }
+
+    return success;
+}
+
+
+bool CustomerCapabilitiesManager::CustomerCapabilitiesSync::updatePollingServers(
+        const QList<CustomerCapabilities::CustomerId>& customerIds,
+        bool                                           activate,
+        unsigned long                                  total,
+        unsigned long&                                 completed,
+        JobScheduler::Progress&                        progress,
+        unsigned                                       threadId
+    ) {
+    bool success         = true;
+    int  numberCustomers = customerIds.size();
+    int  index           = 0;
+
+    while (index < numberCustomers) {
+        ServerAdministrator::CustomerList batch = customerIds.mid(index, static_cast<int>(customerBatchSize));
+
+        bool batchSuccess;
+        if (activate) {
+            batchSuccess = currentServerAdministrator->activateCustomers(batch, threadId);
+        } else {
+            batchSuccess = currentServerAdministrator->deactivateCustomers(batch, threadId);
+        }
+
+        if (!batchSuccess) {
+            success = false;
+            progress.setMessage(
+                QString("could not %1 customers starting at customer %2")
+                .arg(activate ? "activate" : "deactivate")
+                .arg(batch.first())
+            );
+        }
+
+        index     += batch.size();
+        completed += static_cast<unsigned long>(batch.size());
+        progress.setProgress(completed, total);
+    }
+
+    return success;
+}
+
 /***********************************************************************************************************************
 * CustomerCapabilitiesManager::CustomerCapabilitiesList
 */
@@ -668,6 +975,108 @@ RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCapabilitiesPause
     return response;
 }
 
+/***********************************************************************************************************************
+* CustomerCapabilitiesManager::CustomerCacheStatistics
+*/
+
+CustomerCapabilitiesManager::CustomerCacheStatistics::CustomerCacheStatistics(
+        const QByteArray&      secret,
+        CustomersCapabilities* customerCapabilitiesDatabaseApi,
+        CustomerSecrets*       customerSecretsDatabaseApi,
+        CacheWarmer*           cacheWarmer
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentCustomersCapabilities(
+        customerCapabilitiesDatabaseApi
+    ),currentCustomerSecrets(
+        customerSecretsDatabaseApi
+    ),currentCacheWarmer(
+        cacheWarmer
+    ) {}
+
+
+CustomerCapabilitiesManager::CustomerCacheStatistics::~CustomerCacheStatistics() {}
+
+
+RestApiInV1::JsonResponse CustomerCapabilitiesManager::CustomerCacheStatistics::processAuthenticatedRequest(
+        const QString&       /* path */,
+        const QJsonDocument& request,
+        unsigned             /* threadId */
+    ) {
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (request.isObject()) {
+        QJsonObject object = request.object();
+        if (object.size() == 0 || (object.size() == 1 && object.contains("reset"))) {
+            bool reset = object.value("reset").toBool(false);
+
+            QJsonObject responseObject;
+            responseObject.insert("status", "OK");
+            responseObject.insert(
+                "customer_secrets",
+                statisticsToJson(currentCustomerSecrets->statistics(), currentCustomerSecrets->evictionPolicy())
+            );
+            responseObject.insert(
+                "customer_capabilities",
+                statisticsToJson(
+                    currentCustomersCapabilities->statistics(),
+                    currentCustomersCapabilities->evictionPolicy()
+                )
+            );
+
+            CacheWarmer::WarmUpStatus warmUpStatus = currentCacheWarmer->warmUpStatus();
+            QJsonObject               warmUpObject;
+            warmUpObject.insert("status", CacheWarmer::toString(warmUpStatus.status));
+            warmUpObject.insert("customer_secrets", static_cast<double>(warmUpStatus.numberCustomerSecrets));
+            warmUpObject.insert(
+                "customer_capabilities",
+                static_cast<double>(warmUpStatus.numberCustomerCapabilities)
+            );
+            warmUpObject.insert("elapsed_ms", static_cast<double>(warmUpStatus.elapsedMilliseconds));
+            responseObject.insert("warm_up", warmUpObject);
+
+            if (reset) {
+                currentCustomerSecrets->resetStatistics();
+                currentCustomersCapabilities->resetStatistics();
+            }
+
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
+    }
+
+    return response;
+}
+
+
+QJsonObject CustomerCapabilitiesManager::CustomerCacheStatistics::statisticsToJson(
+        const CacheBase::Statistics& statistics,
+        CacheBase::EvictionPolicy    evictionPolicy
+    ) {
+    QJsonArray probeLengths;
+    for (unsigned i=0 ; i<CacheBase::numberProbeLengthBins ; ++i) {
+        probeLengths.append(static_cast<double>(statistics.probeLengths[i]));
+    }
+
+    unsigned long long numberLookups = statistics.hits + statistics.misses;
+    double             hitRate       =   numberLookups > 0
+                                       ? static_cast<double>(statistics.hits) / numberLookups
+                                       : 0.0;
+
+    QJsonObject result;
+    result.insert("eviction_policy", CacheBase::toString(evictionPolicy));
+    result.insert("hits", static_cast<double>(statistics.hits));
+    result.insert("misses", static_cast<double>(statistics.misses));
+    result.insert("hit_rate", hitRate);
+    result.insert("insertions", static_cast<double>(statistics.insertions));
+    result.insert("evictions", static_cast<double>(statistics.evictions));
+    result.insert("rejections", static_cast<double>(statistics.rejections));
+    result.insert("probe_lengths", probeLengths);
+    result.insert("entries", static_cast<double>(statistics.numberEntries));
+    result.insert("table_size", static_cast<double>(statistics.tableSize));
+
+    return result;
+}
+
 /***********************************************************************************************************************
 * CustomerCapabilitiesManager
 */
@@ -676,16 +1085,20 @@ const QString CustomerCapabilitiesManager::customerCapabilitiesGetPath("/custome
 const QString CustomerCapabilitiesManager::customerCapabilitiesUpdatePath("/customer/create");
 const QString CustomerCapabilitiesManager::customerCapabilitiesDeletePath("/customer/delete");
 const QString CustomerCapabilitiesManager::customerCapabilitiesPurgePath("/customer/purge");
+const QString CustomerCapabilitiesManager::customerCapabilitiesSyncPath("/customer/sync");
 const QString CustomerCapabilitiesManager::customerCapabilitiesListPath("/customer/list");
 const QString CustomerCapabilitiesManager::customerGetSecretPath("/customer/get_secret");
 const QString CustomerCapabilitiesManager::customerResetSecretPath("/customer/reset_secret");
 const QString CustomerCapabilitiesManager::customerCapabilitiesPausePath("/customer/pause");
+const QString CustomerCapabilitiesManager::customerCacheStatisticsPath("/customer/cache/statistics");
 
 CustomerCapabilitiesManager::CustomerCapabilitiesManager(
         RestApiInV1::Server*   restApiServer,
         CustomersCapabilities* customerCapabilitiesDatabaseApi,
         CustomerSecrets*       customerSecretsDatabaseApi,
         ServerAdministrator*   serverAdministrator,
+        CacheWarmer*           cacheWarmer,
+        JobScheduler*          jobScheduler,
         const QByteArray&      secret,
         QObject*               parent
     ):QObject(
@@ -705,7 +1118,14 @@ CustomerCapabilitiesManager::CustomerCapabilitiesManager(
     ),customerCapabilitiesPurge(
         secret,
         customerCapabilitiesDatabaseApi,
-        serverAdministrator
+        serverAdministrator,
+        jobScheduler
+    ),customerCapabilitiesSync(
+        secret,
+        customerCapabilitiesDatabaseApi,
+        serverAdministrator,
+        customerSecretsDatabaseApi,
+        jobScheduler
     ),customerCapabilitiesList(
         secret,
         customerCapabilitiesDatabaseApi
@@ -718,6 +1138,11 @@ CustomerCapabilitiesManager::CustomerCapabilitiesManager(
     ),customerCapabilitiesPause(
         secret,
         serverAdministrator
+    ),customerCacheStatistics(
+        secret,
+        customerCapabilitiesDatabaseApi,
+        customerSecretsDatabaseApi,
+        cacheWarmer
     ) {
     restApiServer->registerHandler(
         &customerCapabilitiesGet,
@@ -739,6 +1164,11 @@ CustomerCapabilitiesManager::CustomerCapabilitiesManager(
         RestApiInV1::Handler::Method::POST,
         customerCapabilitiesPurgePath
     );
+    restApiServer->registerHandler(
+        &customerCapabilitiesSync,
+        RestApiInV1::Handler::Method::POST,
+        customerCapabilitiesSyncPath
+    );
     restApiServer->registerHandler(
         &customerCapabilitiesList,
         RestApiInV1::Handler::Method::POST,
@@ -759,6 +1189,11 @@ CustomerCapabilitiesManager::CustomerCapabilitiesManager(
         RestApiInV1::Handler::Method::POST,
         customerCapabilitiesPausePath
     );
+    restApiServer->registerHandler(
+        &customerCacheStatistics,
+        RestApiInV1::Handler::Method::POST,
+        customerCacheStatisticsPath
+    );
 }
 
 
@@ -770,8 +1205,10 @@ void CustomerCapabilitiesManager::setSecret(const QByteArray& newSecret) {
     customerCapabilitiesUpdate.setSecret(newSecret);
     customerCapabilitiesDelete.setSecret(newSecret);
     customerCapabilitiesPurge.setSecret(newSecret);
+    customerCapabilitiesSync.setSecret(newSecret);
     customerCapabilitiesList.setSecret(newSecret);
     customerGetSecret.setSecret(newSecret);
     customerResetSecret.setSecret(newSecret);
     customerCapabilitiesPause.setSecret(newSecret);
+    customerCacheStatistics.setSecret(newSecret);
 }
@@ -21,6 +21,11 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QSet>
+#include <QList>
+#include <QStringList>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
@@ -31,9 +36,17 @@
 #include <cstdint>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "database_manager.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
+#include "shard_map.h"
+#include "cache_invalidation_bus.h"
 #include "customer_mapping.h"
 
+const unsigned CustomerMapping::maximumRowsPerStatement = 1000;
+const char     CustomerMapping::invalidationTable[]     = "customer_mapping";
+
 CustomerMapping::CustomerMapping(
         DatabaseManager* databaseManager,
         QObject*         parent
@@ -41,6 +54,10 @@ CustomerMapping::CustomerMapping(
         parent
     ),currentDatabaseManager(
         databaseManager
+    ),currentShardMap(
+        nullptr
+    ),indexLoaded(
+        false
     ) {}
 
 
@@ -52,6 +69,14 @@ bool CustomerMapping::updateMapping(
         const CustomerMapping::Mapping& mapping,
         unsigned                        threadId
     ) {
+    QMutexLocker locker(&indexMutex);
+
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("CustomerMapping::updateMapping")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -63,26 +88,40 @@ bool CustomerMapping::updateMapping(
             supportsTransactions = false;
         }
 
-        QSqlQuery query(database);
+        QSqlQuery query = currentDatabaseManager->preparedQuery(
+            database,
+            QString("DELETE FROM customer_mapping WHERE customer_id = :customer_id"),
+            &success
+        );
 
-        QString queryString = QString("DELETE FROM customer_mapping WHERE customer_id = %1").arg(customerId);
-        success = query.exec(queryString);
         if (success) {
-            queryString = QString(
-                "INSERT INTO customer_mapping(customer_id, server_id, primary_server) "
-                "VALUES (:customer_id, :server_id, :primary_server)"
+            query.bindValue(":customer_id", customerId);
+            success = SqlHelpers::execute(query);
+        }
+
+        if (success) {
+            QSqlQuery insertQuery = currentDatabaseManager->preparedQuery(
+                database,
+                QString(
+                    "INSERT INTO customer_mapping(customer_id, server_id, primary_server) "
+                    "VALUES (:customer_id, :server_id, :primary_server)"
+                ),
+                &success
             );
-            success = query.prepare(queryString);
+
             if (success) {
                 Mapping::const_iterator mappingIterator    = mapping.constBegin();
                 Mapping::const_iterator mappingEndIterator = mapping.constEnd();
 
                 while (success && mappingIterator != mappingEndIterator) {
-                    query.bindValue(":customer_id", customerId);
-                    query.bindValue(":server_id", *mappingIterator);
-                    query.bindValue(":primary_server", *mappingIterator == mapping.primaryServerId() ? true : false);
+                    insertQuery.bindValue(":customer_id", customerId);
+                    insertQuery.bindValue(":server_id", *mappingIterator);
+                    insertQuery.bindValue(
+                        ":primary_server",
+                        *mappingIterator == mapping.primaryServerId() ? true : false
+                    );
 
-                    success = query.exec();
+                    success = SqlHelpers::execute(insertQuery);
                     if (success) {
                         ++mappingIterator;
                     }
@@ -92,7 +131,7 @@ bool CustomerMapping::updateMapping(
                     logWrite(
                         QString("Failed to update customer mapping - customer id = %1, error = %2")
                         .arg(customerId)
-                        .arg(query.lastError().text()),
+                        .arg(insertQuery.lastError().text()),
                         true
                     );
                 }
@@ -100,7 +139,7 @@ bool CustomerMapping::updateMapping(
                 logWrite(
                     QString("Failed to prepare update of customer mapping - customer id = %1, error = %2")
                     .arg(customerId)
-                    .arg(query.lastError().text()),
+                    .arg(insertQuery.lastError().text()),
                     true
                 );
             }
@@ -145,78 +184,157 @@ bool CustomerMapping::updateMapping(
     }
 
     currentDatabaseManager->closeAndRelease(database);
+
+    if (success) {
+        if (indexLoaded) {
+            indexMapping(customerId, mapping);
+        }
+
+        CacheInvalidationBus::instance()->publish(invalidationTable, customerId);
+    } else {
+        indexLoaded = false;
+    }
+
     return success;
 }
 
 
-CustomerMapping::Mapping CustomerMapping::mapping(CustomerMapping::CustomerId customerId, unsigned threadId) {
-    Mapping result;
+bool CustomerMapping::updateMappings(const CustomerMapping::MappingsByCustomerId& mappings, unsigned threadId) {
+    QMutexLocker locker(&indexMutex);
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+    QStringList customerIds;
+    QStringList rows;
+    for (  MappingsByCustomerId::const_iterator mappingsIterator    = mappings.constBegin(),
+                                                mappingsEndIterator = mappings.constEnd()
+         ; mappingsIterator != mappingsEndIterator
+         ; ++mappingsIterator
+        ) {
+        CustomerId     customerId = mappingsIterator.key();
+        const Mapping& mapping    = mappingsIterator.value();
 
-        QString queryString = QString(
-            "SELECT server_id AS server_id, primary_server AS primary_server FROM customer_mapping "
-            "WHERE customer_id = %1"
-        ).arg(customerId);
+        customerIds.append(QString::number(customerId));
+        for (Mapping::const_iterator it=mapping.constBegin(),end=mapping.constEnd() ; it!=end ; ++it) {
+            rows.append(
+                QString("(%1,%2,%3)")
+                .arg(customerId)
+                .arg(*it)
+                .arg(*it == mapping.primaryServerId() ? "TRUE" : "FALSE")
+            );
+        }
+    }
 
-        success = query.exec(queryString);
+    bool success = true;
+    if (!customerIds.isEmpty()) {
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        success = database.isOpen();
         if (success) {
-            //int customerIdField = query.record().indexOf("customer_id");
-            int serverIdField        = query.record().indexOf("server_id");
-            int isPrimaryServerField = query.record().indexOf("primary_server");
+            bool supportsTransactions;
+            if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
+                supportsTransactions = true;
+                database.transaction();
+            } else {
+                supportsTransactions = false;
+            }
 
-            if (serverIdField >= 0 && isPrimaryServerField >= 0) {
-                ServerSet servers;
-                ServerId  primaryServerId = invalidServerId;
-                while (success && query.next()) {
-                    ServerId serverId        = query.value(serverIdField).toUInt(&success);
-                    bool     isPrimaryServer = query.value(isPrimaryServerField).toBool();
+            QSqlQuery query(database);
 
-                    if (success) {
-                        if (isPrimaryServer) {
-                            if (primaryServerId == invalidServerId) {
-                                primaryServerId = serverId;
-                            } else {
-                                logWrite(
-                                    QString("??? Warning: Multiple primary servers for customer %1")
-                                    .arg(customerId),
-                                    false
-                                );
-                            }
-                        }
+            unsigned long numberCustomers = static_cast<unsigned long>(customerIds.size());
+            unsigned long customerIndex   = 0;
+            while (success && customerIndex < numberCustomers) {
+                QString queryString = QString("DELETE FROM customer_mapping WHERE customer_id IN (%1)")
+                                      .arg(customerIds.mid(customerIndex, maximumRowsPerStatement).join(QChar(',')));
 
-                        servers.insert(serverId);
-                    }
+                success = SqlHelpers::execute(query, queryString);
+                if (success) {
+                    customerIndex += maximumRowsPerStatement;
+                } else {
+                    logWrite(
+                        QString("Failed to delete old customer mappings - CustomerMapping::updateMappings: %1")
+                        .arg(query.lastError().text()),
+                        true
+                    );
                 }
+            }
 
-                result = Mapping(primaryServerId, servers);
-            } else {
-                logWrite(
-                    QString("Failed to get field index - CustomerMapping::mapping: %1")
-                    .arg(query.lastError().text()),
-                    true
-                );
+            unsigned long numberRows = static_cast<unsigned long>(rows.size());
+            unsigned long rowIndex   = 0;
+            while (success && rowIndex < numberRows) {
+                QString queryString = QString(
+                    "INSERT INTO customer_mapping(customer_id, server_id, primary_server) VALUES %1"
+                ).arg(rows.mid(rowIndex, maximumRowsPerStatement).join(QChar(',')));
+
+                success = SqlHelpers::execute(query, queryString);
+                if (success) {
+                    rowIndex += maximumRowsPerStatement;
+                } else {
+                    logWrite(
+                        QString("Failed to insert customer mappings - CustomerMapping::updateMappings: %1")
+                        .arg(query.lastError().text()),
+                        true
+                    );
+                }
+            }
+
+            if (supportsTransactions) {
+                if (success) {
+                    success = database.commit();
+                    if (!success) {
+                        logWrite(
+                            QString("Failed to commit customer mappings - CustomerMapping::updateMappings: %1")
+                            .arg(database.lastError().text()),
+                            true
+                        );
+                    }
+                } else {
+                    bool rollbackSuccess = database.rollback();
+                    if (!rollbackSuccess) {
+                        logWrite(
+                            QString("Failed to rollback customer mappings - CustomerMapping::updateMappings: %1")
+                            .arg(database.lastError().text()),
+                            true
+                        );
+                    }
+                }
             }
         } else {
             logWrite(
-                QString("Failed SELECT - CustomerMapping::mapping: %1")
-                .arg(query.lastError().text()),
+                QString("Failed to open database - CustomerMapping::updateMappings: %1")
+                .arg(database.lastError().text()),
                 true
             );
         }
-    } else {
-        logWrite(
-            QString("Failed to open database - CustomerMapping::mapping: %1")
-            .arg(database.lastError().text()),
-            true
-        );
+
+        currentDatabaseManager->closeAndRelease(database);
+
+        if (success) {
+            if (indexLoaded) {
+                for (  MappingsByCustomerId::const_iterator mappingsIterator    = mappings.constBegin(),
+                                                            mappingsEndIterator = mappings.constEnd()
+                     ; mappingsIterator != mappingsEndIterator
+                     ; ++mappingsIterator
+                    ) {
+                    indexMapping(mappingsIterator.key(), mappingsIterator.value());
+                }
+            }
+
+            CacheInvalidationBus::instance()->publish(invalidationTable);
+        } else {
+            indexLoaded = false;
+        }
+    }
+
+    return success;
+}
+
+
+CustomerMapping::Mapping CustomerMapping::mapping(CustomerMapping::CustomerId customerId, unsigned threadId) {
+    QMutexLocker locker(&indexMutex);
+
+    Mapping result;
+    if (loadIndex(threadId)) {
+        result = mappingsByCustomerId.value(customerId);
     }
 
-    currentDatabaseManager->closeAndRelease(database);
     return result;
 }
 
@@ -225,31 +343,166 @@ CustomerMapping::MappingsByCustomerId CustomerMapping::mappings(
         CustomerMapping::ServerId serverId,
         unsigned                  threadId
     ) {
+    QMutexLocker locker(&indexMutex);
+
     MappingsByCustomerId result;
+    if (loadIndex(threadId)) {
+        if (serverId == invalidServerId) {
+            result = mappingsByCustomerId;
+        } else {
+            const QSet<CustomerId>& customers = customerIdsByServerId.value(serverId);
+            for (  QSet<CustomerId>::const_iterator customerIterator = customers.constBegin(),
+                                                    customerEndIterator = customers.constEnd()
+                 ; customerIterator != customerEndIterator
+                 ; ++customerIterator
+                ) {
+                CustomerId customerId = *customerIterator;
+                ServerId   primaryServerId =   mappingsByCustomerId.value(customerId).primaryServerId() == serverId
+                                             ? serverId
+                                             : invalidServerId;
+
+                result.insert(customerId, Mapping(primaryServerId, ServerSet() << serverId));
+            }
+        }
+    }
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+    return result;
+}
+
+
+QList<CustomerMapping::CustomerId> CustomerMapping::customerIds(CustomerMapping::ServerId serverId, unsigned threadId) {
+    QMutexLocker locker(&indexMutex);
 
-        QString queryString = QString("SELECT * FROM customer_mapping");
-        if (serverId != invalidServerId) {
-            queryString += QString(" WHERE server_id = %1").arg(serverId);
+    QList<CustomerId> result;
+    if (loadIndex(threadId)) {
+        result = customerIdsByServerId.value(serverId).values();
+    }
+
+    return result;
+}
+
+
+void CustomerMapping::removeServer(CustomerMapping::ServerId serverId) {
+    QMutexLocker locker(&indexMutex);
+
+    if (indexLoaded) {
+        QSet<CustomerId> customers = customerIdsByServerId.take(serverId);
+        for (  QSet<CustomerId>::const_iterator customerIterator = customers.constBegin(),
+                                                customerEndIterator = customers.constEnd()
+             ; customerIterator != customerEndIterator
+             ; ++customerIterator
+            ) {
+            MappingsByCustomerId::iterator mappingIterator = mappingsByCustomerId.find(*customerIterator);
+            if (mappingIterator != mappingsByCustomerId.end()) {
+                mappingIterator->remove(serverId);
+                if (mappingIterator->primaryServerId() == serverId) {
+                    mappingIterator->setPrimaryServer(invalidServerId);
+                }
+
+                if (mappingIterator->isEmpty()) {
+                    mappingsByCustomerId.erase(mappingIterator);
+                }
+            }
         }
+    }
+
+    CacheInvalidationBus::instance()->publish(invalidationTable);
+}
+
+
+void CustomerMapping::invalidate() {
+    QMutexLocker locker(&indexMutex);
+    indexLoaded = false;
+}
+
+
+void CustomerMapping::setShardMap(ShardMap* newShardMap) {
+    QMutexLocker locker(&indexMutex);
+    currentShardMap = newShardMap;
+    indexLoaded     = false;
+}
+
+
+ShardMap* CustomerMapping::shardMap() const {
+    return currentShardMap;
+}
+
+
+bool CustomerMapping::ownsCustomer(CustomerMapping::CustomerId customerId, unsigned threadId) {
+    return currentShardMap == nullptr || currentShardMap->ownsCustomer(customerId, threadId);
+}
+
+
+bool CustomerMapping::loadIndex(unsigned threadId) {
+    if (!indexLoaded) {
+        bool                 success;
+        MappingsByCustomerId newMappings = readMappings(&success, threadId);
 
-        success = query.exec(queryString);
         if (success) {
+            if (currentShardMap != nullptr && currentShardMap->isSharded()) {
+                MappingsByCustomerId::iterator it = newMappings.begin();
+                while (it != newMappings.end()) {
+                    if (currentShardMap->ownsCustomer(it.key(), threadId)) {
+                        ++it;
+                    } else {
+                        it = newMappings.erase(it);
+                    }
+                }
+            }
+
+            mappingsByCustomerId = newMappings;
+            customerIdsByServerId.clear();
+
+            for (  MappingsByCustomerId::const_iterator mappingIterator = mappingsByCustomerId.constBegin(),
+                                                        mappingEndIterator = mappingsByCustomerId.constEnd()
+                 ; mappingIterator != mappingEndIterator
+                 ; ++mappingIterator
+                ) {
+                CustomerId customerId = mappingIterator.key();
+                for (  Mapping::const_iterator serverIterator = mappingIterator->constBegin(),
+                                               serverEndIterator = mappingIterator->constEnd()
+                     ; serverIterator != serverEndIterator
+                     ; ++serverIterator
+                    ) {
+                    customerIdsByServerId[*serverIterator].insert(customerId);
+                }
+            }
+
+            indexLoaded = true;
+        }
+    }
+
+    return indexLoaded;
+}
+
+
+CustomerMapping::MappingsByCustomerId CustomerMapping::readMappings(bool* success, unsigned threadId) {
+    MappingsByCustomerId result;
+
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("CustomerMapping::readMappings")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    *success = database.isOpen();
+    if (*success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        *success = SqlHelpers::execute(query, "SELECT * FROM customer_mapping");
+        if (*success) {
             int customerIdField      = query.record().indexOf("customer_id");
             int serverIdField        = query.record().indexOf("server_id");
             int isPrimaryServerField = query.record().indexOf("primary_server");
 
             if (customerIdField >= 0 && serverIdField >= 0 && isPrimaryServerField >= 0) {
-                while (success && query.next()) {
-                    CustomerId customerId = query.value(customerIdField).toUInt(&success);
-                    if (success && customerId != CustomerCapabilities::invalidCustomerId) {
-                        ServerId serverId = query.value(serverIdField).toUInt(&success);
-                        if (success && serverId != invalidServerId) {
+                while (*success && query.next()) {
+                    CustomerId customerId = query.value(customerIdField).toUInt(success);
+                    if (*success && customerId != CustomerCapabilities::invalidCustomerId) {
+                        ServerId serverId = query.value(serverIdField).toUInt(success);
+                        if (*success && serverId != invalidServerId) {
                             bool isPrimaryServer = query.value(isPrimaryServerField).toBool();
 
                             result[customerId].insert(serverId);
@@ -266,36 +519,35 @@ CustomerMapping::MappingsByCustomerId CustomerMapping::mappings(
                                 }
                             }
                         } else {
-                            success = false;
+                            *success = false;
                             logWrite(
-                                QString("Invalid server ID - CustomerMapping::mappings, customer %1")
+                                QString("Invalid server ID - CustomerMapping::readMappings, customer %1")
                                 .arg(customerId),
                                 true
                             );
                         }
                     } else {
-                        success = false;
+                        *success = false;
                         logWrite(
-                            QString("Invalid server ID - CustomerMapping::mappings, customer %1")
+                            QString("Invalid server ID - CustomerMapping::readMappings, customer %1")
                             .arg(customerId),
                             true
                         );
                     }
                 }
             } else {
-                success = false;
-                logWrite(QString("Failed to get field index - CustomerMapping::mappings"), true);
+                *success = false;
+                logWrite(QString("Failed to get field index - CustomerMapping::readMappings"), true);
             }
         } else {
-            QSqlError lastError = query.lastError();
             logWrite(
-                QString("Failed SELECT - CustomerMapping::mappings: %1").arg(query.lastError().text()),
+                QString("Failed SELECT - CustomerMapping::readMappings: %1").arg(query.lastError().text()),
                 true
             );
         }
     } else {
         logWrite(
-            QString("Failed to open database - CustomerMapping::mappings: %1")
+            QString("Failed to open database - CustomerMapping::readMappings: %1")
             .arg(database.lastError().text()),
             true
         );
@@ -304,3 +556,36 @@ CustomerMapping::MappingsByCustomerId CustomerMapping::mappings(
     currentDatabaseManager->closeAndRelease(database);
     return result;
 }
+
+
+void CustomerMapping::indexMapping(CustomerMapping::CustomerId customerId, const CustomerMapping::Mapping& mapping) {
+    Mapping oldMapping = mappingsByCustomerId.value(customerId);
+    for (  Mapping::const_iterator serverIterator = oldMapping.constBegin(), serverEndIterator = oldMapping.constEnd()
+         ; serverIterator != serverEndIterator
+         ; ++serverIterator
+        ) {
+        ServerId serverId = *serverIterator;
+        if (!mapping.contains(serverId)) {
+            QHash<ServerId, QSet<CustomerId>>::iterator customersIterator = customerIdsByServerId.find(serverId);
+            if (customersIterator != customerIdsByServerId.end()) {
+                customersIterator->remove(customerId);
+                if (customersIterator->isEmpty()) {
+                    customerIdsByServerId.erase(customersIterator);
+                }
+            }
+        }
+    }
+
+    if (mapping.isEmpty()) {
+        mappingsByCustomerId.remove(customerId);
+    } else {
+        for (  Mapping::const_iterator serverIterator = mapping.constBegin(), serverEndIterator = mapping.constEnd()
+             ; serverIterator != serverEndIterator
+             ; ++serverIterator
+            ) {
+            customerIdsByServerId[*serverIterator].insert(customerId);
+        }
+
+        mappingsByCustomerId.insert(customerId, mapping);
+    }
+}
@@ -25,10 +25,13 @@
 #include <QJsonValue>
 #include <QJsonArray>
 
+#include <cstdint>
+
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 
 #include "customer_mapping.h"
+#include "shard_map.h"
 #include "customer_mapping_manager.h"
 #include "server_administrator.h"
 
@@ -65,25 +68,28 @@ RestApiInV1::JsonResponse CustomerMappingManager::CustomerMappingGet::processAut
             if (customerIdDouble >= 1 && customerIdDouble <= 0xFFFFFFFF) {
                 CustomerMapping::CustomerId customerId = static_cast<CustomerMapping::CustomerId>(customerIdDouble);
 
-                CustomerMapping::Mapping mapping = currentCustomerMapping->mapping(customerId, threadId);
-                if (mapping.isValid()) {
-                    QJsonObject mappingObject;
-                    mappingObject.insert("primary_server", static_cast<double>(mapping.primaryServerId()));
-
-                    QJsonArray serverList;
-                    for (  CustomerMapping::Mapping::const_iterator it = mapping.constBegin(), end = mapping.constEnd()
-                         ; it != end
-                         ; ++it
-                        ) {
-                        serverList.append(static_cast<double>(*it));
-                    }
+                if (checkShard(currentCustomerMapping, customerId, threadId, responseObject)) {
+                    CustomerMapping::Mapping mapping = currentCustomerMapping->mapping(customerId, threadId);
+                    if (mapping.isValid()) {
+                        QJsonObject mappingObject;
+                        mappingObject.insert("primary_server", static_cast<double>(mapping.primaryServerId()));
+
+                        QJsonArray serverList;
+                        for (  CustomerMapping::Mapping::const_iterator it  = mapping.constBegin(),
+                                                                        end = mapping.constEnd()
+                             ; it != end
+                             ; ++it
+                            ) {
+                            serverList.append(static_cast<double>(*it));
+                        }
 
-                    mappingObject.insert("servers", serverList);
+                        mappingObject.insert("servers", serverList);
 
-                    responseObject.insert("status" , "OK");
-                    responseObject.insert("mapping", mappingObject);
-                } else {
-                    responseObject.insert("status", "no mapping");
+                        responseObject.insert("status" , "OK");
+                        responseObject.insert("mapping", mappingObject);
+                    } else {
+                        responseObject.insert("status", "no mapping");
+                    }
                 }
             } else {
                 responseObject.insert("status", "invalid customer ID");
@@ -129,45 +135,48 @@ RestApiInV1::JsonResponse CustomerMappingManager::CustomerMappingUpdate::process
             if (customerIdDouble >= 1 && customerIdDouble <= 0xFFFFFFFF) {
                 CustomerMapping::CustomerId customerId = static_cast<CustomerMapping::CustomerId>(customerIdDouble);
 
-                QJsonValue mappingValue = object.value("mapping");
-                if (mappingValue.isArray()) {
-                    QJsonArray mappingArray = mappingValue.toArray();
-
-                    CustomerMapping::ServerId  primaryServerId = CustomerMapping::invalidServerId;
-                    CustomerMapping::ServerSet servers;
-
-                    bool                       success = true;
-                    QJsonArray::const_iterator it      = mappingArray.constBegin();
-                    QJsonArray::const_iterator end     = mappingArray.constEnd();
-
-                    while (success && it != end) {
-                        int serverIdInt = it->toInt(-1);
-                        if (serverIdInt >= 1 && serverIdInt <= 0xFFFF) {
-                            CustomerMapping::ServerId serverId = static_cast<CustomerMapping::ServerId>(serverIdInt);
-                            if (primaryServerId == CustomerMapping::invalidServerId) {
-                                primaryServerId = serverId;
+                if (checkShard(currentCustomerMapping, customerId, threadId, responseObject)) {
+                    QJsonValue mappingValue = object.value("mapping");
+                    if (mappingValue.isArray()) {
+                        QJsonArray mappingArray = mappingValue.toArray();
+
+                        CustomerMapping::ServerId  primaryServerId = CustomerMapping::invalidServerId;
+                        CustomerMapping::ServerSet servers;
+
+                        bool                       success = true;
+                        QJsonArray::const_iterator it      = mappingArray.constBegin();
+                        QJsonArray::const_iterator end     = mappingArray.constEnd();
+
+                        while (success && it != end) {
+                            int serverIdInt = it->toInt(-1);
+                            if (serverIdInt >= 1 && serverIdInt <= 0xFFFF) {
+                                CustomerMapping::ServerId serverId =
+                                    static_cast<CustomerMapping::ServerId>(serverIdInt);
+                                if (primaryServerId == CustomerMapping::invalidServerId) {
+                                    primaryServerId = serverId;
+                                }
+
+                                servers.insert(serverId);
+                                ++it;
+                            } else {
+                                success = false;
                             }
-
-                            servers.insert(serverId);
-                            ++it;
-                        } else {
-                            success = false;
                         }
-                    }
 
-                    if (success) {
-                        CustomerMapping::Mapping mapping(primaryServerId, servers);
-                        success = currentCustomerMapping->updateMapping(customerId, mapping, threadId);
                         if (success) {
-                            responseObject.insert("status", "OK");
+                            CustomerMapping::Mapping mapping(primaryServerId, servers);
+                            success = currentCustomerMapping->updateMapping(customerId, mapping, threadId);
+                            if (success) {
+                                responseObject.insert("status", "OK");
+                            } else {
+                                responseObject.insert("status", "failed to create new mapping");
+                            }
                         } else {
-                            responseObject.insert("status", "failed to create new mapping");
+                            responseObject.insert("status", "invalid mapping");
                         }
                     } else {
-                        responseObject.insert("status", "invalid mapping");
+                        responseObject.insert("status", "expected array");
                     }
-                } else {
-                    responseObject.insert("status", "expected array");
                 }
             } else {
                 responseObject.insert("status", "invalid customer ID");
@@ -186,9 +195,12 @@ RestApiInV1::JsonResponse CustomerMappingManager::CustomerMappingUpdate::process
 
 CustomerMappingManager::CustomerMappingCustomerActivate::CustomerMappingCustomerActivate(
         const QByteArray&    secret,
+        CustomerMapping*     customerMappingDatabaseApi,
         ServerAdministrator* serverAdministratorApi
     ):RestApiInV1::InesonicRestHandler(
         secret
+    ),currentCustomerMapping(
+        customerMappingDatabaseApi
     ),currentServerAdministrator(
         serverAdministratorApi
     ) {}
@@ -213,11 +225,13 @@ RestApiInV1::JsonResponse CustomerMappingManager::CustomerMappingCustomerActivat
             if (customerIdDouble >= 1 && customerIdDouble <= 0xFFFFFFFF) {
                 CustomerMapping::CustomerId customerId = static_cast<CustomerMapping::CustomerId>(customerIdDouble);
 
-                bool success = currentServerAdministrator->activateCustomer(customerId, threadId);
-                if (success) {
-                    responseObject.insert("status", "OK");
-                } else {
-                    responseObject.insert("status", "unknown customer ID");
+                if (checkShard(currentCustomerMapping, customerId, threadId, responseObject)) {
+                    bool success = currentServerAdministrator->activateCustomer(customerId, threadId);
+                    if (success) {
+                        responseObject.insert("status", "OK");
+                    } else {
+                        responseObject.insert("status", "unknown customer ID");
+                    }
                 }
             } else {
                 responseObject.insert("status", "invalid customer ID");
@@ -236,9 +250,12 @@ RestApiInV1::JsonResponse CustomerMappingManager::CustomerMappingCustomerActivat
 
 CustomerMappingManager::CustomerMappingCustomerDeactivate::CustomerMappingCustomerDeactivate(
         const QByteArray&    secret,
+        CustomerMapping*     customerMappingDatabaseApi,
         ServerAdministrator* serverAdministratorApi
     ):RestApiInV1::InesonicRestHandler(
         secret
+    ),currentCustomerMapping(
+        customerMappingDatabaseApi
     ),currentServerAdministrator(
         serverAdministratorApi
     ) {}
@@ -263,11 +280,13 @@ RestApiInV1::JsonResponse CustomerMappingManager::CustomerMappingCustomerDeactiv
             if (customerIdDouble >= 1 && customerIdDouble <= 0xFFFFFFFF) {
                 CustomerMapping::CustomerId customerId = static_cast<CustomerMapping::CustomerId>(customerIdDouble);
 
-                bool success = currentServerAdministrator->deactivateCustomer(customerId, threadId);
-                if (success) {
-                    responseObject.insert("status", "OK");
-                } else {
-                    responseObject.insert("status", "failed to deactivate");
+                if (checkShard(currentCustomerMapping, customerId, threadId, responseObject)) {
+                    bool success = currentServerAdministrator->deactivateCustomer(customerId, threadId);
+                    if (success) {
+                        responseObject.insert("status", "OK");
+                    } else {
+                        responseObject.insert("status", "failed to deactivate");
+                    }
                 }
             } else {
                 responseObject.insert("status", "invalid customer ID");
@@ -389,9 +408,11 @@ CustomerMappingManager::CustomerMappingManager(
         customerMappingDatabaseApi
     ),mappingCustomerActivate(
         secret,
+        customerMappingDatabaseApi,
         serverAdministratorApi
     ),mappingCustomerDeactivate(
         secret,
+        customerMappingDatabaseApi,
         serverAdministratorApi
     ),mappingList(
         secret,
@@ -416,6 +437,25 @@ CustomerMappingManager::CustomerMappingManager(
 CustomerMappingManager::~CustomerMappingManager() {}
 
 
+bool CustomerMappingManager::checkShard(
+        CustomerMapping* customerMapping,
+        std::uint32_t    customerId,
+        unsigned         threadId,
+        QJsonObject&     responseObject
+    ) {
+    bool result = customerMapping->ownsCustomer(customerId, threadId);
+    if (!result) {
+        ShardMap::Shard shard = customerMapping->shardMap()->shardForCustomer(customerId, threadId);
+
+        responseObject.insert("status", "failed, wrong shard");
+        responseObject.insert("shard_id", static_cast<int>(shard.shardId()));
+        responseObject.insert("shard_url", shard.baseUrl());
+    }
+
+    return result;
+}
+
+
 void CustomerMappingManager::setSecret(const QByteArray& newSecret) {
     mappingGet.setSecret(newSecret);
     mappingUpdate.setSecret(newSecret);
@@ -0,0 +1,177 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref CustomerRateLimiter class.
+***********************************************************************************************************************/
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "customer_capabilities.h"
+#include "customers_capabilities.h"
+#include "metrics_registry.h"
+#include "customer_rate_limiter.h"
+
+const double CustomerRateLimiter::defaultBaseRate              = 0.0;
+const double CustomerRateLimiter::defaultRatePerMonitor        = 0.0;
+const double CustomerRateLimiter::defaultBurstSeconds          = 30.0;
+const qint64 CustomerRateLimiter::budgetRefreshMilliseconds    = 60000;
+const qint64 CustomerRateLimiter::sweepIntervalMilliseconds    = 300000;
+
+CustomerRateLimiter::CustomerRateLimiter(CustomersCapabilities* customersCapabilities) {
+    currentCustomersCapabilities = customersCapabilities;
+    currentBaseRate              = defaultBaseRate;
+    currentRatePerMonitor        = defaultRatePerMonitor;
+    currentBurstSeconds          = defaultBurstSeconds;
+    lastSweep                    = 0;
+
+    rejectedMetric = MetricsRegistry::instance()->counter(
+        QString("dbc_customer_rate_limited_total"),
+        QString("Number of customer API requests refused because the customer exceeded their request budget.")
+    );
+
+    clock.start();
+}
+
+
+CustomerRateLimiter::~CustomerRateLimiter() {}
+
+
+void CustomerRateLimiter::setBudget(double baseRate, double ratePerMonitor, double burstSeconds) {
+    QMutexLocker locker(&bucketMutex);
+
+    currentBaseRate       = baseRate;
+    currentRatePerMonitor = ratePerMonitor;
+    currentBurstSeconds   = burstSeconds;
+
+    // Force every bucket to pick up the new budget on its next request.
+    buckets.clear();
+}
+
+
+bool CustomerRateLimiter::admit(CustomerId customerId, double cost, unsigned threadId, unsigned* retryAfterSeconds) {
+    bool result;
+
+    bucketMutex.lock();
+
+    bool   enabled     = currentBaseRate > 0 || currentRatePerMonitor > 0;
+    qint64 now         = clock.elapsed();
+    bool   needsBudget = false;
+
+    if (enabled) {
+        QHash<CustomerId, Bucket>::const_iterator it = buckets.constFind(customerId);
+        needsBudget = it == buckets.constEnd() || now - it.value().lastBudgetRefresh >= budgetRefreshMilliseconds;
+    }
+
+    bucketMutex.unlock();
+
+    if (!enabled) {
+        result = true;
+    } else {
+        // The capabilities lookup may reach the database so it is done without holding the bucket mutex.
+        double rate = needsBudget ? customerRate(customerId, threadId) : 0;
+
+        QMutexLocker locker(&bucketMutex);
+
+        if (now - lastSweep >= sweepIntervalMilliseconds) {
+            sweep(now);
+            lastSweep = now;
+        }
+
+        QHash<CustomerId, Bucket>::iterator it = buckets.find(customerId);
+        if (it == buckets.end()) {
+            Bucket bucket;
+            bucket.rate              = rate;
+            bucket.depth             = std::max(1.0, rate * currentBurstSeconds);
+            bucket.tokens            = bucket.depth;
+            bucket.lastRefill        = now;
+            bucket.lastBudgetRefresh = now;
+
+            it = buckets.insert(customerId, bucket);
+        } else if (needsBudget) {
+            it.value().rate              = rate;
+            it.value().depth             = std::max(1.0, rate * currentBurstSeconds);
+            it.value().lastBudgetRefresh = now;
+        }
+
+        Bucket& bucket = it.value();
+
+        if (now > bucket.lastRefill) {
+            double refill = bucket.rate * (now - bucket.lastRefill) / 1000.0;
+            bucket.tokens     = std::min(bucket.depth, bucket.tokens + refill);
+            bucket.lastRefill = now;
+        }
+
+        // Requests costing more than the bucket can hold would otherwise never be admitted.
+        double spend = std::min(cost, bucket.depth);
+        if (bucket.rate <= 0) {
+            result = true;
+        } else if (bucket.tokens >= spend) {
+            bucket.tokens -= spend;
+            result = true;
+        } else {
+            if (retryAfterSeconds != nullptr) {
+                double shortfall = spend - bucket.tokens;
+                *retryAfterSeconds = std::max(1U, static_cast<unsigned>(std::ceil(shortfall / bucket.rate)));
+            }
+
+            rejectedMetric->increment();
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+
+double CustomerRateLimiter::customerRate(CustomerId customerId, unsigned threadId) {
+    CustomerCapabilities capabilities = currentCustomersCapabilities->getCustomerCapabilities(
+        customerId,
+        false,
+        threadId
+    );
+
+    QMutexLocker locker(&bucketMutex);
+
+    double result = currentBaseRate;
+    if (capabilities.isValid()) {
+        result += currentRatePerMonitor * capabilities.maximumNumberMonitors();
+    }
+
+    return result;
+}
+
+
+void CustomerRateLimiter::sweep(qint64 now) {
+    QHash<CustomerId, Bucket>::iterator it = buckets.begin();
+    while (it != buckets.end()) {
+        const Bucket& bucket   = it.value();
+        double        idleTime = (now - bucket.lastRefill) / 1000.0;
+
+        if (bucket.tokens + bucket.rate * idleTime >= bucket.depth) {
+            it = buckets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -23,8 +23,10 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QJsonArray>
 #include <QImage>
 #include <QBuffer>
+#include <QDataStream>
 
 #include <rest_api_in_v1_server.h>
 #include <rest_api_in_v1_json_response.h>
@@ -48,15 +50,25 @@
 #include "event_processor.h"
 #include "latency_entry.h"
 #include "aggregated_latency_entry.h"
+#include "latency_rolling_statistics.h"
 #include "latency_interface_manager.h"
 #include "plot_mailbox.h"
+#include "plot_cache.h"
 #include "latency_plotter.h"
 #include "resource.h"
 #include "active_resources.h"
 #include "resources.h"
 #include "resource_plotter.h"
 #include "server_administrator.h"
+#include "json_stream_writer.h"
+#include "response_compressor.h"
+#include "catalog.h"
+#include "dashboard_cache.h"
+#include "customer_rate_limiter.h"
 #include "rest_helpers.h"
+#include "request_tracer.h"
+#include "worker_pools.h"
+#include "traffic_recorder.h"
 #include "customer_rest_api_v1.h"
 
 /***********************************************************************************************************************
@@ -65,11 +77,14 @@
 
 CustomerRestApiV1::CapabilitiesGet::CapabilitiesGet(
         CustomerAuthenticator* customerAuthenticator,
-        CustomersCapabilities* customerCapabilitiesDatabaseApi
+        CustomersCapabilities* customerCapabilitiesDatabaseApi,
+        Catalog*               catalog
     ):RestApiInV1::InesonicCustomerRestHandler(
         customerAuthenticator
     ),customersCapabilities(
         customerCapabilitiesDatabaseApi
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -77,23 +92,34 @@ CustomerRestApiV1::CapabilitiesGet::~CapabilitiesGet() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::CapabilitiesGet::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
-        const QJsonDocument& /* request */,
+        const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::CapabilitiesGet"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
-    CustomerCapabilities capabilities = customersCapabilities->getCustomerCapabilities(
-        static_cast<CustomerCapabilities::CustomerId>(customerId),
-        false,
-        threadId
-    );
+    QString     etag = entityTag(path, customerId, currentCatalog->customerVersion(customerId));
 
-    if (capabilities.isValid()) {
-        responseObject.insert("status", "OK");
-        responseObject.insert("capabilities", convertToJson(capabilities, false, false, false));
+    if (ifNoneMatch(request) == etag) {
+        responseObject.insert("status", "OK, not modified");
+        responseObject.insert("etag", etag);
     } else {
-        responseObject.insert("status", "failed, no capabilities identified");
+        CustomerCapabilities capabilities = customersCapabilities->getCustomerCapabilities(
+            static_cast<CustomerCapabilities::CustomerId>(customerId),
+            false,
+            threadId
+        );
+
+        if (capabilities.isValid()) {
+            responseObject.insert("status", "OK");
+            responseObject.insert("capabilities", convertToJson(capabilities, false, false, false));
+            responseObject.insert("etag", etag);
+        } else {
+            responseObject.insert("status", "failed, no capabilities identified");
+        }
     }
 
     return RestApiInV1::JsonResponse(responseObject);
@@ -117,11 +143,14 @@ CustomerRestApiV1::HostsGet::~HostsGet() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::HostsGet::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::HostsGet"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -157,11 +186,14 @@ RestApiInV1::JsonResponse CustomerRestApiV1::HostsGet::processAuthenticatedReque
 
 CustomerRestApiV1::HostsList::HostsList(
         CustomerAuthenticator* customerAuthenticator,
-        HostSchemes*           hostSchemeDatabaseApi
+        HostSchemes*           hostSchemeDatabaseApi,
+        Catalog*               catalog
     ):RestApiInV1::InesonicCustomerRestHandler(
         customerAuthenticator
     ),currentHostSchemes(
         hostSchemeDatabaseApi
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -169,20 +201,30 @@ CustomerRestApiV1::HostsList::~HostsList() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::HostsList::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
-        const QJsonDocument& /* request */,
+        const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::HostsList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
+    QString     etag = entityTag(path, customerId, currentCatalog->customerVersion(customerId));
 
-    HostSchemes::HostSchemeHash customerHostSchemes = currentHostSchemes->getHostSchemes(
-        static_cast<HostSchemes::CustomerId>(customerId),
-        threadId
-    );
+    if (ifNoneMatch(request) == etag) {
+        responseObject.insert("status", "OK, not modified");
+    } else {
+        HostSchemes::HostSchemeHash customerHostSchemes = currentHostSchemes->getHostSchemes(
+            static_cast<HostSchemes::CustomerId>(customerId),
+            threadId
+        );
 
-    responseObject.insert("status", "OK");
-    responseObject.insert("host_schemes", convertToJson(customerHostSchemes, false));
+        responseObject.insert("status", "OK");
+        responseObject.insert("host_schemes", convertToJson(customerHostSchemes, false));
+    }
+
+    responseObject.insert("etag", etag);
 
     return RestApiInV1::JsonResponse(responseObject);
 }
@@ -205,11 +247,14 @@ CustomerRestApiV1::MonitorsGet::~MonitorsGet() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::MonitorsGet::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::MonitorsGet"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -245,13 +290,16 @@ RestApiInV1::JsonResponse CustomerRestApiV1::MonitorsGet::processAuthenticatedRe
 CustomerRestApiV1::MonitorsList::MonitorsList(
         CustomerAuthenticator* customerAuthenticator,
         Monitors*              monitorDatabaseApi,
-        HostSchemes*           hostSchemeDatabaseApi
+        HostSchemes*           hostSchemeDatabaseApi,
+        Catalog*               catalog
     ):RestApiInV1::InesonicCustomerRestHandler(
         customerAuthenticator
     ),currentMonitors(
         monitorDatabaseApi
     ),currentHostSchemes(
         hostSchemeDatabaseApi
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -259,25 +307,42 @@ CustomerRestApiV1::MonitorsList::~MonitorsList() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::MonitorsList::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::MonitorsList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     QString orderBy("monitor_id");
     bool    validRequest = true;
     if (request.isObject()) {
         QJsonObject requestObject = request.object();
-        if (requestObject.size() == 1 && requestObject.contains("order_by")) {
+        int         numberFields  = 0;
+
+        if (requestObject.contains("order_by")) {
             orderBy = requestObject.value("order_by").toString().toLower().replace('-', '_');
-        } else {
-            validRequest = false;
+            ++numberFields;
+        }
+
+        if (requestObject.contains("if_none_match")) {
+            ++numberFields;
         }
+
+        validRequest = (numberFields > 0 && numberFields == requestObject.size());
     }
 
-    if (validRequest) {
+    QString etag = entityTag(path, customerId, currentCatalog->customerVersion(customerId), orderBy);
+    if (validRequest && ifNoneMatch(request) == etag) {
+        QJsonObject responseObject;
+        responseObject.insert("status", "OK, not modified");
+        responseObject.insert("etag", etag);
+
+        response = RestApiInV1::JsonResponse(responseObject);
+    } else if (validRequest) {
         QJsonObject responseObject;
 
         enum class OrderBy {
@@ -374,6 +439,7 @@ RestApiInV1::JsonResponse CustomerRestApiV1::MonitorsList::processAuthenticatedR
 
             responseObject.insert("status", "OK");
             responseObject.insert("monitors", monitorsObject);
+            responseObject.insert("etag", etag);
         } else {
             responseObject.insert("status", "failed, invalid order_by value.");
         }
@@ -405,11 +471,14 @@ CustomerRestApiV1::MonitorsUpdate::~MonitorsUpdate() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::MonitorsUpdate::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::MonitorsUpdate"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isArray()) {
@@ -498,11 +567,14 @@ CustomerRestApiV1::RegionsGet::~RegionsGet() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::RegionsGet::processAuthenticatedRequest(
-        const QString&       /* path */,
-        unsigned long        /* customerId */,
+        const QString&       path,
+        unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::RegionsGet"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -553,26 +625,36 @@ CustomerRestApiV1::RegionsList::~RegionsList() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::RegionsList::processAuthenticatedRequest(
-        const QString&       /* path */,
-        unsigned long        /* customerId */,
-        const QJsonDocument& /* request */,
+        const QString&       path,
+        unsigned long        customerId,
+        const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::RegionsList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
+    QString     etag = entityTag(path, 0, currentRegions->version());
 
-    Regions::RegionHash regions = currentRegions->getAllRegions(threadId);
+    if (ifNoneMatch(request) == etag) {
+        responseObject.insert("status", "OK, not modified");
+    } else {
+        Regions::RegionHash regions = currentRegions->getAllRegions(threadId);
 
-    QJsonObject regionsObject;
-    for (Regions::RegionHash::const_iterator it=regions.constBegin(),end=regions.constEnd() ; it!=end ; ++it) {
-        QJsonObject regionObject;
-        regionObject.insert("region_id", it.value().regionId());
-        regionObject.insert("description", it.value().regionName());
+        QJsonObject regionsObject;
+        for (Regions::RegionHash::const_iterator it=regions.constBegin(),end=regions.constEnd() ; it!=end ; ++it) {
+            QJsonObject regionObject;
+            regionObject.insert("region_id", it.value().regionId());
+            regionObject.insert("description", it.value().regionName());
 
-        regionsObject.insert(QString::number(it.key()), regionObject);
+            regionsObject.insert(QString::number(it.key()), regionObject);
+        }
+
+        responseObject.insert("status", "OK");
+        responseObject.insert("regions" , regionsObject);
     }
 
-    responseObject.insert("status", "OK");
-    responseObject.insert("regions" , regionsObject);
+    responseObject.insert("etag", etag);
 
     return RestApiInV1::JsonResponse(responseObject);
 }
@@ -595,11 +677,14 @@ CustomerRestApiV1::EventsGet::~EventsGet() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::EventsGet::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::EventsGet"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -635,29 +720,38 @@ RestApiInV1::JsonResponse CustomerRestApiV1::EventsGet::processAuthenticatedRequ
 
 CustomerRestApiV1::EventsList::EventsList(
         CustomerAuthenticator* customerAuthenticator,
-        Events*                eventDatabaseApi
-    ):RestApiInV1::InesonicCustomerRestHandler(
+        Events*                eventDatabaseApi,
+        ResponseCompressor*    responseCompressor
+    ):RestApiInV1::InesonicCustomerBinaryRestHandler(
         customerAuthenticator
     ),currentEvents(
         eventDatabaseApi
+    ),currentResponseCompressor(
+        responseCompressor
     ) {}
 
 
 CustomerRestApiV1::EventsList::~EventsList() {}
 
 
-RestApiInV1::JsonResponse CustomerRestApiV1::EventsList::processAuthenticatedRequest(
-        const QString&       /* path */,
+RestApiInV1::BinaryResponse CustomerRestApiV1::EventsList::processAuthenticatedRequest(
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::EventsList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
 
-    unsigned long long startTimestamp   = 0;
-    unsigned long long endTimestamp     = static_cast<unsigned long long>(-1);
-    bool               isValid          = true;
-    bool               sendJsonResponse = true;
+    unsigned long long           startTimestamp   = 0;
+    unsigned long long           endTimestamp     = static_cast<unsigned long long>(-1);
+    Events::Cursor               after;
+    unsigned long                pageSize         = Events::unlimitedPageSize;
+    bool                         isValid          = true;
+    bool                         sendJsonResponse = true;
+    ResponseCompressor::Encoding encoding         = ResponseCompressor::Encoding::IDENTITY;
 
     if (request.isObject()) {
         QJsonObject object       = request.object();
@@ -687,27 +781,78 @@ RestApiInV1::JsonResponse CustomerRestApiV1::EventsList::processAuthenticatedReq
             ++numberFields;
         }
 
+        if (object.contains("page_size")) {
+            double pageSizeDouble = object.value("page_size").toDouble(-1);
+            if (pageSizeDouble >= 1 && pageSizeDouble <= 0xFFFFFFFF) {
+                pageSize = static_cast<unsigned long>(pageSizeDouble);
+            } else {
+                responseObject.insert("status", "failed, invalid page size");
+                isValid = false;
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("cursor")) {
+            bool cursorOk;
+            after = convertToCursor(object.value("cursor").toString(), &cursorOk);
+            if (!cursorOk) {
+                responseObject.insert("status", "failed, invalid cursor");
+                isValid = false;
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("accept_encoding")) {
+            encoding = ResponseCompressor::selectEncoding(object.value("accept_encoding").toString());
+            ++numberFields;
+        }
+
         if (numberFields != static_cast<unsigned>(object.size())) {
             sendJsonResponse = false;
             isValid          = false;
         }
     }
 
+    RestApiInV1::BinaryResponse response(StatusCode::BAD_REQUEST);
+
     if (isValid && sendJsonResponse) {
         Events::EventList events = currentEvents->getEventsByCustomer(
             static_cast<CustomerCapabilities::CustomerId>(customerId),
             startTimestamp,
             endTimestamp,
+            after,
+            pageSize,
             threadId
         );
 
-        responseObject.insert("status", "OK");
-        responseObject.insert("events", convertToJson(events, false, false));
+        // The listing is streamed into the response so no intermediate QJsonArray of every event is built.
+        RequestTracer::Span jsonSpan(RequestTracer::Phase::JSON, threadId);
+        JsonStreamWriter writer;
+        writer.beginObject();
+        writer.insert("status", "OK");
+        writeJson(writer, "events", events, false, false);
+
+        Events::Cursor next = nextCursor(events, pageSize);
+        if (next.isValid()) {
+            writer.insert("next_cursor", convertToString(next));
+        }
+
+        writer.endObject();
+
+        QByteArray contentType("application/json");
+        QByteArray data = currentResponseCompressor->compress(encoding, contentType, writer.data());
+
+        response = RestApiInV1::BinaryResponse(contentType, data);
+    } else if (sendJsonResponse) {
+        response = RestApiInV1::BinaryResponse(
+            QByteArray("application/json"),
+            QJsonDocument(responseObject).toJson()
+        );
     }
 
-    return   sendJsonResponse
-           ? RestApiInV1::JsonResponse(responseObject)
-           : RestApiInV1::JsonResponse(StatusCode::BAD_REQUEST);
+    return response;
 }
 
 /***********************************************************************************************************************
@@ -731,11 +876,14 @@ CustomerRestApiV1::EventsCreate::~EventsCreate() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::EventsCreate::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::EventsCreate"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
 
     if (request.isObject()) {
@@ -830,11 +978,14 @@ CustomerRestApiV1::StatusGet::~StatusGet() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::StatusGet::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::StatusGet"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -870,11 +1021,14 @@ RestApiInV1::JsonResponse CustomerRestApiV1::StatusGet::processAuthenticatedRequ
 
 CustomerRestApiV1::StatusList::StatusList(
         CustomerAuthenticator* customerAuthenticator,
-        Events*                eventDatabaseApi
+        Events*                eventDatabaseApi,
+        Catalog*               catalog
     ):RestApiInV1::InesonicCustomerRestHandler(
         customerAuthenticator
     ),currentEvents(
         eventDatabaseApi
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -882,143 +1036,780 @@ CustomerRestApiV1::StatusList::~StatusList() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::StatusList::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
-        const QJsonDocument& /* request */,
+        const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::StatusList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
+    QString     etag = entityTag(path, customerId, currentCatalog->customerVersion(customerId));
 
-    Events::MonitorStatusByMonitorId monitorStatus = currentEvents->monitorStatusByCustomerId(
-        static_cast<CustomerCapabilities::CustomerId>(customerId),
-        threadId
-    );
+    if (ifNoneMatch(request) == etag) {
+        responseObject.insert("status", "OK, not modified");
+    } else {
+        Events::MonitorStatusByMonitorId monitorStatus = currentEvents->monitorStatusByCustomerId(
+            static_cast<CustomerCapabilities::CustomerId>(customerId),
+            threadId
+        );
+
+        responseObject.insert("status", "OK");
+        responseObject.insert("monitor_status", convertToJson(monitorStatus));
+    }
+
+    responseObject.insert("etag", etag);
+
+    return RestApiInV1::JsonResponse(responseObject);
+}
+
+/***********************************************************************************************************************
+* CustomerRestApiV1::StatusWait
+*/
+
+CustomerRestApiV1::StatusWait::StatusWait(
+        CustomerAuthenticator* customerAuthenticator,
+        Events*                eventDatabaseApi,
+        Catalog*               catalog
+    ):RestApiInV1::InesonicCustomerRestHandler(
+        customerAuthenticator
+    ),currentEvents(
+        eventDatabaseApi
+    ),currentCatalog(
+        catalog
+    ),currentNumberWaiters(
+        0
+    ) {}
+
+
+CustomerRestApiV1::StatusWait::~StatusWait() {}
+
+
+RestApiInV1::JsonResponse CustomerRestApiV1::StatusWait::processAuthenticatedRequest(
+        const QString&       path,
+        unsigned long        customerId,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::StatusWait"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
+    QJsonObject responseObject;
+
+    QString            ifNoneMatchTag;
+    unsigned long      timeoutMilliseconds = 1000UL * defaultTimeoutSeconds;
+    unsigned long long sinceTimestamp      = 0;
+    bool               includeEvents       = false;
+    bool               isValid             = true;
+    bool               sendJsonResponse    = true;
+
+    if (request.isObject()) {
+        QJsonObject object       = request.object();
+        unsigned    numberFields = 0;
+
+        if (object.contains("if_none_match")) {
+            ifNoneMatchTag = object.value("if_none_match").toString();
+            ++numberFields;
+        }
+
+        if (object.contains("timeout")) {
+            double timeoutDouble = object.value("timeout").toDouble(-1);
+            if (timeoutDouble >= 0 && timeoutDouble <= maximumTimeoutSeconds) {
+                timeoutMilliseconds = static_cast<unsigned long>(1000.0 * timeoutDouble);
+            } else {
+                responseObject.insert("status", "failed, invalid timeout");
+                isValid = false;
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("since")) {
+            double sinceDouble = object.value("since").toDouble(-1);
+            if (sinceDouble >= 0) {
+                sinceTimestamp = static_cast<unsigned long long>(sinceDouble);
+                includeEvents  = true;
+            } else {
+                responseObject.insert("status", "failed, invalid since timestamp");
+                isValid = false;
+            }
+
+            ++numberFields;
+        }
+
+        if (numberFields != static_cast<unsigned>(object.size())) {
+            sendJsonResponse = false;
+            isValid          = false;
+        }
+    }
+
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (isValid) {
+        CustomerCapabilities::CustomerId id      = static_cast<CustomerCapabilities::CustomerId>(customerId);
+        unsigned long long               version = currentCatalog->customerVersion(id);
+
+        // Tags match those issued by v1/status/list so clients can move between the two endpoints freely.
+        QString etag = entityTag(statusListPath, customerId, version);
+        if (ifNoneMatchTag == etag && timeoutMilliseconds > 0) {
+            if (currentNumberWaiters.fetchAndAddOrdered(1) < maximumNumberWaiters) {
+                version = currentCatalog->waitForCustomerChange(id, version, timeoutMilliseconds);
+                etag    = entityTag(statusListPath, customerId, version);
+            }
+
+            currentNumberWaiters.fetchAndSubOrdered(1);
+        }
+
+        if (ifNoneMatchTag == etag) {
+            responseObject.insert("status", "OK, not modified");
+        } else {
+            Events::MonitorStatusByMonitorId monitorStatus = currentEvents->monitorStatusByCustomerId(id, threadId);
+
+            responseObject.insert("status", "OK");
+            responseObject.insert("monitor_status", convertToJson(monitorStatus));
+
+            if (includeEvents) {
+                Events::EventList events = currentEvents->getEventsByCustomer(
+                    id,
+                    sinceTimestamp,
+                    static_cast<unsigned long long>(-1),
+                    threadId
+                );
+
+                responseObject.insert("events", convertToJson(events, false, false));
+            }
+        }
+
+        responseObject.insert("etag", etag);
+        response = RestApiInV1::JsonResponse(responseObject);
+    } else if (sendJsonResponse) {
+        response = RestApiInV1::JsonResponse(responseObject);
+    }
+
+    return response;
+}
+
+/***********************************************************************************************************************
+* CustomerRestApiV1::MultipleList
+*/
+
+CustomerRestApiV1::MultipleList::MultipleList(
+        CustomerAuthenticator* customerAuthenticator,
+        DashboardCache*        dashboardCache,
+        ResponseCompressor*    responseCompressor,
+        CustomerRateLimiter*   rateLimiter
+    ):RestApiInV1::InesonicCustomerBinaryRestHandler(
+        customerAuthenticator
+    ),currentDashboardCache(
+        dashboardCache
+    ),currentResponseCompressor(
+        responseCompressor
+    ),currentRateLimiter(
+        rateLimiter
+    ) {}
+
+
+CustomerRestApiV1::MultipleList::~MultipleList() {}
+
+
+RestApiInV1::BinaryResponse CustomerRestApiV1::MultipleList::processAuthenticatedRequest(
+        const QString&       path,
+        unsigned long        customerId,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::MultipleList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
+    RestApiInV1::BinaryResponse response;
+
+    unsigned retryAfter = 0;
+    if (!currentRateLimiter->admit(customerId, multipleListCost, threadId, &retryAfter)) {
+        QJsonObject responseObject;
+        responseObject.insert("status", "failed, rate limited");
+        responseObject.insert("retry_after", static_cast<double>(retryAfter));
+
+        response = RestApiInV1::BinaryResponse(QByteArray("application/json"), QJsonDocument(responseObject).toJson());
+    } else {
+        // The request body is otherwise ignored so older callers that send arbitrary content keep working.
+        ResponseCompressor::Encoding encoding = ResponseCompressor::Encoding::IDENTITY;
+        if (request.isObject()) {
+            encoding = ResponseCompressor::selectEncoding(request.object().value("accept_encoding").toString());
+        }
+
+        QByteArray contentType("application/json");
+        QByteArray data = currentResponseCompressor->compress(
+            encoding,
+            contentType,
+            currentDashboardCache->dashboard(static_cast<DashboardCache::CustomerId>(customerId), threadId)
+        );
+
+        response = RestApiInV1::BinaryResponse(contentType, data);
+    }
+
+    return response;
+}
+
+/***********************************************************************************************************************
+* CustomerRestApiV1::LatencyList
+*/
+
+CustomerRestApiV1::LatencyList::LatencyList(
+        CustomerAuthenticator*   customerAuthenticator,
+        LatencyInterfaceManager* latencyInterfaceManager,
+        ServerAdministrator*     serverAdministrator,
+        ResponseCompressor*      responseCompressor,
+        CustomerRateLimiter*     rateLimiter
+    ):RestApiInV1::InesonicCustomerBinaryRestHandler(
+        customerAuthenticator
+    ),currentLatencyInterfaceManager(
+        latencyInterfaceManager
+    ),currentServerAdministrator(
+        serverAdministrator
+    ),currentResponseCompressor(
+        responseCompressor
+    ),currentRateLimiter(
+        rateLimiter
+    ) {}
+
+
+CustomerRestApiV1::LatencyList::~LatencyList() {}
+
+
+RestApiInV1::BinaryResponse CustomerRestApiV1::LatencyList::processAuthenticatedRequest(
+        const QString&       path,
+        unsigned long        customerId,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::LatencyList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
+    RestApiInV1::BinaryResponse response;
+
+    if (request.isObject()) {
+        QJsonObject                  responseObject;
+        bool                         success        = true;
+        QJsonObject                  object         = request.object();
+        unsigned                     numberFields   = 0;
+        Monitor::MonitorId           monitorId      = Monitor::invalidMonitorId;
+        Region::RegionId             regionId       = Region::invalidRegionId;
+        unsigned long long           startTimestamp = 0;
+        unsigned long long           endTimestamp   = std::numeric_limits<unsigned long long>::max();
+        unsigned long                resolution     = 0;
+        unsigned long                maximumPoints  = 0;
+        bool                         downsample     = false;
+        ResponseCompressor::Encoding encoding       = ResponseCompressor::Encoding::IDENTITY;
+
+        if (object.contains("monitor_id")) {
+            if (success) {
+                double monitorIdDouble = object.value("monitor_id").toDouble(-1);
+                if (monitorIdDouble > 0 && monitorIdDouble <= 0xFFFFFFFF) {
+                    monitorId = static_cast<Monitor::MonitorId>(monitorIdDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid monitor ID");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("region_id")) {
+            if (success) {
+                double regionIdDouble = object.value("region_id").toDouble(-1);
+                if (regionIdDouble > 0 && regionIdDouble <= 0xFFFF) {
+                    regionId = static_cast<Server::ServerId>(regionIdDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid region ID");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("start_timestamp")) {
+            if (success) {
+                double startTimestampDouble = object.value("start_timestamp").toDouble(-1);
+                if (startTimestampDouble >= 0) {
+                    startTimestamp = static_cast<unsigned long long>(startTimestampDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid start timestamp");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("end_timestamp")) {
+            if (success) {
+                double endTimestampDouble = object.value("end_timestamp").toDouble(-1);
+                if (endTimestampDouble >= 0) {
+                    endTimestamp = static_cast<unsigned long long>(endTimestampDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid end timestamp");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("resolution")) {
+            if (success) {
+                double resolutionDouble = object.value("resolution").toDouble(-1);
+                if (resolutionDouble >= 1 && resolutionDouble <= 0xFFFFFFFF) {
+                    resolution = static_cast<unsigned long>(resolutionDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid resolution");
+                }
+            }
+
+            downsample = true;
+            ++numberFields;
+        }
+
+        if (object.contains("max_points")) {
+            if (success) {
+                double maximumPointsDouble = object.value("max_points").toDouble(-1);
+                if (maximumPointsDouble >= 1 && maximumPointsDouble <= 1000000) {
+                    maximumPoints = static_cast<unsigned long>(maximumPointsDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid max points");
+                }
+            }
+
+            downsample = true;
+            ++numberFields;
+        }
+
+        if (object.contains("accept_encoding")) {
+            encoding = ResponseCompressor::selectEncoding(object.value("accept_encoding").toString());
+            ++numberFields;
+        }
+
+        unsigned retryAfter = 0;
+        if (success && !currentRateLimiter->admit(customerId, latencyListCost, threadId, &retryAfter)) {
+            success = false;
+            responseObject.insert("status", "failed, rate limited");
+            responseObject.insert("retry_after", static_cast<double>(retryAfter));
+        }
+
+        WorkerPools::Admission admission(WorkerPools::Pool::CUSTOMER);
+        if (success && !admission.admitted()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
+        if (!success) {
+            response = RestApiInV1::BinaryResponse(
+                QByteArray("application/json"),
+                QJsonDocument(responseObject).toJson()
+            );
+        } else if (numberFields == static_cast<unsigned>(object.size())) {
+            LatencyInterfaceManager::LatencyEntryList           rawEntries;
+            LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedEntries;
+            unsigned long                                       interval = 0;
+
+            if (downsample) {
+                aggregatedEntries = currentLatencyInterfaceManager->getLatencyBuckets(
+                    static_cast<CustomerCapabilities::CustomerId>(customerId),
+                    HostScheme::invalidHostSchemeId,
+                    monitorId,
+                    regionId,
+                    Server::invalidServerId,
+                    startTimestamp,
+                    endTimestamp,
+                    resolution,
+                    maximumPoints,
+                    threadId,
+                    &interval
+                );
+            } else {
+                LatencyInterfaceManager::LatencyEntryLists result = currentLatencyInterfaceManager->getLatencyEntries(
+                    static_cast<CustomerCapabilities::CustomerId>(customerId),
+                    HostScheme::invalidHostSchemeId,
+                    monitorId,
+                    regionId,
+                    Server::invalidServerId,
+                    startTimestamp,
+                    endTimestamp,
+                    threadId
+                );
+
+                rawEntries        = result.first;
+                aggregatedEntries = result.second;
+            }
+
+            Servers::ServersById   serversById  = currentServerAdministrator->getServersById(threadId);
+            Monitors::MonitorsById monitorsById;
 
-    QJsonObject statusObject;
-    for (  Events::MonitorStatusByMonitorId::const_iterator it  = monitorStatus.constBegin(),
-                                                            end = monitorStatus.constEnd()
-         ; it != end
-         ; ++it
-        ) {
-        statusObject.insert(QString::number(it.key()), Monitor::toString(it.value()).toLower());
+            // The listing is streamed into the response so no intermediate QJsonArray of every entry is built.
+            RequestTracer::Span jsonSpan(RequestTracer::Phase::JSON, threadId);
+            JsonStreamWriter writer(estimatedJsonSize(rawEntries, aggregatedEntries));
+            writer.beginObject();
+            writer.insert("status", "OK");
+
+            if (downsample) {
+                writer.insert("resolution", static_cast<double>(interval));
+            }
+
+            writeJson(writer, "recent", rawEntries, serversById, monitorsById, false, true, false);
+            writeJson(writer, "aggregated", aggregatedEntries, serversById, monitorsById, false, true, false);
+            writer.endObject();
+
+            QByteArray contentType("application/json");
+            QByteArray data = currentResponseCompressor->compress(encoding, contentType, writer.data());
+
+            response = RestApiInV1::BinaryResponse(contentType, data);
+        }
+    }
+
+    return response;
+}
+
+/***********************************************************************************************************************
+* CustomerRestApiV1::LatencyStatistics
+*/
+
+CustomerRestApiV1::LatencyStatistics::LatencyStatistics(
+        CustomerAuthenticator*   customerAuthenticator,
+        LatencyInterfaceManager* latencyInterfaceManager,
+        CustomerRateLimiter*     rateLimiter
+    ):RestApiInV1::InesonicCustomerRestHandler(
+        customerAuthenticator
+    ),currentLatencyInterfaceManager(
+        latencyInterfaceManager
+    ),currentRateLimiter(
+        rateLimiter
+    ) {}
+
+
+CustomerRestApiV1::LatencyStatistics::~LatencyStatistics() {}
+
+
+RestApiInV1::JsonResponse CustomerRestApiV1::LatencyStatistics::processAuthenticatedRequest(
+        const QString&       path,
+        unsigned long        customerId,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::LatencyStatistics"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
+    RestApiInV1::JsonResponse response;
+
+    if (request.isObject()) {
+        QJsonObject                           responseObject;
+        bool                                  success        = true;
+        QJsonObject                           object         = request.object();
+        unsigned                              numberFields   = 0;
+        LatencyInterfaceManager::MonitorIdSet monitorIds;
+        Region::RegionId                      regionId       = Region::invalidRegionId;
+        unsigned long long                    startTimestamp = 0;
+        unsigned long long                    endTimestamp   = std::numeric_limits<unsigned long long>::max();
+
+        if (object.contains("monitor_ids")) {
+            if (success) {
+                QJsonArray monitorIdArray = object.value("monitor_ids").toArray();
+                for (  QJsonArray::const_iterator it  = monitorIdArray.constBegin(),
+                                                  end = monitorIdArray.constEnd()
+                     ; success && it != end
+                     ; ++it
+                    ) {
+                    double monitorIdDouble = (*it).toDouble(-1);
+                    if (monitorIdDouble > 0 && monitorIdDouble <= 0xFFFFFFFF) {
+                        monitorIds.insert(static_cast<Monitor::MonitorId>(monitorIdDouble));
+                    } else {
+                        success = false;
+                        responseObject.insert("status", "failed, invalid monitor ID");
+                    }
+                }
+
+                if (success && monitorIds.isEmpty()) {
+                    success = false;
+                    responseObject.insert("status", "failed, no monitor IDs");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("region_id")) {
+            if (success) {
+                double regionIdDouble = object.value("region_id").toDouble(-1);
+                if (regionIdDouble > 0 && regionIdDouble <= 0xFFFF) {
+                    regionId = static_cast<Region::RegionId>(regionIdDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid region ID");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("start_timestamp")) {
+            if (success) {
+                double startTimestampDouble = object.value("start_timestamp").toDouble(-1);
+                if (startTimestampDouble >= 0) {
+                    startTimestamp = static_cast<unsigned long long>(startTimestampDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid start timestamp");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("end_timestamp")) {
+            if (success) {
+                double endTimestampDouble = object.value("end_timestamp").toDouble(-1);
+                if (endTimestampDouble >= 0) {
+                    endTimestamp = static_cast<unsigned long long>(endTimestampDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid end timestamp");
+                }
+            }
+
+            ++numberFields;
+        }
+
+        unsigned retryAfter = 0;
+        if (success && !currentRateLimiter->admit(customerId, latencyStatisticsCost, threadId, &retryAfter)) {
+            success = false;
+            responseObject.insert("status", "failed, rate limited");
+            responseObject.insert("retry_after", static_cast<double>(retryAfter));
+        }
+
+        WorkerPools::Admission admission(WorkerPools::Pool::CUSTOMER);
+        if (success && !admission.admitted()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
+        if (!success) {
+            response = RestApiInV1::JsonResponse(responseObject);
+        } else if (numberFields == static_cast<unsigned>(object.size())) {
+            LatencyInterfaceManager::LatencyStatisticsByMonitorId statistics;
+            statistics = currentLatencyInterfaceManager->getBulkLatencyStatistics(
+                static_cast<CustomerCapabilities::CustomerId>(customerId),
+                monitorIds,
+                regionId,
+                Server::invalidServerId,
+                startTimestamp,
+                endTimestamp,
+                threadId,
+                &success
+            );
+
+            if (success) {
+                QJsonObject statisticsObject;
+                for (  LatencyInterfaceManager::LatencyStatisticsByMonitorId::const_iterator
+                           it  = statistics.constBegin(),
+                           end = statistics.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    const AggregatedLatencyEntry& entry = it.value();
+
+                    QJsonObject monitorObject;
+                    monitorObject.insert("mean", entry.meanLatency() * 1.0E-6);
+                    monitorObject.insert("variance", entry.varianceLatency() * 1.0E-12);
+                    monitorObject.insert("minimum", entry.minimumLatency() * 1.0E-6);
+                    monitorObject.insert("maximum", entry.maximumLatency() * 1.0E-6);
+                    monitorObject.insert("number_samples", static_cast<double>(entry.numberSamples()));
+
+                    statisticsObject.insert(QString::number(it.key()), monitorObject);
+                }
+
+                responseObject.insert("status", "OK");
+                responseObject.insert("statistics", statisticsObject);
+            } else {
+                responseObject.insert("status", "failed");
+            }
+
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
     }
 
-    responseObject.insert("status", "OK");
-    responseObject.insert("monitor_status", statusObject);
-
-    return RestApiInV1::JsonResponse(responseObject);
+    return response;
 }
 
-
-
 /***********************************************************************************************************************
-* CustomerRestApiV1::MultipleList
+* CustomerRestApiV1::LatencyRolling
 */
 
-CustomerRestApiV1::MultipleList::MultipleList(
-        CustomerAuthenticator* customerAuthenticator,
-        HostSchemes*           hostSchemeDatabaseApi,
-        Monitors*              monitorDatabaseApi,
-        Events*                eventDatabaseApi
+CustomerRestApiV1::LatencyRolling::LatencyRolling(
+        CustomerAuthenticator*   customerAuthenticator,
+        LatencyInterfaceManager* latencyInterfaceManager,
+        CustomerRateLimiter*     rateLimiter
     ):RestApiInV1::InesonicCustomerRestHandler(
         customerAuthenticator
-    ),currentHostSchemes(
-        hostSchemeDatabaseApi
-    ),currentMonitors(
-        monitorDatabaseApi
-    ),currentEvents(
-        eventDatabaseApi
+    ),currentLatencyInterfaceManager(
+        latencyInterfaceManager
+    ),currentRateLimiter(
+        rateLimiter
     ) {}
 
 
-CustomerRestApiV1::MultipleList::~MultipleList() {}
+CustomerRestApiV1::LatencyRolling::~LatencyRolling() {}
 
 
-RestApiInV1::JsonResponse CustomerRestApiV1::MultipleList::processAuthenticatedRequest(
-        const QString&       /* path */,
+RestApiInV1::JsonResponse CustomerRestApiV1::LatencyRolling::processAuthenticatedRequest(
+        const QString&       path,
         unsigned long        customerId,
-        const QJsonDocument& /* request */,
+        const QJsonDocument& request,
         unsigned             threadId
     ) {
-    QJsonObject responseObject;
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::LatencyRolling"), threadId);
+    TrafficRecorder::record(path, customerId, request);
 
-    HostSchemes::HostSchemeHash customerHostSchemes = currentHostSchemes->getHostSchemes(
-        static_cast<HostSchemes::CustomerId>(customerId),
-        threadId
-    );
+    RestApiInV1::JsonResponse response;
 
-    Monitors::MonitorList monitors = currentMonitors->getMonitorsByUserOrder(
-        static_cast<CustomerCapabilities::CustomerId>(customerId),
-        threadId
-    );
+    if (request.isObject()) {
+        QJsonObject                           responseObject;
+        bool                                  success      = true;
+        QJsonObject                           object       = request.object();
+        unsigned                              numberFields = 0;
+        LatencyInterfaceManager::MonitorIdSet monitorIds;
 
-    Events::MonitorStatusByMonitorId monitorStatusMultiple = currentEvents->monitorStatusByCustomerId(
-        static_cast<CustomerCapabilities::CustomerId>(customerId),
-        threadId
-    );
+        if (object.contains("monitor_ids")) {
+            if (success) {
+                QJsonArray monitorIdArray = object.value("monitor_ids").toArray();
+                for (  QJsonArray::const_iterator it  = monitorIdArray.constBegin(),
+                                                  end = monitorIdArray.constEnd()
+                     ; success && it != end
+                     ; ++it
+                    ) {
+                    double monitorIdDouble = (*it).toDouble(-1);
+                    if (monitorIdDouble > 0 && monitorIdDouble <= 0xFFFFFFFF) {
+                        monitorIds.insert(static_cast<Monitor::MonitorId>(monitorIdDouble));
+                    } else {
+                        success = false;
+                        responseObject.insert("status", "failed, invalid monitor ID");
+                    }
+                }
 
-    Events::EventList events = currentEvents->getEventsByCustomer(
-        static_cast<CustomerCapabilities::CustomerId>(customerId),
-        0,
-        static_cast<unsigned long long>(-1),
-        threadId
-    );
+                if (success && monitorIds.isEmpty()) {
+                    success = false;
+                    responseObject.insert("status", "failed, no monitor IDs");
+                }
+            }
 
-    QJsonObject statusObject;
-    for (  Events::MonitorStatusByMonitorId::const_iterator it  = monitorStatusMultiple.constBegin(),
-                                                            end = monitorStatusMultiple.constEnd()
-         ; it != end
-         ; ++it
-        ) {
-        statusObject.insert(QString::number(it.key()), Monitor::toString(it.value()).toLower());
-    }
+            ++numberFields;
+        }
 
-    responseObject.insert("status", "OK");
-    responseObject.insert("host_schemes", convertToJson(customerHostSchemes, false));
-    responseObject.insert("monitors", convertToJson(monitors, false));
-    responseObject.insert("events", convertToJson(events, false, false));
-    responseObject.insert("monitor_status", statusObject);
+        unsigned retryAfter = 0;
+        if (success && !currentRateLimiter->admit(customerId, latencyRollingCost, threadId, &retryAfter)) {
+            success = false;
+            responseObject.insert("status", "failed, rate limited");
+            responseObject.insert("retry_after", static_cast<double>(retryAfter));
+        }
 
-    return RestApiInV1::JsonResponse(responseObject);
+        if (!success) {
+            response = RestApiInV1::JsonResponse(responseObject);
+        } else if (numberFields == static_cast<unsigned>(object.size())) {
+            QJsonObject statisticsObject;
+            unsigned    windowIndex = 0;
+            while (success && windowIndex < LatencyRollingStatistics::numberWindows) {
+                LatencyRollingStatistics::Window window = static_cast<LatencyRollingStatistics::Window>(windowIndex);
+                LatencyInterfaceManager::RollingStatisticsByMonitorId statistics;
+                statistics = currentLatencyInterfaceManager->getRollingStatistics(
+                    static_cast<CustomerCapabilities::CustomerId>(customerId),
+                    monitorIds,
+                    Server::invalidServerId,
+                    window,
+                    threadId,
+                    &success
+                );
+
+                for (  LatencyInterfaceManager::RollingStatisticsByMonitorId::const_iterator
+                           it  = statistics.constBegin(),
+                           end = statistics.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    QString     monitorKey    = QString::number(it.key());
+                    QJsonObject monitorObject = statisticsObject.value(monitorKey).toObject();
+                    monitorObject.insert(LatencyRollingStatistics::toString(window), convertToJson(it.value()));
+                    statisticsObject.insert(monitorKey, monitorObject);
+                }
+
+                ++windowIndex;
+            }
+
+            if (success) {
+                responseObject.insert("status", "OK");
+                responseObject.insert("statistics", statisticsObject);
+            } else {
+                responseObject.insert("status", "failed");
+            }
+
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
+    }
+
+    return response;
 }
 
 /***********************************************************************************************************************
-* CustomerRestApiV1::LatencyList
+* CustomerRestApiV1::LatencyExport
 */
 
-CustomerRestApiV1::LatencyList::LatencyList(
+CustomerRestApiV1::LatencyExport::LatencyExport(
         CustomerAuthenticator*   customerAuthenticator,
         LatencyInterfaceManager* latencyInterfaceManager,
-        Servers*                 serverDatabaseApi
-    ):RestApiInV1::InesonicCustomerRestHandler(
+        ServerAdministrator*     serverAdministrator,
+        ResponseCompressor*      responseCompressor,
+        CustomerRateLimiter*     rateLimiter
+    ):RestApiInV1::InesonicCustomerBinaryRestHandler(
         customerAuthenticator
     ),currentLatencyInterfaceManager(
         latencyInterfaceManager
-    ),currentServers(
-        serverDatabaseApi
+    ),currentServerAdministrator(
+        serverAdministrator
+    ),currentResponseCompressor(
+        responseCompressor
+    ),currentRateLimiter(
+        rateLimiter
     ) {}
 
 
-CustomerRestApiV1::LatencyList::~LatencyList() {}
+CustomerRestApiV1::LatencyExport::~LatencyExport() {}
 
 
-RestApiInV1::JsonResponse CustomerRestApiV1::LatencyList::processAuthenticatedRequest(
-        const QString&       /* path */,
+RestApiInV1::BinaryResponse CustomerRestApiV1::LatencyExport::processAuthenticatedRequest(
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
-    RestApiInV1::JsonResponse response;
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::LatencyExport"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
+    RestApiInV1::BinaryResponse response;
 
     if (request.isObject()) {
-        QJsonObject        responseObject;
-        bool               success        = true;
-        QJsonObject        object         = request.object();
-        unsigned           numberFields   = 0;
-        Monitor::MonitorId monitorId      = Monitor::invalidMonitorId;
-        Region::RegionId   regionId       = Region::invalidRegionId;
-        unsigned long long startTimestamp = 0;
-        unsigned long long endTimestamp   = std::numeric_limits<unsigned long long>::max();
+        QJsonObject                  responseObject;
+        bool                         success        = true;
+        QJsonObject                  object         = request.object();
+        unsigned                     numberFields   = 0;
+        Monitor::MonitorId           monitorId      = Monitor::invalidMonitorId;
+        Region::RegionId             regionId       = Region::invalidRegionId;
+        unsigned long long           startTimestamp = 0;
+        unsigned long long           endTimestamp   = std::numeric_limits<unsigned long long>::max();
+        unsigned long                resolution     = 0;
+        unsigned long                maximumPoints  = 0;
+        bool                         downsample     = false;
+        ResponseCompressor::Encoding encoding       = ResponseCompressor::Encoding::IDENTITY;
 
         if (object.contains("monitor_id")) {
             if (success) {
@@ -1076,39 +1867,105 @@ RestApiInV1::JsonResponse CustomerRestApiV1::LatencyList::processAuthenticatedRe
             ++numberFields;
         }
 
-        if (numberFields == static_cast<unsigned>(object.size())) {
-            LatencyInterfaceManager::LatencyEntryLists result = currentLatencyInterfaceManager->getLatencyEntries(
-                static_cast<CustomerCapabilities::CustomerId>(customerId),
-                HostScheme::invalidHostSchemeId,
-                monitorId,
-                regionId,
-                Server::invalidServerId,
-                startTimestamp,
-                endTimestamp,
-                threadId
+        if (object.contains("resolution")) {
+            if (success) {
+                double resolutionDouble = object.value("resolution").toDouble(-1);
+                if (resolutionDouble >= 1 && resolutionDouble <= 0xFFFFFFFF) {
+                    resolution = static_cast<unsigned long>(resolutionDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid resolution");
+                }
+            }
+
+            downsample = true;
+            ++numberFields;
+        }
+
+        if (object.contains("max_points")) {
+            if (success) {
+                double maximumPointsDouble = object.value("max_points").toDouble(-1);
+                if (maximumPointsDouble >= 1 && maximumPointsDouble <= 1000000) {
+                    maximumPoints = static_cast<unsigned long>(maximumPointsDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid max points");
+                }
+            }
+
+            downsample = true;
+            ++numberFields;
+        }
+
+        if (object.contains("accept_encoding")) {
+            encoding = ResponseCompressor::selectEncoding(object.value("accept_encoding").toString());
+            ++numberFields;
+        }
+
+        unsigned retryAfter = 0;
+        if (success && !currentRateLimiter->admit(customerId, latencyExportCost, threadId, &retryAfter)) {
+            success = false;
+            responseObject.insert("status", "failed, rate limited");
+            responseObject.insert("retry_after", static_cast<double>(retryAfter));
+        }
+
+        WorkerPools::Admission admission(WorkerPools::Pool::CUSTOMER);
+        if (success && !admission.admitted()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
+        if (!success) {
+            response = RestApiInV1::BinaryResponse(
+                QByteArray("application/json"),
+                QJsonDocument(responseObject).toJson()
             );
+        } else if (numberFields == static_cast<unsigned>(object.size())) {
+            LatencyInterfaceManager::LatencyEntryList           rawEntries;
+            LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedEntries;
+
+            if (downsample) {
+                unsigned long interval;
+                aggregatedEntries = currentLatencyInterfaceManager->getLatencyBuckets(
+                    static_cast<CustomerCapabilities::CustomerId>(customerId),
+                    HostScheme::invalidHostSchemeId,
+                    monitorId,
+                    regionId,
+                    Server::invalidServerId,
+                    startTimestamp,
+                    endTimestamp,
+                    resolution,
+                    maximumPoints,
+                    threadId,
+                    &interval
+                );
+            } else {
+                LatencyInterfaceManager::LatencyEntryLists result = currentLatencyInterfaceManager->getLatencyEntries(
+                    static_cast<CustomerCapabilities::CustomerId>(customerId),
+                    HostScheme::invalidHostSchemeId,
+                    monitorId,
+                    regionId,
+                    Server::invalidServerId,
+                    startTimestamp,
+                    endTimestamp,
+                    threadId
+                );
 
-            LatencyInterfaceManager::LatencyEntryList           rawEntries        = result.first;
-            LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedEntries = result.second;
+                rawEntries        = result.first;
+                aggregatedEntries = result.second;
+            }
 
-            Servers::ServersById   serversById  = currentServers->getServersById(threadId);
+            Servers::ServersById   serversById  = currentServerAdministrator->getServersById(threadId);
             Monitors::MonitorsById monitorsById;
 
-            responseObject.insert("status", "OK");
-            responseObject.insert("recent", convertToJson(rawEntries, serversById, monitorsById, false, true, false));
-            responseObject.insert(
-                "aggregated",
-                convertToJson(
-                    aggregatedEntries,
-                    serversById,
-                    monitorsById,
-                    false,
-                    true,
-                    false
-                )
+            QByteArray contentType = binaryLatencyContentType;
+            QByteArray data        = currentResponseCompressor->compress(
+                encoding,
+                contentType,
+                convertToBinary(rawEntries, aggregatedEntries, serversById, monitorsById, false, true, false)
             );
 
-            response = RestApiInV1::JsonResponse(responseObject);
+            response = RestApiInV1::BinaryResponse(contentType, data);
         }
     }
 
@@ -1121,11 +1978,14 @@ RestApiInV1::JsonResponse CustomerRestApiV1::LatencyList::processAuthenticatedRe
 
 CustomerRestApiV1::LatencyPlot::LatencyPlot(
         CustomerAuthenticator* customerAuthenticator,
-        LatencyPlotter*        latencyPlotter
+        LatencyPlotter*        latencyPlotter,
+        CustomerRateLimiter*   rateLimiter
     ):RestApiInV1::InesonicCustomerBinaryRestHandler(
         customerAuthenticator
     ),currentLatencyPlotter(
         latencyPlotter
+    ),currentRateLimiter(
+        rateLimiter
     ) {}
 
 
@@ -1133,11 +1993,14 @@ CustomerRestApiV1::LatencyPlot::~LatencyPlot() {}
 
 
 RestApiInV1::BinaryResponse CustomerRestApiV1::LatencyPlot::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::LatencyPlot"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::BinaryResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -1153,6 +2016,7 @@ RestApiInV1::BinaryResponse CustomerRestApiV1::LatencyPlot::processAuthenticated
         double                   minimumLatency = -1;
         double                   maximumLatency = -1;
         bool                     logScale       = false;
+        bool                     revalidate     = false;
         unsigned                 width          = ::LatencyPlotter::defaultWidth;
         unsigned                 height         = ::LatencyPlotter::defaultHeight;
         QString                  plotType("history");
@@ -1164,6 +2028,7 @@ RestApiInV1::BinaryResponse CustomerRestApiV1::LatencyPlot::processAuthenticated
         QString                  titleFont;
         QString                  axisTitleFont;
         QString                  axisLabelFont;
+        QByteArray               ifNoneMatch;
 
         if (object.contains("plot_type")) {
             plotType = object.value("plot_type").toString().toLower();
@@ -1325,81 +2190,136 @@ RestApiInV1::BinaryResponse CustomerRestApiV1::LatencyPlot::processAuthenticated
             ++numberFields;
         }
 
+        if (object.contains("if_none_match")) {
+            ifNoneMatch = object.value("if_none_match").toString().toUtf8();
+            revalidate  = true;
+            ++numberFields;
+        }
+
         if (numberFields == static_cast<unsigned>(object.size())) {
+            unsigned retryAfter = 0;
+            if (success && !currentRateLimiter->admit(customerId, latencyPlotCost, threadId, &retryAfter)) {
+                success = false;
+                responseObject.insert("status", "failed, rate limited");
+                responseObject.insert("retry_after", static_cast<double>(retryAfter));
+            }
+
+            WorkerPools::Admission admission(WorkerPools::Pool::PLOT);
+            if (success && !admission.admitted()) {
+                success = false;
+                responseObject.insert("status", "failed, busy");
+            }
+
             if (success) {
-                QImage image;
-
-                if (plotType == "history") {
-                    PlotMailbox& mailbox = currentLatencyPlotter->requestHistoryPlot(
-                        threadId,
-                        customerId,
-                        regionId,
-                        Server::invalidServerId, // Customers have limited visibility to specific servers.
-                        hostSchemeId,
-                        monitorId,
-                        startTimestamp,
-                        endTimestamp,
-                        title,
-                        xAxisLabel,
-                        yAxisLabel,
-                        dateFormat,
-                        titleFont,
-                        axisTitleFont,
-                        axisLabelFont,
-                        maximumLatency,
-                        minimumLatency,
-                        logScale,
-                        width,
-                        height
-                    );
+                QByteArray  cacheKey;
+                QDataStream keyStream(&cacheKey, QIODevice::OpenModeFlag::WriteOnly);
+                keyStream << plotType << plotFormat << static_cast<quint64>(customerId)
+                          << static_cast<quint32>(regionId) << static_cast<quint32>(Server::invalidServerId)
+                          << static_cast<quint64>(hostSchemeId) << static_cast<quint64>(monitorId)
+                          << static_cast<quint64>(startTimestamp) << static_cast<quint64>(endTimestamp)
+                          << title << xAxisLabel << yAxisLabel << dateFormat
+                          << titleFont << axisTitleFont << axisLabelFont
+                          << minimumLatency << maximumLatency << logScale
+                          << static_cast<quint32>(width) << static_cast<quint32>(height);
+
+                // The version is read before rendering so data arriving mid-render invalidates the new entry.
+                PlotCache&         plotCache   = currentLatencyPlotter->plotCache();
+                unsigned long long dataVersion = currentLatencyPlotter->dataVersion(monitorId);
+                PlotCache::Plot    plot;
+
+                if (!plotCache.getPlot(cacheKey, dataVersion, plot)) {
+                    QImage image;
+
+                    if (!currentLatencyPlotter->acceptingPlots()) {
+                        success = false;
+                        responseObject.insert("status", "failed, busy");
+                    } else if (plotType == "history") {
+                        RequestTracer::Span plotSpan(RequestTracer::Phase::PLOT, threadId);
+                        PlotMailbox& mailbox = currentLatencyPlotter->requestHistoryPlot(
+                            threadId,
+                            customerId,
+                            regionId,
+                            Server::invalidServerId, // Customers have limited visibility to specific servers.
+                            hostSchemeId,
+                            monitorId,
+                            startTimestamp,
+                            endTimestamp,
+                            title,
+                            xAxisLabel,
+                            yAxisLabel,
+                            dateFormat,
+                            titleFont,
+                            axisTitleFont,
+                            axisLabelFont,
+                            maximumLatency,
+                            minimumLatency,
+                            logScale,
+                            width,
+                            height
+                        );
 
-                    image = mailbox.waitForImage();
-                } else if (plotType == "histogram") {
-                    PlotMailbox& mailbox = currentLatencyPlotter->requestHistogramPlot(
-                        threadId,
-                        customerId,
-                        regionId,
-                        Server::invalidServerId, // Customers have limited visibility to specific servers.
-                        hostSchemeId,
-                        monitorId,
-                        startTimestamp,
-                        endTimestamp,
-                        title,
-                        xAxisLabel,
-                        yAxisLabel,
-                        titleFont,
-                        axisTitleFont,
-                        axisLabelFont,
-                        maximumLatency,
-                        minimumLatency,
-                        width,
-                        height
-                    );
+                        image = mailbox.waitForImage();
+                    } else if (plotType == "histogram") {
+                        RequestTracer::Span plotSpan(RequestTracer::Phase::PLOT, threadId);
+                        PlotMailbox& mailbox = currentLatencyPlotter->requestHistogramPlot(
+                            threadId,
+                            customerId,
+                            regionId,
+                            Server::invalidServerId, // Customers have limited visibility to specific servers.
+                            hostSchemeId,
+                            monitorId,
+                            startTimestamp,
+                            endTimestamp,
+                            title,
+                            xAxisLabel,
+                            yAxisLabel,
+                            titleFont,
+                            axisTitleFont,
+                            axisLabelFont,
+                            maximumLatency,
+                            minimumLatency,
+                            width,
+                            height
+                        );
 
-                    image = mailbox.waitForImage();
-                } else {
-                    success = false;
-                    responseObject.insert("status", "invalid plot type");
+                        image = mailbox.waitForImage();
+                    } else {
+                        success = false;
+                        responseObject.insert("status", "invalid plot type");
+                    }
+
+                    if (success) {
+                        QByteArray plotData;
+                        QBuffer    buffer(&plotData);
+                        buffer.open(QBuffer::OpenModeFlag::WriteOnly);
+
+                        success = image.save(&buffer, plotFormat.toLocal8Bit().data());
+                        if (!success) {
+                            responseObject.insert("status", "failed, could not convert to image");
+                        } else {
+                            plot = plotCache.addPlot(cacheKey, dataVersion, plotData);
+                        }
+                    }
                 }
 
                 if (success) {
-                    QByteArray plotData;
-                    QBuffer    buffer(&plotData);
-                    buffer.open(QBuffer::OpenModeFlag::WriteOnly);
-
-                    success = image.save(&buffer, plotFormat.toLocal8Bit().data());
-                    if (!success) {
-                        responseObject.insert("status", "failed, could not convert to image");
+                    QByteArray contentType = QString("image/%1").arg(plotFormat).toLower().toUtf8();
+                    if (revalidate) {
+                        responseObject.insert("etag", QString::fromUtf8(plot.etag));
+                        if (plot.etag == ifNoneMatch) {
+                            responseObject.insert("status", "OK, not modified");
+                        } else {
+                            responseObject.insert("status", "OK");
+                            responseObject.insert("content_type", QString::fromUtf8(contentType));
+                            responseObject.insert("image", QString::fromLatin1(plot.imageData.toBase64()));
+                        }
                     } else {
-                        response = RestApiInV1::BinaryResponse(
-                            QString("image/%1").arg(plotFormat).toLower().toUtf8(),
-                            plotData
-                        );
+                        response = RestApiInV1::BinaryResponse(contentType, plot.imageData);
                     }
                 }
             }
 
-            if (!success) {
+            if (!success || revalidate) {
                 response = RestApiInV1::BinaryResponse(
                     QByteArray("application/json"),
                     QJsonDocument(responseObject).toJson()
@@ -1429,11 +2349,14 @@ CustomerRestApiV1::CustomerPause::~CustomerPause() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::CustomerPause::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::CustomerPause"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -1475,11 +2398,14 @@ CustomerRestApiV1::ResourceAvailable::~ResourceAvailable() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::ResourceAvailable::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
-        const QJsonDocument& /* request */,
+        const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::ResourceAvailable"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     QJsonObject responseObject;
 
     ActiveResources     activeResources = currentResources->hasResourceData(customerId, threadId);
@@ -1515,75 +2441,124 @@ CustomerRestApiV1::ResourceCreate::~ResourceCreate() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::ResourceCreate::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::ResourceCreate"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response;
 
     if (request.isObject()) {
-        QJsonObject responseObject;
-        bool        success = true;
-        QJsonObject object  = request.object();
-        if (object.size() >= 1 && object.contains("value")) {
-            float               value        = object.value("value").toDouble(0);
-            Resource::ValueType valueType    = 0;
-            unsigned long long  timestamp    = 0;
-            unsigned            numberFields = 1;
-
-            if (object.contains("value_type")) {
-                int valueTypeInt = object.value("value_type").toInt(-1);
-                if (valueTypeInt >= 0 && valueTypeInt <= 255) {
-                    valueType = static_cast<Resource::ValueType>(valueTypeInt);
+        QJsonObject             responseObject;
+        QString                 status;
+        Resources::ResourceList resources;
+        QJsonObject             object = request.object();
+
+        if (object.size() == 1 && object.contains("entries")) {
+            QJsonValue entriesValue = object.value("entries");
+            if (entriesValue.isArray()) {
+                QJsonArray entriesArray  = entriesValue.toArray();
+                unsigned   numberEntries = static_cast<unsigned>(entriesArray.size());
+                if (numberEntries <= maximumEntriesPerRequest) {
+                    unsigned index = 0;
+                    while (status.isEmpty() && index < numberEntries) {
+                        QJsonValue entryValue = entriesArray.at(index);
+                        if (entryValue.isObject()) {
+                            Resource resource;
+                            status = convertToResource(customerId, entryValue.toObject(), resource);
+                            if (status.isEmpty()) {
+                                resources.append(resource);
+                            } else {
+                                status = QString("%1, entry %2").arg(status).arg(index);
+                            }
+                        } else {
+                            status = QString("failed, entry %1 is not an object").arg(index);
+                        }
+
+                        ++index;
+                    }
                 } else {
-                    responseObject.insert("status", "failed, bad value type");
-                    success = false;
+                    status = QString("failed, too many entries");
                 }
+            } else {
+                status = QString("failed, entries must be an array");
+            }
+        } else {
+            Resource resource;
+            status = convertToResource(customerId, object, resource);
+            if (status.isEmpty()) {
+                resources.append(resource);
+            }
+        }
 
-                ++numberFields;
+        if (status.isEmpty()) {
+            if (currentResources->queueResources(resources)) {
+                status = QString("OK");
+            } else {
+                status = QString("failed, busy");
             }
+        }
 
-            if (object.contains("timestamp")) {
-                double timestampDouble = object.value("timestamp").toDouble(-1);
-                if (timestampDouble >= 0 && timestampDouble <= 0xFFFFFFFFFFFFFFFFULL) {
-                    timestamp = static_cast<unsigned long long>(timestampDouble);
-                } else {
-                    responseObject.insert("status", "failed, bad timestamp");
-                    success = false;
-                }
+        responseObject.insert("status", status);
+        response = RestApiInV1::JsonResponse(QJsonDocument(responseObject));
+    }
 
-                ++numberFields;
+    return response;
+}
+
+
+QString CustomerRestApiV1::ResourceCreate::convertToResource(
+        unsigned long      customerId,
+        const QJsonObject& object,
+        Resource&          resource
+    ) {
+    QString status;
+
+    if (object.size() >= 1 && object.contains("value")) {
+        float               value        = object.value("value").toDouble(0);
+        Resource::ValueType valueType    = 0;
+        unsigned long long  timestamp    = 0;
+        unsigned            numberFields = 1;
+
+        if (object.contains("value_type")) {
+            int valueTypeInt = object.value("value_type").toInt(-1);
+            if (valueTypeInt >= 0 && valueTypeInt <= 255) {
+                valueType = static_cast<Resource::ValueType>(valueTypeInt);
             } else {
-                timestamp = QDateTime::currentSecsSinceEpoch();
+                status = QString("failed, bad value type");
             }
 
-            if (success) {
-                if (static_cast<unsigned>(object.size()) == numberFields) {
-                    Resource resource = currentResources->recordResource(
-                        customerId,
-                        valueType,
-                        value,
-                        timestamp,
-                        threadId
-                    );
-                    if (resource.isValid()) {
-                        responseObject.insert("status", "OK");
-                    } else {
-                        responseObject.insert("status", "failed to create entry");
-                    }
-                } else {
-                    responseObject.insert("status", "unexpected fields");
-                }
+            ++numberFields;
+        }
+
+        if (object.contains("timestamp")) {
+            double timestampDouble = object.value("timestamp").toDouble(-1);
+            if (timestampDouble >= 0 && timestampDouble <= 0xFFFFFFFFFFFFFFFFULL) {
+                timestamp = static_cast<unsigned long long>(timestampDouble);
+            } else {
+                status = QString("failed, bad timestamp");
             }
+
+            ++numberFields;
         } else {
-            responseObject.insert("status", "failed, missing value field");
+            timestamp = QDateTime::currentSecsSinceEpoch();
         }
 
-        response = RestApiInV1::JsonResponse(QJsonDocument(responseObject));
+        if (status.isEmpty()) {
+            if (static_cast<unsigned>(object.size()) == numberFields) {
+                resource = Resource(static_cast<Resource::CustomerId>(customerId), valueType, value, timestamp);
+            } else {
+                status = QString("unexpected fields");
+            }
+        }
+    } else {
+        status = QString("failed, missing value field");
     }
 
-    return response;
+    return status;
 }
 
 /***********************************************************************************************************************
@@ -1604,11 +2579,14 @@ CustomerRestApiV1::ResourceList::~ResourceList() {}
 
 
 RestApiInV1::JsonResponse CustomerRestApiV1::ResourceList::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::ResourceList"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::JsonResponse response;
 
     if (request.isObject()) {
@@ -1687,11 +2665,14 @@ RestApiInV1::JsonResponse CustomerRestApiV1::ResourceList::processAuthenticatedR
 
 CustomerRestApiV1::ResourcePlot::ResourcePlot(
         CustomerAuthenticator* customerAuthenticator,
-        ResourcePlotter*       resourcePlotter
+        ResourcePlotter*       resourcePlotter,
+        CustomerRateLimiter*   rateLimiter
     ):RestApiInV1::InesonicCustomerBinaryRestHandler(
         customerAuthenticator
     ),currentResourcePlotter(
         resourcePlotter
+    ),currentRateLimiter(
+        rateLimiter
     ) {}
 
 
@@ -1699,11 +2680,14 @@ CustomerRestApiV1::ResourcePlot::~ResourcePlot() {}
 
 
 RestApiInV1::BinaryResponse CustomerRestApiV1::ResourcePlot::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         unsigned long        customerId,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("CustomerRestApiV1::ResourcePlot"), threadId);
+    TrafficRecorder::record(path, customerId, request);
+
     RestApiInV1::BinaryResponse response = nullptr;
     bool                        success  = true;
     QJsonObject                 responseObject;
@@ -1839,8 +2823,27 @@ RestApiInV1::BinaryResponse CustomerRestApiV1::ResourcePlot::processAuthenticate
             ++numberFields;
         }
 
+        unsigned retryAfter = 0;
+        if (success && !currentRateLimiter->admit(customerId, resourcePlotCost, threadId, &retryAfter)) {
+            success = false;
+            responseObject.insert("status", "failed, rate limited");
+            responseObject.insert("retry_after", static_cast<double>(retryAfter));
+        }
+
+        WorkerPools::Admission admission(WorkerPools::Pool::PLOT);
+        if (success && !admission.admitted()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
+        if (success && !currentResourcePlotter->acceptingPlots()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
         if (success) {
             if (numberFields == static_cast<unsigned>(object.size())) {
+                RequestTracer::Span plotSpan(RequestTracer::Phase::PLOT, threadId);
                 PlotMailbox& mailbox = currentResourcePlotter->requestPlot(
                     threadId,
                     customerId,
@@ -1908,15 +2911,27 @@ const QString CustomerRestApiV1::eventsListPath("/v1/events/list");
 const QString CustomerRestApiV1::eventsCreatePath("/v1/events/create");
 const QString CustomerRestApiV1::statusGetPath("/v1/status/get");
 const QString CustomerRestApiV1::statusListPath("/v1/status/list");
+const QString CustomerRestApiV1::statusWaitPath("/v1/status/wait");
 const QString CustomerRestApiV1::multipleListPath("/v1/multiple/list");
 const QString CustomerRestApiV1::latencyListPath("/v1/latency/list");
+const QString CustomerRestApiV1::latencyStatisticsPath("/v1/latency/statistics");
+const QString CustomerRestApiV1::latencyRollingPath("/v1/latency/rolling");
 const QString CustomerRestApiV1::latencyPlotPath("/v1/latency/plot");
+const QString CustomerRestApiV1::latencyExportPath("/v1/latency/export");
 const QString CustomerRestApiV1::customerPausePath("/v1/customer/pause");
 const QString CustomerRestApiV1::resourceAvailablePath("/v1/resource/available");
 const QString CustomerRestApiV1::resourceCreatePath("/v1/resource/create");
 const QString CustomerRestApiV1::resourceListPath("/v1/resource/list");
 const QString CustomerRestApiV1::resourcePlotPath("/v1/resource/plot");
 
+const double CustomerRestApiV1::multipleListCost      = 1.0;
+const double CustomerRestApiV1::latencyListCost       = 4.0;
+const double CustomerRestApiV1::latencyStatisticsCost = 4.0;
+const double CustomerRestApiV1::latencyRollingCost    = 1.0;
+const double CustomerRestApiV1::latencyPlotCost       = 8.0;
+const double CustomerRestApiV1::latencyExportCost     = 4.0;
+const double CustomerRestApiV1::resourcePlotCost      = 8.0;
+
 CustomerRestApiV1::CustomerRestApiV1(
         RestApiInV1::Server*     restApiServer,
         CustomerAuthenticator*   wordPressCustomerAuthenticator,
@@ -1926,7 +2941,6 @@ CustomerRestApiV1::CustomerRestApiV1(
         Monitors*                monitorDatabaseApi,
         MonitorUpdater*          monitorUpdater,
         Regions*                 regionDatabaseApi,
-        Servers*                 serverDatabaseApi,
         Events*                  eventDatabaseApi,
         EventProcessor*          eventProcessor,
         LatencyInterfaceManager* latencyInterfaceManager,
@@ -1934,25 +2948,32 @@ CustomerRestApiV1::CustomerRestApiV1(
         Resources*               resourceDatabaseApi,
         ResourcePlotter*         resourcePlotter,
         ServerAdministrator*     serverAdministrator,
+        ResponseCompressor*      responseCompressor,
+        Catalog*                 catalog,
+        DashboardCache*          dashboardCache,
+        CustomerRateLimiter*     customerRateLimiter,
         QObject*                 parent
     ):QObject(
         parent
     ),capabilitiesGet(
         wordPressCustomerAuthenticator,
-        customersCapabilitiesDatabaseApi
+        customersCapabilitiesDatabaseApi,
+        catalog
     ),hostsGet(
         restCustomerAuthenticator,
         hostSchemeDatabaseApi
     ),hostsList(
         restCustomerAuthenticator,
-        hostSchemeDatabaseApi
+        hostSchemeDatabaseApi,
+        catalog
     ),monitorsGet(
         restCustomerAuthenticator,
         monitorDatabaseApi
     ),monitorsList(
         restCustomerAuthenticator,
         monitorDatabaseApi,
-        hostSchemeDatabaseApi
+        hostSchemeDatabaseApi,
+        catalog
     ),monitorsUpdate(
         restCustomerAuthenticator,
         customersCapabilitiesDatabaseApi,
@@ -1968,7 +2989,8 @@ CustomerRestApiV1::CustomerRestApiV1(
         eventDatabaseApi
     ),eventsList(
         restCustomerAuthenticator,
-        eventDatabaseApi
+        eventDatabaseApi,
+        responseCompressor
     ),eventsCreate(
         restCustomerAuthenticator,
         monitorDatabaseApi,
@@ -1979,19 +3001,41 @@ CustomerRestApiV1::CustomerRestApiV1(
         eventDatabaseApi
     ),statusList(
         restCustomerAuthenticator,
-        eventDatabaseApi
+        eventDatabaseApi,
+        catalog
+    ),statusWait(
+        restCustomerAuthenticator,
+        eventDatabaseApi,
+        catalog
     ),multipleList(
         wordPressCustomerAuthenticator,
-        hostSchemeDatabaseApi,
-        monitorDatabaseApi,
-        eventDatabaseApi
+        dashboardCache,
+        responseCompressor,
+        customerRateLimiter
     ),latencyList(
         restCustomerAuthenticator,
         latencyInterfaceManager,
-        serverDatabaseApi
+        serverAdministrator,
+        responseCompressor,
+        customerRateLimiter
+    ),latencyStatistics(
+        restCustomerAuthenticator,
+        latencyInterfaceManager,
+        customerRateLimiter
+    ),latencyRolling(
+        restCustomerAuthenticator,
+        latencyInterfaceManager,
+        customerRateLimiter
     ),latencyPlot(
         wordPressCustomerAuthenticator,
-        latencyPlotter
+        latencyPlotter,
+        customerRateLimiter
+    ),latencyExport(
+        restCustomerAuthenticator,
+        latencyInterfaceManager,
+        serverAdministrator,
+        responseCompressor,
+        customerRateLimiter
     ),customerPause(
         restCustomerAuthenticator,
         serverAdministrator
@@ -2006,7 +3050,8 @@ CustomerRestApiV1::CustomerRestApiV1(
         resourceDatabaseApi
     ),resourcePlot(
         restCustomerAuthenticator,
-        resourcePlotter
+        resourcePlotter,
+        customerRateLimiter
     ) {
     restApiServer->registerHandler(
         &capabilitiesGet,
@@ -2073,6 +3118,11 @@ CustomerRestApiV1::CustomerRestApiV1(
         RestApiInV1::Handler::Method::POST,
         statusListPath
     );
+    restApiServer->registerHandler(
+        &statusWait,
+        RestApiInV1::Handler::Method::POST,
+        statusWaitPath
+    );
     restApiServer->registerHandler(
         &multipleList,
         RestApiInV1::Handler::Method::POST,
@@ -2083,11 +3133,26 @@ CustomerRestApiV1::CustomerRestApiV1(
         RestApiInV1::Handler::Method::POST,
         latencyListPath
     );
+    restApiServer->registerHandler(
+        &latencyStatistics,
+        RestApiInV1::Handler::Method::POST,
+        latencyStatisticsPath
+    );
+    restApiServer->registerHandler(
+        &latencyRolling,
+        RestApiInV1::Handler::Method::POST,
+        latencyRollingPath
+    );
     restApiServer->registerHandler(
         &latencyPlot,
         RestApiInV1::Handler::Method::POST,
         latencyPlotPath
     );
+    restApiServer->registerHandler(
+        &latencyExport,
+        RestApiInV1::Handler::Method::POST,
+        latencyExportPath
+    );
     restApiServer->registerHandler(
         &customerPause,
         RestApiInV1::Handler::Method::POST,
@@ -19,8 +19,6 @@
 ***********************************************************************************************************************/
 
 #include <QObject>
-#include <QMutex>
-#include <QMutexLocker>
 #include <QString>
 #include <QHash>
 #include <QSqlDatabase>
@@ -30,6 +28,7 @@
 #include <QSqlRecord>
 #include <QVariant>
 #include <QRandomGenerator>
+#include <QThread>
 
 #include <cstdint>
 #include <cstring>
@@ -41,11 +40,17 @@
 #include <crypto_helpers.h>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "database_manager.h"
-#include "cache.h"
+#include "concurrent_cache.h"
 #include "customer_secret.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
+#include "cache_invalidation_bus.h"
 #include "customer_secrets.h"
 
+const char CustomerSecrets::invalidationTable[] = "customer_secrets";
+
 CustomerSecrets::CustomerSecrets(
         DatabaseManager*  databaseManager,
         const QByteArray& encryptionKey,
@@ -54,11 +59,15 @@ CustomerSecrets::CustomerSecrets(
         QObject*          parent
     ):QObject(
         parent
-    ),Cache<CustomerSecret, CustomerSecret::CustomerId>(
+    ),ConcurrentCache<CustomerSecret, CustomerSecret::CustomerId>(
         maximumCacheDepth
     ),currentDatabaseManager(
         databaseManager
+    ),identifierCache(
+        maximumCacheDepth
     ) {
+    std::memset(this->customerIdentifierKey, 0, sizeof(this->customerIdentifierKey));
+
     setEncryptionKeys(encryptionKey);
     setCustomerIdentifierKey(customerIdentifierKey);
 }
@@ -76,46 +85,51 @@ void CustomerSecrets::setEncryptionKeys(const QByteArray& newKeys) {
 
 
 void CustomerSecrets::setCustomerIdentifierKey(const QByteArray& newKeys) {
-    std::memcpy(customerIdentifierKey, newKeys.data(), sizeof(customerIdentifierKey));
+    if (std::memcmp(customerIdentifierKey, newKeys.data(), sizeof(customerIdentifierKey)) != 0) {
+        std::memcpy(customerIdentifierKey, newKeys.data(), sizeof(customerIdentifierKey));
+        identifierCache.clearCache();
+    }
+}
+
+
+void CustomerSecrets::resizeCache(unsigned long newCacheSize) {
+    ConcurrentCache<CustomerSecret, CustomerSecret::CustomerId>::resizeCache(newCacheSize);
+    identifierCache.resizeCache(newCacheSize);
 }
 
 
 CustomerSecret CustomerSecrets::getCustomerSecret(CustomerId customerId, bool noCacheUpdate, unsigned threadId) {
-    CustomerSecret result;
+    RequestTracer::Span cacheSpan(RequestTracer::Phase::CACHE, threadId);
+    CustomerSecret      result;
+
+    if (!getCacheEntry(customerId, result) && (noCacheUpdate || !isKnownAbsent(customerId))) {
+        static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+            QString("CustomerSecrets::getCustomerSecret")
+        );
+        MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+        RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
 
-    cacheMutex.lock();
-    const CustomerSecret* cacheResult = getCacheEntry(customerId);
-    if (cacheResult == nullptr) {
-        cacheMutex.unlock();
         QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
         bool success = database.isOpen();
         if (success) {
-            QSqlQuery query(database);
-            query.setForwardOnly(true);
+            QSqlQuery query = currentDatabaseManager->preparedQuery(
+                database,
+                QString("SELECT * FROM customer_secrets WHERE customer_id = :customer_id"),
+                &success
+            );
 
-            QString queryString = QString("SELECT * FROM customer_secrets WHERE customer_id = %1")
-                                  .arg(customerId);
+            if (success) {
+                query.bindValue(":customer_id", customerId);
+                success = SqlHelpers::execute(query);
+            }
 
-            success = query.exec(queryString);
             if (success) {
                 if (query.first()) {
                     int fieldNumber = query.record().indexOf("secret");
                     if (fieldNumber >= 0) {
-                        QByteArray encryptedSecret = query.value(fieldNumber).toByteArray();
-                        Crypto::AesCbcDecryptor decryptor(
-                            *reinterpret_cast<const Crypto::AesCbcDecryptor::Keys*>(encryptionKey),
-                            *reinterpret_cast<const Crypto::AesCbcDecryptor::IV*>(encryptedSecret.data())
-                        );
-
-                        QByteArray decryptedSecret = decryptor.decrypt(
-                            encryptedSecret.mid(Crypto::AesCbcDecryptor::ivLength)
-                        );
-
-                        result = CustomerSecret(customerId, decryptedSecret);
+                        result = decryptSecret(customerId, query.value(fieldNumber).toByteArray());
                         if (!noCacheUpdate) {
-                            cacheMutex.lock();
                             addToCache(result);
-                            cacheMutex.unlock();
                         }
                     } else {
                         logWrite(
@@ -124,6 +138,8 @@ CustomerSecret CustomerSecrets::getCustomerSecret(CustomerId customerId, bool no
                             true
                         );
                     }
+                } else if (!noCacheUpdate) {
+                    addNegativeEntry(customerId);
                 }
             } else {
                 logWrite(
@@ -141,9 +157,6 @@ CustomerSecret CustomerSecrets::getCustomerSecret(CustomerId customerId, bool no
         }
 
         currentDatabaseManager->closeAndRelease(database);
-    } else {
-        result = *cacheResult;
-        cacheMutex.unlock();
     }
 
     return result;
@@ -158,7 +171,7 @@ bool CustomerSecrets::deleteCustomerSecret(CustomerId customerId, unsigned threa
 
         QString queryString = QString("DELETE FROM customer_secrets WHERE customer_id = %1")
                 .arg(customerId);
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
 
         if (!success) {
             logWrite(
@@ -177,9 +190,11 @@ bool CustomerSecrets::deleteCustomerSecret(CustomerId customerId, unsigned threa
 
     currentDatabaseManager->closeAndRelease(database);
 
-    cacheMutex.lock();
     evictCacheEntry(customerId);
-    cacheMutex.unlock();
+
+    if (success) {
+        CacheInvalidationBus::instance()->publish(invalidationTable, customerId);
+    }
 
     return success;
 }
@@ -188,6 +203,12 @@ bool CustomerSecrets::deleteCustomerSecret(CustomerId customerId, unsigned threa
 CustomerSecret CustomerSecrets::updateCustomerSecret(CustomerId customerId, unsigned threadId) {
     CustomerSecret result = getCustomerSecret(customerId, true);
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("CustomerSecrets::updateCustomerSecret")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -218,7 +239,7 @@ CustomerSecret CustomerSecrets::updateCustomerSecret(CustomerId customerId, unsi
                 query.bindValue(":customer_id", customerId);
                 query.bindValue(":encrypted_secret", encryptedSecret);
 
-                success = query.exec();
+                success = SqlHelpers::execute(query);
                 if (!success) {
                     logWrite(
                         QString("Failed UPDATE - CustomerSecrets::updateCustomerSecret: %1")
@@ -240,7 +261,7 @@ CustomerSecret CustomerSecrets::updateCustomerSecret(CustomerId customerId, unsi
                 query.bindValue(":customer_id", customerId);
                 query.bindValue(":encrypted_secret", encryptedSecret);
 
-                success = query.exec();
+                success = SqlHelpers::execute(query);
                 if (!success) {
                     logWrite(
                         QString("Failed INSERT - CustomerSecrets::updateCustomerSecret: %1")
@@ -267,9 +288,8 @@ CustomerSecret CustomerSecrets::updateCustomerSecret(CustomerId customerId, unsi
     currentDatabaseManager->closeAndRelease(database);
 
     if (success) {
-        cacheMutex.lock();
         addToCache(result);
-        cacheMutex.unlock();
+        CacheInvalidationBus::instance()->publish(invalidationTable, customerId);
     } else {
         result = CustomerSecret();
     }
@@ -278,6 +298,63 @@ CustomerSecret CustomerSecrets::updateCustomerSecret(CustomerId customerId, unsi
 }
 
 
+unsigned long CustomerSecrets::warmCache(unsigned long maximumNumberEntries, unsigned threadId) {
+    unsigned long numberLoaded = 0;
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        QString queryString = QString(
+            "SELECT cs.customer_id, cs.secret FROM customer_secrets AS cs "
+            "ORDER BY EXISTS ("
+                "SELECT 1 FROM customer_mapping AS cm WHERE cm.customer_id = cs.customer_id"
+            ") DESC, cs.customer_id DESC "
+            "LIMIT %1"
+        ).arg(maximumNumberEntries);
+
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            QThread* thread = QThread::currentThread();
+            while (!thread->isInterruptionRequested() && query.next()) {
+                bool       ok;
+                CustomerId customerId      = query.value(0).toUInt(&ok);
+                QByteArray encryptedSecret = query.value(1).toByteArray();
+
+                if (ok                                                                          &&
+                    customerId != 0                                                             &&
+                    encryptedSecret.size() > static_cast<int>(Crypto::AesCbcDecryptor::ivLength)   ) {
+                    // Entries already cached were loaded on demand and may be newer than this row.
+                    if (addToCacheIfAbsent(decryptSecret(customerId, encryptedSecret))) {
+                        ++numberLoaded;
+                    }
+                } else {
+                    logWrite(
+                        QString("Skipping invalid entry - CustomerSecrets::warmCache: customer_id = %1")
+                        .arg(customerId),
+                        true
+                    );
+                }
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - CustomerSecrets::warmCache: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - CustomerSecrets::warmCache: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return numberLoaded;
+}
+
 
 std::uint64_t CustomerSecrets::toCustomerIdentifier(CustomerSecrets::CustomerId customerId) const {
     // Note: Assumes a little-endian architecture.
@@ -298,11 +375,35 @@ CustomerSecrets::CustomerId CustomerSecrets::toCustomerId(std::uint64_t customer
         IneXtea::Block block;
     } u;
 
-    u.v = customerIdentifier;
-    return static_cast<CustomerId>(IneXtea::toCustomerId(u.block, customerIdentifierKey));
+    IdentifierMapping mapping;
+    if (!identifierCache.getCacheEntry(customerIdentifier, mapping)) {
+        u.v = customerIdentifier;
+        mapping = IdentifierMapping(
+            customerIdentifier,
+            static_cast<CustomerId>(IneXtea::toCustomerId(u.block, customerIdentifierKey))
+        );
+
+        // Invalid identifiers are not cached so arbitrary requests can not flush valid mappings.
+        if (mapping.customerId != CustomerSecret::invalidCustomerId) {
+            identifierCache.addToCache(mapping);
+        }
+    }
+
+    return mapping.customerId;
 }
 
 
 CustomerSecrets::CustomerId CustomerSecrets::idFromValue(const CustomerSecret& value) const {
     return value.customerId();
 }
+
+
+CustomerSecret CustomerSecrets::decryptSecret(CustomerId customerId, const QByteArray& encryptedSecret) const {
+    Crypto::AesCbcDecryptor decryptor(
+        *reinterpret_cast<const Crypto::AesCbcDecryptor::Keys*>(encryptionKey),
+        *reinterpret_cast<const Crypto::AesCbcDecryptor::IV*>(encryptedSecret.data())
+    );
+
+    QByteArray decryptedSecret = decryptor.decrypt(encryptedSecret.mid(Crypto::AesCbcDecryptor::ivLength));
+    return CustomerSecret(customerId, decryptedSecret);
+}
@@ -19,38 +19,49 @@
 ***********************************************************************************************************************/
 
 #include <QObject>
-#include <QMutex>
-#include <QMutexLocker>
 #include <QString>
 #include <QHash>
 #include <QSet>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QVariant>
+#include <QThread>
 
 #include <cstdint>
 #include <cstring>
 #include <cmath>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "database_manager.h"
-#include "cache.h"
+#include "catalog.h"
+#include "concurrent_cache.h"
 #include "customer_capabilities.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
+#include "cache_invalidation_bus.h"
 #include "customers_capabilities.h"
 
+const char CustomersCapabilities::invalidationTable[] = "customer_capabilities";
+const unsigned CustomersCapabilities::maximumRowsPerStatement = 1000;
+
 CustomersCapabilities::CustomersCapabilities(
         DatabaseManager*  databaseManager,
+        Catalog*          catalog,
         unsigned          maximumCacheDepth,
         QObject*          parent
     ):QObject(
         parent
-    ),Cache<CustomerCapabilities, CustomerCapabilities::CustomerId>(
+    ),ConcurrentCache<CustomerCapabilities, CustomerCapabilities::CustomerId>(
         maximumCacheDepth
     ),currentDatabaseManager(
         databaseManager
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -62,20 +73,30 @@ CustomerCapabilities CustomersCapabilities::getCustomerCapabilities(
         bool       noCacheUpdate,
         unsigned   threadId
     ) {
+    RequestTracer::Span  cacheSpan(RequestTracer::Phase::CACHE, threadId);
     CustomerCapabilities result;
 
-    cacheMutex.lock();
-    const CustomerCapabilities* cacheResult = getCacheEntry(customerId);
-    if (cacheResult == nullptr) {
-        cacheMutex.unlock();
+    if (!getCacheEntry(customerId, result) && (noCacheUpdate || !isKnownAbsent(customerId))) {
+        static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+            QString("CustomersCapabilities::getCustomerCapabilities")
+        );
+        MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+        RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
         QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
         bool success = database.isOpen();
         if (success) {
-            QSqlQuery query(database);
-            query.setForwardOnly(true);
+            QSqlQuery query = currentDatabaseManager->preparedQuery(
+                database,
+                QString("SELECT * FROM customer_capabilities WHERE customer_id = :customer_id"),
+                &success
+            );
+
+            if (success) {
+                query.bindValue(":customer_id", customerId);
+                success = SqlHelpers::execute(query);
+            }
 
-            QString queryString = QString("SELECT * FROM customer_capabilities WHERE customer_id = %1").arg(customerId);
-            success = query.exec(queryString);
             if (success) {
                 if (query.first()) {
                     int numberMonitorsField  = query.record().indexOf("number_monitors");
@@ -103,9 +124,7 @@ CustomerCapabilities CustomersCapabilities::getCustomerCapabilities(
                                         );
 
                                         if (!noCacheUpdate) {
-                                            cacheMutex.lock();
                                             addToCache(result);
-                                            cacheMutex.unlock();
                                         }
                                     } else {
                                         success = false;
@@ -159,6 +178,8 @@ CustomerCapabilities CustomersCapabilities::getCustomerCapabilities(
                             true
                         );
                     }
+                } else if (!noCacheUpdate) {
+                    addNegativeEntry(customerId);
                 }
             } else {
                 logWrite(
@@ -178,9 +199,6 @@ CustomerCapabilities CustomersCapabilities::getCustomerCapabilities(
         }
 
         currentDatabaseManager->closeAndRelease(database);
-    } else {
-        result = *cacheResult;
-        cacheMutex.unlock();
     }
 
     return result;
@@ -195,9 +213,13 @@ bool CustomersCapabilities::deleteCustomerCapabilities(CustomerId customerId, un
 
         QString queryString = QString("DELETE FROM customer_capabilities WHERE customer_id = %1")
                 .arg(customerId);
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
 
-        if (!success) {
+        if (success) {
+            // Mirrors the ON DELETE CASCADE constraints on the host_scheme and monitor tables.
+            currentCatalog->removeCustomerHostSchemes(customerId);
+            currentCatalog->removeCustomerMonitors(customerId);
+        } else {
             logWrite(
                 QString(
                     "Failed DELETE - CustomerCapabilities::deleteCustomerCapabilities: "
@@ -216,9 +238,11 @@ bool CustomersCapabilities::deleteCustomerCapabilities(CustomerId customerId, un
 
     currentDatabaseManager->closeAndRelease(database);
 
-    cacheMutex.lock();
     evictCacheEntry(customerId);
-    cacheMutex.unlock();
+
+    if (success) {
+        CacheInvalidationBus::instance()->publish(invalidationTable, customerId);
+    }
 
     return success;
 }
@@ -236,10 +260,8 @@ bool CustomersCapabilities::purgeCustomerCapabilities(
         QString inString;
         bool    first = true;
 
-        cacheMutex.lock();
         for (CustomerIdSet::const_iterator it=customerIds.constBegin(),end=customerIds.constEnd() ; it!=end ; ++it) {
             CustomerId customerId = *it;
-            evictCacheEntry(customerId);
 
             if (first) {
                 inString = QString::number(customerId);
@@ -252,8 +274,18 @@ bool CustomersCapabilities::purgeCustomerCapabilities(
         QString queryString = QString("DELETE FROM customer_capabilities WHERE customer_id IN (%1)")
                 .arg(inString);
 
-        success = query.exec(queryString);
-        cacheMutex.unlock();
+        success = SqlHelpers::execute(query, queryString);
+
+        // Entries are evicted after the DELETE so that a concurrent lookup can not re-cache a deleted entry.
+        for (CustomerIdSet::const_iterator it=customerIds.constBegin(),end=customerIds.constEnd() ; it!=end ; ++it) {
+            evictCacheEntry(*it);
+
+            if (success) {
+                currentCatalog->removeCustomerHostSchemes(*it);
+                currentCatalog->removeCustomerMonitors(*it);
+                CacheInvalidationBus::instance()->publish(invalidationTable, *it);
+            }
+        }
 
         if (!success) {
             logWrite(
@@ -283,6 +315,12 @@ bool CustomersCapabilities::updateCustomerCapabilities(
     ) {
     CustomerCapabilities storedCapabilities = getCustomerCapabilities(customerCapabilities.customerId(), true);
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("CustomersCapabilities::updateCustomerCapabilities")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -291,28 +329,31 @@ bool CustomersCapabilities::updateCustomerCapabilities(
         if (doUpdate) {
             queryString = QString(
                 "UPDATE customer_capabilities SET "
-                    "number_monitors = %1, "
-                    "polling_interval = %2, "
-                    "expiration_days = %3, "
-                    "flags = %4 "
-                "WHERE customer_id = %5"
-            ).arg(customerCapabilities.maximumNumberMonitors())
-             .arg(customerCapabilities.pollingInterval())
-             .arg(customerCapabilities.expirationDays())
-             .arg(customerCapabilities.flags())
-             .arg(customerCapabilities.customerId());
+                    "number_monitors = :number_monitors, "
+                    "polling_interval = :polling_interval, "
+                    "expiration_days = :expiration_days, "
+                    "flags = :flags "
+                "WHERE customer_id = :customer_id"
+            );
         } else {
             queryString = QString(
-                "INSERT INTO customer_capabilities VALUES (%1, %2, %3, %4, %5)"
-            ).arg(customerCapabilities.customerId())
-             .arg(customerCapabilities.maximumNumberMonitors())
-             .arg(customerCapabilities.pollingInterval())
-             .arg(customerCapabilities.expirationDays())
-             .arg(customerCapabilities.flags());
+                "INSERT INTO customer_capabilities VALUES ("
+                    ":customer_id, :number_monitors, :polling_interval, :expiration_days, :flags"
+                ")"
+            );
+        }
+
+        QSqlQuery query = currentDatabaseManager->preparedQuery(database, queryString, &success);
+        if (success) {
+            query.bindValue(":customer_id", customerCapabilities.customerId());
+            query.bindValue(":number_monitors", customerCapabilities.maximumNumberMonitors());
+            query.bindValue(":polling_interval", customerCapabilities.pollingInterval());
+            query.bindValue(":expiration_days", customerCapabilities.expirationDays());
+            query.bindValue(":flags", customerCapabilities.flags());
+
+            success = SqlHelpers::execute(query);
         }
 
-        QSqlQuery query(database);
-        success = query.exec(queryString);
         if (!success) {
             QSqlError lastError = query.lastError();
             if (doUpdate) {
@@ -331,9 +372,9 @@ bool CustomersCapabilities::updateCustomerCapabilities(
                 );
             }
         } else {
-            cacheMutex.lock();
             addToCache(customerCapabilities);
-            cacheMutex.unlock();
+            currentCatalog->customerChanged(customerCapabilities.customerId());
+            CacheInvalidationBus::instance()->publish(invalidationTable, customerCapabilities.customerId());
         }
     }
 
@@ -342,6 +383,322 @@ bool CustomersCapabilities::updateCustomerCapabilities(
 }
 
 
+bool CustomersCapabilities::synchronizeCustomerCapabilities(
+        const CustomersCapabilities::CapabilitiesByCustomerId& customerCapabilities,
+        CustomersCapabilities::CapabilitiesByCustomerId*       changedCapabilities,
+        unsigned                                               threadId
+    ) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("CustomersCapabilities::synchronizeCustomerCapabilities")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+    CapabilitiesByCustomerId changed;
+    bool                     success = true;
+
+    if (!customerCapabilities.isEmpty()) {
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        success = database.isOpen();
+        if (success) {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+
+            QStringList customerIds;
+            customerIds.reserve(customerCapabilities.size());
+            for (  CapabilitiesByCustomerId::const_iterator it  = customerCapabilities.constBegin(),
+                                                            end = customerCapabilities.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                customerIds.append(QString::number(it.key()));
+            }
+
+            // Rows that can not be decoded are left out of the stored set so that they are rewritten below.
+            CapabilitiesByCustomerId storedCapabilities;
+            unsigned long            numberCustomers = static_cast<unsigned long>(customerIds.size());
+            unsigned long            customerIndex   = 0;
+            while (success && customerIndex < numberCustomers) {
+                QString queryString = QString(
+                    "SELECT customer_id, number_monitors, polling_interval, expiration_days, flags "
+                    "FROM customer_capabilities WHERE customer_id IN (%1)"
+                ).arg(customerIds.mid(customerIndex, maximumRowsPerStatement).join(QChar(',')));
+
+                success = SqlHelpers::execute(query, queryString);
+                if (success) {
+                    while (query.next()) {
+                        bool     ok;
+                        unsigned customerId      = query.value(0).toUInt(&ok);
+                        unsigned numberMonitors  = ok ? query.value(1).toUInt(&ok) : 0;
+                        unsigned pollingInterval = ok ? query.value(2).toUInt(&ok) : 0;
+                        unsigned expirationDays  = ok ? query.value(3).toUInt(&ok) : 0;
+                        unsigned flags           = ok ? query.value(4).toUInt(&ok) : 0;
+
+                        if (ok                        &&
+                            customerId != 0           &&
+                            numberMonitors <= 0xFFFF  &&
+                            pollingInterval <= 0xFFFF &&
+                            flags <= 0xFFFF              ) {
+                            storedCapabilities.insert(
+                                customerId,
+                                CustomerCapabilities(
+                                    customerId,
+                                    static_cast<unsigned short>(numberMonitors),
+                                    static_cast<unsigned short>(pollingInterval),
+                                    expirationDays,
+                                    static_cast<CustomerCapabilities::Flags>(flags)
+                                )
+                            );
+                        }
+                    }
+
+                    customerIndex += maximumRowsPerStatement;
+                } else {
+                    logWrite(
+                        QString(
+                            "Failed SELECT - CustomerCapabilities::synchronizeCustomerCapabilities: %1"
+                        ).arg(query.lastError().text()),
+                        true
+                    );
+                }
+            }
+
+            QStringList rows;
+            if (success) {
+                for (  CapabilitiesByCustomerId::const_iterator it  = customerCapabilities.constBegin(),
+                                                                end = customerCapabilities.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    CustomerCapabilities capabilities = it.value();
+                    CustomerCapabilities stored       = storedCapabilities.value(it.key());
+
+                    if (stored.isValid()) {
+                        capabilities.setPaused(stored.paused());
+                    }
+
+                    if (stored.isInvalid()                                                     ||
+                        stored.maximumNumberMonitors() != capabilities.maximumNumberMonitors() ||
+                        stored.pollingInterval() != capabilities.pollingInterval()             ||
+                        stored.expirationDays() != capabilities.expirationDays()               ||
+                        stored.flags() != capabilities.flags()                                    ) {
+                        changed.insert(it.key(), capabilities);
+                        rows.append(
+                            QString("(%1,%2,%3,%4,%5)")
+                            .arg(capabilities.customerId())
+                            .arg(capabilities.maximumNumberMonitors())
+                            .arg(capabilities.pollingInterval())
+                            .arg(capabilities.expirationDays())
+                            .arg(capabilities.flags())
+                        );
+                    }
+                }
+            }
+
+            if (success && !rows.isEmpty()) {
+                bool supportsTransactions;
+                if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
+                    supportsTransactions = true;
+                    database.transaction();
+                } else {
+                    supportsTransactions = false;
+                }
+
+                unsigned long numberRows = static_cast<unsigned long>(rows.size());
+                unsigned long rowIndex   = 0;
+                while (success && rowIndex < numberRows) {
+                    QString queryString = QString(
+                        "INSERT INTO customer_capabilities ("
+                            "customer_id, number_monitors, polling_interval, expiration_days, flags"
+                        ") VALUES %1 "
+                        "ON CONFLICT (customer_id) DO UPDATE SET "
+                            "number_monitors = EXCLUDED.number_monitors, "
+                            "polling_interval = EXCLUDED.polling_interval, "
+                            "expiration_days = EXCLUDED.expiration_days, "
+                            "flags = EXCLUDED.flags"
+                    ).arg(rows.mid(rowIndex, maximumRowsPerStatement).join(QChar(',')));
+
+                    success = SqlHelpers::execute(query, queryString);
+                    if (success) {
+                        rowIndex += maximumRowsPerStatement;
+                    } else {
+                        logWrite(
+                            QString(
+                                "Failed INSERT - CustomerCapabilities::synchronizeCustomerCapabilities: %1"
+                            ).arg(query.lastError().text()),
+                            true
+                        );
+                    }
+                }
+
+                if (supportsTransactions) {
+                    if (success) {
+                        success = database.commit();
+                        if (!success) {
+                            logWrite(
+                                QString(
+                                    "Failed to commit - CustomerCapabilities::synchronizeCustomerCapabilities: %1"
+                                ).arg(database.lastError().text()),
+                                true
+                            );
+                        }
+                    } else {
+                        bool rollbackSuccess = database.rollback();
+                        if (!rollbackSuccess) {
+                            logWrite(
+                                QString(
+                                    "Failed to rollback - CustomerCapabilities::synchronizeCustomerCapabilities: %1"
+                                ).arg(database.lastError().text()),
+                                true
+                            );
+                        }
+                    }
+                }
+
+                // Without transactions a failure can leave some rows written so the affected entries are evicted.
+                for (  CapabilitiesByCustomerId::const_iterator it = changed.constBegin(), end = changed.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    if (success) {
+                        addToCache(it.value());
+                        currentCatalog->customerChanged(it.key());
+                        CacheInvalidationBus::instance()->publish(invalidationTable, it.key());
+                    } else {
+                        evictCacheEntry(it.key());
+                    }
+                }
+            }
+        } else {
+            logWrite(
+                QString(
+                    "Failed to open database - CustomerCapabilities::synchronizeCustomerCapabilities: %1"
+                ).arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    }
+
+    if (success && changedCapabilities != nullptr) {
+        *changedCapabilities = changed;
+    }
+
+    return success;
+}
+
+
+CustomersCapabilities::CapabilitiesByCustomerId CustomersCapabilities::getCustomerCapabilities(
+        const CustomersCapabilities::CustomerIdSet& customerIds,
+        unsigned                                    threadId
+    ) {
+    RequestTracer::Span      cacheSpan(RequestTracer::Phase::CACHE, threadId);
+    CapabilitiesByCustomerId result;
+    QStringList              missingCustomerIds;
+
+    for (CustomerIdSet::const_iterator it=customerIds.constBegin(),end=customerIds.constEnd() ; it!=end ; ++it) {
+        CustomerId           customerId = *it;
+        CustomerCapabilities capabilities;
+        if (getCacheEntry(customerId, capabilities)) {
+            result.insert(customerId, capabilities);
+        } else if (!isKnownAbsent(customerId)) {
+            missingCustomerIds.append(QString::number(customerId));
+        }
+    }
+
+    if (!missingCustomerIds.isEmpty()) {
+        static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+            QString("CustomersCapabilities::getCustomerCapabilities")
+        );
+        MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+        RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        if (database.isOpen()) {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+
+            QString queryString = QString("SELECT * FROM customer_capabilities WHERE customer_id IN (%1)")
+                                  .arg(missingCustomerIds.join(QChar(',')));
+
+            if (SqlHelpers::execute(query, queryString)) {
+                int customerIdField      = query.record().indexOf("customer_id");
+                int numberMonitorsField  = query.record().indexOf("number_monitors");
+                int pollingIntervalField = query.record().indexOf("polling_interval");
+                int expirationDaysField  = query.record().indexOf("expiration_days");
+                int flagsField           = query.record().indexOf("flags");
+
+                if (customerIdField >= 0      &&
+                    numberMonitorsField >= 0  &&
+                    pollingIntervalField >= 0 &&
+                    expirationDaysField >=0   &&
+                    flagsField >= 0              ) {
+                    while (query.next()) {
+                        bool     ok;
+                        unsigned customerId      = query.value(customerIdField).toUInt(&ok);
+                        unsigned numberMonitors  = ok ? query.value(numberMonitorsField).toUInt(&ok) : 0;
+                        unsigned pollingInterval = ok ? query.value(pollingIntervalField).toUInt(&ok) : 0;
+                        unsigned expirationDays  = ok ? query.value(expirationDaysField).toUInt(&ok) : 0;
+                        unsigned flags           = ok ? query.value(flagsField).toUInt(&ok) : 0;
+
+                        if (ok                        &&
+                            customerId != 0           &&
+                            numberMonitors <= 0xFFFF  &&
+                            pollingInterval <= 0xFFFF &&
+                            flags <= 0xFFFF              ) {
+                            CustomerCapabilities capabilities(
+                                customerId,
+                                static_cast<unsigned short>(numberMonitors),
+                                static_cast<unsigned short>(pollingInterval),
+                                expirationDays,
+                                static_cast<CustomerCapabilities::Flags>(flags)
+                            );
+
+                            addToCache(capabilities);
+                            result.insert(customerId, capabilities);
+                        } else {
+                            logWrite(
+                                QString(
+                                    "Skipping invalid entry - CustomerCapabilities::getCustomerCapabilities: "
+                                    "customer_id = %1"
+                                ).arg(customerId),
+                                true
+                            );
+                        }
+                    }
+                } else {
+                    logWrite(
+                        QString(
+                            "Failed to get field index - CustomerCapabilities::getCustomerCapabilities: %1"
+                        ).arg(query.lastError().text()),
+                        true
+                    );
+                }
+            } else {
+                logWrite(
+                    QString(
+                        "Failed SELECT - CustomerCapabilities::getCustomerCapabilities: %1"
+                    ).arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString(
+                    "Failed to open database - CustomerCapabilities::getCustomerCapabilities: %1"
+                ).arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    }
+
+    return result;
+}
+
+
 CustomersCapabilities::CapabilitiesByCustomerId CustomersCapabilities::getAllCustomerCapabilities(unsigned threadId) {
     CapabilitiesByCustomerId result;
 
@@ -352,7 +709,7 @@ CustomersCapabilities::CapabilitiesByCustomerId CustomersCapabilities::getAllCus
         query.setForwardOnly(true);
 
         QString queryString = QString("SELECT * FROM customer_capabilities");
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             int customerIdField      = query.record().indexOf("customer_id");
             int numberMonitorsField  = query.record().indexOf("number_monitors");
@@ -476,6 +833,103 @@ CustomersCapabilities::CapabilitiesByCustomerId CustomersCapabilities::getAllCus
 }
 
 
+unsigned long CustomersCapabilities::warmCache(unsigned long maximumNumberEntries, unsigned threadId) {
+    unsigned long numberLoaded = 0;
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        // The capabilities table carries no activity timestamp so we treat customers currently mapped to a polling
+        // server as active, favoring the newest customers.
+        QString queryString = QString(
+            "SELECT cc.* FROM customer_capabilities AS cc "
+            "ORDER BY EXISTS ("
+                "SELECT 1 FROM customer_mapping AS cm WHERE cm.customer_id = cc.customer_id"
+            ") DESC, cc.customer_id DESC "
+            "LIMIT %1"
+        ).arg(maximumNumberEntries);
+
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            int customerIdField      = query.record().indexOf("customer_id");
+            int numberMonitorsField  = query.record().indexOf("number_monitors");
+            int pollingIntervalField = query.record().indexOf("polling_interval");
+            int expirationDaysField  = query.record().indexOf("expiration_days");
+            int flagsField           = query.record().indexOf("flags");
+
+            if (customerIdField >= 0      &&
+                numberMonitorsField >= 0  &&
+                pollingIntervalField >= 0 &&
+                expirationDaysField >=0   &&
+                flagsField >= 0              ) {
+                QThread* thread = QThread::currentThread();
+                while (!thread->isInterruptionRequested() && query.next()) {
+                    bool     ok;
+                    unsigned customerId      = query.value(customerIdField).toUInt(&ok);
+                    unsigned numberMonitors  = ok ? query.value(numberMonitorsField).toUInt(&ok) : 0;
+                    unsigned pollingInterval = ok ? query.value(pollingIntervalField).toUInt(&ok) : 0;
+                    unsigned expirationDays  = ok ? query.value(expirationDaysField).toUInt(&ok) : 0;
+                    unsigned flags           = ok ? query.value(flagsField).toUInt(&ok) : 0;
+
+                    if (ok                        &&
+                        customerId != 0           &&
+                        numberMonitors <= 0xFFFF  &&
+                        pollingInterval <= 0xFFFF &&
+                        flags <= 0xFFFF              ) {
+                        // Entries already cached were loaded on demand and may be newer than this row.
+                        bool added = addToCacheIfAbsent(
+                            CustomerCapabilities(
+                                customerId,
+                                static_cast<unsigned short>(numberMonitors),
+                                static_cast<unsigned short>(pollingInterval),
+                                expirationDays,
+                                static_cast<CustomerCapabilities::Flags>(flags)
+                            )
+                        );
+
+                        if (added) {
+                            ++numberLoaded;
+                        }
+                    } else {
+                        logWrite(
+                            QString(
+                                "Skipping invalid entry - CustomerCapabilities::warmCache: customer_id = %1"
+                            ).arg(customerId),
+                            true
+                        );
+                    }
+                }
+            } else {
+                logWrite(
+                    QString(
+                        "Failed to get field index - CustomerCapabilities::warmCache: %1"
+                    ).arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - CustomerCapabilities::warmCache: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString(
+                "Failed to open database - CustomerCapabilities::warmCache: %1"
+            ).arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return numberLoaded;
+}
+
+
 CustomersCapabilities::CustomerId CustomersCapabilities::idFromValue(const CustomerCapabilities& value) const {
     return value.customerId();
 }
@@ -0,0 +1,198 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref DashboardCache class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QString>
+#include <QAtomicInteger>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "concurrent_cache.h"
+#include "customer_capabilities.h"
+#include "host_schemes.h"
+#include "monitors.h"
+#include "events.h"
+#include "catalog.h"
+#include "server.h"
+#include "latency_rolling_statistics.h"
+#include "rest_helpers.h"
+#include "request_tracer.h"
+#include "dashboard_cache.h"
+
+DashboardCache::DashboardCache(
+        HostSchemes*              hostSchemeDatabaseApi,
+        Monitors*                 monitorDatabaseApi,
+        Events*                   eventDatabaseApi,
+        Catalog*                  catalog,
+        LatencyRollingStatistics* rollingStatistics,
+        unsigned long             maximumCacheDepth
+    ):currentHostSchemes(
+        hostSchemeDatabaseApi
+    ),currentMonitors(
+        monitorDatabaseApi
+    ),currentEvents(
+        eventDatabaseApi
+    ),currentCatalog(
+        catalog
+    ),currentRollingStatistics(
+        rollingStatistics
+    ),currentEventWindowDays(
+        defaultEventWindowDays
+    ),entryCache(
+        maximumCacheDepth
+    ) {}
+
+
+DashboardCache::~DashboardCache() {}
+
+
+void DashboardCache::resizeCache(unsigned long newCacheSize) {
+    entryCache.resizeCache(newCacheSize);
+}
+
+
+CacheBase::Statistics DashboardCache::statistics() const {
+    return entryCache.statistics();
+}
+
+
+void DashboardCache::setEventWindow(unsigned eventWindowDays) {
+    if (currentEventWindowDays.fetchAndStoreOrdered(eventWindowDays) != eventWindowDays) {
+        entryCache.clearCache();
+    }
+}
+
+
+unsigned DashboardCache::eventWindow() const {
+    return currentEventWindowDays.loadAcquire();
+}
+
+
+QByteArray DashboardCache::dashboard(CustomerId customerId, unsigned threadId) {
+    RequestTracer::Span cacheSpan(RequestTracer::Phase::CACHE, threadId);
+    QByteArray          result;
+
+    // The version is read before the database so changes made while the dashboard is built invalidate it.
+    unsigned long long dataVersion = currentCatalog->customerVersion(customerId);
+    Dashboard          cachedDashboard;
+    if (entryCache.getCacheEntry(customerId, cachedDashboard) && cachedDashboard.dataVersion == dataVersion) {
+        result = cachedDashboard.jsonData;
+    } else {
+        result = buildDashboard(customerId, threadId);
+        entryCache.addToCache(Dashboard(customerId, dataVersion, result));
+    }
+
+    if (currentRollingStatistics != nullptr && currentRollingStatistics->isEnabled()) {
+        result = addRollingStatistics(result, customerId, threadId);
+    }
+
+    return result;
+}
+
+
+QByteArray DashboardCache::buildDashboard(CustomerId customerId, unsigned threadId) const {
+    HostSchemes::HostSchemeHash customerHostSchemes = currentHostSchemes->getHostSchemes(
+        static_cast<HostSchemes::CustomerId>(customerId),
+        threadId
+    );
+
+    Monitors::MonitorList monitors = currentMonitors->getMonitorsByUserOrder(customerId, threadId);
+
+    Events::MonitorStatusByMonitorId monitorStatus = currentEvents->monitorStatusByCustomerId(customerId, threadId);
+
+    unsigned long long startTimestamp  = 0;
+    unsigned           eventWindowDays = currentEventWindowDays.loadAcquire();
+    if (eventWindowDays > 0) {
+        unsigned long long now          = static_cast<unsigned long long>(QDateTime::currentSecsSinceEpoch());
+        unsigned long long windowLength = 86400ULL * eventWindowDays;
+
+        startTimestamp = now > windowLength ? now - windowLength : 0;
+    }
+
+    Events::EventList events = currentEvents->getEventsByCustomer(
+        customerId,
+        startTimestamp,
+        static_cast<unsigned long long>(-1),
+        threadId
+    );
+
+    QJsonObject responseObject;
+    responseObject.insert("status", "OK");
+    responseObject.insert("host_schemes", convertToJson(customerHostSchemes, false));
+    responseObject.insert("monitors", convertToJson(monitors, false));
+    responseObject.insert("events", convertToJson(events, false, false));
+    responseObject.insert("monitor_status", convertToJson(monitorStatus));
+
+    return QJsonDocument(responseObject).toJson(QJsonDocument::Compact);
+}
+
+
+QByteArray DashboardCache::addRollingStatistics(
+        const QByteArray& dashboard,
+        CustomerId        customerId,
+        unsigned          threadId
+    ) const {
+    QByteArray result = dashboard;
+
+    Catalog::SnapshotPointer snapshot = currentCatalog->snapshot(threadId);
+    if (snapshot->isLoaded() && result.endsWith('}')) {
+        Catalog::MonitorsById                  monitors = snapshot->monitorsByCustomerId(customerId);
+        LatencyRollingStatistics::MonitorIdSet monitorIds;
+        for (  Catalog::MonitorsById::const_iterator it = monitors.constBegin(), end = monitors.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            monitorIds.insert(it.key());
+        }
+
+        QJsonObject statisticsObject;
+        for (unsigned windowIndex=0 ; windowIndex<LatencyRollingStatistics::numberWindows ; ++windowIndex) {
+            LatencyRollingStatistics::Window window = static_cast<LatencyRollingStatistics::Window>(windowIndex);
+
+            LatencyRollingStatistics::SummariesByMonitorId summaries = currentRollingStatistics->summaries(
+                &monitorIds,
+                Server::invalidServerId,
+                window
+            );
+
+            for (  LatencyRollingStatistics::SummariesByMonitorId::const_iterator
+                       it  = summaries.constBegin(),
+                       end = summaries.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                QString     monitorKey    = QString::number(it.key());
+                QJsonObject monitorObject = statisticsObject.value(monitorKey).toObject();
+                monitorObject.insert(LatencyRollingStatistics::toString(window), convertToJson(it.value()));
+                statisticsObject.insert(monitorKey, monitorObject);
+            }
+        }
+
+        // Dashboards are cached as compact JSON objects so the statistics are spliced in ahead of the closing brace
+        // rather than parsing and re-serializing the cached document.
+        result.chop(1);
+        result.append(",\"latency_rolling\":");
+        result.append(QJsonDocument(statisticsObject).toJson(QJsonDocument::Compact));
+        result.append('}');
+    }
+
+    return result;
+}
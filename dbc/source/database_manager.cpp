@@ -21,53 +21,376 @@
 #include <QCoreApplication>
 #include <QAtomicInteger>
 #include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QThread>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QWaitCondition>
+
+#include <algorithm>
 
 #include "log.h"
+#include "metrics_registry.h"
+#include "sql_helpers.h"
 #include "database_manager.h"
 
 const QString                      DatabaseManager::defaultDatabaseDriver("QPSQL");
 const unsigned short               DatabaseManager::defaultDatabasePort = 5432;
+const unsigned                     DatabaseManager::defaultMinimumPoolSize = 4;
+const unsigned                     DatabaseManager::defaultMaximumPoolSize = 64;
+const unsigned                     DatabaseManager::defaultIdleTimeoutSeconds = 300;
+const unsigned                     DatabaseManager::defaultHealthCheckIntervalSeconds = 30;
+const unsigned                     DatabaseManager::defaultMaximumAcquireWaitMilliseconds = 10000;
+const unsigned                     DatabaseManager::maximumPreparedStatementsPerConnection = 256;
+const unsigned                     DatabaseManager::defaultMaximumReplicaLagSeconds = 30;
+const unsigned                     DatabaseManager::reapIntervalMilliseconds = 15000;
+const unsigned                     DatabaseManager::replicaLagCheckIntervalMilliseconds = 5000;
+const int                          DatabaseManager::primaryDatabase = -1;
 QAtomicInteger<unsigned long long> DatabaseManager::instanceCounter(0);
 
-DatabaseManager::DatabaseManager() {}
+DatabaseManager::DatabaseManager() {
+    currentNumberOpenConnections           = 0;
+    currentSettingsGeneration              = 0;
+    currentMinimumPoolSize                 = defaultMinimumPoolSize;
+    currentMaximumPoolSize                 = defaultMaximumPoolSize;
+    currentIdleTimeoutMilliseconds         = 1000LL * defaultIdleTimeoutSeconds;
+    currentHealthCheckIntervalMilliseconds = 1000LL * defaultHealthCheckIntervalSeconds;
+    currentMaximumAcquireWaitMilliseconds  = defaultMaximumAcquireWaitMilliseconds;
+
+    currentNumberAcquisitions             = 0;
+    currentNumberWaits                    = 0;
+    currentNumberTimeouts                 = 0;
+    currentNumberHealthCheckFailures      = 0;
+    currentNumberReapedConnections        = 0;
+    currentTotalAcquireWaitMicroseconds   = 0;
+    currentMaximumAcquireWaitMicroseconds = 0;
+
+    currentDatabasePort   = defaultDatabasePort;
+    currentDatabaseDriver = defaultDatabaseDriver;
+
+    currentMaximumReplicaLagSeconds = defaultMaximumReplicaLagSeconds;
+
+    acquireMetric = MetricsRegistry::instance()->histogram(
+        QString("dbc_database_acquire_seconds"),
+        QString("Time spent acquiring pooled database connections, including opening new connections.")
+    );
 
+    poolClock.start();
 
-DatabaseManager::~DatabaseManager() {}
+    reapTimer = new QTimer(this);
+    reapTimer->setSingleShot(false);
+    connect(reapTimer, &QTimer::timeout, this, &DatabaseManager::reapIdleConnections);
+    reapTimer->start(reapIntervalMilliseconds);
+}
+
+
+DatabaseManager::~DatabaseManager() {
+    reapTimer->stop();
+
+    QMutexLocker poolMutexLocker(&poolMutex);
+    QList<QString> connectionNames = connections.keys();
+    for (QList<QString>::const_iterator it=connectionNames.constBegin(),end=connectionNames.constEnd() ; it!=end ; ++it) {
+        removeConnection(*it);
+    }
+}
 
 
 QSqlDatabase DatabaseManager::getDatabase(const QString& instanceName) {
-    QMutexLocker databaseMutexLocker(&databaseMutex);
+    return acquireDatabase(connectionName(instanceName), primaryDatabase);
+}
+
+
+QSqlDatabase DatabaseManager::getDatabase() {
+    return openDatabase(QString("i") + QString::number(instanceCounter.fetchAndAddRelaxed(1)));
+}
+
+
+QSqlDatabase DatabaseManager::getReadDatabase(const QString& instanceName) {
+    databaseMutex.lock();
+    unsigned numberReplicas = static_cast<unsigned>(replicas.size());
+    databaseMutex.unlock();
+
+    for (unsigned attempt=0 ; attempt<numberReplicas ; ++attempt) {
+        unsigned replicaIndex = nextReplica.fetchAndAddRelaxed(1) % numberReplicas;
+        bool     usable       = false;
+        bool     checkLag     = false;
+        unsigned maximumLagSeconds;
 
-    if (QSqlDatabase::contains(instanceName)) {
-        QSqlDatabase::removeDatabase(instanceName);
+        databaseMutex.lock();
+        if (replicaIndex < static_cast<unsigned>(replicas.size())) {
+            Replica&  replica = replicas[replicaIndex];
+            long long now     = poolClock.elapsed();
+
+            // Claim the lag check so concurrent readers do not all check the same replica.
+            checkLag = (now - replica.lastLagCheckTime) >= replicaLagCheckIntervalMilliseconds;
+            if (checkLag) {
+                replica.lastLagCheckTime = now;
+            }
+
+            usable = checkLag || !replica.lagging;
+        }
+        maximumLagSeconds = currentMaximumReplicaLagSeconds;
+        databaseMutex.unlock();
+
+        if (usable) {
+            QSqlDatabase database = acquireDatabase(
+                connectionName(QString("%1/replica%2").arg(instanceName).arg(replicaIndex)),
+                static_cast<int>(replicaIndex)
+            );
+
+            bool current = database.isOpen() && (!checkLag || isReplicaCurrent(database, maximumLagSeconds));
+            if (checkLag || !current) {
+                QMutexLocker databaseMutexLocker(&databaseMutex);
+                if (replicaIndex < static_cast<unsigned>(replicas.size())) {
+                    replicas[replicaIndex].lagging = !current;
+                }
+            }
+
+            if (current) {
+                return database;
+            }
+
+            closeAndRelease(database);
+        }
     }
 
-    QSqlDatabase database = QSqlDatabase::addDatabase(currentDatabaseDriver, instanceName);
-    database.setHostName(currentDatabaseServer);
-    database.setPort(currentDatabasePort);
-    database.setDatabaseName(currentDatabaseName);
+    return getDatabase(instanceName);
+}
 
-    bool ok = database.open(currentDatabaseUsername, currentDatabasePassword);
-    if (!ok && database.isOpen()) {
-        database.close();
+
+QSqlDatabase DatabaseManager::acquireDatabase(const QString& name, int replicaIndex) {
+    MetricsRegistry::ScopedTimer acquireTimer(acquireMetric);
+
+    poolMutex.lock();
+    ++currentNumberAcquisitions;
+
+    QHash<QString, Connection>::iterator it = connections.find(name);
+    if (it != connections.end()) {
+        Connection& connection = it.value();
+        ++connection.useCount;
+
+        if (connection.useCount == 1) {
+            bool staleSettings = connection.settingsGeneration != currentSettingsGeneration;
+            bool needsCheck    = (poolClock.elapsed() - connection.lastReleaseTime)
+                                 >= currentHealthCheckIntervalMilliseconds;
+            QSqlDatabase database = connection.database;
+            poolMutex.unlock();
+
+            if (staleSettings || !database.isOpen() || (needsCheck && !isHealthy(database))) {
+                if (!staleSettings) {
+                    QMutexLocker poolMutexLocker(&poolMutex);
+                    ++currentNumberHealthCheckFailures;
+                }
+
+                // Statements prepared on the old connection must be released before the connection is closed.
+                QHash<QString, QSqlQuery> staleStatements;
+                poolMutex.lock();
+                staleStatements.swap(connections[name].preparedStatements);
+                poolMutex.unlock();
+                staleStatements.clear();
+
+                if (database.isOpen()) {
+                    database.close();
+                }
+
+                database = QSqlDatabase();
+
+                poolMutex.lock();
+                connections[name].database = QSqlDatabase();
+                poolMutex.unlock();
+
+                database = openDatabase(name, replicaIndex);
+
+                poolMutex.lock();
+                Connection& reopened = connections[name];
+                reopened.database           = database;
+                reopened.settingsGeneration = currentSettingsGeneration;
+                poolMutex.unlock();
+            }
+
+            return database;
+        } else {
+            QSqlDatabase database = connection.database;
+            poolMutex.unlock();
+
+            return database;
+        }
+    }
+
+    if (currentNumberOpenConnections >= currentMaximumPoolSize) {
+        qint64 waitStart = poolClock.nsecsElapsed();
+        bool   timedOut  = false;
+
+        ++currentNumberWaits;
+        while (!timedOut && currentNumberOpenConnections >= currentMaximumPoolSize && !evictIdleConnection()) {
+            unsigned long long waitedMilliseconds = (poolClock.nsecsElapsed() - waitStart) / 1000000;
+            if (waitedMilliseconds >= currentMaximumAcquireWaitMilliseconds) {
+                timedOut = true;
+            } else {
+                poolSlotAvailable.wait(&poolMutex, currentMaximumAcquireWaitMilliseconds - waitedMilliseconds);
+            }
+        }
+
+        unsigned long long waitMicroseconds = (poolClock.nsecsElapsed() - waitStart) / 1000;
+        currentTotalAcquireWaitMicroseconds += waitMicroseconds;
+        currentMaximumAcquireWaitMicroseconds = std::max(currentMaximumAcquireWaitMicroseconds, waitMicroseconds);
+
+        if (timedOut) {
+            ++currentNumberTimeouts;
+            poolMutex.unlock();
+
+            logWrite(
+                QString("Timed out waiting for a database connection - DatabaseManager::acquireDatabase: %1")
+                .arg(name),
+                true
+            );
+
+            return QSqlDatabase();
+        }
     }
 
+    Connection& connection = connections[name];
+    connection.useCount           = 1;
+    connection.settingsGeneration = currentSettingsGeneration;
+    connection.owningThread       = QThread::currentThread();
+    ++currentNumberOpenConnections;
+
+    poolMutex.unlock();
+
+    QSqlDatabase database = openDatabase(name, replicaIndex);
+
+    poolMutex.lock();
+    connections[name].database = database;
+    poolMutex.unlock();
+
     return database;
 }
 
 
-QSqlDatabase DatabaseManager::getDatabase() {
-    return getDatabase(QString("i") + QString::number(instanceCounter.fetchAndAddRelaxed(1)));
+void DatabaseManager::closeAndRelease(QSqlDatabase& database) {
+    QString name = database.connectionName();
+
+    poolMutex.lock();
+    QHash<QString, Connection>::iterator it = connections.find(name);
+    if (it != connections.end()) {
+        Connection& connection = it.value();
+        if (connection.useCount > 0) {
+            --connection.useCount;
+        }
+
+        if (connection.useCount == 0) {
+            connection.lastReleaseTime = poolClock.elapsed();
+            if (!connection.database.isOpen()) {
+                database = QSqlDatabase();
+                removeConnection(name);
+            }
+
+            poolSlotAvailable.wakeOne();
+        }
+
+        poolMutex.unlock();
+    } else {
+        poolMutex.unlock();
+
+        if (database.isOpen()) {
+            database.close();
+        }
+    }
+
+    database = QSqlDatabase();
 }
 
 
-void DatabaseManager::closeAndRelease(QSqlDatabase& database) {
-    if (database.isOpen()) {
-        database.close();
+QSqlQuery DatabaseManager::preparedQuery(const QSqlDatabase& database, const QString& statement, bool* success) {
+    QString connectionName = database.connectionName();
+    bool    pooled;
+
+    poolMutex.lock();
+    QHash<QString, Connection>::iterator it = connections.find(connectionName);
+    if (it != connections.end()) {
+        pooled = true;
+
+        const QHash<QString, QSqlQuery>&          preparedStatements = it.value().preparedStatements;
+        QHash<QString, QSqlQuery>::const_iterator statementIterator  = preparedStatements.constFind(statement);
+        if (statementIterator != preparedStatements.constEnd()) {
+            QSqlQuery result = statementIterator.value();
+            poolMutex.unlock();
+
+            if (success != nullptr) {
+                *success = true;
+            }
+
+            return result;
+        }
+    } else {
+        pooled = false;
+    }
+    poolMutex.unlock();
+
+    QSqlQuery result(database);
+    result.setForwardOnly(true);
+
+    bool prepared = result.prepare(statement);
+    if (prepared) {
+        if (pooled) {
+            QMutexLocker poolMutexLocker(&poolMutex);
+
+            it = connections.find(connectionName);
+            if (it != connections.end()) {
+                QHash<QString, QSqlQuery>& preparedStatements = it.value().preparedStatements;
+                if (static_cast<unsigned>(preparedStatements.size()) >= maximumPreparedStatementsPerConnection) {
+                    preparedStatements.clear();
+                }
+
+                preparedStatements.insert(statement, result);
+            }
+        }
+    } else {
+        logWrite(
+            QString("Failed to prepare statement - DatabaseManager::preparedQuery: %1: %2")
+            .arg(statement, result.lastError().text()),
+            true
+        );
+    }
+
+    if (success != nullptr) {
+        *success = prepared;
+    }
+
+    return result;
+}
+
+
+DatabaseManager::Statistics DatabaseManager::statistics() const {
+    QMutexLocker poolMutexLocker(&poolMutex);
+
+    unsigned numberIdleConnections = 0;
+    for (QHash<QString, Connection>::const_iterator it=connections.constBegin(),end=connections.constEnd() ;
+         it!=end                                                                                              ;
+         ++it                                                                                                 ) {
+        if (it.value().useCount == 0) {
+            ++numberIdleConnections;
+        }
     }
+
+    return Statistics(
+        currentNumberOpenConnections,
+        numberIdleConnections,
+        currentNumberAcquisitions,
+        currentNumberWaits,
+        currentNumberTimeouts,
+        currentNumberHealthCheckFailures,
+        currentNumberReapedConnections,
+        currentTotalAcquireWaitMicroseconds,
+        currentMaximumAcquireWaitMicroseconds
+    );
 }
 
 
@@ -81,10 +404,241 @@ void DatabaseManager::setDatabaseConnectionSettings(
     ) {
     QMutexLocker databaseMutexLocker(&databaseMutex);
 
-    currentDatabaseUsername = databaseUsername;
-    currentDatabasePassword = databasePassword;
-    currentDatabaseName     = databaseName;
-    currentDatabaseServer   = databaseServer;
-    currentDatabasePort     = databasePort;
-    currentDatabaseDriver   = databaseDriver;
+    if (currentDatabaseUsername != databaseUsername ||
+        currentDatabasePassword != databasePassword ||
+        currentDatabaseName != databaseName         ||
+        currentDatabaseServer != databaseServer     ||
+        currentDatabasePort != databasePort         ||
+        currentDatabaseDriver != databaseDriver        ) {
+        currentDatabaseUsername = databaseUsername;
+        currentDatabasePassword = databasePassword;
+        currentDatabaseName     = databaseName;
+        currentDatabaseServer   = databaseServer;
+        currentDatabasePort     = databasePort;
+        currentDatabaseDriver   = databaseDriver;
+
+        QMutexLocker poolMutexLocker(&poolMutex);
+        ++currentSettingsGeneration;
+    }
+}
+
+
+void DatabaseManager::setPoolParameters(
+        unsigned minimumPoolSize,
+        unsigned maximumPoolSize,
+        unsigned idleTimeoutSeconds,
+        unsigned healthCheckIntervalSeconds,
+        unsigned maximumAcquireWaitMilliseconds
+    ) {
+    QMutexLocker poolMutexLocker(&poolMutex);
+
+    currentMaximumPoolSize                 = std::max(1U, maximumPoolSize);
+    currentMinimumPoolSize                 = std::min(minimumPoolSize, currentMaximumPoolSize);
+    currentIdleTimeoutMilliseconds         = 1000LL * idleTimeoutSeconds;
+    currentHealthCheckIntervalMilliseconds = 1000LL * healthCheckIntervalSeconds;
+    currentMaximumAcquireWaitMilliseconds  = maximumAcquireWaitMilliseconds;
+
+    poolSlotAvailable.wakeAll();
+}
+
+
+void DatabaseManager::setReadReplicas(const QStringList& replicaServers, unsigned maximumLagSeconds) {
+    QList<Replica> newReplicas;
+    for (QStringList::const_iterator it=replicaServers.constBegin(),end=replicaServers.constEnd() ; it!=end ; ++it) {
+        Replica replica;
+        int     separator = it->lastIndexOf(QChar(':'));
+        bool    ok        = true;
+
+        if (separator > 0) {
+            replica.server = it->left(separator);
+            replica.port   = it->mid(separator + 1).toUShort(&ok);
+        } else {
+            replica.server = *it;
+            replica.port   = defaultDatabasePort;
+        }
+
+        if (ok && !replica.server.isEmpty()) {
+            newReplicas.append(replica);
+        } else {
+            logWrite(QString("Invalid read replica \"%1\" - DatabaseManager::setReadReplicas").arg(*it), true);
+        }
+    }
+
+    QMutexLocker databaseMutexLocker(&databaseMutex);
+    currentMaximumReplicaLagSeconds = maximumLagSeconds;
+
+    bool changed = newReplicas.size() != replicas.size();
+    for (int i=0 ; !changed && i<newReplicas.size() ; ++i) {
+        changed = newReplicas.at(i).server != replicas.at(i).server || newReplicas.at(i).port != replicas.at(i).port;
+    }
+
+    if (changed) {
+        replicas = newReplicas;
+
+        QMutexLocker poolMutexLocker(&poolMutex);
+        ++currentSettingsGeneration;
+    }
+}
+
+
+void DatabaseManager::reapIdleConnections() {
+    QMutexLocker poolMutexLocker(&poolMutex);
+
+    long long      now = poolClock.elapsed();
+    QList<QString> reapList;
+    unsigned       numberIdleConnections = 0;
+
+    for (QHash<QString, Connection>::const_iterator it=connections.constBegin(),end=connections.constEnd() ;
+         it!=end                                                                                              ;
+         ++it                                                                                                 ) {
+        const Connection& connection = it.value();
+        if (connection.useCount == 0) {
+            ++numberIdleConnections;
+            if (now - connection.lastReleaseTime >= currentIdleTimeoutMilliseconds) {
+                reapList.append(it.key());
+            }
+        }
+    }
+
+    for (QList<QString>::const_iterator it=reapList.constBegin(),end=reapList.constEnd() ;
+         it!=end && numberIdleConnections > currentMinimumPoolSize                        ;
+         ++it                                                                               ) {
+        removeConnection(*it);
+        ++currentNumberReapedConnections;
+        --numberIdleConnections;
+    }
+}
+
+
+QString DatabaseManager::connectionName(const QString& instanceName) {
+    return QString("%1@%2").arg(instanceName).arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+}
+
+
+QSqlDatabase DatabaseManager::openDatabase(const QString& connectionName, int replicaIndex) {
+    databaseMutex.lock();
+    QString        databaseDriver   = currentDatabaseDriver;
+    QString        databaseServer   = currentDatabaseServer;
+    unsigned short databasePort     = currentDatabasePort;
+    if (replicaIndex != primaryDatabase && replicaIndex < replicas.size()) {
+        databaseServer = replicas.at(replicaIndex).server;
+        databasePort   = replicas.at(replicaIndex).port;
+    }
+
+    QString        databaseName     = currentDatabaseName;
+    QString        databaseUsername = currentDatabaseUsername;
+    QString        databasePassword = currentDatabasePassword;
+    databaseMutex.unlock();
+
+    if (QSqlDatabase::contains(connectionName)) {
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+
+    QSqlDatabase database = QSqlDatabase::addDatabase(databaseDriver, connectionName);
+    database.setHostName(databaseServer);
+    database.setPort(databasePort);
+    database.setDatabaseName(databaseName);
+
+    bool ok = database.open(databaseUsername, databasePassword);
+    if (!ok && database.isOpen()) {
+        database.close();
+    }
+
+    return database;
+}
+
+
+bool DatabaseManager::isHealthy(QSqlDatabase& database) {
+    QSqlQuery query(database);
+    bool success = SqlHelpers::execute(query, "SELECT 1");
+    if (!success) {
+        logWrite(
+            QString("Pooled database connection failed health check - DatabaseManager::isHealthy: %1")
+            .arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool DatabaseManager::isReplicaCurrent(QSqlDatabase& database, unsigned maximumLagSeconds) {
+    // A replica that has replayed everything it received is current even if the primary has been idle.  The lag is
+    // zero on servers that are not in recovery.
+    QSqlQuery query(database);
+    bool success = SqlHelpers::execute(
+        query,
+        "SELECT COALESCE("
+            "CASE WHEN pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0 "
+            "ELSE EXTRACT(EPOCH FROM (now() - pg_last_xact_replay_timestamp())) END, "
+            "0"
+        ")"
+    );
+
+    if (success && query.first()) {
+        double lagSeconds = query.value(0).toDouble(&success);
+        if (success && lagSeconds > maximumLagSeconds) {
+            logWrite(
+                QString("Read replica %1 lagging by %2 seconds - DatabaseManager::isReplicaCurrent")
+                .arg(database.hostName())
+                .arg(lagSeconds),
+                true
+            );
+
+            success = false;
+        }
+    } else {
+        logWrite(
+            QString("Failed replication lag check - DatabaseManager::isReplicaCurrent: %1")
+            .arg(query.lastError().text()),
+            true
+        );
+
+        success = false;
+    }
+
+    return success;
+}
+
+
+void DatabaseManager::removeConnection(const QString& connectionName) {
+    QHash<QString, Connection>::iterator it = connections.find(connectionName);
+    if (it != connections.end()) {
+        it.value().preparedStatements.clear();
+
+        if (it.value().database.isOpen()) {
+            it.value().database.close();
+        }
+
+        connections.erase(it);
+        --currentNumberOpenConnections;
+
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+
+bool DatabaseManager::evictIdleConnection() {
+    QString   oldestName;
+    long long oldestReleaseTime = 0;
+    bool      found             = false;
+
+    for (QHash<QString, Connection>::const_iterator it=connections.constBegin(),end=connections.constEnd() ;
+         it!=end                                                                                              ;
+         ++it                                                                                                 ) {
+        const Connection& connection = it.value();
+        if (connection.useCount == 0 && (!found || connection.lastReleaseTime < oldestReleaseTime)) {
+            found             = true;
+            oldestName        = it.key();
+            oldestReleaseTime = connection.lastReleaseTime;
+        }
+    }
+
+    if (found) {
+        removeConnection(oldestName);
+        ++currentNumberReapedConnections;
+    }
+
+    return found;
 }
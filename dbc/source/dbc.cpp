@@ -26,11 +26,16 @@
 #include <QStringList>
 #include <QFileSystemWatcher>
 #include <QFile>
+#include <QIODevice>
 #include <QNetworkAccessManager>
 #include <QJsonParseError>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
+#include <QJsonArray>
+#include <QRegularExpression>
+
+#include <cmath>
 
 #include <inextea.h>
 #include <crypto_aes_cbc_encryptor.h>
@@ -42,17 +47,45 @@
 #include <rest_api_in_v1_inesonic_binary_rest_handler.h>
 
 #include "log.h"
+#include "log_writer.h"
+#include "metrics_registry.h"
+#include "request_tracer.h"
+#include "worker_pools.h"
+#include "thread_placement.h"
+#include "query_statistics.h"
+#include "statement_pipeline.h"
+#include "memory_governor.h"
+#include "cache_invalidation_bus.h"
+#include "traffic_recorder.h"
 #include "database_manager.h"
+#include "id_registry.h"
+#include "catalog.h"
+#include "latency_aggregator.h"
+#include "latency_purger.h"
+#include "latency_deduplicator.h"
+#include "latency_archive.h"
 #include "latency_interface_manager.h"
+#include "query_executor.h"
+#include "latency_ring_buffer.h"
+#include "latency_result_cache.h"
+#include "plot_worker_pool.h"
+#include "plot_cache.h"
 #include "latency_plotter.h"
+#include "response_compressor.h"
+#include "dashboard_cache.h"
+#include "customer_rate_limiter.h"
 #include "regions.h"
 #include "servers.h"
 #include "customer_secrets.h"
 #include "customers_capabilities.h"
+#include "cache_warmer.h"
+#include "warm_start.h"
+#include "query_plan_checker.h"
 #include "host_schemes.h"
 #include "monitors.h"
 #include "events.h"
 #include "customer_mapping.h"
+#include "shard_map.h"
 #include "region_manager.h"
 #include "server_manager.h"
 #include "host_scheme_manager.h"
@@ -72,16 +105,37 @@
 #include "resources.h"
 #include "resource_plotter.h"
 #include "resource_manager.h"
+#include "job_scheduler.h"
+#include "job_manager.h"
+#include "periodic_scheduler.h"
+#include "metrics_manager.h"
 #include "dbc.h"
 
-DbC::DbC(const QString& configurationFilename, QObject* parent):QObject(parent) {
+const QStringList DbC::restartRequiredSettings = {
+    "database_username",
+    "database_password",
+    "database_server",
+    "database_name",
+    "inbound_port",
+    "inbound_host_address",
+    "shard_id",
+    "customer_secrets_encryption_key",
+    "customer_identifier_key",
+    "latency_spool_directory"
+};
+
+DbC::DbC(const QString& configurationFilename, bool relayMode, QObject* parent):QObject(parent) {
     currentConfigurationFilename = configurationFilename;
+    currentRelayMode             = relayMode;
+    configurationApplied         = false;
     fileSystemWatcher = new QFileSystemWatcher(QStringList() << configurationFilename, this);
     connect(fileSystemWatcher, &QFileSystemWatcher::fileChanged, this, &DbC::configurationFileChanged);
 
     databaseManager        = new DatabaseManager;
+    currentIdRegistry      = new IdRegistry(this);
+    currentCatalog         = new Catalog(databaseManager, this);
     currentRegions         = new Regions(databaseManager, this);
-    currentServers         = new Servers(databaseManager, this);
+    currentServers         = new Servers(databaseManager, currentIdRegistry, this);
     currentCustomerSecrets = new CustomerSecrets(
         databaseManager,
         QByteArray(),
@@ -91,19 +145,80 @@ DbC::DbC(const QString& configurationFilename, QObject* parent):QObject(parent)
     );
     currentCustomersCapabilities = new CustomersCapabilities(
         databaseManager,
+        currentCatalog,
         CustomersCapabilities::defaultCacheDepth,
         this
     );
-    currentHostSchemes     = new HostSchemes(databaseManager, this);
-    currentMonitors        = new Monitors(databaseManager, this);
-    currentEvents          = new Events(databaseManager, this);
+    currentCacheWarmer     = new CacheWarmer(currentCustomerSecrets, currentCustomersCapabilities, this);
+    currentWarmStart       = new WarmStart(currentCatalog, this);
+    currentQueryPlanChecker = new QueryPlanChecker(databaseManager, this);
+    currentHostSchemes     = new HostSchemes(databaseManager, currentIdRegistry, currentCatalog, this);
+    currentMonitors        = new Monitors(databaseManager, currentIdRegistry, currentCatalog, this);
+    currentEvents          = new Events(databaseManager, currentCatalog, this);
     currentResources       = new Resources(databaseManager, this);
     currentCustomerMapping = new CustomerMapping(databaseManager, this);
+    currentShardMap        = new ShardMap(databaseManager, this);
+
+    currentCustomerMapping->setShardMap(currentShardMap);
+
+    // Handlers run on the invalidation bus thread when another instance reports a committed change.
+    CacheInvalidationBus* cacheInvalidationBus = CacheInvalidationBus::instance();
+    cacheInvalidationBus->registerHandler(
+        QString(CustomerSecrets::invalidationTable),
+        [this](quint64 customerId) {
+            if (customerId == CacheInvalidationBus::allEntries) {
+                currentCustomerSecrets->clearCache();
+            } else {
+                currentCustomerSecrets->evictCacheEntry(static_cast<CustomerSecrets::CustomerId>(customerId));
+                currentCustomerSecrets->clearNegativeEntry(static_cast<CustomerSecrets::CustomerId>(customerId));
+            }
+        }
+    );
+    cacheInvalidationBus->registerHandler(
+        QString(CustomersCapabilities::invalidationTable),
+        [this](quint64 customerId) {
+            if (customerId == CacheInvalidationBus::allEntries) {
+                currentCustomersCapabilities->clearCache();
+                currentCatalog->allCustomersChanged();
+            } else {
+                CustomersCapabilities::CustomerId id = static_cast<CustomersCapabilities::CustomerId>(customerId);
+                currentCustomersCapabilities->evictCacheEntry(id);
+                currentCustomersCapabilities->clearNegativeEntry(id);
+                currentCatalog->customerChanged(id);
+            }
+        }
+    );
+    cacheInvalidationBus->registerHandler(
+        QString(CustomerMapping::invalidationTable),
+        [this](quint64) {
+            currentCustomerMapping->invalidate();
+        }
+    );
+    cacheInvalidationBus->registerHandler(
+        QString(Catalog::invalidationTable),
+        [this](quint64 customerId) {
+            if (customerId == CacheInvalidationBus::allEntries) {
+                currentCatalog->invalidate();
+            } else {
+                currentCatalog->reloadCustomer(
+                    static_cast<Catalog::CustomerId>(customerId),
+                    CacheInvalidationBus::busThreadId
+                );
+            }
+        }
+    );
 
-    latencyInterfaceManager  = new LatencyInterfaceManager(databaseManager, this);
+    latencyInterfaceManager  = new LatencyInterfaceManager(
+        databaseManager,
+        currentIdRegistry,
+        currentCatalog,
+        this
+    );
+    latencyInterfaceManager->setAggregationEnabled(!relayMode);
 
-    currentLatencyPlotter  = new LatencyPlotter(latencyInterfaceManager, this);
-    currentResourcePlotter = new ResourcePlotter(currentResources, this);
+    currentPlotWorkerPool  = new PlotWorkerPool(this);
+    currentLatencyPlotter  = new LatencyPlotter(latencyInterfaceManager, currentPlotWorkerPool, this);
+    currentResourcePlotter = new ResourcePlotter(currentResources, currentPlotWorkerPool, this);
 
     wordPressCustomerAuthenticator = new CustomerAuthenticator(
         true,
@@ -166,107 +281,252 @@ DbC::DbC(const QString& configurationFilename, QObject* parent):QObject(parent)
         outboundRestApiFactory,
         this
     );
-    currentMonitorUpdater = new MonitorUpdater(currentHostSchemes, currentMonitors, currentServerAdministrator);
-
-    currentRegionManager = new RegionManager(inboundRestServer, currentRegions, QByteArray(), this);
-    currentServerManager = new ServerManager(
-        inboundRestServer,
-        currentServerAdministrator,
-        currentRegions,
-        QByteArray(),
-        this
-    );
-    currentHostSchemeManager = new HostSchemeManager(
-        inboundRestServer,
+    currentMonitorUpdater = new MonitorUpdater(
+        databaseManager,
         currentHostSchemes,
-        currentMonitorUpdater,
-        QByteArray(),
-        this
-    );
-    currentMonitorManager = new MonitorManager(
-        inboundRestServer,
         currentMonitors,
-        currentCustomersCapabilities,
-        currentMonitorUpdater,
-        QByteArray(),
-        this
-    );
-    currentCustomerCapabilitiesManager = new CustomerCapabilitiesManager(
-        inboundRestServer,
-        currentCustomersCapabilities,
-        currentCustomerSecrets,
-        currentServerAdministrator,
-        QByteArray(),
-        this
+        currentServerAdministrator
     );
-    currentEventManager = new EventManager(
-        inboundRestServer,
-        currentEvents,
+
+    currentResponseCompressor  = new ResponseCompressor;
+    currentDashboardCache      = new DashboardCache(
+        currentHostSchemes,
         currentMonitors,
-        currentEventProcessor,
-        QByteArray(),
-        this
-    );
-    currentCustomerMappingManager = new CustomerMappingManager(
-        inboundRestServer,
-        currentCustomerMapping,
-        currentServerAdministrator,
-        QByteArray(),
-        this
+        currentEvents,
+        currentCatalog,
+        latencyInterfaceManager->rollingStatistics()
     );
+    currentCustomerRateLimiter = new CustomerRateLimiter(currentCustomersCapabilities);
+
     currentLatencyManager = new LatencyManager(
         inboundRestServer,
         latencyInterfaceManager,
-        currentServers,
+        currentServerAdministrator,
         currentMonitors,
         currentLatencyPlotter,
+        currentResponseCompressor,
         QByteArray(),
         this
     );
-    currentMultipleManager = new MultipleManager(
+    currentMetricsManager = new MetricsManager(
         inboundRestServer,
-        currentHostSchemes,
-        currentMonitors,
-        currentEvents,
-        currentLatencyPlotter,
+        MetricsRegistry::instance(),
+        QueryStatistics::instance(),
+        currentResponseCompressor,
         QByteArray(),
         this
     );
-    currentResourceManager = new ResourceManager(
-        inboundRestServer,
-        currentResources,
-        currentResourcePlotter,
-        QByteArray(),
-        this
+
+    if (relayMode) {
+        currentRegionManager               = nullptr;
+        currentServerManager               = nullptr;
+        currentHostSchemeManager           = nullptr;
+        currentMonitorManager              = nullptr;
+        currentCustomerCapabilitiesManager = nullptr;
+        currentEventManager                = nullptr;
+        currentCustomerMappingManager      = nullptr;
+        currentMultipleManager             = nullptr;
+        currentResourceManager             = nullptr;
+        currentJobScheduler                = nullptr;
+        currentJobManager                  = nullptr;
+        customerRestApiV1                  = nullptr;
+    } else {
+        // The scheduler is created ahead of the managers that register job types so its workers are stopped first.
+        currentJobScheduler = new JobScheduler(databaseManager, this);
+        currentJobManager   = new JobManager(inboundRestServer, currentJobScheduler, QByteArray(), this);
+
+        currentEvents->setJobScheduler(currentJobScheduler);
+
+        currentRegionManager = new RegionManager(inboundRestServer, currentRegions, QByteArray(), this);
+        currentServerManager = new ServerManager(
+            inboundRestServer,
+            currentServerAdministrator,
+            currentRegions,
+            currentJobScheduler,
+            QByteArray(),
+            this
+        );
+        currentHostSchemeManager = new HostSchemeManager(
+            inboundRestServer,
+            currentHostSchemes,
+            currentMonitorUpdater,
+            QByteArray(),
+            this
+        );
+        currentMonitorManager = new MonitorManager(
+            inboundRestServer,
+            currentMonitors,
+            currentCustomersCapabilities,
+            currentMonitorUpdater,
+            QByteArray(),
+            this
+        );
+        currentCustomerCapabilitiesManager = new CustomerCapabilitiesManager(
+            inboundRestServer,
+            currentCustomersCapabilities,
+            currentCustomerSecrets,
+            currentServerAdministrator,
+            currentCacheWarmer,
+            currentJobScheduler,
+            QByteArray(),
+            this
+        );
+        currentEventManager = new EventManager(
+            inboundRestServer,
+            currentEvents,
+            currentMonitors,
+            currentEventProcessor,
+            QByteArray(),
+            this
+        );
+        currentCustomerMappingManager = new CustomerMappingManager(
+            inboundRestServer,
+            currentCustomerMapping,
+            currentServerAdministrator,
+            QByteArray(),
+            this
+        );
+        currentMultipleManager = new MultipleManager(
+            inboundRestServer,
+            currentDashboardCache,
+            currentLatencyPlotter,
+            currentResponseCompressor,
+            QByteArray(),
+            this
+        );
+        currentResourceManager = new ResourceManager(
+            inboundRestServer,
+            currentResources,
+            currentResourcePlotter,
+            QByteArray(),
+            this
+        );
+        customerRestApiV1 = new CustomerRestApiV1(
+            inboundRestServer,
+            wordPressCustomerAuthenticator,
+            restCustomerAuthenticator,
+            currentCustomersCapabilities,
+            currentHostSchemes,
+            currentMonitors,
+            currentMonitorUpdater,
+            currentRegions,
+            currentEvents,
+            currentEventProcessor,
+            latencyInterfaceManager,
+            currentLatencyPlotter,
+            currentResources,
+            currentResourcePlotter,
+            currentServerAdministrator,
+            currentResponseCompressor,
+            currentCatalog,
+            currentDashboardCache,
+            currentCustomerRateLimiter,
+            this
+        );
+    }
+
+    addCacheMetrics(QString("customer_secrets"), [this]() { return currentCustomerSecrets->statistics(); });
+    addCacheMetrics(
+        QString("customer_capabilities"),
+        [this]() { return currentCustomersCapabilities->statistics(); }
     );
-    customerRestApiV1 = new CustomerRestApiV1(
-        inboundRestServer,
-        wordPressCustomerAuthenticator,
-        restCustomerAuthenticator,
-        currentCustomersCapabilities,
-        currentHostSchemes,
-        currentMonitors,
-        currentMonitorUpdater,
-        currentRegions,
-        currentServers,
-        currentEvents,
-        currentEventProcessor,
-        latencyInterfaceManager,
-        currentLatencyPlotter,
-        currentResources,
-        currentResourcePlotter,
-        currentServerAdministrator,
-        this
+    addCacheMetrics(QString("resources"), [this]() { return currentResources->statistics(); });
+    addCacheMetrics(QString("dashboards"), [this]() { return currentDashboardCache->statistics(); });
+    addCacheMetrics(QString("plots"), [this]() { return currentLatencyPlotter->plotCache().statistics(); });
+    addCacheMetrics(
+        QString("latency_results"),
+        [this]() { return latencyInterfaceManager->resultCacheStatistics(); }
+    );
+
+    addSampledMetric(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_database_open_connections"),
+        QString("Number of open pooled database connections."),
+        QString(),
+        [this]() { return static_cast<double>(databaseManager->statistics().numberOpenConnections()); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_database_idle_connections"),
+        QString("Number of open pooled database connections not in use."),
+        QString(),
+        [this]() { return static_cast<double>(databaseManager->statistics().numberIdleConnections()); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_database_acquire_waits_total"),
+        QString("Number of connection acquisitions that waited for a pool slot."),
+        QString(),
+        [this]() { return static_cast<double>(databaseManager->statistics().numberWaits()); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_database_acquire_timeouts_total"),
+        QString("Number of connection acquisitions that timed out."),
+        QString(),
+        [this]() { return static_cast<double>(databaseManager->statistics().numberTimeouts()); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_log_messages_dropped_total"),
+        QString("Number of log messages dropped by the rate limits or a full queue."),
+        QString(),
+        []() { return static_cast<double>(logMessagesDropped()); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::GAUGE,
+        QString("process_resident_memory_bytes"),
+        QString("Resident memory size of the process."),
+        QString(),
+        []() { return processMemoryBytes(QByteArray("VmRSS")); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_process_peak_resident_memory_bytes"),
+        QString("Peak resident memory size of the process since startup."),
+        QString(),
+        []() { return processMemoryBytes(QByteArray("VmHWM")); }
     );
 
     configurationFileChanged(configurationFilename);
 
-    currentServerAdministrator->sendGoActive(65535);
+    if (!relayMode) {
+        currentServerAdministrator->sendGoActive(65535);
+    }
 }
 
 
 DbC::~DbC() {
+    // The invalidation bus uses our database manager and its handlers reference classes we are about to destroy.
+    CacheInvalidationBus* cacheInvalidationBus = CacheInvalidationBus::instance();
+    cacheInvalidationBus->stopBus();
+    cacheInvalidationBus->unregisterHandler(QString(CustomerSecrets::invalidationTable));
+    cacheInvalidationBus->unregisterHandler(QString(CustomersCapabilities::invalidationTable));
+    cacheInvalidationBus->unregisterHandler(QString(CustomerMapping::invalidationTable));
+    cacheInvalidationBus->unregisterHandler(QString(Catalog::invalidationTable));
+
+    // Samplers reference classes we are about to destroy.
+    for (QList<QPair<QString, QString>>::const_iterator it=sampledMetrics.constBegin(),end=sampledMetrics.constEnd() ;
+         it!=end                                                                                              ;
+         ++it                                                                                                 ) {
+        MetricsRegistry::instance()->removeSeries(it->first, it->second);
+    }
+
+    // The warm-up thread must stop before the caches it populates are destroyed.
+    delete currentCacheWarmer;
+
+    // Saves the catalog a final time so the next instance can start warm.
+    delete currentWarmStart;
+
+    delete currentQueryPlanChecker;
+
+    // Plot workers must finish before the managers they read from are destroyed.
+    delete currentPlotWorkerPool;
+
     delete timeDeltaHandler;
+    delete currentResponseCompressor;
+    delete currentDashboardCache;
+    delete currentCustomerRateLimiter;
 }
 
 
@@ -294,24 +554,265 @@ void DbC::configurationFileChanged(const QString& /* filePath */) {
             QString websiteAuthority     = jsonObject.value(QString("website_authority")).toString();
             QString websiteEncodedApiKey = jsonObject.value(QString("website_api_key")).toString();
 
+            double websiteMaximumConcurrentRequestsAsDouble = jsonObject.value(
+                "website_maximum_concurrent_requests"
+            ).toDouble(OutboundRestApi::defaultMaximumConcurrentRequests);
+            double websiteReportBatchSizeAsDouble = jsonObject.value("website_report_batch_size").toDouble(0);
+
             QString encodedCustomerSecretsEncryptionKey = jsonObject.value(
                 "customer_secrets_encryption_key"
             ).toString();
 
             QString encodedCustomerIdentifierKey = jsonObject.value("customer_identifier_key").toString();
 
+            double databaseMinimumPoolSizeAsDouble = jsonObject.value("database_minimum_pool_size").toDouble(
+                DatabaseManager::defaultMinimumPoolSize
+            );
+            double databaseMaximumPoolSizeAsDouble = jsonObject.value("database_maximum_pool_size").toDouble(
+                DatabaseManager::defaultMaximumPoolSize
+            );
+            double databaseIdleTimeoutAsDouble = jsonObject.value("database_idle_timeout").toDouble(
+                DatabaseManager::defaultIdleTimeoutSeconds
+            );
+            double databaseHealthCheckIntervalAsDouble = jsonObject.value("database_health_check_interval").toDouble(
+                DatabaseManager::defaultHealthCheckIntervalSeconds
+            );
+            double databaseAcquireTimeoutAsDouble = jsonObject.value("database_acquire_timeout").toDouble(
+                DatabaseManager::defaultMaximumAcquireWaitMilliseconds
+            );
+
+            QJsonArray databaseReadReplicasArray = jsonObject.value("database_read_replicas").toArray();
+            double     databaseMaximumReplicaLagAsDouble = jsonObject.value("database_maximum_replica_lag").toDouble(
+                DatabaseManager::defaultMaximumReplicaLagSeconds
+            );
+
             double customerSecretsCacheSizeAsDouble = jsonObject.value("customer_secrets_cache_size").toDouble(-1);
 
             double customerCapabilitiesCacheSizeAsDouble = jsonObject.value(
                 "customer_capabilities_cache_size"
             ).toDouble(-1);
 
+            double customerNegativeCacheSizeAsDouble = jsonObject.value("customer_negative_cache_size").toDouble(
+                CustomerSecrets::defaultNegativeCacheDepth
+            );
+
+            double customerNegativeCacheTtlAsDouble = jsonObject.value("customer_negative_cache_ttl").toDouble(
+                CustomerSecrets::defaultNegativeTimeToLiveSeconds
+            );
+
+            bool customerCacheWarmUp = jsonObject.value("customer_cache_warm_up").toBool(true);
+
+            QString warmStartFile                 = jsonObject.value("warm_start_file").toString();
+            double  warmStartSaveIntervalAsDouble = jsonObject.value("warm_start_save_interval").toDouble(
+                WarmStart::defaultSaveIntervalSeconds
+            );
+
+            double memorySoftLimitAsDouble = jsonObject.value("memory_soft_limit").toDouble(0);
+            double memoryHardLimitAsDouble = jsonObject.value("memory_hard_limit").toDouble(0);
+
+            bool    cacheInvalidation        = jsonObject.value("cache_invalidation").toBool(true);
+            QString cacheInvalidationChannel = jsonObject.value("cache_invalidation_channel").toString(
+                QString(CacheInvalidationBus::defaultChannel)
+            );
+
+            bool queryPlanCheck = jsonObject.value("query_plan_check").toBool(true);
+
+            double queryPlanCheckMinimumRowsAsDouble = jsonObject.value("query_plan_check_minimum_rows").toDouble(
+                QueryPlanChecker::defaultMinimumTableRows
+            );
+
+            QString customerSecretsCachePolicyString = jsonObject.value("customer_secrets_cache_policy").toString(
+                CacheBase::toString(CacheBase::EvictionPolicy::RANDOM)
+            );
+
+            QString customerCapabilitiesCachePolicyString = jsonObject.value(
+                "customer_capabilities_cache_policy"
+            ).toString(CacheBase::toString(CacheBase::EvictionPolicy::RANDOM));
+
+            double logRateLimitInfoAsDouble = jsonObject.value("log_rate_limit_info").toDouble(
+                LogWriter::defaultRateLimit
+            );
+            double logRateLimitWarningAsDouble = jsonObject.value("log_rate_limit_warning").toDouble(
+                LogWriter::defaultRateLimit
+            );
+            double logRateLimitErrorAsDouble = jsonObject.value("log_rate_limit_error").toDouble(
+                LogWriter::defaultRateLimit
+            );
+
+            double requestTraceSampleRateAsDouble = jsonObject.value("request_trace_sample_rate").toDouble(
+                RequestTracer::defaultSampleRate
+            );
+            double requestTraceSlowThresholdAsDouble = jsonObject.value("request_trace_slow_threshold").toDouble(
+                RequestTracer::defaultSlowThresholdMilliseconds
+            );
+            QString requestTraceLog = jsonObject.value("request_trace_log").toString();
+
+            double slowQueryThresholdAsDouble = jsonObject.value("slow_query_threshold").toDouble(
+                QueryStatistics::defaultSlowThresholdMilliseconds
+            );
+
+            bool databasePipelining = jsonObject.value("database_pipelining").toBool(true);
+
+            QString trafficCaptureFile = jsonObject.value("traffic_capture_file").toString();
+            double  trafficCaptureMaximumSizeAsDouble = jsonObject.value("traffic_capture_maximum_size").toDouble(
+                static_cast<double>(TrafficRecorder::defaultMaximumCaptureSize)
+            );
+
             double aggregationAgeAsDouble = jsonObject.value("aggregation_age").toDouble(-1);
 
             double aggregationSamplePeriodAsDouble = jsonObject.value("aggregation_sample_period").toDouble(-1);
 
+            // Thread counts given in the thread pool configuration take precedence over the per-subsystem settings.
+            QJsonObject threadPoolsObject = jsonObject.value("thread_pools").toObject();
+
+            double aggregationWorkersAsDouble = jsonObject.value("aggregation_workers").toDouble(
+                LatencyAggregator::defaultNumberWorkers
+            );
+            aggregationWorkersAsDouble = threadPoolsObject.value("aggregation").toObject().value("threads").toDouble(
+                aggregationWorkersAsDouble
+            );
+
+            double queryWorkersAsDouble = jsonObject.value("query_workers").toDouble(
+                QueryExecutor::defaultNumberWorkers
+            );
+            queryWorkersAsDouble = threadPoolsObject.value("query").toObject().value("threads").toDouble(
+                queryWorkersAsDouble
+            );
+
+            double recentLatencyRetentionAsDouble = jsonObject.value("recent_latency_retention").toDouble(
+                LatencyRingBuffer::defaultRetention
+            );
+
+            bool   latencyRollingStatistics        = jsonObject.value("latency_rolling_statistics").toBool(true);
+            double latencyDegradationRatioAsDouble = jsonObject.value("latency_degradation_ratio").toDouble(0);
+
+            double latencyResultCacheSizeAsDouble = jsonObject.value("latency_result_cache_size").toDouble(
+                LatencyResultCache::defaultCacheDepth
+            );
+
+            double latencyResultCacheTimeToLiveAsDouble = jsonObject.value(
+                "latency_result_cache_time_to_live"
+            ).toDouble(LatencyResultCache::defaultTimeToLiveMilliseconds / 1000.0);
+
+            double responseCompressionMinimumSizeAsDouble = jsonObject.value(
+                "response_compression_minimum_size"
+            ).toDouble(ResponseCompressor::defaultMinimumSize);
+
+            double responseCompressionLevelAsDouble = jsonObject.value("response_compression_level").toDouble(
+                ResponseCompressor::defaultCompressionLevel
+            );
+
+            double plotWorkersAsDouble = jsonObject.value("plot_workers").toDouble(
+                PlotWorkerPool::defaultNumberWorkers
+            );
+            plotWorkersAsDouble = threadPoolsObject.value("plot").toObject().value("threads").toDouble(
+                plotWorkersAsDouble
+            );
+
+            double plotCacheSizeAsDouble = jsonObject.value("plot_cache_size").toDouble(PlotCache::defaultCacheDepth);
+
+            double plotQueueDepthAsDouble = jsonObject.value("plot_queue_depth").toDouble(
+                PlotWorkerPool::defaultMaximumQueued
+            );
+
+            double dashboardCacheSizeAsDouble = jsonObject.value("dashboard_cache_size").toDouble(
+                DashboardCache::defaultCacheDepth
+            );
+
+            double dashboardEventWindowDaysAsDouble = jsonObject.value("dashboard_event_window_days").toDouble(
+                DashboardCache::defaultEventWindowDays
+            );
+
+            double fastPlotMaximumPixelsAsDouble = jsonObject.value("fast_plot_maximum_pixels").toDouble(
+                PlotterBase::defaultFastRendererMaximumPixels
+            );
+
+            QJsonObject customerRateLimitObject       = jsonObject.value("customer_rate_limit").toObject();
+            double      rateLimitBaseRateAsDouble     = customerRateLimitObject.value("base_rate").toDouble(
+                CustomerRateLimiter::defaultBaseRate
+            );
+            double      rateLimitPerMonitorAsDouble   = customerRateLimitObject.value("rate_per_monitor").toDouble(
+                CustomerRateLimiter::defaultRatePerMonitor
+            );
+            double      rateLimitBurstSecondsAsDouble = customerRateLimitObject.value("burst_seconds").toDouble(
+                CustomerRateLimiter::defaultBurstSeconds
+            );
+
             double expungeAgeAsDouble = jsonObject.value(QString("expunge_age")).toDouble(-1);
 
+            double resourceFlushMaximumEntriesAsDouble = jsonObject.value("resource_flush_maximum_entries").toDouble(
+                Resources::defaultFlushMaximumEntries
+            );
+            double resourceFlushMaximumAgeAsDouble = jsonObject.value("resource_flush_maximum_age").toDouble(
+                Resources::defaultFlushMaximumAge
+            );
+
+            QJsonArray  resourceAggregationTiersArray = jsonObject.value("resource_aggregation_tiers").toArray();
+            QJsonObject resourcePartitionPeriodsObject = jsonObject.value("resource_partition_periods").toObject();
+
+            QJsonArray aggregationTiersArray = jsonObject.value("aggregation_tiers").toArray();
+
+            QJsonObject latencyPartitionPeriodsObject = jsonObject.value("latency_partition_periods").toObject();
+
+            bool   pollingServerDeltaUpdates         = jsonObject.value("polling_server_delta_updates").toBool(false);
+            double serverReportFlushIntervalAsDouble = jsonObject.value("server_report_flush_interval").toDouble(
+                ServerAdministrator::defaultReportFlushIntervalSeconds
+            );
+            double serverHealthDegradationRatioAsDouble = (
+                jsonObject.value("server_health_degradation_ratio").toDouble(0)
+            );
+
+            double latencyPurgeBatchSizeAsDouble = jsonObject.value("latency_purge_batch_size").toDouble(
+                LatencyPurger::defaultBatchSize
+            );
+            double latencyPurgeRowsPerSecondAsDouble = jsonObject.value("latency_purge_rows_per_second").toDouble(
+                LatencyPurger::defaultRowsPerSecond
+            );
+
+            double eventRetentionAgeAsDouble    = jsonObject.value("event_retention_age").toDouble(0);
+            double eventPartitionPeriodAsDouble = jsonObject.value("event_partition_period").toDouble(0);
+            double eventPurgeBatchSizeAsDouble  = jsonObject.value("event_purge_batch_size").toDouble(
+                Events::defaultPurgeBatchSize
+            );
+
+            double latencyDeduplicationCapacityAsDouble = jsonObject.value("latency_deduplication_capacity").toDouble(
+                static_cast<double>(LatencyDeduplicator::defaultCapacity)
+            );
+            double latencyFlushBatchSizeAsDouble = jsonObject.value("latency_flush_batch_size").toDouble(
+                LatencyInterface::defaultFlushBatchSize
+            );
+            double latencyFlushMaximumEntriesAsDouble = jsonObject.value("latency_flush_maximum_entries").toDouble(
+                LatencyInterface::defaultFlushMaximumEntries
+            );
+            double latencyFlushMaximumBytesAsDouble = jsonObject.value("latency_flush_maximum_bytes").toDouble(
+                static_cast<double>(LatencyInterface::defaultFlushMaximumBytes)
+            );
+            double latencyFlushMaximumAgeAsDouble = jsonObject.value("latency_flush_maximum_age").toDouble(
+                LatencyInterface::defaultFlushMaximumAge
+            );
+            QString latencySpoolDirectory = jsonObject.value("latency_spool_directory").toString();
+
+            QString latencyArchiveDirectory      = jsonObject.value("latency_archive_directory").toString();
+            double  latencyArchiveAgeAsDouble    = jsonObject.value("latency_archive_age").toDouble(
+                LatencyArchive::defaultArchiveAge
+            );
+            double  latencyArchiveShardsAsDouble = jsonObject.value("latency_archive_shards").toDouble(
+                LatencyArchive::defaultNumberShards
+            );
+
+            double shardIdAsDouble = jsonObject.value("shard_id").toDouble(ShardMap::invalidShardId);
+
+            bool latencyIngestRollups = jsonObject.value("latency_ingest_rollups").toBool(false);
+            bool latencyBlockStorage  = jsonObject.value("latency_block_storage").toBool(false);
+            double latencyIngestHighWatermarkAsDouble = jsonObject.value("latency_ingest_high_watermark").toDouble(
+                LatencyInterface::defaultIngestHighWatermark
+            );
+            double latencyIngestLowWatermarkAsDouble = jsonObject.value("latency_ingest_low_watermark").toDouble(
+                LatencyInterface::defaultIngestLowWatermark
+            );
+            double      latencyWritersPerRegionAsDouble = jsonObject.value("latency_writers_per_region").toDouble(1);
+            QJsonObject latencyWritersByRegionObject    = jsonObject.value("latency_writers_by_region").toObject();
+
             int     inboundPort                  = jsonObject.value(QString("inbound_port")).toInt(
                 RestApiInV1::Server::defaultPort
             );
@@ -323,6 +824,11 @@ void DbC::configurationFileChanged(const QString& /* filePath */) {
             ).toInt(
                 RestApiInV1::Server::defaultMaximumSimultaneousConnections
             );
+            double      ingestReservedWorkersAsDouble = jsonObject.value("ingest_reserved_workers").toDouble(0);
+            double      workerQueueTimeoutAsDouble    = jsonObject.value("worker_queue_timeout").toDouble(
+                WorkerPools::defaultQueueTimeoutMilliseconds
+            );
+            QJsonObject workerPoolsObject             = jsonObject.value("worker_pools").toObject();
 
             QByteArray::FromBase64Result inboundKey = QByteArray::fromBase64Encoding(
                 encodedInboundApiKey.toUtf8(),
@@ -402,6 +908,67 @@ void DbC::configurationFileChanged(const QString& /* filePath */) {
                 success = false;
             }
 
+            if (success                                                             &&
+                (databaseMinimumPoolSizeAsDouble < 0                                ||
+                 databaseMaximumPoolSizeAsDouble < 1                                ||
+                 databaseMinimumPoolSizeAsDouble > databaseMaximumPoolSizeAsDouble  ||
+                 databaseIdleTimeoutAsDouble <= 0                                   ||
+                 databaseHealthCheckIntervalAsDouble < 0                            ||
+                 databaseAcquireTimeoutAsDouble <= 0                                  )    ) {
+                logWrite(QString("Invalid database connection pool settings."), true);
+                success = false;
+            }
+
+            QStringList databaseReadReplicas;
+            if (success) {
+                for (  QJsonArray::const_iterator it  = databaseReadReplicasArray.constBegin(),
+                                                  end = databaseReadReplicasArray.constEnd()
+                     ; success && it != end
+                     ; ++it
+                    ) {
+                    QString replica = (*it).toString();
+                    if (!replica.isEmpty()) {
+                        databaseReadReplicas.append(replica);
+                    } else {
+                        logWrite(QString("Invalid database read replica."), true);
+                        success = false;
+                    }
+                }
+            }
+
+            if (success && databaseMaximumReplicaLagAsDouble < 0) {
+                logWrite(QString("Invalid database maximum replica lag."), true);
+                success = false;
+            }
+
+            if (success                            &&
+                (logRateLimitInfoAsDouble < 0    ||
+                 logRateLimitWarningAsDouble < 0 ||
+                 logRateLimitErrorAsDouble < 0      )    ) {
+                logWrite(QString("Invalid log rate limit."), true);
+                success = false;
+            }
+
+            if (success && (requestTraceSampleRateAsDouble < 0 || requestTraceSampleRateAsDouble > 1)) {
+                logWrite(QString("Invalid request trace sample rate."), true);
+                success = false;
+            }
+
+            if (success && (requestTraceSlowThresholdAsDouble < 0 || requestTraceSlowThresholdAsDouble > 0xFFFFFFFF)) {
+                logWrite(QString("Invalid request trace slow threshold."), true);
+                success = false;
+            }
+
+            if (success && (slowQueryThresholdAsDouble < 0 || slowQueryThresholdAsDouble > 0xFFFFFFFF)) {
+                logWrite(QString("Invalid slow query threshold."), true);
+                success = false;
+            }
+
+            if (success && trafficCaptureMaximumSizeAsDouble < 0) {
+                logWrite(QString("Invalid traffic capture maximum size."), true);
+                success = false;
+            }
+
             if (success && aggregationAgeAsDouble <= 0) {
                 logWrite(QString("Aggregation age value is invalid."), true);
                 success = false;
@@ -411,48 +978,512 @@ void DbC::configurationFileChanged(const QString& /* filePath */) {
                 logWrite(QString("Aggregation sample period is invalid."), true);
             }
 
-            if (success && expungeAgeAsDouble <= 0) {
-                logWrite(QString("Expunge age is invalid."), true);
+            if (success && (aggregationWorkersAsDouble < 1 || aggregationWorkersAsDouble > 64)) {
+                logWrite(QString("Aggregation workers value is invalid."), true);
+                success = false;
             }
 
-            if (success && (inboundPort < 0 || inboundPort > 0xFFFF)) {
-                logWrite(QString("Inbound port address is invalid."), true);
+            if (success && (queryWorkersAsDouble < 0 || queryWorkersAsDouble > 64)) {
+                logWrite(QString("Query workers is invalid."), true);
                 success = false;
             }
 
-            if (success && maximumConcurrentConnections <= 0) {
-                logWrite(QString("Invalid maximum number of concurrent connections."), true);
+            if (success && recentLatencyRetentionAsDouble < 0) {
+                logWrite(QString("Recent latency retention is invalid."), true);
                 success = false;
             }
 
-            QByteArray customerSecretsEncryptionKey;
-            if (!encodedCustomerSecretsEncryptionKey.isEmpty()) {
-                QByteArray::FromBase64Result customerSecretsEncryptionKeyResult = QByteArray::fromBase64Encoding(
-                    encodedCustomerSecretsEncryptionKey.toUtf8(),
-                    QByteArray::Base64Option::Base64Encoding
-                );
+            if (success && latencyDegradationRatioAsDouble != 0 && latencyDegradationRatioAsDouble <= 1) {
+                logWrite(QString("Latency degradation ratio is invalid."), true);
+                success = false;
+            }
 
-                if (customerSecretsEncryptionKeyResult) {
-                    customerSecretsEncryptionKey = *customerSecretsEncryptionKeyResult;
-                    unsigned encryptionKeyLength = static_cast<unsigned>(customerSecretsEncryptionKey.size());
-                    if (encryptionKeyLength != Crypto::AesCbcEncryptor::keyLength) {
-                        logWrite(QString("Invalid customer secrets encryption key length."), true);
-                        success = false;
-                    }
-                } else {
-                    logWrite(QString("Customer secrets encryption key should be base-64 encoded."), true);
-                    success = false;
-                }
+            if (success && (latencyResultCacheSizeAsDouble < 1 || latencyResultCacheSizeAsDouble > 65536)) {
+                logWrite(QString("Latency result cache size is invalid."), true);
+                success = false;
+            }
 
-                Crypto::scrub(*customerSecretsEncryptionKeyResult);
-            } else {
-                logWrite(QString("Missing or empty \"customer_secrets_encryption_key\" value."), true);
+            if (success && (latencyResultCacheTimeToLiveAsDouble < 0 || latencyResultCacheTimeToLiveAsDouble > 3600)) {
+                logWrite(QString("Latency result cache time to live is invalid."), true);
                 success = false;
             }
 
-            Crypto::scrub(encodedCustomerSecretsEncryptionKey);
+            if (success                                              &&
+                (responseCompressionMinimumSizeAsDouble < 0          ||
+                 responseCompressionMinimumSizeAsDouble > 0x7FFFFFFF    )) {
+                logWrite(QString("Response compression minimum size is invalid."), true);
+                success = false;
+            }
 
-            QByteArray customerIdentifierKey;
+            if (success && (responseCompressionLevelAsDouble < 1 || responseCompressionLevelAsDouble > 9)) {
+                logWrite(QString("Response compression level is invalid."), true);
+                success = false;
+            }
+
+            if (success && (plotWorkersAsDouble < 1 || plotWorkersAsDouble > 64)) {
+                logWrite(QString("Plot workers is invalid."), true);
+                success = false;
+            }
+
+            if (success && (plotQueueDepthAsDouble < 0 || plotQueueDepthAsDouble > 65535)) {
+                logWrite(QString("Plot queue depth is invalid."), true);
+                success = false;
+            }
+
+            if (success && plotCacheSizeAsDouble < 0) {
+                logWrite(QString("Plot cache size is invalid."), true);
+                success = false;
+            }
+
+            if (success && dashboardCacheSizeAsDouble < 0) {
+                logWrite(QString("Dashboard cache size is invalid."), true);
+                success = false;
+            }
+
+            if (success && (dashboardEventWindowDaysAsDouble < 0 || dashboardEventWindowDaysAsDouble > 36500)) {
+                logWrite(QString("Dashboard event window is invalid."), true);
+                success = false;
+            }
+
+            if (success && (rateLimitBaseRateAsDouble < 0 || rateLimitPerMonitorAsDouble < 0)) {
+                logWrite(QString("Customer rate limit is invalid."), true);
+                success = false;
+            }
+
+            if (success && (rateLimitBurstSecondsAsDouble < 1 || rateLimitBurstSecondsAsDouble > 86400)) {
+                logWrite(QString("Customer rate limit burst is invalid."), true);
+                success = false;
+            }
+
+            if (success && (fastPlotMaximumPixelsAsDouble < 0 || fastPlotMaximumPixelsAsDouble > 16777216)) {
+                logWrite(QString("Fast plot maximum pixels is invalid."), true);
+                success = false;
+            }
+
+            if (success && expungeAgeAsDouble <= 0) {
+                logWrite(QString("Expunge age is invalid."), true);
+            }
+
+            if (success && (resourceFlushMaximumEntriesAsDouble < 1                              ||
+                            resourceFlushMaximumEntriesAsDouble > Resources::maximumQueueDepth ||
+                            resourceFlushMaximumAgeAsDouble < 1                                     )) {
+                logWrite(QString("Resource flush thresholds are invalid."), true);
+                success = false;
+            }
+
+            LatencyInterfaceManager::AggregationTierList aggregationTiers;
+            if (success) {
+                QRegularExpression tableNameExpression("^[a-z_][a-z0-9_]*$");
+                double             inputSamplePeriod = aggregationSamplePeriodAsDouble;
+
+                unsigned numberTiers = static_cast<unsigned>(aggregationTiersArray.size());
+                unsigned tierIndex   = 0;
+                while (success && tierIndex < numberTiers) {
+                    QJsonObject tierObject               = aggregationTiersArray.at(tierIndex).toObject();
+                    QString     tableName                = tierObject.value("table").toString();
+                    double      tierSamplePeriodAsDouble = tierObject.value("sample_period").toDouble(-1);
+                    double      tierExpungeAgeAsDouble   = tierObject.value("expunge_age").toDouble(-1);
+
+                    if (!tableNameExpression.match(tableName).hasMatch()             ||
+                        tableName == QString("latency_seconds")                     ||
+                        tableName == QString("latency_blocks")                      ||
+                        tableName == QString("latency_aggregated")                  ||
+                        tierSamplePeriodAsDouble <= inputSamplePeriod               ||
+                        std::fmod(tierSamplePeriodAsDouble, inputSamplePeriod) != 0 ||
+                        tierExpungeAgeAsDouble <= 0                                    ) {
+                        logWrite(QString("Aggregation tier %1 is invalid.").arg(tierIndex), true);
+                        success = false;
+                    } else {
+                        LatencyInterfaceManager::AggregationTier tier;
+                        tier.tableName      = tableName;
+                        tier.resamplePeriod = static_cast<unsigned long>(tierSamplePeriodAsDouble);
+                        tier.expungeAge     = static_cast<unsigned long>(tierExpungeAgeAsDouble);
+                        aggregationTiers.append(tier);
+
+                        inputSamplePeriod = tierSamplePeriodAsDouble;
+                        ++tierIndex;
+                    }
+                }
+            }
+
+            LatencyInterfaceManager::PartitionPeriods latencyPartitionPeriods;
+            if (success) {
+                QRegularExpression tableNameExpression("^[a-z_][a-z0-9_]*$");
+                for (  QJsonObject::const_iterator it  = latencyPartitionPeriodsObject.constBegin(),
+                                                   end = latencyPartitionPeriodsObject.constEnd()
+                     ; success && it != end
+                     ; ++it
+                    ) {
+                    double partitionPeriod = it.value().toDouble(-1);
+                    if (tableNameExpression.match(it.key()).hasMatch() && partitionPeriod >= 3600) {
+                        latencyPartitionPeriods.insert(it.key(), static_cast<unsigned long>(partitionPeriod));
+                    } else {
+                        logWrite(QString("Latency partition period for table \"%1\" is invalid.").arg(it.key()), true);
+                        success = false;
+                    }
+                }
+            }
+
+            Resources::AggregationTierList resourceAggregationTiers;
+            if (success) {
+                QRegularExpression tableNameExpression("^[a-z_][a-z0-9_]*$");
+                double             inputSamplePeriod = 0;
+
+                unsigned numberTiers = static_cast<unsigned>(resourceAggregationTiersArray.size());
+                unsigned tierIndex   = 0;
+                while (success && tierIndex < numberTiers) {
+                    QJsonObject tierObject               = resourceAggregationTiersArray.at(tierIndex).toObject();
+                    QString     tableName                = tierObject.value("table").toString();
+                    double      tierSamplePeriodAsDouble = tierObject.value("sample_period").toDouble(-1);
+                    double      tierExpungeAgeAsDouble   = tierObject.value("expunge_age").toDouble(-1);
+
+                    bool multipleOfInput = (
+                           inputSamplePeriod == 0
+                        || std::fmod(tierSamplePeriodAsDouble, inputSamplePeriod) == 0
+                    );
+
+                    if (!tableNameExpression.match(tableName).hasMatch()         ||
+                        tableName == QString("resources")                       ||
+                        tableName == QString("resources_aggregation_watermark") ||
+                        tierSamplePeriodAsDouble < 60                           ||
+                        tierSamplePeriodAsDouble <= inputSamplePeriod           ||
+                        !multipleOfInput                                        ||
+                        tierExpungeAgeAsDouble <= 0                                ) {
+                        logWrite(QString("Resource aggregation tier %1 is invalid.").arg(tierIndex), true);
+                        success = false;
+                    } else {
+                        Resources::AggregationTier tier;
+                        tier.tableName      = tableName;
+                        tier.resamplePeriod = static_cast<unsigned long>(tierSamplePeriodAsDouble);
+                        tier.expungeAge     = static_cast<unsigned long>(tierExpungeAgeAsDouble);
+                        resourceAggregationTiers.append(tier);
+
+                        inputSamplePeriod = tierSamplePeriodAsDouble;
+                        ++tierIndex;
+                    }
+                }
+            }
+
+            Resources::PartitionPeriods resourcePartitionPeriods;
+            if (success) {
+                QRegularExpression tableNameExpression("^[a-z_][a-z0-9_]*$");
+                for (  QJsonObject::const_iterator it  = resourcePartitionPeriodsObject.constBegin(),
+                                                   end = resourcePartitionPeriodsObject.constEnd()
+                     ; success && it != end
+                     ; ++it
+                    ) {
+                    double partitionPeriod = it.value().toDouble(-1);
+                    if (tableNameExpression.match(it.key()).hasMatch() &&
+                        partitionPeriod >= 3600                         &&
+                        std::fmod(partitionPeriod, 3600) == 0              ) {
+                        resourcePartitionPeriods.insert(it.key(), static_cast<unsigned long>(partitionPeriod));
+                    } else {
+                        logWrite(
+                            QString("Resource partition period for table \"%1\" is invalid.").arg(it.key()),
+                            true
+                        );
+                        success = false;
+                    }
+                }
+            }
+
+            if (success && (serverReportFlushIntervalAsDouble < 1 || serverReportFlushIntervalAsDouble > 3600)) {
+                logWrite(QString("Server report flush interval is invalid."), true);
+                success = false;
+            }
+
+            if (success && serverHealthDegradationRatioAsDouble != 0 && serverHealthDegradationRatioAsDouble <= 1) {
+                logWrite(QString("Server health degradation ratio is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyPurgeBatchSizeAsDouble < 1) {
+                logWrite(QString("Latency purge batch size is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyPurgeRowsPerSecondAsDouble < 1) {
+                logWrite(QString("Latency purge rows per second is invalid."), true);
+                success = false;
+            }
+
+            if (success && (eventRetentionAgeAsDouble < 0 || eventRetentionAgeAsDouble > 0xFFFFFFFF)) {
+                logWrite(QString("Event retention age is invalid."), true);
+                success = false;
+            }
+
+            if (success && eventPartitionPeriodAsDouble != 0 && (
+                    eventPartitionPeriodAsDouble < 3600                ||
+                    eventPartitionPeriodAsDouble > 0xFFFFFFFF          ||
+                    std::fmod(eventPartitionPeriodAsDouble, 3600) != 0
+               )) {
+                logWrite(QString("Event partition period is invalid."), true);
+                success = false;
+            }
+
+            if (success && eventPurgeBatchSizeAsDouble < 1) {
+                logWrite(QString("Event purge batch size is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyDeduplicationCapacityAsDouble < 0) {
+                logWrite(QString("Latency de-duplication capacity is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyFlushBatchSizeAsDouble < 1) {
+                logWrite(QString("Latency flush batch size is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyFlushMaximumEntriesAsDouble < 1) {
+                logWrite(QString("Latency flush maximum entries is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyFlushMaximumBytesAsDouble < 1) {
+                logWrite(QString("Latency flush maximum bytes is invalid."), true);
+                success = false;
+            }
+
+            if (success && latencyFlushMaximumAgeAsDouble < 1) {
+                logWrite(QString("Latency flush maximum age is invalid."), true);
+                success = false;
+            }
+
+            if (success && (latencyIngestHighWatermarkAsDouble < 1                                ||
+                            latencyIngestLowWatermarkAsDouble < 0                                 ||
+                            latencyIngestLowWatermarkAsDouble > latencyIngestHighWatermarkAsDouble   )) {
+                logWrite(QString("Latency ingest watermarks are invalid."), true);
+                success = false;
+            }
+
+            if (success && (latencyWritersPerRegionAsDouble < 1 || latencyWritersPerRegionAsDouble > 64)) {
+                logWrite(QString("Latency writers per region is invalid."), true);
+                success = false;
+            }
+
+            if (success && (latencyArchiveAgeAsDouble < LatencyArchive::segmentPeriod ||
+                            latencyArchiveShardsAsDouble < 1                          ||
+                            latencyArchiveShardsAsDouble > 256                           )) {
+                logWrite(QString("Latency archive settings are invalid."), true);
+                success = false;
+            }
+
+            if (success && (warmStartSaveIntervalAsDouble < 0 || warmStartSaveIntervalAsDouble > 86400)) {
+                logWrite(QString("Warm start save interval is invalid."), true);
+                success = false;
+            }
+
+            if (success && (memorySoftLimitAsDouble < 0                                                   ||
+                            memoryHardLimitAsDouble < 0                                                   ||
+                            (memoryHardLimitAsDouble > 0 && memoryHardLimitAsDouble < memorySoftLimitAsDouble))) {
+                logWrite(QString("Memory limits are invalid."), true);
+                success = false;
+            }
+
+            if (success && (cacheInvalidationChannel.isEmpty() || cacheInvalidationChannel.toUtf8().size() > 63)) {
+                logWrite(QString("Cache invalidation channel is invalid."), true);
+                success = false;
+            }
+
+            if (success && (shardIdAsDouble < 0 || shardIdAsDouble > 0xFFFF)) {
+                logWrite(QString("Shard ID is invalid."), true);
+                success = false;
+            }
+
+            LatencyInterfaceManager::NumberWritersByRegion latencyWritersByRegion;
+            for (  QJsonObject::const_iterator it  = latencyWritersByRegionObject.constBegin(),
+                                               end = latencyWritersByRegionObject.constEnd()
+                 ; success && it != end
+                 ; ++it
+                ) {
+                bool     ok;
+                unsigned regionId      = it.key().toUInt(&ok);
+                double   numberWriters = it.value().toDouble(0);
+
+                if (ok && regionId <= 0xFFFF && numberWriters >= 1 && numberWriters <= 64) {
+                    latencyWritersByRegion.insert(
+                        static_cast<LatencyInterfaceManager::RegionId>(regionId),
+                        static_cast<unsigned>(numberWriters)
+                    );
+                } else {
+                    logWrite(QString("Latency writers for region \"%1\" is invalid.").arg(it.key()), true);
+                    success = false;
+                }
+            }
+
+            if (success && (inboundPort < 0 || inboundPort > 0xFFFF)) {
+                logWrite(QString("Inbound port address is invalid."), true);
+                success = false;
+            }
+
+            if (success && maximumConcurrentConnections <= 0) {
+                logWrite(QString("Invalid maximum number of concurrent connections."), true);
+                success = false;
+            }
+
+            if (success && (ingestReservedWorkersAsDouble < 0                            ||
+                            ingestReservedWorkersAsDouble >= maximumConcurrentConnections ||
+                            workerQueueTimeoutAsDouble < 0                               ||
+                            workerQueueTimeoutAsDouble > 60000                              )) {
+                logWrite(QString("Worker reservation settings are invalid."), true);
+                success = false;
+            }
+
+            unsigned poolMaximumWorkers[WorkerPools::numberPools];
+            unsigned poolMaximumQueued[WorkerPools::numberPools];
+            for (unsigned poolIndex=0 ; poolIndex<WorkerPools::numberPools ; ++poolIndex) {
+                WorkerPools::Pool pool       = static_cast<WorkerPools::Pool>(poolIndex);
+                QJsonObject       poolObject = workerPoolsObject.value(WorkerPools::toString(pool)).toObject();
+                double            workers    = poolObject.value("workers").toDouble(0);
+                double            queued     = poolObject.value("queue").toDouble(WorkerPools::defaultMaximumQueued);
+
+                if (success && (workers < 0 || workers > 65535 || queued < 0 || queued > 65535)) {
+                    logWrite(QString("Worker pool %1 settings are invalid.").arg(WorkerPools::toString(pool)), true);
+                    success = false;
+                }
+
+                poolMaximumWorkers[poolIndex] = static_cast<unsigned>(workers);
+                poolMaximumQueued[poolIndex]  = static_cast<unsigned>(queued);
+            }
+
+            double      jobWorkersAsDouble   = jsonObject.value("job_workers").toDouble(
+                JobScheduler::defaultNumberWorkers
+            );
+            QJsonObject jobConcurrencyObject = jsonObject.value("job_concurrency").toObject();
+
+            jobWorkersAsDouble = threadPoolsObject.value("job").toObject().value("threads").toDouble(
+                jobWorkersAsDouble
+            );
+
+            if (success && (jobWorkersAsDouble < 1 || jobWorkersAsDouble > JobScheduler::maximumNumberWorkers)) {
+                logWrite(QString("Job workers is invalid."), true);
+                success = false;
+            }
+
+            ThreadPlacement::Placement threadPlacements[ThreadPlacement::numberSubsystems];
+            for (  QJsonObject::const_iterator it  = threadPoolsObject.constBegin(),
+                                               end = threadPoolsObject.constEnd()
+                 ; success && it != end
+                 ; ++it
+                ) {
+                bool                       knownSubsystem;
+                ThreadPlacement::Subsystem subsystem = ThreadPlacement::toSubsystem(it.key(), &knownSubsystem);
+                QJsonObject                poolObject = it.value().toObject();
+                if (knownSubsystem && it.value().isObject()) {
+                    ThreadPlacement::Placement& placement = threadPlacements[static_cast<unsigned>(subsystem)];
+                    if (poolObject.contains("cpus")) {
+                        placement.cpus = ThreadPlacement::toCpuList(poolObject.value("cpus").toString(), &success);
+                        if (!success) {
+                            logWrite(QString("Thread pool \"%1\" CPU list is invalid.").arg(it.key()), true);
+                        }
+                    }
+
+                    if (success && poolObject.contains("nice")) {
+                        double niceAsDouble = poolObject.value("nice").toDouble(-100);
+                        if (niceAsDouble >= -20 && niceAsDouble <= 19 && std::floor(niceAsDouble) == niceAsDouble) {
+                            placement.adjustNice = true;
+                            placement.nice       = static_cast<int>(niceAsDouble);
+                        } else {
+                            logWrite(QString("Thread pool \"%1\" nice value is invalid.").arg(it.key()), true);
+                            success = false;
+                        }
+                    }
+
+                    // Latency interfaces and resources run a fixed set of threads.
+                    bool fixedThreads = (
+                           subsystem == ThreadPlacement::Subsystem::LATENCY_INTERFACE
+                        || subsystem == ThreadPlacement::Subsystem::RESOURCES
+                    );
+
+                    if (success && fixedThreads && poolObject.contains("threads")) {
+                        logWrite(QString("Thread pool \"%1\" thread count is not supported.").arg(it.key()), true);
+                        success = false;
+                    }
+                } else {
+                    logWrite(QString("Unknown thread pool \"%1\".").arg(it.key()), true);
+                    success = false;
+                }
+            }
+
+            for (  QJsonObject::const_iterator it  = jobConcurrencyObject.constBegin(),
+                                               end = jobConcurrencyObject.constEnd()
+                 ; success && it != end
+                 ; ++it
+                ) {
+                double maximumConcurrent = it.value().toDouble(-1);
+                if (maximumConcurrent < 1 || maximumConcurrent > JobScheduler::maximumNumberWorkers) {
+                    logWrite(QString("Job concurrency for %1 is invalid.").arg(it.key()), true);
+                    success = false;
+                }
+            }
+
+            QJsonObject                           scheduleObject = jsonObject.value("schedule").toObject();
+            PeriodicScheduler::TaskConfigurations taskConfigurations;
+            for (  QJsonObject::const_iterator it  = scheduleObject.constBegin(),
+                                               end = scheduleObject.constEnd()
+                 ; success && it != end
+                 ; ++it
+                ) {
+                QJsonObject taskObject     = it.value().toObject();
+                double      periodAsDouble = taskObject.value("period").toDouble(PeriodicScheduler::useDefault);
+                double      jitterAsDouble = taskObject.value("jitter").toDouble(PeriodicScheduler::useDefault);
+                QJsonValue  groupValue     = taskObject.value("group");
+
+                if (!it.value().isObject()                                                      ||
+                    (periodAsDouble < 0 && periodAsDouble != PeriodicScheduler::useDefault)     ||
+                    (jitterAsDouble < 0 && jitterAsDouble != PeriodicScheduler::useDefault)     ||
+                    (!groupValue.isUndefined() && !groupValue.isString())                          ) {
+                    logWrite(QString("Schedule for task %1 is invalid.").arg(it.key()), true);
+                    success = false;
+                } else {
+                    // An empty group removes the task from its default group so it must stay distinct from a null
+                    // string.
+                    QString group;
+                    if (groupValue.isString()) {
+                        group = groupValue.toString().isEmpty() ? QString("") : groupValue.toString();
+                    }
+
+                    taskConfigurations.insert(
+                        it.key(),
+                        PeriodicScheduler::TaskConfiguration(
+                            static_cast<long>(periodAsDouble),
+                            static_cast<long>(jitterAsDouble),
+                            group
+                        )
+                    );
+                }
+            }
+
+            QByteArray customerSecretsEncryptionKey;
+            if (!encodedCustomerSecretsEncryptionKey.isEmpty()) {
+                QByteArray::FromBase64Result customerSecretsEncryptionKeyResult = QByteArray::fromBase64Encoding(
+                    encodedCustomerSecretsEncryptionKey.toUtf8(),
+                    QByteArray::Base64Option::Base64Encoding
+                );
+
+                if (customerSecretsEncryptionKeyResult) {
+                    customerSecretsEncryptionKey = *customerSecretsEncryptionKeyResult;
+                    unsigned encryptionKeyLength = static_cast<unsigned>(customerSecretsEncryptionKey.size());
+                    if (encryptionKeyLength != Crypto::AesCbcEncryptor::keyLength) {
+                        logWrite(QString("Invalid customer secrets encryption key length."), true);
+                        success = false;
+                    }
+                } else {
+                    logWrite(QString("Customer secrets encryption key should be base-64 encoded."), true);
+                    success = false;
+                }
+
+                Crypto::scrub(*customerSecretsEncryptionKeyResult);
+            } else {
+                logWrite(QString("Missing or empty \"customer_secrets_encryption_key\" value."), true);
+                success = false;
+            }
+
+            Crypto::scrub(encodedCustomerSecretsEncryptionKey);
+
+            QByteArray customerIdentifierKey;
             if (!encodedCustomerIdentifierKey.isEmpty()) {
                 QByteArray::FromBase64Result customerIdentifierKeyResult = QByteArray::fromBase64Encoding(
                     encodedCustomerIdentifierKey.toUtf8(),
@@ -499,59 +1530,597 @@ void DbC::configurationFileChanged(const QString& /* filePath */) {
                 }
             }
 
+            unsigned long customerNegativeCacheSize = 0;
             if (success) {
-                databaseManager->setDatabaseConnectionSettings(
-                    databaseUsername,
-                    databasePassword,
-                    databaseName,
-                    databaseServer
-                );
+                if (customerNegativeCacheSizeAsDouble >= 0) {
+                    customerNegativeCacheSize = static_cast<unsigned long>(customerNegativeCacheSizeAsDouble);
+                } else {
+                    logWrite(QString("Invalid customer negative cache size."), true);
+                    success = false;
+                }
+            }
 
-                QHostAddress inboundHostAddress(inboundHostAddressStr);
-                success = inboundRestServer->reconfigure(inboundHostAddress, inboundPort);
-                if (success) {
-                    inboundRestServer->setMaximumSimultaneousConnections(maximumConcurrentConnections);
+            unsigned long customerNegativeCacheTtl = 0;
+            if (success) {
+                if (customerNegativeCacheTtlAsDouble >= 0) {
+                    customerNegativeCacheTtl = static_cast<unsigned long>(customerNegativeCacheTtlAsDouble);
                 } else {
-                    logWrite(QString("Invalid inbound server configuration."), true);
+                    logWrite(QString("Invalid customer negative cache TTL."), true);
                     success = false;
                 }
             }
 
+            unsigned long queryPlanCheckMinimumRows = QueryPlanChecker::defaultMinimumTableRows;
             if (success) {
-                websiteRestApi->setDefaultSecret(websiteApiKey);
-                websiteRestApi->setSchemeAndHost(websiteAuthority);
-
-                outboundRestApiFactory->setDefaultSecret(pollingServerApiKey);
-                outboundRestApiFactory->setScheme(pollingServerScheme);
-                outboundRestApiFactory->setPort(pollingServerPort);
-
-                currentRegionManager->setSecret(inboundApiKey);
-                currentServerManager->setSecret(inboundApiKey);
-                currentHostSchemeManager->setSecret(inboundApiKey);
-                currentMonitorManager->setSecret(inboundApiKey);
-                currentCustomerCapabilitiesManager->setSecret(inboundApiKey);
-                currentEventManager->setSecret(inboundApiKey);
-                currentCustomerMappingManager->setSecret(inboundApiKey);
-                currentLatencyManager->setSecret(inboundApiKey);
-                currentMultipleManager->setSecret(inboundApiKey);
-                currentResourceManager->setSecret(inboundApiKey);
-
-                currentCustomerSecrets->setEncryptionKeys(customerSecretsEncryptionKey);
-                currentCustomerSecrets->setCustomerIdentifierKey(customerIdentifierKey);
-                currentCustomerSecrets->resizeCache(customerSecretsCacheSize);
-                currentCustomersCapabilities->resizeCache(customerCapabilitiesCacheSize);
+                if (queryPlanCheckMinimumRowsAsDouble >= 0) {
+                    queryPlanCheckMinimumRows = static_cast<unsigned long>(queryPlanCheckMinimumRowsAsDouble);
+                } else {
+                    logWrite(QString("Invalid query plan check minimum rows."), true);
+                    success = false;
+                }
+            }
+
+            CacheBase::EvictionPolicy customerSecretsCachePolicy = CacheBase::EvictionPolicy::RANDOM;
+            if (success) {
+                customerSecretsCachePolicy = CacheBase::toEvictionPolicy(customerSecretsCachePolicyString, &success);
+                if (!success) {
+                    logWrite(
+                        QString("Invalid customer secrets cache policy \"%1\".").arg(customerSecretsCachePolicyString),
+                        true
+                    );
+                }
+            }
+
+            CacheBase::EvictionPolicy customerCapabilitiesCachePolicy = CacheBase::EvictionPolicy::RANDOM;
+            if (success) {
+                customerCapabilitiesCachePolicy = CacheBase::toEvictionPolicy(
+                    customerCapabilitiesCachePolicyString,
+                    &success
+                );
+
+                if (!success) {
+                    logWrite(
+                        QString("Invalid customer capabilities cache policy \"%1\".")
+                        .arg(customerCapabilitiesCachePolicyString),
+                        true
+                    );
+                }
+            }
+
+            if (success && configurationApplied) {
+                QStringList pendingRestartSettings;
+                for (  QStringList::const_iterator it  = restartRequiredSettings.constBegin(),
+                                                   end = restartRequiredSettings.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    if (jsonObject.value(*it) != appliedConfiguration.value(*it)) {
+                        pendingRestartSettings.append(*it);
+                    }
+                }
+
+                if (!pendingRestartSettings.isEmpty()) {
+                    logWrite(
+                        QString("Configuration changes require a restart and were not applied: %1")
+                        .arg(pendingRestartSettings.join(QString(", "))),
+                        false
+                    );
+                }
+            }
+
+            // Only subsystems whose settings changed are touched so a reload never drops caches or connections
+            // unnecessarily.  Settings that are not safe to change live are applied only on the first load.
+            if (success) {
+                bool logRateLimitsChanged = settingsChanged(
+                    jsonObject,
+                    { "log_rate_limit_info", "log_rate_limit_warning", "log_rate_limit_error" }
+                );
+                if (logRateLimitsChanged) {
+                    logSetRateLimit(LogSeverity::INFO, static_cast<unsigned>(logRateLimitInfoAsDouble));
+                    logSetRateLimit(LogSeverity::WARNING, static_cast<unsigned>(logRateLimitWarningAsDouble));
+                    logSetRateLimit(LogSeverity::ERROR, static_cast<unsigned>(logRateLimitErrorAsDouble));
+                }
+
+                RequestTracer* requestTracer = RequestTracer::instance();
+                if (settingsChanged(jsonObject, { "request_trace_sample_rate", "request_trace_slow_threshold" })) {
+                    requestTracer->setSampleRate(requestTraceSampleRateAsDouble);
+                    requestTracer->setSlowThreshold(static_cast<unsigned>(requestTraceSlowThresholdAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "request_trace_log" })) {
+                    if (!requestTracer->setSlowRequestLog(requestTraceLog)) {
+                        logWrite(QString("Could not open slow request log %1").arg(requestTraceLog), true);
+                    }
+                }
+
+                if (settingsChanged(jsonObject, { "slow_query_threshold" })) {
+                    QueryStatistics::instance()->setSlowThreshold(static_cast<unsigned>(slowQueryThresholdAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "database_pipelining" })) {
+                    StatementPipeline::setEnabled(databasePipelining);
+                    if (databasePipelining && !StatementPipeline::isSupported()) {
+                        logWrite(QString("Database pipelining requires libpq 14 or later, using sequential writes."));
+                    }
+                }
+
+                if (settingsChanged(jsonObject, { "traffic_capture_file", "traffic_capture_maximum_size" })) {
+                    bool captureStarted = TrafficRecorder::instance()->setCaptureFile(
+                        trafficCaptureFile,
+                        static_cast<unsigned long long>(trafficCaptureMaximumSizeAsDouble)
+                    );
+                    if (!captureStarted) {
+                        logWrite(QString("Could not open traffic capture file %1").arg(trafficCaptureFile), true);
+                    }
+                }
+
+                if (!configurationApplied) {
+                    databaseManager->setDatabaseConnectionSettings(
+                        databaseUsername,
+                        databasePassword,
+                        databaseName,
+                        databaseServer
+                    );
+                }
+
+                bool poolChanged = settingsChanged(
+                    jsonObject,
+                    {
+                        "database_minimum_pool_size",
+                        "database_maximum_pool_size",
+                        "database_idle_timeout",
+                        "database_health_check_interval",
+                        "database_acquire_timeout"
+                    }
+                );
+                if (poolChanged) {
+                    databaseManager->setPoolParameters(
+                        static_cast<unsigned>(databaseMinimumPoolSizeAsDouble),
+                        static_cast<unsigned>(databaseMaximumPoolSizeAsDouble),
+                        static_cast<unsigned>(databaseIdleTimeoutAsDouble),
+                        static_cast<unsigned>(databaseHealthCheckIntervalAsDouble),
+                        static_cast<unsigned>(databaseAcquireTimeoutAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "database_read_replicas", "database_maximum_replica_lag" })) {
+                    databaseManager->setReadReplicas(
+                        databaseReadReplicas,
+                        static_cast<unsigned>(databaseMaximumReplicaLagAsDouble)
+                    );
+                }
+
+                if (!configurationApplied) {
+                    QHostAddress inboundHostAddress(inboundHostAddressStr);
+                    success = inboundRestServer->reconfigure(inboundHostAddress, inboundPort);
+                    if (!success) {
+                        logWrite(QString("Invalid inbound server configuration."), true);
+                    }
+                }
+
+                bool workersChanged = settingsChanged(
+                    jsonObject,
+                    {
+                        "maximum_concurrent_connections",
+                        "ingest_reserved_workers",
+                        "worker_queue_timeout",
+                        "worker_pools"
+                    }
+                );
+                if (success && workersChanged) {
+                    inboundRestServer->setMaximumSimultaneousConnections(maximumConcurrentConnections);
+
+                    WorkerPools* workerPools = WorkerPools::instance();
+                    workerPools->setWorkers(
+                        static_cast<unsigned>(maximumConcurrentConnections),
+                        static_cast<unsigned>(ingestReservedWorkersAsDouble)
+                    );
+                    workerPools->setQueueTimeout(static_cast<unsigned>(workerQueueTimeoutAsDouble));
+                    for (unsigned poolIndex=0 ; poolIndex<WorkerPools::numberPools ; ++poolIndex) {
+                        workerPools->setPoolLimits(
+                            static_cast<WorkerPools::Pool>(poolIndex),
+                            poolMaximumWorkers[poolIndex],
+                            poolMaximumQueued[poolIndex]
+                        );
+                    }
+                }
+            }
+
+            if (success) {
+                bool websiteChanged = settingsChanged(
+                    jsonObject,
+                    {
+                        "website_api_key",
+                        "website_authority",
+                        "website_maximum_concurrent_requests",
+                        "website_report_batch_size"
+                    }
+                );
+                if (websiteChanged) {
+                    websiteRestApi->setDefaultSecret(websiteApiKey);
+                    websiteRestApi->setSchemeAndHost(websiteAuthority);
+                    websiteRestApi->setMaximumConcurrentRequests(
+                        static_cast<unsigned>(websiteMaximumConcurrentRequestsAsDouble)
+                    );
+                    websiteRestApi->setBatching(
+                        QString("/event/report"),
+                        QString("/event/report/batch"),
+                        static_cast<unsigned>(websiteReportBatchSizeAsDouble)
+                    );
+                }
+
+                bool pollingServerChanged = settingsChanged(
+                    jsonObject,
+                    { "polling_server_api_key", "polling_server_scheme", "polling_server_port" }
+                );
+                if (pollingServerChanged) {
+                    outboundRestApiFactory->setDefaultSecret(pollingServerApiKey);
+                    outboundRestApiFactory->setScheme(pollingServerScheme);
+                    outboundRestApiFactory->setPort(pollingServerPort);
+                }
+
+                if (settingsChanged(jsonObject, { "inbound_api_key" })) {
+                    currentLatencyManager->setSecret(inboundApiKey);
+                    currentMetricsManager->setSecret(inboundApiKey);
+
+                    if (!currentRelayMode) {
+                        currentRegionManager->setSecret(inboundApiKey);
+                        currentServerManager->setSecret(inboundApiKey);
+                        currentHostSchemeManager->setSecret(inboundApiKey);
+                        currentMonitorManager->setSecret(inboundApiKey);
+                        currentCustomerCapabilitiesManager->setSecret(inboundApiKey);
+                        currentEventManager->setSecret(inboundApiKey);
+                        currentCustomerMappingManager->setSecret(inboundApiKey);
+                        currentMultipleManager->setSecret(inboundApiKey);
+                        currentResourceManager->setSecret(inboundApiKey);
+                        currentJobManager->setSecret(inboundApiKey);
+                    }
+                }
+
+                if (!configurationApplied) {
+                    currentShardMap->setLocalShardId(static_cast<ShardMap::ShardId>(shardIdAsDouble));
+                    currentShardMap->invalidate();
+                    currentCustomerMapping->invalidate();
+
+                    currentCustomerSecrets->setEncryptionKeys(customerSecretsEncryptionKey);
+                    currentCustomerSecrets->setCustomerIdentifierKey(customerIdentifierKey);
+                }
+
+                if (settingsChanged(jsonObject, { "customer_secrets_cache_policy" })) {
+                    currentCustomerSecrets->setEvictionPolicy(customerSecretsCachePolicy);
+                }
+
+                if (settingsChanged(jsonObject, { "customer_secrets_cache_size" })) {
+                    currentCustomerSecrets->resizeCache(customerSecretsCacheSize);
+                }
+
+                if (settingsChanged(jsonObject, { "customer_capabilities_cache_policy" })) {
+                    currentCustomersCapabilities->setEvictionPolicy(customerCapabilitiesCachePolicy);
+                }
+
+                if (settingsChanged(jsonObject, { "customer_capabilities_cache_size" })) {
+                    currentCustomersCapabilities->resizeCache(customerCapabilitiesCacheSize);
+                }
+
+                if (settingsChanged(jsonObject, { "customer_negative_cache_size", "customer_negative_cache_ttl" })) {
+                    currentCustomerSecrets->setNegativeCaching(customerNegativeCacheSize, customerNegativeCacheTtl);
+                    currentCustomersCapabilities->setNegativeCaching(
+                        customerNegativeCacheSize,
+                        customerNegativeCacheTtl
+                    );
+                }
+
+                if (customerCacheWarmUp) {
+                    currentCacheWarmer->startWarmUp(customerSecretsCacheSize, customerCapabilitiesCacheSize);
+                }
+
+                if (settingsChanged(jsonObject, { "warm_start_file", "warm_start_save_interval" })) {
+                    currentWarmStart->configure(
+                        warmStartFile,
+                        static_cast<unsigned long>(warmStartSaveIntervalAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "memory_soft_limit", "memory_hard_limit" })) {
+                    MemoryGovernor::instance()->setLimits(
+                        static_cast<unsigned long long>(memorySoftLimitAsDouble),
+                        static_cast<unsigned long long>(memoryHardLimitAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "cache_invalidation", "cache_invalidation_channel" })) {
+                    if (cacheInvalidation) {
+                        CacheInvalidationBus::instance()->startBus(databaseManager, cacheInvalidationChannel);
+                    } else {
+                        CacheInvalidationBus::instance()->stopBus();
+                    }
+                }
+
+                if (queryPlanCheck) {
+                    currentQueryPlanChecker->startCheck(queryPlanCheckMinimumRows);
+                }
 
                 Crypto::scrub(customerSecretsEncryptionKey);
                 Crypto::scrub(customerIdentifierKey);
 
-                latencyInterfaceManager->setParameters(
-                    static_cast<unsigned long>(aggregationAgeAsDouble),
-                    static_cast<unsigned long>(aggregationSamplePeriodAsDouble),
-                    static_cast<unsigned long>(expungeAgeAsDouble),
-                    false
+                if (settingsChanged(jsonObject, { "server_report_flush_interval", "polling_server_delta_updates" })) {
+                    currentServerAdministrator->setReportFlushInterval(
+                        static_cast<unsigned>(serverReportFlushIntervalAsDouble)
+                    );
+                    currentServerAdministrator->setDeltaUpdates(pollingServerDeltaUpdates);
+                }
+
+                if (settingsChanged(jsonObject, { "server_health_degradation_ratio" })) {
+                    currentServerAdministrator->setServerHealth(
+                        latencyInterfaceManager->serverHealth(),
+                        serverHealthDegradationRatioAsDouble
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "aggregation_age", "aggregation_sample_period", "expunge_age" })) {
+                    latencyInterfaceManager->setParameters(
+                        static_cast<unsigned long>(aggregationAgeAsDouble),
+                        static_cast<unsigned long>(aggregationSamplePeriodAsDouble),
+                        static_cast<unsigned long>(expungeAgeAsDouble),
+                        false
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "aggregation_tiers" })) {
+                    latencyInterfaceManager->setAggregationTiers(aggregationTiers);
+                }
+
+                if (settingsChanged(jsonObject, { "latency_partition_periods" })) {
+                    latencyInterfaceManager->setPartitionPeriods(latencyPartitionPeriods);
+                }
+
+                // Relays share the central database so archiving and purges are left to the central controller.
+                if (!currentRelayMode) {
+                    bool archiveChanged = settingsChanged(
+                        jsonObject,
+                        { "latency_archive_directory", "latency_archive_age", "latency_archive_shards" }
+                    );
+                    if (archiveChanged) {
+                        latencyInterfaceManager->setArchive(
+                            latencyArchiveDirectory,
+                            static_cast<unsigned long>(latencyArchiveAgeAsDouble),
+                            static_cast<unsigned>(latencyArchiveShardsAsDouble)
+                        );
+                    }
+
+                    if (settingsChanged(jsonObject, { "latency_purge_batch_size", "latency_purge_rows_per_second" })) {
+                        latencyInterfaceManager->setPurgeThrottle(
+                            static_cast<unsigned long>(latencyPurgeBatchSizeAsDouble),
+                            static_cast<unsigned long>(latencyPurgeRowsPerSecondAsDouble)
+                        );
+                    }
+                }
+
+                // Placements are applied first so threads started by the thread count changes below are placed.
+                if (settingsChanged(jsonObject, { "thread_pools" })) {
+                    ThreadPlacement* threadPlacement = ThreadPlacement::instance();
+                    for (unsigned index=0 ; index<ThreadPlacement::numberSubsystems ; ++index) {
+                        threadPlacement->setPlacement(
+                            static_cast<ThreadPlacement::Subsystem>(index),
+                            threadPlacements[index]
+                        );
+                    }
+                }
+
+                if (settingsChanged(jsonObject, { "aggregation_workers", "thread_pools" })) {
+                    latencyInterfaceManager->setNumberAggregationWorkers(
+                        static_cast<unsigned>(aggregationWorkersAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "query_workers", "thread_pools" })) {
+                    latencyInterfaceManager->setNumberQueryWorkers(static_cast<unsigned>(queryWorkersAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "recent_latency_retention" })) {
+                    latencyInterfaceManager->setRecentRetention(
+                        static_cast<unsigned long>(recentLatencyRetentionAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "latency_rolling_statistics" })) {
+                    latencyInterfaceManager->setRollingStatisticsEnabled(latencyRollingStatistics);
+                }
+
+                if (settingsChanged(jsonObject, { "latency_rolling_statistics", "latency_degradation_ratio" })) {
+                    currentEventProcessor->setLatencyDegradation(
+                        latencyRollingStatistics ? latencyInterfaceManager->rollingStatistics() : nullptr,
+                        latencyDegradationRatioAsDouble
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "latency_result_cache_size", "latency_result_cache_time_to_live" })) {
+                    latencyInterfaceManager->setResultCache(
+                        static_cast<unsigned long>(latencyResultCacheSizeAsDouble),
+                        static_cast<unsigned long>(1000.0 * latencyResultCacheTimeToLiveAsDouble + 0.5)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "latency_ingest_rollups" })) {
+                    latencyInterfaceManager->setIngestRollups(latencyIngestRollups && !currentRelayMode);
+                }
+
+                if (settingsChanged(jsonObject, { "latency_block_storage" })) {
+                    latencyInterfaceManager->setBlockStorage(latencyBlockStorage);
+                }
+
+                if (settingsChanged(jsonObject, { "latency_flush_batch_size" })) {
+                    latencyInterfaceManager->setFlushBatchSize(
+                        static_cast<unsigned long>(latencyFlushBatchSizeAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "latency_deduplication_capacity" })) {
+                    latencyInterfaceManager->setDeduplicationCapacity(
+                        static_cast<unsigned long>(latencyDeduplicationCapacityAsDouble)
+                    );
+                }
+
+                bool flushThresholdsChanged = settingsChanged(
+                    jsonObject,
+                    { "latency_flush_maximum_entries", "latency_flush_maximum_bytes", "latency_flush_maximum_age" }
+                );
+                if (flushThresholdsChanged) {
+                    latencyInterfaceManager->setFlushThresholds(
+                        static_cast<unsigned long>(latencyFlushMaximumEntriesAsDouble),
+                        static_cast<unsigned long long>(latencyFlushMaximumBytesAsDouble),
+                        static_cast<unsigned long>(latencyFlushMaximumAgeAsDouble)
+                    );
+                }
+
+                if (!configurationApplied) {
+                    latencyInterfaceManager->setSpoolDirectory(latencySpoolDirectory);
+                }
+
+                if (settingsChanged(jsonObject, { "latency_ingest_high_watermark", "latency_ingest_low_watermark" })) {
+                    latencyInterfaceManager->setIngestWatermarks(
+                        static_cast<unsigned long>(latencyIngestHighWatermarkAsDouble),
+                        static_cast<unsigned long>(latencyIngestLowWatermarkAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "latency_writers_per_region", "latency_writers_by_region" })) {
+                    latencyInterfaceManager->setNumberWriters(
+                        static_cast<unsigned>(latencyWritersPerRegionAsDouble),
+                        latencyWritersByRegion
+                    );
+                }
+
+                bool compressionChanged = settingsChanged(
+                    jsonObject,
+                    { "response_compression_minimum_size", "response_compression_level" }
                 );
+                if (compressionChanged) {
+                    currentResponseCompressor->setMinimumSize(
+                        static_cast<unsigned long>(responseCompressionMinimumSizeAsDouble)
+                    );
+                    currentResponseCompressor->setCompressionLevel(static_cast<int>(responseCompressionLevelAsDouble));
+                }
+
+                if (!currentRelayMode) {
+                    if (settingsChanged(jsonObject, { "job_workers", "thread_pools" })) {
+                        currentJobScheduler->setNumberWorkers(static_cast<unsigned>(jobWorkersAsDouble));
+                    }
+
+                    if (settingsChanged(jsonObject, { "job_concurrency" })) {
+                        for (  QJsonObject::const_iterator it  = jobConcurrencyObject.constBegin(),
+                                                           end = jobConcurrencyObject.constEnd()
+                             ; it != end
+                             ; ++it
+                            ) {
+                            unsigned maximumConcurrent = static_cast<unsigned>(it.value().toDouble());
+                            if (!currentJobScheduler->setMaximumConcurrent(it.key(), maximumConcurrent)) {
+                                logWrite(
+                                    QString("Unknown job type %1 in job concurrency, ignored.").arg(it.key()),
+                                    false
+                                );
+                            }
+                        }
+                    }
+
+                    // Jobs are resumed once, a reload must not queue interrupted jobs a second time.
+                    if (!configurationApplied) {
+                        currentJobScheduler->resumeJobs();
+                    }
+                }
+
+                if (settingsChanged(jsonObject, { "schedule" })) {
+                    PeriodicScheduler::instance()->setConfiguration(taskConfigurations);
+                }
+
+                if (settingsChanged(jsonObject, { "plot_workers", "thread_pools" })) {
+                    currentPlotWorkerPool->setNumberWorkers(static_cast<unsigned>(plotWorkersAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "plot_queue_depth" })) {
+                    currentPlotWorkerPool->setMaximumQueued(static_cast<unsigned>(plotQueueDepthAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "plot_cache_size" })) {
+                    currentLatencyPlotter->plotCache().resizeCache(static_cast<unsigned long>(plotCacheSizeAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "dashboard_cache_size" })) {
+                    currentDashboardCache->resizeCache(static_cast<unsigned long>(dashboardCacheSizeAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "dashboard_event_window_days" })) {
+                    currentDashboardCache->setEventWindow(static_cast<unsigned>(dashboardEventWindowDaysAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "customer_rate_limit" })) {
+                    currentCustomerRateLimiter->setBudget(
+                        rateLimitBaseRateAsDouble,
+                        rateLimitPerMonitorAsDouble,
+                        rateLimitBurstSecondsAsDouble
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "fast_plot_maximum_pixels" })) {
+                    currentLatencyPlotter->setFastRendererMaximumPixels(
+                        static_cast<unsigned>(fastPlotMaximumPixelsAsDouble)
+                    );
+                    currentResourcePlotter->setFastRendererMaximumPixels(
+                        static_cast<unsigned>(fastPlotMaximumPixelsAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "expunge_age" })) {
+                    currentResources->setMaximumAge(expungeAgeAsDouble);
+                }
+
+                if (settingsChanged(jsonObject, { "event_retention_age", "event_partition_period" })) {
+                    currentEvents->setRetention(
+                        static_cast<unsigned long>(eventRetentionAgeAsDouble),
+                        static_cast<unsigned long>(eventPartitionPeriodAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "event_purge_batch_size" })) {
+                    currentEvents->setPurgeBatchSize(static_cast<unsigned long>(eventPurgeBatchSizeAsDouble));
+                }
+
+                if (settingsChanged(jsonObject, { "resource_flush_maximum_entries", "resource_flush_maximum_age" })) {
+                    currentResources->setFlushThresholds(
+                        static_cast<unsigned long>(resourceFlushMaximumEntriesAsDouble),
+                        static_cast<unsigned long>(resourceFlushMaximumAgeAsDouble)
+                    );
+                }
+
+                if (settingsChanged(jsonObject, { "resource_partition_periods" })) {
+                    currentResources->setPartitionPeriods(resourcePartitionPeriods);
+                }
+
+                if (settingsChanged(jsonObject, { "resource_aggregation_tiers" })) {
+                    currentResources->setAggregationTiers(resourceAggregationTiers);
+                }
+            }
+
+            if (success) {
+                // Settings that need a restart keep the values in effect so they continue to be reported.
+                QJsonObject newAppliedConfiguration = jsonObject;
+                if (configurationApplied) {
+                    for (  QStringList::const_iterator it  = restartRequiredSettings.constBegin(),
+                                                       end = restartRequiredSettings.constEnd()
+                         ; it != end
+                         ; ++it
+                        ) {
+                        QJsonValue appliedValue = appliedConfiguration.value(*it);
+                        if (appliedValue.isUndefined()) {
+                            newAppliedConfiguration.remove(*it);
+                        } else {
+                            newAppliedConfiguration.insert(*it, appliedValue);
+                        }
+                    }
+                }
 
-                currentResources->setMaximumAge(expungeAgeAsDouble);
+                appliedConfiguration = newAppliedConfiguration;
+                configurationApplied = true;
             }
         } else {
             logWrite(QString("Invalid JSON formatted configuration file."), true);
@@ -563,6 +2132,129 @@ void DbC::configurationFileChanged(const QString& /* filePath */) {
     }
 
     if (!success) {
-        QCoreApplication::instance()->exit(1);
+        if (configurationApplied) {
+            logWrite(QString("Configuration reload rejected, the previous configuration remains in effect."), true);
+        } else {
+            QCoreApplication::instance()->exit(1);
+        }
+    }
+}
+
+
+bool DbC::settingsChanged(const QJsonObject& configuration, const QStringList& settings) const {
+    bool result = !configurationApplied;
+
+    QStringList::const_iterator it  = settings.constBegin();
+    QStringList::const_iterator end = settings.constEnd();
+    while (!result && it != end) {
+        result = (configuration.value(*it) != appliedConfiguration.value(*it));
+        ++it;
+    }
+
+    return result;
+}
+
+
+void DbC::addSampledMetric(
+        MetricsRegistry::Type           type,
+        const QString&                  name,
+        const QString&                  help,
+        const QString&                  labels,
+        const MetricsRegistry::Sampler& sampler
+    ) {
+    if (MetricsRegistry::instance()->addSampler(type, name, help, labels, sampler)) {
+        sampledMetrics.append(QPair<QString, QString>(name, labels));
+    }
+}
+
+
+void DbC::addCacheMetrics(const QString& cacheName, const std::function<CacheBase::Statistics()>& statistics) {
+    QString labels = MetricsRegistry::label(QString("cache"), cacheName);
+
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_cache_hits_total"),
+        QString("Number of cache lookups that found the requested entry."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().hits); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_cache_misses_total"),
+        QString("Number of cache lookups that did not find the requested entry."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().misses); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_cache_evictions_total"),
+        QString("Number of cache entries evicted to make room for new entries."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().evictions); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_cache_rejections_total"),
+        QString("Number of new cache entries rejected by the admission policy."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().rejections); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::COUNTER,
+        QString("dbc_cache_insertions_total"),
+        QString("Number of new entries added to the cache."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().insertions); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_cache_entries"),
+        QString("Number of entries held in the cache."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().numberEntries); }
+    );
+    addSampledMetric(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_cache_table_size"),
+        QString("Number of table entries allocated by the cache."),
+        labels,
+        [statistics]() { return static_cast<double>(statistics().tableSize); }
+    );
+
+    for (unsigned bin=0 ; bin<CacheBase::numberProbeLengthBins ; ++bin) {
+        QString groups = QString::number(bin + 1);
+        if (bin == CacheBase::numberProbeLengthBins - 1) {
+            groups += QString("+");
+        }
+
+        addSampledMetric(
+            MetricsRegistry::Type::COUNTER,
+            QString("dbc_cache_probe_lengths_total"),
+            QString("Number of cache lookups by the number of probe groups examined."),
+            labels + QString(",") + MetricsRegistry::label(QString("groups"), groups),
+            [statistics, bin]() { return static_cast<double>(statistics().probeLengths[bin]); }
+        );
     }
 }
+
+
+double DbC::processMemoryBytes(const QByteArray& field) {
+    double result = 0;
+
+    QFile statusFile(QString("/proc/self/status"));
+    if (statusFile.open(QIODevice::ReadOnly)) {
+        // Lines take the form "VmRSS:     12345 kB".
+        QByteArray prefix = field + QByteArray(":");
+        QByteArray line   = statusFile.readLine();
+        while (!line.isEmpty() && !line.startsWith(prefix)) {
+            line = statusFile.readLine();
+        }
+
+        if (!line.isEmpty()) {
+            QList<QByteArray> fields = line.mid(prefix.size()).simplified().split(' ');
+            result = fields.first().toDouble() * (fields.size() > 1 && fields.at(1) == "kB" ? 1024 : 1);
+        }
+    }
+
+    return result;
+}
@@ -46,6 +46,8 @@ QString Event::toString(Event::EventType value) {
         case EventType::INQUIRY:                  { result = QString("INQUIRY");                   break; }
         case EventType::SUPPORT_REQUEST:          { result = QString("SUPPORT_REQUEST");           break; }
         case EventType::STORAGE_LIMIT_REACHED:    { result = QString("STORAGE_LIMIT_REACHED");     break; }
+        case EventType::LATENCY_DEGRADED:         { result = QString("LATENCY_DEGRADED");          break; }
+        case EventType::LATENCY_RESTORED:         { result = QString("LATENCY_RESTORED");          break; }
         default:                                  { Q_ASSERT(false);                               break; }
     }
 
@@ -100,6 +102,10 @@ Event::EventType Event::toEventType(const QString& str, bool* ok) {
         result = EventType::SUPPORT_REQUEST;
     } else if (s == "storage_limit_reached") {
         result = EventType::STORAGE_LIMIT_REACHED;
+    } else if (s == "latency_degraded") {
+        result = EventType::LATENCY_DEGRADED;
+    } else if (s == "latency_restored") {
+        result = EventType::LATENCY_RESTORED;
     } else {
         success = false;
         result = EventType::INVALID;
@@ -22,6 +22,7 @@
 #include <QByteArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QJsonValue>
 
 #include <limits>
@@ -35,6 +36,7 @@
 #include "events.h"
 #include "monitors.h"
 #include "event_processor.h"
+#include "traffic_recorder.h"
 #include "event_manager.h"
 
 /***********************************************************************************************************************
@@ -58,108 +60,135 @@ EventManager::EventReport::~EventReport() {}
 
 
 RestApiInV1::JsonResponse EventManager::EventReport::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    TrafficRecorder::record(path, 0, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
-        QJsonObject object = request.object();
-        if (object.contains("monitor_id")       &&
-            object.contains("timestamp")        &&
-            object.contains("event_type")       &&
-            object.contains("monitor_status")   &&
-            object.contains("message")          &&
-            (object.size() == 5            ||
-             (object.size() == 6      &&
-              object.contains("hash")    )    )    ) {
+        EventProcessor::ReportedEvent reportedEvent;
+        bool                          ignored;
+        QString                       status = parseReportedEvent(
+            request.object(),
+            currentMonitors,
+            reportedEvent,
+            ignored,
+            threadId
+        );
+
+        if (!status.isEmpty()) {
+            if (status == QString("OK") && !ignored) {
+                bool success = currentEventProcessor->reportEvent(
+                    reportedEvent.customerId,
+                    reportedEvent.monitorId,
+                    reportedEvent.unixTimestamp,
+                    reportedEvent.eventType,
+                    reportedEvent.monitorStatus,
+                    reportedEvent.message,
+                    reportedEvent.hash,
+                    threadId
+                );
+
+                if (!success) {
+                    status = QString("failed to report event");
+                }
+            }
+
             QJsonObject responseObject;
+            responseObject.insert("status", status);
 
-            QByteArray hash;
-            bool       success = true;
-            if (object.size() == 6) {
-                QString                      hashString = object.value("hash").toString();
-                QByteArray::FromBase64Result hashResult = QByteArray::fromBase64Encoding(hashString.toLatin1());
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
+    }
 
-                success = (hashResult.decodingStatus == QByteArray::Base64DecodingStatus::Ok);
-                if (success) {
-                    hash = hashResult.decoded;
-                }
-            }
+    return response;
+}
 
-            if (success) {
-                QString message         = object.value("message").toString();
-                double  monitorIdDouble = object.value("monitor_id").toDouble(-1);
-
-                if (monitorIdDouble > 0 && monitorIdDouble < 0xFFFFFFFF) {
-                    Events::MonitorId monitorId = static_cast<Events::MonitorId>(monitorIdDouble);
-                    Monitor monitor = currentMonitors->getMonitor(monitorId, threadId);
-                    if (monitor.isValid()) {
-                        Events::CustomerId customerId      = monitor.customerId();
-                        double             timestampDouble = object.value("timestamp").toDouble(-1);
-                        if (timestampDouble >= LatencyEntry::startOfZoranEpoch                &&
-                            timestampDouble <= (LatencyEntry::startOfZoranEpoch + 0xFFFFFFFF)    ) {
-                            unsigned long long timestamp = static_cast<unsigned long long>(timestampDouble);
-                            QString            eventTypeString = object.value("event_type").toString();
-                            Events::EventType  eventType       = Event::toEventType(eventTypeString, &success);
-                            if (success) {
-                                QString monitorStatusString = object.value("monitor_status").toString();
-                                Monitor::MonitorStatus monitorStatus = Monitor::toMonitorStatus(
-                                    monitorStatusString,
-                                    &success
-                                );
+/***********************************************************************************************************************
+* EventManager::EventReportBatch
+*/
 
-                                if (success) {
-                                    logWrite(
-                                        QString(
-                                            "Received event customer %1, type %2, monitor %3, timestamp %4, hash %5"
-                                        ).arg(customerId)
-                                         .arg(eventTypeString)
-                                         .arg(monitorId)
-                                         .arg(timestamp)
-                                         .arg(QString::fromLocal8Bit(hash.toHex()))
-                                    );
-                                    success = currentEventProcessor->reportEvent(
-                                        customerId,
-                                        monitorId,
-                                        timestamp,
-                                        eventType,
-                                        monitorStatus,
-                                        message,
-                                        hash,
-                                        threadId
-                                    );
-
-                                    if (success) {
-                                        responseObject.insert("status", "OK");
-                                    } else {
-                                        responseObject.insert("status", "failed to report event");
-                                    }
-                                } else {
-                                    responseObject.insert("status", "failed, invalid monitor status");
-                                }
-                            } else {
-                                responseObject.insert("status", "failed, invalid event type");
-                            }
-                        } else {
-                            responseObject.insert("status", "failed, invalid timestamp");
+EventManager::EventReportBatch::EventReportBatch(
+        const QByteArray& secret,
+        EventProcessor*   eventProcessor,
+        Monitors*         monitorDatabaseApi
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentEventProcessor(
+        eventProcessor
+    ),currentMonitors(
+        monitorDatabaseApi
+    ) {}
+
+
+EventManager::EventReportBatch::~EventReportBatch() {}
+
+
+RestApiInV1::JsonResponse EventManager::EventReportBatch::processAuthenticatedRequest(
+        const QString&       path,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    TrafficRecorder::record(path, 0, request);
+
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (request.isArray()) {
+        QJsonArray                        eventArray = request.array();
+        QJsonArray                        results;
+        EventProcessor::ReportedEventList reportedEvents;
+        bool                              allValid   = true;
+        bool                              malformed  = false;
+
+        QJsonArray::const_iterator it  = eventArray.constBegin();
+        QJsonArray::const_iterator end = eventArray.constEnd();
+        while (!malformed && it != end) {
+            if ((*it).isObject()) {
+                EventProcessor::ReportedEvent reportedEvent;
+                bool                          ignored;
+                QString                       status = parseReportedEvent(
+                    (*it).toObject(),
+                    currentMonitors,
+                    reportedEvent,
+                    ignored,
+                    threadId
+                );
+
+                if (status.isEmpty()) {
+                    malformed = true;
+                } else {
+                    if (status == QString("OK")) {
+                        if (!ignored) {
+                            reportedEvents.append(reportedEvent);
                         }
                     } else {
-                        // Polling server messages can be delayed until after we delete a monitor so responding with
-                        // a failed response creates a race condition that introduces an infinte loop.  We address this
-                        // by silently ignoring messages from the polling server for non-existent monitors.
-
-                        logWrite(QString("Ignoring event for nonexistent monitor ID %1").arg(monitorId));
-                        responseObject.insert("status", "OK");
+                        allValid = false;
                     }
-                } else {
-                    responseObject.insert("status", "failed, invalid monitor ID");
+
+                    results.append(status);
+                    ++it;
                 }
             } else {
-                responseObject.insert("status", "failed, invalid MD5 sum value");
+                malformed = true;
             }
+        }
+
+        if (!malformed) {
+            QJsonObject responseObject;
 
+            bool success = reportedEvents.isEmpty() || currentEventProcessor->reportEvents(reportedEvents, threadId);
+            if (!success) {
+                responseObject.insert("status", "failed to report events");
+            } else if (!allValid) {
+                responseObject.insert("status", "failed, invalid events");
+            } else {
+                responseObject.insert("status", "OK");
+            }
+
+            responseObject.insert("results", results);
             response = RestApiInV1::JsonResponse(responseObject);
         }
     }
@@ -188,10 +217,12 @@ EventManager::EventStatus::~EventStatus() {}
 
 
 RestApiInV1::JsonResponse EventManager::EventStatus::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    TrafficRecorder::record(path, 0, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -291,10 +322,12 @@ EventManager::EventGet::~EventGet() {}
 
 
 RestApiInV1::JsonResponse EventManager::EventGet::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    TrafficRecorder::record(path, 0, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -307,6 +340,8 @@ RestApiInV1::JsonResponse EventManager::EventGet::processAuthenticatedRequest(
         Events::MonitorId  monitorId      = Monitor::invalidMonitorId;
         unsigned long long startTimestamp = 0;
         unsigned long long endTimestamp   = std::numeric_limits<unsigned long long>::max();
+        Events::Cursor     after;
+        unsigned long      pageSize       = Events::unlimitedPageSize;
 
         if (object.contains("monitor_id")) {
             double monitorIdDouble = object.value("monitor_id").toDouble(-1);
@@ -356,23 +391,60 @@ RestApiInV1::JsonResponse EventManager::EventGet::processAuthenticatedRequest(
             ++numberFields;
         }
 
+        if (object.contains("page_size")) {
+            double pageSizeDouble = object.value("page_size").toDouble(-1);
+            if (pageSizeDouble >= 1 && pageSizeDouble <= 0xFFFFFFFF) {
+                pageSize = static_cast<unsigned long>(pageSizeDouble);
+            } else {
+                success = false;
+                responseObject.insert("status", "failed, invalid page size");
+            }
+
+            ++numberFields;
+        }
+
+        if (object.contains("cursor")) {
+            bool cursorOk;
+            after = convertToCursor(object.value("cursor").toString(), &cursorOk);
+            if (!cursorOk) {
+                success = false;
+                responseObject.insert("status", "failed, invalid cursor");
+            }
+
+            ++numberFields;
+        }
+
         if (success) {
             if (numberFields == static_cast<unsigned>(object.size())) {
                 if (customerId == Events::invalidCustomerId || monitorId == Monitor::invalidMonitorId) {
                     Events::EventList events;
                     if (monitorId != Monitor::invalidMonitorId) {
-                        events = currentEvents->getEventsByMonitor(monitorId, startTimestamp, endTimestamp, threadId);
+                        events = currentEvents->getEventsByMonitor(
+                            monitorId,
+                            startTimestamp,
+                            endTimestamp,
+                            after,
+                            pageSize,
+                            threadId
+                        );
                     } else {
                         events = currentEvents->getEventsByCustomer(
                             customerId,
                             startTimestamp,
                             endTimestamp,
+                            after,
+                            pageSize,
                             threadId
                         );
                     }
 
                     responseObject.insert("status", "OK");
                     responseObject.insert("events", convertToJson(events, true, true));
+
+                    Events::Cursor next = nextCursor(events, pageSize);
+                    if (next.isValid()) {
+                        responseObject.insert("next_cursor", convertToString(next));
+                    }
                 } else {
                     responseObject.insert("status", "failed, customer ID or monitor ID, not both");
                 }
@@ -394,6 +466,7 @@ RestApiInV1::JsonResponse EventManager::EventGet::processAuthenticatedRequest(
 */
 
 const QString EventManager::eventReportPath("/event/report");
+const QString EventManager::eventReportBatchPath("/event/report/batch");
 const QString EventManager::eventStatusPath("/event/status");
 const QString EventManager::eventGetPath("/event/get");
 
@@ -410,6 +483,10 @@ EventManager::EventManager(
         secret,
         eventProcessor,
         monitorDatabaseApi
+    ),eventReportBatch(
+        secret,
+        eventProcessor,
+        monitorDatabaseApi
     ),eventStatus(
         secret,
         eventDatabaseApi,
@@ -419,6 +496,7 @@ EventManager::EventManager(
         eventDatabaseApi
     ) {
     restApiServer->registerHandler(&eventReport, RestApiInV1::Handler::Method::POST, eventReportPath);
+    restApiServer->registerHandler(&eventReportBatch, RestApiInV1::Handler::Method::POST, eventReportBatchPath);
     restApiServer->registerHandler(&eventStatus, RestApiInV1::Handler::Method::POST, eventStatusPath);
     restApiServer->registerHandler(&eventGet, RestApiInV1::Handler::Method::POST, eventGetPath);
 }
@@ -429,6 +507,112 @@ EventManager::~EventManager() {}
 
 void EventManager::setSecret(const QByteArray& newSecret) {
     eventReport.setSecret(newSecret);
+    eventReportBatch.setSecret(newSecret);
     eventStatus.setSecret(newSecret);
     eventGet.setSecret(newSecret);
 }
+
+
+QString EventManager::parseReportedEvent(
+        const QJsonObject&             object,
+        Monitors*                      monitors,
+        EventProcessor::ReportedEvent& reportedEvent,
+        bool&                          ignored,
+        unsigned                       threadId
+    ) {
+    QString result;
+
+    ignored = false;
+    if (object.contains("monitor_id")       &&
+        object.contains("timestamp")        &&
+        object.contains("event_type")       &&
+        object.contains("monitor_status")   &&
+        object.contains("message")          &&
+        (object.size() == 5            ||
+         (object.size() == 6      &&
+          object.contains("hash")    )    )    ) {
+        QByteArray hash;
+        bool       success = true;
+        if (object.size() == 6) {
+            QString                      hashString = object.value("hash").toString();
+            QByteArray::FromBase64Result hashResult = QByteArray::fromBase64Encoding(hashString.toLatin1());
+
+            success = (hashResult.decodingStatus == QByteArray::Base64DecodingStatus::Ok);
+            if (success) {
+                hash = hashResult.decoded;
+            }
+        }
+
+        if (success) {
+            QString message         = object.value("message").toString();
+            double  monitorIdDouble = object.value("monitor_id").toDouble(-1);
+
+            if (monitorIdDouble > 0 && monitorIdDouble < 0xFFFFFFFF) {
+                Events::MonitorId monitorId = static_cast<Events::MonitorId>(monitorIdDouble);
+                Monitor monitor = monitors->getMonitor(monitorId, threadId);
+                if (monitor.isValid()) {
+                    Events::CustomerId customerId      = monitor.customerId();
+                    double             timestampDouble = object.value("timestamp").toDouble(-1);
+                    if (timestampDouble >= LatencyEntry::startOfZoranEpoch                &&
+                        timestampDouble <= (LatencyEntry::startOfZoranEpoch + 0xFFFFFFFF)    ) {
+                        unsigned long long timestamp = static_cast<unsigned long long>(timestampDouble);
+                        QString            eventTypeString = object.value("event_type").toString();
+                        Events::EventType  eventType       = Event::toEventType(eventTypeString, &success);
+                        if (success) {
+                            QString monitorStatusString = object.value("monitor_status").toString();
+                            Monitor::MonitorStatus monitorStatus = Monitor::toMonitorStatus(
+                                monitorStatusString,
+                                &success
+                            );
+
+                            if (success) {
+                                logWrite(
+                                    QString(
+                                        "Received event customer %1, type %2, monitor %3, timestamp %4, hash %5"
+                                    ).arg(customerId)
+                                     .arg(eventTypeString)
+                                     .arg(monitorId)
+                                     .arg(timestamp)
+                                     .arg(QString::fromLocal8Bit(hash.toHex()))
+                                );
+
+                                reportedEvent = EventProcessor::ReportedEvent(
+                                    customerId,
+                                    monitorId,
+                                    timestamp,
+                                    eventType,
+                                    monitorStatus,
+                                    message,
+                                    hash
+                                );
+
+                                result = QString("OK");
+                            } else {
+                                result = QString("failed, invalid monitor status");
+                            }
+                        } else {
+                            result = QString("failed, invalid event type");
+                        }
+                    } else {
+                        result = QString("failed, invalid timestamp");
+                    }
+                } else {
+                    // Polling server messages can be delayed until after we delete a monitor so responding with
+                    // a failed response creates a race condition that introduces an infinte loop.  We address this
+                    // by silently ignoring messages from the polling server for non-existent monitors.
+
+                    logWrite(QString("Ignoring event for nonexistent monitor ID %1").arg(monitorId));
+
+                    ignored = true;
+                    result  = QString("OK");
+                }
+            } else {
+                result = QString("failed, invalid monitor ID");
+            }
+        } else {
+            result = QString("failed, invalid MD5 sum value");
+        }
+    }
+
+    return result;
+}
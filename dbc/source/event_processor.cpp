@@ -22,6 +22,8 @@
 #include <QString>
 #include <QByteArray>
 #include <QHash>
+#include <QSet>
+#include <QMultiMap>
 #include <QDateTime>
 #include <QSqlDatabase>
 #include <QSqlError>
@@ -33,6 +35,8 @@
 #include <QMutexLocker>
 
 #include <cstdint>
+#include <cmath>
+#include <algorithm>
 
 #include "monitor.h"
 #include "monitors.h"
@@ -41,8 +45,14 @@
 #include "event.h"
 #include "events.h"
 #include "outbound_rest_api.h"
+#include "periodic_scheduler.h"
+#include "server.h"
+#include "latency_rolling_statistics.h"
 #include "event_processor.h"
 
+const double EventProcessor::latencyMinimumRecentWeight   = 3.0;
+const double EventProcessor::latencyMinimumBaselineWeight = 30.0;
+
 EventProcessor::EventProcessor(
         Monitors*          monitorsDatabaseApi,
         HostSchemes*       hostSchemesDatabaseApi,
@@ -60,14 +70,45 @@ EventProcessor::EventProcessor(
     ),currentWebsiteRestApi(
         websiteRestApi
     ) {
-    certificateCheckTimer.setSingleShot(false);
-    certificateCheckTimer.start(sslCheckIntervalMilliseconds);
+    lastSslReconcileTime           = 0;
+    currentRollingStatistics       = nullptr;
+    currentLatencyDegradationRatio = 0;
 
-    connect(&certificateCheckTimer, &QTimer::timeout, this, &EventProcessor::checkSslExpiration);
+    PeriodicScheduler* scheduler = PeriodicScheduler::instance();
+    certificateCheckTaskId = scheduler->registerTask(
+        QString("ssl_expiration_check"),
+        QString(),
+        0,
+        [this]() {
+            checkSslExpiration();
+        }
+    );
+    scheduler->setPeriod(certificateCheckTaskId, sslCheckIntervalSeconds);
+
+    latencyCheckTaskId = scheduler->registerTask(
+        QString("latency_degradation_check"),
+        QString(),
+        0,
+        [this]() {
+            checkLatencyDegradation();
+        }
+    );
+    scheduler->setPeriod(latencyCheckTaskId, latencyCheckIntervalSeconds);
+
+    connect(
+        currentHostSchemes,
+        &HostSchemes::hostSchemeModified,
+        this,
+        &EventProcessor::hostSchemeModified,
+        Qt::DirectConnection
+    );
 }
 
 
-EventProcessor::~EventProcessor() {}
+EventProcessor::~EventProcessor() {
+    PeriodicScheduler::instance()->unregisterTask(certificateCheckTaskId);
+    PeriodicScheduler::instance()->unregisterTask(latencyCheckTaskId);
+}
 
 
 bool EventProcessor::reportEvent(
@@ -80,121 +121,404 @@ bool EventProcessor::reportEvent(
         const QByteArray&             hash,
         unsigned                      threadId
     ) {
-    QMutexLocker locker(&reportEventMutex);
-
-    Events::EventDisposition eventDisposition = currentEvents->eventDisposition(
-        eventType,
-        monitorStatus,
-        monitorId,
-        hash,
-        threadId
-    );
-
-    if (eventDisposition == Events::EventDisposition::RECORD_AND_REPORT ||
-        eventDisposition == Events::EventDisposition::RECORD_ONLY          ) {
-        currentEvents->recordEvent(
+    return reportEvents(
+        ReportedEventList() << ReportedEvent(
             customerId,
             monitorId,
             unixTimestamp,
             eventType,
+            monitorStatus,
             message,
-            hash,
+            hash
+        ),
+        threadId
+    );
+}
+
+
+bool EventProcessor::reportEvents(const EventProcessor::ReportedEventList& reportedEvents, unsigned threadId) {
+    // Events touching the same monitor or, for SSL events, the same host/scheme must be processed in order so we lock
+    // the stripes covering every monitor and host/scheme in this group.  Stripes are always locked in ascending order
+    // to avoid deadlocks between groups.
+
+    QList<HostScheme::HostSchemeId> hostSchemeIds;
+    QSet<unsigned>                  stripeSet;
+    for (  ReportedEventList::const_iterator it  = reportedEvents.constBegin(),
+                                             end = reportedEvents.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        HostScheme::HostSchemeId hostSchemeId = HostScheme::invalidHostSchemeId;
+        if (it->eventType == EventType::SSL_CERTIFICATE_EXPIRING ||
+            it->eventType == EventType::SSL_CERTIFICATE_RENEWED     ) {
+            hostSchemeId = currentMonitors->getMonitor(it->monitorId, threadId).hostSchemeId();
+            stripeSet.insert(hostSchemeId % numberReportEventStripes);
+        }
+
+        hostSchemeIds.append(hostSchemeId);
+        stripeSet.insert(it->monitorId % numberReportEventStripes);
+    }
+
+    QList<unsigned> stripes = stripeSet.values();
+    std::sort(stripes.begin(), stripes.end());
+
+    for (QList<unsigned>::const_iterator it=stripes.constBegin(),end=stripes.constEnd() ; it!=end ; ++it) {
+        reportEventMutexes[*it].lock();
+    }
+
+    // Events are classified against the state left by the events ahead of them.  An event that shares state with an
+    // event that is still pending forces the pending group to be written first.
+
+    QList<Event>                   pendingEvents;
+    QList<bool>                    pendingReports;
+    QSet<MonitorId>                pendingMonitorIds;
+    QSet<HostScheme::HostSchemeId> pendingHostSchemeIds;
+
+    unsigned long numberEvents = static_cast<unsigned long>(reportedEvents.size());
+    for (unsigned long index=0 ; index<numberEvents ; ++index) {
+        const ReportedEvent&     event        = reportedEvents.at(index);
+        HostScheme::HostSchemeId hostSchemeId = hostSchemeIds.at(index);
+        bool                     isSslEvent   = (hostSchemeId != HostScheme::invalidHostSchemeId);
+
+        if (pendingMonitorIds.contains(event.monitorId)                       ||
+            (isSslEvent && pendingHostSchemeIds.contains(hostSchemeId))    ) {
+            recordAndReport(pendingEvents, pendingReports, threadId);
+
+            pendingEvents.clear();
+            pendingReports.clear();
+            pendingMonitorIds.clear();
+            pendingHostSchemeIds.clear();
+        }
+
+        Events::EventDisposition eventDisposition = currentEvents->eventDisposition(
+            event.eventType,
+            event.monitorStatus,
+            event.monitorId,
+            event.hash,
             threadId
         );
-    }
 
-    if (eventDisposition == Events::EventDisposition::RECORD_AND_REPORT) {
-        QJsonObject jsonMessage;
+        if (eventDisposition == Events::EventDisposition::RECORD_AND_REPORT ||
+            eventDisposition == Events::EventDisposition::RECORD_ONLY          ) {
+            Event newEvent;
+            newEvent.setMonitorId(event.monitorId);
+            newEvent.setCustomerId(event.customerId);
+            newEvent.setUnixTimestamp(event.unixTimestamp);
+            newEvent.setEventType(event.eventType);
+            newEvent.setMessge(event.message);
+            newEvent.setHash(event.hash);
 
-        Monitor    monitor    = currentMonitors->getMonitor(monitorId, threadId);
-        HostScheme hostScheme = currentHostSchemes->getHostScheme(monitor.hostSchemeId(), threadId);
+            pendingEvents.append(newEvent);
+            pendingReports.append(eventDisposition == Events::EventDisposition::RECORD_AND_REPORT);
+            pendingMonitorIds.insert(event.monitorId);
 
-        jsonMessage.insert("customer_id", static_cast<double>(customerId));
-        jsonMessage.insert("monitor_id", static_cast<double>(monitorId));
-        jsonMessage.insert("event_type", Event::toString(eventType).toLower());
-        jsonMessage.insert("path", monitor.path());
-        jsonMessage.insert("authority", hostScheme.url().toString());
-        jsonMessage.insert("message", message);
-        jsonMessage.insert("timestamp", static_cast<double>(unixTimestamp));
+            if (isSslEvent) {
+                pendingHostSchemeIds.insert(hostSchemeId);
+            }
+        }
+    }
 
-        QString logMessage = QString("Reported event %1 (%2), customer %3 - %4/%5")
-                             .arg(Event::toString(eventType), message)
-                             .arg(customerId)
-                             .arg(hostScheme.url().toString(), monitor.path());
+    if (!pendingEvents.isEmpty()) {
+        recordAndReport(pendingEvents, pendingReports, threadId);
+    }
 
-        currentWebsiteRestApi->postMessage(QString("/event/report"), jsonMessage, logMessage);
+    for (QList<unsigned>::const_iterator it=stripes.constBegin(),end=stripes.constEnd() ; it!=end ; ++it) {
+        reportEventMutexes[*it].unlock();
     }
 
     return true;
 }
 
 
-void EventProcessor::checkSslExpiration() {
-    HostSchemes::HostSchemeHash hostSchemesById = currentHostSchemes->getHostSchemes(
-        HostScheme::invalidCustomerId,
-        timerDatabaseThreadId
-    );
+void EventProcessor::setLatencyDegradation(LatencyRollingStatistics* rollingStatistics, double degradationRatio) {
+    QMutexLocker locker(&latencyDegradationMutex);
+
+    currentRollingStatistics       = rollingStatistics;
+    currentLatencyDegradationRatio = degradationRatio;
+}
+
+
+void EventProcessor::recordAndReport(const QList<Event>& events, const QList<bool>& reports, unsigned threadId) {
+    currentEvents->recordEvents(events, threadId);
+
+    unsigned long numberEvents = static_cast<unsigned long>(events.size());
+    for (unsigned long i=0 ; i<numberEvents ; ++i) {
+        if (reports.at(i)) {
+            sendReport(events.at(i), threadId);
+        }
+    }
+}
+
 
+void EventProcessor::sendReport(const Event& event, unsigned threadId) {
+    QJsonObject jsonMessage;
+
+    Monitor    monitor    = currentMonitors->getMonitor(event.monitorId(), threadId);
+    HostScheme hostScheme = currentHostSchemes->getHostScheme(monitor.hostSchemeId(), threadId);
+
+    jsonMessage.insert("customer_id", static_cast<double>(event.customerId()));
+    jsonMessage.insert("monitor_id", static_cast<double>(event.monitorId()));
+    jsonMessage.insert("event_type", Event::toString(event.eventType()).toLower());
+    jsonMessage.insert("path", monitor.path());
+    jsonMessage.insert("authority", hostScheme.url().toString());
+    jsonMessage.insert("message", event.message());
+    jsonMessage.insert("timestamp", static_cast<double>(event.unixTimestamp()));
+
+    QString logMessage = QString("Reported event %1 (%2), customer %3 - %4/%5")
+                         .arg(Event::toString(event.eventType()), event.message())
+                         .arg(event.customerId())
+                         .arg(hostScheme.url().toString(), monitor.path());
+
+    currentWebsiteRestApi->postMessage(QString("/event/report"), jsonMessage, logMessage);
+}
+
+
+void EventProcessor::checkSslExpiration() {
     unsigned long long currentDateTime = QDateTime::currentSecsSinceEpoch();
-    unsigned long long threshold       = currentDateTime + sslCertificateExpirationMarginSeconds;
 
-    for (  HostSchemes::HostSchemeHash::const_iterator it  = hostSchemesById.constBegin(),
-                                                       end = hostSchemesById.constEnd()
-         ; it != end
-         ; ++it
-         ) {
-        HostScheme::HostSchemeId hostSchemeId = it.key();
-        const HostScheme&        hostScheme   = it.value();
-        unsigned long long       expiration   = hostScheme.sslExpirationTimestamp();
-
-        if (expiration != HostScheme::invalidSslExpirationTimestamp) {
-            if (expiration < threshold) {
-                if (!currentExpiringHostSchemes.value(hostSchemeId)) {
-                    currentExpiringHostSchemes.insert(hostSchemeId, true);
-
-                    Monitors::MonitorList monitors = currentMonitors->getMonitorsUnderHostScheme(
-                        hostSchemeId,
-                        timerDatabaseThreadId
-                    );
-                    const Monitor& monitor = monitors.first();
-
-                    reportEvent(
-                        hostScheme.customerId(),
-                        monitor.monitorId(),
-                        currentDateTime,
-                        EventType::SSL_CERTIFICATE_EXPIRING,
-                        MonitorStatus::WORKING,
-                        tr("Expiration %1 UTC").arg(
-                            QDateTime::fromMSecsSinceEpoch(expiration).toString(Qt::DateFormat::RFC2822Date)
-                        ),
-                        QByteArray(),
-                        timerDatabaseThreadId
-                    );
-                }
+    if (currentDateTime >= lastSslReconcileTime + sslReconcileIntervalSeconds) {
+        // The periodic full scan rebuilds the index, picking up host/schemes changed outside of
+        // HostSchemes::modifyHostScheme and dropping state for deleted host/schemes.
+
+        lastSslReconcileTime = currentDateTime;
+
+        modifiedHostSchemesMutex.lock();
+        modifiedHostSchemeIds.clear();
+        modifiedHostSchemesMutex.unlock();
+
+        HostSchemes::HostSchemeHash hostSchemesById = currentHostSchemes->getHostSchemes(
+            HostScheme::invalidCustomerId,
+            timerDatabaseThreadId
+        );
+
+        hostSchemeIdsByTriggerTime.clear();
+        triggerTimesByHostSchemeId.clear();
+
+        QHash<HostScheme::HostSchemeId, bool>::iterator expiringIterator    = currentExpiringHostSchemes.begin();
+        QHash<HostScheme::HostSchemeId, bool>::iterator expiringEndIterator = currentExpiringHostSchemes.end();
+        while (expiringIterator != expiringEndIterator) {
+            if (hostSchemesById.contains(expiringIterator.key())) {
+                ++expiringIterator;
             } else {
-                if (currentExpiringHostSchemes.value(hostSchemeId,true)) {
-                    currentExpiringHostSchemes.insert(hostSchemeId, false);
+                expiringIterator = currentExpiringHostSchemes.erase(expiringIterator);
+            }
+        }
 
-                    Monitors::MonitorList monitors = currentMonitors->getMonitorsUnderHostScheme(
-                        hostSchemeId,
-                        timerDatabaseThreadId
-                    );
-                    const Monitor& monitor = monitors.first();
-
-                    reportEvent(
-                        hostScheme.customerId(),
-                        monitor.monitorId(),
-                        currentDateTime,
-                        EventType::SSL_CERTIFICATE_RENEWED,
-                        MonitorStatus::WORKING,
-                        tr("Expiration %1 UTC").arg(
-                            QDateTime::fromMSecsSinceEpoch(expiration).toString(Qt::DateFormat::RFC2822Date)
-                        ),
-                        QByteArray(),
-                        timerDatabaseThreadId
+        for (  HostSchemes::HostSchemeHash::const_iterator it  = hostSchemesById.constBegin(),
+                                                           end = hostSchemesById.constEnd()
+             ; it != end
+             ; ++it
+             ) {
+            checkHostSchemeSslExpiration(it.value(), currentDateTime);
+        }
+    } else {
+        modifiedHostSchemesMutex.lock();
+        QSet<HostScheme::HostSchemeId> hostSchemeIds = modifiedHostSchemeIds;
+        modifiedHostSchemeIds.clear();
+        modifiedHostSchemesMutex.unlock();
+
+        // A certificate is expiring once the current time passes its trigger time so only the front of the index
+        // needs to be examined.
+
+        HostSchemeIdsByTriggerTime::const_iterator triggerIterator    = hostSchemeIdsByTriggerTime.constBegin();
+        HostSchemeIdsByTriggerTime::const_iterator triggerEndIterator = hostSchemeIdsByTriggerTime.constEnd();
+        while (triggerIterator != triggerEndIterator && triggerIterator.key() < currentDateTime) {
+            hostSchemeIds.insert(triggerIterator.value());
+            ++triggerIterator;
+        }
+
+        for (  QSet<HostScheme::HostSchemeId>::const_iterator it  = hostSchemeIds.constBegin(),
+                                                              end = hostSchemeIds.constEnd()
+             ; it != end
+             ; ++it
+             ) {
+            HostScheme::HostSchemeId hostSchemeId = *it;
+            HostScheme               hostScheme   = currentHostSchemes->getHostScheme(
+                hostSchemeId,
+                timerDatabaseThreadId
+            );
+
+            if (hostScheme.isValid()) {
+                checkHostSchemeSslExpiration(hostScheme, currentDateTime);
+            } else {
+                unindexSslExpiration(hostSchemeId);
+                currentExpiringHostSchemes.remove(hostSchemeId);
+            }
+        }
+    }
+}
+
+
+void EventProcessor::hostSchemeModified(HostScheme::HostSchemeId hostSchemeId) {
+    QMutexLocker locker(&modifiedHostSchemesMutex);
+    modifiedHostSchemeIds.insert(hostSchemeId);
+}
+
+
+void EventProcessor::checkLatencyDegradation() {
+    latencyDegradationMutex.lock();
+    LatencyRollingStatistics* rollingStatistics = currentRollingStatistics;
+    double                    degradationRatio  = currentLatencyDegradationRatio;
+    latencyDegradationMutex.unlock();
+
+    if (rollingStatistics != nullptr && degradationRatio > 0) {
+        unsigned long long currentDateTime = QDateTime::currentSecsSinceEpoch();
+        double             restoreRatio    = 0.5 * (1.0 + degradationRatio);
+
+        LatencyRollingStatistics::SummariesByMonitorId recentSummaries = rollingStatistics->summaries(
+            nullptr,
+            Server::invalidServerId,
+            LatencyRollingStatistics::Window::FIVE_MINUTES
+        );
+        LatencyRollingStatistics::SummariesByMonitorId baselineSummaries = rollingStatistics->summaries(
+            nullptr,
+            Server::invalidServerId,
+            LatencyRollingStatistics::Window::ONE_DAY
+        );
+
+        // Monitors we have not yet checked may have been reported as degraded before a restart so we report either
+        // transition the first time a monitor is decided.  The event checkers drop the report if nothing changed.
+
+        QHash<MonitorId, bool> checkedMonitors;
+        for (  LatencyRollingStatistics::SummariesByMonitorId::const_iterator it  = recentSummaries.constBegin(),
+                                                                              end = recentSummaries.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            MonitorId                                monitorId       = it.key();
+            const LatencyRollingStatistics::Summary& recentSummary   = it.value();
+            LatencyRollingStatistics::Summary        baselineSummary = baselineSummaries.value(monitorId);
+
+            QHash<MonitorId, bool>::const_iterator stateIterator = currentDegradedMonitors.constFind(monitorId);
+            bool                                   known         = stateIterator != currentDegradedMonitors.constEnd();
+            bool                                   wasDegraded   = known && stateIterator.value();
+
+            bool decided     = false;
+            bool nowDegraded = wasDegraded;
+            if (recentSummary.weight >= latencyMinimumRecentWeight     &&
+                baselineSummary.weight >= latencyMinimumBaselineWeight &&
+                baselineSummary.meanLatency > 0                           ) {
+                double ratio = recentSummary.meanLatency / baselineSummary.meanLatency;
+                if (ratio > degradationRatio) {
+                    decided     = true;
+                    nowDegraded = true;
+                } else if (ratio < restoreRatio) {
+                    decided     = true;
+                    nowDegraded = false;
+                }
+            }
+
+            if (decided) {
+                if (!known || nowDegraded != wasDegraded) {
+                    reportLatencyEvent(
+                        monitorId,
+                        nowDegraded ? EventType::LATENCY_DEGRADED : EventType::LATENCY_RESTORED,
+                        recentSummary.meanLatency,
+                        baselineSummary.meanLatency,
+                        currentDateTime
                     );
                 }
+
+                checkedMonitors.insert(monitorId, nowDegraded);
+            } else if (known) {
+                checkedMonitors.insert(monitorId, wasDegraded);
             }
         }
+
+        currentDegradedMonitors.swap(checkedMonitors);
+    } else {
+        currentDegradedMonitors.clear();
+    }
+}
+
+
+void EventProcessor::checkHostSchemeSslExpiration(const HostScheme& hostScheme, unsigned long long currentDateTime) {
+    HostScheme::HostSchemeId hostSchemeId = hostScheme.hostSchemeId();
+    unsigned long long       expiration   = hostScheme.sslExpirationTimestamp();
+
+    unindexSslExpiration(hostSchemeId);
+
+    if (expiration != HostScheme::invalidSslExpirationTimestamp) {
+        unsigned long long threshold = currentDateTime + sslCertificateExpirationMarginSeconds;
+        if (expiration < threshold) {
+            if (!currentExpiringHostSchemes.value(hostSchemeId)) {
+                currentExpiringHostSchemes.insert(hostSchemeId, true);
+                reportSslEvent(hostScheme, EventType::SSL_CERTIFICATE_EXPIRING, currentDateTime);
+            }
+        } else {
+            if (currentExpiringHostSchemes.value(hostSchemeId, true)) {
+                currentExpiringHostSchemes.insert(hostSchemeId, false);
+                reportSslEvent(hostScheme, EventType::SSL_CERTIFICATE_RENEWED, currentDateTime);
+            }
+
+            unsigned long long triggerTime = expiration - sslCertificateExpirationMarginSeconds;
+            hostSchemeIdsByTriggerTime.insert(triggerTime, hostSchemeId);
+            triggerTimesByHostSchemeId.insert(hostSchemeId, triggerTime);
+        }
+    }
+}
+
+
+void EventProcessor::unindexSslExpiration(HostScheme::HostSchemeId hostSchemeId) {
+    QHash<HostScheme::HostSchemeId, unsigned long long>::iterator it = triggerTimesByHostSchemeId.find(hostSchemeId);
+    if (it != triggerTimesByHostSchemeId.end()) {
+        hostSchemeIdsByTriggerTime.remove(it.value(), hostSchemeId);
+        triggerTimesByHostSchemeId.erase(it);
+    }
+}
+
+
+void EventProcessor::reportSslEvent(
+        const HostScheme&         hostScheme,
+        EventProcessor::EventType eventType,
+        unsigned long long        currentDateTime
+    ) {
+    Monitors::MonitorList monitors = currentMonitors->getMonitorsUnderHostScheme(
+        hostScheme.hostSchemeId(),
+        timerDatabaseThreadId
+    );
+
+    if (!monitors.isEmpty()) {
+        const Monitor& monitor = monitors.first();
+
+        reportEvent(
+            hostScheme.customerId(),
+            monitor.monitorId(),
+            currentDateTime,
+            eventType,
+            MonitorStatus::WORKING,
+            tr("Expiration %1 UTC").arg(
+                QDateTime::fromMSecsSinceEpoch(hostScheme.sslExpirationTimestamp()).toString(
+                    Qt::DateFormat::RFC2822Date
+                )
+            ),
+            QByteArray(),
+            timerDatabaseThreadId
+        );
+    }
+}
+
+
+void EventProcessor::reportLatencyEvent(
+        EventProcessor::MonitorId monitorId,
+        EventProcessor::EventType eventType,
+        double                    recentMean,
+        double                    baselineMean,
+        unsigned long long        currentDateTime
+    ) {
+    Monitor monitor = currentMonitors->getMonitor(monitorId, timerDatabaseThreadId);
+    if (monitor.isValid()) {
+        reportEvent(
+            monitor.customerId(),
+            monitorId,
+            currentDateTime,
+            eventType,
+            MonitorStatus::WORKING,
+            tr("Mean latency %1 ms over 5 minutes, %2 ms over 24 hours")
+            .arg(recentMean / 1000.0, 0, 'f', 1)
+            .arg(baselineMean / 1000.0, 0, 'f', 1),
+            QByteArray(),
+            timerDatabaseThreadId
+        );
     }
 }
@@ -22,21 +22,43 @@
 #include <QString>
 #include <QByteArray>
 #include <QHash>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QVariant>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonValue>
 
 #include <cstdint>
+#include <algorithm>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "event.h"
 #include "latency_entry.h"
 #include "database_manager.h"
+#include "catalog.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
+#include "statement_pipeline.h"
+#include "periodic_scheduler.h"
+#include "job_scheduler.h"
 #include "events.h"
 
+const unsigned long Events::maximumEventsPerStatement = 500;
+const QString       Events::purgeJobType("event_purge");
+const QString       Events::retentionJobType("event_retention");
+const unsigned long Events::defaultPurgeBatchSize = 5000;
+const QString       Events::retentionTaskName("event_retention");
+
 /***********************************************************************************************************************
 * Events::Checker
 */
@@ -63,23 +85,17 @@ QString Events::Checker::queryString(
 }
 
 
-Events::EventDisposition Events::Checker::checkQuery(
-        QSqlQuery&            query,
-        Events::EventType     eventType,
-        Events::MonitorStatus monitorStatus,
-        Events::MonitorId     /* monitorId */,
-        const QByteArray&     /* hash */
+Events::EventDisposition Events::Checker::checkLastEvent(
+        const Events::LastEvent& lastEvent,
+        Events::EventType        eventType,
+        Events::MonitorStatus    monitorStatus,
+        Events::MonitorId        /* monitorId */,
+        const QByteArray&        /* hash */
     ) const {
-    EventDisposition result = EventDisposition::IGNORE;
+    EventDisposition result;
 
-    if (query.first()) {
-        int eventTypeField = query.record().indexOf("event_type");
-        if (eventTypeField >= 0) {
-            QString eventTypeString = query.value(eventTypeField).toString().toUpper();
-            if (eventTypeString != Event::toString(eventType)) {
-                result = EventDisposition::RECORD_AND_REPORT;
-            }
-        }
+    if (lastEvent.exists) {
+        result = lastEvent.eventType != eventType ? EventDisposition::RECORD_AND_REPORT : EventDisposition::IGNORE;
     } else {
         result = defaultDisposition(eventType, monitorStatus);
     }
@@ -88,6 +104,16 @@ Events::EventDisposition Events::Checker::checkQuery(
 }
 
 
+Events::EventClass Events::Checker::eventClass() const {
+    return EventClass::NONE;
+}
+
+
+bool Events::Checker::perHostScheme() const {
+    return false;
+}
+
+
 QString Events::Checker::queryCondition(MonitorId /* monitorId */, const QByteArray& /* hash */) const {
     Q_ASSERT(false);
     return QString();
@@ -95,7 +121,7 @@ QString Events::Checker::queryCondition(MonitorId /* monitorId */, const QByteAr
 
 
 QString Events::Checker::queryColumns() const {
-    return QString("event_type AS event_type");
+    return QString("event_type AS event_type, hash AS hash, timestamp AS timestamp");
 }
 
 
@@ -116,16 +142,21 @@ Events::PerHostSchemeChecker::PerHostSchemeChecker() {}
 Events::PerHostSchemeChecker::~PerHostSchemeChecker() {}
 
 
-QString Events::PerHostSchemeChecker::queryCondition(MonitorId monitorId, const QByteArray& /* hash */) const {
+bool Events::PerHostSchemeChecker::perHostScheme() const {
+    return true;
+}
+
+
+QString Events::PerHostSchemeChecker::queryCondition(MonitorId /* monitorId */, const QByteArray& /* hash */) const {
     QString queryCondition = QString(
             "monitor_id IN ("
                 "SELECT monitor_id FROM monitor WHERE host_scheme_id = ("
-                    "SELECT host_scheme_id FROM monitor WHERE monitor_id = %1"
+                    "SELECT host_scheme_id FROM monitor WHERE monitor_id = :monitor_id"
                 ")"
             ")"
         "AND "
-            "event_type IN (%2)"
-    ).arg(monitorId).arg(eventTypes());
+            "event_type IN (%1)"
+    ).arg(eventTypes());
 
     return queryCondition;
 }
@@ -140,8 +171,8 @@ Events::PerMonitorChecker::PerMonitorChecker() {}
 Events::PerMonitorChecker::~PerMonitorChecker() {}
 
 
-QString Events::PerMonitorChecker::queryCondition(MonitorId monitorId, const QByteArray& /* hash */) const {
-    return QString("monitor_id = %1 AND event_type IN (%2)").arg(monitorId).arg(eventTypes());
+QString Events::PerMonitorChecker::queryCondition(MonitorId /* monitorId */, const QByteArray& /* hash */) const {
+    return QString("monitor_id = :monitor_id AND event_type IN (%1)").arg(eventTypes());
 }
 
 /***********************************************************************************************************************
@@ -154,26 +185,18 @@ Events::HashedEventChecker::HashedEventChecker() {}
 Events::HashedEventChecker::~HashedEventChecker() {}
 
 
-Events::EventDisposition Events::HashedEventChecker::checkQuery(
-        QSqlQuery&            query,
-        Events::EventType     eventType,
-        Events::MonitorStatus monitorStatus,
-        Events::MonitorId     /* monitorId */,
-        const QByteArray&     hash
+Events::EventDisposition Events::HashedEventChecker::checkLastEvent(
+        const Events::LastEvent& lastEvent,
+        Events::EventType        eventType,
+        Events::MonitorStatus    monitorStatus,
+        Events::MonitorId        /* monitorId */,
+        const QByteArray&        hash
     ) const {
     EventDisposition result = EventDisposition::IGNORE;
 
-    if (query.first()) {
-        int eventTypeField = query.record().indexOf("event_type");
-        int hashField      = query.record().indexOf("hash");
-        if (eventTypeField >= 0 && hashField >= 0) {
-            QString eventTypeString = query.value(eventTypeField).toString().toUpper();
-            if (eventTypeString == Event::toString(eventType)) {
-                QByteArray previousHash = query.value(hashField).toByteArray();
-                if (previousHash != hash) {
-                    result = EventDisposition::RECORD_AND_REPORT;
-                }
-            }
+    if (lastEvent.exists) {
+        if (lastEvent.eventType == eventType && !lastEvent.recentHashes.contains(hash)) {
+            result = EventDisposition::RECORD_AND_REPORT;
         }
     } else {
         result = defaultDisposition(eventType, monitorStatus);
@@ -183,8 +206,20 @@ Events::EventDisposition Events::HashedEventChecker::checkQuery(
 }
 
 
-QString Events::HashedEventChecker::queryColumns() const {
-    return QString("event_type AS event_type, hash AS hash");
+QString Events::HashedEventChecker::queryString(
+        Events::EventType     /* eventType */,
+        Events::MonitorStatus /* monitorStatus */,
+        Events::MonitorId     monitorId,
+        const QByteArray&     hash
+    ) const {
+    return QString(
+        "SELECT %1 FROM event "
+            "WHERE "
+                "%2 "
+            "ORDER BY timestamp DESC, event_id DESC "
+            "LIMIT %3"
+    ).arg(queryColumns(), queryCondition(monitorId, hash))
+     .arg(LastEvent::maximumRecentHashes);
 }
 
 
@@ -205,6 +240,11 @@ Events::SslChecker::SslChecker() {}
 Events::SslChecker::~SslChecker() {}
 
 
+Events::EventClass Events::SslChecker::eventClass() const {
+    return EventClass::SSL_CERTIFICATE;
+}
+
+
 QString Events::SslChecker::eventTypes() const {
     return QString("'SSL_CERTIFICATE_EXPIRING', 'SSL_CERTIFICATE_RENEWED'");
 }
@@ -219,6 +259,11 @@ Events::WorkingChecker::WorkingChecker() {}
 Events::WorkingChecker::~WorkingChecker() {}
 
 
+Events::EventClass Events::WorkingChecker::eventClass() const {
+    return EventClass::AVAILABILITY;
+}
+
+
 QString Events::WorkingChecker::eventTypes() const {
     return QString("'WORKING', 'NO_RESPONSE'");
 }
@@ -241,6 +286,11 @@ Events::NoResponseChecker::NoResponseChecker() {}
 Events::NoResponseChecker::~NoResponseChecker() {}
 
 
+Events::EventClass Events::NoResponseChecker::eventClass() const {
+    return EventClass::AVAILABILITY;
+}
+
+
 QString Events::NoResponseChecker::eventTypes() const {
     return QString("'WORKING', 'NO_RESPONSE'");
 }
@@ -263,6 +313,11 @@ Events::ContentChangedChecker::ContentChangedChecker() {}
 Events::ContentChangedChecker::~ContentChangedChecker() {}
 
 
+Events::EventClass Events::ContentChangedChecker::eventClass() const {
+    return EventClass::CONTENT;
+}
+
+
 QString Events::ContentChangedChecker::eventTypes() const {
     return QString("'CONTENT_CHANGED'");
 }
@@ -277,6 +332,11 @@ Events::KeywordsChecker::KeywordsChecker() {}
 Events::KeywordsChecker::~KeywordsChecker() {}
 
 
+Events::EventClass Events::KeywordsChecker::eventClass() const {
+    return EventClass::KEYWORDS;
+}
+
+
 QString Events::KeywordsChecker::eventTypes() const {
     return QString("'KEYWORDS'");
 }
@@ -299,6 +359,51 @@ Events::SslCertificateRenewedChecker::SslCertificateRenewedChecker() {}
 
 Events::SslCertificateRenewedChecker::~SslCertificateRenewedChecker() {}
 
+/***********************************************************************************************************************
+* Events::LatencyChecker
+*/
+
+Events::LatencyChecker::LatencyChecker() {}
+
+
+Events::LatencyChecker::~LatencyChecker() {}
+
+
+Events::EventClass Events::LatencyChecker::eventClass() const {
+    return EventClass::LATENCY;
+}
+
+
+QString Events::LatencyChecker::eventTypes() const {
+    return QString("'LATENCY_DEGRADED', 'LATENCY_RESTORED'");
+}
+
+/***********************************************************************************************************************
+* Events::LatencyDegradedChecker
+*/
+
+Events::LatencyDegradedChecker::LatencyDegradedChecker() {}
+
+
+Events::LatencyDegradedChecker::~LatencyDegradedChecker() {}
+
+
+Events::EventDisposition Events::LatencyDegradedChecker::defaultDisposition(
+        EventType     /* eventType */,
+        MonitorStatus /* monitorStatus */
+    ) const {
+    return EventDisposition::RECORD_AND_REPORT;
+}
+
+/***********************************************************************************************************************
+* Events::LatencyRestoredChecker
+*/
+
+Events::LatencyRestoredChecker::LatencyRestoredChecker() {}
+
+
+Events::LatencyRestoredChecker::~LatencyRestoredChecker() {}
+
 /***********************************************************************************************************************
 * Events::CustomerEventChecker
 */
@@ -331,8 +436,9 @@ QString Events::CustomerEventChecker::queryCondition(
 * Events
 */
 
-Events::Events(DatabaseManager* databaseManager, QObject* parent):QObject(parent) {
+Events::Events(DatabaseManager* databaseManager, Catalog* catalog, QObject* parent):QObject(parent) {
     currentDatabaseManager = databaseManager;
+    currentCatalog         = catalog;
 
     eventCheckers.insert(EventType::WORKING,                  new WorkingChecker);
     eventCheckers.insert(EventType::NO_RESPONSE,              new NoResponseChecker);
@@ -354,10 +460,34 @@ Events::Events(DatabaseManager* databaseManager, QObject* parent):QObject(parent
     eventCheckers.insert(EventType::INQUIRY,                  new CustomerEventChecker);
     eventCheckers.insert(EventType::SUPPORT_REQUEST,          new CustomerEventChecker);
     eventCheckers.insert(EventType::STORAGE_LIMIT_REACHED,    new CustomerEventChecker);
+    eventCheckers.insert(EventType::LATENCY_DEGRADED,         new LatencyDegradedChecker);
+    eventCheckers.insert(EventType::LATENCY_RESTORED,         new LatencyRestoredChecker);
+
+    currentJobScheduler    = nullptr;
+    currentMaximumEventAge = 0;
+    currentPartitionPeriod = 0;
+    currentPurgeBatchSize  = defaultPurgeBatchSize;
+
+    retentionPending.storeRelease(0);
+
+    // Retention is left out of the database maintenance group because the job may wait behind other admin jobs.
+    retentionTaskId = PeriodicScheduler::instance()->registerTask(
+        retentionTaskName,
+        QString(),
+        0,
+        [this]() {
+            startRetention();
+        },
+        [this]() {
+            return retentionPending.loadAcquire() != 0;
+        }
+    );
 }
 
 
 Events::~Events() {
+    PeriodicScheduler::instance()->unregisterTask(retentionTaskId);
+
     for (  QHash<EventType, Checker*>::const_iterator it  = eventCheckers.constBegin(),
                                                       end = eventCheckers.constEnd()
          ; it != end
@@ -377,134 +507,180 @@ Event Events::recordEvent(
         const QByteArray&  hash,
         unsigned           threadId
     ) {
-    Event result;
+    EventList recorded = recordEvents(
+        EventList() << Event(
+            invalidEventId,
+            monitorId,
+            customerId,
+            toZoranTimestamp(unixTimestamp),
+            eventType,
+            message,
+            hash
+        ),
+        threadId
+    );
+
+    return recorded.isEmpty() ? Event() : recorded.first();
+}
+
+
+Events::EventList Events::recordEvents(const Events::EventList& events, unsigned threadId) {
+    EventList result;
+
+    // Determine the status each monitor will be left in.  Only the final status of each monitor is written.
+
+    QHash<MonitorId, MonitorStatus> oldStatuses;
+    QHash<MonitorId, MonitorStatus> newStatuses;
+    for (EventList::const_iterator it=events.constBegin(),end=events.constEnd() ; it!=end ; ++it) {
+        MonitorId monitorId = it->monitorId();
+        if (!oldStatuses.contains(monitorId)) {
+            oldStatuses.insert(monitorId, monitorStatus(monitorId, threadId));
+        }
 
-    MonitorStatus currentStatus = monitorStatus(monitorId, threadId);
+        newStatuses.insert(monitorId, statusAfterEvent(it->eventType()));
+    }
+
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Events::recordEvents")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
 
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
-    if (success) {
+    if (success && !events.isEmpty()) {
         if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
             database.transaction();
         }
 
-        ZoranTimeStamp zoranTimestamp = toZoranTimestamp(unixTimestamp);
-        QString        queryString    = QString(
-            "INSERT INTO event (monitor_id, customer_id, timestamp, event_type, message, hash) "
-            "VALUES (:monitor_id, :customer_id, :timestamp, :event_type, :message, :hash)"
-        );
-
         QSqlQuery query(database);
         query.setForwardOnly(true);
 
-        success = query.prepare(queryString);
-        if (success) {
-            query.bindValue(":monitor_id", monitorId);
-            query.bindValue(":customer_id", customerId);
-            query.bindValue(":timestamp", zoranTimestamp);
-            query.bindValue(":event_type", Event::toString(eventType));
-            query.bindValue(":message", message);
-            query.bindValue(":hash", hash);
+        QList<EventId> eventIds;
+        unsigned long  numberEvents = static_cast<unsigned long>(events.size());
+        unsigned long  index        = 0;
+        while (success && index < numberEvents) {
+            unsigned long numberRows  = std::min(numberEvents - index, maximumEventsPerStatement);
+            QString       queryString = QString(
+                "INSERT INTO event (monitor_id, customer_id, timestamp, event_type, message, hash) VALUES "
+            );
 
-            success = query.exec();
-            if (success) {
-                QVariant eventIdVariant = query.lastInsertId();
-                if (eventIdVariant.isValid()) {
-                    EventId eventId = eventIdVariant.toUInt(&success);
-                    if (success && eventId > 0) {
-                        MonitorStatus newStatus;
-                        QString       newStatusString;
-                        if (eventType == EventType::CONTENT_CHANGED          ||
-                            eventType == EventType::WORKING                  ||
-                            eventType == EventType::KEYWORDS                 ||
-                            eventType == EventType::SSL_CERTIFICATE_EXPIRING ||
-                            eventType == EventType::SSL_CERTIFICATE_RENEWED  ||
-                            Event::isCustomerEvent(eventType)                   ) {
-                            newStatus       = MonitorStatus::WORKING;
-                            newStatusString = QString("WORKING");
-                        } else {
-                            newStatus       = MonitorStatus::FAILED;
-                            newStatusString = QString("FAILED");
-                        }
+            for (unsigned long row=0 ; row<numberRows ; ++row) {
+                queryString += row == 0 ? QString("(?, ?, ?, ?, ?, ?)") : QString(", (?, ?, ?, ?, ?, ?)");
+            }
 
-                        if (newStatus != currentStatus) {
-                            if (currentStatus == MonitorStatus::UNKNOWN) {
-                                queryString = QString("INSERT INTO monitor_status (monitor_id, status) VALUES (%1, '%2')")
-                                              .arg(monitorId)
-                                              .arg(newStatusString);
-                            } else {
-                                queryString = QString("UPDATE monitor_status SET status = '%1' WHERE monitor_id = %2")
-                                              .arg(newStatusString)
-                                              .arg(monitorId);
-                            }
+            // PostgreSQL returns the generated event IDs in the order the rows were supplied.
+            queryString += QString(" RETURNING event_id");
 
-                            success = query.exec(queryString);
-                            if (success) {
-                                result = Event(
-                                    eventId,
-                                    monitorId,
-                                    customerId,
-                                    zoranTimestamp,
-                                    eventType,
-                                    message,
-                                    hash
-                                );
-                            } else {
-                                if (currentStatus == MonitorStatus::UNKNOWN) {
-                                    logWrite(
-                                        QString("Failed INSERT into monitor_status - Events::recordEvent: %1")
-                                        .arg(query.lastError().text()),
-                                        true
-                                    );
-                                } else {
-                                    logWrite(
-                                        QString("Failed UPDATE into monitor_status - Events::recordEvent: %1")
-                                        .arg(query.lastError().text()),
-                                        true
-                                    );
-                                }
-                            }
+            success = query.prepare(queryString);
+            if (success) {
+                for (unsigned long row=0 ; row<numberRows ; ++row) {
+                    const Event& event = events.at(index + row);
+                    query.addBindValue(event.monitorId());
+                    query.addBindValue(event.customerId());
+                    query.addBindValue(event.zoranTimestamp());
+                    query.addBindValue(Event::toString(event.eventType()));
+                    query.addBindValue(event.message());
+                    query.addBindValue(event.hash());
+                }
+
+                success = SqlHelpers::execute(query);
+                if (success) {
+                    while (success && query.next()) {
+                        EventId eventId = query.value(0).toUInt(&success);
+                        if (success && eventId > 0) {
+                            eventIds.append(eventId);
                         } else {
-                            result = Event(
-                                eventId,
-                                monitorId,
-                                customerId,
-                                zoranTimestamp,
-                                eventType,
-                                message,
-                                hash
-                            );
+                            logWrite(QString("Invalid event ID - Events::recordEvents"), true);
+                            success = false;
                         }
-                    } else {
-                        logWrite(QString("Invalid event ID - Events::recordEvent"), true);
+                    }
+
+                    index += numberRows;
+                    if (success && static_cast<unsigned long>(eventIds.size()) != index) {
+                        logWrite(QString("Failed to obtain event IDs - Events::recordEvents"), true);
+                        success = false;
                     }
                 } else {
                     logWrite(
-                        QString("Failed to get field index - Events::recordEvent: %1")
+                        QString("Failed INSERT into event (exec) - Events::recordEvents: %1")
                         .arg(query.lastError().text()),
                         true
                     );
                 }
             } else {
                 logWrite(
-                    QString("Failed INSERT into event (exec) - Events::recordEvent: %1")
+                    QString("Failed INSERT into event (prepare) - Events::recordEvents: %1")
                     .arg(query.lastError().text()),
                     true
                 );
             }
-        } else {
-            logWrite(
-                QString("Failed INSERT into event (prepare) - Events::recordEvent: %1")
-                .arg(query.lastError().text()),
-                true
-            );
+        }
+
+        if (success) {
+            QStringList insertedStatuses;
+            QStringList workingMonitorIds;
+            QStringList failedMonitorIds;
+            for (  QHash<MonitorId, MonitorStatus>::const_iterator it  = newStatuses.constBegin(),
+                                                                   end = newStatuses.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                MonitorId     monitorId = it.key();
+                MonitorStatus newStatus = it.value();
+                MonitorStatus oldStatus = oldStatuses.value(monitorId);
+
+                if (newStatus != oldStatus) {
+                    if (oldStatus == MonitorStatus::UNKNOWN) {
+                        insertedStatuses.append(
+                            QString("(%1, '%2')")
+                            .arg(monitorId)
+                            .arg(newStatus == MonitorStatus::WORKING ? QString("WORKING") : QString("FAILED"))
+                        );
+                    } else if (newStatus == MonitorStatus::WORKING) {
+                        workingMonitorIds.append(QString::number(monitorId));
+                    } else {
+                        failedMonitorIds.append(QString::number(monitorId));
+                    }
+                }
+            }
+
+            StatementPipeline pipeline(database);
+            if (!insertedStatuses.isEmpty()) {
+                pipeline.append(
+                    QString("INSERT INTO monitor_status (monitor_id, status) VALUES %1")
+                    .arg(insertedStatuses.join(", "))
+                );
+            }
+
+            if (!workingMonitorIds.isEmpty()) {
+                pipeline.append(
+                    QString("UPDATE monitor_status SET status = 'WORKING' WHERE monitor_id IN (%1)")
+                    .arg(workingMonitorIds.join(", "))
+                );
+            }
+
+            if (!failedMonitorIds.isEmpty()) {
+                pipeline.append(
+                    QString("UPDATE monitor_status SET status = 'FAILED' WHERE monitor_id IN (%1)")
+                    .arg(failedMonitorIds.join(", "))
+                );
+            }
+
+            success = pipeline.execute();
+            if (!success) {
+                logWrite(
+                    QString("Failed to update monitor_status - Events::recordEvents: %1").arg(pipeline.lastError()),
+                    true
+                );
+            }
         }
 
         if (success) {
             success = database.commit();
             if (!success) {
                 logWrite(
-                    QString("Failed commit - Events::recordEvent: %1")
+                    QString("Failed commit - Events::recordEvents: %1")
                     .arg(database.lastError().text()),
                     true
                 );
@@ -513,21 +689,89 @@ Event Events::recordEvent(
             bool rollbackSuccess = database.rollback();
             if (!rollbackSuccess) {
                 logWrite(
-                    QString("Failed rollback - Events::recordEvent: %1")
+                    QString("Failed rollback - Events::recordEvents: %1")
                     .arg(database.lastError().text()),
                     true
                 );
             }
         }
-    } else {
+
+        if (success) {
+            unsigned long numberIds = static_cast<unsigned long>(eventIds.size());
+            for (unsigned long i=0 ; i<numberIds ; ++i) {
+                const Event& event = events.at(i);
+                result.append(
+                    Event(
+                        eventIds.at(i),
+                        event.monitorId(),
+                        event.customerId(),
+                        event.zoranTimestamp(),
+                        event.eventType(),
+                        event.message(),
+                        event.hash()
+                    )
+                );
+            }
+
+            QSet<CustomerId> changedCustomerIds;
+            for (EventList::const_iterator it=events.constBegin(),end=events.constEnd() ; it!=end ; ++it) {
+                changedCustomerIds.insert(it->customerId());
+            }
+
+            for (  QSet<CustomerId>::const_iterator it  = changedCustomerIds.constBegin(),
+                                                    end = changedCustomerIds.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                currentCatalog->customerChanged(*it);
+            }
+        }
+    } else if (!success) {
         logWrite(
-            QString("Failed to open database - Events::recordEvent: %1")
+            QString("Failed to open database - Events::recordEvents: %1")
             .arg(database.lastError().text()),
             true
         );
     }
 
     currentDatabaseManager->closeAndRelease(database);
+
+    if (!result.isEmpty()) {
+        QList<std::uint64_t> keys;
+        for (EventList::const_iterator it=result.constBegin(),end=result.constEnd() ; it!=end ; ++it) {
+            Checker* checker = eventCheckers.value(it->eventType(), nullptr);
+            keys.append(
+                  checker != nullptr && checker->eventClass() != EventClass::NONE
+                ? stateKey(checker, it->monitorId(), threadId)
+                : 0
+            );
+        }
+
+        QMutexLocker locker(&stateMutex);
+
+        for (  QHash<MonitorId, MonitorStatus>::const_iterator it  = newStatuses.constBegin(),
+                                                               end = newStatuses.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            monitorStatuses.insert(it.key(), it.value());
+        }
+
+        unsigned long numberEvents = static_cast<unsigned long>(result.size());
+        for (unsigned long i=0 ; i<numberEvents ; ++i) {
+            std::uint64_t key = keys.at(i);
+            if (key != 0) {
+                const Event&                              event = result.at(i);
+                QHash<std::uint64_t, LastEvent>::iterator it    = lastEvents.find(key);
+                if (it != lastEvents.end() && (!it->exists || it->zoranTimestamp <= event.zoranTimestamp())) {
+                    LastEvent lastEvent(event.eventType(), event.zoranTimestamp(), event.hash());
+                    lastEvent.retainHashes(*it);
+                    *it = lastEvent;
+                }
+            }
+        }
+    }
+
     return result;
 }
 
@@ -535,52 +779,26 @@ Event Events::recordEvent(
 Events::MonitorStatus Events::monitorStatus(Events::MonitorId monitorId, unsigned threadId) {
     MonitorStatus result = MonitorStatus::UNKNOWN;
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+    stateMutex.lock();
+    QHash<MonitorId, MonitorStatus>::const_iterator it    = monitorStatuses.constFind(monitorId);
+    bool                                            found = (it != monitorStatuses.constEnd());
+    if (found) {
+        result = it.value();
+    }
+    stateMutex.unlock();
 
-        success = query.exec(QString("SELECT * FROM monitor_status WHERE monitor_id = %1").arg(monitorId));
-        if (success) {
-            if (query.first()) {
-                int statusField = query.record().indexOf("status");
-                if (statusField >= 0) {
-                    QString statusString = query.value(statusField).toString().toLower();
-                    if (statusString == QString("working")) {
-                        result = MonitorStatus::WORKING;
-                    } else if (statusString == QString("failed")) {
-                        result = MonitorStatus::FAILED;
-                    } else if (statusString == QString("unknown")) {
-                        result = MonitorStatus::UNKNOWN;
-                    } else {
-                        logWrite(
-                            QString("Failed invalid status value - Events::monitorStatus: \"%1\"")
-                            .arg(statusString),
-                            true
-                        );
-                    }
-                } else {
-                    logWrite(QString("Failed invalid status field index - Events::monitorStatus"), true);
-                }
-            } else {
-                // We're OK but there's no record.  Return UNKNOWN status.
-            }
+    // The database is read without holding the state mutex.  An entry written by a concurrent recordEvents call while
+    // we were reading is newer than what we read so we only fill in entries that are still missing.
+
+    if (!found && readMonitorStatus(result, monitorId, threadId)) {
+        QMutexLocker locker(&stateMutex);
+        if (!monitorStatuses.contains(monitorId)) {
+            monitorStatuses.insert(monitorId, result);
         } else {
-            logWrite(
-                QString("Failed SELECT - Events::monitorStatus: %1").arg(query.lastError().text()),
-                true
-            );
+            result = monitorStatuses.value(monitorId);
         }
-    } else {
-        logWrite(
-            QString("Failed to open database - Events::recordEvent: %1")
-            .arg(database.lastError().text()),
-            true
-        );
     }
 
-    currentDatabaseManager->closeAndRelease(database);
     return result;
 }
 
@@ -588,6 +806,12 @@ Events::MonitorStatus Events::monitorStatus(Events::MonitorId monitorId, unsigne
 Events::MonitorStatusByMonitorId Events::monitorStatusByCustomerId(Events::CustomerId customerId, unsigned threadId) {
     MonitorStatusByMonitorId result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Events::monitorStatusByCustomerId")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -604,7 +828,7 @@ Events::MonitorStatusByMonitorId Events::monitorStatusByCustomerId(Events::Custo
             ).arg(customerId);
         }
 
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             int monitorIdField = query.record().indexOf("monitor_id");
             int statusField    = query.record().indexOf("status");
@@ -662,13 +886,19 @@ Events::MonitorStatusByMonitorId Events::monitorStatusByCustomerId(Events::Custo
 Event Events::getEvent(Events::EventId eventId, unsigned threadId) {
     Event result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Events::getEvent")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
         QSqlQuery query(database);
 
         QString queryString = QString("SELECT * FROM event WHERE event_id = %1").arg(eventId);
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             if (query.first()) {
                 int eventIdField    = query.record().indexOf("event_id");
@@ -747,58 +977,35 @@ Events::EventList Events::getEventsByCustomer(
         unsigned long long endingTimestamp,
         unsigned           threadId
     ) {
-    EventList result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-
-        ZoranTimeStamp startZoranTimestamp = toZoranTimestamp(startTimestamp);
-        ZoranTimeStamp endZoranTimestamp   = toZoranTimestamp(endingTimestamp);
-        QString        queryString         = QString("SELECT * FROM event");
-        bool           hasCondition        = false;
-
-        if (customerId != invalidCustomerId) {
-            queryString += QString(" WHERE customer_id = %1").arg(customerId);
-            hasCondition = true;
-        }
-
-        if (startZoranTimestamp != 0) {
-            if (hasCondition) {
-                queryString += QString(" AND timestamp >= %1").arg(startZoranTimestamp);
-            } else {
-                queryString += QString(" WHERE timestamp >= %1").arg(startZoranTimestamp);
-                hasCondition = true;
-            }
-        }
-
-        if (endZoranTimestamp != std::numeric_limits<ZoranTimeStamp>::max()) {
-            if (hasCondition) {
-                queryString += QString(" AND timestamp <= %1").arg(endZoranTimestamp);
-            } else {
-                queryString += QString(" WHERE timestamp <= %1").arg(endZoranTimestamp);
-                // hasCondition = true;
-            }
-        }
+    return queryEvents(
+        customerCondition(customerId),
+        startTimestamp,
+        endingTimestamp,
+        Cursor(),
+        unlimitedPageSize,
+        false,
+        threadId
+    );
+}
 
-        queryString += QString(" ORDER BY timestamp ASC");
-        success = query.exec(queryString);
-        if (success) {
-            result = parseLongQuery(query);
-        } else {
-            logWrite(QString("Failed SELECT - Events::getEvents: %1").arg(query.lastError().text()), true);
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database - Events::recordEvent: %1")
-            .arg(database.lastError().text()),
-            true
-        );
-    }
 
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+Events::EventList Events::getEventsByCustomer(
+        Events::CustomerId    customerId,
+        unsigned long long    startTimestamp,
+        unsigned long long    endingTimestamp,
+        const Events::Cursor& after,
+        unsigned long         pageSize,
+        unsigned              threadId
+    ) {
+    return queryEvents(
+        customerCondition(customerId),
+        startTimestamp,
+        endingTimestamp,
+        after,
+        pageSize,
+        true,
+        threadId
+    );
 }
 
 
@@ -808,42 +1015,35 @@ Events::EventList Events::getEventsByMonitor(
         unsigned long long endingTimestamp,
         unsigned           threadId
     ) {
-    EventList result;
+    return queryEvents(
+        monitorCondition(monitorId),
+        startTimestamp,
+        endingTimestamp,
+        Cursor(),
+        unlimitedPageSize,
+        false,
+        threadId
+    );
+}
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-
-        ZoranTimeStamp startZoranTimestamp = toZoranTimestamp(startTimestamp);
-        ZoranTimeStamp endZoranTimestamp   = toZoranTimestamp(endingTimestamp);
-        QString        queryString         = QString("SELECT * FROM event WHERE monitor_id = %1").arg(monitorId);
-
-        if (startZoranTimestamp != 0) {
-            queryString += QString(" AND timestamp >= %1").arg(startZoranTimestamp);
-        }
-
-        if (endZoranTimestamp != std::numeric_limits<ZoranTimeStamp>::max()) {
-            queryString += QString(" AND timestamp <= %1").arg(endZoranTimestamp);
-        }
-
-        queryString += QString(" ORDER BY timestamp ASC");
-        success = query.exec(queryString);
-        if (success) {
-            result = parseLongQuery(query);
-        } else {
-            logWrite(QString("Failed SELECT - Events::getEventsByMonitor: %1").arg(query.lastError().text()), true);
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database - Events::recordEvent: %1")
-            .arg(database.lastError().text()),
-            true
-        );
-    }
 
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+Events::EventList Events::getEventsByMonitor(
+        Events::MonitorId     monitorId,
+        unsigned long long    startTimestamp,
+        unsigned long long    endingTimestamp,
+        const Events::Cursor& after,
+        unsigned long         pageSize,
+        unsigned              threadId
+    ) {
+    return queryEvents(
+        monitorCondition(monitorId),
+        startTimestamp,
+        endingTimestamp,
+        after,
+        pageSize,
+        true,
+        threadId
+    );
 }
 
 
@@ -860,27 +1060,28 @@ Events::EventDisposition Events::eventDisposition(
     if (checker != nullptr) {
         QString queryString = checker->queryString(eventType, monitorStatus, monitorId, hash);
         if (!queryString.isEmpty()) {
-            QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-            bool success = database.isOpen();
-            if (success) {
-                QSqlQuery query(database);
-                query.setForwardOnly(true);
-
-                success = query.exec(queryString);
-                if (success) {
-                    result = checker->checkQuery(query, eventType, monitorStatus, monitorId, hash);
-                } else {
-                    logWrite(QString("Failed exec when checking for a repeat event: %1").arg(queryString), true);
+            std::uint64_t key = stateKey(checker, monitorId, threadId);
+
+            stateMutex.lock();
+            QHash<std::uint64_t, LastEvent>::const_iterator it        = lastEvents.constFind(key);
+            bool                                            found     = (it != lastEvents.constEnd());
+            LastEvent                                       lastEvent = found ? it.value() : LastEvent();
+            stateMutex.unlock();
+
+            if (found) {
+                result = checker->checkLastEvent(lastEvent, eventType, monitorStatus, monitorId, hash);
+            } else if (readLastEvent(lastEvent, queryString, monitorId, threadId)) {
+                if (key != 0) {
+                    QMutexLocker locker(&stateMutex);
+                    if (!lastEvents.contains(key)) {
+                        lastEvents.insert(key, lastEvent);
+                    } else {
+                        lastEvent = lastEvents.value(key);
+                    }
                 }
-            } else {
-                logWrite(
-                    QString("Failed to open database - Events::isRepeatEvent: %1")
-                    .arg(database.lastError().text()),
-                    true
-                );
-            }
 
-            currentDatabaseManager->closeAndRelease(database);
+                result = checker->checkLastEvent(lastEvent, eventType, monitorStatus, monitorId, hash);
+            }
         } else {
             result = EventDisposition::RECORD_AND_REPORT;
         }
@@ -892,31 +1093,145 @@ Events::EventDisposition Events::eventDisposition(
 }
 
 
-void Events::purgeEvents(CustomerId customerId, unsigned long long timestamp, unsigned threadId) {
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+void Events::setJobScheduler(JobScheduler* jobScheduler) {
+    currentJobScheduler = jobScheduler;
+
+    currentJobScheduler->registerJobType(
+        purgeJobType,
+        1,
+        [this](const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId) {
+            return runPurge(parameters, progress, threadId);
+        }
+    );
+    currentJobScheduler->registerJobType(
+        retentionJobType,
+        1,
+        [this](const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId) {
+            return runRetention(parameters, progress, threadId);
+        }
+    );
+
+    updateSchedule();
+}
+
+
+void Events::setRetention(unsigned long maximumAge, unsigned long partitionPeriod) {
+    retentionMutex.lock();
+    currentMaximumEventAge = maximumAge;
+    currentPartitionPeriod = partitionPeriod;
+    retentionMutex.unlock();
+
+    updateSchedule();
+}
+
+
+void Events::setPurgeBatchSize(unsigned long batchSize) {
+    QMutexLocker locker(&retentionMutex);
+    currentPurgeBatchSize = std::max(batchSize, 1UL);
+}
+
+
+JobScheduler::JobId Events::purgeEvents(CustomerId customerId, unsigned long long timestamp, unsigned threadId) {
+    JobScheduler::JobId result = JobScheduler::invalidJobId;
+
+    if (currentJobScheduler != nullptr) {
+        QJsonObject parameters;
+        parameters.insert("customer_id", static_cast<double>(customerId));
+        parameters.insert("timestamp", static_cast<double>(timestamp));
+
+        result = currentJobScheduler->submit(purgeJobType, parameters, threadId);
+    } else {
+        logWrite(QString("No job scheduler - Events::purgeEvents"), true);
+    }
+
+    return result;
+}
+
+
+QString Events::customerCondition(Events::CustomerId customerId) {
+    return customerId != invalidCustomerId ? QString("customer_id = %1").arg(customerId) : QString();
+}
+
+
+QString Events::monitorCondition(Events::MonitorId monitorId) {
+    return QString("monitor_id = %1").arg(monitorId);
+}
+
+
+Events::EventList Events::queryEvents(
+        const QString&        keyCondition,
+        unsigned long long    startTimestamp,
+        unsigned long long    endingTimestamp,
+        const Events::Cursor& after,
+        unsigned long         pageSize,
+        bool                  readReplica,
+        unsigned              threadId
+    ) {
+    EventList result;
+
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Events::queryEvents")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+    QString      instanceName = QString::number(threadId);
+    QSqlDatabase database     =   readReplica
+                                ? currentDatabaseManager->getReadDatabase(instanceName)
+                                : currentDatabaseManager->getDatabase(instanceName);
     bool success = database.isOpen();
     if (success) {
         QSqlQuery query(database);
 
-        ZoranTimeStamp zoranTimestamp = toZoranTimestamp(timestamp);
-        QString queryString = QString("DELETE FROM regions WHERE timestamp <= %1").arg(zoranTimestamp);
-        if (customerId != invalidCustomerId) {
-            queryString += QString(" AND customer_id = %1").arg(customerId);
+        ZoranTimeStamp startZoranTimestamp = toZoranTimestamp(startTimestamp);
+        ZoranTimeStamp endZoranTimestamp   = toZoranTimestamp(endingTimestamp);
+        QStringList    conditions;
+
+        if (!keyCondition.isEmpty()) {
+            conditions.append(keyCondition);
+        }
+
+        if (startZoranTimestamp != 0) {
+            conditions.append(QString("timestamp >= %1").arg(startZoranTimestamp));
+        }
+
+        if (endZoranTimestamp != std::numeric_limits<ZoranTimeStamp>::max()) {
+            conditions.append(QString("timestamp <= %1").arg(endZoranTimestamp));
+        }
+
+        if (after.isValid()) {
+            // Row comparison lets the (key, timestamp, event_id) index seek directly to the start of the page.
+            conditions.append(
+                QString("(timestamp, event_id) > (%1, %2)").arg(after.zoranTimestamp()).arg(after.eventId())
+            );
         }
 
-        success = query.exec(queryString);
-        if (!success) {
-            logWrite(QString("Failed DEKETE - Events::purgeEvents: %1").arg(query.lastError().text()), true);
+        QString queryString = QString("SELECT * FROM event");
+        if (!conditions.isEmpty()) {
+            queryString += QString(" WHERE ") + conditions.join(QString(" AND "));
+        }
+
+        queryString += QString(" ORDER BY timestamp ASC, event_id ASC");
+        if (pageSize != unlimitedPageSize) {
+            queryString += QString(" LIMIT %1").arg(pageSize);
+        }
+
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            result = parseLongQuery(query);
+        } else {
+            logWrite(QString("Failed SELECT - Events::queryEvents: %1").arg(query.lastError().text()), true);
         }
     } else {
         logWrite(
-            QString("Failed to open database - Events::recordEvent: %1")
+            QString("Failed to open database - Events::queryEvents: %1")
             .arg(database.lastError().text()),
             true
         );
     }
 
     currentDatabaseManager->closeAndRelease(database);
+    return result;
 }
 
 
@@ -1001,7 +1316,158 @@ Events::EventList Events::parseLongQuery(QSqlQuery& sqlQuery) {
 }
 
 
+void Events::startRetention() {
+    if (currentJobScheduler != nullptr && retentionPending.testAndSetOrdered(0, 1)) {
+        JobScheduler::JobId jobId = currentJobScheduler->submit(retentionJobType, QJsonObject());
+        if (jobId == JobScheduler::invalidJobId) {
+            retentionPending.storeRelease(0);
+        }
+    }
+}
+
+
+bool Events::runRetention(const QJsonObject& /* parameters */, JobScheduler::Progress& progress, unsigned threadId) {
+    retentionMutex.lock();
+    unsigned long maximumAge      = currentMaximumEventAge;
+    unsigned long partitionPeriod = currentPartitionPeriod;
+    retentionMutex.unlock();
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        unsigned long long currentTime           = QDateTime::currentSecsSinceEpoch();
+        long long          currentZoranTimestamp = toZoranTimestamp(currentTime);
+
+        if (partitionPeriod > 0) {
+            success = SqlHelpers::createPartitions(
+                database,
+                QString("event"),
+                static_cast<long long>(partitionPeriod),
+                currentZoranTimestamp,
+                currentZoranTimestamp + static_cast<long long>(partitionsAhead * partitionPeriod)
+            );
+        }
+
+        if (maximumAge > 0 && currentTime > maximumAge) {
+            long long keyThreshold = toZoranTimestamp(currentTime - maximumAge);
+
+            bool partitioned;
+            success = SqlHelpers::dropPartitions(database, QString("event"), keyThreshold, partitioned) && success;
+
+            // Only entries in the partition straddling the threshold, or in the default partition, remain.
+            success = deleteEvents(database, QString("timestamp < %1").arg(keyThreshold), progress) && success;
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Events::runRetention: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    retentionPending.storeRelease(0);
+
+    return success;
+}
+
+
+bool Events::runPurge(const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId) {
+    CustomerId customerId = static_cast<CustomerId>(
+        parameters.value("customer_id").toDouble(static_cast<double>(invalidCustomerId))
+    );
+    long long keyThreshold = toZoranTimestamp(
+        static_cast<unsigned long long>(parameters.value("timestamp").toDouble(0))
+    );
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QString condition = QString("timestamp <= %1").arg(keyThreshold);
+        if (customerId != invalidCustomerId) {
+            condition += QString(" AND customer_id = %1").arg(customerId);
+        } else {
+            bool partitioned;
+            success = SqlHelpers::dropPartitions(database, QString("event"), keyThreshold + 1, partitioned);
+        }
+
+        success = deleteEvents(database, condition, progress) && success;
+
+        // The purge may have removed the last event of a class so the state table is reloaded as events arrive.
+        stateMutex.lock();
+        lastEvents.clear();
+        stateMutex.unlock();
+
+        if (customerId != invalidCustomerId) {
+            currentCatalog->customerChanged(customerId);
+        } else {
+            currentCatalog->allCustomersChanged();
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Events::runPurge: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+bool Events::deleteEvents(QSqlDatabase& database, const QString& condition, JobScheduler::Progress& progress) {
+    retentionMutex.lock();
+    unsigned long batchSize = currentPurgeBatchSize;
+    retentionMutex.unlock();
+
+    QSqlQuery          query(database);
+    unsigned long long rowsDeleted = 0;
+    bool               finished    = false;
+    bool               success     = true;
+
+    while (success && !finished && !progress.cancelRequested()) {
+        // Each batch commits on its own.  Rows are addressed by table OID and tuple ID so batches work across the
+        // partitions of the event table.
+        success = SqlHelpers::execute(
+            query,
+            QString(
+                "DELETE FROM event WHERE (tableoid, ctid) IN ("
+                    "SELECT tableoid, ctid FROM event WHERE %1 LIMIT %2"
+                ")"
+            ).arg(condition)
+             .arg(batchSize)
+        );
+
+        if (success) {
+            int           numberRowsAffected = query.numRowsAffected();
+            unsigned long batchRowsDeleted   = static_cast<unsigned long>(std::max(numberRowsAffected, 0));
+
+            rowsDeleted += batchRowsDeleted;
+            finished     = batchRowsDeleted < batchSize;
+
+            progress.setProgress(rowsDeleted, finished ? rowsDeleted : 0);
+        } else {
+            logWrite(QString("Failed DELETE - Events::deleteEvents: %1").arg(query.lastError().text()), true);
+        }
+    }
+
+    return success;
+}
+
+
+void Events::updateSchedule() {
+    retentionMutex.lock();
+    bool retained = currentMaximumEventAge != 0 || currentPartitionPeriod != 0;
+    retentionMutex.unlock();
+
+    PeriodicScheduler::instance()->setPeriod(
+        retentionTaskId,
+        retained && currentJobScheduler != nullptr ? retentionPeriod : 0
+    );
+}
+
+
 Events::ZoranTimeStamp Events::toZoranTimestamp(unsigned long long unixTimestamp) {
+
     unsigned long long result =   unixTimestamp < LatencyEntry::startOfZoranEpoch
                                 ? 0
                                 : unixTimestamp - LatencyEntry::startOfZoranEpoch;
@@ -1012,3 +1478,168 @@ Events::ZoranTimeStamp Events::toZoranTimestamp(unsigned long long unixTimestamp
 
     return static_cast<ZoranTimeStamp>(result);
 }
+
+
+std::uint64_t Events::stateKey(const Events::Checker* checker, Events::MonitorId monitorId, unsigned threadId) {
+    std::uint64_t scopeId;
+    if (checker->perHostScheme()) {
+        scopeId = currentCatalog->snapshot(threadId)->monitor(monitorId).hostSchemeId();
+    } else {
+        scopeId = monitorId;
+    }
+
+    return scopeId != 0 ? (scopeId << 8) | static_cast<unsigned>(checker->eventClass()) : 0;
+}
+
+
+bool Events::readLastEvent(
+        Events::LastEvent& lastEvent,
+        const QString&     queryString,
+        Events::MonitorId  monitorId,
+        unsigned           threadId
+    ) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Events::readLastEvent")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query = currentDatabaseManager->preparedQuery(database, queryString, &success);
+        if (success) {
+            query.bindValue(":monitor_id", monitorId);
+            success = SqlHelpers::execute(query);
+        }
+
+        if (success) {
+            if (query.first()) {
+                int eventTypeField = query.record().indexOf("event_type");
+                int hashField      = query.record().indexOf("hash");
+                int timestampField = query.record().indexOf("timestamp");
+                if (eventTypeField >= 0 && hashField >= 0 && timestampField >= 0) {
+                    EventType eventType = Event::toEventType(query.value(eventTypeField).toString(), &success);
+                    if (success) {
+                        ZoranTimeStamp zoranTimestamp = query.value(timestampField).toUInt(&success);
+                        if (success) {
+                            lastEvent = LastEvent(eventType, zoranTimestamp, query.value(hashField).toByteArray());
+                            while (query.next() && lastEvent.recentHashes.size() < LastEvent::maximumRecentHashes) {
+                                QByteArray hash = query.value(hashField).toByteArray();
+                                if (!lastEvent.recentHashes.contains(hash)) {
+                                    lastEvent.recentHashes.append(hash);
+                                }
+                            }
+                        } else {
+                            logWrite(QString("Failed invalid timestamp - Events::readLastEvent"), true);
+                        }
+                    } else {
+                        logWrite(QString("Failed invalid event type - Events::readLastEvent"), true);
+                    }
+                } else {
+                    logWrite(QString("Failed to get field index - Events::readLastEvent"), true);
+                    success = false;
+                }
+            }
+        } else {
+            logWrite(QString("Failed exec when checking for a repeat event: %1").arg(queryString), true);
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Events::readLastEvent: %1")
+            .arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+bool Events::readMonitorStatus(Events::MonitorStatus& monitorStatus, Events::MonitorId monitorId, unsigned threadId) {
+    monitorStatus = MonitorStatus::UNKNOWN;
+
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Events::readMonitorStatus")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query = currentDatabaseManager->preparedQuery(
+            database,
+            QString("SELECT * FROM monitor_status WHERE monitor_id = :monitor_id"),
+            &success
+        );
+
+        if (success) {
+            query.bindValue(":monitor_id", monitorId);
+            success = SqlHelpers::execute(query);
+        }
+
+        if (success) {
+            if (query.first()) {
+                int statusField = query.record().indexOf("status");
+                if (statusField >= 0) {
+                    QString statusString = query.value(statusField).toString().toLower();
+                    if (statusString == QString("working")) {
+                        monitorStatus = MonitorStatus::WORKING;
+                    } else if (statusString == QString("failed")) {
+                        monitorStatus = MonitorStatus::FAILED;
+                    } else if (statusString == QString("unknown")) {
+                        monitorStatus = MonitorStatus::UNKNOWN;
+                    } else {
+                        logWrite(
+                            QString("Failed invalid status value - Events::monitorStatus: \"%1\"")
+                            .arg(statusString),
+                            true
+                        );
+                        success = false;
+                    }
+                } else {
+                    logWrite(QString("Failed invalid status field index - Events::monitorStatus"), true);
+                    success = false;
+                }
+            } else {
+                // We're OK but there's no record.  Return UNKNOWN status.
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - Events::monitorStatus: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Events::recordEvent: %1")
+            .arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+Events::MonitorStatus Events::statusAfterEvent(Events::EventType eventType) {
+    MonitorStatus result;
+
+    if (eventType == EventType::CONTENT_CHANGED          ||
+        eventType == EventType::WORKING                  ||
+        eventType == EventType::KEYWORDS                 ||
+        eventType == EventType::SSL_CERTIFICATE_EXPIRING ||
+        eventType == EventType::SSL_CERTIFICATE_RENEWED  ||
+        eventType == EventType::LATENCY_DEGRADED         ||
+        eventType == EventType::LATENCY_RESTORED         ||
+        Event::isCustomerEvent(eventType)                   ) {
+        result = MonitorStatus::WORKING;
+    } else {
+        result = MonitorStatus::FAILED;
+    }
+
+    return result;
+}
@@ -22,6 +22,8 @@
 #include <QString>
 #include <QUrl>
 #include <QHash>
+#include <QList>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
@@ -30,19 +32,33 @@
 #include <QVariant>
 
 #include <cstdint>
+#include <algorithm>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "host_scheme.h"
 #include "database_manager.h"
+#include "id_registry.h"
+#include "catalog.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
 #include "host_schemes.h"
 
+const unsigned long HostSchemes::maximumHostSchemesPerStatement = 500;
+
 HostSchemes::HostSchemes(
         DatabaseManager* databaseManager,
+        IdRegistry*      idRegistry,
+        Catalog*         catalog,
         QObject*         parent
     ):QObject(
         parent
     ),currentDatabaseManager(
         databaseManager
+    ),currentIdRegistry(
+        idRegistry
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -50,35 +66,7 @@ HostSchemes::~HostSchemes() {}
 
 
 HostScheme HostSchemes::getHostScheme(HostSchemes::HostSchemeId hostSchemeId, unsigned threadId) const {
-    HostScheme result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
-
-        QString queryString = QString("SELECT * FROM host_scheme WHERE host_scheme_id = %1").arg(hostSchemeId);
-
-        success = query.exec(queryString);
-        if (success) {
-            if (query.first()) {
-                result = convertQueryToHostScheme(query, &success);
-            } else {
-                // We're OK but there was no record for the requested region.
-            }
-        } else {
-            logWrite(QString("Failed SELECT - HostSchemes::getHostScheme: ").arg(query.lastError().text()), true);
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database HostSchemes::getHostScheme: ").arg(database.lastError().text()),
-            true
-        );
-    }
-
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+    return currentCatalog->snapshot(threadId)->hostScheme(hostSchemeId);
 }
 
 
@@ -89,25 +77,39 @@ HostScheme HostSchemes::createHostScheme(
     ) const {
     HostScheme result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("HostSchemes::createHostScheme")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
-        QSqlQuery query(database);
+        QString   urlString = QString("%1://%2").arg(url.scheme(), url.authority());
+        QSqlQuery query     = currentDatabaseManager->preparedQuery(
+            database,
+            QString(
+                "INSERT INTO host_scheme("
+                    "customer_id,"
+                    "host,"
+                    "ssl_expiration_timestamp"
+                ") VALUES ("
+                    ":customer_id,"
+                    ":host,"
+                    "0"
+                ")"
+            ),
+            &success
+        );
+
+        if (success) {
+            query.bindValue(":customer_id", customerId);
+            query.bindValue(":host", urlString);
+
+            success = SqlHelpers::execute(query);
+        }
 
-        QString urlString   = QString("%1://%2").arg(url.scheme(), url.authority());
-        QString queryString = QString(
-            "INSERT INTO host_scheme("
-                "customer_id,"
-                "host,"
-                "ssl_expiration_timestamp"
-            ") VALUES ("
-                "%1,"
-                "'%2',"
-                "0"
-            ")"
-        ).arg(customerId).arg(escape(urlString));
-
-        success = query.exec(queryString);
         if (success) {
             QVariant hostSchemeIdVariant = query.lastInsertId();
             if (hostSchemeIdVariant.isValid()) {
@@ -119,6 +121,8 @@ HostScheme HostSchemes::createHostScheme(
                         QUrl(urlString),
                         0
                     );
+
+                    currentCatalog->updateHostScheme(result);
                 } else {
                     logWrite(QString("Invalid host/scheme ID, not integer - HostSchemes::createHostScheme."), true);
                 }
@@ -148,25 +152,41 @@ HostScheme HostSchemes::createHostScheme(
 
 
 bool HostSchemes::modifyHostScheme(const HostScheme& hostScheme, unsigned threadId) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("HostSchemes::modifyHostScheme")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
-        QSqlQuery query(database);
+        QSqlQuery query = currentDatabaseManager->preparedQuery(
+            database,
+            QString(
+                "UPDATE host_scheme SET "
+                    "customer_id = :customer_id, "
+                    "host = :host, "
+                    "ssl_expiration_timestamp = :ssl_expiration_timestamp "
+                "WHERE "
+                    "host_scheme_id = :host_scheme_id"
+            ),
+            &success
+        );
 
-        QString queryString  = QString(
-            "UPDATE host_scheme SET "
-                "customer_id = %1, "
-                "host = '%2', "
-                "ssl_expiration_timestamp = '%3' "
-            "WHERE "
-                "host_scheme_id = %4"
-        ).arg(hostScheme.customerId())
-         .arg(escape(hostScheme.url().toString()))
-         .arg(hostScheme.sslExpirationTimestamp())
-         .arg(hostScheme.hostSchemeId());
-
-        success = query.exec(queryString);
-        if (!success) {
+        if (success) {
+            query.bindValue(":customer_id", hostScheme.customerId());
+            query.bindValue(":host", hostScheme.url().toString());
+            query.bindValue(":ssl_expiration_timestamp", hostScheme.sslExpirationTimestamp());
+            query.bindValue(":host_scheme_id", hostScheme.hostSchemeId());
+
+            success = SqlHelpers::execute(query);
+        }
+
+        if (success) {
+            currentCatalog->updateHostScheme(hostScheme);
+            emit hostSchemeModified(hostScheme.hostSchemeId());
+        } else {
             logWrite(QString("Failed UPDATE - HostSchemes::modifyHostScheme: %1").arg(query.lastError().text()), true);
         }
     } else {
@@ -182,6 +202,12 @@ bool HostSchemes::modifyHostScheme(const HostScheme& hostScheme, unsigned thread
 
 
 bool HostSchemes::deleteHostScheme(const HostScheme& hostScheme, unsigned threadId) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("HostSchemes::deleteHostScheme")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -191,8 +217,11 @@ bool HostSchemes::deleteHostScheme(const HostScheme& hostScheme, unsigned thread
             "DELETE FROM host_scheme WHERE host_scheme_id = %1"
         ).arg(hostScheme.hostSchemeId());
 
-        success = query.exec(queryString);
-        if (!success) {
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            currentIdRegistry->invalidate();
+            currentCatalog->removeHostScheme(hostScheme.hostSchemeId());
+        } else {
             logWrite(QString("Failed DELETE - HostSchemes::deleteHostScheme: %1").arg(query.lastError().text()), true);
         }
     } else {
@@ -214,8 +243,11 @@ bool HostSchemes::deleteCustomerHostSchemes(HostSchemes::CustomerId customerId,
         QSqlQuery query(database);
 
         QString queryString = QString("DELETE FROM host_scheme WHERE customer_id = %1").arg(customerId);
-        success = query.exec(queryString);
-        if (!success) {
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            currentIdRegistry->invalidate();
+            currentCatalog->removeCustomerHostSchemes(customerId);
+        } else {
             logWrite(
                 QString("Failed DELETE - HostSchemes::deleteCustomerHostScheme: %1").arg(query.lastError().text()),
                 true
@@ -235,39 +267,158 @@ bool HostSchemes::deleteCustomerHostSchemes(HostSchemes::CustomerId customerId,
 
 
 HostSchemes::HostSchemeHash HostSchemes::getHostSchemes(HostSchemes::CustomerId customerId, unsigned threadId) {
-    HostSchemeHash result;
+    HostSchemeHash           result;
+    Catalog::SnapshotPointer catalog = currentCatalog->snapshot(threadId);
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+    if (customerId == HostScheme::invalidCustomerId) {
+        result = catalog->hostSchemesById();
+    } else {
+        result = catalog->hostSchemesByCustomerId(customerId);
+    }
+
+    return result;
+}
 
-        QString queryString = QString("SELECT * FROM host_scheme");
-        if (customerId != HostScheme::invalidCustomerId) {
-            queryString += QString(" WHERE customer_id = %1").arg(customerId);
+
+bool HostSchemes::insertHostSchemes(
+        QSqlDatabase&                database,
+        HostSchemes::CustomerId      customerId,
+        const QList<QUrl>&           urls,
+        HostSchemes::HostSchemeList& insertedHostSchemes
+    ) const {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("HostSchemes::insertHostSchemes")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool          success       = true;
+    unsigned long numberEntries = static_cast<unsigned long>(urls.size());
+    unsigned long index         = 0;
+    while (success && index < numberEntries) {
+        unsigned long numberRows  = std::min(numberEntries - index, maximumHostSchemesPerStatement);
+        QStringList   urlStrings;
+        QString       queryString = QString(
+            "INSERT INTO host_scheme(customer_id, host, ssl_expiration_timestamp) VALUES "
+        );
+
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            const QUrl& url = urls.at(index + row);
+            urlStrings.append(QString("%1://%2").arg(url.scheme(), url.authority()));
+            queryString += QString("%1(?, ?, 0)").arg(row == 0 ? "" : ", ");
         }
 
-        success = query.exec(queryString);
+        // PostgreSQL returns the generated host/scheme IDs in the order the rows were supplied.
+        queryString += QString(" RETURNING host_scheme_id");
+
+        success = query.prepare(queryString);
         if (success) {
-            while (success && query.next()) {
-                HostScheme hostScheme = convertQueryToHostScheme(query, &success);
-                if (success) {
-                    result.insert(hostScheme.hostSchemeId(), hostScheme);
+            for (unsigned long row=0 ; row<numberRows ; ++row) {
+                query.addBindValue(customerId);
+                query.addBindValue(urlStrings.at(row));
+            }
+
+            success = SqlHelpers::execute(query);
+            if (success) {
+                unsigned long row = 0;
+                while (success && query.next()) {
+                    HostSchemeId hostSchemeId = static_cast<HostSchemeId>(query.value(0).toUInt(&success));
+                    if (success && row < numberRows) {
+                        insertedHostSchemes.append(HostScheme(hostSchemeId, customerId, QUrl(urlStrings.at(row)), 0));
+                        ++row;
+                    } else {
+                        logWrite(QString("Invalid host/scheme ID - HostSchemes::insertHostSchemes"), true);
+                        success = false;
+                    }
+                }
+
+                index += numberRows;
+                if (success && static_cast<unsigned long>(insertedHostSchemes.size()) != index) {
+                    logWrite(QString("Failed to obtain host/scheme IDs - HostSchemes::insertHostSchemes"), true);
+                    success = false;
                 }
+            } else {
+                logWrite(
+                    QString("Failed INSERT (exec) - HostSchemes::insertHostSchemes: %1")
+                    .arg(query.lastError().text()),
+                    true
+                );
             }
         } else {
-            logWrite(QString("Failed SELECT - HostSchemes::getHostScheme: %1").arg(query.lastError().text()), true);
+            logWrite(
+                QString("Failed INSERT (prepare) - HostSchemes::insertHostSchemes: %1")
+                .arg(query.lastError().text()),
+                true
+            );
         }
-    } else {
-        logWrite(
-            QString("Failed to open database - HostScheme::getHostSchemes: %1").arg(database.lastError().text()),
-            true
-        );
     }
 
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+    return success;
+}
+
+
+bool HostSchemes::removeHostSchemes(
+        QSqlDatabase&                           database,
+        const QList<HostSchemes::HostSchemeId>& hostSchemeIds
+    ) const {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("HostSchemes::removeHostSchemes")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    QSqlQuery query(database);
+
+    bool          success       = true;
+    unsigned long numberEntries = static_cast<unsigned long>(hostSchemeIds.size());
+    unsigned long index         = 0;
+    while (success && index < numberEntries) {
+        unsigned long numberRows = std::min(numberEntries - index, maximumHostSchemesPerStatement);
+        QStringList   idStrings;
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            idStrings.append(QString::number(hostSchemeIds.at(index + row)));
+        }
+
+        QString queryString = QString("DELETE FROM host_scheme WHERE host_scheme_id IN (%1)").arg(idStrings.join(","));
+        success = SqlHelpers::execute(query, queryString);
+        if (!success) {
+            logWrite(
+                QString("Failed DELETE - HostSchemes::removeHostSchemes: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+
+        index += numberRows;
+    }
+
+    return success;
+}
+
+
+void HostSchemes::commitHostSchemes(
+        const HostSchemes::HostSchemeList&      insertedHostSchemes,
+        const QList<HostSchemes::HostSchemeId>& removedHostSchemeIds
+    ) {
+    for (  HostSchemeList::const_iterator it  = insertedHostSchemes.constBegin(),
+                                          end = insertedHostSchemes.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        currentCatalog->updateHostScheme(*it);
+    }
+
+    if (!removedHostSchemeIds.isEmpty()) {
+        currentIdRegistry->invalidate();
+
+        for (  QList<HostSchemeId>::const_iterator it  = removedHostSchemeIds.constBegin(),
+                                                   end = removedHostSchemeIds.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            currentCatalog->removeHostScheme(*it);
+        }
+    }
 }
 
 
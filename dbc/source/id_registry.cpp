@@ -0,0 +1,220 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref IdRegistry class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+#include <memory>
+
+#include "log.h"
+#include "monitor.h"
+#include "server.h"
+#include "sql_helpers.h"
+#include "id_registry.h"
+
+const unsigned IdRegistry::defaultReconcileIntervalSeconds = 15 * 60;
+
+IdRegistry::IdRegistry(QObject* parent):QObject(parent) {
+    currentSnapshot                      = std::make_shared<const Snapshot>();
+    numberPendingChanges                 = 0;
+    invalidated                          = 0;
+    currentReconcileIntervalMilliseconds = 1000LL * defaultReconcileIntervalSeconds;
+
+    timeSinceReconcile.invalidate();
+}
+
+
+IdRegistry::~IdRegistry() {}
+
+
+IdRegistry::SnapshotPointer IdRegistry::snapshot() {
+    if (numberPendingChanges.loadAcquire() != 0) {
+        QMutexLocker writerMutexLocker(&writerMutex);
+        applyPendingChanges();
+    }
+
+    return std::atomic_load(&currentSnapshot);
+}
+
+
+void IdRegistry::addMonitor(MonitorId monitorId) {
+    queueChange(Change(Change::Type::ADD_MONITOR, monitorId));
+}
+
+
+void IdRegistry::removeMonitor(MonitorId monitorId) {
+    queueChange(Change(Change::Type::REMOVE_MONITOR, monitorId));
+}
+
+
+void IdRegistry::addServer(ServerId serverId) {
+    queueChange(Change(Change::Type::ADD_SERVER, serverId));
+}
+
+
+void IdRegistry::removeServer(ServerId serverId) {
+    queueChange(Change(Change::Type::REMOVE_SERVER, serverId));
+}
+
+
+void IdRegistry::invalidate() {
+    invalidated.storeRelease(1);
+}
+
+
+void IdRegistry::setReconcileInterval(unsigned reconcileIntervalSeconds) {
+    QMutexLocker writerMutexLocker(&writerMutex);
+    currentReconcileIntervalMilliseconds = 1000LL * reconcileIntervalSeconds;
+}
+
+
+bool IdRegistry::needsReconcile() const {
+    QMutexLocker writerMutexLocker(&writerMutex);
+    return (
+           invalidated.loadAcquire() != 0
+        || !timeSinceReconcile.isValid()
+        || timeSinceReconcile.hasExpired(currentReconcileIntervalMilliseconds)
+    );
+}
+
+
+bool IdRegistry::reconcileIfNeeded(QSqlDatabase& database) {
+    bool success;
+
+    if (needsReconcile()) {
+        success = reconcile(database);
+    } else {
+        success = true;
+    }
+
+    return success;
+}
+
+
+bool IdRegistry::reconcile(QSqlDatabase& database) {
+    QMutexLocker writerMutexLocker(&writerMutex);
+
+    QSet<MonitorId> monitorIds;
+    QSet<ServerId>  serverIds;
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool success = SqlHelpers::execute(query, "SELECT monitor_id FROM monitor");
+    if (success) {
+        int monitorIdField = query.record().indexOf("monitor_id");
+        while (query.next()) {
+            monitorIds.insert(query.value(monitorIdField).toUInt());
+        }
+
+        success = SqlHelpers::execute(query, "SELECT server_id FROM servers");
+        if (success) {
+            int serverIdField = query.record().indexOf("server_id");
+            while (query.next()) {
+                serverIds.insert(static_cast<ServerId>(query.value(serverIdField).toUInt()));
+            }
+        } else {
+            logWrite(QString("Failed SELECT - IdRegistry::reconcile: %1").arg(query.lastError().text()), true);
+        }
+    } else {
+        logWrite(QString("Failed SELECT - IdRegistry::reconcile: %1").arg(query.lastError().text()), true);
+    }
+
+    if (success) {
+        SnapshotPointer oldSnapshot = std::atomic_load(&currentSnapshot);
+        SnapshotPointer newSnapshot = std::make_shared<const Snapshot>(
+            oldSnapshot->version() + 1,
+            monitorIds,
+            serverIds
+        );
+
+        std::atomic_store(&currentSnapshot, newSnapshot);
+
+        pendingChanges.clear();
+        numberPendingChanges.storeRelease(0);
+        invalidated.storeRelease(0);
+        timeSinceReconcile.start();
+    }
+
+    return success;
+}
+
+
+void IdRegistry::queueChange(const Change& change) {
+    QMutexLocker writerMutexLocker(&writerMutex);
+
+    pendingChanges.append(change);
+    numberPendingChanges.storeRelease(pendingChanges.size());
+}
+
+
+void IdRegistry::applyPendingChanges() {
+    if (!pendingChanges.isEmpty()) {
+        SnapshotPointer oldSnapshot = std::atomic_load(&currentSnapshot);
+        QSet<MonitorId> monitorIds  = oldSnapshot->monitorIds();
+        QSet<ServerId>  serverIds   = oldSnapshot->serverIds();
+
+        for (QList<Change>::const_iterator it=pendingChanges.constBegin(),end=pendingChanges.constEnd() ;
+             it!=end                                                                                    ;
+             ++it                                                                                       ) {
+            switch (it->type) {
+                case Change::Type::ADD_MONITOR: {
+                    monitorIds.insert(static_cast<MonitorId>(it->id));
+                    break;
+                }
+
+                case Change::Type::REMOVE_MONITOR: {
+                    monitorIds.remove(static_cast<MonitorId>(it->id));
+                    break;
+                }
+
+                case Change::Type::ADD_SERVER: {
+                    serverIds.insert(static_cast<ServerId>(it->id));
+                    break;
+                }
+
+                case Change::Type::REMOVE_SERVER: {
+                    serverIds.remove(static_cast<ServerId>(it->id));
+                    break;
+                }
+            }
+        }
+
+        SnapshotPointer newSnapshot = std::make_shared<const Snapshot>(
+            oldSnapshot->version() + 1,
+            monitorIds,
+            serverIds
+        );
+
+        std::atomic_store(&currentSnapshot, newSnapshot);
+
+        pendingChanges.clear();
+        numberPendingChanges.storeRelease(0);
+    }
+}
@@ -0,0 +1,185 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref JobManager class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+
+#include <rest_api_in_v1_json_response.h>
+#include <rest_api_in_v1_inesonic_rest_handler.h>
+
+#include "log.h"
+#include "job_scheduler.h"
+#include "request_tracer.h"
+#include "traffic_recorder.h"
+#include "job_manager.h"
+
+/***********************************************************************************************************************
+* JobManager::JobStatus
+*/
+
+JobManager::JobStatus::JobStatus(
+        const QByteArray& secret,
+        JobScheduler*     jobScheduler
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentJobScheduler(
+        jobScheduler
+    ) {}
+
+
+JobManager::JobStatus::~JobStatus() {}
+
+
+RestApiInV1::JsonResponse JobManager::JobStatus::processAuthenticatedRequest(
+        const QString&       path,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("JobManager::JobStatus"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (request.isObject()) {
+        QJsonObject responseObject;
+        QJsonObject object = request.object();
+
+        if (object.size() == 1 && object.contains("job_id")) {
+            double jobIdDouble = object.value("job_id").toDouble(-1);
+            if (jobIdDouble >= 1.0) {
+                JobScheduler::JobStatus jobStatus;
+                bool success = currentJobScheduler->getJobStatus(
+                    static_cast<JobScheduler::JobId>(jobIdDouble),
+                    jobStatus,
+                    threadId
+                );
+
+                if (success) {
+                    responseObject.insert("status", "OK");
+                    responseObject.insert("job_type", jobStatus.jobType);
+                    responseObject.insert("job_status", JobScheduler::toString(jobStatus.status).toLower());
+                    responseObject.insert("completed", static_cast<double>(jobStatus.completed));
+                    responseObject.insert("total", static_cast<double>(jobStatus.total));
+
+                    if (!jobStatus.message.isEmpty()) {
+                        responseObject.insert("message", jobStatus.message);
+                    }
+                } else {
+                    responseObject.insert("status", "failed, unknown job ID");
+                }
+            } else {
+                responseObject.insert("status", "failed, invalid job ID");
+            }
+
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
+    }
+
+    return response;
+}
+
+/***********************************************************************************************************************
+* JobManager::JobCancel
+*/
+
+JobManager::JobCancel::JobCancel(
+        const QByteArray& secret,
+        JobScheduler*     jobScheduler
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentJobScheduler(
+        jobScheduler
+    ) {}
+
+
+JobManager::JobCancel::~JobCancel() {}
+
+
+RestApiInV1::JsonResponse JobManager::JobCancel::processAuthenticatedRequest(
+        const QString&       path,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("JobManager::JobCancel"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (request.isObject()) {
+        QJsonObject responseObject;
+        QJsonObject object = request.object();
+
+        if (object.size() == 1 && object.contains("job_id")) {
+            double jobIdDouble = object.value("job_id").toDouble(-1);
+            if (jobIdDouble >= 1.0) {
+                bool success = currentJobScheduler->cancel(static_cast<JobScheduler::JobId>(jobIdDouble), threadId);
+                if (success) {
+                    responseObject.insert("status", "OK");
+                } else {
+                    responseObject.insert("status", "failed, job not active");
+                }
+            } else {
+                responseObject.insert("status", "failed, invalid job ID");
+            }
+
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
+    }
+
+    return response;
+}
+
+/***********************************************************************************************************************
+* JobManager
+*/
+
+const QString JobManager::jobStatusPath("/job/status");
+const QString JobManager::jobCancelPath("/job/cancel");
+
+JobManager::JobManager(
+        RestApiInV1::Server* restApiServer,
+        JobScheduler*        jobScheduler,
+        const QByteArray&    secret,
+        QObject*             parent
+    ):QObject(
+        parent
+    ),jobStatus(
+        secret,
+        jobScheduler
+    ),jobCancel(
+        secret,
+        jobScheduler
+    ) {
+    restApiServer->registerHandler(&jobStatus, RestApiInV1::Handler::Method::POST, jobStatusPath);
+    restApiServer->registerHandler(&jobCancel, RestApiInV1::Handler::Method::POST, jobCancelPath);
+}
+
+
+JobManager::~JobManager() {}
+
+
+void JobManager::setSecret(const QByteArray& newSecret) {
+    jobStatus.setSecret(newSecret);
+    jobCancel.setSecret(newSecret);
+}
@@ -0,0 +1,620 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref JobScheduler class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+
+#include <algorithm>
+
+#include "log.h"
+#include "database_manager.h"
+#include "sql_helpers.h"
+#include "thread_placement.h"
+#include "job_scheduler.h"
+
+/***********************************************************************************************************************
+* JobScheduler::Progress
+*/
+
+JobScheduler::Progress::Progress(
+        JobScheduler* scheduler,
+        JobId         jobId,
+        unsigned      databaseThreadId
+    ):currentScheduler(
+        scheduler
+    ),currentJobId(
+        jobId
+    ),currentDatabaseThreadId(
+        databaseThreadId
+    ) {}
+
+
+JobScheduler::JobId JobScheduler::Progress::jobId() const {
+    return currentJobId;
+}
+
+
+void JobScheduler::Progress::setProgress(unsigned long long completed, unsigned long long total) {
+    currentScheduler->recordProgress(currentJobId, completed, total, currentDatabaseThreadId);
+}
+
+
+void JobScheduler::Progress::setMessage(const QString& message) {
+    currentMessage = message;
+}
+
+
+bool JobScheduler::Progress::cancelRequested() const {
+    QMutexLocker jobMutexLocker(&currentScheduler->jobMutex);
+    return currentScheduler->cancelRequests.contains(currentJobId);
+}
+
+/***********************************************************************************************************************
+* JobScheduler::Worker
+*/
+
+JobScheduler::Worker::Worker(
+        JobScheduler* scheduler,
+        unsigned      databaseThreadId
+    ):currentScheduler(
+        scheduler
+    ),currentDatabaseThreadId(
+        databaseThreadId
+    ) {
+    currentStopRequested = false;
+    start();
+}
+
+
+JobScheduler::Worker::~Worker() {
+    requestStop();
+    wait();
+}
+
+
+void JobScheduler::Worker::requestStop() {
+    QMutexLocker jobMutexLocker(&currentScheduler->jobMutex);
+
+    currentStopRequested = true;
+    currentScheduler->jobCondition.wakeAll();
+}
+
+
+bool JobScheduler::Worker::stopRequested() const {
+    return currentStopRequested;
+}
+
+
+void JobScheduler::Worker::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::JOB);
+
+    QueuedJob job;
+    while (currentScheduler->nextJob(this, job)) {
+        currentScheduler->runJob(job, currentDatabaseThreadId);
+    }
+}
+
+/***********************************************************************************************************************
+* JobScheduler
+*/
+
+const unsigned JobScheduler::defaultNumberWorkers = 2;
+
+JobScheduler::JobScheduler(
+        DatabaseManager* databaseManager,
+        QObject*         parent
+    ):QObject(
+        parent
+    ),currentDatabaseManager(
+        databaseManager
+    ) {
+    setNumberWorkers(defaultNumberWorkers);
+}
+
+
+JobScheduler::~JobScheduler() {
+    // Queued jobs stay pending in the job table and are picked up again by the next run.
+    setNumberWorkers(0);
+}
+
+
+QString JobScheduler::toString(JobScheduler::Status status) {
+    QString result;
+    switch (status) {
+        case Status::PENDING:   { result = QString("PENDING");    break; }
+        case Status::RUNNING:   { result = QString("RUNNING");    break; }
+        case Status::COMPLETED: { result = QString("COMPLETED");  break; }
+        case Status::FAILED:    { result = QString("FAILED");     break; }
+        case Status::CANCELED:  { result = QString("CANCELED");   break; }
+        default:                { Q_ASSERT(false);                break; }
+    }
+
+    return result;
+}
+
+
+JobScheduler::Status JobScheduler::toStatus(const QString& str, bool* success) {
+    bool   ok = true;
+    Status result;
+
+    QString s = str.trimmed().toLower();
+    if (s == "pending") {
+        result = Status::PENDING;
+    } else if (s == "running") {
+        result = Status::RUNNING;
+    } else if (s == "completed") {
+        result = Status::COMPLETED;
+    } else if (s == "failed") {
+        result = Status::FAILED;
+    } else if (s == "canceled") {
+        result = Status::CANCELED;
+    } else {
+        ok     = false;
+        result = Status::FAILED;
+    }
+
+    if (success != nullptr) {
+        *success = ok;
+    }
+
+    return result;
+}
+
+
+void JobScheduler::registerJobType(
+        const QString&            jobType,
+        unsigned                  maximumConcurrent,
+        JobScheduler::JobFunction jobFunction
+    ) {
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    JobType& entry = jobTypes[jobType];
+    entry.jobFunction       = jobFunction;
+    entry.maximumConcurrent = std::max(maximumConcurrent, 1U);
+    entry.numberRunning     = 0;
+}
+
+
+bool JobScheduler::setMaximumConcurrent(const QString& jobType, unsigned maximumConcurrent) {
+    bool success;
+
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    QHash<QString, JobType>::iterator it = jobTypes.find(jobType);
+    if (it != jobTypes.end()) {
+        it.value().maximumConcurrent = std::max(maximumConcurrent, 1U);
+        jobCondition.wakeAll();
+
+        success = true;
+    } else {
+        success = false;
+    }
+
+    return success;
+}
+
+
+void JobScheduler::setNumberWorkers(unsigned numberWorkers) {
+    unsigned currentNumberWorkers = static_cast<unsigned>(workers.size());
+
+    numberWorkers = std::min(numberWorkers, maximumNumberWorkers);
+    while (currentNumberWorkers < numberWorkers) {
+        workers.append(new Worker(this, firstDatabaseThreadId - currentNumberWorkers));
+        ++currentNumberWorkers;
+    }
+
+    // As with the plot workers, workers are removed from the end so database thread IDs stay dense.
+
+    while (currentNumberWorkers > numberWorkers) {
+        Worker* worker = workers.takeLast();
+        delete worker;
+
+        --currentNumberWorkers;
+    }
+}
+
+
+JobScheduler::JobId JobScheduler::submit(const QString& jobType, const QJsonObject& parameters, unsigned threadId) {
+    JobId result = invalidJobId;
+
+    jobMutex.lock();
+    bool success = jobTypes.contains(jobType);
+    jobMutex.unlock();
+
+    if (success) {
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        success = database.isOpen();
+        if (success) {
+            QSqlQuery query(database);
+            success = query.prepare(
+                "INSERT INTO admin_job (job_type, parameters) VALUES (:job_type, :parameters) RETURNING job_id"
+            );
+
+            if (success) {
+                query.bindValue(":job_type", jobType);
+                query.bindValue(
+                    ":parameters",
+                    QString::fromUtf8(QJsonDocument(parameters).toJson(QJsonDocument::Compact))
+                );
+
+                success = SqlHelpers::execute(query);
+            }
+
+            if (success && query.next()) {
+                result = query.value(0).toULongLong(&success);
+                if (!success) {
+                    result = invalidJobId;
+                    logWrite(QString("Invalid job ID - JobScheduler::submit"), true);
+                }
+            } else {
+                logWrite(QString("Failed INSERT - JobScheduler::submit: %1").arg(query.lastError().text()), true);
+            }
+        } else {
+            logWrite(
+                QString("Failed to open database - JobScheduler::submit: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    } else {
+        logWrite(QString("Unknown job type %1 - JobScheduler::submit").arg(jobType), true);
+    }
+
+    if (result != invalidJobId) {
+        QueuedJob job;
+        job.jobId      = result;
+        job.jobType    = jobType;
+        job.parameters = parameters;
+
+        QMutexLocker jobMutexLocker(&jobMutex);
+        pendingJobs.append(job);
+        jobCondition.wakeAll();
+    }
+
+    return result;
+}
+
+
+bool JobScheduler::getJobStatus(JobScheduler::JobId jobId, JobScheduler::JobStatus& jobStatus, unsigned threadId) {
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        success = SqlHelpers::execute(
+            query,
+            QString("SELECT job_type, status, completed, total, message FROM admin_job WHERE job_id = %1").arg(jobId)
+        );
+
+        if (success) {
+            if (query.next()) {
+                jobStatus.jobType = query.value(0).toString();
+                jobStatus.status  = toStatus(query.value(1).toString(), &success);
+
+                if (success) {
+                    jobStatus.completed = query.value(2).toULongLong(&success);
+                }
+
+                if (success) {
+                    jobStatus.total = query.value(3).toULongLong(&success);
+                }
+
+                if (success) {
+                    jobStatus.message = query.value(4).toString();
+                } else {
+                    logWrite(QString("Invalid job entry %1 - JobScheduler::getJobStatus").arg(jobId), true);
+                }
+            } else {
+                success = false;
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - JobScheduler::getJobStatus: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - JobScheduler::getJobStatus: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+bool JobScheduler::cancel(JobScheduler::JobId jobId, unsigned threadId) {
+    bool result = false;
+
+    jobMutex.lock();
+
+    bool running = runningJobs.contains(jobId);
+    if (running) {
+        cancelRequests.insert(jobId);
+        result = true;
+    } else {
+        QList<QueuedJob>::iterator it  = pendingJobs.begin();
+        QList<QueuedJob>::iterator end = pendingJobs.end();
+        while (it != end && it->jobId != jobId) {
+            ++it;
+        }
+
+        if (it != end) {
+            pendingJobs.erase(it);
+        }
+    }
+
+    jobMutex.unlock();
+
+    if (!running) {
+        // Jobs not yet resumed after a restart are only found in the job table so the table decides the outcome.
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        bool success = database.isOpen();
+        if (success) {
+            QSqlQuery query(database);
+            success = SqlHelpers::execute(
+                query,
+                QString(
+                    "UPDATE admin_job SET status = 'CANCELED' WHERE job_id = %1 AND status IN ('PENDING', 'RUNNING')"
+                ).arg(jobId)
+            );
+
+            if (success) {
+                result = query.numRowsAffected() > 0;
+            } else {
+                logWrite(QString("Failed UPDATE - JobScheduler::cancel: %1").arg(query.lastError().text()), true);
+            }
+        } else {
+            logWrite(
+                QString("Failed to open database - JobScheduler::cancel: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    }
+
+    if (result) {
+        logWrite(QString("Cancellation requested for job %1.").arg(jobId), false);
+    }
+
+    return result;
+}
+
+
+void JobScheduler::resumeJobs() {
+    QList<QueuedJob> storedJobs;
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString("JobScheduler"));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        // Interrupted jobs are left running so they are run again here, oldest first, after a restart.
+        success = SqlHelpers::execute(
+            query,
+            "SELECT job_id, job_type, parameters FROM admin_job "
+            "WHERE status IN ('PENDING', 'RUNNING') ORDER BY job_id ASC"
+        );
+
+        if (success) {
+            while (query.next()) {
+                QueuedJob job;
+                job.jobId      = query.value(0).toULongLong();
+                job.jobType    = query.value(1).toString();
+                job.parameters = QJsonDocument::fromJson(query.value(2).toString().toUtf8()).object();
+
+                storedJobs.append(job);
+            }
+        } else {
+            logWrite(QString("Failed SELECT - JobScheduler::resumeJobs: %1").arg(query.lastError().text()), true);
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - JobScheduler::resumeJobs: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    QSet<JobId> knownJobIds = runningJobs;
+    for (QList<QueuedJob>::const_iterator it=pendingJobs.constBegin(),end=pendingJobs.constEnd() ; it!=end ; ++it) {
+        knownJobIds.insert(it->jobId);
+    }
+
+    for (QList<QueuedJob>::const_iterator it=storedJobs.constBegin(),end=storedJobs.constEnd() ; it!=end ; ++it) {
+        if (!knownJobIds.contains(it->jobId)) {
+            pendingJobs.append(*it);
+        }
+    }
+
+    jobCondition.wakeAll();
+}
+
+
+bool JobScheduler::nextJob(JobScheduler::Worker* worker, JobScheduler::QueuedJob& job) {
+    bool found = false;
+
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    while (!found && !worker->stopRequested()) {
+        QList<QueuedJob>::iterator it  = pendingJobs.begin();
+        QList<QueuedJob>::iterator end = pendingJobs.end();
+
+        // Jobs of an unknown type are taken immediately so they are recorded as failed rather than left queued.
+        while (!found && it != end) {
+            QHash<QString, JobType>::iterator typeIterator = jobTypes.find(it->jobType);
+            if (typeIterator == jobTypes.end()) {
+                found = true;
+            } else if (typeIterator.value().numberRunning < typeIterator.value().maximumConcurrent) {
+                ++typeIterator.value().numberRunning;
+                found = true;
+            } else {
+                ++it;
+            }
+        }
+
+        if (found) {
+            job = *it;
+            pendingJobs.erase(it);
+            runningJobs.insert(job.jobId);
+        } else {
+            jobCondition.wait(&jobMutex);
+        }
+    }
+
+    return found;
+}
+
+
+void JobScheduler::runJob(const JobScheduler::QueuedJob& job, unsigned databaseThreadId) {
+    jobMutex.lock();
+    bool        typeKnown   = jobTypes.contains(job.jobType);
+    JobFunction jobFunction = typeKnown ? jobTypes.value(job.jobType).jobFunction : JobFunction();
+    jobMutex.unlock();
+
+    Progress progress(this, job.jobId, databaseThreadId);
+    bool     success;
+
+    if (typeKnown) {
+        setJobStatus(job.jobId, Status::RUNNING, QString(), databaseThreadId);
+        success = jobFunction(job.parameters, progress, databaseThreadId);
+    } else {
+        progress.setMessage(QString("unknown job type"));
+        success = false;
+    }
+
+    jobMutex.lock();
+
+    bool canceled = cancelRequests.remove(job.jobId);
+    runningJobs.remove(job.jobId);
+
+    QHash<QString, JobType>::iterator typeIterator = jobTypes.find(job.jobType);
+    if (typeIterator != jobTypes.end() && typeIterator.value().numberRunning > 0) {
+        --typeIterator.value().numberRunning;
+    }
+
+    jobCondition.wakeAll();
+    jobMutex.unlock();
+
+    Status status = canceled ? Status::CANCELED : success ? Status::COMPLETED : Status::FAILED;
+    setJobStatus(job.jobId, status, progress.currentMessage, databaseThreadId);
+
+    logWrite(
+        QString("Job %1 (%2) %3.").arg(job.jobId).arg(job.jobType, toString(status).toLower()),
+        status == Status::FAILED
+    );
+}
+
+
+bool JobScheduler::recordProgress(
+        JobScheduler::JobId jobId,
+        unsigned long long  completed,
+        unsigned long long  total,
+        unsigned            threadId
+    ) {
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        success = SqlHelpers::execute(
+            query,
+            QString("UPDATE admin_job SET completed = %1, total = %2 WHERE job_id = %3")
+            .arg(completed)
+            .arg(total)
+            .arg(jobId)
+        );
+
+        if (!success) {
+            logWrite(
+                QString("Failed UPDATE - JobScheduler::recordProgress: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - JobScheduler::recordProgress: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+bool JobScheduler::setJobStatus(
+        JobScheduler::JobId  jobId,
+        JobScheduler::Status status,
+        const QString&       message,
+        unsigned             threadId
+    ) {
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        success = query.prepare(
+            QString("UPDATE admin_job SET status = '%1', message = :message WHERE job_id = %2")
+            .arg(toString(status))
+            .arg(jobId)
+        );
+
+        if (success) {
+            query.bindValue(":message", message);
+            success = SqlHelpers::execute(query);
+        }
+
+        if (!success) {
+            logWrite(
+                QString("Failed UPDATE - JobScheduler::setJobStatus: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - JobScheduler::setJobStatus: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
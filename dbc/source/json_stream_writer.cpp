@@ -0,0 +1,124 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref JsonStreamWriter class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "json_stream_writer.h"
+
+JsonStreamWriter::JsonStreamWriter(int reserve) {
+    if (reserve > 0) {
+        currentData.reserve(reserve);
+    }
+}
+
+
+JsonStreamWriter::~JsonStreamWriter() {}
+
+
+void JsonStreamWriter::beginObject() {
+    separate();
+    currentData.append('{');
+    currentNotEmpty.append(false);
+}
+
+
+void JsonStreamWriter::beginObject(const QString& key) {
+    separate();
+    writeKey(key);
+    currentData.append('{');
+    currentNotEmpty.append(false);
+}
+
+
+void JsonStreamWriter::endObject() {
+    currentData.append('}');
+    currentNotEmpty.removeLast();
+}
+
+
+void JsonStreamWriter::beginArray() {
+    separate();
+    currentData.append('[');
+    currentNotEmpty.append(false);
+}
+
+
+void JsonStreamWriter::beginArray(const QString& key) {
+    separate();
+    writeKey(key);
+    currentData.append('[');
+    currentNotEmpty.append(false);
+}
+
+
+void JsonStreamWriter::endArray() {
+    currentData.append(']');
+    currentNotEmpty.removeLast();
+}
+
+
+void JsonStreamWriter::insert(const QString& key, const QJsonValue& value) {
+    separate();
+    writeKey(key);
+    writeValue(value);
+}
+
+
+void JsonStreamWriter::append(const QJsonValue& value) {
+    separate();
+    writeValue(value);
+}
+
+
+void JsonStreamWriter::separate() {
+    if (!currentNotEmpty.isEmpty()) {
+        if (currentNotEmpty.last()) {
+            currentData.append(',');
+        } else {
+            currentNotEmpty.last() = true;
+        }
+    }
+}
+
+
+void JsonStreamWriter::writeKey(const QString& key) {
+    // Qt only serializes whole documents so scalars are escaped by wrapping them in a single element array.
+    QByteArray encoded = QJsonDocument(QJsonArray({ QJsonValue(key) })).toJson(QJsonDocument::Compact);
+    currentData.append(encoded.constData() + 1, encoded.size() - 2);
+    currentData.append(':');
+}
+
+
+void JsonStreamWriter::writeValue(const QJsonValue& value) {
+    if (value.isObject()) {
+        currentData.append(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+    } else if (value.isArray()) {
+        currentData.append(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+    } else {
+        QByteArray encoded = QJsonDocument(QJsonArray({ value })).toJson(QJsonDocument::Compact);
+        currentData.append(encoded.constData() + 1, encoded.size() - 2);
+    }
+}
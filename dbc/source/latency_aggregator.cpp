@@ -19,14 +19,16 @@
 ***********************************************************************************************************************/
 
 #include <QObject>
-#include <QDateTime>
-#include <QTimer>
+#include <QString>
 
 #include "database_manager.h"
 #include "customers_capabilities.h"
+#include "periodic_scheduler.h"
 #include "latency_aggregator.h"
 #include "latency_aggregator_private.h"
 
+const unsigned LatencyAggregator::defaultNumberWorkers = 1;
+
 LatencyAggregator::LatencyAggregator(
         DatabaseManager* databaseManager,
         QObject*         parent
@@ -37,15 +39,18 @@ LatencyAggregator::LatencyAggregator(
             databaseManager,
             this
         )
+    ),currentEnabled(
+        true
     ) {
-    aggregationTimer = new QTimer(this);
-    aggregationTimer->setSingleShot(false);
+    aggregationTaskId = PeriodicScheduler::invalidTaskId;
 
-    connect(aggregationTimer, &QTimer::timeout, this, &LatencyAggregator::startAggregation);
+    connect(impl, &Private::finished, this, &LatencyAggregator::aggregationFinished);
 }
 
 
-LatencyAggregator::~LatencyAggregator() {}
+LatencyAggregator::~LatencyAggregator() {
+    PeriodicScheduler::instance()->unregisterTask(aggregationTaskId);
+}
 
 
 const QString& LatencyAggregator::inputTableName() const {
@@ -79,7 +84,8 @@ void LatencyAggregator::setParameters(
         unsigned long  inputTableMaximumAge,
         unsigned long  resamplePeriod,
         unsigned long  expungePeriod,
-        bool           inputAggregated
+        bool           inputAggregated,
+        bool           inputBlocks
     ) {
     impl->setParameters(
         inputTableName,
@@ -87,12 +93,11 @@ void LatencyAggregator::setParameters(
         inputTableMaximumAge,
         resamplePeriod,
         expungePeriod,
-        inputAggregated
+        inputAggregated,
+        inputBlocks
     );
 
-    unsigned long long currentTime           = QDateTime::currentSecsSinceEpoch();
-    unsigned long      secondsToNextInterval = (resamplePeriod - (currentTime % resamplePeriod)) % resamplePeriod;
-    aggregationTimer->start(secondsToNextInterval * 1000ULL);
+    updateSchedule();
 }
 
 
@@ -101,6 +106,55 @@ bool LatencyAggregator::deleteByCustomerId(const CustomersCapabilities::Customer
 }
 
 
+void LatencyAggregator::setNumberWorkers(unsigned numberWorkers) {
+    impl->setNumberWorkers(numberWorkers);
+}
+
+
+void LatencyAggregator::setRollupCoverageStart(unsigned long long coverageStart) {
+    impl->setRollupCoverageStart(coverageStart);
+}
+
+
+void LatencyAggregator::setPartitionPeriods(const PartitionPeriods& partitionPeriods) {
+    impl->setPartitionPeriods(partitionPeriods);
+}
+
+
+void LatencyAggregator::setEnabled(bool nowEnabled) {
+    if (nowEnabled != currentEnabled) {
+        currentEnabled = nowEnabled;
+        updateSchedule();
+    }
+}
+
+
 void LatencyAggregator::startAggregation() {
     impl->start();
 }
+
+
+void LatencyAggregator::updateSchedule() {
+    PeriodicScheduler* scheduler = PeriodicScheduler::instance();
+
+    // Tasks are named for their output table so that each tier can be configured on its own.
+    QString taskName = QString("latency_aggregation_%1").arg(impl->outputTableName());
+    if (taskName != currentTaskName) {
+        scheduler->unregisterTask(aggregationTaskId);
+
+        currentTaskName   = taskName;
+        aggregationTaskId = scheduler->registerTask(
+            taskName,
+            PeriodicScheduler::databaseMaintenanceGroup,
+            0,
+            [this]() {
+                startAggregation();
+            },
+            [this]() {
+                return impl->isRunning();
+            }
+        );
+    }
+
+    scheduler->setPeriod(aggregationTaskId, currentEnabled ? impl->resamplePeriod() : 0, true);
+}
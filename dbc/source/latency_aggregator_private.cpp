@@ -23,16 +23,19 @@
 #include <QString>
 #include <QMutex>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSqlDriver>
 #include <QSqlError>
 #include <QVariant>
+#include <QSet>
 #include <QRandomGenerator>
 #include <QPair>
 
 #include <limits>
+#include <algorithm>
 
 #include "log.h"
 #include "database_manager.h"
@@ -43,9 +46,235 @@
 #include "short_latency_entry.h"
 #include "latency_entry.h"
 #include "aggregated_latency_entry.h"
+#include "latency_sketch.h"
+#include "latency_block.h"
+#include "metrics_registry.h"
 #include "latency_aggregator.h"
+#include "sql_helpers.h"
+#include "statement_pipeline.h"
+#include "thread_placement.h"
 #include "latency_aggregator_private.h"
 
+const QString       LatencyAggregator::Private::watermarkTableName("latency_aggregation_watermark");
+const unsigned long LatencyAggregator::Private::monitorsPerRange = 1000;
+const unsigned long LatencyAggregator::Private::cursorFetchSize = 10000;
+const unsigned long LatencyAggregator::Private::writeBatchSize = 1000;
+const unsigned long LatencyAggregator::Private::partitionsAhead = 4;
+
+/***********************************************************************************************************************
+* LatencyAggregator::Private::RandomGenerator
+*/
+
+LatencyAggregator::Private::RandomGenerator::RandomGenerator() {
+    for (unsigned i=0 ; i<(sizeof(seed)/sizeof(std::uint64_t)) ; ++i) {
+        seed[i] = QRandomGenerator::global()->generate64();
+    }
+
+    nextValue    = 0;
+    useNextValue = false;
+}
+
+
+std::uint32_t LatencyAggregator::Private::RandomGenerator::next() {
+    std::uint32_t result;
+    if (useNextValue) {
+        useNextValue = false;
+        result       = nextValue;
+    } else {
+        std::uint64_t s0 = seed[0];
+        std::uint64_t s1 = seed[1];
+        std::uint64_t s2 = seed[2];
+        std::uint64_t s3 = seed[3];
+
+        std::uint64_t t = s1 << 17;
+        std::uint64_t r = s0 + s3;
+
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+
+        s2 ^= t;
+        s3 = (s3 << 45) | (s3 >> 19);
+
+        seed[0] = s0;
+        seed[1] = s1;
+        seed[2] = s2;
+        seed[3] = s3;
+
+        nextValue    = static_cast<std::uint32_t>(r >> 32);
+        useNextValue = true;
+
+        result = static_cast<std::uint32_t>(r);
+    }
+
+    return result;
+}
+
+/***********************************************************************************************************************
+* LatencyAggregator::Private::PeriodAccumulator
+*/
+
+LatencyAggregator::Private::PeriodAccumulator::PeriodAccumulator() {
+    clear();
+}
+
+
+void LatencyAggregator::Private::PeriodAccumulator::add(
+        double                                      meanLatency,
+        double                                      varianceLatency,
+        AggregatedLatencyEntry::LatencyMicroseconds minimumLatency,
+        AggregatedLatencyEntry::LatencyMicroseconds maximumLatency,
+        unsigned long                               numberSamples,
+        AggregatedLatencyEntry::ZoranTimeStamp      zoranTimestamp,
+        AggregatedLatencyEntry::LatencyMicroseconds latency,
+        RandomGenerator&                            randomGenerator
+    ) {
+    if (numberSamples > 0) {
+        unsigned long combinedNumberSamples = currentNumberSamples + numberSamples;
+
+        // Pairwise update:
+        //   \delta = \mu_b - \mu_a
+        //   \mu    = \mu_a + \delta n_b / n
+        //   M_2    = M_{2,a} + n_b \sigma^2_b + \delta^2 n_a n_b / n
+        double delta = meanLatency - currentMeanLatency;
+        double ratio = static_cast<double>(numberSamples) / combinedNumberSamples;
+
+        currentMeanLatency           += delta * ratio;
+        currentSumSquaredDifferences += numberSamples * varianceLatency + delta * delta * currentNumberSamples * ratio;
+
+        if (minimumLatency < currentMinimumLatency) {
+            currentMinimumLatency = minimumLatency;
+        }
+
+        if (maximumLatency > currentMaximumLatency) {
+            currentMaximumLatency = maximumLatency;
+        }
+
+        // The held sample is replaced with probability n_b / n so every underlying sample is equally likely to be
+        // selected.  The multiply and shift maps a 32-bit random value onto [0, n) without a division.
+        std::uint64_t draw = (static_cast<std::uint64_t>(randomGenerator.next()) * combinedNumberSamples) >> 32;
+        if (draw < numberSamples) {
+            currentSampleZoranTimestamp = zoranTimestamp;
+            currentSampleLatency        = latency;
+        }
+
+        currentNumberSamples = combinedNumberSamples;
+    }
+}
+
+
+void LatencyAggregator::Private::PeriodAccumulator::clear() {
+    currentNumberSamples         = 0;
+    currentMeanLatency           = 0;
+    currentSumSquaredDifferences = 0;
+    currentMinimumLatency        = std::numeric_limits<AggregatedLatencyEntry::LatencyMicroseconds>::max();
+    currentMaximumLatency        = 0;
+    currentSampleZoranTimestamp  = 0;
+    currentSampleLatency         = 0;
+}
+
+
+AggregatedLatencyEntry LatencyAggregator::Private::PeriodAccumulator::entry(
+        AggregatedLatencyEntry::MonitorId monitorId,
+        AggregatedLatencyEntry::ServerId  serverId,
+        unsigned long long                periodStartTimestamp,
+        unsigned long long                periodEndTimestamp
+    ) const {
+    return AggregatedLatencyEntry(
+        monitorId,
+        serverId,
+        currentSampleZoranTimestamp,
+        currentSampleLatency,
+        LatencyEntry::toZoranTimestamp(periodStartTimestamp),
+        LatencyEntry::toZoranTimestamp(periodEndTimestamp),
+        currentMeanLatency,
+        currentSumSquaredDifferences / currentNumberSamples,
+        currentMinimumLatency,
+        currentMaximumLatency,
+        currentNumberSamples
+    );
+}
+
+/***********************************************************************************************************************
+* LatencyAggregator::Private::Worker
+*/
+
+LatencyAggregator::Private::Worker::Worker(
+        LatencyAggregator::Private* owner,
+        const QString&              databaseName,
+        const MonitorRangeList&     monitorRanges,
+        unsigned long long          timeThreshold,
+        unsigned long               resamplePeriod,
+        const QString&              inputTableName,
+        const QString&              outputTableName,
+        bool                        inputAggregated,
+        bool                        inputBlocks
+    ):currentOwner(
+        owner
+    ),currentDatabaseName(
+        databaseName
+    ),currentMonitorRanges(
+        monitorRanges
+    ),currentTimeThreshold(
+        timeThreshold
+    ),currentResamplePeriod(
+        resamplePeriod
+    ),currentInputTableName(
+        inputTableName
+    ),currentOutputTableName(
+        outputTableName
+    ),currentInputAggregated(
+        inputAggregated
+    ),currentInputBlocks(
+        inputBlocks
+    ),currentSucceeded(
+        false
+    ) {}
+
+
+LatencyAggregator::Private::Worker::~Worker() {
+    wait();
+}
+
+
+bool LatencyAggregator::Private::Worker::succeeded() const {
+    return currentSucceeded;
+}
+
+
+void LatencyAggregator::Private::Worker::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::AGGREGATION);
+
+    QSqlDatabase database = currentOwner->currentDatabaseManager->getDatabase(currentDatabaseName);
+    if (database.isOpen()) {
+        currentSucceeded = currentOwner->aggregateMonitorRanges(
+            database,
+            currentMonitorRanges,
+            currentTimeThreshold,
+            currentResamplePeriod,
+            currentInputTableName,
+            currentOutputTableName,
+            currentInputAggregated,
+            currentInputBlocks,
+            randomGenerator
+        );
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyAggregator::Worker: %1").arg(database.lastError().text()),
+            true
+        );
+
+        currentSucceeded = false;
+    }
+
+    currentOwner->currentDatabaseManager->closeAndRelease(database);
+}
+
+/***********************************************************************************************************************
+* LatencyAggregator::Private
+*/
+
 LatencyAggregator::Private::Private(
         DatabaseManager* databaseManager,
         QObject*         parent
@@ -57,13 +286,9 @@ LatencyAggregator::Private::Private(
     currentInputTableMaximumAge = 0;
     currentResamplePeriod       = 0;
     currentInputAggregated      = false;
-
-    for (unsigned i=0 ; i<(sizeof(seed)/sizeof(std::uint64_t)) ; ++i) {
-        seed[i] = QRandomGenerator::global()->generate64();
-    }
-
-    nextPrngValue    = 0;
-    useNextPrngValue = false;
+    currentInputBlocks          = false;
+    currentNumberWorkers        = LatencyAggregator::defaultNumberWorkers;
+    currentRollupCoverageStart  = 0;
 }
 
 
@@ -101,7 +326,8 @@ void LatencyAggregator::Private::setParameters(
         unsigned long  inputTableMaximumAge,
         unsigned long  resamplePeriod,
         unsigned long  expungePeriod,
-        bool           inputAggregated
+        bool           inputAggregated,
+        bool           inputBlocks
     ) {
     accessMutex.lock();
 
@@ -111,11 +337,33 @@ void LatencyAggregator::Private::setParameters(
     currentResamplePeriod       = resamplePeriod;
     currentExpungePeriod        = expungePeriod;
     currentInputAggregated      = inputAggregated;
+    currentInputBlocks          = inputBlocks;
 
     accessMutex.unlock();
 }
 
 
+void LatencyAggregator::Private::setNumberWorkers(unsigned numberWorkers) {
+    accessMutex.lock();
+    currentNumberWorkers = numberWorkers;
+    accessMutex.unlock();
+}
+
+
+void LatencyAggregator::Private::setRollupCoverageStart(unsigned long long coverageStart) {
+    accessMutex.lock();
+    currentRollupCoverageStart = coverageStart;
+    accessMutex.unlock();
+}
+
+
+void LatencyAggregator::Private::setPartitionPeriods(const PartitionPeriods& partitionPeriods) {
+    accessMutex.lock();
+    currentPartitionPeriods = partitionPeriods;
+    accessMutex.unlock();
+}
+
+
 bool LatencyAggregator::Private::deleteByCustomerId(
         const CustomersCapabilities::CustomerIdSet& customerIds,
         unsigned                                    threadId
@@ -160,7 +408,7 @@ bool LatencyAggregator::Private::deleteByCustomerId(
         }
 
         QSqlQuery query(database);
-        bool success = query.exec(queryString.arg(inputTableName));
+        bool success = SqlHelpers::execute(query, queryString.arg(inputTableName));
         if (!success) {
             logWrite(
                 QString("Failed DELETE -- LatencyAggregator::deleteByCustomerId (1): %1")
@@ -168,7 +416,7 @@ bool LatencyAggregator::Private::deleteByCustomerId(
                 true
             );
         } else {
-            success = query.exec(queryString.arg(outputTableName));
+            success = SqlHelpers::execute(query, queryString.arg(outputTableName));
             if (!success) {
                 logWrite(
                     QString("Failed DELETE -- LatencyAggregator::deleteByCustomerId (2): %1")
@@ -213,13 +461,25 @@ bool LatencyAggregator::Private::deleteByCustomerId(
 
 
 void LatencyAggregator::Private::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::AGGREGATION);
+
+    QElapsedTimer runTimer;
+    runTimer.start();
+
     accessMutex.lock();
 
     QString       inputTableName       = currentInputTableName;
     QString       outputTableName      = currentOutputTableName;
     unsigned long inputTableMaximumAge = currentInputTableMaximumAge;
     bool          inputAggregated      = currentInputAggregated;
+    bool          inputBlocks          = currentInputBlocks;
     unsigned long expungePeriod        = currentExpungePeriod;
+    unsigned      numberWorkers        = currentNumberWorkers;
+
+    unsigned long long rollupCoverageStart = currentRollupCoverageStart;
+
+    unsigned long inputPartitionPeriod  = currentPartitionPeriods.value(inputTableName, 0);
+    unsigned long outputPartitionPeriod = currentPartitionPeriods.value(outputTableName, 0);
 
     accessMutex.unlock();
 
@@ -227,145 +487,454 @@ void LatencyAggregator::Private::run() {
     unsigned long long expungeThreshold = currentTime - expungePeriod;
     unsigned long long timeThreshold    = currentTime - inputTableMaximumAge;
 
-    timeThreshold = timeThreshold - (timeThreshold % currentResamplePeriod);
+    // Blocks are aggregated and pruned whole so the threshold must also fall on a block boundary.
+    unsigned long thresholdPeriod = (
+          inputBlocks
+        ? LatencyBlock::blockAlignedPeriod(currentResamplePeriod)
+        : currentResamplePeriod
+    );
+    timeThreshold = timeThreshold - (timeThreshold % thresholdPeriod);
+
+    // Periods covered by ingest-time rollups are only pruned.  Only earlier periods are aggregated here.
+    unsigned long long pruneThreshold = timeThreshold;
+    if (rollupCoverageStart != 0 && rollupCoverageStart < timeThreshold) {
+        timeThreshold = rollupCoverageStart;
+    }
 
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString("Database_%1").arg(outputTableName));
     bool success = database.isOpen();
     if (success) {
-        bool supportsTransactions;
-        if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
-            supportsTransactions = true;
-            database.transaction();
-        } else {
-            supportsTransactions = false;
+        // A watermark left by an interrupted pass means we finish that pass, with its time threshold, before starting
+        // a new one.  Ranges the interrupted pass already committed are skipped.
+        QSet<Monitor::MonitorId> completedRanges;
+        success = readWatermark(database, outputTableName, timeThreshold, completedRanges);
+
+        MonitorRangeList monitorRanges;
+        if (success) {
+            success = getMonitorRanges(database, timeThreshold, inputTableName, monitorRanges);
         }
 
-        QList<AggregatedLatencyEntry> aggregatedValues = generateAggregatedEntries(
-            success,
-            database,
-            timeThreshold,
-            currentResamplePeriod,
-            inputTableName,
-            inputAggregated
-        );
+        if (success && !completedRanges.isEmpty()) {
+            logWrite(
+                QString("Resuming interrupted aggregation into %1, %2 ranges already committed.")
+                .arg(outputTableName)
+                .arg(completedRanges.size()),
+                false
+            );
 
-        if (success) {
-            success = writeAggregatedEntries(database, aggregatedValues, outputTableName);
-            if (success) {
-                success = deleteOldEntries(database, timeThreshold, inputTableName);
+            MonitorRangeList::iterator it = monitorRanges.begin();
+            while (it != monitorRanges.end()) {
+                if (completedRanges.contains(it->firstMonitorId)) {
+                    it = monitorRanges.erase(it);
+                } else {
+                    ++it;
+                }
             }
         }
 
-        if (supportsTransactions) {
-            if (success) {
-                success = database.commit();
-                if (!success) {
-                    logWrite(
-                        QString("Failed commit - LatencyAggregator: ").arg(database.lastError().text()),
-                        true
-                    );
-                }
+        if (success && !monitorRanges.isEmpty()) {
+            unsigned long long numberRows = 0;
+            for (  MonitorRangeList::const_iterator it  = monitorRanges.constBegin(),
+                                                    end = monitorRanges.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                numberRows += it->numberRows;
+            }
+
+            // Shards are contiguous runs of monitor ranges balanced by row count.  Each shard is aggregated by its own
+            // worker on its own connection so no two workers ever touch the same monitor's rows.
+            QList<MonitorRangeList> shards = partitionMonitorRanges(monitorRanges, numberWorkers);
+            if (shards.size() <= 1) {
+                success = aggregateMonitorRanges(
+                    database,
+                    monitorRanges,
+                    timeThreshold,
+                    currentResamplePeriod,
+                    inputTableName,
+                    outputTableName,
+                    inputAggregated,
+                    inputBlocks,
+                    randomGenerator
+                );
             } else {
-                success = database.rollback();
-                if (!success) {
-                    logWrite(
-                        QString("Failed rollback - LatencyAggregator: ").arg(database.lastError().text()),
-                        true
+                QList<Worker*> workers;
+                unsigned       numberShards = static_cast<unsigned>(shards.size());
+                for (unsigned shardIndex=0 ; shardIndex<numberShards ; ++shardIndex) {
+                    Worker* worker = new Worker(
+                        this,
+                        QString("Database_%1_%2").arg(outputTableName).arg(shardIndex),
+                        shards.at(shardIndex),
+                        timeThreshold,
+                        currentResamplePeriod,
+                        inputTableName,
+                        outputTableName,
+                        inputAggregated,
+                        inputBlocks
                     );
+
+                    workers.append(worker);
+                    worker->start();
                 }
+
+                for (QList<Worker*>::const_iterator it=workers.constBegin(),end=workers.constEnd() ; it!=end ; ++it) {
+                    Worker* worker = *it;
+                    worker->wait();
+
+                    success = worker->succeeded() && success;
+                    delete worker;
+                }
+            }
+
+            if (success) {
+                MetricsRegistry::instance()->counter(
+                    QString("dbc_aggregator_rows_total"),
+                    QString("Number of input rows aggregated."),
+                    MetricsRegistry::label(QString("table"), outputTableName)
+                )->increment(numberRows);
+
+                double elapsedSeconds = std::max(runTimer.nsecsElapsed() / 1.0E9, 1.0E-3);
+                logWrite(
+                    QString("Aggregated %1 rows from %2 into %3 in %4 seconds, %5 rows/second.")
+                    .arg(numberRows)
+                    .arg(inputTableName)
+                    .arg(outputTableName)
+                    .arg(elapsedSeconds, 0, 'f', 3)
+                    .arg(numberRows / elapsedSeconds, 0, 'f', 0),
+                    false
+                );
             }
         }
+
+        if (success) {
+            clearWatermark(database, outputTableName);
+        }
+
+        if (success && pruneThreshold > timeThreshold) {
+            success = expungeEntries(database, pruneThreshold, inputTableName, 0);
+        }
     } else {
         logWrite(QString("Failed to open database - LatencyAggregator: ").arg(database.lastError().text()), true);
     }
 
+    // Partitions are created from the oldest period written by the next pass so entries rarely land in the default
+    // partition.  Raw entries arrive with current timestamps.
+    unsigned long long partitionsEnd = (
+          currentTime
+        + partitionsAhead * std::max(inputPartitionPeriod, outputPartitionPeriod)
+    );
     if (!inputAggregated) {
-        deleteOldEntries(database, expungeThreshold, inputTableName);
+        if (inputPartitionPeriod > 0) {
+            createPartitions(database, inputTableName, inputPartitionPeriod, currentTime, partitionsEnd);
+        }
+
+        expungeEntries(database, expungeThreshold, inputTableName, 0);
     }
 
-    deleteOldEntries(database, expungeThreshold, outputTableName);
+    if (outputPartitionPeriod > 0) {
+        createPartitions(
+            database,
+            outputTableName,
+            outputPartitionPeriod,
+            timeThreshold - currentResamplePeriod,
+            partitionsEnd
+        );
+    }
+
+    expungeEntries(database, expungeThreshold, outputTableName, currentResamplePeriod);
 
     currentDatabaseManager->closeAndRelease(database);
+
+    MetricsRegistry::instance()->histogram(
+        QString("dbc_aggregator_run_seconds"),
+        QString("Time spent in each aggregation pass."),
+        MetricsRegistry::label(QString("table"), outputTableName)
+    )->observe(runTimer.nsecsElapsed() / 1.0E9);
 }
 
 
-QList<AggregatedLatencyEntry> LatencyAggregator::Private::generateAggregatedEntries(
-        bool&              success,
+bool LatencyAggregator::Private::getMonitorRanges(
+        QSqlDatabase&      database,
+        unsigned long long timeThreshold,
+        const QString&     inputTableName,
+        MonitorRangeList&  monitorRanges
+    ) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    monitorRanges.clear();
+
+    bool success = SqlHelpers::execute(
+        query,
+        QString(
+            "SELECT monitor_id / %1 AS bucket, COUNT(*) FROM %2 WHERE timestamp < %3 "
+            "GROUP BY bucket ORDER BY bucket ASC"
+        ).arg(monitorsPerRange)
+         .arg(inputTableName)
+         .arg(LatencyEntry::toZoranTimestamp(timeThreshold))
+    );
+
+    while (success && query.next()) {
+        unsigned long long bucket = query.value(0).toULongLong(&success);
+        if (success) {
+            MonitorRange monitorRange;
+            monitorRange.numberRows = query.value(1).toULongLong(&success);
+
+            if (success) {
+                unsigned long long first = bucket * monitorsPerRange;
+                unsigned long long last  = std::min(
+                    first + monitorsPerRange - 1,
+                    static_cast<unsigned long long>(std::numeric_limits<Monitor::MonitorId>::max())
+                );
+
+                monitorRange.firstMonitorId = static_cast<Monitor::MonitorId>(first);
+                monitorRange.lastMonitorId  = static_cast<Monitor::MonitorId>(last);
+
+                monitorRanges.append(monitorRange);
+            }
+        }
+    }
+
+    if (!success) {
+        logWrite(
+            QString("Failed SELECT monitor ranges -- LatencyAggregator: %1")
+            .arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+QList<LatencyAggregator::Private::MonitorRangeList> LatencyAggregator::Private::partitionMonitorRanges(
+        const MonitorRangeList& monitorRanges,
+        unsigned                numberShards
+    ) {
+    QList<MonitorRangeList> result;
+
+    unsigned long long totalRows = 0;
+    for (  MonitorRangeList::const_iterator it  = monitorRanges.constBegin(),
+                                            end = monitorRanges.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        totalRows += it->numberRows;
+    }
+
+    if (numberShards <= 1 || static_cast<unsigned>(monitorRanges.size()) <= 1) {
+        result.append(monitorRanges);
+    } else {
+        // Walk the ranges in order, closing a shard each time the running row count passes the next multiple of
+        // total / numberShards.  This keeps shards contiguous while balancing rows rather than monitor IDs.
+        MonitorRangeList   currentShard;
+        unsigned long long runningRows  = 0;
+        unsigned           shardsClosed = 0;
+        for (  MonitorRangeList::const_iterator it  = monitorRanges.constBegin(),
+                                                end = monitorRanges.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            currentShard.append(*it);
+            runningRows += it->numberRows;
+
+            unsigned long long shardLimit = (totalRows * (shardsClosed + 1)) / numberShards;
+            if (runningRows >= shardLimit && shardsClosed + 1 < numberShards) {
+                result.append(currentShard);
+                currentShard.clear();
+                ++shardsClosed;
+            }
+        }
+
+        if (!currentShard.isEmpty()) {
+            result.append(currentShard);
+        }
+    }
+
+    return result;
+}
+
+
+bool LatencyAggregator::Private::aggregateMonitorRanges(
+        QSqlDatabase&           database,
+        const MonitorRangeList& monitorRanges,
+        unsigned long long      timeThreshold,
+        unsigned long           resamplePeriod,
+        const QString&          inputTableName,
+        const QString&          outputTableName,
+        bool                    inputAggregated,
+        bool                    inputBlocks,
+        RandomGenerator&        randomGenerator
+    ) {
+    // Each monitor range is aggregated, written, and pruned in its own transaction so memory use and lock duration
+    // are bounded by the range size rather than the size of the input table.
+    bool success = true;
+    for (  MonitorRangeList::const_iterator it  = monitorRanges.constBegin(),
+                                            end = monitorRanges.constEnd()
+         ; success && it != end
+         ; ++it
+        ) {
+        success = aggregateMonitorRange(
+            database,
+            timeThreshold,
+            resamplePeriod,
+            inputTableName,
+            outputTableName,
+            inputAggregated,
+            inputBlocks,
+            it->firstMonitorId,
+            it->lastMonitorId,
+            randomGenerator
+        );
+    }
+
+    return success;
+}
+
+
+bool LatencyAggregator::Private::aggregateMonitorRange(
         QSqlDatabase&      database,
         unsigned long long timeThreshold,
         unsigned long      resamplePeriod,
         const QString&     inputTableName,
-        bool               inputAggregated
+        const QString&     outputTableName,
+        bool               inputAggregated,
+        bool               inputBlocks,
+        Monitor::MonitorId firstMonitorId,
+        Monitor::MonitorId lastMonitorId,
+        RandomGenerator&   randomGenerator
     ) {
-    QList<AggregatedLatencyEntry> result;
+    // Time not spent writing, deleting or committing is spent reading and aggregating the input rows.
+    QElapsedTimer rangeTimer;
+    QElapsedTimer phaseTimer;
+    qint64        writeTime  = 0;
+    qint64        deleteTime = 0;
+    qint64        commitTime = 0;
+
+    rangeTimer.start();
+
+    bool supportsTransactions;
+    if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
+        supportsTransactions = true;
+        database.transaction();
+    } else {
+        supportsTransactions = false;
+    }
 
     QSqlQuery query(database);
     query.setForwardOnly(true);
 
-    QString queryString = QString(
-        "SELECT * FROM %1 WHERE timestamp < %2 ORDER BY monitor_id ASC, server_id ASC, timestamp ASC"
-    ).arg(inputTableName)
-     .arg(LatencyEntry::toZoranTimestamp(timeThreshold));
+    // Aggregated inputs are coarser tiers' sources and keep their own retention so their rows are never pruned here.
+    // Instead we only read input periods that follow the newest period already written for this range.
+    QString lowerBoundClause;
+    bool    success = true;
+    if (inputAggregated) {
+        success = SqlHelpers::execute(
+            query,
+            QString("SELECT MAX(end_timestamp) FROM %1 WHERE monitor_id >= %2 AND monitor_id <= %3")
+            .arg(outputTableName)
+            .arg(firstMonitorId)
+            .arg(lastMonitorId)
+        );
 
-    success = query.exec(queryString);
-    if (success) {
-        int monitorIdField       = -1;
-        int serverIdField        = -1;
-        int timestampField       = -1;
-        int latencyField         = -1;
-        int startTimestampField  = -1;
-        int endTimestampField    = -1;
-        int meanLatencyField     = -1;
-        int varianceLatencyField = -1;
-        int minimumLatencyField  = -1;
-        int maximumLatencyField  = -1;
-        int numberSamplesField   = -1;
-
-        LatencyEntry::MonitorId           monitorId       = 0;
-        LatencyEntry::ServerId            serverId        = 0;
-        unsigned long long                timestamp       = 0;
-        LatencyEntry::LatencyMicroseconds latency         = 0;
-        unsigned long long                startTimestamp  = 0;
-        unsigned long long                endTimestamp    = 0;
-        double                            meanLatency     = 0;
-        double                            varianceLatency = 0;
-        double                            minimumLatency  = 0;
-        double                            maximumLatency  = 0;
-        unsigned long                     numberSamples   = 0;
-
-        success = getFieldIndexes(
+        if (success) {
+            if (query.next() && !query.value(0).isNull()) {
+                lowerBoundClause = QString(" AND timestamp >= %1").arg(query.value(0).toUInt(&success));
+            }
+        }
+
+        if (!success) {
+            logWrite(
+                QString("Failed SELECT lower bound -- LatencyAggregator: %1")
+                .arg(query.lastError().text()),
+                true
+            );
+        }
+    }
+
+    QString selectString = QString(
+        "SELECT * FROM %1 "
+        "WHERE timestamp < %2%3 AND monitor_id >= %4 AND monitor_id <= %5 "
+        "ORDER BY monitor_id ASC, server_id ASC, timestamp ASC"
+    ).arg(inputTableName)
+     .arg(LatencyEntry::toZoranTimestamp(timeThreshold))
+     .arg(lowerBoundClause)
+     .arg(firstMonitorId)
+     .arg(lastMonitorId);
+
+    // A server-side cursor lets us pull the range in fixed size pieces.  Cursors require a transaction so we fall
+    // back to a single SELECT on drivers without transaction support.
+    QString fetchString;
+    if (success && supportsTransactions) {
+        success = SqlHelpers::execute(
             query,
-            inputAggregated,
-            monitorIdField,
-            serverIdField,
-            timestampField,
-            latencyField,
-            startTimestampField,
-            endTimestampField,
-            meanLatencyField,
-            varianceLatencyField,
-            minimumLatencyField,
-            maximumLatencyField,
-            numberSamplesField
+            QString("DECLARE aggregation_cursor NO SCROLL CURSOR FOR %1").arg(selectString)
         );
+        if (success) {
+            fetchString = QString("FETCH FORWARD %1 FROM aggregation_cursor").arg(cursorFetchSize);
+        } else {
+            logWrite(
+                QString("Failed DECLARE CURSOR -- LatencyAggregator: %1")
+                .arg(query.lastError().text()),
+                true
+            );
+        }
+    } else if (success) {
+        fetchString = selectString;
+    }
 
+    QList<AggregatedLatencyEntry> pendingEntries;
+    QList<LatencySketch>          pendingSketches;
+
+    LatencyEntry::MonitorId           monitorId       = 0;
+    LatencyEntry::ServerId            serverId        = 0;
+    unsigned long long                timestamp       = 0;
+    LatencyEntry::LatencyMicroseconds latency         = 0;
+    unsigned long long                startTimestamp  = 0;
+    unsigned long long                endTimestamp    = 0;
+    double                            meanLatency     = 0;
+    double                            varianceLatency = 0;
+    double                            minimumLatency  = 0;
+    double                            maximumLatency  = 0;
+    unsigned long                     numberSamples   = 0;
+
+    LatencyEntry::MonitorId lastSeenMonitorId    = Monitor::invalidMonitorId;
+    LatencyEntry::ServerId  lastSeenServerId     = Server::invalidServerId;
+    unsigned long long      periodStartTimestamp = 0;
+    unsigned long long      periodEndTimestamp   = 0;
+
+    PeriodAccumulator accumulator;
+    LatencySketch     aggregatedSketch;
+
+    // Samples from the current block are consumed before the next row is read.
+    LatencyBlock::SampleList blockSamples;
+    int                      blockSampleIndex = 0;
+
+    bool moreRows = success;
+    while (success && moreRows) {
+        success = SqlHelpers::execute(query, fetchString);
         if (success) {
-            LatencyEntry::MonitorId lastMonitorId        = Monitor::invalidMonitorId;
-            LatencyEntry::ServerId  lastServerId         = Server::invalidServerId;
-            unsigned long long      periodStartTimestamp = 0;
-            unsigned long long      periodEndTimestamp   = 0;
-
-            QList<ShortLatencyEntry>          shortValues;
-            QList<WeightsAndMeans>            weightsAndMeans;
-            double                            weightedSumMeanLatency     = 0;
-            double                            weightedSumVarianceLatency = 0;
-            LatencyEntry::LatencyMicroseconds aggregatedMinimumLatency   =
-                std::numeric_limits<LatencyEntry::LatencyMicroseconds>::max();
-            LatencyEntry::LatencyMicroseconds aggregatedMaximumLatency   = 0;
-            unsigned long                     aggregatedNumberSamples    = 0;
-
-            while (success && query.next()) {
-                success = getRecord(
+            int monitorIdField       = -1;
+            int serverIdField        = -1;
+            int timestampField       = -1;
+            int latencyField         = -1;
+            int startTimestampField  = -1;
+            int endTimestampField    = -1;
+            int meanLatencyField     = -1;
+            int varianceLatencyField = -1;
+            int minimumLatencyField  = -1;
+            int maximumLatencyField  = -1;
+            int numberSamplesField   = -1;
+            int samplesField         = -1;
+
+            if (inputBlocks) {
+                monitorIdField = query.record().indexOf("monitor_id");
+                serverIdField  = query.record().indexOf("server_id");
+                samplesField   = query.record().indexOf("samples");
+
+                success = (monitorIdField >= 0 && serverIdField >= 0 && samplesField >= 0);
+            } else {
+                success = getFieldIndexes(
                     query,
                     inputAggregated,
                     monitorIdField,
@@ -378,141 +947,283 @@ QList<AggregatedLatencyEntry> LatencyAggregator::Private::generateAggregatedEntr
                     varianceLatencyField,
                     minimumLatencyField,
                     maximumLatencyField,
-                    numberSamplesField,
-                    monitorId,
-                    serverId,
-                    timestamp,
-                    latency,
-                    startTimestamp,
-                    endTimestamp,
-                    meanLatency,
-                    varianceLatency,
-                    minimumLatency,
-                    maximumLatency,
-                    numberSamples
+                    numberSamplesField
                 );
+            }
 
-                if (success) {
-                    if (monitorId != lastMonitorId || serverId != lastServerId || endTimestamp >= periodEndTimestamp) {
-                        if (lastMonitorId != Monitor::invalidMonitorId &&
-                            lastServerId != Server::invalidServerId    &&
-                            !shortValues.isEmpty()                        ) {
-                            AggregatedLatencyEntry aggregatedEntry = generateEntry(
-                                lastMonitorId,
-                                lastServerId,
-                                weightedSumMeanLatency,
-                                weightedSumVarianceLatency,
-                                shortValues,
-                                weightsAndMeans,
-                                periodStartTimestamp,
-                                periodEndTimestamp,
-                                aggregatedMinimumLatency,
-                                aggregatedMaximumLatency,
-                                aggregatedNumberSamples
+            if (!success) {
+                logWrite(
+                    QString("Failed to obtain field index values -- LatencyAggregator: %1")
+                    .arg(query.lastError().text()),
+                    true
+                );
+            }
+
+            int latencySketchField = inputAggregated ? query.record().indexOf("latency_sketch") : -1;
+
+            moreRows = false;
+            while (success && (blockSampleIndex < blockSamples.size() || query.next())) {
+                moreRows = supportsTransactions;
+
+                bool haveRecord = true;
+                if (inputBlocks) {
+                    if (blockSampleIndex >= blockSamples.size()) {
+                        // A corrupt block is skipped, and pruned with the rest of the range, so it can't stall
+                        // aggregation of every other monitor in the range.
+                        blockSampleIndex = 0;
+                        if (!getBlockRecord(
+                                query,
+                                monitorIdField,
+                                serverIdField,
+                                samplesField,
+                                monitorId,
+                                serverId,
+                                blockSamples
+                            )) {
+                            logWrite(
+                                QString("Skipping invalid latency block for monitor %1, server %2 -- LatencyAggregator")
+                                .arg(monitorId)
+                                .arg(serverId),
+                                true
                             );
+                        }
+                    }
+
+                    haveRecord = (blockSampleIndex < blockSamples.size());
+                    if (haveRecord) {
+                        const LatencyBlock::Sample& sample = blockSamples.at(blockSampleIndex);
 
-                            shortValues.clear();
-                            weightsAndMeans.clear();
+                        timestamp      = LatencyEntry::toUnixTimestamp(sample.timestamp);
+                        latency        = sample.latency;
+                        startTimestamp = timestamp;
+                        endTimestamp   = timestamp;
 
-                            weightedSumMeanLatency     = 0;
-                            weightedSumVarianceLatency = 0;
-                            aggregatedMinimumLatency   = std::numeric_limits<LatencyEntry::LatencyMicroseconds>::max();
-                            aggregatedMaximumLatency   = 0;
-                            aggregatedNumberSamples    = 0;
+                        ++blockSampleIndex;
+                    }
+                } else {
+                    success = getRecord(
+                        query,
+                        inputAggregated,
+                        monitorIdField,
+                        serverIdField,
+                        timestampField,
+                        latencyField,
+                        startTimestampField,
+                        endTimestampField,
+                        meanLatencyField,
+                        varianceLatencyField,
+                        minimumLatencyField,
+                        maximumLatencyField,
+                        numberSamplesField,
+                        monitorId,
+                        serverId,
+                        timestamp,
+                        latency,
+                        startTimestamp,
+                        endTimestamp,
+                        meanLatency,
+                        varianceLatency,
+                        minimumLatency,
+                        maximumLatency,
+                        numberSamples
+                    );
+                }
 
-                            result.append(aggregatedEntry);
+                if (success && haveRecord) {
+                    if (monitorId != lastSeenMonitorId         ||
+                        serverId != lastSeenServerId           ||
+                        startTimestamp >= periodEndTimestamp      ) {
+                        if (lastSeenMonitorId != Monitor::invalidMonitorId &&
+                            lastSeenServerId != Server::invalidServerId    &&
+                            !accumulator.isEmpty()                            ) {
+                            pendingEntries.append(
+                                accumulator.entry(
+                                    lastSeenMonitorId,
+                                    lastSeenServerId,
+                                    periodStartTimestamp,
+                                    periodEndTimestamp
+                                )
+                            );
+                            pendingSketches.append(aggregatedSketch);
+
+                            accumulator.clear();
+                            aggregatedSketch.clear();
+
+                            if (static_cast<unsigned long>(pendingEntries.size()) >= writeBatchSize) {
+                                phaseTimer.start();
+                                success = writeAggregatedEntries(
+                                    database,
+                                    pendingEntries,
+                                    pendingSketches,
+                                    outputTableName
+                                );
+                                writeTime += phaseTimer.nsecsElapsed();
+
+                                pendingEntries.clear();
+                                pendingSketches.clear();
+                            }
                         }
 
-                        lastMonitorId = monitorId;
-                        lastServerId  = serverId;
+                        lastSeenMonitorId = monitorId;
+                        lastSeenServerId  = serverId;
 
                         // Note that the algorithm relies on two conditions:
                         // - Entries have been sorted by the database first by time order.
                         // - Within the sort, all start/end values bound the actual sample time.
+                        //
+                        // Periods are keyed by the start timestamp.  For raw entries the start and end timestamps are
+                        // the same.  For aggregated entries, the end timestamp is the first second of the next period.
 
-                        if (endTimestamp >= periodEndTimestamp || startTimestamp < periodStartTimestamp) {
-                            periodStartTimestamp = endTimestamp - (endTimestamp % resamplePeriod);
+                        if (startTimestamp >= periodEndTimestamp || startTimestamp < periodStartTimestamp) {
+                            periodStartTimestamp = startTimestamp - (startTimestamp % resamplePeriod);
                             periodEndTimestamp   = periodStartTimestamp + resamplePeriod;
                         }
                     }
 
                     if (inputAggregated) {
-                        weightedSumMeanLatency     += numberSamples * meanLatency;
-                        weightedSumVarianceLatency += numberSamples * varianceLatency;
-
-                        if (minimumLatency < aggregatedMinimumLatency) {
-                            aggregatedMinimumLatency = minimumLatency;
+                        accumulator.add(
+                            meanLatency,
+                            varianceLatency,
+                            static_cast<LatencyEntry::LatencyMicroseconds>(minimumLatency),
+                            static_cast<LatencyEntry::LatencyMicroseconds>(maximumLatency),
+                            numberSamples,
+                            LatencyEntry::toZoranTimestamp(timestamp),
+                            latency,
+                            randomGenerator
+                        );
+
+                        // Entries written before sketches were introduced only contribute their representative
+                        // sample, weighted by the number of samples in the entry.
+                        QVariant sketchValue = latencySketchField >= 0 ? query.value(latencySketchField) : QVariant();
+                        if (!sketchValue.isNull()) {
+                            aggregatedSketch.merge(LatencySketch::fromByteArray(sketchValue.toByteArray()));
+                        } else {
+                            aggregatedSketch.addValue(latency, numberSamples);
                         }
-
-                        if (maximumLatency > aggregatedMaximumLatency) {
-                            aggregatedMaximumLatency = maximumLatency;
-                        }
-
-                        weightsAndMeans.append(WeightsAndMeans(meanLatency, numberSamples));
-
-                        aggregatedNumberSamples += numberSamples;
                     } else {
-                        weightedSumMeanLatency += latency;
-
-                        if (latency < aggregatedMinimumLatency) {
-                            aggregatedMinimumLatency = latency;
-                        }
-
-                        if (latency > aggregatedMaximumLatency) {
-                            aggregatedMaximumLatency = latency;
-                        }
-
-                        weightsAndMeans.append(latency);
-                        ++aggregatedNumberSamples;
+                        accumulator.add(
+                            latency,
+                            0,
+                            latency,
+                            latency,
+                            1,
+                            LatencyEntry::toZoranTimestamp(timestamp),
+                            latency,
+                            randomGenerator
+                        );
+
+                        aggregatedSketch.addValue(latency);
                     }
-
-                    shortValues.append(ShortLatencyEntry(LatencyEntry::toZoranTimestamp(timestamp), latency));
                 }
             }
-
-            if (lastMonitorId != Monitor::invalidMonitorId &&
-                lastServerId != Server::invalidServerId    &&
-                !shortValues.isEmpty()                        ) {
-                AggregatedLatencyEntry aggregatedEntry = generateEntry(
-                    lastMonitorId,
-                    lastServerId,
-                    weightedSumMeanLatency,
-                    weightedSumVarianceLatency,
-                    shortValues,
-                    weightsAndMeans,
-                    periodStartTimestamp,
-                    periodEndTimestamp,
-                    aggregatedMinimumLatency,
-                    aggregatedMaximumLatency,
-                    aggregatedNumberSamples
-                );
-
-                result.append(aggregatedEntry);
-            }
         } else {
             logWrite(
-                QString("Failed to obtain field index values -- LatencyAggregator: %1")
+                QString("Failed SELECT -- LatencyAggregator: %1")
                 .arg(query.lastError().text()),
                 true
             );
-            success = false;
         }
-    } else {
-        logWrite(
-            QString("Failed SELECT -- LatencyAggregator: %1")
-            .arg(query.lastError().text()),
-            true
+    }
+
+    if (success                                        &&
+        lastSeenMonitorId != Monitor::invalidMonitorId &&
+        lastSeenServerId != Server::invalidServerId    &&
+        !accumulator.isEmpty()                            ) {
+        pendingEntries.append(
+            accumulator.entry(
+                lastSeenMonitorId,
+                lastSeenServerId,
+                periodStartTimestamp,
+                periodEndTimestamp
+            )
         );
-        success = false;
+        pendingSketches.append(aggregatedSketch);
     }
 
-    return result;
+    if (success && !pendingEntries.isEmpty()) {
+        phaseTimer.start();
+        success = writeAggregatedEntries(database, pendingEntries, pendingSketches, outputTableName);
+        writeTime += phaseTimer.nsecsElapsed();
+    }
+
+    if (success && supportsTransactions) {
+        success = SqlHelpers::execute(query, "CLOSE aggregation_cursor");
+        if (!success) {
+            logWrite(
+                QString("Failed CLOSE CURSOR -- LatencyAggregator: %1")
+                .arg(query.lastError().text()),
+                true
+            );
+        }
+    }
+
+    if (success && !inputAggregated) {
+        phaseTimer.start();
+        success = deleteOldEntries(database, timeThreshold, inputTableName, firstMonitorId, lastMonitorId);
+        deleteTime = phaseTimer.nsecsElapsed();
+    }
+
+    if (success) {
+        success = writeWatermark(database, outputTableName, timeThreshold, firstMonitorId);
+    }
+
+    if (supportsTransactions) {
+        if (success) {
+            phaseTimer.start();
+            success = database.commit();
+            commitTime = phaseTimer.nsecsElapsed();
+
+            if (!success) {
+                logWrite(
+                    QString("Failed commit - LatencyAggregator: %1").arg(database.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            if (!database.rollback()) {
+                logWrite(
+                    QString("Failed rollback - LatencyAggregator: %1").arg(database.lastError().text()),
+                    true
+                );
+            }
+        }
+    }
+
+    if (success) {
+        qint64 generateTime = rangeTimer.nsecsElapsed() - writeTime - deleteTime - commitTime;
+
+        recordPhaseTime(outputTableName, QString("generate"), generateTime);
+        recordPhaseTime(outputTableName, QString("write"), writeTime);
+        recordPhaseTime(outputTableName, QString("commit"), commitTime);
+
+        if (!inputAggregated) {
+            recordPhaseTime(outputTableName, QString("delete"), deleteTime);
+        }
+    }
+
+    return success;
+}
+
+
+void LatencyAggregator::Private::recordPhaseTime(
+        const QString& outputTableName,
+        const QString& phase,
+        qint64         elapsedTime
+    ) {
+    MetricsRegistry::instance()->histogram(
+        QString("dbc_aggregator_phase_seconds"),
+        QString("Time spent in each phase of aggregating a monitor range."),
+          MetricsRegistry::label(QString("table"), outputTableName)
+        + QString(",")
+        + MetricsRegistry::label(QString("phase"), phase)
+    )->observe(elapsedTime / 1.0E9);
 }
 
 
 bool LatencyAggregator::Private::writeAggregatedEntries(
         QSqlDatabase&                        database,
         const QList<AggregatedLatencyEntry>& aggregatedEntries,
+        const QList<LatencySketch>&          latencySketches,
         const QString&                       outputTableName
     ) {
     QString queryString  = QString(
@@ -527,57 +1238,153 @@ bool LatencyAggregator::Private::writeAggregatedEntries(
             "variance_latency, "
             "minimum_latency, "
             "maximum_latency, "
-            "number_samples"
-        ") VALUES ("
-            ":monitor_id, "
-            ":server_id, "
-            ":timestamp, "
-            ":latency, "
-            ":start_timestamp, "
-            ":end_timestamp, "
-            ":mean_latency, "
-            ":variance_latency, "
-            ":minimum_latency, "
-            ":maximum_latency, "
-            ":number_samples"
-        ") ON CONFLICT DO NOTHING"
+            "number_samples, "
+            "latency_sketch"
+        ") VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?) ON CONFLICT DO NOTHING"
     ).arg(outputTableName);
 
+    // Every row is queued on a single pipeline so the whole batch costs roughly one round trip rather than one per
+    // aggregated entry.
+    StatementPipeline pipeline(database);
+
+    QList<AggregatedLatencyEntry>::const_iterator entryIterator    = aggregatedEntries.constBegin();
+    QList<AggregatedLatencyEntry>::const_iterator entryEndIterator = aggregatedEntries.constEnd();
+    QList<LatencySketch>::const_iterator          sketchIterator   = latencySketches.constBegin();
+    while (entryIterator != entryEndIterator) {
+        const AggregatedLatencyEntry& entry = *entryIterator;
+
+        QVariantList parameters;
+        parameters << entry.monitorId()
+                   << entry.serverId()
+                   << entry.zoranTimestamp()
+                   << entry.latencyMicroseconds()
+                   << entry.startZoranTimestamp()
+                   << entry.endZoranTimestamp()
+                   << entry.meanLatency()
+                   << entry.varianceLatency()
+                   << entry.minimumLatency()
+                   << entry.maximumLatency()
+                   << static_cast<unsigned>(entry.numberSamples())
+                   << sketchIterator->toByteArray();
+
+        pipeline.append(queryString, parameters);
+
+        ++entryIterator;
+        ++sketchIterator;
+    }
+
+    bool success = pipeline.execute();
+    if (!success) {
+        logWrite(
+            QString("Failed to execute INSERT -- LatencyAggregator: %1")
+            .arg(pipeline.lastError()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool LatencyAggregator::Private::readWatermark(
+        QSqlDatabase&             database,
+        const QString&            outputTableName,
+        unsigned long long&       timeThreshold,
+        QSet<Monitor::MonitorId>& completedRanges
+    ) {
     QSqlQuery query(database);
-    bool success = query.prepare(queryString);
+    query.setForwardOnly(true);
+
+    completedRanges.clear();
+
+    bool success = query.prepare(
+        QString("SELECT first_monitor_id, time_threshold FROM %1 WHERE output_table = :output_table")
+        .arg(watermarkTableName)
+    );
+
     if (success) {
-        QList<AggregatedLatencyEntry>::const_iterator entryIterator    = aggregatedEntries.constBegin();
-        QList<AggregatedLatencyEntry>::const_iterator entryEndIterator = aggregatedEntries.constEnd();
-        while (success && entryIterator != entryEndIterator) {
-            const AggregatedLatencyEntry& entry = *entryIterator;
-
-            query.bindValue(":monitor_id", entry.monitorId());
-            query.bindValue(":server_id", entry.serverId());
-            query.bindValue(":timestamp", entry.zoranTimestamp());
-            query.bindValue(":latency", entry.latencyMicroseconds());
-            query.bindValue(":start_timestamp", entry.startZoranTimestamp());
-            query.bindValue(":end_timestamp", entry.endZoranTimestamp());
-            query.bindValue(":mean_latency", entry.meanLatency());
-            query.bindValue(":variance_latency", entry.varianceLatency());
-            query.bindValue(":minimum_latency", entry.minimumLatency());
-            query.bindValue(":maximum_latency", entry.maximumLatency());
-            query.bindValue(":number_samples", static_cast<unsigned>(entry.numberSamples()));
-
-            success = query.exec();
-
-            ++entryIterator;
+        query.bindValue(":output_table", outputTableName);
+        success = SqlHelpers::execute(query);
+    }
+
+    unsigned long long watermarkThreshold = std::numeric_limits<unsigned long long>::max();
+    while (success && query.next()) {
+        Monitor::MonitorId firstMonitorId = query.value(0).toUInt(&success);
+        if (success) {
+            unsigned long long rangeThreshold = query.value(1).toULongLong(&success);
+            if (success) {
+                completedRanges.insert(firstMonitorId);
+                watermarkThreshold = std::min(watermarkThreshold, rangeThreshold);
+            }
         }
+    }
 
-        if (!success) {
-            logWrite(
-                QString("Failed to execute INSERT -- LatencyAggregator: %1")
-                .arg(query.lastError().text()),
-                true
-            );
+    if (success) {
+        if (!completedRanges.isEmpty()) {
+            timeThreshold = watermarkThreshold;
         }
     } else {
         logWrite(
-            QString("Failed to prepare INSERT -- LatencyAggregator: %1")
+            QString("Failed SELECT watermark -- LatencyAggregator: %1")
+            .arg(query.lastError().text()),
+            true
+        );
+
+        completedRanges.clear();
+    }
+
+    return success;
+}
+
+
+bool LatencyAggregator::Private::writeWatermark(
+        QSqlDatabase&      database,
+        const QString&     outputTableName,
+        unsigned long long timeThreshold,
+        Monitor::MonitorId firstMonitorId
+    ) {
+    QSqlQuery query(database);
+
+    bool success = query.prepare(
+        QString(
+            "INSERT INTO %1 (output_table, first_monitor_id, time_threshold) "
+            "VALUES (:output_table, :first_monitor_id, :time_threshold) "
+            "ON CONFLICT (output_table, first_monitor_id) DO UPDATE SET time_threshold = EXCLUDED.time_threshold"
+        ).arg(watermarkTableName)
+    );
+
+    if (success) {
+        query.bindValue(":output_table", outputTableName);
+        query.bindValue(":first_monitor_id", firstMonitorId);
+        query.bindValue(":time_threshold", timeThreshold);
+
+        success = SqlHelpers::execute(query);
+    }
+
+    if (!success) {
+        logWrite(
+            QString("Failed INSERT watermark -- LatencyAggregator: %1")
+            .arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool LatencyAggregator::Private::clearWatermark(QSqlDatabase& database, const QString& outputTableName) {
+    QSqlQuery query(database);
+
+    bool success = query.prepare(QString("DELETE FROM %1 WHERE output_table = :output_table").arg(watermarkTableName));
+    if (success) {
+        query.bindValue(":output_table", outputTableName);
+        success = SqlHelpers::execute(query);
+    }
+
+    if (!success) {
+        logWrite(
+            QString("Failed DELETE watermark -- LatencyAggregator: %1")
             .arg(query.lastError().text()),
             true
         );
@@ -590,14 +1397,21 @@ bool LatencyAggregator::Private::writeAggregatedEntries(
 bool LatencyAggregator::Private::deleteOldEntries(
         QSqlDatabase&      database,
         unsigned long long timeThreshold,
-        const QString&     inputTableName
+        const QString&     inputTableName,
+        Monitor::MonitorId firstMonitorId,
+        Monitor::MonitorId lastMonitorId
     ) {
-    QString   queryString  = QString("DELETE FROM %1 WHERE timestamp < %2")
-                             .arg(inputTableName)
-                             .arg(LatencyEntry::toZoranTimestamp(timeThreshold));
+    QString queryString = QString("DELETE FROM %1 WHERE timestamp < %2")
+                          .arg(inputTableName)
+                          .arg(LatencyEntry::toZoranTimestamp(timeThreshold));
+
+    if (firstMonitorId != 0 || lastMonitorId != std::numeric_limits<Monitor::MonitorId>::max()) {
+        queryString += QString(" AND monitor_id >= %1 AND monitor_id <= %2").arg(firstMonitorId).arg(lastMonitorId);
+    }
+
     QSqlQuery query(database);
 
-    bool success = query.exec(queryString);
+    bool success = SqlHelpers::execute(query, queryString);
     if (!success) {
         logWrite(
             QString("Failed DELETE -- LatencyAggregator: %1")
@@ -610,6 +1424,65 @@ bool LatencyAggregator::Private::deleteOldEntries(
 }
 
 
+bool LatencyAggregator::Private::expungeEntries(
+        QSqlDatabase&      database,
+        unsigned long long timeThreshold,
+        const QString&     tableName,
+        unsigned long      entryPeriod
+    ) {
+    long long zoranThreshold = static_cast<long long>(LatencyEntry::toZoranTimestamp(timeThreshold));
+
+    bool partitioned;
+    bool success = SqlHelpers::dropPartitions(
+        database,
+        tableName,
+        zoranThreshold - static_cast<long long>(entryPeriod),
+        partitioned
+    );
+
+    // Aggregated tables are partitioned on the start timestamp.  Bounding it as well lets the planner limit the row
+    // delete to the partition straddling the threshold and the default partition.
+    if (success && partitioned && entryPeriod > 0) {
+        QSqlQuery query(database);
+        success = SqlHelpers::execute(
+            query,
+            QString("DELETE FROM %1 WHERE timestamp < %2 AND start_timestamp < %2")
+            .arg(tableName)
+            .arg(LatencyEntry::toZoranTimestamp(timeThreshold))
+        );
+
+        if (!success) {
+            logWrite(
+                QString("Failed DELETE -- LatencyAggregator: %1")
+                .arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        success = deleteOldEntries(database, timeThreshold, tableName) && success;
+    }
+
+    return success;
+}
+
+
+bool LatencyAggregator::Private::createPartitions(
+        QSqlDatabase&      database,
+        const QString&     tableName,
+        unsigned long      partitionPeriod,
+        unsigned long long startTimestamp,
+        unsigned long long endTimestamp
+    ) {
+    return SqlHelpers::createPartitions(
+        database,
+        tableName,
+        static_cast<long long>(partitionPeriod),
+        static_cast<long long>(LatencyEntry::toZoranTimestamp(startTimestamp)),
+        static_cast<long long>(LatencyEntry::toZoranTimestamp(endTimestamp))
+    );
+}
+
+
 bool LatencyAggregator::Private::getFieldIndexes(
         const QSqlQuery& query,
         bool             inputIsAggregated,
@@ -732,79 +1605,23 @@ bool LatencyAggregator::Private::getRecord(
 }
 
 
-AggregatedLatencyEntry LatencyAggregator::Private::generateEntry(
-        AggregatedLatencyEntry::MonitorId                         monitorId,
-        AggregatedLatencyEntry::ServerId                          serverId,
-        double                                                    weightedSumMeanLatency,
-        double                                                    weightedSumVarianceLatency,
-        const QList<ShortLatencyEntry>&                           rawValues,
-        const QList<LatencyAggregator::Private::WeightsAndMeans>& weightsAndMeans,
-        unsigned long long                                        periodStartTimestamp,
-        unsigned long long                                        periodEndTimestamp,
-        AggregatedLatencyEntry::LatencyMicroseconds               minimumLatency,
-        AggregatedLatencyEntry::LatencyMicroseconds               maximumLatency,
-        unsigned long                                             numberSamples
+bool LatencyAggregator::Private::getBlockRecord(
+        const QSqlQuery&          query,
+        int                       monitorIdField,
+        int                       serverIdField,
+        int                       samplesField,
+        Monitor::MonitorId&       monitorId,
+        Server::ServerId&         serverId,
+        LatencyBlock::SampleList& samples
     ) {
-    double aggregationMeanLatency = weightedSumMeanLatency / numberSamples;
-
-    unsigned numberPoints = static_cast<unsigned>(weightsAndMeans.size());
-    for (unsigned i=0 ; i<numberPoints ; ++i) {
-        const WeightsAndMeans& wam  = weightsAndMeans.at(i);
-        double                 d    = wam.meanValue() - aggregationMeanLatency;
-        weightedSumVarianceLatency += wam.numberSamples() * d * d;
-    }
-
-    double aggregationVarianceLatency = weightedSumVarianceLatency / numberSamples;
-
-    const ShortLatencyEntry& shortEntry = rawValues.at(prng() % rawValues.size());
-    return AggregatedLatencyEntry(
-        monitorId,
-        serverId,
-        shortEntry.zoranTimestamp(),
-        shortEntry.latencyMicroseconds(),
-        LatencyEntry::toZoranTimestamp(periodStartTimestamp),
-        LatencyEntry::toZoranTimestamp(periodEndTimestamp),
-        aggregationMeanLatency,
-        aggregationVarianceLatency,
-        minimumLatency,
-        maximumLatency,
-        numberSamples
-    );
-}
-
-
-std::uint32_t LatencyAggregator::Private::prng() {
-    std::uint32_t result;
-    if (useNextPrngValue) {
-        useNextPrngValue = false;
-        result           = nextPrngValue;
-    } else {
-        std::uint64_t s0 = seed[0];
-        std::uint64_t s1 = seed[1];
-        std::uint64_t s2 = seed[2];
-        std::uint64_t s3 = seed[3];
-
-        std::uint64_t t = s1 << 17;
-        std::uint64_t r = s0 + s3;
-
-        s2 ^= s0;
-        s3 ^= s1;
-        s1 ^= s2;
-        s0 ^= s3;
-
-        s2 ^= t;
-        s3 = (s3 << 45) | (s3 >> 19);
-
-        seed[0] = s0;
-        seed[1] = s1;
-        seed[2] = s2;
-        seed[3] = s3;
-
-        nextPrngValue    = static_cast<std::uint32_t>(r >> 32);
-        useNextPrngValue = true;
-
-        result = static_cast<std::uint32_t>(r);
+    bool success;
+    monitorId = query.value(monitorIdField).toUInt(&success);
+    if (success) {
+        serverId = query.value(serverIdField).toUInt(&success);
+        if (success) {
+            success = LatencyBlock::decode(query.value(samplesField).toByteArray(), samples);
+        }
     }
 
-    return result;
+    return success;
 }
@@ -28,11 +28,18 @@
 #include <QString>
 #include <QMutex>
 #include <QSqlDatabase>
+#include <QList>
+#include <QSet>
 
 #include <cstdint>
+#include <limits>
 
+#include "monitor.h"
+#include "server.h"
 #include "short_latency_entry.h"
 #include "aggregated_latency_entry.h"
+#include "latency_sketch.h"
+#include "latency_block.h"
 #include "latency_aggregator.h"
 
 class QTimer;
@@ -107,6 +114,8 @@ class LatencyAggregator::Private:public QThread {
          *
          * \param[in] inputAlreadyAggregated If true, then the input table will contain additional entries for mean and
          *                                   variance.
+         *
+         * \param[in] inputBlocks            If true, then the input table holds raw entries as compressed blocks.
          */
         void setParameters(
             const QString& inputTableName,
@@ -114,7 +123,8 @@ class LatencyAggregator::Private:public QThread {
             unsigned long  inputTableMaximumAge,
             unsigned long  resamplePeriod,
             unsigned long  expungePeriod,
-            bool           inputAggregated
+            bool           inputAggregated,
+            bool           inputBlocks
         );
 
         /**
@@ -128,6 +138,29 @@ class LatencyAggregator::Private:public QThread {
          */
         bool deleteByCustomerId(const CustomersCapabilities::CustomerIdSet& customerIds, unsigned threadId);
 
+        /**
+         * Slot you can trigger to set the number of worker threads used to aggregate data.
+         *
+         * \param[in] numberWorkers The number of worker threads.  A value of zero or one aggregates on this thread.
+         */
+        void setNumberWorkers(unsigned numberWorkers);
+
+        /**
+         * Slot you can trigger to indicate that statistics for periods starting at or after a given time are rolled
+         * up as entries arrive.
+         *
+         * \param[in] coverageStart The Unix timestamp of the first rolled up period.  A value of zero indicates that
+         *                          every period should be aggregated.
+         */
+        void setRollupCoverageStart(unsigned long long coverageStart);
+
+        /**
+         * Slot you can trigger to set the partition periods of time-range partitioned tables.
+         *
+         * \param[in] partitionPeriods The partition period of each partitioned table.
+         */
+        void setPartitionPeriods(const PartitionPeriods& partitionPeriods);
+
     protected:
         /**
          * Method that performs the aggregation in the background.
@@ -136,89 +169,362 @@ class LatencyAggregator::Private:public QThread {
 
     private:
         /**
-         * Class used to track our weights and mean values.
+         * Class that generates random values using the XORSHRO256++ algorithm with a random initial seed.  Each
+         * thread uses its own instance.
+         */
+        class RandomGenerator {
+            public:
+                RandomGenerator();
+
+                /**
+                 * Method that calculates a random value.
+                 *
+                 * \return Returns a random 32-bit value.
+                 */
+                std::uint32_t next();
+
+            private:
+                /**
+                 * Seed used to generate random values.
+                 */
+                std::uint64_t seed[4];
+
+                /**
+                 * Value used to generate fewer random values.
+                 */
+                std::uint32_t nextValue;
+
+                /**
+                 * Flag indicating that the next value should be used.
+                 */
+                bool useNextValue;
+        };
+
+        /**
+         * Trivial class used to describe a range of monitor IDs to be aggregated.
          */
-        class WeightsAndMeans {
+        class MonitorRange {
+            public:
+                /**
+                 * The first monitor ID in the range.
+                 */
+                Monitor::MonitorId firstMonitorId;
+
+                /**
+                 * The last monitor ID in the range, inclusive.
+                 */
+                Monitor::MonitorId lastMonitorId;
+
+                /**
+                 * The number of input rows in the range.
+                 */
+                unsigned long long numberRows;
+        };
+
+        /**
+         * Type used to represent a list of monitor ranges.
+         */
+        typedef QList<MonitorRange> MonitorRangeList;
+
+        /**
+         * Class used to aggregate a shard of monitor ranges on its own thread and database connection.
+         */
+        class Worker:public QThread {
             public:
                 /**
                  * Constructor
                  *
-                 * \param[in] meanValue     The mean value in this population.
+                 * \param[in] owner           The aggregator that owns this worker.
+                 *
+                 * \param[in] databaseName    The name of the database connection used by this worker.
+                 *
+                 * \param[in] monitorRanges   The monitor ranges to be aggregated.
+                 *
+                 * \param[in] timeThreshold   The time threshold for this aggregation.
                  *
-                 * \param[in] numberSamples The number of samples in this population.
+                 * \param[in] resamplePeriod  The period for resampling operations.
+                 *
+                 * \param[in] inputTableName  The name of the input table to be processed.
+                 *
+                 * \param[in] outputTableName The name of the table to write the aggregated entries to.
+                 *
+                 * \param[in] inputAggregated If true, the input table has already been aggregated.
+                 *
+                 * \param[in] inputBlocks     If true, the input table holds compressed blocks.
                  */
-                inline WeightsAndMeans(
-                        double        meanValue,
-                        unsigned long numberSamples = 1
-                    ):currentMeanValue(
-                           meanValue
-                    ),currentNumberSamples(
-                        numberSamples
-                    ) {}
+                Worker(
+                    Private*                owner,
+                    const QString&          databaseName,
+                    const MonitorRangeList& monitorRanges,
+                    unsigned long long      timeThreshold,
+                    unsigned long           resamplePeriod,
+                    const QString&          inputTableName,
+                    const QString&          outputTableName,
+                    bool                    inputAggregated,
+                    bool                    inputBlocks
+                );
+
+                ~Worker() override;
 
                 /**
-                 * Copy constructor
+                 * Method you can use to determine if this worker completed successfully.
                  *
-                 * \param[in] other The instance to assign to this instance.
+                 * \return Returns true if every range was aggregated.
                  */
-                inline WeightsAndMeans(
-                        const WeightsAndMeans& other
-                    ):currentMeanValue(
-                        other.currentMeanValue
-                    ),currentNumberSamples(
-                        other.currentNumberSamples
-                    ) {}
+                bool succeeded() const;
 
-                ~WeightsAndMeans() = default;
+            protected:
+                /**
+                 * Method that performs the aggregation in the background.
+                 */
+                void run() override;
 
+            private:
                 /**
-                 * Method that returns the mean value.
-                 *
-                 * \return Returns the mean value.
+                 * The aggregator that owns this worker.
                  */
-                inline double meanValue() const {
-                    return currentMeanValue;
-                }
+                Private* currentOwner;
+
+                /**
+                 * The name of the database connection used by this worker.
+                 */
+                QString currentDatabaseName;
+
+                /**
+                 * The monitor ranges to be aggregated.
+                 */
+                MonitorRangeList currentMonitorRanges;
+
+                /**
+                 * The time threshold for this aggregation.
+                 */
+                unsigned long long currentTimeThreshold;
+
+                /**
+                 * The resample period.
+                 */
+                unsigned long currentResamplePeriod;
+
+                /**
+                 * The input table name.
+                 */
+                QString currentInputTableName;
+
+                /**
+                 * The output table name.
+                 */
+                QString currentOutputTableName;
+
+                /**
+                 * Holds true if the input table has already been aggregated.
+                 */
+                bool currentInputAggregated;
+
+                /**
+                 * Holds true if the input table holds compressed blocks.
+                 */
+                bool currentInputBlocks;
 
                 /**
-                 * Method that returns the number of samples or population weight.
+                 * The random generator used by this worker.
+                 */
+                RandomGenerator randomGenerator;
+
+                /**
+                 * Holds true if every range was aggregated.
+                 */
+                bool currentSucceeded;
+        };
+
+        /**
+         * Class that accumulates the statistics for a single monitor, server, and period in one pass.  Sub-populations
+         * are folded in using the pairwise update of Chan, Golub, and LeVeque so raw entries and previously aggregated
+         * entries are handled identically.  A single entry reservoir, weighted by the number of samples in each
+         * sub-population, selects the representative sample.
+         */
+        class PeriodAccumulator {
+            public:
+                PeriodAccumulator();
+
+                ~PeriodAccumulator() = default;
+
+                /**
+                 * Method you can use to determine if any samples have been accumulated.
                  *
-                 * \return Returns the number of samples.
+                 * \return Returns true if no samples have been accumulated.
                  */
-                inline unsigned long numberSamples() const {
-                    return currentNumberSamples;
+                inline bool isEmpty() const {
+                    return currentNumberSamples == 0;
                 }
 
                 /**
-                 * Assignment operator
+                 * Method that adds a sub-population to the accumulator.
+                 *
+                 * \param[in] meanLatency     The mean latency of the sub-population.
+                 *
+                 * \param[in] varianceLatency The population variance of the sub-population.
+                 *
+                 * \param[in] minimumLatency  The minimum latency in the sub-population.
+                 *
+                 * \param[in] maximumLatency  The maximum latency in the sub-population.
+                 *
+                 * \param[in] numberSamples   The number of samples in the sub-population.
                  *
-                 * \param[in] other The instance to assign to this instance.
+                 * \param[in] zoranTimestamp  The timestamp of the sub-population's representative sample.
                  *
-                 * \return Returns a reference to this instance.
+                 * \param[in] latency         The latency of the sub-population's representative sample.
+                 *
+                 * \param[in] randomGenerator The random generator used to maintain the reservoir.
                  */
-                inline WeightsAndMeans& operator=(const WeightsAndMeans& other) {
-                    currentMeanValue     = other.currentMeanValue;
-                    currentNumberSamples = other.currentNumberSamples;
+                void add(
+                    double                                      meanLatency,
+                    double                                      varianceLatency,
+                    AggregatedLatencyEntry::LatencyMicroseconds minimumLatency,
+                    AggregatedLatencyEntry::LatencyMicroseconds maximumLatency,
+                    unsigned long                               numberSamples,
+                    AggregatedLatencyEntry::ZoranTimeStamp      zoranTimestamp,
+                    AggregatedLatencyEntry::LatencyMicroseconds latency,
+                    RandomGenerator&                            randomGenerator
+                );
 
-                    return *this;
-                }
+                /**
+                 * Method that resets the accumulator.
+                 */
+                void clear();
 
-            private:
                 /**
-                 * The current mean value for this population.
+                 * Method that creates an aggregated entry from the accumulated statistics.
+                 *
+                 * \param[in] monitorId            The monitor ID of the monitor that collected this population.
+                 *
+                 * \param[in] serverId             The server ID of the server that collected this population.
+                 *
+                 * \param[in] periodStartTimestamp The Unix timestamp of the start of the period.
+                 *
+                 * \param[in] periodEndTimestamp   The Unix timestamp of the end of the period.
+                 *
+                 * \return Returns a \ref AggregatedLatencyEntry instance generated from the accumulated statistics.
                  */
-                double currentMeanValue;
+                AggregatedLatencyEntry entry(
+                    AggregatedLatencyEntry::MonitorId monitorId,
+                    AggregatedLatencyEntry::ServerId  serverId,
+                    unsigned long long                periodStartTimestamp,
+                    unsigned long long                periodEndTimestamp
+                ) const;
 
+            private:
                 /**
-                 * The current number of samples or weights.
+                 * The number of accumulated samples.
                  */
                 unsigned long currentNumberSamples;
+
+                /**
+                 * The running mean latency.
+                 */
+                double currentMeanLatency;
+
+                /**
+                 * The running sum of squared differences from the mean.
+                 */
+                double currentSumSquaredDifferences;
+
+                /**
+                 * The minimum latency.
+                 */
+                AggregatedLatencyEntry::LatencyMicroseconds currentMinimumLatency;
+
+                /**
+                 * The maximum latency.
+                 */
+                AggregatedLatencyEntry::LatencyMicroseconds currentMaximumLatency;
+
+                /**
+                 * The timestamp of the reservoir sample.
+                 */
+                AggregatedLatencyEntry::ZoranTimeStamp currentSampleZoranTimestamp;
+
+                /**
+                 * The latency of the reservoir sample.
+                 */
+                AggregatedLatencyEntry::LatencyMicroseconds currentSampleLatency;
         };
 
         /**
-         * Method that obtains a list of aggregated entries.
+         * Method that determines the ranges of monitor IDs with entries that are ready to be aggregated along with the
+         * number of rows in each range.  Ranges are aligned to \ref monitorsPerRange monitor IDs and empty ranges
+         * are omitted.
          *
-         * \param[out]    success         A boolean value that will hold true on success.
+         * \param[in,out] database       The database instance to be used.
+         *
+         * \param[in]     timeThreshold  The time threshold for this aggregation.
+         *
+         * \param[in]     inputTableName The name of the input table to be processed.
+         *
+         * \param[out]    monitorRanges  The monitor ranges to be aggregated, in ascending order.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool getMonitorRanges(
+            QSqlDatabase&      database,
+            unsigned long long timeThreshold,
+            const QString&     inputTableName,
+            MonitorRangeList&  monitorRanges
+        );
+
+        /**
+         * Method that divides monitor ranges into contiguous shards holding roughly equal numbers of rows.
+         *
+         * \param[in] monitorRanges The monitor ranges to be divided.
+         *
+         * \param[in] numberShards  The desired number of shards.
+         *
+         * \return Returns the list of shards.  Fewer shards than requested are returned if there are too few ranges.
+         */
+        static QList<MonitorRangeList> partitionMonitorRanges(
+            const MonitorRangeList& monitorRanges,
+            unsigned                numberShards
+        );
+
+        /**
+         * Method that aggregates a list of monitor ranges, one transaction per range.
+         *
+         * \param[in,out] database        The database instance to be used.
+         *
+         * \param[in]     monitorRanges   The monitor ranges to be aggregated.
+         *
+         * \param[in]     timeThreshold   The time threshold for this aggregation.
+         *
+         * \param[in]     resamplePeriod  The period for resampling operations.
+         *
+         * \param[in]     inputTableName  The name of the input table to be processed.
+         *
+         * \param[in]     outputTableName The name of the table to write the aggregated entries to.
+         *
+         * \param[in]     inputAggregated If true, the input table has already been aggregated.
+         *
+         * \param[in]     inputBlocks     If true, the input table holds compressed blocks.
+         *
+         * \param[in]     randomGenerator The random generator used to select representative samples.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool aggregateMonitorRanges(
+            QSqlDatabase&           database,
+            const MonitorRangeList& monitorRanges,
+            unsigned long long      timeThreshold,
+            unsigned long           resamplePeriod,
+            const QString&          inputTableName,
+            const QString&          outputTableName,
+            bool                    inputAggregated,
+            bool                    inputBlocks,
+            RandomGenerator&        randomGenerator
+        );
+
+        /**
+         * Method that aggregates, writes, and prunes the entries for a range of monitors in a single transaction.
+         * The range is also recorded in the watermark table within the same transaction.  Input rows are streamed
+         * through a server-side cursor and aggregated entries are written in batches as they are completed so memory
+         * use is independent of the size of the input table.
          *
          * \param[in,out] database        The database instance to be used.
          *
@@ -228,20 +534,46 @@ class LatencyAggregator::Private:public QThread {
          *
          * \param[in]     inputTableName  The name of the input table to be processed.
          *
+         * \param[in]     outputTableName The name of the table to write the aggregated entries to.
+         *
          * \param[in]     inputAggregated If true, the input table has already been aggregated.  If false, the input
          *                                table holds raw data.
          *
-         * \return Returns a list of aggregated values.
+         * \param[in]     inputBlocks     If true, the input table holds raw data as compressed blocks.  Each block is
+         *                                decoded and its samples are aggregated as raw entries.
+         *
+         * \param[in]     firstMonitorId  The first monitor ID in the range.
+         *
+         * \param[in]     lastMonitorId   The last monitor ID in the range, inclusive.
+         *
+         * \param[in]     randomGenerator The random generator used to select representative samples.
+         *
+         * \return Returns true on success.  Returns false on error.
          */
-        QList<AggregatedLatencyEntry> generateAggregatedEntries(
-            bool&              success,
+        bool aggregateMonitorRange(
             QSqlDatabase&      database,
             unsigned long long timeThreshold,
             unsigned long      resamplePeriod,
             const QString&     inputTableName,
-            bool               inputAggregated
+            const QString&     outputTableName,
+            bool               inputAggregated,
+            bool               inputBlocks,
+            Monitor::MonitorId firstMonitorId,
+            Monitor::MonitorId lastMonitorId,
+            RandomGenerator&   randomGenerator
         );
 
+        /**
+         * Method that records the time spent in one phase of aggregating a monitor range.
+         *
+         * \param[in] outputTableName The name of the table the aggregated entries are written to.
+         *
+         * \param[in] phase           The name of the phase.
+         *
+         * \param[in] elapsedTime     The time spent in the phase, in nanoseconds.
+         */
+        static void recordPhaseTime(const QString& outputTableName, const QString& phase, qint64 elapsedTime);
+
         /**
          * Method that writes aggregated entries to the database.
          *
@@ -249,6 +581,8 @@ class LatencyAggregator::Private:public QThread {
          *
          * \param[in]     aggregatedEntries A list of aggregated entries to be written.
          *
+         * \param[in]     latencySketches   The quantile sketch for each aggregated entry.
+         *
          * \param[in]     outputTableName   The name of the table to write the aggregated entries to.
          *
          * \return Returns true on success.  Returns false on error.
@@ -256,9 +590,64 @@ class LatencyAggregator::Private:public QThread {
         bool writeAggregatedEntries(
             QSqlDatabase&                        database,
             const QList<AggregatedLatencyEntry>& aggregatedEntries,
+            const QList<LatencySketch>&          latencySketches,
             const QString&                       outputTableName
         );
 
+        /**
+         * Method that reads the watermark left by an interrupted aggregation pass.
+         *
+         * \param[in,out] database        The database instance to be used.
+         *
+         * \param[in]     outputTableName The name of the output table the pass was writing to.
+         *
+         * \param[out]    timeThreshold   The time threshold used by the interrupted pass.  The value is unchanged if
+         *                                no pass was interrupted.
+         *
+         * \param[out]    completedRanges The first monitor ID of every range committed by the interrupted pass.  An
+         *                                empty set indicates that no pass was interrupted.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool readWatermark(
+            QSqlDatabase&             database,
+            const QString&            outputTableName,
+            unsigned long long&       timeThreshold,
+            QSet<Monitor::MonitorId>& completedRanges
+        );
+
+        /**
+         * Method that records a committed monitor range in the watermark.  The method should be called inside the
+         * range's transaction so the watermark is committed with the range's aggregates.
+         *
+         * \param[in,out] database        The database instance to be used.
+         *
+         * \param[in]     outputTableName The name of the output table.
+         *
+         * \param[in]     timeThreshold   The time threshold for this aggregation.
+         *
+         * \param[in]     firstMonitorId  The first monitor ID in the committed range.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool writeWatermark(
+            QSqlDatabase&      database,
+            const QString&     outputTableName,
+            unsigned long long timeThreshold,
+            Monitor::MonitorId firstMonitorId
+        );
+
+        /**
+         * Method that clears the watermark once an aggregation pass has completed.
+         *
+         * \param[in,out] database        The database instance to be used.
+         *
+         * \param[in]     outputTableName The name of the output table.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool clearWatermark(QSqlDatabase& database, const QString& outputTableName);
+
         /**
          * Method that deletes old entries from the database.
          *
@@ -268,9 +657,68 @@ class LatencyAggregator::Private:public QThread {
          *
          * \param[in]     inputTableName  The name of the input table to be processed.
          *
+         * \param[in]     firstMonitorId  The first monitor ID to be pruned.
+         *
+         * \param[in]     lastMonitorId   The last monitor ID to be pruned, inclusive.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool deleteOldEntries(
+            QSqlDatabase&      database,
+            unsigned long long timeThreshold,
+            const QString&     inputTableName,
+            Monitor::MonitorId firstMonitorId = 0,
+            Monitor::MonitorId lastMonitorId = std::numeric_limits<Monitor::MonitorId>::max()
+        );
+
+        /**
+         * Method that expunges old entries from a table.  Partitions holding only entries older than the threshold
+         * are detached and dropped.  Remaining entries older than the threshold, found only in the partition
+         * straddling the threshold or in the default partition, are deleted by row.  Tables without range partitions
+         * are deleted by row.
+         *
+         * \param[in,out] database      The database instance to be used.
+         *
+         * \param[in]     timeThreshold The Unix timestamp of the oldest entry to be kept.
+         *
+         * \param[in]     tableName     The name of the table to be expunged.
+         *
+         * \param[in]     entryPeriod   The period covered by each entry, in seconds.  Partitions are keyed by the
+         *                              start of each entry's period so a partition is only dropped once its last
+         *                              period is older than the threshold.  Use zero for raw entries.
+         *
+         * \return Returns true on success.  Returns false on error.
+         */
+        bool expungeEntries(
+            QSqlDatabase&      database,
+            unsigned long long timeThreshold,
+            const QString&     tableName,
+            unsigned long      entryPeriod
+        );
+
+        /**
+         * Method that creates any missing partitions covering a span of time.  Partitions are aligned to the partition
+         * period.  Spans already covered by an existing partition, in whole or in part, are skipped.
+         *
+         * \param[in,out] database        The database instance to be used.
+         *
+         * \param[in]     tableName       The name of the partitioned table.
+         *
+         * \param[in]     partitionPeriod The partition period, in seconds.
+         *
+         * \param[in]     startTimestamp  The Unix timestamp of the start of the span to be covered.
+         *
+         * \param[in]     endTimestamp    The Unix timestamp of the end of the span to be covered.
+         *
          * \return Returns true on success.  Returns false on error.
          */
-        bool deleteOldEntries(QSqlDatabase& database, unsigned long long timeThreshold, const QString& inputTableName);
+        bool createPartitions(
+            QSqlDatabase&      database,
+            const QString&     tableName,
+            unsigned long      partitionPeriod,
+            unsigned long long startTimestamp,
+            unsigned long long endTimestamp
+        );
 
         /**
          * Method that calculates and checks field index values from a query.
@@ -406,55 +854,58 @@ class LatencyAggregator::Private:public QThread {
         );
 
         /**
-         * Method that processes the collected result data to return a new aggregation entry.
-         *
-         * \param[in]     monitorId              The monitor ID of the monitor that collected this population.
-         *
-         * \param[in]     serverId               The server ID of the server that collected this population.
+         * Method that gets the next compressed block.
          *
-         * \param[in] weightedSumMeanLatency     The sum of the mean values from each input times the number of samples
-         *                                       from each input, i.e.: \f$ \sum_{i} n _ i \mu _ i \f$.
+         * \param[in]  query          The query to obtain the field data from.
          *
-         * \param[in] weightedSumVarianceLatency The sum of the variances from each input times the number of samples
-         *                                       in each input, i.e.: \f$ \sum_{i} n _ i \sigma ^ 2 _ i \f$.
+         * \param[in]  monitorIdField The field index of the monitor ID field.
          *
-         * \param[in] rawValues                  A list of raw values.  This list is used to select a random entry from
-         *                                       the sample population.
+         * \param[in]  serverIdField  The field index of the server ID field.
          *
-         * \param[in] weightsAndMeans            A list of pairs of populations and mean values.  Used to calculate our
-         *                                       resulting variance.
+         * \param[in]  samplesField   The field index of the samples field.
          *
-         * \param[in] periodStartTimestamp       The earliest measured timestamp in the input population.
+         * \param[out] monitorId      Returns the monitor ID field value.
          *
-         * \param[in] periodEndTimestamp         The latest measured timestamp in the input population.
+         * \param[out] serverId       Returns the server ID field value.
          *
-         * \param[in] minimumLatency             The minimum latency measured across the input population.
+         * \param[out] samples        Returns the decoded samples, sorted by timestamp.
          *
-         * \param[in] maximumLatency             The maximum latency measured across the input population.
-         *
-         * \param[in] numberSamples              The number of raw samples that represent this population.
-         *
-         * \return Returns a \ref AggregatedLatencyEntry instance generated from the data above.
+         * \return Returns true on success.  Returns false on error or if the block holds no samples.
          */
-        AggregatedLatencyEntry generateEntry(
-            AggregatedLatencyEntry::MonitorId           monitorId,
-            AggregatedLatencyEntry::ServerId            serverId,
-            double                                      weightedSumMeanLatency,
-            double                                      weightedSumVarianceLatency,
-            const QList<ShortLatencyEntry>&             rawValues,
-            const QList<WeightsAndMeans>&               weightsAndMeans,
-            unsigned long long                          periodStartTimestamp,
-            unsigned long long                          periodEndTimestamp,
-            AggregatedLatencyEntry::LatencyMicroseconds minimumLatency,
-            AggregatedLatencyEntry::LatencyMicroseconds maximumLatency,
-            unsigned long                               numberSamples
+        static bool getBlockRecord(
+            const QSqlQuery&          query,
+            int                       monitorIdField,
+            int                       serverIdField,
+            int                       samplesField,
+            Monitor::MonitorId&       monitorId,
+            Server::ServerId&         serverId,
+            LatencyBlock::SampleList& samples
         );
 
         /**
-         * Method that calculates a random value  The algorithm uses the XORSHRO256++ algorithm with a random initial
-         * seeds.
+         * The name of the table used to track the progress of an aggregation pass.
          */
-        std::uint32_t prng();
+        static const QString watermarkTableName;
+
+        /**
+         * The number of monitor IDs aggregated per transaction.
+         */
+        static const unsigned long monitorsPerRange;
+
+        /**
+         * The number of input rows fetched from the server-side cursor at a time.
+         */
+        static const unsigned long cursorFetchSize;
+
+        /**
+         * The number of aggregated entries accumulated before they are written.
+         */
+        static const unsigned long writeBatchSize;
+
+        /**
+         * The number of partition periods created ahead of the current time.
+         */
+        static const unsigned long partitionsAhead;
 
         /**
          * Mutex used to control access to variables across threads.
@@ -497,19 +948,29 @@ class LatencyAggregator::Private:public QThread {
         bool currentInputAggregated;
 
         /**
-         * Seed used to generate random values.
+         * Holds true if the input table holds compressed blocks.
+         */
+        bool currentInputBlocks;
+
+        /**
+         * The number of worker threads used to aggregate monitor ranges.
+         */
+        unsigned currentNumberWorkers;
+
+        /**
+         * The Unix timestamp of the first period rolled up at ingest.  A value of zero indicates no rollups.
          */
-        std::uint64_t seed[4];
+        unsigned long long currentRollupCoverageStart;
 
         /**
-         * Value used to generate fewer random values.
+         * The partition period of each time-range partitioned table.
          */
-        std::uint32_t nextPrngValue;
+        PartitionPeriods currentPartitionPeriods;
 
         /**
-         * Flag indicating that the next value should be used.
+         * Random generator used when aggregation runs on this thread.
          */
-        bool useNextPrngValue;
+        RandomGenerator randomGenerator;
 };
 
 #endif
@@ -0,0 +1,779 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyArchive class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+#include <QByteArray>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QDateTime>
+#include <QVector>
+#include <QPair>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QVariant>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+
+#include "log.h"
+#include "database_manager.h"
+#include "latency_entry.h"
+#include "aggregated_latency_entry.h"
+#include "latency_populations.h"
+#include "latency_sketch.h"
+#include "sql_helpers.h"
+#include "latency_archive.h"
+
+const unsigned long LatencyArchive::segmentPeriod       = 7 * 24 * 3600;
+const unsigned long LatencyArchive::defaultArchiveAge   = 4 * 7 * 24 * 3600;
+const unsigned      LatencyArchive::defaultNumberShards = 1;
+const char          LatencyArchive::segmentMagic[8]     = { 'D', 'B', 'C', 'L', 'A', 'S', '0', '1' };
+const std::uint32_t LatencyArchive::formatVersion       = 1;
+const unsigned      LatencyArchive::columnWidths[LatencyArchive::numberColumns] = {
+    4, 2, 4, 4, 4, 4, 8, 8, 4, 4, 4, 8
+};
+
+LatencyArchive::LatencyArchive(
+        DatabaseManager* databaseManager,
+        QObject*         parent
+    ):QThread(
+        parent
+    ),currentDatabaseManager(
+        databaseManager
+    ) {
+    currentArchiveAge   = defaultArchiveAge;
+    currentExpungeAge   = 0;
+    currentNumberShards = defaultNumberShards;
+}
+
+
+LatencyArchive::~LatencyArchive() {
+    requestInterruption();
+    wait();
+}
+
+
+void LatencyArchive::setParameters(const QString& directory, unsigned long archiveAge, unsigned numberShards) {
+    QMutexLocker parametersLocker(&parametersMutex);
+
+    currentDirectory    = directory;
+    currentArchiveAge   = archiveAge;
+    currentNumberShards = std::max(1U, numberShards);
+}
+
+
+void LatencyArchive::setExpungeAge(unsigned long expungeAge) {
+    QMutexLocker parametersLocker(&parametersMutex);
+    currentExpungeAge = expungeAge;
+}
+
+
+bool LatencyArchive::covers(unsigned long long startTimestamp, unsigned long long endTimestamp) {
+    ZoranTimeStamp zoranStart = toZoranTimestamp(startTimestamp);
+    ZoranTimeStamp zoranEnd   = toZoranTimestamp(endTimestamp);
+
+    QMutexLocker segmentsLocker(&segmentsMutex);
+
+    bool                        result = false;
+    SegmentList::const_iterator it     = currentSegments.constBegin();
+    SegmentList::const_iterator end    = currentSegments.constEnd();
+    while (!result && it != end) {
+        const SegmentHeader* header = (*it)->header;
+        result = (header->minimumTimestamp <= zoranEnd && header->maximumTimestamp >= zoranStart);
+        ++it;
+    }
+
+    return result;
+}
+
+
+bool LatencyArchive::readEntries(
+        const Filter&               filter,
+        unsigned long long          startTimestamp,
+        unsigned long long          endTimestamp,
+        AggregatedLatencyEntryList* aggregatedEntries,
+        LatencyPopulations*         populations,
+        LatencySketch*              latencySketch
+    ) {
+    ZoranTimeStamp zoranStart = toZoranTimestamp(startTimestamp);
+    ZoranTimeStamp zoranEnd   = toZoranTimestamp(endTimestamp);
+
+    // Readers work from a copy of the list so segments can be added or expired while a scan is in progress.
+    segmentsMutex.lock();
+    SegmentList segments = currentSegments;
+    segmentsMutex.unlock();
+
+    bool          success    = true;
+    unsigned long firstEntry = aggregatedEntries != nullptr ? static_cast<unsigned long>(aggregatedEntries->size()) : 0;
+
+    for (  SegmentList::const_iterator segmentIterator  = segments.constBegin(),
+                                       segmentEnd       = segments.constEnd()
+         ; success && segmentIterator != segmentEnd
+         ; ++segmentIterator
+        ) {
+        const Segment&       segment = **segmentIterator;
+        const SegmentHeader* header  = segment.header;
+
+        if (header->minimumTimestamp <= zoranEnd && header->maximumTimestamp >= zoranStart) {
+            unsigned long firstRow = 0;
+            unsigned long lastRow  = header->numberRows;
+
+            if (!filter.allMonitors && filter.monitorIds.size() == 1) {
+                // Rows are sorted by monitor so a single monitor is a contiguous range.
+                MonitorId monitorId = *filter.monitorIds.constBegin();
+                std::pair<const std::uint32_t*, const std::uint32_t*> range = std::equal_range(
+                    segment.monitorIds,
+                    segment.monitorIds + header->numberRows,
+                    monitorId
+                );
+
+                firstRow = static_cast<unsigned long>(range.first - segment.monitorIds);
+                lastRow  = static_cast<unsigned long>(range.second - segment.monitorIds);
+            }
+
+            for (unsigned long row=firstRow ; success && row<lastRow ; ++row) {
+                ZoranTimeStamp timestamp = segment.timestamps[row];
+                if (timestamp >= zoranStart                                                      &&
+                    timestamp <= zoranEnd                                                        &&
+                    (filter.allMonitors || filter.monitorIds.contains(segment.monitorIds[row]))  &&
+                    (filter.allServers || filter.serverIds.contains(segment.serverIds[row]))        ) {
+                    if (aggregatedEntries != nullptr) {
+                        aggregatedEntries->append(
+                            AggregatedLatencyEntry(
+                                segment.monitorIds[row],
+                                segment.serverIds[row],
+                                timestamp,
+                                segment.latencies[row],
+                                segment.startTimestamps[row],
+                                segment.endTimestamps[row],
+                                segment.meanLatencies[row],
+                                segment.varianceLatencies[row],
+                                segment.minimumLatencies[row],
+                                segment.maximumLatencies[row],
+                                segment.numberSamples[row]
+                            )
+                        );
+                    }
+
+                    if (populations != nullptr) {
+                        populations->append(
+                            segment.meanLatencies[row],
+                            segment.varianceLatencies[row],
+                            segment.minimumLatencies[row],
+                            segment.maximumLatencies[row],
+                            segment.numberSamples[row]
+                        );
+                    }
+
+                    if (latencySketch != nullptr) {
+                        std::uint64_t sketchStart = segment.sketchOffsets[row];
+                        std::uint64_t sketchSize  = segment.sketchOffsets[row + 1] - sketchStart;
+                        if (sketchSize > 0) {
+                            // The sketch is decoded directly from the mapped file.
+                            latencySketch->merge(
+                                LatencySketch::fromByteArray(
+                                    QByteArray::fromRawData(
+                                        segment.sketches + sketchStart,
+                                        static_cast<int>(sketchSize)
+                                    ),
+                                    &success
+                                )
+                            );
+
+                            if (!success) {
+                                logWrite(
+                                    QString("Invalid latency sketch in archive segment %1 - LatencyArchive")
+                                    .arg(segment.fileName),
+                                    true
+                                );
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (aggregatedEntries != nullptr) {
+        std::sort(
+            aggregatedEntries->begin() + static_cast<int>(firstEntry),
+            aggregatedEntries->end(),
+            [](const AggregatedLatencyEntry& a, const AggregatedLatencyEntry& b) {
+                return (
+                       a.startZoranTimestamp() < b.startZoranTimestamp()
+                    || (   a.startZoranTimestamp() == b.startZoranTimestamp()
+                        && (   a.monitorId() < b.monitorId()
+                            || (a.monitorId() == b.monitorId() && a.serverId() < b.serverId())
+                           )
+                       )
+                );
+            }
+        );
+    }
+
+    return success;
+}
+
+
+void LatencyArchive::startArchive() {
+    parametersMutex.lock();
+    bool enabled = !currentDirectory.isEmpty() && currentArchiveAge > 0;
+    parametersMutex.unlock();
+
+    if (enabled && !isRunning()) {
+        start(QThread::LowPriority);
+    }
+}
+
+
+void LatencyArchive::run() {
+    parametersMutex.lock();
+    QString       directory    = currentDirectory;
+    unsigned long archiveAge   = currentArchiveAge;
+    unsigned long expungeAge   = currentExpungeAge;
+    unsigned      numberShards = currentNumberShards;
+    parametersMutex.unlock();
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString("LatencyArchive"));
+    bool success = database.isOpen();
+    if (success) {
+        if (!database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
+            logWrite(QString("Latency archive requires database transactions - LatencyArchive."), true);
+            success = false;
+        } else if (!QDir().mkpath(directory)) {
+            logWrite(QString("Could not create latency archive directory %1 - LatencyArchive.").arg(directory), true);
+            success = false;
+        }
+
+        if (success && directory != currentLoadedDirectory) {
+            success = loadSegments(database, directory);
+        }
+
+        unsigned long long currentTime = static_cast<unsigned long long>(QDateTime::currentSecsSinceEpoch());
+        if (success && currentTime > archiveAge) {
+            // Only weeks entirely older than the archive age are archived.
+            ZoranTimeStamp threshold = toZoranTimestamp(currentTime - archiveAge);
+            threshold -= threshold % segmentPeriod;
+
+            success = archiveWeeks(database, directory, threshold, numberShards);
+        }
+
+        if (success && expungeAge > 0 && currentTime > expungeAge) {
+            expireSegments(database, directory, toZoranTimestamp(currentTime - expungeAge));
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyArchive: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+}
+
+
+std::uint64_t LatencyArchive::columnOffsets(unsigned long numberRows, std::uint64_t* columnOffsets) {
+    std::uint64_t offset = (sizeof(SegmentHeader) + 7) & ~static_cast<std::uint64_t>(7);
+    for (unsigned column=0 ; column<numberColumns ; ++column) {
+        columnOffsets[column] = offset;
+
+        unsigned long numberValues = column == numberColumns - 1 ? numberRows + 1 : numberRows;
+        std::uint64_t columnBytes  = static_cast<std::uint64_t>(numberValues) * columnWidths[column];
+        offset += (columnBytes + 7) & ~static_cast<std::uint64_t>(7);
+    }
+
+    return offset;
+}
+
+
+LatencyArchive::SegmentPointer LatencyArchive::openSegment(const QString& directory, const QString& fileName) {
+    QFile*         file   = new QFile(QDir(directory).absoluteFilePath(fileName));
+    SegmentPointer result;
+
+    bool   success  = file->open(QFile::ReadOnly);
+    qint64 fileSize = file->size();
+    if (success && static_cast<quint64>(fileSize) < sizeof(SegmentHeader)) {
+        success = false;
+    }
+
+    uchar* mapping = nullptr;
+    if (success) {
+        mapping = file->map(0, fileSize);
+        success = (mapping != nullptr);
+    }
+
+    if (success) {
+        const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(mapping);
+        std::uint64_t        offsets[numberColumns];
+        std::uint64_t        sketchOffset = 0;
+
+        success = (
+               std::memcmp(header->magic, segmentMagic, sizeof(segmentMagic)) == 0
+            && header->version == formatVersion
+        );
+
+        if (success) {
+            sketchOffset = columnOffsets(header->numberRows, offsets);
+            success      = (sketchOffset + header->sketchBytes == static_cast<quint64>(fileSize));
+        }
+
+        if (success) {
+            const std::uint64_t* sketchOffsets = reinterpret_cast<const std::uint64_t*>(
+                mapping + offsets[numberColumns - 1]
+            );
+
+            success = (sketchOffsets[0] == 0 && sketchOffsets[header->numberRows] == header->sketchBytes);
+            for (unsigned long row=0 ; success && row<header->numberRows ; ++row) {
+                success = (sketchOffsets[row] <= sketchOffsets[row + 1]);
+            }
+        }
+
+        if (success) {
+            Segment* segment = new Segment;
+
+            segment->fileName          = fileName;
+            segment->file              = file;
+            segment->mapping           = mapping;
+            segment->header            = header;
+            segment->monitorIds        = reinterpret_cast<const std::uint32_t*>(mapping + offsets[0]);
+            segment->serverIds         = reinterpret_cast<const std::uint16_t*>(mapping + offsets[1]);
+            segment->timestamps        = reinterpret_cast<const std::uint32_t*>(mapping + offsets[2]);
+            segment->latencies         = reinterpret_cast<const std::uint32_t*>(mapping + offsets[3]);
+            segment->startTimestamps   = reinterpret_cast<const std::uint32_t*>(mapping + offsets[4]);
+            segment->endTimestamps     = reinterpret_cast<const std::uint32_t*>(mapping + offsets[5]);
+            segment->meanLatencies     = reinterpret_cast<const double*>(mapping + offsets[6]);
+            segment->varianceLatencies = reinterpret_cast<const double*>(mapping + offsets[7]);
+            segment->minimumLatencies  = reinterpret_cast<const std::uint32_t*>(mapping + offsets[8]);
+            segment->maximumLatencies  = reinterpret_cast<const std::uint32_t*>(mapping + offsets[9]);
+            segment->numberSamples     = reinterpret_cast<const std::uint32_t*>(mapping + offsets[10]);
+            segment->sketchOffsets     = reinterpret_cast<const std::uint64_t*>(mapping + offsets[11]);
+            segment->sketches          = reinterpret_cast<const char*>(mapping + sketchOffset);
+
+            result = SegmentPointer(segment, &LatencyArchive::closeSegment);
+        } else {
+            file->unmap(mapping);
+        }
+    }
+
+    if (!success) {
+        logWrite(
+            QString("Could not open latency archive segment %1: %2").arg(file->fileName(), file->errorString()),
+            true
+        );
+        delete file;
+    }
+
+    return result;
+}
+
+
+void LatencyArchive::closeSegment(Segment* segment) {
+    segment->file->unmap(segment->mapping);
+    segment->file->close();
+
+    delete segment->file;
+    delete segment;
+}
+
+
+bool LatencyArchive::loadSegments(QSqlDatabase& database, const QString& directory) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool success = SqlHelpers::execute(query, "SELECT file_name FROM latency_archive_segments");
+    if (success) {
+        SegmentList   segments;
+        QSet<QString> listedFiles;
+
+        while (query.next()) {
+            QString fileName = query.value(0).toString();
+            listedFiles.insert(fileName);
+
+            SegmentPointer segment = openSegment(directory, fileName);
+            if (!segment.isNull()) {
+                segments.append(segment);
+            }
+        }
+
+        // Files not in the manifest were left by an export that never committed.
+        QDir        archiveDirectory(directory);
+        QStringList fileNames = archiveDirectory.entryList(QStringList() << QString("latency_*.segment"), QDir::Files);
+        for (QStringList::const_iterator it=fileNames.constBegin(),end=fileNames.constEnd() ; it!=end ; ++it) {
+            if (!listedFiles.contains(*it)) {
+                logWrite(QString("Removing unlisted latency archive segment %1 - LatencyArchive").arg(*it), false);
+                archiveDirectory.remove(*it);
+            }
+        }
+
+        segmentsMutex.lock();
+        currentSegments = segments;
+        segmentsMutex.unlock();
+
+        currentLoadedDirectory = directory;
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyArchive::loadSegments: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool LatencyArchive::archiveWeeks(
+        QSqlDatabase&  database,
+        const QString& directory,
+        ZoranTimeStamp threshold,
+        unsigned       numberShards
+    ) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool success = SqlHelpers::execute(
+        query,
+        QString("SELECT MIN(start_timestamp) FROM latency_aggregated WHERE start_timestamp < %1").arg(threshold)
+    );
+
+    if (success) {
+        if (query.first() && !query.value(0).isNull()) {
+            unsigned long long weekStart = query.value(0).toUInt(&success);
+            weekStart -= weekStart % segmentPeriod;
+
+            while (success && weekStart < threshold && !isInterruptionRequested()) {
+                for (unsigned shard=0 ; success && shard<numberShards ; ++shard) {
+                    success = archiveSegment(
+                        database,
+                        directory,
+                        static_cast<ZoranTimeStamp>(weekStart),
+                        shard,
+                        numberShards
+                    );
+                }
+
+                weekStart += segmentPeriod;
+            }
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyArchive::archiveWeeks: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool LatencyArchive::archiveSegment(
+        QSqlDatabase&  database,
+        const QString& directory,
+        ZoranTimeStamp weekStart,
+        unsigned       shard,
+        unsigned       numberShards
+    ) {
+    typedef QPair<AggregatedLatencyEntry, QByteArray> Row;
+
+    ZoranTimeStamp weekEnd = static_cast<ZoranTimeStamp>(
+        std::min(
+            static_cast<unsigned long long>(weekStart) + segmentPeriod,
+            static_cast<unsigned long long>(std::numeric_limits<ZoranTimeStamp>::max())
+        )
+    );
+
+    database.transaction();
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    // Rows are deleted and returned in one statement.  Nothing is removed unless the segment file and manifest entry
+    // are committed with the delete.
+    QString queryString = QString("DELETE FROM latency_aggregated WHERE start_timestamp >= %1 AND start_timestamp < %2")
+                          .arg(weekStart)
+                          .arg(weekEnd);
+    if (numberShards > 1) {
+        queryString += QString(" AND monitor_id % %1 = %2").arg(numberShards).arg(shard);
+    }
+
+    queryString += QString(
+        " RETURNING monitor_id, server_id, timestamp, latency, start_timestamp, end_timestamp, mean_latency, "
+        "variance_latency, minimum_latency, maximum_latency, number_samples, latency_sketch"
+    );
+
+    QVector<Row> rows;
+    bool success = SqlHelpers::execute(query, queryString);
+    if (success) {
+        while (success && query.next()) {
+            bool ok[11];
+            AggregatedLatencyEntry entry(
+                query.value(0).toUInt(&ok[0]),
+                query.value(1).toUInt(&ok[1]),
+                query.value(2).toUInt(&ok[2]),
+                query.value(3).toUInt(&ok[3]),
+                query.value(4).toUInt(&ok[4]),
+                query.value(5).toUInt(&ok[5]),
+                query.value(6).toDouble(&ok[6]),
+                query.value(7).toDouble(&ok[7]),
+                query.value(8).toUInt(&ok[8]),
+                query.value(9).toUInt(&ok[9]),
+                query.value(10).toUInt(&ok[10])
+            );
+
+            success = std::all_of(ok, ok + 11, [](bool value) { return value; });
+            if (success) {
+                rows.append(Row(entry, query.value(11).isNull() ? QByteArray() : query.value(11).toByteArray()));
+            } else {
+                logWrite(QString("Invalid aggregated entry - LatencyArchive::archiveSegment"), true);
+            }
+        }
+    } else {
+        logWrite(
+            QString("Failed DELETE - LatencyArchive::archiveSegment: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    QString fileName;
+    if (success && !rows.isEmpty()) {
+        std::sort(
+            rows.begin(),
+            rows.end(),
+            [](const Row& a, const Row& b) {
+                return (
+                       a.first.monitorId() < b.first.monitorId()
+                    || (   a.first.monitorId() == b.first.monitorId()
+                        && (   a.first.serverId() < b.first.serverId()
+                            || (   a.first.serverId() == b.first.serverId()
+                                && a.first.startZoranTimestamp() < b.first.startZoranTimestamp()
+                               )
+                           )
+                       )
+                );
+            }
+        );
+
+        unsigned long numberRows  = static_cast<unsigned long>(rows.size());
+        std::uint64_t sketchBytes = 0;
+        for (QVector<Row>::const_iterator it=rows.constBegin(),end=rows.constEnd() ; it!=end ; ++it) {
+            sketchBytes += static_cast<std::uint64_t>(it->second.size());
+        }
+
+        std::uint64_t offsets[numberColumns];
+        std::uint64_t sketchOffset = columnOffsets(numberRows, offsets);
+        QByteArray    data(static_cast<int>(sketchOffset + sketchBytes), '\0');
+        char*         base = data.data();
+
+        SegmentHeader header;
+        std::memset(&header, 0, sizeof(SegmentHeader));
+        std::memcpy(header.magic, segmentMagic, sizeof(segmentMagic));
+        header.version          = formatVersion;
+        header.numberRows       = static_cast<std::uint32_t>(numberRows);
+        header.startTimestamp   = weekStart;
+        header.endTimestamp     = weekEnd;
+        header.minimumTimestamp = std::numeric_limits<std::uint32_t>::max();
+        header.maximumTimestamp = 0;
+        header.sketchBytes      = sketchBytes;
+
+        std::uint64_t sketchPosition = 0;
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            const AggregatedLatencyEntry& entry  = rows.at(row).first;
+            const QByteArray&             sketch = rows.at(row).second;
+
+            std::uint32_t monitorId       = entry.monitorId();
+            std::uint16_t serverId        = entry.serverId();
+            std::uint32_t timestamp       = entry.zoranTimestamp();
+            std::uint32_t latency         = entry.latencyMicroseconds();
+            std::uint32_t startTimestamp  = entry.startZoranTimestamp();
+            std::uint32_t endTimestamp    = entry.endZoranTimestamp();
+            double        meanLatency     = entry.meanLatency();
+            double        varianceLatency = entry.varianceLatency();
+            std::uint32_t minimumLatency  = entry.minimumLatency();
+            std::uint32_t maximumLatency  = entry.maximumLatency();
+            std::uint32_t numberSamples   = static_cast<std::uint32_t>(entry.numberSamples());
+
+            std::memcpy(base + offsets[0] + 4 * row, &monitorId, 4);
+            std::memcpy(base + offsets[1] + 2 * row, &serverId, 2);
+            std::memcpy(base + offsets[2] + 4 * row, &timestamp, 4);
+            std::memcpy(base + offsets[3] + 4 * row, &latency, 4);
+            std::memcpy(base + offsets[4] + 4 * row, &startTimestamp, 4);
+            std::memcpy(base + offsets[5] + 4 * row, &endTimestamp, 4);
+            std::memcpy(base + offsets[6] + 8 * row, &meanLatency, 8);
+            std::memcpy(base + offsets[7] + 8 * row, &varianceLatency, 8);
+            std::memcpy(base + offsets[8] + 4 * row, &minimumLatency, 4);
+            std::memcpy(base + offsets[9] + 4 * row, &maximumLatency, 4);
+            std::memcpy(base + offsets[10] + 4 * row, &numberSamples, 4);
+            std::memcpy(base + offsets[11] + 8 * row, &sketchPosition, 8);
+
+            if (!sketch.isEmpty()) {
+                std::memcpy(base + sketchOffset + sketchPosition, sketch.constData(), sketch.size());
+                sketchPosition += static_cast<std::uint64_t>(sketch.size());
+            }
+
+            header.minimumTimestamp = std::min(header.minimumTimestamp, timestamp);
+            header.maximumTimestamp = std::max(header.maximumTimestamp, timestamp);
+        }
+
+        std::memcpy(base + offsets[11] + 8 * numberRows, &sketchPosition, 8);
+        std::memcpy(base, &header, sizeof(SegmentHeader));
+
+        fileName = QString("latency_%1_%2_%3.segment").arg(weekStart)
+                                                      .arg(shard)
+                                                      .arg(QDateTime::currentMSecsSinceEpoch());
+
+        QSaveFile segmentFile(QDir(directory).absoluteFilePath(fileName));
+        success = (
+               segmentFile.open(QSaveFile::WriteOnly)
+            && segmentFile.write(data) == data.size()
+            && segmentFile.commit()
+        );
+
+        if (success) {
+            success = SqlHelpers::execute(
+                query,
+                QString(
+                    "INSERT INTO latency_archive_segments "
+                    "(file_name, start_timestamp, end_timestamp, shard, number_rows) "
+                    "VALUES ('%1', %2, %3, %4, %5)"
+                ).arg(fileName)
+                 .arg(weekStart)
+                 .arg(weekEnd)
+                 .arg(shard)
+                 .arg(numberRows)
+            );
+
+            if (!success) {
+                logWrite(
+                    QString("Failed INSERT - LatencyArchive::archiveSegment: %1").arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Could not write latency archive segment %1: %2").arg(fileName, segmentFile.errorString()),
+                true
+            );
+        }
+    }
+
+    if (success) {
+        success = database.commit();
+        if (!success) {
+            logWrite(
+                QString("Failed commit - LatencyArchive::archiveSegment: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+    } else {
+        bool rollbackSuccess = database.rollback();
+        if (!rollbackSuccess) {
+            logWrite(
+                QString("Failed rollback - LatencyArchive::archiveSegment: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+    }
+
+    if (!fileName.isEmpty()) {
+        if (success) {
+            SegmentPointer segment = openSegment(directory, fileName);
+            if (!segment.isNull()) {
+                segmentsMutex.lock();
+                currentSegments.append(segment);
+                segmentsMutex.unlock();
+            }
+        } else {
+            QDir(directory).remove(fileName);
+        }
+    }
+
+    return success;
+}
+
+
+bool LatencyArchive::expireSegments(QSqlDatabase& database, const QString& directory, ZoranTimeStamp threshold) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool success = SqlHelpers::execute(
+        query,
+        QString("DELETE FROM latency_archive_segments WHERE end_timestamp <= %1 RETURNING file_name").arg(threshold)
+    );
+
+    if (success) {
+        QSet<QString> fileNames;
+        while (query.next()) {
+            fileNames.insert(query.value(0).toString());
+        }
+
+        if (!fileNames.isEmpty()) {
+            segmentsMutex.lock();
+
+            SegmentList::iterator it = currentSegments.begin();
+            while (it != currentSegments.end()) {
+                if (fileNames.contains((*it)->fileName)) {
+                    it = currentSegments.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            segmentsMutex.unlock();
+
+            // Readers holding an expired segment keep their mapping until they release it.
+            QDir archiveDirectory(directory);
+            for (QSet<QString>::const_iterator it=fileNames.constBegin(),end=fileNames.constEnd() ; it!=end ; ++it) {
+                archiveDirectory.remove(*it);
+            }
+        }
+    } else {
+        logWrite(
+            QString("Failed DELETE - LatencyArchive::expireSegments: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+LatencyArchive::ZoranTimeStamp LatencyArchive::toZoranTimestamp(unsigned long long unixTimestamp) {
+    unsigned long long result =   unixTimestamp < LatencyEntry::startOfZoranEpoch
+                                ? 0
+                                : unixTimestamp - LatencyEntry::startOfZoranEpoch;
+
+    if (result > std::numeric_limits<ZoranTimeStamp>::max()) {
+        result = std::numeric_limits<ZoranTimeStamp>::max();
+    }
+
+    return static_cast<ZoranTimeStamp>(result);
+}
@@ -0,0 +1,204 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyBlock class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QVector>
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "latency_entry.h"
+#include "latency_block.h"
+
+const unsigned long LatencyBlock::blockPeriod = 3600;
+
+unsigned long LatencyBlock::blockAlignedPeriod(unsigned long period) {
+    unsigned long result = period;
+    if (result == 0) {
+        result = blockPeriod;
+    } else {
+        while (result % blockPeriod != 0) {
+            result += period;
+        }
+    }
+
+    return result;
+}
+
+
+QByteArray LatencyBlock::encode(SampleList samples) {
+    QByteArray    result;
+    unsigned long numberSamples = static_cast<unsigned long>(samples.size());
+
+    if (numberSamples > 0) {
+        std::stable_sort(
+            samples.begin(),
+            samples.end(),
+            [](const Sample& a, const Sample& b) {
+                return a.timestamp < b.timestamp;
+            }
+        );
+
+        result.reserve(static_cast<int>(12 + 4 * numberSamples));
+
+        const Sample* sample = samples.constData();
+        appendVarint(numberSamples, result);
+        appendVarint(sample[0].timestamp, result);
+        appendVarint(sample[0].latency, result);
+
+        std::int64_t lastDelta = 0;
+        for (unsigned long index=1 ; index<numberSamples ; ++index) {
+            std::int64_t delta         = static_cast<std::int64_t>(sample[index].timestamp) - sample[index - 1].timestamp;
+            std::int64_t deltaOfDelta  = delta - lastDelta;
+            std::uint64_t zigZagDelta  = (
+                  (static_cast<std::uint64_t>(deltaOfDelta) << 1)
+                ^ static_cast<std::uint64_t>(deltaOfDelta >> 63)
+            );
+
+            appendVarint(zigZagDelta, result);
+            appendVarint(sample[index].latency ^ sample[index - 1].latency, result);
+
+            lastDelta = delta;
+        }
+    }
+
+    return result;
+}
+
+
+bool LatencyBlock::decode(const QByteArray& block, SampleList& samples) {
+    const std::uint8_t* current = reinterpret_cast<const std::uint8_t*>(block.constData());
+    const std::uint8_t* end     = current + block.size();
+
+    samples.clear();
+
+    bool success = (current != end);
+    bool sorted  = true;
+    while (success && current != end) {
+        // Every sample occupies at least two bytes so larger counts can only come from a malformed block.  Checking
+        // here keeps a corrupt count from triggering a huge allocation.
+        std::uint64_t numberSamples;
+        success = (
+               readVarint(current, end, numberSamples)
+            && numberSamples > 0
+            && numberSamples <= static_cast<std::uint64_t>(end - current) / 2
+        );
+
+        std::uint64_t timestamp = 0;
+        std::uint64_t latency   = 0;
+        if (success) {
+            success = (
+                   readVarint(current, end, timestamp)
+                && readVarint(current, end, latency)
+                && timestamp <= std::numeric_limits<ZoranTimeStamp>::max()
+                && latency <= std::numeric_limits<LatencyMicroseconds>::max()
+            );
+        }
+
+        if (success) {
+            samples.reserve(samples.size() + static_cast<int>(numberSamples));
+
+            if (!samples.isEmpty() && timestamp < samples.last().timestamp) {
+                sorted = false;
+            }
+
+            Sample sample;
+            sample.timestamp = static_cast<ZoranTimeStamp>(timestamp);
+            sample.latency   = static_cast<LatencyMicroseconds>(latency);
+            samples.append(sample);
+
+            std::int64_t  delta = 0;
+            std::uint64_t index = 1;
+            while (success && index < numberSamples) {
+                std::uint64_t zigZagDelta;
+                std::uint64_t latencyBits;
+                success = (
+                       readVarint(current, end, zigZagDelta)
+                    && readVarint(current, end, latencyBits)
+                    && zigZagDelta <= (1ULL << 34)
+                );
+
+                if (success) {
+                    delta += static_cast<std::int64_t>(zigZagDelta >> 1) ^ -static_cast<std::int64_t>(zigZagDelta & 1);
+
+                    std::int64_t nextTimestamp = static_cast<std::int64_t>(timestamp) + delta;
+                    latency ^= latencyBits;
+
+                    success = (
+                           nextTimestamp >= 0
+                        && nextTimestamp <= std::numeric_limits<ZoranTimeStamp>::max()
+                        && latency <= std::numeric_limits<LatencyMicroseconds>::max()
+                    );
+
+                    if (success) {
+                        timestamp = static_cast<std::uint64_t>(nextTimestamp);
+
+                        sample.timestamp = static_cast<ZoranTimeStamp>(timestamp);
+                        sample.latency   = static_cast<LatencyMicroseconds>(latency);
+                        samples.append(sample);
+
+                        ++index;
+                    }
+                }
+            }
+        }
+    }
+
+    if (success) {
+        // Later segments come from later flushes so a stable sort keeps the first write of a duplicated timestamp.
+        if (!sorted) {
+            std::stable_sort(
+                samples.begin(),
+                samples.end(),
+                [](const Sample& a, const Sample& b) {
+                    return a.timestamp < b.timestamp;
+                }
+            );
+        }
+
+        SampleList::iterator newEnd = std::unique(
+            samples.begin(),
+            samples.end(),
+            [](const Sample& a, const Sample& b) {
+                return a.timestamp == b.timestamp;
+            }
+        );
+        samples.erase(newEnd, samples.end());
+    } else {
+        samples.clear();
+    }
+
+    return success;
+}
+
+
+void LatencyBlock::appendVarint(std::uint64_t value, QByteArray& buffer) {
+    char     bytes[10];
+    unsigned length = 0;
+
+    while (value >= 0x80) {
+        bytes[length++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    bytes[length++] = static_cast<char>(value);
+    buffer.append(bytes, static_cast<int>(length));
+}
@@ -0,0 +1,98 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyDeduplicator class.
+***********************************************************************************************************************/
+
+#include <QSet>
+#include <QPair>
+
+#include <cstdint>
+
+#include "latency_entry.h"
+#include "latency_entry_chunk_list.h"
+#include "latency_deduplicator.h"
+
+const unsigned long LatencyDeduplicator::defaultCapacity = 1000000;
+
+LatencyDeduplicator::LatencyDeduplicator(unsigned long capacity) {
+    currentCapacity = capacity;
+}
+
+
+LatencyDeduplicator::~LatencyDeduplicator() {}
+
+
+void LatencyDeduplicator::setCapacity(unsigned long newCapacity) {
+    currentCapacity = newCapacity;
+    clear();
+}
+
+
+bool LatencyDeduplicator::insert(MonitorId monitorId, ServerId serverId, ZoranTimeStamp zoranTimestamp) {
+    bool result;
+
+    if (currentCapacity > 0) {
+        Key key((static_cast<std::uint64_t>(monitorId) << 16) | serverId, zoranTimestamp);
+        if (currentGeneration.contains(key) || previousGeneration.contains(key)) {
+            result = false;
+        } else {
+            if (static_cast<unsigned long>(currentGeneration.size()) >= (currentCapacity + 1) / 2) {
+                previousGeneration.swap(currentGeneration);
+                currentGeneration.clear();
+            }
+
+            currentGeneration.insert(key);
+            result = true;
+        }
+    } else {
+        result = true;
+    }
+
+    return result;
+}
+
+
+unsigned long LatencyDeduplicator::filter(LatencyEntryChunkList& entries, unsigned long firstIndex) {
+    unsigned long numberEntries = entries.size();
+    unsigned long numberKept    = firstIndex;
+
+    if (currentCapacity > 0) {
+        for (unsigned long index=firstIndex ; index<numberEntries ; ++index) {
+            LatencyEntry entry = entries.at(index);
+            if (insert(entry.monitorId(), entry.serverId(), entry.zoranTimestamp())) {
+                if (numberKept != index) {
+                    entries.replace(numberKept, entry);
+                }
+
+                ++numberKept;
+            }
+        }
+
+        entries.truncate(numberKept);
+    } else {
+        numberKept = numberEntries;
+    }
+
+    return numberEntries - numberKept;
+}
+
+
+void LatencyDeduplicator::clear() {
+    currentGeneration.clear();
+    previousGeneration.clear();
+}
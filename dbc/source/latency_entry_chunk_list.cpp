@@ -0,0 +1,209 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyEntryChunkList class.
+***********************************************************************************************************************/
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <utility>
+#include <vector>
+
+#include "latency_entry.h"
+#include "latency_entry_chunk_list.h"
+
+/***********************************************************************************************************************
+* LatencyEntryChunkList::Pool
+*/
+
+LatencyEntryChunkList::Pool::Pool(unsigned long maximumFreeChunks) {
+    currentMaximumFreeChunks = maximumFreeChunks;
+}
+
+
+LatencyEntryChunkList::Pool::~Pool() {
+    for (QList<Chunk*>::const_iterator it=freeChunks.constBegin(),end=freeChunks.constEnd() ; it!=end ; ++it) {
+        delete *it;
+    }
+}
+
+
+LatencyEntryChunkList::Chunk* LatencyEntryChunkList::Pool::acquire() {
+    Chunk* result;
+
+    freeListMutex.lock();
+    if (!freeChunks.isEmpty()) {
+        result = freeChunks.takeLast();
+        freeListMutex.unlock();
+    } else {
+        freeListMutex.unlock();
+        result = new Chunk;
+    }
+
+    return result;
+}
+
+
+void LatencyEntryChunkList::Pool::release(Chunk* chunk) {
+    chunk->clear();
+
+    freeListMutex.lock();
+    if (static_cast<unsigned long>(freeChunks.size()) < currentMaximumFreeChunks) {
+        freeChunks.append(chunk);
+        freeListMutex.unlock();
+    } else {
+        freeListMutex.unlock();
+        delete chunk;
+    }
+}
+
+
+unsigned long LatencyEntryChunkList::Pool::numberFreeChunks() const {
+    QMutexLocker freeListMutexLocker(&freeListMutex);
+    return static_cast<unsigned long>(freeChunks.size());
+}
+
+/***********************************************************************************************************************
+* LatencyEntryChunkList
+*/
+
+LatencyEntryChunkList::LatencyEntryChunkList(Pool* pool) {
+    currentPool = pool;
+    currentSize = 0;
+}
+
+
+LatencyEntryChunkList::~LatencyEntryChunkList() {
+    clear();
+}
+
+
+void LatencyEntryChunkList::swap(LatencyEntryChunkList& other) {
+    chunks.swap(other.chunks);
+    std::swap(currentSize, other.currentSize);
+    std::swap(currentPool, other.currentPool);
+}
+
+
+void LatencyEntryChunkList::truncate(unsigned long newSize) {
+    if (newSize < currentSize) {
+        unsigned long numberChunks = (newSize + chunkCapacity - 1) / chunkCapacity;
+        while (static_cast<unsigned long>(chunks.size()) > numberChunks) {
+            currentPool->release(chunks.takeLast());
+        }
+
+        if (numberChunks > 0) {
+            chunks.last()->truncate(static_cast<unsigned>(newSize - (numberChunks - 1) * chunkCapacity));
+        }
+
+        currentSize = newSize;
+    }
+}
+
+
+void LatencyEntryChunkList::clear() {
+    for (QList<Chunk*>::const_iterator it=chunks.constBegin(),end=chunks.constEnd() ; it!=end ; ++it) {
+        currentPool->release(*it);
+    }
+
+    chunks.clear();
+    currentSize = 0;
+}
+
+
+void LatencyEntryChunkList::sortByKey() {
+    static constexpr unsigned numberDigits = 10;
+
+    if (currentSize > 1) {
+        std::vector<SortRecord> records(currentSize);
+        std::vector<SortRecord> scratch(currentSize);
+
+        unsigned long recordIndex = 0;
+        for (QList<Chunk*>::const_iterator it=chunks.constBegin(),end=chunks.constEnd() ; it!=end ; ++it) {
+            const Chunk* chunk     = *it;
+            unsigned     chunkSize = chunk->size();
+            for (unsigned chunkIndex=0 ; chunkIndex<chunkSize ; ++chunkIndex) {
+                SortRecord& record = records[recordIndex];
+
+                record.monitorId           = chunk->monitorIds[chunkIndex];
+                record.serverId            = chunk->serverIds[chunkIndex];
+                record.zoranTimestamp      = chunk->zoranTimestamps[chunkIndex];
+                record.latencyMicroseconds = chunk->latenciesMicroseconds[chunkIndex];
+
+                ++recordIndex;
+            }
+        }
+
+        SortRecord* source      = records.data();
+        SortRecord* destination = scratch.data();
+        for (unsigned digit=0 ; digit<numberDigits ; ++digit) {
+            if (radixPass(source, destination, currentSize, digit)) {
+                std::swap(source, destination);
+            }
+        }
+
+        recordIndex = 0;
+        for (QList<Chunk*>::const_iterator it=chunks.constBegin(),end=chunks.constEnd() ; it!=end ; ++it) {
+            Chunk*   chunk     = *it;
+            unsigned chunkSize = chunk->size();
+            for (unsigned chunkIndex=0 ; chunkIndex<chunkSize ; ++chunkIndex) {
+                const SortRecord& record = source[recordIndex];
+
+                chunk->monitorIds[chunkIndex]            = record.monitorId;
+                chunk->serverIds[chunkIndex]             = record.serverId;
+                chunk->zoranTimestamps[chunkIndex]       = record.zoranTimestamp;
+                chunk->latenciesMicroseconds[chunkIndex] = record.latencyMicroseconds;
+
+                ++recordIndex;
+            }
+        }
+    }
+}
+
+
+bool LatencyEntryChunkList::radixPass(
+        const SortRecord* source,
+        SortRecord*       destination,
+        unsigned long     count,
+        unsigned          digit
+    ) {
+    unsigned long offsets[256] = { 0 };
+    for (unsigned long index=0 ; index<count ; ++index) {
+        ++offsets[keyByte(source[index], digit)];
+    }
+
+    // Passes where every record falls into one bucket are common for the upper monitor and server ID bytes and are
+    // skipped outright.
+    bool moved = (offsets[keyByte(source[0], digit)] != count);
+    if (moved) {
+        unsigned long position = 0;
+        for (unsigned bucket=0 ; bucket<256 ; ++bucket) {
+            unsigned long bucketSize = offsets[bucket];
+            offsets[bucket] = position;
+            position += bucketSize;
+        }
+
+        for (unsigned long index=0 ; index<count ; ++index) {
+            const SortRecord& record = source[index];
+            destination[offsets[keyByte(record, digit)]++] = record;
+        }
+    }
+
+    return moved;
+}
@@ -25,50 +25,465 @@
 #include <QList>
 #include <QTimer>
 #include <QThread>
+#include <QAtomicPointer>
+#include <QAtomicInteger>
+#include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QDateTime>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QVariant>
+#include <QByteArray>
+#include <QtEndian>
 
 #include <cstdint>
+#include <algorithm>
+#include <climits>
+
+#include <libpq-fe.h>
 
 #include "log.h"
 #include "short_latency_entry.h"
 #include "database_manager.h"
+#include "id_registry.h"
 #include "latency_entry.h"
+#include "latency_entry_chunk_list.h"
+#include "latency_deduplicator.h"
+#include "latency_spool.h"
+#include "aggregated_latency_entry.h"
+#include "latency_rollup.h"
+#include "latency_ring_buffer.h"
+#include "latency_rolling_statistics.h"
+#include "server_health_statistics.h"
+#include "latency_sketch.h"
+#include "latency_block.h"
+#include "metrics_registry.h"
+#include "memory_governor.h"
+#include "sql_helpers.h"
+#include "thread_placement.h"
 #include "latency_interface.h"
 
-const unsigned      LatencyInterface::queueCheckInterval = 10;
-const unsigned      LatencyInterface::numberCyclesBeforeForcedCommit = 30;
-const unsigned long LatencyInterface::maximumNumberCachedEntries = 8000000;
-const unsigned long LatencyInterface::maximumRowsPerTransaction = 100;
-const unsigned      LatencyInterface::retryIntervalMilliseconds = 30000;
+const qint64             LatencyInterface::noQueuedEntries = -1;
+const unsigned long      LatencyInterface::maximumRowsPerStatement = 1000;
+const int                LatencyInterface::copyBufferSize = 1 << 20;
+const unsigned long      LatencyInterface::defaultFlushBatchSize = 100000;
+const unsigned long      LatencyInterface::defaultFlushMaximumEntries = 8000000;
+const unsigned long long LatencyInterface::defaultFlushMaximumBytes = 256ULL << 20;
+const unsigned long      LatencyInterface::defaultFlushMaximumAge = 60;
+const unsigned long      LatencyInterface::defaultIngestHighWatermark = 32000000;
+const unsigned long      LatencyInterface::defaultIngestLowWatermark = 8000000;
+const unsigned           LatencyInterface::minimumRetryAfterSeconds = 1;
+const unsigned           LatencyInterface::retryIntervalMilliseconds = 30000;
+
+/***********************************************************************************************************************
+* LatencyInterface::ShardWriter
+*/
+
+LatencyInterface::ShardWriter::ShardWriter(
+        LatencyInterface* owner,
+        const QString&    databaseName
+    ):currentOwner(
+        owner
+    ),currentDatabaseName(
+        databaseName
+    ),currentEntries(
+        &owner->chunkPool
+    ) {
+    currentQueueDepth.storeRelease(0);
+
+    writeRequested = false;
+    writeSucceeded = true;
+    stopRequested  = false;
+
+    start();
+}
+
+
+LatencyInterface::ShardWriter::~ShardWriter() {
+    writerMutex.lock();
+    stopRequested = true;
+    writerCondition.wakeAll();
+    writerMutex.unlock();
+
+    wait();
+}
+
+
+LatencyEntryChunkList& LatencyInterface::ShardWriter::entries() {
+    return currentEntries;
+}
+
+
+void LatencyInterface::ShardWriter::startWrite() {
+    QMutexLocker writerMutexLocker(&writerMutex);
+
+    currentQueueDepth.storeRelease(currentEntries.size());
+    writeRequested = true;
+    writerCondition.wakeAll();
+}
+
+
+bool LatencyInterface::ShardWriter::waitForWrite() {
+    QMutexLocker writerMutexLocker(&writerMutex);
+
+    while (writeRequested) {
+        writerCondition.wait(&writerMutex);
+    }
+
+    return writeSucceeded;
+}
+
+
+unsigned long LatencyInterface::ShardWriter::queueDepth() const {
+    return static_cast<unsigned long>(currentQueueDepth.loadAcquire());
+}
+
+
+void LatencyInterface::ShardWriter::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::LATENCY_INTERFACE);
+
+    writerMutex.lock();
+
+    while (!stopRequested) {
+        if (writeRequested) {
+            writerMutex.unlock();
+            bool success = currentOwner->writeEntries(currentEntries, currentDatabaseName);
+            writerMutex.lock();
+
+            currentQueueDepth.storeRelease(0);
+            writeSucceeded = success;
+            writeRequested = false;
+            writerCondition.wakeAll();
+        } else {
+            writerCondition.wait(&writerMutex);
+        }
+    }
+
+    writerMutex.unlock();
+}
+
+/***********************************************************************************************************************
+* LatencyInterface::BlockKey
+*/
+
+LatencyInterface::BlockKey::BlockKey(MonitorId monitorId, ServerId serverId, ZoranTimeStamp blockTimestamp) {
+    this->monitorId      = monitorId;
+    this->serverId       = serverId;
+    this->blockTimestamp = blockTimestamp;
+}
+
+
+bool LatencyInterface::BlockKey::operator<(const BlockKey& other) const {
+    return (
+           monitorId < other.monitorId
+        || (monitorId == other.monitorId && serverId < other.serverId)
+        || (monitorId == other.monitorId && serverId == other.serverId && blockTimestamp < other.blockTimestamp)
+    );
+}
+
+/***********************************************************************************************************************
+* LatencyInterface
+*/
 
 LatencyInterface::LatencyInterface(
-        DatabaseManager* databaseManager,
-        unsigned         connectionId,
-        QObject*         parent
+        DatabaseManager*          databaseManager,
+        IdRegistry*               idRegistry,
+        LatencyRingBuffer*        ringBuffer,
+        LatencyRollingStatistics* rollingStatistics,
+        ServerHealthStatistics*   serverHealth,
+        unsigned                  connectionId,
+        QObject*                  parent
     ):QThread(
         parent
+    ),chunkPool(
+        (defaultFlushMaximumEntries + defaultFlushMaximumEntries / 2) / LatencyEntryChunkList::chunkCapacity
+    ),currentInProcessEntries(
+        &chunkPool
     ) {
-    currentDatabaseManager = databaseManager;
-    currentConnectionId    = connectionId;
+    currentDatabaseManager   = databaseManager;
+    currentIdRegistry        = idRegistry;
+    currentRingBuffer        = ringBuffer;
+    currentRollingStatistics = rollingStatistics;
+    currentServerHealth      = serverHealth;
+    currentConnectionId      = connectionId;
+    currentSpool             = nullptr;
+    currentRollup            = nullptr;
+
+    currentRollupResamplePeriod = 0;
+    currentRollupMaximumAge     = 0;
+    currentRollupCoverageStart  = 0;
 
-    currentInProcessEntries = nullptr;
-    currentIncomingEntries  = new LatencyEntryList;
-    currentIncomingEntries->reserve(maximumNumberCachedEntries + maximumNumberCachedEntries / 2);
+    incomingBlocks.storeRelease(nullptr);
+    numberIncomingEntries.storeRelease(0);
+    numberIncomingBytes.storeRelease(0);
+    numberFlushingEntries.storeRelease(0);
+    oldestEntryMilliseconds.storeRelease(noQueuedEntries);
+    flushOldestEntryMilliseconds = noQueuedEntries;
+    sizeThresholdSignalled.storeRelease(0);
 
+    currentFlushBatchSize.storeRelease(defaultFlushBatchSize);
+    currentDeduplicationCapacity.storeRelease(LatencyDeduplicator::defaultCapacity);
+    currentFlushMaximumEntries.storeRelease(defaultFlushMaximumEntries);
+    currentFlushMaximumBytes.storeRelease(defaultFlushMaximumBytes);
+    currentFlushMaximumAgeMilliseconds.storeRelease(1000ULL * defaultFlushMaximumAge);
+    currentIngestHighWatermark.storeRelease(defaultIngestHighWatermark);
+    currentIngestLowWatermark.storeRelease(defaultIngestLowWatermark);
+    currentFlushRate.storeRelease(0);
+    ingestThrottled.storeRelease(0);
+    memoryStage.storeRelease(static_cast<int>(MemoryGovernor::Stage::NORMAL));
+    currentNumberWriters.storeRelease(1);
+    currentBlockStorage.storeRelease(0);
     shutdownRequested = false;
+
+    flushClock.start();
+
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    metricLabels         = MetricsRegistry::label(QString("region"), QString::number(connectionId));
+    flushDurationMetric  = metricsRegistry->histogram(
+        QString("dbc_latency_flush_seconds"),
+        QString("Time spent writing queued latency entries to the database."),
+        metricLabels
+    );
+    flushedEntriesMetric = metricsRegistry->counter(
+        QString("dbc_latency_flushed_entries_total"),
+        QString("Number of latency entries written to the database."),
+        metricLabels
+    );
+    receivedEntriesMetric = metricsRegistry->counter(
+        QString("dbc_latency_received_entries_total"),
+        QString("Number of latency entries received from polling servers."),
+        metricLabels
+    );
+    duplicateEntriesMetric = metricsRegistry->counter(
+        QString("dbc_latency_duplicate_entries_total"),
+        QString("Number of resent latency entries dropped before being written to the database."),
+        metricLabels
+    );
+    ingestLagMetric = metricsRegistry->histogram(
+        QString("dbc_latency_ingest_lag_seconds"),
+        QString("Time from receipt of the oldest entry in a flush until the flush is committed."),
+        metricLabels
+    );
+
+    metricsRegistry->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_latency_queue_depth"),
+        QString("Number of latency entries waiting to be flushed."),
+        metricLabels,
+        [this]() {
+            return static_cast<double>(numberIncomingEntries.loadAcquire());
+        }
+    );
+    metricsRegistry->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_latency_flush_rate"),
+        QString("Rate of the most recent successful flush, in entries per second."),
+        metricLabels,
+        [this]() {
+            return static_cast<double>(currentFlushRate.loadAcquire());
+        }
+    );
+
+    memoryConsumerId = MemoryGovernor::instance()->registerConsumer(
+        QString("latency_queue_%1").arg(connectionId),
+        [this]() {
+            static const quint64 chunkedEntryBytes = (
+                  sizeof(MonitorId)
+                + sizeof(ServerId)
+                + sizeof(ZoranTimeStamp)
+                + sizeof(LatencyMicroseconds)
+            );
+
+            return numberIncomingBytes.loadAcquire() + chunkedEntryBytes * numberFlushingEntries.loadAcquire();
+        },
+        [this](MemoryGovernor::Stage stage) {
+            memoryStage.storeRelease(static_cast<int>(stage));
+            if (stage >= MemoryGovernor::Stage::FORCE_FLUSH) {
+                wakeFlushThread();
+            }
+        }
+    );
 }
 
 
 LatencyInterface::~LatencyInterface() {
+    MemoryGovernor::instance()->unregisterConsumer(memoryConsumerId);
+
+    MetricsRegistry::instance()->removeSeries(QString("dbc_latency_queue_depth"), metricLabels);
+    MetricsRegistry::instance()->removeSeries(QString("dbc_latency_flush_rate"), metricLabels);
+
+    flushMutex.lock();
     shutdownRequested = true;
+    flushCondition.wakeAll();
+    flushMutex.unlock();
+
     wait();
+
+    for (QList<ShardWriter*>::const_iterator it=shardWriters.constBegin(),end=shardWriters.constEnd() ;
+         it!=end                                                                                      ;
+         ++it                                                                                         ) {
+        delete *it;
+    }
+
+    if (currentSpool != nullptr) {
+        delete currentSpool;
+    }
+
+    if (currentRollup != nullptr) {
+        delete currentRollup;
+    }
+
+    IncomingBlock* remaining = incomingBlocks.fetchAndStoreAcquire(nullptr);
+    while (remaining != nullptr) {
+        IncomingBlock* next = remaining->next;
+        delete remaining;
+        remaining = next;
+    }
+}
+
+
+void LatencyInterface::setFlushBatchSize(unsigned long newFlushBatchSize) {
+    currentFlushBatchSize.storeRelease(newFlushBatchSize > 0 ? newFlushBatchSize : defaultFlushBatchSize);
+}
+
+
+void LatencyInterface::setDeduplicationCapacity(unsigned long newCapacity) {
+    currentDeduplicationCapacity.storeRelease(newCapacity);
+}
+
+
+bool LatencyInterface::enableSpool(const QString& directory) {
+    LatencySpool* spool   = new LatencySpool(directory);
+    bool          success = spool->open();
+
+    if (success) {
+        currentSpool = spool;
+
+        unsigned long numberReplayedEntries = spool->numberUnreadEntries();
+        if (numberReplayedEntries > 0) {
+            queuedEntries(numberReplayedEntries, 0);
+
+            // Replayed entries are treated as overdue so they're flushed as soon as the thread starts.
+            oldestEntryMilliseconds.storeRelease(0);
+        }
+    } else {
+        logWrite(QString("Latency spool %1 is disabled, entries will be held in memory.").arg(directory), true);
+        delete spool;
+    }
+
+    return success;
+}
+
+
+bool LatencyInterface::hasPendingEntries() const {
+    return numberIncomingEntries.loadAcquire() > 0;
+}
+
+
+void LatencyInterface::setIngestWatermarks(unsigned long highWatermark, unsigned long lowWatermark) {
+    if (highWatermark == 0) {
+        highWatermark = defaultIngestHighWatermark;
+    }
+
+    currentIngestHighWatermark.storeRelease(highWatermark);
+    currentIngestLowWatermark.storeRelease(std::min(lowWatermark, highWatermark));
+}
+
+
+LatencyInterface::IngestPressure LatencyInterface::ingestPressure() {
+    IngestPressure result;
+    quint64        queueDepth = numberIncomingEntries.loadAcquire();
+
+    result.queueDepth = static_cast<unsigned long>(queueDepth);
+
+    // The throttle state has hysteresis so polling servers don't oscillate around a single threshold.
+    if (queueDepth >= currentIngestHighWatermark.loadAcquire()) {
+        ingestThrottled.storeRelease(1);
+    } else if (queueDepth <= currentIngestLowWatermark.loadAcquire()) {
+        ingestThrottled.storeRelease(0);
+    }
+
+    // Memory backpressure overrides the queue watermarks but leaves their hysteresis state untouched.
+    result.throttled = (
+           ingestThrottled.loadAcquire() != 0
+        || memoryStage.loadAcquire() >= static_cast<int>(MemoryGovernor::Stage::BACKPRESSURE)
+    );
+    if (result.throttled) {
+        quint64 flushRate         = currentFlushRate.loadAcquire();
+        quint64 excess            = queueDepth - std::min(queueDepth, currentIngestLowWatermark.loadAcquire());
+        quint64 maximumRetryAfter = currentFlushMaximumAgeMilliseconds.loadAcquire() / 1000;
+
+        if (flushRate > 0) {
+            result.retryAfterSeconds = static_cast<unsigned long>(
+                std::max(
+                    static_cast<quint64>(minimumRetryAfterSeconds),
+                    std::min(excess / flushRate, maximumRetryAfter)
+                )
+            );
+        } else {
+            result.retryAfterSeconds = static_cast<unsigned long>(maximumRetryAfter);
+        }
+    } else {
+        result.retryAfterSeconds = 0;
+    }
+
+    return result;
+}
+
+
+void LatencyInterface::setNumberWriters(unsigned numberWriters) {
+    currentNumberWriters.storeRelease(std::max(numberWriters, 1U));
+}
+
+
+void LatencyInterface::setBlockStorage(bool enabled) {
+    currentBlockStorage.storeRelease(enabled ? 1 : 0);
+}
+
+
+QList<unsigned long> LatencyInterface::shardQueueDepths() {
+    QList<unsigned long> result;
+
+    QMutexLocker shardWritersMutexLocker(&shardWritersMutex);
+    for (QList<ShardWriter*>::const_iterator it=shardWriters.constBegin(),end=shardWriters.constEnd() ;
+         it!=end                                                                                      ;
+         ++it                                                                                         ) {
+        result.append((*it)->queueDepth());
+    }
+
+    return result;
+}
+
+
+void LatencyInterface::setRollupParameters(
+        unsigned long      resamplePeriod,
+        unsigned long      maximumAge,
+        unsigned long long coverageStart
+    ) {
+    QMutexLocker rollupParametersMutexLocker(&rollupParametersMutex);
+
+    currentRollupResamplePeriod = resamplePeriod;
+    currentRollupMaximumAge     = maximumAge;
+    currentRollupCoverageStart  = coverageStart;
+}
+
+
+void LatencyInterface::setFlushThresholds(
+        unsigned long      maximumEntries,
+        unsigned long long maximumBytes,
+        unsigned long      maximumAge
+    ) {
+    currentFlushMaximumEntries.storeRelease(maximumEntries > 0 ? maximumEntries : defaultFlushMaximumEntries);
+    currentFlushMaximumBytes.storeRelease(maximumBytes > 0 ? maximumBytes : defaultFlushMaximumBytes);
+    currentFlushMaximumAgeMilliseconds.storeRelease(1000ULL * (maximumAge > 0 ? maximumAge : defaultFlushMaximumAge));
+
+    wakeFlushThread();
 }
 
 
@@ -78,31 +493,116 @@ void LatencyInterface::addEntry(
         ZoranTimeStamp      zoranTimestamp,
         LatencyMicroseconds latencyMicroseconds
     ) {
-    incomingEntriesMutex.lock();
-    currentIncomingEntries->append(
-        LatencyEntry(
-            monitorId,
-            serverId,
-            zoranTimestamp,
-            latencyMicroseconds
-        )
-    );
-    incomingEntriesMutex.unlock();
+    LatencyEntryList entries;
+    entries.append(LatencyEntry(monitorId, serverId, zoranTimestamp, latencyMicroseconds));
+    addEntries(entries);
 }
 
 
 
 void LatencyInterface::addEntry(const LatencyEntry& latencyEntry) {
-    incomingEntriesMutex.lock();
-    currentIncomingEntries->append(latencyEntry);
-    incomingEntriesMutex.unlock();
+    LatencyEntryList entries;
+    entries.append(latencyEntry);
+    addEntries(entries);
 }
 
 
 void LatencyInterface::addEntries(const QList<LatencyEntry>& latencyEntries) {
-    incomingEntriesMutex.lock();
-    currentIncomingEntries->append(latencyEntries);
-    incomingEntriesMutex.unlock();
+    if (!latencyEntries.isEmpty()) {
+        receivedEntriesMetric->increment(static_cast<unsigned long>(latencyEntries.size()));
+
+        if (currentRingBuffer != nullptr || currentRollingStatistics != nullptr) {
+            for (  LatencyEntryList::const_iterator it = latencyEntries.constBegin(), end = latencyEntries.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                if (it->latencyMicroseconds() <= LatencyEntry::maximumAllowedLatencyMicroseconds) {
+                    if (currentRingBuffer != nullptr) {
+                        currentRingBuffer->addEntry(
+                            it->monitorId(),
+                            it->serverId(),
+                            it->zoranTimestamp(),
+                            it->latencyMicroseconds()
+                        );
+                    }
+
+                    if (currentRollingStatistics != nullptr) {
+                        currentRollingStatistics->addEntry(
+                            it->monitorId(),
+                            it->serverId(),
+                            it->zoranTimestamp(),
+                            it->latencyMicroseconds()
+                        );
+                    }
+                }
+            }
+        }
+
+        if (currentServerHealth != nullptr) {
+            currentServerHealth->addEntries(latencyEntries);
+        }
+
+        if (currentSpool != nullptr && currentSpool->append(latencyEntries)) {
+            queuedEntries(static_cast<unsigned long>(latencyEntries.size()), 0);
+        } else {
+            pushIncomingBlock(new IncomingBlock(latencyEntries));
+        }
+    }
+}
+
+
+void LatencyInterface::addEntries(
+        ServerId          serverId,
+        const QByteArray& payload,
+        unsigned long     offset,
+        unsigned long     numberEntries
+    ) {
+    if (numberEntries > 0) {
+        receivedEntriesMetric->increment(numberEntries);
+
+        if (currentRingBuffer != nullptr || currentRollingStatistics != nullptr || currentServerHealth != nullptr) {
+            // Every entry in the payload comes from one server so its health is accumulated locally and added with
+            // a single lock.  Timeouts are included since they are part of the server's health.
+            ServerHealthStatistics::Batch healthBatch;
+
+            const RawEntry* rawEntry = reinterpret_cast<const RawEntry*>(payload.constData() + offset);
+            for (unsigned long i=0 ; i<numberEntries ; ++i) {
+                healthBatch.add(rawEntry->latencyMicroseconds);
+
+                if (rawEntry->latencyMicroseconds <= LatencyEntry::maximumAllowedLatencyMicroseconds) {
+                    if (currentRingBuffer != nullptr) {
+                        currentRingBuffer->addEntry(
+                            rawEntry->monitorId,
+                            serverId,
+                            rawEntry->timestamp,
+                            rawEntry->latencyMicroseconds
+                        );
+                    }
+
+                    if (currentRollingStatistics != nullptr) {
+                        currentRollingStatistics->addEntry(
+                            rawEntry->monitorId,
+                            serverId,
+                            rawEntry->timestamp,
+                            rawEntry->latencyMicroseconds
+                        );
+                    }
+                }
+
+                ++rawEntry;
+            }
+
+            if (currentServerHealth != nullptr) {
+                currentServerHealth->addBatch(serverId, healthBatch);
+            }
+        }
+
+        if (currentSpool != nullptr && currentSpool->append(serverId, payload, offset, numberEntries)) {
+            queuedEntries(numberEntries, 0);
+        } else {
+            pushIncomingBlock(new IncomingBlock(payload, offset, numberEntries, serverId));
+        }
+    }
 }
 
 
@@ -114,50 +614,287 @@ void LatencyInterface::receivedEntries() {
 
 
 void LatencyInterface::run() {
-    unsigned long numberQueuedEntries;
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::LATENCY_INTERFACE);
 
+    flushMutex.lock();
+
+    while (!shutdownRequested) {
+        unsigned long waitMilliseconds;
+        if (flushDue(waitMilliseconds)) {
+            flushMutex.unlock();
+            performFlush();
+            flushMutex.lock();
+        } else {
+            flushCondition.wait(&flushMutex, waitMilliseconds);
+        }
+    }
+
+    flushMutex.unlock();
+
+    if (numberQueuedEntries() > 0) {
+        performFlush();
+    }
+}
+
+
+bool LatencyInterface::flushDue(unsigned long& waitMilliseconds) const {
+    bool    result;
+    quint64 numberEntries = numberIncomingEntries.loadAcquire();
+
+    if (numberEntries == 0) {
+        waitMilliseconds = ULONG_MAX;
+        result           = false;
+    } else if (numberEntries >= currentFlushMaximumEntries.loadAcquire()                          ||
+               numberIncomingBytes.loadAcquire() >= currentFlushMaximumBytes.loadAcquire()             ||
+               memoryStage.loadAcquire() >= static_cast<int>(MemoryGovernor::Stage::FORCE_FLUSH)      ) {
+        result = true;
+    } else {
+        quint64 maximumAge = currentFlushMaximumAgeMilliseconds.loadAcquire();
+        qint64  oldest     = oldestEntryMilliseconds.loadAcquire();
+        quint64 age        = oldest == noQueuedEntries ? 0 : static_cast<quint64>(flushClock.elapsed() - oldest);
+
+        if (age >= maximumAge) {
+            result = true;
+        } else {
+            waitMilliseconds = static_cast<unsigned long>(maximumAge - age);
+            result           = false;
+        }
+    }
+
+    return result;
+}
+
+
+void LatencyInterface::wakeFlushThread() {
+    QMutexLocker flushMutexLocker(&flushMutex);
+    flushCondition.wakeAll();
+}
+
+
+unsigned long LatencyInterface::numberQueuedEntries() {
+    return static_cast<unsigned long>(numberIncomingEntries.loadAcquire());
+}
+
+
+void LatencyInterface::pushIncomingBlock(IncomingBlock* block) {
+    IncomingBlock* top = incomingBlocks.loadAcquire();
     do {
-        unsigned cyclesRemaining = numberCyclesBeforeForcedCommit;
-        do {
-            sleep(queueCheckInterval);
+        block->next = top;
+    } while (!incomingBlocks.testAndSetOrdered(top, block, top));
+
+    queuedEntries(block->numberEntries, block->numberBytes);
+}
 
-            incomingEntriesMutex.lock();
-            numberQueuedEntries = static_cast<unsigned long>(currentIncomingEntries->size());
-            incomingEntriesMutex.unlock();
 
-            --cyclesRemaining;
-        } while (!shutdownRequested && numberQueuedEntries < maximumNumberCachedEntries && cyclesRemaining > 0);
+void LatencyInterface::queuedEntries(unsigned long newEntries, unsigned long newBytes) {
+    quint64 numberEntries = numberIncomingEntries.fetchAndAddOrdered(newEntries) + newEntries;
+    quint64 numberBytes   = numberIncomingBytes.fetchAndAddOrdered(newBytes) + newBytes;
 
-        if (!shutdownRequested && numberQueuedEntries > 0) {
-            performFlush();
+    // The first entry after a flush starts the age deadline and so must wake the flush thread.  Crossing a size
+    // threshold wakes the flush thread at most once per flush so producers rarely touch the flush mutex.
+    bool firstEntry   = oldestEntryMilliseconds.testAndSetOrdered(noQueuedEntries, flushClock.elapsed());
+    bool sizeExceeded = (
+           numberEntries >= currentFlushMaximumEntries.loadAcquire()
+        || numberBytes >= currentFlushMaximumBytes.loadAcquire()
+    );
+
+    if (firstEntry || (sizeExceeded && sizeThresholdSignalled.testAndSetOrdered(0, 1))) {
+        wakeFlushThread();
+    }
+}
+
+
+void LatencyInterface::drainIncomingBlocks() {
+    flushOldestEntryMilliseconds = oldestEntryMilliseconds.fetchAndStoreOrdered(noQueuedEntries);
+    sizeThresholdSignalled.storeRelease(0);
+
+    IncomingBlock* block    = incomingBlocks.fetchAndStoreAcquire(nullptr);
+    IncomingBlock* reversed = nullptr;
+
+    // The stack holds the newest block first so we reverse it to preserve arrival order.
+    while (block != nullptr) {
+        IncomingBlock* next = block->next;
+        block->next = reversed;
+        reversed    = block;
+        block       = next;
+    }
+
+    while (reversed != nullptr) {
+        IncomingBlock* next = reversed->next;
+
+        if (reversed->entries.isEmpty()) {
+            const RawEntry* rawEntry = reinterpret_cast<const RawEntry*>(
+                reversed->payload.constData() + reversed->offset
+            );
+
+            for (unsigned long i=0 ; i<reversed->numberEntries ; ++i) {
+                currentInProcessEntries.append(
+                    rawEntry->monitorId,
+                    reversed->serverId,
+                    rawEntry->timestamp,
+                    rawEntry->latencyMicroseconds
+                );
+
+                ++rawEntry;
+            }
+        } else {
+            const LatencyEntryList& entries = reversed->entries;
+            for (LatencyEntryList::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+                currentInProcessEntries.append(*it);
+            }
         }
 
-        incomingEntriesMutex.lock();
-        numberQueuedEntries = static_cast<unsigned long>(currentIncomingEntries->size());
-        incomingEntriesMutex.unlock();
-    } while (numberQueuedEntries > 0);
+        numberIncomingEntries.fetchAndSubOrdered(reversed->numberEntries);
+        numberIncomingBytes.fetchAndSubOrdered(reversed->numberBytes);
+
+        delete reversed;
+        reversed = next;
+    }
+
+    if (currentSpool != nullptr) {
+        unsigned long maximumEntries = static_cast<unsigned long>(currentFlushMaximumEntries.loadAcquire());
+        unsigned long numberInMemory = currentInProcessEntries.size();
+
+        if (numberInMemory < maximumEntries) {
+            // Producers only ever add to the count so clamping here can not hide entries.
+            quint64 numberRead = currentSpool->read(currentInProcessEntries, maximumEntries - numberInMemory);
+            numberIncomingEntries.fetchAndSubOrdered(std::min(numberRead, numberIncomingEntries.loadAcquire()));
+        }
+
+        if (currentSpool->numberUnreadEntries() > 0) {
+            // A backlog remains in the spool so the next flush is due immediately.
+            oldestEntryMilliseconds.storeRelease(0);
+        }
+    }
 }
 
 
 void LatencyInterface::performFlush() {
-    incomingEntriesMutex.lock();
+    unsigned long firstNewEntry = currentInProcessEntries.size();
+    drainIncomingBlocks();
 
-    currentInProcessEntries = currentIncomingEntries;
-    currentIncomingEntries  = new LatencyEntryList;
-    currentIncomingEntries->reserve(maximumNumberCachedEntries + maximumNumberCachedEntries / 2);
+    unsigned long deduplicationCapacity = static_cast<unsigned long>(currentDeduplicationCapacity.loadAcquire());
+    if (deduplicationCapacity != currentDeduplicator.capacity()) {
+        currentDeduplicator.setCapacity(deduplicationCapacity);
+    }
+
+    // Resent entries are dropped before rollups so they are neither written nor counted twice.
+    unsigned long numberDuplicates = currentDeduplicator.filter(currentInProcessEntries, firstNewEntry);
+    if (numberDuplicates > 0) {
+        duplicateEntriesMetric->increment(numberDuplicates);
+    }
+
+    accumulateRollups();
+    numberFlushingEntries.storeRelease(currentInProcessEntries.size());
 
-    incomingEntriesMutex.unlock();
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+
+    unsigned long numberEntries = currentInProcessEntries.size();
+    unsigned      numberWriters = static_cast<unsigned>(currentNumberWriters.loadAcquire());
+    QString       databaseName  = QString("LatencyInterface%1").arg(currentConnectionId);
+    bool          written;
+
+    MonitorIdSet writtenMonitorIds;
+    for (unsigned long index=0 ; index<numberEntries ; ++index) {
+        writtenMonitorIds.insert(currentInProcessEntries.at(index).monitorId());
+    }
+
+    if (numberWriters <= 1) {
+        written = writeEntries(currentInProcessEntries, databaseName);
+    } else {
+        shardWritersMutex.lock();
+
+        while (static_cast<unsigned>(shardWriters.size()) < numberWriters) {
+            unsigned writerIndex = static_cast<unsigned>(shardWriters.size());
+            shardWriters.append(new ShardWriter(this, QString("%1_%2").arg(databaseName).arg(writerIndex)));
+        }
+
+        while (static_cast<unsigned>(shardWriters.size()) > numberWriters) {
+            delete shardWriters.takeLast();
+        }
+
+        shardWritersMutex.unlock();
+
+        for (unsigned long index=0 ; index<numberEntries ; ++index) {
+            const LatencyEntry& latencyEntry = currentInProcessEntries.at(index);
+            shardWriters.at(shardIndex(latencyEntry.monitorId(), numberWriters))->entries().append(latencyEntry);
+        }
+
+        currentInProcessEntries.clear();
+
+        QString depths;
+        for (  QList<ShardWriter*>::const_iterator it  = shardWriters.constBegin(),
+                                                   end = shardWriters.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            ShardWriter* writer = *it;
+            depths += QString(depths.isEmpty() ? "%1" : ", %1").arg(writer->entries().size());
+            writer->startWrite();
+        }
+
+        logWrite(
+            QString("Region %1 flushing %2 entries across %3 writers: %4")
+            .arg(currentConnectionId)
+            .arg(numberEntries)
+            .arg(numberWriters)
+            .arg(depths),
+            false
+        );
+
+        written = true;
+        for (  QList<ShardWriter*>::const_iterator it  = shardWriters.constBegin(),
+                                                   end = shardWriters.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            written = (*it)->waitForWrite() && written;
+        }
+    }
+
+    if (written) {
+        if (currentRollup != nullptr) {
+            writeRollups(databaseName);
+        }
+
+        if (currentSpool != nullptr) {
+            currentSpool->checkpoint();
+        }
+
+        qint64 elapsedMilliseconds = std::max(flushTimer.elapsed(), static_cast<qint64>(1));
+        currentFlushRate.storeRelease(1000ULL * numberEntries / static_cast<quint64>(elapsedMilliseconds));
+
+        flushDurationMetric->observe(flushTimer.nsecsElapsed() / 1.0E9);
+        flushedEntriesMetric->increment(numberEntries);
+
+        if (flushOldestEntryMilliseconds != noQueuedEntries && numberEntries > 0) {
+            ingestLagMetric->observe((flushClock.elapsed() - flushOldestEntryMilliseconds) / 1000.0);
+        }
+
+        if (!writtenMonitorIds.isEmpty()) {
+            emit entriesWritten(writtenMonitorIds);
+        }
+    }
+
+    numberFlushingEntries.storeRelease(0);
+}
+
+
+bool LatencyInterface::writeEntries(LatencyEntryChunkList& entries, const QString& databaseName) {
+    unsigned long flushBatchSize = static_cast<unsigned long>(currentFlushBatchSize.loadAcquire());
+    bool          blockStorage   = (currentBlockStorage.loadAcquire() != 0);
 
     bool          success        = true;
+    bool          written        = true;
     unsigned long entryBaseIndex = 0;
-    unsigned long numberEntries  = static_cast<unsigned long>(currentInProcessEntries->size());
+    unsigned long numberEntries  = entries.size();
 
-    QString queryString  = QString(
-        "INSERT INTO latency_seconds (monitor_id, server_id, timestamp, latency) "
-                             "VALUES (:monitor_id, :server_id, :timestamp, :latency) "
-                    "ON CONFLICT DO NOTHING"
-    );
-    QString databaseName = QString("LatencyInterface%1").arg(currentConnectionId);
+    // Entries arrive interleaved across polling servers.  Writing them in primary key order keeps B-tree maintenance
+    // on latency_seconds largely sequential.  Block storage already groups rows by key when building blocks.
+    if (!blockStorage) {
+        entries.sortByKey();
+    }
 
     do {
         QSqlDatabase database = currentDatabaseManager->getDatabase(databaseName);
@@ -171,9 +908,41 @@ void LatencyInterface::performFlush() {
             );
         }
 
+        pg_conn*                    connection = nullptr;
+        IdRegistry::SnapshotPointer validIds;
+
+        if (success) {
+            success  = currentIdRegistry->reconcileIfNeeded(database);
+            validIds = currentIdRegistry->snapshot();
+        }
+
+        if (success) {
+            QSqlQuery query(database);
+
+            connection = blockStorage ? nullptr : SqlHelpers::postgreSqlConnection(database);
+            if (connection != nullptr) {
+                success = SqlHelpers::execute(
+                    query,
+                    "CREATE TEMPORARY TABLE IF NOT EXISTS latency_seconds_staging ("
+                        "monitor_id INTEGER NOT NULL, "
+                        "server_id SMALLINT NOT NULL, "
+                        "timestamp INTEGER NOT NULL, "
+                        "latency INTEGER NOT NULL"
+                    ") ON COMMIT DELETE ROWS"
+                );
+
+                if (!success) {
+                    logWrite(
+                        QString("Failed to create staging table: %1 -- retrying").arg(query.lastError().text()),
+                        true
+                    );
+                }
+            }
+        }
+
         while (success && entryBaseIndex < numberEntries) {
             unsigned long entriesRemaining             = numberEntries - entryBaseIndex;
-            unsigned long numberEntriesThisTransaction = std::min(entriesRemaining, maximumRowsPerTransaction);
+            unsigned long numberEntriesThisTransaction = std::min(entriesRemaining, flushBatchSize);
             bool          supportsTransactions;
 
             if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
@@ -183,97 +952,532 @@ void LatencyInterface::performFlush() {
                 supportsTransactions = false;
             }
 
-            QSqlQuery query(database);
-
-            QSet<MonitorId> validMonitorIds;
-            success = query.exec("SELECT monitor_id FROM monitor");
-            if (success) {
-                int monitorIdField = query.record().indexOf("monitor_id");
-                while (success && query.next()) {
-                    validMonitorIds.insert(query.value(monitorIdField).toUInt());
-                }
+            if (blockStorage) {
+                success = insertBlocks(database, *validIds, entries, entryBaseIndex, numberEntriesThisTransaction);
+            } else if (connection != nullptr) {
+                success = copyEntries(
+                    database,
+                    connection,
+                    *validIds,
+                    entries,
+                    entryBaseIndex,
+                    numberEntriesThisTransaction
+                );
+            } else {
+                success = insertEntries(database, *validIds, entries, entryBaseIndex, numberEntriesThisTransaction);
+            }
 
-                QSet<ServerId>  validServerIds;
-                success = query.exec("SELECT server_id FROM servers");
+            if (supportsTransactions) {
                 if (success) {
-                    int serverIdField = query.record().indexOf("server_id");
-                    while (success && query.next()) {
-                        validServerIds.insert(query.value(serverIdField).toUInt());
-                    }
-
-                    query.finish();
-                    success = query.prepare(queryString);
+                    success = database.commit();
                     if (success) {
-                        unsigned offset     = static_cast<unsigned>(-1);
-                        unsigned lastOffset = numberEntriesThisTransaction - 1;
-                        do {
-                            ++offset;
-                            const LatencyEntry& latencyEntry = currentInProcessEntries->at(entryBaseIndex + offset);
-
-                            LatencyEntry::MonitorId           monitorId           = latencyEntry.monitorId();
-                            LatencyEntry::ServerId            serverId            = latencyEntry.serverId();
-                            LatencyEntry::LatencyMicroseconds latencyMicroseconds = latencyEntry.latencyMicroseconds();
-
-                            if (latencyMicroseconds <= LatencyEntry::maximumAllowedLatencyMicroseconds &&
-                                validMonitorIds.contains(monitorId)                                    &&
-                                validServerIds.contains(serverId)                                         ) {
-                                query.bindValue(":monitor_id", QVariant(monitorId));
-                                query.bindValue(":server_id", QVariant(serverId));
-                                query.bindValue(":timestamp", QVariant(latencyEntry.zoranTimestamp()));
-                                query.bindValue(":latency", QVariant(latencyMicroseconds));
-
-                                success = query.exec();
-                            }
-                        } while (success && offset < lastOffset);
-
-                        if (!success) {
-                            logWrite(
-                                QString("Failed query: \"%1\" during insertion: %2 -- retrying")
-                                .arg(queryString, query.lastError().text()),
-                                true
-                            );
-                        }
+                        entryBaseIndex += numberEntriesThisTransaction;
                     } else {
                         logWrite(
-                            QString("Failed to prepare query: %1 -- retrying").arg(query.lastError().text()),
+                            QString("Failed commit while inserting new data: %1 -- retrying")
+                            .arg(database.lastError().text()),
+                            true
+                        );
+                    }
+                } else {
+                    if (!database.rollback()) {
+                        logWrite(
+                            QString("Failed rollback while inserting new data: %1 -- retrying")
+                            .arg(database.lastError().text()),
                             true
                         );
                     }
                 }
+            } else if (success) {
+                entryBaseIndex += numberEntriesThisTransaction;
             }
+        }
 
-            if (supportsTransactions) {
-                if (success) {
-                    success = database.commit();
-                    if (success) {
-                        entryBaseIndex += numberEntriesThisTransaction;
-                    } else {
+        currentDatabaseManager->closeAndRelease(database);
+
+        if (!success) {
+            currentIdRegistry->invalidate();
+
+            QMutexLocker flushMutexLocker(&flushMutex);
+            if (shutdownRequested) {
+                if (currentSpool != nullptr) {
+                    logWrite(
+                        QString("Leaving %1 latency entries in spool %2 at shutdown.")
+                        .arg(entries.size())
+                        .arg(currentSpool->directory()),
+                        false
+                    );
+                } else {
+                    logWrite(
+                        QString("Discarding %1 latency entries at shutdown.").arg(entries.size()),
+                        true
+                    );
+                }
+
+                written = false;
+                success = true;
+            } else {
+                flushCondition.wait(&flushMutex, retryIntervalMilliseconds);
+            }
+        }
+    } while (!success);
+
+    entries.clear();
+    return written;
+}
+
+
+void LatencyInterface::accumulateRollups() {
+    rollupParametersMutex.lock();
+
+    unsigned long      resamplePeriod = currentRollupResamplePeriod;
+    unsigned long long coverageStart  = currentRollupCoverageStart;
+
+    rollupParametersMutex.unlock();
+
+    if (currentRollup != nullptr                          &&
+        (currentRollup->resamplePeriod() != resamplePeriod ||
+         currentRollup->coverageStart() != coverageStart      )) {
+        // Open periods are discarded.  The new coverage start always follows them so the aggregator picks them up.
+        delete currentRollup;
+        currentRollup = nullptr;
+    }
+
+    if (currentRollup == nullptr && resamplePeriod > 0) {
+        currentRollup = new LatencyRollup(resamplePeriod, coverageStart);
+    }
+
+    if (currentRollup != nullptr) {
+        unsigned long numberEntries = currentInProcessEntries.size();
+        for (unsigned long index=0 ; index<numberEntries ; ++index) {
+            const LatencyEntry& latencyEntry = currentInProcessEntries.at(index);
+            if (latencyEntry.latencyMicroseconds() <= LatencyEntry::maximumAllowedLatencyMicroseconds) {
+                currentRollup->addEntry(
+                    latencyEntry.monitorId(),
+                    latencyEntry.serverId(),
+                    latencyEntry.zoranTimestamp(),
+                    latencyEntry.latencyMicroseconds()
+                );
+            }
+        }
+    }
+}
+
+
+bool LatencyInterface::writeRollups(const QString& databaseName) {
+    // Rows for the same period are merged using the pooled mean and variance.  Sketches are merged by concatenation.
+    // The existing representative sample is kept.
+    static const QString queryPrefix(
+        "INSERT INTO latency_aggregated ("
+            "monitor_id, "
+            "server_id, "
+            "timestamp, "
+            "latency, "
+            "start_timestamp, "
+            "end_timestamp, "
+            "mean_latency, "
+            "variance_latency, "
+            "minimum_latency, "
+            "maximum_latency, "
+            "number_samples, "
+            "latency_sketch"
+        ") VALUES "
+    );
+    static const QString querySuffix(
+        " ON CONFLICT (monitor_id, server_id, start_timestamp) DO UPDATE SET "
+            "mean_latency = ("
+                  "latency_aggregated.mean_latency * latency_aggregated.number_samples "
+                "+ EXCLUDED.mean_latency * EXCLUDED.number_samples"
+            ") / (latency_aggregated.number_samples + EXCLUDED.number_samples), "
+            "variance_latency = ("
+                  "latency_aggregated.variance_latency * latency_aggregated.number_samples "
+                "+ EXCLUDED.variance_latency * EXCLUDED.number_samples"
+            ") / (latency_aggregated.number_samples + EXCLUDED.number_samples) + ("
+                  "latency_aggregated.number_samples::DOUBLE PRECISION * EXCLUDED.number_samples "
+                "* (latency_aggregated.mean_latency - EXCLUDED.mean_latency) "
+                "* (latency_aggregated.mean_latency - EXCLUDED.mean_latency)"
+            ") / ("
+                  "(latency_aggregated.number_samples + EXCLUDED.number_samples)::DOUBLE PRECISION "
+                "* (latency_aggregated.number_samples + EXCLUDED.number_samples)"
+            "), "
+            "minimum_latency = LEAST(latency_aggregated.minimum_latency, EXCLUDED.minimum_latency), "
+            "maximum_latency = GREATEST(latency_aggregated.maximum_latency, EXCLUDED.maximum_latency), "
+            "number_samples = latency_aggregated.number_samples + EXCLUDED.number_samples, "
+            "latency_sketch = COALESCE(latency_aggregated.latency_sketch, ''::BYTEA) || EXCLUDED.latency_sketch"
+    );
+
+    rollupParametersMutex.lock();
+    unsigned long maximumAge = currentRollupMaximumAge;
+    rollupParametersMutex.unlock();
+
+    unsigned long long currentTime    = QDateTime::currentSecsSinceEpoch();
+    unsigned long long closeThreshold = currentTime > maximumAge ? currentTime - maximumAge : 0;
+
+    QList<LatencySketch>                      latencySketches;
+    LatencyRollup::AggregatedLatencyEntryList closedPeriods = currentRollup->closedPeriods(
+        closeThreshold,
+        &latencySketches
+    );
+    bool success = true;
+
+    if (!closedPeriods.isEmpty()) {
+        QSqlDatabase database = currentDatabaseManager->getDatabase(databaseName);
+
+        success = database.isOpen();
+        if (success) {
+            IdRegistry::SnapshotPointer validIds = currentIdRegistry->snapshot();
+
+            bool supportsTransactions;
+            if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
+                supportsTransactions = true;
+                database.transaction();
+            } else {
+                supportsTransactions = false;
+            }
+
+            QSqlQuery query(database);
+
+            LatencyRollup::AggregatedLatencyEntryList::const_iterator it       = closedPeriods.constBegin();
+            LatencyRollup::AggregatedLatencyEntryList::const_iterator end      = closedPeriods.constEnd();
+            QList<LatencySketch>::const_iterator                      sketchIt = latencySketches.constBegin();
+            while (success && it != end) {
+                QString       queryString = queryPrefix;
+                unsigned long numberRows  = 0;
+                while (it != end && numberRows < maximumRowsPerStatement) {
+                    const AggregatedLatencyEntry& entry = *it;
+                    if (validIds->containsMonitor(entry.monitorId()) && validIds->containsServer(entry.serverId())) {
+                        if (numberRows > 0) {
+                            queryString += QChar(',');
+                        }
+
+                        queryString += QString("(%1,%2,%3,%4,%5,%6,%7,%8,%9,%10,%11,'\\x%12'::BYTEA)")
+                                       .arg(entry.monitorId())
+                                       .arg(entry.serverId())
+                                       .arg(entry.zoranTimestamp())
+                                       .arg(entry.latencyMicroseconds())
+                                       .arg(entry.startZoranTimestamp())
+                                       .arg(entry.endZoranTimestamp())
+                                       .arg(entry.meanLatency(), 0, 'g', 17)
+                                       .arg(entry.varianceLatency(), 0, 'g', 17)
+                                       .arg(entry.minimumLatency())
+                                       .arg(entry.maximumLatency())
+                                       .arg(entry.numberSamples())
+                                       .arg(QString::fromLatin1(sketchIt->toByteArray().toHex()));
+
+                        ++numberRows;
+                    }
+
+                    ++it;
+                    ++sketchIt;
+                }
+
+                if (numberRows > 0) {
+                    success = SqlHelpers::execute(query, queryString + querySuffix);
+                    if (!success) {
                         logWrite(
-                            QString("Failed commit while inserting new data: %1 -- retrying")
+                            QString("Failed to write %1 latency rollups: %2 -- retrying on next flush")
+                            .arg(numberRows)
                             .arg(query.lastError().text()),
                             true
                         );
                     }
-                } else {
-                    success = database.rollback();
+                }
+            }
+
+            if (supportsTransactions) {
+                if (success) {
+                    success = database.commit();
                     if (!success) {
                         logWrite(
-                            QString("Failed rollback while inserting new data: %1 -- retrying")
-                            .arg(query.lastError().text()),
+                            QString("Failed commit while writing latency rollups: %1 -- retrying on next flush")
+                            .arg(database.lastError().text()),
                             true
                         );
                     }
+                } else if (!database.rollback()) {
+                    logWrite(
+                        QString("Failed rollback while writing latency rollups: %1")
+                        .arg(database.lastError().text()),
+                        true
+                    );
                 }
             }
+        } else {
+            logWrite(
+                QString("Failed to open database while writing latency rollups: %1 -- retrying on next flush")
+                .arg(database.lastError().text()),
+                true
+            );
         }
 
         currentDatabaseManager->closeAndRelease(database);
+    }
+
+    if (success) {
+        currentRollup->removeClosedPeriods(closeThreshold);
+    }
+
+    return success;
+}
+
+
+bool LatencyInterface::copyEntries(
+        QSqlDatabase&                database,
+        pg_conn*                     connection,
+        const IdRegistry::Snapshot&  validIds,
+        const LatencyEntryChunkList& entries,
+        unsigned long                baseIndex,
+        unsigned long                count
+    ) {
+    static const char     copyHeader[] = { 'P', 'G', 'C', 'O', 'P', 'Y', '\n', '\377', '\r', '\n', '\0' };
+    static const unsigned copyHeaderLength = sizeof(copyHeader);
+    static const unsigned tupleLength      = 2 + 4 + 4 + 4 + 2 + 4 + 4 + 4 + 4;
+
+    PGresult* result  = PQexec(
+        connection,
+        "COPY latency_seconds_staging (monitor_id, server_id, timestamp, latency) FROM STDIN (FORMAT binary)"
+    );
+    bool      success = (PQresultStatus(result) == PGRES_COPY_IN);
+    PQclear(result);
+
+    if (success) {
+        QByteArray buffer;
+        buffer.reserve(copyBufferSize + tupleLength);
+
+        buffer.append(copyHeader, copyHeaderLength);
+        buffer.append(8, '\0'); // Flags field and header extension length.
+
+        unsigned long endIndex = baseIndex + count;
+        unsigned long index    = baseIndex;
+        while (success && index < endIndex) {
+            const LatencyEntry& latencyEntry = entries.at(index);
+            if (latencyEntry.latencyMicroseconds() <= LatencyEntry::maximumAllowedLatencyMicroseconds &&
+                validIds.containsMonitor(latencyEntry.monitorId())                                       &&
+                validIds.containsServer(latencyEntry.serverId())                                            ) {
+                std::uint8_t  tuple[tupleLength];
+                std::uint8_t* p = tuple;
+
+                qToBigEndian<std::int16_t>(4, p);
+                p += 2;
+
+                qToBigEndian<std::int32_t>(4, p + 0);
+                qToBigEndian<std::int32_t>(static_cast<std::int32_t>(latencyEntry.monitorId()), p + 4);
+                p += 8;
+
+                qToBigEndian<std::int32_t>(2, p + 0);
+                qToBigEndian<std::int16_t>(static_cast<std::int16_t>(latencyEntry.serverId()), p + 4);
+                p += 6;
+
+                qToBigEndian<std::int32_t>(4, p + 0);
+                qToBigEndian<std::int32_t>(static_cast<std::int32_t>(latencyEntry.zoranTimestamp()), p + 4);
+                p += 8;
+
+                qToBigEndian<std::int32_t>(4, p + 0);
+                qToBigEndian<std::int32_t>(static_cast<std::int32_t>(latencyEntry.latencyMicroseconds()), p + 4);
+
+                buffer.append(reinterpret_cast<const char*>(tuple), tupleLength);
+            }
+
+            ++index;
+
+            if (buffer.size() >= copyBufferSize || index == endIndex) {
+                if (index == endIndex) {
+                    std::uint8_t trailer[2];
+                    qToBigEndian<std::int16_t>(-1, trailer);
+                    buffer.append(reinterpret_cast<const char*>(trailer), 2);
+                }
+
+                success = (PQputCopyData(connection, buffer.constData(), buffer.size()) == 1);
+                buffer.clear();
+            }
+        }
 
         if (success) {
-            delete currentInProcessEntries;
-            currentInProcessEntries = nullptr;
+            success = (PQputCopyEnd(connection, nullptr) == 1);
         } else {
-            msleep(retryIntervalMilliseconds);
+            PQputCopyEnd(connection, "LatencyInterface::copyEntries aborted");
         }
-    } while (!success);
+
+        result = PQgetResult(connection);
+        while (result != nullptr) {
+            if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+                success = false;
+            }
+
+            PQclear(result);
+            result = PQgetResult(connection);
+        }
+
+        if (success) {
+            QSqlQuery query(database);
+            success = SqlHelpers::execute(
+                query,
+                "INSERT INTO latency_seconds (monitor_id, server_id, timestamp, latency) "
+                    "SELECT s.monitor_id, s.server_id, s.timestamp, s.latency "
+                    "FROM latency_seconds_staging AS s "
+                    "WHERE EXISTS (SELECT 1 FROM monitor AS m WHERE m.monitor_id = s.monitor_id) AND "
+                          "EXISTS (SELECT 1 FROM servers AS v WHERE v.server_id = s.server_id) "
+                "ON CONFLICT DO NOTHING"
+            );
+
+            if (!success) {
+                logWrite(
+                    QString("Failed merge from staging table: %1 -- retrying").arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed COPY into staging table: %1 -- retrying").arg(PQerrorMessage(connection)),
+                true
+            );
+        }
+    } else {
+        logWrite(QString("Failed to start COPY: %1 -- retrying").arg(PQerrorMessage(connection)), true);
+    }
+
+    return success;
+}
+
+
+bool LatencyInterface::insertEntries(
+        QSqlDatabase&                database,
+        const IdRegistry::Snapshot&  validIds,
+        const LatencyEntryChunkList& entries,
+        unsigned long                baseIndex,
+        unsigned long                count
+    ) {
+    static const QString queryPrefix(
+        "INSERT INTO latency_seconds (monitor_id, server_id, timestamp, latency) VALUES "
+    );
+    static const QString querySuffix(" ON CONFLICT DO NOTHING");
+
+    bool          success  = true;
+    unsigned long endIndex = baseIndex + count;
+    unsigned long index    = baseIndex;
+
+    QSqlQuery query(database);
+    while (success && index < endIndex) {
+        QString       queryString = queryPrefix;
+        unsigned long numberRows  = 0;
+        while (index < endIndex && numberRows < maximumRowsPerStatement) {
+            const LatencyEntry& latencyEntry = entries.at(index);
+
+            LatencyEntry::MonitorId           monitorId           = latencyEntry.monitorId();
+            LatencyEntry::ServerId            serverId            = latencyEntry.serverId();
+            LatencyEntry::LatencyMicroseconds latencyMicroseconds = latencyEntry.latencyMicroseconds();
+
+            if (latencyMicroseconds <= LatencyEntry::maximumAllowedLatencyMicroseconds &&
+                validIds.containsMonitor(monitorId)                                    &&
+                validIds.containsServer(serverId)                                         ) {
+                if (numberRows > 0) {
+                    queryString += QChar(',');
+                }
+
+                queryString += QString("(%1,%2,%3,%4)")
+                               .arg(monitorId)
+                               .arg(serverId)
+                               .arg(latencyEntry.zoranTimestamp())
+                               .arg(latencyMicroseconds);
+
+                ++numberRows;
+            }
+
+            ++index;
+        }
+
+        if (numberRows > 0) {
+            queryString += querySuffix;
+            success = SqlHelpers::execute(query, queryString);
+            if (!success) {
+                logWrite(
+                    QString("Failed multi-row insert of %1 rows: %2 -- retrying")
+                    .arg(numberRows)
+                    .arg(query.lastError().text()),
+                    true
+                );
+            }
+        }
+    }
+
+    return success;
+}
+
+
+bool LatencyInterface::insertBlocks(
+        QSqlDatabase&                database,
+        const IdRegistry::Snapshot&  validIds,
+        const LatencyEntryChunkList& entries,
+        unsigned long                baseIndex,
+        unsigned long                count
+    ) {
+    static const QString queryPrefix(
+        "INSERT INTO latency_blocks (monitor_id, server_id, timestamp, samples) VALUES "
+    );
+    static const QString querySuffix(
+        " ON CONFLICT (monitor_id, server_id, timestamp) DO UPDATE SET "
+            "samples = latency_blocks.samples || EXCLUDED.samples"
+    );
+
+    // Keys are visited in order so concurrent writers always lock rows in the same order.
+    QMap<BlockKey, LatencyBlock::SampleList> samplesByBlock;
+
+    unsigned long endIndex = baseIndex + count;
+    for (unsigned long index=baseIndex ; index<endIndex ; ++index) {
+        const LatencyEntry& latencyEntry = entries.at(index);
+
+        MonitorId           monitorId           = latencyEntry.monitorId();
+        ServerId            serverId            = latencyEntry.serverId();
+        LatencyMicroseconds latencyMicroseconds = latencyEntry.latencyMicroseconds();
+
+        if (latencyMicroseconds <= LatencyEntry::maximumAllowedLatencyMicroseconds &&
+            validIds.containsMonitor(monitorId)                                    &&
+            validIds.containsServer(serverId)                                         ) {
+            LatencyBlock::Sample sample;
+            sample.timestamp = latencyEntry.zoranTimestamp();
+            sample.latency   = latencyMicroseconds;
+
+            BlockKey blockKey(monitorId, serverId, LatencyBlock::blockTimestamp(sample.timestamp));
+            samplesByBlock[blockKey].append(sample);
+        }
+    }
+
+    bool      success = true;
+    QSqlQuery query(database);
+
+    QMap<BlockKey, LatencyBlock::SampleList>::const_iterator it  = samplesByBlock.constBegin();
+    QMap<BlockKey, LatencyBlock::SampleList>::const_iterator end = samplesByBlock.constEnd();
+    while (success && it != end) {
+        QString       queryString = queryPrefix;
+        unsigned long numberRows  = 0;
+        while (it != end && numberRows < maximumRowsPerStatement) {
+            const BlockKey& blockKey = it.key();
+
+            if (numberRows > 0) {
+                queryString += QChar(',');
+            }
+
+            queryString += QString("(%1,%2,%3,'\\x%4'::BYTEA)")
+                           .arg(blockKey.monitorId)
+                           .arg(blockKey.serverId)
+                           .arg(blockKey.blockTimestamp)
+                           .arg(QString::fromLatin1(LatencyBlock::encode(it.value()).toHex()));
+
+            ++numberRows;
+            ++it;
+        }
+
+        queryString += querySuffix;
+        success = SqlHelpers::execute(query, queryString);
+        if (!success) {
+            logWrite(
+                QString("Failed multi-row upsert of %1 latency blocks: %2 -- retrying")
+                .arg(numberRows)
+                .arg(query.lastError().text()),
+                true
+            );
+        }
+    }
+
+    return success;
 }
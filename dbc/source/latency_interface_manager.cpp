@@ -21,8 +21,13 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicPointer>
+#include <QDir>
+#include <QDateTime>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QVariant>
@@ -30,6 +35,8 @@
 #include <QSqlRecord>
 
 #include <cstdint>
+#include <limits>
+#include <algorithm>
 
 #include "log.h"
 #include "database_manager.h"
@@ -40,42 +47,2104 @@
 #include "region.h"
 #include "latency_interface.h"
 #include "latency_aggregator.h"
+#include "latency_purger.h"
+#include "latency_archive.h"
+#include "latency_sketch.h"
+#include "latency_block.h"
+#include "latency_ring_buffer.h"
+#include "latency_rolling_statistics.h"
+#include "latency_deduplicator.h"
+#include "latency_populations.h"
+#include "catalog.h"
+#include "query_executor.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
+#include "typed_result_set.h"
+#include "memory_governor.h"
 #include "latency_interface_manager.h"
 
-LatencyInterfaceManager::LatencyInterfaceManager(DatabaseManager* databaseManager, QObject* parent):QObject(parent) {
+/***********************************************************************************************************************
+* LatencyInterfaceManager::Bucket::Key
+*/
+
+LatencyInterfaceManager::Bucket::Key::Key(
+        LatencyEntry::MonitorId monitorId,
+        LatencyEntry::ServerId  serverId,
+        unsigned long long      index
+    ) {
+    this->monitorId = monitorId;
+    this->serverId  = serverId;
+    this->index     = index;
+}
+
+
+bool LatencyInterfaceManager::Bucket::Key::operator<(const Key& other) const {
+    return (
+           monitorId < other.monitorId
+        || (monitorId == other.monitorId && serverId < other.serverId)
+        || (monitorId == other.monitorId && serverId == other.serverId && index < other.index)
+    );
+}
+
+/***********************************************************************************************************************
+* LatencyInterfaceManager::Bucket
+*/
+
+LatencyInterfaceManager::Bucket::Bucket() {
+    numberSamples        = 0;
+    meanLatency          = 0;
+    sumSquaredDeviations = 0;
+    minimumLatency       = std::numeric_limits<LatencyEntry::LatencyMicroseconds>::max();
+    maximumLatency       = 0;
+}
+
+
+void LatencyInterfaceManager::Bucket::add(
+        double                            meanLatency,
+        double                            varianceLatency,
+        LatencyEntry::LatencyMicroseconds minimumLatency,
+        LatencyEntry::LatencyMicroseconds maximumLatency,
+        unsigned long long                numberSamples
+    ) {
+    if (numberSamples > 0) {
+        // Sub-populations are combined pairwise, see Chan et al., so large counts do not lose precision.
+        double             delta         = meanLatency - this->meanLatency;
+        unsigned long long totalSamples  = this->numberSamples + numberSamples;
+        double             weight        = static_cast<double>(numberSamples) / totalSamples;
+
+        sumSquaredDeviations += (
+              varianceLatency * numberSamples
+            + delta * delta * this->numberSamples * weight
+        );
+
+        this->meanLatency   += delta * weight;
+        this->numberSamples  = totalSamples;
+
+        this->minimumLatency = std::min(this->minimumLatency, minimumLatency);
+        this->maximumLatency = std::max(this->maximumLatency, maximumLatency);
+    }
+}
+
+/***********************************************************************************************************************
+* LatencyInterfaceManager::RawQueryJob
+*/
+
+LatencyInterfaceManager::RawQueryJob::RawQueryJob(
+        LatencyInterfaceManager*         manager,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        bool                             statistics,
+        bool                             includeSketch
+    ):currentManager(
+        manager
+    ),currentCustomerId(
+        customerId
+    ),currentHostSchemeId(
+        hostSchemeId
+    ),currentMonitorId(
+        monitorId
+    ),currentRegionId(
+        regionId
+    ),currentServerId(
+        serverId
+    ),currentStartTimestamp(
+        startTimestamp
+    ),currentEndTimestamp(
+        endTimestamp
+    ),currentStatistics(
+        statistics
+    ),currentIncludeSketch(
+        includeSketch
+    ),currentSuccess(
+        false
+    ) {}
+
+
+LatencyInterfaceManager::RawQueryJob::~RawQueryJob() {}
+
+
+void LatencyInterfaceManager::RawQueryJob::run() {
+    QSqlDatabase database = currentManager->currentDatabaseManager->getReadDatabase(QString("RawQuery"));
+    bool success = database.isOpen();
+    if (success) {
+        bool blockStorage = (currentManager->currentBlockStorage.loadAcquire() != 0);
+        if (currentStatistics && blockStorage) {
+            currentStatisticsEntry = currentManager->getBlockEntryStatistics(
+                success,
+                database,
+                currentCustomerId,
+                currentHostSchemeId,
+                currentMonitorId,
+                currentRegionId,
+                currentServerId,
+                currentStartTimestamp,
+                currentEndTimestamp,
+                currentIncludeSketch ? &currentSketch : nullptr
+            );
+        } else if (currentStatistics) {
+            currentStatisticsEntry = currentManager->getRawEntryStatistics(
+                success,
+                database,
+                currentCustomerId,
+                currentHostSchemeId,
+                currentMonitorId,
+                currentRegionId,
+                currentServerId,
+                currentStartTimestamp,
+                currentEndTimestamp
+            );
+
+            if (success && currentIncludeSketch) {
+                currentManager->getRawEntrySketch(
+                    success,
+                    database,
+                    currentCustomerId,
+                    currentHostSchemeId,
+                    currentMonitorId,
+                    currentRegionId,
+                    currentServerId,
+                    currentStartTimestamp,
+                    currentEndTimestamp,
+                    currentSketch
+                );
+            }
+        } else if (blockStorage) {
+            currentEntries = currentManager->getBlockEntries(
+                success,
+                database,
+                currentCustomerId,
+                currentHostSchemeId,
+                currentMonitorId,
+                currentRegionId,
+                currentServerId,
+                currentStartTimestamp,
+                currentEndTimestamp
+            );
+        } else {
+            currentEntries = currentManager->getRawEntries(
+                success,
+                database,
+                currentCustomerId,
+                currentHostSchemeId,
+                currentMonitorId,
+                currentRegionId,
+                currentServerId,
+                currentStartTimestamp,
+                currentEndTimestamp
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyInterfaceManager::RawQueryJob: %1")
+            .arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentManager->currentDatabaseManager->closeAndRelease(database);
+    currentSuccess = success;
+}
+
+
+bool LatencyInterfaceManager::RawQueryJob::succeeded() const {
+    return currentSuccess;
+}
+
+
+const LatencyInterfaceManager::LatencyEntryList& LatencyInterfaceManager::RawQueryJob::entries() const {
+    return currentEntries;
+}
+
+
+const AggregatedLatencyEntry& LatencyInterfaceManager::RawQueryJob::statistics() const {
+    return currentStatisticsEntry;
+}
+
+
+const LatencySketch& LatencyInterfaceManager::RawQueryJob::sketch() const {
+    return currentSketch;
+}
+
+/***********************************************************************************************************************
+* LatencyInterfaceManager
+*/
+
+LatencyInterfaceManager::LatencyInterfaceManager(
+        DatabaseManager* databaseManager,
+        IdRegistry*      idRegistry,
+        Catalog*         catalog,
+        QObject*         parent
+    ):QObject(
+        parent
+    ) {
     currentDatabaseManager   = databaseManager;
+    currentIdRegistry        = idRegistry;
+    currentCatalog           = catalog;
     currentLatencyAggregator = new LatencyAggregator(databaseManager, this);
+    currentLatencyPurger     = new LatencyPurger(databaseManager, this);
+    currentLatencyArchive    = new LatencyArchive(databaseManager, this);
+    currentQueryExecutor     = new QueryExecutor(this);
+    currentFlushBatchSize      = LatencyInterface::defaultFlushBatchSize;
+    currentFlushMaximumEntries = LatencyInterface::defaultFlushMaximumEntries;
+    currentFlushMaximumBytes   = LatencyInterface::defaultFlushMaximumBytes;
+    currentFlushMaximumAge     = LatencyInterface::defaultFlushMaximumAge;
+    currentIngestHighWatermark = LatencyInterface::defaultIngestHighWatermark;
+    currentIngestLowWatermark  = LatencyInterface::defaultIngestLowWatermark;
+    currentDefaultNumberWriters     = 1;
+    currentDeduplicationCapacity    = LatencyDeduplicator::defaultCapacity;
+    currentAggregationAge           = 0;
+    currentResamplePeriod           = 0;
+    currentIngestRollupsEnabled     = false;
+    currentAggregationEnabled       = true;
+    currentExpungePeriod            = 0;
+    currentInputAggregated          = false;
+    currentRollupCoverageStart      = 0;
+    currentNumberAggregationWorkers = LatencyAggregator::defaultNumberWorkers;
+    currentDataVersion              = 0;
+    currentAggregationDataVersion   = 0;
+    currentUnattributedDataVersion  = 0;
+
+    currentBlockStorage.storeRelease(0);
+
+    connect(
+        currentLatencyAggregator,
+        &LatencyAggregator::aggregationFinished,
+        this,
+        &LatencyInterfaceManager::aggregationFinished
+    );
+
+    for (unsigned slot=0 ; slot<numberRegionSlots ; ++slot) {
+        dataInterfacesBySlot[slot].storeRelease(nullptr);
+    }
+
+    resultCacheConsumerId = MemoryGovernor::instance()->registerConsumer(
+        QString("latency_result_cache"),
+        [this]() {
+            return currentResultCache.memoryUsage();
+        },
+        [this](MemoryGovernor::Stage stage) {
+            currentResultCache.setMemoryPressure(stage >= MemoryGovernor::Stage::SHRINK_CACHES);
+        }
+    );
+}
+
+
+LatencyInterfaceManager::~LatencyInterfaceManager() {
+    MemoryGovernor::instance()->unregisterConsumer(resultCacheConsumerId);
+
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        LatencyInterface* dataInterface = it.value();
+        delete dataInterface;
+    }
+}
+
+
+LatencyInterface* LatencyInterfaceManager::getLatencyInterface(RegionId regionId) {
+    LatencyInterface* dataInterfaceForRegion = dataInterfacesBySlot[regionId].loadAcquire();
+    if (dataInterfaceForRegion == nullptr) {
+        QMutexLocker accessMutexLocker(&accessMutex);
+
+        dataInterfaceForRegion = dataInterfacesByRegion.value(regionId, nullptr);
+        if (dataInterfaceForRegion == nullptr) {
+            dataInterfaceForRegion = new LatencyInterface(
+                currentDatabaseManager,
+                currentIdRegistry,
+                &currentRingBuffer,
+                &currentRollingStatistics,
+                &currentServerHealth,
+                regionId
+            );
+            connect(
+                dataInterfaceForRegion,
+                &LatencyInterface::entriesWritten,
+                this,
+                &LatencyInterfaceManager::entriesWritten,
+                Qt::DirectConnection
+            );
+            dataInterfaceForRegion->setFlushBatchSize(currentFlushBatchSize);
+            dataInterfaceForRegion->setDeduplicationCapacity(currentDeduplicationCapacity);
+            dataInterfaceForRegion->setFlushThresholds(
+                currentFlushMaximumEntries,
+                currentFlushMaximumBytes,
+                currentFlushMaximumAge
+            );
+            dataInterfaceForRegion->setIngestWatermarks(currentIngestHighWatermark, currentIngestLowWatermark);
+            dataInterfaceForRegion->setNumberWriters(
+                currentNumberWritersByRegion.value(regionId, currentDefaultNumberWriters)
+            );
+            dataInterfaceForRegion->setRollupParameters(
+                currentIngestRollupsEnabled ? currentResamplePeriod : 0,
+                currentAggregationAge,
+                currentRollupCoverageStart
+            );
+            dataInterfaceForRegion->setBlockStorage(currentBlockStorage.loadAcquire() != 0);
+            dataInterfaceForRegion->moveToThread(thread());
+
+            if (!currentSpoolDirectory.isEmpty()) {
+                dataInterfaceForRegion->enableSpool(
+                    QDir(currentSpoolDirectory).absoluteFilePath(QString("region_%1").arg(regionId))
+                );
+            }
+
+            dataInterfacesByRegion.insert(regionId, dataInterfaceForRegion);
+            dataInterfacesBySlot[regionId].storeRelease(dataInterfaceForRegion);
+        }
+    }
+
+    return dataInterfaceForRegion;
+}
+
+
+LatencyInterfaceManager::LatencyEntryLists LatencyInterfaceManager::getLatencyEntries(
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        unsigned                         threadId,
+        unsigned long                    resolution
+    ) {
+    RequestTracer::Span cacheSpan(RequestTracer::Phase::CACHE, threadId);
+    LatencyEntryLists   result;
+
+    QByteArray key = QString("%1,%2,%3,%4,%5,%6,%7,%8")
+                     .arg(customerId)
+                     .arg(hostSchemeId)
+                     .arg(monitorId)
+                     .arg(regionId)
+                     .arg(serverId)
+                     .arg(startTimestamp)
+                     .arg(endTimestamp)
+                     .arg(resolution)
+                     .toUtf8();
+
+    // The version is read before the query so data written while the query runs invalidates the result.
+    unsigned long long version = resultDataVersion(customerId, monitorId);
+    if (!currentResultCache.startQuery(key, version, result)) {
+        RequestTracer::Span databaseSpan(RequestTracer::Phase::DATABASE, threadId);
+
+        bool success;
+        result = readLatencyEntries(
+            success,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            threadId,
+            resolution
+        );
+
+        currentResultCache.finishQuery(key, version, success ? &result : nullptr);
+    }
+
+    return result;
+}
+
+
+LatencyInterfaceManager::LatencyEntryLists LatencyInterfaceManager::readLatencyEntries(
+        bool&                            success,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        unsigned                         threadId,
+        unsigned long                    resolution
+    ) {
+    LatencyEntryList           rawEntries;
+    LatencyEntryList           recentEntries;
+    AggregatedLatencyEntryList aggregatedEntries;
+
+    // Recent raw entries are served from memory.  Only older raw entries are read from the database.
+    unsigned long long rawEndTimestamp = endTimestamp;
+    bool               readRawEntries  = !rawEntriesAggregated(endTimestamp);
+    if (readRawEntries) {
+        unsigned long long recentStart = getRecentEntries(
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            threadId,
+            recentEntries
+        );
+
+        if (recentStart <= startTimestamp) {
+            readRawEntries = false;
+        } else if (recentStart <= endTimestamp) {
+            rawEndTimestamp = recentStart - 1;
+        }
+    }
+
+    // The raw entries are read on a query worker, over its own connection, while we read the aggregated entries.
+    RawQueryJob rawQueryJob(
+        this,
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        rawEndTimestamp,
+        false,
+        false
+    );
+
+    if (readRawEntries) {
+        currentQueryExecutor->enqueue(&rawQueryJob);
+    }
+
+    QSqlDatabase database = currentDatabaseManager->getReadDatabase(QString::number(threadId));
+    success = database.isOpen();
+    if (success) {
+        getTieredAggregatedData(
+            success,
+            database,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            resolution,
+            &aggregatedEntries,
+            nullptr,
+            nullptr
+        );
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyInterfaceManager::readLatencyEntries: %1")
+            .arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    if (readRawEntries) {
+        rawQueryJob.waitForCompletion();
+
+        success    = rawQueryJob.succeeded() && success;
+        rawEntries = rawQueryJob.entries();
+    }
+
+    rawEntries.append(recentEntries);
+
+    if (!success) {
+        rawEntries.clear();
+        aggregatedEntries.clear();
+    }
+
+    return LatencyEntryLists(rawEntries, aggregatedEntries);
+}
+
+
+LatencyInterfaceManager::AggregatedLatencyEntryList LatencyInterfaceManager::getLatencyBuckets(
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        unsigned long                    resolution,
+        unsigned long                    maximumPoints,
+        unsigned                         threadId,
+        unsigned long*                   interval
+    ) {
+    AggregatedLatencyEntryList result;
+
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+    unsigned long long windowEnd   = std::min(endTimestamp, currentTime);
+    unsigned long      bucketWidth = std::max(resolution, 1UL);
+
+    // With an open start, the interval width driven by the point limit is only known once the data has been read.
+    if (maximumPoints > 0 && startTimestamp > 0 && windowEnd > startTimestamp) {
+        unsigned long long span = windowEnd - startTimestamp + 1;
+        bucketWidth = static_cast<unsigned long>(
+            std::max(static_cast<unsigned long long>(bucketWidth), (span + maximumPoints - 1) / maximumPoints)
+        );
+    }
+
+    LatencyEntryLists entries = getLatencyEntries(
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        threadId,
+        bucketWidth
+    );
+
+    const LatencyEntryList&           rawEntries        = entries.first;
+    const AggregatedLatencyEntryList& aggregatedEntries = entries.second;
+
+    LatencyEntry::ZoranTimeStamp origin = toZoranTimestamp(startTimestamp);
+    if (startTimestamp == 0) {
+        origin = std::numeric_limits<LatencyEntry::ZoranTimeStamp>::max();
+        for (  AggregatedLatencyEntryList::const_iterator it  = aggregatedEntries.constBegin(),
+                                                          end = aggregatedEntries.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            origin = std::min(origin, it->zoranTimestamp());
+        }
+
+        for (LatencyEntryList::const_iterator it=rawEntries.constBegin(),end=rawEntries.constEnd() ; it!=end ; ++it) {
+            origin = std::min(origin, it->zoranTimestamp());
+        }
+
+        if (maximumPoints > 0 && LatencyEntry::toUnixTimestamp(origin) < windowEnd) {
+            unsigned long long span = windowEnd - LatencyEntry::toUnixTimestamp(origin) + 1;
+            bucketWidth = static_cast<unsigned long>(
+                std::max(static_cast<unsigned long long>(bucketWidth), (span + maximumPoints - 1) / maximumPoints)
+            );
+        }
+    }
+
+    QMap<Bucket::Key, Bucket> buckets;
+    for (  AggregatedLatencyEntryList::const_iterator it  = aggregatedEntries.constBegin(),
+                                                      end = aggregatedEntries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (it->zoranTimestamp() >= origin) {
+            Bucket::Key key(it->monitorId(), it->serverId(), (it->zoranTimestamp() - origin) / bucketWidth);
+            buckets[key].add(
+                it->meanLatency(),
+                it->varianceLatency(),
+                it->minimumLatency(),
+                it->maximumLatency(),
+                it->numberSamples()
+            );
+        }
+    }
+
+    for (LatencyEntryList::const_iterator it=rawEntries.constBegin(),end=rawEntries.constEnd() ; it!=end ; ++it) {
+        if (it->zoranTimestamp() >= origin) {
+            Bucket::Key key(it->monitorId(), it->serverId(), (it->zoranTimestamp() - origin) / bucketWidth);
+            buckets[key].add(it->latencyMicroseconds(), 0, it->latencyMicroseconds(), it->latencyMicroseconds(), 1);
+        }
+    }
+
+    result.reserve(buckets.size());
+    for (QMap<Bucket::Key, Bucket>::const_iterator it=buckets.constBegin(),end=buckets.constEnd() ; it!=end ; ++it) {
+        const Bucket::Key& key         = it.key();
+        const Bucket&      bucket      = it.value();
+        unsigned long long bucketStart = origin + key.index * bucketWidth;
+        unsigned long long bucketEnd   = std::min(
+            bucketStart + bucketWidth,
+            static_cast<unsigned long long>(std::numeric_limits<LatencyEntry::ZoranTimeStamp>::max())
+        );
+
+        result.append(
+            AggregatedLatencyEntry(
+                key.monitorId,
+                key.serverId,
+                static_cast<LatencyEntry::ZoranTimeStamp>(bucketStart),
+                static_cast<LatencyEntry::LatencyMicroseconds>(bucket.meanLatency + 0.5),
+                static_cast<LatencyEntry::ZoranTimeStamp>(bucketStart),
+                static_cast<LatencyEntry::ZoranTimeStamp>(bucketEnd),
+                bucket.meanLatency,
+                bucket.numberSamples > 0 ? bucket.sumSquaredDeviations / bucket.numberSamples : 0,
+                bucket.minimumLatency,
+                bucket.maximumLatency,
+                static_cast<unsigned long>(bucket.numberSamples)
+            )
+        );
+    }
+
+    if (interval != nullptr) {
+        *interval = bucketWidth;
+    }
+
+    return result;
+}
+
+
+AggregatedLatencyEntry LatencyInterfaceManager::getLatencyStatistics(
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        unsigned                         threadId,
+        LatencySketch*                   latencySketch
+    ) {
+    AggregatedLatencyEntry result;
+
+    // The raw statistics are read on a query worker, over its own connection, while we read the aggregated populations.
+    bool        readRawEntries = !rawEntriesAggregated(endTimestamp);
+    RawQueryJob rawQueryJob(
+        this,
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        true,
+        latencySketch != nullptr
+    );
+
+    if (readRawEntries) {
+        currentQueryExecutor->enqueue(&rawQueryJob);
+    }
+
+    LatencyPopulations populations;
+
+    QSqlDatabase database = currentDatabaseManager->getReadDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        accessMutex.lock();
+        unsigned numberTiers = static_cast<unsigned>(tierAggregationAges.size());
+        accessMutex.unlock();
+
+        getSpanningAggregatedData(
+            success,
+            database,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            numberTiers,
+            populations,
+            latencySketch
+        );
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyInterfaceManager::getLatencyStatistics: %1")
+            .arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    AggregatedLatencyEntry rawEntryStatistics;
+    if (readRawEntries) {
+        rawQueryJob.waitForCompletion();
+
+        success            = rawQueryJob.succeeded() && success;
+        rawEntryStatistics = rawQueryJob.statistics();
+
+        if (success && latencySketch != nullptr) {
+            latencySketch->merge(rawQueryJob.sketch());
+        }
+    }
+
+    if (success) {
+        if (populations.isEmpty()) {
+            result = rawEntryStatistics;
+        } else {
+            if (rawEntryStatistics.numberSamples() > 0) {
+                populations.append(rawEntryStatistics);
+            }
+
+            LatencyPopulations::Summary summary = populations.combine();
+            result = AggregatedLatencyEntry(
+                monitorId,
+                serverId,
+                0,
+                0,
+                LatencyEntry::toZoranTimestamp(startTimestamp),
+                LatencyEntry::toZoranTimestamp(endTimestamp),
+                summary.meanLatency,
+                summary.varianceLatency,
+                summary.minimumLatency,
+                summary.maximumLatency,
+                static_cast<unsigned long>(summary.numberSamples)
+            );
+        }
+    }
+
+    return result;
+}
+
+
+LatencyInterfaceManager::LatencyStatisticsByMonitorId LatencyInterfaceManager::getBulkLatencyStatistics(
+        CustomerCapabilities::CustomerId             customerId,
+        const LatencyInterfaceManager::MonitorIdSet& monitorIds,
+        Region::RegionId                             regionId,
+        Server::ServerId                             serverId,
+        unsigned long long                           startTimestamp,
+        unsigned long long                           endTimestamp,
+        unsigned                                     threadId,
+        bool*                                        success
+    ) {
+    LatencyStatisticsByMonitorId result;
+    BucketsByMonitorId           buckets;
+
+    bool succeeded = (customerId != CustomerCapabilities::invalidCustomerId);
+    if (succeeded) {
+        QSqlDatabase database = currentDatabaseManager->getReadDatabase(QString::number(threadId));
+        succeeded = database.isOpen();
+        if (succeeded) {
+            accessMutex.lock();
+            unsigned numberTiers = static_cast<unsigned>(tierAggregationAges.size());
+            accessMutex.unlock();
+
+            getSpanningGroupedStatistics(
+                succeeded,
+                database,
+                customerId,
+                monitorIds,
+                regionId,
+                serverId,
+                startTimestamp,
+                endTimestamp,
+                numberTiers,
+                buckets
+            );
+
+            if (succeeded && !rawEntriesAggregated(endTimestamp)) {
+                getGroupedRawEntryStatistics(
+                    succeeded,
+                    database,
+                    customerId,
+                    monitorIds,
+                    regionId,
+                    serverId,
+                    startTimestamp,
+                    endTimestamp,
+                    buckets
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed to open database - LatencyInterfaceManager::getBulkLatencyStatistics: %1")
+                .arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    } else {
+        logWrite(QString("Invalid customer ID - LatencyInterfaceManager::getBulkLatencyStatistics."), true);
+    }
+
+    if (succeeded) {
+        result.reserve(buckets.size());
+        for (BucketsByMonitorId::const_iterator it=buckets.constBegin(),end=buckets.constEnd() ; it!=end ; ++it) {
+            const Bucket& bucket = it.value();
+            if (bucket.numberSamples > 0) {
+                result.insert(
+                    it.key(),
+                    AggregatedLatencyEntry(
+                        it.key(),
+                        serverId,
+                        0,
+                        0,
+                        LatencyEntry::toZoranTimestamp(startTimestamp),
+                        LatencyEntry::toZoranTimestamp(endTimestamp),
+                        bucket.meanLatency,
+                        bucket.sumSquaredDeviations / bucket.numberSamples,
+                        bucket.minimumLatency,
+                        bucket.maximumLatency,
+                        static_cast<unsigned long>(bucket.numberSamples)
+                    )
+                );
+            }
+        }
+    }
+
+    if (success != nullptr) {
+        *success = succeeded;
+    }
+
+    return result;
+}
+
+
+LatencyInterfaceManager::RollingStatisticsByMonitorId LatencyInterfaceManager::getRollingStatistics(
+        CustomerCapabilities::CustomerId             customerId,
+        const LatencyInterfaceManager::MonitorIdSet& monitorIds,
+        Server::ServerId                             serverId,
+        LatencyRollingStatistics::Window             window,
+        unsigned                                     threadId,
+        bool*                                        success
+    ) {
+    RollingStatisticsByMonitorId result;
+
+    bool succeeded = (customerId != CustomerCapabilities::invalidCustomerId);
+    if (succeeded) {
+        Catalog::SnapshotPointer snapshot = currentCatalog->snapshot(threadId);
+        succeeded = snapshot->isLoaded();
+        if (succeeded) {
+            Catalog::MonitorsById                  monitors = snapshot->monitorsByCustomerId(customerId);
+            LatencyRollingStatistics::MonitorIdSet customerMonitorIds;
+            for (  Catalog::MonitorsById::const_iterator it = monitors.constBegin(), end = monitors.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                if (monitorIds.isEmpty() || monitorIds.contains(it.key())) {
+                    customerMonitorIds.insert(it.key());
+                }
+            }
+
+            result = currentRollingStatistics.summaries(&customerMonitorIds, serverId, window);
+        } else {
+            logWrite(QString("Catalog not loaded - LatencyInterfaceManager::getRollingStatistics."), true);
+        }
+    } else {
+        logWrite(QString("Invalid customer ID - LatencyInterfaceManager::getRollingStatistics."), true);
+    }
+
+    if (success != nullptr) {
+        *success = succeeded;
+    }
+
+    return result;
+}
+
+
+unsigned long long LatencyInterfaceManager::dataVersion(LatencyEntry::MonitorId monitorId) const {
+    QMutexLocker dataVersionLocker(&dataVersionMutex);
+
+    unsigned long long result;
+    if (monitorId == Monitor::invalidMonitorId) {
+        result = currentDataVersion;
+    } else {
+        result = std::max(monitorDataVersions.value(monitorId, 0), currentAggregationDataVersion);
+    }
+
+    return result;
+}
+
+
+unsigned long long LatencyInterfaceManager::resultDataVersion(
+        CustomerCapabilities::CustomerId customerId,
+        LatencyEntry::MonitorId          monitorId
+    ) const {
+    QMutexLocker dataVersionLocker(&dataVersionMutex);
+
+    unsigned long long result;
+    if (monitorId != Monitor::invalidMonitorId) {
+        result = std::max(monitorDataVersions.value(monitorId, 0), currentAggregationDataVersion);
+    } else if (customerId != CustomerCapabilities::invalidCustomerId) {
+        result = std::max(
+            customerDataVersions.value(customerId, 0),
+            std::max(currentAggregationDataVersion, currentUnattributedDataVersion)
+        );
+    } else {
+        result = currentDataVersion;
+    }
+
+    return result;
+}
+
+
+void LatencyInterfaceManager::addEntry(
+        RegionId                          regionId,
+        LatencyEntry::MonitorId           monitorId,
+        LatencyEntry::ServerId            serverId,
+        LatencyEntry::ZoranTimeStamp      zoranTimestamp,
+        LatencyEntry::LatencyMicroseconds latencyMicroseconds
+    ) {
+    LatencyInterface* latencyInterface = getLatencyInterface(regionId);
+    latencyInterface->addEntry(monitorId, serverId, zoranTimestamp, latencyMicroseconds);
+    latencyInterface->receivedEntries();
+}
+
+
+void LatencyInterfaceManager::addEntry(RegionId regionId, const LatencyEntry& latencyEntry) {
+    LatencyInterface* latencyInterface = getLatencyInterface(regionId);
+    latencyInterface->addEntry(latencyEntry);
+    latencyInterface->receivedEntries();
+}
+
+
+void LatencyInterfaceManager::addEntries(RegionId regionId, const LatencyInterface::LatencyEntryList& latencyEntries) {
+    LatencyInterface* latencyInterface = getLatencyInterface(regionId);
+    latencyInterface->addEntries(latencyEntries);
+    latencyInterface->receivedEntries();
+}
+
+
+bool LatencyInterfaceManager::deleteByCustomerId(
+        const CustomersCapabilities::CustomerIdSet& customerIds,
+        unsigned                                    threadId
+    ) {
+    bool success = currentLatencyAggregator->deleteByCustomerId(customerIds, threadId);
+
+    QMutexLocker accessMutexLocker(&accessMutex);
+    for (  QList<LatencyAggregator*>::const_iterator it  = tierAggregators.constBegin(),
+                                                     end = tierAggregators.constEnd()
+         ; it != end && success
+         ; ++it
+        ) {
+        success = (*it)->deleteByCustomerId(customerIds, threadId);
+    }
+
+    aggregationFinished();
+
+    return success;
+}
+
+
+LatencyPurger::JobId LatencyInterfaceManager::startPurge(
+        const CustomersCapabilities::CustomerIdSet& customerIds,
+        unsigned                                    threadId
+    ) {
+    QStringList tableNames;
+    tableNames.append(currentLatencyAggregator->inputTableName());
+    tableNames.append(currentLatencyAggregator->outputTableName());
+
+    accessMutex.lock();
+    for (  AggregationTierList::const_iterator it  = currentAggregationTiers.constBegin(),
+                                               end = currentAggregationTiers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        tableNames.append(it->tableName);
+    }
+    accessMutex.unlock();
+
+    return currentLatencyPurger->startPurge(customerIds, tableNames, threadId);
+}
+
+
+bool LatencyInterfaceManager::getPurgeStatus(
+        LatencyPurger::JobId      jobId,
+        LatencyPurger::JobStatus& jobStatus,
+        unsigned                  threadId
+    ) {
+    return currentLatencyPurger->getJobStatus(jobId, jobStatus, threadId);
+}
+
+
+void LatencyInterfaceManager::setPurgeThrottle(unsigned long batchSize, unsigned long rowsPerSecond) {
+    currentLatencyPurger->setThrottle(batchSize, rowsPerSecond);
+    currentLatencyPurger->resumeJobs();
+}
+
+
+void LatencyInterfaceManager::setParameters(
+        unsigned long  inputTableMaximumAge,
+        unsigned long  resamplePeriod,
+        unsigned long  expungePeriod,
+        bool           inputAggregated
+    ) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    bool periodsChanged = (inputTableMaximumAge != currentAggregationAge || resamplePeriod != currentResamplePeriod);
+
+    currentAggregationAge  = inputTableMaximumAge;
+    currentResamplePeriod  = resamplePeriod;
+    currentExpungePeriod   = expungePeriod;
+    currentInputAggregated = inputAggregated;
+
+    currentLatencyArchive->setExpungeAge(expungePeriod);
+    applyAggregatorParameters();
+
+    if (periodsChanged) {
+        currentRollupCoverageStart = 0;
+
+        applyRollupParameters();
+        applyAggregationTiers();
+    }
+}
+
+
+void LatencyInterfaceManager::setIngestRollups(bool enabled) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    if (enabled != currentIngestRollupsEnabled) {
+        currentIngestRollupsEnabled = enabled;
+        currentRollupCoverageStart  = 0;
+
+        applyRollupParameters();
+    }
+}
+
+
+void LatencyInterfaceManager::setBlockStorage(bool enabled) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    if (enabled != (currentBlockStorage.loadAcquire() != 0)) {
+        currentBlockStorage.storeRelease(enabled ? 1 : 0);
+
+        for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                                  end = dataInterfacesByRegion.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            it.value()->setBlockStorage(enabled);
+        }
+
+        // Blocks are aggregated whole so rollup coverage must start on a block boundary.
+        currentRollupCoverageStart = 0;
+
+        applyAggregatorParameters();
+        applyRollupParameters();
+    }
+}
+
+
+void LatencyInterfaceManager::setAggregationTiers(const AggregationTierList& aggregationTiers) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentAggregationTiers = aggregationTiers;
+    applyAggregationTiers();
+}
+
+
+void LatencyInterfaceManager::setNumberAggregationWorkers(unsigned numberWorkers) {
+    currentLatencyAggregator->setNumberWorkers(numberWorkers);
+
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentNumberAggregationWorkers = numberWorkers;
+    for (  QList<LatencyAggregator*>::const_iterator it  = tierAggregators.constBegin(),
+                                                     end = tierAggregators.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        (*it)->setNumberWorkers(numberWorkers);
+    }
+}
+
+
+void LatencyInterfaceManager::setNumberQueryWorkers(unsigned numberWorkers) {
+    currentQueryExecutor->setNumberWorkers(numberWorkers);
+}
+
+
+void LatencyInterfaceManager::setRecentRetention(unsigned long retentionSeconds) {
+    currentRingBuffer.setRetention(retentionSeconds);
+}
+
+
+void LatencyInterfaceManager::setRollingStatisticsEnabled(bool nowEnabled) {
+    currentRollingStatistics.setEnabled(nowEnabled);
+}
+
+
+LatencyRollingStatistics* LatencyInterfaceManager::rollingStatistics() {
+    return &currentRollingStatistics;
+}
+
+
+ServerHealthStatistics* LatencyInterfaceManager::serverHealth() {
+    return &currentServerHealth;
+}
+
+
+void LatencyInterfaceManager::setResultCache(unsigned long maximumCacheDepth, unsigned long timeToLiveMilliseconds) {
+    currentResultCache.resizeCache(maximumCacheDepth);
+    currentResultCache.setTimeToLive(timeToLiveMilliseconds);
+}
+
+
+CacheBase::Statistics LatencyInterfaceManager::resultCacheStatistics() const {
+    return currentResultCache.statistics();
+}
+
+
+void LatencyInterfaceManager::setPartitionPeriods(const PartitionPeriods& partitionPeriods) {
+    currentLatencyAggregator->setPartitionPeriods(partitionPeriods);
+
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentPartitionPeriods = partitionPeriods;
+    for (  QList<LatencyAggregator*>::const_iterator it  = tierAggregators.constBegin(),
+                                                     end = tierAggregators.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        (*it)->setPartitionPeriods(partitionPeriods);
+    }
+}
+
+
+void LatencyInterfaceManager::setArchive(const QString& directory, unsigned long archiveAge, unsigned numberShards) {
+    currentLatencyArchive->setParameters(directory, archiveAge, numberShards);
+    currentLatencyArchive->startArchive();
+}
+
+
+void LatencyInterfaceManager::setAggregationEnabled(bool nowEnabled) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentAggregationEnabled = nowEnabled;
+    currentLatencyAggregator->setEnabled(nowEnabled);
+
+    for (  QList<LatencyAggregator*>::const_iterator it  = tierAggregators.constBegin(),
+                                                     end = tierAggregators.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        (*it)->setEnabled(nowEnabled);
+    }
+}
+
+
+void LatencyInterfaceManager::setFlushBatchSize(unsigned long flushBatchSize) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentFlushBatchSize = flushBatchSize;
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        it.value()->setFlushBatchSize(flushBatchSize);
+    }
+}
+
+
+void LatencyInterfaceManager::setDeduplicationCapacity(unsigned long capacity) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentDeduplicationCapacity = capacity;
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        it.value()->setDeduplicationCapacity(capacity);
+    }
+}
+
+
+void LatencyInterfaceManager::setFlushThresholds(
+        unsigned long      maximumEntries,
+        unsigned long long maximumBytes,
+        unsigned long      maximumAge
+    ) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentFlushMaximumEntries = maximumEntries;
+    currentFlushMaximumBytes   = maximumBytes;
+    currentFlushMaximumAge     = maximumAge;
+
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        it.value()->setFlushThresholds(maximumEntries, maximumBytes, maximumAge);
+    }
+}
+
+
+void LatencyInterfaceManager::setIngestWatermarks(unsigned long highWatermark, unsigned long lowWatermark) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentIngestHighWatermark = highWatermark;
+    currentIngestLowWatermark  = lowWatermark;
+
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        it.value()->setIngestWatermarks(highWatermark, lowWatermark);
+    }
+}
+
+
+void LatencyInterfaceManager::setNumberWriters(
+        unsigned                     defaultNumberWriters,
+        const NumberWritersByRegion& numberWritersByRegion
+    ) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    currentDefaultNumberWriters  = defaultNumberWriters;
+    currentNumberWritersByRegion = numberWritersByRegion;
+
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        it.value()->setNumberWriters(numberWritersByRegion.value(it.key(), defaultNumberWriters));
+    }
+}
+
+
+void LatencyInterfaceManager::setSpoolDirectory(const QString& spoolDirectory) {
+    accessMutex.lock();
+
+    bool apply = dataInterfacesByRegion.isEmpty();
+    if (apply) {
+        currentSpoolDirectory = spoolDirectory;
+    } else if (spoolDirectory != currentSpoolDirectory) {
+        logWrite(QString("Latency spool directory change will take effect on restart."), false);
+    }
+
+    accessMutex.unlock();
+
+    if (apply && !spoolDirectory.isEmpty()) {
+        QStringList regionDirectories = QDir(spoolDirectory).entryList(
+            QStringList() << QString("region_*"),
+            QDir::Dirs | QDir::NoDotAndDotDot
+        );
+
+        for (  QStringList::const_iterator it  = regionDirectories.constBegin(),
+                                           end = regionDirectories.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            bool     ok;
+            unsigned regionId = it->mid(7).toUInt(&ok);
+            if (ok && regionId <= std::numeric_limits<RegionId>::max()) {
+                LatencyInterface* latencyInterface = getLatencyInterface(static_cast<RegionId>(regionId));
+                if (latencyInterface->hasPendingEntries()) {
+                    latencyInterface->receivedEntries();
+                }
+            }
+        }
+    }
+}
+
+
+void LatencyInterfaceManager::entriesWritten(const LatencyInterface::MonitorIdSet& monitorIds) {
+    Catalog::SnapshotPointer snapshot = currentCatalog->snapshot();
+
+    QMutexLocker dataVersionLocker(&dataVersionMutex);
+
+    ++currentDataVersion;
+    for (  LatencyInterface::MonitorIdSet::const_iterator it  = monitorIds.constBegin(),
+                                                          end = monitorIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        monitorDataVersions.insert(*it, currentDataVersion);
+
+        Catalog::MonitorsById::const_iterator monitorIterator = snapshot->monitorsById().constFind(*it);
+        if (monitorIterator != snapshot->monitorsById().constEnd()) {
+            customerDataVersions.insert(monitorIterator.value().customerId(), currentDataVersion);
+        } else {
+            currentUnattributedDataVersion = currentDataVersion;
+        }
+    }
+}
+
+
+void LatencyInterfaceManager::aggregationFinished() {
+    currentRingBuffer.expire();
+    currentRollingStatistics.expire();
+    currentServerHealth.expire();
+    currentLatencyArchive->startArchive();
+
+    QMutexLocker dataVersionLocker(&dataVersionMutex);
+
+    ++currentDataVersion;
+    currentAggregationDataVersion = currentDataVersion;
+}
+
+
+void LatencyInterfaceManager::applyRollupParameters() {
+    bool enabled = currentIngestRollupsEnabled && currentResamplePeriod > 0;
+    if (enabled && currentRollupCoverageStart == 0) {
+        // Rollups start with the first full period so every covered period is seen from its beginning.  Earlier
+        // periods remain the aggregator's responsibility.
+        unsigned long long currentTime     = QDateTime::currentSecsSinceEpoch();
+        unsigned long      alignmentPeriod = (
+              currentBlockStorage.loadAcquire() != 0
+            ? LatencyBlock::blockAlignedPeriod(currentResamplePeriod)
+            : currentResamplePeriod
+        );
+        currentRollupCoverageStart = currentTime - (currentTime % alignmentPeriod) + alignmentPeriod;
+    }
+
+    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
+                                                              end = dataInterfacesByRegion.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        it.value()->setRollupParameters(
+            enabled ? currentResamplePeriod : 0,
+            currentAggregationAge,
+            currentRollupCoverageStart
+        );
+    }
+
+    currentLatencyAggregator->setRollupCoverageStart(enabled ? currentRollupCoverageStart : 0);
+}
+
+
+void LatencyInterfaceManager::applyAggregatorParameters() {
+    bool blockStorage = (currentBlockStorage.loadAcquire() != 0);
+    currentLatencyAggregator->setParameters(
+        QString(blockStorage ? "latency_blocks" : "latency_seconds"),
+        QString("latency_aggregated"),
+        currentAggregationAge,
+        currentResamplePeriod,
+        currentExpungePeriod,
+        currentInputAggregated,
+        blockStorage
+    );
+}
+
+
+void LatencyInterfaceManager::applyAggregationTiers() {
+    unsigned numberTiers = currentResamplePeriod > 0 ? static_cast<unsigned>(currentAggregationTiers.size()) : 0;
+
+    while (static_cast<unsigned>(tierAggregators.size()) > numberTiers) {
+        tierAggregators.takeLast()->deleteLater();
+    }
+
+    while (static_cast<unsigned>(tierAggregators.size()) < numberTiers) {
+        LatencyAggregator* aggregator = new LatencyAggregator(currentDatabaseManager, this);
+        aggregator->setNumberWorkers(currentNumberAggregationWorkers);
+        aggregator->setPartitionPeriods(currentPartitionPeriods);
+        aggregator->setEnabled(currentAggregationEnabled);
+        tierAggregators.append(aggregator);
+
+        connect(
+            aggregator,
+            &LatencyAggregator::aggregationFinished,
+            this,
+            &LatencyInterfaceManager::aggregationFinished
+        );
+    }
+
+    // Each tier waits until the tier feeding it has been aggregated for at least two of its own periods.  This keeps
+    // a tier from folding in a period of its input that its input's aggregator is still filling.
+    tierAggregationAges.clear();
+
+    QString       inputTableName = QString("latency_aggregated");
+    unsigned long inputAge       = currentAggregationAge;
+    unsigned long inputPeriod    = currentResamplePeriod;
+    for (unsigned tierIndex=0 ; tierIndex<numberTiers ; ++tierIndex) {
+        const AggregationTier& tier           = currentAggregationTiers.at(tierIndex);
+        unsigned long          aggregationAge = inputAge + 2 * inputPeriod;
+
+        tierAggregators.at(tierIndex)->setParameters(
+            inputTableName,
+            tier.tableName,
+            aggregationAge,
+            tier.resamplePeriod,
+            tier.expungeAge,
+            true
+        );
+
+        tierAggregationAges.append(aggregationAge);
+
+        inputTableName = tier.tableName;
+        inputAge       = aggregationAge;
+        inputPeriod    = tier.resamplePeriod;
+    }
+}
+
+
+LatencyInterfaceManager::LatencyEntryList LatencyInterfaceManager::getRawEntries(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp
+    ) {
+    enum Field : unsigned {
+        MONITOR_ID_FIELD,
+        SERVER_ID_FIELD,
+        TIMESTAMP_FIELD,
+        LATENCY_FIELD,
+        NUMBER_FIELDS
+    };
+
+    static const TypedResultSet::Column columns[NUMBER_FIELDS] = {
+        { "monitor_id", TypedResultSet::ColumnType::UINT32 },
+        { "server_id",  TypedResultSet::ColumnType::UINT32 },
+        { "timestamp",  TypedResultSet::ColumnType::UINT32 },
+        { "latency",    TypedResultSet::ColumnType::UINT32 }
+    };
+
+    LatencyEntryList result;
+
+    QString queryString = buildQueryString(
+        "latency_seconds",
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        QString("monitor_id, server_id, timestamp, latency")
+    );
+    queryString += QString(" ORDER BY timestamp ASC, monitor_id ASC, server_id ASC");
+
+    TypedResultSet resultSet(database);
+    success = resultSet.execute(queryString, columns, NUMBER_FIELDS);
+    if (success) {
+        unsigned long        numberRows = resultSet.size();
+        const std::uint32_t* monitorIds = resultSet.uint32Values(MONITOR_ID_FIELD);
+        const std::uint32_t* serverIds  = resultSet.uint32Values(SERVER_ID_FIELD);
+        const std::uint32_t* timestamps = resultSet.uint32Values(TIMESTAMP_FIELD);
+        const std::uint32_t* latencies  = resultSet.uint32Values(LATENCY_FIELD);
+
+        result.reserve(static_cast<int>(numberRows));
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            result.append(
+                LatencyEntry(
+                    monitorIds[row],
+                    static_cast<LatencyEntry::ServerId>(serverIds[row]),
+                    timestamps[row],
+                    latencies[row]
+                )
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyInterfaceManager::getLatencyEntries: %1").arg(resultSet.lastError()),
+            true
+        );
+    }
+
+    return result;
+}
+
+
+LatencyInterfaceManager::LatencyEntryList LatencyInterfaceManager::getBlockEntries(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp
+    ) {
+    LatencyEntryList result;
+
+    typedef LatencyEntry::MonitorId      MonitorId;
+    typedef LatencyEntry::ServerId       ServerId;
+    typedef LatencyEntry::ZoranTimeStamp ZoranTimeStamp;
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    // Blocks are keyed by their first second so the block holding the start of the range may begin before it.
+    QString queryString = buildQueryString(
+        "latency_blocks",
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp - (startTimestamp % LatencyBlock::blockPeriod),
+        endTimestamp
+    );
+
+    ZoranTimeStamp firstTimestamp = toZoranTimestamp(startTimestamp);
+    ZoranTimeStamp lastTimestamp  = toZoranTimestamp(endTimestamp);
+
+    success = SqlHelpers::execute(query, queryString);
+    if (success) {
+        int monitorIdField = query.record().indexOf("monitor_id");
+        int serverIdField  = query.record().indexOf("server_id");
+        int samplesField   = query.record().indexOf("samples");
+
+        if (monitorIdField >= 0 && serverIdField >= 0 && samplesField >= 0) {
+            LatencyBlock::SampleList samples;
+            while (success && query.next()) {
+                MonitorId monitorId = query.value(monitorIdField).toUInt(&success);
+                if (success) {
+                    ServerId serverId = query.value(serverIdField).toUInt(&success);
+                    if (success) {
+                        success = LatencyBlock::decode(query.value(samplesField).toByteArray(), samples);
+                        if (success) {
+                            for (  LatencyBlock::SampleList::const_iterator it  = samples.constBegin(),
+                                                                            end = samples.constEnd()
+                                 ; it != end
+                                 ; ++it
+                                ) {
+                                if (it->timestamp >= firstTimestamp && it->timestamp <= lastTimestamp) {
+                                    result.append(LatencyEntry(monitorId, serverId, it->timestamp, it->latency));
+                                }
+                            }
+                        } else {
+                            logWrite(
+                                QString("Invalid latency block - LatencyInterfaceManager::getBlockEntries."),
+                                true
+                            );
+                        }
+                    } else {
+                        logWrite(QString("Invalid server ID - LatencyInterfaceManager::getBlockEntries."), true);
+                    }
+                } else {
+                    logWrite(QString("Invalid monitor ID - LatencyInterfaceManager::getBlockEntries."), true);
+                }
+            }
+
+            std::sort(
+                result.begin(),
+                result.end(),
+                [](const LatencyEntry& a, const LatencyEntry& b) {
+                    return (
+                           a.zoranTimestamp() < b.zoranTimestamp()
+                        || (a.zoranTimestamp() == b.zoranTimestamp() && a.monitorId() < b.monitorId())
+                        || (   a.zoranTimestamp() == b.zoranTimestamp()
+                            && a.monitorId() == b.monitorId()
+                            && a.serverId() < b.serverId()
+                           )
+                    );
+                }
+            );
+        } else {
+            logWrite(QString("Failed to get field indexes - LatencyInterfaceManager::getBlockEntries."), true);
+            success = false;
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyInterfaceManager::getBlockEntries: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return result;
+}
+
+
+bool LatencyInterfaceManager::rawEntriesAggregated(unsigned long long endTimestamp) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    bool result = false;
+    if (currentAggregationAge > 0 && currentResamplePeriod > 0) {
+        unsigned long long currentTime    = QDateTime::currentSecsSinceEpoch();
+        unsigned long long aggregationAge = currentAggregationAge + 2ULL * currentResamplePeriod;
+        if (currentTime > aggregationAge) {
+            unsigned long long boundary        = currentTime - aggregationAge;
+            unsigned long      alignmentPeriod = (
+                  currentBlockStorage.loadAcquire() != 0
+                ? LatencyBlock::blockAlignedPeriod(currentResamplePeriod)
+                : currentResamplePeriod
+            );
+
+            boundary -= boundary % alignmentPeriod;
+
+            result = endTimestamp < boundary;
+        }
+    }
+
+    return result;
+}
+
+
+unsigned long long LatencyInterfaceManager::oldestUnaggregatedTimestamp() {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    // Each aggregation pass only folds entries older than the aggregation age, measured when the pass starts.
+    unsigned long long result = 0;
+    if (currentAggregationAge > 0) {
+        unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+        if (currentTime > currentAggregationAge) {
+            result = currentTime - currentAggregationAge;
+
+            // Blocks are only aggregated once every sample in them has aged out.
+            if (currentBlockStorage.loadAcquire() != 0) {
+                result -= result % LatencyBlock::blockAlignedPeriod(currentResamplePeriod);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+unsigned long long LatencyInterfaceManager::getRecentEntries(
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        unsigned                         threadId,
+        LatencyEntryList&                rawEntries
+    ) {
+    unsigned long long result = std::numeric_limits<unsigned long long>::max();
+
+    // The buffer does not track regions so region-wide reads are left to the database.
+    if (regionId == Region::invalidRegionId || serverId != Server::invalidServerId) {
+        LatencyRingBuffer::MonitorIdSet monitorIds;
+        bool                            allMonitors = false;
+        bool                            resolved    = true;
+
+        if (monitorId != Monitor::invalidMonitorId) {
+            monitorIds.insert(monitorId);
+        } else if (hostSchemeId != HostScheme::invalidHostSchemeId       ||
+                   customerId != CustomerCapabilities::invalidCustomerId    ) {
+            Catalog::SnapshotPointer snapshot = currentCatalog->snapshot(threadId);
+            if (snapshot->isLoaded()) {
+                if (hostSchemeId != HostScheme::invalidHostSchemeId) {
+                    Catalog::MonitorList monitors = snapshot->monitorsUnderHostScheme(hostSchemeId);
+                    for (  Catalog::MonitorList::const_iterator it = monitors.constBegin(), end = monitors.constEnd()
+                         ; it != end
+                         ; ++it
+                        ) {
+                        if (customerId == CustomerCapabilities::invalidCustomerId || it->customerId() == customerId) {
+                            monitorIds.insert(it->monitorId());
+                        }
+                    }
+                } else {
+                    Catalog::MonitorsById monitors = snapshot->monitorsByCustomerId(customerId);
+                    for (  Catalog::MonitorsById::const_iterator it = monitors.constBegin(), end = monitors.constEnd()
+                         ; it != end
+                         ; ++it
+                        ) {
+                        monitorIds.insert(it.key());
+                    }
+                }
+            } else {
+                resolved = false;
+            }
+        } else {
+            allMonitors = true;
+        }
+
+        if (resolved) {
+            unsigned long long recentStart = std::max(startTimestamp, oldestUnaggregatedTimestamp());
+            if (recentStart <= endTimestamp) {
+                unsigned long long coverageStart = currentRingBuffer.getEntries(
+                    allMonitors ? nullptr : &monitorIds,
+                    serverId,
+                    recentStart,
+                    endTimestamp,
+                    rawEntries
+                );
+
+                if (coverageStart != std::numeric_limits<unsigned long long>::max()) {
+                    result = std::max(coverageStart, recentStart);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+bool LatencyInterfaceManager::selectAggregationTier(
+        unsigned long long  startTimestamp,
+        unsigned long       resolution,
+        QString&            tableName,
+        unsigned long long& tierEnd
+    ) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    bool               found       = false;
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+    unsigned           tierIndex   = static_cast<unsigned>(tierAggregationAges.size());
+    while (!found && tierIndex > 0) {
+        --tierIndex;
+
+        const AggregationTier& tier = currentAggregationTiers.at(tierIndex);
+        if (tier.resamplePeriod <= resolution                                         &&
+            (startTimestamp == 0 || currentTime <= startTimestamp + tier.expungeAge)    ) {
+            unsigned long long aggregationAge = tierAggregationAges.at(tierIndex);
+            if (currentTime > aggregationAge) {
+                unsigned long long boundary = currentTime - aggregationAge;
+                boundary -= boundary % tier.resamplePeriod;
+
+                if (boundary > startTimestamp) {
+                    found     = true;
+                    tableName = tier.tableName;
+                    tierEnd   = boundary;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+
+bool LatencyInterfaceManager::selectSpanningTier(
+        unsigned long long  startTimestamp,
+        unsigned long long  endTimestamp,
+        unsigned            numberTiers,
+        unsigned&           tierIndex,
+        QString&            tableName,
+        unsigned long long& alignedStart,
+        unsigned long long& alignedEnd
+    ) {
+    QMutexLocker accessMutexLocker(&accessMutex);
+
+    // Periods are aligned to the Zoran epoch by the aggregator so we align in Zoran time.  An aggregated row's
+    // timestamp always falls inside its period so aligned bounds select exactly the whole periods.
+    bool               found       = false;
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+    unsigned long long zoranStart  = toZoranTimestamp(startTimestamp);
+    unsigned long long zoranEnd    = toZoranTimestamp(endTimestamp) + 1ULL;
+
+    tierIndex = std::min(numberTiers, static_cast<unsigned>(tierAggregationAges.size()));
+    while (!found && tierIndex > 0) {
+        --tierIndex;
+
+        const AggregationTier& tier           = currentAggregationTiers.at(tierIndex);
+        unsigned long long     period         = tier.resamplePeriod;
+        unsigned long long     aggregationAge = tierAggregationAges.at(tierIndex);
+        if (currentTime > aggregationAge && currentTime > tier.expungeAge) {
+            unsigned long long tierStart = std::max(
+                zoranStart,
+                static_cast<unsigned long long>(toZoranTimestamp(currentTime - tier.expungeAge))
+            );
+            unsigned long long tierEnd = std::min(
+                zoranEnd,
+                static_cast<unsigned long long>(toZoranTimestamp(currentTime - aggregationAge))
+            );
+
+            unsigned long long firstPeriod = tierStart + (period - (tierStart % period)) % period;
+            unsigned long long lastPeriod  = tierEnd - (tierEnd % period);
+
+            if (firstPeriod < lastPeriod) {
+                found        = true;
+                tableName    = tier.tableName;
+                alignedStart = firstPeriod + LatencyEntry::startOfZoranEpoch;
+                alignedEnd   = lastPeriod + LatencyEntry::startOfZoranEpoch;
+            }
+        }
+    }
+
+    return found;
+}
+
+
+void LatencyInterfaceManager::getSpanningAggregatedData(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        unsigned                         numberTiers,
+        LatencyPopulations&              populations,
+        LatencySketch*                   latencySketch
+    ) {
+    unsigned           tierIndex;
+    QString            tierTableName;
+    unsigned long long alignedStart;
+    unsigned long long alignedEnd;
+    if (selectSpanningTier(
+            startTimestamp,
+            endTimestamp,
+            numberTiers,
+            tierIndex,
+            tierTableName,
+            alignedStart,
+            alignedEnd
+        )) {
+        if (alignedStart > startTimestamp) {
+            getSpanningAggregatedData(
+                success,
+                database,
+                customerId,
+                hostSchemeId,
+                monitorId,
+                regionId,
+                serverId,
+                startTimestamp,
+                alignedStart - 1,
+                tierIndex,
+                populations,
+                latencySketch
+            );
+        }
+
+        if (success) {
+            getAggregatedSegment(
+                success,
+                database,
+                customerId,
+                hostSchemeId,
+                monitorId,
+                regionId,
+                serverId,
+                alignedStart,
+                alignedEnd - 1,
+                tierTableName,
+                nullptr,
+                &populations,
+                latencySketch
+            );
+        }
+
+        if (success && alignedEnd <= endTimestamp) {
+            getSpanningAggregatedData(
+                success,
+                database,
+                customerId,
+                hostSchemeId,
+                monitorId,
+                regionId,
+                serverId,
+                alignedEnd,
+                endTimestamp,
+                tierIndex,
+                populations,
+                latencySketch
+            );
+        }
+    } else {
+        getAggregatedSegment(
+            success,
+            database,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            QString("latency_aggregated"),
+            nullptr,
+            &populations,
+            latencySketch
+        );
+    }
+}
+
+
+void LatencyInterfaceManager::getSpanningGroupedStatistics(
+        bool&                                        success,
+        QSqlDatabase&                                database,
+        CustomerCapabilities::CustomerId             customerId,
+        const LatencyInterfaceManager::MonitorIdSet& monitorIds,
+        Region::RegionId                             regionId,
+        Server::ServerId                             serverId,
+        unsigned long long                           startTimestamp,
+        unsigned long long                           endTimestamp,
+        unsigned                                     numberTiers,
+        LatencyInterfaceManager::BucketsByMonitorId& buckets
+    ) {
+    unsigned           tierIndex;
+    QString            tierTableName;
+    unsigned long long alignedStart;
+    unsigned long long alignedEnd;
+    if (selectSpanningTier(
+            startTimestamp,
+            endTimestamp,
+            numberTiers,
+            tierIndex,
+            tierTableName,
+            alignedStart,
+            alignedEnd
+        )) {
+        if (alignedStart > startTimestamp) {
+            getSpanningGroupedStatistics(
+                success,
+                database,
+                customerId,
+                monitorIds,
+                regionId,
+                serverId,
+                startTimestamp,
+                alignedStart - 1,
+                tierIndex,
+                buckets
+            );
+        }
+
+        if (success) {
+            getGroupedSegmentStatistics(
+                success,
+                database,
+                customerId,
+                monitorIds,
+                regionId,
+                serverId,
+                alignedStart,
+                alignedEnd - 1,
+                tierTableName,
+                buckets
+            );
+        }
+
+        if (success && alignedEnd <= endTimestamp) {
+            getSpanningGroupedStatistics(
+                success,
+                database,
+                customerId,
+                monitorIds,
+                regionId,
+                serverId,
+                alignedEnd,
+                endTimestamp,
+                tierIndex,
+                buckets
+            );
+        }
+    } else {
+        getGroupedSegmentStatistics(
+            success,
+            database,
+            customerId,
+            monitorIds,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            QString("latency_aggregated"),
+            buckets
+        );
+    }
 }
 
 
-LatencyInterfaceManager::~LatencyInterfaceManager() {
-    for (  QHash<RegionId, LatencyInterface*>::const_iterator it  = dataInterfacesByRegion.constBegin(),
-                                                              end = dataInterfacesByRegion.constEnd()
-         ; it != end
-         ; ++it
-        ) {
-        LatencyInterface* dataInterface = it.value();
-        delete dataInterface;
+void LatencyInterfaceManager::getGroupedSegmentStatistics(
+        bool&                                        success,
+        QSqlDatabase&                                database,
+        CustomerCapabilities::CustomerId             customerId,
+        const LatencyInterfaceManager::MonitorIdSet& monitorIds,
+        Region::RegionId                             regionId,
+        Server::ServerId                             serverId,
+        unsigned long long                           startTimestamp,
+        unsigned long long                           endTimestamp,
+        const QString&                               tableName,
+        LatencyInterfaceManager::BucketsByMonitorId& buckets
+    ) {
+    if (tableName == QString("latency_aggregated") && currentLatencyArchive->covers(startTimestamp, endTimestamp)) {
+        LatencyArchive::Filter filter = buildArchiveFilter(
+            success,
+            database,
+            customerId,
+            HostScheme::invalidHostSchemeId,
+            Monitor::invalidMonitorId,
+            regionId,
+            serverId
+        );
+
+        if (success) {
+            if (!monitorIds.isEmpty()) {
+                filter.monitorIds.intersect(monitorIds);
+            }
+
+            AggregatedLatencyEntryList archivedEntries;
+            success = currentLatencyArchive->readEntries(
+                filter,
+                startTimestamp,
+                endTimestamp,
+                &archivedEntries,
+                nullptr,
+                nullptr
+            );
+
+            for (  AggregatedLatencyEntryList::const_iterator it  = archivedEntries.constBegin(),
+                                                              end = archivedEntries.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                buckets[it->monitorId()].add(
+                    it->meanLatency(),
+                    it->varianceLatency(),
+                    it->minimumLatency(),
+                    it->maximumLatency(),
+                    it->numberSamples()
+                );
+            }
+        }
     }
-}
 
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
 
-LatencyInterface* LatencyInterfaceManager::getLatencyInterface(RegionId regionId) {
-    QMutexLocker accessMutexLocker(&accessMutex);
+        // Each row's second moment about zero is summed so sub-populations combine exactly in a single pass.
+        QString queryString = buildGroupedQueryString(
+            tableName,
+            customerId,
+            monitorIds,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            QString(
+                "SUM(number_samples) AS sample_size, "
+                "SUM(mean_latency * number_samples) / NULLIF(SUM(number_samples), 0) AS average, "
+                "SUM((variance_latency + mean_latency * mean_latency) * number_samples) "
+                    "/ NULLIF(SUM(number_samples), 0) AS second_moment, "
+                "MIN(minimum_latency) AS minimum, "
+                "MAX(maximum_latency) AS maximum"
+            )
+        );
 
-    LatencyInterface* dataInterfaceForRegion = dataInterfacesByRegion.value(regionId, nullptr);
-    if (dataInterfaceForRegion == nullptr) {
-        dataInterfaceForRegion = new LatencyInterface(currentDatabaseManager, regionId);
-        dataInterfaceForRegion->moveToThread(thread());
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            while (success && query.next()) {
+                LatencyEntry::MonitorId monitorId  = query.value(0).toUInt(&success);
+                unsigned long long      sampleSize = success ? query.value(1).toULongLong(&success) : 0;
+                if (success && sampleSize > 0) {
+                    double average = query.value(2).toDouble(&success);
+                    if (success) {
+                        double secondMoment = query.value(3).toDouble(&success);
+                        if (success) {
+                            LatencyEntry::LatencyMicroseconds minimum = query.value(4).toUInt(&success);
+                            if (success) {
+                                LatencyEntry::LatencyMicroseconds maximum = query.value(5).toUInt(&success);
+                                if (success) {
+                                    buckets[monitorId].add(
+                                        average,
+                                        std::max(0.0, secondMoment - average * average),
+                                        minimum,
+                                        maximum,
+                                        sampleSize
+                                    );
+                                }
+                            }
+                        }
+                    }
+                }
+            }
 
-        dataInterfacesByRegion.insert(regionId, dataInterfaceForRegion);
+            if (!success) {
+                logWrite(
+                    QString("Invalid statistics - LatencyInterfaceManager::getGroupedSegmentStatistics."),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - LatencyInterfaceManager::getGroupedSegmentStatistics: %1")
+                .arg(query.lastError().text()),
+                true
+            );
+        }
     }
-
-    return dataInterfaceForRegion;
 }
 
 
-LatencyInterfaceManager::LatencyEntryLists LatencyInterfaceManager::getLatencyEntries(
+void LatencyInterfaceManager::getTieredAggregatedData(
+        bool&                            success,
+        QSqlDatabase&                    database,
         CustomerCapabilities::CustomerId customerId,
         HostScheme::HostSchemeId         hostSchemeId,
         LatencyEntry::MonitorId          monitorId,
@@ -83,15 +2152,15 @@ LatencyInterfaceManager::LatencyEntryLists LatencyInterfaceManager::getLatencyEn
         Server::ServerId                 serverId,
         unsigned long long               startTimestamp,
         unsigned long long               endTimestamp,
-        unsigned                         threadId
+        unsigned long                    resolution,
+        AggregatedLatencyEntryList*      aggregatedEntries,
+        LatencyPopulations*              populations,
+        LatencySketch*                   latencySketch
     ) {
-    LatencyEntryList           rawEntries;
-    AggregatedLatencyEntryList aggregatedEntries;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        rawEntries = getRawEntries(
+    QString            tierTableName;
+    unsigned long long tierEnd;
+    if (resolution > 0 && selectAggregationTier(startTimestamp, resolution, tierTableName, tierEnd)) {
+        getAggregatedSegment(
             success,
             database,
             customerId,
@@ -100,11 +2169,15 @@ LatencyInterfaceManager::LatencyEntryLists LatencyInterfaceManager::getLatencyEn
             regionId,
             serverId,
             startTimestamp,
-            endTimestamp
+            std::min(endTimestamp, tierEnd - 1),
+            tierTableName,
+            aggregatedEntries,
+            populations,
+            latencySketch
         );
 
-        if (success) {
-            aggregatedEntries = getAggregatedEntries(
+        if (success && endTimestamp >= tierEnd) {
+            getAggregatedSegment(
                 success,
                 database,
                 customerId,
@@ -112,30 +2185,37 @@ LatencyInterfaceManager::LatencyEntryLists LatencyInterfaceManager::getLatencyEn
                 monitorId,
                 regionId,
                 serverId,
-                startTimestamp,
-                endTimestamp
+                tierEnd,
+                endTimestamp,
+                QString("latency_aggregated"),
+                aggregatedEntries,
+                populations,
+                latencySketch
             );
         }
     } else {
-        logWrite(
-            QString("Failed to open database - LatencyInterfaceManager::getLatencyEntries: %1")
-            .arg(database.lastError().text()),
-            true
+        getAggregatedSegment(
+            success,
+            database,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            QString("latency_aggregated"),
+            aggregatedEntries,
+            populations,
+            latencySketch
         );
     }
-
-    currentDatabaseManager->closeAndRelease(database);
-
-    if (!success) {
-        rawEntries.clear();
-        aggregatedEntries.clear();
-    }
-
-    return LatencyEntryLists(rawEntries, aggregatedEntries);
 }
 
 
-AggregatedLatencyEntry LatencyInterfaceManager::getLatencyStatistics(
+void LatencyInterfaceManager::getAggregatedSegment(
+        bool&                            success,
+        QSqlDatabase&                    database,
         CustomerCapabilities::CustomerId customerId,
         HostScheme::HostSchemeId         hostSchemeId,
         LatencyEntry::MonitorId          monitorId,
@@ -143,27 +2223,38 @@ AggregatedLatencyEntry LatencyInterfaceManager::getLatencyStatistics(
         Server::ServerId                 serverId,
         unsigned long long               startTimestamp,
         unsigned long long               endTimestamp,
-        unsigned                         threadId
+        const QString&                   tableName,
+        AggregatedLatencyEntryList*      aggregatedEntries,
+        LatencyPopulations*              populations,
+        LatencySketch*                   latencySketch
     ) {
-    AggregatedLatencyEntry result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        AggregatedLatencyEntry rawEntryStatistics = getRawEntryStatistics(
+    // Archived entries are older than any entry still in the table so they are read first to preserve ordering.
+    if (tableName == QString("latency_aggregated") && currentLatencyArchive->covers(startTimestamp, endTimestamp)) {
+        LatencyArchive::Filter filter = buildArchiveFilter(
             success,
             database,
             customerId,
             hostSchemeId,
             monitorId,
             regionId,
-            serverId,
-            startTimestamp,
-            endTimestamp
+            serverId
         );
 
         if (success) {
-            AggregatedLatencyEntryList aggregatedEntries = getAggregatedEntries(
+            success = currentLatencyArchive->readEntries(
+                filter,
+                startTimestamp,
+                endTimestamp,
+                aggregatedEntries,
+                populations,
+                latencySketch
+            );
+        }
+    }
+
+    if (success && aggregatedEntries != nullptr) {
+        aggregatedEntries->append(
+            getAggregatedEntries(
                 success,
                 database,
                 customerId,
@@ -172,227 +2263,103 @@ AggregatedLatencyEntry LatencyInterfaceManager::getLatencyStatistics(
                 regionId,
                 serverId,
                 startTimestamp,
-                endTimestamp
-            );
-
-            unsigned numberAggregations = static_cast<unsigned>(aggregatedEntries.size());
-            if (numberAggregations == 0) {
-                result = rawEntryStatistics;
-            } else {
-                aggregatedEntries.append(rawEntryStatistics);
-
-                // Now find the combined mean and variance
-                //
-                // To do this, we use the expression:
-                //
-                //   v_c = \frac{ \sum_i n _ i \left [ v_i + \left ( \mu_i - \mu_c \right ) ^ 2 \right ] }
-                //              { \sum_i n _ i }
-                //
-                // Where:
-                //   v_c -   Is the population variance of the combined population
-                //   n_i -   Is the size of sub-population i
-                //   v_i -   Is the variance of sub-population i
-                //   \mu_i - Is the average of sub-population i
-                //   \mu_c - Is the average of the combined population.
-                //
-                // We calculate the combined mean by:
-                //
-                //    \mu _ c = \frac{ \sum_i n _ i \mu _ i }
-                //                   { \sum_i n _ i }
-                //
-                // While we're at it, we also get our minimum and maximum values.
-
-                double                            sum = 0;
-                unsigned long                     nc  = 0;
-                LatencyEntry::LatencyMicroseconds min = std::numeric_limits<LatencyEntry::LatencyMicroseconds>::max();
-                LatencyEntry::LatencyMicroseconds max = 0;
-                for (unsigned i=0 ; i<numberAggregations ; ++i) {
-                    const AggregatedLatencyEntry& entry = aggregatedEntries.at(i);
-                    sum += entry.meanLatency() * entry.numberSamples();
-                    nc  += entry.numberSamples();
-
-                    if (entry.maximumLatency() > max) {
-                        max = entry.maximumLatency();
-                    }
-
-                    if (entry.minimumLatency() < min) {
-                        min = entry.minimumLatency();
-                    }
-                }
-
-                double muc = sum / nc;
-
-                double numerator = 0;
-                for (unsigned i=0 ; i<numberAggregations ; ++i) {
-                    const AggregatedLatencyEntry& entry = aggregatedEntries.at(i);
-                    unsigned ni    = entry.numberSamples();
-                    double   mui   = entry.meanLatency();
-                    double   vi    = entry.varianceLatency();
-                    double   dmean = mui - muc;
-
-                    numerator += ni * (vi + dmean * dmean);
-                }
-
-                double vc = numerator / nc;
-
-                result = AggregatedLatencyEntry(
-                    monitorId,
-                    serverId,
-                    0,
-                    0,
-                    LatencyEntry::toZoranTimestamp(startTimestamp),
-                    LatencyEntry::toZoranTimestamp(endTimestamp),
-                    muc,
-                    vc,
-                    min,
-                    max,
-                    nc
-                );
-            }
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database - LatencyInterfaceManager::getLatencyStatistics: %1")
-            .arg(database.lastError().text()),
-            true
+                endTimestamp,
+                tableName
+            )
         );
     }
 
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
-}
-
-
-void LatencyInterfaceManager::addEntry(
-        RegionId                          regionId,
-        LatencyEntry::MonitorId           monitorId,
-        LatencyEntry::ServerId            serverId,
-        LatencyEntry::ZoranTimeStamp      zoranTimestamp,
-        LatencyEntry::LatencyMicroseconds latencyMicroseconds
-    ) {
-    LatencyInterface* latencyInterface = getLatencyInterface(regionId);
-    latencyInterface->addEntry(monitorId, serverId, zoranTimestamp, latencyMicroseconds);
-    latencyInterface->receivedEntries();
-}
-
-
-void LatencyInterfaceManager::addEntry(RegionId regionId, const LatencyEntry& latencyEntry) {
-    LatencyInterface* latencyInterface = getLatencyInterface(regionId);
-    latencyInterface->addEntry(latencyEntry);
-    latencyInterface->receivedEntries();
-}
-
-
-void LatencyInterfaceManager::addEntries(RegionId regionId, const LatencyInterface::LatencyEntryList& latencyEntries) {
-    LatencyInterface* latencyInterface = getLatencyInterface(regionId);
-    latencyInterface->addEntries(latencyEntries);
-    latencyInterface->receivedEntries();
-}
-
-
-bool LatencyInterfaceManager::deleteByCustomerId(
-        const CustomersCapabilities::CustomerIdSet& customerIds,
-        unsigned                                    threadId
-    ) {
-    return currentLatencyAggregator->deleteByCustomerId(customerIds, threadId);
-}
-
+    if (success && populations != nullptr) {
+        getAggregatedPopulations(
+            success,
+            database,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            tableName,
+            *populations
+        );
+    }
 
-void LatencyInterfaceManager::setParameters(
-        unsigned long  inputTableMaximumAge,
-        unsigned long  resamplePeriod,
-        unsigned long  expungePeriod,
-        bool           inputAggregated
-    ) {
-    currentLatencyAggregator->setParameters(
-        QString("latency_seconds"),
-        QString("latency_aggregated"),
-        inputTableMaximumAge,
-        resamplePeriod,
-        expungePeriod,
-        inputAggregated
-    );
+    if (success && latencySketch != nullptr) {
+        getAggregatedSketch(
+            success,
+            database,
+            customerId,
+            hostSchemeId,
+            monitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            tableName,
+            *latencySketch
+        );
+    }
 }
 
 
-LatencyInterfaceManager::LatencyEntryList LatencyInterfaceManager::getRawEntries(
+LatencyArchive::Filter LatencyInterfaceManager::buildArchiveFilter(
         bool&                            success,
         QSqlDatabase&                    database,
         CustomerCapabilities::CustomerId customerId,
         HostScheme::HostSchemeId         hostSchemeId,
         LatencyEntry::MonitorId          monitorId,
         Region::RegionId                 regionId,
-        Server::ServerId                 serverId,
-        unsigned long long               startTimestamp,
-        unsigned long long               endTimestamp
+        Server::ServerId                 serverId
     ) {
-    LatencyEntryList result;
-
-    typedef LatencyEntry::MonitorId           MonitorId;
-    typedef LatencyEntry::ServerId            ServerId;
-    typedef LatencyEntry::ZoranTimeStamp      ZoranTimeStamp;
-    typedef LatencyEntry::LatencyMicroseconds Latency;
+    LatencyArchive::Filter result;
+    result.allMonitors = true;
+    result.allServers  = true;
 
     QSqlQuery query(database);
     query.setForwardOnly(true);
 
-    QString queryString = buildQueryString(
-        "latency_seconds",
-        customerId,
-        hostSchemeId,
-        monitorId,
-        regionId,
-        serverId,
-        startTimestamp,
-        endTimestamp
-    );
-    queryString += QString(" ORDER BY timestamp ASC, monitor_id ASC, server_id ASC");
+    success = true;
+    if (monitorId != Monitor::invalidMonitorId) {
+        result.allMonitors = false;
+        result.monitorIds.insert(monitorId);
+    } else if (hostSchemeId != HostScheme::invalidHostSchemeId       ||
+               customerId != CustomerCapabilities::invalidCustomerId    ) {
+        result.allMonitors = false;
+
+        QString queryString = (
+              hostSchemeId != HostScheme::invalidHostSchemeId
+            ? QString("SELECT monitor_id FROM monitor WHERE host_scheme_id = %1").arg(hostSchemeId)
+            : QString("SELECT monitor_id FROM monitor WHERE customer_id = %1").arg(customerId)
+        );
+
+        success = SqlHelpers::execute(query, queryString);
+        while (success && query.next()) {
+            result.monitorIds.insert(query.value(0).toUInt(&success));
+        }
+    }
 
-    success = query.exec(queryString);
     if (success) {
-        int monitorIdField = query.record().indexOf("monitor_id");
-        int serverIdField  = query.record().indexOf("server_id");
-        int timestampField = query.record().indexOf("timestamp");
-        int latencyField   = query.record().indexOf("latency");
+        if (serverId != Server::invalidServerId) {
+            result.allServers = false;
+            result.serverIds.insert(serverId);
+        } else if (regionId != Region::invalidRegionId) {
+            result.allServers = false;
+
+            success = SqlHelpers::execute(
+                query,
+                QString("SELECT server_id FROM servers WHERE region_id = %1").arg(regionId)
+            );
 
-        if (monitorIdField >= 0 &&
-            serverIdField >= 0  &&
-            timestampField >= 0 &&
-            latencyField >= 0      ) {
             while (success && query.next()) {
-                MonitorId monitorId = query.value(monitorIdField).toUInt(&success);
-                if (success) {
-                    ServerId serverId = query.value(serverIdField).toUInt(&success);
-                    if (success) {
-                        ZoranTimeStamp timestamp = query.value(timestampField).toUInt(&success);
-                        if (success) {
-                            Latency latency = query.value(latencyField).toUInt(&success);
-                            if (success) {
-                                LatencyEntry entry = LatencyEntry(monitorId, serverId, timestamp, latency);
-                                result.append(entry);
-                            } else {
-                                logWrite(
-                                    QString("Invalid latency - LatencyInterfaceManager::getLatencyEntries."),
-                                    true
-                                );
-                            }
-                        } else {
-                            logWrite(QString("Invalid timestamp - LatencyInterfaceManager::getLatencyEntries."), true);
-                        }
-                    } else {
-                        logWrite(QString("Invalid server ID - LatencyInterfaceManager::getLatencyEntries."), true);
-                    }
-                } else {
-                    logWrite(QString("Invalid monitor ID - LatencyInterfaceManager::getLatencyEntries."), true);
-                }
+                result.serverIds.insert(static_cast<Server::ServerId>(query.value(0).toUInt(&success)));
             }
-        } else {
-            logWrite(QString("Failed to get field indexes - LatencyInterfaceManager::getLatencyEntries."), true);
-            success = false;
         }
-    } else {
+    }
+
+    if (!success) {
         logWrite(
-            QString("Failed SELECT - LatencyInterfaceManager::getLatencyEntries: ").arg(database.lastError().text()),
+            QString("Failed SELECT - LatencyInterfaceManager::buildArchiveFilter: %1").arg(query.lastError().text()),
             true
         );
     }
@@ -410,187 +2377,93 @@ LatencyInterfaceManager::AggregatedLatencyEntryList LatencyInterfaceManager::get
         Region::RegionId                 regionId,
         Server::ServerId                 serverId,
         unsigned long long               startTimestamp,
-        unsigned long long               endTimestamp
+        unsigned long long               endTimestamp,
+        const QString&                   tableName
     ) {
-    AggregatedLatencyEntryList result;
-
-    typedef LatencyEntry::MonitorId           MonitorId;
-    typedef LatencyEntry::ServerId            ServerId;
-    typedef LatencyEntry::ZoranTimeStamp      ZoranTimeStamp;
-    typedef LatencyEntry::LatencyMicroseconds Latency;
+    enum Field : unsigned {
+        MONITOR_ID_FIELD,
+        SERVER_ID_FIELD,
+        TIMESTAMP_FIELD,
+        LATENCY_FIELD,
+        START_TIMESTAMP_FIELD,
+        END_TIMESTAMP_FIELD,
+        MEAN_LATENCY_FIELD,
+        VARIANCE_LATENCY_FIELD,
+        MINIMUM_LATENCY_FIELD,
+        MAXIMUM_LATENCY_FIELD,
+        NUMBER_SAMPLES_FIELD,
+        NUMBER_FIELDS
+    };
+
+    static const TypedResultSet::Column columns[NUMBER_FIELDS] = {
+        { "monitor_id",       TypedResultSet::ColumnType::UINT32 },
+        { "server_id",        TypedResultSet::ColumnType::UINT32 },
+        { "timestamp",        TypedResultSet::ColumnType::UINT32 },
+        { "latency",          TypedResultSet::ColumnType::UINT32 },
+        { "start_timestamp",  TypedResultSet::ColumnType::UINT32 },
+        { "end_timestamp",    TypedResultSet::ColumnType::UINT32 },
+        { "mean_latency",     TypedResultSet::ColumnType::DOUBLE },
+        { "variance_latency", TypedResultSet::ColumnType::DOUBLE },
+        { "minimum_latency",  TypedResultSet::ColumnType::UINT32 },
+        { "maximum_latency",  TypedResultSet::ColumnType::UINT32 },
+        { "number_samples",   TypedResultSet::ColumnType::UINT32 }
+    };
 
-    QSqlQuery query(database);
-    query.setForwardOnly(true);
+    AggregatedLatencyEntryList result;
 
     QString queryString = buildQueryString(
-        "latency_aggregated",
+        tableName,
         customerId,
         hostSchemeId,
         monitorId,
         regionId,
         serverId,
         startTimestamp,
-        endTimestamp
+        endTimestamp,
+        QString(
+            "monitor_id, server_id, timestamp, latency, start_timestamp, end_timestamp, mean_latency, "
+            "variance_latency, minimum_latency, maximum_latency, number_samples"
+        )
     );
     queryString += QString(" ORDER BY start_timestamp ASC, monitor_id ASC, server_id ASC");
 
-    success = query.exec(queryString);
+    TypedResultSet resultSet(database);
+    success = resultSet.execute(queryString, columns, NUMBER_FIELDS);
     if (success) {
-        int monitorIdField       = query.record().indexOf("monitor_id");
-        int serverIdField        = query.record().indexOf("server_id");
-        int timestampField       = query.record().indexOf("timestamp");
-        int latencyField         = query.record().indexOf("latency");
-        int startTimestampField  = query.record().indexOf("start_timestamp");
-        int endTimestampField    = query.record().indexOf("end_timestamp");
-        int meanLatencyField     = query.record().indexOf("mean_latency");
-        int varianceLatencyField = query.record().indexOf("variance_latency");
-        int minimumLatencyField  = query.record().indexOf("minimum_latency");
-        int maximumLatencyField  = query.record().indexOf("maximum_latency");
-        int numberSamplesField   = query.record().indexOf("number_samples");
-
-        if (monitorIdField >= 0       &&
-            serverIdField >= 0        &&
-            timestampField >= 0       &&
-            latencyField >= 0         &&
-            startTimestampField >= 0  &&
-            endTimestampField >= 0    &&
-            meanLatencyField >= 0     &&
-            varianceLatencyField >= 0 &&
-            minimumLatencyField >= 0  &&
-            maximumLatencyField >= 0  &&
-            numberSamplesField >= 0      ) {
-            while (success && query.next()) {
-                MonitorId monitorId = query.value(monitorIdField).toUInt(&success);
-                if (success) {
-                    ServerId serverId = query.value(serverIdField).toUInt(&success);
-                    if (success) {
-                        ZoranTimeStamp timestamp = query.value(timestampField).toUInt(&success);
-                        if (success) {
-                            Latency latency = query.value(latencyField).toUInt(&success);
-                            if (success) {
-                                ZoranTimeStamp startTime = query.value(startTimestampField).toUInt(&success);
-                                if (success) {
-                                    ZoranTimeStamp endTime = query.value(endTimestampField).toUInt(&success);
-                                    if (success) {
-                                        double meanLatency = query.value(meanLatencyField).toDouble(&success);
-                                        if (success) {
-                                            double varianceLatency = query.value(varianceLatencyField)
-                                                                          .toDouble(&success);
-                                            if (success) {
-                                                Latency minimumLatency = query.value(minimumLatencyField)
-                                                                              .toUInt(&success);
-                                                if (success) {
-                                                    Latency maximumLatency = query.value(maximumLatencyField)
-                                                                                  .toUInt(&success);
-                                                    if (success) {
-                                                        unsigned long numberSamples = query.value(numberSamplesField)
-                                                                                           .toUInt(&success);
-                                                        if (success) {
-                                                            AggregatedLatencyEntry entry = AggregatedLatencyEntry(
-                                                                monitorId,
-                                                                serverId,
-                                                                timestamp,
-                                                                latency,
-                                                                startTime,
-                                                                endTime,
-                                                                meanLatency,
-                                                                varianceLatency,
-                                                                minimumLatency,
-                                                                maximumLatency,
-                                                                numberSamples
-                                                            );
-
-                                                            result.append(entry);
-                                                        } else {
-                                                            logWrite(
-                                                                QString(
-                                                                    "Invalid number samples - "
-                                                                    "LatencyInterfaceManager::getLatencyEntries."
-                                                                ),
-                                                                true
-                                                            );
-                                                        }
-                                                    } else {
-                                                        logWrite(
-                                                            QString(
-                                                                "Invalid maximum latency - "
-                                                                "LatencyInterfaceManager::getLatencyEntries."
-                                                            ),
-                                                            true
-                                                        );
-                                                    }
-                                                } else {
-                                                    logWrite(
-                                                        QString(
-                                                            "Invalid minimum latency - "
-                                                            "LatencyInterfaceManager::getLatencyEntries."
-                                                        ),
-                                                        true
-                                                    );
-                                                }
-                                            } else {
-                                                logWrite(
-                                                    QString(
-                                                        "Invalid variance latency - "
-                                                        "LatencyInterfaceManager::getLatencyEntries."
-                                                    ),
-                                                    true
-                                                );
-                                            }
-                                        } else {
-                                            logWrite(
-                                                QString(
-                                                    "Invalid mean latency - "
-                                                    "LatencyInterfaceManager::getLatencyEntries."
-                                                ),
-                                                true
-                                            );
-                                        }
-                                    } else {
-                                        logWrite(
-                                            QString("Invalid end time - LatencyInterfaceManager::getLatencyEntries."),
-                                            true
-                                        );
-                                    }
-                                } else {
-                                    logWrite(
-                                        QString("Invalid start time - LatencyInterfaceManager::getLatencyEntries."),
-                                        true
-                                    );
-                                }
-                            } else {
-                                logWrite(
-                                    QString("Invalid latency - LatencyInterfaceManager::getLatencyEntries."),
-                                    true
-                                );
-                            }
-                        } else {
-                            logWrite(
-                                QString("Invalid timestamp - LatencyInterfaceManager::getLatencyEntries."),
-                                true
-                            );
-                        }
-                    } else {
-                        logWrite(
-                            QString("Invalid server ID - LatencyInterfaceManager::getLatencyEntries."),
-                            true
-                        );
-                    }
-                } else {
-                    logWrite(
-                        QString("Invalid monitor ID - LatencyInterfaceManager::getLatencyEntries."),
-                        true
-                    );
-                }
-            }
-
-        } else {
-            logWrite(QString("Failed to get field indexes - LatencyInterfaceManager::getLatencyEntries."), true);
-            success = false;
+        unsigned long        numberRows        = resultSet.size();
+        const std::uint32_t* monitorIds        = resultSet.uint32Values(MONITOR_ID_FIELD);
+        const std::uint32_t* serverIds         = resultSet.uint32Values(SERVER_ID_FIELD);
+        const std::uint32_t* timestamps        = resultSet.uint32Values(TIMESTAMP_FIELD);
+        const std::uint32_t* latencies         = resultSet.uint32Values(LATENCY_FIELD);
+        const std::uint32_t* startTimestamps   = resultSet.uint32Values(START_TIMESTAMP_FIELD);
+        const std::uint32_t* endTimestamps     = resultSet.uint32Values(END_TIMESTAMP_FIELD);
+        const double*        meanLatencies     = resultSet.doubleValues(MEAN_LATENCY_FIELD);
+        const double*        varianceLatencies = resultSet.doubleValues(VARIANCE_LATENCY_FIELD);
+        const std::uint32_t* minimumLatencies  = resultSet.uint32Values(MINIMUM_LATENCY_FIELD);
+        const std::uint32_t* maximumLatencies  = resultSet.uint32Values(MAXIMUM_LATENCY_FIELD);
+        const std::uint32_t* numberSamples     = resultSet.uint32Values(NUMBER_SAMPLES_FIELD);
+
+        result.reserve(static_cast<int>(numberRows));
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            result.append(
+                AggregatedLatencyEntry(
+                    monitorIds[row],
+                    static_cast<LatencyEntry::ServerId>(serverIds[row]),
+                    timestamps[row],
+                    latencies[row],
+                    startTimestamps[row],
+                    endTimestamps[row],
+                    meanLatencies[row],
+                    varianceLatencies[row],
+                    minimumLatencies[row],
+                    maximumLatencies[row],
+                    numberSamples[row]
+                )
+            );
         }
     } else {
         logWrite(
-            QString("Failed SELECT - LatencyInterfaceManager::getLatencyEntries: %1").arg(query.lastError().text()),
+            QString("Failed SELECT - LatencyInterfaceManager::getLatencyEntries: %1").arg(resultSet.lastError()),
             true
         );
     }
@@ -632,7 +2505,7 @@ AggregatedLatencyEntry LatencyInterfaceManager::getRawEntryStatistics(
             "COUNT(latency) AS sample_size")
     );
 
-    success = query.exec(queryString);
+    success = SqlHelpers::execute(query, queryString);
     if (success) {
         int averageField    = query.record().indexOf("average");
         int varianceField   = query.record().indexOf("variance");
@@ -719,6 +2592,334 @@ AggregatedLatencyEntry LatencyInterfaceManager::getRawEntryStatistics(
 }
 
 
+void LatencyInterfaceManager::getGroupedRawEntryStatistics(
+        bool&                                        success,
+        QSqlDatabase&                                database,
+        CustomerCapabilities::CustomerId             customerId,
+        const LatencyInterfaceManager::MonitorIdSet& monitorIds,
+        Region::RegionId                             regionId,
+        Server::ServerId                             serverId,
+        unsigned long long                           startTimestamp,
+        unsigned long long                           endTimestamp,
+        LatencyInterfaceManager::BucketsByMonitorId& buckets
+    ) {
+    if (currentBlockStorage.loadAcquire() != 0) {
+        LatencyEntryList entries = getBlockEntries(
+            success,
+            database,
+            customerId,
+            HostScheme::invalidHostSchemeId,
+            Monitor::invalidMonitorId,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp
+        );
+
+        for (LatencyEntryList::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+            if (monitorIds.isEmpty() || monitorIds.contains(it->monitorId())) {
+                LatencyEntry::LatencyMicroseconds latency = it->latencyMicroseconds();
+                buckets[it->monitorId()].add(latency, 0, latency, latency, 1);
+            }
+        }
+    } else {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        QString queryString = buildGroupedQueryString(
+            "latency_seconds",
+            customerId,
+            monitorIds,
+            regionId,
+            serverId,
+            startTimestamp,
+            endTimestamp,
+            QString(
+                "COUNT(latency) AS sample_size, "
+                "AVG(latency) AS average, "
+                "VAR_POP(latency) AS variance, "
+                "MIN(latency) AS minimum, "
+                "MAX(latency) AS maximum"
+            )
+        );
+
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            while (success && query.next()) {
+                LatencyEntry::MonitorId monitorId  = query.value(0).toUInt(&success);
+                unsigned long long      sampleSize = success ? query.value(1).toULongLong(&success) : 0;
+                if (success && sampleSize > 0) {
+                    double average = query.value(2).toDouble(&success);
+                    if (success) {
+                        double variance = query.value(3).toDouble(&success);
+                        if (success) {
+                            LatencyEntry::LatencyMicroseconds minimum = query.value(4).toUInt(&success);
+                            if (success) {
+                                LatencyEntry::LatencyMicroseconds maximum = query.value(5).toUInt(&success);
+                                if (success) {
+                                    buckets[monitorId].add(average, variance, minimum, maximum, sampleSize);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (!success) {
+                logWrite(
+                    QString("Invalid statistics - LatencyInterfaceManager::getGroupedRawEntryStatistics."),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - LatencyInterfaceManager::getGroupedRawEntryStatistics: %1")
+                .arg(query.lastError().text()),
+                true
+            );
+        }
+    }
+}
+
+
+void LatencyInterfaceManager::getAggregatedPopulations(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        const QString&                   tableName,
+        LatencyPopulations&              populations
+    ) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    QString queryString = buildQueryString(
+        tableName,
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        QString("mean_latency, variance_latency, minimum_latency, maximum_latency, number_samples")
+    );
+
+    success = SqlHelpers::execute(query, queryString);
+    if (success) {
+        int numberRows = query.size();
+        if (numberRows > 0) {
+            populations.reserve(populations.size() + static_cast<unsigned long>(numberRows));
+        }
+
+        while (success && query.next()) {
+            double meanLatency = query.value(0).toDouble(&success);
+            if (success) {
+                double varianceLatency = query.value(1).toDouble(&success);
+                if (success) {
+                    LatencyEntry::LatencyMicroseconds minimumLatency = query.value(2).toUInt(&success);
+                    if (success) {
+                        LatencyEntry::LatencyMicroseconds maximumLatency = query.value(3).toUInt(&success);
+                        if (success) {
+                            unsigned long numberSamples = query.value(4).toUInt(&success);
+                            if (success) {
+                                populations.append(
+                                    meanLatency,
+                                    varianceLatency,
+                                    minimumLatency,
+                                    maximumLatency,
+                                    numberSamples
+                                );
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!success) {
+            logWrite(QString("Invalid statistics - LatencyInterfaceManager::getAggregatedPopulations."), true);
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyInterfaceManager::getAggregatedPopulations: %1")
+            .arg(query.lastError().text()),
+            true
+        );
+    }
+}
+
+
+void LatencyInterfaceManager::getAggregatedSketch(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        const QString&                   tableName,
+        LatencySketch&                   latencySketch
+    ) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    // Serialized sketches merge by concatenation so the database can combine every matching row into one value.
+    QString queryString = buildQueryString(
+        tableName,
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        QString("STRING_AGG(latency_sketch, ''::BYTEA) AS latency_sketch")
+    );
+
+    success = SqlHelpers::execute(query, queryString);
+    if (success) {
+        if (query.first() && !query.value(0).isNull()) {
+            latencySketch.merge(LatencySketch::fromByteArray(query.value(0).toByteArray(), &success));
+            if (!success) {
+                logWrite(QString("Invalid latency sketch - LatencyInterfaceManager::getAggregatedSketch."), true);
+            }
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyInterfaceManager::getAggregatedSketch: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+}
+
+
+void LatencyInterfaceManager::getRawEntrySketch(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        LatencySketch&                   latencySketch
+    ) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    QString queryString = buildQueryString(
+        "latency_seconds",
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        QString("CEIL(LN(GREATEST(latency, 1)) / LN(%1))::INTEGER AS bucket, COUNT(*) AS count")
+        .arg(LatencySketch::gamma, 0, 'g', 17)
+    );
+    queryString += QString(" GROUP BY bucket");
+
+    success = SqlHelpers::execute(query, queryString);
+    if (success) {
+        while (success && query.next()) {
+            int bucketIndex = query.value(0).toInt(&success);
+            if (success) {
+                latencySketch.addBucket(bucketIndex, query.value(1).toULongLong(&success));
+            }
+        }
+
+        if (!success) {
+            logWrite(QString("Invalid bucket - LatencyInterfaceManager::getRawEntrySketch."), true);
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - LatencyInterfaceManager::getRawEntrySketch: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+}
+
+
+AggregatedLatencyEntry LatencyInterfaceManager::getBlockEntryStatistics(
+        bool&                            success,
+        QSqlDatabase&                    database,
+        CustomerCapabilities::CustomerId customerId,
+        HostScheme::HostSchemeId         hostSchemeId,
+        LatencyEntry::MonitorId          monitorId,
+        Region::RegionId                 regionId,
+        Server::ServerId                 serverId,
+        unsigned long long               startTimestamp,
+        unsigned long long               endTimestamp,
+        LatencySketch*                   latencySketch
+    ) {
+    AggregatedLatencyEntry result;
+
+    LatencyEntryList entries = getBlockEntries(
+        success,
+        database,
+        customerId,
+        hostSchemeId,
+        monitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp
+    );
+
+    if (success && !entries.isEmpty()) {
+        // Welford's method matches the population variance reported by the database for raw entries.
+        unsigned long                     sampleSize = 0;
+        double                            average    = 0;
+        double                            sumSquares = 0;
+        LatencyEntry::LatencyMicroseconds minimum    = std::numeric_limits<LatencyEntry::LatencyMicroseconds>::max();
+        LatencyEntry::LatencyMicroseconds maximum    = 0;
+
+        for (LatencyEntryList::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+            LatencyEntry::LatencyMicroseconds latency = it->latencyMicroseconds();
+
+            ++sampleSize;
+            double delta  = latency - average;
+            average      += delta / sampleSize;
+            sumSquares   += delta * (latency - average);
+
+            minimum = std::min(minimum, latency);
+            maximum = std::max(maximum, latency);
+
+            if (latencySketch != nullptr) {
+                latencySketch->addValue(latency);
+            }
+        }
+
+        result = AggregatedLatencyEntry(
+            monitorId,
+            serverId,
+            0,
+            0,
+            LatencyEntry::toZoranTimestamp(startTimestamp),
+            LatencyEntry::toZoranTimestamp(endTimestamp),
+            average,
+            sumSquares / sampleSize,
+            minimum,
+            maximum,
+            sampleSize
+        );
+    }
+
+    return result;
+}
+
+
 QString LatencyInterfaceManager::buildQueryString(
         const QString&                   tableName,
         CustomerCapabilities::CustomerId customerId,
@@ -788,6 +2989,50 @@ QString LatencyInterfaceManager::buildQueryString(
 }
 
 
+QString LatencyInterfaceManager::buildGroupedQueryString(
+        const QString&                               tableName,
+        CustomerCapabilities::CustomerId             customerId,
+        const LatencyInterfaceManager::MonitorIdSet& monitorIds,
+        Region::RegionId                             regionId,
+        Server::ServerId                             serverId,
+        unsigned long long                           startTimestamp,
+        unsigned long long                           endTimestamp,
+        const QString&                               selectClause
+    ) {
+    // The customer constraint guarantees a WHERE clause that the monitor constraint can extend.
+    QString result = buildQueryString(
+        tableName,
+        customerId,
+        HostScheme::invalidHostSchemeId,
+        Monitor::invalidMonitorId,
+        regionId,
+        serverId,
+        startTimestamp,
+        endTimestamp,
+        QString("monitor_id, ") + selectClause
+    );
+
+    if (!monitorIds.isEmpty()) {
+        QList<LatencyEntry::MonitorId> sortedMonitorIds = monitorIds.values();
+        std::sort(sortedMonitorIds.begin(), sortedMonitorIds.end());
+
+        QStringList monitorIdStrings;
+        for (  QList<LatencyEntry::MonitorId>::const_iterator it  = sortedMonitorIds.constBegin(),
+                                                              end = sortedMonitorIds.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            monitorIdStrings.append(QString::number(*it));
+        }
+
+        result += QString(" AND monitor_id IN (%1)").arg(monitorIdStrings.join(QChar(',')));
+    }
+
+    result += QString(" GROUP BY monitor_id");
+    return result;
+}
+
+
 LatencyEntry::ZoranTimeStamp LatencyInterfaceManager::toZoranTimestamp(unsigned long long unixTimestamp) {
     unsigned long long result =   unixTimestamp < LatencyEntry::startOfZoranEpoch
                                 ? 0
@@ -25,7 +25,13 @@
 #include <QJsonValue>
 #include <QImage>
 #include <QBuffer>
+#include <QDataStream>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtEndian>
 
+#include <cstdint>
+#include <limits>
 #include <iomanip>
 
 #include <rest_api_in_v1_response.h>
@@ -39,10 +45,20 @@
 #include "server.h"
 #include "monitor.h"
 #include "servers.h"
+#include "server_administrator.h"
 #include "monitors.h"
+#include "latency_sketch.h"
+#include "latency_block.h"
+#include "latency_purger.h"
 #include "latency_interface_manager.h"
 #include "plot_mailbox.h"
+#include "plot_cache.h"
 #include "latency_plotter.h"
+#include "json_stream_writer.h"
+#include "response_compressor.h"
+#include "request_tracer.h"
+#include "worker_pools.h"
+#include "traffic_recorder.h"
 #include "latency_manager.h"
 
 /***********************************************************************************************************************
@@ -52,13 +68,13 @@
 LatencyManager::LatencyRecord::LatencyRecord(
         const QByteArray&        secret,
         LatencyInterfaceManager* latencyInterfaceManager,
-        Servers*                 serverDatabaseApi
+        ServerAdministrator*     serverAdministrator
     ):RestApiInV1::InesonicBinaryRestHandler(
         secret
     ),currentLatencyInterfaceManager(
         latencyInterfaceManager
-    ),currentServers(
-        serverDatabaseApi
+    ),currentServerAdministrator(
+        serverAdministrator
     ) {
     Q_ASSERT(sizeof(Header) == 64);
     Q_ASSERT(sizeof(Entry) == 12);
@@ -69,10 +85,16 @@ LatencyManager::LatencyRecord::~LatencyRecord() {}
 
 
 RestApiInV1::Response* LatencyManager::LatencyRecord::processAuthenticatedRequest(
-        const QString&    /* path */,
+        const QString&    path,
         const QByteArray& request,
         unsigned          threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("LatencyManager::LatencyRecord"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
+    // Ingest is always admitted, the pools only account for it and reserve workers on its behalf.
+    WorkerPools::Admission admission(WorkerPools::Pool::INGEST);
+
     RestApiInV1::Response* response = nullptr;
 
     /* Our raw data is formatted as follows:
@@ -99,7 +121,12 @@ RestApiInV1::Response* LatencyManager::LatencyRecord::processAuthenticatedReques
      * |               |               |                | 3 = DEFUNCT.  See the definition of Server::Status for |
      * |               |               |                | mapping.                                               |
      * +---------------+---------------+----------------+--------------------------------------------------------+
-     * | 0x001D        | 0x003F        |  35            | reserved/spare                                         |
+     * | 0x001D        | 0x0024        |  8             | Batch sequence number, little endian.  Version 1 and   |
+     * |               |               |                | later.  Zero if the batch is not sequenced.            |
+     * +---------------+---------------+----------------+--------------------------------------------------------+
+     * | 0x0025        | 0x0025        |  1             | Compact payload framing.  Version 2 and later.         |
+     * +---------------+---------------+----------------+--------------------------------------------------------+
+     * | 0x0026        | 0x003F        |  26            | reserved/spare                                         |
      * +---------------+---------------+----------------+--------------------------------------------------------+
      * | 0x0040 + 12*N | 0x0043 + 12*N |  4             | Monitor ID for record N.                               |
      * +---------------+---------------+----------------+--------------------------------------------------------+
@@ -108,84 +135,126 @@ RestApiInV1::Response* LatencyManager::LatencyRecord::processAuthenticatedReques
      * | 0x0048 + 12*N | 0x004B + 12*N |  4             | Latency in microseconds for record N.                  |
      * +---------------+---------------+----------------+--------------------------------------------------------+
      *
-     * For details, see the structures Header and Entry.
+     * Version 2 and later headers are followed by a compact payload in place of the fixed size records.  The payload
+     * byte framing field in the header selects how the payload is stored:
+     *
+     *   0 - The payload is stored as is.
+     *   1 - The payload is zlib compressed with a 4 byte big endian uncompressed length prefix, as produced by
+     *       qCompress.
+     *
+     * The uncompressed payload is a sequence of unsigned LEB128 varints.  Signed values are zig-zag encoded:
+     *
+     *   - Base Zoran timestamp.
+     *   - Number of monitor groups.
+     *   - For each monitor group, in increasing monitor ID order:
+     *     - Monitor ID minus the previous group's monitor ID.  The first group holds the monitor ID.
+     *     - Number of records in the group.
+     *     - For each record:
+     *       - Signed timestamp delta from the previous record in the group.  The first record is relative to the
+     *         base timestamp.
+     *       - Latency in microseconds.
+     *
+     * For details, see the structures Header and Entry and the method decodeCompactEntries.
      */
 
     unsigned long payloadSize     = static_cast<unsigned long>(request.size());
     unsigned long monitorDataSize = payloadSize - sizeof(Header);
-    if (payloadSize >= sizeof(Header) && (monitorDataSize % sizeof(Entry) == 0)) {
+    const Header* header          = (
+          payloadSize >= sizeof(Header)
+        ? reinterpret_cast<const Header*>(request.constData())
+        : nullptr
+    );
+    bool          compactPayload  = (header != nullptr && header->version >= compactHeaderVersion);
+
+    if (header != nullptr && (compactPayload || monitorDataSize % sizeof(Entry) == 0)) {
         QJsonObject responseObject;
 
-        const std::uint8_t* requestData = reinterpret_cast<const std::uint8_t*>(request.data());
-        const Header*       header      = reinterpret_cast<const Header*>(requestData);
-
         QString identifier = QString::fromUtf8(reinterpret_cast<const char*>(header->identifier));
-        Server  server     = currentServers->getServer(identifier, threadId);
-
-        if (server.isValid()) {
-            bool success = true;
-
-            std::uint8_t   serverStatusValue    = header->serverStatusCode;
-            Server::Status newServerStatus      = static_cast<Server::Status>(serverStatusValue);
-            float          newCpuLoading        = static_cast<double>(header->cpuLoading) / 4096.0;
-            float          newMemoryLoading     = static_cast<double>(header->memoryLoading) / 65536.0;
-            float          newMonitorsPerSecond = static_cast<double>(header->monitorsPerSecond) / 256.0;
-
-            if (serverStatusValue < static_cast<std::uint8_t>(Server::Status::NUMBER_VALUES)) {
-                if (server.status() != newServerStatus                 ||
-                    server.cpuLoading() != newCpuLoading               ||
-                    server.memoryLoading() != newMemoryLoading         ||
-                    server.monitorsPerSecond() != newMonitorsPerSecond    ) {
-                    server.setStatus(newServerStatus);
-                    server.setCpuLoading(newCpuLoading);
-                    server.setMemoryLoading(newMemoryLoading);
-                    server.setMonitorsPerSecond(newMonitorsPerSecond);
-
-                    success = currentServers->modifyServer(server, threadId);
-                    if (!success) {
-                        responseObject.insert("status", "failed, could not update server status");
-                    }
-                }
-            } else {
-                responseObject.insert("status", "failed, invalid server status code");
-            }
 
-            if (success) {
+        std::uint8_t   serverStatusValue    = header->serverStatusCode;
+        Server::Status newServerStatus      = static_cast<Server::Status>(serverStatusValue);
+        float          newCpuLoading        = static_cast<double>(header->cpuLoading) / 4096.0;
+        float          newMemoryLoading     = static_cast<double>(header->memoryLoading) / 65536.0;
+        float          newMonitorsPerSecond = static_cast<double>(header->monitorsPerSecond) / 256.0;
+
+        if (serverStatusValue < static_cast<std::uint8_t>(Server::Status::NUMBER_VALUES)) {
+            // The report only updates the in-memory server table.  Changes are written to the database in bulk so
+            // recording latency never waits on server metadata queries.
+            Server server = currentServerAdministrator->recordServerReport(
+                identifier,
+                newServerStatus,
+                newMonitorsPerSecond,
+                newCpuLoading,
+                newMemoryLoading,
+                threadId
+            );
+
+            if (server.isValid()) {
                 Server::ServerId  serverId         = server.serverId();
                 Region::RegionId  regionId         = server.regionId();
                 LatencyInterface* latencyInterface = currentLatencyInterfaceManager->getLatencyInterface(regionId);
-                unsigned long     numberMonitors   = monitorDataSize / sizeof(Entry);
-                const Entry*      entry            = reinterpret_cast<const Entry*>(requestData + sizeof(Header));
-
-                for (unsigned long i=0 ; i<numberMonitors ; ++i) {
-                    latencyInterface->addEntry(
-                        entry->monitorId,
-                        serverId,
-                        entry->timestamp,
-                        entry->latencyMicroseconds
+                std::uint64_t     batchSequence    = (
+                      header->version >= sequencedHeaderVersion
+                    ? header->batchSequence
+                    : 0
+                );
+
+                // Compact payloads are expanded to the fixed entry layout so both formats share the bulk append path.
+                QByteArray    entryData      = request;
+                unsigned long entryOffset    = sizeof(Header);
+                unsigned long numberMonitors = monitorDataSize / sizeof(Entry);
+                bool          validPayload   = true;
+                if (compactPayload) {
+                    validPayload   = decodeCompactEntries(*header, request, entryData);
+                    entryOffset    = 0;
+                    numberMonitors = static_cast<unsigned long>(entryData.size()) / sizeof(Entry);
+                }
+
+                if (validPayload) {
+                    // Retries of a batch that was already accepted are acknowledged without queueing the entries
+                    // again.
+                    std::uint64_t acknowledgedSequence = 0;
+                    bool          newBatch             = (
+                           batchSequence == 0
+                        || acceptSequence(serverId, batchSequence, acknowledgedSequence)
                     );
 
-                    ++entry;
-                }
+                    if (newBatch) {
+                        latencyInterface->addEntries(serverId, entryData, entryOffset, numberMonitors);
+                        latencyInterface->receivedEntries();
+                    }
 
-                latencyInterface->receivedEntries();
+                    LatencyInterface::IngestPressure pressure = latencyInterface->ingestPressure();
 
-                QString message = QString(
-                    "Received records from %1, status = %2, cpu = %3%, memory = %4%, m/s= %5, records = %6"
-                ).arg(identifier, Server::toString(newServerStatus))
-                 .arg(100.0 * newCpuLoading, 0, 'f', 2)
-                 .arg(100.0 * newMemoryLoading, 0, 'f', 2)
-                 .arg(newMonitorsPerSecond)
-                 .arg(numberMonitors);
+                    QString message = QString(
+                        "Received records from %1, status = %2, cpu = %3%, memory = %4%, m/s= %5, records = %6%7"
+                    ).arg(identifier, Server::toString(newServerStatus))
+                     .arg(100.0 * newCpuLoading, 0, 'f', 2)
+                     .arg(100.0 * newMemoryLoading, 0, 'f', 2)
+                     .arg(newMonitorsPerSecond)
+                     .arg(numberMonitors)
+                     .arg(newBatch ? QString() : QString(", duplicate batch %1").arg(batchSequence));
 
-                logWrite(message, false);
-            }
+                    logWrite(message, false);
 
-            if (success) {
-                responseObject.insert("status", "OK");
+                    if (batchSequence != 0) {
+                        responseObject.insert("acknowledged_sequence", static_cast<double>(acknowledgedSequence));
+                    }
+
+                    // Entries are always accepted.  A throttle status asks the polling server to hold and batch data
+                    // locally until the suggested interval has elapsed.
+                    responseObject.insert("status", pressure.throttled ? "throttle" : "OK");
+                    responseObject.insert("queue_depth", static_cast<double>(pressure.queueDepth));
+                    responseObject.insert("retry_after", static_cast<double>(pressure.retryAfterSeconds));
+                } else {
+                    logWrite(QString("Invalid compact latency payload from %1").arg(identifier), true);
+                    responseObject.insert("status", "failed, invalid payload");
+                }
+            } else {
+                responseObject.insert("status", "failed, unknown server");
             }
         } else {
-            responseObject.insert("status", "failed, unknown server");
+            responseObject.insert("status", "failed, invalid server status code");
         }
 
         response = new RestApiInV1::JsonResponse(responseObject);
@@ -196,6 +265,153 @@ RestApiInV1::Response* LatencyManager::LatencyRecord::processAuthenticatedReques
     return response;
 }
 
+
+bool LatencyManager::LatencyRecord::decodeCompactEntries(
+        const Header&     header,
+        const QByteArray& request,
+        QByteArray&       entries
+    ) {
+    const char*   payloadData = request.constData() + sizeof(Header);
+    unsigned long payloadSize = static_cast<unsigned long>(request.size()) - sizeof(Header);
+    QByteArray    payload;
+    bool          success;
+
+    if (header.payloadFraming == uncompressedFraming) {
+        payload = QByteArray::fromRawData(payloadData, static_cast<int>(payloadSize));
+        success = true;
+    } else if (header.payloadFraming == zlibFraming && payloadSize > 4) {
+        // The length prefix is checked before inflating so a hostile payload can not force a large allocation.
+        std::uint32_t uncompressedSize = qFromBigEndian<std::uint32_t>(payloadData);
+        if (uncompressedSize > 0 && uncompressedSize <= maximumCompactPayloadSize) {
+            payload = qUncompress(reinterpret_cast<const uchar*>(payloadData), static_cast<int>(payloadSize));
+            success = (static_cast<std::uint32_t>(payload.size()) == uncompressedSize);
+        } else {
+            success = false;
+        }
+    } else {
+        success = false;
+    }
+
+    const std::uint8_t* current       = reinterpret_cast<const std::uint8_t*>(payload.constData());
+    const std::uint8_t* end           = current + payload.size();
+    std::uint64_t       baseTimestamp = 0;
+    std::uint64_t       numberGroups  = 0;
+
+    if (success) {
+        success = (
+               LatencyBlock::readVarint(current, end, baseTimestamp)
+            && LatencyBlock::readVarint(current, end, numberGroups)
+            && baseTimestamp <= std::numeric_limits<std::uint32_t>::max()
+            && numberGroups <= static_cast<std::uint64_t>(end - current) / 2
+        );
+    }
+
+    if (success) {
+        // Every record takes at least two bytes which bounds the output before any record is decoded.
+        entries.resize(static_cast<int>(sizeof(Entry) * (static_cast<std::uint64_t>(end - current) / 2)));
+
+        Entry*        output        = reinterpret_cast<Entry*>(entries.data());
+        unsigned long numberEntries = 0;
+        std::uint64_t monitorId     = 0;
+
+        for (std::uint64_t group=0 ; success && group<numberGroups ; ++group) {
+            std::uint64_t monitorDelta;
+            std::uint64_t numberRecords;
+
+            success = (
+                   LatencyBlock::readVarint(current, end, monitorDelta)
+                && LatencyBlock::readVarint(current, end, numberRecords)
+                && (group == 0 || monitorDelta > 0)
+                && monitorId + monitorDelta <= std::numeric_limits<std::uint32_t>::max()
+                && numberRecords <= static_cast<std::uint64_t>(end - current) / 2
+            );
+
+            monitorId += monitorDelta;
+
+            std::int64_t timestamp = static_cast<std::int64_t>(baseTimestamp);
+            for (std::uint64_t record=0 ; success && record<numberRecords ; ++record) {
+                std::uint64_t encodedDelta;
+                std::uint64_t latency;
+
+                success = (
+                       LatencyBlock::readVarint(current, end, encodedDelta)
+                    && LatencyBlock::readVarint(current, end, latency)
+                    && encodedDelta <= 0x1FFFFFFFFULL
+                    && latency <= std::numeric_limits<std::uint32_t>::max()
+                );
+
+                if (success) {
+                    std::int64_t magnitude = static_cast<std::int64_t>(encodedDelta >> 1);
+                    std::int64_t delta     = (encodedDelta & 1) != 0 ? -magnitude - 1 : magnitude;
+
+                    timestamp += delta;
+                    success    = (timestamp >= 0 && timestamp <= std::numeric_limits<std::uint32_t>::max());
+                }
+
+                if (success) {
+                    output[numberEntries].monitorId           = static_cast<std::uint32_t>(monitorId);
+                    output[numberEntries].timestamp           = static_cast<std::uint32_t>(timestamp);
+                    output[numberEntries].latencyMicroseconds = static_cast<std::uint32_t>(latency);
+                    ++numberEntries;
+                }
+            }
+        }
+
+        if (success && current == end) {
+            entries.resize(static_cast<int>(sizeof(Entry) * numberEntries));
+        } else {
+            success = false;
+            entries.clear();
+        }
+    }
+
+    return success;
+}
+
+
+bool LatencyManager::LatencyRecord::acceptSequence(
+        Server::ServerId serverId,
+        std::uint64_t    batchSequence,
+        std::uint64_t&   acknowledgedSequence
+    ) {
+    bool result;
+
+    QMutexLocker sequenceLocker(&sequenceMutex);
+    SequenceWindow& window = sequenceWindows[serverId];
+
+    if (batchSequence > window.highestSequence) {
+        std::uint64_t shift = batchSequence - window.highestSequence;
+        if (window.highestSequence == 0 || shift > sequenceWindowSize) {
+            window.acceptedMask = 0;
+        } else {
+            // The previous highest sequence number becomes bit shift - 1 in the window.
+            window.acceptedMask = shift == sequenceWindowSize ? 0 : (window.acceptedMask << shift);
+            window.acceptedMask |= static_cast<std::uint64_t>(1) << (shift - 1);
+        }
+
+        window.highestSequence = batchSequence;
+        result                 = true;
+    } else if (batchSequence == window.highestSequence) {
+        result = false;
+    } else {
+        std::uint64_t offset = window.highestSequence - 1 - batchSequence;
+        if (offset < sequenceWindowSize) {
+            std::uint64_t bit = static_cast<std::uint64_t>(1) << offset;
+
+            result               = (window.acceptedMask & bit) == 0;
+            window.acceptedMask |= bit;
+        } else {
+            // Far below the window so the server has restarted its count.
+            window.highestSequence = batchSequence;
+            window.acceptedMask    = 0;
+            result                 = true;
+        }
+    }
+
+    acknowledgedSequence = window.highestSequence;
+    return result;
+}
+
 /***********************************************************************************************************************
 * LatencyManager::LatencyGet
 */
@@ -203,33 +419,40 @@ RestApiInV1::Response* LatencyManager::LatencyRecord::processAuthenticatedReques
 LatencyManager::LatencyGet::LatencyGet(
         const QByteArray&        secret,
         LatencyInterfaceManager* latencyInterfaceManager,
-        Servers*                 serverDatabaseApi,
-        Monitors*                monitorDatabaseApi
-    ):RestApiInV1::InesonicRestHandler(
+        ServerAdministrator*     serverAdministrator,
+        Monitors*                monitorDatabaseApi,
+        ResponseCompressor*      responseCompressor
+    ):RestApiInV1::InesonicBinaryRestHandler(
         secret
     ),currentLatencyInterfaceManager(
         latencyInterfaceManager
-    ),currentServers(
-        serverDatabaseApi
+    ),currentServerAdministrator(
+        serverAdministrator
     ),currentMonitors(
         monitorDatabaseApi
+    ),currentResponseCompressor(
+        responseCompressor
     ) {}
 
 
 LatencyManager::LatencyGet::~LatencyGet() {}
 
 
-RestApiInV1::JsonResponse LatencyManager::LatencyGet::processAuthenticatedRequest(
-        const QString&       /* path */,
-        const QJsonDocument& request,
-        unsigned             threadId
+RestApiInV1::Response* LatencyManager::LatencyGet::processAuthenticatedRequest(
+        const QString&    path,
+        const QByteArray& request,
+        unsigned          threadId
     ) {
-    RestApiInV1::JsonResponse response;
+    RequestTracer::Trace requestTrace(QString("LatencyManager::LatencyGet"), threadId);
+    TrafficRecorder::record(path, 0, request);
 
-    if (request.isObject()) {
+    RestApiInV1::Response* response = nullptr;
+
+    QJsonDocument document = QJsonDocument::fromJson(request);
+    if (document.isObject()) {
         QJsonObject                      responseObject;
         bool                             success        = true;
-        QJsonObject                      object         = request.object();
+        QJsonObject                      object         = document.object();
         unsigned                         numberFields   = 0;
         CustomerCapabilities::CustomerId customerId     = CustomerCapabilities::invalidCustomerId;
         Monitor::MonitorId               monitorId      = Monitor::invalidMonitorId;
@@ -237,6 +460,11 @@ RestApiInV1::JsonResponse LatencyManager::LatencyGet::processAuthenticatedReques
         Region::RegionId                 regionId       = Region::invalidRegionId;
         unsigned long long               startTimestamp = 0;
         unsigned long long               endTimestamp   = std::numeric_limits<unsigned long long>::max();
+        unsigned long                    resolution     = 0;
+        unsigned long                    maximumPoints  = 0;
+        bool                             downsample     = false;
+        bool                             binary         = false;
+        ResponseCompressor::Encoding     encoding       = ResponseCompressor::Encoding::IDENTITY;
 
         if (object.contains("customer_id")) {
             double customerIdDouble = object.value("customer_id").toDouble(-1);
@@ -320,42 +548,135 @@ RestApiInV1::JsonResponse LatencyManager::LatencyGet::processAuthenticatedReques
             ++numberFields;
         }
 
-        if (numberFields == static_cast<unsigned>(object.size())) {
-            LatencyInterfaceManager::LatencyEntryLists result = currentLatencyInterfaceManager->getLatencyEntries(
-                customerId,
-                HostScheme::invalidHostSchemeId,
-                monitorId,
-                regionId,
-                serverId,
-                startTimestamp,
-                endTimestamp,
-                threadId
-            );
+        if (object.contains("resolution")) {
+            if (success) {
+                double resolutionDouble = object.value("resolution").toDouble(-1);
+                if (resolutionDouble >= 1 && resolutionDouble <= 0xFFFFFFFF) {
+                    resolution = static_cast<unsigned long>(resolutionDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid resolution");
+                }
+            }
+
+            downsample = true;
+            ++numberFields;
+        }
+
+        if (object.contains("max_points")) {
+            if (success) {
+                double maximumPointsDouble = object.value("max_points").toDouble(-1);
+                if (maximumPointsDouble >= 1 && maximumPointsDouble <= 1000000) {
+                    maximumPoints = static_cast<unsigned long>(maximumPointsDouble);
+                } else {
+                    success = false;
+                    responseObject.insert("status", "failed, invalid max points");
+                }
+            }
 
-            LatencyInterfaceManager::LatencyEntryList           rawEntries        = result.first;
-            LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedEntries = result.second;
+            downsample = true;
+            ++numberFields;
+        }
+
+        if (object.contains("accept_encoding")) {
+            encoding = ResponseCompressor::selectEncoding(object.value("accept_encoding").toString());
+            ++numberFields;
+        }
+
+        if (object.contains("format")) {
+            QString format = object.value("format").toString().toLower();
+            if (format == "binary") {
+                binary = true;
+            } else if (format != "json") {
+                success = false;
+                responseObject.insert("status", "failed, invalid format");
+            }
+
+            ++numberFields;
+        }
+
+        WorkerPools::Admission admission(WorkerPools::Pool::ADMIN);
+        if (success && !admission.admitted()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
+        if (!success) {
+            response = new RestApiInV1::JsonResponse(responseObject);
+        } else if (numberFields == static_cast<unsigned>(object.size())) {
+            LatencyInterfaceManager::LatencyEntryList           rawEntries;
+            LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedEntries;
+            unsigned long                                       interval = 0;
+
+            if (downsample) {
+                aggregatedEntries = currentLatencyInterfaceManager->getLatencyBuckets(
+                    customerId,
+                    HostScheme::invalidHostSchemeId,
+                    monitorId,
+                    regionId,
+                    serverId,
+                    startTimestamp,
+                    endTimestamp,
+                    resolution,
+                    maximumPoints,
+                    threadId,
+                    &interval
+                );
+            } else {
+                LatencyInterfaceManager::LatencyEntryLists result = currentLatencyInterfaceManager->getLatencyEntries(
+                    customerId,
+                    HostScheme::invalidHostSchemeId,
+                    monitorId,
+                    regionId,
+                    serverId,
+                    startTimestamp,
+                    endTimestamp,
+                    threadId
+                );
+
+                rawEntries        = result.first;
+                aggregatedEntries = result.second;
+            }
 
-            Servers::ServersById serversById    = currentServers->getServersById(threadId);
+            Servers::ServersById serversById    = currentServerAdministrator->getServersById(threadId);
             Monitors::MonitorsById monitorsById = currentMonitors->getMonitorsById(threadId);
 
-            responseObject.insert("status", "OK");
-            responseObject.insert("recent", convertToJson(rawEntries, serversById, monitorsById, true, true, true));
-            responseObject.insert(
-                "aggregated",
-                convertToJson(
-                    aggregatedEntries,
-                    serversById,
-                    monitorsById,
-                    true,
-                    true,
-                    true
-                )
-            );
+            if (binary) {
+                QByteArray contentType = binaryLatencyContentType;
+                QByteArray data        = currentResponseCompressor->compress(
+                    encoding,
+                    contentType,
+                    convertToBinary(rawEntries, aggregatedEntries, serversById, monitorsById, true, true, true)
+                );
 
-            response = RestApiInV1::JsonResponse(responseObject);
+                response = new RestApiInV1::BinaryResponse(contentType, data);
+            } else {
+                // The listing is streamed into the response so no intermediate QJsonArray of every entry is built.
+                RequestTracer::Span jsonSpan(RequestTracer::Phase::JSON, threadId);
+                JsonStreamWriter writer(estimatedJsonSize(rawEntries, aggregatedEntries));
+                writer.beginObject();
+                writer.insert("status", "OK");
+
+                if (downsample) {
+                    writer.insert("resolution", static_cast<double>(interval));
+                }
+
+                writeJson(writer, "recent", rawEntries, serversById, monitorsById, true, true, true);
+                writeJson(writer, "aggregated", aggregatedEntries, serversById, monitorsById, true, true, true);
+                writer.endObject();
+
+                QByteArray contentType("application/json");
+                QByteArray data = currentResponseCompressor->compress(encoding, contentType, writer.data());
+
+                response = new RestApiInV1::BinaryResponse(contentType, data);
+            }
         }
     }
 
+    if (response == nullptr) {
+        response = new RestApiInV1::BinaryResponse(StatusCode::BAD_REQUEST);
+    }
+
     return response;
 }
 
@@ -377,10 +698,13 @@ LatencyManager::LatencyPurge::~LatencyPurge() {}
 
 
 RestApiInV1::JsonResponse LatencyManager::LatencyPurge::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("LatencyManager::LatencyPurge"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isArray()) {
@@ -404,9 +728,10 @@ RestApiInV1::JsonResponse LatencyManager::LatencyPurge::processAuthenticatedRequ
 
         if (success) {
             if (static_cast<unsigned long>(customerIds.size()) == numberCustomerIds) {
-                success = currentLatencyInterfaceManager->deleteByCustomerId(customerIds, threadId);
-                if (success) {
+                LatencyPurger::JobId jobId = currentLatencyInterfaceManager->startPurge(customerIds, threadId);
+                if (jobId != LatencyPurger::invalidJobId) {
                     responseObject.insert("status", "OK");
+                    responseObject.insert("job_id", static_cast<double>(jobId));
                 } else {
                     responseObject.insert("status", "failed");
                 }
@@ -423,6 +748,67 @@ RestApiInV1::JsonResponse LatencyManager::LatencyPurge::processAuthenticatedRequ
     return response;
 }
 
+/***********************************************************************************************************************
+* LatencyManager::LatencyPurgeStatus
+*/
+
+LatencyManager::LatencyPurgeStatus::LatencyPurgeStatus(
+        const QByteArray&        secret,
+        LatencyInterfaceManager* latencyInterfaceManager
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentLatencyInterfaceManager(
+        latencyInterfaceManager
+    ) {}
+
+
+LatencyManager::LatencyPurgeStatus::~LatencyPurgeStatus() {}
+
+
+RestApiInV1::JsonResponse LatencyManager::LatencyPurgeStatus::processAuthenticatedRequest(
+        const QString&       path,
+        const QJsonDocument& request,
+        unsigned             threadId
+    ) {
+    RequestTracer::Trace requestTrace(QString("LatencyManager::LatencyPurgeStatus"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    if (request.isObject()) {
+        QJsonObject responseObject;
+        QJsonObject object = request.object();
+
+        if (object.size() == 1 && object.contains("job_id")) {
+            double jobIdDouble = object.value("job_id").toDouble(-1);
+            if (jobIdDouble >= 1.0) {
+                LatencyPurger::JobStatus jobStatus;
+                bool success = currentLatencyInterfaceManager->getPurgeStatus(
+                    static_cast<LatencyPurger::JobId>(jobIdDouble),
+                    jobStatus,
+                    threadId
+                );
+
+                if (success) {
+                    responseObject.insert("status", "OK");
+                    responseObject.insert("job_status", LatencyPurger::toString(jobStatus.status).toLower());
+                    responseObject.insert("rows_deleted", static_cast<double>(jobStatus.rowsDeleted));
+                    responseObject.insert("tables_completed", static_cast<int>(jobStatus.numberTablesCompleted));
+                    responseObject.insert("number_tables", static_cast<int>(jobStatus.numberTables));
+                } else {
+                    responseObject.insert("status", "failed, unknown job ID");
+                }
+            } else {
+                responseObject.insert("status", "failed, invalid job ID");
+            }
+
+            response = RestApiInV1::JsonResponse(responseObject);
+        }
+    }
+
+    return response;
+}
+
 /***********************************************************************************************************************
 * LatencyManager::LatencyPlot
 */
@@ -441,10 +827,13 @@ LatencyManager::LatencyPlot::~LatencyPlot() {}
 
 
 RestApiInV1::Response* LatencyManager::LatencyPlot::processAuthenticatedRequest(
-        const QString&    /* path */,
+        const QString&    path,
         const QByteArray& request,
         unsigned          threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("LatencyManager::LatencyPlot"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
     RestApiInV1::Response* response = nullptr;
 
     QJsonDocument document = QJsonDocument::fromJson(request);
@@ -463,6 +852,7 @@ RestApiInV1::Response* LatencyManager::LatencyPlot::processAuthenticatedRequest(
         double                           minimumLatency = -1;
         double                           maximumLatency = -1;
         bool                             logScale       = false;
+        bool                             revalidate     = false;
         unsigned                         width          = LatencyPlotter::defaultWidth;
         unsigned                         height         = LatencyPlotter::defaultHeight;
         QString                          plotType("history");
@@ -474,6 +864,7 @@ RestApiInV1::Response* LatencyManager::LatencyPlot::processAuthenticatedRequest(
         QString                          titleFont;
         QString                          axisTitleFont;
         QString                          axisLabelFont;
+        QByteArray                       ifNoneMatch;
 
         if (object.contains("customer_id")) {
             double customerIdDouble = object.value("customer_id").toDouble(-1);
@@ -653,81 +1044,129 @@ RestApiInV1::Response* LatencyManager::LatencyPlot::processAuthenticatedRequest(
             ++numberFields;
         }
 
+        if (object.contains("if_none_match")) {
+            ifNoneMatch = object.value("if_none_match").toString().toUtf8();
+            revalidate  = true;
+            ++numberFields;
+        }
+
         if (numberFields == static_cast<unsigned>(object.size())) {
+            WorkerPools::Admission admission(WorkerPools::Pool::PLOT);
+            if (success && !admission.admitted()) {
+                success = false;
+                responseObject.insert("status", "failed, busy");
+            }
+
             if (success) {
-                QImage image;
-
-                if (plotType == "history") {
-                    PlotMailbox& mailbox = currentLatencyPlotter->requestHistoryPlot(
-                        threadId,
-                        customerId,
-                        regionId,
-                        serverId,
-                        hostSchemeId,
-                        monitorId,
-                        startTimestamp,
-                        endTimestamp,
-                        title,
-                        xAxisLabel,
-                        yAxisLabel,
-                        dateFormat,
-                        titleFont,
-                        axisTitleFont,
-                        axisLabelFont,
-                        maximumLatency,
-                        minimumLatency,
-                        logScale,
-                        width,
-                        height
-                    );
+                QByteArray  cacheKey;
+                QDataStream keyStream(&cacheKey, QIODevice::OpenModeFlag::WriteOnly);
+                keyStream << plotType << plotFormat << static_cast<quint64>(customerId)
+                          << static_cast<quint32>(regionId) << static_cast<quint32>(serverId)
+                          << static_cast<quint64>(hostSchemeId) << static_cast<quint64>(monitorId)
+                          << static_cast<quint64>(startTimestamp) << static_cast<quint64>(endTimestamp)
+                          << title << xAxisLabel << yAxisLabel << dateFormat
+                          << titleFont << axisTitleFont << axisLabelFont
+                          << minimumLatency << maximumLatency << logScale
+                          << static_cast<quint32>(width) << static_cast<quint32>(height);
+
+                // The version is read before rendering so data arriving mid-render invalidates the new entry.
+                PlotCache&         plotCache   = currentLatencyPlotter->plotCache();
+                unsigned long long dataVersion = currentLatencyPlotter->dataVersion(monitorId);
+                PlotCache::Plot    plot;
+
+                if (!plotCache.getPlot(cacheKey, dataVersion, plot)) {
+                    QImage image;
+
+                    if (!currentLatencyPlotter->acceptingPlots()) {
+                        success = false;
+                        responseObject.insert("status", "failed, busy");
+                    } else if (plotType == "history") {
+                        RequestTracer::Span plotSpan(RequestTracer::Phase::PLOT, threadId);
+                        PlotMailbox& mailbox = currentLatencyPlotter->requestHistoryPlot(
+                            threadId,
+                            customerId,
+                            regionId,
+                            serverId,
+                            hostSchemeId,
+                            monitorId,
+                            startTimestamp,
+                            endTimestamp,
+                            title,
+                            xAxisLabel,
+                            yAxisLabel,
+                            dateFormat,
+                            titleFont,
+                            axisTitleFont,
+                            axisLabelFont,
+                            maximumLatency,
+                            minimumLatency,
+                            logScale,
+                            width,
+                            height
+                        );
 
-                    image = mailbox.waitForImage();
-                } else if (plotType == "histogram") {
-                    PlotMailbox& mailbox = currentLatencyPlotter->requestHistogramPlot(
-                        threadId,
-                        customerId,
-                        regionId,
-                        serverId,
-                        hostSchemeId,
-                        monitorId,
-                        startTimestamp,
-                        endTimestamp,
-                        title,
-                        xAxisLabel,
-                        yAxisLabel,
-                        titleFont,
-                        axisTitleFont,
-                        axisLabelFont,
-                        maximumLatency,
-                        minimumLatency,
-                        width,
-                        height
-                    );
+                        image = mailbox.waitForImage();
+                    } else if (plotType == "histogram") {
+                        RequestTracer::Span plotSpan(RequestTracer::Phase::PLOT, threadId);
+                        PlotMailbox& mailbox = currentLatencyPlotter->requestHistogramPlot(
+                            threadId,
+                            customerId,
+                            regionId,
+                            serverId,
+                            hostSchemeId,
+                            monitorId,
+                            startTimestamp,
+                            endTimestamp,
+                            title,
+                            xAxisLabel,
+                            yAxisLabel,
+                            titleFont,
+                            axisTitleFont,
+                            axisLabelFont,
+                            maximumLatency,
+                            minimumLatency,
+                            width,
+                            height
+                        );
 
-                    image = mailbox.waitForImage();
-                } else {
-                    success = false;
-                    responseObject.insert("status", "invalid plot type");
+                        image = mailbox.waitForImage();
+                    } else {
+                        success = false;
+                        responseObject.insert("status", "invalid plot type");
+                    }
+
+                    if (success) {
+                        QByteArray plotData;
+                        QBuffer    buffer(&plotData);
+                        buffer.open(QBuffer::OpenModeFlag::WriteOnly);
+
+                        success = image.save(&buffer, plotFormat.toLocal8Bit().data());
+                        if (!success) {
+                            responseObject.insert("status", "failed, could not convert to image");
+                        } else {
+                            plot = plotCache.addPlot(cacheKey, dataVersion, plotData);
+                        }
+                    }
                 }
 
                 if (success) {
-                    QByteArray plotData;
-                    QBuffer    buffer(&plotData);
-                    buffer.open(QBuffer::OpenModeFlag::WriteOnly);
-
-                    success = image.save(&buffer, plotFormat.toLocal8Bit().data());
-                    if (!success) {
-                        responseObject.insert("status", "failed, could not convert to image");
+                    QByteArray contentType = QString("image/%1").arg(plotFormat).toLower().toUtf8();
+                    if (revalidate) {
+                        responseObject.insert("etag", QString::fromUtf8(plot.etag));
+                        if (plot.etag == ifNoneMatch) {
+                            responseObject.insert("status", "OK, not modified");
+                        } else {
+                            responseObject.insert("status", "OK");
+                            responseObject.insert("content_type", QString::fromUtf8(contentType));
+                            responseObject.insert("image", QString::fromLatin1(plot.imageData.toBase64()));
+                        }
                     } else {
-                        response = new RestApiInV1::BinaryResponse(
-                            QString("image/%1").arg(plotFormat).toLower().toUtf8(),
-                            plotData
-                        );
+                        response = new RestApiInV1::BinaryResponse(contentType, plot.imageData);
                     }
                 }
             }
 
-            if (!success) {
+            if (!success || revalidate) {
                 response = new RestApiInV1::JsonResponse(responseObject);
             }
         }
@@ -758,10 +1197,13 @@ LatencyManager::LatencyStatistics::~LatencyStatistics() {}
 
 
 RestApiInV1::JsonResponse LatencyManager::LatencyStatistics::processAuthenticatedRequest(
-        const QString&       /* path */,
+        const QString&       path,
         const QJsonDocument& request,
         unsigned             threadId
     ) {
+    RequestTracer::Trace requestTrace(QString("LatencyManager::LatencyStatistics"), threadId);
+    TrafficRecorder::record(path, 0, request);
+
     RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
 
     if (request.isObject()) {
@@ -858,7 +1300,12 @@ RestApiInV1::JsonResponse LatencyManager::LatencyStatistics::processAuthenticate
             ++numberFields;
         }
 
-        if (numberFields == static_cast<unsigned>(object.size()) && success) {
+        WorkerPools::Admission admission(WorkerPools::Pool::ADMIN);
+        if (numberFields == static_cast<unsigned>(object.size()) && success && !admission.admitted()) {
+            responseObject.insert("status", "failed, busy");
+            response = RestApiInV1::JsonResponse(responseObject);
+        } else if (numberFields == static_cast<unsigned>(object.size()) && success) {
+            LatencySketch          latencySketch;
             AggregatedLatencyEntry result = currentLatencyInterfaceManager->getLatencyStatistics(
                 customerId,
                 HostScheme::invalidHostSchemeId,
@@ -867,7 +1314,8 @@ RestApiInV1::JsonResponse LatencyManager::LatencyStatistics::processAuthenticate
                 serverId,
                 startTimestamp,
                 endTimestamp,
-                threadId
+                threadId,
+                &latencySketch
             );
 
             if (result.numberSamples() > 0) {
@@ -880,6 +1328,13 @@ RestApiInV1::JsonResponse LatencyManager::LatencyStatistics::processAuthenticate
                 statisticsObject.insert("maximum", result.maximumLatency() * 1.0E-6);
                 statisticsObject.insert("number_samples", static_cast<double>(result.numberSamples()));
 
+                if (!latencySketch.isEmpty()) {
+                    statisticsObject.insert("p50", latencySketch.quantile(0.50) * 1.0E-6);
+                    statisticsObject.insert("p90", latencySketch.quantile(0.90) * 1.0E-6);
+                    statisticsObject.insert("p95", latencySketch.quantile(0.95) * 1.0E-6);
+                    statisticsObject.insert("p99", latencySketch.quantile(0.99) * 1.0E-6);
+                }
+
                 responseObject.insert("statistics", statisticsObject);
             } else {
                 responseObject.insert("status", "failed");
@@ -899,15 +1354,17 @@ RestApiInV1::JsonResponse LatencyManager::LatencyStatistics::processAuthenticate
 const QString LatencyManager::latencyRecordPath("/latency/record");
 const QString LatencyManager::latencyGetPath("/latency/get");
 const QString LatencyManager::latencyPurgePath("/latency/purge");
+const QString LatencyManager::latencyPurgeStatusPath("/latency/purge/status");
 const QString LatencyManager::latencyPlotPath("/latency/plot");
 const QString LatencyManager::latencyStatisticsPath("/latency/statistics");
 
 LatencyManager::LatencyManager(
         RestApiInV1::Server*     restApiServer,
         LatencyInterfaceManager* latencyInterfaceManager,
-        Servers*                 serverDatabaseApi,
+        ServerAdministrator*     serverAdministrator,
         Monitors*                monitorDatabaseApi,
         LatencyPlotter*          latencyPlotter,
+        ResponseCompressor*      responseCompressor,
         const QByteArray&        secret,
         QObject*                 parent
     ):QObject(
@@ -915,15 +1372,19 @@ LatencyManager::LatencyManager(
     ),latencyRecord(
         secret,
         latencyInterfaceManager,
-        serverDatabaseApi
+        serverAdministrator
     ),latencyGet(
         secret,
         latencyInterfaceManager,
-        serverDatabaseApi,
-        monitorDatabaseApi
+        serverAdministrator,
+        monitorDatabaseApi,
+        responseCompressor
     ),latencyPurge(
         secret,
         latencyInterfaceManager
+    ),latencyPurgeStatus(
+        secret,
+        latencyInterfaceManager
     ),latencyPlot(
         secret,
         latencyPlotter
@@ -934,6 +1395,7 @@ LatencyManager::LatencyManager(
     restApiServer->registerHandler(&latencyRecord, RestApiInV1::Handler::Method::POST, latencyRecordPath);
     restApiServer->registerHandler(&latencyGet, RestApiInV1::Handler::Method::POST, latencyGetPath);
     restApiServer->registerHandler(&latencyPurge, RestApiInV1::Handler::Method::POST, latencyPurgePath);
+    restApiServer->registerHandler(&latencyPurgeStatus, RestApiInV1::Handler::Method::POST, latencyPurgeStatusPath);
     restApiServer->registerHandler(&latencyPlot, RestApiInV1::Handler::Method::POST, latencyPlotPath);
     restApiServer->registerHandler(&latencyStatistics, RestApiInV1::Handler::Method::POST, latencyStatisticsPath);
 }
@@ -946,6 +1408,7 @@ void LatencyManager::setSecret(const QByteArray& newSecret) {
     latencyRecord.setSecret(newSecret);
     latencyGet.setSecret(newSecret);
     latencyPurge.setSecret(newSecret);
+    latencyPurgeStatus.setSecret(newSecret);
     latencyPlot.setSecret(newSecret);
     latencyStatistics.setSecret(newSecret);
 }
@@ -27,6 +27,7 @@
 #include <QPair>
 #include <QList>
 #include <QImage>
+#include <QElapsedTimer>
 #include <QGraphicsScene>
 #include <QGraphicsLineItem>
 #include <QtCharts>
@@ -45,24 +46,240 @@
 #include "short_latency_entry.h"
 #include "latency_entry.h"
 #include "aggregated_latency_entry.h"
+#include "latency_populations.h"
+#include "latency_sketch.h"
 #include "latency_interface_manager.h"
+#include "plot_cache.h"
 #include "plotter_base.h"
+#include "memory_governor.h"
 #include "latency_plotter.h"
 
+/***********************************************************************************************************************
+* LatencyPlotter::HistoryPlotJob
+*/
+
+LatencyPlotter::HistoryPlotJob::HistoryPlotJob(
+        LatencyPlotter*              plotter,
+        PlotMailbox*                 mailbox,
+        LatencyPlotter::ThreadId     threadId,
+        LatencyPlotter::CustomerId   customerId,
+        LatencyPlotter::RegionId     regionId,
+        LatencyPlotter::ServerId     serverId,
+        LatencyPlotter::HostSchemeId hostSchemeId,
+        LatencyPlotter::MonitorId    monitorId,
+        unsigned long long           startTimestamp,
+        unsigned long long           endTimestamp,
+        const QString&               titleText,
+        const QString&               xAxisTitle,
+        const QString&               yAxisTitle,
+        const QString&               dateFormatString,
+        const QString&               titleFont,
+        const QString&               axisTitleFont,
+        const QString&               axisLabelFont,
+        double                       maximumLatency,
+        double                       minimumLatency,
+        bool                         logScale,
+        unsigned                     width,
+        unsigned                     height
+    ):PlotWorkerPool::Job(
+        mailbox
+    ),currentPlotter(
+        plotter
+    ),currentThreadId(
+        threadId
+    ),currentCustomerId(
+        customerId
+    ),currentRegionId(
+        regionId
+    ),currentServerId(
+        serverId
+    ),currentHostSchemeId(
+        hostSchemeId
+    ),currentMonitorId(
+        monitorId
+    ),currentStartTimestamp(
+        startTimestamp
+    ),currentEndTimestamp(
+        endTimestamp
+    ),currentTitleText(
+        titleText
+    ),currentXAxisTitle(
+        xAxisTitle
+    ),currentYAxisTitle(
+        yAxisTitle
+    ),currentDateFormatString(
+        dateFormatString
+    ),currentTitleFont(
+        titleFont
+    ),currentAxisTitleFont(
+        axisTitleFont
+    ),currentAxisLabelFont(
+        axisLabelFont
+    ),currentMaximumLatency(
+        maximumLatency
+    ),currentMinimumLatency(
+        minimumLatency
+    ),currentLogScale(
+        logScale
+    ),currentWidth(
+        width
+    ),currentHeight(
+        height
+    ) {}
+
+
+LatencyPlotter::HistoryPlotJob::~HistoryPlotJob() {}
+
+
+void LatencyPlotter::HistoryPlotJob::run(unsigned databaseThreadId) {
+    currentPlotter->generateHistoryPlot(
+        currentThreadId,
+        currentCustomerId,
+        currentRegionId,
+        currentServerId,
+        currentHostSchemeId,
+        currentMonitorId,
+        currentStartTimestamp,
+        currentEndTimestamp,
+        currentTitleText,
+        currentXAxisTitle,
+        currentYAxisTitle,
+        currentDateFormatString,
+        currentTitleFont,
+        currentAxisTitleFont,
+        currentAxisLabelFont,
+        currentMaximumLatency,
+        currentMinimumLatency,
+        currentLogScale,
+        currentWidth,
+        currentHeight,
+        databaseThreadId
+    );
+}
+
+/***********************************************************************************************************************
+* LatencyPlotter::HistogramPlotJob
+*/
+
+LatencyPlotter::HistogramPlotJob::HistogramPlotJob(
+        LatencyPlotter*              plotter,
+        PlotMailbox*                 mailbox,
+        LatencyPlotter::ThreadId     threadId,
+        LatencyPlotter::CustomerId   customerId,
+        LatencyPlotter::RegionId     regionId,
+        LatencyPlotter::ServerId     serverId,
+        LatencyPlotter::HostSchemeId hostSchemeId,
+        LatencyPlotter::MonitorId    monitorId,
+        unsigned long long           startTimestamp,
+        unsigned long long           endTimestamp,
+        const QString&               titleText,
+        const QString&               xAxisTitle,
+        const QString&               yAxisTitle,
+        const QString&               titleFont,
+        const QString&               axisTitleFont,
+        const QString&               axisLabelFont,
+        double                       maximumLatency,
+        double                       minimumLatency,
+        unsigned                     width,
+        unsigned                     height
+    ):PlotWorkerPool::Job(
+        mailbox
+    ),currentPlotter(
+        plotter
+    ),currentThreadId(
+        threadId
+    ),currentCustomerId(
+        customerId
+    ),currentRegionId(
+        regionId
+    ),currentServerId(
+        serverId
+    ),currentHostSchemeId(
+        hostSchemeId
+    ),currentMonitorId(
+        monitorId
+    ),currentStartTimestamp(
+        startTimestamp
+    ),currentEndTimestamp(
+        endTimestamp
+    ),currentTitleText(
+        titleText
+    ),currentXAxisTitle(
+        xAxisTitle
+    ),currentYAxisTitle(
+        yAxisTitle
+    ),currentTitleFont(
+        titleFont
+    ),currentAxisTitleFont(
+        axisTitleFont
+    ),currentAxisLabelFont(
+        axisLabelFont
+    ),currentMaximumLatency(
+        maximumLatency
+    ),currentMinimumLatency(
+        minimumLatency
+    ),currentWidth(
+        width
+    ),currentHeight(
+        height
+    ) {}
+
+
+LatencyPlotter::HistogramPlotJob::~HistogramPlotJob() {}
+
+
+void LatencyPlotter::HistogramPlotJob::run(unsigned databaseThreadId) {
+    currentPlotter->generateHistogramPlot(
+        currentThreadId,
+        currentCustomerId,
+        currentRegionId,
+        currentServerId,
+        currentHostSchemeId,
+        currentMonitorId,
+        currentStartTimestamp,
+        currentEndTimestamp,
+        currentTitleText,
+        currentXAxisTitle,
+        currentYAxisTitle,
+        currentTitleFont,
+        currentAxisTitleFont,
+        currentAxisLabelFont,
+        currentMaximumLatency,
+        currentMinimumLatency,
+        currentWidth,
+        currentHeight,
+        databaseThreadId
+    );
+}
+
+/***********************************************************************************************************************
+* LatencyPlotter
+*/
+
 LatencyPlotter::LatencyPlotter(
         LatencyInterfaceManager* latencyInterfaceManager,
+        PlotWorkerPool*          plotWorkerPool,
         QObject*                 parent
     ):PlotterBase(
+        plotWorkerPool,
         parent
     ),currentLatencyInterfaceManager(
         latencyInterfaceManager
     ) {
-    connect(this, &LatencyPlotter::issueRequestHistogramPlot, this, &LatencyPlotter::generateHistogramPlot);
-    connect(this, &LatencyPlotter::issueRequestHistoryPlot, this, &LatencyPlotter::generateHistoryPlot);
+    plotCacheConsumerId = MemoryGovernor::instance()->registerConsumer(
+        QString("plot_cache"),
+        [this]() {
+            return currentPlotCache.memoryUsage();
+        },
+        [this](MemoryGovernor::Stage stage) {
+            currentPlotCache.setMemoryPressure(stage >= MemoryGovernor::Stage::SHRINK_CACHES);
+        }
+    );
 }
 
 
 LatencyPlotter::~LatencyPlotter() {
+    MemoryGovernor::instance()->unregisterConsumer(plotCacheConsumerId);
 }
 
 
@@ -91,27 +308,31 @@ PlotMailbox& LatencyPlotter::requestHistoryPlot(
     PlotMailbox& mb = mailbox(threadId);
     mb.forceEmpty();
 
-    emit issueRequestHistoryPlot(
-        threadId,
-        customerId,
-        regionId,
-        serverId,
-        hostSchemeId,
-        monitorId,
-        startTimestamp,
-        endTimestamp,
-        titleText,
-        xAxisTitle,
-        yAxisTitle,
-        dateFormatString,
-        titleFont,
-        axisTitleFont,
-        axisLabelFont,
-        maximumLatency,
-        minimumLatency,
-        logScale,
-        width,
-        height
+    enqueue(
+        new HistoryPlotJob(
+            this,
+            &mb,
+            threadId,
+            customerId,
+            regionId,
+            serverId,
+            hostSchemeId,
+            monitorId,
+            startTimestamp,
+            endTimestamp,
+            titleText,
+            xAxisTitle,
+            yAxisTitle,
+            dateFormatString,
+            titleFont,
+            axisTitleFont,
+            axisLabelFont,
+            maximumLatency,
+            minimumLatency,
+            logScale,
+            width,
+            height
+        )
     );
 
     return mb;
@@ -141,25 +362,29 @@ PlotMailbox& LatencyPlotter::requestHistogramPlot(
     PlotMailbox& mb = mailbox(threadId);
     mb.forceEmpty();
 
-    emit issueRequestHistogramPlot(
-        threadId,
-        customerId,
-        regionId,
-        serverId,
-        hostSchemeId,
-        monitorId,
-        startTimestamp,
-        endTimestamp,
-        titleText,
-        xAxisTitle,
-        yAxisTitle,
-        titleFont,
-        axisTitleFont,
-        axisLabelFont,
-        maximumLatency,
-        minimumLatency,
-        width,
-        height
+    enqueue(
+        new HistogramPlotJob(
+            this,
+            &mb,
+            threadId,
+            customerId,
+            regionId,
+            serverId,
+            hostSchemeId,
+            monitorId,
+            startTimestamp,
+            endTimestamp,
+            titleText,
+            xAxisTitle,
+            yAxisTitle,
+            titleFont,
+            axisTitleFont,
+            axisLabelFont,
+            maximumLatency,
+            minimumLatency,
+            width,
+            height
+        )
     );
 
     return mb;
@@ -190,6 +415,77 @@ PlotMailbox& LatencyPlotter::mailbox(unsigned threadId) {
 }
 
 
+PlotCache& LatencyPlotter::plotCache() {
+    return currentPlotCache;
+}
+
+
+unsigned long long LatencyPlotter::dataVersion(LatencyPlotter::MonitorId monitorId) const {
+    return currentLatencyInterfaceManager->dataVersion(monitorId);
+}
+
+
+QList<LatencyEntry> LatencyPlotter::downsampleEntries(
+        const QList<LatencyEntry>& latencyEntries,
+        unsigned                   numberColumns
+    ) {
+    QList<LatencyEntry> result;
+
+    unsigned long numberEntries = static_cast<unsigned long>(latencyEntries.size());
+    if (numberColumns == 0 || numberEntries <= 4UL * numberColumns) {
+        result = latencyEntries;
+    } else {
+        unsigned long long startTime = latencyEntries.first().unixTimestamp();
+        unsigned long long timeSpan  = latencyEntries.last().unixTimestamp() - startTime + 1;
+
+        result.reserve(4 * numberColumns);
+
+        unsigned long      columnFirst   = 0;
+        unsigned long      columnMinimum = 0;
+        unsigned long      columnMaximum = 0;
+        unsigned long long currentColumn = 0;
+        for (unsigned long index=1 ; index<=numberEntries ; ++index) {
+            unsigned long long column;
+            if (index < numberEntries) {
+                unsigned long long unixTimestamp = latencyEntries.at(index).unixTimestamp();
+                column = (unixTimestamp - startTime) * numberColumns / timeSpan;
+            } else {
+                column = currentColumn + 1;
+            }
+
+            if (column != currentColumn) {
+                // Keep the column's entries in timestamp order, dropping the duplicates.
+                unsigned long kept[4] = { columnFirst, columnMinimum, columnMaximum, index - 1 };
+                std::sort(kept, kept + 4);
+
+                result.append(latencyEntries.at(kept[0]));
+                for (unsigned i=1 ; i<4 ; ++i) {
+                    if (kept[i] != kept[i - 1]) {
+                        result.append(latencyEntries.at(kept[i]));
+                    }
+                }
+
+                columnFirst   = index;
+                columnMinimum = index;
+                columnMaximum = index;
+                currentColumn = column;
+            } else {
+                LatencyEntry::LatencyMicroseconds latency = latencyEntries.at(index).latencyMicroseconds();
+                if (latency < latencyEntries.at(columnMinimum).latencyMicroseconds()) {
+                    columnMinimum = index;
+                }
+
+                if (latency > latencyEntries.at(columnMaximum).latencyMicroseconds()) {
+                    columnMaximum = index;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
 void LatencyPlotter::generateHistoryPlot(
         unsigned           threadId,
         unsigned long      customerId,
@@ -210,10 +506,14 @@ void LatencyPlotter::generateHistoryPlot(
         double             minimumLatency,
         bool               logScale,
         unsigned           width,
-        unsigned           height
+        unsigned           height,
+        unsigned           databaseThreadId
     ) {
-    typedef QList<AggregatedLatencyEntry>                 AggregatedEntryList;
-    typedef QMap<unsigned long long, AggregatedEntryList> MergedEntries;
+    typedef QPair<unsigned long, unsigned long> EntrySpan;
+    typedef QList<EntrySpan>                    EntrySpans;
+
+    QElapsedTimer plotTimer;
+    plotTimer.start();
 
     fixTimestamp(startTimestamp, endTimestamp);
 
@@ -225,31 +525,27 @@ void LatencyPlotter::generateHistoryPlot(
         serverId,
         startTimestamp,
         endTimestamp,
-        databaseThreadId
+        databaseThreadId,
+        static_cast<unsigned long>((endTimestamp - startTimestamp) / std::max(width, 1U))
     );
 
-    LatencyInterfaceManager::LatencyEntryList           latencyEntryList           = latencyData.first;
+    LatencyInterfaceManager::LatencyEntryList           latencyEntryList           = downsampleEntries(
+        latencyData.first,
+        width
+    );
     LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedLatencyEntryList = latencyData.second;
 
-    QtCharts::QLineSeries* recentSeries                = new QtCharts::QLineSeries();
-    QtCharts::QLineSeries* aggregatedMinimumSeries     = new QtCharts::QLineSeries();
-    QtCharts::QLineSeries* aggregatedMaximumSeries     = new QtCharts::QLineSeries();
-    QtCharts::QLineSeries* aggregatedStdDevLowerSeries = new QtCharts::QLineSeries();
-    QtCharts::QLineSeries* aggregatedStdDevUpperSeries = new QtCharts::QLineSeries();
-    QtCharts::QAreaSeries* oneSigmaAreaSeries          = new QtCharts::QAreaSeries(
-        aggregatedStdDevLowerSeries,
-        aggregatedStdDevUpperSeries
-    );
+    QVector<QPointF> recentPoints;
+    QVector<QPointF> aggregatedMinimumPoints;
+    QVector<QPointF> aggregatedMaximumPoints;
+    QVector<QPointF> aggregatedStdDevLowerPoints;
+    QVector<QPointF> aggregatedStdDevUpperPoints;
 
     QColor inesonicBlue(0x17, 0x6E, 0xDA);
 //    QColor inesonicOrange(0xE0, 0x7E, 0x26);
 
     QPen recentSeriesPen(QBrush(inesonicBlue), 1.5);
-    recentSeries->setPen(recentSeriesPen);
-
     QPen minMaxSeriesPen(QBrush(Qt::GlobalColor::red), 0.5);
-    aggregatedMinimumSeries->setPen(minMaxSeriesPen);
-    aggregatedMaximumSeries->setPen(minMaxSeriesPen);
 
     QColor inesonicBlueTranslucent(0x18, 0x6E, 0xDA, 32);
     QLinearGradient areaGradient(QPointF(0, 0), QPointF(0, 1));
@@ -257,8 +553,6 @@ void LatencyPlotter::generateHistoryPlot(
     areaGradient.setColorAt(1.0, inesonicBlueTranslucent.darker(120));
 
     QPen areaSeriesPen(QBrush(inesonicBlue), 0.25);
-    oneSigmaAreaSeries->setPen(areaSeriesPen);
-    oneSigmaAreaSeries->setBrush(areaGradient);
 
     unsigned           latencyEntryListSize     = static_cast<unsigned>(latencyEntryList.size());
     unsigned long long minimumTime              = std::numeric_limits<unsigned long long>::max();
@@ -267,36 +561,35 @@ void LatencyPlotter::generateHistoryPlot(
     double             maximum                  = -minimum;
     bool               showDayOfWeek            = (dateFormatString == "dow");
 
-    MergedEntries mergedEntries;
-    unsigned      aggregatedLatencyEntryListSize = static_cast<unsigned>(aggregatedLatencyEntryList.size());
+    // Entries arrive sorted by start time.  Runs of entries covering the same period are combined into a single
+    // span using the structure-of-arrays population kernels.
+    LatencyPopulations populations;
+    EntrySpans         entrySpans;
+    unsigned           aggregatedLatencyEntryListSize = static_cast<unsigned>(aggregatedLatencyEntryList.size());
     if (aggregatedLatencyEntryListSize > 0) {
+        populations.reserve(aggregatedLatencyEntryListSize);
 
-        unsigned long long   periodStartTimestamp = 0;
-        unsigned long long   periodEndTimestamp   = 0;
+        unsigned long long periodStartTimestamp = 0;
+        unsigned long long periodEndTimestamp   = 0;
 
-        AggregatedEntryList* currentList = nullptr;
         for (unsigned i=0 ; i<aggregatedLatencyEntryListSize ; ++i) {
             const AggregatedLatencyEntry& entry          = aggregatedLatencyEntryList.at(i);
             unsigned long long            startTimestamp = entry.startTimestamp();
             unsigned long long            endTimestamp   = entry.endTimestamp();
 
-            if (startTimestamp < periodStartTimestamp || endTimestamp > periodEndTimestamp || currentList == nullptr) {
+            if (startTimestamp < periodStartTimestamp || endTimestamp > periodEndTimestamp || entrySpans.isEmpty()) {
                 periodStartTimestamp = startTimestamp;
                 periodEndTimestamp   = endTimestamp;
 
-                MergedEntries::iterator it = mergedEntries.find(startTimestamp);
-                if (it == mergedEntries.end()) {
-                    it = mergedEntries.insert(startTimestamp, AggregatedEntryList());
-                }
-
-                currentList = &it.value();
+                entrySpans.append(EntrySpan(i, i));
             }
 
-            currentList->append(entry);
+            entrySpans.last().second = i + 1;
+            populations.append(entry);
         }
 
-        minimumTime = mergedEntries.firstKey();
-        maximumTime = mergedEntries.last().last().endTimestamp();
+        minimumTime = aggregatedLatencyEntryList.at(entrySpans.first().first).startTimestamp();
+        maximumTime = aggregatedLatencyEntryList.at(entrySpans.last().second - 1).endTimestamp();
     }
 
     if (latencyEntryListSize > 0) {
@@ -321,53 +614,24 @@ void LatencyPlotter::generateHistoryPlot(
     }
 
     if (aggregatedLatencyEntryListSize > 0) {
-        for (  MergedEntries::const_iterator timeSpanIterator    = mergedEntries.constBegin(),
-                                             timeSpanEndIterator = mergedEntries.constEnd()
-             ; timeSpanIterator != timeSpanEndIterator
-             ; ++timeSpanIterator
+        for (  EntrySpans::const_iterator spanIterator    = entrySpans.constBegin(),
+                                          spanEndIterator = entrySpans.constEnd()
+             ; spanIterator != spanEndIterator
+             ; ++spanIterator
             ) {
-            const AggregatedEntryList& entryList                  = timeSpanIterator.value();
-            unsigned long              numberEntries              = static_cast<unsigned long>(entryList.size());
-            unsigned long long         aggregatedStartTime        = entryList.first().startTimestamp();
-            unsigned long long         aggregatedEndTime          = entryList.last().endTimestamp();
-            unsigned long              aggregatedNumberSamples    = 0;
-            double                     aggregatedMinimumLatency   = std::numeric_limits<double>::max();
-            double                     aggregatedMaximumLatency   = 0;
-            double                     weightedSumMeanLatency     = 0;
-            double                     weightedSumVarianceLatency = 0;
-
-            for (unsigned long i=0 ; i<numberEntries ; ++i) {
-                const AggregatedLatencyEntry& entry         = entryList.at(i);
-                double                        avg           = entry.meanLatency() * 1.0E-6;
-                double                        min           = entry.minimumLatency() * 1.0E-6;
-                double                        max           = entry.maximumLatency() * 1.0E-6;
-                double                        variance      = entry.varianceLatency() * 1.0E-12;
-                unsigned long                 numberSamples = entry.numberSamples();
-
-                if (min < aggregatedMinimumLatency) {
-                    aggregatedMinimumLatency = min;
-                }
-
-                if (max > aggregatedMaximumLatency) {
-                    aggregatedMaximumLatency = max;
-                }
-
-                weightedSumMeanLatency     += numberSamples * avg;
-                weightedSumVarianceLatency += numberSamples * variance;
-                aggregatedNumberSamples    += numberSamples;
-            }
-
-            double meanLatency = weightedSumMeanLatency / aggregatedNumberSamples;
-            for (unsigned long i=0 ; i<numberEntries ; ++i) {
-                const AggregatedLatencyEntry& entry = entryList.at(i);
-                double                        d     = entry.meanLatency() * 1.0E-6 - meanLatency;
-                weightedSumVarianceLatency += entry.numberSamples() * d * d;
-            }
-
-            double varianceLatency = weightedSumVarianceLatency / aggregatedNumberSamples;
-            double stdDeviation    = std::sqrt(varianceLatency);
-            double lower1Sigma     = std::max(0.0, meanLatency - stdDeviation);
-            double upper1Sigma     = meanLatency + stdDeviation;
+            const EntrySpan&            span                     = *spanIterator;
+            LatencyPopulations::Summary summary                  = populations.combine(span.first, span.second);
+            unsigned long long          aggregatedStartTime      =
+                aggregatedLatencyEntryList.at(span.first).startTimestamp();
+            unsigned long long          aggregatedEndTime        =
+                aggregatedLatencyEntryList.at(span.second - 1).endTimestamp();
+            double                      aggregatedMinimumLatency = summary.minimumLatency * 1.0E-6;
+            double                      aggregatedMaximumLatency = summary.maximumLatency * 1.0E-6;
+            double                      meanLatency              = summary.meanLatency * 1.0E-6;
+            double                      varianceLatency          = summary.varianceLatency * 1.0E-12;
+            double                      stdDeviation             = std::sqrt(varianceLatency);
+            double                      lower1Sigma              = std::max(0.0, meanLatency - stdDeviation);
+            double                      upper1Sigma              = meanLatency + stdDeviation;
 
             if (showDayOfWeek) {
                 double startDow = 1 + static_cast<double>(aggregatedStartTime - weekStartTimestamp) / secondsPerDay;
@@ -377,33 +641,33 @@ void LatencyPlotter::generateHistoryPlot(
                         endDow = 7.9999999;
                     }
 
-                    recentSeries->append(startDow, meanLatency);
-                    aggregatedMinimumSeries->append(startDow, aggregatedMinimumLatency);
-                    aggregatedMaximumSeries->append(startDow, aggregatedMaximumLatency);
-                    aggregatedStdDevLowerSeries->append(startDow, lower1Sigma);
-                    aggregatedStdDevUpperSeries->append(startDow, upper1Sigma);
-
-                    recentSeries->append(endDow, meanLatency);
-                    aggregatedMinimumSeries->append(endDow, aggregatedMinimumLatency);
-                    aggregatedMaximumSeries->append(endDow, aggregatedMaximumLatency);
-                    aggregatedStdDevLowerSeries->append(endDow, lower1Sigma);
-                    aggregatedStdDevUpperSeries->append(endDow, upper1Sigma);
+                    recentPoints.append(QPointF(startDow, meanLatency));
+                    aggregatedMinimumPoints.append(QPointF(startDow, aggregatedMinimumLatency));
+                    aggregatedMaximumPoints.append(QPointF(startDow, aggregatedMaximumLatency));
+                    aggregatedStdDevLowerPoints.append(QPointF(startDow, lower1Sigma));
+                    aggregatedStdDevUpperPoints.append(QPointF(startDow, upper1Sigma));
+
+                    recentPoints.append(QPointF(endDow, meanLatency));
+                    aggregatedMinimumPoints.append(QPointF(endDow, aggregatedMinimumLatency));
+                    aggregatedMaximumPoints.append(QPointF(endDow, aggregatedMaximumLatency));
+                    aggregatedStdDevLowerPoints.append(QPointF(endDow, lower1Sigma));
+                    aggregatedStdDevUpperPoints.append(QPointF(endDow, upper1Sigma));
                 }
             } else {
                 unsigned long long startValue = aggregatedStartTime * 1000ULL;
                 unsigned long long endValue   = aggregatedEndTime * 1000ULL;
 
-                recentSeries->append(startValue, meanLatency);
-                aggregatedMinimumSeries->append(startValue, aggregatedMinimumLatency);
-                aggregatedMaximumSeries->append(startValue, aggregatedMaximumLatency);
-                aggregatedStdDevLowerSeries->append(startValue, lower1Sigma);
-                aggregatedStdDevUpperSeries->append(startValue, upper1Sigma);
-
-                recentSeries->append(endValue, meanLatency);
-                aggregatedMinimumSeries->append(endValue, aggregatedMinimumLatency);
-                aggregatedMaximumSeries->append(endValue, aggregatedMaximumLatency);
-                aggregatedStdDevLowerSeries->append(endValue, lower1Sigma);
-                aggregatedStdDevUpperSeries->append(endValue, upper1Sigma);
+                recentPoints.append(QPointF(startValue, meanLatency));
+                aggregatedMinimumPoints.append(QPointF(startValue, aggregatedMinimumLatency));
+                aggregatedMaximumPoints.append(QPointF(startValue, aggregatedMaximumLatency));
+                aggregatedStdDevLowerPoints.append(QPointF(startValue, lower1Sigma));
+                aggregatedStdDevUpperPoints.append(QPointF(startValue, upper1Sigma));
+
+                recentPoints.append(QPointF(endValue, meanLatency));
+                aggregatedMinimumPoints.append(QPointF(endValue, aggregatedMinimumLatency));
+                aggregatedMaximumPoints.append(QPointF(endValue, aggregatedMaximumLatency));
+                aggregatedStdDevLowerPoints.append(QPointF(endValue, lower1Sigma));
+                aggregatedStdDevUpperPoints.append(QPointF(endValue, upper1Sigma));
             }
 
             if (aggregatedMinimumLatency < minimum) {
@@ -435,10 +699,10 @@ void LatencyPlotter::generateHistoryPlot(
             if (showDayOfWeek) {
                 double dow = 1 + static_cast<double>(unixTimestamp - weekStartTimestamp) / secondsPerDay;
                 if (dow < 8.0) {
-                    recentSeries->append(dow, latencySeconds);
+                    recentPoints.append(QPointF(dow, latencySeconds));
                 }
             } else {
-                recentSeries->append(unixTimestamp * 1000ULL, latencySeconds);
+                recentPoints.append(QPointF(unixTimestamp * 1000ULL, latencySeconds));
             }
         }
     }
@@ -451,135 +715,210 @@ void LatencyPlotter::generateHistoryPlot(
         maximum = 1.0;
     }
 
-    QtCharts::QChart* chart = new QtCharts::QChart();
-    chart->addSeries(recentSeries);
-    chart->addSeries(aggregatedMinimumSeries);
-    chart->addSeries(aggregatedMaximumSeries);
-    chart->addSeries(oneSigmaAreaSeries);
+    qint64 dataTime     = plotTimer.nsecsElapsed();
+    bool   fastRenderer = useFastRenderer(width, height);
 
-    chart->legend()->hide();
-    chart->setTitle(titleText);
+    QImage result;
+    if (fastRenderer) {
+        Canvas canvas(width, height);
+        canvas.setTitle(titleText, titleFont);
+        canvas.setAxisTitles(xAxisTitle, yAxisTitle, axisTitleFont);
+        canvas.setAxisLabelFont(axisLabelFont);
 
-    bool fontOk;
-    QFont newTitleFont = toFont(titleFont, &fontOk);
-    if (fontOk) {
-        chart->setTitleFont(newTitleFont);
-    }
+        if (showDayOfWeek) {
+            canvas.setHorizontalDayOfWeekAxis();
+        } else {
+            if (minimumTime <= maximumTime) {
+                canvas.setHorizontalDateTimeAxis(minimumTime * 1000.0, maximumTime * 1000.0, dateFormatString);
+            } else {
+                canvas.setHorizontalDateTimeAxis(startTimestamp * 1000.0, endTimestamp * 1000.0, dateFormatString);
+            }
+        }
 
-    QtCharts::QAbstractAxis* axisX;
-    if (showDayOfWeek) {
-        QtCharts::QCategoryAxis* axisXValue = new QtCharts::QCategoryAxis();
-        axisXValue->setTickCount(8);
-        axisXValue->setLabelFormat("%1.0f");
-        axisXValue->setRange(1.0, 8.0);
-        axisXValue->append("Mon", 2.0);
-        axisXValue->append("Tue", 3.0);
-        axisXValue->append("Wed", 4.0);
-        axisXValue->append("Thu", 5.0);
-        axisXValue->append("Fri", 6.0);
-        axisXValue->append("Sat", 7.0);
-        axisXValue->append("Sun", 8.0);
-
-        axisX = axisXValue;
+        if (!logScale) {
+            double   axisMinimum = minimumLatency >= 0 ? minimumLatency : minimum;
+            double   axisMaximum = maximumLatency >= 0 ? maximumLatency : maximum;
+            unsigned numberSteps = calculateNiceRange(axisMinimum, axisMaximum);
+
+            canvas.setVerticalAxis(axisMinimum, axisMaximum, numberSteps);
+        } else {
+            calculateNiceLogRange(minimum, maximum);
+            canvas.setVerticalAxis(
+                minimumLatency >= 0 ? minimumLatency : minimum,
+                maximumLatency >= 0 ? maximumLatency : maximum,
+                0,
+                true
+            );
+        }
+
+        canvas.drawFrame();
+        canvas.drawBand(aggregatedStdDevLowerPoints, aggregatedStdDevUpperPoints, areaGradient, areaSeriesPen);
+        canvas.drawLine(aggregatedMinimumPoints, minMaxSeriesPen);
+        canvas.drawLine(aggregatedMaximumPoints, minMaxSeriesPen);
+        canvas.drawLine(recentPoints, recentSeriesPen);
+
+        result = canvas.image();
     } else {
-        QtCharts::QDateTimeAxis* axisXDateTime = new QtCharts::QDateTimeAxis;
-        axisXDateTime->setTickCount(5);
-        axisXDateTime->setFormat(dateFormatString); // "MMM dd - hh:mm");
+        QtCharts::QLineSeries* recentSeries                = new QtCharts::QLineSeries();
+        QtCharts::QLineSeries* aggregatedMinimumSeries     = new QtCharts::QLineSeries();
+        QtCharts::QLineSeries* aggregatedMaximumSeries     = new QtCharts::QLineSeries();
+        QtCharts::QLineSeries* aggregatedStdDevLowerSeries = new QtCharts::QLineSeries();
+        QtCharts::QLineSeries* aggregatedStdDevUpperSeries = new QtCharts::QLineSeries();
+        QtCharts::QAreaSeries* oneSigmaAreaSeries          = new QtCharts::QAreaSeries(
+            aggregatedStdDevLowerSeries,
+            aggregatedStdDevUpperSeries
+        );
 
-        axisX = axisXDateTime;
-    }
+        recentSeries->replace(recentPoints);
+        aggregatedMinimumSeries->replace(aggregatedMinimumPoints);
+        aggregatedMaximumSeries->replace(aggregatedMaximumPoints);
+        aggregatedStdDevLowerSeries->replace(aggregatedStdDevLowerPoints);
+        aggregatedStdDevUpperSeries->replace(aggregatedStdDevUpperPoints);
+
+        recentSeries->setPen(recentSeriesPen);
+        aggregatedMinimumSeries->setPen(minMaxSeriesPen);
+        aggregatedMaximumSeries->setPen(minMaxSeriesPen);
+        oneSigmaAreaSeries->setPen(areaSeriesPen);
+        oneSigmaAreaSeries->setBrush(areaGradient);
+
+        QtCharts::QChart* chart = new QtCharts::QChart();
+        chart->addSeries(recentSeries);
+        chart->addSeries(aggregatedMinimumSeries);
+        chart->addSeries(aggregatedMaximumSeries);
+        chart->addSeries(oneSigmaAreaSeries);
+
+        chart->legend()->hide();
+        chart->setTitle(titleText);
+
+        bool fontOk;
+        QFont newTitleFont = toFont(titleFont, &fontOk);
+        if (fontOk) {
+            chart->setTitleFont(newTitleFont);
+        }
 
-    axisX->setTitleText(xAxisTitle);
-    chart->addAxis(axisX, Qt::AlignmentFlag::AlignBottom);
+        QtCharts::QAbstractAxis* axisX;
+        if (showDayOfWeek) {
+            QtCharts::QCategoryAxis* axisXValue = new QtCharts::QCategoryAxis();
+            axisXValue->setTickCount(8);
+            axisXValue->setLabelFormat("%1.0f");
+            axisXValue->setRange(1.0, 8.0);
+            axisXValue->append("Mon", 2.0);
+            axisXValue->append("Tue", 3.0);
+            axisXValue->append("Wed", 4.0);
+            axisXValue->append("Thu", 5.0);
+            axisXValue->append("Fri", 6.0);
+            axisXValue->append("Sat", 7.0);
+            axisXValue->append("Sun", 8.0);
+
+            axisX = axisXValue;
+        } else {
+            QtCharts::QDateTimeAxis* axisXDateTime = new QtCharts::QDateTimeAxis;
+            axisXDateTime->setTickCount(5);
+            axisXDateTime->setFormat(dateFormatString); // "MMM dd - hh:mm");
 
-    recentSeries->attachAxis(axisX);
-    aggregatedMinimumSeries->attachAxis(axisX);
-    aggregatedMaximumSeries->attachAxis(axisX);
-    oneSigmaAreaSeries->attachAxis(axisX);
+            axisX = axisXDateTime;
+        }
 
-    QtCharts::QAbstractAxis* axisY;
-    if (logScale) {
-        axisY = new QtCharts::QLogValueAxis;
-    } else {
-        axisY = new QtCharts::QValueAxis;
-    }
+        axisX->setTitleText(xAxisTitle);
+        chart->addAxis(axisX, Qt::AlignmentFlag::AlignBottom);
 
-    axisY->setTitleText(yAxisTitle);
+        recentSeries->attachAxis(axisX);
+        aggregatedMinimumSeries->attachAxis(axisX);
+        aggregatedMaximumSeries->attachAxis(axisX);
+        oneSigmaAreaSeries->attachAxis(axisX);
 
-    QFont newAxisTitleFont = toFont(axisTitleFont, &fontOk);
-    if (fontOk) {
-        axisX->setTitleFont(newAxisTitleFont);
-        axisY->setTitleFont(newAxisTitleFont);
-    }
+        QtCharts::QAbstractAxis* axisY;
+        if (logScale) {
+            axisY = new QtCharts::QLogValueAxis;
+        } else {
+            axisY = new QtCharts::QValueAxis;
+        }
 
-    QFont newAxisLabelFont = toFont(axisLabelFont, &fontOk);
-    if (fontOk) {
-        axisX->setLabelsFont(newAxisLabelFont);
-        axisY->setLabelsFont(newAxisLabelFont);
-    }
+        axisY->setTitleText(yAxisTitle);
+
+        QFont newAxisTitleFont = toFont(axisTitleFont, &fontOk);
+        if (fontOk) {
+            axisX->setTitleFont(newAxisTitleFont);
+            axisY->setTitleFont(newAxisTitleFont);
+        }
+
+        QFont newAxisLabelFont = toFont(axisLabelFont, &fontOk);
+        if (fontOk) {
+            axisX->setLabelsFont(newAxisLabelFont);
+            axisY->setLabelsFont(newAxisLabelFont);
+        }
 
-    chart->addAxis(axisY, Qt::AlignmentFlag::AlignLeft);
+        chart->addAxis(axisY, Qt::AlignmentFlag::AlignLeft);
 
-    recentSeries->attachAxis(axisY);
-    aggregatedMinimumSeries->attachAxis(axisY);
-    aggregatedMaximumSeries->attachAxis(axisY);
-    oneSigmaAreaSeries->attachAxis(axisY);
+        recentSeries->attachAxis(axisY);
+        aggregatedMinimumSeries->attachAxis(axisY);
+        aggregatedMaximumSeries->attachAxis(axisY);
+        oneSigmaAreaSeries->attachAxis(axisY);
 
-    if (!logScale) {
-        if (minimumLatency < 0 && maximumLatency < 0) {
-            unsigned recommendedTickCount = calculateNiceRange(minimum, maximum);
+        if (!logScale) {
+            if (minimumLatency < 0 && maximumLatency < 0) {
+                unsigned recommendedTickCount = calculateNiceRange(minimum, maximum);
 
-            static_cast<QtCharts::QValueAxis*>(axisY)->setRange(minimum, maximum);
-            static_cast<QtCharts::QValueAxis*>(axisY)->setTickCount(recommendedTickCount + 1);
-            static_cast<QtCharts::QValueAxis*>(axisY)->setMinorTickCount(1);
+                static_cast<QtCharts::QValueAxis*>(axisY)->setRange(minimum, maximum);
+                static_cast<QtCharts::QValueAxis*>(axisY)->setTickCount(recommendedTickCount + 1);
+                static_cast<QtCharts::QValueAxis*>(axisY)->setMinorTickCount(1);
+            } else {
+                static_cast<QtCharts::QValueAxis*>(axisY)->setMin(minimumLatency >= 0 ? minimumLatency : minimum);
+                static_cast<QtCharts::QValueAxis*>(axisY)->setMax(maximumLatency >= 0 ? maximumLatency : maximum);
+                static_cast<QtCharts::QValueAxis*>(axisY)->setMinorTickCount(1);
+                static_cast<QtCharts::QValueAxis*>(axisY)->applyNiceNumbers();
+            }
         } else {
-            static_cast<QtCharts::QValueAxis*>(axisY)->setMin(minimumLatency >= 0 ? minimumLatency : minimum);
-            static_cast<QtCharts::QValueAxis*>(axisY)->setMax(maximumLatency >= 0 ? maximumLatency : maximum);
-            static_cast<QtCharts::QValueAxis*>(axisY)->setMinorTickCount(1);
-            static_cast<QtCharts::QValueAxis*>(axisY)->applyNiceNumbers();
+            calculateNiceLogRange(minimum, maximum);
+
+            static_cast<QtCharts::QLogValueAxis*>(axisY)->setMin(minimumLatency >= 0 ? minimumLatency : minimum);
+            static_cast<QtCharts::QLogValueAxis*>(axisY)->setMax(maximumLatency >= 0 ? maximumLatency : maximum);
+            static_cast<QtCharts::QLogValueAxis*>(axisY)->setGridLineColor(QColor(0xC0, 0xC0, 0xC0));
+            static_cast<QtCharts::QLogValueAxis*>(axisY)->setMinorTickCount(9);
         }
-    } else {
-        calculateNiceLogRange(minimum, maximum);
 
-        static_cast<QtCharts::QLogValueAxis*>(axisY)->setMin(minimumLatency >= 0 ? minimumLatency : minimum);
-        static_cast<QtCharts::QLogValueAxis*>(axisY)->setMax(maximumLatency >= 0 ? maximumLatency : maximum);
-        static_cast<QtCharts::QLogValueAxis*>(axisY)->setGridLineColor(QColor(0xC0, 0xC0, 0xC0));
-        static_cast<QtCharts::QLogValueAxis*>(axisY)->setMinorTickCount(9);
-    }
+        QGraphicsScene scene;
+        scene.addItem(chart);
 
-    QGraphicsScene scene;
-    scene.addItem(chart);
+        chart->setGeometry(0, 0, width, height);
+        scene.setSceneRect(0, 0, width, height);
 
-    chart->setGeometry(0, 0, width, height);
-    scene.setSceneRect(0, 0, width, height);
+//        if (aggregatedLatencyEntryListSize > 0 && latencyEntryListSize > 0 && !showDayOfWeek) {
+//            QRectF plotActiveArea = chart->plotArea();
 
-//    if (aggregatedLatencyEntryListSize > 0 && latencyEntryListSize > 0 && !showDayOfWeek) {
-//        QRectF plotActiveArea = chart->plotArea();
+//            unsigned long long leftX  = static_cast<QtCharts::QDateTimeAxis*>(axisX)->min().toMSecsSinceEpoch();
+//            unsigned long long rightX = static_cast<QtCharts::QDateTimeAxis*>(axisX)->max().toMSecsSinceEpoch();
+//            unsigned long long lineX  = aggregatedEntriesEndTime * 1000ULL;
 
-//        unsigned long long leftX  = static_cast<QtCharts::QDateTimeAxis*>(axisX)->min().toMSecsSinceEpoch();
-//        unsigned long long rightX = static_cast<QtCharts::QDateTimeAxis*>(axisX)->max().toMSecsSinceEpoch();
-//        unsigned long long lineX  = aggregatedEntriesEndTime * 1000ULL;
+//            float              sceneR        = static_cast<float>(lineX - leftX)/static_cast<float>(rightX - leftX);
+//            float              sceneX        = plotActiveArea.width() * sceneR + plotActiveArea.left();
+//            QGraphicsLineItem* separatorLine = new QGraphicsLineItem(
+//                sceneX, plotActiveArea.top(),
+//                sceneX, plotActiveArea.bottom()
+//            );
 
-//        float              sceneR        = static_cast<float>(lineX - leftX)/static_cast<float>(rightX - leftX);
-//        float              sceneX        = plotActiveArea.width() * sceneR + plotActiveArea.left();
-//        QGraphicsLineItem* separatorLine = new QGraphicsLineItem(
-//            sceneX, plotActiveArea.top(),
-//            sceneX, plotActiveArea.bottom()
-//        );
+//            QPen separatorLinePen(QBrush(inesonicOrange), 2);
+//            separatorLine->setPen(separatorLinePen);
 
-//        QPen separatorLinePen(QBrush(inesonicOrange), 2);
-//        separatorLine->setPen(separatorLinePen);
+//            scene.addItem(separatorLine);
+//        }
 
-//        scene.addItem(separatorLine);
-//    }
+        result = QImage(width, height, QImage::Format::Format_RGB888);
+        result.fill(Qt::GlobalColor::white);
 
-    QImage result(width, height, QImage::Format::Format_RGB888);
-    result.fill(Qt::GlobalColor::white);
+        QPainter painter(&result);
 
-    QPainter painter(&result);
+        scene.render(&painter);
+        painter.end();
+    }
 
-    scene.render(&painter);
-    painter.end();
+    recordPlotTiming(
+        QString("history"),
+        fastRenderer,
+        latencyEntryListSize + aggregatedLatencyEntryListSize,
+        dataTime,
+        plotTimer.nsecsElapsed() - dataTime
+    );
 
     PlotMailbox& mb = mailbox(threadId);
     mb.sendImage(result);
@@ -604,11 +943,18 @@ void LatencyPlotter::generateHistogramPlot(
         double             maximumLatency,
         double             minimumLatency,
         unsigned           width,
-        unsigned           height
+        unsigned           height,
+        unsigned           databaseThreadId
     ) {
+    QElapsedTimer plotTimer;
+    plotTimer.start();
+
     fixTimestamp(startTimestamp, endTimestamp);
 
-    LatencyInterfaceManager::LatencyEntryLists latencyData = currentLatencyInterfaceManager->getLatencyEntries(
+    // The window is summarized from the mergeable sketches stored with each aggregated entry plus raw entries
+    // bucketed by the database so we never need to pull individual samples.
+    LatencySketch          sketch;
+    AggregatedLatencyEntry statistics = currentLatencyInterfaceManager->getLatencyStatistics(
         customerId,
         hostSchemeId,
         monitorId,
@@ -616,53 +962,26 @@ void LatencyPlotter::generateHistogramPlot(
         serverId,
         startTimestamp,
         endTimestamp,
-        databaseThreadId
+        databaseThreadId,
+        &sketch
     );
 
-    LatencyInterfaceManager::LatencyEntryList           latencyEntryList           = latencyData.first;
-    LatencyInterfaceManager::AggregatedLatencyEntryList aggregatedLatencyEntryList = latencyData.second;
-
-    unsigned long latencyEntryListSize           = static_cast<unsigned long>(latencyEntryList.size());
-    unsigned long aggregatedLatencyEntryListSize = static_cast<unsigned long>(aggregatedLatencyEntryList.size());
-    unsigned long totalEntries                   = latencyEntryListSize + aggregatedLatencyEntryListSize;
+    unsigned long long totalEntries = sketch.numberSamples();
 
     double minimum = minimumLatency;
     double maximum = maximumLatency;
 
-    QVector<double> latencyValues;
-    latencyValues.reserve(totalEntries);
-
-    double min = std::numeric_limits<double>::max();
-    double max = -minimum;
-
-    for (unsigned long i=0 ; i<latencyEntryListSize ; ++i) {
-        const LatencyEntry& entry          = latencyEntryList.at(i);
-        double              latencySeconds = entry.latencySeconds();
-
-        latencyValues.append(latencySeconds);
-
-        if (latencySeconds < min) {
-            min = latencySeconds;
-        }
-
-        if (latencySeconds > max) {
-            max = latencySeconds;
-        }
-    }
-
-    for (unsigned long i=0 ; i<aggregatedLatencyEntryListSize ; ++i) {
-        const AggregatedLatencyEntry& entry          = aggregatedLatencyEntryList.at(i);
-        double                        latencySeconds = entry.latencySeconds();
-
-        latencyValues.append(latencySeconds);
-
-        if (latencySeconds < min) {
-            min = latencySeconds;
-        }
-
-        if (latencySeconds > max) {
-            max = latencySeconds;
-        }
+    double min;
+    double max;
+    if (totalEntries > 0 && statistics.numberSamples() > 0) {
+        min = statistics.minimumLatency() * 1.0E-6;
+        max = statistics.maximumLatency() * 1.0E-6;
+    } else if (totalEntries > 0) {
+        min = sketch.quantile(0) * 1.0E-6;
+        max = sketch.quantile(1) * 1.0E-6;
+    } else {
+        min = std::numeric_limits<double>::max();
+        max = -min;
     }
 
     if (min == max) {
@@ -683,7 +1002,7 @@ void LatencyPlotter::generateHistogramPlot(
 
     unsigned recommendedNumberSteps = calculateNiceRange(minimum, maximum);
 
-    unsigned numberBuckets = static_cast<unsigned>(std::min(100UL, totalEntries / 500));
+    unsigned numberBuckets = static_cast<unsigned>(std::min(100ULL, totalEntries / 500));
     if (numberBuckets < recommendedNumberSteps) {
         numberBuckets = recommendedNumberSteps;
         while (numberBuckets < 10) {
@@ -700,34 +1019,14 @@ void LatencyPlotter::generateHistogramPlot(
 
     unsigned minorTicksPerMajorTick = (numberBuckets / recommendedNumberSteps) - 1;
 
-    double bucketWidth = (maximum - minimum) / numberBuckets;
-    QVector<unsigned long> counts(numberBuckets, 0UL);
-
-    double sumValues       = 0;
-    double sumSquareValues = 0;
-    for (unsigned long i=0 ; i<totalEntries ; ++i) {
-        double v = latencyValues.at(i);
-        if (v >= minimum && v <= maximum) {
-            sumValues       += v;
-            sumSquareValues += v * v;
-
-            unsigned bucketIndex = static_cast<unsigned>((v - minimum) / bucketWidth);
-            if (bucketIndex >= numberBuckets) {
-                ++counts.last();
-            } else {
-                ++counts[bucketIndex];
-            }
-        }
-    }
-
-    double average = sumValues / totalEntries;
-    double stdDev  = std::sqrt(sumSquareValues / totalEntries - average * average);
+    QVector<double> counts = sketch.histogram(minimum * 1.0E6, maximum * 1.0E6, numberBuckets);
 
-    double maximumCount = 0;
-    QtCharts::QBarSet* barSet = new QtCharts::QBarSet(QString());
+    double          maximumCount = 0;
+    QVector<double> barValues;
+    barValues.reserve(numberBuckets);
     for (unsigned bucketIndex=0 ; bucketIndex<numberBuckets ; ++bucketIndex) {
-        unsigned count = static_cast<unsigned>(counts.at(bucketIndex));
-        barSet->append(count);
+        double count = std::round(counts.at(bucketIndex));
+        barValues.append(count);
         if (count > maximumCount) {
             maximumCount = count;
         }
@@ -736,83 +1035,113 @@ void LatencyPlotter::generateHistogramPlot(
     double   minimumCount     = 0;
     unsigned numberCountTicks = calculateNiceRange(minimumCount, maximumCount);
 
-    QtCharts::QBarSeries* barSeries = new QtCharts::QBarSeries;
-    barSeries->append(barSet);
+    unsigned numberDigits = 4;
+    if (maximum > 10) {
+        numberDigits = 0;
+    } else if (maximum >= 1) {
+        numberDigits = 1;
+    } else if (maximum >= 0.1) {
+        numberDigits = 2;
+    } else if (maximum >= 0.01) {
+        numberDigits = 3;
+    }
 
     QColor inesonicBlue(0x17, 0x6E, 0xDA);
 
     QBrush barSetBrush(inesonicBlue);
     QPen   barSetPen(QBrush(inesonicBlue.darker(150)), 1);
 
-    barSet->setBrush(barSetBrush);
-    barSet->setPen(barSetPen);
+    qint64 dataTime     = plotTimer.nsecsElapsed();
+    bool   fastRenderer = useFastRenderer(width, height);
 
-    QtCharts::QChart* chart = new QtCharts::QChart();
-    chart->addSeries(barSeries);
+    QImage result;
+    if (fastRenderer) {
+        Canvas canvas(width, height);
+        canvas.setTitle(titleText, titleFont);
+        canvas.setAxisTitles(xAxisTitle, yAxisTitle, axisTitleFont);
+        canvas.setAxisLabelFont(axisLabelFont);
+        canvas.setHorizontalValueAxis(minimum, maximum, recommendedNumberSteps, numberDigits);
+        canvas.setVerticalAxis(minimumCount, maximumCount, numberCountTicks);
 
-    chart->legend()->hide();
-    chart->setTitle(titleText);
+        canvas.drawFrame();
+        canvas.drawBars(barValues, barSetBrush, barSetPen);
 
-    bool fontOk;
-    QFont newTitleFont = toFont(titleFont, &fontOk);
-    if (fontOk) {
-        chart->setTitleFont(newTitleFont);
-    }
+        result = canvas.image();
+    } else {
+        QtCharts::QBarSet* barSet = new QtCharts::QBarSet(QString());
+        for (unsigned bucketIndex=0 ; bucketIndex<numberBuckets ; ++bucketIndex) {
+            barSet->append(barValues.at(bucketIndex));
+        }
 
-    QtCharts::QValueAxis* axisX = new QtCharts::QValueAxis;
-    axisX->setRange(minimum, maximum);
-    axisX->setTickCount(recommendedNumberSteps + 1);
-    axisX->setMinorTickCount(minorTicksPerMajorTick);
-    axisX->setMinorGridLineColor(QColor(0xF4, 0xF4, 0xF4));
-    axisX->setTickAnchor(minimum);
-    axisX->setTitleText(xAxisTitle);
+        QtCharts::QBarSeries* barSeries = new QtCharts::QBarSeries;
+        barSeries->append(barSet);
 
-    if (maximum > 10) {
-        axisX->setLabelFormat("%.0f");
-    } else if (maximum >= 1) {
-        axisX->setLabelFormat("%.1f");
-    } else if (maximum >= 0.1) {
-        axisX->setLabelFormat("%.2f");
-    } else if (maximum >= 0.01) {
-        axisX->setLabelFormat("%.3f");
-    }
+        barSet->setBrush(barSetBrush);
+        barSet->setPen(barSetPen);
 
-    QtCharts::QValueAxis* axisY = new QtCharts::QValueAxis;
-    axisY->setRange(minimumCount, maximumCount);
-    axisY->setTickCount(numberCountTicks + 1);
-    axisY->setTickAnchor(minimumCount);
-    axisY->setTitleText(yAxisTitle);
+        QtCharts::QChart* chart = new QtCharts::QChart();
+        chart->addSeries(barSeries);
 
-    QFont newAxisTitleFont = toFont(axisTitleFont, &fontOk);
-    if (fontOk) {
-        axisX->setTitleFont(newAxisTitleFont);
-        axisY->setTitleFont(newAxisTitleFont);
-    }
+        chart->legend()->hide();
+        chart->setTitle(titleText);
 
-    QFont newAxisLabelFont = toFont(axisLabelFont, &fontOk);
-    if (fontOk) {
-        axisX->setLabelsFont(newAxisLabelFont);
-        axisY->setLabelsFont(newAxisLabelFont);
-    }
+        bool fontOk;
+        QFont newTitleFont = toFont(titleFont, &fontOk);
+        if (fontOk) {
+            chart->setTitleFont(newTitleFont);
+        }
+
+        QtCharts::QValueAxis* axisX = new QtCharts::QValueAxis;
+        axisX->setRange(minimum, maximum);
+        axisX->setTickCount(recommendedNumberSteps + 1);
+        axisX->setMinorTickCount(minorTicksPerMajorTick);
+        axisX->setMinorGridLineColor(QColor(0xF4, 0xF4, 0xF4));
+        axisX->setTickAnchor(minimum);
+        axisX->setTitleText(xAxisTitle);
+
+        if (maximum >= 0.01) {
+            axisX->setLabelFormat(QString("%.%1f").arg(numberDigits));
+        }
+
+        QtCharts::QValueAxis* axisY = new QtCharts::QValueAxis;
+        axisY->setRange(minimumCount, maximumCount);
+        axisY->setTickCount(numberCountTicks + 1);
+        axisY->setTickAnchor(minimumCount);
+        axisY->setTitleText(yAxisTitle);
 
-    chart->addAxis(axisX, Qt::AlignmentFlag::AlignBottom);
-    chart->addAxis(axisY, Qt::AlignmentFlag::AlignLeft);
+        QFont newAxisTitleFont = toFont(axisTitleFont, &fontOk);
+        if (fontOk) {
+            axisX->setTitleFont(newAxisTitleFont);
+            axisY->setTitleFont(newAxisTitleFont);
+        }
+
+        QFont newAxisLabelFont = toFont(axisLabelFont, &fontOk);
+        if (fontOk) {
+            axisX->setLabelsFont(newAxisLabelFont);
+            axisY->setLabelsFont(newAxisLabelFont);
+        }
 
-    barSeries->attachAxis(axisY);
+        chart->addAxis(axisX, Qt::AlignmentFlag::AlignBottom);
+        chart->addAxis(axisY, Qt::AlignmentFlag::AlignLeft);
 
-    QGraphicsScene scene;
-    scene.addItem(chart);
+        barSeries->attachAxis(axisY);
 
-    chart->setGeometry(0, 0, width, height);
-    scene.setSceneRect(0, 0, width, height);
+        QGraphicsScene scene;
+        scene.addItem(chart);
 
-    QImage result(width, height, QImage::Format::Format_RGB888);
-    result.fill(Qt::GlobalColor::white);
+        chart->setGeometry(0, 0, width, height);
+        scene.setSceneRect(0, 0, width, height);
 
-    QPainter painter(&result);
+        result = QImage(width, height, QImage::Format::Format_RGB888);
+        result.fill(Qt::GlobalColor::white);
+
+        QPainter painter(&result);
+
+        scene.render(&painter);
+        painter.end();
+    }
 
-    scene.render(&painter);
-    painter.end();
+    recordPlotTiming(QString("histogram"), fastRenderer, numberBuckets, dataTime, plotTimer.nsecsElapsed() - dataTime);
 
     PlotMailbox& mb = mailbox(threadId);
     mb.sendImage(result);
@@ -0,0 +1,189 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyPopulations class.
+***********************************************************************************************************************/
+
+#include <QVector>
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "latency_entry.h"
+#include "aggregated_latency_entry.h"
+#include "latency_populations.h"
+
+LatencyPopulations::LatencyPopulations() {}
+
+
+LatencyPopulations::~LatencyPopulations() {}
+
+
+unsigned long LatencyPopulations::size() const {
+    return static_cast<unsigned long>(currentCounts.size());
+}
+
+
+bool LatencyPopulations::isEmpty() const {
+    return currentCounts.isEmpty();
+}
+
+
+void LatencyPopulations::reserve(unsigned long numberPopulations) {
+    int capacity = static_cast<int>(numberPopulations);
+
+    currentMeans.reserve(capacity);
+    currentVariances.reserve(capacity);
+    currentCounts.reserve(capacity);
+    currentMinimums.reserve(capacity);
+    currentMaximums.reserve(capacity);
+}
+
+
+void LatencyPopulations::clear() {
+    currentMeans.clear();
+    currentVariances.clear();
+    currentCounts.clear();
+    currentMinimums.clear();
+    currentMaximums.clear();
+}
+
+
+void LatencyPopulations::append(
+        double              meanLatency,
+        double              varianceLatency,
+        LatencyMicroseconds minimumLatency,
+        LatencyMicroseconds maximumLatency,
+        unsigned long       numberSamples
+    ) {
+    if (numberSamples > 0) {
+        currentMeans.append(meanLatency);
+        currentVariances.append(varianceLatency);
+        currentCounts.append(static_cast<double>(numberSamples));
+        currentMinimums.append(minimumLatency);
+        currentMaximums.append(maximumLatency);
+    }
+}
+
+
+void LatencyPopulations::append(const AggregatedLatencyEntry& entry) {
+    append(
+        entry.meanLatency(),
+        entry.varianceLatency(),
+        entry.minimumLatency(),
+        entry.maximumLatency(),
+        entry.numberSamples()
+    );
+}
+
+
+LatencyPopulations::Summary LatencyPopulations::combine() const {
+    return combine(0, size());
+}
+
+
+LatencyPopulations::Summary LatencyPopulations::combine(unsigned long firstIndex, unsigned long lastIndex) const {
+    Summary result;
+    result.numberSamples   = 0;
+    result.meanLatency     = 0;
+    result.varianceLatency = 0;
+    result.minimumLatency  = 0;
+    result.maximumLatency  = 0;
+
+    lastIndex = std::min(lastIndex, size());
+    if (firstIndex < lastIndex) {
+        unsigned long              numberPopulations = lastIndex - firstIndex;
+        unsigned long              numberBlocks      = numberPopulations / numberLanes;
+        const double*              means             = currentMeans.constData() + firstIndex;
+        const double*              variances         = currentVariances.constData() + firstIndex;
+        const double*              counts            = currentCounts.constData() + firstIndex;
+        const LatencyMicroseconds* minimums          = currentMinimums.constData() + firstIndex;
+        const LatencyMicroseconds* maximums          = currentMaximums.constData() + firstIndex;
+
+        // First pass: total weight, weighted sum of means, and the latency extremes.
+
+        double              countLanes[numberLanes]   = {};
+        double              sumLanes[numberLanes]     = {};
+        LatencyMicroseconds minimumLanes[numberLanes];
+        LatencyMicroseconds maximumLanes[numberLanes] = {};
+        std::fill(minimumLanes, minimumLanes + numberLanes, std::numeric_limits<LatencyMicroseconds>::max());
+
+        for (unsigned long block=0 ; block<numberBlocks ; ++block) {
+            unsigned long base = block * numberLanes;
+            for (unsigned lane=0 ; lane<numberLanes ; ++lane) {
+                unsigned long i = base + lane;
+                countLanes[lane]   += counts[i];
+                sumLanes[lane]     += counts[i] * means[i];
+                minimumLanes[lane]  = std::min(minimumLanes[lane], minimums[i]);
+                maximumLanes[lane]  = std::max(maximumLanes[lane], maximums[i]);
+            }
+        }
+
+        for (unsigned long i=numberBlocks * numberLanes ; i<numberPopulations ; ++i) {
+            countLanes[0]   += counts[i];
+            sumLanes[0]     += counts[i] * means[i];
+            minimumLanes[0]  = std::min(minimumLanes[0], minimums[i]);
+            maximumLanes[0]  = std::max(maximumLanes[0], maximums[i]);
+        }
+
+        double              totalCount = 0;
+        double              totalSum   = 0;
+        LatencyMicroseconds minimum    = std::numeric_limits<LatencyMicroseconds>::max();
+        LatencyMicroseconds maximum    = 0;
+        for (unsigned lane=0 ; lane<numberLanes ; ++lane) {
+            totalCount += countLanes[lane];
+            totalSum   += sumLanes[lane];
+            minimum     = std::min(minimum, minimumLanes[lane]);
+            maximum     = std::max(maximum, maximumLanes[lane]);
+        }
+
+        double mean = totalSum / totalCount;
+
+        // Second pass: the combined variance,
+        //
+        //   v_c = \frac{ \sum_i n_i \left [ v_i + \left ( \mu_i - \mu_c \right ) ^ 2 \right ] } { \sum_i n_i }
+
+        double numeratorLanes[numberLanes] = {};
+        for (unsigned long block=0 ; block<numberBlocks ; ++block) {
+            unsigned long base = block * numberLanes;
+            for (unsigned lane=0 ; lane<numberLanes ; ++lane) {
+                unsigned long i = base + lane;
+                double        d = means[i] - mean;
+                numeratorLanes[lane] += counts[i] * (variances[i] + d * d);
+            }
+        }
+
+        for (unsigned long i=numberBlocks * numberLanes ; i<numberPopulations ; ++i) {
+            double d = means[i] - mean;
+            numeratorLanes[0] += counts[i] * (variances[i] + d * d);
+        }
+
+        double numerator = 0;
+        for (unsigned lane=0 ; lane<numberLanes ; ++lane) {
+            numerator += numeratorLanes[lane];
+        }
+
+        result.numberSamples   = static_cast<unsigned long long>(totalCount);
+        result.meanLatency     = mean;
+        result.varianceLatency = numerator / totalCount;
+        result.minimumLatency  = minimum;
+        result.maximumLatency  = maximum;
+    }
+
+    return result;
+}
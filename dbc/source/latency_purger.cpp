@@ -0,0 +1,491 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyPurger class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QVariant>
+
+#include <algorithm>
+
+#include "log.h"
+#include "database_manager.h"
+#include "customer_capabilities.h"
+#include "customers_capabilities.h"
+#include "sql_helpers.h"
+#include "thread_placement.h"
+#include "latency_purger.h"
+
+const unsigned long LatencyPurger::defaultBatchSize          = 10000;
+const unsigned long LatencyPurger::defaultRowsPerSecond      = 50000;
+const unsigned long LatencyPurger::retryIntervalMilliseconds = 60000;
+
+LatencyPurger::LatencyPurger(
+        DatabaseManager* databaseManager,
+        QObject*         parent
+    ):QThread(
+        parent
+    ),currentDatabaseManager(
+        databaseManager
+    ) {
+    jobsQueued           = false;
+    shutdownRequested    = false;
+    currentBatchSize     = defaultBatchSize;
+    currentRowsPerSecond = defaultRowsPerSecond;
+}
+
+
+LatencyPurger::~LatencyPurger() {
+    jobMutex.lock();
+    shutdownRequested = true;
+    jobCondition.wakeAll();
+    jobMutex.unlock();
+
+    wait();
+}
+
+
+QString LatencyPurger::toString(LatencyPurger::Status status) {
+    QString result;
+    switch (status) {
+        case Status::PENDING:   { result = QString("PENDING");    break; }
+        case Status::RUNNING:   { result = QString("RUNNING");    break; }
+        case Status::COMPLETED: { result = QString("COMPLETED");  break; }
+        case Status::FAILED:    { result = QString("FAILED");     break; }
+        default:                { Q_ASSERT(false);                break; }
+    }
+
+    return result;
+}
+
+
+LatencyPurger::Status LatencyPurger::toStatus(const QString& str, bool* success) {
+    bool   ok = true;
+    Status result;
+
+    QString s = str.trimmed().toLower();
+    if (s == "pending") {
+        result = Status::PENDING;
+    } else if (s == "running") {
+        result = Status::RUNNING;
+    } else if (s == "completed") {
+        result = Status::COMPLETED;
+    } else if (s == "failed") {
+        result = Status::FAILED;
+    } else {
+        ok     = false;
+        result = Status::FAILED;
+    }
+
+    if (success != nullptr) {
+        *success = ok;
+    }
+
+    return result;
+}
+
+
+LatencyPurger::JobId LatencyPurger::startPurge(
+        const CustomersCapabilities::CustomerIdSet& customerIds,
+        const QStringList&                          tableNames,
+        unsigned                                    threadId
+    ) {
+    JobId result = invalidJobId;
+
+    QStringList customerIdStrings;
+    for (  CustomersCapabilities::CustomerIdSet::const_iterator it  = customerIds.constBegin(),
+                                                                end = customerIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        customerIdStrings.append(QString::number(*it));
+    }
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        success = SqlHelpers::execute(
+            query,
+            QString("INSERT INTO latency_purge_job (customer_ids, table_names) VALUES ('%1', '%2') RETURNING job_id")
+            .arg(customerIdStrings.join(","), tableNames.join(","))
+        );
+
+        if (success && query.next()) {
+            result = query.value(0).toULongLong(&success);
+            if (!success) {
+                result = invalidJobId;
+                logWrite(QString("Invalid job ID - LatencyPurger::startPurge"), true);
+            }
+        } else {
+            logWrite(
+                QString("Failed INSERT - LatencyPurger::startPurge: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyPurger::startPurge: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    if (result != invalidJobId) {
+        resumeJobs();
+    }
+
+    return result;
+}
+
+
+bool LatencyPurger::getJobStatus(LatencyPurger::JobId jobId, LatencyPurger::JobStatus& jobStatus, unsigned threadId) {
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery query(database);
+        query.setForwardOnly(true);
+
+        success = SqlHelpers::execute(
+            query,
+            QString("SELECT status, rows_deleted, table_index, table_names FROM latency_purge_job WHERE job_id = %1")
+            .arg(jobId)
+        );
+
+        if (success) {
+            if (query.next()) {
+                jobStatus.status = toStatus(query.value(0).toString(), &success);
+
+                if (success) {
+                    jobStatus.rowsDeleted = query.value(1).toULongLong(&success);
+                }
+
+                if (success) {
+                    jobStatus.numberTablesCompleted = query.value(2).toUInt(&success);
+                }
+
+                if (success) {
+                    jobStatus.numberTables = static_cast<unsigned>(
+                        query.value(3).toString().split(QChar(',')).size()
+                    );
+                } else {
+                    logWrite(QString("Invalid job entry %1 - LatencyPurger::getJobStatus").arg(jobId), true);
+                }
+            } else {
+                success = false;
+            }
+        } else {
+            logWrite(
+                QString("Failed SELECT - LatencyPurger::getJobStatus: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - LatencyPurger::getJobStatus: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+void LatencyPurger::setThrottle(unsigned long batchSize, unsigned long rowsPerSecond) {
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    currentBatchSize     = std::max(batchSize, 1UL);
+    currentRowsPerSecond = std::max(rowsPerSecond, 1UL);
+}
+
+
+void LatencyPurger::resumeJobs() {
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    jobsQueued = true;
+    if (isRunning()) {
+        jobCondition.wakeAll();
+    } else {
+        start();
+    }
+}
+
+
+void LatencyPurger::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::JOB);
+
+    jobMutex.lock();
+    bool shutdown = shutdownRequested;
+    jobMutex.unlock();
+
+    while (!shutdown) {
+        bool        jobFound   = false;
+        JobId       jobId      = invalidJobId;
+        unsigned    tableIndex = 0;
+        QString     customerIds;
+        QStringList tableNames;
+
+        jobMutex.lock();
+        jobsQueued = false;
+        jobMutex.unlock();
+
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString("LatencyPurger"));
+        bool success = database.isOpen();
+        if (success) {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+
+            // Interrupted jobs are left running so they are picked up here, oldest first, after a restart.
+            success = SqlHelpers::execute(
+                query,
+                "SELECT job_id, customer_ids, table_names, table_index FROM latency_purge_job "
+                "WHERE status IN ('PENDING', 'RUNNING') ORDER BY job_id ASC LIMIT 1"
+            );
+
+            if (success) {
+                if (query.next()) {
+                    jobId       = query.value(0).toULongLong(&success);
+                    customerIds = query.value(1).toString();
+                    tableNames  = query.value(2).toString().split(QChar(','));
+
+                    if (success) {
+                        tableIndex = query.value(3).toUInt(&success);
+                    }
+
+                    if (success) {
+                        success = purgeJob(database, jobId, customerIds, tableNames, tableIndex);
+                    } else {
+                        logWrite(QString("Invalid purge job %1 - LatencyPurger").arg(jobId), true);
+                        success = setJobStatus(database, jobId, Status::FAILED);
+                    }
+
+                    jobFound = true;
+                }
+            } else {
+                logWrite(QString("Failed SELECT - LatencyPurger: %1").arg(query.lastError().text()), true);
+            }
+        } else {
+            logWrite(
+                QString("Failed to open database - LatencyPurger: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+
+        if (!success) {
+            shutdown = waitOrShutdown(retryIntervalMilliseconds);
+        } else if (!jobFound) {
+            jobMutex.lock();
+            if (!jobsQueued && !shutdownRequested) {
+                jobCondition.wait(&jobMutex);
+            }
+
+            shutdown = shutdownRequested;
+            jobMutex.unlock();
+        } else {
+            jobMutex.lock();
+            shutdown = shutdownRequested;
+            jobMutex.unlock();
+        }
+    }
+}
+
+
+bool LatencyPurger::purgeJob(
+        QSqlDatabase&      database,
+        JobId              jobId,
+        const QString&     customerIds,
+        const QStringList& tableNames,
+        unsigned           tableIndex
+    ) {
+    bool success  = setJobStatus(database, jobId, Status::RUNNING);
+    bool shutdown = false;
+
+    unsigned numberTables = static_cast<unsigned>(tableNames.size());
+    while (success && !shutdown && tableIndex < numberTables) {
+        jobMutex.lock();
+        unsigned long batchSize     = currentBatchSize;
+        unsigned long rowsPerSecond = currentRowsPerSecond;
+        jobMutex.unlock();
+
+        unsigned long rowsDeleted = 0;
+        success = purgeBatch(
+            database,
+            jobId,
+            customerIds,
+            tableNames.at(tableIndex),
+            tableIndex,
+            batchSize,
+            rowsDeleted
+        );
+
+        if (success) {
+            if (rowsDeleted < batchSize) {
+                ++tableIndex;
+            }
+
+            // Pacing by the rows just deleted holds the long term delete rate at the configured limit regardless of
+            // the batch size.
+            if (rowsDeleted > 0) {
+                shutdown = waitOrShutdown((1000ULL * rowsDeleted) / rowsPerSecond);
+            }
+        }
+    }
+
+    if (success && !shutdown) {
+        success = setJobStatus(database, jobId, Status::COMPLETED);
+        if (success) {
+            logWrite(QString("Latency purge job %1 completed.").arg(jobId), false);
+        }
+    }
+
+    return success;
+}
+
+
+bool LatencyPurger::purgeBatch(
+        QSqlDatabase&  database,
+        JobId          jobId,
+        const QString& customerIds,
+        const QString& tableName,
+        unsigned       tableIndex,
+        unsigned long  batchSize,
+        unsigned long& rowsDeleted
+    ) {
+    bool supportsTransactions;
+    if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
+        supportsTransactions = true;
+        database.transaction();
+    } else {
+        supportsTransactions = false;
+    }
+
+    QSqlQuery query(database);
+
+    // Rows are addressed by table OID and tuple ID so batches work across the partitions of partitioned tables.
+    bool success = SqlHelpers::execute(
+        query,
+        QString(
+            "DELETE FROM %1 WHERE (tableoid, ctid) IN ("
+                "SELECT tableoid, ctid FROM %1 WHERE monitor_id IN ("
+                    "SELECT monitor_id FROM monitor WHERE customer_id IN (%2)"
+                ") LIMIT %3"
+            ")"
+        ).arg(tableName, customerIds)
+         .arg(batchSize)
+    );
+
+    if (success) {
+        int numberRowsAffected = query.numRowsAffected();
+        rowsDeleted            = numberRowsAffected > 0 ? static_cast<unsigned long>(numberRowsAffected) : 0;
+
+        unsigned nextTableIndex = rowsDeleted < batchSize ? tableIndex + 1 : tableIndex;
+        success = SqlHelpers::execute(
+            query,
+            QString(
+                "UPDATE latency_purge_job SET rows_deleted = rows_deleted + %1, table_index = %2 WHERE job_id = %3"
+            ).arg(rowsDeleted)
+             .arg(nextTableIndex)
+             .arg(jobId)
+        );
+
+        if (!success) {
+            logWrite(
+                QString("Failed UPDATE - LatencyPurger::purgeBatch: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    } else {
+        logWrite(
+            QString("Failed DELETE - LatencyPurger::purgeBatch: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    if (supportsTransactions) {
+        if (success) {
+            success = database.commit();
+            if (!success) {
+                logWrite(
+                    QString("Failed commit - LatencyPurger::purgeBatch: %1").arg(database.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            bool rollbackSuccess = database.rollback();
+            if (!rollbackSuccess) {
+                logWrite(
+                    QString("Failed rollback - LatencyPurger::purgeBatch: %1").arg(database.lastError().text()),
+                    true
+                );
+            }
+        }
+    }
+
+    return success;
+}
+
+
+bool LatencyPurger::setJobStatus(QSqlDatabase& database, LatencyPurger::JobId jobId, LatencyPurger::Status status) {
+    QSqlQuery query(database);
+
+    bool success = SqlHelpers::execute(
+        query,
+        QString("UPDATE latency_purge_job SET status = '%1' WHERE job_id = %2").arg(toString(status)).arg(jobId)
+    );
+
+    if (!success) {
+        logWrite(
+            QString("Failed UPDATE - LatencyPurger::setJobStatus: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool LatencyPurger::waitOrShutdown(unsigned long milliseconds) {
+    QMutexLocker jobMutexLocker(&jobMutex);
+
+    // Newly queued jobs also wake the condition so we keep waiting until the full period has elapsed.
+    QElapsedTimer timer;
+    timer.start();
+
+    unsigned long long elapsed = 0;
+    while (!shutdownRequested && elapsed < milliseconds) {
+        jobCondition.wait(&jobMutex, static_cast<unsigned long>(milliseconds - elapsed));
+        elapsed = static_cast<unsigned long long>(timer.elapsed());
+    }
+
+    return shutdownRequested;
+}
@@ -0,0 +1,203 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyResultCache class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInteger>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include <cstdint>
+
+#include "concurrent_cache.h"
+#include "latency_result_cache.h"
+
+LatencyResultCache::LatencyResultCache(unsigned long maximumCacheDepth):entryCache(maximumCacheDepth) {
+    currentCacheDepth   = maximumCacheDepth;
+    underMemoryPressure = false;
+
+    averageEntryBytes.storeRelease(0);
+    currentTimeToLive.storeRelease(defaultTimeToLiveMilliseconds);
+    clock.start();
+}
+
+
+LatencyResultCache::~LatencyResultCache() {}
+
+
+void LatencyResultCache::resizeCache(unsigned long newCacheSize) {
+    QMutexLocker depthMutexLocker(&depthMutex);
+    currentCacheDepth = newCacheSize;
+    applyCacheDepth();
+}
+
+
+CacheBase::Statistics LatencyResultCache::statistics() const {
+    return entryCache.statistics();
+}
+
+
+unsigned long long LatencyResultCache::memoryUsage() const {
+    return entryCache.statistics().numberEntries * averageEntryBytes.loadAcquire();
+}
+
+
+void LatencyResultCache::setMemoryPressure(bool underPressure) {
+    QMutexLocker depthMutexLocker(&depthMutex);
+    if (underPressure != underMemoryPressure) {
+        underMemoryPressure = underPressure;
+        applyCacheDepth();
+    }
+}
+
+
+void LatencyResultCache::applyCacheDepth() {
+    entryCache.resizeCache(underMemoryPressure ? currentCacheDepth / pressureShrinkFactor : currentCacheDepth);
+}
+
+
+void LatencyResultCache::updateAverageEntryBytes(unsigned long long entryBytes) {
+    // An exponential moving average is close enough for budgeting and needs no lock.  Concurrent updates may lose a
+    // sample.
+    quint64 average = averageEntryBytes.loadAcquire();
+    averageEntryBytes.storeRelease(average == 0 ? entryBytes : (7 * average + entryBytes) / 8);
+}
+
+
+void LatencyResultCache::setTimeToLive(unsigned long timeToLiveMilliseconds) {
+    currentTimeToLive.storeRelease(timeToLiveMilliseconds);
+    if (timeToLiveMilliseconds == 0) {
+        entryCache.clearCache();
+    }
+}
+
+
+bool LatencyResultCache::startQuery(
+        const QByteArray&  key,
+        unsigned long long dataVersion,
+        LatencyEntryLists& result
+    ) {
+    bool found = getResult(key, dataVersion, result);
+    if (!found) {
+        QMutexLocker inFlightLocker(&inFlightMutex);
+
+        bool done = false;
+        do {
+            Flight* flight = flights.value(key, nullptr);
+            if (flight == nullptr) {
+                flights.insert(key, new Flight);
+                done = true;
+            } else {
+                ++flight->numberWaiters;
+                while (!flight->finished) {
+                    inFlightCondition.wait(&inFlightMutex);
+                }
+                --flight->numberWaiters;
+
+                // A result read from older data is not shared.  We then run the query ourselves or wait on whoever
+                // started it first.
+                if (flight->succeeded && flight->result.dataVersion == dataVersion) {
+                    result = flight->result.entries;
+                    found  = true;
+                    done   = true;
+                }
+
+                if (flight->numberWaiters == 0) {
+                    delete flight;
+                }
+            }
+        } while (!done);
+    }
+
+    return found;
+}
+
+
+void LatencyResultCache::finishQuery(
+        const QByteArray&        key,
+        unsigned long long       dataVersion,
+        const LatencyEntryLists* result
+    ) {
+    Result cachedResult;
+    if (result != nullptr) {
+        cachedResult.key            = key;
+        cachedResult.dataVersion    = dataVersion;
+        cachedResult.expirationTime = clock.elapsed() + static_cast<qint64>(currentTimeToLive.loadAcquire());
+        cachedResult.entries        = *result;
+
+        if (currentTimeToLive.loadAcquire() > 0) {
+            updateAverageEntryBytes(
+                  sizeof(Result)
+                + static_cast<unsigned long long>(key.size())
+                + sizeof(LatencyEntry) * static_cast<unsigned long long>(result->first.size())
+                + sizeof(AggregatedLatencyEntry) * static_cast<unsigned long long>(result->second.size())
+            );
+
+            entryCache.addToCache(cachedResult);
+        }
+    }
+
+    QMutexLocker inFlightLocker(&inFlightMutex);
+
+    Flight* flight = flights.take(key);
+    if (flight != nullptr) {
+        if (flight->numberWaiters == 0) {
+            delete flight;
+        } else {
+            flight->finished  = true;
+            flight->succeeded = result != nullptr;
+            flight->result    = cachedResult;
+
+            inFlightCondition.wakeAll();
+        }
+    }
+}
+
+
+std::uint64_t LatencyResultCache::keyHash(const QByteArray& key) {
+    QByteArray digest = QCryptographicHash::hash(key, QCryptographicHash::Algorithm::Sha1);
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(digest.constData()));
+}
+
+
+bool LatencyResultCache::getResult(
+        const QByteArray&  key,
+        unsigned long long dataVersion,
+        LatencyEntryLists& result
+    ) const {
+    Result cachedResult;
+    bool   success = entryCache.getCacheEntry(keyHash(key), cachedResult);
+
+    // The key is compared as well so that a hash collision can never serve the wrong result.
+    if (success                                      &&
+        cachedResult.dataVersion == dataVersion      &&
+        cachedResult.key == key                      &&
+        cachedResult.expirationTime > clock.elapsed()   ) {
+        result = cachedResult.entries;
+    } else {
+        success = false;
+    }
+
+    return success;
+}
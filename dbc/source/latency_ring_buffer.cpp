@@ -0,0 +1,380 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyRingBuffer class.
+***********************************************************************************************************************/
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QVector>
+#include <QDateTime>
+
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "server.h"
+#include "latency_entry.h"
+#include "latency_ring_buffer.h"
+
+/***********************************************************************************************************************
+* LatencyRingBuffer::Series
+*/
+
+LatencyRingBuffer::Series::Series() {
+    currentFirst              = 0;
+    currentSize               = 0;
+    currentOverwrittenThrough = 0;
+}
+
+
+LatencyRingBuffer::Series::~Series() {}
+
+
+void LatencyRingBuffer::Series::append(const Sample& sample) {
+    unsigned capacity = static_cast<unsigned>(samples.size());
+    if (currentSize == capacity) {
+        if (capacity < maximumEntriesPerSeries) {
+            unsigned        newCapacity = capacity == 0 ? 16 : 2 * capacity;
+            QVector<Sample> newSamples(newCapacity);
+            for (unsigned i=0 ; i<currentSize ; ++i) {
+                newSamples[i] = samples.at((currentFirst + i) & (capacity - 1));
+            }
+
+            samples      = newSamples;
+            currentFirst = 0;
+            capacity     = newCapacity;
+        } else {
+            const Sample& oldest = samples.at(currentFirst);
+            if (oldest.zoranTimestamp > currentOverwrittenThrough) {
+                currentOverwrittenThrough = oldest.zoranTimestamp;
+            }
+
+            currentFirst = (currentFirst + 1) & (capacity - 1);
+            --currentSize;
+        }
+    }
+
+    samples[(currentFirst + currentSize) & (capacity - 1)] = sample;
+    ++currentSize;
+}
+
+
+void LatencyRingBuffer::Series::expire(ZoranTimeStamp cutoff) {
+    unsigned mask = static_cast<unsigned>(samples.size()) - 1;
+    while (currentSize > 0 && samples.at(currentFirst).zoranTimestamp < cutoff) {
+        currentFirst = (currentFirst + 1) & mask;
+        --currentSize;
+    }
+}
+
+
+bool LatencyRingBuffer::Series::isEmpty() const {
+    return currentSize == 0;
+}
+
+
+const LatencyRingBuffer::Sample& LatencyRingBuffer::Series::at(unsigned index) const {
+    return samples.at((currentFirst + index) & (static_cast<unsigned>(samples.size()) - 1));
+}
+
+
+unsigned LatencyRingBuffer::Series::size() const {
+    return currentSize;
+}
+
+
+LatencyRingBuffer::ZoranTimeStamp LatencyRingBuffer::Series::overwrittenThrough() const {
+    return currentOverwrittenThrough;
+}
+
+/***********************************************************************************************************************
+* LatencyRingBuffer
+*/
+
+const unsigned long LatencyRingBuffer::defaultRetention = 6 * 60 * 60;
+const unsigned      LatencyRingBuffer::maximumEntriesPerSeries = 8192;
+
+LatencyRingBuffer::LatencyRingBuffer() {
+    currentRetention.storeRelease(defaultRetention);
+    currentCoverageStart.storeRelease(QDateTime::currentSecsSinceEpoch());
+}
+
+
+LatencyRingBuffer::~LatencyRingBuffer() {}
+
+
+void LatencyRingBuffer::setRetention(unsigned long retentionSeconds) {
+    if (retentionSeconds != currentRetention.loadAcquire()) {
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            stripes[stripeIndex].mutex.lock();
+        }
+
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            stripes[stripeIndex].seriesByMonitor.clear();
+        }
+
+        currentRetention.storeRelease(retentionSeconds);
+        currentCoverageStart.storeRelease(QDateTime::currentSecsSinceEpoch());
+
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            stripes[stripeIndex].mutex.unlock();
+        }
+    }
+}
+
+
+unsigned long LatencyRingBuffer::retention() const {
+    return static_cast<unsigned long>(currentRetention.loadAcquire());
+}
+
+
+void LatencyRingBuffer::addEntry(
+        MonitorId           monitorId,
+        ServerId            serverId,
+        ZoranTimeStamp      zoranTimestamp,
+        LatencyMicroseconds latencyMicroseconds
+    ) {
+    unsigned long retentionSeconds = static_cast<unsigned long>(currentRetention.loadAcquire());
+    if (retentionSeconds != 0) {
+        ZoranTimeStamp cutoff = cutoffTimestamp(retentionSeconds);
+        if (zoranTimestamp >= cutoff) {
+            Stripe&      stripe = stripes[monitorId % numberStripes];
+            QMutexLocker locker(&stripe.mutex);
+
+            Series& series = stripe.seriesByMonitor[monitorId][serverId];
+            series.expire(cutoff);
+
+            Sample sample;
+            sample.zoranTimestamp      = zoranTimestamp;
+            sample.latencyMicroseconds = latencyMicroseconds;
+
+            series.append(sample);
+        }
+    }
+}
+
+
+void LatencyRingBuffer::addEntries(const LatencyEntryList& latencyEntries) {
+    for (  LatencyEntryList::const_iterator it = latencyEntries.constBegin(), end = latencyEntries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        addEntry(it->monitorId(), it->serverId(), it->zoranTimestamp(), it->latencyMicroseconds());
+    }
+}
+
+
+void LatencyRingBuffer::removeMonitors(const MonitorIdSet& monitorIds) {
+    for (MonitorIdSet::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        MonitorId    monitorId = *it;
+        Stripe&      stripe    = stripes[monitorId % numberStripes];
+        QMutexLocker locker(&stripe.mutex);
+
+        stripe.seriesByMonitor.remove(monitorId);
+    }
+}
+
+
+void LatencyRingBuffer::expire() {
+    unsigned long retentionSeconds = static_cast<unsigned long>(currentRetention.loadAcquire());
+    if (retentionSeconds != 0) {
+        ZoranTimeStamp cutoff = cutoffTimestamp(retentionSeconds);
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            Stripe&      stripe = stripes[stripeIndex];
+            QMutexLocker locker(&stripe.mutex);
+
+            QHash<MonitorId, SeriesByServer>::iterator monitorIterator = stripe.seriesByMonitor.begin();
+            while (monitorIterator != stripe.seriesByMonitor.end()) {
+                SeriesByServer&          seriesByServer = monitorIterator.value();
+                SeriesByServer::iterator seriesIterator = seriesByServer.begin();
+                while (seriesIterator != seriesByServer.end()) {
+                    seriesIterator.value().expire(cutoff);
+                    if (seriesIterator.value().isEmpty()) {
+                        seriesIterator = seriesByServer.erase(seriesIterator);
+                    } else {
+                        ++seriesIterator;
+                    }
+                }
+
+                if (seriesByServer.isEmpty()) {
+                    monitorIterator = stripe.seriesByMonitor.erase(monitorIterator);
+                } else {
+                    ++monitorIterator;
+                }
+            }
+        }
+    }
+}
+
+
+unsigned long long LatencyRingBuffer::getEntries(
+        const MonitorIdSet* monitorIds,
+        ServerId            serverId,
+        unsigned long long  startTimestamp,
+        unsigned long long  endTimestamp,
+        LatencyEntryList&   latencyEntries
+    ) const {
+    unsigned long long result;
+
+    unsigned long retentionSeconds = static_cast<unsigned long>(currentRetention.loadAcquire());
+    if (retentionSeconds != 0) {
+        ZoranTimeStamp coverageStart = std::max(
+            cutoffTimestamp(retentionSeconds),
+            LatencyEntry::toZoranTimestamp(currentCoverageStart.loadAcquire())
+        );
+
+        ZoranTimeStamp zoranStart;
+        if (startTimestamp <= LatencyEntry::startOfZoranEpoch) {
+            zoranStart = 0;
+        } else if (startTimestamp - LatencyEntry::startOfZoranEpoch >= std::numeric_limits<ZoranTimeStamp>::max()) {
+            zoranStart = std::numeric_limits<ZoranTimeStamp>::max();
+        } else {
+            zoranStart = LatencyEntry::toZoranTimestamp(startTimestamp);
+        }
+
+        ZoranTimeStamp zoranEnd;
+        if (endTimestamp < LatencyEntry::startOfZoranEpoch) {
+            zoranEnd = 0;
+        } else if (endTimestamp - LatencyEntry::startOfZoranEpoch >= std::numeric_limits<ZoranTimeStamp>::max()) {
+            zoranEnd = std::numeric_limits<ZoranTimeStamp>::max();
+        } else {
+            zoranEnd = LatencyEntry::toZoranTimestamp(endTimestamp);
+        }
+
+        if (endTimestamp >= LatencyEntry::startOfZoranEpoch && zoranStart <= zoranEnd) {
+            if (monitorIds != nullptr) {
+                for (  MonitorIdSet::const_iterator it  = monitorIds->constBegin(), end = monitorIds->constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    MonitorId     monitorId = *it;
+                    const Stripe& stripe    = stripes[monitorId % numberStripes];
+                    QMutexLocker  locker(&stripe.mutex);
+
+                    QHash<MonitorId, SeriesByServer>::const_iterator monitorIterator =
+                        stripe.seriesByMonitor.constFind(monitorId);
+                    if (monitorIterator != stripe.seriesByMonitor.constEnd()) {
+                        readSeries(
+                            monitorIterator.value(),
+                            monitorId,
+                            serverId,
+                            zoranStart,
+                            zoranEnd,
+                            coverageStart,
+                            latencyEntries
+                        );
+                    }
+                }
+            } else {
+                for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+                    const Stripe& stripe = stripes[stripeIndex];
+                    QMutexLocker  locker(&stripe.mutex);
+
+                    for (  QHash<MonitorId, SeriesByServer>::const_iterator
+                               it  = stripe.seriesByMonitor.constBegin(),
+                               end = stripe.seriesByMonitor.constEnd()
+                         ; it != end
+                         ; ++it
+                        ) {
+                        readSeries(it.value(), it.key(), serverId, zoranStart, zoranEnd, coverageStart, latencyEntries);
+                    }
+                }
+            }
+
+            // Overwritten samples can move the coverage start after entries were read so we filter at the end.
+            ZoranTimeStamp firstIncluded = std::max(coverageStart, zoranStart);
+            LatencyEntryList::iterator newEnd = std::remove_if(
+                latencyEntries.begin(),
+                latencyEntries.end(),
+                [firstIncluded](const LatencyEntry& entry) { return entry.zoranTimestamp() < firstIncluded; }
+            );
+            latencyEntries.erase(newEnd, latencyEntries.end());
+
+            std::sort(
+                latencyEntries.begin(),
+                latencyEntries.end(),
+                [](const LatencyEntry& a, const LatencyEntry& b) {
+                    return (
+                           a.zoranTimestamp() < b.zoranTimestamp()
+                        || (a.zoranTimestamp() == b.zoranTimestamp() && a.monitorId() < b.monitorId())
+                        || (   a.zoranTimestamp() == b.zoranTimestamp()
+                            && a.monitorId() == b.monitorId()
+                            && a.serverId() < b.serverId()
+                           )
+                    );
+                }
+            );
+        }
+
+        result = LatencyEntry::toUnixTimestamp(coverageStart);
+    } else {
+        result = std::numeric_limits<unsigned long long>::max();
+    }
+
+    return result;
+}
+
+
+void LatencyRingBuffer::readSeries(
+        const SeriesByServer& seriesByServer,
+        MonitorId             monitorId,
+        ServerId              serverId,
+        ZoranTimeStamp        startTimestamp,
+        ZoranTimeStamp        endTimestamp,
+        ZoranTimeStamp&       coverageStart,
+        LatencyEntryList&     latencyEntries
+    ) {
+    for (  SeriesByServer::const_iterator it = seriesByServer.constBegin(), end = seriesByServer.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (serverId == Server::invalidServerId || it.key() == serverId) {
+            const Series& series = it.value();
+            if (series.overwrittenThrough() >= coverageStart) {
+                coverageStart = series.overwrittenThrough() + 1;
+            }
+
+            unsigned numberSamples = series.size();
+            for (unsigned i=0 ; i<numberSamples ; ++i) {
+                const Sample& sample = series.at(i);
+                if (sample.zoranTimestamp >= startTimestamp && sample.zoranTimestamp <= endTimestamp) {
+                    latencyEntries.append(
+                        LatencyEntry(monitorId, it.key(), sample.zoranTimestamp, sample.latencyMicroseconds)
+                    );
+                }
+            }
+        }
+    }
+}
+
+
+LatencyRingBuffer::ZoranTimeStamp LatencyRingBuffer::cutoffTimestamp(unsigned long retentionSeconds) {
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+    ZoranTimeStamp     result;
+
+    if (currentTime > LatencyEntry::startOfZoranEpoch + retentionSeconds) {
+        result = LatencyEntry::toZoranTimestamp(currentTime - retentionSeconds);
+    } else {
+        result = 0;
+    }
+
+    return result;
+}
@@ -0,0 +1,422 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref LatencyRollingStatistics class.
+***********************************************************************************************************************/
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QString>
+#include <QDateTime>
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "server.h"
+#include "latency_entry.h"
+#include "latency_rolling_statistics.h"
+
+/***********************************************************************************************************************
+* LatencyRollingStatistics::Accumulator
+*/
+
+LatencyRollingStatistics::Accumulator::Accumulator() {
+    currentWeight     = 0;
+    currentMean       = 0;
+    currentSumSquares = 0;
+
+    for (unsigned i=0 ; i<numberBuckets ; ++i) {
+        currentBuckets[i] = 0;
+    }
+}
+
+
+LatencyRollingStatistics::Accumulator::~Accumulator() {}
+
+
+void LatencyRollingStatistics::Accumulator::decay(double factor) {
+    currentWeight     *= factor;
+    currentSumSquares *= factor;
+
+    float bucketFactor = static_cast<float>(factor);
+    for (unsigned i=0 ; i<numberBuckets ; ++i) {
+        currentBuckets[i] *= bucketFactor;
+    }
+}
+
+
+void LatencyRollingStatistics::Accumulator::add(double latency, unsigned bucket) {
+    double newWeight = currentWeight + 1.0;
+    double delta     = latency - currentMean;
+
+    currentMean       += delta / newWeight;
+    currentSumSquares += delta * (latency - currentMean);
+    currentWeight      = newWeight;
+
+    currentBuckets[bucket] += 1.0F;
+}
+
+
+void LatencyRollingStatistics::Accumulator::merge(const Accumulator& other) {
+    if (other.currentWeight > 0) {
+        double newWeight = currentWeight + other.currentWeight;
+        double delta     = other.currentMean - currentMean;
+
+        currentMean       += delta * other.currentWeight / newWeight;
+        currentSumSquares += other.currentSumSquares + delta * delta * currentWeight * other.currentWeight / newWeight;
+        currentWeight      = newWeight;
+
+        for (unsigned i=0 ; i<numberBuckets ; ++i) {
+            currentBuckets[i] += other.currentBuckets[i];
+        }
+    }
+}
+
+
+LatencyRollingStatistics::Summary LatencyRollingStatistics::Accumulator::toSummary(
+        ZoranTimeStamp lastZoranTimestamp
+    ) const {
+    Summary result;
+
+    if (currentWeight > 0) {
+        result.weight            = currentWeight;
+        result.meanLatency       = currentMean;
+        result.varianceLatency   = std::max(0.0, currentSumSquares / currentWeight);
+        result.p50Latency        = quantile(0.50);
+        result.p90Latency        = quantile(0.90);
+        result.p99Latency        = quantile(0.99);
+        result.lastUnixTimestamp = LatencyEntry::toUnixTimestamp(lastZoranTimestamp);
+    }
+
+    return result;
+}
+
+
+double LatencyRollingStatistics::Accumulator::quantile(double fraction) const {
+    double total = 0;
+    for (unsigned i=0 ; i<numberBuckets ; ++i) {
+        total += currentBuckets[i];
+    }
+
+    double   target     = fraction * total;
+    double   cumulative = 0;
+    double   result     = 0;
+    bool     found      = false;
+    unsigned bucket     = 0;
+    while (!found && bucket < numberBuckets) {
+        double count = currentBuckets[bucket];
+        if (count > 0 && cumulative + count >= target) {
+            double lowerLimit = bucketLowerLimit(bucket);
+            double upperLimit =   bucket + 1 < numberBuckets
+                                ? bucketLowerLimit(bucket + 1)
+                                : lowerLimit * std::sqrt(2.0);
+
+            result = lowerLimit + (upperLimit - lowerLimit) * std::max(0.0, target - cumulative) / count;
+            found  = true;
+        } else {
+            cumulative += count;
+            ++bucket;
+        }
+    }
+
+    return result;
+}
+
+/***********************************************************************************************************************
+* LatencyRollingStatistics::Series
+*/
+
+LatencyRollingStatistics::Series::Series() {
+    currentLastTimestamp = 0;
+}
+
+
+LatencyRollingStatistics::Series::~Series() {}
+
+
+void LatencyRollingStatistics::Series::add(ZoranTimeStamp zoranTimestamp, LatencyMicroseconds latencyMicroseconds) {
+    if (zoranTimestamp > currentLastTimestamp) {
+        double elapsed = static_cast<double>(zoranTimestamp - currentLastTimestamp);
+        for (unsigned window=0 ; window<numberWindows ; ++window) {
+            accumulators[window].decay(std::exp(-elapsed / windowSeconds[window]));
+        }
+
+        currentLastTimestamp = zoranTimestamp;
+    }
+
+    double   latency = static_cast<double>(latencyMicroseconds);
+    unsigned bucket  = bucketIndex(latency);
+    for (unsigned window=0 ; window<numberWindows ; ++window) {
+        accumulators[window].add(latency, bucket);
+    }
+}
+
+
+void LatencyRollingStatistics::Series::mergeInto(
+        Window         window,
+        ZoranTimeStamp zoranTimestamp,
+        Accumulator&   accumulator
+    ) const {
+    unsigned    windowIndex = static_cast<unsigned>(window);
+    Accumulator decayed     = accumulators[windowIndex];
+    if (zoranTimestamp > currentLastTimestamp) {
+        double elapsed = static_cast<double>(zoranTimestamp - currentLastTimestamp);
+        decayed.decay(std::exp(-elapsed / windowSeconds[windowIndex]));
+    }
+
+    accumulator.merge(decayed);
+}
+
+
+LatencyRollingStatistics::ZoranTimeStamp LatencyRollingStatistics::Series::lastTimestamp() const {
+    return currentLastTimestamp;
+}
+
+/***********************************************************************************************************************
+* LatencyRollingStatistics
+*/
+
+const unsigned long LatencyRollingStatistics::windowSeconds[numberWindows] = { 5 * 60, 60 * 60, 24 * 60 * 60 };
+const unsigned long LatencyRollingStatistics::maximumIdleSeconds           = 3 * 24 * 60 * 60;
+const double        LatencyRollingStatistics::firstBucketLimit             = 1000.0;
+
+LatencyRollingStatistics::LatencyRollingStatistics() {
+    currentEnabled.storeRelease(1);
+}
+
+
+LatencyRollingStatistics::~LatencyRollingStatistics() {}
+
+
+void LatencyRollingStatistics::setEnabled(bool nowEnabled) {
+    if (currentEnabled.fetchAndStoreOrdered(nowEnabled ? 1 : 0) != 0 && !nowEnabled) {
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            Stripe&      stripe = stripes[stripeIndex];
+            QMutexLocker locker(&stripe.mutex);
+
+            stripe.seriesByMonitor.clear();
+        }
+    }
+}
+
+
+bool LatencyRollingStatistics::isEnabled() const {
+    return currentEnabled.loadAcquire() != 0;
+}
+
+
+void LatencyRollingStatistics::addEntry(
+        MonitorId           monitorId,
+        ServerId            serverId,
+        ZoranTimeStamp      zoranTimestamp,
+        LatencyMicroseconds latencyMicroseconds
+    ) {
+    if (currentEnabled.loadAcquire() != 0) {
+        Stripe&      stripe = stripes[monitorId % numberStripes];
+        QMutexLocker locker(&stripe.mutex);
+
+        stripe.seriesByMonitor[monitorId][serverId].add(zoranTimestamp, latencyMicroseconds);
+    }
+}
+
+
+void LatencyRollingStatistics::addEntries(const LatencyEntryList& latencyEntries) {
+    for (  LatencyEntryList::const_iterator it = latencyEntries.constBegin(), end = latencyEntries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        addEntry(it->monitorId(), it->serverId(), it->zoranTimestamp(), it->latencyMicroseconds());
+    }
+}
+
+
+void LatencyRollingStatistics::removeMonitors(const MonitorIdSet& monitorIds) {
+    for (MonitorIdSet::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+        MonitorId    monitorId = *it;
+        Stripe&      stripe    = stripes[monitorId % numberStripes];
+        QMutexLocker locker(&stripe.mutex);
+
+        stripe.seriesByMonitor.remove(monitorId);
+    }
+}
+
+
+void LatencyRollingStatistics::expire() {
+    ZoranTimeStamp now = currentZoranTimestamp();
+    if (now > maximumIdleSeconds) {
+        ZoranTimeStamp cutoff = static_cast<ZoranTimeStamp>(now - maximumIdleSeconds);
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            Stripe&      stripe = stripes[stripeIndex];
+            QMutexLocker locker(&stripe.mutex);
+
+            QHash<MonitorId, SeriesByServer>::iterator monitorIterator = stripe.seriesByMonitor.begin();
+            while (monitorIterator != stripe.seriesByMonitor.end()) {
+                SeriesByServer&          seriesByServer = monitorIterator.value();
+                SeriesByServer::iterator seriesIterator = seriesByServer.begin();
+                while (seriesIterator != seriesByServer.end()) {
+                    if (seriesIterator.value().lastTimestamp() < cutoff) {
+                        seriesIterator = seriesByServer.erase(seriesIterator);
+                    } else {
+                        ++seriesIterator;
+                    }
+                }
+
+                if (seriesByServer.isEmpty()) {
+                    monitorIterator = stripe.seriesByMonitor.erase(monitorIterator);
+                } else {
+                    ++monitorIterator;
+                }
+            }
+        }
+    }
+}
+
+
+LatencyRollingStatistics::Summary LatencyRollingStatistics::summary(
+        MonitorId monitorId,
+        ServerId  serverId,
+        Window    window
+    ) const {
+    Summary result;
+
+    const Stripe& stripe = stripes[monitorId % numberStripes];
+    QMutexLocker  locker(&stripe.mutex);
+
+    QHash<MonitorId, SeriesByServer>::const_iterator monitorIterator = stripe.seriesByMonitor.constFind(monitorId);
+    if (monitorIterator != stripe.seriesByMonitor.constEnd()) {
+        result = summarizeSeries(monitorIterator.value(), serverId, window, currentZoranTimestamp());
+    }
+
+    return result;
+}
+
+
+LatencyRollingStatistics::SummariesByMonitorId LatencyRollingStatistics::summaries(
+        const MonitorIdSet* monitorIds,
+        ServerId            serverId,
+        Window              window
+    ) const {
+    SummariesByMonitorId result;
+    ZoranTimeStamp       now = currentZoranTimestamp();
+
+    if (monitorIds != nullptr) {
+        for (MonitorIdSet::const_iterator it=monitorIds->constBegin(),end=monitorIds->constEnd() ; it!=end ; ++it) {
+            MonitorId     monitorId = *it;
+            const Stripe& stripe    = stripes[monitorId % numberStripes];
+            QMutexLocker  locker(&stripe.mutex);
+
+            QHash<MonitorId, SeriesByServer>::const_iterator monitorIterator = stripe.seriesByMonitor.constFind(
+                monitorId
+            );
+            if (monitorIterator != stripe.seriesByMonitor.constEnd()) {
+                Summary summary = summarizeSeries(monitorIterator.value(), serverId, window, now);
+                if (summary.isValid()) {
+                    result.insert(monitorId, summary);
+                }
+            }
+        }
+    } else {
+        for (unsigned stripeIndex=0 ; stripeIndex<numberStripes ; ++stripeIndex) {
+            const Stripe& stripe = stripes[stripeIndex];
+            QMutexLocker  locker(&stripe.mutex);
+
+            for (  QHash<MonitorId, SeriesByServer>::const_iterator
+                       it  = stripe.seriesByMonitor.constBegin(),
+                       end = stripe.seriesByMonitor.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                Summary summary = summarizeSeries(it.value(), serverId, window, now);
+                if (summary.isValid()) {
+                    result.insert(it.key(), summary);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+QString LatencyRollingStatistics::toString(Window window) {
+    QString result;
+
+    switch (window) {
+        case Window::FIVE_MINUTES: { result = QString("5m");   break; }
+        case Window::ONE_HOUR:     { result = QString("1h");   break; }
+        case Window::ONE_DAY:      { result = QString("24h");  break; }
+        default:                   { Q_ASSERT(false);          break; }
+    }
+
+    return result;
+}
+
+
+LatencyRollingStatistics::Summary LatencyRollingStatistics::summarizeSeries(
+        const SeriesByServer& seriesByServer,
+        ServerId              serverId,
+        Window                window,
+        ZoranTimeStamp        zoranTimestamp
+    ) {
+    Accumulator    accumulator;
+    ZoranTimeStamp lastTimestamp = 0;
+
+    if (serverId != Server::invalidServerId) {
+        SeriesByServer::const_iterator seriesIterator = seriesByServer.constFind(serverId);
+        if (seriesIterator != seriesByServer.constEnd()) {
+            seriesIterator.value().mergeInto(window, zoranTimestamp, accumulator);
+            lastTimestamp = seriesIterator.value().lastTimestamp();
+        }
+    } else {
+        for (  SeriesByServer::const_iterator it = seriesByServer.constBegin(), end = seriesByServer.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            it.value().mergeInto(window, zoranTimestamp, accumulator);
+            lastTimestamp = std::max(lastTimestamp, it.value().lastTimestamp());
+        }
+    }
+
+    return accumulator.toSummary(lastTimestamp);
+}
+
+
+unsigned LatencyRollingStatistics::bucketIndex(double latency) {
+    unsigned result;
+
+    if (latency < firstBucketLimit) {
+        result = 0;
+    } else {
+        double index = 1.0 + std::floor(2.0 * std::log2(latency / firstBucketLimit));
+        result = static_cast<unsigned>(std::min(index, static_cast<double>(numberBuckets - 1)));
+    }
+
+    return result;
+}
+
+
+double LatencyRollingStatistics::bucketLowerLimit(unsigned bucket) {
+    return bucket == 0 ? 0.0 : firstBucketLimit * std::pow(2.0, 0.5 * (bucket - 1));
+}
+
+
+LatencyRollingStatistics::ZoranTimeStamp LatencyRollingStatistics::currentZoranTimestamp() {
+    return LatencyEntry::toZoranTimestamp(static_cast<std::uint64_t>(QDateTime::currentSecsSinceEpoch()));
+}
@@ -0,0 +1,191 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencyRollup class.
+***********************************************************************************************************************/
+
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QRandomGenerator>
+
+#include <cstdint>
+#include <limits>
+
+#include "latency_entry.h"
+#include "aggregated_latency_entry.h"
+#include "latency_sketch.h"
+#include "latency_rollup.h"
+
+/***********************************************************************************************************************
+* LatencyRollup::Accumulator
+*/
+
+LatencyRollup::Accumulator::Accumulator() {
+    numberSamples         = 0;
+    meanLatency           = 0;
+    sumSquaredDifferences = 0;
+    minimumLatency        = std::numeric_limits<LatencyEntry::LatencyMicroseconds>::max();
+    maximumLatency        = 0;
+    sampleZoranTimestamp  = 0;
+    sampleLatency         = 0;
+}
+
+
+void LatencyRollup::Accumulator::add(
+        LatencyEntry::ZoranTimeStamp      zoranTimestamp,
+        LatencyEntry::LatencyMicroseconds latencyMicroseconds,
+        QRandomGenerator&                 randomGenerator
+    ) {
+    ++numberSamples;
+
+    double value = static_cast<double>(latencyMicroseconds);
+    double delta = value - meanLatency;
+    meanLatency           += delta / numberSamples;
+    sumSquaredDifferences += delta * (value - meanLatency);
+
+    if (latencyMicroseconds < minimumLatency) {
+        minimumLatency = latencyMicroseconds;
+    }
+
+    if (latencyMicroseconds > maximumLatency) {
+        maximumLatency = latencyMicroseconds;
+    }
+
+    sketch.addValue(latencyMicroseconds);
+
+    // Single entry reservoir: the n'th sample replaces the held sample with probability 1/n.
+    if (randomGenerator.bounded(static_cast<quint32>(numberSamples)) == 0) {
+        sampleZoranTimestamp = zoranTimestamp;
+        sampleLatency        = latencyMicroseconds;
+    }
+}
+
+/***********************************************************************************************************************
+* LatencyRollup
+*/
+
+LatencyRollup::LatencyRollup(
+        unsigned long      resamplePeriod,
+        unsigned long long coverageStart
+    ):currentResamplePeriod(
+        resamplePeriod
+    ),currentCoverageStart(
+        coverageStart
+    ),randomGenerator(
+        QRandomGenerator::global()->generate()
+    ) {}
+
+
+LatencyRollup::~LatencyRollup() {}
+
+
+unsigned long LatencyRollup::resamplePeriod() const {
+    return currentResamplePeriod;
+}
+
+
+unsigned long long LatencyRollup::coverageStart() const {
+    return currentCoverageStart;
+}
+
+
+unsigned long LatencyRollup::numberAccumulators() const {
+    unsigned long result = 0;
+    for (  QMap<unsigned long long, AccumulatorsByKey>::const_iterator it  = accumulatorsByPeriod.constBegin(),
+                                                                       end = accumulatorsByPeriod.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        result += static_cast<unsigned long>(it.value().size());
+    }
+
+    return result;
+}
+
+
+void LatencyRollup::addEntry(
+        MonitorId                         monitorId,
+        ServerId                          serverId,
+        LatencyEntry::ZoranTimeStamp      zoranTimestamp,
+        LatencyEntry::LatencyMicroseconds latencyMicroseconds
+    ) {
+    unsigned long long timestamp = LatencyEntry::toUnixTimestamp(zoranTimestamp);
+    if (timestamp >= currentCoverageStart) {
+        unsigned long long periodStart = timestamp - (timestamp % currentResamplePeriod);
+        accumulatorsByPeriod[periodStart][key(monitorId, serverId)].add(
+            zoranTimestamp,
+            latencyMicroseconds,
+            randomGenerator
+        );
+    }
+}
+
+
+LatencyRollup::AggregatedLatencyEntryList LatencyRollup::closedPeriods(
+        unsigned long long    closeThreshold,
+        QList<LatencySketch>* latencySketches
+    ) const {
+    AggregatedLatencyEntryList result;
+
+    QMap<unsigned long long, AccumulatorsByKey>::const_iterator periodIterator    = accumulatorsByPeriod.constBegin();
+    QMap<unsigned long long, AccumulatorsByKey>::const_iterator periodEndIterator = accumulatorsByPeriod.constEnd();
+    while (periodIterator != periodEndIterator && periodIterator.key() + currentResamplePeriod <= closeThreshold) {
+        unsigned long long       periodStart  = periodIterator.key();
+        unsigned long long       periodEnd    = periodStart + currentResamplePeriod;
+        const AccumulatorsByKey& accumulators = periodIterator.value();
+
+        for (  AccumulatorsByKey::const_iterator it  = accumulators.constBegin(),
+                                                 end = accumulators.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            const Accumulator& accumulator = it.value();
+            result.append(
+                AggregatedLatencyEntry(
+                    static_cast<MonitorId>(it.key() >> 16),
+                    static_cast<ServerId>(it.key() & 0xFFFF),
+                    accumulator.sampleZoranTimestamp,
+                    accumulator.sampleLatency,
+                    LatencyEntry::toZoranTimestamp(periodStart),
+                    LatencyEntry::toZoranTimestamp(periodEnd),
+                    accumulator.meanLatency,
+                    accumulator.sumSquaredDifferences / accumulator.numberSamples,
+                    accumulator.minimumLatency,
+                    accumulator.maximumLatency,
+                    accumulator.numberSamples
+                )
+            );
+
+            if (latencySketches != nullptr) {
+                latencySketches->append(accumulator.sketch);
+            }
+        }
+
+        ++periodIterator;
+    }
+
+    return result;
+}
+
+
+void LatencyRollup::removeClosedPeriods(unsigned long long closeThreshold) {
+    QMap<unsigned long long, AccumulatorsByKey>::iterator it = accumulatorsByPeriod.begin();
+    while (it != accumulatorsByPeriod.end() && it.key() + currentResamplePeriod <= closeThreshold) {
+        it = accumulatorsByPeriod.erase(it);
+    }
+}
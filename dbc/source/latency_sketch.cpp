@@ -0,0 +1,251 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencySketch class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QMap>
+#include <QVector>
+
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "latency_entry.h"
+#include "latency_sketch.h"
+
+const double   LatencySketch::relativeAccuracy = 0.01;
+const double   LatencySketch::gamma            = (1.0 + relativeAccuracy) / (1.0 - relativeAccuracy);
+const unsigned LatencySketch::recordSize       = 6;
+
+LatencySketch::LatencySketch() {
+    currentNumberSamples = 0;
+}
+
+
+LatencySketch::LatencySketch(
+        const LatencySketch& other
+    ):currentCounts(
+        other.currentCounts
+    ),currentNumberSamples(
+        other.currentNumberSamples
+    ) {}
+
+
+LatencySketch::~LatencySketch() {}
+
+
+bool LatencySketch::isEmpty() const {
+    return currentNumberSamples == 0;
+}
+
+
+unsigned long long LatencySketch::numberSamples() const {
+    return currentNumberSamples;
+}
+
+
+void LatencySketch::addValue(LatencyMicroseconds latencyMicroseconds, unsigned long long count) {
+    addBucket(bucketIndex(latencyMicroseconds), count);
+}
+
+
+void LatencySketch::addBucket(int bucketIndex, unsigned long long count) {
+    if (count > 0) {
+        currentCounts[bucketIndex] += count;
+        currentNumberSamples       += count;
+    }
+}
+
+
+void LatencySketch::merge(const LatencySketch& other) {
+    for (  QMap<int, unsigned long long>::const_iterator it  = other.currentCounts.constBegin(),
+                                                         end = other.currentCounts.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        currentCounts[it.key()] += it.value();
+    }
+
+    currentNumberSamples += other.currentNumberSamples;
+}
+
+
+void LatencySketch::clear() {
+    currentCounts.clear();
+    currentNumberSamples = 0;
+}
+
+
+LatencySketch::LatencyMicroseconds LatencySketch::quantile(double quantile) const {
+    LatencyMicroseconds result = 0;
+
+    if (currentNumberSamples > 0) {
+        double             clampedQuantile = std::max(0.0, std::min(1.0, quantile));
+        unsigned long long rank            = static_cast<unsigned long long>(
+            clampedQuantile * (currentNumberSamples - 1)
+        );
+
+        unsigned long long                            cumulative = 0;
+        QMap<int, unsigned long long>::const_iterator it         = currentCounts.constBegin();
+        QMap<int, unsigned long long>::const_iterator end        = currentCounts.constEnd();
+        while (it != end && cumulative + it.value() <= rank) {
+            cumulative += it.value();
+            ++it;
+        }
+
+        if (it == end) {
+            --it;
+        }
+
+        result = bucketValue(it.key());
+    }
+
+    return result;
+}
+
+
+QVector<double> LatencySketch::histogram(
+        double   minimumMicroseconds,
+        double   maximumMicroseconds,
+        unsigned numberBins
+    ) const {
+    QVector<double> result(static_cast<int>(numberBins), 0.0);
+
+    if (numberBins > 0 && maximumMicroseconds > minimumMicroseconds) {
+        double binWidth = (maximumMicroseconds - minimumMicroseconds) / numberBins;
+
+        for (  QMap<int, unsigned long long>::const_iterator it  = currentCounts.constBegin(),
+                                                             end = currentCounts.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            // Bucket i holds values in (gamma^(i-1), gamma^i].
+            double bucketLower  = std::pow(gamma, it.key() - 1);
+            double bucketUpper  = std::pow(gamma, it.key());
+            double clippedLower = std::max(bucketLower, minimumMicroseconds);
+            double clippedUpper = std::min(bucketUpper, maximumMicroseconds);
+
+            if (clippedUpper > clippedLower) {
+                double   density  = it.value() / (bucketUpper - bucketLower);
+                unsigned firstBin = static_cast<unsigned>((clippedLower - minimumMicroseconds) / binWidth);
+                unsigned lastBin  = std::min(
+                    numberBins - 1,
+                    static_cast<unsigned>((clippedUpper - minimumMicroseconds) / binWidth)
+                );
+
+                for (unsigned bin=firstBin ; bin<=lastBin ; ++bin) {
+                    double binLower = std::max(clippedLower, minimumMicroseconds + bin * binWidth);
+                    double binUpper = std::min(clippedUpper, minimumMicroseconds + (bin + 1) * binWidth);
+                    if (binUpper > binLower) {
+                        result[bin] += density * (binUpper - binLower);
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+QByteArray LatencySketch::toByteArray() const {
+    QByteArray result;
+    result.reserve(static_cast<int>(currentCounts.size() * recordSize));
+
+    for (  QMap<int, unsigned long long>::const_iterator it  = currentCounts.constBegin(),
+                                                         end = currentCounts.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        std::uint16_t      index     = static_cast<std::uint16_t>(it.key());
+        unsigned long long remaining = it.value();
+
+        // Counts too large for a single record are split across records.  The decoder sums them back together.
+        while (remaining > 0) {
+            std::uint32_t count = static_cast<std::uint32_t>(
+                std::min(remaining, static_cast<unsigned long long>(std::numeric_limits<std::uint32_t>::max()))
+            );
+
+            result.append(static_cast<char>(index));
+            result.append(static_cast<char>(index >> 8));
+            result.append(static_cast<char>(count));
+            result.append(static_cast<char>(count >> 8));
+            result.append(static_cast<char>(count >> 16));
+            result.append(static_cast<char>(count >> 24));
+
+            remaining -= count;
+        }
+    }
+
+    return result;
+}
+
+
+LatencySketch LatencySketch::fromByteArray(const QByteArray& data, bool* success) {
+    LatencySketch result;
+
+    unsigned             numberBytes = static_cast<unsigned>(data.size());
+    bool                 ok          = (numberBytes % recordSize) == 0;
+    const unsigned char* bytes       = reinterpret_cast<const unsigned char*>(data.constData());
+
+    if (ok) {
+        for (unsigned offset=0 ; offset<numberBytes ; offset+=recordSize) {
+            std::int16_t  index = static_cast<std::int16_t>(bytes[offset] | (bytes[offset + 1] << 8));
+            std::uint32_t count = (
+                  static_cast<std::uint32_t>(bytes[offset + 2])
+                | (static_cast<std::uint32_t>(bytes[offset + 3]) << 8)
+                | (static_cast<std::uint32_t>(bytes[offset + 4]) << 16)
+                | (static_cast<std::uint32_t>(bytes[offset + 5]) << 24)
+            );
+
+            result.addBucket(index, count);
+        }
+    }
+
+    if (success != nullptr) {
+        *success = ok;
+    }
+
+    return result;
+}
+
+
+int LatencySketch::bucketIndex(LatencyMicroseconds latencyMicroseconds) {
+    double value = std::max(static_cast<double>(latencyMicroseconds), 1.0);
+    return static_cast<int>(std::ceil(std::log(value) / std::log(gamma)));
+}
+
+
+LatencySketch& LatencySketch::operator=(const LatencySketch& other) {
+    currentCounts        = other.currentCounts;
+    currentNumberSamples = other.currentNumberSamples;
+
+    return *this;
+}
+
+
+LatencySketch::LatencyMicroseconds LatencySketch::bucketValue(int bucketIndex) {
+    // Bucket i holds values in (gamma^(i-1), gamma^i].  The value 2 gamma^i / (gamma + 1) is within the relative
+    // accuracy of every value in the bucket.
+    double value = 2.0 * std::pow(gamma, bucketIndex) / (gamma + 1.0);
+    double limit = static_cast<double>(std::numeric_limits<LatencyMicroseconds>::max());
+
+    return static_cast<LatencyMicroseconds>(std::min(std::round(value), limit));
+}
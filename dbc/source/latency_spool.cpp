@@ -0,0 +1,448 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LatencySpool class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+
+#include "log.h"
+#include "latency_entry.h"
+#include "latency_entry_chunk_list.h"
+#include "latency_interface.h"
+#include "latency_spool.h"
+
+const unsigned long LatencySpool::defaultSegmentCapacity = 4 * 1024 * 1024;
+const std::uint16_t LatencySpool::recordMarker = 0xA55A;
+const std::uint32_t LatencySpool::formatVersion = 1;
+const char          LatencySpool::segmentMagic[8] = { 'D', 'B', 'C', 'S', 'P', 'O', 'O', 'L' };
+const char          LatencySpool::checkpointMagic[8] = { 'D', 'B', 'C', 'S', 'P', 'C', 'K', 'P' };
+
+LatencySpool::LatencySpool(const QString& directory, unsigned long segmentCapacity) {
+    currentDirectory       = directory;
+    currentSegmentCapacity = segmentCapacity > 0 ? segmentCapacity : defaultSegmentCapacity;
+    currentReadSequence    = 0;
+    currentReadIndex       = 0;
+    currentNumberUnread    = 0;
+}
+
+
+LatencySpool::~LatencySpool() {
+    for (QList<Segment*>::const_iterator it=segments.constBegin(),end=segments.constEnd() ; it!=end ; ++it) {
+        closeSegment(*it, false);
+    }
+}
+
+
+bool LatencySpool::open() {
+    QMutexLocker spoolMutexLocker(&spoolMutex);
+
+    QDir directory(currentDirectory);
+    bool success = directory.mkpath(QString("."));
+    if (!success) {
+        logWrite(QString("Could not create latency spool directory %1").arg(currentDirectory), true);
+    }
+
+    QList<std::uint64_t> sequences;
+    if (success) {
+        QStringList filenames = directory.entryList(QStringList() << QString("segment_*.spool"), QDir::Files);
+        for (QStringList::const_iterator it=filenames.constBegin(),end=filenames.constEnd() ; it!=end ; ++it) {
+            bool          ok;
+            std::uint64_t sequence = it->mid(8, it->length() - 14).toULongLong(&ok);
+            if (ok) {
+                sequences.append(sequence);
+            }
+        }
+
+        std::sort(sequences.begin(), sequences.end());
+    }
+
+    std::uint64_t checkpointSequence = sequences.isEmpty() ? 0 : sequences.first();
+    unsigned long checkpointIndex    = 0;
+
+    if (success) {
+        QFile checkpointFile(directory.absoluteFilePath(QString("checkpoint")));
+        if (checkpointFile.open(QFile::ReadOnly)) {
+            QByteArray data = checkpointFile.readAll();
+            if (static_cast<unsigned>(data.size()) == sizeof(Checkpoint)) {
+                Checkpoint checkpoint;
+                std::memcpy(&checkpoint, data.constData(), sizeof(Checkpoint));
+
+                if (std::memcmp(checkpoint.magic, checkpointMagic, sizeof(checkpointMagic)) == 0) {
+                    checkpointSequence = checkpoint.sequence;
+                    checkpointIndex    = static_cast<unsigned long>(checkpoint.index);
+                } else {
+                    logWrite(QString("Ignoring invalid latency spool checkpoint in %1").arg(currentDirectory), true);
+                }
+            } else {
+                logWrite(QString("Ignoring truncated latency spool checkpoint in %1").arg(currentDirectory), true);
+            }
+        }
+    }
+
+    for (QList<std::uint64_t>::const_iterator it=sequences.constBegin(),end=sequences.constEnd() ;
+         success && it!=end                                                                      ;
+         ++it                                                                                    ) {
+        std::uint64_t sequence = *it;
+        if (sequence < checkpointSequence) {
+            QFile::remove(segmentFilename(sequence));
+        } else {
+            Segment* segment = openSegment(sequence, false);
+            if (segment != nullptr) {
+                segments.append(segment);
+            } else {
+                success = false;
+            }
+        }
+    }
+
+    if (success && segments.isEmpty()) {
+        Segment* segment = openSegment(checkpointSequence, true);
+        if (segment != nullptr) {
+            segments.append(segment);
+            checkpointIndex = 0;
+        } else {
+            success = false;
+        }
+    }
+
+    if (success) {
+        if (segments.first()->sequence != checkpointSequence) {
+            checkpointIndex = 0;
+        }
+
+        currentReadSequence = segments.first()->sequence;
+        currentReadIndex    = std::min(checkpointIndex, segments.first()->numberWritten);
+        currentNumberUnread = 0;
+
+        for (QList<Segment*>::const_iterator it=segments.constBegin(),end=segments.constEnd() ; it!=end ; ++it) {
+            currentNumberUnread += (*it)->numberWritten;
+        }
+
+        currentNumberUnread -= currentReadIndex;
+
+        if (currentNumberUnread > 0) {
+            logWrite(
+                QString("Replaying %1 latency entries from spool %2").arg(currentNumberUnread).arg(currentDirectory),
+                false
+            );
+        }
+    }
+
+    return success;
+}
+
+
+const QString& LatencySpool::directory() const {
+    return currentDirectory;
+}
+
+
+unsigned long LatencySpool::numberUnreadEntries() {
+    QMutexLocker spoolMutexLocker(&spoolMutex);
+    return currentNumberUnread;
+}
+
+
+bool LatencySpool::append(
+        ServerId          serverId,
+        const QByteArray& payload,
+        unsigned long     offset,
+        unsigned long     numberEntries
+    ) {
+    typedef LatencyInterface::RawEntry RawEntry;
+
+    QMutexLocker spoolMutexLocker(&spoolMutex);
+
+    const RawEntry* rawEntry = reinterpret_cast<const RawEntry*>(payload.constData() + offset);
+    bool            success  = true;
+    unsigned long   index    = 0;
+
+    while (success && index < numberEntries) {
+        Record* record = reserveRecord();
+        if (record != nullptr) {
+            record->monitorId           = rawEntry->monitorId;
+            record->timestamp           = rawEntry->timestamp;
+            record->latencyMicroseconds = rawEntry->latencyMicroseconds;
+            record->serverId            = serverId;
+
+            publishRecord(record);
+
+            ++segments.last()->numberWritten;
+            ++currentNumberUnread;
+            ++rawEntry;
+            ++index;
+        } else {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+
+bool LatencySpool::append(const LatencyEntryList& latencyEntries) {
+    QMutexLocker spoolMutexLocker(&spoolMutex);
+
+    bool success = true;
+    for (LatencyEntryList::const_iterator it=latencyEntries.constBegin(),end=latencyEntries.constEnd() ;
+         success && it!=end                                                                            ;
+         ++it                                                                                          ) {
+        Record* record = reserveRecord();
+        if (record != nullptr) {
+            record->monitorId           = it->monitorId();
+            record->timestamp           = it->zoranTimestamp();
+            record->latencyMicroseconds = it->latencyMicroseconds();
+            record->serverId            = it->serverId();
+
+            publishRecord(record);
+
+            ++segments.last()->numberWritten;
+            ++currentNumberUnread;
+        } else {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+
+unsigned long LatencySpool::read(LatencyEntryChunkList& destination, unsigned long maximumEntries) {
+    unsigned long numberRead = 0;
+    bool          finished   = false;
+
+    do {
+        spoolMutex.lock();
+
+        Segment*      segment       = findSegment(currentReadSequence);
+        unsigned long numberWritten = segment != nullptr ? segment->numberWritten : 0;
+        bool          isLast        = segment == nullptr || segment == segments.last();
+
+        spoolMutex.unlock();
+
+        // Records below the written count are never modified once published so they can be read without the lock.
+        unsigned long available = (
+              numberWritten > currentReadIndex
+            ? std::min(numberWritten - currentReadIndex, maximumEntries - numberRead)
+            : 0
+        );
+        if (available > 0) {
+            const Record* record = segment->records + currentReadIndex;
+            for (unsigned long i=0 ; i<available ; ++i) {
+                destination.append(
+                    record->monitorId,
+                    record->serverId,
+                    record->timestamp,
+                    record->latencyMicroseconds
+                );
+
+                ++record;
+            }
+
+            currentReadIndex += available;
+            numberRead       += available;
+        }
+
+        if (segment != nullptr && currentReadIndex >= numberWritten && numberWritten >= segment->capacity && !isLast) {
+            ++currentReadSequence;
+            currentReadIndex = 0;
+        } else if (available == 0 || numberRead >= maximumEntries) {
+            finished = true;
+        }
+    } while (!finished);
+
+    spoolMutex.lock();
+    currentNumberUnread -= numberRead;
+    spoolMutex.unlock();
+
+    return numberRead;
+}
+
+
+bool LatencySpool::checkpoint() {
+    Checkpoint checkpoint;
+    std::memcpy(checkpoint.magic, checkpointMagic, sizeof(checkpointMagic));
+    checkpoint.sequence = currentReadSequence;
+    checkpoint.index    = currentReadIndex;
+
+    QSaveFile checkpointFile(QDir(currentDirectory).absoluteFilePath(QString("checkpoint")));
+    bool success = checkpointFile.open(QSaveFile::WriteOnly);
+    if (success) {
+        qint64 bytesWritten = checkpointFile.write(reinterpret_cast<const char*>(&checkpoint), sizeof(Checkpoint));
+        success = (bytesWritten == sizeof(Checkpoint) && checkpointFile.commit());
+    }
+
+    if (success) {
+        QList<Segment*> consumed;
+
+        spoolMutex.lock();
+        while (segments.size() > 1 && segments.first()->sequence < currentReadSequence) {
+            consumed.append(segments.takeFirst());
+        }
+        spoolMutex.unlock();
+
+        for (QList<Segment*>::const_iterator it=consumed.constBegin(),end=consumed.constEnd() ; it!=end ; ++it) {
+            closeSegment(*it, true);
+        }
+    } else {
+        logWrite(QString("Failed to write latency spool checkpoint in %1").arg(currentDirectory), true);
+    }
+
+    return success;
+}
+
+
+QString LatencySpool::segmentFilename(std::uint64_t sequence) const {
+    return QDir(currentDirectory).absoluteFilePath(
+        QString("segment_%1.spool").arg(static_cast<qulonglong>(sequence), 16, 10, QChar('0'))
+    );
+}
+
+
+LatencySpool::Segment* LatencySpool::openSegment(std::uint64_t sequence, bool create) {
+    QString  filename = segmentFilename(sequence);
+    QFile*   file     = new QFile(filename);
+    Segment* result   = nullptr;
+
+    bool success = file->open(QFile::ReadWrite);
+    if (success && create) {
+        success = file->resize(sizeof(SegmentHeader) + currentSegmentCapacity * sizeof(Record));
+    }
+
+    qint64 fileSize = file->size();
+    if (success && static_cast<quint64>(fileSize) <= sizeof(SegmentHeader)) {
+        success = false;
+    }
+
+    uchar* mapping = nullptr;
+    if (success) {
+        mapping = file->map(0, fileSize);
+        success = (mapping != nullptr);
+    }
+
+    if (success) {
+        SegmentHeader* header = reinterpret_cast<SegmentHeader*>(mapping);
+        if (create) {
+            std::memset(header, 0, sizeof(SegmentHeader));
+            std::memcpy(header->magic, segmentMagic, sizeof(segmentMagic));
+            header->version  = formatVersion;
+            header->capacity = static_cast<std::uint32_t>(currentSegmentCapacity);
+        } else {
+            success = (
+                   std::memcmp(header->magic, segmentMagic, sizeof(segmentMagic)) == 0
+                && header->version == formatVersion
+                && sizeof(SegmentHeader) + header->capacity * sizeof(Record) <= static_cast<quint64>(fileSize)
+            );
+        }
+
+        if (success) {
+            result = new Segment;
+
+            result->sequence      = sequence;
+            result->file          = file;
+            result->mapping       = mapping;
+            result->records       = reinterpret_cast<Record*>(mapping + sizeof(SegmentHeader));
+            result->capacity      = header->capacity;
+            result->numberWritten = 0;
+
+            while (result->numberWritten < result->capacity                         &&
+                   result->records[result->numberWritten].marker == recordMarker    ) {
+                ++result->numberWritten;
+            }
+        } else {
+            file->unmap(mapping);
+        }
+    }
+
+    if (!success) {
+        logWrite(QString("Could not open latency spool segment %1: %2").arg(filename, file->errorString()), true);
+        delete file;
+    }
+
+    return result;
+}
+
+
+LatencySpool::Segment* LatencySpool::findSegment(std::uint64_t sequence) const {
+    Segment* result = nullptr;
+
+    QList<Segment*>::const_iterator it  = segments.constBegin();
+    QList<Segment*>::const_iterator end = segments.constEnd();
+    while (result == nullptr && it != end) {
+        if ((*it)->sequence == sequence) {
+            result = *it;
+        }
+
+        ++it;
+    }
+
+    return result;
+}
+
+
+void LatencySpool::closeSegment(Segment* segment, bool remove) {
+    segment->file->unmap(segment->mapping);
+    segment->file->close();
+
+    if (remove) {
+        segment->file->remove();
+    }
+
+    delete segment->file;
+    delete segment;
+}
+
+
+LatencySpool::Record* LatencySpool::reserveRecord() {
+    Record*  result  = nullptr;
+    Segment* segment = segments.isEmpty() ? nullptr : segments.last();
+
+    if (segment != nullptr && segment->numberWritten >= segment->capacity) {
+        segment = openSegment(segment->sequence + 1, true);
+        if (segment != nullptr) {
+            segments.append(segment);
+        }
+    }
+
+    if (segment != nullptr) {
+        result = segment->records + segment->numberWritten;
+    }
+
+    return result;
+}
+
+
+void LatencySpool::publishRecord(Record* record) {
+    // The marker must be stored after the payload so a torn record is never replayed.
+    std::atomic_thread_fence(std::memory_order_release);
+    record->marker = recordMarker;
+}
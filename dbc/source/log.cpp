@@ -15,32 +15,29 @@
 ********************************************************************************************************************//**
 * \file
 *
-* This header implements the \ref Monitor class.
+* This file implements the \ref logWrite function.
 ***********************************************************************************************************************/
 
 #include <QString>
-#include <QByteArray>
-#include <QDateTime>
-#include <QMutex>
-#include <QMutexLocker>
-
-#include <iostream>
 
+#include "log_writer.h"
 #include "log.h"
 
-QMutex loggingMutex;
-
 void logWrite(const QString& message, bool error) {
-    QMutexLocker mutexLocker(&loggingMutex);
+    LogWriter::instance()->write(message, error ? LogSeverity::ERROR : LogSeverity::INFO);
+}
+
 
-    QString dateTime = QDateTime::currentDateTime().toString(Qt::DateFormat::ISODate);
+void logWrite(const QString& message, LogSeverity severity) {
+    LogWriter::instance()->write(message, severity);
+}
+
+
+void logSetRateLimit(LogSeverity severity, unsigned messagesPerSecond) {
+    LogWriter::instance()->setRateLimit(severity, messagesPerSecond);
+}
 
-    if (error) {
-        QString logEntry = QString("%1: *** %2").arg(dateTime, message);
-        std::cerr << logEntry.toLocal8Bit().data() << std::endl;
-    } else {
-        QString logEntry = QString("%1: %2").arg(dateTime, message);
-        std::cout << logEntry.toLocal8Bit().data() << std::endl;
 
-    }
+unsigned long long logMessagesDropped() {
+    return LogWriter::instance()->numberDropped();
 }
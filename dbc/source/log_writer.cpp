@@ -0,0 +1,292 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref LogWriter class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+#include "log.h"
+#include "log_writer.h"
+
+/***********************************************************************************************************************
+* LogWriter::Slot
+*/
+
+LogWriter::Slot::Slot():sequence(0),timestamp(0),severity(LogSeverity::INFO) {}
+
+/***********************************************************************************************************************
+* LogWriter::RateLimiter
+*/
+
+LogWriter::RateLimiter::RateLimiter():currentSecond(0),currentCount(0),limit(LogWriter::defaultRateLimit) {}
+
+/***********************************************************************************************************************
+* LogWriter
+*/
+
+LogWriter* LogWriter::instance() {
+    // The writer is intentionally never destroyed so entries logged by static destructors remain safe.
+    static LogWriter* writer = new LogWriter;
+    return writer;
+}
+
+
+void LogWriter::write(const QString& message, LogSeverity severity) {
+    long long timestamp = QDateTime::currentMSecsSinceEpoch();
+
+    if (!allow(severity, timestamp)) {
+        numberDroppedRateLimited.fetch_add(1, std::memory_order_relaxed);
+    } else if (synchronous.load(std::memory_order_acquire)) {
+        std::string outputBatch;
+        std::string errorBatch;
+
+        (severity == LogSeverity::INFO ? outputBatch : errorBatch) = format(message, severity, timestamp);
+
+        QMutexLocker locker(&synchronousMutex);
+        flush(outputBatch, errorBatch);
+    } else if (!enqueue(message, severity, timestamp)) {
+        numberDroppedQueueFull.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+void LogWriter::setRateLimit(LogSeverity severity, unsigned messagesPerSecond) {
+    rateLimiters[static_cast<unsigned>(severity)].limit.store(messagesPerSecond, std::memory_order_relaxed);
+}
+
+
+unsigned long long LogWriter::numberDropped() const {
+    return   numberDroppedQueueFull.load(std::memory_order_relaxed)
+           + numberDroppedRateLimited.load(std::memory_order_relaxed);
+}
+
+
+LogWriter::LogWriter():enqueuePosition(0),dequeuePosition(0),numberDroppedQueueFull(0),numberDroppedRateLimited(0) {
+    for (unsigned i=0 ; i<queueCapacity ; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    numberDroppedReported = 0;
+    stopRequested.store(false);
+    synchronous.store(false);
+
+    writerThread = std::thread(&LogWriter::run, this);
+    std::atexit(&LogWriter::shutdown);
+}
+
+
+LogWriter::~LogWriter() {
+    if (writerThread.joinable()) {
+        stopRequested.store(true, std::memory_order_release);
+        writerThread.join();
+    }
+}
+
+
+void LogWriter::shutdown() {
+    LogWriter* writer = instance();
+
+    writer->stopRequested.store(true, std::memory_order_release);
+    if (writer->writerThread.joinable()) {
+        writer->writerThread.join();
+    }
+
+    writer->synchronous.store(true, std::memory_order_release);
+
+    // Pick up anything queued while the writer was stopping.
+    std::string outputBatch;
+    std::string errorBatch;
+
+    QMutexLocker locker(&writer->synchronousMutex);
+    writer->drain(outputBatch, errorBatch);
+    writer->reportDropped(errorBatch);
+    flush(outputBatch, errorBatch);
+}
+
+
+bool LogWriter::allow(LogSeverity severity, long long timestamp) {
+    RateLimiter& rateLimiter = rateLimiters[static_cast<unsigned>(severity)];
+    unsigned     limit       = rateLimiter.limit.load(std::memory_order_relaxed);
+    bool         result;
+
+    if (limit == 0) {
+        result = true;
+    } else {
+        long long second        = timestamp / 1000;
+        long long currentSecond = rateLimiter.currentSecond.load(std::memory_order_relaxed);
+
+        // Only the thread that advances the window resets the count.  A few entries may be miscounted as the window
+        // turns over which is acceptable for a rate limit.
+        if (second > currentSecond
+            && rateLimiter.currentSecond.compare_exchange_strong(currentSecond, second, std::memory_order_relaxed)) {
+            rateLimiter.currentCount.store(0, std::memory_order_relaxed);
+        }
+
+        result = rateLimiter.currentCount.fetch_add(1, std::memory_order_relaxed) < limit;
+    }
+
+    return result;
+}
+
+
+bool LogWriter::enqueue(const QString& message, LogSeverity severity, long long timestamp) {
+    std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Slot*       slot     = nullptr;
+
+    while (slot == nullptr) {
+        Slot&          candidate  = slots[position & (queueCapacity - 1)];
+        std::size_t    sequence   = candidate.sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+
+        if (difference == 0) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot = &candidate;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestamp = timestamp;
+    slot->severity  = severity;
+    slot->message   = message;
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    return true;
+}
+
+
+unsigned long LogWriter::drain(std::string& outputBatch, std::string& errorBatch) {
+    unsigned long numberEntries = 0;
+    bool          empty         = false;
+
+    while (!empty) {
+        Slot&       slot     = slots[dequeuePosition & (queueCapacity - 1)];
+        std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+        if (sequence == dequeuePosition + 1) {
+            (slot.severity == LogSeverity::INFO ? outputBatch : errorBatch) += format(
+                slot.message,
+                slot.severity,
+                slot.timestamp
+            );
+
+            slot.message = QString();
+            slot.sequence.store(dequeuePosition + queueCapacity, std::memory_order_release);
+
+            ++dequeuePosition;
+            ++numberEntries;
+        } else {
+            empty = true;
+        }
+    }
+
+    return numberEntries;
+}
+
+
+void LogWriter::flush(std::string& outputBatch, std::string& errorBatch) {
+    if (!outputBatch.empty()) {
+        std::cout.write(outputBatch.data(), static_cast<std::streamsize>(outputBatch.size()));
+        std::cout.flush();
+        outputBatch.clear();
+    }
+
+    if (!errorBatch.empty()) {
+        std::cerr.write(errorBatch.data(), static_cast<std::streamsize>(errorBatch.size()));
+        std::cerr.flush();
+        errorBatch.clear();
+    }
+}
+
+
+std::string LogWriter::format(const QString& message, LogSeverity severity, long long timestamp) {
+    QString dateTime = QDateTime::fromMSecsSinceEpoch(timestamp).toString(Qt::DateFormat::ISODate);
+    QString logEntry;
+
+    switch (severity) {
+        case LogSeverity::INFO:    { logEntry = QString("%1: %2\n").arg(dateTime, message);       break; }
+        case LogSeverity::WARNING: { logEntry = QString("%1: ** %2\n").arg(dateTime, message);    break; }
+        case LogSeverity::ERROR:   { logEntry = QString("%1: *** %2\n").arg(dateTime, message);   break; }
+        default:                   { Q_ASSERT(false);                                             break; }
+    }
+
+    QByteArray encoded = logEntry.toLocal8Bit();
+    return std::string(encoded.constData(), static_cast<std::size_t>(encoded.size()));
+}
+
+
+void LogWriter::reportDropped(std::string& errorBatch) {
+    unsigned long long numberQueueFull   = numberDroppedQueueFull.load(std::memory_order_relaxed);
+    unsigned long long numberRateLimited = numberDroppedRateLimited.load(std::memory_order_relaxed);
+    unsigned long long total             = numberQueueFull + numberRateLimited;
+
+    if (total != numberDroppedReported) {
+        errorBatch += format(
+            QString("%1 log messages dropped since startup: %2 queue full, %3 rate limited.")
+            .arg(total)
+            .arg(numberQueueFull)
+            .arg(numberRateLimited),
+            LogSeverity::ERROR,
+            QDateTime::currentMSecsSinceEpoch()
+        );
+
+        numberDroppedReported = total;
+    }
+}
+
+
+void LogWriter::run() {
+    std::string outputBatch;
+    std::string errorBatch;
+    long long   lastDropReport = QDateTime::currentMSecsSinceEpoch();
+
+    while (!stopRequested.load(std::memory_order_acquire)) {
+        unsigned long numberEntries = drain(outputBatch, errorBatch);
+
+        long long now = QDateTime::currentMSecsSinceEpoch();
+        if (now - lastDropReport >= dropReportIntervalMilliseconds) {
+            reportDropped(errorBatch);
+            lastDropReport = now;
+        }
+
+        flush(outputBatch, errorBatch);
+
+        if (numberEntries == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(idleIntervalMilliseconds));
+        }
+    }
+
+    drain(outputBatch, errorBatch);
+    reportDropped(errorBatch);
+    flush(outputBatch, errorBatch);
+}
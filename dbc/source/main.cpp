@@ -22,6 +22,7 @@
 #include <QCommandLineParser>
 #include <QCommandLineOption>
 #include <QString>
+#include <QStringList>
 #include <QFile>
 #include <QByteArray>
 #include <QJsonParseError>
@@ -46,10 +47,20 @@ int main(int argumentCount, char* argumentValues[]) {
 
     registerMetaTypes();
 
-    if (argumentCount == 2) {
-        QString configurationFilename = QString::fromLocal8Bit(argumentValues[1]);
+    QCommandLineParser commandLineParser;
+    QCommandLineOption relayOption(
+        QStringList() << "r" << "relay",
+        QString("Run as a regional latency ingest relay.")
+    );
+    commandLineParser.addOption(relayOption);
+    commandLineParser.addPositionalArgument(QString("configuration"), QString("Path to the configuration file."));
+    commandLineParser.process(application);
 
-        DbC dbController(configurationFilename);
+    QStringList positionalArguments = commandLineParser.positionalArguments();
+    if (positionalArguments.size() == 1) {
+        QString configurationFilename = positionalArguments.first();
+
+        DbC dbController(configurationFilename, commandLineParser.isSet(relayOption));
         exitStatus = application.exec();
     } else {
         logWrite(QString("Invalid command line.  Include path to the configuration file."), true);
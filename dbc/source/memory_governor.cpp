@@ -0,0 +1,244 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref MemoryGovernor class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+
+#include <algorithm>
+
+#include <unistd.h>
+
+#include "log.h"
+#include "metrics_registry.h"
+#include "periodic_scheduler.h"
+#include "memory_governor.h"
+
+MemoryGovernor* MemoryGovernor::instance() {
+    static MemoryGovernor* memoryGovernor = new MemoryGovernor;
+    return memoryGovernor;
+}
+
+
+MemoryGovernor::MemoryGovernor() {
+    nextConsumerId   = invalidConsumerId + 1;
+    currentSoftLimit = 0;
+    currentHardLimit = 0;
+    currentStage.storeRelease(static_cast<int>(Stage::NORMAL));
+    currentUsage.storeRelease(0);
+
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    metricsRegistry->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_memory_usage_bytes"),
+        QString("Memory usage measured by the memory governor, in bytes."),
+        QString(),
+        [this]() {
+            return static_cast<double>(currentUsage.loadAcquire());
+        }
+    );
+    metricsRegistry->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_memory_pressure_stage"),
+        QString("Memory pressure stage, 0 = normal, 1 = shrink caches, 2 = force flush, 3 = backpressure."),
+        QString(),
+        [this]() {
+            return static_cast<double>(currentStage.loadAcquire());
+        }
+    );
+
+    evaluationTaskId = PeriodicScheduler::instance()->registerTask(
+        QString("memory_governor"),
+        QString(),
+        0,
+        [this]() {
+            evaluate();
+        }
+    );
+}
+
+
+MemoryGovernor::~MemoryGovernor() {
+    PeriodicScheduler::instance()->unregisterTask(evaluationTaskId);
+}
+
+
+void MemoryGovernor::setLimits(unsigned long long softLimit, unsigned long long hardLimit) {
+    consumersMutex.lock();
+    currentSoftLimit = softLimit;
+    currentHardLimit = hardLimit;
+    consumersMutex.unlock();
+
+    PeriodicScheduler::instance()->setPeriod(evaluationTaskId, softLimit > 0 ? defaultEvaluationIntervalSeconds : 0);
+    if (softLimit == 0) {
+        // Evaluation is stopped so any shedding in effect must be released now.
+        evaluate();
+    }
+}
+
+
+MemoryGovernor::ConsumerId MemoryGovernor::registerConsumer(
+        const QString&          name,
+        const UsageFunction&    usageFunction,
+        const ResponseFunction& responseFunction
+    ) {
+    Consumer consumer;
+    consumer.name             = name;
+    consumer.usageFunction    = usageFunction;
+    consumer.responseFunction = responseFunction;
+
+    QMutexLocker consumersMutexLocker(&consumersMutex);
+
+    ConsumerId consumerId = nextConsumerId;
+    ++nextConsumerId;
+
+    consumers.insert(consumerId, consumer);
+    MetricsRegistry::instance()->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_memory_consumer_bytes"),
+        QString("Approximate memory held by each memory governor consumer, in bytes."),
+        metricLabels(name),
+        [usageFunction]() {
+            return static_cast<double>(usageFunction());
+        }
+    );
+
+    responseFunction(stage());
+
+    return consumerId;
+}
+
+
+void MemoryGovernor::unregisterConsumer(ConsumerId consumerId) {
+    QMutexLocker consumersMutexLocker(&consumersMutex);
+
+    QMap<ConsumerId, Consumer>::iterator it = consumers.find(consumerId);
+    if (it != consumers.end()) {
+        MetricsRegistry::instance()->removeSeries(QString("dbc_memory_consumer_bytes"), metricLabels(it->name));
+        consumers.erase(it);
+    }
+}
+
+
+QString MemoryGovernor::toString(Stage stage) {
+    QString result;
+
+    switch (stage) {
+        case Stage::NORMAL:        { result = QString("normal");          break; }
+        case Stage::SHRINK_CACHES: { result = QString("shrink caches");   break; }
+        case Stage::FORCE_FLUSH:   { result = QString("force flush");     break; }
+        case Stage::BACKPRESSURE:  { result = QString("backpressure");    break; }
+        default:                   { result = QString("unknown");         break; }
+    }
+
+    return result;
+}
+
+
+void MemoryGovernor::evaluate() {
+    QMutexLocker consumersMutexLocker(&consumersMutex);
+
+    unsigned long long accountedUsage = 0;
+    for (  QMap<ConsumerId, Consumer>::const_iterator it  = consumers.constBegin(),
+                                                      end = consumers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        accountedUsage += it->usageFunction();
+    }
+
+    unsigned long long usage    = std::max(accountedUsage, residentSetSize());
+    Stage              oldStage = stage();
+    Stage              newStage;
+
+    currentUsage.storeRelease(usage);
+
+    if (currentSoftLimit == 0) {
+        newStage = Stage::NORMAL;
+    } else if (currentHardLimit > 0 && usage >= currentHardLimit) {
+        newStage = Stage::BACKPRESSURE;
+    } else if (usage >= currentSoftLimit) {
+        // Shedding escalates one step at a time so the cheaper responses get a chance to work first.  Backpressure
+        // is reserved for the hard limit.
+        if (oldStage == Stage::BACKPRESSURE) {
+            newStage = Stage::FORCE_FLUSH;
+        } else {
+            newStage = static_cast<Stage>(
+                std::min(static_cast<int>(oldStage) + 1, static_cast<int>(Stage::FORCE_FLUSH))
+            );
+        }
+    } else if (usage < static_cast<unsigned long long>(currentSoftLimit * releaseFraction) &&
+               oldStage != Stage::NORMAL                                                      ) {
+        newStage = static_cast<Stage>(static_cast<int>(oldStage) - 1);
+    } else {
+        newStage = oldStage;
+    }
+
+    if (newStage != oldStage) {
+        logWrite(
+            QString("Memory pressure %1 -> %2, usage %3 bytes, %4 bytes accounted, soft limit %5, hard limit %6.")
+            .arg(toString(oldStage))
+            .arg(toString(newStage))
+            .arg(usage)
+            .arg(accountedUsage)
+            .arg(currentSoftLimit)
+            .arg(currentHardLimit),
+            newStage > oldStage
+        );
+
+        currentStage.storeRelease(static_cast<int>(newStage));
+        for (  QMap<ConsumerId, Consumer>::const_iterator it  = consumers.constBegin(),
+                                                          end = consumers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            it->responseFunction(newStage);
+        }
+    }
+}
+
+
+unsigned long long MemoryGovernor::residentSetSize() {
+    unsigned long long result = 0;
+
+    QFile statm(QString("/proc/self/statm"));
+    if (statm.open(QFile::OpenModeFlag::ReadOnly)) {
+        QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() >= 2) {
+            bool               success;
+            unsigned long long residentPages = fields.at(1).toULongLong(&success);
+            long               pageSize      = sysconf(_SC_PAGESIZE);
+
+            if (success && pageSize > 0) {
+                result = residentPages * static_cast<unsigned long long>(pageSize);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+QString MemoryGovernor::metricLabels(const QString& name) {
+    return MetricsRegistry::label(QString("consumer"), name);
+}
@@ -22,9 +22,11 @@
 #include <QHostAddress>
 #include <QJsonDocument>
 
+#include "outbound_rest_api_factory.h"
 #include "metatypes.h"
 
 void registerMetaTypes() {
     qRegisterMetaType<QHostAddress>();
     qRegisterMetaType<QJsonDocument>();
+    qRegisterMetaType<OutboundRestApiFactory::LatenciesByServerIdentifier>();
 }
@@ -0,0 +1,173 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref MetricsManager class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonValue>
+
+#include <rest_api_in_v1_response.h>
+#include <rest_api_in_v1_binary_response.h>
+#include <rest_api_in_v1_json_response.h>
+#include <rest_api_in_v1_inesonic_rest_handler.h>
+#include <rest_api_in_v1_inesonic_binary_rest_handler.h>
+
+#include "metrics_registry.h"
+#include "query_statistics.h"
+#include "response_compressor.h"
+#include "metrics_manager.h"
+
+/***********************************************************************************************************************
+* MetricsManager::MetricsGet
+*/
+
+MetricsManager::MetricsGet::MetricsGet(
+        const QByteArray&   secret,
+        MetricsRegistry*    metricsRegistry,
+        ResponseCompressor* responseCompressor
+    ):RestApiInV1::InesonicBinaryRestHandler(
+        secret
+    ),currentMetricsRegistry(
+        metricsRegistry
+    ),currentResponseCompressor(
+        responseCompressor
+    ) {}
+
+
+MetricsManager::MetricsGet::~MetricsGet() {}
+
+
+RestApiInV1::Response* MetricsManager::MetricsGet::processAuthenticatedRequest(
+        const QString&    /* path */,
+        const QByteArray& request,
+        unsigned          /* threadId */
+    ) {
+    ResponseCompressor::Encoding encoding = ResponseCompressor::selectEncoding(
+        QJsonDocument::fromJson(request).object().value("accept_encoding").toString()
+    );
+
+    QByteArray contentType("text/plain; version=0.0.4; charset=utf-8");
+    QByteArray data = currentResponseCompressor->compress(encoding, contentType, currentMetricsRegistry->render());
+
+    return new RestApiInV1::BinaryResponse(contentType, data);
+}
+
+/***********************************************************************************************************************
+* MetricsManager::MetricsQueries
+*/
+
+MetricsManager::MetricsQueries::MetricsQueries(
+        const QByteArray& secret,
+        QueryStatistics*  queryStatistics
+    ):RestApiInV1::InesonicRestHandler(
+        secret
+    ),currentQueryStatistics(
+        queryStatistics
+    ) {}
+
+
+MetricsManager::MetricsQueries::~MetricsQueries() {}
+
+
+RestApiInV1::JsonResponse MetricsManager::MetricsQueries::processAuthenticatedRequest(
+        const QString&       /* path */,
+        const QJsonDocument& request,
+        unsigned             /* threadId */
+    ) {
+    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+
+    QJsonObject object = request.object();
+    int         limit  = object.value("limit").toInt(100);
+    bool        reset  = object.value("reset").toBool(false);
+
+    if (limit > 0) {
+        QueryStatistics::SummaryList summaries = currentQueryStatistics->summaries();
+        if (reset) {
+            currentQueryStatistics->reset();
+        }
+
+        QJsonArray statements;
+        for (  QueryStatistics::SummaryList::const_iterator it  = summaries.constBegin(),
+                                                            end = summaries.constEnd()
+             ; it != end && statements.size() < limit
+             ; ++it
+            ) {
+            QJsonObject statement;
+            statement.insert("statement", it->statement);
+            statement.insert("count", static_cast<double>(it->count));
+            statement.insert("errors", static_cast<double>(it->errors));
+            statement.insert("total", it->totalSeconds);
+            statement.insert("p50", it->p50Seconds);
+            statement.insert("p99", it->p99Seconds);
+            statement.insert("maximum", it->maximumSeconds);
+            statement.insert("rows", static_cast<double>(it->rows));
+
+            statements.append(statement);
+        }
+
+        QJsonObject responseObject;
+        responseObject.insert("status", "OK");
+        responseObject.insert("statements", statements);
+
+        response = RestApiInV1::JsonResponse(QJsonDocument(responseObject));
+    }
+
+    return response;
+}
+
+/***********************************************************************************************************************
+* MetricsManager
+*/
+
+const QString MetricsManager::metricsGetPath("/metrics/get");
+const QString MetricsManager::metricsQueriesPath("/metrics/queries");
+
+MetricsManager::MetricsManager(
+        RestApiInV1::Server* restApiServer,
+        MetricsRegistry*     metricsRegistry,
+        QueryStatistics*     queryStatistics,
+        ResponseCompressor*  responseCompressor,
+        const QByteArray&    secret,
+        QObject*             parent
+    ):QObject(
+        parent
+    ),metricsGet(
+        secret,
+        metricsRegistry,
+        responseCompressor
+    ),metricsQueries(
+        secret,
+        queryStatistics
+    ) {
+    restApiServer->registerHandler(&metricsGet, RestApiInV1::Handler::Method::POST, metricsGetPath);
+    restApiServer->registerHandler(&metricsQueries, RestApiInV1::Handler::Method::POST, metricsQueriesPath);
+}
+
+
+MetricsManager::~MetricsManager() {}
+
+
+void MetricsManager::setSecret(const QByteArray& newSecret) {
+    metricsGet.setSecret(newSecret);
+    metricsQueries.setSecret(newSecret);
+}
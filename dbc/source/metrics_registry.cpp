@@ -0,0 +1,431 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref MetricsRegistry class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <cmath>
+
+#include "metrics_registry.h"
+
+const QList<double> MetricsRegistry::defaultLatencyBuckets = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0
+};
+
+/***********************************************************************************************************************
+* MetricsRegistry::Metric
+*/
+
+MetricsRegistry::Metric::~Metric() {}
+
+/***********************************************************************************************************************
+* MetricsRegistry::Counter
+*/
+
+MetricsRegistry::Counter::Counter():currentValue(0) {}
+
+
+MetricsRegistry::Counter::~Counter() {}
+
+
+void MetricsRegistry::Counter::render(const QString& name, const QString& labels, QByteArray& output) const {
+    renderLine(name, labels, QByteArray::number(value()), output);
+}
+
+/***********************************************************************************************************************
+* MetricsRegistry::Gauge
+*/
+
+MetricsRegistry::Gauge::Gauge():currentValue(0) {}
+
+
+MetricsRegistry::Gauge::~Gauge() {}
+
+
+void MetricsRegistry::Gauge::add(double amount) {
+    double expected = currentValue.load(std::memory_order_relaxed);
+    while (!currentValue.compare_exchange_weak(expected, expected + amount, std::memory_order_relaxed)) {}
+}
+
+
+void MetricsRegistry::Gauge::render(const QString& name, const QString& labels, QByteArray& output) const {
+    renderLine(name, labels, formatValue(value()), output);
+}
+
+/***********************************************************************************************************************
+* MetricsRegistry::Histogram
+*/
+
+MetricsRegistry::Histogram::Histogram(
+        const QList<double>& bounds
+    ):currentBounds(
+        bounds
+    ),currentCount(
+        0
+    ),currentSum(
+        0
+    ) {
+    unsigned numberBuckets = static_cast<unsigned>(bounds.size()) + 1;
+
+    currentCounts = new QAtomicInteger<quint64>[numberBuckets];
+    for (unsigned i=0 ; i<numberBuckets ; ++i) {
+        currentCounts[i].storeRelease(0);
+    }
+}
+
+
+MetricsRegistry::Histogram::~Histogram() {
+    delete[] currentCounts;
+}
+
+
+void MetricsRegistry::Histogram::observe(double value) {
+    unsigned numberBounds = static_cast<unsigned>(currentBounds.size());
+    unsigned bucket       = 0;
+    while (bucket < numberBounds && value > currentBounds.at(bucket)) {
+        ++bucket;
+    }
+
+    currentCounts[bucket].fetchAndAddRelaxed(1);
+    currentCount.fetchAndAddRelaxed(1);
+
+    double expected = currentSum.load(std::memory_order_relaxed);
+    while (!currentSum.compare_exchange_weak(expected, expected + value, std::memory_order_relaxed)) {}
+}
+
+
+void MetricsRegistry::Histogram::render(const QString& name, const QString& labels, QByteArray& output) const {
+    QString  bucketName   = name + QString("_bucket");
+    QString  prefix       = labels.isEmpty() ? QString() : labels + QString(",");
+    unsigned numberBounds = static_cast<unsigned>(currentBounds.size());
+
+    // Buckets are read individually so a concurrent observation may be missing from some buckets.  The total is
+    // taken from the buckets so the rendered histogram is always self-consistent.
+    unsigned long long cumulative = 0;
+    for (unsigned i=0 ; i<numberBounds ; ++i) {
+        cumulative += currentCounts[i].loadAcquire();
+        renderLine(
+            bucketName,
+            prefix + label(QString("le"), QString::fromLatin1(formatValue(currentBounds.at(i)))),
+            QByteArray::number(cumulative),
+            output
+        );
+    }
+
+    cumulative += currentCounts[numberBounds].loadAcquire();
+    renderLine(bucketName, prefix + label(QString("le"), QString("+Inf")), QByteArray::number(cumulative), output);
+
+    renderLine(name + QString("_sum"), labels, formatValue(currentSum.load(std::memory_order_relaxed)), output);
+    renderLine(name + QString("_count"), labels, QByteArray::number(cumulative), output);
+}
+
+/***********************************************************************************************************************
+* MetricsRegistry::ScopedTimer
+*/
+
+MetricsRegistry::ScopedTimer::ScopedTimer(Histogram* histogram) {
+    currentHistogram = histogram;
+    if (histogram != nullptr) {
+        timer.start();
+    }
+}
+
+
+MetricsRegistry::ScopedTimer::~ScopedTimer() {
+    if (currentHistogram != nullptr) {
+        currentHistogram->observe(timer.nsecsElapsed() / 1.0E9);
+    }
+}
+
+/***********************************************************************************************************************
+* MetricsRegistry::SampledMetric
+*/
+
+MetricsRegistry::SampledMetric::SampledMetric(const Sampler& sampler):currentSampler(sampler) {}
+
+
+MetricsRegistry::SampledMetric::~SampledMetric() {}
+
+
+void MetricsRegistry::SampledMetric::render(const QString& name, const QString& labels, QByteArray& output) const {
+    renderLine(name, labels, formatValue(currentSampler()), output);
+}
+
+/***********************************************************************************************************************
+* MetricsRegistry
+*/
+
+MetricsRegistry* MetricsRegistry::instance() {
+    // The registry is intentionally never destroyed so that metrics can be updated during process shutdown.
+    static MetricsRegistry* registry = new MetricsRegistry;
+    return registry;
+}
+
+
+QString MetricsRegistry::label(const QString& name, const QString& value) {
+    QString escaped = value;
+    escaped.replace(QChar('\\'), QString("\\\\"));
+    escaped.replace(QChar('"'), QString("\\\""));
+    escaped.replace(QChar('\n'), QString("\\n"));
+
+    return QString("%1=\"%2\"").arg(name, escaped);
+}
+
+
+MetricsRegistry::Histogram* MetricsRegistry::queryHistogram(const QString& method) {
+    return instance()->histogram(
+        QString("dbc_database_query_seconds"),
+        QString("Time spent in database access methods, including connection acquisition."),
+        label(QString("method"), method)
+    );
+}
+
+
+MetricsRegistry::Counter* MetricsRegistry::counter(const QString& name, const QString& help, const QString& labels) {
+    Counter* result = nullptr;
+
+    QMutexLocker registryMutexLocker(&registryMutex);
+    Family* metricFamily = family(Type::COUNTER, name, help);
+    if (metricFamily != nullptr) {
+        Metric*& metric = metricFamily->series[labels];
+        if (metric == nullptr) {
+            metric = new Counter;
+        }
+
+        result = dynamic_cast<Counter*>(metric);
+    }
+
+    return result;
+}
+
+
+MetricsRegistry::Gauge* MetricsRegistry::gauge(const QString& name, const QString& help, const QString& labels) {
+    Gauge* result = nullptr;
+
+    QMutexLocker registryMutexLocker(&registryMutex);
+    Family* metricFamily = family(Type::GAUGE, name, help);
+    if (metricFamily != nullptr) {
+        Metric*& metric = metricFamily->series[labels];
+        if (metric == nullptr) {
+            metric = new Gauge;
+        }
+
+        result = dynamic_cast<Gauge*>(metric);
+    }
+
+    return result;
+}
+
+
+MetricsRegistry::Histogram* MetricsRegistry::histogram(
+        const QString&       name,
+        const QString&       help,
+        const QString&       labels,
+        const QList<double>& bounds
+    ) {
+    Histogram* result = nullptr;
+
+    QMutexLocker registryMutexLocker(&registryMutex);
+    Family* metricFamily = family(Type::HISTOGRAM, name, help);
+    if (metricFamily != nullptr) {
+        Metric*& metric = metricFamily->series[labels];
+        if (metric == nullptr) {
+            metric = new Histogram(bounds);
+        }
+
+        result = dynamic_cast<Histogram*>(metric);
+    }
+
+    return result;
+}
+
+
+bool MetricsRegistry::addSampler(
+        MetricsRegistry::Type type,
+        const QString&        name,
+        const QString&        help,
+        const QString&        labels,
+        const Sampler&        sampler
+    ) {
+    bool success = false;
+
+    if (type != Type::HISTOGRAM) {
+        QMutexLocker registryMutexLocker(&registryMutex);
+        Family* metricFamily = family(type, name, help);
+        if (metricFamily != nullptr) {
+            Metric*& metric = metricFamily->series[labels];
+            if (metric != nullptr) {
+                delete metric;
+            }
+
+            metric  = new SampledMetric(sampler);
+            success = true;
+        }
+    }
+
+    return success;
+}
+
+
+void MetricsRegistry::removeSeries(const QString& name, const QString& labels) {
+    QMutexLocker registryMutexLocker(&registryMutex);
+
+    QMap<QString, Family>::iterator familyIterator = families.find(name);
+    if (familyIterator != families.end()) {
+        Metric* metric = familyIterator.value().series.take(labels);
+        if (metric != nullptr) {
+            delete metric;
+        }
+
+        if (familyIterator.value().series.isEmpty()) {
+            families.erase(familyIterator);
+        }
+    }
+}
+
+
+QByteArray MetricsRegistry::render() const {
+    QByteArray result;
+
+    QMutexLocker registryMutexLocker(&registryMutex);
+    for (  QMap<QString, Family>::const_iterator familyIterator  = families.constBegin(),
+                                                 familyEnd       = families.constEnd()
+         ; familyIterator != familyEnd
+         ; ++familyIterator
+        ) {
+        const QString& name         = familyIterator.key();
+        const Family&  metricFamily = familyIterator.value();
+
+        QString typeName;
+        switch (metricFamily.type) {
+            case Type::COUNTER: {
+                typeName = QString("counter");
+                break;
+            }
+
+            case Type::GAUGE: {
+                typeName = QString("gauge");
+                break;
+            }
+
+            case Type::HISTOGRAM: {
+                typeName = QString("histogram");
+                break;
+            }
+        }
+
+        QString help = metricFamily.help;
+        help.replace(QChar('\\'), QString("\\\\")).replace(QChar('\n'), QString("\\n"));
+
+        result += QString("# HELP %1 %2\n# TYPE %1 %3\n").arg(name, help, typeName).toUtf8();
+
+        for (  QMap<QString, Metric*>::const_iterator it  = metricFamily.series.constBegin(),
+                                                      end = metricFamily.series.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            it.value()->render(name, it.key(), result);
+        }
+    }
+
+    return result;
+}
+
+
+MetricsRegistry::MetricsRegistry() {}
+
+
+MetricsRegistry::~MetricsRegistry() {
+    for (QMap<QString, Family>::const_iterator it=families.constBegin(),end=families.constEnd() ; it!=end ; ++it) {
+        const QMap<QString, Metric*>& series = it.value().series;
+        for (  QMap<QString, Metric*>::const_iterator seriesIterator  = series.constBegin(),
+                                                      seriesEnd       = series.constEnd()
+             ; seriesIterator != seriesEnd
+             ; ++seriesIterator
+            ) {
+            delete seriesIterator.value();
+        }
+    }
+}
+
+
+MetricsRegistry::Family* MetricsRegistry::family(
+        MetricsRegistry::Type type,
+        const QString&        name,
+        const QString&        help
+    ) {
+    Family* result;
+
+    QMap<QString, Family>::iterator it = families.find(name);
+    if (it == families.end()) {
+        Family newFamily;
+        newFamily.type = type;
+        newFamily.help = help;
+
+        result = &(families.insert(name, newFamily).value());
+    } else if (it.value().type == type) {
+        result = &(it.value());
+    } else {
+        result = nullptr;
+    }
+
+    return result;
+}
+
+
+QByteArray MetricsRegistry::formatValue(double value) {
+    QByteArray result;
+
+    if (std::isnan(value)) {
+        result = QByteArray("NaN");
+    } else if (std::isinf(value)) {
+        result = value > 0 ? QByteArray("+Inf") : QByteArray("-Inf");
+    } else {
+        result = QByteArray::number(value, 'g', 15);
+    }
+
+    return result;
+}
+
+
+void MetricsRegistry::renderLine(
+        const QString&    name,
+        const QString&    labels,
+        const QByteArray& value,
+        QByteArray&       output
+    ) {
+    output += name.toUtf8();
+    if (!labels.isEmpty()) {
+        output += '{';
+        output += labels.toUtf8();
+        output += '}';
+    }
+
+    output += ' ';
+    output += value;
+    output += '\n';
+}
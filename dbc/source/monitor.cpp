@@ -27,6 +27,7 @@
 #include <cstring>
 
 #include "host_scheme.h"
+#include "string_pool.h"
 #include "monitor.h"
 
 Monitor::Monitor(
@@ -50,30 +51,32 @@ Monitor::Monitor(
     ),currentUserOrdering(
         userOrdering
     ),currentPath(
-        path
+        StringPool::intern(path)
     ),currentMethod(
         method
     ),currentContentCheckMode(
         contentCheckMode
     ),currentKeywords(
-        keywords
+        toByteArray(keywords)
     ),currentContentType(
         contentType
     ),currentUserAgent(
-        userAgent
-    ),currentPostContent(
-        postContent
-    ) {}
+        StringPool::intern(userAgent)
+    ) {
+    setPostContent(postContent);
+}
 
 
 Monitor::Monitor() {
-    currentMonitorId        = invalidMonitorId;
-    currentCustomerId       = invalidCustomerId;
-    currentHostSchemeId     = invalidHostSchemeId;
-    currentUserOrdering     = 0;
-    currentMethod           = Method::GET;
-    currentContentCheckMode = ContentCheckMode::NO_CHECK;
-    currentContentType      = ContentType::TEXT;
+    currentMonitorId             = invalidMonitorId;
+    currentCustomerId            = invalidCustomerId;
+    currentHostSchemeId          = invalidHostSchemeId;
+    currentUserOrdering          = 0;
+    currentMethod                = Method::GET;
+    currentContentCheckMode      = ContentCheckMode::NO_CHECK;
+    currentKeywords              = toByteArray(KeywordList());
+    currentContentType           = ContentType::TEXT;
+    currentPostContentCompressed = false;
 }
 
 
@@ -101,6 +104,8 @@ Monitor::Monitor(
         other.currentUserAgent
     ),currentPostContent(
         other.currentPostContent
+    ),currentPostContentCompressed(
+        other.currentPostContentCompressed
     ) {}
 
 
@@ -128,9 +133,31 @@ Monitor::Monitor(
         other.currentUserAgent
     ),currentPostContent(
         other.currentPostContent
+    ),currentPostContentCompressed(
+        other.currentPostContentCompressed
     ) {}
 
 
+QByteArray Monitor::postContent() const {
+    return currentPostContentCompressed ? qUncompress(currentPostContent) : currentPostContent;
+}
+
+
+QByteArray Monitor::compressedPostContent() const {
+    return currentPostContentCompressed ? currentPostContent : qCompress(currentPostContent);
+}
+
+
+void Monitor::setPostContent(const QByteArray& newPostContent) {
+    if (newPostContent.size() >= postContentCompressionThreshold) {
+        currentPostContent           = qCompress(newPostContent);
+        currentPostContentCompressed = true;
+    } else {
+        currentPostContent           = newPostContent;
+        currentPostContentCompressed = false;
+    }
+}
+
 
 QString Monitor::toString(Method method) {
     QString result;
@@ -375,35 +402,91 @@ Monitor::KeywordList Monitor::toKeywordList(const QByteArray& blob, bool* ok) {
 }
 
 
+bool Monitor::isValidKeywordBlob(const QByteArray& blob) {
+    bool     success    = true;
+    unsigned blobLength = static_cast<unsigned>(blob.size());
+    if (blobLength >= 2) {
+        const std::uint8_t* blobData       = reinterpret_cast<const std::uint8_t*>(blob.data());
+        unsigned            numberKeywords = blobData[0] | (blobData[1] << 8);
+        unsigned            keywordIndex   = 0;
+        unsigned            blobIndex      = 2;
+        while (success && keywordIndex < numberKeywords && blobIndex + 2 <= blobLength) {
+            unsigned keywordLength = blobData[blobIndex] | (blobData[blobIndex+1] << 8);
+
+            blobIndex += 2;
+            if (blobLength - blobIndex >= keywordLength) {
+                blobIndex += keywordLength;
+                ++keywordIndex;
+            } else {
+                success = false;
+            }
+        }
+
+        success = success && blobIndex == blobLength;
+    } else {
+        success = false;
+    }
+
+    return success;
+}
+
+
+void Monitor::setCompressedPostContent(const QByteArray& newCompressedPostContent) {
+    // qCompress prefixes its output with the expanded length as a 32-bit big-endian value so we can decide whether
+    // to keep the content compressed without expanding it.
+
+    unsigned long expandedLength = 0;
+    if (newCompressedPostContent.size() >= 4) {
+        const std::uint8_t* d = reinterpret_cast<const std::uint8_t*>(newCompressedPostContent.data());
+        expandedLength = (
+              (static_cast<unsigned long>(d[0]) << 24)
+            | (static_cast<unsigned long>(d[1]) << 16)
+            | (static_cast<unsigned long>(d[2]) <<  8)
+            |  static_cast<unsigned long>(d[3])
+        );
+    }
+
+    if (expandedLength >= static_cast<unsigned long>(postContentCompressionThreshold)) {
+        currentPostContent           = newCompressedPostContent;
+        currentPostContentCompressed = true;
+    } else {
+        currentPostContent           = qUncompress(newCompressedPostContent);
+        currentPostContentCompressed = false;
+    }
+}
+
+
 Monitor& Monitor::operator=(const Monitor& other) {
-    currentMonitorId        = other.currentMonitorId;
-    currentCustomerId       = other.currentCustomerId;
-    currentHostSchemeId     = other.currentHostSchemeId;
-    currentUserOrdering     = other.currentUserOrdering;
-    currentPath             = other.currentPath;
-    currentMethod           = other.currentMethod;
-    currentContentCheckMode = other.currentContentCheckMode;
-    currentKeywords         = other.currentKeywords;
-    currentContentType      = other.currentContentType;
-    currentUserAgent        = other.currentUserAgent;
-    currentPostContent      = other.currentPostContent;
+    currentMonitorId             = other.currentMonitorId;
+    currentCustomerId            = other.currentCustomerId;
+    currentHostSchemeId          = other.currentHostSchemeId;
+    currentUserOrdering          = other.currentUserOrdering;
+    currentPath                  = other.currentPath;
+    currentMethod                = other.currentMethod;
+    currentContentCheckMode      = other.currentContentCheckMode;
+    currentKeywords              = other.currentKeywords;
+    currentContentType           = other.currentContentType;
+    currentUserAgent             = other.currentUserAgent;
+    currentPostContent           = other.currentPostContent;
+    currentPostContentCompressed = other.currentPostContentCompressed;
 
     return *this;
 }
 
 
 Monitor& Monitor::operator=(Monitor&& other) {
-    currentMonitorId        = other.currentMonitorId;
-    currentCustomerId       = other.currentCustomerId;
-    currentHostSchemeId     = other.currentHostSchemeId;
-    currentUserOrdering     = other.currentUserOrdering;
-    currentPath             = other.currentPath;
-    currentMethod           = other.currentMethod;
-    currentContentCheckMode = other.currentContentCheckMode;
-    currentKeywords         = other.currentKeywords;
-    currentContentType      = other.currentContentType;
-    currentUserAgent        = other.currentUserAgent;
-    currentPostContent      = other.currentPostContent;
+    currentMonitorId             = other.currentMonitorId;
+    currentCustomerId            = other.currentCustomerId;
+    currentHostSchemeId          = other.currentHostSchemeId;
+    currentUserOrdering          = other.currentUserOrdering;
+    currentPath                  = other.currentPath;
+    currentMethod                = other.currentMethod;
+    currentContentCheckMode      = other.currentContentCheckMode;
+    currentKeywords              = other.currentKeywords;
+    currentContentType           = other.currentContentType;
+    currentUserAgent             = other.currentUserAgent;
+    currentPostContent           = other.currentPostContent;
+    currentPostContentCompressed = other.currentPostContentCompressed;
 
     return *this;
 }
@@ -26,11 +26,17 @@
 #include <QSet>
 #include <QHash>
 #include <QDateTime>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlError>
 
 #include <cstdint>
 #include <limits>
 #include <algorithm>
 
+#include "log.h"
+#include "database_manager.h"
+#include "request_tracer.h"
 #include "customer_capabilities.h"
 #include "host_scheme.h"
 #include "monitor.h"
@@ -42,10 +48,13 @@
 #include "monitor_updater.h"
 
 MonitorUpdater::MonitorUpdater(
+        DatabaseManager*     databaseManager,
         HostSchemes*         hostSchemes,
         Monitors*            monitors,
         ServerAdministrator* serverAdministrator
-    ):currentHostSchemes(
+    ):currentDatabaseManager(
+        databaseManager
+    ),currentHostSchemes(
         hostSchemes
     ),currentMonitors(
         monitors
@@ -155,11 +164,17 @@ MonitorUpdater::Errors MonitorUpdater::update(
 
             HostSchemesBySchemeHost hashedExistingHostSchemes = hashHostSchemesBySchemeHost(existingHostSchemes);
 
-            QSet<const HostScheme*> usedHostSchemes;
-            QList<HostScheme*>      newHostSchemes;
-            QList<Monitor*>         newMonitors;
+            // Compute the full set of differences first so the changes can be applied with a handful of multi-row
+            // statements rather than one round trip per entry.
 
-            const HostScheme* previousHostScheme = nullptr;
+            QSet<HostSchemeId>     usedHostSchemeIds;
+            QHash<SchemeHost, int> newHostSchemeIndexes;
+            QList<QUrl>            newHostSchemeUrls;
+            PendingMonitors        pendingMonitors;
+            Monitors::MonitorList  modifiedMonitors;
+
+            const HostScheme* previousHostScheme         = nullptr;
+            int               previousNewHostSchemeIndex = -1;
             for (  SortedEntries::const_iterator entryIterator    = sortedEntries.constBegin(),
                                                  entryEndIterator = sortedEntries.constEnd()
                  ; entryIterator != entryEndIterator
@@ -170,79 +185,84 @@ MonitorUpdater::Errors MonitorUpdater::update(
                 QString      slug  = urlToSlug(uri);
 
                 const HostScheme* hostScheme;
+                int               newHostSchemeIndex;
                 if (uri.isRelative()) { // This check is enough since we've already validated entries above.
-                    hostScheme = previousHostScheme;
+                    hostScheme         = previousHostScheme;
+                    newHostSchemeIndex = previousNewHostSchemeIndex;
                 } else {
                     SchemeHost schemeHost(uri);
-                    hostScheme = hashedExistingHostSchemes.value(schemeHost, nullptr);
+                    hostScheme         = hashedExistingHostSchemes.value(schemeHost, nullptr);
+                    newHostSchemeIndex = -1;
+
+                    if (hostScheme == nullptr) {
+                        newHostSchemeIndex = newHostSchemeIndexes.value(schemeHost, -1);
+                        if (newHostSchemeIndex < 0) {
+                            newHostSchemeIndex = newHostSchemeUrls.size();
+                            newHostSchemeIndexes.insert(schemeHost, newHostSchemeIndex);
+                            newHostSchemeUrls.append(uri);
+                        }
+                    }
                 }
 
                 if (hostScheme == nullptr) {
-                    HostScheme* newHostScheme = new HostScheme(
-                        currentHostSchemes->createHostScheme(customerId, uri, threadId)
-                    );
+                    PendingMonitor pendingMonitor;
+                    pendingMonitor.newHostSchemeIndex = newHostSchemeIndex;
+                    pendingMonitor.hostSchemeId       = invalidHostSchemeId;
+                    pendingMonitor.slug               = slug;
+                    pendingMonitor.entry              = entry;
 
-                    hostScheme = newHostScheme;
-                    newHostSchemes.append(newHostScheme);
-
-                    if (newHostScheme->isValid()) {
-                        Monitor* monitor = createMonitor(
-                            customerId,
-                            hostScheme->hostSchemeId(),
-                            slug,
-                            *entry,
-                            threadId
-                        );
-
-                        if (!monitor->isValid()) {
-                            errors.append(Error(entry->userOrdering(), QString("failed to create monitor entry")));
-                        }
-
-                        newMonitors.append(monitor);
-                    } else {
-                        errors.append(Error(entry->userOrdering(), QString("failed to create monitor entry")));
-                    }
+                    pendingMonitors.append(pendingMonitor);
                 } else {
-                    SchemeHostPath shp(hostScheme->hostSchemeId(), slug);
+                    HostSchemeId   hostSchemeId = hostScheme->hostSchemeId();
+                    SchemeHostPath shp(hostSchemeId, slug);
                     Monitors::MonitorsBySchemeHostPath::iterator existingIterator = existingMonitors.find(shp);
                     if (existingIterator != existingMonitors.end()) {
-                        Monitor* monitor = &(existingIterator.value());
-
-                        bool updateNeeded = updateMonitor(monitor, *entry);
+                        Monitor monitor      = existingIterator.value();
+                        bool    updateNeeded = updateMonitor(&monitor, *entry);
                         if (updateNeeded) {
-                            bool success = currentMonitors->modifyMonitor(*monitor, threadId);
-                            if (!success) {
-                                errors.append(
-                                    Error(entry->userOrdering(), QString("failed to update monitor settings"))
-                                );
-                            }
+                            modifiedMonitors.append(monitor);
                         }
 
                         existingMonitors.erase(existingIterator);
                     } else {
-                        Monitor* monitor = createMonitor(
-                            customerId,
-                            hostScheme->hostSchemeId(),
-                            slug,
-                            *entry,
-                            threadId
-                        );
-                        newMonitors.append(monitor);
-
-                        if (!monitor->isValid()) {
-                            errors.append(Error(entry->userOrdering(), QString("failed to create monitor entry")));
-                        }
+                        PendingMonitor pendingMonitor;
+                        pendingMonitor.newHostSchemeIndex = -1;
+                        pendingMonitor.hostSchemeId       = hostSchemeId;
+                        pendingMonitor.slug               = slug;
+                        pendingMonitor.entry              = entry;
+
+                        pendingMonitors.append(pendingMonitor);
                     }
+
+                    usedHostSchemeIds.insert(hostSchemeId);
                 }
 
-                usedHostSchemes.insert(hostScheme);
-                previousHostScheme = hostScheme;
+                previousHostScheme         = hostScheme;
+                previousNewHostSchemeIndex = newHostSchemeIndex;
+            }
+
+            HostSchemes::HostSchemeList unusedHostSchemes;
+            for (  HostSchemes::HostSchemeHash::const_iterator
+                       hostSchemeIterator    = existingHostSchemes.constBegin(),
+                       hostSchemeEndIterator = existingHostSchemes.constEnd()
+                 ; hostSchemeIterator != hostSchemeEndIterator
+                 ; ++hostSchemeIterator
+                ) {
+                if (!usedHostSchemeIds.contains(hostSchemeIterator.key())) {
+                    unusedHostSchemes.append(hostSchemeIterator.value());
+                }
             }
 
-            deleteUnusedMonitors(errors, existingMonitors, threadId);
-            deleteUnusedHostSchemes(errors, existingHostSchemes, usedHostSchemes, threadId);
-            deleteContents(newMonitors);
-            deleteContents(newHostSchemes);
+            applyChanges(
+                errors,
+                customerId,
+                newHostSchemeUrls,
+                pendingMonitors,
+                modifiedMonitors,
+                existingMonitors,
+                unusedHostSchemes,
+                threadId
+            );
         }
     } else {
         bool success = deleteCustomer(customerId, threadId);
@@ -296,8 +316,11 @@ void MonitorUpdater::performSchedulePollingServerUpdate(unsigned long customerId
 
 void MonitorUpdater::performUpdates() {
     if (!pendingUpdatesByTimestamp.isEmpty()) {
-        unsigned long long                  currentTimestamp;
-        PendingUpdatesByTimestamp::iterator pit = pendingUpdatesByTimestamp.begin();
+        ServerAdministrator::CustomerList activatedCustomers;
+        ServerAdministrator::CustomerList deactivatedCustomers;
+
+        unsigned long long                  currentTimestamp = QDateTime::currentSecsSinceEpoch();
+        PendingUpdatesByTimestamp::iterator pit              = pendingUpdatesByTimestamp.begin();
         do {
             const PendingUpdates pendingUpdates = pit.value();
             for (  PendingUpdates::const_iterator cit = pendingUpdates.constBegin(), end = pendingUpdates.constEnd()
@@ -308,19 +331,30 @@ void MonitorUpdater::performUpdates() {
                 bool                deactivate = cit.value();
 
                 if (deactivate) {
-                    currentServerAdministrator->deactivateCustomer(customerId, timerThreadId);
+                    deactivatedCustomers.append(customerId);
                 } else {
-                    currentServerAdministrator->activateCustomer(customerId, timerThreadId);
+                    activatedCustomers.append(customerId);
                 }
 
                 updateTimestampByCustomerId.remove(customerId);
             }
 
             pit = pendingUpdatesByTimestamp.erase(pit);
-            currentTimestamp = QDateTime::currentSecsSinceEpoch();
         } while (pit != pendingUpdatesByTimestamp.end() && pit.key() <= currentTimestamp);
 
+        // Due updates are sent together so each polling server receives one message covering all of its customers.
+
+        if (!deactivatedCustomers.isEmpty()) {
+            currentServerAdministrator->deactivateCustomers(deactivatedCustomers, timerThreadId);
+        }
+
+        if (!activatedCustomers.isEmpty()) {
+            currentServerAdministrator->activateCustomers(activatedCustomers, timerThreadId);
+        }
+
         if (!pendingUpdatesByTimestamp.isEmpty()) {
+            currentTimestamp = QDateTime::currentSecsSinceEpoch();
+
             unsigned long long newFirstTimestamp = pendingUpdatesByTimestamp.firstKey();
             unsigned           newDelay          =   newFirstTimestamp > currentTimestamp
                                                    ? newFirstTimestamp - currentTimestamp
@@ -434,31 +468,6 @@ QString MonitorUpdater::urlToSlug(const QUrl& url) {
 }
 
 
-Monitor* MonitorUpdater::createMonitor(
-        MonitorUpdater::CustomerId   customerId,
-        MonitorUpdater::HostSchemeId hostSchemeId,
-        const QString&               slug,
-        const MonitorUpdater::Entry& entry,
-        unsigned int                 threadId
-    ) {
-    return new Monitor(
-        currentMonitors->createMonitor(
-            customerId,
-            hostSchemeId,
-            entry.userOrdering(),
-            slug,
-            entry.method(),
-            entry.contentCheckMode(),
-            entry.keywords(),
-            entry.contentType(),
-            entry.userAgent(),
-            entry.postContent(),
-            threadId
-        )
-    );
-}
-
-
 bool MonitorUpdater::updateMonitor(Monitor* monitor, const Entry& monitorEntry) {
     bool monitorChanged = false;
 
@@ -507,49 +516,192 @@ bool MonitorUpdater::updateMonitor(Monitor* monitor, const Entry& monitorEntry)
 }
 
 
-void MonitorUpdater::deleteUnusedMonitors(
+void MonitorUpdater::applyChanges(
         MonitorUpdater::Errors&                   errors,
-        const Monitors::MonitorsBySchemeHostPath& existingMonitors,
+        MonitorUpdater::CustomerId                customerId,
+        const QList<QUrl>&                        newHostSchemeUrls,
+        const MonitorUpdater::PendingMonitors&    pendingMonitors,
+        const Monitors::MonitorList&              modifiedMonitors,
+        const Monitors::MonitorsBySchemeHostPath& unusedMonitors,
+        const HostSchemes::HostSchemeList&        unusedHostSchemes,
         unsigned                                  threadId
     ) {
-    for (  Monitors::MonitorsBySchemeHostPath::const_iterator
-               monitorIterator    = existingMonitors.constBegin(),
-               monitorEndIterator = existingMonitors.constEnd()
-         ; monitorIterator != monitorEndIterator
-         ; ++monitorIterator
-        ) {
-        const Monitor* monitor = &monitorIterator.value();
-        bool success = currentMonitors->deleteMonitor(*monitor, threadId);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+    bool success = database.isOpen();
+    if (success) {
+        bool usingTransaction = (
+               database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)
+            && database.transaction()
+        );
+
+        HostSchemes::HostSchemeList insertedHostSchemes;
+        Monitors::MonitorList       insertedMonitors;
+        Monitors::MonitorList       updatedMonitors;
+        QList<MonitorId>            removedMonitorIds;
+        QList<HostSchemeId>         removedHostSchemeIds;
+
+        if (!newHostSchemeUrls.isEmpty()) {
+            success = currentHostSchemes->insertHostSchemes(
+                database,
+                customerId,
+                newHostSchemeUrls,
+                insertedHostSchemes
+            );
+        }
+
+        if (success && !pendingMonitors.isEmpty()) {
+            Monitors::MonitorList newMonitors;
+            for (  PendingMonitors::const_iterator it  = pendingMonitors.constBegin(),
+                                                   end = pendingMonitors.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                const Entry* entry        = it->entry;
+                HostSchemeId hostSchemeId =   it->newHostSchemeIndex >= 0
+                                            ? insertedHostSchemes.at(it->newHostSchemeIndex).hostSchemeId()
+                                            : it->hostSchemeId;
+
+                newMonitors.append(
+                    Monitor(
+                        invalidMonitorId,
+                        customerId,
+                        hostSchemeId,
+                        entry->userOrdering(),
+                        it->slug,
+                        entry->method(),
+                        entry->contentCheckMode(),
+                        entry->keywords(),
+                        entry->contentType(),
+                        entry->userAgent(),
+                        entry->postContent()
+                    )
+                );
+            }
+
+            success = currentMonitors->insertMonitors(database, newMonitors, insertedMonitors);
+        }
+
         if (!success) {
-            errors.append(Error(monitor->userOrdering(), QString("failed to delete unused monitor.")));
+            for (  PendingMonitors::const_iterator it  = pendingMonitors.constBegin(),
+                                                   end = pendingMonitors.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                errors.append(Error(it->entry->userOrdering(), QString("failed to create monitor entry")));
+            }
+        }
+
+        if (success && !modifiedMonitors.isEmpty()) {
+            success = currentMonitors->updateMonitors(database, modifiedMonitors);
+            if (success) {
+                updatedMonitors = modifiedMonitors;
+            } else {
+                for (  Monitors::MonitorList::const_iterator it  = modifiedMonitors.constBegin(),
+                                                             end = modifiedMonitors.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    errors.append(Error(it->userOrdering(), QString("failed to update monitor settings")));
+                }
+            }
         }
-    }
-}
 
+        if (success && !unusedMonitors.isEmpty()) {
+            QList<MonitorId> unusedMonitorIds;
+            for (  Monitors::MonitorsBySchemeHostPath::const_iterator it  = unusedMonitors.constBegin(),
+                                                                      end = unusedMonitors.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                unusedMonitorIds.append(it.value().monitorId());
+            }
+
+            success = currentMonitors->removeMonitors(database, unusedMonitorIds);
+            if (success) {
+                removedMonitorIds = unusedMonitorIds;
+            } else {
+                for (  Monitors::MonitorsBySchemeHostPath::const_iterator it  = unusedMonitors.constBegin(),
+                                                                          end = unusedMonitors.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    errors.append(Error(it.value().userOrdering(), QString("failed to delete unused monitor.")));
+                }
+            }
+        }
+
+        if (success && !unusedHostSchemes.isEmpty()) {
+            QList<HostSchemeId> unusedHostSchemeIds;
+            for (  HostSchemes::HostSchemeList::const_iterator it  = unusedHostSchemes.constBegin(),
+                                                               end = unusedHostSchemes.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                unusedHostSchemeIds.append(it->hostSchemeId());
+            }
+
+            success = currentHostSchemes->removeHostSchemes(database, unusedHostSchemeIds);
+            if (success) {
+                removedHostSchemeIds = unusedHostSchemeIds;
+            } else {
+                for (  HostSchemes::HostSchemeList::const_iterator it  = unusedHostSchemes.constBegin(),
+                                                                   end = unusedHostSchemes.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    errors.append(
+                        Error(0xFFFF, QString("failed to delete host/scheme %1").arg(it->url().toString()))
+                    );
+                }
+            }
+        }
+
+        if (usingTransaction) {
+            if (success) {
+                success = database.commit();
+                if (!success) {
+                    logWrite(
+                        QString("Failed commit - MonitorUpdater::applyChanges: %1").arg(database.lastError().text()),
+                        true
+                    );
+
+                    errors.append(Error(0, QString("failed to commit monitor changes")));
+                }
+            }
 
-void MonitorUpdater::deleteUnusedHostSchemes(
-        MonitorUpdater::Errors&            errors,
-        const HostSchemes::HostSchemeHash& existingHostSchemes,
-        const QSet<const HostScheme*>&     usedHostSchemes,
-        unsigned                           threadId
-    ) {
-    for (  HostSchemes::HostSchemeHash::const_iterator
-               hostSchemeIterator    = existingHostSchemes.constBegin(),
-               hostSchemeEndIterator = existingHostSchemes.constEnd()
-         ; hostSchemeIterator != hostSchemeEndIterator
-         ; ++hostSchemeIterator
-        ) {
-        const HostScheme* hostScheme = &hostSchemeIterator.value();
-        if (!usedHostSchemes.contains(hostScheme)) {
-            bool success = currentHostSchemes->deleteHostScheme(*hostScheme, threadId);
             if (!success) {
-                errors.append(
-                    Error(
-                        0xFFFF,
-                        QString("failed to delete host/scheme %1").arg(hostScheme->url().toString())
-                    )
-                );
+                bool rollbackSuccess = database.rollback();
+                if (!rollbackSuccess) {
+                    logWrite(
+                        QString("Failed rollback - MonitorUpdater::applyChanges: %1")
+                        .arg(database.lastError().text()),
+                        true
+                    );
+                }
+
+                insertedHostSchemes.clear();
+                insertedMonitors.clear();
+                updatedMonitors.clear();
+                removedMonitorIds.clear();
+                removedHostSchemeIds.clear();
             }
         }
+
+        // Without transaction support, whatever was written before a failure is still published so the catalog
+        // continues to match the database.
+
+        currentHostSchemes->commitHostSchemes(insertedHostSchemes, removedHostSchemeIds);
+        currentMonitors->commitMonitors(insertedMonitors, updatedMonitors, removedMonitorIds);
+    } else {
+        logWrite(
+            QString("Failed to open database - MonitorUpdater::applyChanges: %1").arg(database.lastError().text()),
+            true
+        );
+
+        errors.append(Error(0, QString("could not open database")));
     }
+
+    currentDatabaseManager->closeAndRelease(database);
 }
@@ -22,6 +22,7 @@
 #include <QString>
 #include <QHash>
 #include <QList>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
@@ -30,21 +31,35 @@
 #include <QVariant>
 
 #include <cstdint>
+#include <algorithm>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "database_manager.h"
+#include "id_registry.h"
+#include "catalog.h"
 #include "host_scheme.h"
 #include "scheme_host_path.h"
 #include "monitor.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
 #include "monitors.h"
 
+const unsigned long Monitors::maximumMonitorsPerStatement = 500;
+
 Monitors::Monitors(
         DatabaseManager* databaseManager,
+        IdRegistry*      idRegistry,
+        Catalog*         catalog,
         QObject*         parent
     ):QObject(
         parent
     ),currentDatabaseManager(
         databaseManager
+    ),currentIdRegistry(
+        idRegistry
+    ),currentCatalog(
+        catalog
     ) {}
 
 
@@ -52,126 +67,40 @@ Monitors::~Monitors() {}
 
 
 Monitor Monitors::getMonitor(Monitors::MonitorId monitorId, unsigned threadId) const {
-    Monitor result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
-
-        QString queryString = QString("SELECT * FROM monitor WHERE monitor_id = %1").arg(monitorId);
-
-        success = query.exec(queryString);
-        if (success) {
-            if (query.first()) {
-                result = convertQueryToMonitor(query, &success);
-            } else {
-                // We're OK but there was no record for the requested region.
-            }
-        } else {
-            logWrite(QString("Failed SELECT - Monitors::getMonitor: %1").arg(query.lastError().text()), true);
-        }
-    } else {
-        logWrite(QString("Failed to open database - Monitors::getMonitor: %1").arg(database.lastError().text()), true);
-    }
-
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+    return currentCatalog->snapshot(threadId)->monitor(monitorId);
 }
 
 
 Monitors::MonitorList Monitors::getMonitorsByUserOrder(Monitors::CustomerId customerId, unsigned threadId) const {
-    MonitorList result;
+    MonitorList              result;
+    Catalog::SnapshotPointer catalog = currentCatalog->snapshot(threadId);
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+    if (customerId == Monitors::invalidCustomerId) {
+        const MonitorsById& monitorsById = catalog->monitorsById();
+        QList<MonitorId>    monitorIds   = monitorsById.keys();
 
-        QString queryString;
-        if (customerId == Monitors::invalidCustomerId) {
-            queryString = QString("SELECT * FROM monitor ORDER BY monitor_id ASC");
-        } else {
-            queryString = QString("SELECT * FROM monitor WHERE customer_id = %1 ORDER BY user_ordering ASC")
-                          .arg(customerId);
-        }
-
-        success = query.exec(queryString);
-        if (success) {
-            while (success && query.next()) {
-                Monitor monitor = convertQueryToMonitor(query, &success);
-                if (success) {
-                    result.append(monitor);
-                }
-            }
-
-            if (!success) {
-                result.clear();
-            }
-        } else {
-            logWrite(
-                QString("Failed SELECT - Monitors::getMonitorsByUserOrder: %1").arg(query.lastError().text()),
-                true
-            );
+        std::sort(monitorIds.begin(), monitorIds.end());
+        for (QList<MonitorId>::const_iterator it=monitorIds.constBegin(),end=monitorIds.constEnd() ; it!=end ; ++it) {
+            result.append(monitorsById.value(*it));
         }
     } else {
-        logWrite(
-            QString("Failed to open database - Monitors::getMonitorsByUserOrder: %1").arg(database.lastError().text()),
-            true
-        );
+        result = catalog->monitorsByUserOrder(customerId);
     }
 
-    currentDatabaseManager->closeAndRelease(database);
     return result;
 }
 
 
 Monitors::MonitorsById Monitors::getMonitorsByCustomerId(Monitors::CustomerId customerId, unsigned threadId) const {
-    MonitorsById result;
+    MonitorsById             result;
+    Catalog::SnapshotPointer catalog = currentCatalog->snapshot(threadId);
 
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
-
-        QString queryString;
-        if (customerId == Monitors::invalidCustomerId) {
-            queryString = QString("SELECT * FROM monitor ORDER BY monitor_id ASC");
-        } else {
-            queryString = QString("SELECT * FROM monitor WHERE customer_id = %1 ORDER BY user_ordering ASC")
-                          .arg(customerId);
-        }
-
-        success = query.exec(queryString);
-        if (success) {
-            while (success && query.next()) {
-                Monitor monitor = convertQueryToMonitor(query, &success);
-                if (success) {
-                    result.insert(monitor.monitorId(), monitor);
-                }
-            }
-
-            if (!success) {
-                result.clear();
-            }
-        } else {
-            logWrite(
-                QString("Failed SELECT - Monitors::getMonitorsByCustomerId: %1").arg(query.lastError().text()),
-                true
-            );
-        }
+    if (customerId == Monitors::invalidCustomerId) {
+        result = catalog->monitorsById();
     } else {
-        logWrite(
-            QString("Failed to open database - Monitors::getMonitorsByCustomerId: %1")
-            .arg(database.lastError().text()),
-            true
-        );
+        result = catalog->monitorsByCustomerId(customerId);
     }
 
-    currentDatabaseManager->closeAndRelease(database);
     return result;
 }
 
@@ -180,45 +109,7 @@ Monitors::MonitorsBySchemeHostPath Monitors::getMonitorsBySchemeHostPath(
         Monitors::CustomerId customerId,
         unsigned             threadId
     ) const {
-    MonitorsBySchemeHostPath result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
-
-        QString queryString = QString("SELECT * FROM monitor WHERE customer_id = %1").arg(customerId);
-
-        success = query.exec(queryString);
-        if (success) {
-            while (success && query.next()) {
-                Monitor monitor = convertQueryToMonitor(query, &success);
-                if (success) {
-                    SchemeHostPath shp(monitor.hostSchemeId(), monitor.path());
-                    result.insert(shp, monitor);
-                }
-            }
-
-            if (!success) {
-                result.clear();
-            }
-        } else {
-            logWrite(
-                QString("Failed SELECT - Monitors::getMonitorsBySchemeHostPath: %1").arg(query.lastError().text()),
-                true
-            );
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database - Monitors::getMonitorsBySchemeHostPath: %1")
-            .arg(database.lastError().text()),
-            true
-        );
-    }
-
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+    return currentCatalog->snapshot(threadId)->monitorsBySchemeHostPath(customerId);
 }
 
 
@@ -226,82 +117,12 @@ Monitors::MonitorList Monitors::getMonitorsUnderHostScheme(
         Monitors::HostSchemeId hostSchemeId,
         unsigned               threadId
     ) const {
-    MonitorList result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
-
-        QString queryString = QString("SELECT * FROM monitor WHERE host_scheme_id = %1 ORDER BY user_ordering ASC")
-                              .arg(hostSchemeId);
-
-        success = query.exec(queryString);
-        if (success) {
-            while (success && query.next()) {
-                Monitor monitor = convertQueryToMonitor(query, &success);
-                if (success) {
-                    result.append(monitor);
-                }
-            }
-
-            if (!success) {
-                result.clear();
-            }
-        } else {
-            logWrite(
-                QString("Failed SELECT - Monitors::getMonitorsUnderSchemeHostPath: %1").arg(query.lastError().text()),
-                true
-            );
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database - Monitors::getMonitorsUnderSchemeHostPath: %1")
-            .arg(database.lastError().text()),
-            true
-        );
-    }
-
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+    return currentCatalog->snapshot(threadId)->monitorsUnderHostScheme(hostSchemeId);
 }
 
 
 Monitors::MonitorsById Monitors::getMonitorsById(unsigned threadId) const {
-    MonitorsById result;
-
-    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
-    bool success = database.isOpen();
-    if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
-
-        QString queryString = QString("SELECT * FROM monitor");
-        success = query.exec(queryString);
-        if (success) {
-            while (success && query.next()) {
-                Monitor monitor = convertQueryToMonitor(query, &success);
-                if (success) {
-                    result.insert(monitor.monitorId(), monitor);
-                }
-            }
-
-            if (!success) {
-                result.clear();
-            }
-        } else {
-            logWrite(QString("Failed SELECT - Monitors::getMonitorsById: %1").arg(query.lastError().text()), true);
-        }
-    } else {
-        logWrite(
-            QString("Failed to open database - Monitors::getMonitorsById: %1").arg(database.lastError().text()),
-            true
-        );
-    }
-
-    currentDatabaseManager->closeAndRelease(database);
-    return result;
+    return currentCatalog->snapshot(threadId)->monitorsById();
 }
 
 
@@ -320,11 +141,15 @@ Monitor Monitors::createMonitor(
     ) {
     Monitor result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Monitors::createMonitor")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
-        QSqlQuery query(database);
-
         QString queryString  = QString(
             "INSERT INTO monitor("
                 "customer_id,"
@@ -351,25 +176,29 @@ Monitor Monitors::createMonitor(
             ")"
         );
 
-        query.prepare(queryString);
-        query.bindValue(":customer_id", customerId);
-        query.bindValue(":host_scheme_id", hostSchemeId);
-        query.bindValue(":user_ordering", userOrdering);
-        query.bindValue(":path", path);
-        query.bindValue(":method", Monitor::toString(method));
-        query.bindValue(":content_check_mode", Monitor::toString(contentCheckMode));
-        query.bindValue(":keywords", qCompress(Monitor::toByteArray(keywords)));
-        query.bindValue(":post_content_type", Monitor::toString(contentType));
-        query.bindValue(":post_user_agent", userAgent);
-        query.bindValue(":post_content", qCompress(postContent));
-
-        success = query.exec();
+        QSqlQuery query = currentDatabaseManager->preparedQuery(database, queryString, &success);
+        if (success) {
+            query.bindValue(":customer_id", customerId);
+            query.bindValue(":host_scheme_id", hostSchemeId);
+            query.bindValue(":user_ordering", userOrdering);
+            query.bindValue(":path", path);
+            query.bindValue(":method", Monitor::toString(method));
+            query.bindValue(":content_check_mode", Monitor::toString(contentCheckMode));
+            query.bindValue(":keywords", qCompress(Monitor::toByteArray(keywords)));
+            query.bindValue(":post_content_type", Monitor::toString(contentType));
+            query.bindValue(":post_user_agent", userAgent);
+            query.bindValue(":post_content", qCompress(postContent));
+
+            success = SqlHelpers::execute(query);
+        }
+
         if (success) {
             QVariant monitorIdVariant = query.lastInsertId();
             if (monitorIdVariant.isValid()) {
                 unsigned unsignedMonitorId = monitorIdVariant.toUInt(&success);
                 if (success) {
                     MonitorId monitorId = static_cast<MonitorId>(unsignedMonitorId);
+                    currentIdRegistry->addMonitor(monitorId);
 
                     result = Monitor(
                         monitorId,
@@ -384,6 +213,8 @@ Monitor Monitors::createMonitor(
                         userAgent,
                         postContent
                     );
+
+                    currentCatalog->updateMonitor(result);
                 } else {
                     logWrite(QString("Invalid monitor ID, not integer- Monitors::createMonitor: "), true);
                 }
@@ -409,11 +240,15 @@ Monitor Monitors::createMonitor(
 
 
 bool Monitors::modifyMonitor(const Monitor& monitor, unsigned threadId) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Monitors::modifyMonitor")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
-        QSqlQuery query(database);
-
         QString queryString  = QString(
             "UPDATE monitor SET "
                 "customer_id = :customer_id, "
@@ -429,21 +264,26 @@ bool Monitors::modifyMonitor(const Monitor& monitor, unsigned threadId) {
             "WHERE monitor_id = :monitor_id"
         );
 
-        query.prepare(queryString);
-        query.bindValue(":monitor_id", monitor.monitorId());
-        query.bindValue(":customer_id", monitor.customerId());
-        query.bindValue(":host_scheme_id", monitor.hostSchemeId());
-        query.bindValue(":user_ordering", monitor.userOrdering());
-        query.bindValue(":path", monitor.path());
-        query.bindValue(":method", Monitor::toString(monitor.method()));
-        query.bindValue(":content_check_mode", Monitor::toString(monitor.contentCheckMode()));
-        query.bindValue(":keywords", qCompress(Monitor::toByteArray(monitor.keywords())));
-        query.bindValue(":post_content_type", Monitor::toString(monitor.contentType()));
-        query.bindValue(":post_user_agent", monitor.userAgent());
-        query.bindValue(":post_content", qCompress(monitor.postContent()));
-
-        success = query.exec();
-        if (!success) {
+        QSqlQuery query = currentDatabaseManager->preparedQuery(database, queryString, &success);
+        if (success) {
+            query.bindValue(":monitor_id", monitor.monitorId());
+            query.bindValue(":customer_id", monitor.customerId());
+            query.bindValue(":host_scheme_id", monitor.hostSchemeId());
+            query.bindValue(":user_ordering", monitor.userOrdering());
+            query.bindValue(":path", monitor.path());
+            query.bindValue(":method", Monitor::toString(monitor.method()));
+            query.bindValue(":content_check_mode", Monitor::toString(monitor.contentCheckMode()));
+            query.bindValue(":keywords", qCompress(monitor.keywordBlob()));
+            query.bindValue(":post_content_type", Monitor::toString(monitor.contentType()));
+            query.bindValue(":post_user_agent", monitor.userAgent());
+            query.bindValue(":post_content", monitor.compressedPostContent());
+
+            success = SqlHelpers::execute(query);
+        }
+
+        if (success) {
+            currentCatalog->updateMonitor(monitor);
+        } else {
             logWrite(
                 QString("Failed UPDATE - Monitors::modifyMonitor: %1").arg(query.lastError().text()),
                 true
@@ -462,14 +302,23 @@ bool Monitors::modifyMonitor(const Monitor& monitor, unsigned threadId) {
 
 
 bool Monitors::deleteMonitor(const Monitor& monitor, unsigned threadId) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Monitors::deleteMonitor")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
         QSqlQuery query(database);
 
         QString queryString = QString("DELETE FROM monitor WHERE monitor_id = %1").arg(monitor.monitorId());
-        success = query.exec(queryString);
-        if (!success) {
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            currentIdRegistry->removeMonitor(monitor.monitorId());
+            currentCatalog->removeMonitor(monitor.monitorId());
+        } else {
             logWrite(
                 QString("Failed DELETE - Monitors::deleteMonitor: %1").arg(query.lastError().text()),
                 true
@@ -494,8 +343,11 @@ bool Monitors::deleteMonitors(Monitors::CustomerId customerId, unsigned threadId
         QSqlQuery query(database);
 
         QString queryString = QString("DELETE FROM monitor WHERE customer_id = %1").arg(customerId);
-        success = query.exec(queryString);
-        if (!success) {
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            currentIdRegistry->invalidate();
+            currentCatalog->removeCustomerMonitors(customerId);
+        } else {
             logWrite(
                 QString("Failed DELETE - Monitors::deleteMonitors: %1").arg(query.lastError().text()),
                 true
@@ -513,21 +365,278 @@ bool Monitors::deleteMonitors(Monitors::CustomerId customerId, unsigned threadId
 }
 
 
+bool Monitors::insertMonitors(
+        QSqlDatabase&                database,
+        const Monitors::MonitorList& monitors,
+        Monitors::MonitorList&       insertedMonitors
+    ) const {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Monitors::insertMonitors")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool          success       = true;
+    unsigned long numberEntries = static_cast<unsigned long>(monitors.size());
+    unsigned long index         = 0;
+    while (success && index < numberEntries) {
+        unsigned long numberRows  = std::min(numberEntries - index, maximumMonitorsPerStatement);
+        QString       queryString = QString(
+            "INSERT INTO monitor("
+                "customer_id,"
+                "host_scheme_id,"
+                "user_ordering,"
+                "path,"
+                "method,"
+                "content_check_mode,"
+                "keywords,"
+                "post_content_type,"
+                "post_user_agent,"
+                "post_content"
+            ") VALUES "
+        );
+
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            queryString += QString("%1(?, ?, ?, ?, ?, ?, ?, ?, ?, ?)").arg(row == 0 ? "" : ", ");
+        }
+
+        // PostgreSQL returns the generated monitor IDs in the order the rows were supplied.
+        queryString += QString(" RETURNING monitor_id");
+
+        success = query.prepare(queryString);
+        if (success) {
+            for (unsigned long row=0 ; row<numberRows ; ++row) {
+                const Monitor& monitor = monitors.at(index + row);
+                query.addBindValue(monitor.customerId());
+                query.addBindValue(monitor.hostSchemeId());
+                query.addBindValue(monitor.userOrdering());
+                query.addBindValue(monitor.path());
+                query.addBindValue(Monitor::toString(monitor.method()));
+                query.addBindValue(Monitor::toString(monitor.contentCheckMode()));
+                query.addBindValue(qCompress(monitor.keywordBlob()));
+                query.addBindValue(Monitor::toString(monitor.contentType()));
+                query.addBindValue(monitor.userAgent());
+                query.addBindValue(monitor.compressedPostContent());
+            }
+
+            success = SqlHelpers::execute(query);
+            if (success) {
+                unsigned long row = 0;
+                while (success && query.next()) {
+                    MonitorId monitorId = static_cast<MonitorId>(query.value(0).toUInt(&success));
+                    if (success && row < numberRows) {
+                        Monitor insertedMonitor = monitors.at(index + row);
+                        insertedMonitor.currentMonitorId = monitorId;
+
+                        insertedMonitors.append(insertedMonitor);
+
+                        ++row;
+                    } else {
+                        logWrite(QString("Invalid monitor ID - Monitors::insertMonitors"), true);
+                        success = false;
+                    }
+                }
+
+                index += numberRows;
+                if (success && static_cast<unsigned long>(insertedMonitors.size()) != index) {
+                    logWrite(QString("Failed to obtain monitor IDs - Monitors::insertMonitors"), true);
+                    success = false;
+                }
+            } else {
+                logWrite(
+                    QString("Failed INSERT (exec) - Monitors::insertMonitors: %1").arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed INSERT (prepare) - Monitors::insertMonitors: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+    }
+
+    return success;
+}
+
+
+bool Monitors::updateMonitors(QSqlDatabase& database, const Monitors::MonitorList& monitors) const {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Monitors::updateMonitors")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool          success       = true;
+    unsigned long numberEntries = static_cast<unsigned long>(monitors.size());
+    unsigned long index         = 0;
+    while (success && index < numberEntries) {
+        unsigned long numberRows  = std::min(numberEntries - index, maximumMonitorsPerStatement);
+        QString       queryString = QString(
+            "UPDATE monitor SET "
+                "user_ordering = v.user_ordering, "
+                "path = v.path, "
+                "method = v.method, "
+                "content_check_mode = v.content_check_mode, "
+                "keywords = v.keywords, "
+                "post_content_type = v.post_content_type, "
+                "post_user_agent = v.post_user_agent, "
+                "post_content = v.post_content "
+            "FROM (VALUES "
+        );
+
+        // Bound values arrive untyped so each column is cast to the type of the column it updates.
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            queryString += QString(
+                "%1("
+                    "?::INTEGER, "
+                    "?::SMALLINT, "
+                    "?::TEXT, "
+                    "?::monitor_method, "
+                    "?::monitor_content_check_mode, "
+                    "?::BYTEA, "
+                    "?::monitor_post_content_type, "
+                    "?::VARCHAR, "
+                    "?::BYTEA"
+                ")"
+            ).arg(row == 0 ? "" : ", ");
+        }
+
+        queryString += QString(
+            ") AS v("
+                "monitor_id,"
+                "user_ordering,"
+                "path,"
+                "method,"
+                "content_check_mode,"
+                "keywords,"
+                "post_content_type,"
+                "post_user_agent,"
+                "post_content"
+            ") "
+            "WHERE monitor.monitor_id = v.monitor_id"
+        );
+
+        success = query.prepare(queryString);
+        if (success) {
+            for (unsigned long row=0 ; row<numberRows ; ++row) {
+                const Monitor& monitor = monitors.at(index + row);
+                query.addBindValue(monitor.monitorId());
+                query.addBindValue(monitor.userOrdering());
+                query.addBindValue(monitor.path());
+                query.addBindValue(Monitor::toString(monitor.method()));
+                query.addBindValue(Monitor::toString(monitor.contentCheckMode()));
+                query.addBindValue(qCompress(monitor.keywordBlob()));
+                query.addBindValue(Monitor::toString(monitor.contentType()));
+                query.addBindValue(monitor.userAgent());
+                query.addBindValue(monitor.compressedPostContent());
+            }
+
+            success = SqlHelpers::execute(query);
+            if (!success) {
+                logWrite(
+                    QString("Failed UPDATE (exec) - Monitors::updateMonitors: %1").arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed UPDATE (prepare) - Monitors::updateMonitors: %1").arg(query.lastError().text()),
+                true
+            );
+        }
+
+        index += numberRows;
+    }
+
+    return success;
+}
+
+
+bool Monitors::removeMonitors(QSqlDatabase& database, const QList<Monitors::MonitorId>& monitorIds) const {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Monitors::removeMonitors")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    QSqlQuery query(database);
+
+    bool          success       = true;
+    unsigned long numberEntries = static_cast<unsigned long>(monitorIds.size());
+    unsigned long index         = 0;
+    while (success && index < numberEntries) {
+        unsigned long numberRows = std::min(numberEntries - index, maximumMonitorsPerStatement);
+        QStringList   idStrings;
+        for (unsigned long row=0 ; row<numberRows ; ++row) {
+            idStrings.append(QString::number(monitorIds.at(index + row)));
+        }
+
+        QString queryString = QString("DELETE FROM monitor WHERE monitor_id IN (%1)").arg(idStrings.join(","));
+        success = SqlHelpers::execute(query, queryString);
+        if (!success) {
+            logWrite(QString("Failed DELETE - Monitors::removeMonitors: %1").arg(query.lastError().text()), true);
+        }
+
+        index += numberRows;
+    }
+
+    return success;
+}
+
+
+void Monitors::commitMonitors(
+        const Monitors::MonitorList&      insertedMonitors,
+        const Monitors::MonitorList&      updatedMonitors,
+        const QList<Monitors::MonitorId>& removedMonitorIds
+    ) {
+    for (  MonitorList::const_iterator it  = insertedMonitors.constBegin(),
+                                       end = insertedMonitors.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        currentIdRegistry->addMonitor(it->monitorId());
+        currentCatalog->updateMonitor(*it);
+    }
+
+    for (  MonitorList::const_iterator it  = updatedMonitors.constBegin(),
+                                       end = updatedMonitors.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        currentCatalog->updateMonitor(*it);
+    }
+
+    for (  QList<MonitorId>::const_iterator it  = removedMonitorIds.constBegin(),
+                                            end = removedMonitorIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        currentIdRegistry->removeMonitor(*it);
+        currentCatalog->removeMonitor(*it);
+    }
+}
+
+
 Monitor Monitors::convertQueryToMonitor(const QSqlQuery& sqlQuery, bool* success) {
     Monitor result;
     bool    ok = true;
 
-    int monitorIdField        = sqlQuery.record().indexOf("monitor_id");
-    int customerIdField       = sqlQuery.record().indexOf("customer_id");
-    int hostSchemeIdField     = sqlQuery.record().indexOf("host_scheme_id");
-    int userOrderingField     = sqlQuery.record().indexOf("user_ordering");
-    int pathField             = sqlQuery.record().indexOf("path");
-    int methodField           = sqlQuery.record().indexOf("method");
-    int contentCheckModeField = sqlQuery.record().indexOf("content_check_mode");
-    int keywordsField         = sqlQuery.record().indexOf("keywords");
-    int postContentTypeField  = sqlQuery.record().indexOf("post_content_type");
-    int postUserAgentField    = sqlQuery.record().indexOf("post_user_agent");
-    int postContentField      = sqlQuery.record().indexOf("post_content");
+    QSqlRecord record                = sqlQuery.record();
+    int        monitorIdField        = record.indexOf("monitor_id");
+    int        customerIdField       = record.indexOf("customer_id");
+    int        hostSchemeIdField     = record.indexOf("host_scheme_id");
+    int        userOrderingField     = record.indexOf("user_ordering");
+    int        pathField             = record.indexOf("path");
+    int        methodField           = record.indexOf("method");
+    int        contentCheckModeField = record.indexOf("content_check_mode");
+    int        keywordsField         = record.indexOf("keywords");
+    int        postContentTypeField  = record.indexOf("post_content_type");
+    int        postUserAgentField    = record.indexOf("post_user_agent");
+    int        postContentField      = record.indexOf("post_content");
 
     if (monitorIdField >= 0        &&
         customerIdField >= 0       &&
@@ -543,14 +652,14 @@ Monitor Monitors::convertQueryToMonitor(const QSqlQuery& sqlQuery, bool* success
         QString          path             = sqlQuery.value(pathField).toString();
         QString          postUserAgent    = sqlQuery.value(postUserAgentField).toString();
         MonitorId        monitorId        = sqlQuery.value(monitorIdField).toUInt(&ok);
-        QByteArray       postContent      = qUncompress(sqlQuery.value(postContentField).toByteArray());
+        QByteArray       postContent      = sqlQuery.value(postContentField).toByteArray();
         CustomerId       customerId       = invalidCustomerId;
         HostSchemeId     hostSchemeId     = invalidHostSchemeId;
         UserOrdering     userOrdering     = 0;
         Method           method           = Method::GET;
         ContentCheckMode contentCheckMode = ContentCheckMode::NO_CHECK;
         ContentType      postContentType  = ContentType::TEXT;
-        KeywordList      keywords;
+        QByteArray       keywordBlob;
 
         if (ok) {
             customerId = sqlQuery.value(customerIdField).toUInt(&ok);
@@ -582,10 +691,14 @@ Monitor Monitors::convertQueryToMonitor(const QSqlQuery& sqlQuery, bool* success
         }
 
         if (ok) {
-            keywords = Monitor::toKeywordList(qUncompress(sqlQuery.value(keywordsField).toByteArray()), &ok);
+            keywordBlob = qUncompress(sqlQuery.value(keywordsField).toByteArray());
+            ok          = Monitor::isValidKeywordBlob(keywordBlob);
         }
 
         if (ok) {
+            // The keyword blob and compressed POST content are adopted as stored rather than being decoded and
+            // re-encoded.
+
             result = Monitor(
                 monitorId,
                 customerId,
@@ -594,11 +707,14 @@ Monitor Monitors::convertQueryToMonitor(const QSqlQuery& sqlQuery, bool* success
                 path,
                 method,
                 contentCheckMode,
-                keywords,
+                KeywordList(),
                 postContentType,
                 postUserAgent,
-                postContent
+                QByteArray()
             );
+
+            result.currentKeywords = keywordBlob;
+            result.setCompressedPostContent(postContent);
         }
     }
 
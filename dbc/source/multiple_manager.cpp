@@ -25,14 +25,16 @@
 #include <QJsonArray>
 #include <QJsonValue>
 
+#include <rest_api_in_v1_response.h>
+#include <rest_api_in_v1_binary_response.h>
 #include <rest_api_in_v1_json_response.h>
 #include <rest_api_in_v1_inesonic_rest_handler.h>
+#include <rest_api_in_v1_inesonic_binary_rest_handler.h>
 
 #include "log.h"
-#include "host_schemes.h"
-#include "monitors.h"
-#include "events.h"
+#include "dashboard_cache.h"
 #include "latency_plotter.h"
+#include "response_compressor.h"
 #include "rest_helpers.h"
 #include "multiple_manager.h"
 
@@ -41,86 +43,61 @@
 */
 
 MultipleManager::MultipleList::MultipleList(
-        const QByteArray& secret,
-        HostSchemes*      hostSchemeDatabaseApi,
-        Monitors*         monitorDatabaseApi,
-        Events*           eventDatabaseApi
-    ):RestApiInV1::InesonicRestHandler(
+        const QByteArray&   secret,
+        DashboardCache*     dashboardCache,
+        ResponseCompressor* responseCompressor
+    ):RestApiInV1::InesonicBinaryRestHandler(
         secret
-    ),currentHostSchemes(
-        hostSchemeDatabaseApi
-    ),currentMonitors(
-        monitorDatabaseApi
-    ),currentEvents(
-        eventDatabaseApi
+    ),currentDashboardCache(
+        dashboardCache
+    ),currentResponseCompressor(
+        responseCompressor
     ) {}
 
 
 MultipleManager::MultipleList::~MultipleList() {}
 
 
-RestApiInV1::JsonResponse MultipleManager::MultipleList::processAuthenticatedRequest(
-        const QString&       /* path */,
-        const QJsonDocument& request,
-        unsigned             threadId
+RestApiInV1::Response* MultipleManager::MultipleList::processAuthenticatedRequest(
+        const QString&    /* path */,
+        const QByteArray& request,
+        unsigned          threadId
     ) {
-    RestApiInV1::JsonResponse response(StatusCode::BAD_REQUEST);
+    RestApiInV1::Response* response = nullptr;
 
-    if (request.isObject()) {
-        QJsonObject requestObject = request.object();
+    QJsonDocument document = QJsonDocument::fromJson(request);
+    if (document.isObject()) {
+        QJsonObject requestObject = document.object();
         if (requestObject.contains("customer_id")) {
-            QJsonObject responseObject;
+            ResponseCompressor::Encoding encoding = ResponseCompressor::selectEncoding(
+                requestObject.value("accept_encoding").toString()
+            );
 
-            double customerIdDouble = requestObject.value("customer_id").toDouble(-1);
+            QByteArray jsonData;
+            double     customerIdDouble = requestObject.value("customer_id").toDouble(-1);
             if (customerIdDouble >= 1 && customerIdDouble <= 0xFFFFFFFF) {
                 CustomerCapabilities::CustomerId customerId = static_cast<CustomerCapabilities::CustomerId>(
                     customerIdDouble
                 );
 
-                HostSchemes::HostSchemeHash customerHostSchemes = currentHostSchemes->getHostSchemes(
-                    static_cast<HostSchemes::CustomerId>(customerId),
-                    threadId
-                );
-
-                Monitors::MonitorList monitors = currentMonitors->getMonitorsByUserOrder(
-                    static_cast<CustomerCapabilities::CustomerId>(customerId),
-                    threadId
-                );
-
-                Events::MonitorStatusByMonitorId monitorStatusMultiple = currentEvents->monitorStatusByCustomerId(
-                    static_cast<CustomerCapabilities::CustomerId>(customerId),
-                    threadId
-                );
-
-                Events::EventList events = currentEvents->getEventsByCustomer(
-                    static_cast<CustomerCapabilities::CustomerId>(customerId),
-                    0,
-                    static_cast<unsigned long long>(-1),
-                    threadId
-                );
-
-                QJsonObject statusObject;
-                for (  Events::MonitorStatusByMonitorId::const_iterator it  = monitorStatusMultiple.constBegin(),
-                                                                        end = monitorStatusMultiple.constEnd()
-                     ; it != end
-                     ; ++it
-                    ) {
-                    statusObject.insert(QString::number(it.key()), Monitor::toString(it.value()).toLower());
-                }
-
-                responseObject.insert("status", "OK");
-                responseObject.insert("host_schemes", convertToJson(customerHostSchemes, false));
-                responseObject.insert("monitors", convertToJson(monitors, false));
-                responseObject.insert("events", convertToJson(events, false, false));
-                responseObject.insert("monitor_status", statusObject);
+                jsonData = currentDashboardCache->dashboard(customerId, threadId);
             } else {
+                QJsonObject responseObject;
                 responseObject.insert("status", "failed");
+                jsonData = QJsonDocument(responseObject).toJson(QJsonDocument::Compact);
             }
 
-            response = RestApiInV1::JsonResponse(responseObject);
+            QByteArray contentType("application/json");
+            QByteArray data = currentResponseCompressor->compress(encoding, contentType, jsonData);
+
+            response = new RestApiInV1::BinaryResponse(contentType, data);
         }
     }
 
+    if (response == nullptr) {
+        response = new RestApiInV1::BinaryResponse(StatusCode::BAD_REQUEST);
+    }
+
     return response;
 }
 
@@ -132,19 +109,17 @@ const QString MultipleManager::multipleListPath("/multiple/list");
 
 MultipleManager::MultipleManager(
         RestApiInV1::Server* restApiServer,
-        HostSchemes*         hostSchemeDatabaseApi,
-        Monitors*            monitorDatabaseApi,
-        Events*              eventDatabaseApi,
+        DashboardCache*      dashboardCache,
         LatencyPlotter*      /* latencyPlotter */,
+        ResponseCompressor*  responseCompressor,
         const QByteArray&    secret,
         QObject*             parent
     ):QObject(
         parent
     ),multipleList(
         secret,
-        hostSchemeDatabaseApi,
-        monitorDatabaseApi,
-        eventDatabaseApi
+        dashboardCache,
+        responseCompressor
     ) {
     restApiServer->registerHandler(&multipleList, RestApiInV1::Handler::Method::POST, multipleListPath);
 }
@@ -22,7 +22,11 @@
 #include <QCoreApplication>
 #include <QUrl>
 #include <QQueue>
+#include <QList>
+#include <QHash>
 #include <QTimer>
+#include <QDateTime>
+#include <QMetaObject>
 #include <QString>
 #include <QByteArray>
 #include <QJsonDocument>
@@ -34,6 +38,7 @@
 #include <rest_api_out_v1_inesonic_rest_handler.h>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "outbound_rest_api.h"
 
 OutboundRestApi::OutboundRestApi(
@@ -47,15 +52,27 @@ OutboundRestApi::OutboundRestApi(
         authority,
         timeDeltaSlug,
         parent
+    ),currentMaximumConcurrentRequests(
+        defaultMaximumConcurrentRequests
+    ),currentMaximumBatchSize(
+        0
     ),currentPerformGarbageCollection(
         garbageCollect
+    ),reportedQueueLength(
+        0
     ) {
-    activeRequest = nullptr;
+    queueLengthMetric = MetricsRegistry::instance()->gauge(
+        QString("dbc_outbound_queue_length"),
+        QString("Number of messages queued, in flight or waiting to be retried, by destination server."),
+        MetricsRegistry::label(QString("server"), authority.host())
+    );
 
     connect(&eventTimer, &QTimer::timeout, this, &OutboundRestApi::startNextAction);
+    connect(&retryTimer, &QTimer::timeout, this, &OutboundRestApi::startTransfers);
     connect(this, &OutboundRestApi::sendMessage, this, &OutboundRestApi::processSendMessage);
 
     eventTimer.setSingleShot(true);
+    retryTimer.setSingleShot(true);
     if (garbageCollect) {
         eventTimer.start(maximumIdleTimeSeconds * 1000);
         timerAction = TimerAction::GARBAGE_COLLECTION;
@@ -65,6 +82,40 @@ OutboundRestApi::OutboundRestApi(
 }
 
 
+OutboundRestApi::~OutboundRestApi() {
+    queueLengthMetric->add(-static_cast<double>(reportedQueueLength));
+}
+
+
+void OutboundRestApi::setMaximumConcurrentRequests(unsigned newMaximumConcurrentRequests) {
+    currentMaximumConcurrentRequests = newMaximumConcurrentRequests > 0 ? newMaximumConcurrentRequests : 1;
+    startTransfers();
+}
+
+
+unsigned OutboundRestApi::maximumConcurrentRequests() const {
+    return currentMaximumConcurrentRequests;
+}
+
+
+void OutboundRestApi::setBatching(const QString& endpoint, const QString& batchEndpoint, unsigned maximumBatchSize) {
+    currentBatchedEndpoint  = endpoint;
+    currentBatchEndpoint    = batchEndpoint;
+    currentMaximumBatchSize = maximumBatchSize;
+}
+
+
+void OutboundRestApi::setGarbageCollection(bool enabled) {
+    currentPerformGarbageCollection = enabled;
+    if (enabled) {
+        startTransfers();
+    } else {
+        timerAction = TimerAction::NONE;
+        eventTimer.stop();
+    }
+}
+
+
 void OutboundRestApi::postMessage(const QString& endpoint, const QJsonDocument& message, const QString& logText) {
     timerAction = TimerAction::NONE;
     emit sendMessage(endpoint, message, logText, nullptr, nullptr, QString());
@@ -130,9 +181,7 @@ void OutboundRestApi::processSendMessage(
         const QString&       slot
     ) {
     pendingRequests.enqueue(Request(endpoint, message, logText, context, receiver, slot));
-    if (activeRequest == nullptr) {
-        startSend(pendingRequests.head());
-    }
+    startTransfers();
 }
 
 
@@ -142,107 +191,218 @@ void OutboundRestApi::startNextAction() {
             break;
         }
 
-        case TimerAction::RETRY: {
-            startSend((pendingRequests.head()));
+        case TimerAction::GARBAGE_COLLECTION: {
+            if (pendingRequests.isEmpty() && activeTransfers.isEmpty() && delayedTransfers.isEmpty()) {
+                emit performGarbageCollection(this);
+            }
+
             break;
         }
+    }
+}
+
 
-        case TimerAction::CLEANUP: {
-            Q_ASSERT(!pendingRequests.isEmpty());
+void OutboundRestApi::startTransfers() {
+    long long currentTime = QDateTime::currentMSecsSinceEpoch();
 
-            const Request& request   = pendingRequests.head();
-            QObject*       receiver = request.receiver();
+    QList<Transfer>::iterator delayedIterator = delayedTransfers.begin();
+    while (delayedIterator != delayedTransfers.end()                                      &&
+           static_cast<unsigned>(activeTransfers.size()) < currentMaximumConcurrentRequests    ) {
+        if (delayedIterator->retryTime() <= currentTime) {
+            Transfer transfer = *delayedIterator;
+            delayedIterator = delayedTransfers.erase(delayedIterator);
+            startSend(transfer);
+        } else {
+            ++delayedIterator;
+        }
+    }
 
-            Q_ASSERT(receiver != nullptr);
-            disconnect(this, SIGNAL(sendCallback(void*)), receiver, SLOT(sendCallback(void*)));
+    // In ordered mode a transfer waiting to be retried holds its slot so later messages can not overtake it.
+    unsigned numberOutstanding = static_cast<unsigned>(activeTransfers.size());
+    if (currentMaximumConcurrentRequests == 1) {
+        numberOutstanding += static_cast<unsigned>(delayedTransfers.size());
+    }
 
-            startNext();
+    while (numberOutstanding < currentMaximumConcurrentRequests && !pendingRequests.isEmpty()) {
+        startSend(nextTransfer());
+        ++numberOutstanding;
+    }
 
-            break;
+    long long nextRetryTime = 0;
+    for (  QList<Transfer>::const_iterator it  = delayedTransfers.constBegin(),
+                                           end = delayedTransfers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        long long retryTime = it->retryTime();
+        if (retryTime > currentTime && (nextRetryTime == 0 || retryTime < nextRetryTime)) {
+            nextRetryTime = retryTime;
         }
+    }
 
-        case TimerAction::GARBAGE_COLLECTION: {
-            Q_ASSERT(pendingRequests.isEmpty());
-            emit performGarbageCollection(this);
-            break;
+    if (nextRetryTime != 0) {
+        retryTimer.start(static_cast<int>(nextRetryTime - currentTime));
+    } else {
+        retryTimer.stop();
+    }
+
+    updateQueueLengthMetric();
+
+    if (pendingRequests.isEmpty() && activeTransfers.isEmpty() && delayedTransfers.isEmpty()) {
+        if (currentPerformGarbageCollection) {
+            timerAction = TimerAction::GARBAGE_COLLECTION;
+            eventTimer.start(maximumIdleTimeSeconds * 1000);
+        } else {
+            timerAction = TimerAction::NONE;
         }
     }
 }
 
 
 void OutboundRestApi::jsonResponse(const QJsonDocument& jsonData) {
-    const Request& request = pendingRequests.head();
+    RestApiOutV1::InesonicRestHandler* handler = qobject_cast<RestApiOutV1::InesonicRestHandler*>(sender());
+    QHash<RestApiOutV1::InesonicRestHandler*, Transfer>::iterator transferIterator = activeTransfers.find(handler);
+    if (transferIterator != activeTransfers.end()) {
+        Transfer transfer = transferIterator.value();
+        activeTransfers.erase(transferIterator);
+
+        bool statusOk = false;
+        if (jsonData.isObject()) {
+            QJsonObject object = jsonData.object();
+            QString     status = object.value("status").toString();
+            statusOk = (status == QString("OK"));
+        }
+
+        const RequestList& requests = transfer.requests();
+        for (RequestList::const_iterator it=requests.constBegin(),end=requests.constEnd() ; it!=end ; ++it) {
+            QObject* receiver = it->receiver();
+            if (receiver != nullptr) {
+                // Slots are supplied using the SLOT macro, "1name(arguments)".  Slots taking a QJsonDocument also
+                // receive the server's response.
+                const QString& slot        = it->slot();
+                int            parenIndex  = slot.indexOf(QChar('('));
+                QByteArray     slotName    =   parenIndex > 1
+                                             ? slot.mid(1, parenIndex - 1).toLatin1()
+                                             : QByteArray("sendCallback");
+
+                if (slot.contains(QString("QJsonDocument"))) {
+                    QMetaObject::invokeMethod(
+                        receiver,
+                        slotName.constData(),
+                        Q_ARG(void*, it->context()),
+                        Q_ARG(QJsonDocument, jsonData)
+                    );
+                } else {
+                    QMetaObject::invokeMethod(receiver, slotName.constData(), Q_ARG(void*, it->context()));
+                }
+            }
+
+            if (statusOk) {
+                logWrite(
+                    QString("Sent message to %1%2: %3")
+                    .arg(schemeAndHost().toString(), transfer.endpoint(), it->logText()),
+                    false
+                );
+            }
+        }
+
+        handler->deleteLater();
+    }
+
+    startTransfers();
+}
 
-    QObject* receiver = request.receiver();
-    if (receiver != nullptr) {
-        connect(this, SIGNAL(sendCallback(void*)), receiver, SLOT(sendCallback(void*)));
-        timerAction = TimerAction::CLEANUP;
-        eventTimer.start(10); // Give 10mSec for the event to propagate.
 
-        emit sendCallback(request.context());
+void OutboundRestApi::requestFailed(const QString& errorString) {
+    RestApiOutV1::InesonicRestHandler* handler = qobject_cast<RestApiOutV1::InesonicRestHandler*>(sender());
+    QHash<RestApiOutV1::InesonicRestHandler*, Transfer>::iterator transferIterator = activeTransfers.find(handler);
+    if (transferIterator != activeTransfers.end()) {
+        Transfer transfer = transferIterator.value();
+        activeTransfers.erase(transferIterator);
+
+        unsigned delay = retryDelay(transfer.numberFailures() + 1);
+        logWrite(
+            QString("Failed to send to %1%2:%3 -- Retrying in %4 seconds.")
+            .arg(schemeAndHost().toString(), transfer.endpoint(), errorString)
+            .arg(delay),
+            true
+        );
+
+        transfer.failed(QDateTime::currentMSecsSinceEpoch() + 1000LL * delay);
+        delayedTransfers.append(transfer);
+
+        handler->deleteLater();
     }
 
-    if (jsonData.isObject()) {
-        QJsonObject object = jsonData.object();
-        QString     status = object.value("status").toString();
-        if (status == QString("OK")) {
-            logWrite(
-                QString("Sent message to %1%2: %3")
-                .arg(schemeAndHost().toString(), request.endpoint(), request.logText()),
-                false
-            );
+    startTransfers();
+}
+
+
+OutboundRestApi::Transfer OutboundRestApi::nextTransfer() {
+    Request     request = pendingRequests.dequeue();
+    RequestList requests;
+    requests.append(request);
+
+    if (currentMaximumBatchSize > 1                  &&
+        request.endpoint() == currentBatchedEndpoint &&
+        request.receiver() == nullptr                   ) {
+        while (static_cast<unsigned>(requests.size()) < currentMaximumBatchSize &&
+               !pendingRequests.isEmpty()                                       &&
+               pendingRequests.head().endpoint() == currentBatchedEndpoint      &&
+               pendingRequests.head().receiver() == nullptr                        ) {
+            requests.append(pendingRequests.dequeue());
         }
     }
 
-    activeRequest->deleteLater();
-    if (receiver == nullptr) {
-        startNext();
+    Transfer result;
+    if (requests.size() > 1) {
+        QJsonArray messages;
+        for (RequestList::const_iterator it=requests.constBegin(),end=requests.constEnd() ; it!=end ; ++it) {
+            const QJsonDocument& message = it->message();
+            if (message.isArray()) {
+                messages.append(message.array());
+            } else {
+                messages.append(message.object());
+            }
+        }
+
+        result = Transfer(requests, currentBatchEndpoint, QJsonDocument(messages));
     } else {
-        activeRequest = nullptr;
+        result = Transfer(requests, request.endpoint(), request.message());
     }
+
+    return result;
 }
 
 
-void OutboundRestApi::requestFailed(const QString& errorString) {
-    const Request& request = pendingRequests.head();
-    logWrite(
-        QString("Failed to send to %1%2:%3 -- Retrying in %4 seconds.")
-        .arg(schemeAndHost().toString(), request.endpoint(), errorString)
-        .arg(retryInterval),
-        true
-    );
+void OutboundRestApi::startSend(const OutboundRestApi::Transfer& transfer) {
+    RestApiOutV1::InesonicRestHandler* handler = new RestApiOutV1::InesonicRestHandler(this, this);
 
-    timerAction = TimerAction::RETRY;
-    eventTimer.start(retryInterval * 1000);
+    connect(handler, &RestApiOutV1::InesonicRestHandler::jsonResponse, this, &OutboundRestApi::jsonResponse);
+    connect(handler, &RestApiOutV1::InesonicRestHandler::requestFailed, this, &OutboundRestApi::requestFailed);
 
-    activeRequest->deleteLater();
-    activeRequest = nullptr;
+    activeTransfers.insert(handler, transfer);
+    handler->post(transfer.endpoint(), transfer.message());
 }
 
 
-void OutboundRestApi::startSend(const OutboundRestApi::Request& request) {
-    activeRequest = new RestApiOutV1::InesonicRestHandler(this, this);
-
-    connect(activeRequest, &RestApiOutV1::InesonicRestHandler::jsonResponse, this, &OutboundRestApi::jsonResponse);
-    connect(activeRequest, &RestApiOutV1::InesonicRestHandler::requestFailed, this, &OutboundRestApi::requestFailed);
+unsigned OutboundRestApi::retryDelay(unsigned numberFailures) {
+    unsigned result = retryInterval;
+    for (unsigned i=1 ; i<numberFailures && result<maximumRetryInterval ; ++i) {
+        result *= 2;
+    }
 
-    activeRequest->post(request.endpoint(), request.message());
+    return result < maximumRetryInterval ? result : maximumRetryInterval;
 }
 
 
-void OutboundRestApi::startNext() {
-    pendingRequests.dequeue();
-
-    if (!pendingRequests.isEmpty()) {
-        startSend(pendingRequests.head());
-    } else {
-        activeRequest = nullptr;
+void OutboundRestApi::updateQueueLengthMetric() {
+    unsigned queueLength = static_cast<unsigned>(
+        pendingRequests.size() + activeTransfers.size() + delayedTransfers.size()
+    );
 
-        if (currentPerformGarbageCollection) {
-            timerAction = TimerAction::GARBAGE_COLLECTION;
-            eventTimer.start(maximumIdleTimeSeconds * 1000);
-        } else {
-            timerAction = TimerAction::NONE;
-        }
+    if (queueLength != reportedQueueLength) {
+        queueLengthMetric->add(static_cast<double>(queueLength) - static_cast<double>(reportedQueueLength));
+        reportedQueueLength = queueLength;
     }
 }
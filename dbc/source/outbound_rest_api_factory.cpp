@@ -26,6 +26,7 @@
 #include <QByteArray>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QElapsedTimer>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -63,12 +64,11 @@ OutboundRestApiFactory::OutboundRestApiFactory(
         RestApiOutV1::Server::defaultUserAgent
     ) {
     connect(this, &OutboundRestApiFactory::postMessageRequested, this, &OutboundRestApiFactory::performPostMessage);
+    connect(this, &OutboundRestApiFactory::fanOutRequested, this, &OutboundRestApiFactory::performFanOut);
+    connect(this, &OutboundRestApiFactory::releaseRequested, this, &OutboundRestApiFactory::performRelease);
 }
 
 
-OutboundRestApi::~OutboundRestApi() {}
-
-
 void OutboundRestApiFactory::setDefaultSecret(const QByteArray& newDefaultSecret) {
     currentDefaultSecret = newDefaultSecret;
 }
@@ -186,6 +186,22 @@ void OutboundRestApiFactory::postMessage(
 }
 
 
+void OutboundRestApiFactory::postMessages(
+        const OutboundRestApiFactory::MessagesByServerIdentifier& messages,
+        const QString&                                            endpoint,
+        const QString&                                            logText
+    ) {
+    if (!messages.isEmpty()) {
+        emit fanOutRequested(new FanOut(messages, endpoint, logText));
+    }
+}
+
+
+void OutboundRestApiFactory::releaseOutboundRestApi(const QString& serverIdentifier) {
+    emit releaseRequested(serverIdentifier);
+}
+
+
 void OutboundRestApiFactory::performPostMessage(
         const QString&       serverIdentifier,
         const QString&       endpoint,
@@ -210,6 +226,79 @@ void OutboundRestApiFactory::expungeOutboundRestApi(OutboundRestApi* outboundRes
 }
 
 
+void OutboundRestApiFactory::performFanOut(void* fanOut) {
+    FanOut*                           request  = reinterpret_cast<FanOut*>(fanOut);
+    const MessagesByServerIdentifier& messages = request->messages();
+
+    request->start();
+    for (  MessagesByServerIdentifier::const_iterator it  = messages.constBegin(),
+                                                      end = messages.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        const QString&   serverIdentifier = it.key();
+        OutboundRestApi* api              = outboundRestApi(serverIdentifier);
+
+        api->setGarbageCollection(false);
+        api->postMessage(
+            request->endpoint(),
+            it.value(),
+            request->logText(),
+            new FanOutTarget(request, serverIdentifier),
+            this,
+            SLOT(sendCallback(void*))
+        );
+    }
+}
+
+
+void OutboundRestApiFactory::performRelease(const QString& serverIdentifier) {
+    QMutexLocker locker(&accessMutex);
+
+    OutboundRestApi* api = outboundRestApiByServerIdentifier.value(serverIdentifier, nullptr);
+    if (api != nullptr) {
+        api->setGarbageCollection(true);
+    }
+}
+
+
+void OutboundRestApiFactory::sendCallback(void* context) {
+    FanOutTarget* target = reinterpret_cast<FanOutTarget*>(context);
+    FanOut*       fanOut = target->fanOut();
+
+    if (fanOut->completed(target->serverIdentifier())) {
+        const LatenciesByServerIdentifier& latencies = fanOut->latencies();
+
+        QString            slowestServerIdentifier;
+        unsigned long long slowestLatency = 0;
+        for (  LatenciesByServerIdentifier::const_iterator it  = latencies.constBegin(),
+                                                           end = latencies.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (slowestServerIdentifier.isEmpty() || it.value() > slowestLatency) {
+                slowestServerIdentifier = it.key();
+                slowestLatency          = it.value();
+            }
+        }
+
+        logWrite(
+            QString("Fan-out to %1 completed: %2 servers, slowest %3 in %4 mSec.")
+            .arg(fanOut->endpoint())
+            .arg(latencies.size())
+            .arg(slowestServerIdentifier)
+            .arg(slowestLatency),
+            false
+        );
+
+        emit fanOutCompleted(fanOut->endpoint(), latencies);
+        delete fanOut;
+    }
+
+    delete target;
+}
+
+
 OutboundRestApi* OutboundRestApiFactory::outboundRestApi(const QString& serverIdentifier) {
     QMutexLocker locker(&accessMutex);
 
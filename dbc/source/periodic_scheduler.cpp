@@ -0,0 +1,420 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref PeriodicScheduler class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QDateTime>
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+#include "metrics_registry.h"
+#include "periodic_scheduler.h"
+
+/***********************************************************************************************************************
+* PeriodicScheduler::TaskConfiguration
+*/
+
+PeriodicScheduler::TaskConfiguration::TaskConfiguration(
+        long           periodSeconds,
+        long           jitterSeconds,
+        const QString& group
+    ):currentPeriodSeconds(
+        periodSeconds
+    ),currentJitterSeconds(
+        jitterSeconds
+    ),currentGroup(
+        group
+    ) {}
+
+
+PeriodicScheduler::TaskConfiguration::TaskConfiguration(
+        const PeriodicScheduler::TaskConfiguration& other
+    ):currentPeriodSeconds(
+        other.currentPeriodSeconds
+    ),currentJitterSeconds(
+        other.currentJitterSeconds
+    ),currentGroup(
+        other.currentGroup
+    ) {}
+
+
+PeriodicScheduler::TaskConfiguration::~TaskConfiguration() {}
+
+
+PeriodicScheduler::TaskConfiguration& PeriodicScheduler::TaskConfiguration::operator=(
+        const PeriodicScheduler::TaskConfiguration& other
+    ) {
+    currentPeriodSeconds = other.currentPeriodSeconds;
+    currentJitterSeconds = other.currentJitterSeconds;
+    currentGroup         = other.currentGroup;
+
+    return *this;
+}
+
+/***********************************************************************************************************************
+* PeriodicScheduler
+*/
+
+const unsigned long PeriodicScheduler::groupRetrySeconds = 5;
+const QString       PeriodicScheduler::databaseMaintenanceGroup("database_maintenance");
+
+PeriodicScheduler* PeriodicScheduler::instance() {
+    // The scheduler is intentionally never destroyed so that owners can unregister tasks during process shutdown.
+    static PeriodicScheduler* scheduler = new PeriodicScheduler;
+    return scheduler;
+}
+
+
+PeriodicScheduler::TaskId PeriodicScheduler::registerTask(
+        const QString&                         name,
+        const QString&                         defaultGroup,
+        unsigned long                          defaultJitter,
+        const PeriodicScheduler::TaskFunction& function,
+        const PeriodicScheduler::BusyFunction& busyFunction
+    ) {
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    QString          labels          = MetricsRegistry::label(QString("task"), name);
+
+    Task* task = new Task;
+    task->name            = name;
+    task->defaultGroup    = defaultGroup;
+    task->defaultJitter   = defaultJitter;
+    task->ownerPeriod     = 0;
+    task->scheduledPeriod = 0;
+    task->aligned         = false;
+    task->function        = function;
+    task->busyFunction    = busyFunction;
+    task->deadline        = 0;
+    task->running         = false;
+    task->runsMetric      = metricsRegistry->counter(
+        QString("dbc_scheduler_runs_total"),
+        QString("Number of periodic task runs started."),
+        labels
+    );
+    task->deferredMetric  = metricsRegistry->counter(
+        QString("dbc_scheduler_deferred_total"),
+        QString("Number of periodic task runs deferred because the task or its group was busy."),
+        labels
+    );
+    task->durationMetric  = metricsRegistry->histogram(
+        QString("dbc_scheduler_run_seconds"),
+        QString("Time spent running periodic tasks."),
+        labels
+    );
+
+    QMutexLocker schedulerMutexLocker(&schedulerMutex);
+    TaskId taskId = nextTaskId;
+    ++nextTaskId;
+
+    currentTasks.insert(taskId, task);
+    return taskId;
+}
+
+
+void PeriodicScheduler::unregisterTask(PeriodicScheduler::TaskId taskId) {
+    QMutexLocker schedulerMutexLocker(&schedulerMutex);
+    delete currentTasks.take(taskId);
+}
+
+
+void PeriodicScheduler::setPeriod(PeriodicScheduler::TaskId taskId, unsigned long periodSeconds, bool aligned) {
+    QMutexLocker schedulerMutexLocker(&schedulerMutex);
+    Task* task = currentTasks.value(taskId, nullptr);
+    if (task != nullptr) {
+        if (task->aligned != aligned) {
+            task->aligned         = aligned;
+            task->scheduledPeriod = 0;
+        }
+
+        task->ownerPeriod = periodSeconds;
+        updateTask(taskId, *task);
+    }
+}
+
+
+unsigned long PeriodicScheduler::period(PeriodicScheduler::TaskId taskId) const {
+    unsigned long result = 0;
+
+    QMutexLocker schedulerMutexLocker(&schedulerMutex);
+    const Task* task = currentTasks.value(taskId, nullptr);
+    if (task != nullptr) {
+        result = effectivePeriod(*task);
+    }
+
+    return result;
+}
+
+
+void PeriodicScheduler::setConfiguration(const PeriodicScheduler::TaskConfigurations& configurations) {
+    QMutexLocker schedulerMutexLocker(&schedulerMutex);
+    currentConfigurations = configurations;
+
+    for (QHash<TaskId, Task*>::iterator it=currentTasks.begin(),end=currentTasks.end() ; it!=end ; ++it) {
+        updateTask(it.key(), *it.value());
+    }
+}
+
+
+PeriodicScheduler::PeriodicScheduler():QObject() {
+    nextTaskId  = invalidTaskId + 1;
+    currentTick = 0;
+    clock.start();
+
+    tickTimer = new QTimer(this);
+    tickTimer->setSingleShot(false);
+    connect(tickTimer, &QTimer::timeout, this, &PeriodicScheduler::tick);
+    tickTimer->start(tickMilliseconds);
+}
+
+
+PeriodicScheduler::~PeriodicScheduler() {
+    for (QHash<TaskId, Task*>::iterator it=currentTasks.begin(),end=currentTasks.end() ; it!=end ; ++it) {
+        delete it.value();
+    }
+}
+
+
+void PeriodicScheduler::tick() {
+    QList<TaskId> dueTasks;
+
+    schedulerMutex.lock();
+
+    // Ticks missed while the event loop was busy are caught up so that deadlines are never skipped.
+    unsigned long long targetTick = static_cast<unsigned long long>(clock.elapsed() / tickMilliseconds);
+    while (currentTick < targetTick) {
+        ++currentTick;
+        advance(dueTasks);
+    }
+
+    pollRunning();
+    schedulerMutex.unlock();
+
+    for (QList<TaskId>::const_iterator it=dueTasks.constBegin(),end=dueTasks.constEnd() ; it!=end ; ++it) {
+        runTask(*it);
+    }
+}
+
+
+void PeriodicScheduler::advance(QList<TaskId>& dueTasks) {
+    // Higher levels are cascaded first so entries they move down are picked up by the levels below on this tick.
+    unsigned highestLevel = 0;
+    bool     wrapped      = true;
+    while (wrapped && highestLevel + 1 < wheelLevels) {
+        wrapped = (currentTick & ((1ULL << (slotBits * (highestLevel + 1))) - 1)) == 0;
+        if (wrapped) {
+            ++highestLevel;
+        }
+    }
+
+    for (unsigned level=highestLevel ; level>0 ; --level) {
+        Slot entries;
+        entries.swap(wheel[level][(currentTick >> (slotBits * level)) & (slotsPerLevel - 1)]);
+
+        for (Slot::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+            insertEntry(*it);
+        }
+    }
+
+    Slot entries;
+    entries.swap(wheel[0][currentTick & (slotsPerLevel - 1)]);
+
+    for (Slot::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+        const WheelEntry& entry = *it;
+        if (entry.second > currentTick) {
+            insertEntry(entry);
+        } else {
+            Task* task = currentTasks.value(entry.first, nullptr);
+            if (task != nullptr && task->deadline == entry.second) {
+                task->deadline = 0;
+                dueTasks.append(entry.first);
+            }
+        }
+    }
+}
+
+
+void PeriodicScheduler::runTask(PeriodicScheduler::TaskId taskId) {
+    TaskFunction function;
+
+    schedulerMutex.lock();
+    Task* task = currentTasks.value(taskId, nullptr);
+    if (task != nullptr && task->deadline == 0 && effectivePeriod(*task) > 0) {
+        if (task->running || groupBusy(effectiveGroup(*task), taskId)) {
+            task->deferredMetric->increment();
+            scheduleAt(taskId, *task, currentTick + groupRetrySeconds);
+        } else {
+            task->running = true;
+            task->runClock.start();
+            task->runsMetric->increment();
+
+            scheduleNext(taskId, *task);
+            function = task->function;
+        }
+    }
+    schedulerMutex.unlock();
+
+    if (function) {
+        function();
+
+        QMutexLocker schedulerMutexLocker(&schedulerMutex);
+        task = currentTasks.value(taskId, nullptr);
+        if (task != nullptr && task->running && (!task->busyFunction || !task->busyFunction())) {
+            finishTask(*task);
+        }
+    }
+}
+
+
+void PeriodicScheduler::pollRunning() {
+    for (QHash<TaskId, Task*>::iterator it=currentTasks.begin(),end=currentTasks.end() ; it!=end ; ++it) {
+        Task* task = it.value();
+        if (task->running && task->busyFunction && !task->busyFunction()) {
+            finishTask(*task);
+        }
+    }
+}
+
+
+void PeriodicScheduler::finishTask(PeriodicScheduler::Task& task) {
+    task.running = false;
+    task.durationMetric->observe(task.runClock.elapsed() / 1000.0);
+}
+
+
+void PeriodicScheduler::updateTask(PeriodicScheduler::TaskId taskId, PeriodicScheduler::Task& task) {
+    unsigned long periodSeconds = effectivePeriod(task);
+    if (periodSeconds != task.scheduledPeriod || (periodSeconds > 0 && task.deadline == 0 && !task.running)) {
+        task.scheduledPeriod = periodSeconds;
+        if (periodSeconds > 0) {
+            scheduleNext(taskId, task);
+        } else {
+            task.deadline = 0;
+        }
+    }
+}
+
+
+void PeriodicScheduler::scheduleNext(PeriodicScheduler::TaskId taskId, PeriodicScheduler::Task& task) {
+    unsigned long periodSeconds = effectivePeriod(task);
+    unsigned long jitterSeconds = effectiveJitter(task);
+
+    unsigned long long delay;
+    if (task.aligned) {
+        unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+        delay = periodSeconds - (currentTime % periodSeconds);
+    } else {
+        delay = periodSeconds;
+    }
+
+    if (jitterSeconds > 0) {
+        delay += QRandomGenerator::global()->bounded(static_cast<quint32>(std::min(jitterSeconds, 0xFFFFFFFEUL) + 1));
+    }
+
+    task.scheduledPeriod = periodSeconds;
+    scheduleAt(taskId, task, currentTick + std::max(delay, 1ULL));
+}
+
+
+void PeriodicScheduler::scheduleAt(
+        PeriodicScheduler::TaskId taskId,
+        PeriodicScheduler::Task&  task,
+        unsigned long long        deadline
+    ) {
+    task.deadline = deadline;
+    insertEntry(WheelEntry(taskId, deadline));
+}
+
+
+void PeriodicScheduler::insertEntry(const PeriodicScheduler::WheelEntry& entry) {
+    // Entries beyond the wheel's span are parked on the top level and placed again each time that slot cascades.
+    unsigned long long horizon  = (1ULL << (slotBits * wheelLevels)) - 1;
+    unsigned long long deadline = std::max(std::min(entry.second, currentTick + horizon), currentTick + 1);
+    unsigned long long delta    = deadline - currentTick;
+
+    unsigned level = 0;
+    while (level + 1 < wheelLevels && delta >= (1ULL << (slotBits * (level + 1)))) {
+        ++level;
+    }
+
+    wheel[level][(deadline >> (slotBits * level)) & (slotsPerLevel - 1)].append(entry);
+}
+
+
+unsigned long PeriodicScheduler::effectivePeriod(const PeriodicScheduler::Task& task) const {
+    unsigned long result = task.ownerPeriod;
+
+    if (result > 0) {
+        TaskConfigurations::const_iterator configuration = currentConfigurations.constFind(task.name);
+        if (configuration != currentConfigurations.constEnd() && configuration->periodSeconds() != useDefault) {
+            result = static_cast<unsigned long>(configuration->periodSeconds());
+        }
+    }
+
+    return result;
+}
+
+
+unsigned long PeriodicScheduler::effectiveJitter(const PeriodicScheduler::Task& task) const {
+    unsigned long result = task.defaultJitter;
+
+    TaskConfigurations::const_iterator configuration = currentConfigurations.constFind(task.name);
+    if (configuration != currentConfigurations.constEnd() && configuration->jitterSeconds() != useDefault) {
+        result = static_cast<unsigned long>(configuration->jitterSeconds());
+    }
+
+    return result;
+}
+
+
+QString PeriodicScheduler::effectiveGroup(const PeriodicScheduler::Task& task) const {
+    QString result = task.defaultGroup;
+
+    TaskConfigurations::const_iterator configuration = currentConfigurations.constFind(task.name);
+    if (configuration != currentConfigurations.constEnd() && !configuration->group().isNull()) {
+        result = configuration->group();
+    }
+
+    return result;
+}
+
+
+bool PeriodicScheduler::groupBusy(const QString& group, PeriodicScheduler::TaskId taskId) const {
+    bool result = false;
+
+    if (!group.isEmpty()) {
+        for (  QHash<TaskId, Task*>::const_iterator it  = currentTasks.constBegin(),
+                                                    end = currentTasks.constEnd()
+             ; !result && it != end
+             ; ++it
+            ) {
+            result = it.value()->running && it.key() != taskId && effectiveGroup(*it.value()) == group;
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,120 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref PlotCache class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInteger>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include <cstdint>
+
+#include "concurrent_cache.h"
+#include "plot_cache.h"
+
+PlotCache::PlotCache(unsigned long maximumCacheDepth):entryCache(maximumCacheDepth) {
+    currentCacheDepth   = maximumCacheDepth;
+    underMemoryPressure = false;
+
+    averageEntryBytes.storeRelease(0);
+}
+
+
+PlotCache::~PlotCache() {}
+
+
+void PlotCache::resizeCache(unsigned long newCacheSize) {
+    QMutexLocker depthMutexLocker(&depthMutex);
+    currentCacheDepth = newCacheSize;
+    applyCacheDepth();
+}
+
+
+CacheBase::Statistics PlotCache::statistics() const {
+    return entryCache.statistics();
+}
+
+
+unsigned long long PlotCache::memoryUsage() const {
+    return entryCache.statistics().numberEntries * averageEntryBytes.loadAcquire();
+}
+
+
+void PlotCache::setMemoryPressure(bool underPressure) {
+    QMutexLocker depthMutexLocker(&depthMutex);
+    if (underPressure != underMemoryPressure) {
+        underMemoryPressure = underPressure;
+        applyCacheDepth();
+    }
+}
+
+
+void PlotCache::applyCacheDepth() {
+    entryCache.resizeCache(underMemoryPressure ? currentCacheDepth / pressureShrinkFactor : currentCacheDepth);
+}
+
+
+void PlotCache::updateAverageEntryBytes(unsigned long long entryBytes) {
+    // An exponential moving average is close enough for budgeting and needs no lock.  Concurrent updates may lose a
+    // sample.
+    quint64 average = averageEntryBytes.loadAcquire();
+    averageEntryBytes.storeRelease(average == 0 ? entryBytes : (7 * average + entryBytes) / 8);
+}
+
+
+bool PlotCache::getPlot(const QByteArray& key, unsigned long long dataVersion, PlotCache::Plot& plot) const {
+    Plot cachedPlot;
+    bool success = entryCache.getCacheEntry(keyHash(key), cachedPlot);
+
+    // The key is compared as well so that a hash collision can never serve the wrong plot.
+    if (success && cachedPlot.dataVersion == dataVersion && cachedPlot.key == key) {
+        plot = cachedPlot;
+    } else {
+        success = false;
+    }
+
+    return success;
+}
+
+
+PlotCache::Plot PlotCache::addPlot(const QByteArray& key, unsigned long long dataVersion, const QByteArray& imageData) {
+    Plot plot(key, dataVersion, imageData);
+
+    updateAverageEntryBytes(sizeof(Plot) + static_cast<unsigned long long>(key.size() + imageData.size()));
+    entryCache.addToCache(plot);
+
+    return plot;
+}
+
+
+QByteArray PlotCache::etag(const QByteArray& key, unsigned long long dataVersion) {
+    QCryptographicHash hash(QCryptographicHash::Algorithm::Sha1);
+    hash.addData(key);
+    hash.addData(QByteArray::number(dataVersion));
+
+    return hash.result().toHex();
+}
+
+
+std::uint64_t PlotCache::keyHash(const QByteArray& key) {
+    QByteArray digest = QCryptographicHash::hash(key, QCryptographicHash::Algorithm::Sha1);
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(digest.constData()));
+}
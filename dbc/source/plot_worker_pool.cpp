@@ -0,0 +1,218 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref PlotWorkerPool class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QList>
+
+#include "metrics_registry.h"
+#include "plot_mailbox.h"
+#include "thread_placement.h"
+#include "plot_worker_pool.h"
+
+const unsigned PlotWorkerPool::defaultNumberWorkers = 4;
+const unsigned PlotWorkerPool::defaultMaximumQueued = 32;
+
+/***********************************************************************************************************************
+* PlotWorkerPool::Job
+*/
+
+PlotWorkerPool::Job::Job(PlotMailbox* mailbox) {
+    currentMailbox = mailbox;
+}
+
+
+PlotWorkerPool::Job::~Job() {}
+
+
+PlotMailbox* PlotWorkerPool::Job::mailbox() const {
+    return currentMailbox;
+}
+
+/***********************************************************************************************************************
+* PlotWorkerPool::Worker
+*/
+
+PlotWorkerPool::Worker::Worker(
+        PlotWorkerPool* pool,
+        unsigned        databaseThreadId
+    ):currentPool(
+        pool
+    ),currentDatabaseThreadId(
+        databaseThreadId
+    ) {
+    currentStopRequested = false;
+    start();
+}
+
+
+PlotWorkerPool::Worker::~Worker() {
+    requestStop();
+    wait();
+}
+
+
+void PlotWorkerPool::Worker::requestStop() {
+    QMutexLocker queueMutexLocker(&currentPool->queueMutex);
+
+    currentStopRequested = true;
+    currentPool->queueCondition.wakeAll();
+}
+
+
+bool PlotWorkerPool::Worker::stopRequested() const {
+    return currentStopRequested;
+}
+
+
+void PlotWorkerPool::Worker::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::PLOT);
+
+    MetricsRegistry::Histogram* renderMetric = MetricsRegistry::instance()->histogram(
+        QString("dbc_plot_render_seconds"),
+        QString("Time spent rendering plots, including reading the plotted data.")
+    );
+
+    Job* job = currentPool->nextJob(this);
+    while (job != nullptr) {
+        QElapsedTimer renderTimer;
+        renderTimer.start();
+
+        job->run(currentDatabaseThreadId);
+        renderMetric->observe(renderTimer.nsecsElapsed() / 1.0E9);
+
+        delete job;
+
+        job = currentPool->nextJob(this);
+    }
+}
+
+/***********************************************************************************************************************
+* PlotWorkerPool
+*/
+
+PlotWorkerPool::PlotWorkerPool(QObject* parent):QObject(parent) {
+    currentMaximumQueued = defaultMaximumQueued;
+    queueDepthMetric     = MetricsRegistry::instance()->gauge(
+        QString("dbc_plot_queue_depth"),
+        QString("Number of plots waiting for a rendering worker.")
+    );
+
+    setNumberWorkers(defaultNumberWorkers);
+}
+
+
+PlotWorkerPool::~PlotWorkerPool() {
+    setNumberWorkers(0);
+
+    // Nothing will render the remaining jobs so release anyone waiting on them.
+
+    while (!pendingJobs.isEmpty()) {
+        Job* job = pendingJobs.dequeue();
+        job->mailbox()->sendFailedStatus();
+        delete job;
+    }
+}
+
+
+void PlotWorkerPool::setNumberWorkers(unsigned numberWorkers) {
+    unsigned currentNumberWorkers = static_cast<unsigned>(workers.size());
+
+    while (currentNumberWorkers < numberWorkers) {
+        workers.append(new Worker(this, firstDatabaseThreadId - currentNumberWorkers));
+        ++currentNumberWorkers;
+    }
+
+    // Workers are removed from the end so database thread IDs stay dense.  Deleting a worker blocks until it
+    // finishes the plot it's rendering, which keeps a replacement from sharing its database connection.
+
+    while (currentNumberWorkers > numberWorkers) {
+        Worker* worker = workers.takeLast();
+        delete worker;
+
+        --currentNumberWorkers;
+    }
+}
+
+
+unsigned PlotWorkerPool::numberWorkers() const {
+    return static_cast<unsigned>(workers.size());
+}
+
+
+void PlotWorkerPool::setMaximumQueued(unsigned maximumQueued) {
+    QMutexLocker queueMutexLocker(&queueMutex);
+    currentMaximumQueued = maximumQueued;
+}
+
+
+unsigned PlotWorkerPool::maximumQueued() const {
+    QMutexLocker queueMutexLocker(&queueMutex);
+    return currentMaximumQueued;
+}
+
+
+bool PlotWorkerPool::acceptingJobs() const {
+    QMutexLocker queueMutexLocker(&queueMutex);
+    return currentMaximumQueued == 0 || static_cast<unsigned>(pendingJobs.size()) < currentMaximumQueued;
+}
+
+
+void PlotWorkerPool::enqueue(PlotWorkerPool::Job* job) {
+    QMutexLocker queueMutexLocker(&queueMutex);
+
+    pendingJobs.enqueue(job);
+    updateQueueDepth();
+
+    queueCondition.wakeOne();
+}
+
+
+PlotWorkerPool::Job* PlotWorkerPool::nextJob(PlotWorkerPool::Worker* worker) {
+    Job* result = nullptr;
+
+    QMutexLocker queueMutexLocker(&queueMutex);
+
+    while (result == nullptr && !worker->stopRequested()) {
+        if (pendingJobs.isEmpty()) {
+            queueCondition.wait(&queueMutex);
+        } else {
+            result = pendingJobs.dequeue();
+            updateQueueDepth();
+        }
+    }
+
+    if (result == nullptr && !pendingJobs.isEmpty()) {
+        // We may have consumed a wake-up meant for a worker that will render the job.
+        queueCondition.wakeOne();
+    }
+
+    return result;
+}
+
+
+void PlotWorkerPool::updateQueueDepth() {
+    queueDepthMetric->set(static_cast<double>(pendingJobs.size()));
+}
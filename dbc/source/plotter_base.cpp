@@ -38,6 +38,10 @@
 #include <QRectF>
 #include <QPointF>
 #include <QPainter>
+#include <QPolygonF>
+#include <QFontMetrics>
+#include <QDateTime>
+#include <QAtomicInt>
 
 #include <cmath>
 #include <algorithm>
@@ -46,14 +50,35 @@
 #include "latency_entry.h"
 #include "aggregated_latency_entry.h"
 #include "latency_interface_manager.h"
+#include "plot_worker_pool.h"
+#include "metrics_registry.h"
 #include "plotter_base.h"
 
-PlotterBase::PlotterBase(QObject* parent):QObject(parent) {}
+PlotterBase::PlotterBase(
+        PlotWorkerPool* plotWorkerPool,
+        QObject*        parent
+    ):QObject(
+        parent
+    ),currentPlotWorkerPool(
+        plotWorkerPool
+    ),currentFastRendererMaximumPixels(
+        static_cast<int>(defaultFastRendererMaximumPixels)
+    ) {}
 
 
 PlotterBase::~PlotterBase() {}
 
 
+void PlotterBase::setFastRendererMaximumPixels(unsigned newMaximumPixels) {
+    currentFastRendererMaximumPixels.storeRelease(static_cast<int>(newMaximumPixels));
+}
+
+
+unsigned PlotterBase::fastRendererMaximumPixels() const {
+    return static_cast<unsigned>(currentFastRendererMaximumPixels.loadAcquire());
+}
+
+
 void PlotterBase::fixTimestamp(unsigned long long& startTimestamp, unsigned long long& endTimestamp) {
     if (endTimestamp == 0) {
         endTimestamp = static_cast<unsigned long long>(-1);
@@ -179,3 +204,480 @@ QFont PlotterBase::toFont(const QString& description, bool* ok) {
 
     return result;
 }
+
+
+bool PlotterBase::acceptingPlots() const {
+    return currentPlotWorkerPool->acceptingJobs();
+}
+
+
+void PlotterBase::enqueue(PlotWorkerPool::Job* job) {
+    currentPlotWorkerPool->enqueue(job);
+}
+
+
+bool PlotterBase::useFastRenderer(unsigned width, unsigned height) const {
+    unsigned long maximumPixels = fastRendererMaximumPixels();
+    return static_cast<unsigned long>(width) * height <= maximumPixels;
+}
+
+
+void PlotterBase::recordPlotTiming(
+        const QString& plotType,
+        bool           fastRenderer,
+        unsigned long  numberPoints,
+        qint64         dataTime,
+        qint64         drawTime
+    ) {
+    static const QList<double> pointBuckets = { 10, 100, 1000, 10000, 100000, 1000000 };
+
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    QString          plotLabel       = MetricsRegistry::label(QString("plot"), plotType);
+
+    metricsRegistry->histogram(
+        QString("dbc_plot_data_seconds"),
+        QString("Time spent obtaining and preparing plotted data."),
+        plotLabel
+    )->observe(dataTime / 1.0E9);
+
+    metricsRegistry->histogram(
+        QString("dbc_plot_draw_seconds"),
+        QString("Time spent drawing plots, by renderer."),
+          plotLabel
+        + QString(",")
+        + MetricsRegistry::label(QString("renderer"), QString(fastRenderer ? "fast" : "charts"))
+    )->observe(drawTime / 1.0E9);
+
+    metricsRegistry->histogram(
+        QString("dbc_plot_points"),
+        QString("Number of data points, or bars, in each plot."),
+        plotLabel,
+        pointBuckets
+    )->observe(static_cast<double>(numberPoints));
+}
+
+/***********************************************************************************************************************
+* PlotterBase::Canvas
+*/
+
+PlotterBase::Canvas::Canvas(
+        unsigned width,
+        unsigned height
+    ):currentImage(
+        static_cast<int>(width),
+        static_cast<int>(height),
+        QImage::Format::Format_RGB888
+    ),currentHorizontalAxisType(
+        HorizontalAxisType::VALUE
+    ),currentMinimumX(
+        0
+    ),currentMaximumX(
+        1.0
+    ),currentNumberXSteps(
+        1
+    ),currentNumberXDigits(
+        1
+    ),currentMinimumY(
+        0
+    ),currentMaximumY(
+        1.0
+    ),currentNumberYSteps(
+        1
+    ),currentLogScale(
+        false
+    ) {
+    currentImage.fill(Qt::GlobalColor::white);
+
+    currentPainter.begin(&currentImage);
+    currentPainter.setRenderHint(QPainter::RenderHint::Antialiasing);
+
+    currentTitleFont = QFont(currentTitleFont.family(), 12, QFont::Weight::Bold);
+}
+
+
+PlotterBase::Canvas::~Canvas() {
+    if (currentPainter.isActive()) {
+        currentPainter.end();
+    }
+}
+
+
+void PlotterBase::Canvas::setTitle(const QString& text, const QString& fontDescription) {
+    currentTitle     = text;
+    currentTitleFont = fontFor(fontDescription, currentTitleFont);
+}
+
+
+void PlotterBase::Canvas::setAxisTitles(
+        const QString& xAxisTitle,
+        const QString& yAxisTitle,
+        const QString& fontDescription
+    ) {
+    currentXAxisTitle    = xAxisTitle;
+    currentYAxisTitle    = yAxisTitle;
+    currentAxisTitleFont = fontFor(fontDescription, currentAxisTitleFont);
+}
+
+
+void PlotterBase::Canvas::setAxisLabelFont(const QString& fontDescription) {
+    currentAxisLabelFont = fontFor(fontDescription, currentAxisLabelFont);
+}
+
+
+void PlotterBase::Canvas::setHorizontalDateTimeAxis(
+        double         minimumMilliseconds,
+        double         maximumMilliseconds,
+        const QString& dateFormatString
+    ) {
+    currentHorizontalAxisType = HorizontalAxisType::DATE_TIME;
+    currentMinimumX           = minimumMilliseconds;
+    currentMaximumX           = std::max(maximumMilliseconds, minimumMilliseconds + 1000.0);
+    currentNumberXSteps       = dateTimeSteps;
+    currentDateFormatString   = dateFormatString;
+}
+
+
+void PlotterBase::Canvas::setHorizontalDayOfWeekAxis() {
+    currentHorizontalAxisType = HorizontalAxisType::DAY_OF_WEEK;
+    currentMinimumX           = 1.0;
+    currentMaximumX           = 8.0;
+    currentNumberXSteps       = 7;
+}
+
+
+void PlotterBase::Canvas::setHorizontalValueAxis(
+        double   minimum,
+        double   maximum,
+        unsigned numberSteps,
+        unsigned numberDigits
+    ) {
+    currentHorizontalAxisType = HorizontalAxisType::VALUE;
+    currentMinimumX           = minimum;
+    currentMaximumX           = maximum > minimum ? maximum : minimum + 1.0;
+    currentNumberXSteps       = std::max(numberSteps, 1U);
+    currentNumberXDigits      = numberDigits;
+}
+
+
+void PlotterBase::Canvas::setVerticalAxis(double minimum, double maximum, unsigned numberSteps, bool logScale) {
+    currentLogScale     = logScale;
+    currentNumberYSteps = std::max(numberSteps, 1U);
+
+    if (logScale) {
+        currentMinimumY = minimum > 0 ? minimum : 1.0E-6;
+        currentMaximumY = maximum > currentMinimumY ? maximum : 10.0 * currentMinimumY;
+    } else {
+        currentMinimumY = minimum;
+        currentMaximumY = maximum > minimum ? maximum : minimum + 1.0;
+    }
+}
+
+
+void PlotterBase::Canvas::drawFrame() {
+    QFontMetrics titleMetrics(currentTitleFont);
+    QFontMetrics axisTitleMetrics(currentAxisTitleFont);
+    QFontMetrics axisLabelMetrics(currentAxisLabelFont);
+
+    QVector<double> xTickValues;
+    QStringList     xLabels;
+    horizontalTicks(xTickValues, xLabels);
+
+    QVector<double> yTickValues;
+    QStringList     yLabels;
+    verticalTicks(yTickValues, yLabels);
+
+    int maximumYLabelWidth = 0;
+    for (QStringList::const_iterator it=yLabels.constBegin(),end=yLabels.constEnd() ; it!=end ; ++it) {
+        maximumYLabelWidth = std::max(maximumYLabelWidth, axisLabelMetrics.horizontalAdvance(*it));
+    }
+
+    int lastXLabelWidth = xLabels.isEmpty() ? 0 : axisLabelMetrics.horizontalAdvance(xLabels.last());
+    int titleHeight     = currentTitle.isEmpty() ? 0 : titleMetrics.height() + margin;
+    int xTitleHeight    = currentXAxisTitle.isEmpty() ? 0 : axisTitleMetrics.height() + margin / 2;
+    int yTitleWidth     = currentYAxisTitle.isEmpty() ? 0 : axisTitleMetrics.height() + margin / 2;
+    int labelHeight     = axisLabelMetrics.height();
+
+    double left   = margin + yTitleWidth + maximumYLabelWidth + margin / 2;
+    double top    = margin + titleHeight + labelHeight / 2;
+    double right  = currentImage.width() - margin - lastXLabelWidth / 2;
+    double bottom = currentImage.height() - margin - xTitleHeight - labelHeight - margin / 2;
+
+    currentPlotArea = QRectF(
+        QPointF(left, top),
+        QPointF(std::max(right, left + 1.0), std::max(bottom, top + 1.0))
+    );
+
+    currentPainter.setBrush(Qt::BrushStyle::NoBrush);
+
+    currentPainter.setPen(QPen(QBrush(QColor(0xE0, 0xE0, 0xE0)), 1));
+    for (QVector<double>::const_iterator it=xTickValues.constBegin(),end=xTickValues.constEnd() ; it!=end ; ++it) {
+        double x = mapX(*it);
+        currentPainter.drawLine(QPointF(x, currentPlotArea.top()), QPointF(x, currentPlotArea.bottom()));
+    }
+
+    for (QVector<double>::const_iterator it=yTickValues.constBegin(),end=yTickValues.constEnd() ; it!=end ; ++it) {
+        double y = mapY(*it);
+        currentPainter.drawLine(QPointF(currentPlotArea.left(), y), QPointF(currentPlotArea.right(), y));
+    }
+
+    currentPainter.setPen(QPen(QBrush(QColor(0xA0, 0xA0, 0xA0)), 1));
+    currentPainter.drawRect(currentPlotArea);
+
+    currentPainter.setPen(QPen(QBrush(Qt::GlobalColor::black), 1));
+
+    if (!currentTitle.isEmpty()) {
+        currentPainter.setFont(currentTitleFont);
+        currentPainter.drawText(
+            QRectF(0, margin, currentImage.width(), titleMetrics.height()),
+            Qt::AlignmentFlag::AlignCenter,
+            currentTitle
+        );
+    }
+
+    currentPainter.setFont(currentAxisLabelFont);
+
+    // Day-of-week labels are centered between ticks, matching the QtCharts category axis.
+    bool   labelsBetweenTicks = (xLabels.size() + 1 == xTickValues.size());
+    double labelTop           = currentPlotArea.bottom() + margin / 2;
+    for (int i=0 ; i<xLabels.size() ; ++i) {
+        double x;
+        if (labelsBetweenTicks) {
+            x = (mapX(xTickValues.at(i)) + mapX(xTickValues.at(i + 1))) / 2.0;
+        } else {
+            x = mapX(xTickValues.at(i));
+        }
+
+        const QString& label      = xLabels.at(i);
+        int            labelWidth = axisLabelMetrics.horizontalAdvance(label);
+        currentPainter.drawText(
+            QRectF(x - labelWidth, labelTop, 2 * labelWidth, labelHeight),
+            Qt::AlignmentFlag::AlignCenter,
+            label
+        );
+    }
+
+    double labelRight = currentPlotArea.left() - margin / 2;
+    for (int i=0 ; i<yLabels.size() ; ++i) {
+        double y = mapY(yTickValues.at(i));
+        currentPainter.drawText(
+            QRectF(labelRight - maximumYLabelWidth, y - labelHeight / 2.0, maximumYLabelWidth, labelHeight),
+            Qt::AlignmentFlag::AlignRight | Qt::AlignmentFlag::AlignVCenter,
+            yLabels.at(i)
+        );
+    }
+
+    currentPainter.setFont(currentAxisTitleFont);
+
+    if (!currentXAxisTitle.isEmpty()) {
+        currentPainter.drawText(
+            QRectF(
+                currentPlotArea.left(),
+                labelTop + labelHeight + margin / 2,
+                currentPlotArea.width(),
+                axisTitleMetrics.height()
+            ),
+            Qt::AlignmentFlag::AlignCenter,
+            currentXAxisTitle
+        );
+    }
+
+    if (!currentYAxisTitle.isEmpty()) {
+        currentPainter.save();
+        currentPainter.translate(margin, currentPlotArea.bottom());
+        currentPainter.rotate(-90);
+        currentPainter.drawText(
+            QRectF(0, 0, currentPlotArea.height(), axisTitleMetrics.height()),
+            Qt::AlignmentFlag::AlignCenter,
+            currentYAxisTitle
+        );
+        currentPainter.restore();
+    }
+}
+
+
+void PlotterBase::Canvas::drawLine(const QVector<QPointF>& points, const QPen& pen) {
+    if (points.size() > 1) {
+        QPolygonF polygon;
+        polygon.reserve(points.size());
+
+        for (QVector<QPointF>::const_iterator it=points.constBegin(),end=points.constEnd() ; it!=end ; ++it) {
+            polygon.append(map(*it));
+        }
+
+        currentPainter.setClipRect(currentPlotArea);
+        currentPainter.setPen(pen);
+        currentPainter.setBrush(Qt::BrushStyle::NoBrush);
+        currentPainter.drawPolyline(polygon);
+        currentPainter.setClipping(false);
+    }
+}
+
+
+void PlotterBase::Canvas::drawBand(
+        const QVector<QPointF>& lower,
+        const QVector<QPointF>& upper,
+        const QBrush&           brush,
+        const QPen&             pen
+    ) {
+    if (lower.size() > 1 && upper.size() > 1) {
+        QPolygonF polygon;
+        polygon.reserve(lower.size() + upper.size());
+
+        for (QVector<QPointF>::const_iterator it=lower.constBegin(),end=lower.constEnd() ; it!=end ; ++it) {
+            polygon.append(map(*it));
+        }
+
+        for (int i=upper.size() - 1 ; i>=0 ; --i) {
+            polygon.append(map(upper.at(i)));
+        }
+
+        currentPainter.setClipRect(currentPlotArea);
+        currentPainter.setPen(pen);
+
+        if (brush.style() == Qt::BrushStyle::LinearGradientPattern) {
+            QLinearGradient gradient(*static_cast<const QLinearGradient*>(brush.gradient()));
+            gradient.setCoordinateMode(QGradient::CoordinateMode::ObjectBoundingMode);
+            currentPainter.setBrush(gradient);
+        } else {
+            currentPainter.setBrush(brush);
+        }
+
+        currentPainter.drawPolygon(polygon);
+        currentPainter.setClipping(false);
+    }
+}
+
+
+void PlotterBase::Canvas::drawBars(const QVector<double>& values, const QBrush& brush, const QPen& pen) {
+    unsigned numberBars = static_cast<unsigned>(values.size());
+    if (numberBars > 0) {
+        double slotWidth = currentPlotArea.width() / numberBars;
+        double barWidth  = 0.8 * slotWidth;
+        double baseY     = mapY(currentLogScale ? currentMinimumY : std::max(currentMinimumY, 0.0));
+
+        currentPainter.setClipRect(currentPlotArea);
+        currentPainter.setPen(pen);
+        currentPainter.setBrush(brush);
+
+        for (unsigned i=0 ; i<numberBars ; ++i) {
+            double x = currentPlotArea.left() + i * slotWidth + (slotWidth - barWidth) / 2.0;
+            double y = mapY(values.at(i));
+            if (y < baseY) {
+                currentPainter.drawRect(QRectF(x, y, barWidth, baseY - y));
+            }
+        }
+
+        currentPainter.setClipping(false);
+    }
+}
+
+
+const QImage& PlotterBase::Canvas::image() {
+    if (currentPainter.isActive()) {
+        currentPainter.end();
+    }
+
+    return currentImage;
+}
+
+
+QFont PlotterBase::Canvas::fontFor(const QString& fontDescription, const QFont& defaultFont) {
+    bool  fontOk;
+    QFont font = toFont(fontDescription, &fontOk);
+
+    return fontOk ? font : defaultFont;
+}
+
+
+QPointF PlotterBase::Canvas::map(const QPointF& point) const {
+    return QPointF(mapX(point.x()), mapY(point.y()));
+}
+
+
+double PlotterBase::Canvas::mapX(double x) const {
+    double r = (x - currentMinimumX) / (currentMaximumX - currentMinimumX);
+    return currentPlotArea.left() + r * currentPlotArea.width();
+}
+
+
+double PlotterBase::Canvas::mapY(double y) const {
+    double r;
+    if (currentLogScale) {
+        double logMinimum = std::log10(currentMinimumY);
+        double logMaximum = std::log10(currentMaximumY);
+        double logY       = y > 0 ? std::log10(y) : logMinimum;
+
+        r = (logY - logMinimum) / (logMaximum - logMinimum);
+    } else {
+        r = (y - currentMinimumY) / (currentMaximumY - currentMinimumY);
+    }
+
+    return currentPlotArea.bottom() - r * currentPlotArea.height();
+}
+
+
+void PlotterBase::Canvas::horizontalTicks(QVector<double>& tickValues, QStringList& labels) const {
+    tickValues.clear();
+    labels.clear();
+
+    double stepSize = (currentMaximumX - currentMinimumX) / currentNumberXSteps;
+    for (unsigned i=0 ; i<=currentNumberXSteps ; ++i) {
+        tickValues.append(currentMinimumX + i * stepSize);
+    }
+
+    switch (currentHorizontalAxisType) {
+        case HorizontalAxisType::DATE_TIME: {
+            for (unsigned i=0 ; i<=currentNumberXSteps ; ++i) {
+                QDateTime dateTime = QDateTime::fromMSecsSinceEpoch(
+                    static_cast<qint64>(tickValues.at(i)),
+                    Qt::TimeSpec::UTC
+                );
+                labels.append(dateTime.toString(currentDateFormatString));
+            }
+
+            break;
+        }
+
+        case HorizontalAxisType::DAY_OF_WEEK: {
+            labels << "Mon" << "Tue" << "Wed" << "Thu" << "Fri" << "Sat" << "Sun";
+            break;
+        }
+
+        case HorizontalAxisType::VALUE: {
+            for (unsigned i=0 ; i<=currentNumberXSteps ; ++i) {
+                labels.append(QString::number(tickValues.at(i), 'f', static_cast<int>(currentNumberXDigits)));
+            }
+
+            break;
+        }
+    }
+}
+
+
+void PlotterBase::Canvas::verticalTicks(QVector<double>& tickValues, QStringList& labels) const {
+    tickValues.clear();
+    labels.clear();
+
+    if (currentLogScale) {
+        double firstPower = std::ceil(std::log10(currentMinimumY) - 1.0E-9);
+        double lastPower  = std::floor(std::log10(currentMaximumY) + 1.0E-9);
+        for (double power=firstPower ; power<=lastPower ; power+=1.0) {
+            double v = std::pow(10.0, power);
+            tickValues.append(v);
+            labels.append(QString::number(v, 'g', 3));
+        }
+
+        if (tickValues.isEmpty()) {
+            tickValues << currentMinimumY << currentMaximumY;
+            labels << QString::number(currentMinimumY, 'g', 3) << QString::number(currentMaximumY, 'g', 3);
+        }
+    } else {
+        double stepSize     = (currentMaximumY - currentMinimumY) / currentNumberYSteps;
+        int    numberDigits = std::max(0, static_cast<int>(-std::floor(std::log10(stepSize))));
+        for (unsigned i=0 ; i<=currentNumberYSteps ; ++i) {
+            double v = currentMinimumY + i * stepSize;
+            tickValues.append(v);
+            labels.append(QString::number(v, 'f', numberDigits));
+        }
+    }
+}
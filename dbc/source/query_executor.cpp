@@ -0,0 +1,192 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref QueryExecutor class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+
+#include "thread_placement.h"
+#include "query_executor.h"
+
+const unsigned QueryExecutor::defaultNumberWorkers = 4;
+
+/***********************************************************************************************************************
+* QueryExecutor::Job
+*/
+
+QueryExecutor::Job::Job() {
+    currentCompleted = false;
+}
+
+
+QueryExecutor::Job::~Job() {}
+
+
+void QueryExecutor::Job::waitForCompletion() {
+    QMutexLocker completionMutexLocker(&completionMutex);
+
+    while (!currentCompleted) {
+        completionCondition.wait(&completionMutex);
+    }
+}
+
+
+void QueryExecutor::Job::markCompleted() {
+    QMutexLocker completionMutexLocker(&completionMutex);
+
+    currentCompleted = true;
+    completionCondition.wakeAll();
+}
+
+/***********************************************************************************************************************
+* QueryExecutor::Worker
+*/
+
+QueryExecutor::Worker::Worker(QueryExecutor* executor):currentExecutor(executor) {
+    currentStopRequested = false;
+    start();
+}
+
+
+QueryExecutor::Worker::~Worker() {
+    requestStop();
+    wait();
+}
+
+
+void QueryExecutor::Worker::requestStop() {
+    QMutexLocker queueMutexLocker(&currentExecutor->queueMutex);
+
+    currentStopRequested = true;
+    currentExecutor->queueCondition.wakeAll();
+}
+
+
+bool QueryExecutor::Worker::stopRequested() const {
+    return currentStopRequested;
+}
+
+
+void QueryExecutor::Worker::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::QUERY);
+
+    Job* job = currentExecutor->nextJob(this);
+    while (job != nullptr) {
+        job->run();
+        job->markCompleted();
+
+        job = currentExecutor->nextJob(this);
+    }
+}
+
+/***********************************************************************************************************************
+* QueryExecutor
+*/
+
+QueryExecutor::QueryExecutor(QObject* parent):QObject(parent) {
+    currentNumberActiveWorkers = 0;
+    setNumberWorkers(defaultNumberWorkers);
+}
+
+
+QueryExecutor::~QueryExecutor() {
+    setNumberWorkers(0);
+}
+
+
+void QueryExecutor::setNumberWorkers(unsigned numberWorkers) {
+    queueMutex.lock();
+    currentNumberActiveWorkers = numberWorkers;
+    queueMutex.unlock();
+
+    unsigned currentNumberWorkers = static_cast<unsigned>(workers.size());
+
+    while (currentNumberWorkers < numberWorkers) {
+        workers.append(new Worker(this));
+        ++currentNumberWorkers;
+    }
+
+    while (currentNumberWorkers > numberWorkers) {
+        Worker* worker = workers.takeLast();
+        delete worker;
+
+        --currentNumberWorkers;
+    }
+
+    if (numberWorkers == 0) {
+        // Nothing will pick up the remaining jobs so run them here rather than leave their callers waiting.
+
+        QMutexLocker queueMutexLocker(&queueMutex);
+        while (!pendingJobs.isEmpty()) {
+            Job* job = pendingJobs.dequeue();
+
+            queueMutexLocker.unlock();
+            job->run();
+            job->markCompleted();
+            queueMutexLocker.relock();
+        }
+    }
+}
+
+
+unsigned QueryExecutor::numberWorkers() const {
+    return static_cast<unsigned>(workers.size());
+}
+
+
+void QueryExecutor::enqueue(QueryExecutor::Job* job) {
+    QMutexLocker queueMutexLocker(&queueMutex);
+
+    if (currentNumberActiveWorkers == 0) {
+        queueMutexLocker.unlock();
+
+        job->run();
+        job->markCompleted();
+    } else {
+        pendingJobs.enqueue(job);
+        queueCondition.wakeOne();
+    }
+}
+
+
+QueryExecutor::Job* QueryExecutor::nextJob(QueryExecutor::Worker* worker) {
+    Job* result = nullptr;
+
+    QMutexLocker queueMutexLocker(&queueMutex);
+
+    while (result == nullptr && !worker->stopRequested()) {
+        if (pendingJobs.isEmpty()) {
+            queueCondition.wait(&queueMutex);
+        } else {
+            result = pendingJobs.dequeue();
+        }
+    }
+
+    if (result == nullptr && !pendingJobs.isEmpty()) {
+        // We may have consumed a wake-up meant for a worker that will run the job.
+        queueCondition.wakeOne();
+    }
+
+    return result;
+}
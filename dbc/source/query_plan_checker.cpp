@@ -0,0 +1,301 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref QueryPlanChecker class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include "log.h"
+#include "database_manager.h"
+#include "sql_helpers.h"
+#include "query_plan_checker.h"
+
+QueryPlanChecker::QueryPlanChecker(
+        DatabaseManager* databaseManager,
+        QObject*         parent
+    ):QThread(
+        parent
+    ),currentDatabaseManager(
+        databaseManager
+    ) {
+    checkStarted            = false;
+    currentMinimumTableRows = defaultMinimumTableRows;
+}
+
+
+QueryPlanChecker::~QueryPlanChecker() {
+    requestInterruption();
+    wait();
+}
+
+
+void QueryPlanChecker::startCheck(unsigned long minimumTableRows) {
+    QMutexLocker locker(&stateMutex);
+
+    if (!checkStarted) {
+        checkStarted            = true;
+        currentMinimumTableRows = minimumTableRows;
+
+        start(QThread::LowPriority);
+    }
+}
+
+
+void QueryPlanChecker::run() {
+    stateMutex.lock();
+    double minimumTableRows = static_cast<double>(currentMinimumTableRows);
+    stateMutex.unlock();
+
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(checkThreadId));
+    if (database.isOpen()) {
+        QList<HotQuery> queries        = hotQueries();
+        unsigned long   numberChecked  = 0;
+        unsigned long   numberDegraded = 0;
+
+        for (  QList<HotQuery>::const_iterator it  = queries.constBegin(),
+                                               end = queries.constEnd()
+             ; it != end && !isInterruptionRequested()
+             ; ++it
+            ) {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+
+            bool success = SqlHelpers::execute(query, QString("EXPLAIN (FORMAT JSON) %1").arg(it->query));
+            if (success && query.next()) {
+                QJsonDocument document = QJsonDocument::fromJson(query.value(0).toString().toUtf8());
+                QJsonArray    plans    = document.array();
+
+                QStringList relations;
+                for (QJsonArray::const_iterator pit=plans.constBegin(),pend=plans.constEnd() ; pit!=pend ; ++pit) {
+                    collectSequentialScans((*pit).toObject().value("Plan").toObject(), relations);
+                }
+
+                QStringList largeRelations;
+                for (  QStringList::const_iterator rit  = relations.constBegin(),
+                                                   rend = relations.constEnd()
+                     ; rit != rend
+                     ; ++rit
+                    ) {
+                    if (!largeRelations.contains(*rit) && estimatedRows(database, *rit) >= minimumTableRows) {
+                        largeRelations.append(*rit);
+                    }
+                }
+
+                if (!largeRelations.isEmpty()) {
+                    logWrite(
+                        QString("Query plan for \"%1\" uses a sequential scan over %2 - missing index?")
+                        .arg(it->description, largeRelations.join(QString(", "))),
+                        true
+                    );
+
+                    ++numberDegraded;
+                }
+
+                ++numberChecked;
+            } else {
+                logWrite(
+                    QString("Failed EXPLAIN - QueryPlanChecker::run: %1: %2")
+                    .arg(it->description, query.lastError().text()),
+                    true
+                );
+            }
+        }
+
+        logWrite(
+            QString("Query plan check completed: %1 queries checked, %2 using sequential scans.")
+            .arg(numberChecked)
+            .arg(numberDegraded),
+            false
+        );
+    } else {
+        logWrite(
+            QString("Failed to open database - QueryPlanChecker::run: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+}
+
+
+QList<QueryPlanChecker::HotQuery> QueryPlanChecker::hotQueries() {
+    // The IDs and timestamps below are placeholders, the plan shape does not depend on them.
+    QList<HotQuery> result;
+
+    result.append(
+        HotQuery {
+            QString("per-monitor event check"),
+            QString(
+                "SELECT event_type AS event_type, hash AS hash, timestamp AS timestamp FROM event "
+                    "WHERE "
+                        "timestamp = ("
+                            "SELECT MAX(timestamp) FROM event "
+                            "WHERE monitor_id = 1 AND event_type IN ('WORKING', 'NO_RESPONSE')"
+                        ") "
+                    "AND "
+                        "monitor_id = 1 AND event_type IN ('WORKING', 'NO_RESPONSE')"
+            )
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("per-host/scheme event check"),
+            QString(
+                "SELECT MAX(timestamp) FROM event "
+                "WHERE monitor_id IN ("
+                    "SELECT monitor_id FROM monitor WHERE host_scheme_id = ("
+                        "SELECT host_scheme_id FROM monitor WHERE monitor_id = 1"
+                    ")"
+                ") "
+                "AND event_type IN ('SSL_CERTIFICATE_EXPIRING', 'SSL_CERTIFICATE_RENEWED')"
+            )
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("events by customer"),
+            QString(
+                "SELECT * FROM event WHERE customer_id = 1 AND timestamp >= 0 "
+                "ORDER BY timestamp ASC, event_id ASC LIMIT 100"
+            )
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("monitor status by customer"),
+            QString(
+                "SELECT * FROM monitor_status "
+                "WHERE monitor_id IN (SELECT monitor_id FROM monitor WHERE customer_id = 1)"
+            )
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("monitors by customer"),
+            QString("SELECT * FROM monitor WHERE customer_id = 1")
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("host/schemes by customer"),
+            QString("SELECT * FROM host_scheme WHERE customer_id = 1")
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("customer mapping by server"),
+            QString("SELECT * FROM customer_mapping WHERE server_id = 1")
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("latency by customer"),
+            QString(
+                "SELECT * FROM latency_seconds "
+                "WHERE monitor_id IN (SELECT monitor_id FROM monitor WHERE customer_id = 1) "
+                "AND timestamp >= 0 AND timestamp <= 86400"
+            )
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("latency by host/scheme"),
+            QString(
+                "SELECT * FROM latency_seconds "
+                "WHERE monitor_id IN (SELECT monitor_id FROM monitor WHERE host_scheme_id = 1) "
+                "AND timestamp >= 0 AND timestamp <= 86400"
+            )
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("latency by server"),
+            QString("SELECT * FROM latency_seconds WHERE server_id = 1 AND timestamp >= 0 AND timestamp <= 86400")
+        }
+    );
+
+    result.append(
+        HotQuery {
+            QString("aggregated latency by customer"),
+            QString(
+                "SELECT * FROM latency_aggregated "
+                "WHERE monitor_id IN (SELECT monitor_id FROM monitor WHERE customer_id = 1) "
+                "AND timestamp >= 0 AND timestamp <= 86400"
+            )
+        }
+    );
+
+    return result;
+}
+
+
+void QueryPlanChecker::collectSequentialScans(const QJsonObject& planNode, QStringList& relations) {
+    if (planNode.value("Node Type").toString() == QString("Seq Scan")) {
+        relations.append(planNode.value("Relation Name").toString());
+    }
+
+    QJsonArray children = planNode.value("Plans").toArray();
+    for (QJsonArray::const_iterator it=children.constBegin(),end=children.constEnd() ; it!=end ; ++it) {
+        collectSequentialScans((*it).toObject(), relations);
+    }
+}
+
+
+double QueryPlanChecker::estimatedRows(const QSqlDatabase& database, const QString& relationName) {
+    double result = -1;
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+    query.prepare("SELECT reltuples FROM pg_class WHERE relname = ?");
+    query.addBindValue(relationName);
+
+    if (SqlHelpers::execute(query)) {
+        if (query.next()) {
+            result = query.value(0).toDouble();
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT - QueryPlanChecker::estimatedRows: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return result;
+}
@@ -0,0 +1,297 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref QueryStatistics class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QVariant>
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QAtomicInteger>
+#include <QRegularExpression>
+#include <QSqlQuery>
+
+#include <algorithm>
+#include <cmath>
+
+#include "log.h"
+#include "query_statistics.h"
+
+const unsigned QueryStatistics::defaultSlowThresholdMilliseconds = 250;
+
+QueryStatistics* QueryStatistics::instance() {
+    static QueryStatistics* queryStatistics = new QueryStatistics;
+    return queryStatistics;
+}
+
+
+void QueryStatistics::setSlowThreshold(unsigned newSlowThresholdMilliseconds) {
+    currentSlowThreshold.storeRelease(Q_INT64_C(1000000) * newSlowThresholdMilliseconds);
+}
+
+
+void QueryStatistics::record(const QSqlQuery& query, const QString& statement, bool success, qint64 elapsedTime) {
+    int rows = query.isSelect() ? query.size() : query.numRowsAffected();
+    if (rows < 0) {
+        rows = 0;
+    }
+
+    // Bound values are only gathered for slow statements as building the list is not free.
+    if (recordExecution(statement, success, elapsedTime, rows)) {
+        logSlowStatement(query.boundValues(), statement, elapsedTime, rows);
+    }
+}
+
+
+void QueryStatistics::record(const QString& statement, bool success, qint64 elapsedTime, int rows) {
+    if (recordExecution(statement, success, elapsedTime, rows)) {
+        logSlowStatement(QMap<QString, QVariant>(), statement, elapsedTime, rows);
+    }
+}
+
+
+bool QueryStatistics::recordExecution(const QString& statement, bool success, qint64 elapsedTime, int rows) {
+    qint64   elapsedMicroseconds = elapsedTime / 1000;
+    unsigned bucket              = 0;
+    while (bucket < numberBuckets - 1 && (Q_INT64_C(1) << bucket) <= elapsedMicroseconds) {
+        ++bucket;
+    }
+
+    QString normalizedStatement = normalize(statement);
+
+    QMutexLocker entryMutexLocker(&entryMutex);
+
+    QHash<QString, Entry>::iterator it = entries.find(normalizedStatement);
+    if (it == entries.end()) {
+        if (static_cast<unsigned>(entries.size()) >= maximumNumberStatements) {
+            normalizedStatement = QString("(other)");
+            it = entries.find(normalizedStatement);
+        }
+
+        if (it == entries.end()) {
+            Entry entry = {};
+            it = entries.insert(normalizedStatement, entry);
+        }
+    }
+
+    Entry& entry = it.value();
+    ++entry.count;
+    entry.totalTime += elapsedTime;
+    entry.rows      += static_cast<unsigned>(rows);
+    ++entry.buckets[bucket];
+
+    if (!success) {
+        ++entry.errors;
+    }
+
+    if (elapsedTime > entry.maximumTime) {
+        entry.maximumTime = elapsedTime;
+    }
+
+    entryMutexLocker.unlock();
+
+    return elapsedTime >= currentSlowThreshold.loadAcquire();
+}
+
+
+QueryStatistics::SummaryList QueryStatistics::summaries() const {
+    SummaryList result;
+
+    QMutexLocker entryMutexLocker(&entryMutex);
+    for (  QHash<QString, Entry>::const_iterator it  = entries.constBegin(),
+                                                 end = entries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        const Entry& entry = it.value();
+
+        Summary summary;
+        summary.statement      = it.key();
+        summary.count          = entry.count;
+        summary.errors         = entry.errors;
+        summary.totalSeconds   = entry.totalTime / 1.0E9;
+        summary.p50Seconds     = percentile(entry, 0.50);
+        summary.p99Seconds     = percentile(entry, 0.99);
+        summary.maximumSeconds = entry.maximumTime / 1.0E9;
+        summary.rows           = entry.rows;
+
+        result.append(summary);
+    }
+
+    entryMutexLocker.unlock();
+
+    std::sort(
+        result.begin(),
+        result.end(),
+        [](const Summary& a, const Summary& b) {
+            return a.totalSeconds > b.totalSeconds;
+        }
+    );
+
+    return result;
+}
+
+
+void QueryStatistics::reset() {
+    QMutexLocker entryMutexLocker(&entryMutex);
+    entries.clear();
+}
+
+
+QString QueryStatistics::normalize(const QString& statement) {
+    static const QRegularExpression placeholderListExpression("\\?(?:, ?\\?)+");
+    static const QRegularExpression rowListExpression("(\\([^()]*\\))(?:, ?\\1)+");
+
+    QString  result;
+    unsigned length = static_cast<unsigned>(statement.size());
+    unsigned i      = 0;
+
+    result.reserve(statement.size());
+    while (i < length) {
+        QChar c = statement.at(i);
+        if (c.isSpace()) {
+            while (i < length && statement.at(i).isSpace()) {
+                ++i;
+            }
+
+            if (!result.isEmpty()) {
+                result += QChar(' ');
+            }
+        } else if (c == QChar('\'')) {
+            // Skip the literal, honoring both backslash escapes and doubled quotes.
+            bool done = false;
+            ++i;
+            while (i < length && !done) {
+                QChar s = statement.at(i);
+                if (s == QChar('\\')) {
+                    i += 2;
+                } else if (s == QChar('\'')) {
+                    if (i + 1 < length && statement.at(i + 1) == QChar('\'')) {
+                        i += 2;
+                    } else {
+                        ++i;
+                        done = true;
+                    }
+                } else {
+                    ++i;
+                }
+            }
+
+            result += QChar('?');
+        } else if (c.isDigit()) {
+            // Digits that are part of an identifier, such as a partition name, or of a "$1" style placeholder are
+            // kept.
+            QChar previous = result.isEmpty() ? QChar(' ') : result.at(result.size() - 1);
+            if (previous.isLetterOrNumber() || previous == QChar('_') || previous == QChar('$')) {
+                result += c;
+                ++i;
+            } else {
+                while (i < length && (statement.at(i).isLetterOrNumber() || statement.at(i) == QChar('.'))) {
+                    ++i;
+                }
+
+                result += QChar('?');
+            }
+        } else {
+            result += c;
+            ++i;
+        }
+    }
+
+    if (result.endsWith(QChar(' '))) {
+        result.chop(1);
+    }
+
+    result.replace(placeholderListExpression, QString("?, ..."));
+    result.replace(rowListExpression, QString("\\1, ..."));
+
+    return result;
+}
+
+
+QueryStatistics::QueryStatistics() {
+    setSlowThreshold(defaultSlowThresholdMilliseconds);
+}
+
+
+QueryStatistics::~QueryStatistics() {}
+
+
+double QueryStatistics::percentile(const QueryStatistics::Entry& entry, double fraction) {
+    unsigned long long target = static_cast<unsigned long long>(std::ceil(fraction * entry.count));
+    if (target == 0) {
+        target = 1;
+    }
+
+    unsigned long long cumulative = 0;
+    unsigned           bucket     = 0;
+    while (bucket < numberBuckets - 1 && cumulative + entry.buckets[bucket] < target) {
+        cumulative += entry.buckets[bucket];
+        ++bucket;
+    }
+
+    // Report the bucket's upper bound, which can not exceed the longest execution seen.
+    return std::min((Q_INT64_C(1) << bucket) / 1.0E6, entry.maximumTime / 1.0E9);
+}
+
+
+void QueryStatistics::logSlowStatement(
+        const QMap<QString, QVariant>& boundValues,
+        const QString&                 statement,
+        qint64                         elapsedTime,
+        int                            rows
+    ) {
+    QString parameters;
+
+    for (  QMap<QString, QVariant>::const_iterator it  = boundValues.constBegin(),
+                                                   end = boundValues.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        const QVariant& value = it.value();
+
+        QString valueString;
+        if (value.isNull()) {
+            valueString = QString("NULL");
+        } else if (value.type() == QVariant::ByteArray) {
+            valueString = QString("<%1 bytes>").arg(value.toByteArray().size());
+        } else {
+            valueString = value.toString();
+            if (valueString.size() > 64) {
+                valueString = valueString.left(64) + QString("...");
+            }
+        }
+
+        parameters += QString(parameters.isEmpty() ? "%1=%2" : ", %1=%2").arg(it.key(), valueString);
+    }
+
+    QString message = QString("Slow query: %1 ms, %2 rows: %3")
+                      .arg(elapsedTime / 1.0E6, 0, 'f', 3)
+                      .arg(rows)
+                      .arg(statement.size() > 1024 ? statement.left(1024) + QString("...") : statement);
+
+    if (!parameters.isEmpty()) {
+        message += QString(" -- parameters: ") + parameters;
+    }
+
+    logWrite(message, LogSeverity::WARNING);
+}
@@ -21,6 +21,8 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QAtomicInteger>
+#include <QDateTime>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
@@ -33,10 +35,12 @@
 #include "log.h"
 #include "region.h"
 #include "database_manager.h"
+#include "sql_helpers.h"
 #include "regions.h"
 
 Regions::Regions(DatabaseManager* databaseManager, QObject* parent):QObject(parent) {
     currentDatabaseManager = databaseManager;
+    currentVersion         = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch());
 }
 
 
@@ -53,7 +57,7 @@ Region Regions::getRegion(RegionId regionId, unsigned threadId) const {
         query.setForwardOnly(true);
 
         QString queryString = QString("SELECT region_name FROM regions WHERE region_id = %1").arg(regionId);
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             if (query.first()) {
                 int fieldNumber = query.record().indexOf("region_name");
@@ -90,11 +94,12 @@ Region Regions::createRegion(const QString& regionName, unsigned threadId) {
         QSqlQuery query(database);
 
         QString queryString = QString("INSERT INTO regions(region_name) VALUES ('%1')").arg(escape(regionName));
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             QVariant regionId = query.lastInsertId();
             if (regionId.isValid()) {
                 result = Region(regionId.toUInt(), regionName);
+                currentVersion.fetchAndAddOrdered(1);
             } else {
                 logWrite(
                     QString("Failed to get field index - Regions::createRegion: %1")
@@ -129,9 +134,11 @@ bool Regions::modifyRegion(const Region& region, unsigned threadId) {
                               .arg(escape(region.regionName()))
                               .arg(region.regionId());
 
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (!success) {
             logWrite(QString("Failed UPDATE - Regions::modifyRegion: %1").arg(query.lastError().text()), true);
+        } else {
+            currentVersion.fetchAndAddOrdered(1);
         }
     } else {
         logWrite(
@@ -152,9 +159,11 @@ bool Regions::deleteRegion(const Region& region, unsigned threadId) {
         QSqlQuery query(database);
 
         QString queryString = QString("DELETE FROM regions WHERE region_id = %1").arg(region.regionId());
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (!success) {
             logWrite(QString("Failed DELETE - Regions::deleteRegion: %1").arg(query.lastError().text()), true);
+        } else {
+            currentVersion.fetchAndAddOrdered(1);
         }
     } else {
         logWrite(
@@ -177,7 +186,7 @@ Regions::RegionHash Regions::getAllRegions(unsigned threadId) {
         QSqlQuery query(database);
         query.setForwardOnly(true);
 
-        success = query.exec(QString("SELECT * FROM regions"));
+        success = SqlHelpers::execute(query, QString("SELECT * FROM regions"));
         if (success) {
             int regionIdField   = query.record().indexOf("region_id");
             int regionNameField = query.record().indexOf("region_name");
@@ -218,3 +227,8 @@ Regions::RegionHash Regions::getAllRegions(unsigned threadId) {
     currentDatabaseManager->closeAndRelease(database);
     return result;
 }
+
+
+unsigned long long Regions::version() const {
+    return currentVersion.loadAcquire();
+}
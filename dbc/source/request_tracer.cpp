@@ -0,0 +1,304 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RequestTracer class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+#include <QIODevice>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QRandomGenerator>
+
+#include "log.h"
+#include "metrics_registry.h"
+#include "request_tracer.h"
+
+const double   RequestTracer::defaultSampleRate = 0.01;
+const unsigned RequestTracer::defaultSlowThresholdMilliseconds = 1000;
+
+thread_local RequestTracer::Trace*   RequestTracer::threadTrace = nullptr;
+thread_local RequestTracer::HeldSpan RequestTracer::heldSpans[RequestTracer::maximumHeldSpans];
+thread_local unsigned                RequestTracer::numberHeldSpans = 0;
+
+/***********************************************************************************************************************
+* RequestTracer::Trace
+*/
+
+RequestTracer::Trace::Trace(const QString& endpoint, unsigned threadId) {
+    RequestTracer* tracer = instance();
+
+    currentEndpoint = endpoint;
+    currentThreadId = threadId;
+    active          = (threadTrace == nullptr);
+    sampled         = active && tracer->sample();
+    startTime       = tracer->now();
+    currentPhase    = Phase::HANDLER;
+
+    for (unsigned i=0 ; i<numberPhases ; ++i) {
+        phaseTimes[i] = 0;
+    }
+
+    // Held spans were closed while the request was being authenticated.  The request started when the first of them
+    // did.
+    for (unsigned i=0 ; i<numberHeldSpans ; ++i) {
+        const HeldSpan& heldSpan = heldSpans[i];
+        if (heldSpan.threadId == threadId) {
+            phaseTimes[static_cast<unsigned>(heldSpan.phase)] += heldSpan.duration;
+            if (heldSpan.startTime < startTime) {
+                startTime = heldSpan.startTime;
+            }
+        }
+    }
+
+    numberHeldSpans = 0;
+    lastPhaseTime   = tracer->now();
+
+    if (active) {
+        threadTrace = this;
+    }
+}
+
+
+RequestTracer::Trace::~Trace() {
+    if (active) {
+        qint64 endTime = instance()->now();
+
+        phaseTimes[static_cast<unsigned>(currentPhase)] += endTime - lastPhaseTime;
+        threadTrace = nullptr;
+
+        instance()->finish(*this, endTime);
+    }
+}
+
+
+RequestTracer::Phase RequestTracer::Trace::switchPhase(RequestTracer::Phase newPhase) {
+    qint64 currentTime = instance()->now();
+    Phase  oldPhase    = currentPhase;
+
+    phaseTimes[static_cast<unsigned>(oldPhase)] += currentTime - lastPhaseTime;
+    lastPhaseTime = currentTime;
+    currentPhase  = newPhase;
+
+    return oldPhase;
+}
+
+/***********************************************************************************************************************
+* RequestTracer::Span
+*/
+
+RequestTracer::Span::Span(RequestTracer::Phase phase, unsigned threadId) {
+    currentThreadId = threadId;
+    heldStartTime   = -1;
+
+    Trace* trace = threadTrace;
+    if (trace != nullptr) {
+        if (trace->sampled && trace->currentThreadId == threadId) {
+            currentTrace  = trace;
+            previousPhase = trace->switchPhase(phase);
+        } else {
+            currentTrace = nullptr;
+        }
+    } else {
+        currentTrace  = nullptr;
+        previousPhase = phase;
+
+        if (phase == Phase::AUTHENTICATION) {
+            heldStartTime = instance()->now();
+        }
+    }
+}
+
+
+RequestTracer::Span::~Span() {
+    if (currentTrace != nullptr) {
+        currentTrace->switchPhase(previousPhase);
+    } else if (heldStartTime >= 0) {
+        // Held spans from a request that never reached its handler are discarded once the thread runs out of room.
+        if (numberHeldSpans >= maximumHeldSpans) {
+            numberHeldSpans = 0;
+        }
+
+        HeldSpan& heldSpan = heldSpans[numberHeldSpans];
+        heldSpan.threadId  = currentThreadId;
+        heldSpan.phase     = previousPhase;
+        heldSpan.startTime = heldStartTime;
+        heldSpan.duration  = instance()->now() - heldStartTime;
+
+        ++numberHeldSpans;
+    }
+}
+
+/***********************************************************************************************************************
+* RequestTracer
+*/
+
+RequestTracer* RequestTracer::instance() {
+    // The tracer is intentionally never destroyed so that requests can be traced during process shutdown.
+    static RequestTracer* tracer = new RequestTracer;
+    return tracer;
+}
+
+
+void RequestTracer::setSampleRate(double newSampleRate) {
+    double sampleRate = newSampleRate < 0 ? 0 : newSampleRate > 1 ? 1 : newSampleRate;
+    currentSampleThreshold.storeRelease(static_cast<quint32>(sampleRate * 0xFFFFFFFFU));
+}
+
+
+void RequestTracer::setSlowThreshold(unsigned newSlowThresholdMilliseconds) {
+    currentSlowThreshold.storeRelease(1000000LL * newSlowThresholdMilliseconds);
+}
+
+
+bool RequestTracer::setSlowRequestLog(const QString& filename) {
+    bool success = true;
+
+    QMutexLocker slowRequestLogMutexLocker(&slowRequestLogMutex);
+    if (filename != slowRequestLog.fileName() || !slowRequestLog.isOpen()) {
+        if (slowRequestLog.isOpen()) {
+            slowRequestLog.close();
+        }
+
+        if (!filename.isEmpty()) {
+            slowRequestLog.setFileName(filename);
+            success = slowRequestLog.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+        }
+    }
+
+    return success;
+}
+
+
+RequestTracer::RequestTracer() {
+    clock.start();
+
+    setSampleRate(defaultSampleRate);
+    setSlowThreshold(defaultSlowThresholdMilliseconds);
+}
+
+
+RequestTracer::~RequestTracer() {}
+
+
+qint64 RequestTracer::now() const {
+    return clock.nsecsElapsed();
+}
+
+
+bool RequestTracer::sample() const {
+    quint32 sampleThreshold = currentSampleThreshold.loadAcquire();
+    return sampleThreshold != 0 && QRandomGenerator::global()->generate() <= sampleThreshold;
+}
+
+
+void RequestTracer::finish(const RequestTracer::Trace& trace, qint64 endTime) {
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    QString          endpointLabel   = MetricsRegistry::label(QString("endpoint"), trace.currentEndpoint);
+    qint64           duration        = endTime - trace.startTime;
+
+    metricsRegistry->histogram(
+        QString("dbc_request_seconds"),
+        QString("Time spent servicing REST requests, including authentication."),
+        endpointLabel
+    )->observe(duration / 1.0E9);
+
+    if (trace.sampled) {
+        QString breakdown;
+        for (unsigned i=0 ; i<numberPhases ; ++i) {
+            QString phaseName = toString(static_cast<Phase>(i));
+            qint64  phaseTime = trace.phaseTimes[i];
+
+            metricsRegistry->histogram(
+                QString("dbc_request_phase_seconds"),
+                QString("Time charged to each phase of sampled REST requests."),
+                endpointLabel + QString(",") + MetricsRegistry::label(QString("phase"), phaseName)
+            )->observe(phaseTime / 1.0E9);
+
+            if (phaseTime > 0) {
+                breakdown += QString(breakdown.isEmpty() ? "%1 %2 ms" : ", %1 %2 ms")
+                             .arg(phaseName)
+                             .arg(phaseTime / 1.0E6, 0, 'f', 3);
+            }
+        }
+
+        if (duration >= currentSlowThreshold.loadAcquire()) {
+            QString message = QString("Slow request %1, thread %2: %3 ms -- %4")
+                              .arg(trace.currentEndpoint)
+                              .arg(trace.currentThreadId)
+                              .arg(duration / 1.0E6, 0, 'f', 3)
+                              .arg(breakdown);
+
+            QMutexLocker slowRequestLogMutexLocker(&slowRequestLogMutex);
+            if (slowRequestLog.isOpen()) {
+                QByteArray line = QString("%1: %2\n")
+                                  .arg(QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs), message)
+                                  .toUtf8();
+
+                slowRequestLog.write(line);
+                slowRequestLog.flush();
+            } else {
+                slowRequestLogMutexLocker.unlock();
+                logWrite(message, LogSeverity::WARNING);
+            }
+        }
+    }
+}
+
+
+QString RequestTracer::toString(RequestTracer::Phase phase) {
+    QString result;
+
+    switch (phase) {
+        case Phase::AUTHENTICATION: {
+            result = QString("authentication");
+            break;
+        }
+
+        case Phase::CACHE: {
+            result = QString("cache");
+            break;
+        }
+
+        case Phase::DATABASE: {
+            result = QString("database");
+            break;
+        }
+
+        case Phase::JSON: {
+            result = QString("json");
+            break;
+        }
+
+        case Phase::PLOT: {
+            result = QString("plot");
+            break;
+        }
+
+        case Phase::HANDLER: {
+            result = QString("handler");
+            break;
+        }
+    }
+
+    return result;
+}
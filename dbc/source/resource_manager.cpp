@@ -469,6 +469,11 @@ RestApiInV1::Response* ResourceManager::ResourcePlot::processAuthenticatedReques
             ++numberFields;
         }
 
+        if (success && !currentResourcePlotter->acceptingPlots()) {
+            success = false;
+            responseObject.insert("status", "failed, busy");
+        }
+
         if (numberFields == static_cast<unsigned>(object.size())) {
             if (success) {
                 PlotMailbox& mailbox = currentResourcePlotter->requestPlot(
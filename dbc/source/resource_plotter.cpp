@@ -27,6 +27,7 @@
 #include <QPair>
 #include <QList>
 #include <QImage>
+#include <QElapsedTimer>
 #include <QGraphicsScene>
 #include <QGraphicsLineItem>
 #include <QtCharts>
@@ -47,16 +48,103 @@
 #include "plot_mailbox.h"
 #include "resource_plotter.h"
 
+/***********************************************************************************************************************
+* ResourcePlotter::PlotJob
+*/
+
+ResourcePlotter::PlotJob::PlotJob(
+        ResourcePlotter*            plotter,
+        PlotMailbox*                mailbox,
+        ResourcePlotter::ThreadId   threadId,
+        ResourcePlotter::CustomerId customerId,
+        ResourcePlotter::ValueType  valueType,
+        unsigned long long          startTimestamp,
+        unsigned long long          endTimestamp,
+        float                       scaleFactor,
+        const QString&              titleText,
+        const QString&              xAxisTitle,
+        const QString&              yAxisTitle,
+        const QString&              dateFormatString,
+        const QString&              titleFont,
+        const QString&              axisTitleFont,
+        const QString&              axisLabelFont,
+        unsigned                    width,
+        unsigned                    height
+    ):PlotWorkerPool::Job(
+        mailbox
+    ),currentPlotter(
+        plotter
+    ),currentThreadId(
+        threadId
+    ),currentCustomerId(
+        customerId
+    ),currentValueType(
+        valueType
+    ),currentStartTimestamp(
+        startTimestamp
+    ),currentEndTimestamp(
+        endTimestamp
+    ),currentScaleFactor(
+        scaleFactor
+    ),currentTitleText(
+        titleText
+    ),currentXAxisTitle(
+        xAxisTitle
+    ),currentYAxisTitle(
+        yAxisTitle
+    ),currentDateFormatString(
+        dateFormatString
+    ),currentTitleFont(
+        titleFont
+    ),currentAxisTitleFont(
+        axisTitleFont
+    ),currentAxisLabelFont(
+        axisLabelFont
+    ),currentWidth(
+        width
+    ),currentHeight(
+        height
+    ) {}
+
+
+ResourcePlotter::PlotJob::~PlotJob() {}
+
+
+void ResourcePlotter::PlotJob::run(unsigned databaseThreadId) {
+    currentPlotter->generatePlot(
+        currentThreadId,
+        currentCustomerId,
+        currentValueType,
+        currentStartTimestamp,
+        currentEndTimestamp,
+        currentScaleFactor,
+        currentTitleText,
+        currentXAxisTitle,
+        currentYAxisTitle,
+        currentDateFormatString,
+        currentTitleFont,
+        currentAxisTitleFont,
+        currentAxisLabelFont,
+        currentWidth,
+        currentHeight,
+        databaseThreadId
+    );
+}
+
+/***********************************************************************************************************************
+* ResourcePlotter
+*/
+
 ResourcePlotter::ResourcePlotter(
-        Resources* resources,
-        QObject*   parent
+        Resources*      resources,
+        PlotWorkerPool* plotWorkerPool,
+        QObject*        parent
     ):PlotterBase(
+        plotWorkerPool,
         parent
     ),currentResources(
         resources
-    ) {
-    connect(this, &ResourcePlotter::issueRequestPlot, this, &ResourcePlotter::generatePlot);
-}
+    ) {}
 
 
 ResourcePlotter::~ResourcePlotter() {}
@@ -82,22 +170,26 @@ PlotMailbox& ResourcePlotter::requestPlot(
     PlotMailbox& mb = mailbox(threadId);
     mb.forceEmpty();
 
-    emit issueRequestPlot(
-        threadId,
-        customerId,
-        valueType,
-        startTimestamp,
-        endTimestamp,
-        scaleFactor,
-        titleText,
-        xAxisTitle,
-        yAxisTitle,
-        dateFormatString,
-        titleFont,
-        axisTitleFont,
-        axisLabelFont,
-        width,
-        height
+    enqueue(
+        new PlotJob(
+            this,
+            &mb,
+            threadId,
+            customerId,
+            valueType,
+            startTimestamp,
+            endTimestamp,
+            scaleFactor,
+            titleText,
+            xAxisTitle,
+            yAxisTitle,
+            dateFormatString,
+            titleFont,
+            axisTitleFont,
+            axisLabelFont,
+            width,
+            height
+        )
     );
 
     return mb;
@@ -143,10 +235,14 @@ void ResourcePlotter::generatePlot(
         const QString&     axisTitleFont,
         const QString&     axisLabelFont,
         unsigned           width,
-        unsigned           height
+        unsigned           height,
+        unsigned           databaseThreadId
     ) {
     typedef Resources::ResourceList ResourceList;
 
+    QElapsedTimer plotTimer;
+    plotTimer.start();
+
     fixTimestamp(startTimestamp, endTimestamp);
 
     ResourceList resources = currentResources->getResources(
@@ -157,13 +253,12 @@ void ResourcePlotter::generatePlot(
         databaseThreadId
     );
 
-    QtCharts::QLineSeries* series = new QtCharts::QLineSeries();
+    QVector<QPointF> points;
 
     QColor inesonicBlue(0x17, 0x6E, 0xDA);
 //    QColor inesonicOrange(0xE0, 0x7E, 0x26);
 
     QPen seriesPen(QBrush(inesonicBlue), 1.5);
-    series->setPen(seriesPen);
 
     unsigned resourcesListSize = static_cast<unsigned>(resources.size());
     bool     showDayOfWeek     = (dateFormatString == "dow");
@@ -194,7 +289,7 @@ void ResourcePlotter::generatePlot(
                 const Resource& resource = resources.at(i);
                 double dow = 1 + static_cast<double>(resource.unixTimestamp() - weekStartTimestamp) / secondsPerDay;
                 double v   = resource.value() * scaleFactor;
-                series->append(dow, v);
+                points.append(QPointF(dow, v));
 
                 if (v < minimumValue) {
                     minimumValue = v;
@@ -208,7 +303,7 @@ void ResourcePlotter::generatePlot(
             for (unsigned i=0 ; i<resourcesListSize ; ++i) {
                 const Resource& resource = resources.at(i);
                 double          v        = resource.value() * scaleFactor;
-                series->append(resource.unixTimestamp() * 1000, v);
+                points.append(QPointF(resource.unixTimestamp() * 1000.0, v));
 
                 if (v < minimumValue) {
                     minimumValue = v;
@@ -232,81 +327,114 @@ void ResourcePlotter::generatePlot(
         maximumValue = 1;
     }
 
-    QtCharts::QChart* chart = new QtCharts::QChart();
-    chart->addSeries(series);
+    qint64 dataTime     = plotTimer.nsecsElapsed();
+    bool   fastRenderer = useFastRenderer(width, height);
 
-    chart->legend()->hide();
-    chart->setTitle(titleText);
+    QImage result;
+    if (fastRenderer) {
+        Canvas canvas(width, height);
+        canvas.setTitle(titleText, titleFont);
+        canvas.setAxisTitles(xAxisTitle, yAxisTitle, axisTitleFont);
+        canvas.setAxisLabelFont(axisLabelFont);
 
-    bool fontOk;
-    QFont newTitleFont = toFont(titleFont, &fontOk);
-    if (fontOk) {
-        chart->setTitleFont(newTitleFont);
-    }
+        if (showDayOfWeek) {
+            canvas.setHorizontalDayOfWeekAxis();
+        } else if (points.isEmpty()) {
+            canvas.setHorizontalDateTimeAxis(startTimestamp * 1000.0, endTimestamp * 1000.0, dateFormatString);
+        } else {
+            canvas.setHorizontalDateTimeAxis(points.first().x(), points.last().x(), dateFormatString);
+        }
+
+        unsigned recommendedTickCount = calculateNiceRange(minimumValue, maximumValue);
+        canvas.setVerticalAxis(minimumValue, maximumValue, recommendedTickCount);
+
+        canvas.drawFrame();
+        canvas.drawLine(points, seriesPen);
 
-    QtCharts::QAbstractAxis* axisX;
-    if (showDayOfWeek) {
-        QtCharts::QCategoryAxis* axisXValue = new QtCharts::QCategoryAxis();
-        axisXValue->setTickCount(8);
-        axisXValue->setLabelFormat("%1.0f");
-        axisXValue->setRange(1.0, 8.0);
-        axisXValue->append("Mon", 2.0);
-        axisXValue->append("Tue", 3.0);
-        axisXValue->append("Wed", 4.0);
-        axisXValue->append("Thu", 5.0);
-        axisXValue->append("Fri", 6.0);
-        axisXValue->append("Sat", 7.0);
-        axisXValue->append("Sun", 8.0);
-        axisX = axisXValue;
+        result = canvas.image();
     } else {
-        QtCharts::QDateTimeAxis* axisXDateTime = new QtCharts::QDateTimeAxis;
-        axisXDateTime->setTickCount(5);
-        axisXDateTime->setFormat(dateFormatString); // "MMM dd - hh:mm");
+        QtCharts::QLineSeries* series = new QtCharts::QLineSeries();
+        series->replace(points);
+        series->setPen(seriesPen);
 
-        axisX = axisXDateTime;
-    }
+        QtCharts::QChart* chart = new QtCharts::QChart();
+        chart->addSeries(series);
 
-    axisX->setTitleText(xAxisTitle);
-    chart->addAxis(axisX, Qt::AlignmentFlag::AlignBottom);
+        chart->legend()->hide();
+        chart->setTitle(titleText);
 
-    series->attachAxis(axisX);
+        bool fontOk;
+        QFont newTitleFont = toFont(titleFont, &fontOk);
+        if (fontOk) {
+            chart->setTitleFont(newTitleFont);
+        }
 
-    QtCharts::QValueAxis* axisY = new QtCharts::QValueAxis;
-    axisY->setTitleText(yAxisTitle);
+        QtCharts::QAbstractAxis* axisX;
+        if (showDayOfWeek) {
+            QtCharts::QCategoryAxis* axisXValue = new QtCharts::QCategoryAxis();
+            axisXValue->setTickCount(8);
+            axisXValue->setLabelFormat("%1.0f");
+            axisXValue->setRange(1.0, 8.0);
+            axisXValue->append("Mon", 2.0);
+            axisXValue->append("Tue", 3.0);
+            axisXValue->append("Wed", 4.0);
+            axisXValue->append("Thu", 5.0);
+            axisXValue->append("Fri", 6.0);
+            axisXValue->append("Sat", 7.0);
+            axisXValue->append("Sun", 8.0);
+            axisX = axisXValue;
+        } else {
+            QtCharts::QDateTimeAxis* axisXDateTime = new QtCharts::QDateTimeAxis;
+            axisXDateTime->setTickCount(5);
+            axisXDateTime->setFormat(dateFormatString); // "MMM dd - hh:mm");
 
-    QFont newAxisTitleFont = toFont(axisTitleFont, &fontOk);
-    if (fontOk) {
-        axisX->setTitleFont(newAxisTitleFont);
-        axisY->setTitleFont(newAxisTitleFont);
-    }
+            axisX = axisXDateTime;
+        }
 
-    QFont newAxisLabelFont = toFont(axisLabelFont, &fontOk);
-    if (fontOk) {
-        axisX->setLabelsFont(newAxisLabelFont);
-        axisY->setLabelsFont(newAxisLabelFont);
-    }
+        axisX->setTitleText(xAxisTitle);
+        chart->addAxis(axisX, Qt::AlignmentFlag::AlignBottom);
+
+        series->attachAxis(axisX);
+
+        QtCharts::QValueAxis* axisY = new QtCharts::QValueAxis;
+        axisY->setTitleText(yAxisTitle);
 
-    chart->addAxis(axisY, Qt::AlignmentFlag::AlignLeft);
-    series->attachAxis(axisY);
+        QFont newAxisTitleFont = toFont(axisTitleFont, &fontOk);
+        if (fontOk) {
+            axisX->setTitleFont(newAxisTitleFont);
+            axisY->setTitleFont(newAxisTitleFont);
+        }
+
+        QFont newAxisLabelFont = toFont(axisLabelFont, &fontOk);
+        if (fontOk) {
+            axisX->setLabelsFont(newAxisLabelFont);
+            axisY->setLabelsFont(newAxisLabelFont);
+        }
 
-    unsigned recommendedTickCount = calculateNiceRange(minimumValue, maximumValue);
-    static_cast<QtCharts::QValueAxis*>(axisY)->setRange(minimumValue, maximumValue);
-    static_cast<QtCharts::QValueAxis*>(axisY)->setTickCount(recommendedTickCount + 1);
-    static_cast<QtCharts::QValueAxis*>(axisY)->setMinorTickCount(1);
+        chart->addAxis(axisY, Qt::AlignmentFlag::AlignLeft);
+        series->attachAxis(axisY);
 
-    QGraphicsScene scene;
-    scene.addItem(chart);
+        unsigned recommendedTickCount = calculateNiceRange(minimumValue, maximumValue);
+        static_cast<QtCharts::QValueAxis*>(axisY)->setRange(minimumValue, maximumValue);
+        static_cast<QtCharts::QValueAxis*>(axisY)->setTickCount(recommendedTickCount + 1);
+        static_cast<QtCharts::QValueAxis*>(axisY)->setMinorTickCount(1);
 
-    chart->setGeometry(0, 0, width, height);
-    scene.setSceneRect(0, 0, width, height);
+        QGraphicsScene scene;
+        scene.addItem(chart);
 
-    QImage result(width, height, QImage::Format::Format_RGB888);
-    result.fill(Qt::GlobalColor::white);
+        chart->setGeometry(0, 0, width, height);
+        scene.setSceneRect(0, 0, width, height);
 
-    QPainter painter(&result);
+        result = QImage(width, height, QImage::Format::Format_RGB888);
+        result.fill(Qt::GlobalColor::white);
+
+        QPainter painter(&result);
+
+        scene.render(&painter);
+        painter.end();
+    }
 
-    scene.render(&painter);
-    painter.end();
+    recordPlotTiming(QString("resource"), fastRenderer, points.size(), dataTime, plotTimer.nsecsElapsed() - dataTime);
 
     PlotMailbox& mb = mailbox(threadId);
     mb.sendImage(result);
@@ -20,70 +20,215 @@
 
 #include <QObject>
 #include <QThread>
-#include <QTimer>
 #include <QString>
 #include <QByteArray>
 #include <QHash>
+#include <QSet>
+#include <QPair>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlDriver>
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QVariant>
+#include <QDateTime>
 #include <QMutex>
 #include <QMutexLocker>
-#include <QDateTime>
+#include <QWaitCondition>
+#include <QElapsedTimer>
 
 #include <cstdint>
+#include <climits>
+#include <limits>
+#include <algorithm>
 
 #include "log.h"
+#include "metrics_registry.h"
+#include "periodic_scheduler.h"
 #include "customer_capabilities.h"
 #include "active_resources.h"
 #include "resource.h"
 #include "database_manager.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
+#include "statement_pipeline.h"
+#include "thread_placement.h"
 #include "resources.h"
 
+/***********************************************************************************************************************
+* Resources::Flusher
+*/
+
+Resources::Flusher::Flusher(Resources* owner):currentOwner(owner) {
+    start();
+}
+
+
+Resources::Flusher::~Flusher() {
+    wait();
+}
+
+
+void Resources::Flusher::run() {
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::RESOURCES);
+
+    currentOwner->queueMutex.lock();
+
+    while (!currentOwner->flushStopRequested) {
+        unsigned long waitMilliseconds;
+        if (currentOwner->flushDue(waitMilliseconds)) {
+            ResourceList resources;
+            resources.swap(currentOwner->queuedResources);
+
+            currentOwner->queueMutex.unlock();
+            bool success = currentOwner->writeResources(resources);
+            currentOwner->queueMutex.lock();
+
+            if (!success) {
+                // Rows are inserted with ON CONFLICT DO NOTHING so rows written before the failure can safely be
+                // written again.  We hold off a full flush interval so a lost database doesn't spin this thread.
+                resources.append(currentOwner->queuedResources);
+                currentOwner->queuedResources.swap(resources);
+                currentOwner->oldestQueuedMilliseconds = currentOwner->queueClock.elapsed();
+
+                if (!currentOwner->flushStopRequested) {
+                    currentOwner->queueCondition.wait(
+                        &currentOwner->queueMutex,
+                        currentOwner->currentFlushMaximumAgeMilliseconds
+                    );
+                }
+            }
+        } else {
+            currentOwner->queueCondition.wait(&currentOwner->queueMutex, waitMilliseconds);
+        }
+    }
+
+    ResourceList remaining;
+    remaining.swap(currentOwner->queuedResources);
+    currentOwner->queueMutex.unlock();
+
+    if (!remaining.isEmpty()) {
+        currentOwner->writeResources(remaining);
+    }
+}
+
 /***********************************************************************************************************************
 * Resources
 */
 
+const QString Resources::watermarkTableName("resources_aggregation_watermark");
+const QString Resources::resourcesTableName("resources");
+const QString Resources::summaryTableName("resource_summary");
+const QString Resources::expungeTaskName("resources_expunge");
+const QString Resources::aggregationTaskName("resources_aggregation");
+
 Resources::Resources(
         DatabaseManager* databaseManager,
         QObject*         parent
     ):QThread(
         parent
-    ),Cache<ActiveResources, Resource::CustomerId>(
+    ),ConcurrentCache<ActiveResources, Resource::CustomerId>(
         maximumCacheDepth
     ),currentDatabaseManager(
         databaseManager
     ) {
     currentMaximumResourceDataAge = 0;
 
-    expungeTimer = new QTimer(this);
-    expungeTimer->setSingleShot(false);
-    connect(expungeTimer, &QTimer::timeout, this, &Resources::startExpunge);
+    // Expunge and aggregation share this thread so both are kept in the database maintenance group.
+    PeriodicScheduler* scheduler = PeriodicScheduler::instance();
+    expungeTaskId = scheduler->registerTask(
+        expungeTaskName,
+        PeriodicScheduler::databaseMaintenanceGroup,
+        expungeJitter,
+        [this]() {
+            startExpunge();
+        },
+        [this]() {
+            return isRunning();
+        }
+    );
+    aggregationTaskId = scheduler->registerTask(
+        aggregationTaskName,
+        PeriodicScheduler::databaseMaintenanceGroup,
+        0,
+        [this]() {
+            startAggregation();
+        },
+        [this]() {
+            return isRunning();
+        }
+    );
+
+    expungePending.storeRelease(0);
+
+    oldestQueuedMilliseconds           = 0;
+    currentFlushMaximumEntries         = defaultFlushMaximumEntries;
+    currentFlushMaximumAgeMilliseconds = 1000UL * defaultFlushMaximumAge;
+    flushStopRequested                 = false;
+
+    queueClock.start();
+
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    flushedEntriesMetric = metricsRegistry->counter(
+        QString("dbc_resources_flushed_entries_total"),
+        QString("Number of queued resource entries written to the database.")
+    );
+    rejectedEntriesMetric = metricsRegistry->counter(
+        QString("dbc_resources_rejected_entries_total"),
+        QString("Number of resource entries rejected because the queue was full.")
+    );
+
+    metricsRegistry->addSampler(
+        MetricsRegistry::Type::GAUGE,
+        QString("dbc_resources_queue_depth"),
+        QString("Number of resource entries waiting to be written."),
+        QString(),
+        [this]() {
+            return static_cast<double>(numberQueuedEntries());
+        }
+    );
+
+    flusher = new Flusher(this);
 }
 
 
-Resources::~Resources() {}
+Resources::~Resources() {
+    PeriodicScheduler* scheduler = PeriodicScheduler::instance();
+    scheduler->unregisterTask(expungeTaskId);
+    scheduler->unregisterTask(aggregationTaskId);
+
+    MetricsRegistry::instance()->removeSeries(QString("dbc_resources_queue_depth"));
+
+    queueMutex.lock();
+    flushStopRequested = true;
+    queueCondition.wakeAll();
+    queueMutex.unlock();
+
+    delete flusher;
+}
 
 
 ActiveResources Resources::hasResourceData(CustomerId customerId, unsigned threadId) {
-    ActiveResources result;
+    RequestTracer::Span cacheSpan(RequestTracer::Phase::CACHE, threadId);
+    ActiveResources     result;
+
+    if (!getCacheEntry(customerId, result)) {
+        static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+            QString("Resources::hasResourceData")
+        );
+        MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+        RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
 
-    cacheMutex.lock();
-    const ActiveResources* activeResources = getCacheEntry(customerId);
-    if (activeResources == nullptr) {
-        cacheMutex.unlock();
         QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
         bool success = database.isOpen();
         if (success) {
             QSqlQuery query(database);
             query.setForwardOnly(true);
 
-            QString queryString = QString("SELECT DISTINCT value_type FROM resources WHERE customer_id = %1")
+            QString queryString = QString("SELECT value_type FROM %1 WHERE customer_id = %2")
+                                  .arg(summaryTableName)
                                   .arg(customerId);
-            success = query.exec(queryString);
+            success = SqlHelpers::execute(query, queryString);
             if (success) {
                 int valueTypeField   = query.record().indexOf("value_type");
                 bool hasResourceData = false;
@@ -106,11 +251,7 @@ ActiveResources Resources::hasResourceData(CustomerId customerId, unsigned threa
                 }
 
                 if (hasResourceData) {
-                    QMutexLocker locker(&cacheMutex);
-                    const ActiveResources* activeResources = getCacheEntry(customerId);
-                    if (activeResources == nullptr) {
-                        addToCache(result);
-                    }
+                    addToCacheIfAbsent(result);
                 }
             } else {
                 logWrite(QString("Failed SELECT - Resources::hasResourceData"), true);
@@ -122,9 +263,8 @@ ActiveResources Resources::hasResourceData(CustomerId customerId, unsigned threa
                 true
             );
         }
-    } else {
-        result = *activeResources;
-        cacheMutex.unlock();
+
+        currentDatabaseManager->closeAndRelease(database);
     }
 
     return result;
@@ -140,6 +280,12 @@ Resource Resources::recordResource(
     ) {
     Resource result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Resources::recordResource")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -159,14 +305,11 @@ Resource Resources::recordResource(
             query.bindValue(":timestamp1", static_cast<int>(unixTimestamp / 3600));
             query.bindValue(":timestamp2", static_cast<int>(unixTimestamp % 3600));
 
-            success = query.exec();
+            success = SqlHelpers::execute(query);
             if (success) {
-                result = Resource(customerId, valueType, value, unixTimestamp);
-
-                QMutexLocker cacheMutexLocker(&cacheMutex);
-                ActiveResources* activeResources = getCacheEntry(customerId);
-                if (activeResources != nullptr) {
-                    activeResources->setActive(valueType);
+                Resource resource(customerId, valueType, value, unixTimestamp);
+                if (updateSummary(query, ResourceList() << resource)) {
+                    result = resource;
                 }
             } else {
                 logWrite(
@@ -195,6 +338,51 @@ Resource Resources::recordResource(
 }
 
 
+bool Resources::queueResources(const Resources::ResourceList& resources) {
+    bool         result;
+    QMutexLocker queueMutexLocker(&queueMutex);
+
+    unsigned long numberQueued = static_cast<unsigned long>(queuedResources.size());
+    unsigned long numberNew    = static_cast<unsigned long>(resources.size());
+    if (numberQueued + numberNew <= maximumQueueDepth) {
+        if (numberNew > 0) {
+            // The first entry starts the age deadline and so must wake the flush thread.
+            if (numberQueued == 0) {
+                oldestQueuedMilliseconds = queueClock.elapsed();
+                queueCondition.wakeAll();
+            } else if (numberQueued + numberNew >= currentFlushMaximumEntries) {
+                queueCondition.wakeAll();
+            }
+
+            queuedResources.append(resources);
+        }
+
+        result = true;
+    } else {
+        rejectedEntriesMetric->increment(numberNew);
+        result = false;
+    }
+
+    return result;
+}
+
+
+void Resources::setFlushThresholds(unsigned long maximumEntries, unsigned long maximumAge) {
+    QMutexLocker queueMutexLocker(&queueMutex);
+
+    currentFlushMaximumEntries         = maximumEntries == 0 ? defaultFlushMaximumEntries : maximumEntries;
+    currentFlushMaximumAgeMilliseconds = 1000UL * (maximumAge == 0 ? defaultFlushMaximumAge : maximumAge);
+
+    queueCondition.wakeAll();
+}
+
+
+unsigned long Resources::numberQueuedEntries() {
+    QMutexLocker queueMutexLocker(&queueMutex);
+    return static_cast<unsigned long>(queuedResources.size());
+}
+
+
 Resources::ResourceList Resources::getResources(
         Resources::CustomerId customerId,
         Resources::ValueType  valueType,
@@ -204,15 +392,48 @@ Resources::ResourceList Resources::getResources(
     ) {
     ResourceList result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Resources::getResources")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
         QSqlQuery query(database);
         query.setForwardOnly(true);
 
-        QString queryString = QString("SELECT * FROM resources WHERE customer_id = %1 AND value_type = %2")
-                              .arg(customerId)
-                              .arg(valueType);
+        // Aggregation tiers are presented with the same columns as the resources table so entries from either
+        // source are read the same way.
+        QString tableName = tableForRange(startTimestamp, endTimestamp);
+        QString queryString;
+        if (tableName == resourcesTableName) {
+            queryString = QString("SELECT * FROM resources WHERE customer_id = %1 AND value_type = %2")
+                          .arg(customerId)
+                          .arg(valueType);
+        } else {
+            // Bounding start_timestamp directly lets the planner use the tier's index and partitions.
+            unsigned long long lastTimestamp = std::min(
+                endTimestamp == 0 ? std::numeric_limits<unsigned long long>::max() : endTimestamp,
+                static_cast<unsigned long long>(std::numeric_limits<long long>::max())
+            );
+
+            queryString = QString(
+                              "SELECT * FROM ("
+                                  "SELECT customer_id, value_type, mean_value AS value, "
+                                         "start_timestamp / 3600 AS timestamp1, start_timestamp % 3600 AS timestamp2 "
+                                  "FROM %1 "
+                                  "WHERE customer_id = %2 AND value_type = %3 AND "
+                                        "start_timestamp >= %4 AND start_timestamp <= %5"
+                              ") AS tier WHERE TRUE"
+                          )
+                          .arg(tableName)
+                          .arg(customerId)
+                          .arg(valueType)
+                          .arg(startTimestamp)
+                          .arg(lastTimestamp);
+        }
 
         if (startTimestamp != 0) {
             queryString += QString(" AND (timestamp1 > %1 OR (timestamp1 = %2 AND timestamp2 >=%3))")
@@ -230,7 +451,7 @@ Resources::ResourceList Resources::getResources(
 
         queryString += QString(" ORDER BY timestamp1 ASC");
 
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             int customerIdField = query.record().indexOf("customer_id");
             int valueTypeField  = query.record().indexOf("value_type");
@@ -312,8 +533,10 @@ void Resources::purgeResources(Resources::CustomerId customerId, unsigned long l
             queryString += QString(" AND customer_id = %1").arg(customerId);
         }
 
-        success = query.exec(queryString);
-        if (!success) {
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            trimSummary(query, customerId, timestamp);
+        } else {
             logWrite(QString("Failed DELETE - Resources::purgeResources: %1").arg(query.lastError().text()), true);
         }
     } else {
@@ -330,16 +553,25 @@ void Resources::purgeResources(Resources::CustomerId customerId, unsigned long l
 
 void Resources::setMaximumAge(unsigned long newMaximumAge) {
     currentMaximumResourceDataAge = newMaximumAge;
+    updateSchedule();
+}
 
-    if (newMaximumAge == 0) {
-        if (expungeTimer->isActive()) {
-            expungeTimer->stop();
-        }
-    } else {
-        if (!expungeTimer->isActive()) {
-            expungeTimer->start(expungeTimerPeriod);
-        }
-    }
+
+void Resources::setAggregationTiers(const Resources::AggregationTierList& aggregationTiers) {
+    tiersMutex.lock();
+    currentAggregationTiers = aggregationTiers;
+    tiersMutex.unlock();
+
+    updateSchedule();
+}
+
+
+void Resources::setPartitionPeriods(const Resources::PartitionPeriods& partitionPeriods) {
+    tiersMutex.lock();
+    currentPartitionPeriods = partitionPeriods;
+    tiersMutex.unlock();
+
+    updateSchedule();
 }
 
 
@@ -349,102 +581,591 @@ Resources::CustomerId Resources::idFromValue(const ActiveResources& value) const
 
 
 void Resources::run() {
-    unsigned long long expungeThreshold = QDateTime::currentSecsSinceEpoch() - currentMaximumResourceDataAge;
+    ThreadPlacement::Scope placementScope(ThreadPlacement::Subsystem::RESOURCES);
+
+    tiersMutex.lock();
+    AggregationTierList aggregationTiers = currentAggregationTiers;
+    PartitionPeriods    partitionPeriods = currentPartitionPeriods;
+    tiersMutex.unlock();
 
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(expungeThreadId));
     bool success = database.isOpen();
     if (success) {
-        bool supportsTransactions;
-        if (database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions)) {
-            supportsTransactions = true;
-            database.transaction();
-        } else {
-            supportsTransactions = false;
+        createPartitions(database, aggregationTiers, partitionPeriods);
+
+        // Entries can sit in the flush queue for up to the flush age so the resources table is only complete up to
+        // that point.
+        queueMutex.lock();
+        unsigned long long flushAge = currentFlushMaximumAgeMilliseconds / 1000 + 1;
+        queueMutex.unlock();
+
+        unsigned long long currentTime    = QDateTime::currentSecsSinceEpoch();
+        unsigned long long inputThreshold = currentTime - std::min(currentTime, flushAge);
+
+        QString inputTableName = resourcesTableName;
+        for (  AggregationTierList::const_iterator it  = aggregationTiers.constBegin(),
+                                                   end = aggregationTiers.constEnd()
+             ; success && it != end
+             ; ++it
+            ) {
+            success        = aggregateTier(database, *it, inputTableName, inputThreshold);
+            inputTableName = it->tableName;
         }
 
-        QList<Resource::CustomerId> updatedCustomers;
-        QSqlQuery query(database);
+        if (expungePending.testAndSetOrdered(1, 0)) {
+            expungeEntries(database, aggregationTiers);
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database - Resources::run: %1").arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+}
+
+
+QString Resources::tableForRange(unsigned long long startTimestamp, unsigned long long endTimestamp) {
+    QString result = resourcesTableName;
+
+    if (startTimestamp != 0) {
+        unsigned long long currentTime  = QDateTime::currentSecsSinceEpoch();
+        unsigned long long lastTime     = endTimestamp == 0 ? currentTime : std::min(endTimestamp, currentTime);
+        unsigned long long span         = lastTime > startTimestamp ? lastTime - startTimestamp : 0;
+        unsigned long long finestPeriod = span / targetNumberPoints;
+
+        // A coarser tier is also used when the finer source has already expunged the start of the range.
+        bool covered = (
+               currentMaximumResourceDataAge == 0
+            || currentTime < currentMaximumResourceDataAge
+            || currentTime - currentMaximumResourceDataAge <= startTimestamp
+        );
+
+        QMutexLocker tiersMutexLocker(&tiersMutex);
+        for (  AggregationTierList::const_iterator it  = currentAggregationTiers.constBegin(),
+                                                   end = currentAggregationTiers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            const AggregationTier& tier = *it;
+            if (tier.resamplePeriod <= finestPeriod || !covered) {
+                result  = tier.tableName;
+                covered = (currentTime < tier.expungeAge || currentTime - tier.expungeAge <= startTimestamp);
+            }
+        }
+    }
+
+    return result;
+}
+
+
+void Resources::updateSchedule() {
+    tiersMutex.lock();
+    bool          hasTiers          = !currentAggregationTiers.isEmpty();
+    bool          hasPartitions     = !currentPartitionPeriods.isEmpty();
+    unsigned long aggregationPeriod = maximumAggregationPeriod;
+    for (  AggregationTierList::const_iterator it  = currentAggregationTiers.constBegin(),
+                                               end = currentAggregationTiers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        aggregationPeriod = std::min(aggregationPeriod, it->resamplePeriod);
+    }
+    tiersMutex.unlock();
+
+    PeriodicScheduler* scheduler = PeriodicScheduler::instance();
+    scheduler->setPeriod(expungeTaskId, currentMaximumResourceDataAge != 0 || hasTiers ? expungePeriod : 0);
+    scheduler->setPeriod(aggregationTaskId, hasTiers || hasPartitions ? std::max(aggregationPeriod, 1UL) : 0);
+}
+
+
+bool Resources::createPartitions(
+        QSqlDatabase&                         database,
+        const Resources::AggregationTierList& aggregationTiers,
+        const Resources::PartitionPeriods&    partitionPeriods
+    ) {
+    bool               success     = true;
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+
+    // The resources table is partitioned on timestamp1 which holds the hour of each entry.
+    unsigned long resourcesPeriod = partitionPeriods.value(resourcesTableName, 0) / 3600;
+    if (resourcesPeriod > 0) {
+        success = SqlHelpers::createPartitions(
+            database,
+            resourcesTableName,
+            static_cast<long long>(resourcesPeriod),
+            static_cast<long long>(currentTime / 3600),
+            static_cast<long long>(currentTime / 3600 + partitionsAhead * resourcesPeriod)
+        );
+    }
+
+    for (  AggregationTierList::const_iterator it  = aggregationTiers.constBegin(),
+                                               end = aggregationTiers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        unsigned long tierPeriod = partitionPeriods.value(it->tableName, 0);
+        if (tierPeriod > 0) {
+            unsigned long long startTimestamp = currentTime - std::min(
+                currentTime,
+                static_cast<unsigned long long>(it->resamplePeriod)
+            );
+
+            success = SqlHelpers::createPartitions(
+                database,
+                it->tableName,
+                static_cast<long long>(tierPeriod),
+                static_cast<long long>(startTimestamp),
+                static_cast<long long>(currentTime + partitionsAhead * tierPeriod)
+            ) && success;
+        }
+    }
+
+    return success;
+}
+
+
+bool Resources::aggregateTier(
+        QSqlDatabase&                     database,
+        const Resources::AggregationTier& tier,
+        const QString&                    inputTableName,
+        unsigned long long&               inputThreshold
+    ) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Resources::aggregateTier")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    unsigned long long period      = tier.resamplePeriod;
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+    unsigned long long startTime   = currentTime - std::min(
+        currentTime,
+        static_cast<unsigned long long>(tier.expungeAge)
+    );
+
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    bool success = query.prepare(
+        QString("SELECT time_threshold FROM %1 WHERE output_table = :output_table").arg(watermarkTableName)
+    );
+
+    if (success) {
+        query.bindValue(":output_table", tier.tableName);
+        success = SqlHelpers::execute(query);
+        if (success && query.next()) {
+            startTime = query.value(0).toULongLong(&success);
+        }
+    }
+
+    if (!success) {
+        logWrite(
+            QString("Failed SELECT watermark - Resources::aggregateTier: %1").arg(query.lastError().text()),
+            true
+        );
+    }
+
+    if (success) {
+        unsigned long long alignedStart = startTime - (startTime % period);
+        unsigned long long alignedEnd   = inputThreshold - (inputThreshold % period);
 
+        if (alignedEnd > alignedStart) {
+            QString selectString;
+            if (inputTableName == resourcesTableName) {
+                selectString = QString(
+                                   "SELECT customer_id, value_type, "
+                                          "((timestamp1::BIGINT * 3600 + timestamp2) / %1) * %1 AS period_start, "
+                                          "AVG(value), MIN(value), MAX(value), COUNT(*) "
+                                   "FROM resources "
+                                   "WHERE timestamp1 >= %2 AND timestamp1 <= %3 AND "
+                                         "timestamp1::BIGINT * 3600 + timestamp2 >= %4 AND "
+                                         "timestamp1::BIGINT * 3600 + timestamp2 < %5 "
+                                   "GROUP BY customer_id, value_type, period_start"
+                               )
+                               .arg(period)
+                               .arg(alignedStart / 3600)
+                               .arg((alignedEnd - 1) / 3600)
+                               .arg(alignedStart)
+                               .arg(alignedEnd);
+            } else {
+                selectString = QString(
+                                   "SELECT customer_id, value_type, (start_timestamp / %1) * %1 AS period_start, "
+                                          "SUM(mean_value * number_samples) / SUM(number_samples), "
+                                          "MIN(minimum_value), MAX(maximum_value), SUM(number_samples) "
+                                   "FROM %2 "
+                                   "WHERE start_timestamp >= %3 AND start_timestamp < %4 "
+                                   "GROUP BY customer_id, value_type, period_start"
+                               )
+                               .arg(period)
+                               .arg(inputTableName)
+                               .arg(alignedStart)
+                               .arg(alignedEnd);
+            }
+
+            bool supportsTransactions = database.driver()->hasFeature(QSqlDriver::DriverFeature::Transactions);
+            if (supportsTransactions) {
+                database.transaction();
+            }
+
+            // The roll-up and the watermark update are sent together; a failed roll-up aborts the watermark update
+            // on the server so the two can not drift apart.
+            StatementPipeline pipeline(database);
+            pipeline.append(
+                QString(
+                    "INSERT INTO %1 (customer_id, value_type, start_timestamp, mean_value, minimum_value, "
+                                    "maximum_value, number_samples) %2 "
+                    "ON CONFLICT (customer_id, value_type, start_timestamp) DO UPDATE SET "
+                        "mean_value = EXCLUDED.mean_value, "
+                        "minimum_value = EXCLUDED.minimum_value, "
+                        "maximum_value = EXCLUDED.maximum_value, "
+                        "number_samples = EXCLUDED.number_samples"
+                ).arg(tier.tableName).arg(selectString)
+            );
+            pipeline.append(
+                QString(
+                    "INSERT INTO %1 (output_table, time_threshold) VALUES (?, ?) "
+                    "ON CONFLICT (output_table) DO UPDATE SET time_threshold = EXCLUDED.time_threshold"
+                ).arg(watermarkTableName),
+                QVariantList() << tier.tableName << alignedEnd
+            );
+
+            success = pipeline.execute();
+            if (!success) {
+                logWrite(
+                    QString("Failed to aggregate %1 into %2 - Resources::aggregateTier: %3")
+                    .arg(inputTableName)
+                    .arg(tier.tableName)
+                    .arg(pipeline.lastError()),
+                    true
+                );
+            }
+
+            if (supportsTransactions) {
+                if (success) {
+                    success = database.commit();
+                    if (!success) {
+                        logWrite(
+                            QString("Failed commit - Resources::aggregateTier: %1").arg(database.lastError().text()),
+                            true
+                        );
+                    }
+                } else {
+                    database.rollback();
+                }
+            }
+        }
+
+        inputThreshold = std::max(alignedStart, alignedEnd);
+    }
+
+    return success;
+}
+
+
+bool Resources::expungeEntries(QSqlDatabase& database, const Resources::AggregationTierList& aggregationTiers) {
+    bool               success     = true;
+    unsigned long long currentTime = QDateTime::currentSecsSinceEpoch();
+
+    QSqlQuery query(database);
+    if (currentMaximumResourceDataAge != 0 && currentTime > currentMaximumResourceDataAge) {
+        unsigned long long expungeThreshold = currentTime - currentMaximumResourceDataAge;
+
+        bool partitioned;
+        success = SqlHelpers::dropPartitions(
+            database,
+            resourcesTableName,
+            static_cast<long long>(expungeThreshold / 3600),
+            partitioned
+        );
+
+        // Bounding timestamp1 as well lets the planner limit the delete to the partition straddling the threshold.
         QString queryString = QString(
-                                  "SELECT DISTINCT customer_id FROM resources "
-                                  "WHERE timestamp1 < %1 OR (timestamp1 = %2 AND timestamp2 < %3)"
+                                  "DELETE FROM resources "
+                                  "WHERE timestamp1 <= %1 AND (timestamp1 < %2 OR timestamp2 < %3)"
                               )
                               .arg(expungeThreshold / 3600)
                               .arg(expungeThreshold / 3600)
                               .arg(expungeThreshold % 3600);
 
-        success = query.exec(queryString);
-        if (success) {
-            int customerIdField = query.record().indexOf("customer_id");
-            if (customerIdField >= 0) {
-                while (success && query.next()) {
-                    Resource::CustomerId customerId = static_cast<Resource::CustomerId>(
-                        query.value(customerIdField).toUInt(&success)
-                    );
+        if (SqlHelpers::execute(query, queryString)) {
+            success = trimSummary(query, CustomerCapabilities::invalidCustomerId, expungeThreshold) && success;
+        } else {
+            logWrite(QString("Failed DELETE - Resources::expungeEntries: %1").arg(query.lastError().text()), true);
+            success = false;
+        }
+    }
 
-                    if (success) {
-                        updatedCustomers.append(customerId);
-                    }
-                }
+    for (  AggregationTierList::const_iterator it  = aggregationTiers.constBegin(),
+                                               end = aggregationTiers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        const AggregationTier& tier = *it;
+        if (currentTime > static_cast<unsigned long long>(tier.expungeAge) + tier.resamplePeriod) {
+            // Entries are keyed by the start of their period so an entry expires once its whole period has.
+            long long keyThreshold = static_cast<long long>(currentTime - tier.expungeAge - tier.resamplePeriod);
+
+            bool partitioned;
+            success = SqlHelpers::dropPartitions(database, tier.tableName, keyThreshold, partitioned) && success;
+
+            bool deleted = SqlHelpers::execute(
+                query,
+                QString("DELETE FROM %1 WHERE start_timestamp <= %2").arg(tier.tableName).arg(keyThreshold)
+            );
+
+            if (!deleted) {
+                logWrite(
+                    QString("Failed DELETE from %1 - Resources::expungeEntries: %2")
+                    .arg(tier.tableName)
+                    .arg(query.lastError().text()),
+                    true
+                );
 
-                if (!success) {
-                    logWrite(QString("Failed to read entry -- Resources::run: %1").arg(query.lastError().text()), true);
-                }
-            } else {
-                logWrite(QString("Invalid field ID -- Resources::run: %1").arg(query.lastError().text()), true);
                 success = false;
             }
+        }
+    }
+
+    return success;
+}
+
+
+bool Resources::flushDue(unsigned long& waitMilliseconds) const {
+    bool result;
+
+    if (queuedResources.isEmpty()) {
+        waitMilliseconds = ULONG_MAX;
+        result           = false;
+    } else if (static_cast<unsigned long>(queuedResources.size()) >= currentFlushMaximumEntries) {
+        result = true;
+    } else {
+        unsigned long age = static_cast<unsigned long>(queueClock.elapsed() - oldestQueuedMilliseconds);
+        if (age >= currentFlushMaximumAgeMilliseconds) {
+            result = true;
         } else {
-            logWrite(QString("Failed SELECT DISTINCT -- Resources::run: %1").arg(query.lastError().text()), true);
+            waitMilliseconds = currentFlushMaximumAgeMilliseconds - age;
+            result           = false;
         }
+    }
 
-        if (success) {
-            queryString = QString(
-                              "DELETE FROM resources "
-                              "WHERE timestamp1 < %1 OR (timestamp1 = %2 AND timestamp2 < %3)"
-                          )
-                          .arg(expungeThreshold / 3600)
-                          .arg(expungeThreshold / 3600)
-                          .arg(expungeThreshold % 3600);
+    return result;
+}
+
+
+bool Resources::writeResources(const Resources::ResourceList& resources) {
+    static const QString queryPrefix(
+        "INSERT INTO resources (customer_id, value_type, value, timestamp1, timestamp2) VALUES "
+    );
+    static const QString querySuffix(" ON CONFLICT DO NOTHING");
+
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Resources::writeResources")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+
+    unsigned long numberEntries = static_cast<unsigned long>(resources.size());
 
-            success = query.exec(queryString);
+    QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(flushThreadId));
+    bool success = database.isOpen();
+    if (success) {
+        QSqlQuery     query(database);
+        unsigned long index = 0;
+
+        while (success && index < numberEntries) {
+            QString       queryString = queryPrefix;
+            unsigned long numberRows  = 0;
+            while (index < numberEntries && numberRows < maximumRowsPerStatement) {
+                const Resource&    resource      = resources.at(index);
+                unsigned long long unixTimestamp = resource.unixTimestamp();
+
+                if (numberRows > 0) {
+                    queryString += QChar(',');
+                }
+
+                queryString += QString("(%1,%2,%3,%4,%5)")
+                               .arg(resource.customerId())
+                               .arg(static_cast<unsigned>(resource.valueType()))
+                               .arg(static_cast<double>(resource.value()), 0, 'g', 9)
+                               .arg(unixTimestamp / 3600)
+                               .arg(unixTimestamp % 3600);
+
+                ++numberRows;
+                ++index;
+            }
+
+            queryString += querySuffix;
+            success = SqlHelpers::execute(query, queryString);
             if (!success) {
-                logWrite(QString("Failed DELETE - Resources::run: %1").arg(query.lastError().text()), true);
+                logWrite(
+                    QString("Failed multi-row INSERT of %1 rows into resources: %2 -- retrying")
+                    .arg(numberRows)
+                    .arg(query.lastError().text()),
+                    true
+                );
             }
         }
 
         if (success) {
-            cacheMutex.lock();
-
-            for (  QList<Resource::CustomerId>::const_iterator it  = updatedCustomers.constBegin(),
-                                                               end = updatedCustomers.constEnd()
-                 ; it!=end
-                 ; ++it
-                ) {
-                evictCacheEntry(*it);
+            success = updateSummary(query, resources);
+        }
+    } else {
+        logWrite(
+            QString("Failed to open database for queued resources: %1 -- retrying")
+            .arg(database.lastError().text()),
+            true
+        );
+    }
+
+    currentDatabaseManager->closeAndRelease(database);
+
+    if (success) {
+        flushedEntriesMetric->increment(numberEntries);
+    }
+
+    return success;
+}
+
+
+bool Resources::updateSummary(QSqlQuery& query, const Resources::ResourceList& resources) {
+    static const QString queryPrefix = QString(
+        "INSERT INTO %1 (customer_id, value_type, first_timestamp, last_timestamp) VALUES "
+    ).arg(summaryTableName);
+    static const QString querySuffix = QString(
+        " ON CONFLICT (customer_id, value_type) DO UPDATE SET "
+            "first_timestamp = LEAST(%1.first_timestamp, EXCLUDED.first_timestamp), "
+            "last_timestamp = GREATEST(%1.last_timestamp, EXCLUDED.last_timestamp)"
+    ).arg(summaryTableName);
+
+    SummaryRanges summaryRanges;
+    for (  ResourceList::const_iterator it  = resources.constBegin(),
+                                        end = resources.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        SummaryKey         key           = SummaryKey(it->customerId(), it->valueType());
+        unsigned long long unixTimestamp = it->unixTimestamp();
+
+        SummaryRanges::iterator range = summaryRanges.find(key);
+        if (range == summaryRanges.end()) {
+            summaryRanges.insert(key, SummaryRange(unixTimestamp, unixTimestamp));
+        } else {
+            range->first  = std::min(range->first, unixTimestamp);
+            range->second = std::max(range->second, unixTimestamp);
+        }
+    }
+
+    bool                          success   = true;
+    SummaryRanges::const_iterator rangeIt   = summaryRanges.constBegin();
+    SummaryRanges::const_iterator rangesEnd = summaryRanges.constEnd();
+    while (success && rangeIt != rangesEnd) {
+        QString       queryString = queryPrefix;
+        unsigned long numberRows  = 0;
+        while (rangeIt != rangesEnd && numberRows < maximumRowsPerStatement) {
+            if (numberRows > 0) {
+                queryString += QChar(',');
             }
 
-            cacheMutex.unlock();
+            queryString += QString("(%1,%2,%3,%4)")
+                           .arg(rangeIt.key().first)
+                           .arg(static_cast<unsigned>(rangeIt.key().second))
+                           .arg(rangeIt.value().first)
+                           .arg(rangeIt.value().second);
 
-            if (supportsTransactions) {
-                success = database.commit();
-                if (!success) {
-                    logWrite(QString("Failed commit - Resources::run: %1").arg(database.lastError().text()), true);
+            ++numberRows;
+            ++rangeIt;
+        }
+
+        queryString += querySuffix;
+        success = SqlHelpers::execute(query, queryString);
+        if (!success) {
+            logWrite(
+                QString("Failed INSERT into %1: %2").arg(summaryTableName).arg(query.lastError().text()),
+                true
+            );
+        }
+    }
+
+    if (success) {
+        for (  SummaryRanges::const_iterator it  = summaryRanges.constBegin(),
+                                             end = summaryRanges.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            ValueType valueType = it.key().second;
+            modifyCacheEntry(
+                it.key().first,
+                [valueType](ActiveResources& activeResources) {
+                    activeResources.setActive(valueType);
                 }
-            }
-        } else if (supportsTransactions) {
-            success = database.rollback();
-            if (!success) {
-                logWrite(QString("Failed rollback - Resources::run: %1").arg(database.lastError().text()), true);
-            }
+            );
         }
     }
 
-    currentDatabaseManager->closeAndRelease(database);
+    return success;
+}
+
+
+bool Resources::trimSummary(QSqlQuery& query, CustomerId customerId, unsigned long long timestamp) {
+    QString customerCondition;
+    if (customerId != CustomerCapabilities::invalidCustomerId) {
+        customerCondition = QString(" AND customer_id = %1").arg(customerId);
+    }
+
+    // Value types whose newest entry was removed no longer have data so cached bitmaps for their customers are stale.
+    bool success = SqlHelpers::execute(
+        query,
+        QString("DELETE FROM %1 WHERE last_timestamp < %2%3 RETURNING customer_id")
+        .arg(summaryTableName)
+        .arg(timestamp)
+        .arg(customerCondition)
+    );
+
+    if (success) {
+        QSet<CustomerId> staleCustomers;
+        while (query.next()) {
+            staleCustomers.insert(static_cast<CustomerId>(query.value(0).toULongLong()));
+        }
+
+        for (  QSet<CustomerId>::const_iterator it  = staleCustomers.constBegin(),
+                                                end = staleCustomers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            evictCacheEntry(*it);
+        }
+
+        // The first remaining entry is at or after the threshold so the threshold is kept as a lower bound rather
+        // than scanning for the exact value.
+        success = SqlHelpers::execute(
+            query,
+            QString("UPDATE %1 SET first_timestamp = %2 WHERE first_timestamp < %2%3")
+            .arg(summaryTableName)
+            .arg(timestamp)
+            .arg(customerCondition)
+        );
+    }
+
+    if (!success) {
+        logWrite(
+            QString("Failed to trim %1 - Resources::trimSummary: %2")
+            .arg(summaryTableName)
+            .arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
 }
 
 
 void Resources::startExpunge() {
+    expungePending.storeRelease(1);
+    start();
+}
+
+
+void Resources::startAggregation() {
     start();
 }
 
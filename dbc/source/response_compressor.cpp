@@ -0,0 +1,179 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref ResponseCompressor class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QAtomicInteger>
+#include <QtEndian>
+
+#include <cstdint>
+
+#include "response_compressor.h"
+
+ResponseCompressor::ResponseCompressor():currentMinimumSize(
+        defaultMinimumSize
+    ),currentCompressionLevel(
+        defaultCompressionLevel
+    ) {}
+
+
+ResponseCompressor::~ResponseCompressor() {}
+
+
+void ResponseCompressor::setMinimumSize(unsigned long newMinimumSize) {
+    currentMinimumSize = newMinimumSize;
+}
+
+
+unsigned long ResponseCompressor::minimumSize() const {
+    return currentMinimumSize;
+}
+
+
+void ResponseCompressor::setCompressionLevel(int newCompressionLevel) {
+    currentCompressionLevel = newCompressionLevel;
+}
+
+
+int ResponseCompressor::compressionLevel() const {
+    return currentCompressionLevel;
+}
+
+
+ResponseCompressor::Encoding ResponseCompressor::selectEncoding(const QString& acceptEncoding) {
+    double gzipQuality    = 0;
+    double deflateQuality = 0;
+
+    QStringList entries = acceptEncoding.split(',');
+    for (QStringList::const_iterator it=entries.constBegin(),end=entries.constEnd() ; it!=end ; ++it) {
+        QStringList parameters = it->split(';');
+        QString     coding     = parameters.first().trimmed().toLower();
+        double      quality    = 1.0;
+
+        for (int i=1 ; i<parameters.size() ; ++i) {
+            QString parameter = parameters.at(i).trimmed().toLower();
+            if (parameter.startsWith("q=")) {
+                bool ok;
+                quality = parameter.mid(2).toDouble(&ok);
+                if (!ok) {
+                    quality = 0;
+                }
+            }
+        }
+
+        if (coding == "gzip" || coding == "x-gzip") {
+            gzipQuality = quality;
+        } else if (coding == "deflate") {
+            deflateQuality = quality;
+        } else if (coding == "*") {
+            if (gzipQuality == 0) {
+                gzipQuality = quality;
+            }
+
+            if (deflateQuality == 0) {
+                deflateQuality = quality;
+            }
+        }
+    }
+
+    Encoding result;
+    if (gzipQuality > 0 && gzipQuality >= deflateQuality) {
+        result = Encoding::GZIP;
+    } else if (deflateQuality > 0) {
+        result = Encoding::DEFLATE;
+    } else {
+        result = Encoding::IDENTITY;
+    }
+
+    return result;
+}
+
+
+QByteArray ResponseCompressor::compress(Encoding encoding, QByteArray& contentType, const QByteArray& data) const {
+    QByteArray    result;
+    unsigned long minimum = currentMinimumSize;
+
+    if (encoding == Encoding::IDENTITY || minimum == 0 || static_cast<unsigned long>(data.size()) < minimum) {
+        result = data;
+    } else {
+        // qCompress emits a 4 byte big endian length followed by a complete RFC 1950 zlib stream.
+        QByteArray compressed = qCompress(data, currentCompressionLevel);
+        if (compressed.size() <= 10) {
+            result = data;
+        } else if (encoding == Encoding::DEFLATE) {
+            result      = compressed.mid(4);
+            contentType = QByteArray("application/zlib");
+        } else {
+            // The gzip member wraps the raw deflate data from the zlib stream, dropping its 2 byte header and
+            // 4 byte Adler-32 trailer.
+            static const char gzipHeader[10] = {
+                '\x1F', '\x8B', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xFF'
+            };
+
+            char trailer[8];
+            qToLittleEndian<quint32>(crc32(data), trailer);
+            qToLittleEndian<quint32>(static_cast<quint32>(data.size()), trailer + 4);
+
+            result.reserve(compressed.size() + 12);
+            result.append(gzipHeader, 10);
+            result.append(compressed.constData() + 6, compressed.size() - 10);
+            result.append(trailer, 8);
+
+            contentType = QByteArray("application/gzip");
+        }
+    }
+
+    return result;
+}
+
+
+std::uint32_t ResponseCompressor::crc32(const QByteArray& data) {
+    // Initialization of function local statics is thread safe.
+    static const QVector<std::uint32_t> table = buildCrc32Table();
+
+    std::uint32_t       crc     = 0xFFFFFFFFU;
+    const std::uint8_t* current = reinterpret_cast<const std::uint8_t*>(data.constData());
+    const std::uint8_t* end     = current + data.size();
+
+    while (current != end) {
+        crc = table.at((crc ^ *current) & 0xFF) ^ (crc >> 8);
+        ++current;
+    }
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+
+QVector<std::uint32_t> ResponseCompressor::buildCrc32Table() {
+    QVector<std::uint32_t> result(256);
+
+    for (std::uint32_t i=0 ; i<256 ; ++i) {
+        std::uint32_t value = i;
+        for (unsigned bit=0 ; bit<8 ; ++bit) {
+            value = (value & 1) ? (0xEDB88320U ^ (value >> 1)) : (value >> 1);
+        }
+
+        result[static_cast<int>(i)] = value;
+    }
+
+    return result;
+}
@@ -19,14 +19,23 @@
 ***********************************************************************************************************************/
 
 #include <QObject>
+#include <QString>
+#include <QStringList>
 #include <QByteArray>
 #include <QUrl>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonValue>
+#include <QList>
+#include <QHash>
+#include <QtEndian>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
 
 #include <cmath>
+#include <cstring>
+#include <cstdint>
 
 #include "monitor.h"
 #include "monitors.h"
@@ -36,9 +45,61 @@
 #include "events.h"
 #include "latency_entry.h"
 #include "aggregated_latency_entry.h"
+#include "latency_rolling_statistics.h"
 #include "latency_interface_manager.h"
+#include "json_stream_writer.h"
+#include "metrics_registry.h"
 #include "rest_helpers.h"
 
+/***********************************************************************************************************************
+* RestHelpers::SerializationTimer
+*/
+
+RestHelpers::SerializationTimer::SerializationTimer(
+        const RestHelpers::SerializationMetrics& metrics,
+        unsigned long                            numberEntries,
+        const JsonStreamWriter*                  writer
+    ):currentMetrics(
+        metrics
+    ),currentNumberEntries(
+        numberEntries
+    ),currentWriter(
+        writer
+    ) {
+    startingSize = writer != nullptr ? writer->data().size() : 0;
+    timer.start();
+}
+
+
+RestHelpers::SerializationTimer::~SerializationTimer() {
+    currentMetrics.seconds->observe(timer.nsecsElapsed() / 1.0E9);
+    currentMetrics.entries->increment(currentNumberEntries);
+
+    if (currentWriter != nullptr) {
+        currentMetrics.bytes->increment(static_cast<unsigned long long>(currentWriter->data().size() - startingSize));
+    }
+}
+
+/***********************************************************************************************************************
+* RestHelpers
+*/
+
+const QByteArray RestHelpers::binaryLatencyContentType("application/vnd.speedsentry.latency");
+const QString RestHelpers::monitorIdKey("monitor_id");
+const QString RestHelpers::timestampKey("timestamp");
+const QString RestHelpers::latencyKey("latency");
+const QString RestHelpers::serverIdKey("server_id");
+const QString RestHelpers::regionIdKey("region_id");
+const QString RestHelpers::customerIdKey("customer_id");
+const QString RestHelpers::averageKey("average");
+const QString RestHelpers::varianceKey("variance");
+const QString RestHelpers::minimumKey("minimum");
+const QString RestHelpers::maximumKey("maximum");
+const QString RestHelpers::numberSamplesKey("number_samples");
+const QString RestHelpers::startTimestampKey("start_timestamp");
+const QString RestHelpers::endTimestampKey("end_timestamp");
+
+
 QJsonObject RestHelpers::convertToJson(const HostScheme& hostScheme, bool includeCustomerId) {
     QJsonObject result;
 
@@ -159,6 +220,12 @@ QJsonObject RestHelpers::convertToJson(
 
 
 QJsonObject RestHelpers::convertToJson(const Monitors::MonitorList& monitorList, bool includeCustomerId) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("monitors"),
+        QString("object")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(monitorList.size()));
+
     QJsonObject monitorArray;
     for (  Monitors::MonitorList::const_iterator monitorIterator    = monitorList.constBegin(),
                                                  monitorEndIterator = monitorList.constEnd()
@@ -550,6 +617,12 @@ QJsonObject RestHelpers::convertToJson(const Event& event, bool includeCustomerI
 
 
 QJsonArray RestHelpers::convertToJson(const Events::EventList& events, bool includeCustomerId, bool includeHash) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("events"),
+        QString("object")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(events.size()));
+
     QJsonArray result;
 
     for (Events::EventList::const_iterator it=events.constBegin(),end=events.constEnd() ; it!=end ; ++it) {
@@ -560,6 +633,86 @@ QJsonArray RestHelpers::convertToJson(const Events::EventList& events, bool incl
 }
 
 
+QJsonObject RestHelpers::convertToJson(const Events::MonitorStatusByMonitorId& monitorStatus) {
+    QJsonObject result;
+
+    for (  Events::MonitorStatusByMonitorId::const_iterator it  = monitorStatus.constBegin(),
+                                                            end = monitorStatus.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        result.insert(QString::number(it.key()), Monitor::toString(it.value()).toLower());
+    }
+
+    return result;
+}
+
+
+QString RestHelpers::convertToString(const Events::Cursor& cursor) {
+    return QString("%1.%2").arg(cursor.zoranTimestamp()).arg(cursor.eventId());
+}
+
+
+Events::Cursor RestHelpers::convertToCursor(const QString& cursorString, bool* ok) {
+    Events::Cursor result;
+    bool           success = false;
+
+    QStringList fields = cursorString.split('.');
+    if (fields.size() == 2) {
+        bool                   timestampOk = false;
+        bool                   eventIdOk   = false;
+        Events::ZoranTimeStamp timestamp   = static_cast<Events::ZoranTimeStamp>(fields.at(0).toULong(&timestampOk));
+        Events::EventId        eventId     = static_cast<Events::EventId>(fields.at(1).toULong(&eventIdOk));
+
+        if (timestampOk && eventIdOk && eventId != Events::invalidEventId) {
+            result  = Events::Cursor(timestamp, eventId);
+            success = true;
+        }
+    }
+
+    if (ok != nullptr) {
+        *ok = success;
+    }
+
+    return result;
+}
+
+
+Events::Cursor RestHelpers::nextCursor(const Events::EventList& events, unsigned long pageSize) {
+    Events::Cursor result;
+
+    if (pageSize != Events::unlimitedPageSize && static_cast<unsigned long>(events.size()) >= pageSize) {
+        const Event& lastEvent = events.last();
+        result = Events::Cursor(lastEvent.zoranTimestamp(), lastEvent.eventId());
+    }
+
+    return result;
+}
+
+
+void RestHelpers::writeJson(
+        JsonStreamWriter&        writer,
+        const QString&           key,
+        const Events::EventList& events,
+        bool                     includeCustomerId,
+        bool                     includeHash
+    ) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("events"),
+        QString("stream")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(events.size()), &writer);
+
+    writer.beginArray(key);
+
+    for (Events::EventList::const_iterator it=events.constBegin(),end=events.constEnd() ; it!=end ; ++it) {
+        writer.append(convertToJson(*it, includeCustomerId, includeHash));
+    }
+
+    writer.endArray();
+}
+
+
 QJsonObject RestHelpers::convertToJson(
         const LatencyEntry&           entry,
         const Servers::ServersById&   serversById,
@@ -570,30 +723,20 @@ QJsonObject RestHelpers::convertToJson(
     ) {
     QJsonObject result;
 
-    result.insert("monitor_id", static_cast<double>(entry.monitorId()));
-    result.insert("timestamp", static_cast<double>(entry.unixTimestamp()));
-    result.insert("latency", entry.latencyMicroseconds() * 1.0E-6);
+    result.insert(monitorIdKey, static_cast<double>(entry.monitorId()));
+    result.insert(timestampKey, static_cast<double>(entry.unixTimestamp()));
+    result.insert(latencyKey, entry.latencyMicroseconds() * 1.0E-6);
 
     if (includeServerId) {
-        result.insert("server_id", entry.serverId());
+        result.insert(serverIdKey, entry.serverId());
     }
 
     if (includeRegionId) {
-        if (serversById.contains(entry.serverId())) {
-            const Server& server = serversById.value(entry.serverId());
-            result.insert("region_id", server.regionId());
-        } else {
-            result.insert("region_id", Region::invalidRegionId);
-        }
+        result.insert(regionIdKey, regionIdForServer(entry.serverId(), serversById));
     }
 
     if (includeCustomerId) {
-        if (monitorsById.contains(entry.monitorId())) {
-            const Monitor& monitor = monitorsById.value(entry.monitorId());
-            result.insert("customer_id", static_cast<double>(monitor.customerId()));
-        } else {
-            result.insert("customer_id", static_cast<double>(CustomerCapabilities::invalidCustomerId));
-        }
+        result.insert(customerIdKey, static_cast<double>(customerIdForMonitor(entry.monitorId(), monitorsById)));
     }
 
     return result;
@@ -617,13 +760,13 @@ QJsonObject RestHelpers::convertToJson(
         includeCustomerId
     );
 
-    result.insert("average", entry.meanLatency() * 1.0E-6);
-    result.insert("variance", entry.varianceLatency() * 1.0E-12);
-    result.insert("minimum", entry.minimumLatency() * 1.0E-6);
-    result.insert("maximum", entry.maximumLatency() * 1.0E-6);
-    result.insert("number_samples", static_cast<double>(entry.numberSamples()));
-    result.insert("start_timestamp", static_cast<double>(entry.startTimestamp()));
-    result.insert("end_timestamp", static_cast<double>(entry.endTimestamp()));
+    result.insert(averageKey, entry.meanLatency() * 1.0E-6);
+    result.insert(varianceKey, entry.varianceLatency() * 1.0E-12);
+    result.insert(minimumKey, entry.minimumLatency() * 1.0E-6);
+    result.insert(maximumKey, entry.maximumLatency() * 1.0E-6);
+    result.insert(numberSamplesKey, static_cast<double>(entry.numberSamples()));
+    result.insert(startTimestampKey, static_cast<double>(entry.startTimestamp()));
+    result.insert(endTimestampKey, static_cast<double>(entry.endTimestamp()));
 
     return result;
 }
@@ -637,6 +780,12 @@ QJsonArray RestHelpers::convertToJson(
         bool                                             includeRegionId,
         bool                                             includeCustomerId
     ) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("latency"),
+        QString("object")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(entries.size()));
+
     QJsonArray result;
 
     for (  LatencyInterfaceManager::LatencyEntryList::const_iterator it  = entries.constBegin(),
@@ -669,6 +818,12 @@ QJsonArray RestHelpers::convertToJson(
         bool                                                       includeRegionId,
         bool                                                       includeCustomerId
     ) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("aggregated_latency"),
+        QString("object")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(entries.size()));
+
     QJsonArray result;
 
     for (  LatencyInterfaceManager::AggregatedLatencyEntryList::const_iterator it  = entries.constBegin(),
@@ -693,6 +848,269 @@ QJsonArray RestHelpers::convertToJson(
 }
 
 
+QJsonObject RestHelpers::convertToJson(const LatencyRollingStatistics::Summary& summary) {
+    QJsonObject result;
+
+    result.insert("mean", summary.meanLatency * 1.0E-6);
+    result.insert("variance", summary.varianceLatency * 1.0E-12);
+    result.insert("p50", summary.p50Latency * 1.0E-6);
+    result.insert("p90", summary.p90Latency * 1.0E-6);
+    result.insert("p99", summary.p99Latency * 1.0E-6);
+    result.insert("weight", summary.weight);
+    result.insert("last_timestamp", static_cast<double>(summary.lastUnixTimestamp));
+
+    return result;
+}
+
+
+void RestHelpers::writeJson(
+        JsonStreamWriter&                                writer,
+        const QString&                                   key,
+        const LatencyInterfaceManager::LatencyEntryList& entries,
+        const Servers::ServersById&                      serversById,
+        const Monitors::MonitorsById&                    monitorsById,
+        bool                                             includeServerId,
+        bool                                             includeRegionId,
+        bool                                             includeCustomerId
+    ) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("latency"),
+        QString("stream")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(entries.size()), &writer);
+
+    writer.beginArray(key);
+
+    for (  LatencyInterfaceManager::LatencyEntryList::const_iterator it  = entries.constBegin(),
+                                                                     end = entries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        writer.append(
+            convertToJson(*it, serversById, monitorsById, includeServerId, includeRegionId, includeCustomerId)
+        );
+    }
+
+    writer.endArray();
+}
+
+
+void RestHelpers::writeJson(
+        JsonStreamWriter&                                          writer,
+        const QString&                                             key,
+        const LatencyInterfaceManager::AggregatedLatencyEntryList& entries,
+        const Servers::ServersById&                                serversById,
+        const Monitors::MonitorsById&                              monitorsById,
+        bool                                                       includeServerId,
+        bool                                                       includeRegionId,
+        bool                                                       includeCustomerId
+    ) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("aggregated_latency"),
+        QString("stream")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(entries.size()), &writer);
+
+    writer.beginArray(key);
+
+    for (  LatencyInterfaceManager::AggregatedLatencyEntryList::const_iterator it  = entries.constBegin(),
+                                                                               end = entries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        writer.append(
+            convertToJson(*it, serversById, monitorsById, includeServerId, includeRegionId, includeCustomerId)
+        );
+    }
+
+    writer.endArray();
+}
+
+
+int RestHelpers::estimatedJsonSize(
+        const LatencyInterfaceManager::LatencyEntryList&           rawEntries,
+        const LatencyInterfaceManager::AggregatedLatencyEntryList& aggregatedEntries
+    ) {
+    // Roughly the width of one serialized entry with every optional field included.  Overestimating slightly costs
+    // less than the repeated reallocate-and-copy of a buffer that grows to several megabytes.
+    static constexpr int rawEntryBytes        = 112;
+    static constexpr int aggregatedEntryBytes = 320;
+    static constexpr int overheadBytes        = 128;
+
+    return overheadBytes + rawEntryBytes * rawEntries.size() + aggregatedEntryBytes * aggregatedEntries.size();
+}
+
+
+QByteArray RestHelpers::convertToBinary(
+        const LatencyInterfaceManager::LatencyEntryList&           rawEntries,
+        const LatencyInterfaceManager::AggregatedLatencyEntryList& aggregatedEntries,
+        const Servers::ServersById&                                serversById,
+        const Monitors::MonitorsById&                              monitorsById,
+        bool                                                       includeServerId,
+        bool                                                       includeRegionId,
+        bool                                                       includeCustomerId
+    ) {
+    QList<const LatencyEntry*> rawPointers;
+    QList<const LatencyEntry*> aggregatedPointers;
+
+    rawPointers.reserve(rawEntries.size());
+    for (  LatencyInterfaceManager::LatencyEntryList::const_iterator it  = rawEntries.constBegin(),
+                                                                     end = rawEntries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        rawPointers.append(&(*it));
+    }
+
+    aggregatedPointers.reserve(aggregatedEntries.size());
+    for (  LatencyInterfaceManager::AggregatedLatencyEntryList::const_iterator it  = aggregatedEntries.constBegin(),
+                                                                               end = aggregatedEntries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        aggregatedPointers.append(&(*it));
+    }
+
+    // Dictionaries are built in first-seen order so the indexes are small for the common single customer case.
+    QList<Region::RegionId>                 regionIds;
+    QList<CustomerCapabilities::CustomerId> customerIds;
+    RegionIndexes                           regionIndexes;
+    CustomerIndexes                         customerIndexes;
+
+    if (includeRegionId || includeCustomerId) {
+        QList<const LatencyEntry*> allPointers = rawPointers + aggregatedPointers;
+        for (  QList<const LatencyEntry*>::const_iterator it = allPointers.constBegin(), end = allPointers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            const LatencyEntry* entry = *it;
+
+            if (includeRegionId) {
+                Region::RegionId regionId = regionIdForServer(entry->serverId(), serversById);
+                if (!regionIndexes.contains(regionId)) {
+                    regionIndexes.insert(regionId, static_cast<unsigned long>(regionIds.size()));
+                    regionIds.append(regionId);
+                }
+            }
+
+            if (includeCustomerId) {
+                CustomerCapabilities::CustomerId customerId = customerIdForMonitor(entry->monitorId(), monitorsById);
+                if (!customerIndexes.contains(customerId)) {
+                    customerIndexes.insert(customerId, static_cast<unsigned long>(customerIds.size()));
+                    customerIds.append(customerId);
+                }
+            }
+        }
+    }
+
+    QByteArray result;
+    result.reserve(24 + 8 * rawPointers.size() + 40 * aggregatedPointers.size());
+
+    result.append("SSLB", 4);
+    result.append(static_cast<char>(1));
+    result.append(
+        static_cast<char>(
+              (includeServerId ? 0x01 : 0x00)
+            | (includeRegionId ? 0x02 : 0x00)
+            | (includeCustomerId ? 0x04 : 0x00)
+        )
+    );
+
+    char epoch[8];
+    qToLittleEndian<quint64>(LatencyEntry::startOfZoranEpoch, epoch);
+    result.append(epoch, 8);
+
+    if (includeRegionId) {
+        appendVarint(result, static_cast<unsigned long long>(regionIds.size()));
+        for (  QList<Region::RegionId>::const_iterator it = regionIds.constBegin(), end = regionIds.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            appendVarint(result, *it);
+        }
+    }
+
+    if (includeCustomerId) {
+        appendVarint(result, static_cast<unsigned long long>(customerIds.size()));
+        for (  QList<CustomerCapabilities::CustomerId>::const_iterator it  = customerIds.constBegin(),
+                                                                       end = customerIds.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            appendVarint(result, *it);
+        }
+    }
+
+    appendVarint(result, static_cast<unsigned long long>(rawPointers.size()));
+    appendLatencyColumns(
+        result,
+        rawPointers,
+        serversById,
+        monitorsById,
+        includeServerId,
+        includeRegionId,
+        includeCustomerId,
+        regionIndexes,
+        customerIndexes
+    );
+
+    appendVarint(result, static_cast<unsigned long long>(aggregatedPointers.size()));
+    appendLatencyColumns(
+        result,
+        aggregatedPointers,
+        serversById,
+        monitorsById,
+        includeServerId,
+        includeRegionId,
+        includeCustomerId,
+        regionIndexes,
+        customerIndexes
+    );
+
+    typedef LatencyInterfaceManager::AggregatedLatencyEntryList::const_iterator AggregatedIterator;
+    AggregatedIterator aggregatedBegin = aggregatedEntries.constBegin();
+    AggregatedIterator aggregatedEnd   = aggregatedEntries.constEnd();
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendZigZag(
+            result,
+            static_cast<long long>(it->startZoranTimestamp()) - static_cast<long long>(it->zoranTimestamp())
+        );
+    }
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendVarint(
+            result,
+            it->endZoranTimestamp() >= it->startZoranTimestamp()
+                ? it->endZoranTimestamp() - it->startZoranTimestamp()
+                : 0
+        );
+    }
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendDouble(result, it->meanLatency());
+    }
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendDouble(result, it->varianceLatency());
+    }
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendVarint(result, it->minimumLatency());
+    }
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendVarint(result, it->maximumLatency());
+    }
+
+    for (AggregatedIterator it=aggregatedBegin ; it!=aggregatedEnd ; ++it) {
+        appendVarint(result, it->numberSamples());
+    }
+
+    return result;
+}
+
+
 QJsonObject RestHelpers::convertToJson(const Resource& resource, bool includeCustomerId) {
     QJsonObject result;
 
@@ -713,6 +1131,12 @@ QJsonArray RestHelpers::convertToJson(
         bool                           fullEntry,
         bool                           includeCustomerId
     ) {
+    static const SerializationMetrics serializationMetric = serializationMetrics(
+        QString("resources"),
+        QString("object")
+    );
+    SerializationTimer serializationTimer(serializationMetric, static_cast<unsigned long>(resources.size()));
+
     QJsonArray result;
 
     if (fullEntry) {
@@ -738,3 +1162,149 @@ QJsonArray RestHelpers::convertToJson(
 
     return result;
 }
+
+
+QString RestHelpers::entityTag(
+        const QString&     path,
+        unsigned long      customerId,
+        unsigned long long dataVersion,
+        const QString&     variant
+    ) {
+    QCryptographicHash hash(QCryptographicHash::Algorithm::Sha1);
+    hash.addData(path.toUtf8());
+    hash.addData(QByteArray::number(static_cast<qulonglong>(customerId)));
+    hash.addData(QByteArray::number(dataVersion));
+    hash.addData(variant.toUtf8());
+
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+
+QString RestHelpers::ifNoneMatch(const QJsonDocument& request) {
+    return request.isObject() ? request.object().value("if_none_match").toString() : QString();
+}
+
+
+void RestHelpers::appendLatencyColumns(
+        QByteArray&                       result,
+        const QList<const LatencyEntry*>& entries,
+        const Servers::ServersById&       serversById,
+        const Monitors::MonitorsById&     monitorsById,
+        bool                              includeServerId,
+        bool                              includeRegionId,
+        bool                              includeCustomerId,
+        const RegionIndexes&              regionIndexes,
+        const CustomerIndexes&            customerIndexes
+    ) {
+    QList<const LatencyEntry*>::const_iterator begin = entries.constBegin();
+    QList<const LatencyEntry*>::const_iterator end   = entries.constEnd();
+
+    for (QList<const LatencyEntry*>::const_iterator it=begin ; it!=end ; ++it) {
+        appendVarint(result, (*it)->monitorId());
+    }
+
+    if (includeServerId) {
+        for (QList<const LatencyEntry*>::const_iterator it=begin ; it!=end ; ++it) {
+            appendVarint(result, (*it)->serverId());
+        }
+    }
+
+    if (includeRegionId) {
+        for (QList<const LatencyEntry*>::const_iterator it=begin ; it!=end ; ++it) {
+            appendVarint(result, regionIndexes.value(regionIdForServer((*it)->serverId(), serversById)));
+        }
+    }
+
+    if (includeCustomerId) {
+        for (QList<const LatencyEntry*>::const_iterator it=begin ; it!=end ; ++it) {
+            appendVarint(result, customerIndexes.value(customerIdForMonitor((*it)->monitorId(), monitorsById)));
+        }
+    }
+
+    long long lastZoranTimestamp = 0;
+    for (QList<const LatencyEntry*>::const_iterator it=begin ; it!=end ; ++it) {
+        long long zoranTimestamp = static_cast<long long>((*it)->zoranTimestamp());
+        appendZigZag(result, zoranTimestamp - lastZoranTimestamp);
+        lastZoranTimestamp = zoranTimestamp;
+    }
+
+    for (QList<const LatencyEntry*>::const_iterator it=begin ; it!=end ; ++it) {
+        appendVarint(result, (*it)->latencyMicroseconds());
+    }
+}
+
+
+void RestHelpers::appendVarint(QByteArray& result, unsigned long long value) {
+    while (value >= 0x80) {
+        result.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    result.append(static_cast<char>(value));
+}
+
+
+void RestHelpers::appendZigZag(QByteArray& result, long long value) {
+    appendVarint(
+        result,
+        (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63)
+    );
+}
+
+
+void RestHelpers::appendDouble(QByteArray& result, double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    char data[8];
+    qToLittleEndian<quint64>(bits, data);
+    result.append(data, 8);
+}
+
+
+Region::RegionId RestHelpers::regionIdForServer(Server::ServerId serverId, const Servers::ServersById& serversById) {
+    Servers::ServersById::const_iterator it = serversById.constFind(serverId);
+    return it != serversById.constEnd() ? it.value().regionId() : Region::invalidRegionId;
+}
+
+
+CustomerCapabilities::CustomerId RestHelpers::customerIdForMonitor(
+        Monitor::MonitorId            monitorId,
+        const Monitors::MonitorsById& monitorsById
+    ) {
+    Monitors::MonitorsById::const_iterator it = monitorsById.constFind(monitorId);
+    return it != monitorsById.constEnd() ? it.value().customerId() : CustomerCapabilities::invalidCustomerId;
+}
+
+
+RestHelpers::SerializationMetrics RestHelpers::serializationMetrics(const QString& kind, const QString& writer) {
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    QString          labels          = (
+          MetricsRegistry::label(QString("kind"), kind)
+        + QString(",")
+        + MetricsRegistry::label(QString("writer"), writer)
+    );
+
+    SerializationMetrics result;
+    result.seconds = metricsRegistry->histogram(
+        QString("dbc_json_serialization_seconds"),
+        QString("Time spent serializing lists of entries to JSON."),
+        labels
+    );
+    result.entries = metricsRegistry->counter(
+        QString("dbc_json_serialized_entries_total"),
+        QString("Number of entries serialized to JSON."),
+        labels
+    );
+    result.bytes   = nullptr;
+
+    if (writer == QString("stream")) {
+        result.bytes = metricsRegistry->counter(
+            QString("dbc_json_serialized_bytes_total"),
+            QString("Number of bytes written by streamed JSON serialization."),
+            labels
+        );
+    }
+
+    return result;
+}
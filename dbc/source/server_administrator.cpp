@@ -23,9 +23,15 @@
 #include <QMutex>
 #include <QMutexLocker>
 #include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 
+#include <memory>
+#include <atomic>
+
 #include "log.h"
 #include "region.h"
 #include "regions.h"
@@ -38,12 +44,16 @@
 #include "customer_capabilities.h"
 #include "customers_capabilities.h"
 #include "customer_mapping.h"
+#include "shard_map.h"
+#include "server_health_statistics.h"
 #include "outbound_rest_api_factory.h"
 #include "server_administrator.h"
 
 const QString ServerAdministrator::pollingServerStateInactiveEndpoint("/state/inactive");
 const QString ServerAdministrator::pollingServerRegionChangeEndpoint("/region/change");
 const QString ServerAdministrator::pollingServerCustomerPauseEndpoint("/customer/pause");
+const QString ServerAdministrator::pollingServerCustomerUpdateEndpoint("/customer/update");
+const unsigned ServerAdministrator::defaultReportFlushIntervalSeconds = 30;
 
 ServerAdministrator::ServerAdministrator(
         Servers*                serverDatabaseApi,
@@ -71,33 +81,49 @@ ServerAdministrator::ServerAdministrator(
     ),currentOutboundRestApiFactory(
         outboundRestApiFactory
     ) {
-    loadNeeded = true;
+    loadNeeded                    = true;
+    currentDeltaUpdates           = false;
+    currentSnapshot               = std::make_shared<const Snapshot>();
+    currentServerHealth           = nullptr;
+    currentHealthDegradationRatio = 0;
+
+    reportFlushTimer = new QTimer(this);
+    reportFlushTimer->setSingleShot(false);
+
+    connect(reportFlushTimer, &QTimer::timeout, this, &ServerAdministrator::reportFlushTimeout);
+    reportFlushTimer->start(1000 * defaultReportFlushIntervalSeconds);
 }
 
 
-ServerAdministrator::~ServerAdministrator() {}
+ServerAdministrator::~ServerAdministrator() {
+    flushServerReports();
+}
 
 
-Server ServerAdministrator::getServer(ServerId serverId, unsigned threadId) {
-    QMutexLocker locker(&accessMutex);
+ServerAdministrator::SnapshotPointer ServerAdministrator::snapshot(unsigned threadId) {
+    SnapshotPointer result = std::atomic_load(&currentSnapshot);
 
-    if (loadNeeded) {
-        updateLocalCache(threadId);
+    if (!result->isLoaded()) {
+        QMutexLocker locker(&accessMutex);
+
+        if (loadNeeded) {
+            updateLocalCache(threadId);
+        }
+
+        result = std::atomic_load(&currentSnapshot);
     }
 
-    return serversById.value(serverId);
+    return result;
 }
 
 
-Server ServerAdministrator::getServer(const QString& identifier, unsigned threadId) {
-    QMutexLocker locker(&accessMutex);
+Server ServerAdministrator::getServer(ServerId serverId, unsigned threadId) {
+    return snapshot(threadId)->server(serverId);
+}
 
-    if (loadNeeded) {
-        updateLocalCache(threadId);
-    }
 
-    ServerId serverId = serverIdsByIdentifier.value(identifier, Server::invalidServerId);
-    return serverId != Server::invalidServerId ? serversById.value(serverId) : Server();
+Server ServerAdministrator::getServer(const QString& identifier, unsigned threadId) {
+    return snapshot(threadId)->server(identifier);
 }
 
 
@@ -106,11 +132,8 @@ ServerAdministrator::ServerList ServerAdministrator::getServers(
         Status   status,
         unsigned threadId
     ) {
-    QMutexLocker locker(&accessMutex);
-
-    if (loadNeeded) {
-        updateLocalCache(threadId);
-    }
+    SnapshotPointer    servers     = snapshot(threadId);
+    const ServersById& serversById = servers->serversById();
 
     ServerList result;
     for (ServersById::const_iterator it=serversById.constBegin(),end=serversById.constEnd() ; it!=end ; ++it) {
@@ -126,17 +149,59 @@ ServerAdministrator::ServerList ServerAdministrator::getServers(
 }
 
 
-const ServerAdministrator::ServersById& ServerAdministrator::getServersById(unsigned threadId) {
-    QMutexLocker locker(&accessMutex);
+ServerAdministrator::ServersById ServerAdministrator::getServersById(unsigned threadId) {
+    return snapshot(threadId)->serversById();
+}
 
-    if (loadNeeded) {
-        updateLocalCache(threadId);
+
+Server ServerAdministrator::recordServerReport(
+        const QString&              identifier,
+        ServerAdministrator::Status status,
+        float                       monitorsPerSecond,
+        float                       cpuLoading,
+        float                       memoryLoading,
+        unsigned                    threadId
+    ) {
+    // Reports that leave the server unchanged are answered from the snapshot without taking the writer mutex.
+    Server result = snapshot(threadId)->server(identifier);
+    if (result.isValid()                                  &&
+        (result.status() != status                       ||
+         result.monitorsPerSecond() != monitorsPerSecond ||
+         result.cpuLoading() != cpuLoading               ||
+         result.memoryLoading() != memoryLoading            )    ) {
+        QMutexLocker locker(&accessMutex);
+
+        ServersById::iterator it = serversById.find(result.serverId());
+        if (it != serversById.end()) {
+            Server& server = it.value();
+
+            // The region tables hold their own copies so they're replaced to keep loading current for server
+            // selection.
+            removeFromRegionTable(server);
+
+            server.setStatus(status);
+            server.setMonitorsPerSecond(monitorsPerSecond);
+            server.setCpuLoading(cpuLoading);
+            server.setMemoryLoading(memoryLoading);
+
+            addToRegionTable(server);
+            reportedServerIds.insert(server.serverId());
+
+            publishSnapshot();
+            result = server;
+        } else {
+            result = Server();
+        }
     }
 
-    return serversById;
+    return result;
 }
 
 
+void ServerAdministrator::setReportFlushInterval(unsigned intervalSeconds) {
+    reportFlushTimer->start(1000 * intervalSeconds);
+}
+
 
 Server ServerAdministrator::createServer(
         ServerAdministrator::RegionId regionId,
@@ -161,6 +226,7 @@ Server ServerAdministrator::createServer(
         accessMutex.lock();
         serversById.insert(result.serverId(), result);
         addServer(result);
+        publishSnapshot();
         accessMutex.unlock();
 
         sendGoInactive(result);
@@ -196,9 +262,13 @@ bool ServerAdministrator::deleteServer(ServerId serverId, unsigned threadId) {
     if (oldServer.isValid() && oldServer.status() == Status::DEFUNCT) {
         success = currentServers->deleteServer(oldServer, threadId);
         if (success) {
+            currentMapping->removeServer(serverId);
+            currentOutboundRestApiFactory->releaseOutboundRestApi(oldServer.identifier());
+            customerSyncStatesByServerId.remove(serverId);
             serversById.remove(serverId);
             serverIdsByIdentifier.remove(oldServer.identifier());
             removeFromRegionTable(oldServer);
+            publishSnapshot();
         }
     } else {
         logWrite(QString("Attempt to delete server that is not defunct, server ID %1").arg(serverId), true);
@@ -209,6 +279,74 @@ bool ServerAdministrator::deleteServer(ServerId serverId, unsigned threadId) {
 }
 
 
+void ServerAdministrator::setDeltaUpdates(bool enabled) {
+    QMutexLocker locker(&accessMutex);
+
+    currentDeltaUpdates = enabled;
+    if (!enabled) {
+        customerSyncStatesByServerId.clear();
+    }
+}
+
+
+void ServerAdministrator::setServerHealth(ServerHealthStatistics* serverHealth, double degradationRatio) {
+    accessMutex.lock();
+    currentServerHealth           = serverHealth;
+    currentHealthDegradationRatio = degradationRatio;
+    accessMutex.unlock();
+
+    updateServerHealth();
+}
+
+
+ServerHealthStatistics::HealthByServerId ServerAdministrator::getServerHealth(unsigned threadId) {
+    SnapshotPointer servers = snapshot(threadId);
+
+    accessMutex.lock();
+    ServerHealthStatistics* serverHealth     = currentServerHealth;
+    double                  degradationRatio = currentHealthDegradationRatio;
+    accessMutex.unlock();
+
+    return   serverHealth != nullptr
+           ? serverHealth->health(servers->serversById(), degradationRatio)
+           : ServerHealthStatistics::HealthByServerId();
+}
+
+
+void ServerAdministrator::flushServerReports(unsigned threadId) {
+    ServerList servers;
+
+    accessMutex.lock();
+
+    for (  QSet<ServerId>::const_iterator it  = reportedServerIds.constBegin(),
+                                          end = reportedServerIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        Server server = serversById.value(*it);
+        if (server.isValid()) {
+            servers.append(server);
+        }
+    }
+
+    reportedServerIds.clear();
+
+    accessMutex.unlock();
+
+    if (!servers.isEmpty()) {
+        bool success = currentServers->updateServerReports(servers, threadId);
+        if (!success) {
+            // Reports are retried at the next interval.  Newer reports simply overwrite these values.
+            accessMutex.lock();
+            for (ServerList::const_iterator it=servers.constBegin(),end=servers.constEnd() ; it!=end ; ++it) {
+                reportedServerIds.insert(it->serverId());
+            }
+            accessMutex.unlock();
+        }
+    }
+}
+
+
 void ServerAdministrator::sendGoActive(unsigned threadId) {
     QMutexLocker locker(&accessMutex);
 
@@ -294,6 +432,8 @@ bool ServerAdministrator::startServer(ServerAdministrator::ServerId serverId, un
         RegionId regionId    = server.regionId();
         unsigned regionIndex = regionIndexByRegionIds.value(regionId, static_cast<unsigned>(-1));
         if (regionIndex != static_cast<unsigned>(-1)) {
+            customerSyncStatesByServerId.remove(serverId);
+
             CustomerMapping::MappingsByCustomerId mappings  = currentMapping->mappings(serverId, threadId);
             QList<CustomerId>                     customers = mappings.keys();
 
@@ -358,12 +498,15 @@ bool ServerAdministrator::activateCustomer(ServerAdministrator::CustomerId custo
         threadId
     );
 
-    if (capabilities.isValid()) {
+    if (capabilities.isValid() && currentMapping->ownsCustomer(customerId, threadId)) {
+        CustomerMapping::Mapping oldMapping = currentMapping->mapping(customerId, threadId);
+
         QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> mappingData = assignServersToCustomer(
             customerId,
             false,
             capabilities.multiRegionChecking(),
             ServerExclusionList(),
+            nullptr,
             threadId
         );
 
@@ -371,6 +514,8 @@ bool ServerAdministrator::activateCustomer(ServerAdministrator::CustomerId custo
         const CustomerMapping::ServerSet removeFromServers = mappingData.second;
 
         currentMapping->updateMapping(customerId, newMapping, threadId);
+        projectPlacement(serverLoadIndex, oldMapping, newMapping, customerMonitorsPerSecond(capabilities, threadId));
+
         applyCustomerActivation(newMapping, removeFromServers, CustomerMapping::ServerSet(), capabilities, threadId);
 
         success = true;
@@ -402,6 +547,95 @@ bool ServerAdministrator::deactivateCustomer(ServerAdministrator::CustomerId cus
 }
 
 
+bool ServerAdministrator::activateCustomers(const ServerAdministrator::CustomerList& customerIds, unsigned threadId) {
+    bool success = true;
+
+    QMutexLocker locker(&accessMutex);
+
+    if (loadNeeded) {
+        updateLocalCache(threadId);
+    }
+
+    CustomersCapabilities::CustomerIdSet customerIdSet;
+    for (CustomerList::const_iterator it=customerIds.constBegin(),end=customerIds.constEnd() ; it!=end ; ++it) {
+        if (currentMapping->ownsCustomer(*it, threadId)) {
+            customerIdSet.insert(*it);
+        }
+    }
+
+    CustomersCapabilities::CapabilitiesByCustomerId capabilitiesByCustomerId =
+        currentCustomerCapabilities->getCustomerCapabilities(customerIdSet, threadId);
+
+    CustomerMessageBatch batch;
+    for (CustomerList::const_iterator it=customerIds.constBegin(),end=customerIds.constEnd() ; it!=end ; ++it) {
+        CustomerId           customerId   = *it;
+        CustomerCapabilities capabilities = capabilitiesByCustomerId.value(customerId);
+
+        if (capabilities.isValid()) {
+            CustomerMapping::Mapping oldMapping = currentMapping->mapping(customerId, threadId);
+
+            QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> mappingData = assignServersToCustomer(
+                customerId,
+                false,
+                capabilities.multiRegionChecking(),
+                ServerExclusionList(),
+                nullptr,
+                threadId
+            );
+
+            const CustomerMapping::Mapping   newMapping        = mappingData.first;
+            const CustomerMapping::ServerSet removeFromServers = mappingData.second;
+
+            currentMapping->updateMapping(customerId, newMapping, threadId);
+            projectPlacement(
+                serverLoadIndex,
+                oldMapping,
+                newMapping,
+                customerMonitorsPerSecond(capabilities, threadId)
+            );
+
+            applyCustomerActivation(
+                newMapping,
+                removeFromServers,
+                CustomerMapping::ServerSet(),
+                capabilities,
+                threadId,
+                &batch
+            );
+        } else if (customerIdSet.contains(customerId)) {
+            success = false;
+        }
+    }
+
+    sendCustomerMessageBatch(batch);
+    return success;
+}
+
+
+bool ServerAdministrator::deactivateCustomers(const ServerAdministrator::CustomerList& customerIds, unsigned threadId) {
+    bool success = true;
+
+    QMutexLocker locker(&accessMutex);
+
+    if (loadNeeded) {
+        updateLocalCache(threadId);
+    }
+
+    for (CustomerList::const_iterator it=customerIds.constBegin(),end=customerIds.constEnd() ; it!=end ; ++it) {
+        CustomerId               customerId = *it;
+        CustomerMapping::Mapping mapping    = currentMapping->mapping(customerId, threadId);
+
+        if (currentMapping->updateMapping(customerId, CustomerMapping::Mapping(), threadId)) {
+            applyCustomerDeactivation(customerId, mapping);
+        } else {
+            success = false;
+        }
+    }
+
+    return success;
+}
+
+
 bool ServerAdministrator::setPaused(CustomerId customerId, bool nowPaused, unsigned threadId) {
     bool success = true;
 
@@ -475,6 +709,8 @@ bool ServerAdministrator::reassignWorkload(
         ServerAdministrator::ServerId            fromServerId,
         const ServerAdministrator::CustomerList& customers,
         ServerAdministrator::ServerId            toServerId,
+        bool                                     dryRun,
+        ServerAdministrator::LoadingByServerId*  projectedLoading,
         unsigned                                 threadId
     ) {
     bool success = true;
@@ -486,74 +722,123 @@ bool ServerAdministrator::reassignWorkload(
         }
     }
 
+    if (success && customers.isEmpty() && !dryRun) {
+        Server fromServer = getServer(fromServerId, threadId);
+        fromServer.setStatus(Server::Status::INACTIVE);
+        success = modifyServer(fromServer, threadId);
+    }
+
     if (success) {
-        Server       fromServer = getServer(fromServerId, threadId);
-        CustomerList customersOnServer;
+        // Customer capabilities are fetched before taking the writer mutex so other writers, including server
+        // reports, are not held up by the database read.
+        CustomerList customersOnServer =   customers.isEmpty()
+                                         ? currentMapping->customerIds(fromServerId, threadId)
+                                         : customers;
+
+        CustomersCapabilities::CustomerIdSet customerIdSet;
+        for (  CustomerList::const_iterator it  = customersOnServer.constBegin(),
+                                            end = customersOnServer.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            customerIdSet.insert(*it);
+        }
 
-        if (customers.isEmpty()) {
-            fromServer.setStatus(Server::Status::INACTIVE);
-            success = modifyServer(fromServer, threadId);
+        CustomersCapabilities::CapabilitiesByCustomerId capabilitiesByCustomerId =
+            currentCustomerCapabilities->getCustomerCapabilities(customerIdSet, threadId);
 
-            CustomerMapping::MappingsByCustomerId mappingsByCustomerId = currentMapping->mappings(fromServerId);
-            customersOnServer = mappingsByCustomerId.keys();
-        } else {
-            customersOnServer = customers;
+        QMutexLocker locker(&accessMutex);
+
+        if (loadNeeded) {
+            updateLocalCache(threadId);
         }
 
-        if (success) {
-            unsigned long numberCustomers = static_cast<unsigned long>(customersOnServer.size());
-            for (unsigned long customerIndex=0 ; customerIndex<numberCustomers ; ++customerIndex) {
-                accessMutex.lock();
+        // Plan the complete new assignment before touching the database or the polling servers.  Placements are
+        // projected onto a copy of the load index so a dry run leaves the live projections untouched.
 
-                CustomerId           customerId   = customersOnServer.at(customerIndex);
-                CustomerCapabilities capabilities = currentCustomerCapabilities->getCustomerCapabilities(
-                    customerId,
-                    false,
-                    threadId
-                );
+        ServerLoadIndex                               loadIndex     = serverLoadIndex;
+        ServerExclusionList                           exclusionList = ServerExclusionList() << fromServerId;
+        CustomerMapping::MappingsByCustomerId         newMappings;
+        QHash<CustomerId, CustomerMapping::ServerSet> removedServersByCustomerId;
 
-                if (capabilities.isValid()) {
-                    CustomerMapping::Mapping   newMapping;
-                    CustomerMapping::ServerSet removeFromServers;
-
-                    if (toServerId != invalidServerId) {
-                        QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet>
-                            mappingData = assignServersToCustomer(
-                                customerId,
-                                false,
-                                capabilities.multiRegionChecking(),
-                                ServerExclusionList(),
-                                threadId
-                        );
+        for (  CustomerList::const_iterator customerIterator    = customersOnServer.constBegin(),
+                                            customerEndIterator = customersOnServer.constEnd()
+             ; customerIterator != customerEndIterator
+             ; ++customerIterator
+            ) {
+            CustomerId           customerId   = *customerIterator;
+            CustomerCapabilities capabilities = capabilitiesByCustomerId.value(customerId);
+
+            if (capabilities.isValid()) {
+                CustomerMapping::Mapping   oldMapping = currentMapping->mapping(customerId, threadId);
+                CustomerMapping::Mapping   newMapping;
+                CustomerMapping::ServerSet removeFromServers;
+
+                if (toServerId != invalidServerId) {
+                    newMapping = oldMapping;
+                    if (newMapping.remove(fromServerId)) {
+                        removeFromServers.insert(fromServerId);
+                        newMapping.insert(toServerId);
+
+                        if (newMapping.primaryServerId() == fromServerId) {
+                            newMapping.setPrimaryServer(toServerId);
+                        }
+                    }
+                } else {
+                    QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet>
+                        mappingData = assignServersToCustomer(
+                            customerId,
+                            false,
+                            capabilities.multiRegionChecking(),
+                            exclusionList,
+                            &loadIndex,
+                            threadId
+                    );
 
-                        newMapping        = mappingData.first;
-                        removeFromServers = mappingData.second;
+                    newMapping        = mappingData.first;
+                    removeFromServers = mappingData.second;
+                }
 
-                        if (newMapping.remove(fromServerId)) {
-                            removeFromServers.insert(fromServerId);
-                            newMapping.insert(toServerId);
-                        }
-                    } else {
-                        QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet>
-                            mappingData = assignServersToCustomer(
-                                customerId,
-                                false,
-                                capabilities.multiRegionChecking(),
-                                ServerExclusionList() << fromServerId,
-                                threadId
-                        );
+                projectPlacement(loadIndex, oldMapping, newMapping, customerMonitorsPerSecond(capabilities, threadId));
 
-                        newMapping        = mappingData.first;
-                        removeFromServers = mappingData.second;
-                    }
+                newMappings.insert(customerId, newMapping);
+                removedServersByCustomerId.insert(customerId, removeFromServers);
+            }
+        }
+
+        if (projectedLoading != nullptr) {
+            projectedLoading->clear();
+            for (ServersById::const_iterator it=serversById.constBegin(),end=serversById.constEnd() ; it!=end ; ++it) {
+                ServerId serverId = it.key();
+                projectedLoading->insert(serverId, loadIndex.projectedCpuLoading(serverId));
+            }
+        }
+
+        if (dryRun) {
+            logWrite(
+                QString("Planned move of %1 customers from server %2 (dry run)")
+                .arg(newMappings.size())
+                .arg(fromServerId),
+                false
+            );
+        } else if (!newMappings.isEmpty()) {
+            success = currentMapping->updateMappings(newMappings, threadId);
+            if (success) {
+                serverLoadIndex = loadIndex;
+
+                CustomerMessageBatch batch;
+                CustomerMapping::MappingsByCustomerId::const_iterator mappingIterator    = newMappings.constBegin();
+                CustomerMapping::MappingsByCustomerId::const_iterator mappingEndIterator = newMappings.constEnd();
+                while (mappingIterator != mappingEndIterator) {
+                    CustomerId customerId = mappingIterator.key();
 
-                    currentMapping->updateMapping(customerId, newMapping, threadId);
                     applyCustomerActivation(
-                        newMapping,
-                        removeFromServers,
+                        mappingIterator.value(),
+                        removedServersByCustomerId.value(customerId),
                         CustomerMapping::ServerSet(),
-                        capabilities,
-                        threadId
+                        capabilitiesByCustomerId.value(customerId),
+                        threadId,
+                        &batch
                     );
 
                     if (toServerId == invalidServerId) {
@@ -567,9 +852,11 @@ bool ServerAdministrator::reassignWorkload(
                             false
                         );
                     }
+
+                    ++mappingIterator;
                 }
 
-                accessMutex.unlock();
+                sendCustomerMessageBatch(batch);
             }
         }
     }
@@ -583,8 +870,13 @@ QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> ServerAdministrator:
         bool                                            ignoreExisting,
         bool                                            multiRegion,
         const ServerAdministrator::ServerExclusionList& exclusionList,
+        const ServerLoadIndex*                          loadIndex,
         unsigned                                        threadId
     ) {
+    if (loadIndex == nullptr) {
+        loadIndex = &serverLoadIndex;
+    }
+
     CustomerMapping::Mapping mapping =   ignoreExisting
                                        ? CustomerMapping::Mapping()
                                        : currentMapping->mapping(customerId, threadId);
@@ -598,7 +890,7 @@ QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> ServerAdministrator:
     QSet<RegionId>             assignedRegions;
     CustomerMapping::ServerSet removedServers;
     ServerId                   leastLoadedServerId = invalidServerId;
-    float                      bestCpuLoading      = std::numeric_limits<float>::max();
+    float                      bestScore           = std::numeric_limits<float>::max();
     while (mappingIterator != mappingEndIterator) {
         ServerId      serverId = *mappingIterator;
         if (exclusionList.contains(serverId)) {
@@ -617,9 +909,10 @@ QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> ServerAdministrator:
                 } else {
                     assignedRegions.insert(server.regionId());
 
-                    if (server.cpuLoading() < bestCpuLoading) {
+                    float score = loadIndex->score(serverId);
+                    if (score < bestScore) {
                         leastLoadedServerId = serverId;
-                        bestCpuLoading      = server.cpuLoading();
+                        bestScore           = score;
                     }
                 }
 
@@ -644,28 +937,25 @@ QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> ServerAdministrator:
                  ; regionIterator != regionEndIterator
                  ; ++regionIterator
                 ) {
-                RegionId           regionId          = *regionIterator;
-                const ServersById& serversThisRegion = activeServersByServerIdByRegionId.value(regionId);
+                RegionId regionId = *regionIterator;
+                ServerId serverId = loadIndex->leastLoaded(regionId, exclusionList);
+                if (serverId != invalidServerId) {
+                    mapping.insert(serverId);
 
-                Server server = leastLoadedServer(serversThisRegion, exclusionList);
-                if (server.isValid()) {
-                    mapping.insert(server.serverId());
-
-                    if (server.cpuLoading() < bestCpuLoading) {
-                        leastLoadedServerId = server.serverId();
-                        bestCpuLoading      = server.cpuLoading();
+                    float score = loadIndex->score(serverId);
+                    if (score < bestScore) {
+                        leastLoadedServerId = serverId;
+                        bestScore           = score;
                     }
                 }
             }
         }
     } else {
         if (mapping.size() != 1) {
-            Server bestServer = leastLoadedServer(serversById, exclusionList);
-            leastLoadedServerId = bestServer.serverId();
-            bestCpuLoading      = bestServer.cpuLoading();
+            leastLoadedServerId = loadIndex->leastLoaded(exclusionList);
 
             CustomerMapping::ServerSet oldServers = mapping;
-            oldServers.remove(bestServer.serverId());
+            oldServers.remove(leastLoadedServerId);
 
             removedServers.unite(oldServers);
 
@@ -689,26 +979,98 @@ QPair<CustomerMapping::Mapping, CustomerMapping::ServerSet> ServerAdministrator:
 }
 
 
-Server ServerAdministrator::leastLoadedServer(
-        const ServerAdministrator::ServersById&         servers,
-        const ServerAdministrator::ServerExclusionList& exclusionList
+float ServerAdministrator::customerMonitorsPerSecond(
+        const CustomerCapabilities& capabilities,
+        unsigned                    threadId
+    ) const {
+    float result;
+
+    unsigned short pollingInterval = capabilities.pollingInterval();
+    if (pollingInterval > 0) {
+        unsigned long numberMonitors = static_cast<unsigned long>(
+            currentMonitors->getMonitorsByCustomerId(capabilities.customerId(), threadId).size()
+        );
+
+        result = static_cast<float>(numberMonitors) / pollingInterval;
+    } else {
+        result = 0;
+    }
+
+    return result;
+}
+
+
+void ServerAdministrator::projectPlacement(
+        ServerLoadIndex&                  loadIndex,
+        const CustomerMapping::ServerSet& oldServers,
+        const CustomerMapping::ServerSet& newServers,
+        float                             customerMonitorsPerSecond
     ) {
-    ServerId bestServerid   = invalidServerId;
-    float    bestCpuLoading = std::numeric_limits<float>::max();
-    for (ServersById::const_iterator it=servers.constBegin(),end=servers.constEnd() ; it!=end ; ++it) {
-        const Server& server   = it.value();
-        ServerId      serverId = server.serverId();
-        if (server.status() == Server::Status::ACTIVE && !exclusionList.contains(serverId)) {
-            float         cpuLoading = server.cpuLoading();
-
-            if (cpuLoading < bestCpuLoading) {
-                bestServerid   = server.serverId();
-                bestCpuLoading = cpuLoading;
+    for (  CustomerMapping::ServerSet::const_iterator it  = oldServers.constBegin(),
+                                                      end = oldServers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (!newServers.contains(*it)) {
+            loadIndex.addMonitorsPerSecond(*it, -customerMonitorsPerSecond);
+        }
+    }
+
+    for (  CustomerMapping::ServerSet::const_iterator it  = newServers.constBegin(),
+                                                      end = newServers.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (!oldServers.contains(*it)) {
+            loadIndex.addMonitorsPerSecond(*it, customerMonitorsPerSecond);
+        }
+    }
+}
+
+
+void ServerAdministrator::reportFlushTimeout() {
+    flushServerReports();
+    updateServerHealth();
+}
+
+
+void ServerAdministrator::customerUpdateResponse(void* context, const QJsonDocument& response) {
+    CustomerUpdate* update = reinterpret_cast<CustomerUpdate*>(context);
+    QString         status = response.object().value("status").toString();
+
+    if (status != QString("OK")) {
+        QMutexLocker locker(&accessMutex);
+
+        ServerId   serverId   = update->serverId();
+        CustomerId customerId = update->customerId();
+
+        logWrite(
+            QString("Server %1 rejected version %2 for customer %3 (%4) -- resynchronizing.")
+            .arg(serverId)
+            .arg(update->version())
+            .arg(customerId)
+            .arg(status),
+            false
+        );
+
+        QHash<ServerId, CustomerSyncStates>::iterator syncStatesIterator = customerSyncStatesByServerId.find(serverId);
+        if (syncStatesIterator != customerSyncStatesByServerId.end()) {
+            syncStatesIterator.value().remove(customerId);
+        }
+
+        CustomerCapabilities capabilities = currentCustomerCapabilities->getCustomerCapabilities(customerId);
+        if (capabilities.isValid()) {
+            CustomerMapping::Mapping mapping = currentMapping->mapping(customerId);
+            if (mapping.contains(serverId)) {
+                CustomerMapping::ServerSet limitToServer;
+                limitToServer.insert(serverId);
+
+                applyCustomerActivation(mapping, CustomerMapping::ServerSet(), limitToServer, capabilities, 0);
             }
         }
     }
 
-    return servers.value(bestServerid);
+    delete update;
 }
 
 
@@ -720,16 +1082,85 @@ void ServerAdministrator::updateLocalCache(unsigned threadId) {
     inactiveServersByServerIdByRegionId.clear();
     defunctServersByServerIdByRegionId.clear();
     regionIndexByRegionIds.clear();
+    serverLoadIndex.clear();
 
     for (ServersById::const_iterator it=serversById.constBegin(),end=serversById.constEnd() ; it!=end ; ++it) {
         addServer(it.value());
     }
 
     loadNeeded = false;
+    publishSnapshot();
+}
+
+
+void ServerAdministrator::publishSnapshot() {
+    // The tables are implicitly shared so the snapshot holds shallow copies.  Later changes detach the writer's
+    // tables, leaving the published snapshot untouched.
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    snapshot->currentVersion                 = std::atomic_load(&currentSnapshot)->version() + 1;
+    snapshot->currentServersById             = serversById;
+    snapshot->currentServerIdsByIdentifier   = serverIdsByIdentifier;
+    snapshot->currentActiveServersByRegionId = activeServersByServerIdByRegionId;
+    snapshot->currentRegionIndexByRegionIds  = regionIndexByRegionIds;
+
+    std::atomic_store(&currentSnapshot, SnapshotPointer(snapshot));
+}
+
+
+void ServerAdministrator::updateServerHealth() {
+    // Health is computed outside the writer mutex since it only reads the published snapshot.
+    ServerHealthStatistics::HealthByServerId healthByServerId = getServerHealth();
+
+    QSet<ServerId> nowDegradedServerIds;
+    for (  ServerHealthStatistics::HealthByServerId::const_iterator it  = healthByServerId.constBegin(),
+                                                                    end = healthByServerId.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (it.value().degraded) {
+            nowDegradedServerIds.insert(it.key());
+        }
+    }
+
+    QMutexLocker locker(&accessMutex);
+
+    for (  QSet<ServerId>::const_iterator it = degradedServerIds.constBegin(), end = degradedServerIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (!nowDegradedServerIds.contains(*it)) {
+            serverLoadIndex.setDegraded(*it, false);
+            logWrite(QString("Server %1 is no longer degraded relative to its regional peers.").arg(*it), false);
+        }
+    }
+
+    for (  QSet<ServerId>::const_iterator it = nowDegradedServerIds.constBegin(), end = nowDegradedServerIds.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        if (!degradedServerIds.contains(*it)) {
+            const ServerHealthStatistics::Health& health = healthByServerId[*it];
+
+            serverLoadIndex.setDegraded(*it, true);
+            logWrite(
+                QString("Server %1 is degraded, latency %2 ms and timeout ratio %3 versus peer medians %4 ms and %5.")
+                .arg(*it)
+                .arg(health.meanLatency * 1.0E-3, 0, 'f', 1)
+                .arg(health.timeoutRatio, 0, 'f', 3)
+                .arg(health.peerMeanLatency * 1.0E-3, 0, 'f', 1)
+                .arg(health.peerTimeoutRatio, 0, 'f', 3),
+                false
+            );
+        }
+    }
+
+    degradedServerIds = nowDegradedServerIds;
 }
 
 
 void ServerAdministrator::globalUpdateRegionData() {
+    OutboundRestApiFactory::MessagesByServerIdentifier messages;
+
     unsigned numberActiveRegions = static_cast<unsigned>(activeServersByServerIdByRegionId.size());
     regionIndexByRegionIds.clear();
     unsigned regionIndex = 0;
@@ -745,12 +1176,23 @@ void ServerAdministrator::globalUpdateRegionData() {
              ; serverIterator != serverEndIterator
              ; ++serverIterator
             ) {
-            sendGoActive(serverIterator.value(), regionIndex, numberActiveRegions);
+            messages.insert(
+                serverIterator.value().identifier(),
+                QJsonDocument(buildRegionChangeMessage(regionIndex, numberActiveRegions))
+            );
         }
 
         regionIndexByRegionIds.insert(regionIterator.key(), regionIndex);
         ++regionIndex;
     }
+
+    publishSnapshot();
+
+    currentOutboundRestApiFactory->postMessages(
+        messages,
+        pollingServerRegionChangeEndpoint,
+        QString("Server going active")
+    );
 }
 
 
@@ -764,6 +1206,7 @@ bool ServerAdministrator::modifyServerHelper(const Server& server, unsigned int
             serversById.insert(server.serverId(), server);
 
             if (oldServer.identifier() != server.identifier()) {
+                currentOutboundRestApiFactory->releaseOutboundRestApi(oldServer.identifier());
                 serverIdsByIdentifier.remove(oldServer.identifier());
                 serverIdsByIdentifier.insert(server.identifier(), server.serverId());
             }
@@ -772,6 +1215,8 @@ bool ServerAdministrator::modifyServerHelper(const Server& server, unsigned int
                 removeFromRegionTable(oldServer);
                 addToRegionTable(server);
             }
+
+            publishSnapshot();
         }
     } else {
         logWrite(
@@ -834,6 +1279,8 @@ void ServerAdministrator::addToRegionTable(const Server& server) {
         ServerId serverId = server.serverId();
         (*serversByRegion)[regionId].insert(serverId, server);
     }
+
+    serverLoadIndex.insert(server, degradedServerIds.contains(server.serverId()));
 }
 
 
@@ -854,10 +1301,14 @@ void ServerAdministrator::removeFromRegionTable(const Server& server) {
             }
         }
     }
+
+    serverLoadIndex.remove(server.serverId());
 }
 
 
 void ServerAdministrator::sendGoInactive(const Server& server) {
+    customerSyncStatesByServerId.remove(server.serverId());
+
     const QString& identifier = server.identifier();
     currentOutboundRestApiFactory->postMessage(
         identifier,
@@ -868,21 +1319,228 @@ void ServerAdministrator::sendGoInactive(const Server& server) {
 
 
 void ServerAdministrator::sendGoActive(const Server& server, unsigned regionIndex, unsigned numberRegions) {
-    const QString& identifier = server.identifier();
-    QJsonObject    message;
+    OutboundRestApiFactory::MessagesByServerIdentifier messages;
+    messages.insert(server.identifier(), QJsonDocument(buildRegionChangeMessage(regionIndex, numberRegions)));
 
-    message.insert("region_index", static_cast<int>(regionIndex));
-    message.insert("number_regions", static_cast<int>(numberRegions));
-
-    currentOutboundRestApiFactory->postMessage(
-        identifier,
+    currentOutboundRestApiFactory->postMessages(
+        messages,
         pollingServerRegionChangeEndpoint,
-        QJsonDocument(message),
         QString("Server going active")
     );
 }
 
 
+QJsonObject ServerAdministrator::buildRegionChangeMessage(unsigned regionIndex, unsigned numberRegions) {
+    QJsonObject message;
+
+    message.insert("region_index", static_cast<int>(regionIndex));
+    message.insert("number_regions", static_cast<int>(numberRegions));
+
+    return message;
+}
+
+
+QJsonObject ServerAdministrator::buildMonitorMessage(const Monitor& monitor) {
+    QJsonObject monitorObject;
+
+    monitorObject.insert("uri", monitor.path());
+
+    if (monitor.method() != Monitor::Method::GET) {
+        monitorObject.insert("method", Monitor::toString(monitor.method()).toLower());
+    }
+
+    if (monitor.contentCheckMode() != Monitor::ContentCheckMode::NO_CHECK) {
+        monitorObject.insert("content_check_mode", Monitor::toString(monitor.contentCheckMode()).toLower());
+    }
+
+    const Monitor::KeywordList& keywords       = monitor.keywords();
+    unsigned                    numberKeywords = static_cast<unsigned>(keywords.size());
+    if (numberKeywords > 0) {
+        QJsonArray keywordsArray;
+        for (unsigned keywordsIndex=0 ; keywordsIndex<numberKeywords ; ++keywordsIndex) {
+            const QByteArray& keyword = keywords.at(keywordsIndex);
+            keywordsArray.append(QString::fromLatin1(keyword.toBase64()));
+        }
+
+        monitorObject.insert("keywords", keywordsArray);
+    }
+
+    if (monitor.contentType() != Monitor::ContentType::TEXT) {
+        monitorObject.insert("post_content_type", Monitor::toString(monitor.contentType()).toLower());
+    }
+
+    if (!monitor.userAgent().isEmpty()) {
+        monitorObject.insert("post_user_agent", monitor.userAgent());
+    }
+
+    const QByteArray& postContent = monitor.postContent();
+    if (!postContent.isEmpty()) {
+        monitorObject.insert("post_content", QString::fromLatin1(postContent.toBase64()));
+    }
+
+    return monitorObject;
+}
+
+
+QJsonObject ServerAdministrator::buildCustomerDelta(
+        const ServerAdministrator::CustomerSyncState& syncState,
+        const HostSchemes::HostSchemeHash&            hostSchemesById,
+        const Monitors::MonitorsById&                 monitorsById
+    ) {
+    const HostSchemes::HostSchemeHash& oldHostSchemesById = syncState.hostSchemesById();
+    const Monitors::MonitorsById&      oldMonitorsById    = syncState.monitorsById();
+
+    QHash<HostScheme::HostSchemeId, QJsonObject> addedMonitorsByHostScheme;
+    QHash<HostScheme::HostSchemeId, QJsonObject> modifiedMonitorsByHostScheme;
+    for (  Monitors::MonitorsById::const_iterator monitorsIterator    = monitorsById.constBegin(),
+                                                  monitorsEndIterator = monitorsById.constEnd()
+         ; monitorsIterator != monitorsEndIterator
+         ; ++monitorsIterator
+        ) {
+        const Monitor&           monitor      = monitorsIterator.value();
+        HostScheme::HostSchemeId hostSchemeId = monitor.hostSchemeId();
+
+        HostSchemes::HostSchemeHash::const_iterator hostSchemeIterator = hostSchemesById.constFind(hostSchemeId);
+        if (hostSchemeIterator != hostSchemesById.constEnd()) {
+            Monitors::MonitorsById::const_iterator oldMonitorIterator = oldMonitorsById.constFind(
+                monitorsIterator.key()
+            );
+
+            if (oldMonitorIterator == oldMonitorsById.constEnd()                      ||
+                !oldHostSchemesById.contains(oldMonitorIterator.value().hostSchemeId())    ) {
+                addedMonitorsByHostScheme[hostSchemeId].insert(
+                    QString::number(monitor.monitorId()),
+                    buildMonitorMessage(monitor)
+                );
+            } else {
+                const Monitor& oldMonitor = oldMonitorIterator.value();
+                if (oldMonitor.hostSchemeId() != hostSchemeId                                        ||
+                    oldHostSchemesById.value(hostSchemeId).url() != hostSchemeIterator.value().url() ||
+                    oldMonitor.path() != monitor.path()                                              ||
+                    oldMonitor.method() != monitor.method()                                          ||
+                    oldMonitor.contentCheckMode() != monitor.contentCheckMode()                      ||
+                    oldMonitor.keywordBlob() != monitor.keywordBlob()                                ||
+                    oldMonitor.contentType() != monitor.contentType()                                ||
+                    oldMonitor.userAgent() != monitor.userAgent()                                    ||
+                    oldMonitor.postContent() != monitor.postContent()                                   ) {
+                    modifiedMonitorsByHostScheme[hostSchemeId].insert(
+                        QString::number(monitor.monitorId()),
+                        buildMonitorMessage(monitor)
+                    );
+                }
+            }
+        }
+    }
+
+    QJsonArray removedMonitors;
+    for (  Monitors::MonitorsById::const_iterator oldMonitorsIterator    = oldMonitorsById.constBegin(),
+                                                  oldMonitorsEndIterator = oldMonitorsById.constEnd()
+         ; oldMonitorsIterator != oldMonitorsEndIterator
+         ; ++oldMonitorsIterator
+        ) {
+        const Monitor& oldMonitor = oldMonitorsIterator.value();
+        if (oldHostSchemesById.contains(oldMonitor.hostSchemeId())) {
+            Monitors::MonitorsById::const_iterator monitorIterator = monitorsById.constFind(oldMonitorsIterator.key());
+            if (monitorIterator == monitorsById.constEnd()                         ||
+                !hostSchemesById.contains(monitorIterator.value().hostSchemeId())    ) {
+                removedMonitors.append(static_cast<double>(oldMonitorsIterator.key()));
+            }
+        }
+    }
+
+    QJsonObject result;
+
+    for (unsigned i=0 ; i<2 ; ++i) {
+        const QHash<HostScheme::HostSchemeId, QJsonObject>& monitorsByHostScheme =   i == 0
+                                                                                   ? addedMonitorsByHostScheme
+                                                                                   : modifiedMonitorsByHostScheme;
+        if (!monitorsByHostScheme.isEmpty()) {
+            QJsonObject hostSchemesObject;
+            for (  QHash<HostScheme::HostSchemeId, QJsonObject>::const_iterator
+                       it  = monitorsByHostScheme.constBegin(),
+                       end = monitorsByHostScheme.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                QJsonObject hostSchemeObject;
+                hostSchemeObject.insert("url", hostSchemesById.value(it.key()).url().toString());
+                hostSchemeObject.insert("monitors", it.value());
+
+                hostSchemesObject.insert(QString::number(it.key()), hostSchemeObject);
+            }
+
+            result.insert(i == 0 ? QString("add") : QString("modify"), hostSchemesObject);
+        }
+    }
+
+    if (!removedMonitors.isEmpty()) {
+        result.insert("remove", removedMonitors);
+    }
+
+    return result;
+}
+
+
+void ServerAdministrator::sendCustomerSettings(
+        const Server&                      server,
+        CustomerId                         customerId,
+        const QJsonObject&                 settings,
+        const HostSchemes::HostSchemeHash& hostSchemesById,
+        const Monitors::MonitorsById&      monitorsById,
+        CustomerMessageBatch*              batch
+    ) {
+    CustomerSyncStates&          syncStates    = customerSyncStatesByServerId[server.serverId()];
+    CustomerSyncStates::iterator stateIterator = syncStates.find(customerId);
+    QJsonObject                  requestObject;
+
+    if (stateIterator != syncStates.end() && stateIterator.value().settings() == settings) {
+        const CustomerSyncState& syncState = stateIterator.value();
+        QJsonObject              delta     = buildCustomerDelta(syncState, hostSchemesById, monitorsById);
+        if (!delta.isEmpty()) {
+            unsigned long version = syncState.version() + 1;
+
+            delta.insert("base_version", static_cast<double>(syncState.version()));
+            delta.insert("version", static_cast<double>(version));
+            requestObject.insert(QString::number(customerId), delta);
+
+            currentOutboundRestApiFactory->postMessage(
+                server.identifier(),
+                pollingServerCustomerUpdateEndpoint,
+                QJsonDocument(requestObject),
+                QString("Updated monitors for customer %1, version %2").arg(customerId).arg(version),
+                new CustomerUpdate(server.serverId(), customerId, version),
+                this,
+                SLOT(customerUpdateResponse(void*,QJsonDocument))
+            );
+
+            stateIterator.value() = CustomerSyncState(version, settings, hostSchemesById, monitorsById);
+        }
+    } else {
+        unsigned long version     = stateIterator != syncStates.end() ? stateIterator.value().version() + 1 : 1;
+        QJsonObject   message     = settings;
+        QJsonObject   fullMessage = buildCustomerMessage(0, false, false, false, false, hostSchemesById, monitorsById);
+
+        message.insert("host_schemes", fullMessage.value("host_schemes"));
+        message.insert("version", static_cast<double>(version));
+
+        if (batch != nullptr) {
+            batch->addCustomerMessage(server.identifier(), customerId, message);
+        } else {
+            requestObject.insert(QString::number(customerId), message);
+
+            currentOutboundRestApiFactory->postMessage(
+                server.identifier(),
+                QString("/customer/add"),
+                requestObject,
+                QString("Updated settings for customer %1, version %2").arg(customerId).arg(version)
+            );
+        }
+
+        syncStates.insert(customerId, CustomerSyncState(version, settings, hostSchemesById, monitorsById));
+    }
+}
+
+
 QJsonObject ServerAdministrator::buildCustomerMessage(
         unsigned                           pollingInterval,
         bool                               supportsPingTesting,
@@ -919,44 +1577,7 @@ QJsonObject ServerAdministrator::buildCustomerMessage(
             QJsonObject monitorsObject;
             for (unsigned monitorIndex=0 ; monitorIndex<numberMonitors ; ++monitorIndex) {
                 const Monitor& monitor = *monitorsList.at(monitorIndex);
-                QJsonObject    monitorObject;
-
-                monitorObject.insert("uri", monitor.path());
-
-                if (monitor.method() != Monitor::Method::GET) {
-                    monitorObject.insert("method", Monitor::toString(monitor.method()).toLower());
-                }
-
-                if (monitor.contentCheckMode() != Monitor::ContentCheckMode::NO_CHECK) {
-                    monitorObject.insert("content_check_mode", Monitor::toString(monitor.contentCheckMode()).toLower());
-                }
-
-                const Monitor::KeywordList& keywords       = monitor.keywords();
-                unsigned                    numberKeywords = static_cast<unsigned>(keywords.size());
-                if (numberKeywords > 0) {
-                    QJsonArray keywordsArray;
-                    for (unsigned keywordsIndex=0 ; keywordsIndex<numberKeywords ; ++keywordsIndex) {
-                        const QByteArray& keyword = keywords.at(keywordsIndex);
-                        keywordsArray.append(QString::fromLatin1(keyword.toBase64()));
-                    }
-
-                    monitorObject.insert("keywords", keywordsArray);
-                }
-
-                if (monitor.contentType() != Monitor::ContentType::TEXT) {
-                    monitorObject.insert("post_content_type", Monitor::toString(monitor.contentType()).toLower());
-                }
-
-                if (!monitor.userAgent().isEmpty()) {
-                    monitorObject.insert("post_user_agent", monitor.userAgent());
-                }
-
-                const QByteArray& postContent = monitor.postContent();
-                if (!postContent.isEmpty()) {
-                    monitorObject.insert("post_content", QString::fromLatin1(postContent.toBase64()));
-                }
-
-                monitorsObject.insert(QString::number(monitor.monitorId()), monitorObject);
+                monitorsObject.insert(QString::number(monitor.monitorId()), buildMonitorMessage(monitor));
             }
 
             QJsonObject hostSchemeObject;
@@ -983,6 +1604,7 @@ void ServerAdministrator::applyCustomerDeactivation(CustomerId customerId, const
     QJsonObject requestObject;
     requestObject.insert("customer_id", static_cast<double>(customerId));
 
+    OutboundRestApiFactory::MessagesByServerIdentifier messages;
     for (  CustomerMapping::ServerSet::const_iterator serverIterator    = servers.constBegin(),
                                                       serverEndIterator = servers.constEnd()
          ; serverIterator != serverEndIterator
@@ -991,11 +1613,56 @@ void ServerAdministrator::applyCustomerDeactivation(CustomerId customerId, const
         ServerId serverId = *serverIterator;
         const Server& server = serversById.value(serverId);
         if (server.isValid()) {
+            messages.insert(server.identifier(), QJsonDocument(requestObject));
+        }
+
+        QHash<ServerId, CustomerSyncStates>::iterator syncStatesIterator = customerSyncStatesByServerId.find(serverId);
+        if (syncStatesIterator != customerSyncStatesByServerId.end()) {
+            syncStatesIterator.value().remove(customerId);
+        }
+    }
+
+    currentOutboundRestApiFactory->postMessages(
+        messages,
+        QString("/customer/remove"),
+        QString("Deactivated customer %1").arg(customerId)
+    );
+}
+
+
+void ServerAdministrator::sendCustomerMessageBatch(const ServerAdministrator::CustomerMessageBatch& batch) {
+    const QHash<QString, QJsonObject>& requests = batch.requestsByServerIdentifier();
+    if (!requests.isEmpty()) {
+        OutboundRestApiFactory::MessagesByServerIdentifier messages;
+        for (  QHash<QString, QJsonObject>::const_iterator it  = requests.constBegin(),
+                                                           end = requests.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            messages.insert(it.key(), QJsonDocument(it.value()));
+        }
+
+        currentOutboundRestApiFactory->postMessages(
+            messages,
+            QString("/customer/add"),
+            QString("Updated settings for %1 customer entries").arg(batch.numberCustomers())
+        );
+    }
+
+    const QHash<QString, QList<QJsonObject>>& pauseMessages = batch.pauseMessagesByServerIdentifier();
+    for (  QHash<QString, QList<QJsonObject>>::const_iterator serverIterator    = pauseMessages.constBegin(),
+                                                              serverEndIterator = pauseMessages.constEnd()
+         ; serverIterator != serverEndIterator
+         ; ++serverIterator
+        ) {
+        const QList<QJsonObject>& messages = serverIterator.value();
+        for (QList<QJsonObject>::const_iterator it=messages.constBegin(),end=messages.constEnd() ; it!=end ; ++it) {
             currentOutboundRestApiFactory->postMessage(
-                server.identifier(),
-                QString("/customer/remove"),
-                requestObject,
-                QString("Deactivated customer %1").arg(customerId)
+                serverIterator.key(),
+                pollingServerCustomerPauseEndpoint,
+                QJsonDocument(*it),
+                QString("Customer %1 pause state set to true")
+                .arg(static_cast<unsigned long>(it->value("customer_id").toDouble()))
             );
         }
     }
@@ -1007,27 +1674,12 @@ void ServerAdministrator::applyCustomerActivation(
         const CustomerMapping::ServerSet& removedServers,
         const CustomerMapping::ServerSet& limitToServers,
         const CustomerCapabilities&       capabilities,
-        unsigned                          threadId
+        unsigned                          threadId,
+        CustomerMessageBatch*             batch
     ) {
     CustomerId customerId = capabilities.customerId();
 
-    HostSchemes::HostSchemeHash hostSchemesById = currentHostSchemes->getHostSchemes(customerId, threadId);
-    Monitors::MonitorsById      monitorsById    = currentMonitors->getMonitorsByCustomerId(customerId, threadId);
-
-    unsigned perServerPollingInterval = capabilities.pollingInterval();
-    QJsonObject messageObject = buildCustomerMessage(
-        perServerPollingInterval,
-        false,
-        false,
-        capabilities.multiRegionChecking(),
-        capabilities.supportsLatencyTracking(),
-        hostSchemesById,
-        monitorsById
-    );
-
-    QJsonObject requestObject;
-    requestObject.insert(QString::number(customerId), messageObject);
-
+    QList<Server> secondaryServers;
     for (  CustomerMapping::Mapping::const_iterator serverIterator    = mapping.constBegin(),
                                                     serverEndIterator = mapping.constEnd()
          ; serverIterator != serverEndIterator
@@ -1037,60 +1689,141 @@ void ServerAdministrator::applyCustomerActivation(
         if (serverId != mapping.primaryServerId()) {
             const Server& server = serversById.value(serverId);
             if (server.isValid() && (limitToServers.isEmpty() || limitToServers.contains(serverId))) {
-                currentOutboundRestApiFactory->postMessage(
-                    server.identifier(),
-                    QString("/customer/add"),
-                    requestObject,
-                    QString("Updated settings for customer %1").arg(customerId)
-                );
-
-                if (capabilities.paused()) {
-                    QJsonObject pauseMessage;
-
-                    pauseMessage.insert("customer_id", static_cast<double>(customerId));
-                    pauseMessage.insert("pause", true);
-
-                    currentOutboundRestApiFactory->postMessage(
-                        server.identifier(),
-                        pollingServerCustomerPauseEndpoint,
-                        QJsonDocument(pauseMessage),
-                        QString("Customer %1 pause state set to true").arg(customerId)
-                    );
-                }
+                secondaryServers.append(server);
             }
         }
     }
 
+    Server   primaryServer;
     ServerId primaryServerId = mapping.primaryServerId();
     if (limitToServers.isEmpty() || limitToServers.contains(primaryServerId)) {
-        messageObject.insert("ping", capabilities.supportsPingBasedPolling());
-        messageObject.insert("ssl_expiration", capabilities.supportsSslExpirationChecking());
+        primaryServer = serversById.value(primaryServerId);
+    }
 
+    HostSchemes::HostSchemeHash hostSchemesById = currentHostSchemes->getHostSchemes(customerId, threadId);
+    Monitors::MonitorsById      monitorsById    = currentMonitors->getMonitorsByCustomerId(customerId, threadId);
+
+    unsigned perServerPollingInterval = capabilities.pollingInterval();
+    OutboundRestApiFactory::MessagesByServerIdentifier addMessages;
+
+    QString   latencyUrl;
+    ShardMap* shardMap = currentMapping->shardMap();
+    if (shardMap != nullptr && shardMap->isSharded()) {
+        latencyUrl = shardMap->shardForCustomer(customerId, threadId).baseUrl();
+    }
+
+    if (currentDeltaUpdates) {
+        QJsonObject settings = buildCustomerMessage(
+            perServerPollingInterval,
+            false,
+            false,
+            capabilities.multiRegionChecking(),
+            capabilities.supportsLatencyTracking(),
+            HostSchemes::HostSchemeHash(),
+            Monitors::MonitorsById()
+        );
+        settings.remove("host_schemes");
+
+        if (!latencyUrl.isEmpty()) {
+            settings.insert("latency_url", latencyUrl);
+        }
+
+        for (  QList<Server>::const_iterator it  = secondaryServers.constBegin(),
+                                             end = secondaryServers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            sendCustomerSettings(*it, customerId, settings, hostSchemesById, monitorsById, batch);
+        }
+
+        if (primaryServer.isValid()) {
+            settings.insert("ping", capabilities.supportsPingBasedPolling());
+            settings.insert("ssl_expiration", capabilities.supportsSslExpirationChecking());
+
+            sendCustomerSettings(primaryServer, customerId, settings, hostSchemesById, monitorsById, batch);
+        }
+    } else {
+        QJsonObject messageObject = buildCustomerMessage(
+            perServerPollingInterval,
+            false,
+            false,
+            capabilities.multiRegionChecking(),
+            capabilities.supportsLatencyTracking(),
+            hostSchemesById,
+            monitorsById
+        );
+
+        if (!latencyUrl.isEmpty()) {
+            messageObject.insert("latency_url", latencyUrl);
+        }
+
+        QJsonObject requestObject;
         requestObject.insert(QString::number(customerId), messageObject);
 
-        const Server& server = serversById.value(mapping.primaryServerId());
-        if (server.isValid()) {
-            currentOutboundRestApiFactory->postMessage(
-                server.identifier(),
+        for (  QList<Server>::const_iterator it  = secondaryServers.constBegin(),
+                                             end = secondaryServers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (batch != nullptr) {
+                batch->addCustomerMessage(it->identifier(), customerId, messageObject);
+            } else {
+                addMessages.insert(it->identifier(), QJsonDocument(requestObject));
+            }
+        }
+
+        if (primaryServer.isValid()) {
+            messageObject.insert("ping", capabilities.supportsPingBasedPolling());
+            messageObject.insert("ssl_expiration", capabilities.supportsSslExpirationChecking());
+
+            if (batch != nullptr) {
+                batch->addCustomerMessage(primaryServer.identifier(), customerId, messageObject);
+            } else {
+                requestObject.insert(QString::number(customerId), messageObject);
+                addMessages.insert(primaryServer.identifier(), QJsonDocument(requestObject));
+            }
+        }
+
+        if (batch == nullptr) {
+            currentOutboundRestApiFactory->postMessages(
+                addMessages,
                 QString("/customer/add"),
-                requestObject,
-                QString("Updated settings for customer %1 - primary server").arg(customerId)
+                QString("Updated settings for customer %1").arg(customerId)
             );
+        }
+    }
 
-            if (capabilities.paused()) {
-                QJsonObject pauseMessage;
+    if (capabilities.paused()) {
+        QJsonObject pauseMessage;
 
-                pauseMessage.insert("customer_id", static_cast<double>(customerId));
-                pauseMessage.insert("pause", true);
+        pauseMessage.insert("customer_id", static_cast<double>(customerId));
+        pauseMessage.insert("pause", true);
 
-                currentOutboundRestApiFactory->postMessage(
-                    server.identifier(),
-                    pollingServerCustomerPauseEndpoint,
-                    QJsonDocument(pauseMessage),
-                    QString("Customer %1 pause state set to true").arg(customerId)
-                );
+        QList<Server> pausedServers = secondaryServers;
+        if (primaryServer.isValid()) {
+            pausedServers.append(primaryServer);
+        }
+
+        OutboundRestApiFactory::MessagesByServerIdentifier pauseMessages;
+        for (  QList<Server>::const_iterator it  = pausedServers.constBegin(),
+                                             end = pausedServers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (batch != nullptr) {
+                batch->addPauseMessage(it->identifier(), pauseMessage);
+            } else {
+                pauseMessages.insert(it->identifier(), QJsonDocument(pauseMessage));
             }
         }
+
+        if (batch == nullptr) {
+            currentOutboundRestApiFactory->postMessages(
+                pauseMessages,
+                pollingServerCustomerPauseEndpoint,
+                QString("Customer %1 pause state set to true").arg(customerId)
+            );
+        }
     }
 
     applyCustomerDeactivation(customerId, removedServers);
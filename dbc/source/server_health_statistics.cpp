@@ -0,0 +1,301 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref ServerHealthStatistics class.
+***********************************************************************************************************************/
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QList>
+#include <QDateTime>
+
+#include <cmath>
+#include <algorithm>
+
+#include "region.h"
+#include "server.h"
+#include "servers.h"
+#include "latency_entry.h"
+#include "server_health_statistics.h"
+
+/***********************************************************************************************************************
+* ServerHealthStatistics::Batch
+*/
+
+ServerHealthStatistics::Batch::Batch() {
+    currentNumberSamples  = 0;
+    currentNumberTimeouts = 0;
+    currentMean           = 0;
+    currentSumSquares     = 0;
+}
+
+
+ServerHealthStatistics::Batch::~Batch() {}
+
+
+void ServerHealthStatistics::Batch::add(LatencyMicroseconds latencyMicroseconds) {
+    ++currentNumberSamples;
+
+    if (latencyMicroseconds <= LatencyEntry::maximumAllowedLatencyMicroseconds) {
+        double latency     = static_cast<double>(latencyMicroseconds);
+        double numberValid = static_cast<double>(currentNumberSamples - currentNumberTimeouts);
+        double delta       = latency - currentMean;
+
+        currentMean       += delta / numberValid;
+        currentSumSquares += delta * (latency - currentMean);
+    } else {
+        ++currentNumberTimeouts;
+    }
+}
+
+/***********************************************************************************************************************
+* ServerHealthStatistics::Series
+*/
+
+ServerHealthStatistics::Series::Series() {
+    currentWeight        = 0;
+    currentTimeoutWeight = 0;
+    currentLatencyWeight = 0;
+    currentMean          = 0;
+    currentSumSquares    = 0;
+    currentFirstSeconds  = 0;
+    currentLastSeconds   = 0;
+}
+
+
+ServerHealthStatistics::Series::~Series() {}
+
+
+void ServerHealthStatistics::Series::add(const Batch& batch, double unixSeconds) {
+    if (currentWeight <= 0) {
+        currentFirstSeconds = unixSeconds;
+        currentLastSeconds  = unixSeconds;
+    } else if (unixSeconds > currentLastSeconds) {
+        double factor = std::exp(-(unixSeconds - currentLastSeconds) / windowSeconds);
+
+        currentWeight        *= factor;
+        currentTimeoutWeight *= factor;
+        currentLatencyWeight *= factor;
+        currentSumSquares    *= factor;
+        currentLastSeconds    = unixSeconds;
+    }
+
+    currentWeight        += static_cast<double>(batch.currentNumberSamples);
+    currentTimeoutWeight += static_cast<double>(batch.currentNumberTimeouts);
+
+    double batchWeight = static_cast<double>(batch.currentNumberSamples - batch.currentNumberTimeouts);
+    if (batchWeight > 0) {
+        double newWeight = currentLatencyWeight + batchWeight;
+        double delta     = batch.currentMean - currentMean;
+
+        currentMean          += delta * batchWeight / newWeight;
+        currentSumSquares    += (
+              batch.currentSumSquares
+            + delta * delta * currentLatencyWeight * batchWeight / newWeight
+        );
+        currentLatencyWeight  = newWeight;
+    }
+}
+
+
+ServerHealthStatistics::Health ServerHealthStatistics::Series::toHealth(double unixSeconds) const {
+    Health result;
+
+    if (currentWeight > 0) {
+        double elapsed = std::max(0.0, unixSeconds - currentLastSeconds);
+        double age     = std::max(1.0, unixSeconds - currentFirstSeconds);
+
+        // A steady rate r accumulates r * T * (1 - exp(-age / T)) of decayed weight, which corrects the rate for
+        // servers that started reporting less than a window ago.
+        result.weight            = currentWeight * std::exp(-elapsed / windowSeconds);
+        result.sampleRate        = result.weight / (windowSeconds * (1.0 - std::exp(-age / windowSeconds)));
+        result.meanLatency       = currentMean;
+        result.timeoutRatio      = currentTimeoutWeight / currentWeight;
+        result.lastUnixTimestamp = static_cast<unsigned long long>(currentLastSeconds);
+
+        if (currentLatencyWeight > 0) {
+            result.varianceLatency = std::max(0.0, currentSumSquares / currentLatencyWeight);
+        }
+    }
+
+    return result;
+}
+
+
+double ServerHealthStatistics::Series::lastSeconds() const {
+    return currentLastSeconds;
+}
+
+/***********************************************************************************************************************
+* ServerHealthStatistics
+*/
+
+const unsigned long ServerHealthStatistics::windowSeconds      = 15 * 60;
+const unsigned long ServerHealthStatistics::maximumIdleSeconds = 24 * 60 * 60;
+const double        ServerHealthStatistics::minimumWeight      = 100.0;
+const double        ServerHealthStatistics::timeoutRatioMargin = 0.02;
+
+ServerHealthStatistics::ServerHealthStatistics() {}
+
+
+ServerHealthStatistics::~ServerHealthStatistics() {}
+
+
+void ServerHealthStatistics::addBatch(ServerId serverId, const Batch& batch) {
+    if (!batch.isEmpty()) {
+        double       now = currentUnixSeconds();
+        QMutexLocker locker(&accessMutex);
+
+        seriesByServerId[serverId].add(batch, now);
+    }
+}
+
+
+void ServerHealthStatistics::addEntries(const LatencyEntryList& latencyEntries) {
+    QHash<ServerId, Batch> batchesByServerId;
+    for (  LatencyEntryList::const_iterator it = latencyEntries.constBegin(), end = latencyEntries.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        batchesByServerId[it->serverId()].add(it->latencyMicroseconds());
+    }
+
+    if (!batchesByServerId.isEmpty()) {
+        double       now = currentUnixSeconds();
+        QMutexLocker locker(&accessMutex);
+
+        for (  QHash<ServerId, Batch>::const_iterator it  = batchesByServerId.constBegin(),
+                                                      end = batchesByServerId.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            seriesByServerId[it.key()].add(it.value(), now);
+        }
+    }
+}
+
+
+void ServerHealthStatistics::expire() {
+    double       cutoff = currentUnixSeconds() - maximumIdleSeconds;
+    QMutexLocker locker(&accessMutex);
+
+    QHash<ServerId, Series>::iterator it = seriesByServerId.begin();
+    while (it != seriesByServerId.end()) {
+        if (it.value().lastSeconds() < cutoff) {
+            it = seriesByServerId.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+
+ServerHealthStatistics::HealthByServerId ServerHealthStatistics::health(
+        const ServersById& serversById,
+        double             degradationRatio
+    ) const {
+    HealthByServerId                 result;
+    QHash<RegionId, QList<ServerId>> serverIdsByRegionId;
+    double                           now = currentUnixSeconds();
+
+    accessMutex.lock();
+
+    for (  QHash<ServerId, Series>::const_iterator it  = seriesByServerId.constBegin(),
+                                                   end = seriesByServerId.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        ServersById::const_iterator serverIterator = serversById.constFind(it.key());
+        if (serverIterator != serversById.constEnd()) {
+            result.insert(it.key(), it.value().toHealth(now));
+            serverIdsByRegionId[serverIterator.value().regionId()].append(it.key());
+        }
+    }
+
+    accessMutex.unlock();
+
+    // Each server is compared against the median of the other servers in its region so a single bad peer can not
+    // drag the baseline.  Regions hold few enough servers that the quadratic scan is cheaper than anything clever.
+
+    for (  QHash<RegionId, QList<ServerId>>::const_iterator regionIterator    = serverIdsByRegionId.constBegin(),
+                                                            regionEndIterator = serverIdsByRegionId.constEnd()
+         ; regionIterator != regionEndIterator
+         ; ++regionIterator
+        ) {
+        const QList<ServerId>& serverIds = regionIterator.value();
+        for (  QList<ServerId>::const_iterator serverIterator    = serverIds.constBegin(),
+                                               serverEndIterator = serverIds.constEnd()
+             ; serverIterator != serverEndIterator
+             ; ++serverIterator
+            ) {
+            QList<double> peerMeanLatencies;
+            QList<double> peerTimeoutRatios;
+            for (  QList<ServerId>::const_iterator peerIterator    = serverIds.constBegin(),
+                                                   peerEndIterator = serverIds.constEnd()
+                 ; peerIterator != peerEndIterator
+                 ; ++peerIterator
+                ) {
+                if (peerIterator != serverIterator) {
+                    const Health& peerHealth = result[*peerIterator];
+                    if (peerHealth.weight >= minimumWeight) {
+                        peerMeanLatencies.append(peerHealth.meanLatency);
+                        peerTimeoutRatios.append(peerHealth.timeoutRatio);
+                    }
+                }
+            }
+
+            Health& health = result[*serverIterator];
+            health.numberPeers = static_cast<unsigned>(peerMeanLatencies.size());
+            if (health.numberPeers > 0) {
+                health.peerMeanLatency  = median(peerMeanLatencies);
+                health.peerTimeoutRatio = median(peerTimeoutRatios);
+
+                if (degradationRatio > 0 && health.weight >= minimumWeight) {
+                    health.degraded = (
+                           (   health.peerMeanLatency > 0
+                            && health.meanLatency > degradationRatio * health.peerMeanLatency)
+                        || health.timeoutRatio > degradationRatio * health.peerTimeoutRatio + timeoutRatioMargin
+                    );
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+
+double ServerHealthStatistics::median(QList<double>& values) {
+    double result;
+
+    int numberValues = values.size();
+    if (numberValues > 0) {
+        std::sort(values.begin(), values.end());
+
+        int middle = numberValues / 2;
+        result = (numberValues % 2) != 0 ? values.at(middle) : 0.5 * (values.at(middle - 1) + values.at(middle));
+    } else {
+        result = 0;
+    }
+
+    return result;
+}
+
+
+double ServerHealthStatistics::currentUnixSeconds() {
+    return static_cast<double>(QDateTime::currentMSecsSinceEpoch()) / 1000.0;
+}
@@ -0,0 +1,297 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref ServerLoadIndex class.
+***********************************************************************************************************************/
+
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QPair>
+
+#include <limits>
+#include <algorithm>
+
+#include "region.h"
+#include "server.h"
+#include "server_load_index.h"
+
+const float ServerLoadIndex::defaultLoadingPerMonitorPerSecond = 0.001F;
+const float ServerLoadIndex::degradedScorePenalty              = 1.0F;
+
+/***********************************************************************************************************************
+* ServerLoadIndex::Entry
+*/
+
+ServerLoadIndex::Entry::Entry() {
+    regionId                   = Region::invalidRegionId;
+    active                     = false;
+    degraded                   = false;
+    cpuLoading                 = 0;
+    memoryLoading              = 0;
+    monitorsPerSecond          = 0;
+    projectedMonitorsPerSecond = 0;
+}
+
+
+ServerLoadIndex::Entry::Entry(const Server& server) {
+    regionId                   = server.regionId();
+    active                     = server.status() == Server::Status::ACTIVE;
+    degraded                   = false;
+    cpuLoading                 = server.cpuLoading();
+    memoryLoading              = server.memoryLoading();
+    monitorsPerSecond          = server.monitorsPerSecond();
+    projectedMonitorsPerSecond = 0;
+}
+
+/***********************************************************************************************************************
+* ServerLoadIndex
+*/
+
+ServerLoadIndex::ServerLoadIndex() {
+    totalCpuLoading        = 0;
+    totalMonitorsPerSecond = 0;
+}
+
+
+ServerLoadIndex::ServerLoadIndex(
+        const ServerLoadIndex& other
+    ):entriesByServerId(
+        other.entriesByServerId
+    ),orderedServers(
+        other.orderedServers
+    ),orderedServersByRegionId(
+        other.orderedServersByRegionId
+    ),totalCpuLoading(
+        other.totalCpuLoading
+    ),totalMonitorsPerSecond(
+        other.totalMonitorsPerSecond
+    ) {}
+
+
+ServerLoadIndex::~ServerLoadIndex() {}
+
+
+void ServerLoadIndex::clear() {
+    entriesByServerId.clear();
+    orderedServers.clear();
+    orderedServersByRegionId.clear();
+
+    totalCpuLoading        = 0;
+    totalMonitorsPerSecond = 0;
+}
+
+
+void ServerLoadIndex::insert(const Server& server, bool degraded) {
+    ServerId serverId = server.serverId();
+
+    remove(serverId);
+
+    Entry entry(server);
+    entry.degraded = degraded;
+    if (entry.active) {
+        totalCpuLoading        += entry.cpuLoading;
+        totalMonitorsPerSecond += entry.monitorsPerSecond;
+
+        order(serverId, entry);
+    }
+
+    entriesByServerId.insert(serverId, entry);
+}
+
+
+void ServerLoadIndex::remove(ServerLoadIndex::ServerId serverId) {
+    QHash<ServerId, Entry>::iterator it = entriesByServerId.find(serverId);
+    if (it != entriesByServerId.end()) {
+        const Entry& entry = it.value();
+        if (entry.active) {
+            unorder(entry);
+
+            totalCpuLoading        = std::max(0.0F, totalCpuLoading - entry.cpuLoading);
+            totalMonitorsPerSecond = std::max(0.0F, totalMonitorsPerSecond - entry.monitorsPerSecond);
+        }
+
+        entriesByServerId.erase(it);
+    }
+}
+
+
+void ServerLoadIndex::setDegraded(ServerLoadIndex::ServerId serverId, bool nowDegraded) {
+    QHash<ServerId, Entry>::iterator it = entriesByServerId.find(serverId);
+    if (it != entriesByServerId.end() && it.value().degraded != nowDegraded) {
+        Entry& entry = it.value();
+        if (entry.active) {
+            unorder(entry);
+        }
+
+        entry.degraded = nowDegraded;
+
+        if (entry.active) {
+            order(serverId, entry);
+        }
+    }
+}
+
+
+bool ServerLoadIndex::isDegraded(ServerLoadIndex::ServerId serverId) const {
+    QHash<ServerId, Entry>::const_iterator it = entriesByServerId.constFind(serverId);
+    return it != entriesByServerId.constEnd() && it.value().degraded;
+}
+
+
+void ServerLoadIndex::addMonitorsPerSecond(ServerLoadIndex::ServerId serverId, float monitorsPerSecond) {
+    QHash<ServerId, Entry>::iterator it = entriesByServerId.find(serverId);
+    if (it != entriesByServerId.end()) {
+        Entry& entry = it.value();
+        if (entry.active) {
+            unorder(entry);
+        }
+
+        entry.projectedMonitorsPerSecond = std::max(
+            -entry.monitorsPerSecond,
+            entry.projectedMonitorsPerSecond + monitorsPerSecond
+        );
+
+        if (entry.active) {
+            order(serverId, entry);
+        }
+    }
+}
+
+
+float ServerLoadIndex::projectedCpuLoading(ServerLoadIndex::ServerId serverId) const {
+    QHash<ServerId, Entry>::const_iterator it = entriesByServerId.constFind(serverId);
+    return it != entriesByServerId.constEnd() ? projectedCpuLoading(it.value()) : 0;
+}
+
+
+float ServerLoadIndex::score(ServerLoadIndex::ServerId serverId) const {
+    QHash<ServerId, Entry>::const_iterator it = entriesByServerId.constFind(serverId);
+    return it != entriesByServerId.constEnd() ? score(it.value()) : std::numeric_limits<float>::max();
+}
+
+
+ServerLoadIndex::ServerId ServerLoadIndex::leastLoaded(
+        const ServerLoadIndex::ServerExclusionList& exclusionList
+    ) const {
+    return firstEligible(orderedServers, exclusionList);
+}
+
+
+ServerLoadIndex::ServerId ServerLoadIndex::leastLoaded(
+        ServerLoadIndex::RegionId                   regionId,
+        const ServerLoadIndex::ServerExclusionList& exclusionList
+    ) const {
+    ServerId result = Server::invalidServerId;
+
+    QHash<RegionId, OrderedServers>::const_iterator it = orderedServersByRegionId.constFind(regionId);
+    if (it != orderedServersByRegionId.constEnd()) {
+        result = firstEligible(it.value(), exclusionList);
+    }
+
+    return result;
+}
+
+
+ServerLoadIndex& ServerLoadIndex::operator=(const ServerLoadIndex& other) {
+    entriesByServerId        = other.entriesByServerId;
+    orderedServers           = other.orderedServers;
+    orderedServersByRegionId = other.orderedServersByRegionId;
+    totalCpuLoading          = other.totalCpuLoading;
+    totalMonitorsPerSecond   = other.totalMonitorsPerSecond;
+
+    return *this;
+}
+
+
+float ServerLoadIndex::projectedCpuLoading(const ServerLoadIndex::Entry& entry) const {
+    float loadingPerMonitorPerSecond;
+    if (entry.monitorsPerSecond > 0) {
+        loadingPerMonitorPerSecond = entry.cpuLoading / entry.monitorsPerSecond;
+    } else if (totalMonitorsPerSecond > 0) {
+        loadingPerMonitorPerSecond = totalCpuLoading / totalMonitorsPerSecond;
+    } else {
+        loadingPerMonitorPerSecond = defaultLoadingPerMonitorPerSecond;
+    }
+
+    return std::max(0.0F, entry.cpuLoading + entry.projectedMonitorsPerSecond * loadingPerMonitorPerSecond);
+}
+
+
+float ServerLoadIndex::score(const ServerLoadIndex::Entry& entry) const {
+    // Memory tracks the number of monitors a server holds so it's scaled in proportion to the projected polling rate.
+    // Without a reported rate there's nothing to scale by so the reported value is used as is.
+
+    float projectedMemoryLoading;
+    if (entry.monitorsPerSecond > 0) {
+        projectedMemoryLoading =   entry.memoryLoading
+                                 * (entry.monitorsPerSecond + entry.projectedMonitorsPerSecond)
+                                 / entry.monitorsPerSecond;
+    } else {
+        projectedMemoryLoading = entry.memoryLoading;
+    }
+
+    float result = std::max(projectedCpuLoading(entry), projectedMemoryLoading);
+    if (entry.degraded) {
+        result += degradedScorePenalty;
+    }
+
+    return result;
+}
+
+
+void ServerLoadIndex::order(ServerLoadIndex::ServerId serverId, ServerLoadIndex::Entry& entry) {
+    entry.key = Key(score(entry), serverId);
+
+    orderedServers.insert(entry.key, serverId);
+    orderedServersByRegionId[entry.regionId].insert(entry.key, serverId);
+}
+
+
+void ServerLoadIndex::unorder(const ServerLoadIndex::Entry& entry) {
+    orderedServers.remove(entry.key);
+
+    QHash<RegionId, OrderedServers>::iterator it = orderedServersByRegionId.find(entry.regionId);
+    if (it != orderedServersByRegionId.end()) {
+        OrderedServers& servers = it.value();
+        servers.remove(entry.key);
+
+        if (servers.isEmpty()) {
+            orderedServersByRegionId.erase(it);
+        }
+    }
+}
+
+
+ServerLoadIndex::ServerId ServerLoadIndex::firstEligible(
+        const ServerLoadIndex::OrderedServers&      servers,
+        const ServerLoadIndex::ServerExclusionList& exclusionList
+    ) {
+    ServerId result = Server::invalidServerId;
+
+    OrderedServers::const_iterator it  = servers.constBegin();
+    OrderedServers::const_iterator end = servers.constEnd();
+    while (result == Server::invalidServerId && it != end) {
+        if (!exclusionList.contains(it.value())) {
+            result = it.value();
+        } else {
+            ++it;
+        }
+    }
+
+    return result;
+}
@@ -26,6 +26,8 @@
 #include <QJsonArray>
 #include <QJsonValue>
 
+#include <cmath>
+
 #include <rest_api_in_v1_inesonic_rest_handler.h>
 
 #include "log.h"
@@ -34,6 +36,8 @@
 #include "server.h"
 #include "servers.h"
 #include "server_administrator.h"
+#include "server_health_statistics.h"
+#include "job_scheduler.h"
 #include "server_manager.h"
 
 /***********************************************************************************************************************
@@ -398,6 +402,10 @@ RestApiInV1::JsonResponse ServerManager::ServerList::processAuthenticatedRequest
 
         if (success) {
             Servers::ServerList serverList = currentServerAdministrator->getServers(regionId, serverStatus, threadId);
+            ServerHealthStatistics::HealthByServerId healthByServerId = currentServerAdministrator->getServerHealth(
+                threadId
+            );
+
             QJsonArray serversList;
             for (  Servers::ServerList::const_iterator it = serverList.constBegin(), end = serverList.constEnd()
                  ; it!=end
@@ -414,6 +422,31 @@ RestApiInV1::JsonResponse ServerManager::ServerList::processAuthenticatedRequest
                 serverObject.insert("cpu_loading", server.cpuLoading());
                 serverObject.insert("memory_loading", server.memoryLoading());
 
+                ServerHealthStatistics::HealthByServerId::const_iterator healthIterator = healthByServerId.constFind(
+                    server.serverId()
+                );
+                if (healthIterator != healthByServerId.constEnd()) {
+                    const ServerHealthStatistics::Health& health = healthIterator.value();
+                    QJsonObject                           healthObject;
+
+                    healthObject.insert("sample_rate", health.sampleRate);
+                    healthObject.insert("mean", health.meanLatency * 1.0E-6);
+                    healthObject.insert("standard_deviation", std::sqrt(health.varianceLatency) * 1.0E-6);
+                    healthObject.insert("timeout_ratio", health.timeoutRatio);
+                    healthObject.insert("weight", health.weight);
+                    healthObject.insert("last_timestamp", static_cast<double>(health.lastUnixTimestamp));
+                    healthObject.insert("peers", static_cast<int>(health.numberPeers));
+
+                    if (health.numberPeers > 0) {
+                        healthObject.insert("peer_mean", health.peerMeanLatency * 1.0E-6);
+                        healthObject.insert("peer_timeout_ratio", health.peerTimeoutRatio);
+                    }
+
+                    healthObject.insert("degraded", health.degraded);
+
+                    serverObject.insert("health", healthObject);
+                }
+
                 serversList.append(serverObject);
             }
 
@@ -592,14 +625,27 @@ RestApiInV1::JsonResponse ServerManager::ServerStart::processAuthenticatedReques
 * ServerManager::ServerReassign
 */
 
+const QString ServerManager::ServerReassign::reassignJobType("server_reassign");
+
 ServerManager::ServerReassign::ServerReassign(
-        const QByteArray& secret,
-        ServerAdministrator*          serverAdministrator
+        const QByteArray&    secret,
+        ServerAdministrator* serverAdministrator,
+        JobScheduler*        jobScheduler
     ):RestApiInV1::InesonicRestHandler(
         secret
     ),currentServerAdministrator(
         serverAdministrator
-    ) {}
+    ),currentJobScheduler(
+        jobScheduler
+    ) {
+    currentJobScheduler->registerJobType(
+        reassignJobType,
+        1,
+        [this](const QJsonObject& parameters, JobScheduler::Progress& progress, unsigned threadId) {
+            return reassign(parameters, progress, threadId);
+        }
+    );
+}
 
 
 ServerManager::ServerReassign::~ServerReassign() {}
@@ -667,26 +713,67 @@ RestApiInV1::JsonResponse ServerManager::ServerReassign::processAuthenticatedReq
             ++numberFields;
         }
 
+        bool dryRun = false;
+        if (object.contains("dry_run")) {
+            QJsonValue dryRunValue = object.value("dry_run");
+            if (dryRunValue.isBool()) {
+                dryRun = dryRunValue.toBool();
+            } else {
+                responseObject.insert("status", "invalid dry run value");
+                success = false;
+            }
+
+            ++numberFields;
+        }
+
         if (success && static_cast<unsigned>(object.size()) <= numberFields) {
-            if (fromServerId != Server::invalidServerId) {
+            if (fromServerId != Server::invalidServerId && dryRun) {
+                ServerAdministrator::LoadingByServerId projectedLoading;
                 bool success = currentServerAdministrator->reassignWorkload(
                     fromServerId,
                     customerList,
                     toServerId,
+                    true,
+                    &projectedLoading,
                     threadId
                 );
 
                 if (success) {
-                    if (toServerId != Server::invalidServerId) {
-                        logWrite(
-                            QString("Reassigned work from server %1 to %2").arg(fromServerId).arg(toServerId),
-                            false
-                        );
-                    } else {
-                        logWrite(QString("Reassigned work away from server %1").arg(fromServerId), false);
+                    QJsonObject projectedLoadingObject;
+                    for (  ServerAdministrator::LoadingByServerId::const_iterator
+                               it  = projectedLoading.constBegin(),
+                               end = projectedLoading.constEnd()
+                         ; it != end
+                         ; ++it
+                        ) {
+                        projectedLoadingObject.insert(QString::number(it.key()), it.value());
                     }
 
+                    responseObject.insert("projected_loading", projectedLoadingObject);
+                    responseObject.insert("status", "OK");
+                } else {
+                    responseObject.insert("status", "failed");
+                }
+            } else if (fromServerId != Server::invalidServerId) {
+                // Moving the work commands every affected polling server so it is run as a background job.
+                QJsonArray customersArray;
+                for (  ServerAdministrator::CustomerList::const_iterator it  = customerList.constBegin(),
+                                                                         end = customerList.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    customersArray.append(static_cast<double>(*it));
+                }
+
+                QJsonObject parameters;
+                parameters.insert("from_server_id", static_cast<int>(fromServerId));
+                parameters.insert("to_server_id", static_cast<int>(toServerId));
+                parameters.insert("customers", customersArray);
+
+                JobScheduler::JobId jobId = currentJobScheduler->submit(reassignJobType, parameters, threadId);
+                if (jobId != JobScheduler::invalidJobId) {
                     responseObject.insert("status", "OK");
+                    responseObject.insert("job_id", static_cast<double>(jobId));
                 } else {
                     responseObject.insert("status", "failed");
                 }
@@ -701,6 +788,47 @@ RestApiInV1::JsonResponse ServerManager::ServerReassign::processAuthenticatedReq
     return response;
 }
 
+
+bool ServerManager::ServerReassign::reassign(
+        const QJsonObject&      parameters,
+        JobScheduler::Progress& progress,
+        unsigned                threadId
+    ) {
+    Server::ServerId fromServerId   = static_cast<Server::ServerId>(parameters.value("from_server_id").toInt());
+    Server::ServerId toServerId     = static_cast<Server::ServerId>(parameters.value("to_server_id").toInt());
+    QJsonArray       customersArray = parameters.value("customers").toArray();
+
+    ServerAdministrator::CustomerList customerList;
+    for (QJsonArray::const_iterator it=customersArray.constBegin(),end=customersArray.constEnd() ; it!=end ; ++it) {
+        customerList.append(static_cast<CustomerCapabilities::CustomerId>(it->toDouble(0)));
+    }
+
+    progress.setProgress(0, 1);
+
+    bool success = currentServerAdministrator->reassignWorkload(
+        fromServerId,
+        customerList,
+        toServerId,
+        false,
+        nullptr,
+        threadId
+    );
+
+    if (success) {
+        if (toServerId != Server::invalidServerId) {
+            logWrite(QString("Reassigned work from server %1 to %2").arg(fromServerId).arg(toServerId), false);
+        } else {
+            logWrite(QString("Reassigned work away from server %1").arg(fromServerId), false);
+        }
+
+        progress.setProgress(1, 1);
+    } else {
+        progress.setMessage(QString("could not reassign work from server %1").arg(fromServerId));
+    }
+
+    return success;
+}
+
 /***********************************************************************************************************************
 * ServerManager::ServerRedistribute
 */
@@ -771,6 +899,7 @@ ServerManager::ServerManager(
         RestApiInV1::Server* restApiServer,
         ServerAdministrator*             serverAdministrator,
         Regions*             regionDatabaseApi,
+        JobScheduler*        jobScheduler,
         const QByteArray&    secret,
         QObject*             parent
     ):QObject(
@@ -803,7 +932,8 @@ ServerManager::ServerManager(
         serverAdministrator
     ),serverReassign(
         secret,
-        serverAdministrator
+        serverAdministrator,
+        jobScheduler
     ),serverRedistribute(
         secret,
         serverAdministrator
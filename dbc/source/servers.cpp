@@ -32,13 +32,18 @@
 #include <cstdint>
 
 #include "log.h"
+#include "metrics_registry.h"
 #include "region.h"
 #include "server.h"
 #include "database_manager.h"
+#include "id_registry.h"
+#include "request_tracer.h"
+#include "sql_helpers.h"
 #include "servers.h"
 
-Servers::Servers(DatabaseManager* databaseManager, QObject* parent):QObject(parent) {
+Servers::Servers(DatabaseManager* databaseManager, IdRegistry* idRegistry, QObject* parent):QObject(parent) {
     currentDatabaseManager = databaseManager;
+    currentIdRegistry      = idRegistry;
 }
 
 
@@ -48,15 +53,26 @@ Servers::~Servers() {}
 Server Servers::getServer(ServerId serverId, unsigned threadId) const {
     Server result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Servers::getServer")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+        QSqlQuery query = currentDatabaseManager->preparedQuery(
+            database,
+            QString("SELECT * FROM servers WHERE server_id = :server_id"),
+            &success
+        );
 
-        QString queryString = QString("SELECT * FROM servers WHERE server_id = %1").arg(serverId);
+        if (success) {
+            query.bindValue(":server_id", serverId);
+            success = SqlHelpers::execute(query);
+        }
 
-        success = query.exec(queryString);
         if (success) {
             if (query.first()) {
                 result = convertQueryToServer(query, &success);
@@ -78,15 +94,26 @@ Server Servers::getServer(ServerId serverId, unsigned threadId) const {
 Server Servers::getServer(const QString& identifier, unsigned threadId) const {
     Server result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Servers::getServer")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
-        QSqlQuery query(database);
-        query.setForwardOnly(true);
+        QSqlQuery query = currentDatabaseManager->preparedQuery(
+            database,
+            QString("SELECT * FROM servers WHERE identifier = :identifier"),
+            &success
+        );
 
-        QString queryString = QString("SELECT * FROM servers WHERE identifier = '%1'").arg(identifier);
+        if (success) {
+            query.bindValue(":identifier", identifier);
+            success = SqlHelpers::execute(query);
+        }
 
-        success = query.exec(queryString);
         if (success) {
             if (query.first()) {
                 result = convertQueryToServer(query, &success);
@@ -137,7 +164,7 @@ Server Servers::createServer(
             ")"
         ).arg(regionId).arg(identifier, statusString);
 
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             QVariant serverIdVariant = query.lastInsertId();
             if (serverIdVariant.isValid()) {
@@ -155,6 +182,8 @@ Server Servers::createServer(
                             0.0F,
                             0.0F
                         );
+
+                        currentIdRegistry->addServer(serverId);
                     } else {
                         success = false;
                         logWrite(QString("Invalid server ID, out of range - Servers::createServer"), true);
@@ -181,6 +210,12 @@ Server Servers::createServer(
 
 
 bool Servers::modifyServer(const Server& server, unsigned threadId) {
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Servers::modifyServer")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -203,7 +238,7 @@ bool Servers::modifyServer(const Server& server, unsigned threadId) {
          .arg(server.memoryLoading())
          .arg(server.serverId());
 
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (!success) {
             logWrite(QString("Failed UPDATE - Servers::modifyServer: 1").arg(query.lastError().text()), true);
         }
@@ -216,6 +251,66 @@ bool Servers::modifyServer(const Server& server, unsigned threadId) {
 }
 
 
+bool Servers::updateServerReports(const ServerList& servers, unsigned threadId) {
+    QString values;
+    for (ServerList::const_iterator it=servers.constBegin(),end=servers.constEnd() ; it!=end ; ++it) {
+        const Server& server = *it;
+        if (!values.isEmpty()) {
+            values += ",";
+        }
+
+        values += QString("(%1,'%2',%3,%4,%5)")
+                  .arg(server.serverId())
+                  .arg(Server::toString(server.status()))
+                  .arg(server.monitorsPerSecond())
+                  .arg(server.cpuLoading())
+                  .arg(server.memoryLoading());
+    }
+
+    bool success = true;
+    if (!values.isEmpty()) {
+        static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+            QString("Servers::updateServerReports")
+        );
+        MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+        RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        success = database.isOpen();
+        if (success) {
+            QSqlQuery query(database);
+
+            QString queryString = QString(
+                "UPDATE servers SET "
+                    "status = reports.status::server_status, "
+                    "monitor_service_rate = reports.monitor_service_rate, "
+                    "cpu_loading = reports.cpu_loading, "
+                    "memory_loading = reports.memory_loading "
+                "FROM (VALUES %1) AS reports(server_id, status, monitor_service_rate, cpu_loading, memory_loading) "
+                "WHERE servers.server_id = reports.server_id"
+            ).arg(values);
+
+            success = SqlHelpers::execute(query, queryString);
+            if (!success) {
+                logWrite(
+                    QString("Failed UPDATE - Servers::updateServerReports: %1").arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed to open database - Servers::updateServerReports: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    }
+
+    return success;
+}
+
+
 bool Servers::deleteServer(const Server& server, unsigned threadId) {
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
@@ -223,8 +318,10 @@ bool Servers::deleteServer(const Server& server, unsigned threadId) {
         QSqlQuery query(database);
 
         QString queryString = QString("DELETE FROM servers WHERE server_id = %1").arg(server.serverId());
-        success = query.exec(queryString);
-        if (!success) {
+        success = SqlHelpers::execute(query, queryString);
+        if (success) {
+            currentIdRegistry->removeServer(server.serverId());
+        } else {
             logWrite(QString("Failed DELETE - Servers::deleteServer: 1").arg(query.lastError().text()), true);
         }
     } else {
@@ -239,6 +336,12 @@ bool Servers::deleteServer(const Server& server, unsigned threadId) {
 Servers::ServerList Servers::getServers(RegionId regionId, Server::Status status, unsigned threadId) {
     ServerList result;
 
+    static MetricsRegistry::Histogram* const queryMetric = MetricsRegistry::queryHistogram(
+        QString("Servers::getServers")
+    );
+    MetricsRegistry::ScopedTimer queryTimer(queryMetric);
+    RequestTracer::Span querySpan(RequestTracer::Phase::DATABASE, threadId);
+
     QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
     bool success = database.isOpen();
     if (success) {
@@ -259,7 +362,7 @@ Servers::ServerList Servers::getServers(RegionId regionId, Server::Status status
         }
 
         queryString += QString(" ORDER BY region_id ASC, monitor_service_rate DESC, server_id ASC");
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             while (success && query.next()) {
                 Server server = convertQueryToServer(query, &success);
@@ -289,7 +392,7 @@ Servers::ServersById Servers::getServersById(unsigned threadId) {
         query.setForwardOnly(true);
 
         QString queryString = QString("SELECT * FROM servers");
-        success = query.exec(queryString);
+        success = SqlHelpers::execute(query, queryString);
         if (success) {
             while (success && query.next()) {
                 Server server = convertQueryToServer(query, &success);
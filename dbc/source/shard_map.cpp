@@ -0,0 +1,224 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref ShardMap class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QVariant>
+
+#include <cstdint>
+
+#include "log.h"
+#include "database_manager.h"
+#include "sql_helpers.h"
+#include "shard_map.h"
+
+const unsigned ShardMap::defaultVirtualNodes = 64;
+
+ShardMap::ShardMap(
+        DatabaseManager* databaseManager,
+        QObject*         parent
+    ):QObject(
+        parent
+    ),currentDatabaseManager(
+        databaseManager
+    ),currentLocalShardId(
+        invalidShardId
+    ),ringLoaded(
+        false
+    ) {}
+
+
+ShardMap::~ShardMap() {}
+
+
+void ShardMap::setLocalShardId(ShardMap::ShardId newLocalShardId) {
+    QMutexLocker locker(&ringMutex);
+    currentLocalShardId = newLocalShardId;
+}
+
+
+ShardMap::ShardId ShardMap::localShardId() const {
+    QMutexLocker locker(&ringMutex);
+    return currentLocalShardId;
+}
+
+
+bool ShardMap::isSharded() const {
+    QMutexLocker locker(&ringMutex);
+    return currentLocalShardId != invalidShardId;
+}
+
+
+ShardMap::Shard ShardMap::shardForCustomer(ShardMap::CustomerId customerId, unsigned threadId) {
+    Shard result;
+
+    QMutexLocker locker(&ringMutex);
+    if (currentLocalShardId != invalidShardId && loadRing(threadId)) {
+        result = shardsById.value(ringLookup(customerId));
+    }
+
+    return result;
+}
+
+
+ShardMap::Shard ShardMap::shard(ShardMap::ShardId shardId, unsigned threadId) {
+    Shard result;
+
+    QMutexLocker locker(&ringMutex);
+    if (loadRing(threadId)) {
+        result = shardsById.value(shardId);
+    }
+
+    return result;
+}
+
+
+bool ShardMap::ownsCustomer(ShardMap::CustomerId customerId, unsigned threadId) {
+    bool result;
+
+    QMutexLocker locker(&ringMutex);
+    if (currentLocalShardId != invalidShardId && loadRing(threadId) && !ring.isEmpty()) {
+        result = (ringLookup(customerId) == currentLocalShardId);
+    } else {
+        result = true;
+    }
+
+    return result;
+}
+
+
+void ShardMap::invalidate() {
+    QMutexLocker locker(&ringMutex);
+    ringLoaded = false;
+}
+
+
+bool ShardMap::loadRing(unsigned threadId) {
+    bool success = ringLoaded;
+
+    if (!success) {
+        QSqlDatabase database = currentDatabaseManager->getDatabase(QString::number(threadId));
+        success = database.isOpen();
+        if (success) {
+            QSqlQuery query(database);
+            query.setForwardOnly(true);
+
+            success = SqlHelpers::execute(query, "SELECT shard_id, base_url, virtual_nodes FROM dbc_shards");
+            if (success) {
+                int shardIdField      = query.record().indexOf("shard_id");
+                int baseUrlField      = query.record().indexOf("base_url");
+                int virtualNodesField = query.record().indexOf("virtual_nodes");
+
+                if (shardIdField >= 0 && baseUrlField >= 0 && virtualNodesField >= 0) {
+                    QHash<ShardId, Shard>        newShardsById;
+                    QMap<std::uint64_t, ShardId> newRing;
+
+                    while (success && query.next()) {
+                        unsigned shardId      = query.value(shardIdField).toUInt(&success);
+                        unsigned virtualNodes = success ? query.value(virtualNodesField).toUInt(&success) : 0;
+                        if (success && shardId != invalidShardId && shardId <= 0xFFFF) {
+                            Shard shard(
+                                static_cast<ShardId>(shardId),
+                                query.value(baseUrlField).toString(),
+                                virtualNodes
+                            );
+
+                            newShardsById.insert(shard.shardId(), shard);
+                            for (unsigned nodeIndex=0 ; nodeIndex<virtualNodes ; ++nodeIndex) {
+                                std::uint64_t position = mix((static_cast<std::uint64_t>(shardId) << 32) | nodeIndex);
+                                newRing.insert(position, shard.shardId());
+                            }
+                        } else {
+                            success = false;
+                            logWrite(QString("Invalid shard ID - ShardMap::loadRing"), true);
+                        }
+                    }
+
+                    if (success) {
+                        if (currentLocalShardId != invalidShardId && !newShardsById.contains(currentLocalShardId)) {
+                            logWrite(
+                                QString("??? Warning: Local shard %1 is not listed in dbc_shards")
+                                .arg(currentLocalShardId),
+                                false
+                            );
+                        }
+
+                        shardsById = newShardsById;
+                        ring       = newRing;
+                        ringLoaded = true;
+                    }
+                } else {
+                    success = false;
+                    logWrite(QString("Failed to get field index - ShardMap::loadRing"), true);
+                }
+            } else {
+                logWrite(
+                    QString("Failed SELECT - ShardMap::loadRing: %1").arg(query.lastError().text()),
+                    true
+                );
+            }
+        } else {
+            logWrite(
+                QString("Failed to open database - ShardMap::loadRing: %1").arg(database.lastError().text()),
+                true
+            );
+        }
+
+        currentDatabaseManager->closeAndRelease(database);
+    }
+
+    return success;
+}
+
+
+ShardMap::ShardId ShardMap::ringLookup(ShardMap::CustomerId customerId) const {
+    ShardId result;
+
+    if (!ring.isEmpty()) {
+        QMap<std::uint64_t, ShardId>::const_iterator it = ring.lowerBound(mix(customerId));
+        if (it == ring.constEnd()) {
+            it = ring.constBegin();
+        }
+
+        result = it.value();
+    } else {
+        result = invalidShardId;
+    }
+
+    return result;
+}
+
+
+std::uint64_t ShardMap::mix(std::uint64_t value) {
+    std::uint64_t result = value + 0x9E3779B97F4A7C15ULL;
+
+    result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    result = (result ^ (result >> 27)) * 0x94D049BB133111EBULL;
+
+    return result ^ (result >> 31);
+}
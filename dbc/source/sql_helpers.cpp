@@ -19,7 +19,18 @@
 ***********************************************************************************************************************/
 
 #include <QString>
+#include <QVariant>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QRegularExpression>
 
+#include <libpq-fe.h>
+
+#include "log.h"
+#include "query_statistics.h"
 #include "sql_helpers.h"
 
 SqlHelpers::SqlHelpers() {}
@@ -65,3 +76,202 @@ QString SqlHelpers::binaryToText(const QByteArray& binaryData) {
 
     return result;
 }
+
+
+bool SqlHelpers::execute(QSqlQuery& query) {
+    QElapsedTimer timer;
+    timer.start();
+
+    bool success = query.exec();
+    QueryStatistics::instance()->record(query, query.lastQuery(), success, timer.nsecsElapsed());
+
+    return success;
+}
+
+
+bool SqlHelpers::execute(QSqlQuery& query, const QString& statement) {
+    QElapsedTimer timer;
+    timer.start();
+
+    bool success = query.exec(statement);
+    QueryStatistics::instance()->record(query, statement, success, timer.nsecsElapsed());
+
+    return success;
+}
+
+
+pg_conn* SqlHelpers::postgreSqlConnection(const QSqlDatabase& database) {
+    pg_conn* result = nullptr;
+
+    QVariant handle = database.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "PGconn*") == 0) {
+        result = *static_cast<PGconn* const*>(handle.data());
+    }
+
+    return result;
+}
+
+
+bool SqlHelpers::getPartitions(
+        QSqlDatabase&  database,
+        const QString& tableName,
+        bool&          partitioned,
+        PartitionList& partitions
+    ) {
+    QSqlQuery query(database);
+    query.setForwardOnly(true);
+
+    partitioned = false;
+    partitions.clear();
+
+    // A partitioned table with no partitions yet still returns one row with a NULL partition.
+    bool success = execute(
+        query,
+        QString(
+            "SELECT child.relname, pg_get_expr(child.relpartbound, child.oid) "
+            "FROM pg_class AS parent "
+            "LEFT JOIN pg_inherits ON pg_inherits.inhparent = parent.oid "
+            "LEFT JOIN pg_class AS child ON child.oid = pg_inherits.inhrelid "
+            "WHERE parent.relname = '%1' AND parent.relkind = 'p'"
+        ).arg(tableName)
+    );
+
+    if (success) {
+        QRegularExpression boundsExpression("^FOR VALUES FROM \\((-?[0-9]+)\\) TO \\((-?[0-9]+)\\)$");
+        while (success && query.next()) {
+            partitioned = true;
+
+            QRegularExpressionMatch match = boundsExpression.match(query.value(1).toString());
+            if (match.hasMatch()) {
+                Partition partition;
+                partition.partitionName = query.value(0).toString();
+                partition.lowerBound    = match.captured(1).toLongLong(&success);
+
+                if (success) {
+                    partition.upperBound = match.captured(2).toLongLong(&success);
+                }
+
+                if (success) {
+                    partitions.append(partition);
+                }
+            }
+        }
+    } else {
+        logWrite(
+            QString("Failed SELECT partitions of %1: %2")
+            .arg(tableName)
+            .arg(query.lastError().text()),
+            true
+        );
+    }
+
+    return success;
+}
+
+
+bool SqlHelpers::createPartitions(
+        QSqlDatabase&  database,
+        const QString& tableName,
+        long long      partitionPeriod,
+        long long      startKey,
+        long long      endKey
+    ) {
+    bool          partitioned;
+    PartitionList partitions;
+    bool success = getPartitions(database, tableName, partitioned, partitions);
+    if (success && partitioned) {
+        QSqlQuery query(database);
+        for (  long long lowerBound  = startKey - (startKey % partitionPeriod)
+             ; lowerBound < endKey
+             ; lowerBound += partitionPeriod
+            ) {
+            long long upperBound = lowerBound + partitionPeriod;
+
+            bool                          covered = false;
+            PartitionList::const_iterator it      = partitions.constBegin();
+            PartitionList::const_iterator end     = partitions.constEnd();
+            while (!covered && it != end) {
+                covered = (it->lowerBound < upperBound && it->upperBound > lowerBound);
+                ++it;
+            }
+
+            if (!covered) {
+                QString partitionName = QString("%1_p%2").arg(tableName).arg(lowerBound);
+                bool created = execute(
+                    query,
+                    QString("CREATE TABLE %1 PARTITION OF %2 FOR VALUES FROM (%3) TO (%4)")
+                    .arg(partitionName)
+                    .arg(tableName)
+                    .arg(lowerBound)
+                    .arg(upperBound)
+                );
+
+                if (created) {
+                    Partition partition;
+                    partition.partitionName = partitionName;
+                    partition.lowerBound    = lowerBound;
+                    partition.upperBound    = upperBound;
+
+                    partitions.append(partition);
+                } else {
+                    logWrite(
+                        QString("Failed CREATE PARTITION %1: %2")
+                        .arg(partitionName)
+                        .arg(query.lastError().text()),
+                        true
+                    );
+
+                    success = false;
+                }
+            }
+        }
+    }
+
+    return success;
+}
+
+
+bool SqlHelpers::dropPartitions(
+        QSqlDatabase&  database,
+        const QString& tableName,
+        long long      keyThreshold,
+        bool&          partitioned
+    ) {
+    PartitionList partitions;
+    bool success = getPartitions(database, tableName, partitioned, partitions);
+    if (success) {
+        QSqlQuery query(database);
+        for (  PartitionList::const_iterator it  = partitions.constBegin(),
+                                             end = partitions.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            const Partition& partition = *it;
+            if (partition.upperBound <= keyThreshold) {
+                bool dropped = execute(
+                    query,
+                    QString("ALTER TABLE %1 DETACH PARTITION %2").arg(tableName).arg(partition.partitionName)
+                );
+
+                if (dropped) {
+                    dropped = execute(query, QString("DROP TABLE %1").arg(partition.partitionName));
+                }
+
+                if (dropped) {
+                    logWrite(QString("Dropped expired partition %1.").arg(partition.partitionName), false);
+                } else {
+                    logWrite(
+                        QString("Failed DROP PARTITION %1: %2")
+                        .arg(partition.partitionName)
+                        .arg(query.lastError().text()),
+                        true
+                    );
+
+                    success = false;
+                }
+            }
+        }
+    }
+
+    return success;
+}
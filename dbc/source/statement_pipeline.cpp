@@ -0,0 +1,388 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref StatementPipeline class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QVariant>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+#include <cstdlib>
+
+#include <poll.h>
+#include <libpq-fe.h>
+
+#include "log.h"
+#include "query_statistics.h"
+#include "sql_helpers.h"
+#include "statement_pipeline.h"
+
+QAtomicInt StatementPipeline::enabled(1);
+
+StatementPipeline::StatementPipeline(const QSqlDatabase& database):currentDatabase(database) {}
+
+
+StatementPipeline::~StatementPipeline() {}
+
+
+void StatementPipeline::setEnabled(bool nowEnabled) {
+    enabled.storeRelease(nowEnabled ? 1 : 0);
+}
+
+
+bool StatementPipeline::isSupported() {
+    #if (defined(LIBPQ_HAS_PIPELINING))
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+
+void StatementPipeline::append(const QString& statement, const QVariantList& parameters) {
+    Statement entry;
+    entry.text       = statement;
+    entry.parameters = parameters;
+
+    currentStatements.append(entry);
+}
+
+
+bool StatementPipeline::execute() {
+    bool success = true;
+
+    currentLastError.clear();
+    if (!currentStatements.isEmpty()) {
+        pg_conn* connection = nullptr;
+        if (isSupported() && enabled.loadAcquire() != 0) {
+            connection = SqlHelpers::postgreSqlConnection(currentDatabase);
+        }
+
+        if (connection != nullptr) {
+            success = executePipelined(connection);
+        } else {
+            success = executeSequentially();
+        }
+
+        currentStatements.clear();
+    }
+
+    return success;
+}
+
+#if (defined(LIBPQ_HAS_PIPELINING))
+
+    bool StatementPipeline::executePipelined(pg_conn* connection) {
+        resultStatements.clear();
+        completions.clear();
+
+        bool success = (PQenterPipelineMode(connection) == 1 && PQsetnonblocking(connection, 1) == 0);
+        if (success) {
+            bool sent = sendStatements(connection);
+            if (sent) {
+                sent = (PQpipelineSync(connection) == 1);
+            }
+
+            if (!sent) {
+                currentLastError = QString::fromUtf8(PQerrorMessage(connection));
+                PQpipelineSync(connection);
+            }
+
+            // Results for anything that was sent are drained even after a failure so the connection can be handed
+            // back to Qt SQL.
+            bool collected = collectResults(connection);
+            success = sent && collected;
+        } else {
+            currentLastError = QString::fromUtf8(PQerrorMessage(connection));
+        }
+
+        PQsetnonblocking(connection, 0);
+        if (PQpipelineStatus(connection) != PQ_PIPELINE_OFF && PQexitPipelineMode(connection) != 1) {
+            logWrite(
+                QString("Could not leave pipeline mode, resetting connection - StatementPipeline: %1")
+                .arg(QString::fromUtf8(PQerrorMessage(connection))),
+                true
+            );
+
+            PQreset(connection);
+        }
+
+        QueryStatistics* queryStatistics = QueryStatistics::instance();
+        int              numberResults   = completions.size();
+        for (int index=0 ; index<numberResults ; ++index) {
+            const Completion& completion = completions.at(index);
+            queryStatistics->record(
+                currentStatements.at(index).text,
+                completion.success,
+                completion.elapsedTime,
+                completion.rows
+            );
+        }
+
+        return success;
+    }
+
+
+    bool StatementPipeline::sendStatements(pg_conn* connection) {
+        bool       success = true;
+        QByteArray preparedText;
+        bool       prepared = false;
+
+        int numberStatements = currentStatements.size();
+        int statementIndex   = 0;
+        while (success && statementIndex < numberStatements) {
+            const Statement& statement        = currentStatements.at(statementIndex);
+            int              numberParameters = statement.parameters.size();
+            QByteArray       text             = (
+                  numberParameters == 0
+                ? statement.text.toUtf8()
+                : toNumberedPlaceholders(statement.text)
+            );
+
+            if (numberParameters == 0) {
+                success = (
+                    PQsendQueryParams(connection, text.constData(), 0, nullptr, nullptr, nullptr, nullptr, 0) == 1
+                );
+            } else {
+                // Consecutive statements with the same text share the unnamed prepared statement.
+                if (!prepared || text != preparedText) {
+                    success = (PQsendPrepare(connection, "", text.constData(), numberParameters, nullptr) == 1);
+                    if (success) {
+                        resultStatements.append(-1);
+                        preparedText = text;
+                        prepared     = true;
+                    }
+                }
+
+                if (success) {
+                    QList<QByteArray>   values;
+                    QVector<const char*> valuePointers(numberParameters);
+                    QVector<int>         valueLengths(numberParameters);
+                    QVector<int>         valueFormats(numberParameters);
+
+                    for (int parameterIndex=0 ; parameterIndex<numberParameters ; ++parameterIndex) {
+                        const QVariant& parameter = statement.parameters.at(parameterIndex);
+                        if (parameter.isNull()) {
+                            valuePointers[parameterIndex] = nullptr;
+                            valueLengths[parameterIndex]  = 0;
+                            valueFormats[parameterIndex]  = 0;
+                        } else {
+                            bool binary = (parameter.type() == QVariant::ByteArray);
+                            values.append(binary ? parameter.toByteArray() : parameter.toString().toUtf8());
+
+                            valuePointers[parameterIndex] = values.last().constData();
+                            valueLengths[parameterIndex]  = values.last().size();
+                            valueFormats[parameterIndex]  = binary ? 1 : 0;
+                        }
+                    }
+
+                    success = (
+                        PQsendQueryPrepared(
+                            connection,
+                            "",
+                            numberParameters,
+                            valuePointers.constData(),
+                            valueLengths.constData(),
+                            valueFormats.constData(),
+                            0
+                        ) == 1
+                    );
+                }
+            }
+
+            if (success) {
+                resultStatements.append(statementIndex);
+
+                // Opportunistically push data out so the output buffer does not grow to hold the entire pipeline.
+                success = (PQflush(connection) >= 0);
+            }
+
+            ++statementIndex;
+        }
+
+        return success;
+    }
+
+
+    bool StatementPipeline::collectResults(pg_conn* connection) {
+        QElapsedTimer timer;
+        timer.start();
+
+        bool   success         = true;
+        bool   connectionValid = true;
+        bool   finished        = false;
+        int    resultIndex     = 0;
+        int    numberResults   = resultStatements.size();
+        qint64 lastTime        = 0;
+
+        while (connectionValid && !finished) {
+            int flushResult = PQflush(connection);
+            connectionValid = (flushResult >= 0 && PQconsumeInput(connection) == 1);
+
+            while (connectionValid && !finished && resultIndex <= numberResults && PQisBusy(connection) == 0) {
+                PGresult* result = PQgetResult(connection);
+                if (result == nullptr) {
+                    // Marks the end of the results for one statement.
+                    ++resultIndex;
+                } else {
+                    ExecStatusType status = PQresultStatus(result);
+                    if (status == PGRES_PIPELINE_SYNC) {
+                        finished = true;
+                    } else if (status != PGRES_PIPELINE_ABORTED && resultIndex < numberResults) {
+                        bool statementSuccess = (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK);
+                        if (!statementSuccess && success) {
+                            currentLastError = QString::fromUtf8(PQresultErrorMessage(result)).trimmed();
+                        }
+
+                        if (resultStatements.at(resultIndex) >= 0) {
+                            qint64     currentTime = timer.nsecsElapsed();
+                            Completion completion;
+
+                            completion.elapsedTime = currentTime - lastTime;
+                            completion.rows        = std::atoi(PQcmdTuples(result));
+                            completion.success     = statementSuccess;
+
+                            completions.append(completion);
+                            lastTime = currentTime;
+                        }
+
+                        success = success && statementSuccess;
+                    } else {
+                        success = false;
+                    }
+
+                    PQclear(result);
+                }
+            }
+
+            if (connectionValid && !finished) {
+                connectionValid = waitForSocket(connection, flushResult == 1);
+            }
+        }
+
+        if (!connectionValid) {
+            currentLastError = QString::fromUtf8(PQerrorMessage(connection)).trimmed();
+            if (currentLastError.isEmpty()) {
+                currentLastError = QString("Timed out waiting for pipeline results");
+            }
+
+            success = false;
+        }
+
+        return success;
+    }
+
+#else
+
+    bool StatementPipeline::executePipelined(pg_conn* /* connection */) {
+        return executeSequentially();
+    }
+
+
+    bool StatementPipeline::sendStatements(pg_conn* /* connection */) {
+        return false;
+    }
+
+
+    bool StatementPipeline::collectResults(pg_conn* /* connection */) {
+        return false;
+    }
+
+#endif
+
+bool StatementPipeline::waitForSocket(pg_conn* connection, bool write) {
+    pollfd descriptor;
+    descriptor.fd      = PQsocket(connection);
+    descriptor.events  = write ? (POLLIN | POLLOUT) : POLLIN;
+    descriptor.revents = 0;
+
+    return descriptor.fd >= 0 && poll(&descriptor, 1, maximumWaitMilliseconds) > 0;
+}
+
+
+bool StatementPipeline::executeSequentially() {
+    QSqlQuery query(currentDatabase);
+    query.setForwardOnly(true);
+
+    bool    success  = true;
+    bool    prepared = false;
+    QString preparedText;
+
+    QList<Statement>::const_iterator it  = currentStatements.constBegin();
+    QList<Statement>::const_iterator end = currentStatements.constEnd();
+    while (success && it != end) {
+        if (it->parameters.isEmpty()) {
+            success = SqlHelpers::execute(query, it->text);
+        } else {
+            if (!prepared || it->text != preparedText) {
+                success      = query.prepare(it->text);
+                prepared     = success;
+                preparedText = it->text;
+            }
+
+            if (success) {
+                for (  QVariantList::const_iterator parameterIterator    = it->parameters.constBegin(),
+                                                    parameterEndIterator = it->parameters.constEnd()
+                     ; parameterIterator != parameterEndIterator
+                     ; ++parameterIterator
+                    ) {
+                    query.addBindValue(*parameterIterator);
+                }
+
+                success = SqlHelpers::execute(query);
+            }
+        }
+
+        if (!success) {
+            currentLastError = query.lastError().text();
+        }
+
+        ++it;
+    }
+
+    return success;
+}
+
+
+QByteArray StatementPipeline::toNumberedPlaceholders(const QString& statement) {
+    QString  result;
+    unsigned parameterNumber = 0;
+    bool     quoted          = false;
+
+    result.reserve(statement.size() + 16);
+    for (QString::const_iterator it=statement.constBegin(),end=statement.constEnd() ; it!=end ; ++it) {
+        QChar c = *it;
+        if (c == QChar('\'')) {
+            quoted = !quoted;
+            result += c;
+        } else if (c == QChar('?') && !quoted) {
+            ++parameterNumber;
+            result += QString("$%1").arg(parameterNumber);
+        } else {
+            result += c;
+        }
+    }
+
+    return result.toUtf8();
+}
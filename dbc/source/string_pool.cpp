@@ -0,0 +1,73 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref StringPool class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "string_pool.h"
+
+QMutex        StringPool::poolMutex;
+QSet<QString> StringPool::pool;
+
+QString StringPool::intern(const QString& str) {
+    QString result;
+
+    if (!str.isEmpty()) {
+        QMutexLocker poolMutexLocker(&poolMutex);
+
+        QSet<QString>::const_iterator it = pool.constFind(str);
+        if (it != pool.constEnd()) {
+            result = *it;
+        } else {
+            pool.insert(str);
+            result = str;
+        }
+    }
+
+    return result;
+}
+
+
+unsigned long StringPool::purge() {
+    unsigned long numberReleased = 0;
+
+    QMutexLocker poolMutexLocker(&poolMutex);
+
+    QSet<QString>::iterator it = pool.begin();
+    while (it != pool.end()) {
+        // A detached string holds the only reference to its buffer so nothing outside the pool is using it.
+        if (it->isDetached()) {
+            it = pool.erase(it);
+            ++numberReleased;
+        } else {
+            ++it;
+        }
+    }
+
+    return numberReleased;
+}
+
+
+unsigned long StringPool::size() {
+    QMutexLocker poolMutexLocker(&poolMutex);
+    return static_cast<unsigned long>(pool.size());
+}
@@ -0,0 +1,323 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref ThreadPlacement class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "metrics_registry.h"
+#include "thread_placement.h"
+
+/***********************************************************************************************************************
+* ThreadPlacement::Scope
+*/
+
+ThreadPlacement::Scope::Scope(ThreadPlacement::Subsystem subsystem):currentSubsystem(subsystem) {
+    ThreadPlacement::instance()->enter(subsystem);
+}
+
+
+ThreadPlacement::Scope::~Scope() {
+    ThreadPlacement::instance()->leave(currentSubsystem);
+}
+
+/***********************************************************************************************************************
+* ThreadPlacement
+*/
+
+ThreadPlacement* ThreadPlacement::instance() {
+    // The instance is intentionally never destroyed so that threads stopping during shutdown can leave their scope.
+    static ThreadPlacement* threadPlacement = new ThreadPlacement;
+    return threadPlacement;
+}
+
+
+void ThreadPlacement::setPlacement(ThreadPlacement::Subsystem subsystem, const ThreadPlacement::Placement& placement) {
+    unsigned subsystemIndex = static_cast<unsigned>(subsystem);
+
+    QMutexLocker locker(&placementMutex);
+    placements[subsystemIndex] = placement;
+
+    const QList<PlacedThread>& subsystemThreads = threads[subsystemIndex];
+    for (  QList<PlacedThread>::const_iterator it  = subsystemThreads.constBegin(),
+                                               end = subsystemThreads.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        apply(*it, placement);
+    }
+}
+
+
+QString ThreadPlacement::toString(ThreadPlacement::Subsystem subsystem) {
+    QString result;
+
+    switch (subsystem) {
+        case Subsystem::LATENCY_INTERFACE: {
+            result = QString("latency_interface");
+            break;
+        }
+
+        case Subsystem::AGGREGATION: {
+            result = QString("aggregation");
+            break;
+        }
+
+        case Subsystem::QUERY: {
+            result = QString("query");
+            break;
+        }
+
+        case Subsystem::RESOURCES: {
+            result = QString("resources");
+            break;
+        }
+
+        case Subsystem::PLOT: {
+            result = QString("plot");
+            break;
+        }
+
+        case Subsystem::JOB: {
+            result = QString("job");
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+ThreadPlacement::Subsystem ThreadPlacement::toSubsystem(const QString& str, bool* success) {
+    Subsystem result = Subsystem::JOB;
+    bool      found  = false;
+
+    unsigned subsystemIndex = 0;
+    while (!found && subsystemIndex < numberSubsystems) {
+        Subsystem subsystem = static_cast<Subsystem>(subsystemIndex);
+        if (toString(subsystem) == str) {
+            result = subsystem;
+            found  = true;
+        } else {
+            ++subsystemIndex;
+        }
+    }
+
+    if (success != nullptr) {
+        *success = found;
+    }
+
+    return result;
+}
+
+
+QList<unsigned> ThreadPlacement::toCpuList(const QString& str, bool* success) {
+    QList<unsigned> result;
+    bool            ok = !str.trimmed().isEmpty();
+
+    QStringList ranges = str.split(QChar(','));
+    for (  QStringList::const_iterator it = ranges.constBegin(), end = ranges.constEnd()
+         ; ok && it != end
+         ; ++it
+        ) {
+        QStringList bounds = it->trimmed().split(QChar('-'));
+        if (bounds.size() == 1 || bounds.size() == 2) {
+            unsigned first = bounds.first().trimmed().toUInt(&ok);
+            unsigned last  = first;
+            if (ok && bounds.size() == 2) {
+                last = bounds.last().trimmed().toUInt(&ok);
+            }
+
+            ok = ok && first <= last && last < static_cast<unsigned>(CPU_SETSIZE);
+            for (unsigned cpu=first ; ok && cpu<=last ; ++cpu) {
+                if (!result.contains(cpu)) {
+                    result.append(cpu);
+                }
+            }
+        } else {
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        std::sort(result.begin(), result.end());
+    } else {
+        result.clear();
+    }
+
+    if (success != nullptr) {
+        *success = ok;
+    }
+
+    return result;
+}
+
+
+ThreadPlacement::ThreadPlacement() {
+    MetricsRegistry* metricsRegistry = MetricsRegistry::instance();
+    for (unsigned subsystemIndex=0 ; subsystemIndex<numberSubsystems ; ++subsystemIndex) {
+        Subsystem subsystem = static_cast<Subsystem>(subsystemIndex);
+        QString   labels    = MetricsRegistry::label(QString("subsystem"), toString(subsystem));
+
+        retiredCpuSeconds[subsystemIndex] = 0;
+
+        metricsRegistry->addSampler(
+            MetricsRegistry::Type::COUNTER,
+            QString("dbc_thread_cpu_seconds_total"),
+            QString("CPU time used by the threads of each background subsystem, in seconds."),
+            labels,
+            [this, subsystem]() {
+                return subsystemCpuSeconds(subsystem);
+            }
+        );
+        metricsRegistry->addSampler(
+            MetricsRegistry::Type::GAUGE,
+            QString("dbc_threads"),
+            QString("Number of running threads in each background subsystem."),
+            labels,
+            [this, subsystem]() {
+                return static_cast<double>(numberThreads(subsystem));
+            }
+        );
+    }
+}
+
+
+ThreadPlacement::~ThreadPlacement() {}
+
+
+void ThreadPlacement::enter(ThreadPlacement::Subsystem subsystem) {
+    unsigned subsystemIndex = static_cast<unsigned>(subsystem);
+
+    PlacedThread placedThread;
+    placedThread.handle      = pthread_self();
+    placedThread.threadId    = static_cast<pid_t>(syscall(SYS_gettid));
+    placedThread.hasCpuClock = (pthread_getcpuclockid(placedThread.handle, &placedThread.cpuClock) == 0);
+
+    QMutexLocker locker(&placementMutex);
+    threads[subsystemIndex].append(placedThread);
+    apply(placedThread, placements[subsystemIndex]);
+}
+
+
+void ThreadPlacement::leave(ThreadPlacement::Subsystem subsystem) {
+    unsigned  subsystemIndex = static_cast<unsigned>(subsystem);
+    pthread_t handle         = pthread_self();
+
+    QMutexLocker locker(&placementMutex);
+
+    QList<PlacedThread>& subsystemThreads = threads[subsystemIndex];
+    QList<PlacedThread>::iterator it  = subsystemThreads.begin();
+    QList<PlacedThread>::iterator end = subsystemThreads.end();
+    while (it != end && !pthread_equal(it->handle, handle)) {
+        ++it;
+    }
+
+    if (it != end) {
+        retiredCpuSeconds[subsystemIndex] += cpuSeconds(*it);
+        subsystemThreads.erase(it);
+    }
+}
+
+
+void ThreadPlacement::apply(const ThreadPlacement::PlacedThread& placedThread, const Placement& placement) {
+    if (!placement.cpus.isEmpty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+
+        for (  QList<unsigned>::const_iterator it = placement.cpus.constBegin(), end = placement.cpus.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            CPU_SET(*it, &cpuSet);
+        }
+
+        int status = pthread_setaffinity_np(placedThread.handle, sizeof(cpuSet), &cpuSet);
+        if (status != 0) {
+            logWrite(
+                QString("Failed to set CPU affinity - ThreadPlacement::apply: %1").arg(std::strerror(status)),
+                true
+            );
+        }
+    }
+
+    if (placement.adjustNice) {
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(placedThread.threadId), placement.nice) != 0) {
+            logWrite(
+                QString("Failed to set nice value - ThreadPlacement::apply: %1").arg(std::strerror(errno)),
+                true
+            );
+        }
+    }
+}
+
+
+double ThreadPlacement::cpuSeconds(const ThreadPlacement::PlacedThread& placedThread) {
+    double result = 0;
+
+    if (placedThread.hasCpuClock) {
+        struct timespec cpuTime;
+        if (clock_gettime(placedThread.cpuClock, &cpuTime) == 0) {
+            result = static_cast<double>(cpuTime.tv_sec) + static_cast<double>(cpuTime.tv_nsec) / 1.0E9;
+        }
+    }
+
+    return result;
+}
+
+
+double ThreadPlacement::subsystemCpuSeconds(ThreadPlacement::Subsystem subsystem) {
+    unsigned subsystemIndex = static_cast<unsigned>(subsystem);
+
+    QMutexLocker locker(&placementMutex);
+
+    double result = retiredCpuSeconds[subsystemIndex];
+
+    const QList<PlacedThread>& subsystemThreads = threads[subsystemIndex];
+    for (  QList<PlacedThread>::const_iterator it  = subsystemThreads.constBegin(),
+                                               end = subsystemThreads.constEnd()
+         ; it != end
+         ; ++it
+        ) {
+        result += cpuSeconds(*it);
+    }
+
+    return result;
+}
+
+
+unsigned ThreadPlacement::numberThreads(ThreadPlacement::Subsystem subsystem) {
+    QMutexLocker locker(&placementMutex);
+    return static_cast<unsigned>(threads[static_cast<unsigned>(subsystem)].size());
+}
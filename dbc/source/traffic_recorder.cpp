@@ -0,0 +1,133 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref TrafficRecorder class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QFile>
+#include <QIODevice>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QtEndian>
+
+#include <cstdint>
+
+#include "log.h"
+#include "traffic_recorder.h"
+
+const unsigned long long TrafficRecorder::defaultMaximumCaptureSize = 1ULL << 30;
+
+TrafficRecorder* TrafficRecorder::instance() {
+    static TrafficRecorder* trafficRecorder = new TrafficRecorder;
+    return trafficRecorder;
+}
+
+
+bool TrafficRecorder::setCaptureFile(const QString& filename, unsigned long long maximumCaptureSize) {
+    bool success = true;
+
+    QMutexLocker captureMutexLocker(&captureMutex);
+
+    currentMaximumCaptureSize = maximumCaptureSize;
+
+    // A capture stopped by its size limit is only restarted when the file changes so that reloading the
+    // configuration can not overwrite it.
+    if (filename != currentFilename) {
+        currentFilename = filename;
+
+        capturing.storeRelease(0);
+        if (captureFile.isOpen()) {
+            captureFile.close();
+            logWrite(QString("Stopped capturing traffic to %1").arg(captureFile.fileName()), false);
+        }
+
+        if (!filename.isEmpty()) {
+            captureFile.setFileName(filename);
+            success = captureFile.open(QIODevice::WriteOnly | QIODevice::Truncate);
+            if (success) {
+                QByteArray header("DBCCAP01");
+                header.resize(16);
+                qToLittleEndian<quint64>(
+                    static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()),
+                    reinterpret_cast<uchar*>(header.data() + 8)
+                );
+
+                success = (captureFile.write(header) == header.size());
+                if (success) {
+                    captureTimer.start();
+                    capturing.storeRelease(1);
+
+                    logWrite(QString("Capturing traffic to %1").arg(filename), false);
+                } else {
+                    captureFile.close();
+                }
+            }
+        }
+    }
+
+    return success;
+}
+
+
+TrafficRecorder::TrafficRecorder() {
+    capturing.storeRelease(0);
+    currentMaximumCaptureSize = defaultMaximumCaptureSize;
+}
+
+
+TrafficRecorder::~TrafficRecorder() {}
+
+
+void TrafficRecorder::write(const QString& path, unsigned long customerId, const QByteArray& payload) {
+    QByteArray pathBytes = path.toUtf8().left(0xFFFF);
+    QByteArray record(22, '\0');
+
+    record.reserve(record.size() + pathBytes.size() + payload.size());
+    record.append(pathBytes);
+    record.append(payload);
+
+    uchar* d = reinterpret_cast<uchar*>(record.data());
+    qToLittleEndian<quint64>(static_cast<quint64>(customerId), d + 8);
+    qToLittleEndian<quint16>(static_cast<quint16>(pathBytes.size()), d + 16);
+    qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), d + 18);
+
+    QMutexLocker captureMutexLocker(&captureMutex);
+
+    // The capture may have been stopped while we were building the record.
+    if (captureFile.isOpen()) {
+        qToLittleEndian<quint64>(static_cast<quint64>(captureTimer.nsecsElapsed()), d);
+
+        if (static_cast<unsigned long long>(captureFile.size() + record.size()) > currentMaximumCaptureSize) {
+            capturing.storeRelease(0);
+            captureFile.close();
+
+            captureMutexLocker.unlock();
+            logWrite(QString("Traffic capture reached its size limit and was stopped."), LogSeverity::WARNING);
+        } else if (captureFile.write(record) != record.size() || !captureFile.flush()) {
+            capturing.storeRelease(0);
+            captureFile.close();
+
+            captureMutexLocker.unlock();
+            logWrite(QString("Traffic capture failed and was stopped."), true);
+        }
+    }
+}
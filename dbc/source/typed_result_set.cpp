@@ -0,0 +1,431 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref TypedResultSet class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlError>
+#include <QtEndian>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <libpq-fe.h>
+
+#include "log.h"
+#include "query_statistics.h"
+#include "sql_helpers.h"
+#include "typed_result_set.h"
+
+TypedResultSet::TypedResultSet(const QSqlDatabase& database):currentDatabase(database) {
+    currentSize = 0;
+}
+
+
+TypedResultSet::~TypedResultSet() {}
+
+
+bool TypedResultSet::execute(const QString& statement, const Column* columns, unsigned numberColumns) {
+    bool success;
+
+    currentLastError.clear();
+    currentSize = 0;
+
+    columnBuffers.clear();
+    columnBuffers.resize(static_cast<int>(numberColumns));
+    for (unsigned column=0 ; column<numberColumns ; ++column) {
+        columnBuffers[column].type = columns[column].type;
+    }
+
+    pg_conn* connection = SqlHelpers::postgreSqlConnection(currentDatabase);
+    if (connection != nullptr) {
+        success = executePostgreSql(connection, statement.toUtf8(), columns);
+    } else {
+        success = executeGeneric(statement, columns);
+    }
+
+    if (!success) {
+        resizeBuffers(0);
+    }
+
+    return success;
+}
+
+
+bool TypedResultSet::executePostgreSql(pg_conn* connection, const QByteArray& statement, const Column* columns) {
+    QElapsedTimer timer;
+    timer.start();
+
+    PGresult* result  = PQexecParams(connection, statement.constData(), 0, nullptr, nullptr, nullptr, nullptr, 1);
+    bool      success = (PQresultStatus(result) == PGRES_TUPLES_OK);
+    if (success) {
+        // A column type without a binary decoder, NUMERIC for example, forces the slower text format.
+        bool binary        = true;
+        int  numberColumns = columnBuffers.size();
+        int  column        = 0;
+        while (binary && column < numberColumns) {
+            int field = PQfnumber(result, columns[column].name);
+            binary = (field < 0 || binaryDecodable(PQftype(result, field), columns[column].type));
+            ++column;
+        }
+
+        if (!binary) {
+            PQclear(result);
+            result  = PQexecParams(connection, statement.constData(), 0, nullptr, nullptr, nullptr, nullptr, 0);
+            success = (PQresultStatus(result) == PGRES_TUPLES_OK);
+        }
+    }
+
+    if (success) {
+        success = decodeResult(result, columns);
+    } else {
+        currentLastError = QString::fromUtf8(PQresultErrorMessage(result)).trimmed();
+    }
+
+    QueryStatistics::instance()->record(
+        QString::fromUtf8(statement),
+        success,
+        timer.nsecsElapsed(),
+        static_cast<int>(currentSize)
+    );
+
+    PQclear(result);
+    return success;
+}
+
+
+bool TypedResultSet::decodeResult(const pg_result* result, const Column* columns) {
+    bool          success       = true;
+    int           numberColumns = columnBuffers.size();
+    unsigned long numberRows    = static_cast<unsigned long>(PQntuples(result));
+
+    resizeBuffers(numberRows);
+
+    int column = 0;
+    while (success && column < numberColumns) {
+        int field = PQfnumber(result, columns[column].name);
+        if (field >= 0) {
+            ColumnBuffer& buffer  = columnBuffers[column];
+            unsigned      typeOid = PQftype(result, field);
+            bool          binary  = (PQfformat(result, field) == 1);
+
+            unsigned long row = 0;
+            while (success && row < numberRows) {
+                int rowIndex = static_cast<int>(row);
+                if (PQgetisnull(result, rowIndex, field)) {
+                    success = (buffer.type == ColumnType::BYTES);
+                } else {
+                    const char* data   = PQgetvalue(result, rowIndex, field);
+                    int         length = PQgetlength(result, rowIndex, field);
+
+                    switch (buffer.type) {
+                        case ColumnType::UINT32: {
+                            std::uint64_t value = 0;
+                            if (binary) {
+                                success = decodeBinaryInteger(typeOid, data, length, value);
+                            } else {
+                                char* end;
+                                value   = std::strtoull(data, &end, 10);
+                                success = (end != data && *end == '\0' && data[0] != '-');
+                            }
+
+                            success = success && value <= 0xFFFFFFFFULL;
+                            buffer.uint32Values[row] = static_cast<std::uint32_t>(value);
+
+                            break;
+                        }
+
+                        case ColumnType::UINT64: {
+                            std::uint64_t value = 0;
+                            if (binary) {
+                                success = decodeBinaryInteger(typeOid, data, length, value);
+                            } else {
+                                char* end;
+                                value   = std::strtoull(data, &end, 10);
+                                success = (end != data && *end == '\0' && data[0] != '-');
+                            }
+
+                            buffer.uint64Values[row] = value;
+                            break;
+                        }
+
+                        case ColumnType::DOUBLE: {
+                            double value = 0;
+                            if (binary) {
+                                success = decodeBinaryNumber(typeOid, data, length, value);
+                            } else {
+                                char* end;
+                                value   = std::strtod(data, &end);
+                                success = (end != data && *end == '\0');
+                            }
+
+                            buffer.doubleValues[row] = value;
+                            break;
+                        }
+
+                        case ColumnType::BYTES: {
+                            if (binary) {
+                                buffer.byteArrayValues[rowIndex] = QByteArray(data, length);
+                            } else {
+                                std::size_t    unescapedLength;
+                                unsigned char* unescaped = PQunescapeBytea(
+                                    reinterpret_cast<const unsigned char*>(data),
+                                    &unescapedLength
+                                );
+
+                                success = (unescaped != nullptr);
+                                if (success) {
+                                    buffer.byteArrayValues[rowIndex] = QByteArray(
+                                        reinterpret_cast<const char*>(unescaped),
+                                        static_cast<int>(unescapedLength)
+                                    );
+
+                                    PQfreemem(unescaped);
+                                }
+                            }
+
+                            break;
+                        }
+
+                        default: {
+                            success = false;
+                            break;
+                        }
+                    }
+                }
+
+                if (!success) {
+                    currentLastError = QString("Invalid value in column %1, row %2")
+                                       .arg(QString::fromUtf8(columns[column].name))
+                                       .arg(row);
+                }
+
+                ++row;
+            }
+        } else {
+            currentLastError = QString("Missing column %1").arg(QString::fromUtf8(columns[column].name));
+            success          = false;
+        }
+
+        ++column;
+    }
+
+    if (success) {
+        currentSize = numberRows;
+    }
+
+    return success;
+}
+
+
+bool TypedResultSet::executeGeneric(const QString& statement, const Column* columns) {
+    QSqlQuery query(currentDatabase);
+    query.setForwardOnly(true);
+
+    bool success = SqlHelpers::execute(query, statement);
+    if (success) {
+        int        numberColumns = columnBuffers.size();
+        QList<int> fields;
+        for (int column=0 ; column<numberColumns ; ++column) {
+            int field = query.record().indexOf(QString::fromUtf8(columns[column].name));
+            if (field < 0 && success) {
+                currentLastError = QString("Missing column %1").arg(QString::fromUtf8(columns[column].name));
+                success          = false;
+            }
+
+            fields.append(field);
+        }
+
+        unsigned long numberRows = 0;
+        while (success && query.next()) {
+            resizeBuffers(numberRows + 1);
+
+            int column = 0;
+            while (success && column < numberColumns) {
+                ColumnBuffer&   buffer = columnBuffers[column];
+                const QVariant& value  = query.value(fields.at(column));
+
+                switch (buffer.type) {
+                    case ColumnType::UINT32: {
+                        buffer.uint32Values[numberRows] = value.toUInt(&success);
+                        break;
+                    }
+
+                    case ColumnType::UINT64: {
+                        buffer.uint64Values[numberRows] = value.toULongLong(&success);
+                        break;
+                    }
+
+                    case ColumnType::DOUBLE: {
+                        buffer.doubleValues[numberRows] = value.toDouble(&success);
+                        break;
+                    }
+
+                    case ColumnType::BYTES: {
+                        buffer.byteArrayValues[static_cast<int>(numberRows)] = value.toByteArray();
+                        break;
+                    }
+
+                    default: {
+                        success = false;
+                        break;
+                    }
+                }
+
+                if (!success) {
+                    currentLastError = QString("Invalid value in column %1, row %2")
+                                       .arg(QString::fromUtf8(columns[column].name))
+                                       .arg(numberRows);
+                }
+
+                ++column;
+            }
+
+            ++numberRows;
+        }
+
+        if (success) {
+            currentSize = numberRows;
+        }
+    } else {
+        currentLastError = query.lastError().text();
+    }
+
+    return success;
+}
+
+
+bool TypedResultSet::binaryDecodable(unsigned typeOid, ColumnType type) {
+    bool result;
+
+    switch (type) {
+        case ColumnType::UINT32:
+        case ColumnType::UINT64: {
+            result = (typeOid == int2Oid || typeOid == int4Oid || typeOid == int8Oid);
+            break;
+        }
+
+        case ColumnType::DOUBLE: {
+            result = (
+                   typeOid == int2Oid
+                || typeOid == int4Oid
+                || typeOid == int8Oid
+                || typeOid == float4Oid
+                || typeOid == float8Oid
+            );
+
+            break;
+        }
+
+        case ColumnType::BYTES: {
+            result = (typeOid == byteaOid);
+            break;
+        }
+
+        default: {
+            result = false;
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+bool TypedResultSet::decodeBinaryNumber(unsigned typeOid, const char* data, int length, double& value) {
+    bool success = true;
+
+    if (typeOid == float8Oid && length == 8) {
+        std::uint64_t bits = qFromBigEndian<std::uint64_t>(data);
+        std::memcpy(&value, &bits, sizeof(value));
+    } else if (typeOid == float4Oid && length == 4) {
+        std::uint32_t bits = qFromBigEndian<std::uint32_t>(data);
+        float         singleValue;
+        std::memcpy(&singleValue, &bits, sizeof(singleValue));
+        value = singleValue;
+    } else if (typeOid == int2Oid && length == 2) {
+        value = qFromBigEndian<std::int16_t>(data);
+    } else if (typeOid == int4Oid && length == 4) {
+        value = qFromBigEndian<std::int32_t>(data);
+    } else if (typeOid == int8Oid && length == 8) {
+        value = static_cast<double>(qFromBigEndian<std::int64_t>(data));
+    } else {
+        success = false;
+    }
+
+    return success;
+}
+
+
+bool TypedResultSet::decodeBinaryInteger(unsigned typeOid, const char* data, int length, std::uint64_t& value) {
+    std::int64_t signedValue;
+    bool         success = true;
+
+    if (typeOid == int2Oid && length == 2) {
+        signedValue = qFromBigEndian<std::int16_t>(data);
+    } else if (typeOid == int4Oid && length == 4) {
+        signedValue = qFromBigEndian<std::int32_t>(data);
+    } else if (typeOid == int8Oid && length == 8) {
+        signedValue = qFromBigEndian<std::int64_t>(data);
+    } else {
+        signedValue = 0;
+        success     = false;
+    }
+
+    success = success && signedValue >= 0;
+    value   = static_cast<std::uint64_t>(signedValue);
+
+    return success;
+}
+
+
+void TypedResultSet::resizeBuffers(unsigned long numberRows) {
+    int numberColumns = columnBuffers.size();
+    for (int column=0 ; column<numberColumns ; ++column) {
+        ColumnBuffer& buffer = columnBuffers[column];
+        switch (buffer.type) {
+            case ColumnType::UINT32: {
+                buffer.uint32Values.resize(numberRows);
+                break;
+            }
+
+            case ColumnType::UINT64: {
+                buffer.uint64Values.resize(numberRows);
+                break;
+            }
+
+            case ColumnType::DOUBLE: {
+                buffer.doubleValues.resize(numberRows);
+                break;
+            }
+
+            case ColumnType::BYTES: {
+                buffer.byteArrayValues.resize(static_cast<int>(numberRows));
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+* \file
+*
+* This file implements the \ref WarmStart class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include "log.h"
+#include "catalog.h"
+#include "periodic_scheduler.h"
+#include "warm_start.h"
+
+const unsigned long WarmStart::defaultSaveIntervalSeconds = 15 * 60;
+
+WarmStart::WarmStart(
+        Catalog* catalog,
+        QObject* parent
+    ):QThread(
+        parent
+    ),currentCatalog(
+        catalog
+    ) {
+    restoreAttempted = false;
+    saveTaskId       = PeriodicScheduler::instance()->registerTask(
+        QString("catalog_snapshot_save"),
+        QString(),
+        60,
+        [this]() {
+            save();
+        }
+    );
+}
+
+
+WarmStart::~WarmStart() {
+    PeriodicScheduler::instance()->unregisterTask(saveTaskId);
+    wait();
+
+    save();
+}
+
+
+void WarmStart::configure(const QString& filename, unsigned long saveIntervalSeconds) {
+    filenameMutex.lock();
+    bool restore = !restoreAttempted && !filename.isEmpty();
+    currentFilename = filename;
+    if (restore) {
+        restoreAttempted = true;
+    }
+    filenameMutex.unlock();
+
+    if (restore && currentCatalog->restoreSnapshot(filename, warmStartThreadId)) {
+        start(QThread::LowPriority);
+    }
+
+    PeriodicScheduler::instance()->setPeriod(saveTaskId, filename.isEmpty() ? 0 : saveIntervalSeconds);
+}
+
+
+bool WarmStart::save() {
+    filenameMutex.lock();
+    QString filename = currentFilename;
+    filenameMutex.unlock();
+
+    return !filename.isEmpty() && currentCatalog->saveSnapshot(filename);
+}
+
+
+void WarmStart::run() {
+    QElapsedTimer timer;
+    timer.start();
+
+    bool success = currentCatalog->reconcileNow(warmStartThreadId);
+    if (success) {
+        logWrite(QString("Restored catalog reconciled in %1 mSec.").arg(timer.elapsed()), false);
+    } else {
+        logWrite(QString("Could not reconcile restored catalog, readers will retry."), true);
+    }
+}
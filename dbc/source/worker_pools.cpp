@@ -0,0 +1,213 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2021 - 2023 Inesonic, LLC.
+*
+* GNU Public License, Version 3:
+*   This program is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+*   License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later
+*   version.
+*   
+*   This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+*   warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+*   details.
+*   
+*   You should have received a copy of the GNU General Public License along with this program.  If not, see
+*   <https://www.gnu.org/licenses/>.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref WorkerPools class.
+***********************************************************************************************************************/
+
+#include <QString>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+#include "metrics_registry.h"
+#include "worker_pools.h"
+
+/***********************************************************************************************************************
+* WorkerPools::Admission
+*/
+
+WorkerPools::Admission::Admission(WorkerPools::Pool pool):currentPool(pool) {
+    currentAdmitted = WorkerPools::instance()->acquire(pool);
+}
+
+
+WorkerPools::Admission::~Admission() {
+    if (currentAdmitted) {
+        WorkerPools::instance()->release(currentPool);
+    }
+}
+
+/***********************************************************************************************************************
+* WorkerPools
+*/
+
+const unsigned WorkerPools::defaultQueueTimeoutMilliseconds = 1000;
+const unsigned WorkerPools::defaultMaximumQueued            = 64;
+
+WorkerPools* WorkerPools::instance() {
+    // The pools are intentionally never destroyed so that requests in flight during shutdown can release workers.
+    static WorkerPools* pools = new WorkerPools;
+    return pools;
+}
+
+
+void WorkerPools::setWorkers(unsigned totalWorkers, unsigned ingestReserved) {
+    QMutexLocker locker(&poolMutex);
+
+    if (totalWorkers == 0) {
+        currentSharedWorkers = 0;
+    } else {
+        currentSharedWorkers = totalWorkers > ingestReserved ? totalWorkers - ingestReserved : 1;
+    }
+
+    workerReleased.wakeAll();
+}
+
+
+void WorkerPools::setPoolLimits(WorkerPools::Pool pool, unsigned newMaximumWorkers, unsigned newMaximumQueued) {
+    QMutexLocker locker(&poolMutex);
+
+    unsigned poolIndex = static_cast<unsigned>(pool);
+    maximumWorkers[poolIndex] = newMaximumWorkers;
+    maximumQueued[poolIndex]  = newMaximumQueued;
+
+    workerReleased.wakeAll();
+}
+
+
+void WorkerPools::setQueueTimeout(unsigned newQueueTimeoutMilliseconds) {
+    QMutexLocker locker(&poolMutex);
+    currentQueueTimeoutMilliseconds = newQueueTimeoutMilliseconds;
+}
+
+
+QString WorkerPools::toString(WorkerPools::Pool pool) {
+    QString result;
+
+    switch (pool) {
+        case Pool::INGEST: {
+            result = QString("ingest");
+            break;
+        }
+
+        case Pool::CUSTOMER: {
+            result = QString("customer");
+            break;
+        }
+
+        case Pool::PLOT: {
+            result = QString("plot");
+            break;
+        }
+
+        case Pool::ADMIN: {
+            result = QString("admin");
+            break;
+        }
+    }
+
+    return result;
+}
+
+
+WorkerPools::WorkerPools() {
+    currentSharedWorkers            = 0;
+    numberSharedActive              = 0;
+    currentQueueTimeoutMilliseconds = defaultQueueTimeoutMilliseconds;
+
+    MetricsRegistry* registry = MetricsRegistry::instance();
+    for (unsigned poolIndex=0 ; poolIndex<numberPools ; ++poolIndex) {
+        QString labels = MetricsRegistry::label(QString("pool"), toString(static_cast<Pool>(poolIndex)));
+
+        maximumWorkers[poolIndex] = 0;
+        maximumQueued[poolIndex]  = defaultMaximumQueued;
+        numberActive[poolIndex]   = 0;
+        numberQueued[poolIndex]   = 0;
+
+        activeMetrics[poolIndex] = registry->gauge(
+            QString("dbc_worker_pool_active"),
+            QString("Number of requests running in each worker pool."),
+            labels
+        );
+        rejectedMetrics[poolIndex] = registry->counter(
+            QString("dbc_worker_pool_rejected_total"),
+            QString("Number of requests refused because a worker pool was saturated."),
+            labels
+        );
+    }
+}
+
+
+WorkerPools::~WorkerPools() {}
+
+
+bool WorkerPools::acquire(WorkerPools::Pool pool) {
+    bool     result;
+    unsigned poolIndex = static_cast<unsigned>(pool);
+
+    QMutexLocker locker(&poolMutex);
+
+    if (pool == Pool::INGEST) {
+        result = true;
+    } else {
+        result = workerAvailable(poolIndex);
+        if (!result && numberQueued[poolIndex] < maximumQueued[poolIndex]) {
+            QElapsedTimer waitTimer;
+            bool          timedOut = false;
+
+            waitTimer.start();
+            ++numberQueued[poolIndex];
+            while (!result && !timedOut) {
+                unsigned long long waitedMilliseconds = static_cast<unsigned long long>(waitTimer.elapsed());
+                if (waitedMilliseconds >= currentQueueTimeoutMilliseconds) {
+                    timedOut = true;
+                } else {
+                    workerReleased.wait(&poolMutex, currentQueueTimeoutMilliseconds - waitedMilliseconds);
+                    result = workerAvailable(poolIndex);
+                }
+            }
+            --numberQueued[poolIndex];
+        }
+
+        if (result) {
+            ++numberSharedActive;
+        } else {
+            rejectedMetrics[poolIndex]->increment();
+        }
+    }
+
+    if (result) {
+        ++numberActive[poolIndex];
+        activeMetrics[poolIndex]->set(numberActive[poolIndex]);
+    }
+
+    return result;
+}
+
+
+void WorkerPools::release(WorkerPools::Pool pool) {
+    unsigned poolIndex = static_cast<unsigned>(pool);
+
+    QMutexLocker locker(&poolMutex);
+
+    --numberActive[poolIndex];
+    activeMetrics[poolIndex]->set(numberActive[poolIndex]);
+
+    if (pool != Pool::INGEST) {
+        --numberSharedActive;
+        workerReleased.wakeAll();
+    }
+}
+
+
+bool WorkerPools::workerAvailable(unsigned poolIndex) const {
+    return (
+           (maximumWorkers[poolIndex] == 0 || numberActive[poolIndex] < maximumWorkers[poolIndex])
+        && (currentSharedWorkers == 0 || numberSharedActive < currentSharedWorkers)
+    );
+}
@@ -43,6 +43,9 @@ GRANT CONNECT,CREATE,TEMPORARY ON DATABASE speedsentry_backend TO DbCAdmin;
 
 \c speedsentry_backend;
 
+-- The DbC creates and drops latency table partitions so it needs to create tables in the public schema.
+GRANT CREATE ON SCHEMA public TO DbC;
+
 -- ---------------------------------------------------------------------------------------------------------------------
 -- Regions table
 -- The regions table tracks the regions where polling servers reside.  We maintain a 1-to-many relationship between
@@ -130,9 +133,27 @@ CREATE TABLE customer_mapping (
         ON DELETE CASCADE ON UPDATE NO ACTION
 );
 
+-- Servers look up the customers they serve and server removal cascades by server ID.
+CREATE INDEX customer_mapping_server_index ON customer_mapping (server_id);
+
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE customer_mapping TO DbC;
 GRANT ALL PRIVILEGES ON TABLE customer_mapping TO DbCAdmin;
 
+-- ---------------------------------------------------------------------------------------------------------------------
+-- DbC shards table
+-- The DbC shards table lists the database controller shards.  Customers are assigned to shards using a consistent hash
+-- ring holding the listed number of virtual nodes per shard.  Polling servers post latency for a customer to the base
+-- URL of the owning shard.  The table is only consulted by controllers configured with a non-zero shard ID.
+
+CREATE TABLE dbc_shards (
+    shard_id      SMALLINT NOT NULL PRIMARY KEY,
+    base_url      TEXT NOT NULL,
+    virtual_nodes SMALLINT NOT NULL DEFAULT 64
+);
+
+GRANT SELECT ON TABLE dbc_shards TO DbC;
+GRANT ALL PRIVILEGES ON TABLE dbc_shards TO DbCAdmin;
+
 -- ---------------------------------------------------------------------------------------------------------------------
 -- Host/Scheme table
 -- The host/scheme table stores information about a single authority referenced by a customer.  The table also stores
@@ -151,6 +172,9 @@ CREATE TABLE host_scheme (
         ON DELETE CASCADE ON UPDATE NO ACTION
 );
 
+-- Host/schemes are loaded and purged per customer.
+CREATE INDEX host_scheme_customer_index ON host_scheme (customer_id);
+
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE host_scheme TO DbC;
 GRANT ALL PRIVILEGES ON SEQUENCE host_scheme_host_scheme_id_seq TO DbC;
 GRANT ALL PRIVILEGES ON TABLE host_scheme TO DbCAdmin;
@@ -197,6 +221,11 @@ CREATE TABLE monitor (
         ON DELETE CASCADE ON UPDATE NO ACTION
 );
 
+-- Latency and monitor status queries select monitors with "monitor_id IN (SELECT monitor_id FROM monitor WHERE ...)"
+-- sub-queries by customer or by host/scheme.  Including the monitor ID lets these sub-queries use index only scans.
+CREATE INDEX monitor_customer_index ON monitor (customer_id, monitor_id);
+CREATE INDEX monitor_host_scheme_index ON monitor (host_scheme_id, monitor_id);
+
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE monitor TO DbC;
 GRANT ALL PRIVILEGES ON SEQUENCE monitor_monitor_id_seq TO DbC;
 GRANT ALL PRIVILEGES ON TABLE monitor TO DbCAdmin;
@@ -207,6 +236,8 @@ GRANT ALL PRIVILEGES ON SEQUENCE monitor_monitor_id_seq TO DbCAdmin;
 -- The latency seconds table stores raw latency values reported by the polling servers.  The time stamp is defined as
 -- the seconds since 12:00:00 January 1, 2021 (UTC) to keep the value under 32-bits.
 -- The latency value is latency in microseconds.
+-- The table is partitioned by time stamp.  The DbC creates partitions ahead of time and drops expired partitions.
+-- Entries outside every partition land in the default partition.
 
 CREATE TABLE latency_seconds (
     monitor_id INTEGER NOT NULL,
@@ -220,15 +251,57 @@ CREATE TABLE latency_seconds (
     CONSTRAINT latency_seconds_server_fk_constraint
         FOREIGN KEY (server_id) REFERENCES servers (server_id)
         ON DELETE CASCADE ON UPDATE NO ACTION
-);
+) PARTITION BY RANGE (timestamp);
 
+CREATE TABLE latency_seconds_default PARTITION OF latency_seconds DEFAULT;
+
+-- The primary key serves queries by monitor.  Queries by server or region alone use this index.  Pure time range
+-- queries are served by partition pruning.
+CREATE INDEX latency_seconds_server_index ON latency_seconds (server_id, timestamp);
+
+ALTER TABLE latency_seconds OWNER TO DbC;
+ALTER TABLE latency_seconds_default OWNER TO DbC;
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_seconds TO DbC;
 GRANT ALL PRIVILEGES ON TABLE latency_seconds TO DbCAdmin;
 
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Latency Blocks table
+-- The latency blocks table replaces the latency seconds table when block storage is enabled.  Each row holds every raw
+-- sample for a monitor and server over one hour, compressed with delta-of-delta timestamps and XOR encoded latencies.
+-- The time stamp is the first second of the hour, using the same epoch as the latency seconds table.  Samples from
+-- each flush are appended to the row by concatenation.
+-- The table is partitioned by time stamp in the same way as the latency seconds table.
+
+CREATE TABLE latency_blocks (
+    monitor_id INTEGER NOT NULL,
+    server_id  SMALLINT NOT NULL,
+    timestamp  INTEGER NOT NULL,
+    samples    BYTEA NOT NULL,
+    PRIMARY KEY (monitor_id, server_id, timestamp),
+    CONSTRAINT latency_blocks_monitor_fk_constraint
+        FOREIGN KEY (monitor_id) REFERENCES monitor (monitor_id)
+        ON DELETE CASCADE ON UPDATE NO ACTION,
+    CONSTRAINT latency_blocks_server_fk_constraint
+        FOREIGN KEY (server_id) REFERENCES servers (server_id)
+        ON DELETE CASCADE ON UPDATE NO ACTION
+) PARTITION BY RANGE (timestamp);
+
+CREATE TABLE latency_blocks_default PARTITION OF latency_blocks DEFAULT;
+
+-- See the latency_seconds_server_index above.
+CREATE INDEX latency_blocks_server_index ON latency_blocks (server_id, timestamp);
+
+ALTER TABLE latency_blocks OWNER TO DbC;
+ALTER TABLE latency_blocks_default OWNER TO DbC;
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_blocks TO DbC;
+GRANT ALL PRIVILEGES ON TABLE latency_blocks TO DbCAdmin;
+
 -- ---------------------------------------------------------------------------------------------------------------------
 -- Latency Aggregated table
 -- The latency aggregated table is used to store older latency values.  Latency and timestamp are random samples taken
 -- over a sample period defined by the start and end timestamp values.
+-- The latency sketch holds a mergeable quantile sketch of every sample in the period.  Sketches merge by concatenation.
+-- The aggregated tables are partitioned by start time stamp in the same way as the latency seconds table.
 
 CREATE TABLE latency_aggregated (
     monitor_id       INTEGER NOT NULL,
@@ -242,6 +315,7 @@ CREATE TABLE latency_aggregated (
     minimum_latency  INTEGER NOT NULL,
     maximum_latency  INTEGER NOT NULL,
     number_samples   INTEGER NOT NULL,
+    latency_sketch   BYTEA,
     PRIMARY KEY (monitor_id, server_id, start_timestamp),
     CONSTRAINT latency_aggregated_monitor_fk_constraint
         FOREIGN KEY (monitor_id) REFERENCES monitor (monitor_id)
@@ -249,15 +323,172 @@ CREATE TABLE latency_aggregated (
     CONSTRAINT latency_aggregated_servers_fk_constraint
         FOREIGN KEY (server_id) REFERENCES servers (server_id)
         ON DELETE CASCADE ON UPDATE NO ACTION
-);
+) PARTITION BY RANGE (start_timestamp);
+
+CREATE TABLE latency_aggregated_default PARTITION OF latency_aggregated DEFAULT;
 
+-- See the latency_seconds_server_index above.
+CREATE INDEX latency_aggregated_server_index ON latency_aggregated (server_id, timestamp);
+
+ALTER TABLE latency_aggregated OWNER TO DbC;
+ALTER TABLE latency_aggregated_default OWNER TO DbC;
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_aggregated TO DbC;
 GRANT ALL PRIVILEGES ON TABLE latency_aggregated TO DbCAdmin;
 
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Latency Daily table
+-- The latency daily table is an aggregation tier holding one entry per monitor and server per day.  Entries are
+-- aggregated from the latency aggregated table and kept longer than the hourly entries.
+
+CREATE TABLE latency_daily (
+    monitor_id       INTEGER NOT NULL,
+    server_id        SMALLINT NOT NULL,
+    timestamp        INTEGER NOT NULL,
+    latency          INTEGER NOT NULL,
+    start_timestamp  INTEGER NOT NULL,
+    end_timestamp    INTEGER NOT NULL,
+    mean_latency     DOUBLE PRECISION NOT NULL,
+    variance_latency DOUBLE PRECISION NOT NULL,
+    minimum_latency  INTEGER NOT NULL,
+    maximum_latency  INTEGER NOT NULL,
+    number_samples   INTEGER NOT NULL,
+    latency_sketch   BYTEA,
+    PRIMARY KEY (monitor_id, server_id, start_timestamp),
+    CONSTRAINT latency_daily_monitor_fk_constraint
+        FOREIGN KEY (monitor_id) REFERENCES monitor (monitor_id)
+        ON DELETE CASCADE ON UPDATE NO ACTION,
+    CONSTRAINT latency_daily_servers_fk_constraint
+        FOREIGN KEY (server_id) REFERENCES servers (server_id)
+        ON DELETE CASCADE ON UPDATE NO ACTION
+) PARTITION BY RANGE (start_timestamp);
+
+CREATE TABLE latency_daily_default PARTITION OF latency_daily DEFAULT;
+
+ALTER TABLE latency_daily OWNER TO DbC;
+ALTER TABLE latency_daily_default OWNER TO DbC;
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_daily TO DbC;
+GRANT ALL PRIVILEGES ON TABLE latency_daily TO DbCAdmin;
+
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Latency Weekly table
+-- The latency weekly table is an aggregation tier holding one entry per monitor and server per week.  Entries are
+-- aggregated from the latency daily table.
+
+CREATE TABLE latency_weekly (
+    monitor_id       INTEGER NOT NULL,
+    server_id        SMALLINT NOT NULL,
+    timestamp        INTEGER NOT NULL,
+    latency          INTEGER NOT NULL,
+    start_timestamp  INTEGER NOT NULL,
+    end_timestamp    INTEGER NOT NULL,
+    mean_latency     DOUBLE PRECISION NOT NULL,
+    variance_latency DOUBLE PRECISION NOT NULL,
+    minimum_latency  INTEGER NOT NULL,
+    maximum_latency  INTEGER NOT NULL,
+    number_samples   INTEGER NOT NULL,
+    latency_sketch   BYTEA,
+    PRIMARY KEY (monitor_id, server_id, start_timestamp),
+    CONSTRAINT latency_weekly_monitor_fk_constraint
+        FOREIGN KEY (monitor_id) REFERENCES monitor (monitor_id)
+        ON DELETE CASCADE ON UPDATE NO ACTION,
+    CONSTRAINT latency_weekly_servers_fk_constraint
+        FOREIGN KEY (server_id) REFERENCES servers (server_id)
+        ON DELETE CASCADE ON UPDATE NO ACTION
+) PARTITION BY RANGE (start_timestamp);
+
+CREATE TABLE latency_weekly_default PARTITION OF latency_weekly DEFAULT;
+
+ALTER TABLE latency_weekly OWNER TO DbC;
+ALTER TABLE latency_weekly_default OWNER TO DbC;
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_weekly TO DbC;
+GRANT ALL PRIVILEGES ON TABLE latency_weekly TO DbCAdmin;
+
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Latency archive segments table
+-- The latency archive segments table is the manifest of columnar segment files holding latency aggregated entries
+-- moved out of the database.  Each segment holds one week of entries for one shard of the monitors.  A segment file is
+-- only used once its row is committed so files left by an interrupted export are ignored and removed.
+
+CREATE TABLE latency_archive_segments (
+    file_name       TEXT NOT NULL PRIMARY KEY,
+    start_timestamp INTEGER NOT NULL,
+    end_timestamp   INTEGER NOT NULL,
+    shard           SMALLINT NOT NULL,
+    number_rows     INTEGER NOT NULL
+);
+
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_archive_segments TO DbC;
+GRANT ALL PRIVILEGES ON TABLE latency_archive_segments TO DbCAdmin;
+
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Latency purge job table
+-- The latency purge job table tracks background purges of customer latency entries.  Entries are deleted in batches
+-- with each batch committed alongside the job's progress so an interrupted purge resumes where it stopped.  The table
+-- index is the index into the comma separated table names of the first table not yet fully purged.
+
+CREATE TYPE latency_purge_job_status AS ENUM('PENDING','RUNNING','COMPLETED','FAILED');
+
+CREATE TABLE latency_purge_job (
+    job_id       BIGSERIAL NOT NULL PRIMARY KEY,
+    customer_ids TEXT NOT NULL,
+    table_names  TEXT NOT NULL,
+    table_index  SMALLINT NOT NULL DEFAULT 0,
+    rows_deleted BIGINT NOT NULL DEFAULT 0,
+    status       latency_purge_job_status NOT NULL DEFAULT 'PENDING'
+);
+
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_purge_job TO DbC;
+GRANT ALL PRIVILEGES ON SEQUENCE latency_purge_job_job_id_seq TO DbC;
+GRANT ALL PRIVILEGES ON TABLE latency_purge_job TO DbCAdmin;
+GRANT ALL PRIVILEGES ON SEQUENCE latency_purge_job_job_id_seq TO DbCAdmin;
+
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Admin job table
+-- The admin job table tracks long admin operations, such as customer purges and server reassignments, run in the
+-- background.  Parameters are stored as a JSON document.  Jobs left pending or running by a restart are run again.
+
+CREATE TYPE admin_job_status AS ENUM('PENDING','RUNNING','COMPLETED','FAILED','CANCELED');
+
+CREATE TABLE admin_job (
+    job_id     BIGSERIAL NOT NULL PRIMARY KEY,
+    job_type   VARCHAR(32) NOT NULL,
+    parameters TEXT NOT NULL,
+    completed  BIGINT NOT NULL DEFAULT 0,
+    total      BIGINT NOT NULL DEFAULT 0,
+    message    TEXT NOT NULL DEFAULT '',
+    status     admin_job_status NOT NULL DEFAULT 'PENDING'
+);
+
+-- Unfinished jobs are found by status on startup.
+CREATE INDEX admin_job_status_index ON admin_job (status);
+
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE admin_job TO DbC;
+GRANT ALL PRIVILEGES ON SEQUENCE admin_job_job_id_seq TO DbC;
+GRANT ALL PRIVILEGES ON TABLE admin_job TO DbCAdmin;
+GRANT ALL PRIVILEGES ON SEQUENCE admin_job_job_id_seq TO DbCAdmin;
+
+-- ---------------------------------------------------------------------------------------------------------------------
+-- Latency aggregation watermark table
+-- The latency aggregation watermark table records each monitor range committed by an aggregation pass.  The row is
+-- written in the same transaction as the range's aggregates so an interrupted pass can be resumed with its original
+-- time threshold.  Rows are removed once the pass completes.
+
+CREATE TABLE latency_aggregation_watermark (
+    output_table     VARCHAR(64) NOT NULL,
+    first_monitor_id INTEGER NOT NULL,
+    time_threshold   BIGINT NOT NULL,
+    PRIMARY KEY (output_table, first_monitor_id)
+);
+
+GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE latency_aggregation_watermark TO DbC;
+GRANT ALL PRIVILEGES ON TABLE latency_aggregation_watermark TO DbCAdmin;
+
 -- ---------------------------------------------------------------------------------------------------------------------
 -- Event table
 -- The event table stores information about an event reported by a polling server.  Only events that are reported to the
 -- customer are stored.
+-- The table is partitioned by time stamp so retention drops whole partitions.  The DbC creates partitions ahead of time
+-- when an event partition period is configured.  Entries outside every partition land in the default partition.
 
 CREATE TYPE event_event_type AS ENUM(
     'WORKING',
@@ -279,7 +510,9 @@ CREATE TYPE event_event_type AS ENUM(
     'TRANSACTION',
     'INQUIRY',
     'SUPPORT_REQUEST',
-    'STORAGE_LIMIT_REACHED'
+    'STORAGE_LIMIT_REACHED',
+    'LATENCY_DEGRADED',
+    'LATENCY_RESTORED'
 );
 
 CREATE TABLE event (
@@ -290,14 +523,27 @@ CREATE TABLE event (
     event_type  event_event_type NOT NULL,
     message     VARCHAR(128) DEFAULT NULL,
     hash        BYTEA,
-    PRIMARY KEY (event_id),
+    PRIMARY KEY (event_id, timestamp),
     CONSTRAINT event_customer_capabilities_fk_constraint
         FOREIGN KEY (customer_id) REFERENCES customer_capabilities (customer_id)
         ON DELETE CASCADE ON UPDATE NO ACTION,
     CONSTRAINT event_monitor_fk_constraint
         FOREIGN KEY (monitor_id) REFERENCES monitor (monitor_id) ON DELETE CASCADE ON UPDATE NO ACTION
-);
+) PARTITION BY RANGE (timestamp);
+
+CREATE TABLE event_default PARTITION OF event DEFAULT;
+
+-- Event listings are ordered by timestamp and event ID so these indexes serve both time window and keyset pagination
+-- queries without a sort.
+CREATE INDEX event_customer_timestamp_index ON event (customer_id, timestamp, event_id);
+CREATE INDEX event_monitor_timestamp_index ON event (monitor_id, timestamp, event_id);
 
+-- The event checkers look up "MAX(timestamp) ... WHERE monitor_id = ? AND event_type IN (...)".  Leading with the
+-- event type keeps the maximum a single index probe per event type.
+CREATE INDEX event_monitor_type_timestamp_index ON event (monitor_id, event_type, timestamp);
+
+ALTER TABLE event OWNER TO DbC;
+ALTER TABLE event_default OWNER TO DbC;
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE event TO DbC;
 GRANT ALL PRIVILEGES ON SEQUENCE event_event_id_seq TO DbC;
 GRANT ALL PRIVILEGES ON TABLE event TO DbCAdmin;
@@ -317,6 +563,9 @@ CREATE TABLE monitor_status (
         ON DELETE CASCADE ON UPDATE NO ACTION
 );
 
+-- Monitor status is read and updated by monitor ID.
+CREATE INDEX monitor_status_monitor_index ON monitor_status (monitor_id);
+
 GRANT SELECT,INSERT,UPDATE,DELETE ON TABLE monitor_status TO DbC;
 GRANT ALL PRIVILEGES ON TABLE monitor_status TO DbCAdmin;
 